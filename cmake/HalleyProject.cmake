@@ -183,6 +183,12 @@ if (USE_MEDIA_FOUNDATION)
 	add_definitions(-DWITH_MEDIA_FOUNDATION)
 endif()
 
+# Memory tracking (see MemoryTracker)
+option(USE_MEMORY_TRACKING "Count allocations by subsystem" OFF)
+if (USE_MEMORY_TRACKING)
+	add_definitions(-DHALLEY_MEMORY_TRACKING)
+endif()
+
 
 # Apple frameworks
 if (APPLE)
@@ -194,10 +200,11 @@ if (APPLE)
 	find_library(IOKIT_LIBRARY IOKit)
 	find_library(COREVIDEO_LIBRARY CoreVideo)
 	find_library(AUDIOTOOLBOX_LIBRARY AudioToolbox)
+	find_library(CORESERVICES_LIBRARY CoreServices)
 
-	mark_as_advanced(CARBON_LIBRARY COCOA_LIBRARY COREAUDIO_LIBRARY AUDIOTOOLBOX_LIBRARY AUDIOUNIT_LIBRARY FORCEFEEDBACK_LIBRARY IOKIT_LIBRARY COREVIDEO_LIBRARY)
+	mark_as_advanced(CARBON_LIBRARY COCOA_LIBRARY COREAUDIO_LIBRARY AUDIOTOOLBOX_LIBRARY AUDIOUNIT_LIBRARY FORCEFEEDBACK_LIBRARY IOKIT_LIBRARY COREVIDEO_LIBRARY CORESERVICES_LIBRARY)
 
-	set(EXTRA_LIBS ${EXTRA_LIBS} ${CARBON_LIBRARY} ${COCOA_LIBRARY} ${COREAUDIO_LIBRARY} ${AUDIOTOOLBOX_LIBRARY} ${AUDIOUNIT_LIBRARY} ${FORCEFEEDBACK_LIBRARY} ${IOKIT_LIBRARY} ${COREVIDEO_LIBRARY} iconv)
+	set(EXTRA_LIBS ${EXTRA_LIBS} ${CARBON_LIBRARY} ${COCOA_LIBRARY} ${COREAUDIO_LIBRARY} ${AUDIOTOOLBOX_LIBRARY} ${AUDIOUNIT_LIBRARY} ${FORCEFEEDBACK_LIBRARY} ${IOKIT_LIBRARY} ${COREVIDEO_LIBRARY} ${CORESERVICES_LIBRARY} iconv)
 
 	if (BUILD_MACOSX_BUNDLE)
 		add_definitions(-DHALLEY_MACOSX_BUNDLE)
@@ -1,14 +1,11 @@
 uniform sampler2D tex0;
-layout(std140) uniform MaterialBlock {
-	float u_smoothness;
-	float u_outline;
-	vec4 u_outlineColour;
-};
 
 in vec2 v_texCoord0;
 in vec2 v_pixelTexCoord0;
 in vec4 v_colour;
 in vec4 v_colourAdd;
+in vec2 v_custom0; // x = smoothness, y = outline
+in vec4 v_custom1; // Outline colour
 
 in vec4 gl_FragCoord;
 
@@ -20,14 +17,14 @@ void main() {
 	float texGrad = max(dx, dy);
 
 	float a = texture(tex0, v_texCoord0).a;
-	float s = u_smoothness * texGrad;
+	float s = v_custom0.x * texGrad;
 	float inEdge = 0.5;
-	float outEdge = inEdge - clamp(u_outline, 0.0, 0.995) * 0.5;
+	float outEdge = inEdge - clamp(v_custom0.y, 0.0, 0.995) * 0.5;
 
 	float edge = smoothstep(clamp(outEdge - s, 0.001, 1.0), clamp(outEdge + s, 0.0, 0.999), a);
 	float outline = 1.0 - smoothstep(inEdge - s, inEdge + s, a);
 	vec4 colFill = v_colour;
-	vec4 colOutline = u_outlineColour;
+	vec4 colOutline = v_custom1;
 	vec4 col = mix(colFill, colOutline, outline);
 	outCol = vec4(col.rgb, col.a * edge);
 }
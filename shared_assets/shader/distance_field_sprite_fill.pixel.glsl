@@ -1,14 +1,11 @@
 uniform sampler2D tex0;
-layout(std140) uniform MaterialBlock {
-	float u_smoothness;
-	float u_outline;
-	vec4 u_outlineColour;
-};
 
 in vec2 v_texCoord0;
 in vec2 v_pixelTexCoord0;
 in vec4 v_colour;
 in vec4 v_colourAdd;
+in vec2 v_custom0; // x = smoothness, y = outline
+in vec4 v_custom1; // Outline colour
 
 in vec4 gl_FragCoord;
 
@@ -20,7 +17,7 @@ void main() {
 	float texGrad = max(dx, dy);
 
 	float a = texture(tex0, v_texCoord0).a;
-	float s = max(u_smoothness * texGrad, 0.001);
+	float s = max(v_custom0.x * texGrad, 0.001);
 	float inEdge = 0.51;
 
 	float edge0 = clamp(inEdge - s, 0.01, 0.98);
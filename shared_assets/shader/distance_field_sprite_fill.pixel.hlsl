@@ -3,12 +3,6 @@ SamplerState sampler0 : register(s0) {
 	Filter = D3D11_FILTER_MIN_MAG_MIP_POINT;
 };
 
-cbuffer MaterialBlock : register(b1) {
-	float u_smoothness;
-	float u_outline;
-	float4 u_outlineColour;
-};
-
 struct VOut {
     float4 position : SV_POSITION;
     float2 texCoord0 : TEXCOORD0;
@@ -17,6 +11,8 @@ struct VOut {
     float4 colourAdd : COLOR1;
     float2 vertPos : POSITION1;
     float2 pixelPos : POSITION2;
+    float2 custom0 : TEXCOORD2; // x = smoothness, y = outline
+    float4 custom1 : COLOR2; // Outline colour
 };
 
 
@@ -26,7 +22,7 @@ float4 main(VOut input) : SV_TARGET {
 	float texGrad = max(dx, dy);
 
 	float a = tex0.Sample(sampler0, input.texCoord0).a;
-	float s = max(u_smoothness * texGrad, 0.001);
+	float s = max(input.custom0.x * texGrad, 0.001);
 	float inEdge = 0.51;
 
 	float edge0 = clamp(inEdge - s, 0.01, 0.98);
@@ -3,12 +3,6 @@ SamplerState sampler0 : register(s0) {
 	Filter = D3D11_FILTER_MIN_MAG_MIP_POINT;
 };
 
-cbuffer MaterialBlock : register(b1) {
-	float u_smoothness;
-	float u_outline;
-	float4 u_outlineColour;
-};
-
 struct VOut {
     float4 position : SV_POSITION;
     float2 texCoord0 : TEXCOORD0;
@@ -17,6 +11,8 @@ struct VOut {
     float4 colourAdd : COLOR1;
     float2 vertPos : POSITION1;
     float2 pixelPos : POSITION2;
+    float2 custom0 : TEXCOORD2; // x = smoothness, y = outline
+    float4 custom1 : COLOR2; // Outline colour
 };
 
 
@@ -26,14 +22,14 @@ float4 main(VOut input) : SV_TARGET {
 	float texGrad = max(dx, dy);
 
 	float a = tex0.Sample(sampler0, input.texCoord0).a;
-	float s = max(u_smoothness * texGrad, 0.001);
+	float s = max(input.custom0.x * texGrad, 0.001);
 	float inEdge = 0.5;
-	float outEdge = inEdge - clamp(u_outline, 0.0, 0.995) * 0.5;
+	float outEdge = inEdge - clamp(input.custom0.y, 0.0, 0.995) * 0.5;
 
 	float edge0 = clamp(outEdge - s, 0.01, 0.98);
 	float edge1 = clamp(outEdge + s, edge0 + 0.01, 0.99);
 
 	float edge = smoothstep(edge0, edge1, a) * input.colour.a;
-	float4 col = u_outlineColour;
+	float4 col = input.custom1;
 	return float4(col.rgb, col.a * edge);
 }
@@ -1,5 +1,11 @@
 uniform sampler2D tex0;
 
+layout(std140) uniform MaterialBlock {
+    vec2 u_frameSize;
+    vec2 u_textureSize;
+    float u_yPlaneHeight;
+};
+
 in vec2 v_texCoord0;
 in vec4 v_colour;
 in vec4 v_colourAdd;
@@ -7,20 +13,19 @@ in vec4 v_colourAdd;
 out vec4 outCol;
 
 void main() {
-    const float frameWidth = 1920.0;
-    const float frameHeight = 1080.0;
-    const float width = 1920.0;
-    const float halfWidth = floor(width * 0.5);
-    const float yHeight = 1088.0;
-    const float uvHeight = 544.0;
-    const float height = yHeight + uvHeight;
-    const float uvPlaneY = yHeight / height;
+    float frameWidth = u_frameSize.x;
+    float frameHeight = u_frameSize.y;
+    float width = u_textureSize.x;
+    float halfWidth = floor(width * 0.5);
+    float yHeight = u_yPlaneHeight;
+    float height = u_textureSize.y;
+    float uvPlaneY = yHeight / height;
 
     vec2 yPlaneStart = vec2(0.0, 0.0);
     vec2 uPlaneStart = vec2(0.0, uvPlaneY);
     vec2 vPlaneStart = vec2(1.0 / width, uvPlaneY);
 
-    vec2 texCoord = vec2(v_texCoord0.x, v_texCoord0.y * frameHeight / height);
+    vec2 texCoord = vec2(v_texCoord0.x * frameWidth / width, v_texCoord0.y * frameHeight / height);
     vec2 uvTexCoord = vec2(floor(texCoord.x * halfWidth) / halfWidth + (0.5 / width), texCoord.y * 0.5);
 
 	float y = texture(tex0, texCoord + yPlaneStart).r;
@@ -1,6 +1,12 @@
 Texture2D tex0 : register(t0);
 SamplerState sampler0 : register(s0);
 
+cbuffer MaterialBlock : register(b1) {
+    float2 u_frameSize;
+    float2 u_textureSize;
+    float u_yPlaneHeight;
+};
+
 struct VOut {
     float4 position : SV_POSITION;
     float2 texCoord0 : TEXCOORD0;
@@ -12,20 +18,19 @@ struct VOut {
 };
 
 float4 main(VOut input) : SV_TARGET {
-    const float frameWidth = 1920.0;
-    const float frameHeight = 1080.0;
-    const float width = 1920.0;
-    const float halfWidth = floor(width * 0.5);
-    const float yHeight = 1088.0;
-    const float uvHeight = 544.0;
-    const float height = yHeight + uvHeight;
-    const float uvPlaneY = yHeight / height;
+    float frameWidth = u_frameSize.x;
+    float frameHeight = u_frameSize.y;
+    float width = u_textureSize.x;
+    float halfWidth = floor(width * 0.5);
+    float yHeight = u_yPlaneHeight;
+    float height = u_textureSize.y;
+    float uvPlaneY = yHeight / height;
 
     float2 yPlaneStart = float2(0.0, 0.0);
     float2 uPlaneStart = float2(0.0, uvPlaneY);
     float2 vPlaneStart = float2(1.0 / width, uvPlaneY);
 
-    float2 texCoord = float2(input.texCoord0.x, input.texCoord0.y * frameHeight / height);
+    float2 texCoord = float2(input.texCoord0.x * frameWidth / width, input.texCoord0.y * frameHeight / height);
     float2 uvTexCoord = float2(floor(texCoord.x * halfWidth) / halfWidth + (0.5 / width), texCoord.y * 0.5);
 
 	float y = tex0.Sample(sampler0, texCoord + yPlaneStart).r;
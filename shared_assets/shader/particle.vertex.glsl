@@ -0,0 +1,80 @@
+layout(std140) uniform HalleyBlock {
+	mat4 u_mvp;
+};
+
+layout(std140) uniform ParticleBlock {
+	vec4 u_emitter;
+	vec4 u_positionArea;
+	vec4 u_lifeSpeed;
+	vec4 u_angles;
+	vec4 u_accelerationScale;
+	vec4 u_startColour;
+	vec4 u_endColour;
+	vec4 u_texRect;
+	vec4 u_sizePivot;
+};
+
+in vec4 a_vertPos;
+in vec4 a_seed;
+
+out vec2 v_texCoord0;
+out vec2 v_pixelTexCoord0;
+out vec4 v_colour;
+out vec4 v_colourAdd;
+out vec2 v_vertPos;
+out vec2 v_pixelPos;
+
+// Each slot gets different (but deterministic) random values every time it's reused
+float getRandom(float seed, float generation) {
+	return fract(seed + generation * 0.61803398875);
+}
+
+void getColours(vec4 inColour, out vec4 baseColour, out vec4 addColour) {
+	vec4 inputCol = vec4(inColour.rgb * inColour.a, inColour.a); // Premultiply alpha
+	vec4 baseCol = clamp(inputCol, vec4(0, 0, 0, 0), vec4(1, 1, 1, 1));
+	baseColour = baseCol;
+	addColour = clamp(inputCol - baseCol, vec4(0, 0, 0, 0), vec4(1, 1, 1, 0));
+}
+
+void main() {
+	float time = u_emitter.x;
+	float spawnRate = u_emitter.y;
+	float numSlots = u_emitter.z;
+	float stopTime = u_emitter.w;
+	float slot = a_vertPos.z;
+
+	// Slots are spawned in turn, so this slot's current particle was spawned at the last time it came around
+	float generation = floor((time * spawnRate - slot) / numSlots);
+	float spawnTime = (slot + generation * numSlots) / spawnRate;
+	float age = time - spawnTime;
+	float lifetime = mix(u_lifeSpeed.x, u_lifeSpeed.y, getRandom(a_seed.x, generation));
+	float t = age / lifetime;
+
+	v_texCoord0 = mix(u_texRect.xy, u_texRect.zw, a_vertPos.xy);
+	v_pixelTexCoord0 = v_texCoord0 * u_sizePivot.xy;
+	v_vertPos = a_vertPos.xy;
+	v_pixelPos = u_sizePivot.xy * a_vertPos.xy;
+
+	if (generation < 0.0 || spawnTime > stopTime || t >= 1.0) {
+		// Not alive, so all of its vertices go to the same point outside of the view
+		v_colour = vec4(0, 0, 0, 0);
+		v_colourAdd = vec4(0, 0, 0, 0);
+		gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+		return;
+	}
+
+	vec2 spawnOffset = (vec2(getRandom(a_seed.y, generation), getRandom(a_seed.z, generation)) * 2.0 - 1.0) * u_positionArea.zw;
+	float direction = mix(u_angles.x, u_angles.y, getRandom(a_seed.w, generation));
+	float speed = mix(u_lifeSpeed.z, u_lifeSpeed.w, getRandom(a_seed.x + 0.5, generation));
+	float rotation = mix(u_angles.z, u_angles.w, getRandom(a_seed.y + 0.5, generation)) * age;
+	vec2 position = u_positionArea.xy + spawnOffset + vec2(cos(direction), sin(direction)) * speed * age + 0.5 * u_accelerationScale.xy * age * age;
+	vec2 size = u_sizePivot.xy * mix(u_accelerationScale.z, u_accelerationScale.w, t);
+
+	getColours(mix(u_startColour, u_endColour, t), v_colour, v_colourAdd);
+
+	float c = cos(rotation);
+	float s = sin(rotation);
+	mat2 m = mat2(c, s, -s, c);
+	vec2 pos = position + m * ((a_vertPos.xy - u_sizePivot.zw) * size);
+	gl_Position = u_mvp * vec4(pos, 0.0, 1.0);
+}
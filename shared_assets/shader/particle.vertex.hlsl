@@ -0,0 +1,89 @@
+cbuffer HalleyBlock : register(b0) {
+    float4x4 u_mvp;
+};
+
+cbuffer ParticleBlock : register(b1) {
+    float4 u_emitter;
+    float4 u_positionArea;
+    float4 u_lifeSpeed;
+    float4 u_angles;
+    float4 u_accelerationScale;
+    float4 u_startColour;
+    float4 u_endColour;
+    float4 u_texRect;
+    float4 u_sizePivot;
+};
+
+struct VIn {
+    float4 vertPos : VERTPOS;
+    float4 seed : SEED;
+};
+
+struct VOut {
+    float4 position : SV_POSITION;
+    float2 texCoord0 : TEXCOORD0;
+    float2 pixelTexCoord0 : TEXCOORD1;
+    float4 colour : COLOR0;
+    float4 colourAdd : COLOR1;
+    float2 vertPos : POSITION1;
+    float2 pixelPos : POSITION2;
+};
+
+// Each slot gets different (but deterministic) random values every time it's reused
+float getRandom(float seed, float generation) {
+    return frac(seed + generation * 0.61803398875);
+}
+
+void getColours(float4 inColour, out float4 baseColour, out float4 addColour) {
+    float4 inputCol = float4(inColour.rgb * inColour.a, inColour.a); // Premultiply alpha
+    float4 baseCol = clamp(inputCol, float4(0, 0, 0, 0), float4(1, 1, 1, 1));
+    baseColour = baseCol;
+    addColour = clamp(inputCol - baseCol, float4(0, 0, 0, 0), float4(1, 1, 1, 0));
+}
+
+VOut main(VIn input) {
+    VOut result;
+
+    float time = u_emitter.x;
+    float spawnRate = u_emitter.y;
+    float numSlots = u_emitter.z;
+    float stopTime = u_emitter.w;
+    float slot = input.vertPos.z;
+
+    // Slots are spawned in turn, so this slot's current particle was spawned at the last time it came around
+    float generation = floor((time * spawnRate - slot) / numSlots);
+    float spawnTime = (slot + generation * numSlots) / spawnRate;
+    float age = time - spawnTime;
+    float lifetime = lerp(u_lifeSpeed.x, u_lifeSpeed.y, getRandom(input.seed.x, generation));
+    float t = age / lifetime;
+
+    result.texCoord0 = lerp(u_texRect.xy, u_texRect.zw, input.vertPos.xy);
+    result.pixelTexCoord0 = result.texCoord0 * u_sizePivot.xy;
+    result.vertPos = input.vertPos.xy;
+    result.pixelPos = u_sizePivot.xy * input.vertPos.xy;
+
+    if (generation < 0.0 || spawnTime > stopTime || t >= 1.0) {
+        // Not alive, so all of its vertices go to the same point outside of the view
+        result.colour = float4(0, 0, 0, 0);
+        result.colourAdd = float4(0, 0, 0, 0);
+        result.position = float4(2.0, 2.0, 2.0, 1.0);
+        return result;
+    }
+
+    float2 spawnOffset = (float2(getRandom(input.seed.y, generation), getRandom(input.seed.z, generation)) * 2.0 - 1.0) * u_positionArea.zw;
+    float direction = lerp(u_angles.x, u_angles.y, getRandom(input.seed.w, generation));
+    float speed = lerp(u_lifeSpeed.z, u_lifeSpeed.w, getRandom(input.seed.x + 0.5, generation));
+    float rotation = lerp(u_angles.z, u_angles.w, getRandom(input.seed.y + 0.5, generation)) * age;
+    float2 position = u_positionArea.xy + spawnOffset + float2(cos(direction), sin(direction)) * speed * age + 0.5 * u_accelerationScale.xy * age * age;
+    float2 size = u_sizePivot.xy * lerp(u_accelerationScale.z, u_accelerationScale.w, t);
+
+    getColours(lerp(u_startColour, u_endColour, t), result.colour, result.colourAdd);
+
+    float c = cos(rotation);
+    float s = sin(rotation);
+    float2x2 m = { c, -s, s, c };
+    float2 pos = position + mul(m, ((input.vertPos.xy - u_sizePivot.zw) * size));
+    result.position = mul(u_mvp, float4(pos, 0.0, 1.0));
+
+    return result;
+}
@@ -11,6 +11,7 @@ in vec4 a_colour;
 in vec4 a_texCoord0;
 in float a_rotation;
 in float a_textureRotation;
+in float a_depth;
 
 out vec2 v_texCoord0;
 out vec2 v_pixelTexCoord0;
@@ -31,13 +32,14 @@ void getColours(vec4 inColour, out vec4 baseColour, out vec4 addColour) {
 	addColour = clamp(inputCol - baseCol, vec4(0, 0, 0, 0), vec4(1, 1, 1, 0));
 }
 
-vec4 getVertexPosition(vec2 position, vec2 pivot, vec2 size, vec2 vertPos, float angle) {
+vec4 getVertexPosition(vec2 position, vec2 pivot, vec2 size, vec2 vertPos, float angle, float depth) {
 	float c = cos(angle);
 	float s = sin(angle);
 	mat2 m = mat2(c, s, -s, c);
 	
 	vec2 pos = position + m * ((vertPos - pivot) * size);
-	return u_mvp * vec4(pos, 0.0, 1.0);
+	vec4 result = u_mvp * vec4(pos, 0.0, 1.0);
+	return vec4(result.xy, (depth * 2.0 - 1.0) * result.w, result.w); // depth is [0..1], GL's clip space is [-1..1]
 }
 
 void main() {
@@ -46,5 +48,5 @@ void main() {
 	v_vertPos = a_vertPos.xy;
 	v_pixelPos = a_size * a_scale * a_vertPos.xy;
 	getColours(a_colour, v_colour, v_colourAdd);
-	gl_Position = getVertexPosition(a_position, a_pivot, a_size * a_scale, a_vertPos.xy, a_rotation);
+	gl_Position = getVertexPosition(a_position, a_pivot, a_size * a_scale, a_vertPos.xy, a_rotation, a_depth);
 }
@@ -12,6 +12,7 @@ struct VIn {
     float4 texCoord0 : TEXCOORD0;
     float rotation : ROTATION;
     float textureRotation : TEXTUREROTATION;
+    float depth : DEPTH;
 };
 
 struct VOut {
@@ -36,13 +37,14 @@ void getColours(float4 inColour, out float4 baseColour, out float4 addColour) {
     addColour = clamp(inputCol - baseCol, float4(0, 0, 0, 0), float4(1, 1, 1, 0));
 }
 
-float4 getVertexPosition(float2 position, float2 pivot, float2 size, float2 vertPos, float angle) {
+float4 getVertexPosition(float2 position, float2 pivot, float2 size, float2 vertPos, float angle, float depth) {
     float c = cos(angle);
     float s = sin(angle);
     float2x2 m = { c, -s, s, c };
     
     float2 pos = position + mul(m, ((vertPos - pivot) * size));
-    return mul(u_mvp, float4(pos, 0.0, 1.0));
+    float4 result = mul(u_mvp, float4(pos, 0.0, 1.0));
+    return float4(result.xy, depth * result.w, result.w);
 }
 
 VOut main(VIn input) {
@@ -53,7 +55,7 @@ VOut main(VIn input) {
     result.vertPos = input.vertPos.xy;
     result.pixelPos = input.size * input.scale * input.vertPos.xy;
     getColours(input.colour, result.colour, result.colourAdd);
-    result.position = getVertexPosition(input.position, input.pivot, input.size * input.scale, input.vertPos.xy, input.rotation);
+    result.position = getVertexPosition(input.position, input.pivot, input.size * input.scale, input.vertPos.xy, input.rotation, input.depth);
 
     return result;
 }
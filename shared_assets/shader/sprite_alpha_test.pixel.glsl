@@ -0,0 +1,15 @@
+uniform sampler2D tex0;
+
+in vec2 v_texCoord0;
+in vec4 v_colour;
+in vec4 v_colourAdd;
+
+out vec4 outCol;
+
+void main() {
+	vec4 col = texture(tex0, v_texCoord0.xy);
+	if (col.a < 0.5) {
+		discard;
+	}
+	outCol = col * v_colour + v_colourAdd * col.a;
+}
@@ -0,0 +1,18 @@
+Texture2D tex0 : register(t0);
+SamplerState sampler0 : register(s0);
+
+struct VOut {
+    float4 position : SV_POSITION;
+    float2 texCoord0 : TEXCOORD0;
+    float2 pixelTexCoord0 : TEXCOORD1;
+    float4 colour : COLOR0;
+    float4 colourAdd : COLOR1;
+    float2 vertPos : POSITION1;
+    float2 pixelPos : POSITION2;
+};
+
+float4 main(VOut input) : SV_TARGET {
+	float4 col = tex0.Sample(sampler0, input.texCoord0.xy);
+	clip(col.a - 0.5);
+	return col * input.colour + input.colourAdd * col.a;
+}
@@ -2,11 +2,34 @@
 #include "halley/resources/resource.h"
 #include "halley/resources/resource_data.h"
 #include "halley/core/api/audio_api.h"
+#include "halley/audio/audio_clip_format.h"
+#include "halley/text/string_converter.h"
+#include <atomic>
+#include <mutex>
 
 namespace Halley
 {
 	class ResourceLoader;
-	class VorbisData;
+	class AudioClipStreamer;
+
+	// How sounds played by an event get their samples
+	enum class AudioClipPolicy
+	{
+		DecodeOnPlay, // Kept compressed, decoded when played into a cache with a memory budget
+		KeepDecoded, // Decoded once and kept, outside of that budget
+		Stream // Decoded while playing, nothing is kept
+	};
+
+	template <>
+	struct EnumNames<AudioClipPolicy> {
+		constexpr std::array<const char*, 3> operator()() const {
+			return{{
+				"decodeOnPlay",
+				"keepDecoded",
+				"stream"
+			}};
+		}
+	};
 
 	class IAudioClip
 	{
@@ -20,7 +43,7 @@ namespace Halley
 		virtual bool isLoaded() const { return true; }
 	};
 
-	class AudioClip : public AsyncResource, public IAudioClip
+	class AudioClip : public AsyncResource, public IAudioClip, public std::enable_shared_from_this<AudioClip>
 	{
 	public:
 		AudioClip(size_t numChannels);
@@ -37,7 +60,19 @@ namespace Halley
 		size_t getLoopPoint() const override; // in samples
 		bool isLoaded() const override;
 
+		// Non-streamed clips only keep their compressed data around, unless asked to hold on to the decoded samples.
+		// Clips in any format other than Vorbis are always read straight from it, see AudioClipFormat.
+		bool isStreaming() const;
+		AudioClipFormat getFormat() const;
+		std::shared_ptr<ResourceDataStatic> getCompressedData() const;
+		void keepDecoded() const;
+		bool isDecoded() const;
+
+		size_t getMemoryUsage() const override;
+		bool reduceMemoryUsage() override; // Drops the decoded samples, if nothing else is holding on to the clip
+
 		static std::shared_ptr<AudioClip> loadResource(ResourceLoader& loader);
+		static bool loadsFromStream(const Metadata& meta);
 		constexpr static AssetType getAssetType() { return AssetType::AudioClip; }
 		void reload(Resource&& resource) override;
 
@@ -45,14 +80,17 @@ namespace Halley
 		size_t sampleLength = 0;
 		size_t numChannels = 0;
 		size_t loopPoint = 0;
-		mutable size_t streamPos = 0;
 		bool streaming = false;
+		AudioClipFormat format = AudioClipFormat::Vorbis;
 
-		// TODO: sort this mess?
-		mutable std::vector<std::vector<AudioConfig::SampleFormat>> temp0;
-		mutable std::vector<std::vector<AudioConfig::SampleFormat>> temp1;
+		std::shared_ptr<ResourceDataStatic> compressed;
 		mutable std::vector<std::vector<AudioConfig::SampleFormat>> samples;
-		mutable std::unique_ptr<VorbisData> vorbisData;
+		mutable std::atomic<bool> decoded;
+		mutable bool keepDecodedRequested = false;
+		mutable std::mutex decodeMutex;
+		std::shared_ptr<AudioClipStreamer> streamer;
+
+		void decode() const;
 	};
 
 	class StreamingAudioClip : public IAudioClip
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "halley/text/string_converter.h"
+#include "halley/utils/utils.h"
+#include <gsl/gsl>
+#include <vector>
+
+namespace Halley
+{
+	// How an audio clip's samples are stored. Other than Vorbis, they're cheap enough to decode straight into the mix
+	// buffers as the clip plays, so they never need decoding ahead of time, nor memory for the decoded samples.
+	enum class AudioClipFormat
+	{
+		Vorbis,
+		PCM16, // Half the size of decoded samples
+		ADPCM // IMA-ADPCM, 4 bits per sample (plus a small header per block), at some cost in quality
+	};
+
+	template <>
+	struct EnumNames<AudioClipFormat> {
+		constexpr std::array<const char*, 3> operator()() const {
+			return{{
+				"vorbis",
+				"pcm16",
+				"adpcm"
+			}};
+		}
+	};
+
+	// Channels are stored one after another, each numSamples long, so each can be read on its own
+	namespace AudioClipCodec
+	{
+		Bytes encode(AudioClipFormat format, gsl::span<const std::vector<float>> channels);
+		size_t getEncodedSize(AudioClipFormat format, size_t numChannels, size_t numSamples);
+
+		// Decodes len samples of channel starting at pos into dst
+		void decode(AudioClipFormat format, gsl::span<const gsl::byte> data, size_t numSamples, size_t channel, size_t pos, size_t len, gsl::span<float> dst);
+	}
+}
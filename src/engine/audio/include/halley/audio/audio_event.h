@@ -26,6 +26,7 @@ namespace Halley
 		void deserialize(Deserializer& s);
 
 		void loadDependencies(Resources& resources) const;
+		std::vector<String> getClips() const;
 
 		void reload(Resource&& resource) override;
 		static std::shared_ptr<AudioEvent> loadResource(ResourceLoader& loader);
@@ -74,6 +75,7 @@ namespace Halley
 		void deserialize(Deserializer& s) override;
 
 		void loadDependencies(const Resources& resources) override;
+		const std::vector<String>& getClips() const;
 
 	private:
 		std::vector<String> clips;
@@ -84,5 +86,6 @@ namespace Halley
 		float delay = 0.0f;
 		float minimumSpace = 0.0f;
 		bool loop = false;
+		AudioClipPolicy policy = AudioClipPolicy::DecodeOnPlay;
 	};
 }
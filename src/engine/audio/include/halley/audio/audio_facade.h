@@ -4,6 +4,7 @@
 #include <atomic>
 #include <vector>
 #include "halley/core/api/halley_api_internal.h"
+#include "halley/concurrency/spsc_queue.h"
 #include <map>
 
 namespace Halley {
@@ -32,6 +33,7 @@ namespace Halley {
 		void stopPlayback() override;
 		void pausePlayback() override;
 		void resumePlayback() override;
+		void setLowLatency(bool enabled) override;
 
 	    AudioHandle postEvent(const String& name, AudioPosition position) override;
 
@@ -43,9 +45,15 @@ namespace Halley {
 
 		void setMasterVolume(float volume = 1.0f) override;
 		void setGroupVolume(const String& groupName, float volume = 1.0f) override;
+		void setGroupParent(const String& groupName, const String& parentName) override;
+		void addGroupEffect(const String& groupName, AudioEffectParameters effect) override;
+		void clearGroupEffects(const String& groupName) override;
 
 	    void setOutputChannels(std::vector<AudioChannelData> audioChannelData) override;
 	    void setListener(AudioListenerData listener) override;
+		void setMaxVoices(size_t maxVoices) override;
+		void setDecodedAudioBudget(size_t bytes) override;
+		AudioStats getStats() const override;
 
 		void onAudioException(std::exception& e);
 
@@ -56,23 +64,27 @@ namespace Halley {
 		std::unique_ptr<AudioEngine> engine;
 
 		std::thread audioThread;
-		std::mutex audioMutex;
 		std::mutex exceptionMutex;
 		std::atomic<bool> running;
 		std::atomic<bool> started;
 	    AudioSpec audioSpec;
 
+		// Game thread to audio thread. Whatever doesn't fit waits in the outbox until the next pump.
 		std::vector<std::function<void()>> outbox;
-		std::vector<std::function<void()>> inbox;
-		std::vector<std::function<void()>> inboxProcessing;
+		SPSCQueue<std::function<void()>> commands;
+
+		// Audio thread to game thread, snapshots of the playing sounds after each buffer
+		SPSCQueue<std::vector<size_t>> playingSoundsUpdates;
+		SPSCQueue<AudioStats> statsUpdates;
+		AudioStats stats;
 		std::vector<String> exceptions;
 		std::vector<size_t> playingSounds;
-		std::vector<size_t> playingSoundsNext;
 
 		std::map<int, AudioHandle> musicTracks;
 
 		size_t uniqueId = 0;
 		bool ownAudioThread;
+		bool lowLatency = false;
 
 	    void run();
 	    void stepAudio();
@@ -31,6 +31,9 @@ namespace Halley
 		void setMix(size_t srcChannels, gsl::span<const AudioChannelData> dstChannels, gsl::span<float, 16> dst, float gain, const AudioListenerData& listener) const;
 		void setPosition(Vector3f position);
 
+		// If this is a single point in the world, that point, so its mix can be batched with others
+		const SpatialSource* getSingleSpatialSource() const;
+
 	private:
 		std::vector<SpatialSource> sources;
 		float pan = 0;
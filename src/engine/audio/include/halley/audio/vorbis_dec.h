@@ -24,6 +24,7 @@
 #include <memory>
 #include <vector>
 #include <gsl/gsl>
+#include <cstdint>
 
 struct OggVorbis_File;
 
@@ -53,6 +54,9 @@ namespace Halley {
 		void seek(double t);
 		void seek(size_t sample);
 
+		// Nanoseconds spent decoding, across every thread, since the start
+		static int64_t getTotalDecodeTime();
+
 	private:
 		void open();
 		static size_t vorbisRead(void* ptr, size_t size, size_t nmemb, void* datasource);
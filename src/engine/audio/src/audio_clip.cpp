@@ -1,6 +1,7 @@
 #include "audio_clip.h"
 #include "halley/resources/resource_data.h"
 #include "vorbis_dec.h"
+#include "audio_clip_streamer.h"
 #include "halley/resources/metadata.h"
 #include "halley/concurrency/concurrent.h"
 #include "halley/text/string_converter.h"
@@ -9,12 +10,16 @@ using namespace Halley;
 
 AudioClip::AudioClip(size_t numChannels)
 	: numChannels(numChannels)
+	, decoded(false)
 {
 	startLoading();
 }
 
 AudioClip::~AudioClip()
 {
+	if (streamer) {
+		streamer->stop();
+	}
 }
 
 AudioClip& AudioClip::operator=(AudioClip&& other) noexcept
@@ -24,13 +29,17 @@ AudioClip& AudioClip::operator=(AudioClip&& other) noexcept
 	sampleLength = other.sampleLength;
 	numChannels = other.numChannels;
 	loopPoint = other.loopPoint;
-	streamPos = other.streamPos;
 	streaming = other.streaming;
+	format = other.format;
 
-	temp0 = std::move(other.temp0);
-	temp1 = std::move(other.temp1);
+	if (streamer) {
+		streamer->stop();
+	}
+	compressed = std::move(other.compressed);
 	samples = std::move(other.samples);
-	vorbisData = std::move(other.vorbisData);
+	decoded = other.decoded.load();
+	keepDecodedRequested = other.keepDecodedRequested;
+	streamer = std::move(other.streamer);
 
 	doneLoading();
 
@@ -39,6 +48,23 @@ AudioClip& AudioClip::operator=(AudioClip&& other) noexcept
 
 void AudioClip::loadFromStatic(std::shared_ptr<ResourceDataStatic> data, Metadata metadata)
 {
+	format = fromString<AudioClipFormat>(metadata.getString("format", "vorbis"));
+	if (format != AudioClipFormat::Vorbis) {
+		numChannels = size_t(metadata.getInt("channels", 1));
+		sampleLength = size_t(metadata.getInt("samples", 0));
+		loopPoint = metadata.getInt("loopPoint", 0);
+		streaming = false;
+		if (data->getSize() < AudioClipCodec::getEncodedSize(format, numChannels, sampleLength)) {
+			throw Exception("Sound clip data is too short for its length.", HalleyExceptions::AudioEngine);
+		}
+
+		std::unique_lock<std::mutex> lock(decodeMutex);
+		compressed = std::move(data);
+		lock.unlock();
+		doneLoading();
+		return;
+	}
+
 	VorbisData vorbis(data);
 	if (vorbis.getSampleRate() != AudioConfig::sampleRate) {
 		throw Exception("Sound clip should be " + toString(AudioConfig::sampleRate) + " Hz.", HalleyExceptions::AudioEngine);
@@ -47,31 +73,34 @@ void AudioClip::loadFromStatic(std::shared_ptr<ResourceDataStatic> data, Metadat
 	sampleLength = vorbis.getNumSamples();
 	loopPoint = metadata.getInt("loopPoint", 0);
 	streaming = false;
+	vorbis.close();
 
-	samples.resize(numChannels);
-	for (size_t i = 0; i < numChannels; ++i) {
-		samples[i].resize(sampleLength);
+	{
+		std::unique_lock<std::mutex> lock(decodeMutex);
+		compressed = std::move(data);
+	}
+	if (keepDecodedRequested) {
+		decode();
 	}
-	vorbis.read(samples);
-	vorbis.close();
 
 	doneLoading();
 }
 
 void AudioClip::loadFromStream(std::shared_ptr<ResourceDataStream> data, Metadata metadata)
 {
-	vorbisData = std::make_unique<VorbisData>(data);
-	size_t nChannels = vorbisData->getNumChannels();
+	auto vorbisData = std::make_unique<VorbisData>(data);
 	if (vorbisData->getSampleRate() != AudioConfig::sampleRate) {
 		throw Exception("Sound clip should be " + toString(AudioConfig::sampleRate) + " Hz.", HalleyExceptions::AudioEngine);
 	}
 	
-	samples.resize(nChannels);
-	numChannels = nChannels;
+	numChannels = vorbisData->getNumChannels();
 	sampleLength = vorbisData->getNumSamples();
 	loopPoint = metadata.getInt("loopPoint", 0);
-	streamPos = 0;
 	streaming = true;
+
+	// Start decoding right away, so it's ready to play by the time anything asks for it
+	streamer = std::make_shared<AudioClipStreamer>(std::move(vorbisData), sampleLength, loopPoint);
+	streamer->start();
 	doneLoading();
 }
 
@@ -80,35 +109,15 @@ size_t AudioClip::copyChannelData(size_t channelN, size_t pos, size_t len, gsl::
 	Expects(pos + len <= sampleLength);
 
 	if (streaming) {
-		auto& temp = pos == 0 ? temp0 : temp1; // pos == 0 has a different buffer because if it loops around, it will be used together with another buffer
-		if (temp.size() != numChannels) {
-			temp.resize(numChannels);
-		}
-
-		if (channelN == 0) { // TODO: this assumes the channels will be read in order. This will break threading.
-			if (pos != streamPos) {
-				vorbisData->seek(pos);
-				streamPos = pos;
-			}
-
-			size_t toRead = len;
-			for (size_t i = 0; i < numChannels; ++i) {
-				if (temp[i].size() < toRead) {
-					temp[i].resize(toRead);
-				}
-			}
-			vorbisData->read(temp);
-			streamPos += len;
-		}
-
-		auto& buf = samples.at(channelN);
-		if (buf.size() < len) {
-			buf.resize(len);
-		}
-
-		memcpy(dst.data(), temp[channelN].data(), len * sizeof(AudioConfig::SampleFormat));
+		return streamer->copyChannelData(channelN, pos, len, dst);
+	} else if (format != AudioClipFormat::Vorbis) {
+		AudioClipCodec::decode(format, compressed->getSpan(), sampleLength, channelN, pos, len, dst);
 		return len;
 	} else {
+		if (!isDecoded()) {
+			// Played directly rather than through the engine, which would have gone through the clip cache
+			decode();
+		}
 		memcpy(dst.data(), samples.at(channelN).data() + pos, len * sizeof(AudioConfig::SampleFormat));
 		return len;
 	}
@@ -136,6 +145,93 @@ bool AudioClip::isLoaded() const
 	return AsyncResource::isLoaded();
 }
 
+bool AudioClip::isStreaming() const
+{
+	return streaming;
+}
+
+AudioClipFormat AudioClip::getFormat() const
+{
+	return format;
+}
+
+std::shared_ptr<ResourceDataStatic> AudioClip::getCompressedData() const
+{
+	std::unique_lock<std::mutex> lock(decodeMutex);
+	return compressed;
+}
+
+void AudioClip::keepDecoded() const
+{
+	bool decodeNow;
+	{
+		std::unique_lock<std::mutex> lock(decodeMutex);
+		if (keepDecodedRequested) {
+			return;
+		}
+		keepDecodedRequested = true;
+		decodeNow = compressed != nullptr && format == AudioClipFormat::Vorbis;
+	}
+
+	// If it's still loading, it'll decode once it's done
+	if (decodeNow) {
+		auto self = shared_from_this();
+		Concurrent::execute(Executors::getCPUAux(), [self] ()
+		{
+			self->decode();
+		});
+	}
+}
+
+bool AudioClip::isDecoded() const
+{
+	return decoded.load(std::memory_order_acquire);
+}
+
+size_t AudioClip::getMemoryUsage() const
+{
+	std::unique_lock<std::mutex> lock(decodeMutex);
+	size_t total = compressed ? compressed->getSize() : 0;
+	if (decoded) {
+		total += numChannels * sampleLength * sizeof(AudioConfig::SampleFormat);
+	}
+	return total;
+}
+
+bool AudioClip::reduceMemoryUsage()
+{
+	// Anything else holding on to it (voices, the clip cache, events that asked to keep it decoded) could be reading
+	// the samples; new references only come from the main thread, which is where this is called
+	if (streaming || !isDecoded() || shared_from_this().use_count() > 2) {
+		return false;
+	}
+
+	std::unique_lock<std::mutex> lock(decodeMutex);
+	samples.clear();
+	samples.shrink_to_fit();
+	keepDecodedRequested = false;
+	decoded.store(false, std::memory_order_release);
+	return true;
+}
+
+void AudioClip::decode() const
+{
+	std::unique_lock<std::mutex> lock(decodeMutex);
+	if (decoded || !compressed || format != AudioClipFormat::Vorbis) {
+		return;
+	}
+
+	VorbisData vorbis(compressed);
+	samples.resize(numChannels);
+	for (size_t i = 0; i < numChannels; ++i) {
+		samples[i].resize(sampleLength);
+	}
+	vorbis.read(samples);
+	vorbis.close();
+
+	decoded.store(true, std::memory_order_release);
+}
+
 std::shared_ptr<AudioClip> AudioClip::loadResource(ResourceLoader& loader)
 {
 	auto meta = loader.getMeta();
@@ -159,6 +255,11 @@ std::shared_ptr<AudioClip> AudioClip::loadResource(ResourceLoader& loader)
 	return result;
 }
 
+bool AudioClip::loadsFromStream(const Metadata& meta)
+{
+	return meta.getBool("streaming", false);
+}
+
 void AudioClip::reload(Resource&& resource)
 {
 	*this = std::move(dynamic_cast<AudioClip&>(resource));
@@ -0,0 +1,196 @@
+#include "audio_clip_cache.h"
+#include "audio_clip_streamer.h"
+#include "vorbis_dec.h"
+#include "halley/concurrency/concurrent.h"
+#include "halley/support/logger.h"
+#include <cstring>
+
+using namespace Halley;
+
+DecodedAudioClip::DecodedAudioClip(std::shared_ptr<const AudioClip> clip)
+	: clip(std::move(clip))
+	, loaded(false)
+{}
+
+size_t DecodedAudioClip::copyChannelData(size_t channelN, size_t pos, size_t len, gsl::span<AudioConfig::SampleFormat> dst) const
+{
+	Expects(isLoaded());
+	Expects(channelN < samples.size());
+
+	const auto& src = samples[channelN];
+	const size_t n = pos < src.size() ? std::min(len, src.size() - pos) : 0;
+	if (n > 0) {
+		memcpy(dst.data(), src.data() + pos, n * sizeof(AudioConfig::SampleFormat));
+	}
+	return n;
+}
+
+size_t DecodedAudioClip::getNumberOfChannels() const
+{
+	return clip->getNumberOfChannels();
+}
+
+size_t DecodedAudioClip::getLength() const
+{
+	return clip->getLength();
+}
+
+size_t DecodedAudioClip::getLoopPoint() const
+{
+	return clip->getLoopPoint();
+}
+
+bool DecodedAudioClip::isLoaded() const
+{
+	if (!started && clip->isLoaded()) {
+		// Can't start decoding until the compressed data is there
+		started = true;
+		auto self = std::const_pointer_cast<DecodedAudioClip>(shared_from_this());
+		Concurrent::execute(Executors::getCPUAux(), [self] ()
+		{
+			self->decode();
+		});
+	}
+	return loaded.load(std::memory_order_acquire);
+}
+
+size_t DecodedAudioClip::getMemoryUsage() const
+{
+	return clip->getNumberOfChannels() * clip->getLength() * sizeof(AudioConfig::SampleFormat);
+}
+
+void DecodedAudioClip::decode()
+{
+	const size_t numChannels = clip->getNumberOfChannels();
+	samples.resize(numChannels);
+	for (auto& s: samples) {
+		s.resize(clip->getLength());
+	}
+
+	try {
+		VorbisData vorbis(clip->getCompressedData());
+		vorbis.read(samples);
+		vorbis.close();
+	} catch (std::exception& e) {
+		// Play silence rather than keeping the sound waiting forever
+		Logger::logException(e);
+		for (auto& s: samples) {
+			std::fill(s.begin(), s.end(), 0.0f);
+		}
+	}
+
+	loaded.store(true, std::memory_order_release);
+}
+
+StreamedAudioClip::StreamedAudioClip(std::shared_ptr<const AudioClip> clip)
+	: clip(std::move(clip))
+{}
+
+StreamedAudioClip::~StreamedAudioClip()
+{
+	if (streamer) {
+		streamer->stop();
+	}
+}
+
+size_t StreamedAudioClip::copyChannelData(size_t channelN, size_t pos, size_t len, gsl::span<AudioConfig::SampleFormat> dst) const
+{
+	Expects(isLoaded());
+	return streamer->copyChannelData(channelN, pos, len, dst);
+}
+
+size_t StreamedAudioClip::getNumberOfChannels() const
+{
+	return clip->getNumberOfChannels();
+}
+
+size_t StreamedAudioClip::getLength() const
+{
+	return clip->getLength();
+}
+
+size_t StreamedAudioClip::getLoopPoint() const
+{
+	return clip->getLoopPoint();
+}
+
+bool StreamedAudioClip::isLoaded() const
+{
+	if (!streamer) {
+		if (!clip->isLoaded()) {
+			return false;
+		}
+		streamer = std::make_shared<AudioClipStreamer>(clip->getCompressedData(), clip->getNumberOfChannels(), clip->getLength(), clip->getLoopPoint());
+		streamer->start();
+	}
+	return streamer->isPrimed();
+}
+
+AudioClipCache::AudioClipCache(size_t budget)
+	: budget(budget)
+{}
+
+void AudioClipCache::setBudget(size_t bytes)
+{
+	budget = bytes;
+	evict();
+}
+
+size_t AudioClipCache::getMemoryUsage() const
+{
+	return memoryUsage;
+}
+
+std::shared_ptr<const IAudioClip> AudioClipCache::getClip(std::shared_ptr<const AudioClip> clip, AudioClipPolicy policy)
+{
+	if (!clip || clip->isStreaming() || clip->isDecoded() || clip->getFormat() != AudioClipFormat::Vorbis) {
+		// Streaming clips have always decoded themselves, others might have been asked to stay decoded, and the rest
+		// of the formats are decoded as they play
+		return clip;
+	}
+
+	if (policy == AudioClipPolicy::DecodeOnPlay) {
+		return getDecoded(std::move(clip));
+	} else {
+		// Clips kept decoded might not be done decoding yet, so stream them in the meantime
+		return std::make_shared<StreamedAudioClip>(std::move(clip));
+	}
+}
+
+std::shared_ptr<const IAudioClip> AudioClipCache::getDecoded(std::shared_ptr<const AudioClip> clip)
+{
+	const auto iter = entryMap.find(clip.get());
+	if (iter != entryMap.end()) {
+		// Played again, so it's now the latest one
+		entries.splice(entries.begin(), entries, iter->second);
+		return iter->second->decoded;
+	}
+
+	Entry entry;
+	entry.decoded = std::make_shared<DecodedAudioClip>(clip);
+	entry.memoryUsage = entry.decoded->getMemoryUsage();
+	entry.clip = std::move(clip);
+	memoryUsage += entry.memoryUsage;
+
+	entries.push_front(std::move(entry));
+	entryMap[entries.front().clip.get()] = entries.begin();
+	auto result = entries.front().decoded;
+
+	evict();
+	return result;
+}
+
+void AudioClipCache::evict()
+{
+	for (auto iter = entries.end(); memoryUsage > budget && iter != entries.begin(); ) {
+		--iter;
+		if (iter->decoded.use_count() > 1) {
+			// Still playing, or about to
+			continue;
+		}
+
+		memoryUsage -= iter->memoryUsage;
+		entryMap.erase(iter->clip.get());
+		iter = entries.erase(iter);
+	}
+}
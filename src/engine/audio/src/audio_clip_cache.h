@@ -0,0 +1,83 @@
+#pragma once
+#include "halley/audio/audio_clip.h"
+#include "halley/data_structures/hash_map.h"
+#include <atomic>
+#include <list>
+#include <memory>
+#include <vector>
+
+namespace Halley
+{
+	class AudioClipStreamer;
+
+	// The samples of a clip, decoded on a worker thread from its compressed data
+	class DecodedAudioClip : public IAudioClip, public std::enable_shared_from_this<DecodedAudioClip>
+	{
+	public:
+		explicit DecodedAudioClip(std::shared_ptr<const AudioClip> clip);
+
+		size_t copyChannelData(size_t channelN, size_t pos, size_t len, gsl::span<AudioConfig::SampleFormat> dst) const override;
+		size_t getNumberOfChannels() const override;
+		size_t getLength() const override;
+		size_t getLoopPoint() const override;
+		bool isLoaded() const override;
+
+		size_t getMemoryUsage() const;
+
+	private:
+		std::shared_ptr<const AudioClip> clip;
+		std::vector<std::vector<AudioConfig::SampleFormat>> samples;
+		mutable bool started = false;
+		std::atomic<bool> loaded;
+
+		void decode();
+	};
+
+	// Decodes a clip as it plays, for a single playback
+	class StreamedAudioClip : public IAudioClip
+	{
+	public:
+		explicit StreamedAudioClip(std::shared_ptr<const AudioClip> clip);
+		~StreamedAudioClip();
+
+		size_t copyChannelData(size_t channelN, size_t pos, size_t len, gsl::span<AudioConfig::SampleFormat> dst) const override;
+		size_t getNumberOfChannels() const override;
+		size_t getLength() const override;
+		size_t getLoopPoint() const override;
+		bool isLoaded() const override;
+
+	private:
+		std::shared_ptr<const AudioClip> clip;
+		mutable std::shared_ptr<AudioClipStreamer> streamer;
+	};
+
+	// Keeps the clips played with AudioClipPolicy::DecodeOnPlay decoded, so playing them again doesn't decode them again.
+	// Once over the budget, the clips that haven't been played for longest are dropped, unless they're still playing.
+	// Only used from the audio thread.
+	class AudioClipCache
+	{
+	public:
+		explicit AudioClipCache(size_t budget = 64 * 1024 * 1024);
+
+		void setBudget(size_t bytes);
+		size_t getMemoryUsage() const;
+
+		std::shared_ptr<const IAudioClip> getClip(std::shared_ptr<const AudioClip> clip, AudioClipPolicy policy);
+
+	private:
+		struct Entry
+		{
+			std::shared_ptr<const AudioClip> clip; // Holding on to it, so no other clip can be allocated at the same address
+			std::shared_ptr<DecodedAudioClip> decoded;
+			size_t memoryUsage = 0;
+		};
+
+		size_t budget;
+		size_t memoryUsage = 0;
+		std::list<Entry> entries; // Most recently played first
+		HashMap<const AudioClip*, std::list<Entry>::iterator> entryMap;
+
+		std::shared_ptr<const IAudioClip> getDecoded(std::shared_ptr<const AudioClip> clip);
+		void evict();
+	};
+}
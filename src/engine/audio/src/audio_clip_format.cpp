@@ -0,0 +1,243 @@
+#include "halley/audio/audio_clip_format.h"
+#include "audio_mixer.h"
+#include "halley/support/exception.h"
+#include <cmath>
+#include <cstdint>
+
+#if defined(HAS_SSE)
+#include <emmintrin.h>
+#elif defined(HAS_NEON)
+#ifdef _MSC_VER
+#include <arm64_neon.h>
+#else
+#include <arm_neon.h>
+#endif
+#endif
+
+using namespace Halley;
+
+namespace {
+	constexpr float pcmScale = 1.0f / 32768.0f;
+
+	// Each ADPCM block starts with the decoder state (predictor as int16, step index, one byte of padding), so it
+	// can be decoded without anything before it, followed by two samples per byte, low nibble first
+	constexpr size_t adpcmSamplesPerBlock = 256;
+	constexpr size_t adpcmHeaderSize = 4;
+	constexpr size_t adpcmBlockSize = adpcmHeaderSize + adpcmSamplesPerBlock / 2;
+
+	constexpr int adpcmIndexTable[16] = { -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8 };
+
+	constexpr int adpcmStepTable[89] = {
+		7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+		50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+		337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+		2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+		15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+	};
+
+	struct ADPCMState
+	{
+		int predictor = 0;
+		int index = 0;
+
+		int decode(int nibble)
+		{
+			const int step = adpcmStepTable[index];
+			int diff = step >> 3;
+			if (nibble & 4) {
+				diff += step;
+			}
+			if (nibble & 2) {
+				diff += step >> 1;
+			}
+			if (nibble & 1) {
+				diff += step >> 2;
+			}
+			predictor = clamp(nibble & 8 ? predictor - diff : predictor + diff, -32768, 32767);
+			index = clamp(index + adpcmIndexTable[nibble], 0, 88);
+			return predictor;
+		}
+
+		int encode(int sample)
+		{
+			// Decodes the nibble it picked straight away, so its state always matches the decoder's
+			int step = adpcmStepTable[index];
+			int diff = sample - predictor;
+			int nibble = 0;
+			if (diff < 0) {
+				nibble = 8;
+				diff = -diff;
+			}
+			if (diff >= step) {
+				nibble |= 4;
+				diff -= step;
+			}
+			step >>= 1;
+			if (diff >= step) {
+				nibble |= 2;
+				diff -= step;
+			}
+			step >>= 1;
+			if (diff >= step) {
+				nibble |= 1;
+			}
+			decode(nibble);
+			return nibble;
+		}
+	};
+
+	int16_t toPCM16(float sample)
+	{
+		return int16_t(clamp(int(std::lround(sample * 32768.0f)), -32768, 32767));
+	}
+
+	void writeInt16(gsl::byte* dst, int16_t value)
+	{
+		const auto v = uint16_t(value);
+		dst[0] = gsl::byte(v & 0xFF);
+		dst[1] = gsl::byte(v >> 8);
+	}
+
+	int16_t readInt16(const gsl::byte* src)
+	{
+		return int16_t(uint16_t(src[0]) | (uint16_t(src[1]) << 8));
+	}
+
+	size_t getNumADPCMBlocks(size_t numSamples)
+	{
+		return (numSamples + adpcmSamplesPerBlock - 1) / adpcmSamplesPerBlock;
+	}
+
+	void encodeADPCM(gsl::span<const float> src, gsl::byte* dst)
+	{
+		// Starting from the first sample, with a step size to match how fast it's changing, avoids a burst of noise
+		// at the start while the step size would otherwise adapt
+		ADPCMState state;
+		if (src.size() >= 2) {
+			const int delta = std::abs(toPCM16(src[1]) - toPCM16(src[0]));
+			state.predictor = toPCM16(src[0]);
+			while (state.index < 88 && adpcmStepTable[state.index] < delta) {
+				++state.index;
+			}
+		}
+
+		const size_t numBlocks = getNumADPCMBlocks(size_t(src.size()));
+		for (size_t block = 0; block < numBlocks; ++block) {
+			auto* blockData = dst + block * adpcmBlockSize;
+			writeInt16(blockData, int16_t(state.predictor));
+			blockData[2] = gsl::byte(state.index);
+			blockData[3] = gsl::byte(0);
+
+			auto* nibbles = blockData + adpcmHeaderSize;
+			const size_t start = block * adpcmSamplesPerBlock;
+			for (size_t i = 0; i < adpcmSamplesPerBlock; i += 2) {
+				const int a = start + i < size_t(src.size()) ? state.encode(toPCM16(src[start + i])) : 0;
+				const int b = start + i + 1 < size_t(src.size()) ? state.encode(toPCM16(src[start + i + 1])) : 0;
+				nibbles[i / 2] = gsl::byte(a | (b << 4));
+			}
+		}
+	}
+
+	void decodeADPCM(const gsl::byte* src, size_t pos, size_t len, float* dst)
+	{
+		// Blocks can only be decoded from their start, so anything before pos in the first one is decoded and dropped
+		size_t block = pos / adpcmSamplesPerBlock;
+		size_t skip = pos % adpcmSamplesPerBlock;
+		while (len > 0) {
+			const auto* blockData = src + block * adpcmBlockSize;
+			ADPCMState state;
+			state.predictor = readInt16(blockData);
+			state.index = clamp(int(blockData[2]), 0, 88);
+
+			const auto* nibbles = blockData + adpcmHeaderSize;
+			const size_t end = std::min(adpcmSamplesPerBlock, skip + len);
+			for (size_t i = 0; i < end; ++i) {
+				const int byte = int(nibbles[i / 2]);
+				const int sample = state.decode(i & 1 ? byte >> 4 : byte & 0xF);
+				if (i >= skip) {
+					*dst++ = float(sample) * pcmScale;
+				}
+			}
+
+			len -= end - skip;
+			skip = 0;
+			++block;
+		}
+	}
+
+	void decodePCM16(const gsl::byte* src, size_t len, float* dst)
+	{
+		size_t i = 0;
+#if defined(HAS_SSE)
+		const __m128 scale = _mm_set1_ps(pcmScale);
+		for (; i + 8 <= len; i += 8) {
+			// Sign-extends by putting each sample in the top half of a 32-bit lane, then shifting it down
+			const __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+			const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+			const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+			_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+			_mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+		}
+#elif defined(HAS_NEON)
+		for (; i + 8 <= len; i += 8) {
+			const int16x8_t samples = vld1q_s16(reinterpret_cast<const int16_t*>(src + i * 2));
+			vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(samples))), pcmScale));
+			vst1q_f32(dst + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(samples))), pcmScale));
+		}
+#endif
+		for (; i < len; ++i) {
+			dst[i] = float(readInt16(src + i * 2)) * pcmScale;
+		}
+	}
+}
+
+size_t AudioClipCodec::getEncodedSize(AudioClipFormat format, size_t numChannels, size_t numSamples)
+{
+	switch (format) {
+	case AudioClipFormat::PCM16:
+		return numChannels * numSamples * 2;
+	case AudioClipFormat::ADPCM:
+		return numChannels * getNumADPCMBlocks(numSamples) * adpcmBlockSize;
+	default:
+		throw Exception("Audio clip format " + toString(format) + " has no fixed size.", HalleyExceptions::AudioEngine);
+	}
+}
+
+Bytes AudioClipCodec::encode(AudioClipFormat format, gsl::span<const std::vector<float>> channels)
+{
+	const size_t numChannels = size_t(channels.size());
+	const size_t numSamples = numChannels > 0 ? channels[0].size() : 0;
+	Bytes result(getEncodedSize(format, numChannels, numSamples));
+	auto* dst = reinterpret_cast<gsl::byte*>(result.data());
+	const size_t channelSize = result.size() / std::max(numChannels, size_t(1));
+
+	for (size_t c = 0; c < numChannels; ++c) {
+		const auto& src = channels[c];
+		auto* channelDst = dst + c * channelSize;
+		if (format == AudioClipFormat::PCM16) {
+			for (size_t i = 0; i < numSamples; ++i) {
+				writeInt16(channelDst + i * 2, toPCM16(src[i]));
+			}
+		} else {
+			encodeADPCM(src, channelDst);
+		}
+	}
+
+	return result;
+}
+
+void AudioClipCodec::decode(AudioClipFormat format, gsl::span<const gsl::byte> data, size_t numSamples, size_t channel, size_t pos, size_t len, gsl::span<float> dst)
+{
+	Expects(pos + len <= numSamples);
+	Expects(len <= size_t(dst.size()));
+
+	const size_t channelSize = getEncodedSize(format, 1, numSamples);
+	Expects((channel + 1) * channelSize <= size_t(data.size()));
+	const auto* src = data.data() + channel * channelSize;
+
+	if (format == AudioClipFormat::PCM16) {
+		decodePCM16(src + pos * 2, len, dst.data());
+	} else {
+		decodeADPCM(src, pos, len, dst.data());
+	}
+}
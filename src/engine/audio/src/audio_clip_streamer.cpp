@@ -0,0 +1,239 @@
+#include "audio_clip_streamer.h"
+#include "vorbis_dec.h"
+#include "halley/concurrency/concurrent.h"
+#include "halley/support/logger.h"
+#include <cstring>
+
+using namespace Halley;
+
+AudioClipStreamer::AudioClipStreamer(std::unique_ptr<VorbisData> vorbisData, size_t length, size_t loopPoint)
+	: numChannels(size_t(vorbisData->getNumChannels()))
+	, length(length)
+	, loopPoint(loopPoint)
+	, decoded(numChunks)
+	, recycled(numChunks)
+	, generation(0)
+	, seekTimelinePos(0)
+	, decoding(false)
+	, stopped(false)
+	, primed(false)
+	, vorbis(std::move(vorbisData))
+{
+	staged.resize(numChannels);
+}
+
+AudioClipStreamer::AudioClipStreamer(std::shared_ptr<ResourceData> data, size_t numChannels, size_t length, size_t loopPoint)
+	: numChannels(numChannels)
+	, length(length)
+	, loopPoint(loopPoint)
+	, decoded(numChunks)
+	, recycled(numChunks)
+	, generation(0)
+	, seekTimelinePos(0)
+	, decoding(false)
+	, stopped(false)
+	, primed(false)
+	, data(std::move(data))
+{
+	staged.resize(numChannels);
+}
+
+AudioClipStreamer::~AudioClipStreamer() = default;
+
+void AudioClipStreamer::start()
+{
+	scheduleDecode();
+}
+
+void AudioClipStreamer::stop()
+{
+	stopped = true;
+}
+
+bool AudioClipStreamer::isPrimed() const
+{
+	return primed.load(std::memory_order_acquire);
+}
+
+size_t AudioClipStreamer::copyChannelData(size_t channelN, size_t pos, size_t len, gsl::span<AudioConfig::SampleFormat> dst)
+{
+	Expects(channelN < numChannels);
+
+	if (channelN == 0) {
+		stage(pos, len);
+	}
+
+	Expects(staged[channelN].size() >= len);
+	memcpy(dst.data(), staged[channelN].data(), len * sizeof(AudioConfig::SampleFormat));
+	return len;
+}
+
+void AudioClipStreamer::stage(size_t pos, size_t len)
+{
+	if (pos != expectedClipPos) {
+		// Not where the decoder is heading, so have it seek. Timeline positions only need to be consistent within a generation.
+		recycleCurrent();
+		seekTimelinePos.store(pos, std::memory_order_relaxed);
+		generation.store(++readGeneration, std::memory_order_release);
+		expectedTimelinePos = pos;
+	}
+
+	for (auto& s: staged) {
+		if (s.size() < len) {
+			s.resize(len);
+		}
+	}
+
+	const size_t start = expectedTimelinePos;
+	size_t written = 0;
+	while (written < len) {
+		if (!hasCurrent) {
+			hasCurrent = decoded.tryPop(current);
+			if (!hasCurrent) {
+				break;
+			}
+		}
+
+		const size_t want = start + written;
+		const size_t chunkStart = current.timelinePos;
+		const size_t chunkEnd = chunkStart + current.length;
+		if (current.generation != readGeneration || chunkEnd <= want) {
+			// From before a seek, or we've already gone past it after running dry
+			recycleCurrent();
+			continue;
+		}
+
+		if (chunkStart > want) {
+			// Shouldn't happen, as the decoder doesn't skip anything, but don't get stuck if it somehow does
+			const size_t gap = std::min(chunkStart - want, len - written);
+			for (auto& s: staged) {
+				memset(s.data() + written, 0, gap * sizeof(AudioConfig::SampleFormat));
+			}
+			written += gap;
+			continue;
+		}
+
+		const size_t offset = want - chunkStart;
+		const size_t n = std::min(chunkEnd - want, len - written);
+		for (size_t i = 0; i < numChannels; ++i) {
+			memcpy(staged[i].data() + written, current.samples[i].data() + offset, n * sizeof(AudioConfig::SampleFormat));
+		}
+		written += n;
+
+		if (offset + n == current.length) {
+			recycleCurrent();
+		}
+	}
+
+	if (written < len) {
+		// The decoder fell behind; play silence and keep time, it will catch up
+		for (auto& s: staged) {
+			memset(s.data() + written, 0, (len - written) * sizeof(AudioConfig::SampleFormat));
+		}
+	}
+
+	expectedTimelinePos = start + len;
+	const bool reachedEnd = pos + len >= length && loopPoint < length;
+	expectedClipPos = reachedEnd ? loopPoint : pos + len;
+
+	scheduleDecode();
+}
+
+void AudioClipStreamer::recycleCurrent()
+{
+	if (hasCurrent) {
+		recycled.tryPush(std::move(current));
+		current = Chunk();
+		hasCurrent = false;
+	}
+}
+
+void AudioClipStreamer::scheduleDecode()
+{
+	bool expected = false;
+	if (!stopped && decoding.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+		auto self = shared_from_this();
+		Concurrent::execute(Executors::getCPUAux(), [self] ()
+		{
+			self->decode();
+		});
+	}
+}
+
+void AudioClipStreamer::decode()
+{
+	try {
+		if (!vorbis) {
+			vorbis = std::make_unique<VorbisData>(data);
+			data.reset();
+		}
+
+		while (!stopped) {
+			const auto gen = generation.load(std::memory_order_acquire);
+			if (gen != decoderGeneration) {
+				decoderGeneration = gen;
+				decoderTimelinePos = seekTimelinePos.load(std::memory_order_relaxed);
+			}
+			if (toClipPos(decoderTimelinePos) >= length) {
+				break; // Reached the end, and it doesn't loop
+			}
+
+			Chunk chunk;
+			if (!recycled.tryPop(chunk)) {
+				if (numChunksCreated == numChunks) {
+					break; // Everything is decoded and waiting to be played
+				}
+				++numChunksCreated;
+			}
+
+			if (!decodeChunk(chunk)) {
+				--numChunksCreated;
+				break;
+			}
+			decoded.tryPush(std::move(chunk));
+			primed.store(true, std::memory_order_release);
+		}
+	} catch (std::exception& e) {
+		Logger::logException(e);
+		stopped = true;
+	}
+
+	// Even if nothing could be decoded, don't keep anyone waiting for it
+	primed.store(true, std::memory_order_release);
+	decoding.store(false, std::memory_order_release);
+}
+
+bool AudioClipStreamer::decodeChunk(Chunk& chunk)
+{
+	const size_t clipPos = toClipPos(decoderTimelinePos);
+	const size_t toRead = std::min(chunkLength, length - clipPos);
+
+	if (clipPos != decoderClipPos) {
+		vorbis->seek(clipPos);
+	}
+
+	chunk.samples.resize(numChannels);
+	for (auto& s: chunk.samples) {
+		s.resize(toRead);
+	}
+	const size_t nRead = vorbis->read(chunk.samples);
+
+	chunk.generation = decoderGeneration;
+	chunk.timelinePos = decoderTimelinePos;
+	chunk.length = nRead;
+	decoderTimelinePos += nRead;
+	decoderClipPos = clipPos + nRead;
+
+	return nRead > 0;
+}
+
+size_t AudioClipStreamer::toClipPos(size_t timelinePos) const
+{
+	if (timelinePos < length) {
+		return timelinePos;
+	} else if (loopPoint >= length) {
+		return length;
+	} else {
+		return loopPoint + (timelinePos - length) % (length - loopPoint);
+	}
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include "halley/core/api/audio_api.h"
+#include "halley/concurrency/spsc_queue.h"
+#include <gsl/span>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace Halley
+{
+	class VorbisData;
+	class ResourceData;
+
+	// Decodes a streamed clip ahead of playback on a worker thread, so the audio thread only ever copies out of it.
+	// The decoded audio follows the clip as it would play when looping, so neither looping nor just running to the end
+	// needs the decoder to catch up. Jumping anywhere else makes it seek, and plays silence until it does.
+	class AudioClipStreamer : public std::enable_shared_from_this<AudioClipStreamer>
+	{
+	public:
+		AudioClipStreamer(std::unique_ptr<VorbisData> vorbis, size_t length, size_t loopPoint);
+
+		// Opens the data on the decoder thread, as setting up vorbis isn't free either
+		AudioClipStreamer(std::shared_ptr<ResourceData> data, size_t numChannels, size_t length, size_t loopPoint);
+		~AudioClipStreamer();
+
+		void start();
+		void stop();
+
+		// Whether anything has been decoded yet
+		bool isPrimed() const;
+
+		// Audio thread only. Channel 0 has to be read first, with the others then reading the same range.
+		size_t copyChannelData(size_t channelN, size_t pos, size_t len, gsl::span<AudioConfig::SampleFormat> dst);
+
+	private:
+		struct Chunk
+		{
+			uint32_t generation = 0;
+			size_t timelinePos = 0;
+			size_t length = 0;
+			std::vector<std::vector<AudioConfig::SampleFormat>> samples;
+		};
+
+		constexpr static size_t chunkLength = 4096;
+		constexpr static size_t numChunks = 8; // About 650 ms ahead at 48 kHz
+
+		const size_t numChannels;
+		const size_t length;
+		const size_t loopPoint;
+
+		SPSCQueue<Chunk> decoded; // Decoder to audio thread
+		SPSCQueue<Chunk> recycled; // And back, once played
+		std::atomic<uint32_t> generation;
+		std::atomic<size_t> seekTimelinePos;
+		std::atomic<bool> decoding;
+		std::atomic<bool> stopped;
+		std::atomic<bool> primed;
+
+		// Decoder thread
+		std::shared_ptr<ResourceData> data;
+		std::unique_ptr<VorbisData> vorbis;
+		size_t numChunksCreated = 0;
+		uint32_t decoderGeneration = 0;
+		size_t decoderTimelinePos = 0;
+		size_t decoderClipPos = 0;
+
+		// Audio thread
+		Chunk current;
+		bool hasCurrent = false;
+		uint32_t readGeneration = 0;
+		size_t expectedClipPos = 0;
+		size_t expectedTimelinePos = 0;
+		std::vector<std::vector<AudioConfig::SampleFormat>> staged;
+
+		void scheduleDecode();
+		void decode();
+		bool decodeChunk(Chunk& chunk);
+		void stage(size_t pos, size_t len);
+		void recycleCurrent();
+		size_t toClipPos(size_t timelinePos) const;
+	};
+}
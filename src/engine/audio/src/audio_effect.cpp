@@ -0,0 +1,186 @@
+#include "audio_effect.h"
+#include "audio_buffer.h"
+#include "halley/utils/utils.h"
+#include <cmath>
+
+using namespace Halley;
+
+namespace {
+	float gainToDecibels(float gain)
+	{
+		return 20.0f * std::log10(std::max(gain, 0.00001f));
+	}
+
+	float decibelsToGain(float db)
+	{
+		return std::pow(10.0f, db / 20.0f);
+	}
+
+	float getTimeCoefficient(float seconds)
+	{
+		// Envelopes move once per pack
+		const float packTime = float(AudioSamplePack::NumSamples) / float(AudioConfig::sampleRate);
+		return seconds > 0.0f ? std::exp(-packTime / seconds) : 0.0f;
+	}
+}
+
+std::unique_ptr<AudioEffect> AudioEffect::make(const AudioEffectParameters& parameters, int sidechainGroup)
+{
+	switch (parameters.type) {
+	case AudioEffectType::LowPass:
+	case AudioEffectType::HighPass:
+		return std::make_unique<AudioEffectBiquad>(parameters);
+	case AudioEffectType::Compressor:
+		return std::make_unique<AudioEffectCompressor>(parameters, sidechainGroup);
+	case AudioEffectType::Reverb:
+		return std::make_unique<AudioEffectReverb>(parameters);
+	}
+	return {};
+}
+
+AudioEffectBiquad::AudioEffectBiquad(const AudioEffectParameters& parameters)
+{
+	// From the RBJ audio EQ cookbook
+	const float sampleRate = float(AudioConfig::sampleRate);
+	const float frequency = clamp(parameters.frequency, 10.0f, sampleRate * 0.45f);
+	const float w0 = 2.0f * float(pi()) * frequency / sampleRate;
+	const float cosW0 = std::cos(w0);
+	const float alpha = std::sin(w0) / (2.0f * std::max(parameters.resonance, 0.1f));
+	const float a0 = 1.0f + alpha;
+
+	if (parameters.type == AudioEffectType::LowPass) {
+		coefficients.b0 = (1.0f - cosW0) * 0.5f / a0;
+		coefficients.b1 = (1.0f - cosW0) / a0;
+	} else {
+		coefficients.b0 = (1.0f + cosW0) * 0.5f / a0;
+		coefficients.b1 = -(1.0f + cosW0) / a0;
+	}
+	coefficients.b2 = coefficients.b0;
+	coefficients.a1 = -2.0f * cosW0 / a0;
+	coefficients.a2 = (1.0f - alpha) / a0;
+}
+
+void AudioEffectBiquad::process(const AudioEffectContext& context)
+{
+	context.mixer.filterBiquad(context.buffers, context.numPacks, coefficients, state);
+}
+
+AudioEffectCompressor::AudioEffectCompressor(const AudioEffectParameters& parameters, int sidechainGroup)
+	: threshold(parameters.threshold)
+	, slope(1.0f - 1.0f / std::max(parameters.ratio, 1.0f))
+	, attackCoefficient(getTimeCoefficient(parameters.attack))
+	, releaseCoefficient(getTimeCoefficient(parameters.release))
+	, sidechainGroup(sidechainGroup)
+{}
+
+void AudioEffectCompressor::process(const AudioEffectContext& context)
+{
+	const size_t numPacks = context.numPacks;
+	const size_t nChannels = size_t(context.buffers.size());
+	packGains.resize(numPacks);
+
+	for (size_t i = 0; i < numPacks; ++i) {
+		float level = 0.0f;
+		if (sidechainGroup >= 0) {
+			level = context.groupPeaks[sidechainGroup];
+		} else {
+			for (size_t ch = 0; ch < nChannels; ++ch) {
+				level = std::max(level, context.mixer.getPeak(gsl::span<const AudioSamplePack>(context.buffers[ch]->packs).subspan(i, 1)));
+			}
+		}
+
+		const float coefficient = level > envelope ? attackCoefficient : releaseCoefficient;
+		envelope = level + coefficient * (envelope - level);
+
+		const float over = gainToDecibels(envelope) - threshold;
+		packGains[i] = over > 0.0f ? decibelsToGain(-over * slope) : 1.0f;
+	}
+
+	// Ramp from pack to pack, so the gain never jumps
+	for (size_t ch = 0; ch < nChannels; ++ch) {
+		auto packs = gsl::span<AudioSamplePack>(context.buffers[ch]->packs);
+		float prev = gain;
+		for (size_t i = 0; i < numPacks; ++i) {
+			context.mixer.scaleAudio(packs.subspan(i, 1), prev, packGains[i]);
+			prev = packGains[i];
+		}
+	}
+	if (numPacks > 0) {
+		gain = packGains.back();
+	}
+}
+
+AudioEffectReverb::AudioEffectReverb(const AudioEffectParameters& parameters)
+	: feedback(0.7f + 0.28f * clamp(parameters.roomSize, 0.0f, 1.0f))
+	, damp(0.4f * clamp(parameters.damping, 0.0f, 1.0f))
+	, wet(clamp(parameters.wet, 0.0f, 1.0f))
+{}
+
+void AudioEffectReverb::initChannels(size_t numChannels)
+{
+	// Freeverb's tunings, which are in samples at 44.1 kHz. Odd channels are spread slightly, to decorrelate them.
+	constexpr std::array<size_t, numCombs> combLengths = {{ 1116, 1188, 1277, 1356 }};
+	constexpr std::array<size_t, numAllPasses> allPassLengths = {{ 556, 441 }};
+	constexpr size_t stereoSpread = 23;
+
+	channels.resize(numChannels);
+	for (size_t ch = 0; ch < numChannels; ++ch) {
+		const size_t spread = (ch & 1) ? stereoSpread : 0;
+		auto scaled = [&] (size_t length)
+		{
+			return (length + spread) * size_t(AudioConfig::sampleRate) / 44100;
+		};
+		for (size_t i = 0; i < numCombs; ++i) {
+			channels[ch].combs[i].buffer.resize(scaled(combLengths[i]), 0.0f);
+		}
+		for (size_t i = 0; i < numAllPasses; ++i) {
+			channels[ch].allPasses[i].buffer.resize(scaled(allPassLengths[i]), 0.0f);
+		}
+	}
+}
+
+void AudioEffectReverb::process(const AudioEffectContext& context)
+{
+	constexpr float inputGain = 0.03f;
+	const size_t nChannels = size_t(context.buffers.size());
+	const size_t numSamples = context.numPacks * AudioSamplePack::NumSamples;
+	if (channels.size() != nChannels) {
+		initChannels(nChannels);
+	}
+
+	auto wetRef = context.pool.getBuffer(numSamples);
+	auto wetPacks = wetRef.getSpan().subspan(0, context.numPacks);
+	float* wetSamples = reinterpret_cast<float*>(wetPacks.data());
+
+	for (size_t ch = 0; ch < nChannels; ++ch) {
+		auto& channel = channels[ch];
+		auto drySpan = gsl::span<AudioSamplePack>(context.buffers[ch]->packs).subspan(0, context.numPacks);
+		const float* dry = reinterpret_cast<const float*>(drySpan.data());
+
+		// The delay lines feed back on themselves every sample, so this part stays scalar
+		for (size_t i = 0; i < numSamples; ++i) {
+			const float input = dry[i] * inputGain;
+			float out = 0.0f;
+			for (auto& comb: channel.combs) {
+				const float delayed = comb.buffer[comb.pos];
+				comb.filterStore = delayed * (1.0f - damp) + comb.filterStore * damp;
+				if (std::abs(comb.filterStore) < 1e-20f) {
+					comb.filterStore = 0.0f; // Don't let the tail decay into denormals, they're very slow
+				}
+				comb.buffer[comb.pos] = input + comb.filterStore * feedback;
+				comb.pos = comb.pos + 1 == comb.buffer.size() ? 0 : comb.pos + 1;
+				out += delayed;
+			}
+			for (auto& allPass: channel.allPasses) {
+				const float delayed = allPass.buffer[allPass.pos];
+				allPass.buffer[allPass.pos] = out + delayed * 0.5f;
+				allPass.pos = allPass.pos + 1 == allPass.buffer.size() ? 0 : allPass.pos + 1;
+				out = delayed - out;
+			}
+			wetSamples[i] = out;
+		}
+
+		context.mixer.scaleAudio(drySpan, 1.0f - wet, 1.0f - wet);
+		context.mixer.mixAudio(wetPacks, drySpan, wet, wet);
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include "halley/core/api/audio_api.h"
+#include "audio_mixer.h"
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace Halley
+{
+	class AudioBufferPool;
+
+	struct AudioEffectContext
+	{
+		gsl::span<AudioBuffer*> buffers;
+		size_t numPacks;
+		AudioMixer& mixer;
+		AudioBufferPool& pool;
+		gsl::span<const float> groupPeaks; // Loudest sample in each group's latest mix
+	};
+
+	class AudioEffect
+	{
+	public:
+		virtual ~AudioEffect() {}
+		virtual void process(const AudioEffectContext& context) = 0;
+
+		static std::unique_ptr<AudioEffect> make(const AudioEffectParameters& parameters, int sidechainGroup);
+	};
+
+	class AudioEffectBiquad final : public AudioEffect
+	{
+	public:
+		explicit AudioEffectBiquad(const AudioEffectParameters& parameters);
+		void process(const AudioEffectContext& context) override;
+
+	private:
+		AudioBiquadCoefficients coefficients;
+		std::array<AudioBiquadState, AudioConfig::maxChannels> state;
+	};
+
+	class AudioEffectCompressor final : public AudioEffect
+	{
+	public:
+		AudioEffectCompressor(const AudioEffectParameters& parameters, int sidechainGroup);
+		void process(const AudioEffectContext& context) override;
+
+	private:
+		float threshold; // dB
+		float slope;
+		float attackCoefficient;
+		float releaseCoefficient;
+		int sidechainGroup;
+
+		float envelope = 0.0f;
+		float gain = 1.0f;
+		std::vector<float> packGains;
+	};
+
+	// Schroeder/Moorer style, after Freeverb: parallel damped combs into a couple of allpasses, per channel
+	class AudioEffectReverb final : public AudioEffect
+	{
+	public:
+		explicit AudioEffectReverb(const AudioEffectParameters& parameters);
+		void process(const AudioEffectContext& context) override;
+
+	private:
+		constexpr static size_t numCombs = 4;
+		constexpr static size_t numAllPasses = 2;
+
+		struct DelayLine
+		{
+			std::vector<float> buffer;
+			size_t pos = 0;
+			float filterStore = 0.0f;
+		};
+
+		struct Channel
+		{
+			std::array<DelayLine, numCombs> combs;
+			std::array<DelayLine, numAllPasses> allPasses;
+		};
+
+		float feedback;
+		float damp;
+		float wet;
+		std::vector<Channel> channels;
+
+		void initChannels(size_t numChannels);
+	};
+}
@@ -102,6 +102,18 @@ size_t AudioEmitter::getNumberOfChannels() const
 }
 
 void AudioEmitter::update(gsl::span<const AudioChannelData> channels, const AudioListenerData& listener, float groupGain)
+{
+	beginUpdate();
+	updateMix(channels, listener, groupGain);
+	endUpdate(size_t(channels.size()));
+}
+
+void AudioEmitter::updateMix(gsl::span<const AudioChannelData> channels, const AudioListenerData& listener, float groupGain)
+{
+	sourcePos.setMix(nChannels, channels, channelMix, gain * groupGain, listener);
+}
+
+void AudioEmitter::beginUpdate()
 {
 	Expects(playing);
 
@@ -114,7 +126,11 @@ void AudioEmitter::update(gsl::span<const AudioChannelData> channels, const Audi
 	}
 
 	prevChannelMix = channelMix;
-	sourcePos.setMix(nChannels, channels, channelMix, gain * groupGain, listener);
+}
+
+void AudioEmitter::endUpdate(size_t nDstChannels)
+{
+	numMixes = std::min(nChannels * nDstChannels, channelMix.size());
 	
 	if (isFirstUpdate) {
 		prevChannelMix = channelMix;
@@ -122,6 +138,16 @@ void AudioEmitter::update(gsl::span<const AudioChannelData> channels, const Audi
 	}
 }
 
+const AudioPosition::SpatialSource* AudioEmitter::getSingleSpatialSource() const
+{
+	return nChannels == 1 ? sourcePos.getSingleSpatialSource() : nullptr;
+}
+
+gsl::span<float, 16> AudioEmitter::getChannelMix()
+{
+	return channelMix;
+}
+
 void AudioEmitter::mixTo(size_t numSamples, gsl::span<AudioBuffer*> dst, AudioMixer& mixer, AudioBufferPool& pool)
 {
 	Expects(dst.size() > 0);
@@ -140,6 +166,17 @@ void AudioEmitter::mixTo(size_t numSamples, gsl::span<AudioBuffer*> dst, AudioMi
 		totalMix += prevChannelMix[i] + channelMix[i];
 	}
 
+	if (voiceState == VoiceState::Virtual) {
+		skipTo(numSamples);
+		return;
+	}
+
+	// When going virtual, this is the last mix, so ramp down to silence
+	const bool fadingOut = voiceState == VoiceState::FadingOut;
+	if (fadingOut) {
+		voiceState = VoiceState::Virtual;
+	}
+
 	// Read data from source
 	std::array<gsl::span<AudioSamplePack>, AudioConfig::maxChannels> audioData;
 	std::array<gsl::span<AudioConfig::SampleFormat>, AudioConfig::maxChannels> audioSampleData;
@@ -160,7 +197,7 @@ void AudioEmitter::mixTo(size_t numSamples, gsl::span<AudioBuffer*> dst, AudioMi
 				// Compute mix
 				const size_t mixIndex = (srcChannel * nChannels) + dstChannel;
 				const float gain0 = prevChannelMix[mixIndex];
-				const float gain1 = channelMix[mixIndex];
+				const float gain1 = fadingOut ? 0.0f : channelMix[mixIndex];
 
 				// Render to destination
 				if (gain0 + gain1 > 0.0001f) {
@@ -170,12 +207,50 @@ void AudioEmitter::mixTo(size_t numSamples, gsl::span<AudioBuffer*> dst, AudioMi
 		}
 	}
 
+	hasMixed = true;
 	advancePlayback(numSamples);
 	if (!isPlaying) {
 		stop();
 	}
 }
 
+float AudioEmitter::getAudibility() const
+{
+	float result = 0.0f;
+	for (size_t i = 0; i < numMixes; ++i) {
+		result = std::max(result, channelMix[i]);
+	}
+	return result;
+}
+
+void AudioEmitter::setVirtual(bool v)
+{
+	if (v) {
+		if (voiceState == VoiceState::Real) {
+			// No need to fade out something that was never heard
+			voiceState = hasMixed ? VoiceState::FadingOut : VoiceState::Virtual;
+		}
+	} else {
+		if (voiceState == VoiceState::Virtual && hasMixed) {
+			prevChannelMix.fill(0.0f);
+		}
+		voiceState = VoiceState::Real;
+	}
+}
+
+bool AudioEmitter::isVirtual() const
+{
+	return voiceState == VoiceState::Virtual;
+}
+
+void AudioEmitter::skipTo(size_t numSamples)
+{
+	const bool isPlaying = source->skipAudioData(numSamples);
+	advancePlayback(numSamples);
+	if (!isPlaying) {
+		stop();
+	}
+}
 void AudioEmitter::advancePlayback(size_t samples)
 {
 	elapsedTime += float(samples) / AudioConfig::sampleRate;
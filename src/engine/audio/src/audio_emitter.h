@@ -30,7 +30,22 @@ namespace Halley {
 		size_t getNumberOfChannels() const;
 
 		void update(gsl::span<const AudioChannelData> channels, const AudioListenerData& listener, float groupGain);
+
+		// The same as update, split up so the mix can be computed elsewhere, in between begin and end
+		void beginUpdate();
+		void updateMix(gsl::span<const AudioChannelData> channels, const AudioListenerData& listener, float groupGain);
+		void endUpdate(size_t nDstChannels);
+		const AudioPosition::SpatialSource* getSingleSpatialSource() const; // Mono emitters at a single position only
+		gsl::span<float, 16> getChannelMix();
 		void mixTo(size_t numSamples, gsl::span<AudioBuffer*> dst, AudioMixer& mixer, AudioBufferPool& pool);
+
+		// How loud this is on its loudest output channel, as of the last update
+		float getAudibility() const;
+
+		// Virtual emitters keep their playback position moving, but aren't read from or mixed.
+		// Going virtual fades out over the next mix, and coming back fades in.
+		void setVirtual(bool isVirtual);
+		bool isVirtual() const;
 		
 		void setId(size_t id);
 		size_t getId() const;
@@ -48,15 +63,25 @@ namespace Halley {
 		bool playing = false;
 		bool done = false;
 		bool isFirstUpdate = true;
+		bool hasMixed = false;
     	float gain;
 		float elapsedTime = 0.0f;
 
 		size_t nChannels = 0;
+		size_t numMixes = 0;
 		std::array<float, 16> channelMix;
 		std::array<float, 16> prevChannelMix;
 
 		size_t id = std::numeric_limits<size_t>::max();
 
+		enum class VoiceState {
+			Real,
+			FadingOut,
+			Virtual
+		};
+		VoiceState voiceState = VoiceState::Real;
+
 		void advancePlayback(size_t samples);
+		void skipTo(size_t numSamples);
     };
 }
@@ -5,8 +5,11 @@
 #include "audio_source_clip.h"
 #include "audio_filter_resample.h"
 #include "halley/support/debug.h"
+#include "halley/support/profiler.h"
 #include "halley/core/resources/resources.h"
 #include "audio_event.h"
+#include "halley/support/logger.h"
+#include "vorbis_dec.h"
 
 using namespace Halley;
 
@@ -15,8 +18,11 @@ AudioEngine::AudioEngine()
 	, pool(std::make_unique<AudioBufferPool>())
 	, running(true)
 	, needsBuffer(true)
+	, rng(Random::getGlobal().getRawInt(), RandomEngine::Xoshiro)
 {
-	rng.setSeed(Random::getGlobal().getRawInt());
+
+	// The root group
+	getGroupId("");
 }
 
 AudioEngine::~AudioEngine()
@@ -30,6 +36,10 @@ void AudioEngine::postEvent(size_t id, std::shared_ptr<const AudioEvent> event,
 
 void AudioEngine::play(size_t id, std::shared_ptr<const IAudioClip> clip, AudioPosition position, float volume, bool loop)
 {
+	auto audioClip = std::dynamic_pointer_cast<const AudioClip>(clip);
+	if (audioClip) {
+		clip = clipCache.getClip(audioClip, AudioClipPolicy::DecodeOnPlay);
+	}
 	addEmitter(id, std::make_unique<AudioEmitter>(std::make_shared<AudioSourceClip>(clip, loop, 0), position, volume, getGroupId("")));
 }
 
@@ -95,6 +105,17 @@ void AudioEngine::start(AudioSpec s, AudioOutputAPI& o)
 {
 	spec = s;
 	out = &o;
+	running = true;
+
+	// Resuming keeps whatever latency it had settled on before
+	if (spec.lowLatency) {
+		if (targetLatency == 0) {
+			targetLatency = size_t(spec.bufferSize) * 2;
+			buffersBeforeLowering = std::max(size_t(spec.sampleRate / spec.bufferSize), size_t(1)) * 10;
+		}
+		lastUnderruns = out->getUnderrunCount();
+		setTargetLatency(targetLatency);
+	}
 
 	channels.resize(spec.numChannels);
 	channels[0].pan = -1.0f;
@@ -119,6 +140,8 @@ void AudioEngine::pause()
 
 void AudioEngine::generateBuffer()
 {
+	Profiler::Scope profile("AudioEngine::generateBuffer", ProfilerEventType::Audio);
+	const int64_t startTime = Profiler::getTimeNs();
 	const size_t samplesToRead = alignUp(spec.bufferSize * 48000 / spec.sampleRate, 16);
 	const size_t packsToRead = samplesToRead / 16;
 	const size_t numChannels = spec.numChannels;
@@ -144,6 +167,88 @@ void AudioEngine::generateBuffer()
 	} else {
 		out->queueAudio(bufferRef.getSampleSpan());
 	}
+
+	const int64_t mixTime = Profiler::getTimeNs() - startTime;
+	stats.bufferDuration = float(samplesToRead) / float(AudioConfig::sampleRate);
+	++stats.buffersMixed;
+	if (mixTime * 1e-9f > stats.bufferDuration) {
+		++stats.lateBuffers;
+	}
+	++statsBuffers;
+	statsMixTime += mixTime;
+	statsMaxMixTime = std::max(statsMaxMixTime, mixTime);
+	mixTimes.addSample(mixTime);
+
+	if (spec.lowLatency) {
+		updateTargetLatency();
+	}
+}
+
+void AudioEngine::updateTargetLatency()
+{
+	const size_t bufferSize = size_t(spec.bufferSize);
+	const size_t buffersPerSecond = std::max(size_t(spec.sampleRate) / bufferSize, size_t(1));
+	const size_t maxLatency = size_t(spec.sampleRate) / 20;
+	const size_t underruns = out->getUnderrunCount();
+	++buffersSinceLatencyChange;
+
+	if (underruns != lastUnderruns) {
+		// Underruns just after raising it are still from the same hiccup, as the output hasn't had time to fill up yet
+		lastUnderruns = underruns;
+		if (buffersSinceLatencyChange > buffersPerSecond / 10 && targetLatency < maxLatency) {
+			setTargetLatency(std::min(targetLatency + bufferSize, maxLatency));
+
+			// Each time lowering it turns out to be too much, wait longer before trying again
+			buffersBeforeLowering = std::min(buffersBeforeLowering * 2, buffersPerSecond * 300);
+		}
+	} else if (buffersSinceLatencyChange > buffersBeforeLowering && targetLatency > bufferSize) {
+		setTargetLatency(targetLatency - bufferSize);
+	}
+}
+
+void AudioEngine::setTargetLatency(size_t frames)
+{
+	targetLatency = frames;
+	buffersSinceLatencyChange = 0;
+	out->setTargetLatency(frames);
+}
+
+bool AudioEngine::collectStats(AudioStats& result)
+{
+	constexpr float reportInterval = 0.25f;
+	const float period = float(statsBuffers) * stats.bufferDuration;
+	if (statsBuffers == 0 || period < reportInterval) {
+		return false;
+	}
+
+	const int64_t decodeTime = VorbisData::getTotalDecodeTime();
+	stats.averageMixTime = float(statsMixTime) * 1e-9f / float(statsBuffers);
+	stats.maxMixTime = float(statsMaxMixTime) * 1e-9f;
+	stats.mixTimeRecent = mixTimes.getStats(TimeHistogram::Window::Recent);
+	stats.mixTimeTotal = mixTimes.getStats(TimeHistogram::Window::Total);
+	stats.decodeTime = float(decodeTime - statsDecodeTime) * 1e-9f / period;
+	stats.underruns = out ? out->getUnderrunCount() : 0;
+	stats.outputLatency = float(size_t(spec.bufferSize) + targetLatency) / float(spec.sampleRate);
+	stats.groups.resize(buses.size());
+	for (size_t i = 0; i < buses.size(); ++i) {
+		stats.groups[i].name = buses[i].name;
+		stats.groups[i].effectsTime = float(buses[i].effectsTime) * 1e-9f / float(statsBuffers);
+		buses[i].effectsTime = 0;
+	}
+
+	// So they can be lined up with everything else in the trace
+	Profiler::recordCounter("Audio mix load", stats.averageMixTime / stats.bufferDuration);
+	Profiler::recordCounter("Audio decode load", stats.decodeTime);
+	Profiler::recordCounter("Audio voices", float(stats.activeVoices));
+	Profiler::recordCounter("Audio virtual voices", float(stats.virtualVoices));
+
+	statsBuffers = 0;
+	statsMixTime = 0;
+	statsMaxMixTime = 0;
+	statsDecodeTime = decodeTime;
+
+	result = stats;
+	return true;
 }
 
 Random& AudioEngine::getRNG()
@@ -163,7 +268,59 @@ void AudioEngine::setMasterGain(float gain)
 
 void AudioEngine::setGroupGain(const String& name, float gain)
 {
-	groupGains[getGroupId(name)] = gain;
+	buses[getGroupId(name)].gain = gain;
+}
+
+void AudioEngine::setGroupParent(const String& group, const String& parent)
+{
+	const int id = getGroupId(group);
+	const int parentId = getGroupId(parent);
+	if (id == 0) {
+		Logger::logWarning("The root audio group can't have a parent.");
+		return;
+	}
+	for (int p = parentId; p >= 0; p = buses[p].parent) {
+		if (p == id) {
+			Logger::logWarning("Audio group \"" + group + "\" can't be a child of \"" + parent + "\", as that would form a loop.");
+			return;
+		}
+	}
+
+	buses[id].parent = parentId;
+	busOrderDirty = true;
+}
+
+void AudioEngine::addGroupEffect(const String& group, const AudioEffectParameters& effect)
+{
+	const int id = getGroupId(group);
+	const int sidechain = effect.sidechainGroup.isEmpty() ? -1 : getGroupId(effect.sidechainGroup);
+	buses[id].effects.push_back(AudioEffect::make(effect, sidechain));
+}
+
+void AudioEngine::clearGroupEffects(const String& group)
+{
+	buses[getGroupId(group)].effects.clear();
+}
+
+void AudioEngine::setMaxVoices(size_t value)
+{
+	maxVoices = value;
+}
+
+void AudioEngine::setMixer(std::unique_ptr<AudioMixer> m)
+{
+	Expects(m);
+	mixer = std::move(m);
+}
+
+void AudioEngine::setDecodedAudioBudget(size_t bytes)
+{
+	clipCache.setBudget(bytes);
+}
+
+AudioClipCache& AudioEngine::getClipCache()
+{
+	return clipCache;
 }
 
 void AudioEngine::mixEmitters(size_t numSamples, size_t nChannels, gsl::span<AudioBuffer*> buffers)
@@ -172,20 +329,167 @@ void AudioEngine::mixEmitters(size_t numSamples, size_t nChannels, gsl::span<Aud
 	for (size_t i = 0; i < nChannels; ++i) {
 		clearBuffer(buffers[i]->packs);
 	}
-
-	// Mix every emitter
+	outputBuffers = buffers;
+	updateBuses();
+
+	// Update every emitter first, so we know how loud each of them is.
+	// Those at a single point in the world are spatialised all together, which is most of them in busy scenes.
+	voices.clear();
+	spatialisedEmitters.clear();
+	spatialiser.clear();
 	for (auto& e: emitters) {
 		// Start playing if necessary
 		if (!e->isPlaying() && !e->isDone() && e->isReady()) {
 			e->start();
 		}
 
-		// Mix it in!
 		if (e->isPlaying()) {
-			e->update(channels, listener, masterGain * getGroupGain(e->getGroup()));
-			e->mixTo(numSamples, buffers, *mixer, *pool);
+			const float groupGain = masterGain * getGroupGain(e->getGroup());
+			e->beginUpdate();
+			if (const auto* source = e->getSingleSpatialSource()) {
+				spatialiser.add(*source, e->getGain() * groupGain, e->getChannelMix());
+				spatialisedEmitters.push_back(e.get());
+			} else {
+				e->updateMix(channels, listener, groupGain);
+				e->endUpdate(channels.size());
+			}
+			voices.push_back(e.get());
 		}
 	}
+
+	spatialiser.run(channels, listener);
+	for (auto& e: spatialisedEmitters) {
+		e->endUpdate(channels.size());
+	}
+
+	assignVoices();
+
+	// Mix it in! Virtual voices just move forward
+	for (auto& e: voices) {
+		e->mixTo(numSamples, getBusBuffers(e->getGroup(), numSamples), *mixer, *pool);
+	}
+
+	mixBuses(numSamples);
+	outputBuffers = gsl::span<AudioBuffer*>();
+}
+
+void AudioEngine::updateBuses()
+{
+	if (busOrderDirty) {
+		busOrderDirty = false;
+
+		std::vector<int> depths(buses.size(), 0);
+		for (size_t i = 0; i < buses.size(); ++i) {
+			for (int p = buses[i].parent; p >= 0; p = buses[p].parent) {
+				++depths[i];
+			}
+		}
+
+		busOrder.resize(buses.size());
+		for (size_t i = 0; i < buses.size(); ++i) {
+			busOrder[i] = int(i);
+		}
+		std::stable_sort(busOrder.begin(), busOrder.end(), [&] (int a, int b)
+		{
+			return depths[a] > depths[b];
+		});
+	}
+
+	// Gains go down the tree, so walk it from the root
+	for (auto iter = busOrder.rbegin(); iter != busOrder.rend(); ++iter) {
+		auto& bus = buses[*iter];
+		bus.totalGain = bus.gain * (bus.parent >= 0 ? buses[bus.parent].totalGain : 1.0f);
+	}
+}
+
+gsl::span<AudioBuffer*> AudioEngine::getBusBuffers(int id, size_t numSamples)
+{
+	if (id == 0) {
+		return outputBuffers;
+	}
+
+	auto& bus = buses[id];
+	auto result = bus.buffers.getBuffers();
+	if (result.empty()) {
+		bus.buffers = pool->getBuffers(size_t(outputBuffers.size()), numSamples);
+		result = bus.buffers.getBuffers();
+		for (auto& b: result) {
+			clearBuffer(b->packs);
+		}
+	}
+	return result;
+}
+
+void AudioEngine::mixBuses(size_t numSamples)
+{
+	const size_t numPacks = numSamples / AudioSamplePack::NumSamples;
+
+	for (auto id: busOrder) {
+		auto& bus = buses[id];
+
+		// Effects keep running with no input, so tails like the reverb's can ring out
+		if (!bus.effects.empty()) {
+			Profiler::Scope profile(bus.profileName, ProfilerEventType::Audio);
+			const int64_t startTime = Profiler::getTimeNs();
+
+			const auto buffers = getBusBuffers(id, numSamples);
+			const AudioEffectContext context { buffers, numPacks, *mixer, *pool, busPeaks };
+			for (auto& effect: bus.effects) {
+				effect->process(context);
+			}
+
+			bus.effectsTime += Profiler::getTimeNs() - startTime;
+		}
+
+		const auto buffers = id == 0 ? outputBuffers : bus.buffers.getBuffers();
+		float peak = 0.0f;
+		for (auto& b: buffers) {
+			peak = std::max(peak, mixer->getPeak(gsl::span<const AudioSamplePack>(b->packs).subspan(0, numPacks)));
+		}
+		busPeaks[id] = peak;
+
+		if (id != 0 && !buffers.empty()) {
+			const auto parentBuffers = getBusBuffers(bus.parent, numSamples);
+			for (ptrdiff_t ch = 0; ch < buffers.size(); ++ch) {
+				const auto src = gsl::span<const AudioSamplePack>(buffers[ch]->packs).subspan(0, numPacks);
+				const auto dst = gsl::span<AudioSamplePack>(parentBuffers[ch]->packs).subspan(0, numPacks);
+				mixer->mixAudio(src, dst, 1.0f, 1.0f);
+			}
+			bus.buffers = AudioBuffersRef();
+		}
+	}
+}
+
+void AudioEngine::assignVoices()
+{
+	constexpr float minAudibleGain = 0.0001f;
+
+	// Whatever can't be heard is always virtual
+	const auto audibleEnd = std::partition(voices.begin(), voices.end(), [&] (const AudioEmitter* e)
+	{
+		return e->getAudibility() >= minAudibleGain;
+	});
+	size_t nReal = size_t(audibleEnd - voices.begin());
+
+	// Past the cap, only the loudest ones are real. The ones already being mixed get an edge, so that two similarly
+	// loud emitters don't keep swapping places every buffer.
+	if (nReal > maxVoices) {
+		const auto getPriority = [] (const AudioEmitter* e)
+		{
+			return e->getAudibility() * (e->isVirtual() ? 1.0f : 1.25f);
+		};
+		std::nth_element(voices.begin(), voices.begin() + maxVoices, audibleEnd, [&] (const AudioEmitter* a, const AudioEmitter* b)
+		{
+			return getPriority(a) > getPriority(b);
+		});
+		nReal = maxVoices;
+	}
+
+	for (size_t i = 0; i < voices.size(); ++i) {
+		voices[i]->setVirtual(i >= nReal);
+	}
+	stats.activeVoices = nReal;
+	stats.virtualVoices = voices.size() - nReal;
 }
 
 void AudioEngine::removeFinishedEmitters()
@@ -217,17 +521,22 @@ void AudioEngine::clearBuffer(gsl::span<AudioSamplePack> dst)
 
 int AudioEngine::getGroupId(const String& group)
 {
-	auto iter = std::find(groupNames.begin(), groupNames.end(), group);
-	if (iter != groupNames.end()) {
-		return iter - groupNames.begin();
+	auto iter = std::find_if(buses.begin(), buses.end(), [&] (const Bus& bus) { return bus.name == group; });
+	if (iter != buses.end()) {
+		return int(iter - buses.begin());
 	} else {
-		groupNames.push_back(group);
-		groupGains.push_back(1.0f);
-		return int(groupNames.size()) - 1;
+		Bus bus;
+		bus.name = group;
+		bus.parent = buses.empty() ? -1 : 0;
+		bus.profileName = Profiler::internName("Audio group \"" + group + "\" effects");
+		buses.push_back(std::move(bus));
+		busPeaks.push_back(0.0f);
+		busOrderDirty = true;
+		return int(buses.size()) - 1;
 	}
 }
 
 float AudioEngine::getGroupGain(int id) const
 {
-	return groupGains[id];
+	return buses[id].totalGain;
 }
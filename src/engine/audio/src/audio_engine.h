@@ -6,6 +6,9 @@
 #include <map>
 #include <vector>
 #include "audio_emitter.h"
+#include "audio_clip_cache.h"
+#include "audio_effect.h"
+#include "audio_spatialiser.h"
 #include "halley/audio/resampler.h"
 #include "halley/maths/random.h"
 #include "halley/data_structures/flat_map.h"
@@ -44,6 +47,17 @@ namespace Halley {
 		void setMasterGain(float gain);
 		void setGroupGain(const String& name, float gain);
 		int getGroupId(const String& group);
+		void setGroupParent(const String& group, const String& parent);
+		void addGroupEffect(const String& group, const AudioEffectParameters& effect);
+		void clearGroupEffects(const String& group);
+
+		void setMaxVoices(size_t maxVoices);
+		void setMixer(std::unique_ptr<AudioMixer> mixer); // Only while not generating a buffer
+		void setDecodedAudioBudget(size_t bytes);
+		AudioClipCache& getClipCache();
+
+		// Fills in the stats every so often, returning whether it did
+		bool collectStats(AudioStats& result);
 
     private:
 		AudioSpec spec;
@@ -51,29 +65,68 @@ namespace Halley {
 		std::unique_ptr<AudioMixer> mixer;
 		std::unique_ptr<AudioBufferPool> pool;
 		std::unique_ptr<AudioResampler> outResampler;
+		AudioClipCache clipCache;
 
 		std::atomic<bool> running;
 		std::atomic<bool> needsBuffer;
-		std::mutex mutex;
 		std::condition_variable backBufferCondition;
 
 		std::vector<std::unique_ptr<AudioEmitter>> emitters;
+		std::vector<AudioEmitter*> voices;
+		std::vector<AudioEmitter*> spatialisedEmitters;
+		AudioSpatialiser spatialiser;
+		size_t maxVoices = 64;
 		std::vector<AudioChannelData> channels;
 		
 		std::map<size_t, std::vector<AudioEmitter*>> idToSource;
 		std::vector<AudioEmitter*> dummyIdSource;
 
+		// Each group is a bus, mixing into its parent. The root one is always the first, and mixes into the output.
+		struct Bus
+		{
+			String name;
+			int parent = -1;
+			float gain = 1.0f;
+			float totalGain = 1.0f; // Including its parents'
+			std::vector<std::unique_ptr<AudioEffect>> effects;
+			AudioBuffersRef buffers; // Only while mixing, and only if anything mixed into it
+			const char* profileName = "";
+			int64_t effectsTime = 0; // Since the last stats report
+		};
+
 		float masterGain = 1.0f;
-		std::vector<String> groupNames;
-    	std::vector<float> groupGains;
+		std::vector<Bus> buses;
+		std::vector<int> busOrder; // Children before their parents
+		std::vector<float> busPeaks;
+		bool busOrderDirty = true;
+		gsl::span<AudioBuffer*> outputBuffers;
+
+		AudioStats stats;
+		size_t statsBuffers = 0;
+		int64_t statsMixTime = 0;
+		int64_t statsMaxMixTime = 0;
+		TimeHistogram mixTimes;
+		int64_t statsDecodeTime = 0;
+
+		// Low latency mode only: how many frames the output keeps queued, raised whenever it underruns
+		size_t targetLatency = 0;
+		size_t lastUnderruns = 0;
+		size_t buffersSinceLatencyChange = 0;
+		size_t buffersBeforeLowering = 0;
 
 		AudioListenerData listener;
 
 		Random rng;
 
 		void mixEmitters(size_t numSamples, size_t channels, gsl::span<AudioBuffer*> buffers);
+		void assignVoices();
+		void updateBuses();
+		void mixBuses(size_t numSamples);
+		gsl::span<AudioBuffer*> getBusBuffers(int id, size_t numSamples);
 	    void removeFinishedEmitters();
 		void clearBuffer(gsl::span<AudioSamplePack> dst);
+		void updateTargetLatency();
+		void setTargetLatency(size_t frames);
 
     	float getGroupGain(int group) const;
     };
@@ -101,6 +101,13 @@ AudioEventActionPlay::AudioEventActionPlay(const ConfigNode& node)
 	minimumSpace = node["minimumSpace"].asFloat(0.0f);
 	delay = node["delay"].asFloat(0.0f);
 	loop = node["loop"].asBool(false);
+
+	// Looping sounds tend to be long ambiences and music, which aren't worth keeping decoded
+	if (node.hasKey("policy")) {
+		policy = fromString<AudioClipPolicy>(node["policy"].asString());
+	} else {
+		policy = loop ? AudioClipPolicy::Stream : AudioClipPolicy::DecodeOnPlay;
+	}
 }
 
 void AudioEventActionPlay::run(AudioEngine& engine, size_t id, const AudioPosition& position) const
@@ -126,7 +133,7 @@ void AudioEventActionPlay::run(AudioEngine& engine, size_t id, const AudioPositi
 
 	constexpr int sampleRate = 48000;
 
-	std::shared_ptr<AudioSource> source = std::make_shared<AudioSourceClip>(clip, loop, lround(delay * sampleRate));
+	std::shared_ptr<AudioSource> source = std::make_shared<AudioSourceClip>(engine.getClipCache().getClip(clip, policy), loop, lround(delay * sampleRate));
 	if (std::abs(curPitch - 1.0f) > 0.01f) {
 		source = std::make_shared<AudioFilterResample>(source, int(lround(sampleRate * curPitch)), sampleRate, engine.getPool());
 	}
@@ -138,6 +145,11 @@ AudioEventActionType AudioEventActionPlay::getType() const
 	return AudioEventActionType::Play;
 }
 
+const std::vector<String>& AudioEventActionPlay::getClips() const
+{
+	return clips;
+}
+
 void AudioEventActionPlay::serialize(Serializer& s) const
 {
 	s << clips;
@@ -147,6 +159,7 @@ void AudioEventActionPlay::serialize(Serializer& s) const
 	s << delay;
 	s << minimumSpace;
 	s << loop;
+	s << toString(policy);
 }
 
 void AudioEventActionPlay::deserialize(Deserializer& s)
@@ -158,6 +171,9 @@ void AudioEventActionPlay::deserialize(Deserializer& s)
 	s >> delay;
 	s >> minimumSpace;
 	s >> loop;
+	String policyName;
+	s >> policyName;
+	policy = fromString<AudioClipPolicy>(policyName);
 }
 
 void AudioEventActionPlay::loadDependencies(const Resources& resources)
@@ -168,7 +184,11 @@ void AudioEventActionPlay::loadDependencies(const Resources& resources)
 			
 		for (auto& c: clips) {
 			if (resources.exists<AudioClip>(c)) {
-				clipData.push_back(resources.get<AudioClip>(c));
+				auto clip = resources.get<AudioClip>(c);
+				if (policy == AudioClipPolicy::KeepDecoded) {
+					clip->keepDecoded();
+				}
+				clipData.push_back(clip);
 			}
 			else {
 				clipData.push_back(std::shared_ptr<AudioClip>());
@@ -183,3 +203,15 @@ void AudioEvent::loadDependencies(Resources& resources) const
 		a->loadDependencies(resources);
 	}
 }
+
+std::vector<String> AudioEvent::getClips() const
+{
+	std::vector<String> result;
+	for (auto& a: actions) {
+		if (a->getType() == AudioEventActionType::Play) {
+			auto& clips = static_cast<const AudioEventActionPlay&>(*a).getClips();
+			result.insert(result.end(), clips.begin(), clips.end());
+		}
+	}
+	return result;
+}
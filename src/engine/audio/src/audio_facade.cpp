@@ -4,6 +4,7 @@
 #include "audio_emitter_behaviour.h"
 #include "halley/support/console.h"
 #include "halley/support/logger.h"
+#include "halley/support/memory_tracker.h"
 #include "halley/core/resources/resources.h"
 #include "audio_event.h"
 
@@ -14,6 +15,9 @@ AudioFacade::AudioFacade(AudioOutputAPI& o, SystemAPI& system)
 	, system(system)
 	, running(false)
 	, started(false)
+	, commands(4096)
+	, playingSoundsUpdates(4)
+	, statsUpdates(4)
 	, ownAudioThread(o.needsAudioThread())
 {
 }
@@ -59,13 +63,15 @@ void AudioFacade::startPlayback(int deviceNumber)
 		engine = std::make_unique<AudioEngine>();
 
 		AudioSpec format;
-		format.bufferSize = 512;
+		format.bufferSize = lowLatency ? 128 : 512;
 		format.format = AudioSampleFormat::Float;
 		format.numChannels = 2;
 		format.sampleRate = 48000;
+		format.lowLatency = lowLatency;
 
 		try {
 			audioSpec = output.openAudioDevice(format, devices.at(deviceNumber).get(), [this]() { onNeedBuffer(); });
+			ownAudioThread = output.needsAudioThread();
 			started = true;
 
 			std::cout << "Audio Playback started.\n";
@@ -73,7 +79,8 @@ void AudioFacade::startPlayback(int deviceNumber)
 			std::cout << "\tSample rate: " << audioSpec.sampleRate << "\n";
 			std::cout << "\tChannels: " << audioSpec.numChannels << "\n";
 			std::cout << "\tFormat: " << toString(audioSpec.format) << "\n";
-			std::cout << "\tBuffer size: " << audioSpec.bufferSize << std::endl;
+			std::cout << "\tBuffer size: " << audioSpec.bufferSize << "\n";
+			std::cout << "\tLow latency: " << (audioSpec.lowLatency ? "yes" : "no") << std::endl;
 
 			resumePlayback();
 		} catch (...) {
@@ -100,6 +107,11 @@ void AudioFacade::resumePlayback()
 			pausePlayback();
 		}
 
+		// Nothing is consuming or producing at this point, so drop whatever was left from before the pause
+		commands.clear();
+		playingSoundsUpdates.clear();
+		statsUpdates.clear();
+
 		engine->start(audioSpec, output);
 		running = true;
 
@@ -114,19 +126,21 @@ void AudioFacade::resumePlayback()
 void AudioFacade::pausePlayback()
 {
 	if (running) {
-		{
-			std::unique_lock<std::mutex> lock(audioMutex);
-			running = false;
-			engine->pause();
-		}
+		running = false;
 		if (ownAudioThread) {
 			audioThread.join();
 			audioThread = {};
 		}
 		output.stopPlayback();
+		engine->pause();
 	}
 }
 
+void AudioFacade::setLowLatency(bool enabled)
+{
+	lowLatency = enabled;
+}
+
 AudioHandle AudioFacade::postEvent(const String& name, AudioPosition position)
 {
 	if (!resources->exists<AudioEvent>(name))
@@ -211,6 +225,27 @@ void AudioFacade::setGroupVolume(const String& groupName, float volume)
 	});
 }
 
+void AudioFacade::setGroupParent(const String& groupName, const String& parentName)
+{
+	enqueue([=] () {
+		engine->setGroupParent(groupName, parentName);
+	});
+}
+
+void AudioFacade::addGroupEffect(const String& groupName, AudioEffectParameters effect)
+{
+	enqueue([=] () {
+		engine->addGroupEffect(groupName, effect);
+	});
+}
+
+void AudioFacade::clearGroupEffects(const String& groupName)
+{
+	enqueue([=] () {
+		engine->clearGroupEffects(groupName);
+	});
+}
+
 void AudioFacade::setOutputChannels(std::vector<AudioChannelData> audioChannelData)
 {
 	enqueue([=, audioChannelData = std::move(audioChannelData)] () mutable
@@ -242,6 +277,25 @@ void AudioFacade::setListener(AudioListenerData listener)
 	});
 }
 
+void AudioFacade::setMaxVoices(size_t maxVoices)
+{
+	enqueue([=] () {
+		engine->setMaxVoices(maxVoices);
+	});
+}
+
+void AudioFacade::setDecodedAudioBudget(size_t bytes)
+{
+	enqueue([=] () {
+		engine->setDecodedAudioBudget(bytes);
+	});
+}
+
+AudioStats AudioFacade::getStats() const
+{
+	return stats;
+}
+
 void AudioFacade::onAudioException(std::exception& e)
 {
 	std::unique_lock<std::mutex> lock(exceptionMutex);
@@ -257,18 +311,14 @@ void AudioFacade::run()
 
 void AudioFacade::stepAudio()
 {
+	MemoryTagScope memoryTag(MemoryTag::Audio);
 	try {
-		{
-			std::unique_lock<std::mutex> lock(audioMutex);
-			if (!running) {
-				return;
-			}
-			std::swap(inbox, inboxProcessing);
-			inbox.clear();
-			playingSoundsNext = engine->getPlayingSounds();
+		if (!running) {
+			return;
 		}
 
-		for (auto& action : inboxProcessing) {
+		std::function<void()> action;
+		while (commands.tryPop(action)) {
 			action();
 		}
 
@@ -277,6 +327,14 @@ void AudioFacade::stepAudio()
 		} else {
 			engine->generateBuffer();
 		}
+
+		// If the game thread hasn't picked up the previous ones yet, it'll just get the next snapshot instead
+		playingSoundsUpdates.tryPush(engine->getPlayingSounds());
+
+		AudioStats newStats;
+		if (engine->collectStats(newStats)) {
+			statsUpdates.tryPush(std::move(newStats));
+		}
 	} catch (std::exception& e) {
 		onAudioException(e);
 	}
@@ -305,19 +363,22 @@ void AudioFacade::pump()
 	}
 
 	if (running) {
-		std::unique_lock<std::mutex> lock(audioMutex);
-		if (!outbox.empty()) {
-			size_t i = inbox.size();
-			inbox.resize(i + outbox.size());
-			for (auto& o: outbox) {
-				inbox[i++] = std::move(o);
-			}
-			outbox.clear();
+		size_t sent = 0;
+		while (sent < outbox.size() && commands.tryPush(std::move(outbox[sent]))) {
+			++sent;
 		}
+		outbox.erase(outbox.begin(), outbox.begin() + sent);
 
-		playingSounds = playingSoundsNext;
+		std::vector<size_t> update;
+		while (playingSoundsUpdates.tryPop(update)) {
+			playingSounds = std::move(update);
+		}
+
+		AudioStats newStats;
+		while (statsUpdates.tryPop(newStats)) {
+			stats = std::move(newStats);
+		}
 	} else {
-		inbox.clear();
 		outbox.clear();
 	}
 }
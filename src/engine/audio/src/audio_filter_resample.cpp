@@ -29,10 +29,8 @@ bool AudioFilterResample::getAudioData(size_t numSamples, AudioSourceData& dstBu
 	const size_t samplesToGenerate = numSamples - nLeftOver;
 	const size_t numSamplesSrc = samplesToGenerate * fromHz / toHz + additionalPaddingSamples;
 
-	if (resamplers.empty()) {
-		for (size_t i = 0; i < nChannels; ++i) {
-			resamplers.push_back(std::make_unique<AudioResampler>(fromHz, toHz, 1, Debug::isDebug() ? 0.0f : 0.3f));
-		}
+	if (!resampler) {
+		resampler = std::make_unique<AudioResampler>(fromHz, toHz, int(nChannels), Debug::isDebug() ? 0.0f : 0.3f);
 	}
 
 	// Read upstream data
@@ -40,32 +38,46 @@ bool AudioFilterResample::getAudioData(size_t numSamples, AudioSourceData& dstBu
 	auto srcs = srcBuffers.getSampleSpans();
 	bool playing = source->getAudioData(numSamplesSrc, srcs);
 
-	// Prepare temporary destination data
-	auto tmpBuffer = pool.getBuffer(numSamples + 2 * AudioSamplePack::NumSamples);
-	auto tmp = tmpBuffer.getSampleSpan();
-	
-	// Resample
+	// Prepare temporary destination data, with room for the leftovers at the start
+	auto tmpBuffers = pool.getBuffers(nChannels, numSamples + 2 * AudioSamplePack::NumSamples);
+	auto tmps = tmpBuffers.getSampleSpans();
+	std::array<gsl::span<const AudioConfig::SampleFormat>, AudioConfig::maxChannels> resampleSrc;
+	std::array<gsl::span<AudioConfig::SampleFormat>, AudioConfig::maxChannels> resampleDst;
 	for (size_t channel = 0; channel < nChannels; ++channel) {
-		// First copy any leftovers
 		Expects(leftoverSamples[channel].n == nLeftOver);
 		for (size_t i = 0; i < nLeftOver; ++i) {
-			tmp[i] = leftoverSamples[channel].samples[i];
+			tmps[channel][i] = leftoverSamples[channel].samples[i];
 		}
+		resampleSrc[channel] = srcs[channel].subspan(0, numSamplesSrc);
+		resampleDst[channel] = tmps[channel].subspan(nLeftOver);
+	}
 
-		auto result = resamplers[channel]->resample(srcs[channel].subspan(0, numSamplesSrc), tmp.subspan(nLeftOver), 0);
-		Expects(result.nRead == numSamplesSrc);
-		Expects(result.nWritten >= samplesToGenerate);
+	// Resample every channel at once
+	auto result = resampler->resampleChannels(gsl::span<const gsl::span<const AudioConfig::SampleFormat>>(resampleSrc).subspan(0, nChannels), gsl::span<const gsl::span<AudioConfig::SampleFormat>>(resampleDst).subspan(0, nChannels));
+	Expects(result.nRead == numSamplesSrc);
+	Expects(result.nWritten >= samplesToGenerate);
 
+	const size_t leftOver = result.nWritten + nLeftOver - numSamples;
+	for (size_t channel = 0; channel < nChannels; ++channel) {
 		// Store left overs
-		size_t leftOver = result.nWritten + nLeftOver - numSamples;
 		for (size_t i = 0; i < leftOver; ++i) {
-			leftoverSamples[channel].samples[i] = tmp[i + numSamples];
+			leftoverSamples[channel].samples[i] = tmps[channel][i + numSamples];
 		}
 		leftoverSamples[channel].n = leftOver;
 
 		// Copy to destination
-		memcpy(dstBuffers[channel].data(), tmp.data(), numSamples * sizeof(AudioConfig::SampleFormat));
+		memcpy(dstBuffers[channel].data(), tmps[channel].data(), numSamples * sizeof(AudioConfig::SampleFormat));
 	}
 
 	return playing;
 }
+
+bool AudioFilterResample::skipAudioData(size_t numSamples)
+{
+	// The resampler's history goes stale, but nobody is listening to the glitch when playback resumes
+	const size_t nLeftOver = std::min(leftoverSamples[0].n, numSamples);
+	for (auto& l: leftoverSamples) {
+		l.n = 0;
+	}
+	return source->skipAudioData((numSamples - nLeftOver) * fromHz / toHz);
+}
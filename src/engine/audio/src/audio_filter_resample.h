@@ -13,11 +13,12 @@ namespace Halley
 		size_t getNumberOfChannels() const override;
 		bool isReady() const override;
 		bool getAudioData(size_t numSamples, AudioSourceData& dst) override;
+		bool skipAudioData(size_t numSamples) override;
 
 	private:
 		AudioBufferPool& pool;
 		std::shared_ptr<AudioSource> source;
-		std::vector<std::unique_ptr<AudioResampler>> resamplers;
+		std::unique_ptr<AudioResampler> resampler;
 		int fromHz;
 		int toHz;
 
@@ -1,7 +1,11 @@
 #include "audio_mixer.h"
 #include "halley/utils/utils.h"
+#include "halley/support/exception.h"
+#include <algorithm>
 #include "audio_mixer_sse.h"
 #include "audio_mixer_avx.h"
+#include "audio_mixer_avx2.h"
+#include "audio_mixer_neon.h"
 
 using namespace Halley;
 
@@ -54,73 +58,198 @@ void AudioMixer::compressRange(gsl::span<AudioSamplePack> buffer)
 	}
 }
 
-#ifdef HAS_SSE
-
-#ifdef _MSC_VER
+void AudioMixer::scaleAudio(gsl::span<AudioSamplePack> dst, float gain0, float gain1)
+{
+	const size_t nPacks = size_t(dst.size());
 
-#include <intrin.h>
+	if (gain0 == gain1) {
+		for (size_t i = 0; i < nPacks; ++i) {
+			for (size_t j = 0; j < AudioSamplePack::NumSamples; ++j) {
+				dst[i].samples[j] *= gain0;
+			}
+		}
+	} else {
+		const float scale = 1.0f / (dst.size() * AudioSamplePack::NumSamples);
+		for (size_t i = 0; i < nPacks; ++i) {
+			for (size_t j = 0; j < AudioSamplePack::NumSamples; ++j) {
+				dst[i].samples[j] *= lerp(gain0, gain1, (i * AudioSamplePack::NumSamples + j) * scale);
+			}
+		}
+	}
+}
 
-#else
+float AudioMixer::getPeak(gsl::span<const AudioSamplePack> src)
+{
+	float peak = 0.0f;
+	for (auto& pack: src) {
+		for (size_t j = 0; j < AudioSamplePack::NumSamples; ++j) {
+			peak = std::max(peak, std::abs(pack.samples[j]));
+		}
+	}
+	return peak;
+}
 
-#include <cpuid.h>
-static inline unsigned long long _xgetbv(unsigned int index){
-	unsigned int eax, edx;
-	__asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(index));
-	return ((unsigned long long)edx << 32) | eax;
+void AudioMixer::filterBiquad(gsl::span<AudioBuffer*> buffers, size_t numPacks, const AudioBiquadCoefficients& c, gsl::span<AudioBiquadState> state)
+{
+	Expects(state.size() >= buffers.size());
+
+	// Transposed direct form II
+	const size_t nSamples = numPacks * AudioSamplePack::NumSamples;
+	for (ptrdiff_t ch = 0; ch < buffers.size(); ++ch) {
+		Expects(buffers[ch]->packs.size() >= numPacks);
+		float* samples = reinterpret_cast<float*>(buffers[ch]->packs.data());
+		float z1 = state[ch].z1;
+		float z2 = state[ch].z2;
+		for (size_t i = 0; i < nSamples; ++i) {
+			const float x = samples[i];
+			const float y = c.b0 * x + z1;
+			z1 = c.b1 * x - c.a1 * y + z2;
+			z2 = c.b2 * x - c.a2 * y;
+			samples[i] = y;
+		}
+		state[ch].z1 = z1;
+		state[ch].z2 = z2;
+	}
 }
-#define _XCR_XFEATURE_ENABLED_MASK 0
 
-#endif
+#ifdef HAS_AVX
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
 #endif
 
-#ifdef HAS_AVX
-static bool hasAVX()
-{
-#ifndef _MSC_VER
-    // It's crashing on Linux :(
-    return false;
-#endif
+namespace {
+	struct CPUFeatures
+	{
+		bool avx = false;
+		bool avx2 = false;
+	};
 
-#ifdef HAS_SSE
-	int regs[4];
-	int i = 1;
+	void cpuid(int leaf, int regs[4])
+	{
+#ifdef _MSC_VER
+		__cpuidex(regs, leaf, 0);
+#else
+		unsigned int a = 0, b = 0, c = 0, d = 0;
+		__cpuid_count(leaf, 0, a, b, c, d);
+		regs[0] = int(a);
+		regs[1] = int(b);
+		regs[2] = int(c);
+		regs[3] = int(d);
+#endif
+	}
 
-#ifdef _WIN32
-	__cpuid(regs, i);
+	unsigned long long getXCR0()
+	{
+#ifdef _MSC_VER
+		return _xgetbv(0);
 #else
-	asm volatile
-	("cpuid" : "=a" (regs[0]), "=b" (regs[1]), "=c" (regs[2]), "=d" (regs[3])
-	: "a" (i), "c" (0));
-	// ECX is set to zero for CPUID function 4
+		unsigned int eax, edx;
+		__asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return (static_cast<unsigned long long>(edx) << 32) | eax;
 #endif
+	}
 
-	bool osUsesXSAVE_XRSTORE = regs[2] & (1 << 27) || false;
-	bool cpuAVXSuport = regs[2] & (1 << 28) || false;
+	CPUFeatures getCPUFeatures()
+	{
+		CPUFeatures result;
 
-	if (osUsesXSAVE_XRSTORE && cpuAVXSuport) {
-		unsigned long long xcrFeatureMask = _xgetbv(_XCR_XFEATURE_ENABLED_MASK);
-		return (xcrFeatureMask & 0x6) == 0x6;
-	} else {
-		return false;
+		int regs[4];
+		cpuid(0, regs);
+		const int maxLeaf = regs[0];
+
+		cpuid(1, regs);
+		const bool osUsesXSAVE = (regs[2] & (1 << 27)) != 0;
+		const bool cpuAVX = (regs[2] & (1 << 28)) != 0;
+		const bool cpuFMA = (regs[2] & (1 << 12)) != 0;
+
+		// The OS also needs to be saving the YMM registers on context switches
+		if (!osUsesXSAVE || !cpuAVX || (getXCR0() & 0x6) != 0x6) {
+			return result;
+		}
+		result.avx = true;
+
+		if (maxLeaf >= 7) {
+			cpuid(7, regs);
+			result.avx2 = cpuFMA && (regs[1] & (1 << 5)) != 0;
+		}
+
+		return result;
 	}
-#else
-	return false;
-#endif
 }
+
 #endif
 
 std::unique_ptr<AudioMixer> AudioMixer::makeMixer()
 {
-#ifdef HAS_AVX
-	if (hasAVX()) {
+#if defined(HAS_AVX)
+	const auto features = getCPUFeatures();
+	if (features.avx2) {
+		return std::make_unique<AudioMixerAVX2>();
+	} else if (features.avx) {
 		return std::make_unique<AudioMixerAVX>();
 	} else {
 		return std::make_unique<AudioMixerSSE>();
 	}
-#elif HAS_SEE
+#elif defined(HAS_SSE)
 	return std::make_unique<AudioMixerSSE>();
+#elif defined(HAS_NEON)
+	return std::make_unique<AudioMixerNEON>();
 #else
 	return std::make_unique<AudioMixer>();
 #endif
 }
+
+std::vector<String> AudioMixer::getAvailableMixers()
+{
+	std::vector<String> result = { "scalar" };
+#if defined(HAS_SSE)
+	result.push_back("sse");
+#endif
+#if defined(HAS_AVX)
+	const auto features = getCPUFeatures();
+	if (features.avx) {
+		result.push_back("avx");
+	}
+	if (features.avx2) {
+		result.push_back("avx2");
+	}
+#endif
+#if defined(HAS_NEON)
+	result.push_back("neon");
+#endif
+	return result;
+}
+
+std::unique_ptr<AudioMixer> AudioMixer::makeMixer(const String& name)
+{
+	const auto available = getAvailableMixers();
+	if (std::find(available.begin(), available.end(), name) == available.end()) {
+		throw Exception("Audio mixer \"" + name + "\" is not available on this CPU.", HalleyExceptions::AudioEngine);
+	}
+
+	if (name == "scalar") {
+		return std::make_unique<AudioMixer>();
+	}
+#if defined(HAS_SSE)
+	if (name == "sse") {
+		return std::make_unique<AudioMixerSSE>();
+	}
+#endif
+#if defined(HAS_AVX)
+	if (name == "avx") {
+		return std::make_unique<AudioMixerAVX>();
+	}
+	if (name == "avx2") {
+		return std::make_unique<AudioMixerAVX2>();
+	}
+#endif
+#if defined(HAS_NEON)
+	if (name == "neon") {
+		return std::make_unique<AudioMixerNEON>();
+	}
+#endif
+	return std::make_unique<AudioMixer>();
+}
@@ -2,21 +2,40 @@
 #include <gsl/span>
 #include "halley/core/api/audio_api.h"
 #include "audio_buffer.h"
+#include <vector>
 
 #if defined(_M_X64) || defined(__x86_64__)
 #define HAS_SSE
-#if !defined(__linux__)
 #define HAS_AVX
 #endif
-#endif
 
 #if defined(_M_IX86) || defined(__i386)
 // Might not be available, but do we really care about such old processors?
 #define HAS_SSE
 #endif
 
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+// Part of the baseline on all the ARM platforms we ship on, so it doesn't need checking at runtime
+#define HAS_NEON
+#endif
+
 namespace Halley
 {
+	struct AudioBiquadCoefficients
+	{
+		float b0 = 1.0f;
+		float b1 = 0.0f;
+		float b2 = 0.0f;
+		float a1 = 0.0f;
+		float a2 = 0.0f;
+	};
+
+	struct AudioBiquadState
+	{
+		float z1 = 0.0f;
+		float z2 = 0.0f;
+	};
+
 	class AudioMixer
 	{
 	public:
@@ -25,6 +44,19 @@ namespace Halley
 		virtual void mixAudio(gsl::span<const AudioSamplePack> src, gsl::span<AudioSamplePack> dst, float gainStart, float gainEnd);
 		virtual void interleaveChannels(gsl::span<AudioSamplePack> dst, gsl::span<AudioBuffer*> src);
 		virtual void compressRange(gsl::span<AudioSamplePack> buffer);
+
+		// DSP for the bus effects
+		virtual void scaleAudio(gsl::span<AudioSamplePack> dst, float gainStart, float gainEnd);
+		virtual float getPeak(gsl::span<const AudioSamplePack> src);
+
+		// Filters the first numPacks of each buffer in place, with one state per buffer
+		virtual void filterBiquad(gsl::span<AudioBuffer*> buffers, size_t numPacks, const AudioBiquadCoefficients& coefficients, gsl::span<AudioBiquadState> state);
+
+		// The fastest one this CPU supports
 		static std::unique_ptr<AudioMixer> makeMixer();
+
+		// Every variant this CPU supports, slowest first, mostly so they can be compared against each other
+		static std::vector<String> getAvailableMixers();
+		static std::unique_ptr<AudioMixer> makeMixer(const String& name);
 	};
 }
@@ -2,10 +2,7 @@
 
 #ifdef HAS_AVX
 #include <xmmintrin.h>
-
-#ifdef __clang__
 #include <immintrin.h>
-#endif
 
 #ifdef _MSC_VER
 #include <intrin.h>
@@ -13,49 +10,117 @@
 
 using namespace Halley;
 
+// The packs are declared as 64-byte aligned, but std::vector's allocator only guarantees 16 bytes before C++17,
+// so everything here uses unaligned loads and stores. They're just as fast when the data does happen to be aligned.
+
 void AudioMixerAVX::mixAudio(gsl::span<const AudioSamplePack> srcRaw, gsl::span<AudioSamplePack> dstRaw, float gain0, float gain1)
 {
-	gsl::span<const __m256> src(reinterpret_cast<const __m256*>(srcRaw.data()), srcRaw.size() * 2);
-	gsl::span<__m256> dst(reinterpret_cast<__m256*>(dstRaw.data()), dstRaw.size() * 2);
-	const size_t nSamples = size_t(src.size());
+	const float* src = reinterpret_cast<const float*>(srcRaw.data());
+	float* dst = reinterpret_cast<float*>(dstRaw.data());
+	const size_t nSamples = size_t(srcRaw.size()) * AudioSamplePack::NumSamples;
 
 	if (gain0 == gain1) {
-		__m256 gain = _mm256_broadcast_ss(&gain0);
-		for (size_t i = 0; i < nSamples; i += 2) {
-			dst[i] = _mm256_add_ps(dst[i], _mm256_mul_ps(src[i], gain));
-			dst[i + 1] = _mm256_add_ps(dst[i + 1], _mm256_mul_ps(src[i + 1], gain));
+		const __m256 gain = _mm256_set1_ps(gain0);
+		for (size_t i = 0; i < nSamples; i += 16) {
+			_mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_mul_ps(_mm256_loadu_ps(src + i), gain)));
+			_mm256_storeu_ps(dst + i + 8, _mm256_add_ps(_mm256_loadu_ps(dst + i + 8), _mm256_mul_ps(_mm256_loadu_ps(src + i + 8), gain)));
 		}
 	} else {
-		const float sc = 1.0f / (dst.size() * 16);
-		const float gainDiff = gain1 - gain0;
-		const float eight = 8.0f;
-
-		__m256 gain0p = _mm256_broadcast_ss(&gain0);
-		__m256 gain1p = _mm256_broadcast_ss(&gainDiff);
-		__m256 scale = _mm256_broadcast_ss(&sc);
-		__m256 inc = _mm256_broadcast_ss(&eight);
-		__m256 offset = { 0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f };
-		for (size_t i = 0; i < nSamples; ++i) {
-			__m256 t = _mm256_mul_ps(offset, scale);
-			__m256 gain = _mm256_add_ps(gain0p, _mm256_mul_ps(gain1p, t));
+		const float sc = 1.0f / (dstRaw.size() * AudioSamplePack::NumSamples);
+
+		const __m256 gain0p = _mm256_set1_ps(gain0);
+		const __m256 gain1p = _mm256_set1_ps(gain1 - gain0);
+		const __m256 scale = _mm256_set1_ps(sc);
+		const __m256 inc = _mm256_set1_ps(8.0f);
+		__m256 offset = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+		for (size_t i = 0; i < nSamples; i += 8) {
+			const __m256 t = _mm256_mul_ps(offset, scale);
+			const __m256 gain = _mm256_add_ps(gain0p, _mm256_mul_ps(gain1p, t));
 			offset = _mm256_add_ps(offset, inc);
-			dst[i] = _mm256_add_ps(dst[i], _mm256_mul_ps(src[i], gain));
+			_mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_mul_ps(_mm256_loadu_ps(src + i), gain)));
 		}
 	}
 }
 
+void AudioMixerAVX::interleaveChannels(gsl::span<AudioSamplePack> dstBuffer, gsl::span<AudioBuffer*> srcs)
+{
+	if (srcs.size() != 2) {
+		AudioMixer::interleaveChannels(dstBuffer, srcs);
+		return;
+	}
+
+	const size_t nSamples = size_t(dstBuffer.size()) / 2 * AudioSamplePack::NumSamples;
+	const float* left = reinterpret_cast<const float*>(srcs[0]->packs.data());
+	const float* right = reinterpret_cast<const float*>(srcs[1]->packs.data());
+	float* dst = reinterpret_cast<float*>(dstBuffer.data());
+
+	for (size_t i = 0; i < nSamples; i += 8) {
+		const __m256 l = _mm256_loadu_ps(left + i);
+		const __m256 r = _mm256_loadu_ps(right + i);
+
+		// Unpacking works within each 128-bit half, so the halves need to be swapped around afterwards
+		const __m256 lo = _mm256_unpacklo_ps(l, r); // l0 r0 l1 r1 | l4 r4 l5 r5
+		const __m256 hi = _mm256_unpackhi_ps(l, r); // l2 r2 l3 r3 | l6 r6 l7 r7
+		_mm256_storeu_ps(dst + 2 * i, _mm256_permute2f128_ps(lo, hi, 0x20));
+		_mm256_storeu_ps(dst + 2 * i + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+	}
+}
+
 void AudioMixerAVX::compressRange(gsl::span<AudioSamplePack> buffer)
 {
-	gsl::span<__m256> dst(reinterpret_cast<__m256*>(buffer.data()), buffer.size() * 2);
-	const size_t nSamples = size_t(dst.size());
+	float* dst = reinterpret_cast<float*>(buffer.data());
+	const size_t nSamples = size_t(buffer.size()) * AudioSamplePack::NumSamples;
 
-	float val = 0.99995f;
-	__m256 minVal = { -val, -val, -val, -val, -val, -val, -val, -val };
-	__m256 maxVal = { val, val, val, val, val, val, val, val };
+	const float val = 0.99995f;
+	const __m256 minVal = _mm256_set1_ps(-val);
+	const __m256 maxVal = _mm256_set1_ps(val);
 
-	for (size_t i = 0; i < nSamples; ++i) {
-		dst[i] = _mm256_max_ps(minVal, _mm256_min_ps(dst[i], maxVal));
+	for (size_t i = 0; i < nSamples; i += 8) {
+		_mm256_storeu_ps(dst + i, _mm256_max_ps(minVal, _mm256_min_ps(_mm256_loadu_ps(dst + i), maxVal)));
 	}
 }
 
+void AudioMixerAVX::scaleAudio(gsl::span<AudioSamplePack> dstRaw, float gain0, float gain1)
+{
+	float* dst = reinterpret_cast<float*>(dstRaw.data());
+	const size_t nSamples = size_t(dstRaw.size()) * AudioSamplePack::NumSamples;
+
+	if (gain0 == gain1) {
+		const __m256 gain = _mm256_set1_ps(gain0);
+		for (size_t i = 0; i < nSamples; i += 8) {
+			_mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(dst + i), gain));
+		}
+	} else {
+		const float sc = 1.0f / (dstRaw.size() * AudioSamplePack::NumSamples);
+
+		const __m256 gain0p = _mm256_set1_ps(gain0);
+		const __m256 gain1p = _mm256_set1_ps(gain1 - gain0);
+		const __m256 scale = _mm256_set1_ps(sc);
+		const __m256 inc = _mm256_set1_ps(8.0f);
+		__m256 offset = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+		for (size_t i = 0; i < nSamples; i += 8) {
+			const __m256 gain = _mm256_add_ps(gain0p, _mm256_mul_ps(gain1p, _mm256_mul_ps(offset, scale)));
+			offset = _mm256_add_ps(offset, inc);
+			_mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(dst + i), gain));
+		}
+	}
+}
+
+float AudioMixerAVX::getPeak(gsl::span<const AudioSamplePack> srcRaw)
+{
+	const float* src = reinterpret_cast<const float*>(srcRaw.data());
+	const size_t nSamples = size_t(srcRaw.size()) * AudioSamplePack::NumSamples;
+
+	const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+	__m256 peak = _mm256_setzero_ps();
+	for (size_t i = 0; i < nSamples; i += 8) {
+		peak = _mm256_max_ps(peak, _mm256_and_ps(_mm256_loadu_ps(src + i), absMask));
+	}
+
+	const __m128 half = _mm_max_ps(_mm256_castps256_ps128(peak), _mm256_extractf128_ps(peak, 1));
+	alignas(16) float lanes[4];
+	_mm_store_ps(lanes, half);
+	return std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+}
+
 #endif
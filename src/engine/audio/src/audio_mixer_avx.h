@@ -1,14 +1,19 @@
 #pragma once
-#include "audio_mixer.h"
+#include "audio_mixer_sse.h"
 
 #ifdef HAS_AVX
 namespace Halley
 {
-	class AudioMixerAVX : public AudioMixer
+	// Anything with AVX also has SSE, so whatever isn't worth widening comes from there
+	class AudioMixerAVX : public AudioMixerSSE
 	{
 	public:
 		void mixAudio(gsl::span<const AudioSamplePack> src, gsl::span<AudioSamplePack> dst, float gainStart, float gainEnd) override;
+		void interleaveChannels(gsl::span<AudioSamplePack> dst, gsl::span<AudioBuffer*> src) override;
 		void compressRange(gsl::span<AudioSamplePack> buffer) override;
+
+		void scaleAudio(gsl::span<AudioSamplePack> dst, float gainStart, float gainEnd) override;
+		float getPeak(gsl::span<const AudioSamplePack> src) override;
 	};
 }
 #endif
@@ -0,0 +1,40 @@
+#include "audio_mixer_avx2.h"
+
+#ifdef HAS_AVX
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace Halley;
+
+void AudioMixerAVX2::mixAudio(gsl::span<const AudioSamplePack> srcRaw, gsl::span<AudioSamplePack> dstRaw, float gain0, float gain1)
+{
+	const float* src = reinterpret_cast<const float*>(srcRaw.data());
+	float* dst = reinterpret_cast<float*>(dstRaw.data());
+	const size_t nSamples = size_t(srcRaw.size()) * AudioSamplePack::NumSamples;
+
+	if (gain0 == gain1) {
+		const __m256 gain = _mm256_set1_ps(gain0);
+		for (size_t i = 0; i < nSamples; i += 16) {
+			_mm256_storeu_ps(dst + i, _mm256_fmadd_ps(_mm256_loadu_ps(src + i), gain, _mm256_loadu_ps(dst + i)));
+			_mm256_storeu_ps(dst + i + 8, _mm256_fmadd_ps(_mm256_loadu_ps(src + i + 8), gain, _mm256_loadu_ps(dst + i + 8)));
+		}
+	} else {
+		const float sc = 1.0f / (dstRaw.size() * AudioSamplePack::NumSamples);
+
+		const __m256 gain0p = _mm256_set1_ps(gain0);
+		const __m256 gain1p = _mm256_set1_ps(gain1 - gain0);
+		const __m256 scale = _mm256_set1_ps(sc);
+		const __m256 inc = _mm256_set1_ps(8.0f);
+		__m256 offset = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+		for (size_t i = 0; i < nSamples; i += 8) {
+			const __m256 gain = _mm256_fmadd_ps(gain1p, _mm256_mul_ps(offset, scale), gain0p);
+			offset = _mm256_add_ps(offset, inc);
+			_mm256_storeu_ps(dst + i, _mm256_fmadd_ps(_mm256_loadu_ps(src + i), gain, _mm256_loadu_ps(dst + i)));
+		}
+	}
+}
+
+#endif
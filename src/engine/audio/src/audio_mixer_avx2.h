@@ -0,0 +1,14 @@
+#pragma once
+#include "audio_mixer_avx.h"
+
+#ifdef HAS_AVX
+namespace Halley
+{
+	// AVX2 and FMA, which in practice always come together
+	class AudioMixerAVX2 : public AudioMixerAVX
+	{
+	public:
+		void mixAudio(gsl::span<const AudioSamplePack> src, gsl::span<AudioSamplePack> dst, float gainStart, float gainEnd) override;
+	};
+}
+#endif
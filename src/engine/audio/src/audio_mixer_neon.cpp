@@ -0,0 +1,184 @@
+#include "audio_mixer_neon.h"
+#include <algorithm>
+
+#ifdef HAS_NEON
+#ifdef _MSC_VER
+#include <arm64_neon.h>
+#else
+#include <arm_neon.h>
+#endif
+
+using namespace Halley;
+
+namespace {
+	// Fused on ARMv8, which is also more precise; ARMv7 only has the separate multiply and add
+	inline float32x4_t multiplyAdd(float32x4_t acc, float32x4_t a, float32x4_t b)
+	{
+#if defined(__aarch64__) || defined(_M_ARM64)
+		return vfmaq_f32(acc, a, b);
+#else
+		return vmlaq_f32(acc, a, b);
+#endif
+	}
+}
+
+void AudioMixerNEON::mixAudio(gsl::span<const AudioSamplePack> srcRaw, gsl::span<AudioSamplePack> dstRaw, float gain0, float gain1)
+{
+	const float* src = reinterpret_cast<const float*>(srcRaw.data());
+	float* dst = reinterpret_cast<float*>(dstRaw.data());
+	const size_t nSamples = size_t(srcRaw.size()) * AudioSamplePack::NumSamples;
+
+	if (gain0 == gain1) {
+		const float32x4_t gain = vdupq_n_f32(gain0);
+		for (size_t i = 0; i < nSamples; i += 16) {
+			vst1q_f32(dst + i, multiplyAdd(vld1q_f32(dst + i), vld1q_f32(src + i), gain));
+			vst1q_f32(dst + i + 4, multiplyAdd(vld1q_f32(dst + i + 4), vld1q_f32(src + i + 4), gain));
+			vst1q_f32(dst + i + 8, multiplyAdd(vld1q_f32(dst + i + 8), vld1q_f32(src + i + 8), gain));
+			vst1q_f32(dst + i + 12, multiplyAdd(vld1q_f32(dst + i + 12), vld1q_f32(src + i + 12), gain));
+		}
+	} else {
+		const float sc = 1.0f / (dstRaw.size() * AudioSamplePack::NumSamples);
+		const float offsets[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+
+		const float32x4_t gain0p = vdupq_n_f32(gain0);
+		const float32x4_t gain1p = vdupq_n_f32(gain1 - gain0);
+		const float32x4_t scale = vdupq_n_f32(sc);
+		const float32x4_t inc = vdupq_n_f32(4.0f);
+		float32x4_t offset = vld1q_f32(offsets);
+		for (size_t i = 0; i < nSamples; i += 4) {
+			const float32x4_t gain = multiplyAdd(gain0p, gain1p, vmulq_f32(offset, scale));
+			offset = vaddq_f32(offset, inc);
+			vst1q_f32(dst + i, multiplyAdd(vld1q_f32(dst + i), vld1q_f32(src + i), gain));
+		}
+	}
+}
+
+void AudioMixerNEON::interleaveChannels(gsl::span<AudioSamplePack> dstBuffer, gsl::span<AudioBuffer*> srcs)
+{
+	if (srcs.size() != 2) {
+		AudioMixer::interleaveChannels(dstBuffer, srcs);
+		return;
+	}
+
+	const size_t nSamples = size_t(dstBuffer.size()) / 2 * AudioSamplePack::NumSamples;
+	const float* left = reinterpret_cast<const float*>(srcs[0]->packs.data());
+	const float* right = reinterpret_cast<const float*>(srcs[1]->packs.data());
+	float* dst = reinterpret_cast<float*>(dstBuffer.data());
+
+	for (size_t i = 0; i < nSamples; i += 4) {
+		// Interleaving store, does the whole job in one instruction
+		float32x4x2_t lr;
+		lr.val[0] = vld1q_f32(left + i);
+		lr.val[1] = vld1q_f32(right + i);
+		vst2q_f32(dst + 2 * i, lr);
+	}
+}
+
+void AudioMixerNEON::compressRange(gsl::span<AudioSamplePack> buffer)
+{
+	float* dst = reinterpret_cast<float*>(buffer.data());
+	const size_t nSamples = size_t(buffer.size()) * AudioSamplePack::NumSamples;
+
+	const float val = 0.99995f;
+	const float32x4_t minVal = vdupq_n_f32(-val);
+	const float32x4_t maxVal = vdupq_n_f32(val);
+
+	for (size_t i = 0; i < nSamples; i += 4) {
+		vst1q_f32(dst + i, vmaxq_f32(minVal, vminq_f32(vld1q_f32(dst + i), maxVal)));
+	}
+}
+
+void AudioMixerNEON::scaleAudio(gsl::span<AudioSamplePack> dstRaw, float gain0, float gain1)
+{
+	float* dst = reinterpret_cast<float*>(dstRaw.data());
+	const size_t nSamples = size_t(dstRaw.size()) * AudioSamplePack::NumSamples;
+
+	if (gain0 == gain1) {
+		const float32x4_t gain = vdupq_n_f32(gain0);
+		for (size_t i = 0; i < nSamples; i += 4) {
+			vst1q_f32(dst + i, vmulq_f32(vld1q_f32(dst + i), gain));
+		}
+	} else {
+		const float sc = 1.0f / (dstRaw.size() * AudioSamplePack::NumSamples);
+		const float offsets[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+
+		const float32x4_t gain0p = vdupq_n_f32(gain0);
+		const float32x4_t gain1p = vdupq_n_f32(gain1 - gain0);
+		const float32x4_t scale = vdupq_n_f32(sc);
+		const float32x4_t inc = vdupq_n_f32(4.0f);
+		float32x4_t offset = vld1q_f32(offsets);
+		for (size_t i = 0; i < nSamples; i += 4) {
+			const float32x4_t gain = multiplyAdd(gain0p, gain1p, vmulq_f32(offset, scale));
+			offset = vaddq_f32(offset, inc);
+			vst1q_f32(dst + i, vmulq_f32(vld1q_f32(dst + i), gain));
+		}
+	}
+}
+
+float AudioMixerNEON::getPeak(gsl::span<const AudioSamplePack> srcRaw)
+{
+	const float* src = reinterpret_cast<const float*>(srcRaw.data());
+	const size_t nSamples = size_t(srcRaw.size()) * AudioSamplePack::NumSamples;
+
+	float32x4_t peak = vdupq_n_f32(0.0f);
+	for (size_t i = 0; i < nSamples; i += 4) {
+		peak = vmaxq_f32(peak, vabsq_f32(vld1q_f32(src + i)));
+	}
+
+	float lanes[4];
+	vst1q_f32(lanes, peak);
+	return std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+}
+
+void AudioMixerNEON::filterBiquad(gsl::span<AudioBuffer*> buffers, size_t numPacks, const AudioBiquadCoefficients& c, gsl::span<AudioBiquadState> state)
+{
+	Expects(state.size() >= buffers.size());
+
+	// Each lane is a channel, as the filter depends on its own previous output
+	const float32x4_t b0 = vdupq_n_f32(c.b0);
+	const float32x4_t b1 = vdupq_n_f32(c.b1);
+	const float32x4_t b2 = vdupq_n_f32(c.b2);
+	const float32x4_t a1 = vdupq_n_f32(-c.a1);
+	const float32x4_t a2 = vdupq_n_f32(-c.a2);
+	const size_t nSamples = numPacks * AudioSamplePack::NumSamples;
+	const size_t nChannels = size_t(buffers.size());
+
+	for (size_t first = 0; first < nChannels; first += 4) {
+		const size_t nLanes = std::min(nChannels - first, size_t(4));
+		std::array<float*, 4> samples;
+		float lanes[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		float z1Lanes[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		float z2Lanes[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		for (size_t j = 0; j < nLanes; ++j) {
+			Expects(buffers[first + j]->packs.size() >= numPacks);
+			samples[j] = reinterpret_cast<float*>(buffers[first + j]->packs.data());
+			z1Lanes[j] = state[first + j].z1;
+			z2Lanes[j] = state[first + j].z2;
+		}
+
+		float32x4_t z1 = vld1q_f32(z1Lanes);
+		float32x4_t z2 = vld1q_f32(z2Lanes);
+		for (size_t i = 0; i < nSamples; ++i) {
+			for (size_t j = 0; j < nLanes; ++j) {
+				lanes[j] = samples[j][i];
+			}
+			const float32x4_t x = vld1q_f32(lanes);
+			const float32x4_t y = multiplyAdd(z1, b0, x);
+			z1 = multiplyAdd(multiplyAdd(z2, b1, x), a1, y);
+			z2 = multiplyAdd(vmulq_f32(b2, x), a2, y);
+			vst1q_f32(lanes, y);
+			for (size_t j = 0; j < nLanes; ++j) {
+				samples[j][i] = lanes[j];
+			}
+		}
+
+		vst1q_f32(z1Lanes, z1);
+		vst1q_f32(z2Lanes, z2);
+		for (size_t j = 0; j < nLanes; ++j) {
+			state[first + j].z1 = z1Lanes[j];
+			state[first + j].z2 = z2Lanes[j];
+		}
+	}
+}
+
+#endif
@@ -2,6 +2,7 @@
 
 #ifdef HAS_SSE
 #include <xmmintrin.h>
+#include <emmintrin.h>
 
 #ifdef _MSC_VER
 #include <intrin.h>
@@ -24,7 +25,7 @@ void AudioMixerSSE::mixAudio(gsl::span<const AudioSamplePack> srcRaw, gsl::span<
 			dst[i + 3] = _mm_add_ps(dst[i + 3], _mm_mul_ps(src[i + 3], gain));
 		}
 	} else {
-		const float sc = 1.0f / (dst.size() * 16);
+		const float sc = 1.0f / (dstRaw.size() * AudioSamplePack::NumSamples);
 		const float gainDiff = gain1 - gain0;
 
 		__m128 gain0p = { gain0, gain0, gain0, gain0 };
@@ -41,6 +42,27 @@ void AudioMixerSSE::mixAudio(gsl::span<const AudioSamplePack> srcRaw, gsl::span<
 	}
 }
 
+void AudioMixerSSE::interleaveChannels(gsl::span<AudioSamplePack> dstBuffer, gsl::span<AudioBuffer*> srcs)
+{
+	if (srcs.size() != 2) {
+		AudioMixer::interleaveChannels(dstBuffer, srcs);
+		return;
+	}
+
+	// Every pack of the two sources becomes two packs of the destination
+	const size_t nSrcPacks = size_t(dstBuffer.size()) / 2;
+	const float* left = reinterpret_cast<const float*>(srcs[0]->packs.data());
+	const float* right = reinterpret_cast<const float*>(srcs[1]->packs.data());
+	float* dst = reinterpret_cast<float*>(dstBuffer.data());
+
+	for (size_t i = 0; i < nSrcPacks * AudioSamplePack::NumSamples; i += 4) {
+		const __m128 l = _mm_load_ps(left + i);
+		const __m128 r = _mm_load_ps(right + i);
+		_mm_store_ps(dst + 2 * i, _mm_unpacklo_ps(l, r));
+		_mm_store_ps(dst + 2 * i + 4, _mm_unpackhi_ps(l, r));
+	}
+}
+
 void AudioMixerSSE::compressRange(gsl::span<AudioSamplePack> buffer)
 {
 	gsl::span<__m128> dst(reinterpret_cast<__m128*>(buffer.data()), buffer.size() * 4);
@@ -55,4 +77,97 @@ void AudioMixerSSE::compressRange(gsl::span<AudioSamplePack> buffer)
 	}
 }
 
+void AudioMixerSSE::scaleAudio(gsl::span<AudioSamplePack> dstRaw, float gain0, float gain1)
+{
+	gsl::span<__m128> dst(reinterpret_cast<__m128*>(dstRaw.data()), dstRaw.size() * 4);
+	const size_t nSamples = size_t(dst.size());
+
+	if (gain0 == gain1) {
+		const __m128 gain = _mm_set1_ps(gain0);
+		for (size_t i = 0; i < nSamples; ++i) {
+			dst[i] = _mm_mul_ps(dst[i], gain);
+		}
+	} else {
+		const float sc = 1.0f / (dstRaw.size() * AudioSamplePack::NumSamples);
+		const __m128 gain0p = _mm_set1_ps(gain0);
+		const __m128 gain1p = _mm_set1_ps(gain1 - gain0);
+		const __m128 scale = _mm_set1_ps(sc);
+		const __m128 inc = _mm_set1_ps(4.0f);
+		__m128 offset = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+		for (size_t i = 0; i < nSamples; ++i) {
+			const __m128 gain = _mm_add_ps(_mm_mul_ps(gain1p, _mm_mul_ps(offset, scale)), gain0p);
+			offset = _mm_add_ps(offset, inc);
+			dst[i] = _mm_mul_ps(dst[i], gain);
+		}
+	}
+}
+
+float AudioMixerSSE::getPeak(gsl::span<const AudioSamplePack> srcRaw)
+{
+	gsl::span<const __m128> src(reinterpret_cast<const __m128*>(srcRaw.data()), srcRaw.size() * 4);
+	const size_t nSamples = size_t(src.size());
+
+	// Clearing the sign bit is the absolute value
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	__m128 peak = _mm_setzero_ps();
+	for (size_t i = 0; i < nSamples; ++i) {
+		peak = _mm_max_ps(peak, _mm_and_ps(src[i], absMask));
+	}
+
+	alignas(16) float lanes[4];
+	_mm_store_ps(lanes, peak);
+	return std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+}
+
+void AudioMixerSSE::filterBiquad(gsl::span<AudioBuffer*> buffers, size_t numPacks, const AudioBiquadCoefficients& c, gsl::span<AudioBiquadState> state)
+{
+	Expects(state.size() >= buffers.size());
+
+	// The filter feeds back on itself sample by sample, so instead of across samples, it runs across channels: each lane is a channel
+	const __m128 b0 = _mm_set1_ps(c.b0);
+	const __m128 b1 = _mm_set1_ps(c.b1);
+	const __m128 b2 = _mm_set1_ps(c.b2);
+	const __m128 a1 = _mm_set1_ps(c.a1);
+	const __m128 a2 = _mm_set1_ps(c.a2);
+	const size_t nSamples = numPacks * AudioSamplePack::NumSamples;
+	const size_t nChannels = size_t(buffers.size());
+
+	for (size_t first = 0; first < nChannels; first += 4) {
+		const size_t nLanes = std::min(nChannels - first, size_t(4));
+		std::array<float*, 4> samples;
+		alignas(16) float lanes[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		alignas(16) float z1Lanes[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		alignas(16) float z2Lanes[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		for (size_t j = 0; j < nLanes; ++j) {
+			Expects(buffers[first + j]->packs.size() >= numPacks);
+			samples[j] = reinterpret_cast<float*>(buffers[first + j]->packs.data());
+			z1Lanes[j] = state[first + j].z1;
+			z2Lanes[j] = state[first + j].z2;
+		}
+
+		__m128 z1 = _mm_load_ps(z1Lanes);
+		__m128 z2 = _mm_load_ps(z2Lanes);
+		for (size_t i = 0; i < nSamples; ++i) {
+			for (size_t j = 0; j < nLanes; ++j) {
+				lanes[j] = samples[j][i];
+			}
+			const __m128 x = _mm_load_ps(lanes);
+			const __m128 y = _mm_add_ps(_mm_mul_ps(b0, x), z1);
+			z1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1, x), _mm_mul_ps(a1, y)), z2);
+			z2 = _mm_sub_ps(_mm_mul_ps(b2, x), _mm_mul_ps(a2, y));
+			_mm_store_ps(lanes, y);
+			for (size_t j = 0; j < nLanes; ++j) {
+				samples[j][i] = lanes[j];
+			}
+		}
+
+		_mm_store_ps(z1Lanes, z1);
+		_mm_store_ps(z2Lanes, z2);
+		for (size_t j = 0; j < nLanes; ++j) {
+			state[first + j].z1 = z1Lanes[j];
+			state[first + j].z2 = z2Lanes[j];
+		}
+	}
+}
+
 #endif
@@ -8,7 +8,12 @@ namespace Halley
 	{
 	public:
 		void mixAudio(gsl::span<const AudioSamplePack> src, gsl::span<AudioSamplePack> dst, float gainStart, float gainEnd) override;
+		void interleaveChannels(gsl::span<AudioSamplePack> dst, gsl::span<AudioBuffer*> src) override;
 		void compressRange(gsl::span<AudioSamplePack> buffer) override;
+
+		void scaleAudio(gsl::span<AudioSamplePack> dst, float gainStart, float gainEnd) override;
+		float getPeak(gsl::span<const AudioSamplePack> src) override;
+		void filterBiquad(gsl::span<AudioBuffer*> buffers, size_t numPacks, const AudioBiquadCoefficients& coefficients, gsl::span<AudioBiquadState> state) override;
 	};
 }
 #endif
@@ -82,6 +82,11 @@ void AudioPosition::setPosition(Vector3f position)
 	}
 }
 
+const AudioPosition::SpatialSource* AudioPosition::getSingleSpatialSource() const
+{
+	return isPannable && !isUI && sources.size() == 1 ? &sources[0] : nullptr;
+}
+
 static float gain2DPan(float srcPan, float dstPan)
 {
 	constexpr float piOverTwo = 3.1415926535897932384626433832795f / 2.0f;
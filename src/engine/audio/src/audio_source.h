@@ -15,5 +15,8 @@ namespace Halley
 		virtual size_t getNumberOfChannels() const = 0;
 		virtual bool isReady() const { return true; }
 		virtual bool getAudioData(size_t numSamples, AudioSourceData& dst) = 0;
+
+		// Moves playback forward as if getAudioData had been called, without producing anything
+		virtual bool skipAudioData(size_t numSamples) = 0;
 	};
 }
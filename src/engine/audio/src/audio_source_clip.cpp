@@ -93,3 +93,24 @@ bool AudioSourceClip::getAudioData(size_t samplesRequested, AudioSourceData& dst
 
 	return isPlaying;
 }
+
+bool AudioSourceClip::skipAudioData(size_t numSamples)
+{
+	const auto playbackLength = int64_t(clip->getLength());
+	playbackPos += int64_t(numSamples);
+
+	if (looping) {
+		const auto loopPoint = int64_t(clip->getLoopPoint());
+		if (loopPoint >= playbackLength) {
+			looping = false;
+		} else if (playbackPos >= playbackLength) {
+			playbackPos = loopPoint + (playbackPos - playbackLength) % (playbackLength - loopPoint);
+		}
+	}
+
+	if (!looping && playbackPos >= playbackLength) {
+		playbackPos = playbackLength;
+		return false;
+	}
+	return true;
+}
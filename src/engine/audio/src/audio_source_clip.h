@@ -10,6 +10,7 @@ namespace Halley
 
 		size_t getNumberOfChannels() const override;
 		bool getAudioData(size_t numSamples, AudioSourceData& dst) override;
+		bool skipAudioData(size_t numSamples) override;
 		bool isReady() const override;
 
 	private:
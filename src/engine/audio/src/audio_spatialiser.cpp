@@ -0,0 +1,221 @@
+#include "audio_spatialiser.h"
+#include "audio_mixer.h"
+#include "halley/utils/utils.h"
+#include <cmath>
+
+#if defined(HAS_SSE)
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#elif defined(HAS_NEON)
+#ifdef _MSC_VER
+#include <arm64_neon.h>
+#else
+#include <arm_neon.h>
+#endif
+#endif
+
+using namespace Halley;
+
+namespace {
+	constexpr float piOverTwo = 3.1415926535897932384626433832795f / 2.0f;
+
+	// Taylor series up to x^9, good to a few millionths over 0 to pi/2, which is all we need
+	constexpr float sinC3 = -1.0f / 6.0f;
+	constexpr float sinC5 = 1.0f / 120.0f;
+	constexpr float sinC7 = -1.0f / 5040.0f;
+	constexpr float sinC9 = 1.0f / 362880.0f;
+
+	inline float sinApprox(float x)
+	{
+		const float x2 = x * x;
+		return x * (1.0f + x2 * (sinC3 + x2 * (sinC5 + x2 * (sinC7 + x2 * sinC9))));
+	}
+
+#if defined(HAS_SSE)
+	inline __m128 sinApprox(__m128 x)
+	{
+		const __m128 x2 = _mm_mul_ps(x, x);
+		__m128 r = _mm_add_ps(_mm_set1_ps(sinC7), _mm_mul_ps(x2, _mm_set1_ps(sinC9)));
+		r = _mm_add_ps(_mm_set1_ps(sinC5), _mm_mul_ps(x2, r));
+		r = _mm_add_ps(_mm_set1_ps(sinC3), _mm_mul_ps(x2, r));
+		r = _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(x2, r));
+		return _mm_mul_ps(x, r);
+	}
+
+	inline __m128 clampPs(__m128 x, __m128 lo, __m128 hi)
+	{
+		return _mm_max_ps(lo, _mm_min_ps(x, hi));
+	}
+#elif defined(HAS_NEON)
+	inline float32x4_t sinApprox(float32x4_t x)
+	{
+		const float32x4_t x2 = vmulq_f32(x, x);
+		float32x4_t r = vmlaq_f32(vdupq_n_f32(sinC7), x2, vdupq_n_f32(sinC9));
+		r = vmlaq_f32(vdupq_n_f32(sinC5), x2, r);
+		r = vmlaq_f32(vdupq_n_f32(sinC3), x2, r);
+		r = vmlaq_f32(vdupq_n_f32(1.0f), x2, r);
+		return vmulq_f32(x, r);
+	}
+
+	inline float32x4_t clampPs(float32x4_t x, float32x4_t lo, float32x4_t hi)
+	{
+		return vmaxq_f32(lo, vminq_f32(x, hi));
+	}
+#endif
+}
+
+void AudioSpatialiser::clear()
+{
+	posX.clear();
+	posY.clear();
+	posZ.clear();
+	referenceDistance.clear();
+	invDistanceRange.clear();
+	gains.clear();
+	dsts.clear();
+}
+
+void AudioSpatialiser::add(const AudioPosition::SpatialSource& source, float gain, gsl::span<float, 16> dst)
+{
+	posX.push_back(source.pos.x);
+	posY.push_back(source.pos.y);
+	posZ.push_back(source.pos.z);
+	referenceDistance.push_back(source.referenceDistance);
+	invDistanceRange.push_back(1.0f / (source.maxDistance - source.referenceDistance));
+	gains.push_back(gain);
+	dsts.push_back(dst.data());
+}
+
+void AudioSpatialiser::run(gsl::span<const AudioChannelData> channels, const AudioListenerData& listener)
+{
+	const size_t n = dsts.size();
+	if (n == 0) {
+		return;
+	}
+
+	// Silent padding, so every batch is full
+	const size_t padded = alignUp(n, laneCount);
+	posX.resize(padded, 0.0f);
+	posY.resize(padded, 0.0f);
+	posZ.resize(padded, 0.0f);
+	referenceDistance.resize(padded, 1.0f);
+	invDistanceRange.resize(padded, 1.0f);
+	gains.resize(padded, 0.0f);
+	pans.resize(padded);
+	levels.resize(padded);
+
+	computeLevels(padded, listener);
+	for (size_t j = 0; j < size_t(channels.size()); ++j) {
+		computeChannel(padded, j, channels[j]);
+	}
+}
+
+void AudioSpatialiser::computeLevels(size_t n, const AudioListenerData& listener)
+{
+	const float invListenerReference = 1.0f / listener.referenceDistance;
+
+#if defined(HAS_SSE)
+	const __m128 lx = _mm_set1_ps(listener.position.x);
+	const __m128 ly = _mm_set1_ps(listener.position.y);
+	const __m128 lz = _mm_set1_ps(listener.position.z);
+	const __m128 invRef = _mm_set1_ps(invListenerReference);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 minusOne = _mm_set1_ps(-1.0f);
+
+	for (size_t i = 0; i < n; i += laneCount) {
+		const __m128 dx = _mm_sub_ps(_mm_loadu_ps(posX.data() + i), lx);
+		const __m128 dy = _mm_sub_ps(_mm_loadu_ps(posY.data() + i), ly);
+		const __m128 dz = _mm_sub_ps(_mm_loadu_ps(posZ.data() + i), lz);
+		const __m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+		const __m128 t = _mm_mul_ps(_mm_sub_ps(distance, _mm_loadu_ps(referenceDistance.data() + i)), _mm_loadu_ps(invDistanceRange.data() + i));
+		const __m128 proximity = _mm_sub_ps(one, clampPs(t, zero, one));
+		_mm_storeu_ps(pans.data() + i, clampPs(_mm_mul_ps(dx, invRef), minusOne, one));
+		_mm_storeu_ps(levels.data() + i, _mm_mul_ps(proximity, _mm_loadu_ps(gains.data() + i)));
+	}
+#elif defined(HAS_NEON)
+	const float32x4_t lx = vdupq_n_f32(listener.position.x);
+	const float32x4_t ly = vdupq_n_f32(listener.position.y);
+	const float32x4_t lz = vdupq_n_f32(listener.position.z);
+	const float32x4_t invRef = vdupq_n_f32(invListenerReference);
+	const float32x4_t zero = vdupq_n_f32(0.0f);
+	const float32x4_t one = vdupq_n_f32(1.0f);
+	const float32x4_t minusOne = vdupq_n_f32(-1.0f);
+
+	for (size_t i = 0; i < n; i += laneCount) {
+		const float32x4_t dx = vsubq_f32(vld1q_f32(posX.data() + i), lx);
+		const float32x4_t dy = vsubq_f32(vld1q_f32(posY.data() + i), ly);
+		const float32x4_t dz = vsubq_f32(vld1q_f32(posZ.data() + i), lz);
+		const float32x4_t squared = vmlaq_f32(vmlaq_f32(vmulq_f32(dx, dx), dy, dy), dz, dz);
+
+		// No vector square root on ARMv7, so go through the reciprocal estimate, refined twice
+		float32x4_t invSqrt = vrsqrteq_f32(vmaxq_f32(squared, vdupq_n_f32(1e-12f)));
+		invSqrt = vmulq_f32(invSqrt, vrsqrtsq_f32(vmulq_f32(squared, invSqrt), invSqrt));
+		invSqrt = vmulq_f32(invSqrt, vrsqrtsq_f32(vmulq_f32(squared, invSqrt), invSqrt));
+		const float32x4_t distance = vmulq_f32(squared, invSqrt);
+
+		const float32x4_t t = vmulq_f32(vsubq_f32(distance, vld1q_f32(referenceDistance.data() + i)), vld1q_f32(invDistanceRange.data() + i));
+		const float32x4_t proximity = vsubq_f32(one, clampPs(t, zero, one));
+		vst1q_f32(pans.data() + i, clampPs(vmulq_f32(dx, invRef), minusOne, one));
+		vst1q_f32(levels.data() + i, vmulq_f32(proximity, vld1q_f32(gains.data() + i)));
+	}
+#else
+	for (size_t i = 0; i < n; ++i) {
+		const float dx = posX[i] - listener.position.x;
+		const float dy = posY[i] - listener.position.y;
+		const float dz = posZ[i] - listener.position.z;
+		const float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+		const float proximity = 1.0f - clamp((distance - referenceDistance[i]) * invDistanceRange[i], 0.0f, 1.0f);
+		pans[i] = clamp(dx * invListenerReference, -1.0f, 1.0f);
+		levels[i] = proximity * gains[i];
+	}
+#endif
+}
+
+void AudioSpatialiser::computeChannel(size_t n, size_t channel, const AudioChannelData& data)
+{
+	const size_t nEmitters = dsts.size();
+
+#if defined(HAS_SSE)
+	const __m128 dstPan = _mm_set1_ps(data.pan);
+	const __m128 channelGain = _mm_set1_ps(data.gain);
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 angleScale = _mm_set1_ps(piOverTwo);
+	alignas(16) float result[laneCount];
+
+	for (size_t i = 0; i < n; i += laneCount) {
+		const __m128 panDistance = _mm_and_ps(_mm_sub_ps(_mm_loadu_ps(pans.data() + i), dstPan), absMask);
+		const __m128 angle = _mm_mul_ps(_mm_max_ps(_mm_setzero_ps(), _mm_sub_ps(one, _mm_mul_ps(half, panDistance))), angleScale);
+		_mm_store_ps(result, _mm_mul_ps(_mm_mul_ps(sinApprox(angle), _mm_loadu_ps(levels.data() + i)), channelGain));
+
+		for (size_t k = 0; k < laneCount && i + k < nEmitters; ++k) {
+			dsts[i + k][channel] = result[k];
+		}
+	}
+#elif defined(HAS_NEON)
+	const float32x4_t dstPan = vdupq_n_f32(data.pan);
+	const float32x4_t channelGain = vdupq_n_f32(data.gain);
+	const float32x4_t half = vdupq_n_f32(0.5f);
+	const float32x4_t one = vdupq_n_f32(1.0f);
+	const float32x4_t angleScale = vdupq_n_f32(piOverTwo);
+	float result[laneCount];
+
+	for (size_t i = 0; i < n; i += laneCount) {
+		const float32x4_t panDistance = vabdq_f32(vld1q_f32(pans.data() + i), dstPan);
+		const float32x4_t angle = vmulq_f32(vmaxq_f32(vdupq_n_f32(0.0f), vmlsq_f32(one, half, panDistance)), angleScale);
+		vst1q_f32(result, vmulq_f32(vmulq_f32(sinApprox(angle), vld1q_f32(levels.data() + i)), channelGain));
+
+		for (size_t k = 0; k < laneCount && i + k < nEmitters; ++k) {
+			dsts[i + k][channel] = result[k];
+		}
+	}
+#else
+	for (size_t i = 0; i < nEmitters; ++i) {
+		const float panDistance = std::abs(pans[i] - data.pan);
+		const float angle = std::max(0.0f, 1.0f - 0.5f * panDistance) * piOverTwo;
+		dsts[i][channel] = sinApprox(angle) * levels[i] * data.gain;
+	}
+#endif
+}
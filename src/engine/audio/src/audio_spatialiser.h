@@ -0,0 +1,36 @@
+#pragma once
+#include "halley/audio/audio_position.h"
+#include "halley/core/api/audio_api.h"
+#include "halley/data_structures/vector.h"
+
+namespace Halley
+{
+	// Computes the mix of every mono emitter at a single point in the world in one go, a few at a time with SIMD.
+	// Gets the same results as AudioPosition::setMix, give or take the rounding of a polynomial sine.
+	class AudioSpatialiser
+	{
+	public:
+		void clear();
+		void add(const AudioPosition::SpatialSource& source, float gain, gsl::span<float, 16> dst);
+		void run(gsl::span<const AudioChannelData> channels, const AudioListenerData& listener);
+
+	private:
+		constexpr static size_t laneCount = 4;
+
+		// One entry per emitter, padded to a whole number of lanes when running
+		Vector<float> posX;
+		Vector<float> posY;
+		Vector<float> posZ;
+		Vector<float> referenceDistance;
+		Vector<float> invDistanceRange;
+		Vector<float> gains;
+		Vector<float*> dsts;
+
+		// Results, gain before panning
+		Vector<float> pans;
+		Vector<float> levels;
+
+		void computeLevels(size_t n, const AudioListenerData& listener);
+		void computeChannel(size_t n, size_t channel, const AudioChannelData& data);
+	};
+}
@@ -25,6 +25,8 @@
 #include "ogg/ogg.h"
 #include "halley/support/exception.h"
 #include "halley/resources/resource_data.h"
+#include "halley/support/profiler.h"
+#include <atomic>
 
 #ifdef WITH_IVORBIS
 	#include "ivorbiscodec.h"
@@ -104,11 +106,23 @@ void Halley::VorbisData::reset()
 	open();
 }
 
+namespace {
+	std::atomic<int64_t> totalDecodeTime(0);
+}
+
+int64_t VorbisData::getTotalDecodeTime()
+{
+	return totalDecodeTime.load(std::memory_order_relaxed);
+}
+
 size_t Halley::VorbisData::read(gsl::span<std::vector<float>> dst)
 {
 	Expects(file);
 	Expects(dst.size() == getNumChannels());
 
+	Profiler::Scope profile("VorbisData::read", ProfilerEventType::Audio);
+	const int64_t startTime = Profiler::getTimeNs();
+
 	int bitstream;
 	size_t nChannels = getNumChannels();
 	size_t totalRead = 0;
@@ -131,6 +145,8 @@ size_t Halley::VorbisData::read(gsl::span<std::vector<float>> dst)
 			onVorbisError(nRead);
 		}
 	}
+
+	totalDecodeTime.fetch_add(Profiler::getTimeNs() - startTime, std::memory_order_relaxed);
 	return totalRead;
 }
 
@@ -7,6 +7,7 @@
 #include "halley/text/halleystring.h"
 #include "halley/maths/vector2.h"
 #include "halley/maths/vector3.h"
+#include "halley/time/time_histogram.h"
 #include <memory>
 
 namespace Halley
@@ -63,6 +64,7 @@ namespace Halley
 		int numChannels;
 		int bufferSize;
 		AudioSampleFormat format;
+		bool lowLatency = false; // See AudioAPI::setLowLatency; outputs that don't support it return false
 
 		AudioSpec() {}
 		AudioSpec(int sampleRate, int numChannels, int bufferSize, AudioSampleFormat format)
@@ -93,6 +95,98 @@ namespace Halley
 		float gain = 1.0f;
 	};
 
+	enum class AudioEffectType
+	{
+		LowPass,
+		HighPass,
+		Compressor,
+		Reverb
+	};
+
+	// Effects run on everything mixed into a group, before it's mixed into its parent group
+	struct AudioEffectParameters
+	{
+		AudioEffectType type = AudioEffectType::LowPass;
+
+		// Low and high pass
+		float frequency = 1000.0f; // Hz
+		float resonance = 0.7071f; // Q
+
+		// Compressor. Keyed from another group, it ducks this one whenever that one is loud.
+		float threshold = -12.0f; // dB
+		float ratio = 4.0f;
+		float attack = 0.01f; // seconds
+		float release = 0.2f; // seconds
+		String sidechainGroup;
+
+		// Reverb
+		float roomSize = 0.5f; // 0 to 1
+		float damping = 0.5f; // 0 to 1
+		float wet = 0.3f; // 0 to 1
+
+		static AudioEffectParameters lowPass(float frequency, float resonance = 0.7071f)
+		{
+			AudioEffectParameters result;
+			result.type = AudioEffectType::LowPass;
+			result.frequency = frequency;
+			result.resonance = resonance;
+			return result;
+		}
+
+		static AudioEffectParameters highPass(float frequency, float resonance = 0.7071f)
+		{
+			AudioEffectParameters result;
+			result.type = AudioEffectType::HighPass;
+			result.frequency = frequency;
+			result.resonance = resonance;
+			return result;
+		}
+
+		static AudioEffectParameters compressor(float threshold, float ratio, String sidechainGroup = "")
+		{
+			AudioEffectParameters result;
+			result.type = AudioEffectType::Compressor;
+			result.threshold = threshold;
+			result.ratio = ratio;
+			result.sidechainGroup = std::move(sidechainGroup);
+			return result;
+		}
+
+		static AudioEffectParameters reverb(float roomSize, float damping, float wet)
+		{
+			AudioEffectParameters result;
+			result.type = AudioEffectType::Reverb;
+			result.roomSize = roomSize;
+			result.damping = damping;
+			result.wet = wet;
+			return result;
+		}
+	};
+
+	struct AudioGroupStats
+	{
+		String name;
+		float effectsTime = 0.0f; // Seconds spent on its effects, per buffer
+	};
+
+	// Averages are over the last report, which the audio thread sends a few times a second
+	struct AudioStats
+	{
+		float bufferDuration = 0.0f; // Seconds of audio in each buffer
+		float averageMixTime = 0.0f; // Seconds spent generating each buffer
+		float maxMixTime = 0.0f;
+		TimeHistogramStats mixTimeRecent; // In nanoseconds, over the last few seconds
+		TimeHistogramStats mixTimeTotal; // In nanoseconds, since playback started
+		float decodeTime = 0.0f; // Seconds spent decoding per second of audio, on any thread
+		size_t buffersMixed = 0; // Totals since playback started
+		size_t lateBuffers = 0; // Took longer to generate than they last
+		size_t underruns = 0; // The output ran out of audio to play
+		float outputLatency = 0.0f; // Seconds from a buffer being mixed to it reaching the device, not counting the driver
+		size_t activeVoices = 0;
+		size_t virtualVoices = 0;
+		std::vector<AudioGroupStats> groups;
+	};
+
 	using AudioCallback = std::function<void()>;
 
 	class AudioOutputAPI
@@ -111,6 +205,12 @@ namespace Halley
 		virtual bool needsMoreAudio() = 0;
 
 		virtual bool needsAudioThread() const = 0;
+
+		// How many times it had to play silence because nothing was queued in time
+		virtual size_t getUnderrunCount() const { return 0; }
+
+		// Low latency mode only: needsMoreAudio should keep asking for audio until this many sample frames are queued
+		virtual void setTargetLatency(size_t frames) {}
 	};
 
 	class IAudioHandle
@@ -140,6 +240,10 @@ namespace Halley
 		virtual void pausePlayback() = 0;
 		virtual void resumePlayback() = 0;
 
+		// Opens the device with much smaller buffers, and has the audio thread mix just ahead of it, backing off when it
+		// underruns. Meant for games that need audio to follow input closely. Takes effect the next time playback starts.
+		virtual void setLowLatency(bool enabled) = 0;
+
 		virtual AudioHandle postEvent(const String& name, AudioPosition position) = 0;
 
 		virtual AudioHandle play(std::shared_ptr<const IAudioClip> clip, AudioPosition position, float volume = 1.0f, bool loop = false) = 0;
@@ -150,8 +254,23 @@ namespace Halley
 
 		virtual void setMasterVolume(float gain = 1.0f) = 0;
 		virtual void setGroupVolume(const String& groupName, float gain = 1.0f) = 0;
+
+		// Groups are buses: each one mixes into its parent, and the root one ("") goes to the output.
+		// Effects set on a group run once on its whole mix, so they cost the same however many sounds play through it.
+		virtual void setGroupParent(const String& groupName, const String& parentName = "") = 0;
+		virtual void addGroupEffect(const String& groupName, AudioEffectParameters effect) = 0;
+		virtual void clearGroupEffects(const String& groupName) = 0;
+
 		virtual void setOutputChannels(std::vector<AudioChannelData> audioChannelData) = 0;
 
 		virtual void setListener(AudioListenerData listener) = 0;
+
+		// Only the loudest emitters up to this many are actually mixed; the rest keep playing silently
+		virtual void setMaxVoices(size_t maxVoices) = 0;
+
+		// How much memory can be spent keeping clips decoded after they've played
+		virtual void setDecodedAudioBudget(size_t bytes) = 0;
+
+		virtual AudioStats getStats() const = 0;
 	};
 }
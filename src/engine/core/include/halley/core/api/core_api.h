@@ -4,18 +4,23 @@
 #include "halley/core/game/environment.h"
 #include "halley/time/stopwatch.h"
 #include <cstdint>
+#include <functional>
+#include <memory>
 
 namespace Halley
 {
 	class Resources;
 	class Stage;
 	class HalleyStatics;
+	class TextureStreamer;
 
 	enum class CoreAPITimer
 	{
 		Engine,
 		Game,
-		Vsync
+		Vsync,
+		GPU, // Only measured if the video backend supports it, and lags a few frames behind
+		Audio // Mixing each buffer, on the audio thread; ignores the timeline
 	};
 
 	class CoreAPI
@@ -25,14 +30,26 @@ namespace Halley
 		virtual void quit(int exitCode = 0) = 0;
 		virtual void setStage(StageID stage) = 0;
 		virtual void setStage(std::unique_ptr<Stage> stage) = 0;
+
+		// The stage is made and prepared (see Stage::prepare) on a worker thread, then preloaded, while the current
+		// stage keeps running. The switch itself happens on the main thread, once all of that is done.
+		virtual void setStageAsync(StageID stage) = 0;
+		virtual void setStageAsync(std::function<std::unique_ptr<Stage>()> makeStage) = 0;
 		virtual void initStage(Stage& stage) = 0;
 		virtual Stage& getCurrentStage() = 0;
 
+		// How much of Stage::getPreloadAssets the stage being switched to has loaded; 1 when no switch is pending
+		virtual float getStagePreloadProgress() const = 0;
+
 		virtual const HalleyStatics& getStatics() = 0;
 		
 		virtual Resources& getResources() = 0;
 		virtual const Environment& getEnvironment() = 0;
 
+		// Only available with a video plugin
+		virtual TextureStreamer* getTextureStreamer() = 0;
+
 		virtual int64_t getTime(CoreAPITimer timer, TimeLine tl, StopwatchAveraging::Mode mode) const = 0;
+		virtual TimeHistogramStats getTimeStats(CoreAPITimer timer, TimeLine tl, TimeHistogram::Window window) const = 0;
 	};
 }
@@ -4,6 +4,8 @@
 
 namespace Halley
 {
+	class StartupProfile;
+
 	namespace HalleyAPIFlags {
 		enum Flags
 		{
@@ -31,14 +33,14 @@ namespace Halley
 
 	public:
 		~HalleyAPI();
-		CoreAPI* core;
-		SystemAPI* system;
-		VideoAPI* video;
-		InputAPI* input;
-		AudioAPI* audio;
-		PlatformAPI* platform;
-		NetworkAPI* network;
-		MovieAPI* movie;
+		CoreAPI* core = nullptr;
+		SystemAPI* system = nullptr;
+		VideoAPI* video = nullptr;
+		InputAPI* input = nullptr;
+		AudioAPI* audio = nullptr;
+		PlatformAPI* platform = nullptr;
+		NetworkAPI* network = nullptr;
+		MovieAPI* movie = nullptr;
 		
 		template <typename T>
 		std::shared_ptr<const T> getResource(String name) const
@@ -49,7 +51,8 @@ namespace Halley
 	private:
 		friend class Core;
 
-		void init();
+		void initSystem();
+		void initOthers(StartupProfile& profile); // Everything but the system, which must be initialised first
 		void deInit();
 		void assign();
 		static std::unique_ptr<HalleyAPI> create(CoreAPIInternal* core, int flags);
@@ -11,6 +11,7 @@ namespace Halley
 	class InputJoystick;
 	class InputKeyboard;
 	class InputTouch;
+	class InputEventQueue;
 
 	class InputControllerData {
 	public:
@@ -37,6 +38,13 @@ namespace Halley
 
 		virtual void setMouseRemapping(std::function<Vector2f(Vector2i)> remapFunction) = 0;
 
+		// Timestamped events from every device, kept alongside their per-frame state; null if the backend doesn't support it
+		virtual InputEventQueue* getEventQueue() { return nullptr; }
+
+		// Polls the joysticks this many times a second on an input thread, feeding the event queue in between frames.
+		// The per-frame state of the devices is still only updated when the frame starts. 0 stops it.
+		virtual void setSamplingRate(int hz) {}
+
 		virtual Future<bool> requestControllerSetup(int minControllers, int maxControllers, Maybe<std::vector<InputControllerData>> controllerData = {})
 		{
 			Promise<bool> promise;
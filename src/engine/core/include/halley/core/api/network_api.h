@@ -4,6 +4,7 @@
 namespace Halley
 {
 	class NetworkService;
+	struct NetworkStats;
 
 	enum class NetworkProtocol
 	{
@@ -15,6 +16,11 @@ namespace Halley
 	{
 	public:
 		virtual ~NetworkAPI() {}
-		virtual std::unique_ptr<NetworkService> createService(NetworkProtocol protocol, int port = 0) = 0;
+		// With networkThreads > 0, the service runs on its own threads instead of on update(), so packets don't wait on the frame.
+		// Only supported by UDP; servers can shard their connections across several threads.
+		virtual std::unique_ptr<NetworkService> createService(NetworkProtocol protocol, int port = 0, int networkThreads = 0) = 0;
+
+		// Totals across every live reliable connection, UDP message queue and session in the process
+		virtual NetworkStats getStats() const;
 	};
 }
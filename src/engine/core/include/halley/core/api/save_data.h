@@ -3,7 +3,10 @@
 #include <array>
 #include <halley/utils/utils.h>
 #include <halley/text/string_converter.h>
+#include <halley/bytes/compression.h>
+#include <halley/concurrency/future.h>
 #include <limits>
+#include <memory>
 
 #ifdef max
 #undef max
@@ -29,7 +32,7 @@ namespace Halley {
 		}
 	};
 
-	class ISaveData {
+	class ISaveData : public std::enable_shared_from_this<ISaveData> {
 	public:
 		virtual ~ISaveData() = default;
 
@@ -42,5 +45,18 @@ namespace Halley {
 		virtual void setData(const String& path, const Bytes& data, bool commit = true) = 0;
 		virtual void commit() = 0;
 		virtual size_t getFreeSpace() { return std::numeric_limits<size_t>::max(); }
+
+		// Background versions of the above, to save without hitching. Serialize into the Bytes on the calling thread
+		// (e.g. with Serializer::toBytes); compression and the write itself happen on the disk IO thread, which is also
+		// where backends that write files do their write to a temporary file and rename. They run in the order they're
+		// called, so getDataAsync sees every setDataAsync made before it, but the synchronous calls don't wait for them.
+		// Failures are logged, and make setDataAsync return false. The save data must be owned by a shared_ptr.
+		Future<bool> setDataAsync(const String& path, Bytes data, CompressionCodec codec = CompressionCodec::Deflate, bool commit = true);
+		Future<Bytes> getDataAsync(const String& path); // Decompressed, if it was saved compressed
+		Future<void> commitAsync();
+
+		// Data compressed with these gets a small header, so decompressData knows to pass anything else through as is
+		static Bytes compressData(gsl::span<const gsl::byte> data, CompressionCodec codec = CompressionCodec::Deflate);
+		static Bytes decompressData(Bytes data);
 	};
 }
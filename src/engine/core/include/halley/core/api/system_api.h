@@ -5,6 +5,7 @@
 #include "halley/core/graphics/window.h"
 #include "halley/concurrency/concurrent.h"
 #include "halley/data_structures/maybe.h"
+#include "halley/support/profiler.h"
 
 namespace Halley
 {
@@ -40,6 +41,7 @@ namespace Halley
 
 		virtual Vector2i getScreenSize(int n) const = 0;
 		virtual Rect4i getDisplayRect(int screen) const = 0;
+		virtual int getRefreshRate(int screen) const { return 0; } // In Hz, or 0 if unknown
 
 		virtual void showCursor(bool show) = 0;
 		virtual bool hasBeenDisconnectedFromTheInternet() { return false; }
@@ -50,6 +52,7 @@ namespace Halley
 		{
 			return std::thread([=] () {
 				setThreadName(name);
+				Profiler::setThreadName(name);
 				runnable();
 			});
 		}
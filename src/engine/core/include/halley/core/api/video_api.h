@@ -3,6 +3,7 @@
 #include <halley/maths/rect.h>
 #include <halley/text/halleystring.h>
 #include <halley/file/path.h>
+#include "halley/core/graphics/render_target/render_target_pool.h"
 
 namespace Halley
 {
@@ -15,7 +16,6 @@ namespace Halley
 	class ScreenRenderTarget;
 	class Shader;
 	class Window;
-	class MaterialConstantBuffer;
 	class Material;
 
 	class VideoAPI
@@ -35,10 +35,24 @@ namespace Halley
 		virtual std::unique_ptr<Shader> createShader(const ShaderDefinition& definition) = 0;
 		virtual std::unique_ptr<TextureRenderTarget> createTextureRenderTarget() = 0;
 		virtual std::unique_ptr<ScreenRenderTarget> createScreenRenderTarget() = 0;
-		virtual std::unique_ptr<MaterialConstantBuffer> createConstantBuffer() = 0;
 
 		virtual String getShaderLanguage() = 0;
 
+		// Whether startRender, finishRender and painting can happen on a thread other than the main one
+		virtual bool canRenderOnAnyThread() const { return false; }
+
 		virtual void* getImplementationPointer(const String& id) { return nullptr; }
+
+		// Transient render targets, shared by everything rendering this frame. Its frame is advanced by Core.
+		RenderTargetPool& getRenderTargetPool()
+		{
+			if (!renderTargetPool) {
+				renderTargetPool = std::make_unique<RenderTargetPool>(*this);
+			}
+			return *renderTargetPool;
+		}
+
+	private:
+		std::unique_ptr<RenderTargetPool> renderTargetPool;
 	};
 }
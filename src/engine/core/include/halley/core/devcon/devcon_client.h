@@ -10,24 +10,40 @@ namespace Halley
 	class HalleyAPI;
 	class IConnection;
 	class MessageQueue;
+	class MemorySnapshot;
+	class GameConsole;
+	struct TelemetryFrame;
 
 	class DevConClient : private ILoggerSink
 	{
 	public:
-		DevConClient(const HalleyAPI& api, std::unique_ptr<NetworkService> service, const String& address, int port = DevCon::devConPort);
+		DevConClient(const HalleyAPI& api, std::unique_ptr<NetworkService> service, const String& address, int port = DevCon::devConPort, std::shared_ptr<GameConsole> console = {});
 		~DevConClient();
 
 		void update();
 
 		void onReceiveReloadAssets(const DevCon::ReloadAssetsMsg& msg);
+		void onReceiveRequestProfile(const DevCon::RequestProfileMsg& msg);
+		void onReceiveRequestResourceLoadTrace(const DevCon::RequestResourceLoadTraceMsg& msg);
+		void onReceiveRequestMemoryReport(const DevCon::RequestMemoryReportMsg& msg);
+		void onReceiveConsoleCommand(const DevCon::ConsoleCommandMsg& msg);
+		void onReceiveRequestTelemetry(const DevCon::RequestTelemetryMsg& msg);
+
+		// Whether a server wants a TelemetryFrame this frame; if so, it should be filled in and sent with sendTelemetry
+		bool isTelemetryDue() const;
+		void sendTelemetry(TelemetryFrame frame);
 
 	private:
 		const HalleyAPI& api;
 		std::unique_ptr<NetworkService> service;
 		String address;
 		int port;
+		std::shared_ptr<GameConsole> console;
 
 		std::shared_ptr<MessageQueue> queue;
+		std::unique_ptr<MemorySnapshot> memoryCapture;
+		int telemetryInterval = 0;
+		int framesUntilTelemetry = 0;
 
 		void connect();
 		void log(LoggerLevel level, const String& msg) override;
@@ -1,6 +1,7 @@
 #pragma once
 #include "halley/support/logger.h"
 #include "halley/net/connection/network_message.h"
+#include "devcon_telemetry.h"
 #include <gsl/gsl>
 
 namespace Halley
@@ -17,7 +18,17 @@ namespace Halley
 		enum class MessageType
 		{
 			Log,
-			ReloadAssets
+			ReloadAssets,
+			RequestProfile,
+			ProfileData,
+			RequestResourceLoadTrace,
+			ResourceLoadTraceData,
+			RequestMemoryReport,
+			MemoryReportData,
+			ConsoleCommand,
+			ConsoleOutput,
+			RequestTelemetry,
+			TelemetryData
 		};
 
 
@@ -60,5 +71,174 @@ namespace Halley
 		private:
 			std::vector<String> ids;
 		};
+
+		// Asks the client to send its profiler events, and then keep recording or stop
+		class RequestProfileMsg : public DevConMessage
+		{
+		public:
+			RequestProfileMsg(gsl::span<const gsl::byte> data);
+			RequestProfileMsg(bool keepRecording);
+
+			void serialize(Serializer& s) const override;
+
+			bool isKeepRecording() const;
+
+			MessageType getMessageType() const override;
+
+		private:
+			bool keepRecording;
+		};
+
+		// Chrome trace JSON, as produced by Profiler::exportChromeTrace
+		class ProfileDataMsg : public DevConMessage
+		{
+		public:
+			ProfileDataMsg(gsl::span<const gsl::byte> data);
+			ProfileDataMsg(String json);
+
+			void serialize(Serializer& s) const override;
+
+			const String& getJSON() const;
+
+			MessageType getMessageType() const override;
+
+		private:
+			String json;
+		};
+
+		// Asks the client to send the resource loads it traced, and then keep tracing or stop
+		class RequestResourceLoadTraceMsg : public DevConMessage
+		{
+		public:
+			RequestResourceLoadTraceMsg(gsl::span<const gsl::byte> data);
+			RequestResourceLoadTraceMsg(bool keepRecording);
+
+			void serialize(Serializer& s) const override;
+
+			bool isKeepRecording() const;
+
+			MessageType getMessageType() const override;
+
+		private:
+			bool keepRecording;
+		};
+
+		// CSV, as produced by ResourceLoadTrace::toCSV
+		class ResourceLoadTraceDataMsg : public DevConMessage
+		{
+		public:
+			ResourceLoadTraceDataMsg(gsl::span<const gsl::byte> data);
+			ResourceLoadTraceDataMsg(String csv);
+
+			void serialize(Serializer& s) const override;
+
+			const String& getCSV() const;
+
+			MessageType getMessageType() const override;
+
+		private:
+			String csv;
+		};
+
+		// Asks the client for its memory stats (see MemoryTracker), and for what changed since its last capture.
+		// If capture is set, the stats at this point become the next capture.
+		class RequestMemoryReportMsg : public DevConMessage
+		{
+		public:
+			RequestMemoryReportMsg(gsl::span<const gsl::byte> data);
+			RequestMemoryReportMsg(bool capture);
+
+			void serialize(Serializer& s) const override;
+
+			bool isCapture() const;
+
+			MessageType getMessageType() const override;
+
+		private:
+			bool capture;
+		};
+
+		// Plain text tables, from MemorySnapshot
+		class MemoryReportDataMsg : public DevConMessage
+		{
+		public:
+			MemoryReportDataMsg(gsl::span<const gsl::byte> data);
+			MemoryReportDataMsg(String report);
+
+			void serialize(Serializer& s) const override;
+
+			const String& getReport() const;
+
+			MessageType getMessageType() const override;
+
+		private:
+			String report;
+		};
+
+		// A line for the client's GameConsole, as if typed into it
+		class ConsoleCommandMsg : public DevConMessage
+		{
+		public:
+			ConsoleCommandMsg(gsl::span<const gsl::byte> data);
+			ConsoleCommandMsg(String command);
+
+			void serialize(Serializer& s) const override;
+
+			const String& getCommand() const;
+
+			MessageType getMessageType() const override;
+
+		private:
+			String command;
+		};
+
+		class ConsoleOutputMsg : public DevConMessage
+		{
+		public:
+			ConsoleOutputMsg(gsl::span<const gsl::byte> data);
+			ConsoleOutputMsg(String output);
+
+			void serialize(Serializer& s) const override;
+
+			const String& getOutput() const;
+
+			MessageType getMessageType() const override;
+
+		private:
+			String output;
+		};
+
+		// Asks the client to send a TelemetryDataMsg every "interval" frames; 0 stops it
+		class RequestTelemetryMsg : public DevConMessage
+		{
+		public:
+			RequestTelemetryMsg(gsl::span<const gsl::byte> data);
+			RequestTelemetryMsg(int interval);
+
+			void serialize(Serializer& s) const override;
+
+			int getInterval() const;
+
+			MessageType getMessageType() const override;
+
+		private:
+			int interval;
+		};
+
+		class TelemetryDataMsg : public DevConMessage
+		{
+		public:
+			TelemetryDataMsg(gsl::span<const gsl::byte> data);
+			TelemetryDataMsg(TelemetryFrame frame);
+
+			void serialize(Serializer& s) const override;
+
+			const TelemetryFrame& getFrame() const;
+
+			MessageType getMessageType() const override;
+
+		private:
+			TelemetryFrame frame;
+		};
 	}
 }
@@ -4,6 +4,7 @@
 #include <memory>
 #include "halley/text/halleystring.h"
 #include <set>
+#include <functional>
 
 namespace Halley
 {
@@ -15,22 +16,55 @@ namespace Halley
 		constexpr static int devConPort = 12500;
 		class LogMsg;
 		class ReloadAssetsMsg;
+		class RequestProfileMsg;
+		class ProfileDataMsg;
+		class RequestResourceLoadTraceMsg;
+		class ResourceLoadTraceDataMsg;
+		class RequestMemoryReportMsg;
+		class MemoryReportDataMsg;
+		class ConsoleCommandMsg;
+		class ConsoleOutputMsg;
+		class RequestTelemetryMsg;
+		class TelemetryDataMsg;
 	}
 
+	struct TelemetryFrame;
+
+	using DevConProfileCallback = std::function<void(const String& chromeTraceJSON)>;
+	using DevConResourceLoadTraceCallback = std::function<void(const String& csv)>;
+	using DevConMemoryReportCallback = std::function<void(const String& report)>;
+	using DevConConsoleCallback = std::function<void(const String& output)>;
+	using DevConTelemetryCallback = std::function<void(const TelemetryFrame& frame)>;
+
 	class DevConServerConnection
 	{
 	public:
-		DevConServerConnection(std::shared_ptr<IConnection> connection);
+		DevConServerConnection(std::shared_ptr<IConnection> connection, DevConProfileCallback& profileCallback, DevConResourceLoadTraceCallback& resourceLoadTraceCallback, DevConMemoryReportCallback& memoryReportCallback, DevConConsoleCallback& consoleCallback, DevConTelemetryCallback& telemetryCallback);
 		
 		void update();
 		
 		void reloadAssets(const std::vector<String>& assetIds);
+		void requestProfile(bool keepRecording);
+		void requestResourceLoadTrace(bool keepRecording);
+		void requestMemoryReport(bool capture);
+		void runConsoleCommand(const String& command);
+		void requestTelemetry(int interval);
 
 	private:
 		std::shared_ptr<IConnection> connection;
 		std::shared_ptr<MessageQueue> queue;
+		DevConProfileCallback& profileCallback;
+		DevConResourceLoadTraceCallback& resourceLoadTraceCallback;
+		DevConMemoryReportCallback& memoryReportCallback;
+		DevConConsoleCallback& consoleCallback;
+		DevConTelemetryCallback& telemetryCallback;
 
 		void onReceiveLogMsg(const DevCon::LogMsg& msg);
+		void onReceiveProfileData(const DevCon::ProfileDataMsg& msg);
+		void onReceiveResourceLoadTraceData(const DevCon::ResourceLoadTraceDataMsg& msg);
+		void onReceiveMemoryReportData(const DevCon::MemoryReportDataMsg& msg);
+		void onReceiveConsoleOutput(const DevCon::ConsoleOutputMsg& msg);
+		void onReceiveTelemetryData(const DevCon::TelemetryDataMsg& msg);
 	};
 
 	class DevConServer
@@ -43,8 +77,35 @@ namespace Halley
 		void reloadAssets(std::vector<String> assetIds);
 		void reloadAssets(std::set<String> assetIds);
 
+		// The first request starts recording on the clients; each later one gets them to send back what they've
+		// recorded since, which is passed to the callback
+		void requestProfile(bool keepRecording = true);
+		void setProfileCallback(DevConProfileCallback callback);
+
+		// Same as requestProfile, but for the resource loads the clients traced (see ResourceLoadTrace)
+		void requestResourceLoadTrace(bool keepRecording = true);
+		void setResourceLoadTraceCallback(DevConResourceLoadTraceCallback callback);
+
+		// Gets the clients to send their memory stats, and the difference since their last capture
+		void requestMemoryReport(bool capture = true);
+		void setMemoryReportCallback(DevConMemoryReportCallback callback);
+
+		// Runs a command on the clients' GameConsole; the output goes to the callback, or the log if there's none
+		void runConsoleCommand(const String& command);
+		void setConsoleCallback(DevConConsoleCallback callback);
+
+		// Gets the clients to stream a TelemetryFrame every "interval" frames, until called with 0. Frames without a
+		// callback set are dropped. Clients that connect later need to be asked again.
+		void requestTelemetry(int interval = 1);
+		void setTelemetryCallback(DevConTelemetryCallback callback);
+
 	private:
 		std::unique_ptr<NetworkService> service;
+		DevConProfileCallback profileCallback;
+		DevConResourceLoadTraceCallback resourceLoadTraceCallback;
+		DevConMemoryReportCallback memoryReportCallback;
+		DevConConsoleCallback consoleCallback;
+		DevConTelemetryCallback telemetryCallback;
 		std::vector<std::shared_ptr<DevConServerConnection>> connections;
 	};
 }
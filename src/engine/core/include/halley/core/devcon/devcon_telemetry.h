@@ -0,0 +1,54 @@
+#pragma once
+#include "halley/text/halleystring.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace Halley
+{
+	class Serializer;
+	class Deserializer;
+
+	struct TelemetryValue
+	{
+		String name;
+		double value = 0;
+
+		void serialize(Serializer& s) const;
+		void deserialize(Deserializer& s);
+	};
+
+	// A sample of what the game did in one frame, streamed to DevCon servers that asked for it (see DevConServer::requestTelemetry).
+	// Times are in nanoseconds, averaged the same way as CoreAPI::getTime.
+	struct TelemetryFrame
+	{
+		uint64_t frame = 0;
+		std::array<int64_t, 3> engineNs = {}; // By TimeLine, including the game's share
+		std::array<int64_t, 3> gameNs = {};
+		int64_t vsyncNs = 0;
+
+		uint64_t drawCalls = 0;
+		uint64_t vertices = 0;
+		uint64_t triangles = 0;
+
+		uint64_t memoryBytes = 0; // Only with MemoryTracker enabled; each tag's live bytes are in values as "memory.<tag>"
+
+		float audioMixTime = 0; // Seconds per buffer, see AudioStats
+		float audioBufferDuration = 0;
+		float audioLatency = 0;
+		uint64_t audioUnderruns = 0;
+		uint64_t audioVoices = 0;
+
+		uint64_t netBytesSent = 0; // Totals since the start
+		uint64_t netBytesReceived = 0;
+		uint64_t netPacketsLost = 0;
+		float netRoundTripTime = 0; // Mean, in seconds
+
+		std::vector<TelemetryValue> values; // Anything else, e.g. what the stage adds with Stage::addTelemetry
+
+		void add(String name, double value);
+
+		void serialize(Serializer& s) const;
+		void deserialize(Deserializer& s);
+	};
+}
@@ -12,6 +12,9 @@
 #include "halley_statics.h"
 #include <halley/data_structures/tree_map.h>
 #include "halley/support/logger.h"
+#include <halley/concurrency/future.h>
+#include <thread>
+#include <exception>
 
 namespace Halley
 {
@@ -21,8 +24,14 @@ namespace Halley
 	class Painter;
 	class Camera;
 	class RenderTarget;
+	class RenderCommandList;
 	class Environment;
 	class DevConClient;
+	class TextureStreamer;
+	class ResourceAccessTrace;
+	class ResourceLoadTrace;
+	class ResourcePreload;
+	class StartupProfile;
 
 	class Core final : public CoreAPIInternal, public IMainLoopable, public ILoggerSink
 	{
@@ -33,16 +42,22 @@ namespace Halley
 
 		void setStage(StageID stage) override;
 		void setStage(std::unique_ptr<Stage> stage) override;
+		void setStageAsync(StageID stage) override;
+		void setStageAsync(std::function<std::unique_ptr<Stage>()> makeStage) override;
 		void initStage(Stage& stage) override;
 		Stage& getCurrentStage() override;
+		float getStagePreloadProgress() const override;
 		void quit(int exitCode = 0) override;
 		Resources& getResources() override;
 		const Environment& getEnvironment() override;
+		TextureStreamer* getTextureStreamer() override;
 		int64_t getTime(CoreAPITimer timer, TimeLine tl, StopwatchAveraging::Mode mode) const override;
+		TimeHistogramStats getTimeStats(CoreAPITimer timer, TimeLine tl, TimeHistogram::Window window) const override;
 
 		void onFixedUpdate(Time time) override;
 		void onVariableUpdate(Time time) override;
 		bool isRunning() const override	{ return running; }
+		bool isHeadless() const override { return headless; }
 		bool transitionStage() override;
 		const HalleyAPI& getAPI() const override { return *api; }
 		const HalleyStatics& getStatics() override;
@@ -51,6 +66,8 @@ namespace Halley
 		void onReloaded() override;
 		void onTerminatedInError(const std::string& error) override;
 		int getTargetFPS() override;
+		FramePacing getFramePacing() override;
+		int64_t getLastPresentWaitNs() const override;
 
 		void registerDefaultPlugins();
 		void registerPlugin(std::unique_ptr<Plugin> plugin) override;
@@ -69,8 +86,16 @@ namespace Halley
 		void doFixedUpdate(Time time);
 		void doVariableUpdate(Time time);
 		void doRender(Time time);
+		void doHeadlessStep(Time time);
+		void doRenderPipelined(StopwatchAveraging& gameTimer);
+		void updateScreenTarget();
+		void submitRender(RenderCommandList& commands);
+		void waitForRenderSubmission();
 
 		void showComputerInfo() const;
+		void onStartupFinished();
+		void sendTelemetry();
+		void writeTimeReport();
 
 		void pumpEvents(Time time);
 		void pumpAudio();
@@ -80,24 +105,52 @@ namespace Halley
 		StopwatchAveraging vsyncTimer;
 
 		Vector<String> args;
+		std::unique_ptr<StartupProfile> startupProfile; // Until the first frame is done
+		int64_t initEndNs = 0;
+		uint64_t frameNumber = 0;
 
 		std::unique_ptr<Environment> environment;
 		std::unique_ptr<Game> game;
 		std::unique_ptr<HalleyAPI> api;
 		std::unique_ptr<Resources> resources;
+		std::shared_ptr<ResourceAccessTrace> accessTrace; // Only when running with --record-asset-trace
+		std::shared_ptr<ResourceLoadTrace> loadTrace; // Only when running with --record-load-trace
 
 		std::unique_ptr<Painter> painter;
+		std::unique_ptr<TextureStreamer> textureStreamer;
 		std::unique_ptr<Camera> camera;
 		std::unique_ptr<RenderTarget> screenTarget;
 		Vector2i prevWindowSize = Vector2i(-1, -1);
 
+		// Only used if the frame is submitted on a separate thread, while the next one is being updated
+		std::unique_ptr<ExecutionQueue> renderQueue;
+		std::unique_ptr<Executor> renderExecutor;
+		std::thread renderThread;
+		std::unique_ptr<RenderCommandList> submitting;
+		bool renderInFlight = false;
+		std::array<size_t, 3> pipelinedPainterStats = {}; // Draw calls, vertices and triangles, read while the painter is idle
+		Future<void> renderSubmission;
+		std::exception_ptr renderError;
+
 		std::unique_ptr<Stage> currentStage;
 		std::unique_ptr<Stage> nextStage;
+		std::shared_ptr<ResourcePreload> nextStagePreload;
+
+		struct AsyncStage {
+			std::unique_ptr<Stage> stage;
+			std::exception_ptr error;
+			Future<void> done;
+		};
+		std::shared_ptr<AsyncStage> asyncStage;
 		bool pendingStageTransition = false;
 
 		bool running = true;
 		bool hasError = false;
 		bool hasConsole = false;
+		bool headless = false;
+		bool uncapped = false;
+		bool timeReport = false; // Run with --frame-time-report
+		bool logDevMessages = false; // Cached, since log() may be called from the logger thread while the game is being torn down
 		int exitCode = 0;
 		std::unique_ptr<RedirectStream> out;
 
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <halley/text/halleystring.h>
+#include <halley/data_structures/hash_map.h>
+#include <halley/concurrency/concurrent.h>
 #include "halley/file/path.h"
 
 namespace Halley
@@ -15,9 +17,14 @@ namespace Halley
 		void parseProgramPath(const String& commandLine);
 		void setDataPath(Path pathName);
 
+		// Keyed by thread name, or by pool name ("CPU", "CPUAux", "IO") for the engine thread pools
+		void setThreadSettings(const String& name, ThreadSettings settings);
+		ThreadSettings getThreadSettings(const String& name, ThreadSettings defaultSettings = {}) const;
+
 	private:
 		Path programPath;
 		Path dataPath;
 		Path gameDataPath;
+		HashMap<String, ThreadSettings> threadSettings;
 	};
 }
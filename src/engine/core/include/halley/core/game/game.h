@@ -1,6 +1,7 @@
 #pragma once
 
 #include "halley/core/stage/stage.h"
+#include "halley/runner/main_loop.h"
 
 namespace Halley
 {
@@ -15,6 +16,7 @@ namespace Halley
 	public:
 		virtual ~Game() = default;
 
+		virtual void configureEnvironment(Environment& /*environment*/) {} // Called before init, e.g. to change thread settings
 		virtual void init(const Environment&, const Vector<String>& /*args*/) {}
 		virtual int initPlugins(IPluginRegistry &registry) = 0;
 		virtual void initResourceLocator(const Path& gamePath, const Path& assetsPath, const Path& unpackedAssetsPath, ResourceLocator& locator) {}
@@ -30,6 +32,18 @@ namespace Halley
 		virtual std::unique_ptr<Stage> makeStage(StageID /*id*/) { return std::unique_ptr<Stage>(); }
 
 		virtual int getTargetFPS() const { return 60; }
+		virtual FramePacing getFramePacing() const { return FramePacing(); }
+
+		// Runs without video, audio, input or movie APIs, and with only the resource types that don't need them, e.g. for
+		// dedicated servers. Only Stage::onFixedUpdate gets called. Can also be turned on with --headless.
+		virtual bool isHeadless() const { return false; }
+
+		// If the video backend allows it, submit each frame to the GPU on a separate thread while the next one is updated.
+		// Materials and render targets used to draw must not be changed or destroyed in the meantime (Core waits for the previous frame before rendering the next one).
+		virtual bool shouldRenderOnSeparateThread() const { return false; }
+
+		// Hand log messages to the sinks on a background thread, so logging doesn't stall the thread doing it (see Logger::setAsync)
+		virtual bool shouldLogAsynchronously() const { return false; }
 
 		virtual String getDevConAddress() const { return ""; }
 		virtual int getDevConPort() const { return 12500; }
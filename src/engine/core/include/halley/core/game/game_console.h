@@ -24,6 +24,7 @@ namespace Halley {
 
 		void sendMessage(const String& string);
 	    void sendCommand(const String& string);
+		String runCommand(const String& string); // Same as sendCommand, but returns the output instead of sending it to the listeners
 
     	void registerConsoleListener(IGameConsoleListener* listener);
 		void removeConsoleListener(IGameConsoleListener* listener);
@@ -5,6 +5,7 @@ namespace Halley
 {
 	class HalleyStaticsPimpl;
 	class SystemAPI;
+	class Environment;
 
 	class HalleyStatics
 	{
@@ -12,7 +13,7 @@ namespace Halley
 		HalleyStatics();
 		~HalleyStatics();
 		void setupGlobals() const;
-		void resume(SystemAPI* system);
+		void resume(SystemAPI* system, const Environment* environment = nullptr);
 		void suspend();
 
 	private:
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "halley/text/halleystring.h"
+#include "halley/data_structures/vector.h"
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace Halley
+{
+	// How long each phase of starting up took, measured from when the profile was created. Phases can be timed from
+	// any thread, as some of them overlap.
+	class StartupProfile
+	{
+	public:
+		StartupProfile();
+
+		template <typename F>
+		void time(const String& name, F&& f)
+		{
+			const auto start = getTimeNs();
+			f();
+			add(name, start, getTimeNs());
+		}
+
+		void add(const String& name, int64_t startNs, int64_t endNs);
+		int64_t getTimeNs() const;
+
+		// Phases in the order they started, with the thread they ran on
+		String generateReport() const;
+
+	private:
+		struct Phase
+		{
+			String name;
+			int64_t startNs;
+			int64_t endNs;
+			std::thread::id thread;
+		};
+
+		std::chrono::steady_clock::time_point startTime;
+		std::thread::id mainThread;
+		mutable std::mutex mutex;
+		Vector<Phase> phases;
+	};
+}
@@ -46,10 +46,14 @@ namespace Halley {
 		Camera& resetViewPort();
 		Camera& setViewPort(Rect4i viewPort);
 
+		// Renders at this fraction of the viewport's resolution while showing the same area, see DynamicResolution
+		Camera& setResolutionScale(float scale);
+
 		Vector2f getPosition() const { return pos; }
 		Angle1f getAngle() const { return angle; }
 		float getZoom() const { return zoom; }
 		Maybe<Rect4i> getViewPort() const { return viewPort; }
+		float getResolutionScale() const { return resolutionScale; }
 
 		Vector2f screenToWorld(Vector2f p, Rect4f viewport) const;
 		Vector2f worldToScreen(Vector2f p, Rect4f viewport) const;
@@ -71,6 +75,7 @@ namespace Halley {
 		Matrix4f projection;
 		Angle1f angle;
 		float zoom;
+		float resolutionScale = 1.0f;
 		bool rendering = false;
 
 		RenderTarget* renderTarget = nullptr;
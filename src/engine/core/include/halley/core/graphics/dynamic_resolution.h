@@ -0,0 +1,51 @@
+#pragma once
+
+#include "halley/maths/vector2.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+namespace Halley
+{
+	class VideoAPI;
+	class Resources;
+	class RenderContext;
+	class Camera;
+	class Painter;
+	class MaterialDefinition;
+
+	// Draws the world into a render target at a fraction of the screen's resolution, then stretches it over the screen.
+	// The fraction follows the GPU times Painter measures: it drops as soon as a frame goes over budget, and creeps back
+	// up once there's room again. Anything drawn to the context after render, such as the UI, stays at native resolution.
+	// The camera is scaled to match (see Camera::setResolutionScale), so the world drawing code doesn't need to know.
+	// Without GPU timestamp queries, it stays at the maximum scale.
+	class DynamicResolution
+	{
+	public:
+		struct Settings
+		{
+			int64_t targetGPUTimeNs = 14'000'000;
+			float minScale = 0.5f;
+			float maxScale = 1.0f;
+		};
+
+		DynamicResolution(VideoAPI& video, Resources& resources);
+		DynamicResolution(VideoAPI& video, Resources& resources, Settings settings);
+
+		void render(RenderContext& context, Camera& camera, std::function<void(Painter&)> drawWorld);
+
+		float getScale() const;
+		void setSettings(Settings settings);
+
+	private:
+		VideoAPI& video;
+		std::shared_ptr<const MaterialDefinition> material;
+		Settings settings;
+
+		float scale;
+		int64_t smoothedGPUTime = 0;
+		int framesSinceChange = 0;
+
+		void updateScale(int64_t gpuTimeNs);
+	};
+}
@@ -2,6 +2,7 @@
 
 #include <memory>
 #include "halley/text/halleystring.h"
+#include "halley/text/string_id.h"
 #include "halley/core/graphics/texture.h"
 #include <gsl/gsl>
 
@@ -17,14 +18,6 @@ namespace Halley
 	class MaterialTextureParameter;
 	class VideoAPI;
 
-	class MaterialConstantBuffer
-	{
-	public:
-		virtual ~MaterialConstantBuffer() {}
-
-		virtual void update(const MaterialDataBlock& dataBlock) = 0;
-	};
-
 	enum class MaterialDataBlockType
 	{
 		// Shared blocks are not stored locally in the material (e.g. the HalleyBlock, stored by the engine)
@@ -43,22 +36,25 @@ namespace Halley
 		MaterialDataBlock(const MaterialDataBlock& other);
 		MaterialDataBlock(MaterialDataBlock&& other) noexcept;
 
-		MaterialConstantBuffer& getConstantBuffer() const;
-		int getAddress(int pass, ShaderType stage) const;
+		int getAddress(int pass, ShaderType stage, uint32_t variant = 0) const;
 		int getBindPoint() const;
 		gsl::span<const gsl::byte> getData() const;
 		MaterialDataBlockType getType() const;
 
+		// Of the data; the painter packs blocks into a per-frame buffer shared by all materials, and blocks with the
+		// same contents are only stored there once
+		uint64_t getHash() const;
+
 	private:
-		std::unique_ptr<MaterialConstantBuffer> constantBuffer;
 		Bytes data;
 		Vector<int> addresses;
+		int numVariants = 1;
 		MaterialDataBlockType dataBlockType;
 		int bindPoint = 0;
-		bool dirty = true;
+		mutable uint64_t hash = 0;
+		mutable bool needToUpdateHash = true;
 
 		bool setUniform(size_t offset, ShaderParameterType type, void* data);
-		void upload(VideoAPI* api);
 	};
 	
 	class Material
@@ -70,8 +66,6 @@ namespace Halley
 		explicit Material(std::shared_ptr<const MaterialDefinition> materialDefinition, bool forceLocalBlocks = false); // forceLocalBlocks is for engine use only
 
 		void bind(int pass, Painter& painter);
-		void uploadData(Painter& painter);
-		static void resetBindCache();
 
 		bool operator==(const Material& material) const;
 		bool operator!=(const Material& material) const;
@@ -90,6 +84,12 @@ namespace Halley
 		void setPassEnabled(int pass, bool enabled);
 		bool isPassEnabled(int pass) const;
 
+		// Picks which of the definition's shader variants is bound (see MaterialDefinition::getKeywords)
+		Material& setKeyword(const String& keyword, bool enabled);
+		bool isKeywordEnabled(const String& keyword) const;
+		Material& setVariant(uint32_t variant);
+		uint32_t getVariant() const { return variant; }
+
 		Material& set(const String& name, const std::shared_ptr<const Texture>& texture);
 		Material& set(const String& name, const std::shared_ptr<Texture>& texture);
 
@@ -102,6 +102,19 @@ namespace Halley
 			return *this;
 		}
 
+		// Same as above, but without comparing strings; prefer these for parameters set every frame
+		Material& set(StringId name, const std::shared_ptr<const Texture>& texture);
+		Material& set(StringId name, const std::shared_ptr<Texture>& texture);
+
+		bool hasParameter(StringId name) const;
+
+		template <typename T>
+		Material& set(StringId name, const T& value)
+		{
+			getParameter(name) = value;
+			return *this;
+		}
+
 		uint64_t getHash() const;
 
 	private:
@@ -113,13 +126,15 @@ namespace Halley
 		std::vector<std::shared_ptr<const Texture>> textures;
 
 		std::vector<char> passEnabled;
+		uint32_t variant = 0;
 
 		mutable uint64_t hashValue;
 		mutable bool needToUpdateHash = true;
-		bool needToUploadData = true;
 
 		void initUniforms(bool forceLocalBlocks);
 		MaterialParameter& getParameter(const String& name);
+		MaterialParameter& getParameter(StringId name);
+		void setTexture(size_t textureUnit, const std::shared_ptr<const Texture>& texture);
 
 		void setUniform(int blockNumber, size_t offset, ShaderParameterType type, void* data);
 		uint64_t computeHash() const;
@@ -1,6 +1,7 @@
 #pragma once
 #include "halley/core/graphics/blend.h"
 #include "halley/resources/resource.h"
+#include "halley/text/string_id.h"
 
 namespace Halley
 {
@@ -10,6 +11,7 @@ namespace Halley
 	class MaterialPass;
 	class ResourceLoader;
 	class Shader;
+	class ShaderFile;
 	class VideoAPI;
 	class Painter;
 	class MaterialImporter;
@@ -93,11 +95,15 @@ namespace Halley
 	{
 	public:
 		String name;
+		StringId nameId;
 		ShaderParameterType type;
 
 		MaterialUniform();
 		MaterialUniform(String name, ShaderParameterType type);
 
+		bool operator==(const MaterialUniform& other) const;
+		bool operator!=(const MaterialUniform& other) const;
+
 		void serialize(Serializer& s) const;
 		void deserialize(Deserializer& s);
 	};
@@ -111,6 +117,9 @@ namespace Halley
 		MaterialUniformBlock();
 		MaterialUniformBlock(const String& name, const Vector<MaterialUniform>& uniforms);
 
+		bool operator==(const MaterialUniformBlock& other) const;
+		bool operator!=(const MaterialUniformBlock& other) const;
+
 		void serialize(Serializer& s) const;
 		void deserialize(Deserializer& s);
 	};
@@ -122,10 +131,14 @@ namespace Halley
 		ShaderParameterType type;
 		int location;
 		int offset;
+		bool perInstance = false; // Not serialized, see MaterialDefinition::isInstanceable
 
 		MaterialAttribute();
 		MaterialAttribute(String name, ShaderParameterType type, int location, int offset = 0);
 
+		bool operator==(const MaterialAttribute& other) const;
+		bool operator!=(const MaterialAttribute& other) const;
+
 		void serialize(Serializer& s) const;
 		void deserialize(Deserializer& s);
 
@@ -153,13 +166,27 @@ namespace Halley
 		size_t getVertexSize() const;
 		size_t getVertexStride() const;
 		size_t getVertexPosOffset() const;
+
+		// Materials with an a_vertPos attribute can draw sprites instanced: a_vertPos then comes from a static unit quad,
+		// and every other attribute is read once per instance (i.e. per sprite)
+		bool isInstanceable() const;
 		const Vector<MaterialAttribute>& getAttributes() const { return attributes; }
 		const Vector<MaterialUniformBlock>& getUniformBlocks() const { return uniformBlocks; }
 		const Vector<String>& getTextures() const { return textures; }
+		const Vector<StringId>& getTextureIds() const { return textureIds; }
+
+		// Each combination of keywords is a variant, with the shaders compiled with those keywords #defined as 1.
+		// Variants are numbered by a bit mask of their keywords, in the order they were declared.
+		const Vector<String>& getKeywords() const { return keywords; }
+		int getNumVariants() const { return 1 << int(keywords.size()); }
+		uint32_t getKeywordMask(const String& keyword) const;
+		constexpr static size_t maxKeywords = 4;
 		
 		void addPass(const MaterialPass& materialPass);
 
 		static std::unique_ptr<MaterialDefinition> loadResource(ResourceLoader& loader);
+		// Keeps the shaders and layout when only pass state changed, so Materials made from it stay valid
+		static bool updateInPlace(MaterialDefinition& definition, ResourceLoader& loader);
 		constexpr static AssetType getAssetType() { return AssetType::MaterialDefinition; }
 
 		void serialize(Serializer& s) const;
@@ -171,14 +198,19 @@ namespace Halley
 		String name;
 		Vector<MaterialPass> passes;
 		Vector<String> textures;
+		Vector<StringId> textureIds;
 		Vector<MaterialUniformBlock> uniformBlocks;
 		Vector<MaterialAttribute> attributes;
+		Vector<String> keywords;
 		int vertexSize = 0;
 		int vertexPosOffset = 0;
+		bool instanceable = false;
 
+		void updateInstancing();
 		void loadUniforms(const ConfigNode& node);
 		void loadTextures(const ConfigNode& node);
 		void loadAttributes(const ConfigNode& node);
+		void loadKeywords(const ConfigNode& node);
 		ShaderParameterType parseParameterType(String rawType) const;
 	};
 
@@ -228,25 +260,32 @@ namespace Halley
 	class MaterialPass
 	{
 		friend class Material;
+		friend class MaterialDefinition;
 
 	public:
 		MaterialPass();
 		explicit MaterialPass(const String& shaderAssetId, const ConfigNode& node);
 
 		BlendType getBlend() const { return blend; }
-		Shader& getShader() const { return *shader; }
+		Shader& getShader(uint32_t variant = 0) const { return *shaders.at(variant); }
 		const MaterialDepthStencil& getDepthStencil() const { return depthStencil; }
+		const String& getShaderAssetId() const { return shaderAssetId; }
 
 		void serialize(Serializer& s) const;
 		void deserialize(Deserializer& s);
 
-		void createShader(ResourceLoader& loader, String name, const Vector<MaterialAttribute>& attributes);
+		void createShader(ResourceLoader& loader, String name, const Vector<MaterialAttribute>& attributes, int numVariants);
+
+		static String getVariantAssetId(const String& shaderAssetId, uint32_t variant);
 
 	private:
-		std::shared_ptr<Shader> shader;
+		Vector<std::shared_ptr<Shader>> shaders; // One per variant
 		BlendType blend;
 		MaterialDepthStencil depthStencil;
 		
 		String shaderAssetId;
+		uint64_t shaderHash = 0; // Of the ShaderFiles it was created from, so a reload only relinks if the source changed
+
+		static uint64_t hashShaders(const ShaderFile& shaderFile, uint64_t seed);
 	};
 }
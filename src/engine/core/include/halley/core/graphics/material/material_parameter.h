@@ -5,6 +5,7 @@
 #include <halley/maths/vector3.h>
 #include <halley/maths/vector4.h>
 #include <halley/maths/matrix4.h>
+#include <halley/text/string_id.h>
 #include <memory>
 
 namespace Halley
@@ -20,11 +21,12 @@ namespace Halley
 	{
 	public:
 		MaterialTextureParameter(Material& material, const String& name);
-		unsigned int getAddress(int pass, ShaderType stage) const;
+		unsigned int getAddress(int pass, ShaderType stage, uint32_t variant = 0) const;
 
 	private:
 		String name;
 		Vector<int> addresses;
+		int numVariants = 1;
 	};
 
 	class MaterialParameter
@@ -45,13 +47,14 @@ namespace Halley
 		ShaderParameterType getType() const;
 
 	private:
-		MaterialParameter(Material& material, const String& name, ShaderParameterType type, int blockNumber, size_t offset);
+		MaterialParameter(Material& material, const String& name, StringId nameId, ShaderParameterType type, int blockNumber, size_t offset);
 
 		void rebind(Material& material);
 		
 		Material* material;
 		ShaderParameterType type;
 		String name;
+		StringId nameId;
 		int blockNumber;
 		size_t offset;
 	};
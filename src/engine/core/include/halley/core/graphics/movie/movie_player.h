@@ -89,6 +89,10 @@ namespace Halley
 		
 		void setVideoSize(Vector2i size);
 
+		// Rows taken by the luma plane of NV12 frames, with the interleaved chroma plane below it.
+		// If not set, the luma plane is assumed to take the top two thirds of the texture.
+		void setPlaneLayout(int yPlaneHeight);
+
 		VideoAPI& getVideoAPI() const;
 		AudioAPI& getAudioAPI() const;
 
@@ -125,6 +129,7 @@ namespace Halley
 		std::shared_ptr<MoviePlayerAliveFlag> aliveFlag;
 
 		Time time = 0;
+		int yPlaneHeight = 0;
 
 		void startThread();
 		void stopThread();
@@ -135,6 +140,11 @@ namespace Halley
 
 		bool needsMoreVideoFrames() const;
 		bool needsMoreAudioFrames() const;
+
+		bool canUpdateInPlace(const TextureDescriptor& descriptor) const;
+		std::shared_ptr<Texture> takeRecycledTexture(Vector2i size);
+		void insertPendingFrame(std::shared_ptr<Texture> texture, Time time);
+		void releaseCurrentTexture();
 	};
 }
 
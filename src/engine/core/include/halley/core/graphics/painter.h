@@ -1,8 +1,13 @@
 #pragma once
 #include "camera.h"
 #include "blend.h"
+#include "render_command_list.h"
+#include "static_geometry.h"
 #include "halley/maths/colour.h"
+#include "halley/time/stopwatch.h"
+#include "halley/data_structures/hash_map.h"
 #include <condition_variable>
+#include <array>
 #include <halley/maths/vector4.h>
 
 namespace Halley
@@ -36,12 +41,15 @@ namespace Halley
 
 		void flush();
 
-		Rect4i getViewPort() const { return viewPort; }
+		Rect4i getViewPort() const; // At the camera's nominal resolution, see Camera::setResolutionScale
 		Camera& getCurrentCamera() const { return *camera; }
 		Rect4f getWorldViewAABB() const;
 
-		virtual void clear(Colour colour) = 0;
+		void clear(Colour colour); // Also clears depth and stencil, if the render target has them
+		void clearDepth(); // Resets depth to the far plane, leaving colour untouched
 		virtual void setMaterialPass(const Material& material, int pass) = 0;
+		// Binds the material's uniform blocks. Backends pack these into one constant buffer ring per frame, rather
+		// than each material owning buffers, and only store blocks with the same contents once (see MaterialDataBlock::getHash).
 		virtual void setMaterialData(const Material& material) = 0;
 
 		void setRelativeClip(Rect4f rect);
@@ -55,9 +63,22 @@ namespace Halley
 		// vertPosOffset is the offset, in bytes, from the start of each vertex's data, to a Vector2f which will be filled with the vertex's position in 0-1 space.
 		void drawSprites(std::shared_ptr<Material> material, size_t numSprites, const void* vertexData);
 
+		// Same as above, but gathering each sprite's vertex from its own pointer
+		void drawSprites(std::shared_ptr<Material> material, size_t numSprites, const void* const* vertexData);
+
 		// Draw one sliced sprite. Slices -> x = left, y = top, z = right, w = bottom, in [0..1] space relative to the texture
 		void drawSlicedSprite(std::shared_ptr<Material> material, Vector2f scale, Vector4f slices, const void* vertexData);
 
+		// Draws geometry that was built ahead of time, without copying its vertices, see StaticGeometry
+		void drawStaticGeometry(const std::shared_ptr<StaticGeometry>& geometry);
+
+		// As above, but drawing every part with material instead of its own, which must have the same definition
+		void drawStaticGeometry(const std::shared_ptr<StaticGeometry>& geometry, const std::shared_ptr<Material>& material);
+
+		// Applies transform on top of the camera's projection to everything drawn until resetTransform is called
+		void setTransform(const Matrix4f& transform);
+		void resetTransform();
+
 		size_t getNumDrawCalls() const { return nDrawCalls; }
 		size_t getNumVertices() const { return nVertices; }
 		size_t getNumTriangles() const { return nTriangles; }
@@ -66,34 +87,63 @@ namespace Halley
 		size_t getPrevVertices() const { return prevVertices; }
 		size_t getPrevTriangles() const { return prevTriangles; }
 
+		// Time the GPU took to draw recent frames, if the backend supports timestamp queries. Lags gpuTimerLatency frames behind.
+		int64_t getGPUTime(StopwatchAveraging::Mode mode) const;
+		TimeHistogramStats getGPUTimeStats(TimeHistogram::Window window) const;
+
+		constexpr static int gpuTimerLatency = 3;
+		constexpr static size_t maxTimestampsPerFrame = 1024;
+
 	protected:
 		virtual void startDrawCall() {}
 		virtual void endDrawCall() {}
 		virtual void doStartRender() = 0;
 		virtual void doEndRender() = 0;
+		virtual void doClear(Colour colour) = 0;
+		virtual void doClearDepth() = 0;
 		virtual void setVertices(const MaterialDefinition& material, size_t numVertices, void* vertexData, size_t numIndices, unsigned short* indices, bool standardQuadsOnly) = 0;
 		virtual void drawTriangles(size_t numIndices) = 0;
 
+		// Optional instanced sprite path, see MaterialDefinition::isInstanceable
+		virtual bool supportsInstancing() const { return false; }
+		virtual void setInstancedVertices(const MaterialDefinition& material, size_t numInstances, void* instanceData) {}
+		virtual void drawInstancedQuads(size_t numInstances) {}
+
+		// Optional GPU-resident static geometry. If this returns null, the geometry is passed to setVertices instead.
+		virtual std::unique_ptr<StaticGeometryBuffer> createStaticGeometryBuffer(const StaticGeometry& geometry) { return {}; }
+		virtual void setStaticVertices(const MaterialDefinition& material, StaticGeometryBuffer& buffer, size_t vertexStart, size_t indexStart) {}
+
 		virtual void setViewPort(Rect4i rect) = 0;
 		virtual void setClip(Rect4i clip, bool enable) = 0;
 
 		virtual void onUpdateProjection(Material& material) = 0;
+
+		// Optional GPU timestamp queries. Each of the gpuTimerLatency slots has its own set of queries, and a slot's
+		// results are only read back when it's about to be reused, so reading shouldn't stall.
+		virtual bool supportsTimestamps() const { return false; }
+		virtual void beginTimestamps(int slot) {}
+		virtual void writeTimestamp(int slot, size_t index) {}
+		virtual void endTimestamps(int slot) {}
+		virtual bool readTimestamps(int slot, size_t count, Vector<int64_t>& nanoseconds) { return false; }
+
 		void generateQuadIndices(unsigned short firstVertex, size_t numQuads, unsigned short* target);
 		RenderTarget& getActiveRenderTarget();
 
 	private:
 		RenderContext* activeContext = nullptr;
 		RenderTarget* activeRenderTarget = nullptr;
-		Matrix4f projection;
+		RenderTarget* replayRenderTarget = nullptr;
 		Rect4i viewPort;
+		float resolutionScale = 1.0f;
 		Camera* camera = nullptr;
 
 		size_t verticesPending = 0;
 		size_t bytesPending = 0;
 		size_t indicesPending = 0;
 		bool allIndicesAreQuads = true;
-		Vector<char> vertexBuffer;
-		Vector<unsigned short> indexBuffer;
+		bool instancesPending = false;
+		std::unique_ptr<RenderCommandList> recording;
+		std::unique_ptr<RenderCommandList> spareList;
 		std::shared_ptr<Material> materialPending;
 		std::unique_ptr<Material> halleyGlobalMaterial;
 
@@ -106,25 +156,76 @@ namespace Halley
 
 		Vector<unsigned short> stdQuadIndexCache;
 
+		// Material state is cached by content, so clones of the same material don't cost a state change each.
+		// Both are reset every frame and whenever a render target is bound.
+		uint64_t boundMaterialKey = 0;
+		int boundMaterialPass = -1;
+		bool boundMaterialInstanced = false;
+
+		struct GPUTimerRegion
+		{
+			const char* name;
+			size_t start;
+			size_t end;
+		};
+
+		struct GPUTimerFrame
+		{
+			Vector<GPUTimerRegion> regions;
+			size_t nTimestamps = 0;
+			int64_t cpuStartNs = 0;
+			bool pending = false;
+		};
+
+		std::array<GPUTimerFrame, gpuTimerLatency> gpuTimerFrames;
+		size_t gpuFrameIndex = 0;
+		int gpuTimerSlot = -1;
+		size_t gpuOpenRegions = 0;
+		size_t gpuPassRegion = 0;
+		Vector<int64_t> gpuTimestamps;
+		StopwatchAveraging gpuFrameTimer;
+
 		void bind(RenderContext& context);
 		void unbind(RenderContext& context);
 		
+		// Recording happens on whichever thread renders the stage; startRender, replay and endRender on the thread that owns the video backend
+		void startRecording();
+		std::unique_ptr<RenderCommandList> finishRecording();
+		void recycle(std::unique_ptr<RenderCommandList> list);
+
 		void startRender();
+		void replay(RenderCommandList& list);
 		void endRender();
 		
 		void resetPending();
 		void startDrawCall(std::shared_ptr<Material>& material);
 		void flushPending();
-		void executeDrawTriangles(Material& material, size_t numVertices, void* vertexData, size_t numIndices, unsigned short* indices);
+		void executeDrawTriangles(Material& material, size_t numVertices, void* vertexData, size_t numIndices, unsigned short* indices, bool standardQuadsOnly);
+		void executeDrawInstancedQuads(Material& material, size_t numInstances, void* instanceData);
+		void executeDrawStatic(Material& material, StaticGeometry& geometry, const RenderDrawCommand& draw);
+
+		template <typename F>
+		void drawPasses(Material& material, size_t numVertices, size_t numIndices, bool instanced, F draw);
+		void resetMaterialCache();
+		static uint64_t getMaterialKey(const Material& material);
 
 		void makeSpaceForPendingVertices(size_t numBytes);
 		void makeSpaceForPendingIndices(size_t numIndices);
 		PainterVertexData addDrawData(std::shared_ptr<Material>& material, size_t numVertices, size_t numIndices, bool standardQuadsOnly);
+		char* addInstanceData(std::shared_ptr<Material>& material, size_t numInstances);
+
+		template <typename F>
+		void drawSpritesImpl(std::shared_ptr<Material>& material, size_t numSprites, F getSource);
 
 		unsigned short* getStandardQuadIndices(size_t numQuads);
 		void generateQuadIndicesOffset(unsigned short firstVertex, unsigned short lineStride, unsigned short* target);
 
+		size_t beginGPURegion(const char* name);
+		void endGPURegion(size_t region);
+		void readGPUTimers(int slot);
+
 		void updateProjection();
+		void applyProjection(const Matrix4f& projection);
 
 		Rect4i getRectangleForActiveRenderTarget(Rect4i rectangle);
 	};
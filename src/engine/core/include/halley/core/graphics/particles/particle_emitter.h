@@ -0,0 +1,87 @@
+#pragma once
+
+#include "halley/maths/vector2.h"
+#include "halley/maths/vector4.h"
+#include "halley/maths/colour.h"
+#include "halley/maths/rect.h"
+#include "halley/time/halleytime.h"
+#include <memory>
+
+namespace Halley
+{
+	class ConfigNode;
+	class Material;
+	class MaterialDefinition;
+	class Painter;
+	class Sprite;
+	class StaticGeometry;
+	class Texture;
+
+	struct ParticleEmitterConfig
+	{
+		float spawnRate = 100; // Particles per second
+		Vector2f lifetime = Vector2f(1, 1); // Min, max, in seconds
+		Vector2f spawnArea; // Half-size of the rectangle around the emitter's position that particles spawn in
+		Vector2f speed = Vector2f(50, 100); // Min, max, in pixels per second
+		Vector2f angle = Vector2f(0, 360); // Min, max direction, in degrees
+		Vector2f rotationSpeed; // Min, max, in degrees per second
+		Vector2f acceleration; // e.g. gravity, in pixels per second squared
+		Vector2f scale = Vector2f(1, 1); // At the start and end of each particle's life
+		Colour4f startColour = Colour4f(1, 1, 1, 1);
+		Colour4f endColour = Colour4f(1, 1, 1, 0);
+
+		ParticleEmitterConfig() = default;
+		explicit ParticleEmitterConfig(const ConfigNode& node);
+	};
+
+	// Particles simulated entirely on the GPU. Each particle's state is a closed-form function of its slot, the random
+	// values baked into its vertices, and the emitter's time, evaluated in the vertex shader; the vertices are uploaded
+	// once (see StaticGeometry), so the only per-frame CPU cost is setting the emitter's uniforms. Dead and not yet
+	// spawned particles are collapsed to nothing by the shader.
+	//
+	// Since no state is kept between frames, particles move with the emitter (i.e. they're in its local space), and
+	// changing the config restarts the emitter. Particles are drawn in slot order, so use additive blending
+	// (Halley/ParticleAdd) when that matters.
+	//
+	// To drive them from the ECS, keep an emitter in a component, and update and draw it from a system.
+	class ParticleEmitter
+	{
+	public:
+		ParticleEmitter(std::shared_ptr<const MaterialDefinition> materialDefinition, ParticleEmitterConfig config);
+
+		ParticleEmitter& setSprite(const Sprite& sprite);
+		ParticleEmitter& setImage(std::shared_ptr<const Texture> texture, Rect4f texRect, Vector2f size, Vector2f pivot = Vector2f(0.5f, 0.5f));
+		ParticleEmitter& setPosition(Vector2f position);
+		ParticleEmitter& setEmitting(bool emitting);
+		ParticleEmitter& setConfig(ParticleEmitterConfig config);
+
+		Vector2f getPosition() const;
+		bool isEmitting() const;
+		bool isAlive() const; // Emitting or with particles still alive
+		const ParticleEmitterConfig& getConfig() const;
+		size_t getMaxParticles() const;
+		Rect4f getAABB() const;
+
+		void update(Time t);
+		void draw(Painter& painter) const;
+
+	private:
+		constexpr static size_t maxParticlesPerPart = 16384; // Indices are 16-bit
+
+		std::shared_ptr<Material> material;
+		std::shared_ptr<StaticGeometry> geometry;
+		ParticleEmitterConfig config;
+		size_t maxParticles = 0;
+
+		Vector2f position;
+		Vector2f spriteSize;
+		Vector2f pivot;
+		Rect4f texRect;
+		double time = 0;
+		double stopTime = 0;
+		bool emitting = true;
+
+		void generateGeometry();
+		float getMaxExtent() const;
+	};
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "halley/maths/colour.h"
+#include "halley/maths/rect.h"
+#include "halley/maths/matrix4.h"
+#include "halley/data_structures/vector.h"
+#include <memory>
+
+namespace Halley
+{
+	class Material;
+	class RenderTarget;
+	class StaticGeometry;
+
+	enum class RenderCommandType : uint8_t
+	{
+		BindRenderTarget,
+		UnbindRenderTarget,
+		SetViewPort,
+		SetClip,
+		SetProjection,
+		Clear,
+		ClearDepth,
+		Draw
+	};
+
+	struct RenderCommand
+	{
+		RenderCommandType type;
+		bool enableClip = false;
+		uint32_t index = 0; // Into RenderCommandList's projections or draws
+		RenderTarget* renderTarget = nullptr;
+		Rect4i rect;
+		Colour colour;
+	};
+
+	struct RenderDrawCommand
+	{
+		std::shared_ptr<Material> material;
+		size_t vertexStart;
+		size_t numVertices;
+		size_t indexStart;
+		size_t numIndices;
+		size_t numInstances; // If non-zero, vertex data holds one vertex per instance, to be drawn as a unit quad
+		bool standardQuadsOnly;
+		std::shared_ptr<StaticGeometry> geometry; // If set, vertex and index data come from it instead of the list
+	};
+
+	// Everything a Painter was asked to do during one frame, with its vertex and index data, independent of the video
+	// backend. Painter records into it when painting and replays it against the backend when submitting, which doesn't
+	// need to happen on the same thread. Materials are kept alive by the list, and render targets must outlive it;
+	// neither should be modified until the list has been replayed.
+	class RenderCommandList
+	{
+		friend class Painter;
+
+	public:
+		void clear();
+
+		bool isEmpty() const;
+		size_t getNumCommands() const;
+		size_t getNumDrawCommands() const;
+		size_t getVertexDataSize() const;
+
+	private:
+		Vector<RenderCommand> commands;
+		Vector<RenderDrawCommand> draws;
+		Vector<Matrix4f> projections;
+
+		// These grow ahead of use, so the "used" counts say how much of them actually holds data
+		Vector<char> vertexData;
+		Vector<unsigned short> indexData;
+		size_t vertexBytesUsed = 0;
+		size_t indicesUsed = 0;
+
+		RenderCommand& addCommand(RenderCommandType type);
+	};
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "render_target/render_target_pool.h"
+#include "halley/maths/colour.h"
+#include "halley/text/halleystring.h"
+#include "halley/data_structures/maybe.h"
+#include "halley/data_structures/vector.h"
+#include <functional>
+#include <memory>
+
+namespace Halley
+{
+	class RenderContext;
+	class RenderTarget;
+	class TextureRenderTarget;
+	class Texture;
+
+	// Declarative description of a frame's passes. Each pass says which targets it reads and which one it draws to,
+	// and when the graph executes, it:
+	// - culls passes whose output doesn't reach an imported target (unless they're marked as having side effects),
+	// - orders the rest so every pass runs after the passes writing to what it reads,
+	// - picks each pass' load action (clear, keep, or don't care for the first write to a transient target),
+	// - acquires transient targets from the RenderTargetPool right before their first use, and gives them back after
+	//   their last one, so passes that don't overlap share textures.
+	//
+	// Passes writing to the same target run in the order they were added. A graph is meant to be built, executed and
+	// thrown away every frame.
+	class RenderGraph
+	{
+	public:
+		using ResourceId = size_t;
+		using PassCallback = std::function<void(RenderContext& context, const RenderGraph& graph)>;
+
+		enum class LoadAction
+		{
+			Load,
+			Clear,
+			DontCare
+		};
+
+		enum class StoreAction
+		{
+			Store,
+			DontCare
+		};
+
+		class Pass
+		{
+			friend class RenderGraph;
+
+		public:
+			Pass& read(ResourceId resource);
+			Pass& write(ResourceId resource);
+			Pass& clear(Colour colour);
+			Pass& setHasSideEffects();
+
+			const String& getName() const;
+
+			// Only set once the graph has executed
+			LoadAction getLoadAction() const;
+			StoreAction getStoreAction() const;
+
+		private:
+			String name;
+			PassCallback callback;
+			Vector<ResourceId> reads;
+			Maybe<ResourceId> output;
+			Maybe<Colour> clearColour;
+			bool sideEffects = false;
+
+			LoadAction loadAction = LoadAction::Load;
+			StoreAction storeAction = StoreAction::Store;
+
+			Pass(String name, PassCallback callback);
+		};
+
+		explicit RenderGraph(RenderTargetPool& pool);
+		~RenderGraph();
+
+		ResourceId createTarget(const String& name, const RenderTargetPool::Description& description);
+
+		// Imported targets outlive the graph, so passes drawing to them are never culled
+		ResourceId importTarget(const String& name, RenderTarget& target);
+
+		// Passes without an output draw to the context's render target, and are never culled
+		Pass& addPass(const String& name, PassCallback callback);
+
+		void execute(RenderContext& context);
+
+		// Only valid while the passes using that resource are running
+		RenderTarget& getRenderTarget(ResourceId resource) const;
+		std::shared_ptr<Texture> getTexture(ResourceId resource) const;
+
+		// Names of the passes that ran, in the order they did
+		Vector<String> getExecutedPasses() const;
+
+	private:
+		struct Resource
+		{
+			String name;
+			RenderTargetPool::Description description;
+			RenderTarget* imported = nullptr;
+			std::shared_ptr<TextureRenderTarget> transient;
+			Vector<size_t> writers;
+		};
+
+		RenderTargetPool& pool;
+		Vector<Resource> resources;
+		Vector<std::unique_ptr<Pass>> passes;
+		Vector<size_t> order;
+
+		void compile();
+		Vector<bool> findLivePasses() const;
+		void sortPasses(const Vector<bool>& live);
+		void assignActions(Vector<size_t>& firstUse, Vector<size_t>& lastUse);
+		void runPass(Pass& pass, RenderContext& context);
+	};
+}
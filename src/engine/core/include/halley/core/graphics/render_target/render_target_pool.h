@@ -0,0 +1,66 @@
+#pragma once
+
+#include "halley/core/graphics/texture_descriptor.h"
+#include "halley/data_structures/vector.h"
+#include <memory>
+#include <mutex>
+
+namespace Halley
+{
+	class VideoAPI;
+	class TextureRenderTarget;
+
+	// Render targets which are only needed for part of a frame, such as the steps of a post-processing chain.
+	// A target goes back to the pool when it's released, or at the end of the frame at the latest, and a later pass
+	// asking for the same description gets it again, so passes that don't overlap end up sharing textures.
+	// Targets are only valid during the frame they were acquired in; the ones that go unused for a few frames are
+	// destroyed.
+	class RenderTargetPool
+	{
+	public:
+		struct Description
+		{
+			Vector2i size;
+			TextureFormat format = TextureFormat::RGBA;
+			bool useFiltering = false;
+			bool withDepth = false;
+
+			Description() = default;
+			Description(Vector2i size, TextureFormat format = TextureFormat::RGBA, bool useFiltering = false, bool withDepth = false);
+
+			bool operator==(const Description& other) const;
+			bool operator!=(const Description& other) const;
+		};
+
+		explicit RenderTargetPool(VideoAPI& video);
+		~RenderTargetPool();
+
+		std::shared_ptr<TextureRenderTarget> acquire(const Description& description);
+		void release(const std::shared_ptr<TextureRenderTarget>& target);
+
+		void nextFrame();
+		void clear();
+
+		size_t getNumTargets() const;
+		size_t getNumInUse() const;
+
+	private:
+		struct Entry
+		{
+			Description description;
+			std::shared_ptr<TextureRenderTarget> target;
+			uint64_t lastUsedFrame;
+			bool inUse;
+		};
+
+		// Destruction is delayed by a few frames, as a frame that's still being submitted might be drawing to them
+		constexpr static uint64_t framesToKeep = 3;
+
+		VideoAPI& video;
+		mutable std::mutex mutex;
+		Vector<Entry> entries;
+		uint64_t frame = 0;
+
+		std::shared_ptr<TextureRenderTarget> create(const Description& description);
+	};
+}
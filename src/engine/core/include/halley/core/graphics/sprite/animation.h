@@ -1,6 +1,7 @@
 #pragma once
 
 #include <halley/text/halleystring.h>
+#include <halley/text/string_id.h>
 #include <memory>
 #include <halley/resources/resource.h>
 #include "halley/maths/vector2.h"
@@ -17,6 +18,38 @@ namespace Halley
 	class AnimationDirection;
 	class AnimationImporter;
 
+	// Interned name of a sequence or direction. The name is only looked up when the id is made (e.g. when an animation
+	// loads, or once into a constant in gameplay code); after that, comparisons and lookups are integer comparisons.
+	// The same name has the same id in every animation.
+	template <typename Tag>
+	class AnimationNameId
+	{
+	public:
+		AnimationNameId() = default;
+		explicit AnimationNameId(const String& name)
+			: id(name)
+		{}
+		explicit AnimationNameId(StringId id)
+			: id(id)
+		{}
+
+		bool isValid() const { return id.isValid(); }
+		uint32_t getValue() const { return id.getValue(); }
+		StringId getStringId() const { return id; }
+		const String& getName() const { return id.getString(); }
+
+		bool operator==(const AnimationNameId& other) const { return id == other.id; }
+		bool operator!=(const AnimationNameId& other) const { return id != other.id; }
+
+	private:
+		StringId id;
+	};
+
+	struct AnimationSequenceTag {};
+	struct AnimationDirectionTag {};
+	using AnimationSequenceId = AnimationNameId<AnimationSequenceTag>;
+	using AnimationDirectionId = AnimationNameId<AnimationDirectionTag>;
+
 	class AnimationFrame
 	{
 	public:
@@ -65,6 +98,7 @@ namespace Halley
 			return frames[n];
 		}
 		const String& getName() const { return name; }
+		AnimationSequenceId getNameId() const { return nameId; }
 		bool isLooping() const { return loop; }
 		bool isNoFlip() const { return noFlip; }
 
@@ -79,6 +113,7 @@ namespace Halley
 		Vector<AnimationFrame> frames;
 		Vector<AnimationFrameDefinition> frameDefinitions;
 		String name;
+		AnimationSequenceId nameId;
 		bool loop = false;
 		bool noFlip = false;
 	};
@@ -92,6 +127,7 @@ namespace Halley
 		AnimationDirection(String name, String fileName, bool flip, int id);
 
 		String getName() const { return name; }
+		AnimationDirectionId getNameId() const { return nameId; }
 		String getFileName() const { return fileName; }
 		bool shouldFlip() const { return flip; }
 		int getId() const { return id; }
@@ -105,6 +141,7 @@ namespace Halley
 	private:
 		String name;
 		String fileName;
+		AnimationDirectionId nameId;
 		int id;
 		bool flip;
 	};
@@ -121,14 +158,19 @@ namespace Halley
 		void reload(Resource&& resource) override;
 
 		const String& getName() const { return name; }
+		const String& getSpriteSheetName() const { return spriteSheetName; }
+		const String& getMaterialName() const { return materialName; }
 		const SpriteSheet& getSpriteSheet() const { return *spriteSheet; }
 		std::shared_ptr<Material> getMaterial() const { return material; }
 		const AnimationSequence& getSequence(const String& name) const;
+		const AnimationSequence& getSequence(AnimationSequenceId id) const;
 		const AnimationDirection& getDirection(const String& name) const;
+		const AnimationDirection& getDirection(AnimationDirectionId id) const;
 		const AnimationDirection& getDirection(int id) const;
 		Vector2i getPivot() const;
 
 		bool hasSequence(const String& name) const;
+		bool hasSequence(AnimationSequenceId id) const;
 
 		void serialize(Serializer& s) const;
 		void deserialize(Deserializer& s);
@@ -3,6 +3,7 @@
 #include "sprite_sheet.h"
 #include <halley/time/halleytime.h>
 #include "halley/data_structures/maybe.h"
+#include <gsl/gsl>
 
 namespace Halley
 {
@@ -17,14 +18,20 @@ namespace Halley
 
 		AnimationPlayer& setAnimation(std::shared_ptr<const Animation> animation, const String& sequence = "default", const String& direction = "default");
 		AnimationPlayer& setSequence(const String& sequence);
+		AnimationPlayer& setSequence(AnimationSequenceId sequence);
 		AnimationPlayer& setDirection(int direction);
 		AnimationPlayer& setDirection(const String& direction);
+		AnimationPlayer& setDirection(AnimationDirectionId direction);
 		bool trySetSequence(const String& sequence);
+		bool trySetSequence(AnimationSequenceId sequence);
 
 		AnimationPlayer& setApplyPivot(bool apply);
 
 		void update(Time time);
 
+		// Same as calling update on each of them; large batches are split across the CPU executors
+		static void updateAll(gsl::span<AnimationPlayer> players, Time time);
+
 		void updateSprite(Sprite& sprite) const;
 
 		AnimationPlayer& setMaterialOverride(std::shared_ptr<Material> material);
@@ -48,6 +55,8 @@ namespace Halley
 
 	private:
 		void resolveSprite();
+		void startSequence(const AnimationSequence& sequence);
+		void changeDirection(const AnimationDirection& direction);
 
 		void onSequenceStarted();
 		void onSequenceDone();
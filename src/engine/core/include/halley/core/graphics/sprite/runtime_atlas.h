@@ -0,0 +1,91 @@
+#pragma once
+
+#include <halley/maths/rect.h>
+#include <halley/data_structures/vector.h>
+#include <halley/data_structures/bin_pack.h>
+#include <memory>
+#include <mutex>
+
+namespace Halley
+{
+	class Texture;
+	class Material;
+	class MaterialDefinition;
+	class VideoAPI;
+	class Image;
+	class RuntimeAtlasPage;
+
+	// An image packed into a RuntimeAtlas. Its area is reserved for as long as the entry is alive, so hold on to it
+	// for as long as any sprite uses it (see Sprite::setImage).
+	class RuntimeAtlasEntry
+	{
+	public:
+		RuntimeAtlasEntry(std::shared_ptr<RuntimeAtlasPage> page, Rect4i rect);
+		~RuntimeAtlasEntry();
+
+		RuntimeAtlasEntry(const RuntimeAtlasEntry& other) = delete;
+		RuntimeAtlasEntry& operator=(const RuntimeAtlasEntry& other) = delete;
+
+		const std::shared_ptr<Material>& getMaterial() const;
+		Vector2i getSize() const;
+		Rect4f getTexRect() const;
+
+	private:
+		std::shared_ptr<RuntimeAtlasPage> page;
+		Rect4i rect;
+		Rect4f texRect;
+	};
+
+	class RuntimeAtlasPage
+	{
+	public:
+		RuntimeAtlasPage(VideoAPI& video, std::shared_ptr<const MaterialDefinition> materialDefinition, Vector2i size);
+
+		const std::shared_ptr<Texture>& getTexture() const;
+		const std::shared_ptr<Material>& getMaterial() const;
+		Vector2i getSize() const;
+
+		bool allocate(Vector2i size, Rect4i& rect);
+		void release();
+
+	private:
+		std::shared_ptr<Texture> texture;
+		std::shared_ptr<Material> material;
+		Vector2i size;
+
+		std::mutex mutex;
+		MaxRectsBin bin;
+		size_t numEntries = 0;
+	};
+
+	// Packs images made at runtime (user generated content, downloaded thumbnails, etc) into shared textures, so that
+	// sprites using them all share a few materials and can be batched, rather than taking a texture and a draw call
+	// each. Anything which was packed offline should use sprite sheets instead.
+	//
+	// Areas are allocated as soon as an image is added, so the entry's texture coordinates never change; its pixels
+	// are prepared and uploaded on a CPU executor, and the area stays blank until that's done. Areas are only reused
+	// once every entry on that page has been released. Images larger than maxImageSize get a page of their own.
+	class RuntimeAtlas
+	{
+	public:
+		RuntimeAtlas(VideoAPI& video, std::shared_ptr<const MaterialDefinition> materialDefinition, Vector2i pageSize = Vector2i(2048, 2048), int maxImageSize = 256);
+
+		// Image must be RGBA (premultiplied or not, to match the material)
+		std::shared_ptr<RuntimeAtlasEntry> add(std::shared_ptr<const Image> image);
+
+		size_t getNumPages() const;
+
+	private:
+		constexpr static int padding = 1;
+
+		VideoAPI& video;
+		std::shared_ptr<const MaterialDefinition> materialDefinition;
+		Vector2i pageSize;
+		int maxImageSize;
+
+		mutable std::mutex mutex;
+		Vector<std::shared_ptr<RuntimeAtlasPage>> pages;
+
+		void upload(const std::shared_ptr<RuntimeAtlasEntry>& entry, std::shared_ptr<Texture> texture, std::shared_ptr<const Image> image, Rect4i paddedRect);
+	};
+}
@@ -4,6 +4,7 @@
 #include <halley/maths/rect.h>
 #include <halley/maths/colour.h>
 #include <halley/maths/vector4.h>
+#include <halley/maths/transform2d.h>
 #include "halley/data_structures/maybe.h"
 
 namespace Halley
@@ -16,6 +17,7 @@ namespace Halley
 	class Texture;
 	class MaterialDefinition;
 	class Painter;
+	class RuntimeAtlasEntry;
 
 	struct SpriteVertexAttrib
 	{
@@ -30,7 +32,9 @@ namespace Halley
 		Rect4f texRect;
 		float rotation = 0;
 		float textureRotation = 0;
-		char _padding[8];
+		Vector2f custom0; // Material-specific, e.g. smoothness and outline for distance field materials
+		Vector4f custom1; // Material-specific, e.g. outline colour for distance field materials
+		float depth = 0; // [0..1], 0 being nearest; only matters to materials with depth testing
 	};
 
 	class Sprite
@@ -48,11 +52,14 @@ namespace Halley
 		Sprite& setMaterial(Resources& resources, String materialName = "");
 		Sprite& setMaterial(std::shared_ptr<Material> m);
 		Material& getMaterial() const { return *material; }
+		const std::shared_ptr<Material>& getMaterialPtr() const { return material; }
 		bool hasMaterial() const { return material != nullptr; }
+		const SpriteVertexAttrib& getVertexAttrib() const { return vertexAttrib; }
 
 		Sprite& setImage(Resources& resources, String imageName, String materialName = "");
 		Sprite& setImage(std::shared_ptr<const Texture> image, std::shared_ptr<const MaterialDefinition> material);
 		Sprite& setImageData(const Texture& image);
+		Sprite& setImage(const RuntimeAtlasEntry& entry);
 
 		Sprite& setSprite(Resources& resources, String spriteSheetName, String imageName, String materialName = "");
 		Sprite& setSprite(const SpriteResource& sprite, bool applyPivot = true);
@@ -70,6 +77,9 @@ namespace Halley
 
 		Sprite& setRotation(Angle1f angle);
 
+		// Sets position, rotation and scale at once, e.g. from TransformHierarchyService::getWorldTransform
+		Sprite& setTransform(const Transform2D& transform);
+
 		Sprite& setSize(Vector2f size);
 		Sprite& setScale(Vector2f scale);
 		Sprite& setScale(float scale);
@@ -89,12 +99,29 @@ namespace Halley
 		Sprite& setTexRect(Rect4f texRect);
 		Rect4f getTexRect() const;
 
+		// Per-sprite material parameters, so that sprites differing only in these can still be batched together
+		Sprite& setCustom0(Vector2f value);
+		Sprite& setCustom1(Vector4f value);
+		Vector2f getCustom0() const;
+		Vector4f getCustom1() const;
+
+		// Depth buffer value, from 0 (nearest) to 1. SpritePainter assigns these from its draw order.
+		Sprite& setDepth(float depth);
+		float getDepth() const;
+
 		Sprite& setSliced(Vector4s slices);
 		Sprite& setNotSliced();
+		bool isSliced() const;
 
 		Sprite& setVisible(bool visible);
 		bool isVisible() const;
 
+		// For detail sprites: SpritePainter skips them once the longest side of their AABB is under this many pixels
+		// on screen, e.g. when zoomed out. Zero (the default) always draws them.
+		Sprite& setMinScreenSize(float size);
+		float getMinScreenSize() const;
+		bool isLargeEnoughOnScreen(float zoom) const;
+
 		Sprite& setClip(Rect4f clip);
 		Sprite& setAbsoluteClip(Rect4f clip);
 		Sprite& setClip();
@@ -116,6 +143,7 @@ namespace Halley
 		Vector4s slices;
 		Vector4s outerBorder;
 		Maybe<Rect4f> clip;
+		float minScreenSize = 0;
 		bool absoluteClip = false;
 		bool visible = true;
 		bool flip = false;
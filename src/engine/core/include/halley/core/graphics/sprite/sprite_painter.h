@@ -1,8 +1,11 @@
 #pragma once
 
 #include <halley/data_structures/vector.h>
+#include <halley/data_structures/hash_map.h>
 #include <cstddef>
+#include <cstdint>
 #include "halley/maths/rect.h"
+#include "halley/core/graphics/sprite/sprite.h"
 #include <limits>
 
 namespace Halley
@@ -11,11 +14,13 @@ namespace Halley
 	class String;
 	class Sprite;
 	class Painter;
+	class Material;
 
 	enum class SpritePainterEntryType
 	{
 		SpriteRef,
 		SpriteCached,
+		SpriteCompact,
 		TextRef,
 		TextCached
 	};
@@ -33,6 +38,8 @@ namespace Halley
 		const TextRenderer& getText() const;
 		size_t getIndex() const;
 		int getMask() const;
+		int getLayer() const;
+		float getTieBreaker() const;
 
 	private:
 		const void* ptr = nullptr;
@@ -43,23 +50,121 @@ namespace Halley
 		float tieBreaker;
 	};
 
+	// Entries are ordered by layer, then tieBreaker, then material, packed into a 64-bit key and radix sorted.
+	// Grouping by material within the same depth lets the Painter batch those sprites into one draw call.
+	// Sprites outside of the camera's view, or too small on screen (see Sprite::setMinScreenSize), are dropped before sorting.
+	//
+	// If any of the sprites drawn have materials which write depth (e.g. Halley/SpriteOpaque or Halley/SpriteAlphaTest),
+	// every sprite is given a depth from its place in that order, and the depth writing ones are drawn first, front to
+	// back and grouped only by material, so whatever is hidden behind them is rejected by the depth test instead of
+	// overdrawn. The rest follow in order, depth tested against them. Sliced and clipped sprites always go with the
+	// rest, and text is drawn without depth, so it's never hidden by opaque sprites.
 	class SpritePainter
 	{
 	public:
 		void start(size_t nSprites);
 		void add(const Sprite& sprite, int mask, int layer, float tieBreaker);
 		void addCopy(const Sprite& sprite, int mask, int layer, float tieBreaker);
+		void addCopy(Sprite&& sprite, int mask, int layer, float tieBreaker);
 		void add(const TextRenderer& sprite, int mask, int layer, float tieBreaker);
 		void addCopy(const TextRenderer& text, int mask, int layer, float tieBreaker);
 		void draw(int mask, Painter& painter);
 
+		// Static sprites stay registered across frames (start doesn't remove them) and are kept in a loose grid, so
+		// only those in cells near the view are looked at. The sprite is referenced, so it must outlive its
+		// registration, and updateStatic must be called after it moves or changes size.
+		void addStatic(int id, const Sprite& sprite, int mask, int layer, float tieBreaker);
+		void updateStatic(int id);
+		void removeStatic(int id);
+		void clearStatic();
+
 	private:
+		struct StaticSprite
+		{
+			const Sprite* sprite;
+			int mask;
+			int layer;
+			float tieBreaker;
+			uint64_t cell;
+		};
+
+		// Sprites are in the cell of their centre; bounds covers all of them, so cells can be rejected as a whole
+		struct StaticCell
+		{
+			Vector<int> ids;
+			Rect4f bounds;
+			bool boundsDirty = false;
+		};
+
+		constexpr static float staticCellSize = 256.0f;
+
+		struct SortEntry
+		{
+			uint64_t key;
+			uint32_t index;
+		};
+
+		struct OpaqueEntry
+		{
+			const Material* material;
+			uint32_t order;
+		};
+
+		// Plain sprites passed to addCopy are kept in this form. The material is an index into this frame's material
+		// table, so copying one is a memcpy, and each material's reference count is touched once per frame rather than
+		// once per sprite. Sliced and clipped sprites are copied whole, since they're drawn through Sprite::draw.
+		struct CompactSprite
+		{
+			SpriteVertexAttrib vertex;
+			Rect4f aabb;
+			float minScreenSize;
+			uint32_t materialIdx;
+		};
+
 		Vector<SpritePainterEntry> sprites;
+		Vector<SpritePainterEntry> visibleStatic;
+		Vector<uint32_t> visible;
 		Vector<Sprite> cachedSprites;
+		Vector<CompactSprite> compactSprites;
+		Vector<std::shared_ptr<Material>> frameMaterials;
+		HashMap<const Material*, uint32_t> frameMaterialIds;
 		Vector<TextRenderer> cachedText;
+		Vector<SortEntry> sorted;
+		Vector<SortEntry> sortScratch;
+		Vector<uint32_t> drawn;
+		Vector<OpaqueEntry> opaque;
+		Vector<SpriteVertexAttrib> depthVertices;
+		Vector<const void*> batch;
+		const std::shared_ptr<Material>* batchMaterial = nullptr;
 		bool dirty = false;
+		Rect4f lastView;
+		float lastZoom = 1.0f;
+
+		HashMap<int, StaticSprite> staticSprites;
+		HashMap<uint64_t, StaticCell> staticCells;
+
+		void cull(Rect4f view, float zoom);
+		void sort();
+		const SpritePainterEntry& getEntry(uint32_t index) const;
+		const Sprite* getSprite(const SpritePainterEntry& entry) const;
+		const CompactSprite* getCompact(const SpritePainterEntry& entry) const;
+		const SpriteVertexAttrib* getVertex(const SpritePainterEntry& entry) const;
+		const Material* getDepthWritingMaterial(const SpritePainterEntry& entry) const;
+		const TextRenderer* getText(const SpritePainterEntry& entry) const;
+		bool isInView(const SpritePainterEntry& entry, Rect4f view, float zoom) const;
+
+		uint64_t getStaticCell(const Sprite& sprite) const;
+		void insertStatic(int id, StaticSprite& entry);
+		void eraseStatic(int id, const StaticSprite& entry);
+		uint64_t getSortKey(const SpritePainterEntry& entry) const;
+		uint32_t getFrameMaterial(const std::shared_ptr<Material>& material);
+
+		void addToBatch(const std::shared_ptr<Material>& material, const SpriteVertexAttrib& vertex, Painter& painter);
+		void flushBatch(Painter& painter);
 
-		void draw(const Sprite& sprite, Painter& painter, Rect4f view);
+		void drawWithDepth(Painter& painter, Rect4f view);
+		void draw(const SpritePainterEntry& entry, const SpriteVertexAttrib& vertex, Painter& painter, Rect4f view);
+		void draw(const Sprite& sprite, const SpriteVertexAttrib& vertex, Painter& painter, Rect4f view);
 		void draw(const TextRenderer& text, Painter& painter, Rect4f view);
 	};
 }
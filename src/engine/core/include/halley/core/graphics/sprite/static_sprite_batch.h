@@ -0,0 +1,39 @@
+#pragma once
+
+#include "halley/core/graphics/static_geometry.h"
+#include "halley/maths/matrix4.h"
+#include <gsl/gsl>
+
+namespace Halley
+{
+	class Sprite;
+	class Painter;
+
+	// Sprites that don't change (e.g. tilemaps and static decorations), baked into vertex data once, so drawing them
+	// doesn't go through Painter::drawSprites every frame. The sprites are copied when the batch is built; to change
+	// any of them, build a new batch. Sliced and clipped sprites aren't supported.
+	//
+	// If chunkSize is above zero, sprites are split into square chunks of that size by the centre of each sprite, and
+	// chunks that are out of view aren't drawn. Draw order is kept within each chunk, but not across them, so sprites
+	// that must be drawn over sprites in a different chunk should go in a batch of their own.
+	class StaticSpriteBatch
+	{
+	public:
+		StaticSpriteBatch() = default;
+		StaticSpriteBatch(gsl::span<const Sprite> sprites, float chunkSize = 0);
+
+		void draw(Painter& painter) const;
+		void draw(Painter& painter, const Matrix4f& transform) const;
+
+		size_t getNumSprites() const;
+		size_t getNumChunks() const;
+		Rect4f getBounds() const;
+
+	private:
+		Vector<std::shared_ptr<StaticGeometry>> chunks;
+		size_t numSprites = 0;
+		Rect4f bounds;
+
+		static std::shared_ptr<StaticGeometry> bake(gsl::span<const Sprite* const> sprites);
+	};
+}
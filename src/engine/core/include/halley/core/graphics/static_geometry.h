@@ -0,0 +1,47 @@
+#pragma once
+
+#include "halley/data_structures/vector.h"
+#include "halley/maths/rect.h"
+#include <memory>
+
+namespace Halley
+{
+	class Material;
+
+	// Backend handle for geometry that has been uploaded to GPU memory
+	class StaticGeometryBuffer
+	{
+	public:
+		virtual ~StaticGeometryBuffer() {}
+	};
+
+	// Vertex and index data which doesn't change once built, drawn with Painter::drawStaticGeometry. Backends that
+	// support it upload it the first time it's drawn and keep it in GPU memory from then on; the others copy it into
+	// their per-frame buffers, which still saves building the vertices every frame.
+	// Don't modify it after it's first drawn. Each part's indices are relative to the part's first vertex.
+	class StaticGeometry
+	{
+		friend class Painter;
+
+	public:
+		struct Part
+		{
+			std::shared_ptr<Material> material;
+			size_t vertexStart; // In bytes
+			size_t numVertices;
+			size_t indexStart;
+			size_t numIndices;
+			bool standardQuadsOnly;
+		};
+
+		Vector<char> vertexData;
+		Vector<unsigned short> indexData;
+		Vector<Part> parts;
+		Rect4f bounds;
+
+	private:
+		// Only touched by the thread that owns the video backend
+		std::unique_ptr<StaticGeometryBuffer> buffer;
+		bool bufferCreated = false;
+	};
+}
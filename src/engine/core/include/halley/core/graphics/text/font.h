@@ -10,6 +10,7 @@ namespace Halley
 {
 	class Deserializer;
 	class Serializer;
+	class GlyphAtlas;
 
 	class Font : public Resource
 	{
@@ -48,6 +49,8 @@ namespace Halley
 
 		const Glyph& getGlyph(int code) const;
 		const Font& getFontForGlyph(int code) const;
+		// Same as getFontForGlyph followed by getGlyph on that font, but only looks the code up once
+		std::pair<const Font*, const Glyph*> getFontAndGlyph(int code) const;
 		float getLineHeightAtSize(float size) const;
 		float getAscenderDistance() const;
 		float getHeight() const;
@@ -55,10 +58,23 @@ namespace Halley
 		float getSmoothRadius() const;
 		float getReplacementScale() const;
 		String getName() const;
+		String getImageName() const;
+		const std::vector<String>& getFallback() const;
 		bool isDistanceField() const;
 
 		void addGlyph(const Glyph& glyph);
 
+		// Fonts imported with "dynamicAtlas" ship each glyph's distance field on its own, compressed, instead of one
+		// pre-baked texture; they're packed into a GlyphAtlas of atlasSize as they get used
+		void setDynamicAtlas(Vector2i atlasSize);
+		void addGlyphBitmap(int charcode, Bytes compressedAlpha);
+		bool hasDynamicAtlas() const;
+
+		// Where the glyph is in the font's texture. With a dynamic atlas this moves around, and is empty while the
+		// glyph is still being prepared; getAtlasVersion changes whenever any area (of this or a fallback) might have.
+		Rect4f getGlyphArea(const Glyph& glyph) const;
+		uint32_t getAtlasVersion() const;
+
 		std::shared_ptr<Material> getMaterial() const;
 
 		void serialize(Serializer& deserializer) const;
@@ -80,5 +96,17 @@ namespace Halley
 
 		std::shared_ptr<Material> material;
 		FlatMap<int, Glyph> glyphs;
+
+		bool dynamicAtlas = false;
+		Vector2i atlasSize;
+		FlatMap<int, Bytes> glyphBitmaps; // Handed over to the atlas on load
+		std::shared_ptr<GlyphAtlas> atlas;
+
+		// Pages of 256 code points, each mapping to an index in glyphs (or -1), so lookups don't need to search
+		// the map. Only built on load; fonts assembled with addGlyph fall back to searching.
+		std::vector<std::vector<int>> glyphTable;
+
+		const Glyph* findGlyph(int code) const;
+		void buildGlyphTable();
 	};
 }
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <halley/maths/rect.h>
+#include <halley/maths/range.h>
+#include <halley/utils/utils.h>
+#include <halley/data_structures/flat_map.h>
+#include <halley/data_structures/hash_map.h>
+#include <halley/data_structures/vector.h>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_set>
+
+namespace Halley
+{
+	class Texture;
+	class VideoAPI;
+
+	// Glyph texture for fonts that don't ship a pre-baked atlas. Each glyph's distance field comes compressed from
+	// the importer; glyphs are only decoded (on a CPU executor) and packed into the texture once they're first asked
+	// for. Glyphs are packed onto shelves of similar height, and when the texture is full, the least recently
+	// requested ones are evicted to make room.
+	//
+	// Whenever glyphs are added or evicted, the version changes; anything holding on to areas from getArea() should
+	// ask for them again.
+	class GlyphAtlas
+	{
+	public:
+		GlyphAtlas(VideoAPI& video, Vector2i size, FlatMap<int, Bytes> glyphBitmaps);
+
+		const std::shared_ptr<Texture>& getTexture() const;
+
+		// Area of the glyph, in texture coordinates. If it isn't resident yet, it's queued and an empty area is
+		// returned until the version changes.
+		Rect4f getArea(int charcode, Vector2i glyphSize);
+
+		// Packs glyphs that finished decoding since the last call
+		uint32_t getVersion();
+
+		size_t getNumResident() const;
+
+	private:
+		struct Shelf
+		{
+			int y;
+			int height;
+			int usedWidth = 0;
+			int numResident = 0;
+			Vector<Range<int>> freeSpans;
+		};
+
+		struct ResidentGlyph
+		{
+			Rect4i rect;
+			size_t shelf;
+			uint64_t lastUsed;
+		};
+
+		struct DecodedGlyph
+		{
+			int charcode;
+			Vector2i size;
+			Bytes pixels;
+		};
+
+		// Shared with decoding tasks, which might outlive the atlas
+		struct DecodeQueue
+		{
+			FlatMap<int, Bytes> bitmaps;
+			std::mutex mutex;
+			Vector<DecodedGlyph> done;
+			std::atomic<bool> hasDone{ false };
+		};
+
+		// A few texels at the origin are always left blank, for glyphs which aren't resident
+		constexpr static int reservedSize = 2;
+		constexpr static int padding = 1;
+
+		std::shared_ptr<Texture> texture;
+		std::shared_ptr<DecodeQueue> queue;
+		Vector2i size;
+
+		mutable std::mutex mutex;
+		HashMap<int, ResidentGlyph> resident;
+		std::unordered_set<int> requested;
+		Vector<Shelf> shelves;
+		int nextShelfY = reservedSize;
+		uint64_t tick = 0;
+		uint32_t version = 0;
+
+		void request(int charcode, Vector2i glyphSize);
+		void pack(DecodedGlyph& glyph);
+		bool allocate(Vector2i allocSize, Rect4i& rect, size_t& shelfIdx);
+		bool evictLeastRecentlyUsed();
+
+		Rect4f toTexCoords(Rect4i rect) const;
+	};
+}
@@ -6,14 +6,12 @@
 #include "halley/maths/rect.h"
 #include "halley/data_structures/maybe.h"
 #include <gsl/span>
-#include <map>
 
 namespace Halley
 {
 	class LocalisedString;
 	class Font;
 	class Painter;
-	class Material;
 	class Sprite;
 
 	using ColourOverride = std::pair<size_t, Maybe<Colour4f>>;
@@ -75,7 +73,6 @@ namespace Halley
 
 	private:
 		std::shared_ptr<const Font> font;
-		mutable std::map<const Font*, std::shared_ptr<Material>> materials;
 		StringUTF32 text;
 		SpriteFilter spriteFilter;
 		
@@ -95,14 +92,13 @@ namespace Halley
 		std::vector<ColourOverride> colourOverrides;
 
 		mutable Vector<Sprite> spritesCache;
-		mutable bool materialDirty = true;
 		mutable bool glyphsDirty = true;
 		mutable bool positionDirty = true;
+		mutable Vector2f layoutOrigin;
+		mutable uint32_t atlasVersion = 0;
 
-		std::shared_ptr<Material> getMaterial(const Font& font) const;
-		void updateMaterial(Material& material, const Font& font) const;
-		void updateMaterialForFont(const Font& font) const;
-		void updateMaterials() const;
+		void layoutGlyphs(std::vector<Sprite>& sprites) const;
+		Vector2f getLayoutOrigin() const;
 		float getScale(const Font& font) const;
 	};
 }
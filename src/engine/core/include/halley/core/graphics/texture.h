@@ -2,26 +2,53 @@
 
 #include "halley/resources/resource.h"
 #include "halley/maths/vector2.h"
+#include "halley/maths/rect.h"
+#include "halley/utils/utils.h"
 #include <memory>
+#include <atomic>
 
 namespace Halley
 {
 	class TextureDescriptor;
 	class ResourceLoader;
+	enum class TextureFormat;
 
 	class Texture : public AsyncResource
 	{
+		friend class TextureStreamer;
+
 	public:
 		Texture(Vector2i size);
 
 		virtual void load(TextureDescriptor&& descriptor);
 
+		// Replaces the pixels in area with tightly packed rows of data; only for uncompressed textures without mipmaps
+		// that were loaded with canBeUpdated. Can be called from any thread, the backend applies it before the texture is next used.
+		virtual void updateRegion(Rect4i area, TextureFormat format, Bytes&& pixels);
+
 		static std::shared_ptr<Texture> loadResource(ResourceLoader& loader);
+		static bool updateInPlace(Texture& texture, ResourceLoader& loader); // Uploads only the rows and columns that changed
 		constexpr static AssetType getAssetType() { return AssetType::Texture; }
 
 		Vector2i getSize() const { return size; }
 
+		// Streamed textures are marked by the painter whenever they're drawn, see TextureStreamer
+		bool isStreamed() const { return streamed; }
+		void setStreamed(bool streamed);
+		void markUsed() const { used.store(true, std::memory_order_relaxed); }
+		bool consumeUsed() const { return used.exchange(false, std::memory_order_relaxed); }
+
+		size_t getMemoryUsage() const override;
+		bool reduceMemoryUsage() override; // Streamed textures drop back to their smallest levels, unless they're being drawn
+
 	protected:
 		Vector2i size;
+
+	private:
+		bool streamed = false;
+		mutable std::atomic<bool> used{ false };
+		std::atomic<bool> lowResolutionRequested{ false };
+		std::atomic<size_t> memoryUsage{ 0 }; // Set when loading, and by the streamer as its residency changes
+		std::unique_ptr<Bytes> reloadPixels; // Copy of what was uploaded, kept while hot reloading to diff reimports against
 	};
 }
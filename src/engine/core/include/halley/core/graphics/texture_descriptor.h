@@ -11,17 +11,29 @@ namespace Halley
 		Indexed,
 		RGB,
 		RGBA,
-		DEPTH
+		DEPTH,
+
+		// Block compressed, uploaded as-is
+		BC1,
+		BC3,
+		BC7,
+		ETC2,
+		ASTC4x4
 	};
 
 	template <>
 	struct EnumNames<TextureFormat> {
-		constexpr std::array<const char*, 4> operator()() const {
+		constexpr std::array<const char*, 9> operator()() const {
 			return{{
 				"indexed",
 				"rgb",
 				"rgba",
-				"depth"
+				"depth",
+				"bc1",
+				"bc3",
+				"bc7",
+				"etc2",
+				"astc4x4"
 			}};
 		}
 	};
@@ -53,6 +65,9 @@ namespace Halley
 		Maybe<int> getStride() const;
 		int getStrideOr(int assumedStride) const;
 
+		// With explicit mip levels, data holds every level back to back, starting with the largest
+		gsl::span<const gsl::byte> getMipLevel(TextureFormat format, Vector2i size, int level) const;
+
 	private:
 		std::unique_ptr<Image> img;
 		Bytes rawBytes;
@@ -68,6 +83,7 @@ namespace Halley
 		TextureFormat format = TextureFormat::RGBA;
 		PixelDataFormat pixelFormat = PixelDataFormat::Image;
 		TextureDescriptorImageData pixelData;
+		int mipLevels = 1;
 
 		bool useMipMap = false;
 		bool useFiltering = false;
@@ -84,5 +100,9 @@ namespace Halley
 		TextureDescriptor& operator=(TextureDescriptor&& other) noexcept;
 
 		static int getBitsPerPixel(TextureFormat format);
+		static bool isCompressed(TextureFormat format);
+		static size_t getCompressedSize(TextureFormat format, Vector2i size);
+		static size_t getDataSize(TextureFormat format, Vector2i size);
+		static Vector2i getMipLevelSize(Vector2i size, int level);
 	};
 }
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "texture_descriptor.h"
+#include "halley/concurrency/future.h"
+#include "halley/data_structures/vector.h"
+#include <memory>
+#include <mutex>
+
+namespace Halley
+{
+	class Texture;
+	class VideoAPI;
+
+	// Keeps the GPU memory used by large textures within a budget.
+	// Streamed textures start with only their smallest mip levels resident. Once the painter draws one, its full mip
+	// chain is uploaded on the video aux thread. If that would go over budget, the textures that have gone unused for
+	// longest drop back to their smallest levels to make room.
+	// Only textures imported with a mip chain can be streamed; the whole chain stays in system memory.
+	class TextureStreamer
+	{
+	public:
+		explicit TextureStreamer(VideoAPI& video);
+		~TextureStreamer();
+
+		void setEnabled(bool enabled);
+		bool isEnabled() const;
+
+		void setBudget(size_t bytes);
+		size_t getBudget() const;
+		size_t getResidentBytes() const;
+
+		// Takes the full mip chain of a texture that's being loaded, and loads only its smallest levels into it.
+		// Returns false if the texture can't be streamed, in which case it's left untouched.
+		bool add(const std::shared_ptr<Texture>& texture, TextureDescriptor& descriptor);
+
+		// Called by Core once per frame, while no frame is being submitted
+		void update();
+
+		constexpr static int lowResolutionSize = 64;
+		constexpr static int keepUsedFrames = 30;
+		constexpr static int maxUploadsPerFrame = 4;
+
+	private:
+		struct Settings
+		{
+			Vector2i size;
+			TextureFormat format;
+			int mipLevels;
+			bool useFiltering;
+			bool clamp;
+		};
+
+		struct Entry
+		{
+			std::weak_ptr<Texture> texture;
+			Settings settings;
+			std::shared_ptr<const Bytes> data;
+			int minLevel = 0;
+			int lowLevel = 0;
+			int residentLevel = 0;
+			int pendingLevel = -1;
+			size_t accountedBytes = 0;
+			uint64_t lastUsedFrame = 0;
+			Future<std::shared_ptr<Texture>> pending;
+		};
+
+		VideoAPI& video;
+		bool enabled = false;
+		size_t budget = 1024 * 1024 * 1024;
+		size_t residentBytes = 0;
+		uint64_t frame = 0;
+
+		Vector<Entry> entries;
+		Vector<Entry> incoming;
+		std::mutex mutex;
+
+		void startUpload(Entry& entry, int level);
+		bool finishUpload(Entry& entry);
+		bool makeRoom(size_t bytes, const Entry& forEntry, int& uploadsLeft);
+
+		static size_t getResidentSize(const Settings& settings, int level);
+		static TextureDescriptor makeDescriptor(const Settings& settings, const Bytes& data, int level);
+	};
+}
@@ -13,9 +13,14 @@ namespace Halley {} // Get GitHub to realise this is C++ :3
 #include "graphics/blend.h"
 #include "graphics/painter.h"
 #include "graphics/render_context.h"
+#include "graphics/render_graph.h"
+#include "graphics/dynamic_resolution.h"
+#include "graphics/render_command_list.h"
+#include "graphics/static_geometry.h"
 #include "graphics/shader.h"
 #include "graphics/texture.h"
 #include "graphics/texture_descriptor.h"
+#include "graphics/texture_streamer.h"
 
 #include "graphics/material/material.h"
 #include "graphics/material/material_definition.h"
@@ -26,16 +31,22 @@ namespace Halley {} // Get GitHub to realise this is C++ :3
 #include "graphics/render_target/render_target.h"
 #include "graphics/render_target/render_target_screen.h"
 #include "graphics/render_target/render_target_texture.h"
+#include "graphics/render_target/render_target_pool.h"
 
 #include "graphics/text/font.h"
+#include "graphics/text/glyph_atlas.h"
 #include "graphics/text/text_renderer.h"
 
 #include "graphics/sprite/animation.h"
 #include "graphics/sprite/animation_player.h"
 #include "graphics/sprite/sprite.h"
 #include "graphics/sprite/sprite_painter.h"
+#include "graphics/sprite/static_sprite_batch.h"
+#include "graphics/sprite/runtime_atlas.h"
 #include "graphics/sprite/sprite_sheet.h"
 
+#include "graphics/particles/particle_emitter.h"
+
 #include "graphics/window.h"
 
 #include "input/input_joystick.h"
@@ -53,6 +64,7 @@ namespace Halley {} // Get GitHub to realise this is C++ :3
 #include "stage/stage.h"
 #include "stage/entity_stage.h"
 
+#include "utils/network_stats_view.h"
 #include "utils/world_stats.h"
 
 #include "devcon/devcon_client.h"
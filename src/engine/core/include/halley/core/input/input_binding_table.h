@@ -0,0 +1,59 @@
+#pragma once
+
+#include "input_device.h"
+#include "halley/data_structures/vector.h"
+#include <memory>
+#include <set>
+
+namespace Halley {
+	using spInputDevice = std::shared_ptr<InputDevice>;
+
+	// The button and axis bindings of an InputVirtual. Button bindings are also kept grouped by device, so that
+	// InputVirtual::update can read every button of every device once and work out all the virtual buttons from that.
+	// An InputVirtual can have a table per input context (e.g. gameplay, menus, vehicle), switching with setBindings.
+	class InputBindingTable {
+	public:
+		InputBindingTable(int nButtons, int nAxes);
+
+		size_t getNumberButtons() const;
+		size_t getNumberAxes() const;
+
+		void bindButton(int n, spInputDevice device, int deviceN);
+		void bindAxis(int n, spInputDevice device, int deviceN);
+		void bindAxisButton(int n, spInputDevice device, int negativeButton, int positiveButton);
+
+		void unbindButton(int n);
+		void unbindAxis(int n);
+		void clear();
+
+		std::set<spInputDevice> getAllDevices() const;
+
+	private:
+		friend class InputVirtual;
+
+		struct Bind {
+			spInputDevice device;
+			int a = -1;
+			int b = -1;
+			bool isAxis = false;
+			bool isAxisEmulation = false;
+
+			Bind(spInputDevice d, int n, bool axis);
+			Bind(spInputDevice d, int _a, int _b, bool axis);
+		};
+
+		struct DeviceButtons {
+			InputDevice* device;
+			Vector<std::pair<int, int>> buttons; // Virtual button, device button
+		};
+
+		Vector<Vector<Bind>> buttons;
+		Vector<Vector<Bind>> axes;
+
+		Vector<DeviceButtons> byDevice;
+		uint64_t version = 1; // Changes with the button bindings
+		uint64_t byDeviceVersion = 0;
+
+		const Vector<DeviceButtons>& getButtonsByDevice();
+	};
+}
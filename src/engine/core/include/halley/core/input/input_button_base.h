@@ -53,6 +53,9 @@ namespace Halley {
 		void setParent(InputDevice* parent) override;
 		InputDevice* getParent() const override;
 
+		// Changes whenever a button of any device changes state, so cached state (see InputVirtual::update) can tell it's stale
+		static uint64_t getStateGeneration();
+
 	protected:
 		Vector<char> buttonPressed;
 		Vector<char> buttonPressedRepeat;
@@ -64,6 +67,8 @@ namespace Halley {
 
 		virtual void onButtonPressed(int code);
 		virtual void onButtonReleased(int code);
+
+		static void onStateChanged();
 	};
 
 	typedef std::shared_ptr<InputButtonBase> spInputButtonBase;
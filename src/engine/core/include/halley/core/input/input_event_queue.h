@@ -0,0 +1,58 @@
+#pragma once
+
+#include <halley/maths/vector2.h>
+#include <halley/data_structures/vector.h>
+#include <cstdint>
+#include <mutex>
+
+namespace Halley {
+	enum class InputEventType : uint8_t {
+		KeyDown,
+		KeyUp,
+		MouseMotion,
+		MouseButtonDown,
+		MouseButtonUp,
+		MouseWheel,
+		JoystickAxis,
+		JoystickButtonDown,
+		JoystickButtonUp,
+		JoystickHat,
+		TouchDown,
+		TouchMotion,
+		TouchUp
+	};
+
+	struct InputEvent {
+		int64_t timeNs = 0; // See InputEventQueue::getTimeNs
+		InputEventType type = InputEventType::KeyDown;
+		int device = 0; // Index of the keyboard, mouse or joystick in InputAPI, or finger id for touches
+		int code = 0; // Key, button, axis or hat
+		Vector2f value; // Mouse or touch position, axis value (in x), wheel move or hat direction
+	};
+
+	// Every input event, in the order they happened, for when the per-frame state of the devices isn't enough: all the
+	// mouse samples in a frame, a press and release within the same frame, or the exact time of a button press.
+	// Events can be pushed from any thread. Once maxEvents are waiting, the oldest are dropped.
+	class InputEventQueue {
+	public:
+		explicit InputEventQueue(size_t maxEvents = 4096);
+
+		static int64_t getTimeNs(); // Monotonic, on the same clock as the Profiler
+
+		void push(const InputEvent& event);
+		void push(InputEventType type, int device, int code, Vector2f value = {}); // Timestamped now
+
+		// Everything since the last call, sorted by time. Taking them late in the frame (e.g. just before rendering)
+		// gets input that arrived after the frame started, if it's being sampled on a thread (see InputAPI::setSamplingRate).
+		Vector<InputEvent> take();
+		Vector<InputEvent> takeUntil(int64_t timeNs);
+
+		size_t getDroppedCount() const;
+
+	private:
+		mutable std::mutex mutex;
+		size_t maxEvents;
+		size_t dropped = 0;
+		Vector<InputEvent> events;
+	};
+}
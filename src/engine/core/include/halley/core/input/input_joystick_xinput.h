@@ -23,8 +23,10 @@
 
 #include "input_joystick.h"
 #ifdef XINPUT_AVAILABLE
+#include <array>
 
 namespace Halley {
+	class InputEventQueue;
 
 	// XInput implementation
 	class InputJoystickXInput : public InputJoystick {
@@ -38,10 +40,20 @@ namespace Halley {
 		void update(Time t) override;
 		int getButtonAtPosition(JoystickButtonPosition position) const override;
 
+		// For the input sampling thread: pushes whatever changed since the last poll. Keeps its own copy of the state,
+		// so it doesn't race with update().
+		void pollEvents(InputEventQueue& queue, int device);
+
 	private:
 		int index;
 		int cooldown;
 
+		uint32_t polledPacket = 0;
+		int polledCooldown = 0;
+		std::array<float, 6> polledAxes = {};
+		uint32_t polledButtons = 0;
+		Vector2f polledHat;
+
 		void setVibration(float low, float high) override;
 	};
 }
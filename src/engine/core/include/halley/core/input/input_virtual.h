@@ -22,13 +22,15 @@
 #pragma once
 
 #include "input_button_base.h"
+#include "input_binding_table.h"
 #include "halley/maths/rect.h"
 #include "halley/data_structures/maybe.h"
 #include <set>
 
 namespace Halley {
-	using spInputDevice = std::shared_ptr<InputDevice>;
-
+	// Buttons and axes made out of other devices' ones. After update(), the state of every button is cached, so
+	// querying it is a bit test; until then, or if any device changes after it (e.g. clearButtonPress), they're
+	// worked out from the bindings on each query, as before.
 	class InputVirtual : public InputDevice {
 	public:
 		InputVirtual(int nButtons, int nAxes);
@@ -81,6 +83,10 @@ namespace Halley {
 		void unbindAxis(int n);
 		void clearBindings();
 
+		// Swaps the button and axis bindings, e.g. for a different input context; the table must have the same number of each
+		void setBindings(std::shared_ptr<InputBindingTable> bindings);
+		std::shared_ptr<InputBindingTable> getBindings() const;
+
 		void update(Time t);
 
 		void setRepeat(float first, float hold);
@@ -91,29 +97,19 @@ namespace Halley {
 		JoystickType getJoystickType() const override;
 
 	private:
+		using Bind = InputBindingTable::Bind;
+
 		void setLastDevice(InputDevice* device);
 		void updateLastDevice();
-
-		struct Bind {
-			spInputDevice device;
-			int a = -1;
-			int b = -1;
-			bool isAxis = false;
-			bool isAxisEmulation = false;
-
-			Bind(spInputDevice d, int n, bool axis);
-			Bind(spInputDevice d, int _a, int _b, bool axis);
-		};
+		void updateButtonCache();
+		bool isCacheValid() const;
+		bool testBit(const Vector<uint64_t>& bits, int n) const;
 
 		struct AxisData {
-			Vector<Bind> binds;
 			int lastRepeatedValue = 0;
 			int numRepeats = 0;
 			int curRepeatValue = 0;
 			Time timeSinceRepeat = 0;
-
-			AxisData();
-			explicit AxisData(Vector<Bind>& b);
 		};
 
 		struct PositionBindData
@@ -130,9 +126,17 @@ namespace Halley {
 			explicit PositionBindData(spInputDevice device, int axisX, int axisY, float speed);
 		};
 
-		Vector<Vector<Bind>> buttons;
+		std::shared_ptr<InputBindingTable> bindings;
 		Vector<AxisData> axes;
 
+		// One bit per virtual button
+		Vector<uint64_t> downBits;
+		Vector<uint64_t> pressedBits;
+		Vector<uint64_t> pressedRepeatBits;
+		Vector<uint64_t> releasedBits;
+		uint64_t cacheGeneration = 0;
+		uint64_t cacheBindingsVersion = 0; // 0 if there's no cache
+
 		Vector<PositionBindData> positions;
 		Maybe<Rect4f> positionLimits;
 		Vector2f position;
@@ -145,8 +149,6 @@ namespace Halley {
 		
 		float repeatDelayFirst;
 		float repeatDelayHold;
-
-		std::set<spInputDevice> getAllDevices() const;
 	};
 
 	typedef std::shared_ptr<InputVirtual> spInputVirtual;
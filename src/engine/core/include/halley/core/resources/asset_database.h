@@ -1,9 +1,13 @@
 #pragma once
 
 #include "halley/text/halleystring.h"
+#include "halley/utils/utils.h"
 #include "halley/data_structures/tree_map.h"
 #include "halley/data_structures/hash_map.h"
 #include "halley/resources/metadata.h"
+#include <gsl/gsl>
+#include <memory>
+#include <mutex>
 
 namespace Halley
 {
@@ -25,30 +29,66 @@ namespace Halley
 			void deserialize(Deserializer& s);
 		};
 
+		// Entries added here, or looked up in place in a table loaded from the flat format (see AssetDatabase::load),
+		// where each one is only decoded the first time it's asked for. Safe to read from several threads.
 		class TypedDB
 		{
+			friend class AssetDatabase;
+
 		public:
+			TypedDB();
+
 			void add(const String& name, Entry&& asset);
 			const Entry& get(const String& name) const;
+			bool contains(const String& name) const;
+			size_t size() const;
+			std::vector<String> getNames() const;
 
 			void serialize(Serializer& s) const;
 			void deserialize(Deserializer& s);
 
+			// Decodes anything in the table that hasn't been yet, so avoid it on large databases at runtime
 			const HashMap<String, Entry>& getAssets() const;
 
 		private:
-			HashMap<String, Entry> assets;
+			mutable HashMap<String, Entry> assets;
+			mutable std::unique_ptr<std::mutex> mutex;
+			gsl::span<const gsl::byte> flatData; // All of the AssetDatabase's, owned by it or whoever loaded it
+			size_t flatRecordsPos = 0;
+			size_t numFlatRecords = 0;
+
+			void setFlat(gsl::span<const gsl::byte> data, size_t recordsPos, size_t numRecords);
+			size_t findFlat(const String& name) const; // numFlatRecords if not there
+			String getFlatName(size_t idx) const;
+			Entry decodeFlat(size_t idx) const;
 		};
 
 		void addAsset(const String& name, AssetType type, Entry&& entry);
 		const TypedDB& getDatabase(AssetType type) const;
 		std::vector<String> getAssets() const;
+		std::vector<String> enumerate(AssetType type) const;
 
+		// The flat format is a table per type, sorted by 64-bit hash of each name and pointing at where each entry's
+		// name and serialized data are, so nothing needs to be decoded to load it, and looking things up doesn't allocate.
+		// Loading detects and still reads databases serialized the old way.
+		Bytes toBytes() const;
+		void load(Bytes data);
+		void load(gsl::span<const gsl::byte> data); // Looked up in place if it's in the flat format, so it must outlive this
+		static bool isFlat(gsl::span<const gsl::byte> data);
+
+		// The old format, deserialized entry by entry
 		void serialize(Serializer& s) const;
 		void deserialize(Deserializer& s);
-		std::vector<String> enumerate(AssetType type) const;
+
+		// Other assets an asset needs, e.g. a sprite sheet's texture, recorded by its importer. They're kept in the asset's
+		// metadata, so they carry over into packs as they are.
+		static void addDependency(Metadata& meta, AssetType type, const String& name);
+		static std::vector<std::pair<AssetType, String>> getDependencies(const Metadata& meta);
 
 	private:
-		mutable TreeMap<int, TypedDB> dbs;
+		TreeMap<int, TypedDB> dbs;
+		Bytes ownedData;
+
+		void loadFlat(gsl::span<const gsl::byte> data);
 	};
 }
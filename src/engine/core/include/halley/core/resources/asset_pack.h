@@ -12,6 +12,8 @@ namespace Halley {
 	class AssetDatabase;
 	class ResourceData;
 	class ResourceDataReader;
+	class MappedFile;
+	class Metadata;
 
 	struct AssetPackHeader {
 		std::array<char, 8> identifier;
@@ -22,12 +24,41 @@ namespace Halley {
 		void init(size_t assetDbSize);
 	};
 
+	// Where each chunk of an asset that was compressed or encrypted is, in the pack's data
+	struct AssetPackChunkTable {
+		String asset;
+		size_t size = 0; // Once decoded
+		bool encrypted = false;
+		Vector<size_t> offsets; // One per chunk, plus where the last one ends
+		Vector<bool> compressed;
+
+		size_t getNumChunks() const;
+		size_t getChunkSize(size_t chunk) const; // Once decoded
+	};
+
+	// An asset as it's stored in a pack's data, see AssetPack::encodeAsset
+	struct AssetPackEncodedAsset {
+		Bytes data;
+		size_t size = 0; // Once decoded
+		String flags; // "z" if compressed, "e" if encrypted, empty if stored as-is (in which case data is the asset itself)
+	};
+
+	// Summed over chunks read in parallel, to tell how much of the wait was unpacking, see ResourceLoadTiming
+	struct AssetPackChunkTiming {
+		std::atomic<int64_t> read{ 0 };
+		std::atomic<int64_t> unpack{ 0 };
+	};
+
     class AssetPack {
     public:
 		AssetPack();
 		AssetPack(const AssetPack& other) = delete;
 		AssetPack(AssetPack&& other);
 		AssetPack(std::unique_ptr<ResourceDataReader> reader, const String& encryptionKey = "", bool preLoad = false);
+
+		// Static assets stored as-is are handed out as views into the mapping, and nothing needs locking to read from it.
+		// Packs encrypted as a whole (as they used to be) still get decrypted into memory.
+		AssetPack(std::shared_ptr<MappedFile> mapping, const String& encryptionKey = "");
 		~AssetPack();
 
 		AssetPack& operator=(const AssetPack& other) = delete;
@@ -39,9 +70,31 @@ namespace Halley {
 		const Bytes& getData() const;
 
 		Bytes writeOut() const;
+		Bytes writeOutHeader() const; // Everything before the data, which can then be written after it, e.g. when it wasn't kept in memory
 
 		std::unique_ptr<ResourceData> getData(const String& asset, AssetType type, bool stream);
 
+		// Assets are split into chunks, each compressed (if that helps) and encrypted (if there's a key) on its own,
+		// so they can be decoded in parallel, or streamed. Ones that were neither are stored as they are.
+		void addAsset(const String& name, AssetType type, gsl::span<const gsl::byte> asset, const Metadata& meta, const String& encryptionKey = "");
+		constexpr static size_t chunkSize = 256 * 1024;
+
+		// The two halves of addAsset, for when the data is written somewhere else by the caller. encodeAsset is thread-safe,
+		// and spreads the chunks over the CPU; pos is where the data was written, relative to the start of the data.
+		static AssetPackEncodedAsset encodeAsset(gsl::span<const gsl::byte> asset, const String& encryptionKey = "");
+		void addEncodedAsset(const String& name, AssetType type, size_t pos, const AssetPackEncodedAsset& asset, const Metadata& meta);
+
+		// Another entry for data that's already in this pack, e.g. a duplicated sprite
+		void addAssetAlias(const String& name, AssetType type, const String& existingName, AssetType existingType, const Metadata& meta);
+
+		// An entry whose data is another asset's, kept in another pack that's always loaded along with this one.
+		// ResourceLocator reads it from there instead.
+		void addSharedAsset(const String& name, AssetType type, const String& sourceName, AssetType sourceType, const Metadata& meta);
+		static bool getSharedSource(const String& entryPath, AssetType& sourceType, String& sourceName);
+
+		AssetPackChunkTable readChunkTable(const String& asset, size_t pos, size_t storedSize, size_t size, bool encrypted);
+		void readChunk(const AssetPackChunkTable& table, size_t chunk, gsl::span<gsl::byte> dst, AssetPackChunkTiming* timing = nullptr);
+
 		void readToMemory();
 		void encrypt(const String& key);
 		void decrypt(const String& key);
@@ -57,7 +110,15 @@ namespace Halley {
 		std::mutex readerMutex;
 		size_t dataOffset = 0;
 		Bytes data;
+		std::shared_ptr<MappedFile> mapping;
+		std::shared_ptr<MappedFile> assetDbMapping;
+		gsl::span<const gsl::byte> mappedData;
 		std::array<char, 16> iv;
+		String encryptionKey;
+
+		void readHeader(const AssetPackHeader& header, gsl::span<const gsl::byte> assetDbBytes); // Kept alive by assetDbMapping
+		void readHeader(const AssetPackHeader& header, Bytes assetDbBytes);
+		bool isEncryptedAsAWhole() const; // As packs used to be, before assets were encrypted on their own
     };
 
 
@@ -76,6 +137,24 @@ namespace Halley {
 		const size_t startPos;
 		const size_t fileSize;
 		size_t curPos = 0;
-		mutable std::mutex mutex;
+	};
+
+	// Decodes one chunk at a time, as it's read
+	class ChunkedPackDataReader : public ResourceDataReader {
+	public:
+		ChunkedPackDataReader(AssetPack& pack, std::shared_ptr<const AssetPackChunkTable> table);
+
+		size_t size() const override;
+		int read(gsl::span<gsl::byte> dst) override;
+		void seek(int64_t pos, int whence) override;
+		size_t tell() const override;
+		void close() override;
+
+	private:
+		AssetPack& pack;
+		std::shared_ptr<const AssetPackChunkTable> table;
+		size_t curPos = 0;
+		size_t curChunk = size_t(-1);
+		Bytes chunkData;
 	};
 }
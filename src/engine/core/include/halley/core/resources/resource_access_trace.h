@@ -0,0 +1,44 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+#include <halley/text/halleystring.h>
+#include <halley/utils/utils.h>
+
+namespace Halley {
+	enum class AssetType;
+
+	// Records when each asset is first requested within each section of a play session (normally one per stage), so
+	// packs can be laid out in the order they're read, and each section's assets preloaded.
+	// Stored as text, one "seconds<TAB>section<TAB>type:name" line per entry, in the order they were recorded.
+	class ResourceAccessTrace {
+	public:
+		struct Entry {
+			double time;
+			String section;
+			String asset; // "type:name", as in pack manifests
+		};
+
+		ResourceAccessTrace();
+		explicit ResourceAccessTrace(const Bytes& data);
+
+		void setSection(const String& section);
+		void record(const String& asset, AssetType type);
+
+		std::vector<Entry> getEntries() const;
+		std::vector<String> getSections() const;
+
+		Bytes toBytes() const;
+
+	private:
+		mutable std::mutex mutex;
+		std::chrono::steady_clock::time_point start;
+		String section;
+		std::unordered_set<String> seen; // "section:type:name"
+		std::vector<Entry> entries;
+
+		void add(Entry entry);
+	};
+}
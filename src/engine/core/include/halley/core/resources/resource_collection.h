@@ -6,6 +6,7 @@
 #include <halley/text/halleystring.h>
 #include <halley/resources/resource_data.h>
 #include <halley/data_structures/hash_map.h>
+#include <halley/concurrency/future.h>
 
 namespace Halley
 {
@@ -13,24 +14,42 @@ namespace Halley
 	class Resource;
 	class Resources;
 	class ResourceLoader;
+	class ResourceLoadQueue;
+	class Metadata;
+
+	// Someone waiting on an asynchronous load. Type erased, so the load queue doesn't need to know what it's loading.
+	struct ResourceLoadWaiter
+	{
+		std::function<bool()> isWanted;
+		std::function<void(std::shared_ptr<Resource>)> deliver;
+	};
 
 	class ResourceCollectionBase
 	{
+		friend class ResourceLoadQueue;
+		friend class Resources;
+
 		class Wrapper
 		{
 		public:
 			Wrapper(Wrapper&& other) noexcept
 				: res(std::move(other.res))
 				, depth(other.depth)
+				, lastUsed(other.lastUsed)
+				, evictable(other.evictable)
 			{}
 
-			Wrapper(std::shared_ptr<Resource> resource, int loadDepth)
+			Wrapper(std::shared_ptr<Resource> resource, int loadDepth, uint64_t lastUsed = 0, bool evictable = false)
 				: res(resource)
 				, depth(loadDepth)
+				, lastUsed(lastUsed)
+				, evictable(evictable)
 			{}
 
 			std::shared_ptr<Resource> res;
 			int depth;
+			uint64_t lastUsed; // Resources::update tick it was last asked for
+			bool evictable; // Only if it was loaded here, so it can be loaded again
 		};
 
 	public:
@@ -47,22 +66,38 @@ namespace Halley
 		void unloadAll(int minDepth = 0);
 		bool exists(const String& assetId);
 
-		void reload(const String& assetId);
+		// Tries the type's updateInPlace first, with prefetched data if there is any (see Resources::reloadAssets)
+		void reload(const String& assetId, std::unique_ptr<ResourceDataStatic> prefetched = {});
 		void purge(const String& assetId);
 
 		std::vector<String> enumerate() const;
 
+		// Once the resources loaded here add up to more than this (0 for no limit), the least recently used ones are
+		// asked to reduceMemoryUsage, and then ones that nothing outside of the cache holds on to are unloaded.
+		// Checked in Resources::update, so it can be briefly exceeded.
+		void setMemoryBudget(size_t bytes);
+		size_t getMemoryBudget() const;
+		size_t getMemoryUsage() const;
+
 	protected:
 		virtual std::shared_ptr<Resource> loadResource(ResourceLoader& loader) = 0;
+		virtual bool loadsFromStream(const Metadata& meta) const = 0;
+		virtual bool updateInPlace(Resource& resource, ResourceLoader& loader) = 0;
 
 		std::shared_ptr<Resource> doGet(const String& name, ResourceLoadPriority priority);
-		std::shared_ptr<Resource> loadAsset(const String& assetId, ResourceLoadPriority priority);
+		void doGetAsync(const String& name, ResourceLoadPriority priority, ResourceLoadWaiter waiter);
+		std::shared_ptr<Resource> loadAsset(const String& assetId, ResourceLoadPriority priority, std::unique_ptr<ResourceDataStatic> prefetched = {}, std::shared_ptr<ResourceLoadTiming> timing = {});
+		std::shared_ptr<Resource> finishAsyncLoad(const String& assetId, ResourceLoadPriority priority, std::unique_ptr<ResourceDataStatic> prefetched, std::shared_ptr<ResourceLoadTiming> timing);
 
 	private:
 		Resources& parent;
 		HashMap<String, Wrapper> resources;
 		AssetType type;
 		ResourceLoaderFunc resourceLoader;
+		size_t memoryBudget = 0;
+
+		std::shared_ptr<Resource> store(const String& assetId, std::shared_ptr<Resource> resource);
+		void enforceMemoryBudget();
 	};
 
 	template <typename T>
@@ -80,9 +115,41 @@ namespace Halley
 			return std::static_pointer_cast<T>(doGet(assetId, priority));
 		}
 
+		// The future is set on the main thread, to null if loading failed. The load is cancelled if every copy of the
+		// future is dropped before it's done, so hold on to it (futures made from it with then() don't count).
+		Future<std::shared_ptr<const T>> getAsync(const String& assetId, ResourceLoadPriority priority = ResourceLoadPriority::Normal)
+		{
+			auto data = std::make_shared<FutureData<std::shared_ptr<const T>>>();
+			std::weak_ptr<FutureData<std::shared_ptr<const T>>> weak = data;
+
+			ResourceLoadWaiter waiter;
+			waiter.isWanted = [weak] ()
+			{
+				auto d = weak.lock();
+				return d && !d->isCancelled();
+			};
+			waiter.deliver = [weak] (std::shared_ptr<Resource> res)
+			{
+				if (auto d = weak.lock()) {
+					d->set(std::static_pointer_cast<const T>(res));
+				}
+			};
+			doGetAsync(assetId, priority, std::move(waiter));
+
+			return Future<std::shared_ptr<const T>>(data);
+		}
+
 	protected:
 		std::shared_ptr<Resource> loadResource(ResourceLoader& loader) override {
 			return T::loadResource(loader);
 		}
+
+		bool loadsFromStream(const Metadata& meta) const override {
+			return T::loadsFromStream(meta);
+		}
+
+		bool updateInPlace(Resource& resource, ResourceLoader& loader) override {
+			return T::updateInPlace(static_cast<T&>(resource), loader);
+		}
 	};
 }
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <halley/text/halleystring.h>
+#include <halley/utils/utils.h>
+
+namespace Halley {
+	enum class AssetType;
+	struct ResourceLoadTiming;
+
+	// Records how long each resource load spent on each stage, and whether the main thread had to wait for it, to find
+	// out what's behind a stall. Written out as CSV, one row per load, in the order they were requested.
+	class ResourceLoadTrace {
+	public:
+		struct Entry {
+			double time; // Seconds since the trace started, when it was requested
+			String asset; // "type:name"
+			bool mainThread; // Loaded synchronously on the main thread, which waited for it
+			bool async; // Went through the load queue
+			std::shared_ptr<const ResourceLoadTiming> timing; // Still being added to by any stages that finish later
+		};
+
+		ResourceLoadTrace(); // On the main thread
+
+		// Makes the timing that a load should report to
+		std::shared_ptr<ResourceLoadTiming> start(const String& asset, AssetType type, bool async);
+
+		std::vector<Entry> getEntries() const;
+		void clear();
+
+		Bytes toCSV() const;
+
+	private:
+		mutable std::mutex mutex;
+		const std::thread::id mainThreadId;
+		const int64_t startTime;
+		std::vector<Entry> entries;
+	};
+}
@@ -22,6 +22,7 @@
 #pragma once
 
 #include <ctime>
+#include <functional>
 #include <halley/text/halleystring.h>
 #include <halley/resources/resource_data.h>
 #include <halley/data_structures/hash_map.h>
@@ -32,6 +33,7 @@ namespace Halley {
 	class ResourceData;
 	class SystemAPI;
 	class AssetDatabase;
+	class ResourceAccessTrace;
 
 	class IResourceLocatorProvider {
 	public:
@@ -40,6 +42,19 @@ namespace Halley {
 		virtual const AssetDatabase& getAssetDatabase() = 0;
 		virtual int getPriority() const { return 0; }
 		virtual void purge(SystemAPI& system) = 0;
+
+		// Where the asset's data starts within whatever this provider reads from, for ordering reads
+		virtual uint64_t getDataOffset(const String& asset, AssetType type) { return 0; }
+	};
+
+	struct ResourceDataLocation {
+		const IResourceLocatorProvider* provider = nullptr;
+		uint64_t offset = 0;
+
+		bool operator<(const ResourceDataLocation& other) const
+		{
+			return provider != other.provider ? std::less<const IResourceLocatorProvider*>()(provider, other.provider) : offset < other.offset;
+		}
 	};
 
 	class ResourceLocator : public IResourceLocator
@@ -55,15 +70,21 @@ namespace Halley {
 		std::unique_ptr<ResourceDataStatic> getStatic(const String& asset, AssetType type) override;
 		std::unique_ptr<ResourceDataStream> getStream(const String& asset, AssetType type) override;
 		void purge(const String& asset, AssetType type);
+		ResourceDataLocation getDataLocation(const String& asset, AssetType type);
 
 		std::vector<String> enumerate(const AssetType type);
 		bool exists(const String& asset);
 
+		// Records every asset read from here on, see ResourceAccessTrace
+		void setAccessTrace(std::shared_ptr<ResourceAccessTrace> trace);
+
 	private:
 		SystemAPI& system;
+		std::shared_ptr<ResourceAccessTrace> accessTrace;
 		HashMap<String, IResourceLocatorProvider*> locators;
 		Vector<std::unique_ptr<IResourceLocatorProvider>> locatorList;
 
 		std::unique_ptr<ResourceData> getResource(const String& asset, AssetType type, bool stream);
+		void resolveSharedData(String& asset, AssetType& type) const;
 	};
 }
@@ -31,7 +31,24 @@
 namespace Halley {
 	
 	class ResourceLocator;
+	class ResourceLoadQueue;
+	class ResourceLoadTrace;
 	class HalleyAPI;
+
+	// Progress of a Resources::preload, updated on the main thread. Dropping it cancels whatever hasn't been loaded yet.
+	class ResourcePreload {
+		friend class Resources;
+
+	public:
+		size_t getNumAssets() const { return numAssets; }
+		size_t getNumDone() const { return numDone; } // Failures included, they're logged
+		float getProgress() const { return numAssets > 0 ? float(numDone) / float(numAssets) : 1.0f; }
+		bool isDone() const { return numDone == numAssets; }
+
+	private:
+		size_t numAssets = 0;
+		size_t numDone = 0;
+	};
 	
 	class Resources {
 		friend class ResourceCollectionBase;
@@ -57,7 +74,11 @@ namespace Halley {
 
 		ResourceCollectionBase& ofType(AssetType assetType) const
 		{
-			return *resources[int(assetType)];
+			auto& collection = resources[int(assetType)];
+			if (!collection) {
+				throw Exception("Resource type not initialised: " + toString(assetType), HalleyExceptions::Resources);
+			}
+			return *collection;
 		}
 
 		template <typename T>
@@ -66,6 +87,40 @@ namespace Halley {
 			return of<T>().get(name, priority);
 		}
 
+		// Reads on the disk IO thread, highest priority first, then decodes on the CPU workers and finishes on the main thread
+		template <typename T>
+		Future<std::shared_ptr<const T>> getAsync(const String& name, ResourceLoadPriority priority = ResourceLoadPriority::Normal) const
+		{
+			return of<T>().getAsync(name, priority);
+		}
+
+		size_t getNumPendingLoads() const;
+
+		// Loads every "type:name" listed (e.g. in one of the packer's preload manifests) and everything they depend on,
+		// dependencies first, through the same queue as getAsync
+		std::shared_ptr<ResourcePreload> preload(const std::vector<String>& assets, ResourceLoadPriority priority = ResourceLoadPriority::Normal);
+
+		// See ResourceCollectionBase::setMemoryBudget
+		void setMemoryBudget(AssetType type, size_t bytes);
+		size_t getMemoryUsage(AssetType type) const;
+
+		// Reloads every "type:name" listed that is currently loaded, e.g. after a reimport. Their data is read and inflated
+		// in the background, then the whole batch is applied on one update, in type order, since types depend on earlier ones.
+		void reloadAssets(const std::vector<String>& assets);
+
+		// Records every load from here on, see ResourceLoadTrace, or stops recording if null
+		void setLoadTrace(std::shared_ptr<ResourceLoadTrace> trace);
+		const std::shared_ptr<ResourceLoadTrace>& getLoadTrace() const;
+
+		// Set while connected to the editor, so types that can apply reimports in place keep what that needs when loading
+		void setHotReloadEnabled(bool enabled);
+		bool isHotReloadEnabled() const;
+
+		// Called by Core once per frame, on the main thread
+		void update();
+
+		constexpr static int memoryBudgetCheckInterval = 30; // In updates
+
 		template <typename T>
 		void unload(const String& name) const
 		{
@@ -91,8 +146,22 @@ namespace Halley {
 		}
 		
 	private:
+		struct PendingReload {
+			AssetType type;
+			String name;
+			bool prefetch = false; // Otherwise the data is left for the loader to get
+			Future<std::unique_ptr<ResourceDataStatic>> data;
+		};
+
 		const std::unique_ptr<ResourceLocator> locator;
 		Vector<std::unique_ptr<ResourceCollectionBase>> resources;
 		const HalleyAPI* const api;
+		uint64_t frame = 0;
+		bool hotReloadEnabled = false;
+		std::shared_ptr<ResourceLoadTrace> loadTrace;
+		std::unique_ptr<ResourceLoadQueue> loadQueue;
+		std::vector<std::vector<PendingReload>> pendingReloads; // Batches, applied in order
+
+		void applyReloads();
 	};
 }
@@ -8,5 +8,6 @@ namespace Halley
 	{
 	public:
 		static void initialize(Resources& resources);
+		static void initializeHeadless(Resources& resources); // Only data that doesn't need video or audio
 	};
 }
\ No newline at end of file
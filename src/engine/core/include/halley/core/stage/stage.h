@@ -13,6 +13,7 @@ namespace Halley
 	class VideoAPI;
 	class CoreAPI;
 	class Game;
+	struct TelemetryFrame;
 
 	class Stage
 	{
@@ -23,9 +24,32 @@ namespace Halley
 		virtual void onVariableUpdate(Time) {}
 		virtual void onRender(RenderContext&) const {}
 
+		// If this returns true, and the game renders on a separate thread, onRender is called on the render thread,
+		// while the next frame updates. onPrepareRender runs on the main thread first, right after the update, and must
+		// copy everything onRender is going to read, as the update is free to change it from then on.
+		virtual bool isRenderPipelined() const { return false; }
+		virtual void onPrepareRender() {}
+
 		virtual void init() {}
 
+		// Only called when the stage is set with CoreAPI::setStageAsync, on a worker thread, while the previous stage is
+		// still running. Anything slow that doesn't need the main thread (creating the world and its systems, loading
+		// data) can be done here, leaving init() to finish up once the stage is switched in.
+		virtual void prepare() {}
+
+		// "type:name" of assets to load before switching to this stage, along with everything they depend on.
+		// Called before init(), while the previous stage is still running.
+		virtual std::vector<String> getPreloadAssets() const { return {}; }
+
+		// Called on frames sampled for DevCon telemetry (see DevConServer::requestTelemetry), to add the stage's own values,
+		// e.g. World::addTelemetry
+		virtual void addTelemetry(TelemetryFrame& frame) const {}
+
+		// Appended to the report written at shutdown with --frame-time-report, one line per timer, e.g. World::getTimeReport
+		virtual String getTimeReport() const { return ""; }
+
 		const HalleyAPI& getAPI() const { return *api; }
+		const String& getName() const { return name; }
 
 	protected:
 		explicit Stage(String name = "unnamed");
@@ -0,0 +1,34 @@
+#pragma once
+#include "halley/core/graphics/text/text_renderer.h"
+#include "halley/net/connection/network_stats.h"
+#include <chrono>
+
+namespace Halley
+{
+	class CoreAPI;
+	class NetworkAPI;
+	class RenderContext;
+
+	// Overlay with the totals from NetworkAPI::getStats: traffic rates, loss, RTT and ack delay distributions,
+	// queue depths, and the busiest channels and message types
+	class NetworkStatsView
+	{
+	public:
+		NetworkStatsView(CoreAPI& coreApi, NetworkAPI& networkApi);
+
+		void draw(RenderContext& context);
+
+	private:
+		const NetworkAPI& networkAPI;
+		TextRenderer text;
+
+		NetworkStats lastStats;
+		std::chrono::steady_clock::time_point lastTime;
+		float bytesSentPerSecond = 0;
+		float bytesReceivedPerSecond = 0;
+
+		void updateRates(const NetworkStats& stats);
+		String formatHistogram(const NetworkHistogram& histogram) const;
+		String formatTraffic(const NetworkTrafficCounters& traffic) const;
+	};
+}
@@ -8,6 +8,7 @@ namespace Halley
 	class Resources;
 	class RenderContext;
 	class World;
+	class Painter;
 
 	class WorldStatsView
 	{
@@ -19,6 +20,7 @@ namespace Halley
 
 	private:
 		String formatTime(int64_t ns) const;
+		void drawMemoryStats(Painter& painter, Vector2f pos, float width); // Only in builds with memory tracking
 
 		const CoreAPI& coreAPI;
 		const World* world = nullptr;
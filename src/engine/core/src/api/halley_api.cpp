@@ -2,6 +2,7 @@
 #include "api/halley_api.h"
 #include <halley/plugin/plugin.h>
 #include "halley/audio/audio_facade.h"
+#include "halley/core/game/startup_profile.h"
 
 using namespace Halley;
 
@@ -39,31 +40,35 @@ void HalleyAPI::assign()
 	}
 }
 
-void HalleyAPI::init()
+void HalleyAPI::initSystem()
 {
 	if (systemInternal) {
 		systemInternal->init();
 	}
+}
+
+void HalleyAPI::initOthers(StartupProfile& profile)
+{
 	if (videoInternal) {
-		videoInternal->init();
+		profile.time("Video API", [&] () { videoInternal->init(); });
 	}
 	if (inputInternal) {
-		inputInternal->init();
+		profile.time("Input API", [&] () { inputInternal->init(); });
 	}
 	if (audioOutputInternal) {
-		audioOutputInternal->init();
+		profile.time("Audio output API", [&] () { audioOutputInternal->init(); });
 	}
 	if (audioInternal) {
-		audioInternal->init();
+		profile.time("Audio API", [&] () { audioInternal->init(); });
 	}
 	if (platformInternal) {
-		platformInternal->init();
+		profile.time("Platform API", [&] () { platformInternal->init(); });
 	}
 	if (networkInternal) {
-		networkInternal->init();
+		profile.time("Network API", [&] () { networkInternal->init(); });
 	}
 	if (movieInternal) {
-		movieInternal->init();
+		profile.time("Movie API", [&] () { movieInternal->init(); });
 	}
 }
 
@@ -88,6 +93,8 @@ void HalleyAPI::deInit()
 		inputInternal->deInit();
 	}
 	if (videoInternal) {
+		// Its textures belong to the video backend
+		videoInternal->getRenderTargetPool().clear();
 		videoInternal->deInit();
 	}
 	if (systemInternal) {
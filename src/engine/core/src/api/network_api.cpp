@@ -0,0 +1,9 @@
+#include "api/network_api.h"
+#include "halley/net/connection/network_stats.h"
+
+using namespace Halley;
+
+NetworkStats NetworkAPI::getStats() const
+{
+	return NetworkStatsRegistry::get().gather();
+}
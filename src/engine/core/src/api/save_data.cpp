@@ -0,0 +1,91 @@
+#include "halley/core/api/save_data.h"
+#include "halley/concurrency/concurrent.h"
+#include "halley/support/logger.h"
+#include "halley/support/exception.h"
+
+using namespace Halley;
+
+namespace {
+	constexpr std::array<char, 4> compressedMagic = {{ 'H', 'L', 'Z', 'S' }};
+	constexpr size_t compressedHeaderSize = 4 + 1 + 8; // Magic, codec, uncompressed size
+	constexpr size_t compressionChunkSize = 64 * 1024;
+}
+
+Future<bool> ISaveData::setDataAsync(const String& path, Bytes data, CompressionCodec codec, bool commit)
+{
+	return Concurrent::execute(Executors::getDiskIO(), [self = shared_from_this(), path, data = std::move(data), codec, commit] () -> bool
+	{
+		try {
+			self->setData(path, compressData(gsl::as_bytes(gsl::span<const Byte>(data)), codec), commit);
+			return true;
+		} catch (std::exception& e) {
+			Logger::logError("Error saving \"" + path + "\": " + e.what());
+			return false;
+		}
+	});
+}
+
+Future<Bytes> ISaveData::getDataAsync(const String& path)
+{
+	return Concurrent::execute(Executors::getDiskIO(), [self = shared_from_this(), path] () -> Bytes
+	{
+		try {
+			return decompressData(self->getData(path));
+		} catch (std::exception& e) {
+			Logger::logError("Error loading \"" + path + "\": " + e.what());
+			return {};
+		}
+	});
+}
+
+Future<void> ISaveData::commitAsync()
+{
+	return Concurrent::execute(Executors::getDiskIO(), [self = shared_from_this()] ()
+	{
+		self->commit();
+	});
+}
+
+Bytes ISaveData::compressData(gsl::span<const gsl::byte> data, CompressionCodec codec)
+{
+	if (codec == CompressionCodec::None) {
+		return Bytes(reinterpret_cast<const Byte*>(data.data()), reinterpret_cast<const Byte*>(data.data()) + data.size());
+	}
+
+	Bytes result(compressedHeaderSize);
+	const uint64_t size = uint64_t(data.size());
+	memcpy(result.data(), compressedMagic.data(), compressedMagic.size());
+	result[4] = Byte(codec);
+	memcpy(result.data() + 5, &size, sizeof(size));
+
+	auto stream = CompressionStream::create(codec);
+	for (size_t pos = 0; pos < size_t(data.size()); pos += compressionChunkSize) {
+		stream->feed(data.subspan(pos, std::min(compressionChunkSize, size_t(data.size()) - pos)), result);
+	}
+	stream->finish(result);
+	return result;
+}
+
+Bytes ISaveData::decompressData(Bytes data)
+{
+	if (data.size() < compressedHeaderSize || memcmp(data.data(), compressedMagic.data(), compressedMagic.size()) != 0) {
+		return data;
+	}
+
+	const auto codec = CompressionCodec(data[4]);
+	uint64_t size;
+	memcpy(&size, data.data() + 5, sizeof(size));
+
+	Bytes result(size_t(size), 0);
+	auto stream = DecompressionStream::create(codec);
+	stream->feed(gsl::as_bytes(gsl::span<const Byte>(data)).subspan(compressedHeaderSize));
+	size_t pos = 0;
+	while (pos < result.size()) {
+		const auto n = stream->read(gsl::as_writeable_bytes(gsl::span<Byte>(result)).subspan(pos));
+		if (n == 0) {
+			throw Exception("Truncated compressed save data", HalleyExceptions::Compression);
+		}
+		pos += n;
+	}
+	return result;
+}
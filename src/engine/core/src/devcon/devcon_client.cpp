@@ -5,14 +5,21 @@
 #include "halley/core/api/halley_api.h"
 #include "halley/net/connection/message_queue.h"
 #include "devcon/devcon_messages.h"
+#include "halley/support/profiler.h"
+#include "halley/support/memory_tracker.h"
+#include "resources/resources.h"
+#include "resources/resource_load_trace.h"
+#include "game/game_console.h"
+#include <algorithm>
 
 using namespace Halley;
 
-DevConClient::DevConClient(const HalleyAPI& api, std::unique_ptr<NetworkService> service, const String& address, int port)
+DevConClient::DevConClient(const HalleyAPI& api, std::unique_ptr<NetworkService> service, const String& address, int port, std::shared_ptr<GameConsole> console)
 	: api(api)
 	, service(std::move(service))
 	, address(address)
 	, port(port)
+	, console(std::move(console))
 {
 	connect();
 
@@ -29,6 +36,10 @@ void DevConClient::update()
 {
 	service->update();
 
+	if (framesUntilTelemetry > 0) {
+		--framesUntilTelemetry;
+	}
+
 	for (auto& m: queue->receiveAll()) {
 		auto& msg = dynamic_cast<DevCon::DevConMessage&>(*m);
 		switch (msg.getMessageType()) {
@@ -40,6 +51,26 @@ void DevConClient::update()
 			onReceiveReloadAssets(dynamic_cast<DevCon::ReloadAssetsMsg&>(msg));
 			break;
 
+		case DevCon::MessageType::RequestProfile:
+			onReceiveRequestProfile(dynamic_cast<DevCon::RequestProfileMsg&>(msg));
+			break;
+
+		case DevCon::MessageType::RequestResourceLoadTrace:
+			onReceiveRequestResourceLoadTrace(dynamic_cast<DevCon::RequestResourceLoadTraceMsg&>(msg));
+			break;
+
+		case DevCon::MessageType::RequestMemoryReport:
+			onReceiveRequestMemoryReport(dynamic_cast<DevCon::RequestMemoryReportMsg&>(msg));
+			break;
+
+		case DevCon::MessageType::ConsoleCommand:
+			onReceiveConsoleCommand(dynamic_cast<DevCon::ConsoleCommandMsg&>(msg));
+			break;
+
+		case DevCon::MessageType::RequestTelemetry:
+			onReceiveRequestTelemetry(dynamic_cast<DevCon::RequestTelemetryMsg&>(msg));
+			break;
+
 		default:
 			break;
 		}
@@ -48,46 +79,76 @@ void DevConClient::update()
 
 void DevConClient::onReceiveReloadAssets(const DevCon::ReloadAssetsMsg& msg)
 {
-	// Build this map first, so it gets sorted by AssetType
-	// The order in which asset types are reloaded is important, since they have dependencies
-	std::map<AssetType, std::vector<String>> byType;
-
-	for (auto& id: msg.getIds()) {
-		auto splitPos = id.find(':');
-		auto type = fromString<AssetType>(id.left(splitPos));
-		String name = id.mid(splitPos + 1);
-		byType[type].emplace_back(std::move(name));
+	api.core->getResources().reloadAssets(msg.getIds());
+}
+
+void DevConClient::onReceiveRequestProfile(const DevCon::RequestProfileMsg& msg)
+{
+	if (Profiler::isEnabled()) {
+		queue->enqueue(std::make_unique<DevCon::ProfileDataMsg>(Profiler::exportChromeTrace()), 0);
 	}
+	Profiler::setEnabled(msg.isKeepRecording());
+}
 
-	// Purge assets first, to force re-loading of any affected packs
-	for (auto& curType: byType) {
-		auto& resources = api.core->getResources().ofType(curType.first);
-		for (auto& asset: curType.second) {
-			resources.purge(asset);
-		}
+void DevConClient::onReceiveRequestResourceLoadTrace(const DevCon::RequestResourceLoadTraceMsg& msg)
+{
+	auto& resources = api.core->getResources();
+	auto trace = resources.getLoadTrace();
+	if (trace) {
+		const auto csv = trace->toCSV();
+		queue->enqueue(std::make_unique<DevCon::ResourceLoadTraceDataMsg>(String(reinterpret_cast<const char*>(csv.data()), csv.size())), 0);
+		trace->clear();
 	}
 
-	// Reload assets
-	for (auto& curType: byType) {
-		if (curType.first == AssetType::AudioClip) {
-			api.audio->pausePlayback();
-		}
+	if (!msg.isKeepRecording()) {
+		resources.setLoadTrace({});
+	} else if (!trace) {
+		resources.setLoadTrace(std::make_shared<ResourceLoadTrace>());
+	}
+}
 
-		auto& resources = api.core->getResources().ofType(curType.first);
-		for (auto& asset: curType.second) {
-			Logger::logInfo("Reloading " + curType.first + ": " + asset);
-			resources.reload(asset);
-		}
+void DevConClient::onReceiveRequestMemoryReport(const DevCon::RequestMemoryReportMsg& msg)
+{
+	if (!MemoryTracker::isEnabled()) {
+		queue->enqueue(std::make_unique<DevCon::MemoryReportDataMsg>("Memory tracking is not enabled in this build (see USE_MEMORY_TRACKING)."), 0);
+		return;
+	}
 
-		if (curType.first == AssetType::SpriteSheet) {
-			api.core->getResources().ofType(AssetType::Sprite).unloadAll();
-		}
-		if (curType.first == AssetType::AudioClip) {
-			api.audio->resumePlayback();
-		}
+	auto snapshot = MemoryTracker::capture();
+	String report = snapshot.toString();
+	if (memoryCapture) {
+		report += "\nSince last capture:\n" + snapshot.diff(*memoryCapture);
+	}
+	queue->enqueue(std::make_unique<DevCon::MemoryReportDataMsg>(std::move(report)), 0);
+
+	if (msg.isCapture()) {
+		memoryCapture = std::make_unique<MemorySnapshot>(std::move(snapshot));
 	}
 }
 
+void DevConClient::onReceiveConsoleCommand(const DevCon::ConsoleCommandMsg& msg)
+{
+	String output = console ? console->runCommand(msg.getCommand()) : String("This game has no console.");
+	queue->enqueue(std::make_unique<DevCon::ConsoleOutputMsg>(std::move(output)), 0);
+}
+
+void DevConClient::onReceiveRequestTelemetry(const DevCon::RequestTelemetryMsg& msg)
+{
+	telemetryInterval = std::max(msg.getInterval(), 0);
+	framesUntilTelemetry = 0;
+}
+
+bool DevConClient::isTelemetryDue() const
+{
+	return telemetryInterval > 0 && framesUntilTelemetry == 0 && queue->isConnected();
+}
+
+void DevConClient::sendTelemetry(TelemetryFrame frame)
+{
+	queue->enqueue(std::make_unique<DevCon::TelemetryDataMsg>(std::move(frame)), 0);
+	framesUntilTelemetry = telemetryInterval;
+}
+
 void DevConClient::connect()
 {
 	queue = std::make_shared<MessageQueueTCP>(service->connect(address, port));
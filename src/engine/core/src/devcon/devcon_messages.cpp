@@ -9,9 +9,20 @@ using namespace DevCon;
 void DevCon::setupMessageQueue(MessageQueue& queue)
 {
 	queue.setChannel(0, ChannelSettings(true, true));
+	queue.enableCompression();
 
 	queue.addFactory<LogMsg>();
 	queue.addFactory<ReloadAssetsMsg>();
+	queue.addFactory<RequestProfileMsg>();
+	queue.addFactory<ProfileDataMsg>();
+	queue.addFactory<RequestResourceLoadTraceMsg>();
+	queue.addFactory<ResourceLoadTraceDataMsg>();
+	queue.addFactory<RequestMemoryReportMsg>();
+	queue.addFactory<MemoryReportDataMsg>();
+	queue.addFactory<ConsoleCommandMsg>();
+	queue.addFactory<ConsoleOutputMsg>();
+	queue.addFactory<RequestTelemetryMsg>();
+	queue.addFactory<TelemetryDataMsg>();
 }
 
 LogMsg::LogMsg(gsl::span<const gsl::byte> data)
@@ -72,3 +83,263 @@ MessageType ReloadAssetsMsg::getMessageType() const
 {
 	return MessageType::ReloadAssets;
 }
+
+
+RequestProfileMsg::RequestProfileMsg(gsl::span<const gsl::byte> data)
+{
+	Deserializer s(data);
+	s >> keepRecording;
+}
+
+RequestProfileMsg::RequestProfileMsg(bool keepRecording)
+	: keepRecording(keepRecording)
+{}
+
+void RequestProfileMsg::serialize(Serializer& s) const
+{
+	s << keepRecording;
+}
+
+bool RequestProfileMsg::isKeepRecording() const
+{
+	return keepRecording;
+}
+
+MessageType RequestProfileMsg::getMessageType() const
+{
+	return MessageType::RequestProfile;
+}
+
+
+ProfileDataMsg::ProfileDataMsg(gsl::span<const gsl::byte> data)
+{
+	Deserializer s(data);
+	s >> json;
+}
+
+ProfileDataMsg::ProfileDataMsg(String json)
+	: json(std::move(json))
+{}
+
+void ProfileDataMsg::serialize(Serializer& s) const
+{
+	s << json;
+}
+
+const String& ProfileDataMsg::getJSON() const
+{
+	return json;
+}
+
+MessageType ProfileDataMsg::getMessageType() const
+{
+	return MessageType::ProfileData;
+}
+
+
+RequestResourceLoadTraceMsg::RequestResourceLoadTraceMsg(gsl::span<const gsl::byte> data)
+{
+	Deserializer s(data);
+	s >> keepRecording;
+}
+
+RequestResourceLoadTraceMsg::RequestResourceLoadTraceMsg(bool keepRecording)
+	: keepRecording(keepRecording)
+{}
+
+void RequestResourceLoadTraceMsg::serialize(Serializer& s) const
+{
+	s << keepRecording;
+}
+
+bool RequestResourceLoadTraceMsg::isKeepRecording() const
+{
+	return keepRecording;
+}
+
+MessageType RequestResourceLoadTraceMsg::getMessageType() const
+{
+	return MessageType::RequestResourceLoadTrace;
+}
+
+
+ResourceLoadTraceDataMsg::ResourceLoadTraceDataMsg(gsl::span<const gsl::byte> data)
+{
+	Deserializer s(data);
+	s >> csv;
+}
+
+ResourceLoadTraceDataMsg::ResourceLoadTraceDataMsg(String csv)
+	: csv(std::move(csv))
+{}
+
+void ResourceLoadTraceDataMsg::serialize(Serializer& s) const
+{
+	s << csv;
+}
+
+const String& ResourceLoadTraceDataMsg::getCSV() const
+{
+	return csv;
+}
+
+MessageType ResourceLoadTraceDataMsg::getMessageType() const
+{
+	return MessageType::ResourceLoadTraceData;
+}
+
+
+RequestMemoryReportMsg::RequestMemoryReportMsg(gsl::span<const gsl::byte> data)
+{
+	Deserializer s(data);
+	s >> capture;
+}
+
+RequestMemoryReportMsg::RequestMemoryReportMsg(bool capture)
+	: capture(capture)
+{}
+
+void RequestMemoryReportMsg::serialize(Serializer& s) const
+{
+	s << capture;
+}
+
+bool RequestMemoryReportMsg::isCapture() const
+{
+	return capture;
+}
+
+MessageType RequestMemoryReportMsg::getMessageType() const
+{
+	return MessageType::RequestMemoryReport;
+}
+
+
+MemoryReportDataMsg::MemoryReportDataMsg(gsl::span<const gsl::byte> data)
+{
+	Deserializer s(data);
+	s >> report;
+}
+
+MemoryReportDataMsg::MemoryReportDataMsg(String report)
+	: report(std::move(report))
+{}
+
+void MemoryReportDataMsg::serialize(Serializer& s) const
+{
+	s << report;
+}
+
+const String& MemoryReportDataMsg::getReport() const
+{
+	return report;
+}
+
+MessageType MemoryReportDataMsg::getMessageType() const
+{
+	return MessageType::MemoryReportData;
+}
+
+
+ConsoleCommandMsg::ConsoleCommandMsg(gsl::span<const gsl::byte> data)
+{
+	Deserializer s(data);
+	s >> command;
+}
+
+ConsoleCommandMsg::ConsoleCommandMsg(String command)
+	: command(std::move(command))
+{}
+
+void ConsoleCommandMsg::serialize(Serializer& s) const
+{
+	s << command;
+}
+
+const String& ConsoleCommandMsg::getCommand() const
+{
+	return command;
+}
+
+MessageType ConsoleCommandMsg::getMessageType() const
+{
+	return MessageType::ConsoleCommand;
+}
+
+
+ConsoleOutputMsg::ConsoleOutputMsg(gsl::span<const gsl::byte> data)
+{
+	Deserializer s(data);
+	s >> output;
+}
+
+ConsoleOutputMsg::ConsoleOutputMsg(String output)
+	: output(std::move(output))
+{}
+
+void ConsoleOutputMsg::serialize(Serializer& s) const
+{
+	s << output;
+}
+
+const String& ConsoleOutputMsg::getOutput() const
+{
+	return output;
+}
+
+MessageType ConsoleOutputMsg::getMessageType() const
+{
+	return MessageType::ConsoleOutput;
+}
+
+
+RequestTelemetryMsg::RequestTelemetryMsg(gsl::span<const gsl::byte> data)
+{
+	Deserializer s(data);
+	s >> interval;
+}
+
+RequestTelemetryMsg::RequestTelemetryMsg(int interval)
+	: interval(interval)
+{}
+
+void RequestTelemetryMsg::serialize(Serializer& s) const
+{
+	s << interval;
+}
+
+int RequestTelemetryMsg::getInterval() const
+{
+	return interval;
+}
+
+MessageType RequestTelemetryMsg::getMessageType() const
+{
+	return MessageType::RequestTelemetry;
+}
+
+
+TelemetryDataMsg::TelemetryDataMsg(gsl::span<const gsl::byte> data)
+{
+	Deserializer s(data);
+	s >> frame;
+}
+
+TelemetryDataMsg::TelemetryDataMsg(TelemetryFrame frame)
+	: frame(std::move(frame))
+{}
+
+void TelemetryDataMsg::serialize(Serializer& s) const
+{
+	s << frame;
+}
+
+const TelemetryFrame& TelemetryDataMsg::getFrame() const
+{
+	return frame;
+}
+
+MessageType TelemetryDataMsg::getMessageType() const
+{
+	return MessageType::TelemetryData;
+}
@@ -9,9 +9,14 @@
 
 using namespace Halley;
 
-DevConServerConnection::DevConServerConnection(std::shared_ptr<IConnection> conn)
+DevConServerConnection::DevConServerConnection(std::shared_ptr<IConnection> conn, DevConProfileCallback& profileCallback, DevConResourceLoadTraceCallback& resourceLoadTraceCallback, DevConMemoryReportCallback& memoryReportCallback, DevConConsoleCallback& consoleCallback, DevConTelemetryCallback& telemetryCallback)
 	: connection(conn)
 	, queue(std::make_shared<MessageQueueTCP>(connection))
+	, profileCallback(profileCallback)
+	, resourceLoadTraceCallback(resourceLoadTraceCallback)
+	, memoryReportCallback(memoryReportCallback)
+	, consoleCallback(consoleCallback)
+	, telemetryCallback(telemetryCallback)
 {
 	DevCon::setupMessageQueue(*queue);
 }
@@ -25,6 +30,26 @@ void DevConServerConnection::update()
 			onReceiveLogMsg(dynamic_cast<DevCon::LogMsg&>(msg));
 			break;
 
+		case DevCon::MessageType::ProfileData:
+			onReceiveProfileData(dynamic_cast<DevCon::ProfileDataMsg&>(msg));
+			break;
+
+		case DevCon::MessageType::ResourceLoadTraceData:
+			onReceiveResourceLoadTraceData(dynamic_cast<DevCon::ResourceLoadTraceDataMsg&>(msg));
+			break;
+
+		case DevCon::MessageType::MemoryReportData:
+			onReceiveMemoryReportData(dynamic_cast<DevCon::MemoryReportDataMsg&>(msg));
+			break;
+
+		case DevCon::MessageType::ConsoleOutput:
+			onReceiveConsoleOutput(dynamic_cast<DevCon::ConsoleOutputMsg&>(msg));
+			break;
+
+		case DevCon::MessageType::TelemetryData:
+			onReceiveTelemetryData(dynamic_cast<DevCon::TelemetryDataMsg&>(msg));
+			break;
+
 		case DevCon::MessageType::ReloadAssets:
 			// TODO;
 
@@ -40,11 +65,84 @@ void DevConServerConnection::reloadAssets(const std::vector<String>& ids)
 	queue->sendAll();
 }
 
+void DevConServerConnection::requestProfile(bool keepRecording)
+{
+	queue->enqueue(std::make_unique<DevCon::RequestProfileMsg>(keepRecording), 0);
+	queue->sendAll();
+}
+
+void DevConServerConnection::requestResourceLoadTrace(bool keepRecording)
+{
+	queue->enqueue(std::make_unique<DevCon::RequestResourceLoadTraceMsg>(keepRecording), 0);
+	queue->sendAll();
+}
+
+void DevConServerConnection::requestMemoryReport(bool capture)
+{
+	queue->enqueue(std::make_unique<DevCon::RequestMemoryReportMsg>(capture), 0);
+	queue->sendAll();
+}
+
+void DevConServerConnection::runConsoleCommand(const String& command)
+{
+	queue->enqueue(std::make_unique<DevCon::ConsoleCommandMsg>(command), 0);
+	queue->sendAll();
+}
+
+void DevConServerConnection::requestTelemetry(int interval)
+{
+	queue->enqueue(std::make_unique<DevCon::RequestTelemetryMsg>(interval), 0);
+	queue->sendAll();
+}
+
 void DevConServerConnection::onReceiveLogMsg(const DevCon::LogMsg& msg)
 {
 	Logger::log(msg.getLevel(), "[REMOTE] " + msg.getMessage());
 }
 
+void DevConServerConnection::onReceiveProfileData(const DevCon::ProfileDataMsg& msg)
+{
+	if (profileCallback) {
+		profileCallback(msg.getJSON());
+	} else {
+		Logger::logWarning("Received profile data from DevCon client, but no profile callback is set.");
+	}
+}
+
+void DevConServerConnection::onReceiveResourceLoadTraceData(const DevCon::ResourceLoadTraceDataMsg& msg)
+{
+	if (resourceLoadTraceCallback) {
+		resourceLoadTraceCallback(msg.getCSV());
+	} else {
+		Logger::logWarning("Received resource load trace from DevCon client, but no resource load trace callback is set.");
+	}
+}
+
+void DevConServerConnection::onReceiveMemoryReportData(const DevCon::MemoryReportDataMsg& msg)
+{
+	if (memoryReportCallback) {
+		memoryReportCallback(msg.getReport());
+	} else {
+		Logger::logInfo("[REMOTE] Memory report:\n" + msg.getReport());
+	}
+}
+
+void DevConServerConnection::onReceiveConsoleOutput(const DevCon::ConsoleOutputMsg& msg)
+{
+	if (consoleCallback) {
+		consoleCallback(msg.getOutput());
+	} else {
+		Logger::logInfo("[REMOTE] " + msg.getOutput());
+	}
+}
+
+void DevConServerConnection::onReceiveTelemetryData(const DevCon::TelemetryDataMsg& msg)
+{
+	if (telemetryCallback) {
+		telemetryCallback(msg.getFrame());
+	}
+}
+
 DevConServer::DevConServer(std::unique_ptr<NetworkService> s, int port)
 	: service(std::move(s))
 {
@@ -58,7 +156,7 @@ void DevConServer::update()
 	auto newCon = service->tryAcceptConnection();
 	if (newCon) {
 		Logger::logInfo("New incoming DevCon connection.");
-		connections.push_back(std::make_shared<DevConServerConnection>(newCon));
+		connections.push_back(std::make_shared<DevConServerConnection>(newCon, profileCallback, resourceLoadTraceCallback, memoryReportCallback, consoleCallback, telemetryCallback));
 	}
 
 	for (auto& c: connections) {
@@ -82,3 +180,63 @@ void DevConServer::reloadAssets(std::set<String> assetIdsSet)
 	}
 	reloadAssets(std::move(assetIds));
 }
+
+void DevConServer::requestProfile(bool keepRecording)
+{
+	for (auto& c: connections) {
+		c->requestProfile(keepRecording);
+	}
+}
+
+void DevConServer::setProfileCallback(DevConProfileCallback callback)
+{
+	profileCallback = std::move(callback);
+}
+
+void DevConServer::requestResourceLoadTrace(bool keepRecording)
+{
+	for (auto& c: connections) {
+		c->requestResourceLoadTrace(keepRecording);
+	}
+}
+
+void DevConServer::setResourceLoadTraceCallback(DevConResourceLoadTraceCallback callback)
+{
+	resourceLoadTraceCallback = std::move(callback);
+}
+
+void DevConServer::requestMemoryReport(bool capture)
+{
+	for (auto& c: connections) {
+		c->requestMemoryReport(capture);
+	}
+}
+
+void DevConServer::setMemoryReportCallback(DevConMemoryReportCallback callback)
+{
+	memoryReportCallback = std::move(callback);
+}
+
+void DevConServer::runConsoleCommand(const String& command)
+{
+	for (auto& c: connections) {
+		c->runConsoleCommand(command);
+	}
+}
+
+void DevConServer::setConsoleCallback(DevConConsoleCallback callback)
+{
+	consoleCallback = std::move(callback);
+}
+
+void DevConServer::requestTelemetry(int interval)
+{
+	for (auto& c: connections) {
+		c->requestTelemetry(interval);
+	}
+}
+
+void DevConServer::setTelemetryCallback(DevConTelemetryCallback callback)
+{
+	telemetryCallback = std::move(callback);
+}
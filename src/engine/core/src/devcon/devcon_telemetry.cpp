@@ -0,0 +1,73 @@
+#include "halley/core/devcon/devcon_telemetry.h"
+#include "halley/bytes/byte_serializer.h"
+
+using namespace Halley;
+
+void TelemetryValue::serialize(Serializer& s) const
+{
+	s << name;
+	s << value;
+}
+
+void TelemetryValue::deserialize(Deserializer& s)
+{
+	s >> name;
+	s >> value;
+}
+
+void TelemetryFrame::add(String name, double value)
+{
+	values.push_back(TelemetryValue{ std::move(name), value });
+}
+
+void TelemetryFrame::serialize(Serializer& s) const
+{
+	s << frame;
+	for (auto& t: engineNs) {
+		s << t;
+	}
+	for (auto& t: gameNs) {
+		s << t;
+	}
+	s << vsyncNs;
+	s << drawCalls;
+	s << vertices;
+	s << triangles;
+	s << memoryBytes;
+	s << audioMixTime;
+	s << audioBufferDuration;
+	s << audioLatency;
+	s << audioUnderruns;
+	s << audioVoices;
+	s << netBytesSent;
+	s << netBytesReceived;
+	s << netPacketsLost;
+	s << netRoundTripTime;
+	s << values;
+}
+
+void TelemetryFrame::deserialize(Deserializer& s)
+{
+	s >> frame;
+	for (auto& t: engineNs) {
+		s >> t;
+	}
+	for (auto& t: gameNs) {
+		s >> t;
+	}
+	s >> vsyncNs;
+	s >> drawCalls;
+	s >> vertices;
+	s >> triangles;
+	s >> memoryBytes;
+	s >> audioMixTime;
+	s >> audioBufferDuration;
+	s >> audioLatency;
+	s >> audioUnderruns;
+	s >> audioVoices;
+	s >> netBytesSent;
+	s >> netBytesReceived;
+	s >> netPacketsLost;
+	s >> netRoundTripTime;
+	s >> values;
+}
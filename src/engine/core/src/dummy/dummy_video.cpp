@@ -55,10 +55,6 @@ std::unique_ptr<ScreenRenderTarget> DummyVideoAPI::createScreenRenderTarget()
 	return std::make_unique<ScreenRenderTarget>(Rect4i({}, getWindow().getWindowRect().getSize()));
 }
 
-std::unique_ptr<MaterialConstantBuffer> DummyVideoAPI::createConstantBuffer()
-{
-	return std::make_unique<DummyMaterialConstantBuffer>();
-}
 
 void DummyVideoAPI::init()
 {
@@ -98,13 +94,13 @@ int DummyShader::getBlockLocation(const String&, ShaderType)
 	return 0;
 }
 
-void DummyMaterialConstantBuffer::update(const MaterialDataBlock&) {}
-
 DummyPainter::DummyPainter(Resources& resources)
 	: Painter(resources)
 {}
 
-void DummyPainter::clear(Colour colour) {}
+void DummyPainter::doClear(Colour colour) {}
+
+void DummyPainter::doClearDepth() {}
 
 void DummyPainter::setMaterialPass(const Material&, int) {}
 
@@ -20,7 +20,6 @@ namespace Halley {
 		std::unique_ptr<Shader> createShader(const ShaderDefinition& definition) override;
 		std::unique_ptr<TextureRenderTarget> createTextureRenderTarget() override;
 		std::unique_ptr<ScreenRenderTarget> createScreenRenderTarget() override;
-		std::unique_ptr<MaterialConstantBuffer> createConstantBuffer() override;
 		void init() override;
 		void deInit() override;
 		std::unique_ptr<Painter> makePainter(Resources& resources) override;
@@ -44,20 +43,15 @@ namespace Halley {
 		int getBlockLocation(const String& name, ShaderType stage) override;
 	};
 
-	class DummyMaterialConstantBuffer : public MaterialConstantBuffer
-	{
-	public:
-		void update(const MaterialDataBlock& dataBlock) override;
-	};
-
 	class DummyPainter : public Painter
 	{
 	public:
 		explicit DummyPainter(Resources& resources);
-		void clear(Colour colour) override;
 		void setMaterialPass(const Material& material, int pass) override;
 		void doStartRender() override;
 		void doEndRender() override;
+		void doClear(Colour colour) override;
+		void doClearDepth() override;
 		void setVertices(const MaterialDefinition& material, size_t numVertices, void* vertexData, size_t numIndices, unsigned short* indices, bool standardQuadsOnly) override;
 		void drawTriangles(size_t numIndices) override;
 		void setViewPort(Rect4i rect) override;
@@ -2,23 +2,32 @@
 #include "halley/core/game/core.h"
 #include "halley/core/game/game.h"
 #include "halley/core/game/environment.h"
+#include "halley/core/game/startup_profile.h"
 #include "api/halley_api.h"
 #include "graphics/camera.h"
 #include "graphics/render_context.h"
 #include "graphics/render_target/render_target_screen.h"
+#include "graphics/texture_streamer.h"
 #include "graphics/window.h"
 #include "resources/resources.h"
 #include "resources/resource_locator.h"
+#include "resources/resource_access_trace.h"
+#include "resources/resource_load_trace.h"
 #include "resources/standard_resources.h"
 #include <halley/os/os.h>
 #include <halley/support/debug.h>
 #include <halley/support/console.h>
+#include <halley/support/profiler.h>
 #include <halley/concurrency/concurrent.h>
+#include <halley/data_structures/frame_arena.h>
+#include <halley/support/memory_tracker.h>
 #include <fstream>
 #include <chrono>
 #include <ctime>
 #include "../dummy/dummy_plugins.h"
 #include "halley/core/devcon/devcon_client.h"
+#include "halley/core/devcon/devcon_telemetry.h"
+#include "halley/net/connection/network_stats.h"
 #include "halley/net/connection/network_service.h"
 
 #ifdef _MSC_VER
@@ -28,6 +37,7 @@
 using namespace Halley;
 
 Core::Core(std::unique_ptr<Game> g, Vector<std::string> _args)
+	: startupProfile(std::make_unique<StartupProfile>())
 {
 	statics.setupGlobals();
 	Logger::addSink(*this);
@@ -44,7 +54,12 @@ Core::Core(std::unique_ptr<Game> g, Vector<std::string> _args)
 	environment->setDataPath(game->getDataPath());
 
 	// Basic initialization
-	game->init(*environment, args);
+	startupProfile->time("Game init", [&] ()
+	{
+		game->configureEnvironment(*environment);
+		game->init(*environment, args);
+	});
+	logDevMessages = game->isDevMode();
 
 	// Console
 	if (game->shouldCreateSeparateConsole()) {
@@ -53,6 +68,9 @@ Core::Core(std::unique_ptr<Game> g, Vector<std::string> _args)
 		OS::get().initializeConsole();
 	}
 	setOutRedirect(false);
+	if (game->shouldLogAsynchronously()) {
+		Logger::setAsync(true);
+	}
 
 	std::cout << ConsoleColour(Console::GREEN) << "Halley is initializing..." << ConsoleColour() << std::endl;
 
@@ -74,14 +92,19 @@ Core::Core(std::unique_ptr<Game> g, Vector<std::string> _args)
 	std::cout << "Program dir: " << ConsoleColour(Console::DARK_GREY) << environment->getProgramPath() << ConsoleColour() << std::endl;
 	std::cout << "Data dir: " << ConsoleColour(Console::DARK_GREY) << environment->getDataPath() << ConsoleColour() << std::endl;
 
-	// Computer info
-#ifndef _DEBUG
-	showComputerInfo();
-#endif
-
 	// Create API
-	registerDefaultPlugins();
-	api = HalleyAPI::create(this, game->initPlugins(*this));
+	headless = game->isHeadless() || std::find(args.begin(), args.end(), "--headless") != args.end();
+	uncapped = std::find(args.begin(), args.end(), "--uncapped") != args.end();
+	timeReport = std::find(args.begin(), args.end(), "--frame-time-report") != args.end();
+	startupProfile->time("Create APIs", [&] ()
+	{
+		registerDefaultPlugins();
+		int apiFlags = game->initPlugins(*this);
+		if (headless) {
+			apiFlags &= ~(HalleyAPIFlags::Video | HalleyAPIFlags::Audio | HalleyAPIFlags::Input | HalleyAPIFlags::Movie);
+		}
+		api = HalleyAPI::create(this, apiFlags);
+	});
 }
 
 Core::~Core()
@@ -117,10 +140,11 @@ void Core::onReloaded()
 	if (game->shouldCreateSeparateConsole()) {
 		setOutRedirect(true);
 	}
-	statics.resume(api->system);
+	statics.resume(api->system, environment.get());
 	if (api->system) {
 		api->system->setThreadName("main");
 	}
+	Profiler::setThreadName("main");
 	
 	if (api->inputInternal) {
 		api->inputInternal->onResume();
@@ -149,18 +173,56 @@ void Core::onTerminatedInError(const std::string& error)
 
 int Core::getTargetFPS()
 {
-	return game->getTargetFPS();
+	// --uncapped runs the loop as fast as it'll go, with fixed deltas, for benchmarking
+	return uncapped ? 0 : game->getTargetFPS();
+}
+
+FramePacing Core::getFramePacing()
+{
+	auto pacing = game->getFramePacing();
+	if (pacing.refreshRate <= 0 && api->system) {
+		pacing.refreshRate = api->system->getRefreshRate(0);
+	}
+	return pacing;
+}
+
+int64_t Core::getLastPresentWaitNs() const
+{
+	// With a render thread, the main thread only waits for the display indirectly, when it waits for the previous frame
+	return renderQueue ? 0 : vsyncTimer.lastElapsedNanoSeconds();
 }
 
 void Core::init()
 {
 	// Initialize API
-	api->init();
+	startupProfile->time("System API", [&] () { api->initSystem(); });
 	api->systemInternal->setEnvironment(environment.get());
-	statics.resume(api->system);
+
+	// Reading the packs is mostly waiting on the disk, and starting the other APIs mostly waiting on drivers and devices,
+	// so they're done at the same time
+	std::exception_ptr resourcesError;
+	auto resourcesThread = api->system->createThread("startup", ThreadPriority::High, [&] ()
+	{
+		try {
+			startupProfile->time("Resources", [&] () { initResources(); });
+		} catch (...) {
+			resourcesError = std::current_exception();
+		}
+	});
+	api->initOthers(*startupProfile);
+	resourcesThread.join();
+	if (resourcesError) {
+		std::rethrow_exception(resourcesError);
+	}
+	if (api->audioInternal) {
+		api->audioInternal->setResources(*resources);
+	}
+
+	statics.resume(api->system, environment.get());
 	if (api->system) {
 		api->system->setThreadName("main");
 	}
+	Profiler::setThreadName("main");
 
 	// Resources
 	initResources();
@@ -168,26 +230,60 @@ void Core::init()
 	// Create devcon connection
 	String devConAddress = game->getDevConAddress();
 	if (!devConAddress.isEmpty()) {
-		devConClient = std::make_unique<DevConClient>(*api, api->network->createService(NetworkProtocol::TCP), devConAddress, game->getDevConPort());
+		devConClient = std::make_unique<DevConClient>(*api, api->network->createService(NetworkProtocol::TCP), devConAddress, game->getDevConPort(), game->getGameConsole());
+		resources->setHotReloadEnabled(true);
+	}
+
+	// Created before the game starts, so it can be configured and stream the first textures loaded
+	if (api->video) {
+		textureStreamer = std::make_unique<TextureStreamer>(*api->video);
 	}
 
 	// Start game
-	setStage(game->startGame(&*api));
+	startupProfile->time("Start game", [&] () { setStage(game->startGame(&*api)); });
 	
 	// Get video resources
 	if (api->video) {
-		painter = api->videoInternal->makePainter(api->core->getResources());
+		startupProfile->time("Painter", [&] () { painter = api->videoInternal->makePainter(api->core->getResources()); });
+
+		if (game->shouldRenderOnSeparateThread() && api->video->canRenderOnAnyThread() && api->system) {
+			renderQueue = std::make_unique<ExecutionQueue>(ExecutionQueueMode::MPSC);
+			renderExecutor = std::make_unique<Executor>(*renderQueue);
+			renderThread = api->system->createThread("render", ThreadPriority::High, [this] ()
+			{
+				renderExecutor->runForever();
+			});
+		}
 	}
+
+	initEndNs = startupProfile->getTimeNs();
 }
 
 void Core::deInit()
 {
 	std::cout << "Game shutting down." << std::endl;
 
-	// Ensure stage is cleaned up
+	// Ensure stage is cleaned up, including any still being made
+	if (asyncStage) {
+		asyncStage->done.wait();
+		asyncStage.reset();
+	}
 	running = false;
 	transitionStage();
 
+	// Stop render thread
+	if (renderQueue) {
+		waitForRenderSubmission();
+		renderExecutor->stop();
+		renderThread.join();
+		renderExecutor.reset();
+		renderQueue.reset();
+	}
+
+	if (timeReport) {
+		writeTimeReport();
+	}
+
 	// Deinit game
 	game->endGame();
 	game.reset();
@@ -199,6 +295,7 @@ void Core::deInit()
 
 	// Deinit painter
 	painter.reset();
+	textureStreamer.reset();
 
 	// Stop audio playback before releasing resources
 	if (api->audio) {
@@ -207,12 +304,26 @@ void Core::deInit()
 
 	// Deinit resources
 	resources.reset();
+	if (accessTrace) {
+		// To lay out the packs by first use, copy this to the project's root and repack
+		const auto tracePath = environment->getDataPath() / "asset_trace.txt";
+		Path::writeFile(tracePath, accessTrace->toBytes());
+		std::cout << "Asset access trace written to " << ConsoleColour(Console::DARK_GREY) << tracePath << ConsoleColour() << std::endl;
+		accessTrace.reset();
+	}
+	if (loadTrace) {
+		const auto tracePath = environment->getDataPath() / "resource_load_trace.csv";
+		Path::writeFile(tracePath, loadTrace->toCSV());
+		std::cout << "Resource load trace written to " << ConsoleColour(Console::DARK_GREY) << tracePath << ConsoleColour() << std::endl;
+		loadTrace.reset();
+	}
 
 	// Deinit API (note that this has to happen after resources, otherwise resources which rely on an API to de-init, such as textures, will crash)
 	api.reset();
 	
 	// Stop thread pool and other statics
 	statics.suspend();
+	Logger::setAsync(false);
 
 	// Deinit console redirector
 	std::cout << "Goodbye!" << std::endl;
@@ -232,9 +343,20 @@ void Core::initResources()
 	auto locator = std::make_unique<ResourceLocator>(*api->system);
 	auto gamePath = environment->getProgramPath();
 	game->initResourceLocator(gamePath, api->system->getAssetsPath(gamePath.string()), api->system->getUnpackedAssetsPath(gamePath.string()), *locator);
+	if (std::find(args.begin(), args.end(), "--record-asset-trace") != args.end()) {
+		accessTrace = std::make_shared<ResourceAccessTrace>();
+		locator->setAccessTrace(accessTrace);
+	}
 	resources = std::make_unique<Resources>(std::move(locator), &*api);
-	StandardResources::initialize(*resources);
-	api->audioInternal->setResources(*resources);
+	if (std::find(args.begin(), args.end(), "--record-load-trace") != args.end()) {
+		loadTrace = std::make_shared<ResourceLoadTrace>();
+		resources->setLoadTrace(loadTrace);
+	}
+	if (headless) {
+		StandardResources::initializeHeadless(*resources);
+	} else {
+		StandardResources::initialize(*resources);
+	}
 }
 
 void Core::setOutRedirect(bool appendToExisting)
@@ -255,9 +377,11 @@ void Core::setOutRedirect(bool appendToExisting)
 
 void Core::pumpEvents(Time time)
 {
-	auto video = dynamic_cast<VideoAPIInternal*>(&*api->video);
-	auto input = dynamic_cast<InputAPIInternal*>(&*api->input);
-	input->beginEvents(time);
+	auto video = dynamic_cast<VideoAPIInternal*>(api->video);
+	auto input = dynamic_cast<InputAPIInternal*>(api->input);
+	if (input) {
+		input->beginEvents(time);
+	}
 	if (!api->system->generateEvents(video, input)) {
 		quit(0); // System close event
 	}
@@ -278,6 +402,23 @@ void Core::pumpAudio()
 
 void Core::onFixedUpdate(Time time)
 {
+	if (headless) {
+		// There are no variable updates to do the per-frame work, so each step counts as a frame
+		Profiler::nextFrame();
+		FrameArena::nextFrame();
+		MemoryTracker::nextFrame();
+		Profiler::Scope profile("Frame", ProfilerEventType::Frame);
+		if (isRunning()) {
+			doHeadlessStep(time);
+		}
+		if (startupProfile) {
+			onStartupFinished();
+		}
+		sendTelemetry();
+		return;
+	}
+
+	Profiler::Scope profile("Core::fixedUpdate", ProfilerEventType::Frame);
 	if (isRunning()) {
 		doFixedUpdate(time);
 	}
@@ -285,13 +426,25 @@ void Core::onFixedUpdate(Time time)
 
 void Core::onVariableUpdate(Time time)
 {
+	Profiler::nextFrame();
+	FrameArena::nextFrame();
+	MemoryTracker::nextFrame();
+	Profiler::Scope profile("Frame", ProfilerEventType::Frame);
+
 	if (isRunning()) {
+		Profiler::Scope profileUpdate("Core::variableUpdate", ProfilerEventType::Frame);
 		doVariableUpdate(time);
 	}
 
 	if (isRunning()) {
+		Profiler::Scope profileRender("Core::render", ProfilerEventType::Frame);
 		doRender(time);
 	}
+
+	if (startupProfile) {
+		onStartupFinished();
+	}
+	sendTelemetry();
 }
 
 void Core::doFixedUpdate(Time time)
@@ -316,6 +469,24 @@ void Core::doFixedUpdate(Time time)
 	HALLEY_DEBUG_TRACE();
 }
 
+void Core::doHeadlessStep(Time time)
+{
+	pumpEvents(time);
+	Executors::getMainThread().runAll();
+	if (resources) {
+		resources->update();
+	}
+
+	doFixedUpdate(time);
+
+	if (api->platform) {
+		api->platformInternal->update();
+	}
+	if (api->system) {
+		api->systemInternal->update(time);
+	}
+}
+
 void Core::doVariableUpdate(Time time)
 {
 	HALLEY_DEBUG_TRACE();
@@ -324,6 +495,10 @@ void Core::doVariableUpdate(Time time)
 	engineTimer.beginSample();
 
 	pumpEvents(time);
+	Executors::getMainThread().runAll();
+	if (resources) {
+		resources->update();
+	}
 	gameTimer.beginSample();
 	if (running && currentStage) {
 		try {
@@ -354,18 +529,17 @@ void Core::doRender(Time)
 	bool gameSampled = false;
 	engineTimer.beginSample();
 
-	if (api->video) {
-		api->video->startRender();
-		painter->startRender();
+	if (api->video && renderQueue && currentStage && currentStage->isRenderPipelined()) {
+		MemoryTagScope memoryTag(MemoryTag::Graphics);
+		doRenderPipelined(gameTimer);
+		gameSampled = true;
+	} else if (api->video) {
+		MemoryTagScope memoryTag(MemoryTag::Graphics);
+		api->video->getRenderTargetPool().nextFrame();
+		painter->startRecording();
 
 		if (currentStage) {
-			auto windowSize = api->video->getWindow().getDefinition().getSize();
-			if (windowSize != prevWindowSize) {
-				screenTarget.reset();
-				screenTarget = api->video->createScreenRenderTarget();
-				camera = std::make_unique<Camera>(Vector2f(windowSize) * 0.5f);
-				prevWindowSize = windowSize;
-			}
+			updateScreenTarget();
 			RenderContext context(*painter, *camera, *screenTarget);
 
 			gameTimer.beginSample();
@@ -380,11 +554,31 @@ void Core::doRender(Time)
 			gameSampled = true;
 		}
 
-		painter->endRender();
-
-		vsyncTimer.beginSample();
-		api->video->finishRender();
-		vsyncTimer.endSample();
+		auto commands = painter->finishRecording();
+
+		if (renderQueue) {
+			// Only one frame can be in flight; this also gives back its command list, to be reused
+			waitForRenderSubmission();
+			textureStreamer->update();
+			submitting = std::move(commands);
+			renderInFlight = true;
+			renderSubmission = Concurrent::execute(*renderQueue, [this] ()
+			{
+				try {
+					submitRender(*submitting);
+				} catch (...) {
+					renderError = std::current_exception();
+				}
+			});
+		} else {
+			try {
+				submitRender(*commands);
+			} catch (Exception& e) {
+				game->onUncaughtException(e, TimeLine::Render);
+			}
+			painter->recycle(std::move(commands));
+			textureStreamer->update();
+		}
 	}
 
 	if (!gameSampled) {
@@ -396,6 +590,165 @@ void Core::doRender(Time)
 	HALLEY_DEBUG_TRACE();
 }
 
+void Core::doRenderPipelined(StopwatchAveraging& gameTimer)
+{
+	// The painter, screen target and render target pool are all in use until the previous frame is done
+	waitForRenderSubmission();
+	pipelinedPainterStats = { painter->getPrevDrawCalls(), painter->getPrevVertices(), painter->getPrevTriangles() };
+	textureStreamer->update();
+	updateScreenTarget();
+	api->video->getRenderTargetPool().nextFrame();
+
+	try {
+		currentStage->onPrepareRender();
+	} catch (Exception& e) {
+		game->onUncaughtException(e, TimeLine::Render);
+	}
+
+	renderInFlight = true;
+	renderSubmission = Concurrent::execute(*renderQueue, [this, &gameTimer, stage = currentStage.get()] ()
+	{
+		MemoryTagScope memoryTag(MemoryTag::Graphics);
+		painter->startRecording();
+
+		gameTimer.beginSample();
+		try {
+			RenderContext context(*painter, *camera, *screenTarget);
+			stage->onRender(context);
+		} catch (...) {
+			renderError = std::current_exception();
+		}
+		gameTimer.endSample();
+
+		submitting = painter->finishRecording();
+		try {
+			submitRender(*submitting);
+		} catch (...) {
+			renderError = std::current_exception();
+		}
+	});
+}
+
+void Core::updateScreenTarget()
+{
+	auto windowSize = api->video->getWindow().getDefinition().getSize();
+	if (windowSize != prevWindowSize) {
+		// The previous frame might still be drawing to it
+		waitForRenderSubmission();
+		screenTarget.reset();
+		screenTarget = api->video->createScreenRenderTarget();
+		camera = std::make_unique<Camera>(Vector2f(windowSize) * 0.5f);
+		prevWindowSize = windowSize;
+	}
+}
+
+void Core::submitRender(RenderCommandList& commands)
+{
+	Profiler::Scope profile("Core::submitRender", ProfilerEventType::Render);
+	MemoryTagScope memoryTag(MemoryTag::Graphics);
+
+	api->video->startRender();
+	painter->startRender();
+	painter->replay(commands);
+	painter->endRender();
+
+	vsyncTimer.beginSample();
+	api->video->finishRender();
+	vsyncTimer.endSample();
+}
+
+void Core::waitForRenderSubmission()
+{
+	if (renderInFlight) {
+		renderSubmission.wait();
+		renderInFlight = false;
+		if (submitting) {
+			painter->recycle(std::move(submitting));
+		}
+
+		if (renderError) {
+			auto error = renderError;
+			renderError = nullptr;
+			try {
+				std::rethrow_exception(error);
+			} catch (Exception& e) {
+				game->onUncaughtException(e, TimeLine::Render);
+			}
+		}
+	}
+}
+
+void Core::onStartupFinished()
+{
+	const auto now = startupProfile->getTimeNs();
+	startupProfile->add("First frame", initEndNs, now);
+	std::cout << "Started up in " << (now / 1000000) << " ms:\n" << ConsoleColour(Console::DARK_GREY) << startupProfile->generateReport() << ConsoleColour() << std::endl;
+	startupProfile.reset();
+
+	// Off the critical path, as querying the hardware can be slow
+#ifndef _DEBUG
+	showComputerInfo();
+#endif
+}
+
+void Core::sendTelemetry()
+{
+	++frameNumber;
+	if (!devConClient || !devConClient->isTelemetryDue()) {
+		return;
+	}
+
+	TelemetryFrame frame;
+	frame.frame = frameNumber;
+	for (int i = 0; i < int(TimeLine::NUMBER_OF_TIMELINES); ++i) {
+		frame.engineNs[i] = engineTimers[i].averageElapsedNanoSeconds();
+		frame.gameNs[i] = gameTimers[i].averageElapsedNanoSeconds();
+	}
+	frame.vsyncNs = vsyncTimer.averageElapsedNanoSeconds();
+
+	if (renderInFlight) {
+		// The painter belongs to the render thread now, so these are a frame older
+		frame.drawCalls = pipelinedPainterStats[0];
+		frame.vertices = pipelinedPainterStats[1];
+		frame.triangles = pipelinedPainterStats[2];
+	} else if (painter) {
+		frame.drawCalls = painter->getPrevDrawCalls();
+		frame.vertices = painter->getPrevVertices();
+		frame.triangles = painter->getPrevTriangles();
+	}
+
+	if (MemoryTracker::isEnabled()) {
+		const auto memory = MemoryTracker::capture();
+		frame.memoryBytes = memory.total.liveBytes;
+		for (size_t i = 0; i < memory.tags.size(); ++i) {
+			frame.add("memory." + MemoryTracker::getTagName(i), double(memory.tags[i].liveBytes));
+		}
+	}
+
+	if (api->audio) {
+		const auto audio = api->audio->getStats();
+		frame.audioMixTime = audio.averageMixTime;
+		frame.audioBufferDuration = audio.bufferDuration;
+		frame.audioLatency = audio.outputLatency;
+		frame.audioUnderruns = audio.underruns;
+		frame.audioVoices = audio.activeVoices;
+	}
+
+	if (api->network) {
+		const auto net = api->network->getStats();
+		frame.netBytesSent = net.connections.traffic.bytesSent;
+		frame.netBytesReceived = net.connections.traffic.bytesReceived;
+		frame.netPacketsLost = net.connections.packetsLost;
+		frame.netRoundTripTime = net.connections.roundTripTime.getMean();
+	}
+
+	if (currentStage) {
+		currentStage->addTelemetry(frame);
+	}
+
+	devConClient->sendTelemetry(std::move(frame));
+}
+
 void Core::showComputerInfo() const
 {
 	time_t rawtime;
@@ -423,10 +776,52 @@ void Core::setStage(StageID stage)
 
 void Core::setStage(std::unique_ptr<Stage> next)
 {
+	// Supersedes any stage still being made; its result is dropped when it's done
+	asyncStage.reset();
+
+	// Start loading what the next stage needs now, the switch happens once it's all there
+	nextStagePreload.reset();
+	if (next && resources) {
+		const auto assets = next->getPreloadAssets();
+		if (!assets.empty()) {
+			nextStagePreload = resources->preload(assets, ResourceLoadPriority::High);
+		}
+	}
+
 	nextStage = std::move(next);
 	pendingStageTransition = true;
 }
 
+void Core::setStageAsync(StageID stage)
+{
+	setStageAsync([this, stage] () { return game->makeStage(stage); });
+}
+
+void Core::setStageAsync(std::function<std::unique_ptr<Stage>()> makeStage)
+{
+	// Cancels any switch already pending, as setStage would
+	nextStagePreload.reset();
+	nextStage.reset();
+	pendingStageTransition = false;
+
+	auto pending = std::make_shared<AsyncStage>();
+	pending->done = Concurrent::execute(Executors::getCPUAux(), [pending, makeStage, api = api.get(), game = game.get()] ()
+	{
+		try {
+			auto stage = makeStage();
+			if (stage) {
+				stage->api = api;
+				stage->setGame(*game);
+				stage->prepare();
+			}
+			pending->stage = std::move(stage);
+		} catch (...) {
+			pending->error = std::current_exception();
+		}
+	});
+	asyncStage = std::move(pending);
+}
+
 void Core::quit(int code)
 {
 	exitCode = code;
@@ -440,6 +835,11 @@ Resources& Core::getResources()
 	return *resources;
 }
 
+TextureStreamer* Core::getTextureStreamer()
+{
+	return textureStreamer.get();
+}
+
 const Environment& Core::getEnvironment()
 {
 	Expects(environment);
@@ -455,11 +855,67 @@ int64_t Core::getTime(CoreAPITimer timerType, TimeLine tl, StopwatchAveraging::M
 		return gameTimers[int(tl)].elapsedNanoSeconds(mode);
 	case CoreAPITimer::Vsync:
 		return vsyncTimer.elapsedNanoSeconds(mode);
+	case CoreAPITimer::GPU:
+		return painter ? painter->getGPUTime(mode) : 0;
+	case CoreAPITimer::Audio:
+		return api->audio ? int64_t(api->audio->getStats().averageMixTime * 1e9f) : 0;
 	default:
 		return 0;
 	}
 }
 
+TimeHistogramStats Core::getTimeStats(CoreAPITimer timerType, TimeLine tl, TimeHistogram::Window window) const
+{
+	switch (timerType) {
+	case CoreAPITimer::Engine:
+		return engineTimers[int(tl)].getHistogram().getStats(window);
+	case CoreAPITimer::Game:
+		return gameTimers[int(tl)].getHistogram().getStats(window);
+	case CoreAPITimer::Vsync:
+		return vsyncTimer.getHistogram().getStats(window);
+	case CoreAPITimer::GPU:
+		return painter ? painter->getGPUTimeStats(window) : TimeHistogramStats();
+	case CoreAPITimer::Audio:
+		if (api->audio) {
+			const auto stats = api->audio->getStats();
+			return window == TimeHistogram::Window::Total ? stats.mixTimeTotal : stats.mixTimeRecent;
+		}
+		return TimeHistogramStats();
+	default:
+		return TimeHistogramStats();
+	}
+}
+
+void Core::writeTimeReport()
+{
+	// For automated runs (e.g. with --uncapped), so spikes can be compared between builds
+	String report;
+	const char* timelineNames[] = { "Fixed", "Variable", "Render" };
+	auto addLine = [&] (const String& name, const TimeHistogramStats& stats)
+	{
+		if (stats.samples > 0) {
+			report += name + ": " + stats.toString() + "\n";
+		}
+	};
+
+	for (int i = 0; i < int(TimeLine::NUMBER_OF_TIMELINES); ++i) {
+		addLine(String(timelineNames[i]) + " engine", getTimeStats(CoreAPITimer::Engine, TimeLine(i), TimeHistogram::Window::Total));
+		addLine(String(timelineNames[i]) + " game", getTimeStats(CoreAPITimer::Game, TimeLine(i), TimeHistogram::Window::Total));
+	}
+	addLine("VSync", getTimeStats(CoreAPITimer::Vsync, TimeLine::Render, TimeHistogram::Window::Total));
+	addLine("GPU", getTimeStats(CoreAPITimer::GPU, TimeLine::Render, TimeHistogram::Window::Total));
+	addLine("Audio mix", getTimeStats(CoreAPITimer::Audio, TimeLine::Render, TimeHistogram::Window::Total));
+	if (currentStage) {
+		report += currentStage->getTimeReport();
+	}
+
+	Bytes bytes(report.size());
+	memcpy(bytes.data(), report.c_str(), report.size());
+	const auto reportPath = environment->getDataPath() / "frame_time_report.txt";
+	Path::writeFile(reportPath, bytes);
+	std::cout << "Frame times:\n" << ConsoleColour(Console::DARK_GREY) << report << ConsoleColour() << "Written to " << reportPath << std::endl;
+}
+
 void Core::initStage(Stage& stage)
 {
 	stage.api = &*api;
@@ -472,17 +928,38 @@ Stage& Core::getCurrentStage()
 	return *currentStage;
 }
 
+float Core::getStagePreloadProgress() const
+{
+	if (asyncStage) {
+		return 0.0f;
+	}
+	return pendingStageTransition && nextStagePreload ? nextStagePreload->getProgress() : 1.0f;
+}
+
 bool Core::transitionStage()
 {
+	// A stage made in the background goes through the normal path from here, starting with its preload
+	if (asyncStage && asyncStage->done.isReady()) {
+		auto pending = std::move(asyncStage);
+		if (pending->error) {
+			std::rethrow_exception(pending->error);
+		}
+		setStage(std::move(pending->stage));
+	}
+
 	// If it's not running anymore, reset stage
 	if (!running && currentStage) {
 		pendingStageTransition = true;
 		nextStage.reset();
 	}
 
-	// Check if there's a stage waiting to be switched to
-	if (pendingStageTransition) {
-		// Get rid of current stage
+	// Check if there's a stage waiting to be switched to (and ready to)
+	const bool preloading = running && nextStagePreload && !nextStagePreload->isDone();
+	if (pendingStageTransition && !preloading) {
+		nextStagePreload.reset();
+
+		// Get rid of current stage, once it's no longer being drawn
+		waitForRenderSubmission();
 		if (currentStage) {
 			HALLEY_DEBUG_TRACE();
 			currentStage.reset();
@@ -494,6 +971,9 @@ bool Core::transitionStage()
 
 		// Prepare next stage
 		if (currentStage) {
+			if (accessTrace) {
+				accessTrace->setSection(currentStage->getName());
+			}
 			HALLEY_DEBUG_TRACE();
 			initStage(*currentStage);
 			HALLEY_DEBUG_TRACE();
@@ -536,7 +1016,7 @@ Vector<Plugin*> Core::getPlugins(PluginType type)
 
 void Core::log(LoggerLevel level, const String& msg)
 {
-	if (level == LoggerLevel::Dev && (!game || !game->isDevMode())) {
+	if (level == LoggerLevel::Dev && !logDevMessages) {
 		return;
 	}
 
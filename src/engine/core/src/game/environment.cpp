@@ -33,3 +33,14 @@ void Halley::Environment::setDataPath(Path pathName)
 	dataPath = Path(OS::get().getUserDataDir()) / pathName / ".";
 	OS::get().createDirectories(dataPath);
 }
+
+void Halley::Environment::setThreadSettings(const String& name, ThreadSettings settings)
+{
+	threadSettings[name] = settings;
+}
+
+Halley::ThreadSettings Halley::Environment::getThreadSettings(const String& name, ThreadSettings defaultSettings) const
+{
+	const auto iter = threadSettings.find(name);
+	return iter != threadSettings.end() ? iter->second : defaultSettings;
+}
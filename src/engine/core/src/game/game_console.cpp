@@ -45,14 +45,19 @@ void GameConsole::sendMessage(const String& string)
 }
 
 void GameConsole::sendCommand(const String& string)
+{
+	sendMessage(runCommand(string));
+}
+
+String GameConsole::runCommand(const String& string)
 {
 	auto splitStr = string.split(' ');
 	auto command = std::move(splitStr[0]);
 	auto iter = commands.find(command);
 	if (iter != commands.end()) {
 		splitStr.erase(splitStr.begin());
-		sendMessage(iter->second(splitStr));
+		return iter->second(splitStr);
 	} else {
-		sendMessage("Unknown command: " + command);
+		return "Unknown command: " + command;
 	}
 }
@@ -8,6 +8,7 @@
 #include <thread>
 #include "halley/support/logger.h"
 #include "api/system_api.h"
+#include "halley/core/game/environment.h"
 
 using namespace Halley;
 
@@ -55,25 +56,33 @@ HalleyStatics::~HalleyStatics()
 	pimpl.reset();
 }
 
-void HalleyStatics::resume(SystemAPI* system)
+void HalleyStatics::resume(SystemAPI* system, const Environment* environment)
 {
 	setupGlobals();
 
 #if HAS_THREADS
-	auto makeThread = [=] (String name, std::function<void()> runnable) -> std::thread
+	auto makeThreadFor = [=] (const String& poolName) -> ThreadPool::MakeThread
 	{
-		if (system) {
-			return system->createThread(name, ThreadPriority::Normal, runnable);
-		} else {
-			return std::thread([=] () {
+		const auto settings = environment ? environment->getThreadSettings(poolName) : ThreadSettings();
+		return [=] (String name, std::function<void()> runnable) -> std::thread
+		{
+			auto run = [=] () {
+				OS::get().setThreadPriority(settings.priority);
+				OS::get().setThreadAffinity(settings.affinityMask);
 				runnable();
-			});
-		}
+			};
+
+			if (system) {
+				return system->createThread(name, settings.priority, run);
+			} else {
+				return std::thread(run);
+			}
+		};
 	};
 
-	pimpl->cpuThreadPool = std::make_unique<ThreadPool>("CPU", pimpl->executors->getCPU(), std::thread::hardware_concurrency(), makeThread);
-	pimpl->cpuAuxThreadPool = std::make_unique<ThreadPool>("CPUAux", pimpl->executors->getCPUAux(), std::thread::hardware_concurrency(), makeThread);
-	pimpl->diskIOThreadPool = std::make_unique<ThreadPool>("IO", pimpl->executors->getDiskIO(), 1, makeThread);
+	pimpl->cpuThreadPool = std::make_unique<ThreadPool>("CPU", pimpl->executors->getCPU(), std::thread::hardware_concurrency(), makeThreadFor("CPU"));
+	pimpl->cpuAuxThreadPool = std::make_unique<ThreadPool>("CPUAux", pimpl->executors->getCPUAux(), std::thread::hardware_concurrency(), makeThreadFor("CPUAux"));
+	pimpl->diskIOThreadPool = std::make_unique<ThreadPool>("IO", pimpl->executors->getDiskIO(), 1, makeThreadFor("IO"));
 #endif
 }
 
@@ -0,0 +1,40 @@
+#include "halley/core/game/startup_profile.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+using namespace Halley;
+
+StartupProfile::StartupProfile()
+	: startTime(std::chrono::steady_clock::now())
+	, mainThread(std::this_thread::get_id())
+{
+}
+
+void StartupProfile::add(const String& name, int64_t startNs, int64_t endNs)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	phases.push_back(Phase{ name, startNs, endNs, std::this_thread::get_id() });
+}
+
+int64_t StartupProfile::getTimeNs() const
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+String StartupProfile::generateReport() const
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	auto sorted = phases;
+	std::stable_sort(sorted.begin(), sorted.end(), [] (const Phase& a, const Phase& b) { return a.startNs < b.startNs; });
+
+	std::stringstream ss;
+	ss << std::fixed << std::setprecision(1);
+	ss << std::right << std::setw(10) << "Start ms" << std::setw(10) << "ms" << "  " << std::left << std::setw(8) << "Thread" << "Phase" << "\n";
+	for (auto& p: sorted) {
+		ss << std::right << std::setw(10) << (double(p.startNs) / 1000000.0) << std::setw(10) << (double(p.endNs - p.startNs) / 1000000.0)
+			<< "  " << std::left << std::setw(8) << (p.thread == mainThread ? "main" : "worker") << p.name.cppStr() << "\n";
+	}
+	return ss.str();
+}
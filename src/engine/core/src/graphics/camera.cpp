@@ -83,6 +83,13 @@ Camera& Camera::setViewPort(Rect4i v)
 	return *this;
 }
 
+Camera& Camera::setResolutionScale(float scale)
+{
+	Expects(scale > 0);
+	resolutionScale = scale;
+	return *this;
+}
+
 void Camera::updateProjection(bool flipVertical)
 {
 	Vector2i area = getActiveViewPort().getSize();
@@ -93,8 +100,9 @@ void Camera::updateProjection(bool flipVertical)
 	projection = Matrix4f::makeOrtho2D(-w/2, w/2, flipVertical ? h/2 : -h/2, flipVertical ? -h/2 : h/2, -1000, 1000);
 
 	// Camera properties
-	if (zoom != 1.0f) {
-		projection.scale2D(zoom, zoom);
+	const float totalZoom = zoom * resolutionScale;
+	if (totalZoom != 1.0f) {
+		projection.scale2D(totalZoom, totalZoom);
 	}
 	if (angle.getRadians() != 0) {
 		projection.rotateZ(-angle);
@@ -128,7 +136,7 @@ Rect4i Camera::getActiveViewPort() const
 Rect4f Camera::getClippingRectangle() const
 {
 	auto vp = getActiveViewPort();
-	auto halfSize = Vector2f(vp.getSize()) / (zoom * 2);
+	auto halfSize = Vector2f(vp.getSize()) / (zoom * resolutionScale * 2);
 	auto a = halfSize.rotate(angle);
 	auto b = Vector2f(-halfSize.x, halfSize.y).rotate(angle);
 	auto rotatedHalfSize = Vector2f(std::max(std::abs(a.x), std::abs(b.x)), std::max(std::abs(a.y), std::abs(b.y)));
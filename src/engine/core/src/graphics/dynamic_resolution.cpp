@@ -0,0 +1,100 @@
+#include "halley/core/graphics/dynamic_resolution.h"
+#include "halley/core/graphics/render_context.h"
+#include "halley/core/graphics/render_target/render_target_texture.h"
+#include "halley/core/graphics/sprite/sprite.h"
+#include "halley/core/graphics/material/material_definition.h"
+#include "halley/core/graphics/texture.h"
+#include "halley/core/api/video_api.h"
+#include "resources/resources.h"
+#include "halley/utils/utils.h"
+#include <cmath>
+
+using namespace Halley;
+
+DynamicResolution::DynamicResolution(VideoAPI& video, Resources& resources)
+	: DynamicResolution(video, resources, Settings())
+{
+}
+
+DynamicResolution::DynamicResolution(VideoAPI& video, Resources& resources, Settings settings)
+	: video(video)
+	, material(resources.get<MaterialDefinition>("Halley/Sprite"))
+	, settings(settings)
+	, scale(settings.maxScale)
+{
+}
+
+float DynamicResolution::getScale() const
+{
+	return scale;
+}
+
+void DynamicResolution::setSettings(Settings s)
+{
+	settings = s;
+	scale = clamp(scale, settings.minScale, settings.maxScale);
+	framesSinceChange = 0;
+}
+
+void DynamicResolution::render(RenderContext& context, Camera& camera, std::function<void(Painter&)> drawWorld)
+{
+	// The target is always screen-sized, and only its viewport follows the scale, so changing it never reallocates
+	const Vector2i screenSize = context.getDefaultRenderTarget().getViewPort().getSize();
+	const Vector2i size = Vector2i::max(Vector2i((Vector2f(screenSize) * scale).round()), Vector2i(1, 1));
+
+	auto& pool = video.getRenderTargetPool();
+	auto target = pool.acquire(RenderTargetPool::Description(screenSize, TextureFormat::RGBA, true));
+	target->setViewPort(Rect4i(Vector2i(), size));
+
+	const float prevScale = camera.getResolutionScale();
+	camera.setResolutionScale(prevScale * float(size.x) / float(screenSize.x));
+	context.with(*target).with(camera).bind(drawWorld);
+	camera.setResolutionScale(prevScale);
+
+	Camera screenCamera(Vector2f(screenSize) * 0.5f);
+	context.with(screenCamera).bind([&] (Painter& painter)
+	{
+		Sprite()
+			.setImage(target->getTexture(0), material)
+			.setTexRect(Rect4f(Vector2f(), Vector2f(size) / Vector2f(screenSize)))
+			.setSize(Vector2f(screenSize))
+			.setPivot(Vector2f())
+			.setPosition(Vector2f())
+			.draw(painter);
+
+		updateScale(painter.getGPUTime(StopwatchAveraging::Mode::Latest));
+	});
+
+	target->resetViewPort();
+	pool.release(target);
+}
+
+void DynamicResolution::updateScale(int64_t gpuTimeNs)
+{
+	// GPU times lag a few frames behind, so after each change, wait until they reflect it before looking at them again
+	++framesSinceChange;
+	const int settleFrames = Painter::gpuTimerLatency + 1;
+	if (gpuTimeNs <= 0 || framesSinceChange <= settleFrames) {
+		return;
+	}
+	smoothedGPUTime = framesSinceChange == settleFrames + 1 ? gpuTimeNs : (smoothedGPUTime * 3 + gpuTimeNs) / 4;
+
+	// GPU time goes roughly with the number of pixels drawn, i.e. with the square of the scale
+	const float budget = float(settings.targetGPUTimeNs) / float(smoothedGPUTime);
+	float newScale = scale;
+	if (budget < 1.0f) {
+		// Over budget means dropping frames, so go straight to whatever should fit
+		newScale = std::max(scale * std::sqrt(budget), settings.minScale);
+	} else if (framesSinceChange > 30) {
+		// Only go back up once it's been steady for a while, in small steps, and leaving some headroom
+		const float ideal = scale * std::sqrt(budget * 0.9f);
+		if (ideal > scale + 0.02f) {
+			newScale = std::min(std::min(ideal, scale + 0.1f), settings.maxScale);
+		}
+	}
+
+	if (std::abs(newScale - scale) > 0.001f) {
+		scale = newScale;
+		framesSinceChange = 0;
+	}
+}
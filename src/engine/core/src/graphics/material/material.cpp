@@ -9,9 +9,6 @@
 
 using namespace Halley;
 
-static Material* currentMaterial = nullptr;
-static int currentPass = 0;
-
 constexpr static int shaderStageCount = int(ShaderType::NumOfShaderTypes);
 
 MaterialDataBlock::MaterialDataBlock()
@@ -20,14 +17,18 @@ MaterialDataBlock::MaterialDataBlock()
 
 MaterialDataBlock::MaterialDataBlock(MaterialDataBlockType type, size_t size, int bindPoint, const String& name, const MaterialDefinition& def)
 	: data(type == MaterialDataBlockType::SharedExternal ? 0 : size, 0)
-	, addresses(def.getNumPasses() * shaderStageCount)
+	, addresses(def.getNumPasses() * def.getNumVariants() * shaderStageCount)
+	, numVariants(def.getNumVariants())
 	, dataBlockType(type)
 	, bindPoint(bindPoint)
 {
+	// Each variant is its own shader, so locations can differ between them
 	for (int i = 0; i < def.getNumPasses(); ++i) {
-		auto& shader = def.getPass(i).getShader();
-		for (int j = 0; j < shaderStageCount; ++j) {
-			addresses[i * shaderStageCount + j] = shader.getBlockLocation(name, ShaderType(j));
+		for (int v = 0; v < numVariants; ++v) {
+			auto& shader = def.getPass(i).getShader(v);
+			for (int j = 0; j < shaderStageCount; ++j) {
+				addresses[(i * numVariants + v) * shaderStageCount + j] = shader.getBlockLocation(name, ShaderType(j));
+			}
 		}
 	}
 }
@@ -35,29 +36,26 @@ MaterialDataBlock::MaterialDataBlock(MaterialDataBlockType type, size_t size, in
 MaterialDataBlock::MaterialDataBlock(const MaterialDataBlock& other)
 	: data(other.data)
 	, addresses(other.addresses)
+	, numVariants(other.numVariants)
 	, dataBlockType(other.dataBlockType)
 	, bindPoint(other.bindPoint)
-	, dirty(true)
+	, hash(other.hash)
+	, needToUpdateHash(other.needToUpdateHash)
 {}
 
 MaterialDataBlock::MaterialDataBlock(MaterialDataBlock&& other) noexcept
-	: constantBuffer(std::move(other.constantBuffer))
-	, data(std::move(other.data))
+	: data(std::move(other.data))
 	, addresses(std::move(other.addresses))
+	, numVariants(other.numVariants)
 	, dataBlockType(other.dataBlockType)
 	, bindPoint(other.bindPoint)
-	, dirty(other.dirty)
+	, hash(other.hash)
+	, needToUpdateHash(other.needToUpdateHash)
 {}
 
-MaterialConstantBuffer& MaterialDataBlock::getConstantBuffer() const
-{
-	Expects(constantBuffer);
-	return *constantBuffer;
-}
-
-int MaterialDataBlock::getAddress(int pass, ShaderType stage) const
+int MaterialDataBlock::getAddress(int pass, ShaderType stage, uint32_t variant) const
 {
-	return addresses[pass * shaderStageCount + int(stage)];
+	return addresses[(pass * numVariants + variant) * shaderStageCount + int(stage)];
 }
 
 int MaterialDataBlock::getBindPoint() const
@@ -75,6 +73,15 @@ MaterialDataBlockType MaterialDataBlock::getType() const
 	return dataBlockType;
 }
 
+uint64_t MaterialDataBlock::getHash() const
+{
+	if (needToUpdateHash) {
+		hash = Hash::hash(getData());
+		needToUpdateHash = false;
+	}
+	return hash;
+}
+
 bool MaterialDataBlock::setUniform(size_t offset, ShaderParameterType type, void* srcData)
 {
 	Expects(dataBlockType != MaterialDataBlockType::SharedExternal);
@@ -85,27 +92,13 @@ bool MaterialDataBlock::setUniform(size_t offset, ShaderParameterType type, void
 
 	if (memcmp(data.data() + offset, srcData, size) != 0) {
 		memcpy(data.data() + offset, srcData, size);
-		dirty = true;
+		needToUpdateHash = true;
 		return true;
 	} else {
 		return false;
 	}
 }
 
-void MaterialDataBlock::upload(VideoAPI* api)
-{
-	if (dataBlockType != MaterialDataBlockType::SharedExternal) {
-		if (!constantBuffer) {
-			constantBuffer = api->createConstantBuffer();
-			dirty = true;
-		}
-		if (dirty) {
-			constantBuffer->update(*this);
-			dirty = false;
-		}
-	}
-}
-
 Material::Material(const Material& other)
 	: materialDefinition(other.materialDefinition)
 	, uniforms(other.uniforms)
@@ -113,6 +106,7 @@ Material::Material(const Material& other)
 	, dataBlocks(other.dataBlocks)
 	, textures(other.textures)
 	, passEnabled(other.passEnabled)
+	, variant(other.variant)
 {
 	for (auto& u: uniforms) {
 		u.rebind(*this);
@@ -135,7 +129,7 @@ void Material::initUniforms(bool forceLocalBlocks)
 		for (auto& uniform: uniformBlock.uniforms) {
 			auto size = MaterialAttribute::getAttributeSize(uniform.type);
 			curOffset = alignUp(curOffset, std::min(size_t(16), size));
-			uniforms.push_back(MaterialParameter(*this, uniform.name, uniform.type, blockNumber, curOffset));
+			uniforms.push_back(MaterialParameter(*this, uniform.name, uniform.nameId, uniform.type, blockNumber, curOffset));
 			curOffset += size;
 		}
 		auto type = uniformBlock.name == "HalleyBlock"
@@ -154,32 +148,10 @@ void Material::initUniforms(bool forceLocalBlocks)
 
 void Material::bind(int passNumber, Painter& painter)
 {
-	// Avoid redundant work
-	if (currentMaterial == this && currentPass == passNumber && !needToUploadData) {
-		return;
-	}
-	currentMaterial = this;
-	currentPass = passNumber;
-
+	// Redundant binds are skipped by the painter, which caches by content
 	painter.setMaterialPass(*this, passNumber);
 }
 
-void Material::uploadData(Painter& painter)
-{	
-	if (needToUploadData) {
-		for (auto& block: dataBlocks) {
-			block.upload(getDefinition().api);
-		}
-		needToUploadData = false;
-	}
-}
-
-void Material::resetBindCache()
-{
-	currentMaterial = nullptr;
-	currentPass = 0;
-}
-
 bool Material::operator==(const Material& other) const
 {
 	// Same instance
@@ -222,6 +194,11 @@ bool Material::operator==(const Material& other) const
 			}
 		}
 
+		// Different variant
+		if (variant != other.variant) {
+			return false;
+		}
+
 		// Must be the same
 		return true;
 	}
@@ -240,7 +217,6 @@ const std::vector<std::shared_ptr<const Texture>>& Material::getTextures() const
 void Material::setUniform(int blockNumber, size_t offset, ShaderParameterType type, void* data)
 {
 	if (dataBlocks[blockNumber].setUniform(offset, type, data)) {
-		needToUploadData = true;
 		needToUpdateHash = true;
 	}
 }
@@ -258,6 +234,7 @@ uint64_t Material::computeHash() const
 	}
 
 	hasher.feedBytes(gsl::as_bytes(gsl::span<const char>(passEnabled.data(), passEnabled.size())));
+	hasher.feed(variant);
 
 	return hasher.digest();
 }
@@ -292,6 +269,27 @@ bool Material::isPassEnabled(int pass) const
 	return passEnabled[pass];
 }
 
+Material& Material::setKeyword(const String& keyword, bool enabled)
+{
+	const auto mask = materialDefinition->getKeywordMask(keyword);
+	return setVariant(enabled ? (variant | mask) : (variant & ~mask));
+}
+
+bool Material::isKeywordEnabled(const String& keyword) const
+{
+	return (variant & materialDefinition->getKeywordMask(keyword)) != 0;
+}
+
+Material& Material::setVariant(uint32_t v)
+{
+	Expects(v < uint32_t(materialDefinition->getNumVariants()));
+	if (variant != v) {
+		variant = v;
+		needToUpdateHash = true;
+	}
+	return *this;
+}
+
 const Vector<MaterialTextureParameter>& Material::getTextureUniforms() const
 {
 	return textureUniforms;
@@ -302,11 +300,7 @@ Material& Material::set(const String& name, const std::shared_ptr<const Texture>
 	auto& texs = materialDefinition->getTextures();
 	for (size_t i = 0; i < texs.size(); ++i) {
 		if (texs[i] == name) {
-			const auto textureUnit = i;
-			if (textures[textureUnit] != texture) {
-				textures[textureUnit] = texture;
-				needToUpdateHash = true;
-			}
+			setTexture(i, texture);
 			return *this;
 		}
 	}
@@ -319,6 +313,32 @@ Material& Material::set(const String& name, const std::shared_ptr<Texture>& text
 	return set(name, std::shared_ptr<const Texture>(texture));
 }
 
+Material& Material::set(StringId name, const std::shared_ptr<const Texture>& texture)
+{
+	auto& texs = materialDefinition->getTextureIds();
+	for (size_t i = 0; i < texs.size(); ++i) {
+		if (texs[i] == name) {
+			setTexture(i, texture);
+			return *this;
+		}
+	}
+
+	throw Exception("Texture sampler \"" + name.getString() + "\" not available in material \"" + materialDefinition->getName() + "\"", HalleyExceptions::Graphics);
+}
+
+Material& Material::set(StringId name, const std::shared_ptr<Texture>& texture)
+{
+	return set(name, std::shared_ptr<const Texture>(texture));
+}
+
+void Material::setTexture(size_t textureUnit, const std::shared_ptr<const Texture>& texture)
+{
+	if (textures[textureUnit] != texture) {
+		textures[textureUnit] = texture;
+		needToUpdateHash = true;
+	}
+}
+
 bool Material::hasParameter(const String& name) const
 {
 	for (auto& u: uniforms) {
@@ -329,6 +349,16 @@ bool Material::hasParameter(const String& name) const
 	return false;
 }
 
+bool Material::hasParameter(StringId name) const
+{
+	for (auto& u: uniforms) {
+		if (u.nameId == name) {
+			return true;
+		}
+	}
+	return false;
+}
+
 uint64_t Material::getHash() const
 {
 	if (needToUpdateHash) {
@@ -349,6 +379,17 @@ MaterialParameter& Material::getParameter(const String& name)
 	throw Exception("Uniform \"" + name + "\" not available in material \"" + materialDefinition->getName() + "\"", HalleyExceptions::Graphics);
 }
 
+MaterialParameter& Material::getParameter(StringId name)
+{
+	for (auto& u : uniforms) {
+		if (u.nameId == name) {
+			return u;
+		}
+	}
+
+	throw Exception("Uniform \"" + name.getString() + "\" not available in material \"" + materialDefinition->getName() + "\"", HalleyExceptions::Graphics);
+}
+
 std::shared_ptr<Material> Material::clone() const
 {
 	return std::make_shared<Material>(*this);
@@ -9,6 +9,8 @@
 #include "halley/text/string_converter.h"
 #include "halley/file_formats/binary_file.h"
 #include "halley/file_formats/config_file.h"
+#include "halley/utils/hash.h"
+#include <algorithm>
 
 using namespace Halley;
 
@@ -18,9 +20,20 @@ MaterialUniform::MaterialUniform()
 
 MaterialUniform::MaterialUniform(String name, ShaderParameterType type)
 	: name(name)
+	, nameId(name)
 	, type(type)
 {}
 
+bool MaterialUniform::operator==(const MaterialUniform& other) const
+{
+	return name == other.name && type == other.type;
+}
+
+bool MaterialUniform::operator!=(const MaterialUniform& other) const
+{
+	return !(*this == other);
+}
+
 void MaterialUniform::serialize(Serializer& s) const
 {
 	s << name;
@@ -31,6 +44,7 @@ void MaterialUniform::deserialize(Deserializer& s)
 {
 	s >> name;
 	s >> type;
+	nameId = StringId(name);
 }
 
 MaterialUniformBlock::MaterialUniformBlock() {}
@@ -40,6 +54,16 @@ MaterialUniformBlock::MaterialUniformBlock(const String& name, const Vector<Mate
 	, uniforms(uniforms)
 {}
 
+bool MaterialUniformBlock::operator==(const MaterialUniformBlock& other) const
+{
+	return name == other.name && uniforms == other.uniforms;
+}
+
+bool MaterialUniformBlock::operator!=(const MaterialUniformBlock& other) const
+{
+	return !(*this == other);
+}
+
 void MaterialUniformBlock::serialize(Serializer& s) const
 {
 	s << name;
@@ -65,6 +89,16 @@ MaterialAttribute::MaterialAttribute(String name, ShaderParameterType type, int
 	, offset(offset)
 {}
 
+bool MaterialAttribute::operator==(const MaterialAttribute& other) const
+{
+	return name == other.name && type == other.type && location == other.location && offset == other.offset;
+}
+
+bool MaterialAttribute::operator!=(const MaterialAttribute& other) const
+{
+	return !(*this == other);
+}
+
 void MaterialAttribute::serialize(Serializer& s) const
 {
 	s << name;
@@ -111,7 +145,7 @@ MaterialDefinition::MaterialDefinition(ResourceLoader& loader)
 	api = loader.getAPI().video;
 	int i = 0;
 	for (auto& p: passes) {
-		p.createShader(loader, name + "/pass" + toString(i++), attributes);
+		p.createShader(loader, name + "/pass" + toString(i++), attributes, getNumVariants());
 	}
 }
 
@@ -136,6 +170,9 @@ void MaterialDefinition::load(const ConfigNode& root)
 	if (root.hasKey("textures")) {
 		loadTextures(root["textures"]);
 	}
+	if (root.hasKey("keywords")) {
+		loadKeywords(root["keywords"]);
+	}
 }
 
 int MaterialDefinition::getNumPasses() const
@@ -177,6 +214,19 @@ size_t MaterialDefinition::getVertexPosOffset() const
 	return size_t(vertexPosOffset);
 }
 
+bool MaterialDefinition::isInstanceable() const
+{
+	return instanceable;
+}
+
+void MaterialDefinition::updateInstancing()
+{
+	instanceable = std::any_of(attributes.begin(), attributes.end(), [] (const MaterialAttribute& a) { return a.name == "a_vertPos"; });
+	for (auto& a: attributes) {
+		a.perInstance = instanceable && a.name != "a_vertPos";
+	}
+}
+
 void MaterialDefinition::addPass(const MaterialPass& materialPass)
 {
 	passes.push_back(materialPass);
@@ -187,6 +237,45 @@ std::unique_ptr<MaterialDefinition> MaterialDefinition::loadResource(ResourceLoa
 	return std::make_unique<MaterialDefinition>(loader);
 }
 
+bool MaterialDefinition::updateInPlace(MaterialDefinition& definition, ResourceLoader& loader)
+{
+	auto data = loader.getStatic();
+	if (!data) {
+		return false;
+	}
+	MaterialDefinition next;
+	Deserializer s(data->getSpan());
+	s >> next;
+
+	// Materials lay out their uniforms and look up their block locations from these
+	if (next.attributes != definition.attributes || next.uniformBlocks != definition.uniformBlocks || next.textures != definition.textures || next.keywords != definition.keywords || next.passes.size() != definition.passes.size()) {
+		return false;
+	}
+
+	auto& api = loader.getAPI();
+	for (size_t i = 0; i < next.passes.size(); ++i) {
+		auto& cur = definition.passes[i];
+		if (next.passes[i].shaderAssetId != cur.shaderAssetId) {
+			return false;
+		}
+		uint64_t hash = 0;
+		for (int v = 0; v < definition.getNumVariants(); ++v) {
+			auto shaderData = api.getResource<ShaderFile>(MaterialPass::getVariantAssetId(cur.shaderAssetId, v) + ":" + api.video->getShaderLanguage());
+			hash = MaterialPass::hashShaders(*shaderData, hash);
+		}
+		if (hash != cur.shaderHash) {
+			return false;
+		}
+	}
+
+	// Same shaders, so only the pass state can differ, which is read every time a pass is bound
+	for (size_t i = 0; i < next.passes.size(); ++i) {
+		definition.passes[i].blend = next.passes[i].blend;
+		definition.passes[i].depthStencil = next.passes[i].depthStencil;
+	}
+	return true;
+}
+
 void MaterialDefinition::serialize(Serializer& s) const
 {
 	s << name;
@@ -196,6 +285,7 @@ void MaterialDefinition::serialize(Serializer& s) const
 	s << attributes;
 	s << vertexSize;
 	s << vertexPosOffset;
+	s << keywords;
 }
 
 void MaterialDefinition::deserialize(Deserializer& s)
@@ -207,6 +297,13 @@ void MaterialDefinition::deserialize(Deserializer& s)
 	s >> attributes;
 	s >> vertexSize;
 	s >> vertexPosOffset;
+	s >> keywords;
+
+	textureIds.clear();
+	for (auto& t: textures) {
+		textureIds.push_back(StringId(t));
+	}
+	updateInstancing();
 }
 
 void MaterialDefinition::loadUniforms(const ConfigNode& node)
@@ -241,8 +338,35 @@ void MaterialDefinition::loadTextures(const ConfigNode& node)
 			}
 
 			textures.push_back(name);
+			textureIds.push_back(StringId(name));
+		}
+	}
+}
+
+void MaterialDefinition::loadKeywords(const ConfigNode& node)
+{
+	// Added to the base material's, if any
+	for (auto& keywordNode: node.asSequence()) {
+		const auto keyword = keywordNode.asString();
+		if (std::find(keywords.begin(), keywords.end(), keyword) == keywords.end()) {
+			keywords.push_back(keyword);
 		}
 	}
+
+	// Every variant is compiled for every pass and language, so this grows quickly
+	if (keywords.size() > maxKeywords) {
+		throw Exception("Material \"" + name + "\" has " + toString(keywords.size()) + " keywords, but at most " + toString(maxKeywords) + " are supported.", HalleyExceptions::Resources);
+	}
+}
+
+uint32_t MaterialDefinition::getKeywordMask(const String& keyword) const
+{
+	for (size_t i = 0; i < keywords.size(); ++i) {
+		if (keywords[i] == keyword) {
+			return 1u << i;
+		}
+	}
+	throw Exception("Keyword \"" + keyword + "\" not available in material \"" + name + "\"", HalleyExceptions::Graphics);
 }
 
 void MaterialDefinition::loadAttributes(const ConfigNode& node)
@@ -272,6 +396,7 @@ void MaterialDefinition::loadAttributes(const ConfigNode& node)
 	}
 
 	vertexSize = offset;
+	updateInstancing();
 }
 
 ShaderParameterType MaterialDefinition::parseParameterType(String rawType) const
@@ -454,16 +579,39 @@ void MaterialPass::deserialize(Deserializer& s)
 	s >> depthStencil;
 }
 
-void MaterialPass::createShader(ResourceLoader& loader, String name, const Vector<MaterialAttribute>& attributes)
+void MaterialPass::createShader(ResourceLoader& loader, String name, const Vector<MaterialAttribute>& attributes, int numVariants)
 {
 	auto& api = loader.getAPI();
 	auto& video = *api.video;
-	auto shaderData = api.getResource<ShaderFile>(shaderAssetId + ":" + video.getShaderLanguage());
 
-	ShaderDefinition definition;
-	definition.name = name;
-	definition.vertexAttributes = attributes;
-	definition.shaders = shaderData->shaders;
+	shaders.clear();
+	shaderHash = 0;
+	for (int v = 0; v < numVariants; ++v) {
+		auto shaderData = api.getResource<ShaderFile>(getVariantAssetId(shaderAssetId, v) + ":" + video.getShaderLanguage());
+
+		ShaderDefinition definition;
+		definition.name = v == 0 ? name : name + "/v" + toString(v);
+		definition.vertexAttributes = attributes;
+		definition.shaders = shaderData->shaders;
 
-	shader = video.createShader(definition);
+		shaders.push_back(video.createShader(definition));
+		shaderHash = hashShaders(*shaderData, shaderHash);
+	}
+}
+
+String MaterialPass::getVariantAssetId(const String& shaderAssetId, uint32_t variant)
+{
+	// Variant 0 keeps the plain name, so materials without keywords import exactly as before
+	return variant == 0 ? shaderAssetId : shaderAssetId + "_v" + toString(variant);
+}
+
+uint64_t MaterialPass::hashShaders(const ShaderFile& shaderFile, uint64_t seed)
+{
+	Hash::Hasher hasher;
+	hasher.feed(seed);
+	for (auto& s: shaderFile.shaders) {
+		hasher.feed(s.first);
+		hasher.feedBytes(gsl::as_bytes(gsl::span<const Byte>(s.second)));
+	}
+	return hasher.digest();
 }
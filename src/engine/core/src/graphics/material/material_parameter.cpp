@@ -13,24 +13,28 @@ MaterialTextureParameter::MaterialTextureParameter(Material& material, const Str
 	: name(name)
 {
 	auto& definition = material.getDefinition();
-	addresses.resize(definition.passes.size() * shaderStageCount);
+	numVariants = definition.getNumVariants();
+	addresses.resize(definition.passes.size() * numVariants * shaderStageCount);
 	for (size_t i = 0; i < definition.passes.size(); i++) {
-		auto& shader = definition.passes[i].getShader();
-		for (int j = 0; j < shaderStageCount; ++j) {
-			addresses[i * shaderStageCount + j] = shader.getUniformLocation(name, ShaderType(j));
+		for (int v = 0; v < numVariants; ++v) {
+			auto& shader = definition.passes[i].getShader(v);
+			for (int j = 0; j < shaderStageCount; ++j) {
+				addresses[(i * numVariants + v) * shaderStageCount + j] = shader.getUniformLocation(name, ShaderType(j));
+			}
 		}
 	}
 }
 
-unsigned MaterialTextureParameter::getAddress(int pass, ShaderType stage) const
+unsigned MaterialTextureParameter::getAddress(int pass, ShaderType stage, uint32_t variant) const
 {
-	return addresses[pass * shaderStageCount + int(stage)];
+	return addresses[(pass * numVariants + variant) * shaderStageCount + int(stage)];
 }
 
-MaterialParameter::MaterialParameter(Material& material, const String& name, ShaderParameterType type, int blockNumber, size_t offset)
+MaterialParameter::MaterialParameter(Material& material, const String& name, StringId nameId, ShaderParameterType type, int blockNumber, size_t offset)
 	: material(&material)
 	, type(type)
 	, name(name)
+	, nameId(nameId)
 	, blockNumber(blockNumber)
 	, offset(offset)
 {
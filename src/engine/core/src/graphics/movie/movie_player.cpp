@@ -5,6 +5,8 @@
 #include "halley/core/graphics/texture.h"
 #include "halley/core/graphics/render_target/render_target_texture.h"
 #include "halley/core/api/video_api.h"
+#include "halley/core/graphics/material/material.h"
+#include "halley/core/graphics/material/material_parameter.h"
 #include "halley/core/graphics/material/material_definition.h"
 #include "halley/core/graphics/render_context.h"
 #include "halley/audio/audio_clip.h"
@@ -129,12 +131,7 @@ void MoviePlayer::update(Time t)
 			if (!pendingFrames.empty()) {
 				auto& next = pendingFrames.front();
 				if (time >= next.time) {
-					if (currentTexture) {
-						if (shouldRecycleTextures()) {
-							recycleTexture.push_back(currentTexture);
-						}
-						onDoneUsingTexture(currentTexture);
-					}
+					releaseCurrentTexture();
 					currentTexture = next.texture;
 					pendingFrames.pop_front();
 				}
@@ -167,10 +164,19 @@ void MoviePlayer::render(Resources& resources, RenderContext& rc)
 		auto c = rc.with(*renderTarget).with(cam);
 		c.bind([&] (Painter& painter)
 		{
+			const auto textureSize = currentTexture->getSize();
 			auto matDef = resources.get<MaterialDefinition>("Halley/NV12Video");
-			Sprite().setImage(currentTexture, matDef).setTexRect(Rect4f(0, 0, 1, 1)).setSize(Vector2f(videoSize)).draw(painter);
+			auto sprite = Sprite().setImage(currentTexture, matDef).setTexRect(Rect4f(0, 0, 1, 1)).setSize(Vector2f(videoSize));
+			sprite.getMaterial()
+				.set("u_frameSize", Vector2f(videoSize))
+				.set("u_textureSize", Vector2f(textureSize))
+				.set("u_yPlaneHeight", float(yPlaneHeight > 0 ? yPlaneHeight : textureSize.y * 2 / 3));
+			sprite.draw(painter);
 		});
-		currentTexture.reset();
+
+		std::shared_ptr<MoviePlayerAliveFlag> alive = getAliveFlag();
+		std::unique_lock<std::mutex> lock(alive->mutex);
+		releaseCurrentTexture();
 	}
 }
 
@@ -361,8 +367,32 @@ AudioAPI& MoviePlayer::getAudioAPI() const
 
 void MoviePlayer::onVideoFrameAvailable(Time time, TextureDescriptor&& descriptor)
 {
-	auto desc = std::make_shared<TextureDescriptor>(std::move(descriptor));
 	auto alive = getAliveFlag();
+	const bool recycle = shouldRecycleTextures();
+
+	if (recycle && canUpdateInPlace(descriptor)) {
+		// Overwrite the pixels of a texture that's done being displayed, instead of creating a new one every frame
+		std::shared_ptr<Texture> tex;
+		{
+			std::unique_lock<std::mutex> lock(alive->mutex);
+			if (!alive->isAlive) {
+				return;
+			}
+			tex = takeRecycledTexture(descriptor.size);
+			if (tex) {
+				insertPendingFrame(tex, time);
+			}
+		}
+
+		if (tex) {
+			tex->updateRegion(Rect4i(Vector2i(), descriptor.size), descriptor.format, descriptor.pixelData.moveBytes());
+			return;
+		}
+	}
+
+	// Recycled textures get updated in place, so they need to be created that way
+	descriptor.canBeUpdated = recycle;
+	auto desc = std::make_shared<TextureDescriptor>(std::move(descriptor));
 
 	Concurrent::execute(Executors::getVideoAux(), [this, time, alive, desc = std::move(desc)] ()
 	{
@@ -380,12 +410,7 @@ void MoviePlayer::onVideoFrameAvailable(Time time, TextureDescriptor&& descripto
 					tex = recycleTexture.front();
 					recycleTexture.pop_front();
 				}
-
-				const auto iter = std::find_if(pendingFrames.begin(), pendingFrames.end(), [=] (const PendingFrame& f)
-				{
-					return f.time > time;
-				});
-				pendingFrames.insert(iter, { tex, time });
+				insertPendingFrame(tex, time);
 			}
 		}
 
@@ -420,3 +445,53 @@ std::shared_ptr<MoviePlayerAliveFlag> MoviePlayer::getAliveFlag() const
 {
 	return aliveFlag;
 }
+
+bool MoviePlayer::canUpdateInPlace(const TextureDescriptor& descriptor) const
+{
+	// updateRegion takes tightly packed pixels only
+	const auto stride = descriptor.pixelData.getStride();
+	return !descriptor.pixelData.empty()
+		&& !TextureDescriptor::isCompressed(descriptor.format)
+		&& descriptor.pixelFormat == PixelDataFormat::Image
+		&& !descriptor.useMipMap
+		&& (!stride || stride.get() == descriptor.size.x * TextureDescriptor::getBitsPerPixel(descriptor.format));
+}
+
+std::shared_ptr<Texture> MoviePlayer::takeRecycledTexture(Vector2i size)
+{
+	const auto iter = std::find_if(recycleTexture.begin(), recycleTexture.end(), [&] (const std::shared_ptr<Texture>& t)
+	{
+		return t->getSize() == size;
+	});
+	if (iter == recycleTexture.end()) {
+		return {};
+	}
+	auto tex = *iter;
+	recycleTexture.erase(iter);
+	return tex;
+}
+
+void MoviePlayer::insertPendingFrame(std::shared_ptr<Texture> texture, Time time)
+{
+	const auto iter = std::find_if(pendingFrames.begin(), pendingFrames.end(), [=] (const PendingFrame& f)
+	{
+		return f.time > time;
+	});
+	pendingFrames.insert(iter, { std::move(texture), time });
+}
+
+void MoviePlayer::releaseCurrentTexture()
+{
+	if (currentTexture) {
+		if (shouldRecycleTextures()) {
+			recycleTexture.push_back(currentTexture);
+		}
+		onDoneUsingTexture(currentTexture);
+		currentTexture.reset();
+	}
+}
+
+void MoviePlayer::setPlaneLayout(int yPlaneHeight)
+{
+	this->yPlaneHeight = yPlaneHeight;
+}
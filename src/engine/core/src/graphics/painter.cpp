@@ -4,9 +4,12 @@
 #include "halley/core/graphics/material/material.h"
 #include "halley/core/graphics/material/material_definition.h"
 #include "halley/core/graphics/material/material_parameter.h"
+#include "halley/core/graphics/texture.h"
 #include <cstring> // memmove
 #include <gsl/gsl_assert>
 #include "resources/resources.h"
+#include "halley/support/profiler.h"
+#include "halley/concurrency/concurrent.h"
 
 using namespace Halley;
 
@@ -19,34 +22,233 @@ Painter::~Painter()
 {
 }
 
+void Painter::startRecording()
+{
+	if (!recording) {
+		recording = spareList ? std::move(spareList) : std::make_unique<RenderCommandList>();
+	}
+	recording->clear();
+	resetPending();
+}
+
+std::unique_ptr<RenderCommandList> Painter::finishRecording()
+{
+	flush();
+	camera = nullptr;
+	viewPort = Rect4i(0, 0, 0, 0);
+	return std::move(recording);
+}
+
+void Painter::recycle(std::unique_ptr<RenderCommandList> list)
+{
+	// Keeps the list's buffers around, so the next frame doesn't have to grow them again
+	spareList = std::move(list);
+}
+
 void Painter::startRender()
 {
-	Material::resetBindCache();
+	resetMaterialCache();
 	prevDrawCalls = nDrawCalls;
 	prevTriangles = nTriangles;
 	prevVertices = nVertices;
 	nDrawCalls = nTriangles = nVertices = 0;
 
-	resetPending();
 	doStartRender();
+
+	gpuTimerSlot = -1;
+	if (supportsTimestamps()) {
+		gpuTimerSlot = int(gpuFrameIndex++ % gpuTimerLatency);
+		gpuOpenRegions = 0;
+		readGPUTimers(gpuTimerSlot);
+
+		auto& frame = gpuTimerFrames[gpuTimerSlot];
+		frame.regions.clear();
+		frame.nTimestamps = 0;
+		frame.cpuStartNs = Profiler::getTimeNs();
+		frame.pending = true;
+		beginTimestamps(gpuTimerSlot);
+		beginGPURegion("Frame");
+	}
+}
+
+void Painter::replay(RenderCommandList& list)
+{
+	Profiler::Scope profile("Painter::replay", ProfilerEventType::Render);
+
+	for (auto& command: list.commands) {
+		switch (command.type) {
+		case RenderCommandType::BindRenderTarget:
+			gpuPassRegion = beginGPURegion("Render target");
+			resetMaterialCache();
+			replayRenderTarget = command.renderTarget;
+			replayRenderTarget->onBind(*this);
+			break;
+
+		case RenderCommandType::UnbindRenderTarget:
+			endGPURegion(gpuPassRegion);
+			resetMaterialCache();
+			command.renderTarget->onUnbind(*this);
+			replayRenderTarget = nullptr;
+			break;
+
+		case RenderCommandType::SetViewPort:
+			setViewPort(command.rect);
+			break;
+
+		case RenderCommandType::SetClip:
+			setClip(command.rect, command.enableClip);
+			break;
+
+		case RenderCommandType::SetProjection:
+			applyProjection(list.projections[command.index]);
+			break;
+
+		case RenderCommandType::Clear:
+			doClear(command.colour);
+			break;
+
+		case RenderCommandType::ClearDepth:
+			doClearDepth();
+			break;
+
+		case RenderCommandType::Draw:
+			{
+				auto& draw = list.draws[command.index];
+				for (auto& texture: draw.material->getTextures()) {
+					if (texture && texture->isStreamed()) {
+						texture->markUsed();
+					}
+				}
+				// Per draw timings are only worth their queries while profiling
+				const size_t drawRegion = Profiler::isEnabled() ? beginGPURegion(Profiler::internName(draw.material->getDefinition().getName())) : size_t(-1);
+				if (draw.geometry) {
+					executeDrawStatic(*draw.material, *draw.geometry, draw);
+				} else if (draw.numInstances > 0) {
+					executeDrawInstancedQuads(*draw.material, draw.numInstances, list.vertexData.data() + draw.vertexStart);
+				} else {
+					executeDrawTriangles(*draw.material, draw.numVertices, list.vertexData.data() + draw.vertexStart, draw.numIndices, list.indexData.data() + draw.indexStart, draw.standardQuadsOnly);
+				}
+				endGPURegion(drawRegion);
+			}
+			break;
+		}
+	}
 }
 
 void Painter::endRender()
 {
-	flush();
+	if (gpuTimerSlot >= 0) {
+		endGPURegion(0);
+		endTimestamps(gpuTimerSlot);
+	}
+
 	doEndRender();
-	camera = nullptr;
-	viewPort = Rect4i(0, 0, 0, 0);
+	replayRenderTarget = nullptr;
+}
+
+int64_t Painter::getGPUTime(StopwatchAveraging::Mode mode) const
+{
+	return gpuFrameTimer.elapsedNanoSeconds(mode);
+}
+
+TimeHistogramStats Painter::getGPUTimeStats(TimeHistogram::Window window) const
+{
+	return gpuFrameTimer.getHistogram().getStats(window);
+}
+
+size_t Painter::beginGPURegion(const char* name)
+{
+	if (gpuTimerSlot < 0) {
+		return size_t(-1);
+	}
+
+	auto& frame = gpuTimerFrames[gpuTimerSlot];
+	// Leaves room for the end of every region that's still open
+	if (frame.nTimestamps + gpuOpenRegions + 2 > maxTimestampsPerFrame) {
+		return size_t(-1);
+	}
+	++gpuOpenRegions;
+	const size_t start = frame.nTimestamps++;
+	writeTimestamp(gpuTimerSlot, start);
+	frame.regions.push_back(GPUTimerRegion{ name, start, size_t(-1) });
+	return frame.regions.size() - 1;
+}
+
+void Painter::endGPURegion(size_t region)
+{
+	if (gpuTimerSlot < 0) {
+		return;
+	}
+
+	auto& frame = gpuTimerFrames[gpuTimerSlot];
+	if (region < frame.regions.size() && frame.regions[region].end == size_t(-1)) {
+		// beginGPURegion always leaves room for this
+		--gpuOpenRegions;
+		const size_t end = frame.nTimestamps++;
+		writeTimestamp(gpuTimerSlot, end);
+		frame.regions[region].end = end;
+	}
+}
+
+void Painter::readGPUTimers(int slot)
+{
+	auto& frame = gpuTimerFrames[slot];
+	if (!frame.pending || frame.regions.empty()) {
+		return;
+	}
+	frame.pending = false;
+
+	// If the results still aren't in, this frame's sample is just dropped
+	if (!readTimestamps(slot, frame.nTimestamps, gpuTimestamps)) {
+		return;
+	}
+
+	// Region 0 is the whole frame. GPU clocks aren't in sync with the CPU's, so events are placed relative to when the frame started submitting.
+	const auto& frameRegion = frame.regions[0];
+	if (frameRegion.end == size_t(-1)) {
+		return;
+	}
+	const int64_t base = gpuTimestamps[frameRegion.start];
+	gpuFrameTimer.addSample(gpuTimestamps[frameRegion.end] - base);
+
+	if (Profiler::isEnabled()) {
+		for (auto& region: frame.regions) {
+			if (region.end != size_t(-1)) {
+				Profiler::recordGPU(region.name, frame.cpuStartNs + gpuTimestamps[region.start] - base, frame.cpuStartNs + gpuTimestamps[region.end] - base);
+			}
+		}
+	}
+}
+
+void Painter::clear(Colour colour)
+{
+	flushPending();
+	recording->addCommand(RenderCommandType::Clear).colour = colour;
+}
+
+void Painter::clearDepth()
+{
+	flushPending();
+	recording->addCommand(RenderCommandType::ClearDepth);
 }
 
 void Painter::flush()
 {
+	Profiler::Scope profile("Painter::flush", ProfilerEventType::Render);
 	flushPending();
 }
 
+Rect4i Painter::getViewPort() const
+{
+	if (resolutionScale == 1.0f) {
+		return viewPort;
+	}
+	return Rect4i(Vector2i((Vector2f(viewPort.getTopLeft()) / resolutionScale).round()), Vector2i((Vector2f(viewPort.getBottomRight()) / resolutionScale).round()));
+}
+
 Rect4f Painter::getWorldViewAABB() const
 {
-	Vector2f size = Vector2f(viewPort.getSize()) / camera->getZoom();
+	Vector2f size = Vector2f(viewPort.getSize()) / (camera->getZoom() * resolutionScale);
 	assert(camera->getAngle().getRadians() == 0); // Camera rotation not accounted by following line
 	return Rect4f(camera->getPosition() - size * 0.5f, size);
 }
@@ -61,7 +263,11 @@ Painter::PainterVertexData Painter::addDrawData(std::shared_ptr<Material>& mater
 	Expects(material);
 	Expects(numVertices > 0);
 	Expects(numIndices >= numVertices);
+	Expects(recording);
 
+	if (instancesPending) {
+		flushPending();
+	}
 	startDrawCall(material);
 
 	PainterVertexData result;
@@ -72,8 +278,8 @@ Painter::PainterVertexData Painter::addDrawData(std::shared_ptr<Material>& mater
 	makeSpaceForPendingVertices(result.dataSize);
 	makeSpaceForPendingIndices(numIndices);
 
-	result.dstVertex = vertexBuffer.data() + bytesPending;
-	result.dstIndex = indexBuffer.data() + indicesPending;
+	result.dstVertex = recording->vertexData.data() + recording->vertexBytesUsed + bytesPending;
+	result.dstIndex = recording->indexData.data() + recording->indicesUsed + indicesPending;
 	result.firstIndex = static_cast<unsigned short>(verticesPending);
 
 	indicesPending += numIndices;
@@ -84,6 +290,28 @@ Painter::PainterVertexData Painter::addDrawData(std::shared_ptr<Material>& mater
 	return result;
 }
 
+char* Painter::addInstanceData(std::shared_ptr<Material>& material, size_t numInstances)
+{
+	Expects(material);
+	Expects(numInstances > 0);
+	Expects(recording);
+
+	if (!instancesPending && verticesPending > 0) {
+		flushPending();
+	}
+	startDrawCall(material);
+
+	const size_t dataSize = numInstances * material->getDefinition().getVertexStride();
+	makeSpaceForPendingVertices(dataSize);
+	char* result = recording->vertexData.data() + recording->vertexBytesUsed + bytesPending;
+
+	verticesPending += numInstances;
+	bytesPending += dataSize;
+	instancesPending = true;
+
+	return result;
+}
+
 void Painter::drawQuads(std::shared_ptr<Material> material, size_t numVertices, const void* vertexData)
 {
 	Expects(numVertices % 4 == 0);
@@ -99,32 +327,67 @@ void Painter::drawSprites(std::shared_ptr<Material> material, size_t numSprites,
 {
 	Expects(vertexData != nullptr);
 
+	const char* const src = reinterpret_cast<const char*>(vertexData);
+	const size_t stride = material->getDefinition().getVertexStride();
+	drawSpritesImpl(material, numSprites, [src, stride] (size_t i) { return src + i * stride; });
+}
+
+void Painter::drawSprites(std::shared_ptr<Material> material, size_t numSprites, const void* const* vertexData)
+{
+	Expects(vertexData != nullptr);
+
+	drawSpritesImpl(material, numSprites, [vertexData] (size_t i) { return reinterpret_cast<const char*>(vertexData[i]); });
+}
+
+template <typename F>
+void Painter::drawSpritesImpl(std::shared_ptr<Material>& material, size_t numSprites, F getSource)
+{
+	const auto& definition = material->getDefinition();
+	if (definition.isInstanceable() && supportsInstancing()) {
+		// Nothing to expand, the backend draws a unit quad per sprite and fills in a_vertPos from it
+		char* dst = addInstanceData(material, numSprites);
+		const size_t vertexSize = definition.getVertexSize();
+		const size_t vertexStride = definition.getVertexStride();
+		for (size_t i = 0; i < numSprites; i++) {
+			memcpy(dst + i * vertexStride, getSource(i), vertexSize);
+		}
+		return;
+	}
+
 	const size_t verticesPerSprite = 4;
 	const size_t numVertices = verticesPerSprite * numSprites;
-	const size_t vertPosOffset = material->getDefinition().getVertexPosOffset();
+	const size_t vertPosOffset = definition.getVertexPosOffset();
 
 	auto result = addDrawData(material, numVertices, numSprites * 6, true);
 
-	const char* const src = reinterpret_cast<const char*>(vertexData);
-
-	for (size_t i = 0; i < numSprites; i++) {
-		for (size_t j = 0; j < verticesPerSprite; j++) {
-			size_t srcOffset = i * result.vertexStride;
-			size_t dstOffset = (i * verticesPerSprite + j) * result.vertexStride;
-			memmove(result.dstVertex + dstOffset, src + srcOffset, result.vertexSize);
-
-			// j -> vertPos
-			// 0 -> 0, 0
-			// 1 -> 1, 0
-			// 2 -> 1, 1
-			// 3 -> 0, 1
-			const float x = ((j & 1) ^ ((j & 2) >> 1)) * 1.0f;
-			const float y = ((j & 2) >> 1) * 1.0f;
-			getVertPos(result.dstVertex + dstOffset, vertPosOffset) = Vector4f(x, y, x, y);
+	// Each sprite writes to its own part of the space reserved above, so large batches can be split across threads
+	auto generate = [&] (size_t start, size_t end)
+	{
+		for (size_t i = start; i < end; i++) {
+			const char* const src = getSource(i);
+			for (size_t j = 0; j < verticesPerSprite; j++) {
+				size_t dstOffset = (i * verticesPerSprite + j) * result.vertexStride;
+				memmove(result.dstVertex + dstOffset, src, result.vertexSize);
+
+				// j -> vertPos
+				// 0 -> 0, 0
+				// 1 -> 1, 0
+				// 2 -> 1, 1
+				// 3 -> 0, 1
+				const float x = ((j & 1) ^ ((j & 2) >> 1)) * 1.0f;
+				const float y = ((j & 2) >> 1) * 1.0f;
+				getVertPos(result.dstVertex + dstOffset, vertPosOffset) = Vector4f(x, y, x, y);
+			}
 		}
-	}
+		generateQuadIndices(static_cast<unsigned short>(result.firstIndex + start * verticesPerSprite), end - start, result.dstIndex + start * 6);
+	};
 
-	generateQuadIndices(result.firstIndex, numSprites, result.dstIndex);
+	constexpr size_t parallelGrain = 1024;
+	if (numSprites >= 2 * parallelGrain) {
+		Concurrent::parallelFor(Executors::getCPU(), Range<size_t>(0, numSprites), parallelGrain, generate, TaskPriority::Critical);
+	} else {
+		generate(0, numSprites);
+	}
 }
 
 void Painter::drawSlicedSprite(std::shared_ptr<Material> material, Vector2f scale, Vector4f slices, const void* vertexData)
@@ -178,19 +441,63 @@ void Painter::drawSlicedSprite(std::shared_ptr<Material> material, Vector2f scal
 	}
 }
 
+void Painter::drawStaticGeometry(const std::shared_ptr<StaticGeometry>& geometry)
+{
+	Expects(geometry);
+	Expects(recording);
+
+	flushPending();
+	for (auto& part: geometry->parts) {
+		if (part.numIndices > 0) {
+			recording->addCommand(RenderCommandType::Draw).index = uint32_t(recording->draws.size());
+			recording->draws.push_back(RenderDrawCommand{ part.material, part.vertexStart, part.numVertices, part.indexStart, part.numIndices, 0, part.standardQuadsOnly, geometry });
+		}
+	}
+}
+
+void Painter::drawStaticGeometry(const std::shared_ptr<StaticGeometry>& geometry, const std::shared_ptr<Material>& material)
+{
+	Expects(geometry);
+	Expects(material);
+	Expects(recording);
+
+	flushPending();
+	for (auto& part: geometry->parts) {
+		if (part.numIndices > 0) {
+			Expects(&part.material->getDefinition() == &material->getDefinition());
+			recording->addCommand(RenderCommandType::Draw).index = uint32_t(recording->draws.size());
+			recording->draws.push_back(RenderDrawCommand{ material, part.vertexStart, part.numVertices, part.indexStart, part.numIndices, 0, part.standardQuadsOnly, geometry });
+		}
+	}
+}
+
+void Painter::setTransform(const Matrix4f& transform)
+{
+	flushPending();
+	recording->addCommand(RenderCommandType::SetProjection).index = uint32_t(recording->projections.size());
+	recording->projections.push_back(camera->getProjection() * transform);
+}
+
+void Painter::resetTransform()
+{
+	flushPending();
+	recording->addCommand(RenderCommandType::SetProjection).index = uint32_t(recording->projections.size());
+	recording->projections.push_back(camera->getProjection());
+}
+
 void Painter::makeSpaceForPendingVertices(size_t numBytes)
 {
-	size_t requiredSize = bytesPending + numBytes;
-	if (vertexBuffer.size() < requiredSize) {
-		vertexBuffer.resize(requiredSize * 2);
+	size_t requiredSize = recording->vertexBytesUsed + bytesPending + numBytes;
+	if (recording->vertexData.size() < requiredSize) {
+		recording->vertexData.resize(requiredSize * 2);
 	}
 }
 
 void Painter::makeSpaceForPendingIndices(size_t numIndices)
 {
-	size_t requiredSize = indicesPending + numIndices;
-	if (indexBuffer.size() < requiredSize) {
-		indexBuffer.resize(requiredSize * 2);
+	size_t requiredSize = recording->indicesUsed + indicesPending + numIndices;
+	if (recording->indexData.size() < requiredSize) {
+		recording->indexData.resize(requiredSize * 2);
 	}
 }
 
@@ -203,11 +510,12 @@ void Painter::bind(RenderContext& context)
 
 	// Set render target
 	activeRenderTarget = &camera->getActiveRenderTarget();
-	activeRenderTarget->onBind(*this);
+	recording->addCommand(RenderCommandType::BindRenderTarget).renderTarget = activeRenderTarget;
 
 	// Set viewport
 	viewPort = camera->getActiveViewPort();
-	setViewPort(getRectangleForActiveRenderTarget(viewPort));
+	resolutionScale = camera->getResolutionScale();
+	recording->addCommand(RenderCommandType::SetViewPort).rect = getRectangleForActiveRenderTarget(viewPort);
 	setClip();
 
 	// Update projection
@@ -217,7 +525,7 @@ void Painter::bind(RenderContext& context)
 void Painter::unbind(RenderContext& context)
 {
 	flush();
-	activeRenderTarget->onUnbind(*this);
+	recording->addCommand(RenderCommandType::UnbindRenderTarget).renderTarget = activeRenderTarget;
 	activeRenderTarget = nullptr;
 	camera->rendering = false;
 }
@@ -230,7 +538,7 @@ void Painter::setRelativeClip(Rect4f rect)
 	float y0 = -std::numeric_limits<float>::infinity();
 	float y1 = std::numeric_limits<float>::infinity();
 	for (auto& p: ps) {
-		auto point = camera->worldToScreen(p, Rect4f(viewPort));
+		auto point = camera->worldToScreen(p, Rect4f(getViewPort()));
 		x0 = std::max(x0, point.x);
 		x1 = std::min(x1, point.x);
 		y0 = std::max(y0, point.y);
@@ -242,14 +550,21 @@ void Painter::setRelativeClip(Rect4f rect)
 void Painter::setClip(Rect4i rect)
 {
 	flushPending();
+	if (resolutionScale != 1.0f) {
+		rect = Rect4i(Vector2i((Vector2f(rect.getTopLeft()) * resolutionScale).floor()), Vector2i((Vector2f(rect.getBottomRight()) * resolutionScale).ceil()));
+	}
 	Rect4i finalRect = (rect + viewPort.getTopLeft()).intersection(viewPort);
-	setClip(getRectangleForActiveRenderTarget(finalRect), finalRect != activeRenderTarget->getViewPort());
+	auto& command = recording->addCommand(RenderCommandType::SetClip);
+	command.rect = getRectangleForActiveRenderTarget(finalRect);
+	command.enableClip = finalRect != activeRenderTarget->getViewPort();
 }
 
 void Painter::setClip()
 {
 	flushPending();
-	setClip(getRectangleForActiveRenderTarget(viewPort), viewPort != activeRenderTarget->getViewPort());
+	auto& command = recording->addCommand(RenderCommandType::SetClip);
+	command.rect = getRectangleForActiveRenderTarget(viewPort);
+	command.enableClip = viewPort != activeRenderTarget->getViewPort();
 }
 
 Rect4i Painter::getRectangleForActiveRenderTarget(Rect4i r)
@@ -277,7 +592,14 @@ void Painter::startDrawCall(std::shared_ptr<Material>& material)
 void Painter::flushPending()
 {
 	if (verticesPending > 0) {
-		executeDrawTriangles(*materialPending, verticesPending, vertexBuffer.data(), indicesPending, indexBuffer.data());
+		recording->addCommand(RenderCommandType::Draw).index = uint32_t(recording->draws.size());
+		if (instancesPending) {
+			recording->draws.push_back(RenderDrawCommand{ materialPending, recording->vertexBytesUsed, 4, recording->indicesUsed, 6, verticesPending, true });
+		} else {
+			recording->draws.push_back(RenderDrawCommand{ materialPending, recording->vertexBytesUsed, verticesPending, recording->indicesUsed, indicesPending, 0, allIndicesAreQuads });
+		}
+		recording->vertexBytesUsed += bytesPending;
+		recording->indicesUsed += indicesPending;
 	}
 
 	resetPending();
@@ -289,31 +611,79 @@ void Painter::resetPending()
 	verticesPending = 0;
 	indicesPending = 0;
 	allIndicesAreQuads = true;
-	if (materialPending) {
-		Material::resetBindCache();
-		materialPending.reset();
-	}
+	instancesPending = false;
+	materialPending.reset();
 }
 
-void Painter::executeDrawTriangles(Material& material, size_t numVertices, void* vertexData, size_t numIndices, unsigned short* indices)
+void Painter::executeDrawTriangles(Material& material, size_t numVertices, void* vertexData, size_t numIndices, unsigned short* indices, bool standardQuadsOnly)
 {
 	startDrawCall();
 
 	// Load vertices
-	setVertices(material.getDefinition(), numVertices, vertexData, numIndices, indices, allIndicesAreQuads);
+	setVertices(material.getDefinition(), numVertices, vertexData, numIndices, indices, standardQuadsOnly);
+
+	drawPasses(material, numVertices, numIndices, false, [&] () { drawTriangles(numIndices); });
+
+	endDrawCall();
+}
+
+void Painter::executeDrawInstancedQuads(Material& material, size_t numInstances, void* instanceData)
+{
+	startDrawCall();
+
+	// Load instances
+	setInstancedVertices(material.getDefinition(), numInstances, instanceData);
 
-	// Load material uniforms
-	material.uploadData(*this);
-	setMaterialData(material);
+	drawPasses(material, numInstances * 4, numInstances * 6, true, [&] () { drawInstancedQuads(numInstances); });
+
+	endDrawCall();
+}
+
+void Painter::executeDrawStatic(Material& material, StaticGeometry& geometry, const RenderDrawCommand& draw)
+{
+	startDrawCall();
+
+	// Uploaded the first time it's drawn, since that's when it's on the right thread
+	if (!geometry.bufferCreated) {
+		geometry.buffer = createStaticGeometryBuffer(geometry);
+		geometry.bufferCreated = true;
+	}
+
+	if (geometry.buffer) {
+		setStaticVertices(material.getDefinition(), *geometry.buffer, draw.vertexStart, draw.indexStart);
+	} else {
+		setVertices(material.getDefinition(), draw.numVertices, geometry.vertexData.data() + draw.vertexStart, draw.numIndices, geometry.indexData.data() + draw.indexStart, draw.standardQuadsOnly);
+	}
+
+	drawPasses(material, draw.numVertices, draw.numIndices, false, [&] () { drawTriangles(draw.numIndices); });
+
+	endDrawCall();
+}
+
+template <typename F>
+void Painter::drawPasses(Material& material, size_t numVertices, size_t numIndices, bool instanced, F draw)
+{
+	// Load material uniforms, unless a material with the same contents is already bound
+	const uint64_t key = getMaterialKey(material);
+	if (key != boundMaterialKey) {
+		setMaterialData(material);
+
+		boundMaterialKey = key;
+		boundMaterialPass = -1;
+	}
 
 	// Go through each pass
 	for (int i = 0; i < material.getDefinition().getNumPasses(); i++) {
 		if (material.isPassEnabled(i)) {
-			// Bind pass
-			material.bind(i, *this);
+			// Bind pass; instancing changes the vertex layout, so it's part of the state
+			if (boundMaterialPass != i || boundMaterialInstanced != instanced) {
+				material.bind(i, *this);
+				boundMaterialPass = i;
+				boundMaterialInstanced = instanced;
+			}
 
 			// Draw
-			drawTriangles(numIndices);
+			draw();
 
 			// Log stats
 			nDrawCalls++;
@@ -321,8 +691,18 @@ void Painter::executeDrawTriangles(Material& material, size_t numVertices, void*
 			nVertices += numVertices;
 		}
 	}
+}
 
-	endDrawCall();
+void Painter::resetMaterialCache()
+{
+	boundMaterialKey = 0;
+	boundMaterialPass = -1;
+}
+
+uint64_t Painter::getMaterialKey(const Material& material)
+{
+	// The hash covers textures, uniform data and enabled passes, but not which definition they belong to
+	return material.getHash() ^ (uint64_t(reinterpret_cast<uintptr_t>(&material.getDefinition())) * 0x9E3779B97F4A7C15ull);
 }
 
 unsigned short* Painter::getStandardQuadIndices(size_t numQuads)
@@ -373,8 +753,9 @@ void Painter::generateQuadIndices(unsigned short pos, size_t numQuads, unsigned
 
 RenderTarget& Painter::getActiveRenderTarget()
 {
-	Expects(activeRenderTarget);
-	return *activeRenderTarget;
+	// Only meaningful to the backend, while replaying
+	Expects(replayRenderTarget);
+	return *replayRenderTarget;
 }
 
 void Painter::generateQuadIndicesOffset(unsigned short pos, unsigned short lineStride, unsigned short* target)
@@ -395,8 +776,13 @@ void Painter::generateQuadIndicesOffset(unsigned short pos, unsigned short lineS
 void Painter::updateProjection()
 {
 	camera->updateProjection(activeRenderTarget->getProjectionFlipVertical());
-	projection = camera->getProjection();
-	
+
+	recording->addCommand(RenderCommandType::SetProjection).index = uint32_t(recording->projections.size());
+	recording->projections.push_back(camera->getProjection());
+}
+
+void Painter::applyProjection(const Matrix4f& projection)
+{
 	auto old = halleyGlobalMaterial->clone();
 	halleyGlobalMaterial->set("u_mvp", projection);
 	if (*old != *halleyGlobalMaterial) {
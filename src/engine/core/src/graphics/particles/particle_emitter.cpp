@@ -0,0 +1,223 @@
+#include "graphics/particles/particle_emitter.h"
+#include "halley/core/graphics/painter.h"
+#include "halley/core/graphics/camera.h"
+#include "halley/core/graphics/static_geometry.h"
+#include "halley/core/graphics/sprite/sprite.h"
+#include "halley/core/graphics/material/material.h"
+#include "halley/core/graphics/material/material_definition.h"
+#include "halley/core/graphics/material/material_parameter.h"
+#include "halley/core/graphics/texture.h"
+#include "halley/file_formats/config_file.h"
+#include "halley/maths/random.h"
+#include "halley/maths/angle.h"
+#include <gsl/gsl_assert>
+#include <array>
+
+using namespace Halley;
+
+namespace {
+	Colour4f readColour(const ConfigNode& node, Colour4f defaultValue)
+	{
+		return node.getType() == ConfigNodeType::Undefined ? defaultValue : Colour4f::fromString(node.asString());
+	}
+
+	Vector2f readRange(const ConfigNode& node, Vector2f defaultValue)
+	{
+		// Either a single value, or a [min, max] pair
+		if (node.getType() == ConfigNodeType::Undefined) {
+			return defaultValue;
+		} else if (node.getType() == ConfigNodeType::Sequence) {
+			return node.asVector2f();
+		} else {
+			return Vector2f(node.asFloat(), node.asFloat());
+		}
+	}
+}
+
+ParticleEmitterConfig::ParticleEmitterConfig(const ConfigNode& node)
+{
+	spawnRate = node["spawnRate"].asFloat(spawnRate);
+	lifetime = readRange(node["lifetime"], lifetime);
+	spawnArea = node["spawnArea"].asVector2f(spawnArea);
+	speed = readRange(node["speed"], speed);
+	angle = readRange(node["angle"], angle);
+	rotationSpeed = readRange(node["rotationSpeed"], rotationSpeed);
+	acceleration = node["acceleration"].asVector2f(acceleration);
+	scale = readRange(node["scale"], scale);
+	startColour = readColour(node["startColour"], startColour);
+	endColour = readColour(node["endColour"], endColour);
+}
+
+ParticleEmitter::ParticleEmitter(std::shared_ptr<const MaterialDefinition> materialDefinition, ParticleEmitterConfig config)
+	: material(std::make_shared<Material>(materialDefinition))
+	, config(std::move(config))
+{
+	generateGeometry();
+}
+
+ParticleEmitter& ParticleEmitter::setSprite(const Sprite& sprite)
+{
+	const auto& vertex = sprite.getVertexAttrib();
+	return setImage(sprite.getMaterial().getTexture(0), vertex.texRect, vertex.size, vertex.pivot);
+}
+
+ParticleEmitter& ParticleEmitter::setImage(std::shared_ptr<const Texture> texture, Rect4f rect, Vector2f size, Vector2f p)
+{
+	material->set("tex0", texture);
+	texRect = rect;
+	spriteSize = size;
+	pivot = p;
+	return *this;
+}
+
+ParticleEmitter& ParticleEmitter::setPosition(Vector2f p)
+{
+	position = p;
+	return *this;
+}
+
+ParticleEmitter& ParticleEmitter::setEmitting(bool e)
+{
+	if (emitting != e) {
+		emitting = e;
+		if (emitting) {
+			// Particles from before would be spawned again, since they're a function of time
+			time = 0;
+		} else {
+			stopTime = time;
+		}
+	}
+	return *this;
+}
+
+ParticleEmitter& ParticleEmitter::setConfig(ParticleEmitterConfig c)
+{
+	config = std::move(c);
+	time = 0;
+	generateGeometry();
+	return *this;
+}
+
+Vector2f ParticleEmitter::getPosition() const
+{
+	return position;
+}
+
+bool ParticleEmitter::isEmitting() const
+{
+	return emitting;
+}
+
+bool ParticleEmitter::isAlive() const
+{
+	return emitting || time < stopTime + config.lifetime.y;
+}
+
+const ParticleEmitterConfig& ParticleEmitter::getConfig() const
+{
+	return config;
+}
+
+size_t ParticleEmitter::getMaxParticles() const
+{
+	return maxParticles;
+}
+
+Rect4f ParticleEmitter::getAABB() const
+{
+	const float extent = getMaxExtent();
+	const auto size = config.spawnArea + Vector2f(extent, extent);
+	return Rect4f(position - size, position + size);
+}
+
+void ParticleEmitter::update(Time t)
+{
+	time += t;
+
+	// Floats lose precision in the shader as time goes up, so wrap it around every so many generations. The random
+	// values of the particles alive at that point change, which isn't noticeable at that rate.
+	const double wrapPeriod = 1024.0 * double(maxParticles) / double(config.spawnRate);
+	if (emitting && time > wrapPeriod) {
+		time -= wrapPeriod;
+	}
+}
+
+void ParticleEmitter::draw(Painter& painter) const
+{
+	if (!isAlive() || !painter.getCurrentCamera().getClippingRectangle().overlaps(getAABB())) {
+		return;
+	}
+
+	// The material is cloned, since the painter only reads its uniforms once it replays the frame
+	auto frameMaterial = material->clone();
+	frameMaterial->set("u_emitter", Vector4f(float(time), config.spawnRate, float(maxParticles), emitting ? std::numeric_limits<float>::max() : float(stopTime)));
+	frameMaterial->set("u_positionArea", Vector4f(position.x, position.y, config.spawnArea.x, config.spawnArea.y));
+	frameMaterial->set("u_lifeSpeed", Vector4f(config.lifetime.x, config.lifetime.y, config.speed.x, config.speed.y));
+	const float toRadians = PI_CONSTANT_F / 180.0f;
+	frameMaterial->set("u_angles", Vector4f(config.angle.x * toRadians, config.angle.y * toRadians, config.rotationSpeed.x * toRadians, config.rotationSpeed.y * toRadians));
+	frameMaterial->set("u_accelerationScale", Vector4f(config.acceleration.x, config.acceleration.y, config.scale.x, config.scale.y));
+	frameMaterial->set("u_startColour", config.startColour);
+	frameMaterial->set("u_endColour", config.endColour);
+	frameMaterial->set("u_texRect", Vector4f(texRect.getLeft(), texRect.getTop(), texRect.getRight(), texRect.getBottom()));
+	frameMaterial->set("u_sizePivot", Vector4f(spriteSize.x, spriteSize.y, pivot.x, pivot.y));
+
+	painter.drawStaticGeometry(geometry, frameMaterial);
+}
+
+void ParticleEmitter::generateGeometry()
+{
+	Expects(config.spawnRate > 0);
+	Expects(config.lifetime.y > 0);
+
+	// Every slot is reused once its particle is dead, so this is the most that can be alive at once
+	maxParticles = size_t(std::ceil(config.spawnRate * config.lifetime.y)) + 1;
+
+	// Each vertex has its corner and slot in vertPos, and the slot's random values in seed
+	struct ParticleVertex
+	{
+		Vector4f vertPos;
+		Vector4f seed;
+	};
+	constexpr size_t verticesPerParticle = 4;
+	Expects(material->getDefinition().getVertexStride() == sizeof(ParticleVertex));
+
+	geometry = std::make_shared<StaticGeometry>();
+	geometry->vertexData.resize(maxParticles * verticesPerParticle * sizeof(ParticleVertex));
+	geometry->indexData.reserve(maxParticles * 6);
+
+	Vector<float> seeds(maxParticles * 4);
+	Random::getGlobal().fill(seeds, 0.0f, 1.0f);
+
+	auto* vertices = reinterpret_cast<ParticleVertex*>(geometry->vertexData.data());
+	for (size_t i = 0; i < maxParticles; ++i) {
+		const auto partIdx = i % maxParticlesPerPart;
+		if (partIdx == 0) {
+			geometry->parts.push_back(StaticGeometry::Part{ material, i * verticesPerParticle * sizeof(ParticleVertex), 0, geometry->indexData.size(), 0, true });
+		}
+		auto& part = geometry->parts.back();
+
+		const Vector4f seed(seeds[i * 4], seeds[i * 4 + 1], seeds[i * 4 + 2], seeds[i * 4 + 3]);
+		for (size_t j = 0; j < verticesPerParticle; ++j) {
+			const float x = ((j & 1) ^ ((j & 2) >> 1)) * 1.0f;
+			const float y = ((j & 2) >> 1) * 1.0f;
+			vertices[i * verticesPerParticle + j] = ParticleVertex{ Vector4f(x, y, float(i), 0), seed };
+		}
+
+		// Same winding as StaticSpriteBatch
+		const auto pos = static_cast<unsigned short>(partIdx * verticesPerParticle);
+		const std::array<unsigned short, 6> indices = {{ pos, static_cast<unsigned short>(pos + 1), static_cast<unsigned short>(pos + 2), static_cast<unsigned short>(pos + 2), static_cast<unsigned short>(pos + 3), pos }};
+		geometry->indexData.insert(geometry->indexData.end(), indices.begin(), indices.end());
+
+		part.numVertices += verticesPerParticle;
+		part.numIndices += indices.size();
+	}
+}
+
+float ParticleEmitter::getMaxExtent() const
+{
+	// Furthest a particle can get from its spawn point, plus its own size
+	const float life = config.lifetime.y;
+	const float travel = std::max(std::abs(config.speed.x), std::abs(config.speed.y)) * life + 0.5f * config.acceleration.length() * life * life;
+	const float size = std::max(spriteSize.x, spriteSize.y) * std::max(std::abs(config.scale.x), std::abs(config.scale.y));
+	return travel + size;
+}
@@ -0,0 +1,41 @@
+#include "halley/core/graphics/render_command_list.h"
+#include "halley/core/graphics/material/material.h"
+
+using namespace Halley;
+
+void RenderCommandList::clear()
+{
+	commands.clear();
+	draws.clear();
+	projections.clear();
+	vertexBytesUsed = 0;
+	indicesUsed = 0;
+}
+
+bool RenderCommandList::isEmpty() const
+{
+	return commands.empty();
+}
+
+size_t RenderCommandList::getNumCommands() const
+{
+	return commands.size();
+}
+
+size_t RenderCommandList::getNumDrawCommands() const
+{
+	return draws.size();
+}
+
+size_t RenderCommandList::getVertexDataSize() const
+{
+	return vertexBytesUsed;
+}
+
+RenderCommand& RenderCommandList::addCommand(RenderCommandType type)
+{
+	commands.emplace_back();
+	auto& result = commands.back();
+	result.type = type;
+	return result;
+}
@@ -0,0 +1,348 @@
+#include "halley/core/graphics/render_graph.h"
+#include "halley/core/graphics/render_context.h"
+#include "halley/core/graphics/render_target/render_target_texture.h"
+#include "halley/core/graphics/texture.h"
+#include "halley/support/exception.h"
+#include <gsl/gsl_assert>
+#include <queue>
+#include <functional>
+
+using namespace Halley;
+
+namespace {
+	constexpr size_t notUsed = size_t(-1);
+}
+
+RenderGraph::Pass::Pass(String name, PassCallback callback)
+	: name(std::move(name))
+	, callback(std::move(callback))
+{}
+
+RenderGraph::Pass& RenderGraph::Pass::read(ResourceId resource)
+{
+	reads.push_back(resource);
+	return *this;
+}
+
+RenderGraph::Pass& RenderGraph::Pass::write(ResourceId resource)
+{
+	Expects(!output);
+	output = resource;
+	return *this;
+}
+
+RenderGraph::Pass& RenderGraph::Pass::clear(Colour colour)
+{
+	clearColour = colour;
+	return *this;
+}
+
+RenderGraph::Pass& RenderGraph::Pass::setHasSideEffects()
+{
+	sideEffects = true;
+	return *this;
+}
+
+const String& RenderGraph::Pass::getName() const
+{
+	return name;
+}
+
+RenderGraph::LoadAction RenderGraph::Pass::getLoadAction() const
+{
+	return loadAction;
+}
+
+RenderGraph::StoreAction RenderGraph::Pass::getStoreAction() const
+{
+	return storeAction;
+}
+
+RenderGraph::RenderGraph(RenderTargetPool& pool)
+	: pool(pool)
+{}
+
+RenderGraph::~RenderGraph()
+{
+	// In case a pass threw halfway through
+	for (auto& r: resources) {
+		if (r.transient) {
+			pool.release(r.transient);
+		}
+	}
+}
+
+RenderGraph::ResourceId RenderGraph::createTarget(const String& name, const RenderTargetPool::Description& description)
+{
+	Resource resource;
+	resource.name = name;
+	resource.description = description;
+	resources.push_back(std::move(resource));
+	return resources.size() - 1;
+}
+
+RenderGraph::ResourceId RenderGraph::importTarget(const String& name, RenderTarget& target)
+{
+	Resource resource;
+	resource.name = name;
+	resource.imported = &target;
+	resources.push_back(std::move(resource));
+	return resources.size() - 1;
+}
+
+RenderGraph::Pass& RenderGraph::addPass(const String& name, PassCallback callback)
+{
+	passes.push_back(std::unique_ptr<Pass>(new Pass(name, std::move(callback))));
+	return *passes.back();
+}
+
+void RenderGraph::execute(RenderContext& context)
+{
+	compile();
+
+	Vector<size_t> firstUse;
+	Vector<size_t> lastUse;
+	assignActions(firstUse, lastUse);
+
+	for (size_t i = 0; i < order.size(); ++i) {
+		for (size_t r = 0; r < resources.size(); ++r) {
+			auto& resource = resources[r];
+			if (!resource.imported && firstUse[r] == i) {
+				resource.transient = pool.acquire(resource.description);
+			}
+		}
+
+		runPass(*passes[order[i]], context);
+
+		// Nothing after this pass needs them, so later passes can have their textures
+		for (size_t r = 0; r < resources.size(); ++r) {
+			auto& resource = resources[r];
+			if (resource.transient && lastUse[r] == i) {
+				pool.release(resource.transient);
+				resource.transient.reset();
+			}
+		}
+	}
+}
+
+RenderTarget& RenderGraph::getRenderTarget(ResourceId resource) const
+{
+	auto& r = resources.at(resource);
+	if (r.imported) {
+		return *r.imported;
+	}
+	Expects(r.transient);
+	return *r.transient;
+}
+
+std::shared_ptr<Texture> RenderGraph::getTexture(ResourceId resource) const
+{
+	auto& r = resources.at(resource);
+	if (r.imported) {
+		auto textureTarget = dynamic_cast<TextureRenderTarget*>(r.imported);
+		return textureTarget ? textureTarget->getTexture(0) : std::shared_ptr<Texture>();
+	}
+	Expects(r.transient);
+	return r.transient->getTexture(0);
+}
+
+Vector<String> RenderGraph::getExecutedPasses() const
+{
+	Vector<String> result;
+	for (auto i: order) {
+		result.push_back(passes[i]->name);
+	}
+	return result;
+}
+
+void RenderGraph::compile()
+{
+	for (auto& r: resources) {
+		r.writers.clear();
+	}
+	for (size_t i = 0; i < passes.size(); ++i) {
+		auto& pass = *passes[i];
+		if (pass.output) {
+			Expects(pass.output.get() < resources.size());
+			resources[pass.output.get()].writers.push_back(i);
+		}
+	}
+
+	for (auto& pass: passes) {
+		for (auto r: pass->reads) {
+			Expects(r < resources.size());
+			if (pass->output && pass->output.get() == r) {
+				throw Exception("Render graph pass \"" + pass->name + "\" reads from \"" + resources[r].name + "\", which it also draws to.", HalleyExceptions::Graphics);
+			}
+			if (!resources[r].imported && resources[r].writers.empty()) {
+				throw Exception("Render graph pass \"" + pass->name + "\" reads from \"" + resources[r].name + "\", which no pass draws to.", HalleyExceptions::Graphics);
+			}
+		}
+	}
+
+	sortPasses(findLivePasses());
+}
+
+Vector<bool> RenderGraph::findLivePasses() const
+{
+	Vector<bool> live(passes.size(), false);
+
+	// Walk back from whatever is visible outside of the graph
+	Vector<size_t> pending;
+	for (size_t i = 0; i < passes.size(); ++i) {
+		auto& pass = *passes[i];
+		if (pass.sideEffects || !pass.output || resources[pass.output.get()].imported) {
+			pending.push_back(i);
+		}
+	}
+
+	while (!pending.empty()) {
+		const size_t i = pending.back();
+		pending.pop_back();
+		if (live[i]) {
+			continue;
+		}
+		live[i] = true;
+
+		auto& pass = *passes[i];
+		for (auto r: pass.reads) {
+			for (auto w: resources[r].writers) {
+				pending.push_back(w);
+			}
+		}
+
+		// Unless it clears, a pass draws on top of whatever the earlier passes left in its target
+		if (pass.output && !pass.clearColour) {
+			for (auto w: resources[pass.output.get()].writers) {
+				if (w < i) {
+					pending.push_back(w);
+				}
+			}
+		}
+	}
+
+	return live;
+}
+
+void RenderGraph::sortPasses(const Vector<bool>& live)
+{
+	const size_t n = passes.size();
+	Vector<Vector<size_t>> dependents(n);
+	Vector<size_t> numDependencies(n, 0);
+	auto addDependency = [&] (size_t from, size_t to)
+	{
+		if (live[from] && from != to) {
+			dependents[from].push_back(to);
+			++numDependencies[to];
+		}
+	};
+
+	for (size_t i = 0; i < n; ++i) {
+		if (!live[i]) {
+			continue;
+		}
+		auto& pass = *passes[i];
+		for (auto r: pass.reads) {
+			for (auto w: resources[r].writers) {
+				addDependency(w, i);
+			}
+		}
+		if (pass.output) {
+			for (auto w: resources[pass.output.get()].writers) {
+				if (w < i) {
+					addDependency(w, i);
+				}
+			}
+		}
+	}
+
+	// Kahn's algorithm; when there's a choice, passes run in the order they were added
+	std::priority_queue<size_t, Vector<size_t>, std::greater<size_t>> ready;
+	size_t numLive = 0;
+	for (size_t i = 0; i < n; ++i) {
+		if (live[i]) {
+			++numLive;
+			if (numDependencies[i] == 0) {
+				ready.push(i);
+			}
+		}
+	}
+
+	order.clear();
+	while (!ready.empty()) {
+		const size_t i = ready.top();
+		ready.pop();
+		order.push_back(i);
+		for (auto d: dependents[i]) {
+			if (--numDependencies[d] == 0) {
+				ready.push(d);
+			}
+		}
+	}
+
+	if (order.size() != numLive) {
+		throw Exception("Render graph has a cycle between its passes.", HalleyExceptions::Graphics);
+	}
+}
+
+void RenderGraph::assignActions(Vector<size_t>& firstUse, Vector<size_t>& lastUse)
+{
+	firstUse.assign(resources.size(), notUsed);
+	lastUse.assign(resources.size(), notUsed);
+
+	auto use = [&] (ResourceId r, size_t i)
+	{
+		if (firstUse[r] == notUsed) {
+			firstUse[r] = i;
+		}
+		lastUse[r] = i;
+	};
+
+	for (size_t i = 0; i < order.size(); ++i) {
+		auto& pass = *passes[order[i]];
+		for (auto r: pass.reads) {
+			use(r, i);
+		}
+		if (pass.output) {
+			use(pass.output.get(), i);
+		}
+	}
+
+	for (size_t i = 0; i < order.size(); ++i) {
+		auto& pass = *passes[order[i]];
+		if (!pass.output) {
+			pass.loadAction = LoadAction::Load;
+			pass.storeAction = StoreAction::Store;
+			continue;
+		}
+
+		const auto r = pass.output.get();
+		const auto& resource = resources[r];
+		if (pass.clearColour) {
+			pass.loadAction = LoadAction::Clear;
+		} else if (!resource.imported && firstUse[r] == i) {
+			pass.loadAction = LoadAction::DontCare;
+		} else {
+			pass.loadAction = LoadAction::Load;
+		}
+		pass.storeAction = resource.imported || lastUse[r] > i ? StoreAction::Store : StoreAction::DontCare;
+	}
+}
+
+void RenderGraph::runPass(Pass& pass, RenderContext& context)
+{
+	if (!pass.output) {
+		pass.callback(context, *this);
+		return;
+	}
+
+	auto target = context.with(getRenderTarget(pass.output.get()));
+	if (pass.loadAction == LoadAction::Clear) {
+		const auto colour = pass.clearColour.get();
+		target.bind([&] (Painter& painter)
+		{
+			painter.clear(colour);
+		});
+	}
+	pass.callback(target, *this);
+}
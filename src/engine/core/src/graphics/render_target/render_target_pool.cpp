@@ -0,0 +1,121 @@
+#include "halley/core/graphics/render_target/render_target_pool.h"
+#include "halley/core/graphics/render_target/render_target_texture.h"
+#include "halley/core/graphics/texture.h"
+#include "halley/core/api/video_api.h"
+#include <gsl/gsl_assert>
+#include <algorithm>
+
+using namespace Halley;
+
+RenderTargetPool::Description::Description(Vector2i size, TextureFormat format, bool useFiltering, bool withDepth)
+	: size(size)
+	, format(format)
+	, useFiltering(useFiltering)
+	, withDepth(withDepth)
+{}
+
+bool RenderTargetPool::Description::operator==(const Description& other) const
+{
+	return size == other.size && format == other.format && useFiltering == other.useFiltering && withDepth == other.withDepth;
+}
+
+bool RenderTargetPool::Description::operator!=(const Description& other) const
+{
+	return !(*this == other);
+}
+
+RenderTargetPool::RenderTargetPool(VideoAPI& video)
+	: video(video)
+{}
+
+RenderTargetPool::~RenderTargetPool() = default;
+
+std::shared_ptr<TextureRenderTarget> RenderTargetPool::acquire(const Description& description)
+{
+	Expects(description.size.x > 0 && description.size.y > 0);
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	// Most recently used first, so the ones that went unused get a chance to expire
+	Entry* best = nullptr;
+	for (auto& entry: entries) {
+		if (!entry.inUse && entry.description == description && (!best || entry.lastUsedFrame > best->lastUsedFrame)) {
+			best = &entry;
+		}
+	}
+
+	if (!best) {
+		entries.push_back(Entry{ description, create(description), frame, false });
+		best = &entries.back();
+	}
+
+	best->inUse = true;
+	best->lastUsedFrame = frame;
+	best->target->resetViewPort();
+	return best->target;
+}
+
+void RenderTargetPool::release(const std::shared_ptr<TextureRenderTarget>& target)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	for (auto& entry: entries) {
+		if (entry.target == target) {
+			entry.inUse = false;
+			return;
+		}
+	}
+}
+
+void RenderTargetPool::nextFrame()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	++frame;
+
+	for (auto& entry: entries) {
+		entry.inUse = false;
+	}
+	entries.erase(std::remove_if(entries.begin(), entries.end(), [&] (const Entry& entry)
+	{
+		return frame - entry.lastUsedFrame > framesToKeep;
+	}), entries.end());
+}
+
+void RenderTargetPool::clear()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	entries.clear();
+}
+
+size_t RenderTargetPool::getNumTargets() const
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	return entries.size();
+}
+
+size_t RenderTargetPool::getNumInUse() const
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	return size_t(std::count_if(entries.begin(), entries.end(), [] (const Entry& entry) { return entry.inUse; }));
+}
+
+std::shared_ptr<TextureRenderTarget> RenderTargetPool::create(const Description& description)
+{
+	auto target = std::shared_ptr<TextureRenderTarget>(video.createTextureRenderTarget());
+
+	std::shared_ptr<Texture> colour = video.createTexture(description.size);
+	TextureDescriptor colourDesc(description.size, description.format);
+	colourDesc.useFiltering = description.useFiltering;
+	colourDesc.isRenderTarget = true;
+	colour->load(std::move(colourDesc));
+	target->setTarget(0, colour);
+
+	if (description.withDepth) {
+		std::shared_ptr<Texture> depth = video.createTexture(description.size);
+		TextureDescriptor depthDesc(description.size, TextureFormat::DEPTH);
+		depthDesc.isDepthStencil = true;
+		depth->load(std::move(depthDesc));
+		target->setDepthTexture(depth);
+	}
+
+	return target;
+}
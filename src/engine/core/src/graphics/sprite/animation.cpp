@@ -60,6 +60,7 @@ AnimationSequence::AnimationSequence() {}
 
 AnimationSequence::AnimationSequence(String name, bool loop, bool noFlip)
 	: name(std::move(name))
+	, nameId(this->name)
 	, loop(loop)
 	, noFlip(noFlip)
 {}
@@ -78,6 +79,7 @@ void AnimationSequence::deserialize(Deserializer& s)
 	s >> name;
 	s >> loop;
 	s >> noFlip;
+	nameId = AnimationSequenceId(name);
 }
 
 void AnimationSequence::addFrame(const AnimationFrameDefinition& animationFrameDefinition)
@@ -112,6 +114,7 @@ AnimationDirection::AnimationDirection()
 AnimationDirection::AnimationDirection(String name, String fileName, bool flip, int id)
 	: name(std::move(name))
 	, fileName(std::move(fileName))
+	, nameId(this->name)
 	, id(id)
 	, flip(flip)
 {
@@ -162,6 +165,7 @@ void AnimationDirection::deserialize(Deserializer& s)
 	s >> fileName;
 	s >> id;
 	s >> flip;
+	nameId = AnimationDirectionId(name);
 }
 
 Animation::Animation() 
@@ -232,6 +236,16 @@ const AnimationSequence& Animation::getSequence(const String& seqName) const
 	return sequences.at(0);
 }
 
+const AnimationSequence& Animation::getSequence(AnimationSequenceId id) const
+{
+	for (auto& seq: sequences) {
+		if (seq.nameId == id) {
+			return seq;
+		}
+	}
+	return sequences.at(0);
+}
+
 const AnimationDirection& Animation::getDirection(const String& dirName) const
 {
 	Expects(directions.size() > 0);
@@ -244,6 +258,18 @@ const AnimationDirection& Animation::getDirection(const String& dirName) const
 	return directions[0];
 }
 
+const AnimationDirection& Animation::getDirection(AnimationDirectionId id) const
+{
+	Expects(directions.size() > 0);
+
+	for (auto& dir : directions) {
+		if (dir.nameId == id) {
+			return dir;
+		}
+	}
+	return directions[0];
+}
+
 const AnimationDirection& Animation::getDirection(int id) const
 {
 	Expects(id >= 0);
@@ -271,6 +297,16 @@ bool Animation::hasSequence(const String& seqName) const
 	return false;
 }
 
+bool Animation::hasSequence(AnimationSequenceId id) const
+{
+	for (auto& s: sequences) {
+		if (s.nameId == id) {
+			return true;
+		}
+	}
+	return false;
+}
+
 void Animation::serialize(Serializer& s) const
 {
 	s << name;
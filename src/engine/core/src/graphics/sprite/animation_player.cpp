@@ -1,6 +1,7 @@
 #include "graphics/sprite/animation.h"
 #include "graphics/sprite/animation_player.h"
 #include "graphics/sprite/sprite.h"
+#include "halley/concurrency/concurrent.h"
 #include <gsl/gsl_assert>
 
 using namespace Halley;
@@ -49,20 +50,21 @@ AnimationPlayer& AnimationPlayer::setSequence(const String& sequence)
 	updateIfNeeded();
 
 	if (animation && (!curSeq || curSeq->getName() != sequence)) {
-		curSeqTime = 0;
-		curFrameTime = 0;
-		curFrame = 0;
-		curFrameLen = 0;
-		curSeq = &animation->getSequence(sequence);
-		Expects(curSeq);
-
-		seqLen = curSeq->numFrames();
-		seqLooping = curSeq->isLooping();
-		seqNoFlip = curSeq->isNoFlip();
+		startSequence(animation->getSequence(sequence));
+	}
+	return *this;
+}
 
-		dirty = true;
+AnimationPlayer& AnimationPlayer::setSequence(AnimationSequenceId sequence)
+{
+	// The name is only needed again when the animation reloads, so it's only copied when it changes
+	if (!curSeq || curSeq->getNameId() != sequence) {
+		curSeqName = sequence.getName();
+	}
+	updateIfNeeded();
 
-		onSequenceStarted();
+	if (animation && (!curSeq || curSeq->getNameId() != sequence)) {
+		startSequence(animation->getSequence(sequence));
 	}
 	return *this;
 }
@@ -72,13 +74,7 @@ AnimationPlayer& AnimationPlayer::setDirection(int direction)
 	updateIfNeeded();
 
 	if (animation && dirId != direction) {
-		auto newDir = &animation->getDirection(direction);
-		if (curDir != newDir) {
-			curDir = newDir;
-			dirFlip = curDir->shouldFlip();
-			dirId = curDir->getId();
-			dirty = true;
-		}
+		changeDirection(animation->getDirection(direction));
 	}
 	return *this;
 }
@@ -89,13 +85,20 @@ AnimationPlayer& AnimationPlayer::setDirection(const String& direction)
 	updateIfNeeded();
 
 	if (animation && (!curDir || curDir->getName() != direction)) {
-		auto newDir = &animation->getDirection(direction);
-		if (curDir != newDir) {
-			curDir = newDir;
-			dirFlip = curDir->shouldFlip();
-			dirId = curDir->getId();
-			dirty = true;
-		}
+		changeDirection(animation->getDirection(direction));
+	}
+	return *this;
+}
+
+AnimationPlayer& AnimationPlayer::setDirection(AnimationDirectionId direction)
+{
+	if (!curDir || curDir->getNameId() != direction) {
+		curDirName = direction.getName();
+	}
+	updateIfNeeded();
+
+	if (animation && (!curDir || curDir->getNameId() != direction)) {
+		changeDirection(animation->getDirection(direction));
 	}
 	return *this;
 }
@@ -110,6 +113,16 @@ bool AnimationPlayer::trySetSequence(const String& sequence)
 	return false;
 }
 
+bool AnimationPlayer::trySetSequence(AnimationSequenceId sequence)
+{
+	updateIfNeeded();
+	if (animation && animation->hasSequence(sequence)) {
+		setSequence(sequence);
+		return true;
+	}
+	return false;
+}
+
 AnimationPlayer& AnimationPlayer::setApplyPivot(bool apply)
 {
 	applyPivot = apply;
@@ -157,6 +170,25 @@ void AnimationPlayer::update(Time time)
 	}
 }
 
+void AnimationPlayer::updateAll(gsl::span<AnimationPlayer> players, Time time)
+{
+	// Players only touch their own state, so they can be updated in any order
+	auto update = [&] (size_t start, size_t end)
+	{
+		for (size_t i = start; i < end; ++i) {
+			players[i].update(time);
+		}
+	};
+
+	constexpr size_t parallelGrain = 512;
+	const size_t n = size_t(players.size());
+	if (n >= 2 * parallelGrain) {
+		Concurrent::parallelFor(Executors::getCPU(), Range<size_t>(0, n), parallelGrain, update, TaskPriority::Critical);
+	} else {
+		update(0, n);
+	}
+}
+
 void AnimationPlayer::updateSprite(Sprite& sprite) const
 {
 	if (animation && hasUpdate) {
@@ -254,6 +286,33 @@ void AnimationPlayer::resolveSprite()
 	hasUpdate = true;
 }
 
+void AnimationPlayer::startSequence(const AnimationSequence& sequence)
+{
+	curSeqTime = 0;
+	curFrameTime = 0;
+	curFrame = 0;
+	curFrameLen = 0;
+	curSeq = &sequence;
+
+	seqLen = curSeq->numFrames();
+	seqLooping = curSeq->isLooping();
+	seqNoFlip = curSeq->isNoFlip();
+
+	dirty = true;
+
+	onSequenceStarted();
+}
+
+void AnimationPlayer::changeDirection(const AnimationDirection& direction)
+{
+	if (curDir != &direction) {
+		curDir = &direction;
+		dirFlip = curDir->shouldFlip();
+		dirId = curDir->getId();
+		dirty = true;
+	}
+}
+
 void AnimationPlayer::onSequenceStarted()
 {
 	playing = true;
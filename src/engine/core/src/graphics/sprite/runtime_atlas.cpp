@@ -0,0 +1,176 @@
+#include "graphics/sprite/runtime_atlas.h"
+#include "halley/core/api/video_api.h"
+#include "halley/core/graphics/texture.h"
+#include "halley/core/graphics/texture_descriptor.h"
+#include "halley/core/graphics/material/material.h"
+#include "halley/core/graphics/material/material_parameter.h"
+#include "halley/concurrency/concurrent.h"
+#include "halley/file_formats/image.h"
+#include "halley/support/exception.h"
+
+using namespace Halley;
+
+RuntimeAtlasEntry::RuntimeAtlasEntry(std::shared_ptr<RuntimeAtlasPage> page, Rect4i rect)
+	: page(std::move(page))
+	, rect(rect)
+	, texRect(Rect4f(rect) / Vector2f(this->page->getSize()))
+{
+}
+
+RuntimeAtlasEntry::~RuntimeAtlasEntry()
+{
+	page->release();
+}
+
+const std::shared_ptr<Material>& RuntimeAtlasEntry::getMaterial() const
+{
+	return page->getMaterial();
+}
+
+Vector2i RuntimeAtlasEntry::getSize() const
+{
+	return rect.getSize();
+}
+
+Rect4f RuntimeAtlasEntry::getTexRect() const
+{
+	return texRect;
+}
+
+RuntimeAtlasPage::RuntimeAtlasPage(VideoAPI& video, std::shared_ptr<const MaterialDefinition> materialDefinition, Vector2i size)
+	: texture(video.createTexture(size))
+	, material(std::make_shared<Material>(materialDefinition))
+	, size(size)
+	, bin(size)
+{
+	material->set("tex0", texture);
+
+	Concurrent::execute(Executors::getVideoAux(), [texture = texture, size] ()
+	{
+		// Start out blank, so areas still waiting for their pixels don't show garbage
+		TextureDescriptor descriptor(size, TextureFormat::RGBA);
+		descriptor.useFiltering = true;
+		descriptor.clamp = true;
+		descriptor.canBeUpdated = true;
+		descriptor.pixelData = TextureDescriptorImageData(Bytes(TextureDescriptor::getDataSize(TextureFormat::RGBA, size), 0));
+		texture->load(std::move(descriptor));
+	});
+}
+
+const std::shared_ptr<Texture>& RuntimeAtlasPage::getTexture() const
+{
+	return texture;
+}
+
+const std::shared_ptr<Material>& RuntimeAtlasPage::getMaterial() const
+{
+	return material;
+}
+
+Vector2i RuntimeAtlasPage::getSize() const
+{
+	return size;
+}
+
+bool RuntimeAtlasPage::allocate(Vector2i allocSize, Rect4i& rect)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	const auto result = bin.insert(BinPackEntry(allocSize));
+	if (!result) {
+		return false;
+	}
+	rect = result->rect;
+	++numEntries;
+	return true;
+}
+
+void RuntimeAtlasPage::release()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	Expects(numEntries > 0);
+	if (--numEntries == 0) {
+		// MaxRects can't give back individual areas, so the page is only reused once it's empty
+		bin = MaxRectsBin(size);
+	}
+}
+
+RuntimeAtlas::RuntimeAtlas(VideoAPI& video, std::shared_ptr<const MaterialDefinition> materialDefinition, Vector2i pageSize, int maxImageSize)
+	: video(video)
+	, materialDefinition(std::move(materialDefinition))
+	, pageSize(pageSize)
+	, maxImageSize(std::min(maxImageSize, std::min(pageSize.x, pageSize.y) - 2 * padding))
+{
+}
+
+std::shared_ptr<RuntimeAtlasEntry> RuntimeAtlas::add(std::shared_ptr<const Image> image)
+{
+	Expects(image);
+	if (image->getBytesPerPixel() != 4) {
+		throw Exception("Only RGBA images can be added to a RuntimeAtlas.", HalleyExceptions::Graphics);
+	}
+
+	const auto imageSize = image->getSize();
+	Expects(imageSize.x > 0 && imageSize.y > 0);
+	const auto allocSize = imageSize + Vector2i(2 * padding, 2 * padding);
+	Rect4i paddedRect;
+	std::shared_ptr<RuntimeAtlasPage> page;
+
+	if (imageSize.x > maxImageSize || imageSize.y > maxImageSize) {
+		// Not worth taking the space from smaller images, and they might not even fit
+		page = std::make_shared<RuntimeAtlasPage>(video, materialDefinition, allocSize);
+		page->allocate(allocSize, paddedRect);
+	} else {
+		std::unique_lock<std::mutex> lock(mutex);
+		for (auto& p: pages) {
+			if (p->allocate(allocSize, paddedRect)) {
+				page = p;
+				break;
+			}
+		}
+		if (!page) {
+			page = std::make_shared<RuntimeAtlasPage>(video, materialDefinition, pageSize);
+			page->allocate(allocSize, paddedRect);
+			pages.push_back(page);
+		}
+	}
+
+	auto entry = std::make_shared<RuntimeAtlasEntry>(page, Rect4i(paddedRect.getTopLeft() + Vector2i(padding, padding), imageSize.x, imageSize.y));
+	upload(entry, page->getTexture(), std::move(image), paddedRect);
+	return entry;
+}
+
+size_t RuntimeAtlas::getNumPages() const
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	return pages.size();
+}
+
+void RuntimeAtlas::upload(const std::shared_ptr<RuntimeAtlasEntry>& entry, std::shared_ptr<Texture> texture, std::shared_ptr<const Image> image, Rect4i paddedRect)
+{
+	std::weak_ptr<RuntimeAtlasEntry> weakEntry = entry;
+	Concurrent::execute(Executors::getCPU(), TaskPriority::Background, [weakEntry, texture, image = std::move(image), paddedRect] ()
+	{
+		// If the entry is gone, its area might already belong to another image. Otherwise, holding on to it for the
+		// upload keeps the area reserved until the region is queued on the texture.
+		const auto entry = weakEntry.lock();
+		if (!entry) {
+			return;
+		}
+
+		// Edges are extruded into the padding, so filtering doesn't pull in the neighbours
+		const auto imageSize = image->getSize();
+		const auto size = paddedRect.getSize();
+		const auto src = reinterpret_cast<const uint32_t*>(image->getPixels());
+		Bytes pixels(size_t(size.x) * size_t(size.y) * 4);
+		const auto dst = reinterpret_cast<uint32_t*>(pixels.data());
+		for (int y = 0; y < size.y; ++y) {
+			const int srcY = clamp(y - padding, 0, imageSize.y - 1);
+			for (int x = 0; x < size.x; ++x) {
+				const int srcX = clamp(x - padding, 0, imageSize.x - 1);
+				dst[y * size.x + x] = src[srcY * imageSize.x + srcX];
+			}
+		}
+
+		texture->updateRegion(paddedRect, TextureFormat::RGBA, std::move(pixels));
+	});
+}
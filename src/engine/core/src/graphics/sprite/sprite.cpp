@@ -1,12 +1,14 @@
 #include <cstring>
 #include "graphics/sprite/sprite.h"
 #include "graphics/sprite/sprite_sheet.h"
+#include "graphics/sprite/runtime_atlas.h"
 #include "halley/core/graphics/painter.h"
 #include "halley/core/graphics/material/material.h"
 #include "halley/core/graphics/material/material_definition.h"
 #include "halley/core/graphics/material/material_parameter.h"
 #include "halley/core/graphics/texture.h"
 #include "resources/resources.h"
+#include <halley/data_structures/frame_arena.h>
 #include <gsl/gsl_assert>
 
 using namespace Halley;
@@ -77,13 +79,11 @@ void Sprite::draw(const Sprite* sprites, size_t n, Painter& painter) // static
 	size_t spriteSize = sizeof(SpriteVertexAttrib);
 	char buffer[4096];
 	char* vertexData;
-	std::vector<char> vertices;
 	const size_t vertexDataSize = n * spriteSize;
 	if (vertexDataSize <= 4096) {
 		vertexData = buffer;
 	} else {
-		vertices.resize(vertexDataSize);
-		vertexData = vertices.data();
+		vertexData = static_cast<char*>(FrameArena::get().alloc(vertexDataSize, alignof(SpriteVertexAttrib)));
 	}
 
 	for (size_t i = 0; i < n; i++) {
@@ -93,6 +93,10 @@ void Sprite::draw(const Sprite* sprites, size_t n, Painter& painter) // static
 	}
 
 	painter.drawSprites(material, n, vertexData);
+	if (vertexData != buffer) {
+		// The painter has copied it already
+		FrameArena::get().free(vertexData, vertexDataSize);
+	}
 }
 
 void Sprite::drawMixedMaterials(const Sprite* sprites, size_t n, Painter& painter)
@@ -133,6 +137,26 @@ bool Sprite::isInView(Rect4f v) const
 	return isVisible() && getAABB().overlaps(v);
 }
 
+Sprite& Sprite::setMinScreenSize(float size)
+{
+	minScreenSize = size;
+	return *this;
+}
+
+float Sprite::getMinScreenSize() const
+{
+	return minScreenSize;
+}
+
+bool Sprite::isLargeEnoughOnScreen(float zoom) const
+{
+	if (minScreenSize <= 0) {
+		return true;
+	}
+	const auto size = getAABB().getSize();
+	return std::max(size.x, size.y) * zoom >= minScreenSize;
+}
+
 Vector2f Sprite::getScaledSize() const
 {
 	return vertexAttrib.scale * vertexAttrib.size;
@@ -166,6 +190,14 @@ Sprite& Sprite::setRotation(Angle1f v)
 	return *this;
 }
 
+Sprite& Sprite::setTransform(const Transform2D& transform)
+{
+	vertexAttrib.pos = transform.position;
+	vertexAttrib.rotation = transform.rotation.getRadians();
+	vertexAttrib.scale = transform.scale;
+	return *this;
+}
+
 Sprite& Sprite::setColour(Colour4f v)
 {
 	vertexAttrib.colour = v;
@@ -239,6 +271,39 @@ Sprite& Sprite::setTexRect(Rect4f v)
 	return *this;
 }
 
+Sprite& Sprite::setCustom0(Vector2f v)
+{
+	vertexAttrib.custom0 = v;
+	return *this;
+}
+
+Sprite& Sprite::setCustom1(Vector4f v)
+{
+	vertexAttrib.custom1 = v;
+	return *this;
+}
+
+Vector2f Sprite::getCustom0() const
+{
+	return vertexAttrib.custom0;
+}
+
+Vector4f Sprite::getCustom1() const
+{
+	return vertexAttrib.custom1;
+}
+
+Sprite& Sprite::setDepth(float depth)
+{
+	vertexAttrib.depth = depth;
+	return *this;
+}
+
+float Sprite::getDepth() const
+{
+	return vertexAttrib.depth;
+}
+
 Rect4f Sprite::getTexRect() const
 {
 	return vertexAttrib.texRect;
@@ -285,6 +350,14 @@ Sprite& Sprite::setImage(std::shared_ptr<const Texture> image, std::shared_ptr<c
 	return *this;
 }
 
+Sprite& Sprite::setImage(const RuntimeAtlasEntry& entry)
+{
+	setMaterial(entry.getMaterial());
+	setSize(Vector2f(entry.getSize()));
+	setTexRect(entry.getTexRect());
+	return *this;
+}
+
 Sprite& Sprite::setImage(Resources& resources, String imageName, String materialName)
 {
 	/*
@@ -361,6 +434,11 @@ Sprite& Sprite::setNotSliced()
 	return *this;
 }
 
+bool Sprite::isSliced() const
+{
+	return sliced;
+}
+
 Sprite& Sprite::setVisible(bool v)
 {
 	visible = v;
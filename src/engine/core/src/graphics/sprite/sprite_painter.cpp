@@ -3,9 +3,72 @@
 #include "graphics/painter.h"
 #include <gsl/gsl>
 #include "graphics/text/text_renderer.h"
+#include "graphics/material/material.h"
+#include "graphics/material/material_definition.h"
+#include <cstring>
+#include <array>
+#include <algorithm>
+#include <cmath>
 
 using namespace Halley;
 
+namespace {
+	uint32_t getOrderedBits(float value)
+	{
+		// Maps floats to unsigned ints that compare in the same order
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+	}
+
+	template <typename T>
+	void radixSort(Vector<T>& values, Vector<T>& scratch)
+	{
+		// LSD radix sort, one byte at a time. Stable, so entries with the same key keep the order they were added in.
+		const size_t n = values.size();
+		scratch.resize(n);
+
+		for (int shift = 0; shift < 64; shift += 8) {
+			std::array<size_t, 256> counts = {};
+			for (const auto& v: values) {
+				++counts[(v.key >> shift) & 0xFF];
+			}
+
+			// Most of the high bytes are usually the same for every entry
+			if (counts[(values[0].key >> shift) & 0xFF] == n) {
+				continue;
+			}
+
+			size_t total = 0;
+			for (auto& c: counts) {
+				const size_t count = c;
+				c = total;
+				total += count;
+			}
+			for (const auto& v: values) {
+				scratch[counts[(v.key >> shift) & 0xFF]++] = v;
+			}
+			std::swap(values, scratch);
+		}
+	}
+
+	bool writesDepth(const Material& material)
+	{
+		const auto& definition = material.getDefinition();
+		for (int i = 0; i < definition.getNumPasses(); ++i) {
+			if (!definition.getPass(i).getDepthStencil().isDepthWriteEnabled()) {
+				return false;
+			}
+		}
+		return definition.getNumPasses() > 0;
+	}
+
+	bool writesDepth(const Sprite& sprite)
+	{
+		return sprite.hasMaterial() && !sprite.isSliced() && !sprite.getClip() && writesDepth(sprite.getMaterial());
+	}
+}
+
 SpritePainterEntry::SpritePainterEntry(const Sprite& sprite, int mask, int layer, float tieBreaker)
 	: ptr(&sprite)
 	, type(SpritePainterEntryType::SpriteRef)
@@ -72,6 +135,16 @@ int SpritePainterEntry::getMask() const
 	return mask;
 }
 
+int SpritePainterEntry::getLayer() const
+{
+	return layer;
+}
+
+float SpritePainterEntry::getTieBreaker() const
+{
+	return tieBreaker;
+}
+
 void SpritePainter::start(size_t nSprites)
 {
 	if (sprites.capacity() < nSprites) {
@@ -79,7 +152,10 @@ void SpritePainter::start(size_t nSprites)
 	}
 	sprites.clear();
 	cachedSprites.clear();
+	compactSprites.clear();
 	cachedText.clear();
+	frameMaterials.clear();
+	frameMaterialIds.clear();
 }
 
 void SpritePainter::add(const Sprite& sprite, int mask, int layer, float tieBreaker)
@@ -90,11 +166,42 @@ void SpritePainter::add(const Sprite& sprite, int mask, int layer, float tieBrea
 
 void SpritePainter::addCopy(const Sprite& sprite, int mask, int layer, float tieBreaker)
 {
-	sprites.push_back(SpritePainterEntry(SpritePainterEntryType::SpriteCached, cachedSprites.size(), mask, layer, tieBreaker));
-	cachedSprites.push_back(sprite);
+	if (!sprite.isVisible()) {
+		return;
+	}
+	if (sprite.hasMaterial() && !sprite.isSliced() && !sprite.getClip()) {
+		sprites.push_back(SpritePainterEntry(SpritePainterEntryType::SpriteCompact, compactSprites.size(), mask, layer, tieBreaker));
+		compactSprites.push_back(CompactSprite{ sprite.getVertexAttrib(), sprite.getAABB(), sprite.getMinScreenSize(), getFrameMaterial(sprite.getMaterialPtr()) });
+	} else {
+		sprites.push_back(SpritePainterEntry(SpritePainterEntryType::SpriteCached, cachedSprites.size(), mask, layer, tieBreaker));
+		cachedSprites.push_back(sprite);
+	}
 	dirty = true;
 }
 
+void SpritePainter::addCopy(Sprite&& sprite, int mask, int layer, float tieBreaker)
+{
+	if (!sprite.isVisible() || (sprite.hasMaterial() && !sprite.isSliced() && !sprite.getClip())) {
+		addCopy(static_cast<const Sprite&>(sprite), mask, layer, tieBreaker);
+	} else {
+		sprites.push_back(SpritePainterEntry(SpritePainterEntryType::SpriteCached, cachedSprites.size(), mask, layer, tieBreaker));
+		cachedSprites.push_back(std::move(sprite));
+		dirty = true;
+	}
+}
+
+uint32_t SpritePainter::getFrameMaterial(const std::shared_ptr<Material>& material)
+{
+	const auto iter = frameMaterialIds.find(material.get());
+	if (iter != frameMaterialIds.end()) {
+		return iter->second;
+	}
+	const auto idx = uint32_t(frameMaterials.size());
+	frameMaterials.push_back(material);
+	frameMaterialIds[material.get()] = idx;
+	return idx;
+}
+
 void SpritePainter::add(const TextRenderer& text, int mask, int layer, float tieBreaker)
 {
 	sprites.push_back(SpritePainterEntry(text, mask, layer, tieBreaker));
@@ -108,43 +215,364 @@ void SpritePainter::addCopy(const TextRenderer& text, int mask, int layer, float
 	dirty = true;
 }
 
-void SpritePainter::draw(int mask, Painter& painter)
+void SpritePainter::addStatic(int id, const Sprite& sprite, int mask, int layer, float tieBreaker)
 {
-	if (dirty) {
-		// TODO: implement hierarchical bucketing.
-		// - one bucket per layer
-		// - for each layer, one bucket per vertical band of the screen (32px or so)
-		// - sort each leaf bucket
-		std::sort(sprites.begin(), sprites.end()); // lol
-		dirty = false;
+	removeStatic(id);
+	auto& entry = staticSprites[id];
+	entry = StaticSprite{ &sprite, mask, layer, tieBreaker, 0 };
+	insertStatic(id, entry);
+	dirty = true;
+}
+
+void SpritePainter::updateStatic(int id)
+{
+	auto iter = staticSprites.find(id);
+	if (iter != staticSprites.end()) {
+		// Most updates are small moves, which stay in the same cell
+		auto& entry = iter->second;
+		const auto cell = getStaticCell(*entry.sprite);
+		if (cell != entry.cell) {
+			eraseStatic(id, entry);
+			insertStatic(id, entry);
+		} else {
+			auto& staticCell = staticCells[cell];
+			staticCell.bounds = staticCell.bounds.merge(entry.sprite->getAABB());
+		}
+		dirty = true;
+	}
+}
+
+void SpritePainter::removeStatic(int id)
+{
+	auto iter = staticSprites.find(id);
+	if (iter != staticSprites.end()) {
+		eraseStatic(id, iter->second);
+		staticSprites.erase(iter);
+		dirty = true;
+	}
+}
+
+void SpritePainter::clearStatic()
+{
+	staticSprites.clear();
+	staticCells.clear();
+	dirty = true;
+}
+
+uint64_t SpritePainter::getStaticCell(const Sprite& sprite) const
+{
+	const auto centre = sprite.getAABB().getCenter();
+	const auto x = int32_t(std::floor(centre.x / staticCellSize));
+	const auto y = int32_t(std::floor(centre.y / staticCellSize));
+	return (uint64_t(uint32_t(x)) << 32) | uint64_t(uint32_t(y));
+}
+
+void SpritePainter::insertStatic(int id, StaticSprite& entry)
+{
+	entry.cell = getStaticCell(*entry.sprite);
+	auto& cell = staticCells[entry.cell];
+	const auto aabb = entry.sprite->getAABB();
+	cell.bounds = cell.ids.empty() ? aabb : cell.bounds.merge(aabb);
+	cell.ids.push_back(id);
+}
+
+void SpritePainter::eraseStatic(int id, const StaticSprite& entry)
+{
+	auto iter = staticCells.find(entry.cell);
+	if (iter == staticCells.end()) {
+		return;
+	}
+
+	auto& ids = iter->second.ids;
+	auto idIter = std::find(ids.begin(), ids.end(), id);
+	if (idIter != ids.end()) {
+		*idIter = ids.back();
+		ids.pop_back();
+	}
+
+	if (ids.empty()) {
+		staticCells.erase(iter);
+	} else {
+		// Bounds are only ever grown, so shrink them back the next time they're needed
+		iter->second.boundsDirty = true;
 	}
+}
 
+void SpritePainter::draw(int mask, Painter& painter)
+{
 	// View
 	auto& cam = painter.getCurrentCamera();
 	Rect4f view = cam.getClippingRectangle();
+	const float zoom = cam.getZoom();
 
-	// Draw!
-	for (auto& s : sprites) {
+	// Culling happens before sorting, so anything off-screen doesn't pay for it
+	if (dirty || view != lastView || zoom != lastZoom) {
+		cull(view, zoom);
+		sort();
+		lastView = view;
+		lastZoom = zoom;
+		dirty = false;
+	}
+
+	drawn.clear();
+	bool hasOpaque = false;
+	for (auto& entry : sorted) {
+		auto& s = getEntry(entry.index);
 		if ((s.getMask() & mask) != 0) {
-			auto type = s.getType();
-			if (type == SpritePainterEntryType::SpriteRef) {
-				draw(s.getSprite(), painter, view);
-			} else if (type == SpritePainterEntryType::SpriteCached) {
-				draw(cachedSprites[s.getIndex()], painter, view);
-			} else if (type == SpritePainterEntryType::TextRef) {
-				draw(s.getText(), painter, view);
-			} else if (type == SpritePainterEntryType::TextCached) {
-				draw(cachedText[s.getIndex()], painter, view);
+			drawn.push_back(entry.index);
+			hasOpaque = hasOpaque || getDepthWritingMaterial(s) != nullptr;
+		}
+	}
+
+	// Draw!
+	if (hasOpaque) {
+		drawWithDepth(painter, view);
+	} else {
+		for (auto index: drawn) {
+			auto& s = getEntry(index);
+			if (const auto vertex = getVertex(s)) {
+				draw(s, *vertex, painter, view);
+			} else {
+				flushBatch(painter);
+				draw(*getText(s), painter, view);
 			}
 		}
 	}
+	flushBatch(painter);
 	painter.flush();
 }
 
-void SpritePainter::draw(const Sprite& sprite, Painter& painter, Rect4f view)
+void SpritePainter::drawWithDepth(Painter& painter, Rect4f view)
+{
+	// Depth goes from the back (nearly 1) to the front (nearly 0), in the sorted order. Batches point into
+	// depthVertices, so it must not reallocate while drawing.
+	const size_t n = drawn.size();
+	depthVertices.clear();
+	depthVertices.reserve(n);
+	opaque.clear();
+	for (size_t i = 0; i < n; ++i) {
+		const auto& s = getEntry(drawn[i]);
+		const auto vertex = getVertex(s);
+		depthVertices.push_back(vertex ? *vertex : SpriteVertexAttrib());
+		depthVertices.back().depth = 1.0f - float(i + 1) / float(n + 1);
+		if (const auto material = getDepthWritingMaterial(s)) {
+			opaque.push_back(OpaqueEntry{ material, uint32_t(i) });
+		}
+	}
+
+	// Opaque pass, front to back within each material
+	std::sort(opaque.begin(), opaque.end(), [] (const OpaqueEntry& a, const OpaqueEntry& b)
+	{
+		return a.material != b.material ? a.material < b.material : a.order > b.order;
+	});
+	painter.clearDepth();
+	for (auto& entry: opaque) {
+		draw(getEntry(drawn[entry.order]), depthVertices[entry.order], painter, view);
+	}
+	flushBatch(painter);
+
+	// Everything else, in order
+	for (size_t i = 0; i < n; ++i) {
+		auto& s = getEntry(drawn[i]);
+		if (!getDepthWritingMaterial(s)) {
+			draw(s, depthVertices[i], painter, view);
+		}
+	}
+}
+
+void SpritePainter::cull(Rect4f view, float zoom)
+{
+	visible.clear();
+	for (size_t i = 0; i < sprites.size(); ++i) {
+		if (isInView(sprites[i], view, zoom)) {
+			visible.push_back(uint32_t(i));
+		}
+	}
+
+	// Static sprites are indexed after all the others
+	visibleStatic.clear();
+	for (auto& c: staticCells) {
+		auto& cell = c.second;
+		if (cell.boundsDirty) {
+			cell.bounds = staticSprites.at(cell.ids[0]).sprite->getAABB();
+			for (auto id: cell.ids) {
+				cell.bounds = cell.bounds.merge(staticSprites.at(id).sprite->getAABB());
+			}
+			cell.boundsDirty = false;
+		}
+
+		if (cell.bounds.overlaps(view)) {
+			for (auto id: cell.ids) {
+				const auto& s = staticSprites.at(id);
+				if (s.sprite->isInView(view) && s.sprite->isLargeEnoughOnScreen(zoom)) {
+					visible.push_back(uint32_t(sprites.size() + visibleStatic.size()));
+					visibleStatic.push_back(SpritePainterEntry(*s.sprite, s.mask, s.layer, s.tieBreaker));
+				}
+			}
+		}
+	}
+}
+
+const SpritePainterEntry& SpritePainter::getEntry(uint32_t index) const
+{
+	return index < sprites.size() ? sprites[index] : visibleStatic[index - sprites.size()];
+}
+
+const Sprite* SpritePainter::getSprite(const SpritePainterEntry& entry) const
+{
+	switch (entry.getType()) {
+	case SpritePainterEntryType::SpriteRef:
+		return &entry.getSprite();
+	case SpritePainterEntryType::SpriteCached:
+		return &cachedSprites[entry.getIndex()];
+	default:
+		return nullptr;
+	}
+}
+
+const SpritePainter::CompactSprite* SpritePainter::getCompact(const SpritePainterEntry& entry) const
+{
+	return entry.getType() == SpritePainterEntryType::SpriteCompact ? &compactSprites[entry.getIndex()] : nullptr;
+}
+
+const SpriteVertexAttrib* SpritePainter::getVertex(const SpritePainterEntry& entry) const
+{
+	if (const auto sprite = getSprite(entry)) {
+		return &sprite->getVertexAttrib();
+	} else if (const auto compact = getCompact(entry)) {
+		return &compact->vertex;
+	} else {
+		return nullptr;
+	}
+}
+
+const Material* SpritePainter::getDepthWritingMaterial(const SpritePainterEntry& entry) const
+{
+	if (const auto sprite = getSprite(entry)) {
+		return writesDepth(*sprite) ? &sprite->getMaterial() : nullptr;
+	} else if (const auto compact = getCompact(entry)) {
+		const auto& material = *frameMaterials[compact->materialIdx];
+		return writesDepth(material) ? &material : nullptr;
+	} else {
+		return nullptr;
+	}
+}
+
+const TextRenderer* SpritePainter::getText(const SpritePainterEntry& entry) const
+{
+	switch (entry.getType()) {
+	case SpritePainterEntryType::TextRef:
+		return &entry.getText();
+	case SpritePainterEntryType::TextCached:
+		return &cachedText[entry.getIndex()];
+	default:
+		return nullptr;
+	}
+}
+
+bool SpritePainter::isInView(const SpritePainterEntry& entry, Rect4f view, float zoom) const
+{
+	switch (entry.getType()) {
+	case SpritePainterEntryType::SpriteRef:
+		return entry.getSprite().isInView(view) && entry.getSprite().isLargeEnoughOnScreen(zoom);
+	case SpritePainterEntryType::SpriteCached:
+		return cachedSprites[entry.getIndex()].isInView(view) && cachedSprites[entry.getIndex()].isLargeEnoughOnScreen(zoom);
+	case SpritePainterEntryType::SpriteCompact:
+		{
+			// Same as Sprite::isInView and Sprite::isLargeEnoughOnScreen
+			const auto& compact = compactSprites[entry.getIndex()];
+			const auto size = compact.aabb.getSize();
+			return compact.aabb.overlaps(view) && (compact.minScreenSize <= 0 || std::max(size.x, size.y) * zoom >= compact.minScreenSize);
+		}
+	default:
+		// Text doesn't know its bounds without laying it out
+		return true;
+	}
+}
+
+void SpritePainter::sort()
+{
+	sorted.resize(visible.size());
+	for (size_t i = 0; i < visible.size(); ++i) {
+		sorted[i] = SortEntry{ getSortKey(getEntry(visible[i])), visible[i] };
+	}
+	if (sorted.size() > 1) {
+		radixSort(sorted, sortScratch);
+	}
+}
+
+uint64_t SpritePainter::getSortKey(const SpritePainterEntry& entry) const
+{
+	// 16 bits of layer, 32 bits of tie breaker, 4 bits of shader variant and 12 bits of material hash
+	static_assert(MaterialDefinition::maxKeywords <= 4, "Variant doesn't fit in the sort key");
+	const uint64_t layer = uint64_t(clamp(entry.getLayer(), -32768, 32767) + 32768);
+	const uint64_t depth = getOrderedBits(entry.getTieBreaker());
+
+	uint64_t material = 0;
+	const Material* spriteMaterial = nullptr;
+	if (const auto sprite = getSprite(entry)) {
+		spriteMaterial = sprite->hasMaterial() ? &sprite->getMaterial() : nullptr;
+	} else if (const auto compact = getCompact(entry)) {
+		spriteMaterial = frameMaterials[compact->materialIdx].get();
+	}
+	if (spriteMaterial) {
+		const uint64_t hash = spriteMaterial->getHash();
+		material = (uint64_t(spriteMaterial->getVariant()) << 12) | ((hash ^ (hash >> 16) ^ (hash >> 32) ^ (hash >> 48)) & 0xFFF);
+	}
+
+	return (layer << 48) | (depth << 16) | material;
+}
+
+void SpritePainter::draw(const SpritePainterEntry& entry, const SpriteVertexAttrib& vertex, Painter& painter, Rect4f view)
+{
+	if (const auto sprite = getSprite(entry)) {
+		draw(*sprite, vertex, painter, view);
+	} else if (const auto compact = getCompact(entry)) {
+		if (compact->aabb.overlaps(view)) {
+			addToBatch(frameMaterials[compact->materialIdx], vertex, painter);
+		}
+	} else {
+		flushBatch(painter);
+		draw(*getText(entry), painter, view);
+	}
+}
+
+void SpritePainter::draw(const Sprite& sprite, const SpriteVertexAttrib& vertex, Painter& painter, Rect4f view)
 {
 	if (sprite.isInView(view)) {
-		sprite.draw(painter);
+		if (sprite.isSliced() || sprite.getClip()) {
+			flushBatch(painter);
+			if (vertex.depth != sprite.getDepth()) {
+				sprite.clone().setDepth(vertex.depth).draw(painter);
+			} else {
+				sprite.draw(painter);
+			}
+		} else {
+			addToBatch(sprite.getMaterialPtr(), vertex, painter);
+		}
+	}
+}
+
+void SpritePainter::addToBatch(const std::shared_ptr<Material>& material, const SpriteVertexAttrib& vertex, Painter& painter)
+{
+	// Consecutive plain sprites with the same material go to the painter in one call, which lets it build their
+	// vertices in parallel
+	if (batchMaterial && *batchMaterial != material) {
+		flushBatch(painter);
+	}
+	if (!batchMaterial) {
+		batchMaterial = &material;
+	}
+	batch.push_back(&vertex);
+}
+
+void SpritePainter::flushBatch(Painter& painter)
+{
+	if (batchMaterial) {
+		Expects((*batchMaterial)->getDefinition().getVertexStride() == sizeof(SpriteVertexAttrib));
+		painter.drawSprites(*batchMaterial, batch.size(), batch.data());
+		batch.clear();
+		batchMaterial = nullptr;
 	}
 }
 
@@ -153,6 +153,11 @@ void SpriteSheet::addSprite(String name, const SpriteSheetEntry& sprite)
 	spriteIdx[name] = uint32_t(sprites.size() - 1);
 }
 
+const String& SpriteSheet::getTextureName() const
+{
+	return textureName;
+}
+
 void SpriteSheet::setTextureName(String name)
 {
 	textureName = name;
@@ -0,0 +1,152 @@
+#include "graphics/sprite/static_sprite_batch.h"
+#include "graphics/sprite/sprite.h"
+#include "graphics/painter.h"
+#include "graphics/camera.h"
+#include "graphics/material/material.h"
+#include "graphics/material/material_definition.h"
+#include "halley/data_structures/hash_map.h"
+#include <gsl/gsl_assert>
+#include <cstring>
+#include <cmath>
+#include <array>
+
+using namespace Halley;
+
+namespace {
+	// Indices are 16-bit, and relative to the start of their part
+	constexpr size_t maxVerticesPerPart = 65536;
+
+	Rect4f transformRect(Rect4f rect, const Matrix4f& transform)
+	{
+		std::array<Vector2f, 4> corners = {{ rect.getTopLeft(), rect.getTopRight(), rect.getBottomLeft(), rect.getBottomRight() }};
+		transform.transformPoints(corners, corners);
+		Rect4f result(corners[0], corners[0]);
+		for (auto& c: corners) {
+			result = result.merge(Rect4f(c, c));
+		}
+		return result;
+	}
+}
+
+StaticSpriteBatch::StaticSpriteBatch(gsl::span<const Sprite> sprites, float chunkSize)
+	: numSprites(size_t(sprites.size()))
+{
+	// Chunks are kept in the order each one first shows up, and sprites in the order they were given within each
+	Vector<Vector<const Sprite*>> chunkSprites;
+	HashMap<uint64_t, size_t> chunkIndices;
+	for (auto& sprite: sprites) {
+		uint64_t key = 0;
+		if (chunkSize > 0) {
+			const auto centre = sprite.getAABB().getCenter();
+			const auto x = int32_t(std::floor(centre.x / chunkSize));
+			const auto y = int32_t(std::floor(centre.y / chunkSize));
+			key = (uint64_t(uint32_t(x)) << 32) | uint64_t(uint32_t(y));
+		}
+
+		auto iter = chunkIndices.find(key);
+		if (iter == chunkIndices.end()) {
+			iter = chunkIndices.emplace(key, chunkSprites.size()).first;
+			chunkSprites.emplace_back();
+		}
+		chunkSprites[iter->second].push_back(&sprite);
+	}
+
+	for (auto& s: chunkSprites) {
+		chunks.push_back(bake(s));
+		bounds = chunks.size() == 1 ? chunks.back()->bounds : bounds.merge(chunks.back()->bounds);
+	}
+}
+
+std::shared_ptr<StaticGeometry> StaticSpriteBatch::bake(gsl::span<const Sprite* const> sprites)
+{
+	constexpr size_t verticesPerSprite = 4;
+	auto geometry = std::make_shared<StaticGeometry>();
+
+	bool first = true;
+	for (auto* sprite: sprites) {
+		Expects(!sprite->isSliced());
+
+		auto& material = sprite->getMaterialPtr();
+		const auto& definition = material->getDefinition();
+		Expects(definition.getVertexStride() == sizeof(SpriteVertexAttrib));
+
+		// Consecutive sprites with the same material share a part, which is one draw call
+		auto& parts = geometry->parts;
+		if (parts.empty() || !(*parts.back().material == *material) || parts.back().numVertices + verticesPerSprite > maxVerticesPerPart) {
+			parts.push_back(StaticGeometry::Part{ material, geometry->vertexData.size(), 0, geometry->indexData.size(), 0, true });
+		}
+		auto& part = parts.back();
+
+		// Same layout as Painter::drawSprites generates
+		const size_t vertexStride = definition.getVertexStride();
+		const size_t vertPosOffset = definition.getVertexPosOffset();
+		const size_t dstStart = geometry->vertexData.size();
+		geometry->vertexData.resize(dstStart + verticesPerSprite * vertexStride);
+		for (size_t j = 0; j < verticesPerSprite; j++) {
+			char* dst = geometry->vertexData.data() + dstStart + j * vertexStride;
+			memcpy(dst, &sprite->getVertexAttrib(), sizeof(SpriteVertexAttrib));
+
+			const float x = ((j & 1) ^ ((j & 2) >> 1)) * 1.0f;
+			const float y = ((j & 2) >> 1) * 1.0f;
+			const Vector4f vertPos(x, y, x, y);
+			memcpy(dst + vertPosOffset, &vertPos, sizeof(vertPos));
+		}
+
+		// A-----B
+		// |     |
+		// D-----C
+		const auto pos = static_cast<unsigned short>(part.numVertices);
+		const std::array<unsigned short, 6> indices = {{ pos, static_cast<unsigned short>(pos + 1), static_cast<unsigned short>(pos + 2), static_cast<unsigned short>(pos + 2), static_cast<unsigned short>(pos + 3), pos }};
+		geometry->indexData.insert(geometry->indexData.end(), indices.begin(), indices.end());
+
+		part.numVertices += verticesPerSprite;
+		part.numIndices += indices.size();
+
+		const auto aabb = sprite->getAABB();
+		geometry->bounds = first ? aabb : geometry->bounds.merge(aabb);
+		first = false;
+	}
+
+	return geometry;
+}
+
+void StaticSpriteBatch::draw(Painter& painter) const
+{
+	const auto view = painter.getCurrentCamera().getClippingRectangle();
+	for (auto& chunk: chunks) {
+		if (chunk->bounds.overlaps(view)) {
+			painter.drawStaticGeometry(chunk);
+		}
+	}
+}
+
+void StaticSpriteBatch::draw(Painter& painter, const Matrix4f& transform) const
+{
+	const auto view = painter.getCurrentCamera().getClippingRectangle();
+	if (!transformRect(bounds, transform).overlaps(view)) {
+		return;
+	}
+
+	painter.setTransform(transform);
+	for (auto& chunk: chunks) {
+		if (chunks.size() == 1 || transformRect(chunk->bounds, transform).overlaps(view)) {
+			painter.drawStaticGeometry(chunk);
+		}
+	}
+	painter.resetTransform();
+}
+
+size_t StaticSpriteBatch::getNumSprites() const
+{
+	return numSprites;
+}
+
+size_t StaticSpriteBatch::getNumChunks() const
+{
+	return chunks.size();
+}
+
+Rect4f StaticSpriteBatch::getBounds() const
+{
+	return bounds;
+}
@@ -1,4 +1,5 @@
 #include "graphics/text/font.h"
+#include "graphics/text/glyph_atlas.h"
 #include "halley/core/graphics/material/material.h"
 #include "halley/core/graphics/material/material_definition.h"
 #include "halley/core/graphics/material/material_parameter.h"
@@ -70,7 +71,14 @@ Font::Font(ResourceLoader& loader)
 	auto ds = Deserializer(data->getSpan());
 	deserialize(ds);
 
-	auto texture = loader.getAPI().getResource<Texture>(imageName);
+	std::shared_ptr<const Texture> texture;
+	if (dynamicAtlas) {
+		atlas = std::make_shared<GlyphAtlas>(*loader.getAPI().video, atlasSize, std::move(glyphBitmaps));
+		glyphBitmaps.clear();
+		texture = atlas->getTexture();
+	} else {
+		texture = loader.getAPI().getResource<Texture>(imageName);
+	}
 	auto matDef = loader.getAPI().getResource<MaterialDefinition>(distanceField ? "Halley/Text" : "Halley/Sprite");
 	material = std::make_unique<Material>(matDef);
 	material->set("tex0", texture);
@@ -95,24 +103,14 @@ void Font::onLoaded(Resources& resources)
 
 const Font::Glyph& Font::getGlyph(int code) const
 {
-	auto& font = getFontForGlyph(code);
-	auto iter = font.glyphs.find(code);
-	if (iter == font.glyphs.end()) {
-		iter = font.glyphs.find(0);
-		if (iter == font.glyphs.end()) {
-			throw Exception("Unable to load fallback character, needed for character " + toString(code), HalleyExceptions::Graphics);
-		}
-		return iter->second;
-	}
-	return iter->second;
+	return *getFontAndGlyph(code).second;
 }
 
 const Font& Font::getFontForGlyph(int code) const
 {
-	auto iter = glyphs.find(code);
-	if (iter == glyphs.end()) {
+	if (!findGlyph(code)) {
 		for (auto& font: fallbackFont) {
-			if (font->glyphs.find(code) != font->glyphs.end()) {
+			if (font->findGlyph(code)) {
 				return *font;
 			}
 		}
@@ -120,6 +118,57 @@ const Font& Font::getFontForGlyph(int code) const
 	return *this;
 }
 
+std::pair<const Font*, const Font::Glyph*> Font::getFontAndGlyph(int code) const
+{
+	if (auto glyph = findGlyph(code)) {
+		return { this, glyph };
+	}
+	for (auto& font: fallbackFont) {
+		if (auto glyph = font->findGlyph(code)) {
+			return { font.get(), glyph };
+		}
+	}
+	if (auto glyph = findGlyph(0)) {
+		return { this, glyph };
+	}
+	throw Exception("Unable to load fallback character, needed for character " + toString(code), HalleyExceptions::Graphics);
+}
+
+const Font::Glyph* Font::findGlyph(int code) const
+{
+	if (glyphTable.empty()) {
+		const auto iter = glyphs.find(code);
+		return iter != glyphs.end() ? &iter->second : nullptr;
+	}
+
+	const size_t page = size_t(code) >> 8;
+	if (code < 0 || page >= glyphTable.size() || glyphTable[page].empty()) {
+		return nullptr;
+	}
+	const int idx = glyphTable[page][code & 0xFF];
+	return idx >= 0 ? &(glyphs.begin() + idx)->second : nullptr;
+}
+
+void Font::buildGlyphTable()
+{
+	glyphTable.clear();
+	int idx = 0;
+	for (auto& g: glyphs) {
+		const int code = g.first;
+		if (code >= 0) {
+			const size_t page = size_t(code) >> 8;
+			if (page >= glyphTable.size()) {
+				glyphTable.resize(page + 1);
+			}
+			if (glyphTable[page].empty()) {
+				glyphTable[page].resize(256, -1);
+			}
+			glyphTable[page][code & 0xFF] = idx;
+		}
+		++idx;
+	}
+}
+
 float Font::getLineHeightAtSize(float size) const
 {
 	return height * size / sizePt;
@@ -155,6 +204,16 @@ String Font::getName() const
 	return name;
 }
 
+String Font::getImageName() const
+{
+	return imageName;
+}
+
+const std::vector<String>& Font::getFallback() const
+{
+	return fallback;
+}
+
 bool Font::isDistanceField() const
 {
 	return distanceField;
@@ -163,6 +222,43 @@ bool Font::isDistanceField() const
 void Font::addGlyph(const Glyph& glyph)
 {
 	glyphs[glyph.charcode] = glyph;
+	glyphTable.clear();
+}
+
+void Font::setDynamicAtlas(Vector2i size)
+{
+	dynamicAtlas = true;
+	atlasSize = size;
+}
+
+void Font::addGlyphBitmap(int charcode, Bytes compressedAlpha)
+{
+	glyphBitmaps[charcode] = std::move(compressedAlpha);
+}
+
+bool Font::hasDynamicAtlas() const
+{
+	return dynamicAtlas;
+}
+
+Rect4f Font::getGlyphArea(const Glyph& glyph) const
+{
+	if (atlas) {
+		return atlas->getArea(glyph.charcode, Vector2i(glyph.size));
+	}
+	return glyph.area;
+}
+
+uint32_t Font::getAtlasVersion() const
+{
+	// Versions only ever go up, so the sum changes whenever any of them does
+	uint32_t result = atlas ? atlas->getVersion() : 0;
+	for (auto& font: fallbackFont) {
+		if (font->atlas) {
+			result += font->atlas->getVersion();
+		}
+	}
+	return result;
 }
 
 std::shared_ptr<Material> Font::getMaterial() const
@@ -182,6 +278,9 @@ void Font::serialize(Serializer& s) const
 	s << replacementScale;
 	s << glyphs;
 	s << fallback;
+	s << dynamicAtlas;
+	s << atlasSize;
+	s << glyphBitmaps;
 }
 
 void Font::deserialize(Deserializer& s)
@@ -196,10 +295,14 @@ void Font::deserialize(Deserializer& s)
 	s >> replacementScale;
 	s >> glyphs;
 	s >> fallback;
+	s >> dynamicAtlas;
+	s >> atlasSize;
+	s >> glyphBitmaps;
 
 	for (auto& g: glyphs) {
 		g.second.charcode = g.first;
 	}
+	buildGlyphTable();
 
 	//printGlyphs();
 }
@@ -0,0 +1,230 @@
+#include "graphics/text/glyph_atlas.h"
+#include "halley/core/api/video_api.h"
+#include "halley/core/graphics/texture.h"
+#include "halley/core/graphics/texture_descriptor.h"
+#include "halley/concurrency/concurrent.h"
+#include "halley/bytes/compression.h"
+#include "halley/support/logger.h"
+#include "halley/text/string_converter.h"
+
+using namespace Halley;
+
+GlyphAtlas::GlyphAtlas(VideoAPI& video, Vector2i size, FlatMap<int, Bytes> glyphBitmaps)
+	: texture(video.createTexture(size))
+	, queue(std::make_shared<DecodeQueue>())
+	, size(size)
+{
+	queue->bitmaps = std::move(glyphBitmaps);
+
+	Concurrent::execute(Executors::getVideoAux(), [texture = texture, size] ()
+	{
+		// Start out blank, rather than with whatever the driver had in that memory
+		TextureDescriptor descriptor(size, TextureFormat::RGBA);
+		descriptor.useFiltering = true;
+		descriptor.clamp = true;
+		descriptor.canBeUpdated = true;
+		descriptor.pixelData = TextureDescriptorImageData(Bytes(TextureDescriptor::getDataSize(TextureFormat::RGBA, size), 0));
+		texture->load(std::move(descriptor));
+	});
+}
+
+const std::shared_ptr<Texture>& GlyphAtlas::getTexture() const
+{
+	return texture;
+}
+
+Rect4f GlyphAtlas::getArea(int charcode, Vector2i glyphSize)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	auto iter = resident.find(charcode);
+	if (iter != resident.end()) {
+		iter->second.lastUsed = ++tick;
+		return toTexCoords(iter->second.rect);
+	}
+
+	request(charcode, glyphSize);
+	return toTexCoords(Rect4i(0, 0, 1, 1));
+}
+
+uint32_t GlyphAtlas::getVersion()
+{
+	if (queue->hasDone.load(std::memory_order_acquire)) {
+		Vector<DecodedGlyph> done;
+		{
+			std::unique_lock<std::mutex> lock(queue->mutex);
+			done = std::move(queue->done);
+			queue->done.clear();
+			queue->hasDone.store(false, std::memory_order_relaxed);
+		}
+
+		std::unique_lock<std::mutex> lock(mutex);
+		for (auto& glyph: done) {
+			pack(glyph);
+		}
+	}
+
+	std::unique_lock<std::mutex> lock(mutex);
+	return version;
+}
+
+size_t GlyphAtlas::getNumResident() const
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	return resident.size();
+}
+
+void GlyphAtlas::request(int charcode, Vector2i glyphSize)
+{
+	if (requested.find(charcode) != requested.end()) {
+		return;
+	}
+	requested.insert(charcode);
+
+	if (glyphSize.x <= 0 || glyphSize.y <= 0 || queue->bitmaps.find(charcode) == queue->bitmaps.end()) {
+		// Nothing to draw, so it stays as the blank area
+		return;
+	}
+
+	// The bitmaps are never modified after construction, so they can be read without locking
+	Concurrent::execute(Executors::getCPU(), [queue = queue, charcode, glyphSize] ()
+	{
+		const size_t nPixels = size_t(glyphSize.x) * size_t(glyphSize.y);
+		const auto alpha = Compression::decompress(queue->bitmaps.at(charcode), nPixels);
+
+		// Same layout as the pre-baked atlases, so the same material can be used
+		Bytes pixels(nPixels * 4);
+		for (size_t i = 0; i < nPixels; ++i) {
+			pixels[i * 4] = 255;
+			pixels[i * 4 + 1] = 255;
+			pixels[i * 4 + 2] = 255;
+			pixels[i * 4 + 3] = i < alpha.size() ? alpha[i] : 0;
+		}
+
+		std::unique_lock<std::mutex> lock(queue->mutex);
+		queue->done.push_back(DecodedGlyph{ charcode, glyphSize, std::move(pixels) });
+		queue->hasDone.store(true, std::memory_order_release);
+	});
+}
+
+void GlyphAtlas::pack(DecodedGlyph& glyph)
+{
+	requested.erase(glyph.charcode);
+
+	const auto allocSize = glyph.size + Vector2i(padding, padding);
+	Rect4i rect;
+	size_t shelfIdx = 0;
+	while (!allocate(allocSize, rect, shelfIdx)) {
+		if (!evictLeastRecentlyUsed()) {
+			Logger::logWarning("Glyph " + toString(glyph.charcode) + " doesn't fit in a " + toString(size.x) + "x" + toString(size.y) + " glyph atlas.");
+			return;
+		}
+	}
+
+	texture->updateRegion(rect, TextureFormat::RGBA, std::move(glyph.pixels));
+	resident[glyph.charcode] = ResidentGlyph{ rect, shelfIdx, ++tick };
+	++version;
+}
+
+bool GlyphAtlas::allocate(Vector2i allocSize, Rect4i& rect, size_t& shelfIdx)
+{
+	if (allocSize.x > size.x) {
+		return false;
+	}
+
+	auto fitsInShelf = [&] (const Shelf& shelf) -> bool
+	{
+		if (size.x - shelf.usedWidth >= allocSize.x) {
+			return true;
+		}
+		for (auto& span: shelf.freeSpans) {
+			if (span.end - span.start >= allocSize.x) {
+				return true;
+			}
+		}
+		return false;
+	};
+
+	// Tightest shelf that fits; an empty shelf takes any glyph that isn't taller than it
+	bool found = false;
+	for (size_t i = 0; i < shelves.size(); ++i) {
+		const auto& shelf = shelves[i];
+		const bool heightOk = allocSize.y <= shelf.height && (shelf.numResident == 0 || shelf.height <= allocSize.y + allocSize.y / 4 + 2);
+		if (heightOk && (!found || shelf.height < shelves[shelfIdx].height) && fitsInShelf(shelf)) {
+			shelfIdx = i;
+			found = true;
+		}
+	}
+
+	if (!found) {
+		if (nextShelfY + allocSize.y > size.y) {
+			return false;
+		}
+		Shelf shelf;
+		shelf.y = nextShelfY;
+		shelf.height = allocSize.y;
+		shelves.push_back(shelf);
+		nextShelfY += allocSize.y;
+		shelfIdx = shelves.size() - 1;
+	}
+
+	auto& shelf = shelves[shelfIdx];
+	int x = -1;
+	for (size_t i = 0; i < shelf.freeSpans.size(); ++i) {
+		auto& span = shelf.freeSpans[i];
+		if (span.end - span.start >= allocSize.x) {
+			x = span.start;
+			span.start += allocSize.x;
+			if (span.start == span.end) {
+				shelf.freeSpans.erase(shelf.freeSpans.begin() + i);
+			}
+			break;
+		}
+	}
+	if (x < 0) {
+		x = shelf.usedWidth;
+		shelf.usedWidth += allocSize.x;
+	}
+	++shelf.numResident;
+
+	rect = Rect4i(x, shelf.y, allocSize.x - padding, allocSize.y - padding);
+	return true;
+}
+
+bool GlyphAtlas::evictLeastRecentlyUsed()
+{
+	auto lru = resident.end();
+	for (auto iter = resident.begin(); iter != resident.end(); ++iter) {
+		if (lru == resident.end() || iter->second.lastUsed < lru->second.lastUsed) {
+			lru = iter;
+		}
+	}
+	if (lru == resident.end()) {
+		return false;
+	}
+
+	const auto& glyph = lru->second;
+	auto& shelf = shelves[glyph.shelf];
+	--shelf.numResident;
+	if (shelf.numResident == 0) {
+		shelf.usedWidth = 0;
+		shelf.freeSpans.clear();
+	} else {
+		shelf.freeSpans.push_back(Range<int>(glyph.rect.getLeft(), glyph.rect.getRight() + padding));
+	}
+	resident.erase(lru);
+
+	// Give the space of empty shelves at the bottom back, so it can be split up differently
+	while (!shelves.empty() && shelves.back().numResident == 0) {
+		nextShelfY = shelves.back().y;
+		shelves.pop_back();
+	}
+
+	++version;
+	return true;
+}
+
+Rect4f GlyphAtlas::toTexCoords(Rect4i rect) const
+{
+	return Rect4f(rect) / Vector2f(size);
+}
@@ -1,8 +1,6 @@
 #include "graphics/text/text_renderer.h"
 #include "graphics/text/font.h"
 #include "halley/core/graphics/painter.h"
-#include "halley/core/graphics/material/material.h"
-#include "halley/core/graphics/material/material_parameter.h"
 #include <gsl/gsl_assert>
 #include "halley/text/i18n.h"
 
@@ -35,10 +33,7 @@ TextRenderer& TextRenderer::setFont(std::shared_ptr<const Font> v)
 {
 	if (font != v) {
 		font = v;
-
-		if (font->isDistanceField()) {
-			materialDirty = true;
-		}
+		glyphsDirty = true;
 	}
 
 	return *this;
@@ -46,9 +41,15 @@ TextRenderer& TextRenderer::setFont(std::shared_ptr<const Font> v)
 
 TextRenderer& TextRenderer::setText(const String& v)
 {
-	const auto newText = v.getUTF32();
-	if (newText != text) {
-		text = newText;
+	// This usually gets called every frame with the same text, so decode into a reused buffer and only copy on changes
+	thread_local StringUTF32 decoded;
+	decoded.resize(v.getUTF32Len());
+	if (!decoded.empty()) {
+		v.getUTF32(gsl::span<utf32type>(&decoded[0], decoded.size()));
+	}
+
+	if (decoded != text) {
+		text = decoded;
 		glyphsDirty = true;
 	}
 	return *this;
@@ -65,12 +66,7 @@ TextRenderer& TextRenderer::setText(const StringUTF32& v)
 
 TextRenderer& TextRenderer::setText(const LocalisedString& v)
 {
-	const auto newText = v.getString().getUTF32();
-	if (newText != text) {
-		text = newText;
-		glyphsDirty = true;
-	}
-	return *this;
+	return setText(v.getString());
 }
 
 TextRenderer& TextRenderer::setSize(float v)
@@ -95,7 +91,7 @@ TextRenderer& TextRenderer::setOutline(float v)
 {
 	if (outline != v) {
 		outline = v;
-		materialDirty = true;
+		glyphsDirty = true;
 	}
 	return *this;
 }
@@ -134,7 +130,7 @@ TextRenderer& TextRenderer::setSmoothness(float s)
 {
 	if (smoothness != s) {
 		smoothness = s;
-		materialDirty = true;
+		glyphsDirty = true;
 	}
 	return *this;
 }
@@ -170,7 +166,7 @@ TextRenderer& TextRenderer::setOutlineColour(Colour v)
 {
 	if (outlineColour != v) {
 		outlineColour = v;
-		materialDirty = true;
+		glyphsDirty = true;
 	}
 	return *this;
 }
@@ -184,96 +180,149 @@ void TextRenderer::generateSprites(std::vector<Sprite>& sprites) const
 {
 	Expects(font);
 
-	const bool hasMaterialOverride = font->isDistanceField();
-	if (hasMaterialOverride && materialDirty) {
-		updateMaterials();
-		materialDirty = false;
+	// Glyphs in dynamic atlases can move around, and the ones that weren't ready before might be now
+	const auto version = font->getAtlasVersion();
+	if (version != atlasVersion) {
+		atlasVersion = version;
+		glyphsDirty = true;
 	}
 
-	if (glyphsDirty || positionDirty) {
-		float mainScale = getScale(*font);
-		Vector2f p = (position + Vector2f(0, font->getAscenderDistance() * mainScale)).floor();
-		if (offset != Vector2f(0, 0)) {
-			p -= (getExtents() * offset).floor();
+	if (glyphsDirty) {
+		layoutGlyphs(sprites);
+		glyphsDirty = false;
+		positionDirty = false;
+	} else if (positionDirty) {
+		// The layout itself doesn't depend on the position, so just move the glyphs along
+		const auto origin = getLayoutOrigin();
+		const auto delta = origin - layoutOrigin;
+		if (delta != Vector2f()) {
+			for (auto& sprite: sprites) {
+				sprite.setPos(sprite.getPosition() + delta);
+			}
 		}
+		layoutOrigin = origin;
+		positionDirty = false;
+	}
+}
 
-		size_t startPos = 0;
-		size_t spritesInserted = 0;
-		Vector2f lineOffset;
-
-		auto flush = [&] ()
-		{
-			// Line break, update previous characters!
-			if (align != 0) {
-				Vector2f off = (-lineOffset * align).floor();
-				for (size_t j = startPos; j < spritesInserted; j++) {
-					auto& sprite = sprites[j];
-					sprite.setPos(sprite.getPosition() + off);
-				}
+void TextRenderer::layoutGlyphs(std::vector<Sprite>& sprites) const
+{
+	layoutOrigin = getLayoutOrigin();
+	Vector2f p = layoutOrigin;
+	const float lineHeight = getLineHeight();
+
+	size_t startPos = 0;
+	size_t spritesInserted = 0;
+	Vector2f lineOffset;
+	float maxLineWidth = 0;
+
+	auto flush = [&] ()
+	{
+		// Line break, update previous characters!
+		if (align != 0) {
+			Vector2f off = (-lineOffset * align).floor();
+			for (size_t j = startPos; j < spritesInserted; j++) {
+				auto& sprite = sprites[j];
+				sprite.setPos(sprite.getPosition() + off);
 			}
+		}
 
-			// Move pen
-			p.y += getLineHeight();
+		// Move pen
+		p.y += lineHeight;
 
-			// Reset
-			startPos = spritesInserted;
-			lineOffset.x = 0;
-		};
+		// Reset
+		maxLineWidth = std::max(maxLineWidth, lineOffset.x);
+		startPos = spritesInserted;
+		lineOffset.x = 0;
+	};
 
-		auto curCol = colour;
-		size_t curOverride = 0;
+	auto curCol = colour;
+	size_t curOverride = 0;
 
-		const size_t n = text.size();
+	const size_t n = text.size();
 
-		size_t nGlyphs = 0;
-		for (size_t i = 0; i < n; i++) {
-			if (text[i] != '\n') {
-				++nGlyphs;
-			}
+	size_t nGlyphs = 0;
+	size_t nLines = 1;
+	for (size_t i = 0; i < n; i++) {
+		if (text[i] != '\n') {
+			++nGlyphs;
+		} else {
+			++nLines;
 		}
-		sprites.resize(nGlyphs);
+	}
+	sprites.resize(nGlyphs);
+
+	// Consecutive glyphs nearly always come from the same font, so keep its properties around
+	const Font* lastFont = nullptr;
+	std::shared_ptr<Material> materialToUse;
+	float scale = 1.0f;
+	Vector2f fontAdjustment;
+	Vector2f distanceFieldParams;
+	Vector4f outlineParams;
+
+	for (size_t i = 0; i < n; i++) {
+		int c = text[i];
+
+		// Check for colour override
+		while (curOverride < colourOverrides.size() && colourOverrides[curOverride].first == i) {
+			curCol = colourOverrides[curOverride].second ? colourOverrides[curOverride].second.get() : colour;
+			++curOverride;
+		}
+		
+		if (c == '\n') {
+			flush();
+		} else {
+			const auto fontAndGlyph = font->getFontAndGlyph(c);
+			const auto& fontForGlyph = *fontAndGlyph.first;
+			const auto& glyph = *fontAndGlyph.second;
+			if (&fontForGlyph != lastFont) {
+				lastFont = &fontForGlyph;
+				scale = getScale(fontForGlyph);
+				fontAdjustment = (Vector2f(0, fontForGlyph.getAscenderDistance() - font->getAscenderDistance()) * scale).floor();
+				materialToUse = fontForGlyph.getMaterial();
+
+				// Distance field parameters go in the vertices rather than the material, so all text using the same atlas batches together
+				if (fontForGlyph.isDistanceField()) {
+					const float smooth = clamp(smoothness / fontForGlyph.getSmoothRadius(), 0.001f, 0.999f);
+					const float outlineSize = clamp(outline / fontForGlyph.getSmoothRadius(), 0.0f, 0.995f);
+					distanceFieldParams = Vector2f(smooth, outlineSize);
+					outlineParams = Vector4f(outlineColour.r, outlineColour.g, outlineColour.b, outline > 0.0001f ? outlineColour.a : 0.0f);
+				}
+			}
 
-		for (size_t i = 0; i < n; i++) {
-			int c = text[i];
+			sprites[spritesInserted++] = Sprite()
+				.setMaterial(materialToUse)
+				.setSize(glyph.size)
+				.setTexRect(fontForGlyph.getGlyphArea(glyph))
+				.setColour(curCol)
+				.setPivot(glyph.horizontalBearing / glyph.size * Vector2f(-1, 1))
+				.setScale(scale)
+				.setPos(p + lineOffset + pixelOffset + fontAdjustment)
+				.setCustom0(distanceFieldParams)
+				.setCustom1(outlineParams);
 
-			// Check for colour override
-			while (curOverride < colourOverrides.size() && colourOverrides[curOverride].first == i) {
-				curCol = colourOverrides[curOverride].second ? colourOverrides[curOverride].second.get() : colour;
-				++curOverride;
-			}
-			
-			if (c == '\n') {
+			lineOffset.x += glyph.advance.x * scale;
+
+			if (i == n - 1) {
 				flush();
-			} else {
-				auto& fontForGlyph = font->getFontForGlyph(c);
-				auto& glyph = fontForGlyph.getGlyph(c);
-				const float scale = getScale(fontForGlyph);
-				const auto fontAdjustment = (Vector2f(0, fontForGlyph.getAscenderDistance() - font->getAscenderDistance()) * scale).floor();
-
-				std::shared_ptr<Material> materialToUse = hasMaterialOverride ? getMaterial(fontForGlyph) : fontForGlyph.getMaterial();
-
-				sprites[spritesInserted++] = Sprite()
-					.setMaterial(materialToUse)
-					.setSize(glyph.size)
-					.setTexRect(glyph.area)
-					.setColour(curCol)
-					.setPivot(glyph.horizontalBearing / glyph.size * Vector2f(-1, 1))
-					.setScale(scale)
-					.setPos(p + lineOffset + pixelOffset + fontAdjustment);
-
-				lineOffset.x += glyph.advance.x * scale;
-
-				if (i == n - 1) {
-					flush();
-				}
 			}
 		}
+	}
 
-		glyphsDirty = false;
-		positionDirty = false;
+	// Same as getExtents(), but measured during layout rather than walking the text again
+	if (offset != Vector2f(0, 0)) {
+		const Vector2f off = (Vector2f(maxLineWidth, float(nLines) * lineHeight) * offset).floor();
+		for (auto& sprite: sprites) {
+			sprite.setPos(sprite.getPosition() - off);
+		}
 	}
 }
 
+Vector2f TextRenderer::getLayoutOrigin() const
+{
+	return (position + Vector2f(0, font->getAscenderDistance() * getScale(*font))).floor();
+}
+
 void TextRenderer::draw(Painter& painter) const
 {
 	generateSprites(spritesCache);
@@ -317,10 +366,9 @@ Vector2f TextRenderer::getExtents(const StringUTF32& str) const
 			p.x = 0;
 			p.y += lineH;
 		} else {
-			const auto& f = font->getFontForGlyph(c);
-			const float scale = getScale(f);
-			auto& glyph = f.getGlyph(c);
-			p += Vector2f(glyph.advance.x, 0) * scale;
+			const auto fontAndGlyph = font->getFontAndGlyph(c);
+			const float scale = getScale(*fontAndGlyph.first);
+			p += Vector2f(fontAndGlyph.second->advance.x, 0) * scale;
 		}
 	}
 	w = std::max(w, p.x);
@@ -345,10 +393,9 @@ Vector2f TextRenderer::getCharacterPosition(size_t character, const StringUTF32&
 			p.x = 0;
 			p.y += lineH;
 		} else {
-			const auto& f = font->getFontForGlyph(c);
-			const float scale = getScale(f);
-			auto& glyph = f.getGlyph(c);
-			p += Vector2f(glyph.advance.x, 0) * scale;
+			const auto fontAndGlyph = font->getFontAndGlyph(c);
+			const float scale = getScale(*fontAndGlyph.first);
+			p += Vector2f(fontAndGlyph.second->advance.x, 0) * scale;
 		}
 	}
 
@@ -396,10 +443,9 @@ size_t TextRenderer::getCharacterAt(const Vector2f& position, const StringUTF32&
 			p.x = 0;
 			p.y += lineH;
 		} else if (c != 0) {
-			const auto& f = font->getFontForGlyph(c);
-			const float scale = getScale(f);
-			auto& glyph = f.getGlyph(c);
-			p += Vector2f(glyph.advance.x, 0) * scale;
+			const auto fontAndGlyph = font->getFontAndGlyph(c);
+			const float scale = getScale(*fontAndGlyph.first);
+			p += Vector2f(fontAndGlyph.second->advance.x, 0) * scale;
 		}
 	}
 
@@ -436,10 +482,9 @@ StringUTF32 TextRenderer::split(const StringUTF32& str, float maxWidth, std::fun
 				lastValid = src.subspan(0, i + 1);
 			}
 
-			const auto& f = font->getFontForGlyph(c);
-			auto& glyph = f.getGlyph(c);
-			const float scale = getScale(f);
-			const float w = accepted ? glyph.advance.x * scale : 0.0f;
+			const auto fontAndGlyph = font->getFontAndGlyph(c);
+			const float scale = getScale(*fontAndGlyph.first);
+			const float w = accepted ? fontAndGlyph.second->advance.x * scale : 0.0f;
 			curWidth += w;
 
 			if (c == '\n' || curWidth > maxWidth || isLastChar) {
@@ -459,7 +504,7 @@ StringUTF32 TextRenderer::split(const StringUTF32& str, float maxWidth, std::fun
 				if (!result.empty()) {
 					result.push_back('\n');
 				}
-				result += StringUTF32(lastValid.get().data(), advance + advanceAdjust);
+				result.append(lastValid.get().data(), size_t(advance + advanceAdjust));
 				src = src.subspan(advance);
 				break;
 			}
@@ -523,41 +568,3 @@ float TextRenderer::getScale(const Font& f) const
 	const bool usingReplacement = &f != font.get();
 	return size / f.getSizePoints() * (usingReplacement ? font->getReplacementScale() : 1.0f);
 }
-
-std::shared_ptr<Material> TextRenderer::getMaterial(const Font& font) const
-{
-	const auto iter = materials.find(&font);
-	if (iter == materials.end()) {
-		auto material = font.getMaterial()->clone();
-		materials[&font] = material;
-		updateMaterial(*material, font);
-		return material;
-	} else {
-		return iter->second;
-	}
-}
-
-void TextRenderer::updateMaterial(Material& material, const Font& font) const
-{
-	float smooth = clamp(smoothness / font.getSmoothRadius(), 0.001f, 0.999f);
-	float outlineSize = clamp(outline / font.getSmoothRadius(), 0.0f, 0.995f);
-	material
-		.set("u_smoothness", smooth)
-		.set("u_outline", outlineSize)
-		.set("u_outlineColour", outlineColour);
-
-	material.setPassEnabled(0, outline > 0.0001f);
-}
-
-void TextRenderer::updateMaterialForFont(const Font& font) const
-{
-	auto material = getMaterial(font);
-	updateMaterial(*material, font);
-}
-
-void TextRenderer::updateMaterials() const
-{
-	for (auto& m: materials) {
-		updateMaterial(*m.second, *m.first);
-	}
-}
@@ -1,9 +1,11 @@
 #include "halley/core/graphics/texture.h"
 #include "halley/core/api/halley_api.h"
 #include "halley/core/graphics/texture_descriptor.h"
+#include "halley/core/graphics/texture_streamer.h"
 #include <halley/file_formats/image.h>
 #include <halley/resources/metadata.h>
 #include "halley/concurrency/concurrent.h"
+#include "halley/support/profiler.h"
 
 using namespace Halley;
 
@@ -15,6 +17,30 @@ void Texture::load(TextureDescriptor&& descriptor)
 {
 }
 
+void Texture::updateRegion(Rect4i area, TextureFormat format, Bytes&& pixels)
+{
+}
+
+void Texture::setStreamed(bool s)
+{
+	streamed = s;
+}
+
+size_t Texture::getMemoryUsage() const
+{
+	return memoryUsage.load(std::memory_order_relaxed);
+}
+
+bool Texture::reduceMemoryUsage()
+{
+	// Picked up by the streamer on its next update
+	if (!streamed) {
+		return false;
+	}
+	lowResolutionRequested.store(true, std::memory_order_relaxed);
+	return true;
+}
+
 std::shared_ptr<Texture> Texture::loadResource(ResourceLoader& loader)
 {
 	auto& meta = loader.getMeta();
@@ -25,18 +51,26 @@ std::shared_ptr<Texture> Texture::loadResource(ResourceLoader& loader)
 
 	std::shared_ptr<Texture> texture = loader.getAPI().video->createTexture(size);
 	texture->setMeta(meta);
+	auto streamer = meta.getBool("streaming", true) ? loader.getAPI().core->getTextureStreamer() : nullptr;
+	const bool hotReload = loader.getAPI().core->getResources().isHotReloadEnabled();
+	auto timing = loader.getTiming();
 
 	loader.getAsync()
-	.then([texture](std::unique_ptr<ResourceDataStatic> data) -> TextureDescriptorImageData
+	.then([texture, timing](std::unique_ptr<ResourceDataStatic> data) -> TextureDescriptorImageData
 	{
 		auto& meta = texture->getMeta();
 		if (meta.getString("compression") == "png") {
-			return TextureDescriptorImageData(std::make_unique<Image>(*data, meta));
+			const auto start = timing ? Profiler::getTimeNs() : 0;
+			auto img = std::make_unique<Image>(*data, meta);
+			if (timing) {
+				timing->decode += Profiler::getTimeNs() - start;
+			}
+			return TextureDescriptorImageData(std::move(img));
 		} else {
 			return TextureDescriptorImageData(data->getSpan());
 		}
 	})
-	.then(Executors::getVideoAux(), [texture](TextureDescriptorImageData img)
+	.then(Executors::getVideoAux(), [texture, streamer, hotReload, timing](TextureDescriptorImageData img)
 	{
 		auto& meta = texture->getMeta();
 
@@ -52,9 +86,136 @@ std::shared_ptr<Texture> Texture::loadResource(ResourceLoader& loader)
 		descriptor.clamp = meta.getBool("clamp", true);
 		descriptor.format = fromString<TextureFormat>(formatStr);
 		descriptor.pixelData = std::move(img);
+		// Mip levels generated at import time are uploaded as they are, instead of being generated on upload
+		descriptor.mipLevels = meta.getInt("mipLevels", 1);
+		if (descriptor.mipLevels > 1) {
+			descriptor.useMipMap = true;
+		}
 		descriptor.pixelFormat = meta.getString("compression") == "png" ? PixelDataFormat::Image : PixelDataFormat::Precompiled;
-		texture->load(std::move(descriptor));
+
+		size_t bytes = 0;
+		for (int i = 0; i < descriptor.mipLevels; ++i) {
+			bytes += TextureDescriptor::getDataSize(descriptor.format, TextureDescriptor::getMipLevelSize(size, i));
+		}
+		if (descriptor.useMipMap && descriptor.mipLevels == 1) {
+			bytes += bytes / 3; // Generated on upload
+		}
+		texture->memoryUsage = bytes;
+
+		// Reimports can then be diffed and uploaded with updateRegion, see updateInPlace
+		if (hotReload && !TextureDescriptor::isCompressed(descriptor.format) && !descriptor.useMipMap && !descriptor.pixelData.empty()) {
+			const auto span = descriptor.pixelData.getSpan();
+			if (size_t(span.size_bytes()) == TextureDescriptor::getDataSize(descriptor.format, size)) {
+				descriptor.canBeUpdated = true;
+				texture->reloadPixels = std::make_unique<Bytes>(span.size_bytes());
+				memcpy(texture->reloadPixels->data(), span.data(), span.size_bytes());
+			}
+		}
+
+		if (!streamer || !streamer->add(texture, descriptor)) {
+			const auto start = timing ? Profiler::getTimeNs() : 0;
+			texture->load(std::move(descriptor));
+			if (timing) {
+				timing->upload += Profiler::getTimeNs() - start;
+			}
+		}
 	});
 
 	return texture;
 }
+
+bool Texture::updateInPlace(Texture& texture, ResourceLoader& loader)
+{
+	texture.waitForLoad();
+	if (!texture.reloadPixels) {
+		return false;
+	}
+
+	// Anything that changes how it's created needs a new one
+	auto& oldMeta = texture.getMeta();
+	auto& meta = loader.getMeta();
+	for (auto& key: { "width", "height", "mipLevels" }) {
+		if (oldMeta.getInt(key, -1) != meta.getInt(key, -1)) {
+			return false;
+		}
+	}
+	for (auto& key: { "format", "compression" }) {
+		if (oldMeta.getString(key, "") != meta.getString(key, "")) {
+			return false;
+		}
+	}
+	for (auto& key: { "filtering", "mipmap", "clamp" }) {
+		if (oldMeta.getBool(key, false) != meta.getBool(key, false)) {
+			return false;
+		}
+	}
+
+	auto data = loader.getStatic();
+	if (!data) {
+		return false;
+	}
+	std::unique_ptr<Image> img;
+	gsl::span<const gsl::byte> pixels;
+	if (meta.getString("compression") == "png") {
+		img = std::make_unique<Image>(*data, meta);
+		pixels = gsl::as_bytes(gsl::span<const char>(img->getPixels(), img->getByteSize()));
+	} else {
+		pixels = data->getSpan();
+	}
+
+	auto& old = *texture.reloadPixels;
+	if (size_t(pixels.size_bytes()) != old.size()) {
+		return false;
+	}
+
+	auto formatStr = meta.getString("format", "rgba");
+	if (formatStr == "rgba_premultiplied") {
+		formatStr = "rgba";
+	}
+	const auto format = fromString<TextureFormat>(formatStr);
+	const size_t bpp = size_t(TextureDescriptor::getBitsPerPixel(format));
+	const size_t rowBytes = size_t(texture.size.x) * bpp;
+	const auto src = reinterpret_cast<const Byte*>(pixels.data());
+
+	// Each band of rows gets the smallest rectangle covering its changes, so separate edits don't upload everything in between
+	constexpr int bandHeight = 64;
+	for (int bandStart = 0; bandStart < texture.size.y; bandStart += bandHeight) {
+		const int bandEnd = std::min(bandStart + bandHeight, texture.size.y);
+		int x0 = texture.size.x;
+		int x1 = 0;
+		int y0 = bandEnd;
+		int y1 = bandStart;
+		for (int y = bandStart; y < bandEnd; ++y) {
+			const Byte* a = old.data() + y * rowBytes;
+			const Byte* b = src + y * rowBytes;
+			if (memcmp(a, b, rowBytes) == 0) {
+				continue;
+			}
+			size_t first = 0;
+			while (a[first] == b[first]) {
+				++first;
+			}
+			size_t last = rowBytes - 1;
+			while (a[last] == b[last]) {
+				--last;
+			}
+			x0 = std::min(x0, int(first / bpp));
+			x1 = std::max(x1, int(last / bpp) + 1);
+			y0 = std::min(y0, y);
+			y1 = y + 1;
+		}
+
+		if (y0 < y1) {
+			const auto area = Rect4i(x0, y0, x1 - x0, y1 - y0);
+			const size_t areaRowBytes = size_t(area.getWidth()) * bpp;
+			Bytes region(areaRowBytes * size_t(area.getHeight()));
+			for (int y = y0; y < y1; ++y) {
+				memcpy(region.data() + (y - y0) * areaRowBytes, src + y * rowBytes + x0 * bpp, areaRowBytes);
+			}
+			texture.updateRegion(area, format, std::move(region));
+		}
+	}
+
+	memcpy(old.data(), src, old.size());
+	return true;
+}
@@ -89,6 +89,21 @@ int TextureDescriptorImageData::getStrideOr(int assumedStride) const
 	}
 }
 
+gsl::span<const gsl::byte> TextureDescriptorImageData::getMipLevel(TextureFormat format, Vector2i size, int level) const
+{
+	const auto data = getSpan();
+	size_t offset = 0;
+	for (int i = 0; i < level; ++i) {
+		offset += TextureDescriptor::getDataSize(format, TextureDescriptor::getMipLevelSize(size, i));
+	}
+
+	const size_t levelSize = TextureDescriptor::getDataSize(format, TextureDescriptor::getMipLevelSize(size, level));
+	if (offset + levelSize > size_t(data.size())) {
+		throw Exception("Texture data is too small for mip level " + toString(level), HalleyExceptions::Graphics);
+	}
+	return data.subspan(offset, levelSize);
+}
+
 TextureDescriptor::TextureDescriptor(Vector2i size, TextureFormat format)
 	: size(size)
 	, format(format)
@@ -102,6 +117,7 @@ TextureDescriptor& TextureDescriptor::operator=(TextureDescriptor&& other) noexc
 	format = other.format;
 	pixelFormat = other.pixelFormat;
 	pixelData = std::move(other.pixelData);
+	mipLevels = other.mipLevels;
 	useMipMap = other.useMipMap;
 	useFiltering = other.useFiltering;
 	clamp = other.clamp;
@@ -122,6 +138,52 @@ int TextureDescriptor::getBitsPerPixel(TextureFormat format)
 		return 3;
 	case TextureFormat::Indexed:
 		return 1;
+	default:
+		break;
 	}
 	throw Exception("Unknown image format: " + toString(format), HalleyExceptions::Graphics);
 }
+
+bool TextureDescriptor::isCompressed(TextureFormat format)
+{
+	switch (format) {
+	case TextureFormat::BC1:
+	case TextureFormat::BC3:
+	case TextureFormat::BC7:
+	case TextureFormat::ETC2:
+	case TextureFormat::ASTC4x4:
+		return true;
+	default:
+		return false;
+	}
+}
+
+size_t TextureDescriptor::getCompressedSize(TextureFormat format, Vector2i size)
+{
+	// All supported formats use 4x4 blocks
+	const size_t blocks = size_t((size.x + 3) / 4) * size_t((size.y + 3) / 4);
+	switch (format) {
+	case TextureFormat::BC1:
+		return blocks * 8;
+	case TextureFormat::BC3:
+	case TextureFormat::BC7:
+	case TextureFormat::ETC2:
+	case TextureFormat::ASTC4x4:
+		return blocks * 16;
+	default:
+		throw Exception("Not a compressed format: " + toString(format), HalleyExceptions::Graphics);
+	}
+}
+
+size_t TextureDescriptor::getDataSize(TextureFormat format, Vector2i size)
+{
+	if (isCompressed(format)) {
+		return getCompressedSize(format, size);
+	}
+	return size_t(size.x) * size_t(size.y) * size_t(getBitsPerPixel(format));
+}
+
+Vector2i TextureDescriptor::getMipLevelSize(Vector2i size, int level)
+{
+	return Vector2i(std::max(1, size.x >> level), std::max(1, size.y >> level));
+}
@@ -0,0 +1,221 @@
+#include "halley/core/graphics/texture_streamer.h"
+#include "halley/core/graphics/texture.h"
+#include "halley/core/api/video_api.h"
+#include "halley/concurrency/concurrent.h"
+#include "halley/support/profiler.h"
+#include <algorithm>
+
+using namespace Halley;
+
+TextureStreamer::TextureStreamer(VideoAPI& video)
+	: video(video)
+{}
+
+TextureStreamer::~TextureStreamer()
+{
+	// Uploads in flight are still using video
+	for (auto& e: entries) {
+		if (e.pendingLevel >= 0) {
+			e.pending.wait();
+		}
+	}
+}
+
+void TextureStreamer::setEnabled(bool e)
+{
+	enabled = e;
+}
+
+bool TextureStreamer::isEnabled() const
+{
+	return enabled;
+}
+
+void TextureStreamer::setBudget(size_t bytes)
+{
+	budget = bytes;
+}
+
+size_t TextureStreamer::getBudget() const
+{
+	return budget;
+}
+
+size_t TextureStreamer::getResidentBytes() const
+{
+	return residentBytes;
+}
+
+bool TextureStreamer::add(const std::shared_ptr<Texture>& texture, TextureDescriptor& descriptor)
+{
+	if (!enabled || descriptor.mipLevels <= 1 || descriptor.pixelData.empty() || descriptor.canBeUpdated) {
+		return false;
+	}
+
+	Entry entry;
+	entry.texture = texture;
+	entry.settings = Settings{ descriptor.size, descriptor.format, descriptor.mipLevels, descriptor.useFiltering, descriptor.clamp };
+	entry.data = std::make_shared<const Bytes>(descriptor.pixelData.moveBytes());
+	entry.lowLevel = entry.settings.mipLevels - 1;
+	for (int i = 0; i < entry.settings.mipLevels; ++i) {
+		const auto levelSize = TextureDescriptor::getMipLevelSize(entry.settings.size, i);
+		if (std::max(levelSize.x, levelSize.y) <= lowResolutionSize) {
+			entry.lowLevel = i;
+			break;
+		}
+	}
+	entry.residentLevel = entry.lowLevel;
+
+	texture->setStreamed(true);
+	texture->memoryUsage = entry.data->size() + getResidentSize(entry.settings, entry.residentLevel);
+	texture->load(makeDescriptor(entry.settings, *entry.data, entry.lowLevel));
+
+	std::unique_lock<std::mutex> lock(mutex);
+	incoming.push_back(std::move(entry));
+	return true;
+}
+
+void TextureStreamer::update()
+{
+	Profiler::Scope profile("TextureStreamer::update", ProfilerEventType::ResourceLoad);
+	++frame;
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		for (auto& e: incoming) {
+			e.accountedBytes = getResidentSize(e.settings, e.residentLevel);
+			residentBytes += e.accountedBytes;
+			entries.push_back(std::move(e));
+		}
+		incoming.clear();
+	}
+
+	// Apply finished uploads and forget textures that have been unloaded
+	for (auto& e: entries) {
+		if (!finishUpload(e)) {
+			residentBytes -= e.accountedBytes;
+			e.accountedBytes = 0;
+			continue;
+		}
+		auto texture = e.texture.lock();
+		if (texture->consumeUsed()) {
+			e.lastUsedFrame = frame;
+		}
+
+		// Asked to by Resources when over its memory budget, but only if it's not being drawn, or it would just come back
+		if (texture->lowResolutionRequested.exchange(false, std::memory_order_relaxed)) {
+			if (e.residentLevel < e.lowLevel && e.pendingLevel < 0 && frame - e.lastUsedFrame >= keepUsedFrames) {
+				startUpload(e, e.lowLevel);
+			}
+		}
+	}
+	entries.erase(std::remove_if(entries.begin(), entries.end(), [] (const Entry& e) { return e.texture.expired() && e.pendingLevel < 0; }), entries.end());
+
+	// Most recently used first
+	Vector<Entry*> wanted;
+	for (auto& e: entries) {
+		const bool recentlyUsed = !enabled || (e.lastUsedFrame > 0 && frame - e.lastUsedFrame < keepUsedFrames);
+		if (recentlyUsed && e.residentLevel > e.minLevel && e.pendingLevel < 0 && !e.texture.expired()) {
+			wanted.push_back(&e);
+		}
+	}
+	std::sort(wanted.begin(), wanted.end(), [] (const Entry* a, const Entry* b) { return a->lastUsedFrame > b->lastUsedFrame; });
+
+	int uploadsLeft = maxUploadsPerFrame;
+	for (auto* e: wanted) {
+		if (uploadsLeft <= 0) {
+			break;
+		}
+		const size_t extra = getResidentSize(e->settings, e->minLevel) - getResidentSize(e->settings, e->residentLevel);
+		if (!enabled || makeRoom(extra, *e, uploadsLeft)) {
+			startUpload(*e, e->minLevel);
+			--uploadsLeft;
+		}
+	}
+}
+
+void TextureStreamer::startUpload(Entry& entry, int level)
+{
+	// Memory is accounted for as soon as the upload starts, so the budget is never overcommitted
+	const size_t bytes = getResidentSize(entry.settings, level);
+	residentBytes = residentBytes + bytes - entry.accountedBytes;
+	entry.accountedBytes = bytes;
+	entry.pendingLevel = level;
+
+	auto& video = this->video;
+	auto settings = entry.settings;
+	auto data = entry.data;
+	entry.pending = Concurrent::execute(Executors::getVideoAux(), [&video, settings, data, level] () -> std::shared_ptr<Texture>
+	{
+		std::shared_ptr<Texture> texture = video.createTexture(settings.size);
+		texture->load(makeDescriptor(settings, *data, level));
+		return texture;
+	});
+}
+
+bool TextureStreamer::finishUpload(Entry& entry)
+{
+	if (entry.pendingLevel >= 0 && entry.pending.hasValue()) {
+		auto uploaded = entry.pending.get();
+		auto texture = entry.texture.lock();
+		entry.residentLevel = entry.pendingLevel;
+		if (texture) {
+			texture->reload(std::move(*uploaded));
+			texture->memoryUsage = entry.data->size() + getResidentSize(entry.settings, entry.residentLevel);
+		}
+		entry.pendingLevel = -1;
+	}
+	return !entry.texture.expired();
+}
+
+bool TextureStreamer::makeRoom(size_t bytes, const Entry& forEntry, int& uploadsLeft)
+{
+	if (bytes > budget) {
+		return false;
+	}
+
+	// Least recently used first, among textures that aren't in use
+	Vector<Entry*> candidates;
+	for (auto& e: entries) {
+		if (&e != &forEntry && e.residentLevel < e.lowLevel && e.pendingLevel < 0 && frame - e.lastUsedFrame >= keepUsedFrames && !e.texture.expired()) {
+			candidates.push_back(&e);
+		}
+	}
+	std::sort(candidates.begin(), candidates.end(), [] (const Entry* a, const Entry* b) { return a->lastUsedFrame < b->lastUsedFrame; });
+
+	for (auto* e: candidates) {
+		if (residentBytes + bytes <= budget || uploadsLeft <= 1) {
+			break;
+		}
+		startUpload(*e, e->lowLevel);
+		--uploadsLeft;
+	}
+	return residentBytes + bytes <= budget;
+}
+
+size_t TextureStreamer::getResidentSize(const Settings& settings, int level)
+{
+	size_t total = 0;
+	for (int i = level; i < settings.mipLevels; ++i) {
+		total += TextureDescriptor::getDataSize(settings.format, TextureDescriptor::getMipLevelSize(settings.size, i));
+	}
+	return total;
+}
+
+TextureDescriptor TextureStreamer::makeDescriptor(const Settings& settings, const Bytes& data, int level)
+{
+	size_t offset = 0;
+	for (int i = 0; i < level; ++i) {
+		offset += TextureDescriptor::getDataSize(settings.format, TextureDescriptor::getMipLevelSize(settings.size, i));
+	}
+
+	// Dropping the largest levels only makes the GPU texture smaller; it's still sampled with the same coordinates
+	TextureDescriptor descriptor(TextureDescriptor::getMipLevelSize(settings.size, level), settings.format);
+	descriptor.mipLevels = settings.mipLevels - level;
+	descriptor.useMipMap = descriptor.mipLevels > 1;
+	descriptor.useFiltering = settings.useFiltering;
+	descriptor.clamp = settings.clamp;
+	descriptor.pixelFormat = PixelDataFormat::Precompiled;
+	descriptor.pixelData = TextureDescriptorImageData(gsl::as_bytes(gsl::span<const Byte>(data.data() + offset, data.size() - offset)));
+	return descriptor;
+}
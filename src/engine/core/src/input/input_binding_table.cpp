@@ -0,0 +1,116 @@
+#include "input/input_binding_table.h"
+#include <algorithm>
+
+using namespace Halley;
+
+InputBindingTable::InputBindingTable(int nButtons, int nAxes)
+{
+	buttons.resize(nButtons);
+	axes.resize(nAxes);
+}
+
+size_t InputBindingTable::getNumberButtons() const
+{
+	return buttons.size();
+}
+
+size_t InputBindingTable::getNumberAxes() const
+{
+	return axes.size();
+}
+
+void InputBindingTable::bindButton(int n, spInputDevice device, int deviceN)
+{
+	buttons.at(n).push_back(Bind(device, deviceN, false));
+	++version;
+}
+
+void InputBindingTable::bindAxis(int n, spInputDevice device, int deviceN)
+{
+	axes.at(n).push_back(Bind(device, deviceN, true));
+}
+
+void InputBindingTable::bindAxisButton(int n, spInputDevice device, int negativeButton, int positiveButton)
+{
+	axes.at(n).push_back(Bind(device, negativeButton, positiveButton, true));
+}
+
+void InputBindingTable::unbindButton(int n)
+{
+	buttons.at(n).clear();
+	++version;
+}
+
+void InputBindingTable::unbindAxis(int n)
+{
+	axes.at(n).clear();
+}
+
+void InputBindingTable::clear()
+{
+	for (auto& b: buttons) {
+		b.clear();
+	}
+	for (auto& a: axes) {
+		a.clear();
+	}
+	++version;
+}
+
+std::set<spInputDevice> InputBindingTable::getAllDevices() const
+{
+	std::set<spInputDevice> devices;
+	for (auto& axisBinds: axes) {
+		for (auto& bind: axisBinds) {
+			if (bind.device) {
+				devices.insert(bind.device);
+			}
+		}
+	}
+	for (auto& buttonBinds: buttons) {
+		for (auto& bind: buttonBinds) {
+			if (bind.device) {
+				devices.insert(bind.device);
+			}
+		}
+	}
+	return devices;
+}
+
+const Vector<InputBindingTable::DeviceButtons>& InputBindingTable::getButtonsByDevice()
+{
+	if (byDeviceVersion != version) {
+		byDevice.clear();
+		for (size_t i = 0; i < buttons.size(); ++i) {
+			for (auto& bind: buttons[i]) {
+				if (!bind.device) {
+					continue;
+				}
+				auto iter = std::find_if(byDevice.begin(), byDevice.end(), [&] (const DeviceButtons& d) { return d.device == bind.device.get(); });
+				if (iter == byDevice.end()) {
+					byDevice.push_back(DeviceButtons{ bind.device.get(), {} });
+					iter = byDevice.end() - 1;
+				}
+				iter->buttons.emplace_back(int(i), bind.a);
+			}
+		}
+		byDeviceVersion = version;
+	}
+	return byDevice;
+}
+
+InputBindingTable::Bind::Bind(spInputDevice d, int n, bool axis)
+	: device(d)
+	, a(n)
+	, b(0)
+	, isAxis(axis)
+	, isAxisEmulation(false)
+{}
+
+InputBindingTable::Bind::Bind(spInputDevice d, int _a, int _b, bool axis)
+	: device(d)
+	, a(_a)
+	, b(_b)
+	, isAxis(axis)
+	, isAxisEmulation(true)
+{}
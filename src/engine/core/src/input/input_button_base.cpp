@@ -21,9 +21,24 @@
 
 #include "input/input_button_base.h"
 #include "halley/text/string_converter.h"
+#include <atomic>
 
 using namespace Halley;
 
+namespace {
+	std::atomic<uint64_t> stateGeneration(0);
+}
+
+uint64_t InputButtonBase::getStateGeneration()
+{
+	return stateGeneration.load(std::memory_order_relaxed);
+}
+
+void InputButtonBase::onStateChanged()
+{
+	stateGeneration.fetch_add(1, std::memory_order_relaxed);
+}
+
 InputButtonBase::InputButtonBase(int nButtons)
 {
 	if (nButtons != -1) init(nButtons);
@@ -35,10 +50,12 @@ void InputButtonBase::init(int nButtons)
 	buttonPressedRepeat.resize(nButtons);
 	buttonReleased.resize(nButtons);
 	buttonDown.resize(nButtons);
+	onStateChanged();
 }
 
 void InputButtonBase::onButtonPressed(int code)
 {
+	onStateChanged();
 	buttonPressedRepeat[code] = true;
 	if (!buttonDown[code]) {
 		buttonPressed[code] = true;
@@ -50,6 +67,7 @@ void InputButtonBase::onButtonPressed(int code)
 void InputButtonBase::onButtonReleased(int code)
 {
 	if (buttonDown[code]) {
+		onStateChanged();
 		// See comment on method above
 		buttonReleased[code] = true;
 		buttonDown[code] = false;
@@ -61,6 +79,9 @@ void InputButtonBase::onButtonStatus(int code, bool down)
 	// This method should probably not be used with the two above
 	// This is designed for polled input, such as XInput controllers
 	bool wasDown = buttonDown[code] != 0;
+	if (wasDown != down) {
+		onStateChanged();
+	}
 	buttonDown[code] = down;
 	if (wasDown && !down) buttonReleased[code] = true;
 	if (!wasDown && down) {
@@ -81,6 +102,7 @@ InputDevice* InputButtonBase::getParent() const
 
 void InputButtonBase::clearPresses()
 {
+	onStateChanged();
 	size_t len = buttonPressed.size();
 	for (size_t i=0; i<len; i++) {
 		buttonPressed[i] = 0;
@@ -155,6 +177,7 @@ void InputButtonBase::clearButton(int code)
 		buttonPressedRepeat[code] = 0;
 		buttonDown[code] = 0;
 		buttonReleased[code] = 0;
+		onStateChanged();
 	}
 }
 
@@ -163,6 +186,7 @@ void InputButtonBase::clearButtonPress(int code)
 	if (code >= 0 && code < int(buttonPressedRepeat.size())) {
 		buttonPressed[code] = 0;
 		buttonPressedRepeat[code] = 0;
+		onStateChanged();
 	}
 }
 
@@ -170,5 +194,6 @@ void InputButtonBase::clearButtonRelease(int code)
 {
 	if (code >= 0 && code < int(buttonPressedRepeat.size())) {
 		buttonReleased[code] = 0;
+		onStateChanged();
 	}
 }
@@ -0,0 +1,68 @@
+#include "input/input_event_queue.h"
+#include <halley/support/profiler.h>
+#include <algorithm>
+
+using namespace Halley;
+
+InputEventQueue::InputEventQueue(size_t maxEvents)
+	: maxEvents(maxEvents)
+{
+}
+
+int64_t InputEventQueue::getTimeNs()
+{
+	return Profiler::getTimeNs();
+}
+
+void InputEventQueue::push(const InputEvent& event)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	if (events.size() >= maxEvents) {
+		events.erase(events.begin());
+		++dropped;
+	}
+	events.push_back(event);
+}
+
+void InputEventQueue::push(InputEventType type, int device, int code, Vector2f value)
+{
+	InputEvent event;
+	event.timeNs = getTimeNs();
+	event.type = type;
+	event.device = device;
+	event.code = code;
+	event.value = value;
+	push(event);
+}
+
+Vector<InputEvent> InputEventQueue::take()
+{
+	Vector<InputEvent> result;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		result.swap(events);
+	}
+
+	// Events pushed from different threads can arrive slightly out of order
+	std::stable_sort(result.begin(), result.end(), [] (const InputEvent& a, const InputEvent& b) { return a.timeNs < b.timeNs; });
+	return result;
+}
+
+Vector<InputEvent> InputEventQueue::takeUntil(int64_t timeNs)
+{
+	Vector<InputEvent> result;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		std::stable_sort(events.begin(), events.end(), [] (const InputEvent& a, const InputEvent& b) { return a.timeNs < b.timeNs; });
+		const auto end = std::find_if(events.begin(), events.end(), [&] (const InputEvent& e) { return e.timeNs > timeNs; });
+		result.assign(events.begin(), end);
+		events.erase(events.begin(), end);
+	}
+	return result;
+}
+
+size_t InputEventQueue::getDroppedCount() const
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	return dropped;
+}
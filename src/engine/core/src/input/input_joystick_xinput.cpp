@@ -20,6 +20,7 @@
 \*****************************************************************/
 
 #include "input/input_joystick_xinput.h"
+#include "input/input_event_queue.h"
 #include <iostream>
 #include <halley/utils/utils.h>
 #ifdef XINPUT_AVAILABLE
@@ -130,6 +131,79 @@ void InputJoystickXInput::update(Time t)
 	InputJoystick::update(t);
 }
 
+void InputJoystickXInput::pollEvents(InputEventQueue& queue, int device)
+{
+	if (polledCooldown > 0) {
+		polledCooldown--;
+		return;
+	}
+
+	XINPUT_STATE state;
+	ZeroMemory(&state, sizeof(XINPUT_STATE));
+	if (XInputGetState(index, &state) != ERROR_SUCCESS) {
+		polledPacket = 0;
+		polledCooldown = 100;
+		return;
+	}
+	if (state.dwPacketNumber == polledPacket) {
+		return;
+	}
+	polledPacket = state.dwPacketNumber;
+
+	InputEvent event;
+	event.timeNs = InputEventQueue::getTimeNs();
+	event.device = device;
+	auto& gamepad = state.Gamepad;
+
+	const std::array<float, 6> curAxes = {{
+		gamepad.sThumbLX / 32768.0f,
+		-gamepad.sThumbLY / 32768.0f,
+		gamepad.sThumbRX / 32768.0f,
+		-gamepad.sThumbRY / 32768.0f,
+		gamepad.bLeftTrigger / 255.0f,
+		gamepad.bRightTrigger / 255.0f
+	}};
+	for (size_t i = 0; i < curAxes.size(); ++i) {
+		if (curAxes[i] != polledAxes[i]) {
+			event.type = InputEventType::JoystickAxis;
+			event.code = int(i);
+			event.value = Vector2f(curAxes[i], 0);
+			queue.push(event);
+		}
+	}
+	polledAxes = curAxes;
+
+	// Same numbering as update()
+	const std::array<int, 10> masks = {{ XINPUT_GAMEPAD_A, XINPUT_GAMEPAD_B, XINPUT_GAMEPAD_X, XINPUT_GAMEPAD_Y, XINPUT_GAMEPAD_LEFT_SHOULDER, XINPUT_GAMEPAD_RIGHT_SHOULDER,
+		XINPUT_GAMEPAD_LEFT_THUMB, XINPUT_GAMEPAD_RIGHT_THUMB, XINPUT_GAMEPAD_BACK, XINPUT_GAMEPAD_START }};
+	uint32_t curButtons = 0;
+	for (size_t i = 0; i < masks.size(); ++i) {
+		curButtons |= (gamepad.wButtons & masks[i]) != 0 ? (1u << i) : 0;
+	}
+	curButtons |= curAxes[4] > 0.5f ? (1u << 10) : 0;
+	curButtons |= curAxes[5] > 0.5f ? (1u << 11) : 0;
+	const uint32_t changed = curButtons ^ polledButtons;
+	for (int i = 0; i < 12; ++i) {
+		if (changed & (1u << i)) {
+			event.type = (curButtons & (1u << i)) != 0 ? InputEventType::JoystickButtonDown : InputEventType::JoystickButtonUp;
+			event.code = i;
+			event.value = Vector2f();
+			queue.push(event);
+		}
+	}
+	polledButtons = curButtons;
+
+	const int b = gamepad.wButtons;
+	const Vector2f hat(float(((b & XINPUT_GAMEPAD_DPAD_RIGHT) != 0) - ((b & XINPUT_GAMEPAD_DPAD_LEFT) != 0)), float(((b & XINPUT_GAMEPAD_DPAD_DOWN) != 0) - ((b & XINPUT_GAMEPAD_DPAD_UP) != 0)));
+	if (hat != polledHat) {
+		event.type = InputEventType::JoystickHat;
+		event.code = 0;
+		event.value = hat;
+		queue.push(event);
+		polledHat = hat;
+	}
+}
+
 int InputJoystickXInput::getButtonAtPosition(JoystickButtonPosition position) const
 {
 	switch (position) {
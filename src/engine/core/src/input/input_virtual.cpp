@@ -21,23 +21,25 @@
 
 #include "input/input_virtual.h"
 #include "input/input_manual.h"
+#include "halley/support/exception.h"
+#include "halley/text/string_converter.h"
 #include <set>
 #include <algorithm>
 
 using namespace Halley;
 
 InputVirtual::InputVirtual(int nButtons, int nAxes)
-	: lastDeviceFrozen(false)
+	: bindings(std::make_shared<InputBindingTable>(nButtons, nAxes))
+	, lastDeviceFrozen(false)
 	, repeatDelayFirst(0.20f)
 	, repeatDelayHold(0.10f)
 {
-	buttons.resize(nButtons);
 	axes.resize(nAxes);
 }
 
 bool InputVirtual::isEnabled() const
 {
-	for (auto& d: getAllDevices()) {
+	for (auto& d: bindings->getAllDevices()) {
 		if (d->isEnabled()) {
 			return true;
 		}
@@ -57,7 +59,7 @@ std::shared_ptr<InputDevice> InputVirtual::getHat(int)
 
 size_t InputVirtual::getNumberButtons()
 {
-	return buttons.size();
+	return bindings->buttons.size();
 }
 
 size_t InputVirtual::getNumberAxes()
@@ -67,8 +69,8 @@ size_t InputVirtual::getNumberAxes()
 
 bool InputVirtual::isAnyButtonPressed()
 {
-	for (size_t j=0; j < buttons.size(); j++) {
-		auto& binds = buttons[j];
+	for (size_t j=0; j < bindings->buttons.size(); j++) {
+		auto& binds = bindings->buttons[j];
 		for (size_t i=0; i<binds.size(); i++) {
 			Bind& bind = binds[i];
 			if (bind.device->isAnyButtonPressed()) {
@@ -81,8 +83,8 @@ bool InputVirtual::isAnyButtonPressed()
 
 bool InputVirtual::isAnyButtonReleased()
 {
-	for (size_t j=0; j < buttons.size(); j++) {
-		auto& binds = buttons[j];
+	for (size_t j=0; j < bindings->buttons.size(); j++) {
+		auto& binds = bindings->buttons[j];
 		for (size_t i=0; i<binds.size(); i++) {
 			Bind& bind = binds[i];
 			if (bind.device->isAnyButtonReleased()) {
@@ -95,8 +97,8 @@ bool InputVirtual::isAnyButtonReleased()
 
 bool InputVirtual::isAnyButtonDown()
 {
-	for (size_t j=0; j < buttons.size(); j++) {
-		auto& binds = buttons[j];
+	for (size_t j=0; j < bindings->buttons.size(); j++) {
+		auto& binds = bindings->buttons[j];
 		for (size_t i=0; i<binds.size(); i++) {
 			Bind& bind = binds[i];
 			if (bind.device->isAnyButtonDown()) {
@@ -109,7 +111,11 @@ bool InputVirtual::isAnyButtonDown()
 
 bool InputVirtual::isButtonPressed(int code)
 {
-	auto& binds = buttons.at(code);
+	if (isCacheValid()) {
+		return testBit(pressedBits, code);
+	}
+
+	auto& binds = bindings->buttons.at(code);
 	for (size_t i=0; i<binds.size(); i++) {
 		Bind& bind = binds[i];
 		if (bind.device->isButtonPressed(bind.a)) {
@@ -121,7 +127,11 @@ bool InputVirtual::isButtonPressed(int code)
 
 bool InputVirtual::isButtonPressedRepeat(int code)
 {
-	auto& binds = buttons.at(code);
+	if (isCacheValid()) {
+		return testBit(pressedRepeatBits, code);
+	}
+
+	auto& binds = bindings->buttons.at(code);
 	for (size_t i=0; i<binds.size(); i++) {
 		Bind& bind = binds[i];
 		if (bind.device->isButtonPressedRepeat(bind.a)) {
@@ -133,7 +143,11 @@ bool InputVirtual::isButtonPressedRepeat(int code)
 
 bool InputVirtual::isButtonReleased(int code)
 {
-	auto& binds = buttons.at(code);
+	if (isCacheValid()) {
+		return testBit(releasedBits, code);
+	}
+
+	auto& binds = bindings->buttons.at(code);
 	for (size_t i=0; i<binds.size(); i++) {
 		Bind& bind = binds[i];
 		if (bind.device->isButtonReleased(bind.a)) {
@@ -145,7 +159,11 @@ bool InputVirtual::isButtonReleased(int code)
 
 bool InputVirtual::isButtonDown(int code)
 {
-	auto& binds = buttons.at(code);
+	if (isCacheValid()) {
+		return testBit(downBits, code);
+	}
+
+	auto& binds = bindings->buttons.at(code);
 	for (size_t i=0; i<binds.size(); i++) {
 		Bind& bind = binds[i];
 		if (bind.device->isButtonDown(bind.a)) {
@@ -157,7 +175,7 @@ bool InputVirtual::isButtonDown(int code)
 
 void InputVirtual::clearButton(int code)
 {
-	auto& binds = buttons.at(code);
+	auto& binds = bindings->buttons.at(code);
 	for (size_t i=0; i<binds.size(); i++) {
 		Bind& bind = binds[i];
 		bind.device->clearButton(bind.a);
@@ -166,7 +184,7 @@ void InputVirtual::clearButton(int code)
 
 void InputVirtual::clearButtonPress(int code)
 {
-	auto& binds = buttons.at(code);
+	auto& binds = bindings->buttons.at(code);
 	for (size_t i=0; i<binds.size(); i++) {
 		Bind& bind = binds[i];
 		bind.device->clearButtonPress(bind.a);
@@ -175,7 +193,7 @@ void InputVirtual::clearButtonPress(int code)
 
 void InputVirtual::clearButtonRelease(int code)
 {
-	auto& binds = buttons.at(code);
+	auto& binds = bindings->buttons.at(code);
 	for (size_t i=0; i<binds.size(); i++) {
 		Bind& bind = binds[i];
 		bind.device->clearButtonRelease(bind.a);
@@ -184,7 +202,7 @@ void InputVirtual::clearButtonRelease(int code)
 
 float InputVirtual::getAxis(int n)
 {
-	auto& binds = axes.at(n).binds;
+	auto& binds = bindings->axes.at(n);
 	float value = 0;
 
 	for (size_t i=0; i<binds.size(); i++) {
@@ -211,7 +229,7 @@ void InputVirtual::bindButton(int n, spInputDevice device, int deviceN)
 	if (!lastDevice) {
 		setLastDevice(device.get());
 	}
-	buttons.at(n).push_back(Bind(device, deviceN, false));
+	bindings->bindButton(n, std::move(device), deviceN);
 }
 
 void InputVirtual::bindAxis(int n, spInputDevice device, int deviceN)
@@ -219,7 +237,7 @@ void InputVirtual::bindAxis(int n, spInputDevice device, int deviceN)
 	if (!lastDevice) {
 		setLastDevice(device.get());
 	}
-	axes.at(n).binds.push_back(Bind(device, deviceN, true));
+	bindings->bindAxis(n, std::move(device), deviceN);
 }
 
 void InputVirtual::bindAxisButton(int n, spInputDevice device, int negativeButton, int positiveButton)
@@ -227,7 +245,7 @@ void InputVirtual::bindAxisButton(int n, spInputDevice device, int negativeButto
 	if (!lastDevice) {
 		setLastDevice(device.get());
 	}
-	axes.at(n).binds.push_back(Bind(device, negativeButton, positiveButton, true));
+	bindings->bindAxisButton(n, std::move(device), negativeButton, positiveButton);
 }
 
 void InputVirtual::bindVibrationOverride(spInputDevice joy)
@@ -237,25 +255,36 @@ void InputVirtual::bindVibrationOverride(spInputDevice joy)
 
 void InputVirtual::unbindButton(int n)
 {
-	buttons.at(n).clear();
+	bindings->unbindButton(n);
+	cacheBindingsVersion = 0;
 }
 
 void InputVirtual::unbindAxis(int n)
 {
-	axes.at(n).binds.clear();
+	bindings->unbindAxis(n);
 }
 
 void InputVirtual::clearBindings()
 {
-	for (size_t i=0; i<buttons.size(); i++) {
-		buttons[i].clear();
-	}
-	for (size_t i=0; i<axes.size(); i++) {
-		axes[i].binds.clear();
-	}
+	bindings->clear();
+	cacheBindingsVersion = 0;
 	vibrationOverride = spInputDevice();
 }
 
+void InputVirtual::setBindings(std::shared_ptr<InputBindingTable> b)
+{
+	if (!b || b->getNumberButtons() != bindings->getNumberButtons() || b->getNumberAxes() != bindings->getNumberAxes()) {
+		throw Exception("Binding table doesn't match the virtual input's buttons and axes", HalleyExceptions::Input);
+	}
+	bindings = std::move(b);
+	cacheBindingsVersion = 0;
+}
+
+std::shared_ptr<InputBindingTable> InputVirtual::getBindings() const
+{
+	return bindings;
+}
+
 void InputVirtual::vibrate(spInputVibration vib)
 {
 	auto dev = vibrationOverride ? vibrationOverride.get() : lastDevice;
@@ -324,7 +353,7 @@ void InputVirtual::bindWheel(spInputDevice device)
 
 String InputVirtual::getButtonName(int code)
 {
-	auto& binds = buttons.at(code);
+	auto& binds = bindings->buttons.at(code);
 	if (binds.size() > 0) {
 		Bind& bind = binds[0];
 		return bind.device->getButtonName(bind.a);
@@ -336,6 +365,7 @@ String InputVirtual::getButtonName(int code)
 void InputVirtual::update(Time t)
 {
 	updateLastDevice();
+	updateButtonCache();
 
 	for (size_t i = 0; i < axes.size(); i++) {
 		auto& axis = axes[i];
@@ -391,7 +421,7 @@ InputDevice* InputVirtual::getLastDevice() const
 void InputVirtual::updateLastDevice()
 {
 	if (!lastDeviceFrozen) {
-		for (auto& buttonBinds: buttons) {
+		for (auto& buttonBinds: bindings->buttons) {
 			for (auto& bind: buttonBinds) {
 				if (bind.device && !std::dynamic_pointer_cast<InputManual>(bind.device)) {
 					if (!bind.isAxisEmulation && bind.device->isButtonPressed(bind.a)) {
@@ -401,8 +431,8 @@ void InputVirtual::updateLastDevice()
 				}
 			}
 		}
-		for (auto& axisBind: axes) {
-			for (auto& bind: axisBind.binds) {
+		for (auto& axisBinds: bindings->axes) {
+			for (auto& bind: axisBinds) {
 				if (bind.device && !std::dynamic_pointer_cast<InputManual>(bind.device)) {
 					if ((!bind.isAxisEmulation && fabs(bind.device->getAxis(bind.a)) > 0.1f)
 						|| (bind.isAxisEmulation && bind.device->isButtonDown(bind.a))
@@ -416,29 +446,6 @@ void InputVirtual::updateLastDevice()
 	}
 }
 
-InputVirtual::Bind::Bind(spInputDevice d, int n, bool axis)
-	: device(d)
-	, a(n)
-	, b(0)
-	, isAxis(axis)
-	, isAxisEmulation(false)
-{}
-
-InputVirtual::Bind::Bind(spInputDevice d, int _a, int _b, bool axis)
-	: device(d)
-	, a(_a)
-	, b(_b)
-	, isAxis(axis)
-	, isAxisEmulation(true)
-{}
-
-InputVirtual::AxisData::AxisData()
-{}
-
-InputVirtual::AxisData::AxisData(Vector<Bind>& b)
-	: binds(b)
-{}
-
 InputVirtual::PositionBindData::PositionBindData()
 {}
 
@@ -454,28 +461,6 @@ InputVirtual::PositionBindData::PositionBindData(spInputDevice device, int axisX
 	, speed(speed)
 {}
 
-std::set<spInputDevice> InputVirtual::getAllDevices() const
-{
-	std::set<spInputDevice> devices;
-
-	for (auto& axisBind: axes) {
-		for (auto& bind: axisBind.binds) {
-			if (bind.device) {
-				devices.insert(bind.device);
-			}
-		}
-	}
-	for (auto& buttonBinds: buttons) {
-		for (auto& bind: buttonBinds) {
-			if (bind.device) {
-				devices.insert(bind.device);
-			}
-		}
-	}
-
-	return devices;
-}
-
 void InputVirtual::setLastDeviceFreeze(bool frozen)
 {
 	lastDeviceFrozen = frozen;
@@ -505,3 +490,38 @@ void InputVirtual::setLastDevice(InputDevice* device)
 		lastDevice = device;
 	}
 }
+
+void InputVirtual::updateButtonCache()
+{
+	const size_t words = (bindings->buttons.size() + 63) / 64;
+	for (auto* bits: { &downBits, &pressedBits, &pressedRepeatBits, &releasedBits }) {
+		bits->assign(words, 0);
+	}
+
+	for (auto& device: bindings->getButtonsByDevice()) {
+		for (auto& b: device.buttons) {
+			const auto word = size_t(b.first) / 64;
+			const auto bit = uint64_t(1) << (b.first % 64);
+			downBits[word] |= device.device->isButtonDown(b.second) ? bit : 0;
+			pressedBits[word] |= device.device->isButtonPressed(b.second) ? bit : 0;
+			pressedRepeatBits[word] |= device.device->isButtonPressedRepeat(b.second) ? bit : 0;
+			releasedBits[word] |= device.device->isButtonReleased(b.second) ? bit : 0;
+		}
+	}
+
+	cacheGeneration = InputButtonBase::getStateGeneration();
+	cacheBindingsVersion = bindings->version;
+}
+
+bool InputVirtual::isCacheValid() const
+{
+	return cacheBindingsVersion == bindings->version && cacheGeneration == InputButtonBase::getStateGeneration();
+}
+
+bool InputVirtual::testBit(const Vector<uint64_t>& bits, int n) const
+{
+	if (n < 0 || size_t(n) >= bindings->buttons.size()) {
+		throw Exception("Invalid virtual button: " + toString(n), HalleyExceptions::Input);
+	}
+	return (bits[size_t(n) / 64] & (uint64_t(1) << (n % 64))) != 0;
+}
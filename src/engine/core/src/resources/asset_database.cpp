@@ -1,6 +1,12 @@
 #include "halley/core/resources/asset_database.h"
 #include "halley/bytes/byte_serializer.h"
 #include "halley/support/exception.h"
+#include "halley/resources/resource.h"
+#include "halley/text/string_converter.h"
+#include "halley/utils/hash.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
 #include <set>
 
 using namespace Halley;
@@ -24,35 +30,162 @@ void AssetDatabase::Entry::deserialize(Deserializer& s)
 	s >> meta;
 }
 
+namespace {
+	constexpr uint32_t flatVersion = 1;
+
+	struct FlatHeader {
+		std::array<char, 8> identifier;
+		uint32_t version;
+		uint32_t numTypes;
+	};
+
+	struct FlatTypeHeader {
+		int32_t type;
+		uint32_t numRecords;
+		uint64_t recordsPos;
+	};
+
+	struct FlatRecord {
+		uint64_t nameHash;
+		uint32_t namePos;
+		uint32_t nameLength;
+		uint32_t entryPos;
+		uint32_t entryLength;
+	};
+
+	constexpr const char* flatIdentifier = "HALLEYDB";
+
+	uint64_t hashName(const char* name, size_t length)
+	{
+		return Hash::hash(gsl::as_bytes(gsl::span<const char>(name, length)));
+	}
+
+	gsl::span<const gsl::byte> getRange(gsl::span<const gsl::byte> data, size_t pos, size_t length)
+	{
+		if (pos + length > size_t(data.size())) {
+			throw Exception("Asset database is invalid (truncated)", HalleyExceptions::Resources);
+		}
+		return data.subspan(ptrdiff_t(pos), ptrdiff_t(length));
+	}
+}
+
+AssetDatabase::TypedDB::TypedDB()
+	: mutex(std::make_unique<std::mutex>())
+{}
+
 void AssetDatabase::TypedDB::add(const String& name, Entry&& asset)
 {
+	std::unique_lock<std::mutex> lock(*mutex);
 	assets[name] = std::move(asset);
 }
 
 const AssetDatabase::Entry& AssetDatabase::TypedDB::get(const String& name) const
 {
+	std::unique_lock<std::mutex> lock(*mutex);
 	auto i = assets.find(name);
-	if (i == assets.end()) {
+	if (i != assets.end()) {
+		return i->second;
+	}
+
+	const size_t idx = findFlat(name);
+	if (idx == numFlatRecords) {
 		throw Exception("Asset not found: " + name, HalleyExceptions::Resources);
 	}
-	return i->second;
+	return assets[name] = decodeFlat(idx);
+}
+
+bool AssetDatabase::TypedDB::contains(const String& name) const
+{
+	std::unique_lock<std::mutex> lock(*mutex);
+	return assets.find(name) != assets.end() || findFlat(name) != numFlatRecords;
+}
+
+size_t AssetDatabase::TypedDB::size() const
+{
+	return getNames().size();
+}
+
+std::vector<String> AssetDatabase::TypedDB::getNames() const
+{
+	std::unique_lock<std::mutex> lock(*mutex);
+	std::vector<String> result;
+	result.reserve(assets.size() + numFlatRecords);
+	for (auto& a: assets) {
+		result.push_back(a.first);
+	}
+	for (size_t i = 0; i < numFlatRecords; ++i) {
+		auto name = getFlatName(i);
+		if (assets.find(name) == assets.end()) {
+			result.push_back(std::move(name));
+		}
+	}
+	return result;
 }
 
 void AssetDatabase::TypedDB::serialize(Serializer& s) const
 {
-	s << assets;
+	s << getAssets();
 }
 
 void AssetDatabase::TypedDB::deserialize(Deserializer& s)
 {
+	std::unique_lock<std::mutex> lock(*mutex);
 	s >> assets;
 }
 
 const HashMap<String, AssetDatabase::Entry>& AssetDatabase::TypedDB::getAssets() const
 {
+	std::unique_lock<std::mutex> lock(*mutex);
+	for (size_t i = 0; i < numFlatRecords; ++i) {
+		auto name = getFlatName(i);
+		if (assets.find(name) == assets.end()) {
+			assets[name] = decodeFlat(i);
+		}
+	}
 	return assets;
 }
 
+void AssetDatabase::TypedDB::setFlat(gsl::span<const gsl::byte> data, size_t recordsPos, size_t numRecords)
+{
+	getRange(data, recordsPos, numRecords * sizeof(FlatRecord));
+	flatData = data;
+	flatRecordsPos = recordsPos;
+	numFlatRecords = numRecords;
+}
+
+size_t AssetDatabase::TypedDB::findFlat(const String& name) const
+{
+	if (numFlatRecords == 0) {
+		return 0;
+	}
+
+	const auto hash = hashName(name.c_str(), name.length());
+	const auto* records = reinterpret_cast<const FlatRecord*>(flatData.data() + flatRecordsPos);
+	const auto* end = records + numFlatRecords;
+	for (auto* r = std::lower_bound(records, end, hash, [] (const FlatRecord& r, uint64_t h) { return r.nameHash < h; }); r != end && r->nameHash == hash; ++r) {
+		if (r->nameLength == name.length() && memcmp(getRange(flatData, r->namePos, r->nameLength).data(), name.c_str(), name.length()) == 0) {
+			return size_t(r - records);
+		}
+	}
+	return numFlatRecords;
+}
+
+String AssetDatabase::TypedDB::getFlatName(size_t idx) const
+{
+	const auto& r = reinterpret_cast<const FlatRecord*>(flatData.data() + flatRecordsPos)[idx];
+	const auto name = getRange(flatData, r.namePos, r.nameLength);
+	return String(reinterpret_cast<const char*>(name.data()), name.size());
+}
+
+AssetDatabase::Entry AssetDatabase::TypedDB::decodeFlat(size_t idx) const
+{
+	const auto& r = reinterpret_cast<const FlatRecord*>(flatData.data() + flatRecordsPos)[idx];
+	Entry entry;
+	Deserializer s(getRange(flatData, r.entryPos, r.entryLength));
+	s >> entry;
+	return entry;
+}
+
 void AssetDatabase::addAsset(const String& name, AssetType type, Entry&& entry)
 {
 	dbs[int(type)].add(name, std::move(entry));
@@ -60,7 +193,13 @@ void AssetDatabase::addAsset(const String& name, AssetType type, Entry&& entry)
 
 const AssetDatabase::TypedDB& AssetDatabase::getDatabase(AssetType type) const
 {
-	return dbs[int(type)];
+	// Not inserted, so this is safe to call from any thread
+	auto iter = dbs.find(int(type));
+	if (iter == dbs.end()) {
+		static const TypedDB empty;
+		return empty;
+	}
+	return iter->second;
 }
 
 std::vector<String> AssetDatabase::getAssets() const
@@ -68,8 +207,7 @@ std::vector<String> AssetDatabase::getAssets() const
 	std::set<String> contains;
 	std::vector<String> result;
 	for (auto& db: dbs) {
-		for (auto& asset: db.second.getAssets()) {
-			const String& name = asset.first;
+		for (auto& name: db.second.getNames()) {
 			if (contains.find(name) == contains.end()) {
 				contains.insert(name);
 				result.push_back(name);
@@ -80,6 +218,121 @@ std::vector<String> AssetDatabase::getAssets() const
 	return result;
 }
 
+std::vector<String> AssetDatabase::enumerate(AssetType type) const
+{
+	return getDatabase(type).getNames();
+}
+
+Bytes AssetDatabase::toBytes() const
+{
+	struct Record {
+		uint64_t hash;
+		String name;
+		Bytes entry;
+	};
+
+	std::vector<std::pair<int, std::vector<Record>>> types;
+	size_t tablesSize = sizeof(FlatHeader);
+	size_t blobSize = 0;
+	for (auto& db: dbs) {
+		std::vector<Record> records;
+		for (auto& asset: db.second.getAssets()) {
+			records.push_back(Record{ hashName(asset.first.c_str(), asset.first.length()), asset.first, Serializer::toBytes(asset.second) });
+			blobSize += asset.first.length() + records.back().entry.size();
+		}
+		if (records.empty()) {
+			continue;
+		}
+		std::sort(records.begin(), records.end(), [] (const Record& a, const Record& b)
+		{
+			return a.hash != b.hash ? a.hash < b.hash : a.name < b.name;
+		});
+		tablesSize += sizeof(FlatTypeHeader) + records.size() * sizeof(FlatRecord);
+		types.emplace_back(db.first, std::move(records));
+	}
+	if (tablesSize + blobSize > std::numeric_limits<uint32_t>::max()) {
+		throw Exception("Asset database is too large", HalleyExceptions::Resources);
+	}
+
+	Bytes result(tablesSize + blobSize);
+	auto write = [&] (size_t pos, const void* src, size_t size)
+	{
+		memcpy(result.data() + pos, src, size);
+	};
+
+	FlatHeader header;
+	memcpy(header.identifier.data(), flatIdentifier, header.identifier.size());
+	header.version = flatVersion;
+	header.numTypes = uint32_t(types.size());
+	write(0, &header, sizeof(header));
+
+	// Type headers, then every table, then the names and entries they point at
+	size_t typePos = sizeof(FlatHeader);
+	size_t recordPos = typePos + types.size() * sizeof(FlatTypeHeader);
+	size_t blobPos = tablesSize;
+	for (auto& type: types) {
+		const FlatTypeHeader typeHeader{ int32_t(type.first), uint32_t(type.second.size()), uint64_t(recordPos) };
+		write(typePos, &typeHeader, sizeof(typeHeader));
+		typePos += sizeof(typeHeader);
+
+		for (auto& r: type.second) {
+			FlatRecord record{ r.hash, uint32_t(blobPos), uint32_t(r.name.length()), 0, uint32_t(r.entry.size()) };
+			write(blobPos, r.name.c_str(), r.name.length());
+			blobPos += r.name.length();
+			record.entryPos = uint32_t(blobPos);
+			write(blobPos, r.entry.data(), r.entry.size());
+			blobPos += r.entry.size();
+
+			write(recordPos, &record, sizeof(record));
+			recordPos += sizeof(record);
+		}
+	}
+
+	return result;
+}
+
+void AssetDatabase::load(Bytes data)
+{
+	if (isFlat(gsl::as_bytes(gsl::span<const Byte>(data)))) {
+		ownedData = std::move(data);
+		loadFlat(gsl::as_bytes(gsl::span<const Byte>(ownedData)));
+	} else {
+		Deserializer s(data);
+		deserialize(s);
+	}
+}
+
+void AssetDatabase::load(gsl::span<const gsl::byte> data)
+{
+	// Records are read in place, so they need to be aligned
+	if (isFlat(data) && reinterpret_cast<uintptr_t>(data.data()) % alignof(FlatRecord) == 0) {
+		loadFlat(data);
+	} else {
+		load(Bytes(reinterpret_cast<const Byte*>(data.data()), reinterpret_cast<const Byte*>(data.data()) + data.size()));
+	}
+}
+
+bool AssetDatabase::isFlat(gsl::span<const gsl::byte> data)
+{
+	return size_t(data.size()) >= sizeof(FlatHeader) && memcmp(data.data(), flatIdentifier, 8) == 0;
+}
+
+void AssetDatabase::loadFlat(gsl::span<const gsl::byte> data)
+{
+	FlatHeader header;
+	memcpy(&header, data.data(), sizeof(header));
+	if (header.version != flatVersion) {
+		throw Exception("Asset database is invalid (unknown version " + toString(header.version) + ")", HalleyExceptions::Resources);
+	}
+
+	const auto types = getRange(data, sizeof(FlatHeader), header.numTypes * sizeof(FlatTypeHeader));
+	for (uint32_t i = 0; i < header.numTypes; ++i) {
+		FlatTypeHeader typeHeader;
+		memcpy(&typeHeader, types.data() + i * sizeof(FlatTypeHeader), sizeof(typeHeader));
+		dbs[typeHeader.type].setFlat(data, size_t(typeHeader.recordsPos), typeHeader.numRecords);
+	}
+}
+
 void AssetDatabase::serialize(Serializer& s) const
 {
 	s << dbs;
@@ -90,11 +343,30 @@ void AssetDatabase::deserialize(Deserializer& s)
 	s >> dbs;
 }
 
-std::vector<String> AssetDatabase::enumerate(AssetType type) const
+void AssetDatabase::addDependency(Metadata& meta, AssetType type, const String& name)
 {
-	std::vector<String> result;
-	for (auto& asset: getDatabase(type).getAssets()) {
-		result.push_back(asset.first);
+	if (name.isEmpty()) {
+		return;
+	}
+
+	const String dep = toString(type) + ":" + name;
+	const String cur = meta.getString("dependencies", "");
+	for (auto& d: cur.split(';')) {
+		if (d == dep) {
+			return;
+		}
+	}
+	meta.set("dependencies", cur.isEmpty() ? dep : cur + ";" + dep);
+}
+
+std::vector<std::pair<AssetType, String>> AssetDatabase::getDependencies(const Metadata& meta)
+{
+	std::vector<std::pair<AssetType, String>> result;
+	for (auto& d: meta.getString("dependencies", "").split(';')) {
+		const auto split = d.find(':');
+		if (split != String::npos) {
+			result.emplace_back(fromString<AssetType>(d.left(split)), d.mid(split + 1));
+		}
 	}
 	return result;
 }
@@ -1,10 +1,16 @@
 #include "resources/asset_pack.h"
 #include "resources/asset_database.h"
+#include "halley/resources/resource.h"
 #include "halley/resources/resource_data.h"
 #include "halley/bytes/byte_serializer.h"
 #include "halley/bytes/compression.h"
 #include "halley/maths/random.h"
 #include "halley/utils/encrypt.h"
+#include "halley/os/os.h"
+#include "halley/concurrency/concurrent.h"
+#include "halley/concurrency/executor.h"
+#include "halley/text/string_converter.h"
+#include "halley/support/profiler.h"
 
 using namespace Halley;
 
@@ -28,9 +34,10 @@ AssetPack::AssetPack(AssetPack&& other)
 	*this = std::move(other);
 }
 
-AssetPack::AssetPack(std::unique_ptr<ResourceDataReader> _reader, const String& encryptionKey, bool preLoad)
+AssetPack::AssetPack(std::unique_ptr<ResourceDataReader> _reader, const String& key, bool preLoad)
 	: reader(std::move(_reader))
 	, hasReader(true)
+	, encryptionKey(key)
 {
 	// Read header
 	size_t totalSize = reader->size();
@@ -45,8 +52,6 @@ AssetPack::AssetPack(std::unique_ptr<ResourceDataReader> _reader, const String&
 	if (memcmp(header.identifier.data(), "HALLEYPK", 8) != 0) {
 		throw Exception("Asset pack is invalid (invalid identifier)", HalleyExceptions::Resources);
 	}
-	iv = header.iv;
-	dataOffset = size_t(header.dataStartPos);
 
 	// Read asset database
 	{
@@ -56,13 +61,10 @@ AssetPack::AssetPack(std::unique_ptr<ResourceDataReader> _reader, const String&
 		if (nRead != int(assetDbBytes.size())) {
 			throw Exception("Unable to read header", HalleyExceptions::Resources);
 		}
-		assetDb = std::make_unique<AssetDatabase>();
-		Deserializer::fromBytes<AssetDatabase>(*assetDb, Compression::decompress(assetDbBytes));
+		readHeader(header, std::move(assetDbBytes));
 	}
 
-	std::array<char, 16> ivEmpty;
-	memset(ivEmpty.data(), 0, ivEmpty.size());
-	const bool hasCrypt = memcmp(iv.data(), ivEmpty.data(), iv.size()) != 0 && !encryptionKey.isEmpty();
+	const bool hasCrypt = isEncryptedAsAWhole();
 
 	if (preLoad || hasCrypt) {
 		readToMemory();
@@ -73,6 +75,72 @@ AssetPack::AssetPack(std::unique_ptr<ResourceDataReader> _reader, const String&
 	}
 }
 
+AssetPack::AssetPack(std::shared_ptr<MappedFile> _mapping, const String& key)
+	: hasReader(false)
+	, mapping(std::move(_mapping))
+	, encryptionKey(key)
+{
+	const auto bytes = mapping->getSpan();
+	if (size_t(bytes.size()) < sizeof(AssetPackHeader)) {
+		throw Exception("Asset pack is invalid (too small)", HalleyExceptions::Resources);
+	}
+	AssetPackHeader header;
+	memcpy(&header, bytes.data(), sizeof(header));
+	if (memcmp(header.identifier.data(), "HALLEYPK", 8) != 0) {
+		throw Exception("Asset pack is invalid (invalid identifier)", HalleyExceptions::Resources);
+	}
+	if (header.assetDbStartPos > header.dataStartPos || header.dataStartPos > uint64_t(bytes.size())) {
+		throw Exception("Asset pack is invalid (truncated)", HalleyExceptions::Resources);
+	}
+	const auto assetDbBytes = bytes.subspan(ptrdiff_t(header.assetDbStartPos), ptrdiff_t(header.dataStartPos - header.assetDbStartPos));
+	if (AssetDatabase::isFlat(assetDbBytes)) {
+		// Looked up in place, so it stays mapped even if the data gets read into memory
+		assetDbMapping = mapping;
+	}
+	readHeader(header, assetDbBytes);
+	mappedData = bytes.subspan(ptrdiff_t(dataOffset));
+
+	if (isEncryptedAsAWhole()) {
+		// Has to be decrypted as a whole, so the mapping doesn't help
+		readToMemory();
+		decrypt(encryptionKey);
+	}
+}
+
+void AssetPack::readHeader(const AssetPackHeader& header, gsl::span<const gsl::byte> assetDbBytes)
+{
+	iv = header.iv;
+	dataOffset = size_t(header.dataStartPos);
+	assetDb = std::make_unique<AssetDatabase>();
+
+	// Flat databases are looked up in place, in the mapping; older packs had theirs compressed
+	if (AssetDatabase::isFlat(assetDbBytes)) {
+		assetDb->load(assetDbBytes);
+	} else {
+		assetDb->load(Compression::decompress(assetDbBytes));
+	}
+}
+
+void AssetPack::readHeader(const AssetPackHeader& header, Bytes assetDbBytes)
+{
+	iv = header.iv;
+	dataOffset = size_t(header.dataStartPos);
+	assetDb = std::make_unique<AssetDatabase>();
+
+	if (AssetDatabase::isFlat(gsl::as_bytes(gsl::span<const Byte>(assetDbBytes)))) {
+		assetDb->load(std::move(assetDbBytes));
+	} else {
+		assetDb->load(Compression::decompress(assetDbBytes));
+	}
+}
+
+bool AssetPack::isEncryptedAsAWhole() const
+{
+	std::array<char, 16> ivEmpty;
+	memset(ivEmpty.data(), 0, ivEmpty.size());
+	return memcmp(iv.data(), ivEmpty.data(), iv.size()) != 0 && !encryptionKey.isEmpty();
+}
+
 AssetPack::~AssetPack()
 {
 }
@@ -85,10 +153,16 @@ AssetPack& AssetPack::operator=(AssetPack&& other)
 	dataOffset = other.dataOffset;
 	reader = std::move(other.reader);
 	data = std::move(other.data);
+	mapping = std::move(other.mapping);
+	assetDbMapping = std::move(other.assetDbMapping);
+	mappedData = other.mappedData;
+	iv = other.iv;
+	encryptionKey = std::move(other.encryptionKey);
 	hasReader = !!reader;
 
 	other.hasReader = false;
 	other.reader.reset();
+	other.mappedData = {};
 
 	return *this;
 }
@@ -115,29 +189,91 @@ const Bytes& AssetPack::getData() const
 
 Bytes AssetPack::writeOut() const
 {
-	auto assetDbBytes = Compression::compress(Serializer::toBytes(*assetDb));
+	auto result = writeOutHeader();
+	const size_t dataStart = result.size();
+	result.resize(dataStart + data.size());
+	memcpy(result.data() + dataStart, data.data(), data.size());
+	return result;
+}
+
+Bytes AssetPack::writeOutHeader() const
+{
+	// Left uncompressed, so it can be used straight from a memory mapping
+	auto assetDbBytes = assetDb->toBytes();
 	AssetPackHeader header;
 	header.init(assetDbBytes.size());
 	header.iv = iv;
 
-	auto result = Bytes(size_t(header.dataStartPos + data.size()));
+	auto result = Bytes(size_t(header.dataStartPos));
 	memcpy(result.data(), &header, sizeof(AssetPackHeader));
 	memcpy(result.data() + header.assetDbStartPos, assetDbBytes.data(), assetDbBytes.size());
-	memcpy(result.data() + header.dataStartPos, data.data(), data.size());
 	return result;
 }
 
 std::unique_ptr<ResourceData> AssetPack::getData(const String& asset, AssetType type, bool stream)
 {
 	auto path = asset;
-	auto ps = assetDb->getDatabase(type).get(asset).path.split(':');
-	size_t pos = size_t(ps.at(0).toInteger());
-	size_t size = size_t(ps.at(1).toInteger());
+	const auto& entryPath = assetDb->getDatabase(type).get(asset).path;
+	AssetType sourceType;
+	String sourceName;
+	if (getSharedSource(entryPath, sourceType, sourceName)) {
+		throw Exception("Asset \"" + asset + "\" is stored in another pack, as \"" + sourceName + "\".", HalleyExceptions::Resources);
+	}
+	auto ps = entryPath.split(':');
+	size_t pos = size_t(ps.at(0).toInteger64());
+	size_t size = size_t(ps.at(1).toInteger64());
+
+	if (ps.size() >= 4) {
+		// Chunked, as pos:size:storedSize:flags
+		const size_t storedSize = size_t(ps[2].toInteger64());
+		const bool encrypted = ps[3].contains("e");
+		auto table = std::make_shared<const AssetPackChunkTable>(readChunkTable(asset, pos, storedSize, size, encrypted));
+
+		if (stream) {
+			return std::make_unique<ResourceDataStream>(path, [=] () -> std::unique_ptr<ResourceDataReader> {
+				return std::make_unique<ChunkedPackDataReader>(*this, table);
+			});
+		}
+
+		auto loadTiming = ResourceLoadTiming::getCurrent();
+		AssetPackChunkTiming chunkTiming;
+		const auto startTime = loadTiming ? Profiler::getTimeNs() : 0;
+
+		auto result = new char[size];
+		try {
+			Concurrent::parallelFor(Executors::getCPUAux(), Range<size_t>(0, table->getNumChunks()), 1, [&] (size_t start, size_t end)
+			{
+				for (size_t i = start; i < end; ++i) {
+					readChunk(*table, i, gsl::as_writeable_bytes(gsl::span<char>(result + i * chunkSize, table->getChunkSize(i))), loadTiming ? &chunkTiming : nullptr);
+				}
+			});
+
+			// Reads and unpacking overlap across chunks, so the time waited is split in proportion
+			if (loadTiming) {
+				const double total = double(chunkTiming.read.load() + chunkTiming.unpack.load());
+				if (total > 0) {
+					loadTiming->unpack += int64_t(double(Profiler::getTimeNs() - startTime) * double(chunkTiming.unpack.load()) / total);
+				}
+			}
+			return std::make_unique<ResourceDataStatic>(result, size, path, true);
+		} catch (...) {
+			delete[] result;
+			throw;
+		}
+	}
 
 	if (stream) {
 		return std::make_unique<ResourceDataStream>(path, [=] () -> std::unique_ptr<ResourceDataReader> {
 			return std::make_unique<PackDataReader>(*this, pos, size);
 		});
+	} else if (mapping) {
+		if (pos + size > size_t(mappedData.size())) {
+			throw Exception("Asset \"" + asset + "\" is out of pack bounds.", HalleyExceptions::Resources);
+		}
+
+		// Shares ownership of the mapping, so it outlives the pack if it has to
+		const auto start = reinterpret_cast<const char*>(mappedData.data()) + pos;
+		return std::make_unique<ResourceDataStatic>(std::shared_ptr<const char>(mapping, start), size, path);
 	} else {
 		if (hasReader) {
 			auto result = new char[size];
@@ -159,8 +295,222 @@ std::unique_ptr<ResourceData> AssetPack::getData(const String& asset, AssetType
 	}
 }
 
+void AssetPack::addAsset(const String& name, AssetType type, gsl::span<const gsl::byte> asset, const Metadata& meta, const String& key)
+{
+	const auto encoded = encodeAsset(asset, key);
+	const size_t pos = data.size();
+	data.reserve(nextPowerOf2(pos + encoded.data.size()));
+	data.resize(pos + encoded.data.size());
+	memcpy(data.data() + pos, encoded.data.data(), encoded.data.size());
+	addEncodedAsset(name, type, pos, encoded, meta);
+}
+
+AssetPackEncodedAsset AssetPack::encodeAsset(gsl::span<const gsl::byte> asset, const String& key)
+{
+	const size_t size = size_t(asset.size());
+	const size_t numChunks = (size + chunkSize - 1) / chunkSize;
+	const bool encrypted = !key.isEmpty();
+
+	// Every chunk gets its own IV, stored in front of it. Generated up front, as the generator isn't thread-safe.
+	Vector<Bytes> chunkIvs(encrypted ? numChunks : 0);
+	for (auto& chunkIv: chunkIvs) {
+		chunkIv.resize(16);
+		Random::getGlobal().getBytes(gsl::as_writeable_bytes(gsl::span<Byte>(chunkIv)));
+	}
+
+	Vector<Bytes> chunks(numChunks);
+	Vector<char> compressed(numChunks, 0);
+	Concurrent::parallelFor(Executors::getCPUAux(), Range<size_t>(0, numChunks), 1, [&] (size_t start, size_t end)
+	{
+		for (size_t i = start; i < end; ++i) {
+			const auto src = asset.subspan(ptrdiff_t(i * chunkSize), ptrdiff_t(std::min(size_t(chunkSize), size - i * chunkSize)));
+
+			// Only worth decompressing if it saves a decent amount
+			try {
+				auto result = Compression::compressRaw(src, false);
+				if (result.size() <= size_t(src.size()) - size_t(src.size()) / 8) {
+					chunks[i] = std::move(result);
+					compressed[i] = 1;
+				}
+			} catch (Exception&) {
+				// Didn't fit in the space compressRaw allows, so it doesn't compress
+			}
+			if (!compressed[i]) {
+				chunks[i] = Bytes(size_t(src.size()));
+				memcpy(chunks[i].data(), src.data(), chunks[i].size());
+			}
+
+			if (encrypted) {
+				auto cipher = Encrypt::encrypt(chunkIvs[i], key, chunks[i]);
+				chunkIvs[i].insert(chunkIvs[i].end(), cipher.begin(), cipher.end());
+				chunks[i] = std::move(chunkIvs[i]);
+			}
+		}
+	});
+	const bool anyCompressed = std::find(compressed.begin(), compressed.end(), 1) != compressed.end();
+
+	AssetPackEncodedAsset result;
+	result.size = size;
+	if (!encrypted && !anyCompressed) {
+		// Stored as-is, so it can be handed out straight from the pack
+		result.data.resize(size);
+		memcpy(result.data.data(), asset.data(), size);
+		return result;
+	}
+
+	// The chunk table is the number of chunks, then each one's stored size, with the top bit set if it's compressed
+	Vector<uint32_t> header;
+	header.push_back(uint32_t(numChunks));
+	for (size_t i = 0; i < numChunks; ++i) {
+		header.push_back(uint32_t(chunks[i].size()) | (compressed[i] ? 0x80000000u : 0u));
+	}
+
+	size_t storedSize = header.size() * sizeof(uint32_t);
+	for (auto& c: chunks) {
+		storedSize += c.size();
+	}
+	result.data.resize(storedSize);
+	memcpy(result.data.data(), header.data(), header.size() * sizeof(uint32_t));
+	size_t writePos = header.size() * sizeof(uint32_t);
+	for (auto& c: chunks) {
+		memcpy(result.data.data() + writePos, c.data(), c.size());
+		writePos += c.size();
+	}
+
+	result.flags = String(anyCompressed ? "z" : "") + (encrypted ? "e" : "");
+	return result;
+}
+
+void AssetPack::addEncodedAsset(const String& name, AssetType type, size_t pos, const AssetPackEncodedAsset& asset, const Metadata& meta)
+{
+	if (asset.flags.isEmpty()) {
+		assetDb->addAsset(name, type, AssetDatabase::Entry(toString(pos) + ":" + toString(asset.size), meta));
+	} else {
+		assetDb->addAsset(name, type, AssetDatabase::Entry(toString(pos) + ":" + toString(asset.size) + ":" + toString(asset.data.size()) + ":" + asset.flags, meta));
+	}
+}
+
+void AssetPack::addAssetAlias(const String& name, AssetType type, const String& existingName, AssetType existingType, const Metadata& meta)
+{
+	const auto& existing = assetDb->getDatabase(existingType).get(existingName);
+	assetDb->addAsset(name, type, AssetDatabase::Entry(existing.path, meta));
+}
+
+void AssetPack::addSharedAsset(const String& name, AssetType type, const String& sourceName, AssetType sourceType, const Metadata& meta)
+{
+	// Stored as "=type:name", which can't be mistaken for a position
+	assetDb->addAsset(name, type, AssetDatabase::Entry("=" + toString(sourceType) + ":" + sourceName, meta));
+}
+
+bool AssetPack::getSharedSource(const String& entryPath, AssetType& sourceType, String& sourceName)
+{
+	if (!entryPath.startsWith("=")) {
+		return false;
+	}
+	const auto split = entryPath.find(':');
+	if (split == String::npos) {
+		throw Exception("Invalid shared asset entry: \"" + entryPath + "\"", HalleyExceptions::Resources);
+	}
+	sourceType = fromString<AssetType>(entryPath.substr(1, split - 1));
+	sourceName = entryPath.mid(split + 1);
+	return true;
+}
+
+AssetPackChunkTable AssetPack::readChunkTable(const String& asset, size_t pos, size_t storedSize, size_t size, bool encrypted)
+{
+	if (encrypted && encryptionKey.isEmpty()) {
+		throw Exception("Asset \"" + asset + "\" is encrypted, but the pack was opened without a key.", HalleyExceptions::Resources);
+	}
+
+	uint32_t numChunks = 0;
+	readData(pos, gsl::as_writeable_bytes(gsl::span<uint32_t>(&numChunks, 1)));
+	if (numChunks != (size + chunkSize - 1) / chunkSize) {
+		throw Exception("Asset \"" + asset + "\" has an invalid chunk table.", HalleyExceptions::Resources);
+	}
+	Vector<uint32_t> sizes(numChunks);
+	readData(pos + sizeof(uint32_t), gsl::as_writeable_bytes(gsl::span<uint32_t>(sizes)));
+
+	AssetPackChunkTable table;
+	table.asset = asset;
+	table.size = size;
+	table.encrypted = encrypted;
+	table.offsets.resize(numChunks + 1);
+	table.compressed.resize(numChunks);
+	table.offsets[0] = pos + (numChunks + 1) * sizeof(uint32_t);
+	for (size_t i = 0; i < numChunks; ++i) {
+		table.compressed[i] = (sizes[i] & 0x80000000u) != 0;
+		table.offsets[i + 1] = table.offsets[i] + (sizes[i] & 0x7FFFFFFFu);
+	}
+	if (table.offsets.back() != pos + storedSize) {
+		throw Exception("Asset \"" + asset + "\" has an invalid chunk table.", HalleyExceptions::Resources);
+	}
+	return table;
+}
+
+void AssetPack::readChunk(const AssetPackChunkTable& table, size_t chunk, gsl::span<gsl::byte> dst, AssetPackChunkTiming* timing)
+{
+	Expects(chunk < table.getNumChunks());
+	Expects(size_t(dst.size()) == table.getChunkSize(chunk));
+
+	const auto startTime = timing ? Profiler::getTimeNs() : 0;
+	const size_t storedPos = table.offsets[chunk];
+	const size_t storedSize = table.offsets[chunk + 1] - storedPos;
+
+	// Unless it needs decrypting, mapped data is decoded straight out of the mapping, without copying it first
+	const bool inPlace = mapping && !table.encrypted;
+	Bytes stored;
+	gsl::span<const gsl::byte> storedSpan;
+	if (inPlace) {
+		if (storedPos + storedSize > size_t(mappedData.size())) {
+			throw Exception("Asset data is out of pack bounds.", HalleyExceptions::Resources);
+		}
+		storedSpan = mappedData.subspan(ptrdiff_t(storedPos), ptrdiff_t(storedSize));
+	} else {
+		stored.resize(storedSize);
+		readData(storedPos, gsl::as_writeable_bytes(gsl::span<Byte>(stored)));
+	}
+	const auto readTime = timing ? Profiler::getTimeNs() : 0;
+
+	if (!inPlace) {
+		if (table.encrypted) {
+			if (stored.size() < iv.size()) {
+				throw Exception("Asset \"" + table.asset + "\" has an invalid chunk.", HalleyExceptions::Resources);
+			}
+			const Bytes chunkIv(stored.begin(), stored.begin() + iv.size());
+			stored = Encrypt::decrypt(chunkIv, encryptionKey, Bytes(stored.begin() + iv.size(), stored.end()));
+		}
+		storedSpan = gsl::as_bytes(gsl::span<const Byte>(stored));
+	}
+
+	if (table.compressed[chunk]) {
+		try {
+			Compression::decompressRawInto(storedSpan, dst);
+		} catch (Exception& e) {
+			throw Exception("Asset \"" + table.asset + "\" has an invalid chunk: " + e.what(), HalleyExceptions::Resources);
+		}
+	} else {
+		if (size_t(storedSpan.size()) != size_t(dst.size())) {
+			throw Exception("Asset \"" + table.asset + "\" has a chunk of the wrong size.", HalleyExceptions::Resources);
+		}
+		memcpy(dst.data(), storedSpan.data(), storedSpan.size());
+	}
+
+	if (timing) {
+		timing->read += readTime - startTime;
+		timing->unpack += Profiler::getTimeNs() - readTime;
+	}
+}
+
 void AssetPack::readToMemory()
 {
+	if (mapping) {
+		data = Bytes(size_t(mappedData.size()));
+		memcpy(data.data(), mappedData.data(), data.size());
+		mappedData = {};
+		mapping.reset();
+		return;
+	}
+
 	std::unique_lock<std::mutex> lock(readerMutex);
 	reader->seek(dataOffset, SEEK_SET);
 	data = reader->readAll();
@@ -183,11 +533,24 @@ void AssetPack::decrypt(const String& key)
 	Bytes ivBytes(iv.size());
 	memcpy(ivBytes.data(), iv.data(), iv.size());
 
-	data = Encrypt::decrypt(ivBytes, key, data);
+	// Whole packs can be large; chunks are decrypted serially, since they're already loaded in parallel
+	if (Executors::hasInstance()) {
+		data = Encrypt::decrypt(ivBytes, key, data, Executors::getCPU());
+	} else {
+		data = Encrypt::decrypt(ivBytes, key, data);
+	}
 }
 
 void AssetPack::readData(size_t pos, gsl::span<gsl::byte> dst)
 {
+	if (mapping) {
+		if (pos + size_t(dst.size()) > size_t(mappedData.size())) {
+			throw Exception("Asset data is out of pack bounds.", HalleyExceptions::Resources);
+		}
+		memcpy(dst.data(), mappedData.data() + pos, dst.size());
+		return;
+	}
+
 	if (hasReader) {
 		std::unique_lock<std::mutex> lock(readerMutex);
 		if (reader) {
@@ -225,7 +588,6 @@ size_t PackDataReader::size() const
 
 int PackDataReader::read(gsl::span<gsl::byte> dst)
 {
-	std::unique_lock<std::mutex> lock(mutex);
 	size_t available = fileSize - curPos;
 	size_t toRead = std::min(available, size_t(dst.size()));
 
@@ -237,7 +599,6 @@ int PackDataReader::read(gsl::span<gsl::byte> dst)
 
 void PackDataReader::seek(int64_t pos, int whence)
 {
-	std::unique_lock<std::mutex> lock(mutex);
 	switch (whence) {
 	case SEEK_SET:
 		curPos = size_t(pos);
@@ -253,7 +614,6 @@ void PackDataReader::seek(int64_t pos, int whence)
 
 size_t PackDataReader::tell() const
 {
-	std::unique_lock<std::mutex> lock(mutex);
 	return curPos;
 }
 
@@ -261,3 +621,69 @@ void PackDataReader::close()
 {
 }
 
+
+size_t AssetPackChunkTable::getNumChunks() const
+{
+	return compressed.size();
+}
+
+size_t AssetPackChunkTable::getChunkSize(size_t chunk) const
+{
+	return std::min(size_t(AssetPack::chunkSize), size - chunk * AssetPack::chunkSize);
+}
+
+ChunkedPackDataReader::ChunkedPackDataReader(AssetPack& pack, std::shared_ptr<const AssetPackChunkTable> table)
+	: pack(pack)
+	, table(std::move(table))
+{
+}
+
+size_t ChunkedPackDataReader::size() const
+{
+	return table->size;
+}
+
+int ChunkedPackDataReader::read(gsl::span<gsl::byte> dst)
+{
+	const size_t toRead = std::min(table->size - std::min(curPos, table->size), size_t(dst.size()));
+	size_t written = 0;
+	while (written < toRead) {
+		const size_t chunk = curPos / AssetPack::chunkSize;
+		if (chunk != curChunk) {
+			chunkData.resize(table->getChunkSize(chunk));
+			pack.readChunk(*table, chunk, gsl::as_writeable_bytes(gsl::span<Byte>(chunkData)));
+			curChunk = chunk;
+		}
+
+		const size_t offset = curPos - chunk * AssetPack::chunkSize;
+		const size_t n = std::min(chunkData.size() - offset, toRead - written);
+		memcpy(dst.data() + written, chunkData.data() + offset, n);
+		written += n;
+		curPos += n;
+	}
+	return int(written);
+}
+
+void ChunkedPackDataReader::seek(int64_t pos, int whence)
+{
+	switch (whence) {
+	case SEEK_SET:
+		curPos = size_t(pos);
+		break;
+	case SEEK_CUR:
+		curPos = size_t(curPos + pos);
+		break;
+	case SEEK_END:
+		curPos = size_t(table->size + pos);
+		break;
+	}
+}
+
+size_t ChunkedPackDataReader::tell() const
+{
+	return curPos;
+}
+
+void ChunkedPackDataReader::close()
+{
+}
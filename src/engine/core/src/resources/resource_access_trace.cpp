@@ -0,0 +1,77 @@
+#include "resources/resource_access_trace.h"
+#include <halley/resources/resource.h>
+#include "halley/text/string_converter.h"
+#include <cstring>
+#include <set>
+
+using namespace Halley;
+
+ResourceAccessTrace::ResourceAccessTrace()
+	: start(std::chrono::steady_clock::now())
+	, section("startup")
+{}
+
+ResourceAccessTrace::ResourceAccessTrace(const Bytes& data)
+	: ResourceAccessTrace()
+{
+	const auto str = String(reinterpret_cast<const char*>(data.data()), data.size());
+	for (auto& line: str.split('\n')) {
+		auto fields = line.trimBoth().split('\t');
+		if (fields.size() == 3) {
+			add(Entry{ fields[0].toFloat(), fields[1], fields[2] });
+		}
+	}
+}
+
+void ResourceAccessTrace::setSection(const String& s)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	section = s;
+}
+
+void ResourceAccessTrace::record(const String& asset, AssetType type)
+{
+	const double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	add(Entry{ time, section, toString(type) + ":" + asset });
+}
+
+std::vector<ResourceAccessTrace::Entry> ResourceAccessTrace::getEntries() const
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	return entries;
+}
+
+std::vector<String> ResourceAccessTrace::getSections() const
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	std::vector<String> result;
+	std::set<String> found;
+	for (auto& e: entries) {
+		if (found.insert(e.section).second) {
+			result.push_back(e.section);
+		}
+	}
+	return result;
+}
+
+Bytes ResourceAccessTrace::toBytes() const
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	String result;
+	for (auto& e: entries) {
+		result += toString(e.time, 3) + "\t" + e.section + "\t" + e.asset + "\n";
+	}
+
+	Bytes bytes(result.size());
+	memcpy(bytes.data(), result.c_str(), result.size());
+	return bytes;
+}
+
+void ResourceAccessTrace::add(Entry entry)
+{
+	if (seen.insert(entry.section + ":" + entry.asset).second) {
+		entries.push_back(std::move(entry));
+	}
+}
@@ -1,11 +1,44 @@
 #include "resources/resource_collection.h"
 #include "resources/resource_locator.h"
 #include "resources/resources.h"
+#include "resource_load_queue.h"
+#include "resources/resource_load_trace.h"
 #include <halley/resources/resource.h>
 #include "halley/support/logger.h"
+#include "halley/support/profiler.h"
+#include "halley/support/memory_tracker.h"
+#include <algorithm>
 
 using namespace Halley;
 
+namespace {
+	// Time spent in loads started from within the one in progress on this thread, e.g. a material loading its shaders
+	thread_local int64_t nestedLoadTime = 0;
+
+	class NestedLoadTimer {
+	public:
+		NestedLoadTimer()
+			: start(Profiler::getTimeNs())
+			, outer(nestedLoadTime)
+		{
+			nestedLoadTime = 0;
+		}
+
+		~NestedLoadTimer()
+		{
+			nestedLoadTime = outer + (Profiler::getTimeNs() - start);
+		}
+
+		int64_t getOwnTime() const
+		{
+			return Profiler::getTimeNs() - start - nestedLoadTime;
+		}
+
+	private:
+		int64_t start;
+		int64_t outer;
+	};
+}
 
 ResourceCollectionBase::ResourceCollectionBase(Resources& parent, AssetType type)
 	: parent(parent)
@@ -38,13 +71,24 @@ void ResourceCollectionBase::unloadAll(int minDepth)
 	}
 }
 
-void ResourceCollectionBase::reload(const String& assetId)
+void ResourceCollectionBase::reload(const String& assetId, std::unique_ptr<ResourceDataStatic> prefetched)
 {
 	auto res = resources.find(assetId);
 	if (res != resources.end()) {
 		auto& resWrap = res->second;
 		try {
-			std::shared_ptr<Resource> newAsset = loadAsset(assetId, ResourceLoadPriority::High);
+			// Applying just what changed keeps whatever was built from the old version valid
+			if (!resourceLoader) {
+				auto resLoader = ResourceLoader(*(parent.locator), assetId, type, ResourceLoadPriority::High, parent.api);
+				resLoader.prefetched = std::move(prefetched);
+				if (updateInPlace(*resWrap.res, resLoader)) {
+					resWrap.res->onUpdatedInPlace(resLoader.getMeta());
+					return;
+				}
+				prefetched = std::move(resLoader.prefetched);
+			}
+
+			std::shared_ptr<Resource> newAsset = loadAsset(assetId, ResourceLoadPriority::High, std::move(prefetched));
 			newAsset->setAssetId(assetId);
 			newAsset->onLoaded(parent);
 			resWrap.res->reloadResource(std::move(*newAsset));
@@ -68,7 +112,14 @@ std::vector<String> ResourceCollectionBase::enumerate() const
 	return parent.locator->enumerate(type);
 }
 
-std::shared_ptr<Resource> ResourceCollectionBase::loadAsset(const String& assetId, ResourceLoadPriority priority) {
+std::shared_ptr<Resource> ResourceCollectionBase::loadAsset(const String& assetId, ResourceLoadPriority priority, std::unique_ptr<ResourceDataStatic> prefetched, std::shared_ptr<ResourceLoadTiming> timing) {
+	Profiler::Scope profile(Profiler::isEnabled() ? Profiler::internName(assetId) : "", ProfilerEventType::ResourceLoad);
+	MemoryTagScope memoryTag(type);
+	if (!timing && parent.loadTrace) {
+		timing = parent.loadTrace->start(assetId, type, false);
+	}
+	NestedLoadTimer timer;
+	int64_t readTime = 0;
 	std::shared_ptr<Resource> newRes;
 
 	if (resourceLoader) {
@@ -77,7 +128,10 @@ std::shared_ptr<Resource> ResourceCollectionBase::loadAsset(const String& assetI
 	} else {
 		// Normal loading
 		auto resLoader = ResourceLoader(*(parent.locator), assetId, type, priority, parent.api);
+		resLoader.prefetched = std::move(prefetched);
+		resLoader.timing = timing;
 		newRes = loadResource(resLoader);
+		readTime = resLoader.syncReadTime;
 		if (!newRes && resLoader.loaded) {
 			throw Exception("Unable to construct resource from data: " + assetId, HalleyExceptions::Resources);
 		}
@@ -86,6 +140,9 @@ std::shared_ptr<Resource> ResourceCollectionBase::loadAsset(const String& assetI
 	if (!newRes) {
 		throw Exception("Unable to load resource data: " + assetId, HalleyExceptions::Resources);
 	}
+	if (timing) {
+		timing->decode += timer.getOwnTime() - readTime;
+	}
 	return newRes;
 }
 
@@ -94,15 +151,41 @@ std::shared_ptr<Resource> ResourceCollectionBase::doGet(const String& assetId, R
 	// Look in cache and return if it's there
 	auto res = resources.find(assetId);
 	if (res != resources.end()) {
+		res->second.lastUsed = parent.frame;
 		return res->second.res;
 	}
 	
-	// Load resource from disk
-	std::shared_ptr<Resource> newRes = loadAsset(assetId, priority);
+	// Load resource from disk, and store in cache
+	return store(assetId, loadAsset(assetId, priority));
+}
+
+void ResourceCollectionBase::doGetAsync(const String& assetId, ResourceLoadPriority priority, ResourceLoadWaiter waiter)
+{
+	auto res = resources.find(assetId);
+	if (res != resources.end()) {
+		res->second.lastUsed = parent.frame;
+		waiter.deliver(res->second.res);
+		return;
+	}
+
+	parent.loadQueue->enqueue(*this, assetId, priority, std::move(waiter));
+}
+
+std::shared_ptr<Resource> ResourceCollectionBase::finishAsyncLoad(const String& assetId, ResourceLoadPriority priority, std::unique_ptr<ResourceDataStatic> prefetched, std::shared_ptr<ResourceLoadTiming> timing)
+{
+	// Something may have loaded it synchronously in the meantime
+	auto res = resources.find(assetId);
+	if (res != resources.end()) {
+		return res->second.res;
+	}
 
-	// Store in cache
+	return store(assetId, loadAsset(assetId, priority, std::move(prefetched), std::move(timing)));
+}
+
+std::shared_ptr<Resource> ResourceCollectionBase::store(const String& assetId, std::shared_ptr<Resource> newRes)
+{
 	newRes->setAssetId(assetId);
-	resources.emplace(assetId, Wrapper(newRes, 0));
+	resources.emplace(assetId, Wrapper(newRes, 0, parent.frame, true));
 	newRes->onLoaded(parent);
 
 	return newRes;
@@ -127,3 +210,74 @@ void ResourceCollectionBase::setResourceLoader(ResourceLoaderFunc loader)
 {
 	resourceLoader = loader;
 }
+
+void ResourceCollectionBase::setMemoryBudget(size_t bytes)
+{
+	memoryBudget = bytes;
+}
+
+size_t ResourceCollectionBase::getMemoryBudget() const
+{
+	return memoryBudget;
+}
+
+size_t ResourceCollectionBase::getMemoryUsage() const
+{
+	size_t total = 0;
+	for (auto& r: resources) {
+		total += r.second.res->getMemoryUsage();
+	}
+	return total;
+}
+
+void ResourceCollectionBase::enforceMemoryBudget()
+{
+	if (memoryBudget == 0) {
+		return;
+	}
+	size_t total = getMemoryUsage();
+	if (total <= memoryBudget) {
+		return;
+	}
+
+	// Least recently used first, leaving alone anything asked for in the last frame
+	Vector<std::pair<const String*, Wrapper*>> candidates;
+	for (auto& r: resources) {
+		if (r.second.lastUsed + 1 < parent.frame) {
+			candidates.emplace_back(&r.first, &r.second);
+		}
+	}
+	std::sort(candidates.begin(), candidates.end(), [] (const std::pair<const String*, Wrapper*>& a, const std::pair<const String*, Wrapper*>& b)
+	{
+		return a.second->lastUsed < b.second->lastUsed;
+	});
+
+	// Cheaper representations first, since those don't need reloading
+	for (auto& c: candidates) {
+		if (total <= memoryBudget) {
+			return;
+		}
+		auto& res = *c.second->res;
+		const size_t before = res.getMemoryUsage();
+		if (res.reduceMemoryUsage()) {
+			const size_t after = res.getMemoryUsage();
+			total -= std::min(total, before - std::min(before, after));
+		}
+	}
+
+	// Then unload whatever only the cache holds on to; anything still in use would just stop being shared
+	std::vector<String> evicted;
+	for (auto& c: candidates) {
+		if (total <= memoryBudget) {
+			break;
+		}
+		auto& wrapper = *c.second;
+		if (wrapper.evictable && wrapper.res.use_count() == 1) {
+			total -= std::min(total, wrapper.res->getMemoryUsage());
+			evicted.push_back(*c.first);
+		}
+	}
+	for (auto& assetId: evicted) {
+		resources.erase(assetId);
+	}
+}
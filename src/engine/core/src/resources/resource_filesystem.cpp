@@ -59,7 +59,7 @@ void FileSystemResourceLocator::loadAssetDb()
 		throw Exception("Unable to load assets.", HalleyExceptions::Resources);
 	}
 
-	Deserializer::fromBytes<AssetDatabase>(*assetDb, reader->readAll());
+	assetDb->load(reader->readAll());
 }
 
 std::unique_ptr<ResourceData> FileSystemResourceLocator::getData(const String& asset, AssetType type, bool stream)
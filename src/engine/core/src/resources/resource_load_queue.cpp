@@ -0,0 +1,233 @@
+#include "resource_load_queue.h"
+#include <halley/resources/resource.h>
+#include <halley/resources/metadata.h>
+#include <halley/concurrency/concurrent.h>
+#include "halley/support/logger.h"
+#include "halley/support/profiler.h"
+#include "resources/resources.h"
+#include "resources/resource_load_trace.h"
+#include "halley/text/string_converter.h"
+
+using namespace Halley;
+
+bool ResourceLoadQueue::Request::isWanted() const
+{
+	for (auto& w: waiters) {
+		if (w.isWanted()) {
+			return true;
+		}
+	}
+	return false;
+}
+
+ResourceLoadQueue::State::State(ResourceLocator& locator)
+	: locator(locator)
+{}
+
+std::shared_ptr<ResourceLoadQueue::Request> ResourceLoadQueue::State::takeNext()
+{
+	for (int p = int(queued.size()); --p >= 0; ) {
+		auto& requests = queued[p];
+		if (requests.empty()) {
+			continue;
+		}
+
+		// Carry on forwards from the last read if anything is ahead of it in the same pack, otherwise start over from the lowest
+		auto best = requests.end();
+		auto lowest = requests.begin();
+		for (auto iter = requests.begin(); iter != requests.end(); ++iter) {
+			const auto& loc = (*iter)->location;
+			if (loc < (*lowest)->location) {
+				lowest = iter;
+			}
+			if (loc.provider == lastRead.provider && loc.offset >= lastRead.offset && (best == requests.end() || loc < (*best)->location)) {
+				best = iter;
+			}
+		}
+		if (best == requests.end()) {
+			best = lowest;
+		}
+
+		auto result = std::move(*best);
+		requests.erase(best);
+		result->started = true;
+		lastRead = result->location;
+		return result;
+	}
+	return {};
+}
+
+ResourceLoadQueue::ResourceLoadQueue(ResourceLocator& locator)
+	: state(std::make_shared<State>(locator))
+{}
+
+ResourceLoadQueue::~ResourceLoadQueue()
+{
+	std::unique_lock<std::mutex> readLock(state->readMutex);
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->alive = false;
+	for (auto& requests: state->queued) {
+		requests.clear();
+	}
+	state->pending.clear();
+}
+
+void ResourceLoadQueue::enqueue(ResourceCollectionBase& collection, const String& assetId, ResourceLoadPriority priority, ResourceLoadWaiter waiter)
+{
+	const auto type = collection.type;
+	const auto key = toString(int(type)) + ":" + assetId;
+
+	auto iter = state->pending.find(key);
+	if (iter != state->pending.end()) {
+		// Already on its way, so just wait for it, bumping it up if this is more urgent
+		auto& request = iter->second;
+		std::unique_lock<std::mutex> lock(state->mutex);
+		request->waiters.push_back(std::move(waiter));
+		if (!request->started && priority > request->priority) {
+			auto& from = state->queued[int(request->priority)];
+			from.erase(std::find(from.begin(), from.end(), request));
+			state->queued[int(priority)].push_back(request);
+			request->priority = priority;
+		}
+		return;
+	}
+
+	auto& locator = state->locator;
+	auto& meta = locator.getMetaData(assetId, type);
+
+	auto request = std::make_shared<Request>();
+	request->collection = &collection;
+	request->key = key;
+	request->assetId = assetId;
+	request->type = type;
+	request->location = locator.getDataLocation(assetId, type);
+	request->prefetch = !collection.resourceLoader && !collection.loadsFromStream(meta);
+	request->inflate = meta.getString("asset_compression", "") == "deflate";
+	request->priority = priority;
+	request->waiters.push_back(std::move(waiter));
+	if (auto& trace = collection.parent.getLoadTrace()) {
+		request->timing = trace->start(assetId, type, true);
+		request->enqueueTime = Profiler::getTimeNs();
+	}
+	state->pending[key] = request;
+
+	{
+		std::unique_lock<std::mutex> lock(state->mutex);
+		state->queued[int(priority)].push_back(request);
+	}
+
+	// One read per request, each taking whatever is most urgent by the time it runs
+	auto s = state;
+	Executors::getDiskIO().addToQueue([s] ()
+	{
+		read(s);
+	});
+}
+
+size_t ResourceLoadQueue::getNumPending() const
+{
+	return state->pending.size();
+}
+
+void ResourceLoadQueue::read(const std::shared_ptr<State>& state)
+{
+	std::unique_lock<std::mutex> readLock(state->readMutex);
+
+	std::shared_ptr<Request> request;
+	bool wanted;
+	{
+		std::unique_lock<std::mutex> lock(state->mutex);
+		if (!state->alive) {
+			return;
+		}
+		request = state->takeNext();
+		if (!request) {
+			return;
+		}
+		wanted = request->isWanted();
+	}
+
+	auto& timing = request->timing;
+	if (timing) {
+		timing->queue += Profiler::getTimeNs() - request->enqueueTime;
+	}
+	if (wanted && request->prefetch) {
+		try {
+			request->data = timing ? timing->read(state->locator, request->assetId, request->type) : state->locator.getStatic(request->assetId, request->type);
+		} catch (std::exception& e) {
+			request->error = e.what();
+		}
+	}
+	readLock.unlock();
+
+	if (request->data && request->inflate) {
+		Concurrent::execute(Executors::getCPU(), TaskPriority::Background, [state, request] ()
+		{
+			decode(state, request);
+		});
+	} else {
+		Executors::getMainThread().addToQueue([state, request] ()
+		{
+			finish(state, request);
+		});
+	}
+}
+
+void ResourceLoadQueue::decode(const std::shared_ptr<State>& state, std::shared_ptr<Request> request)
+{
+	try {
+		if (request->timing) {
+			request->timing->inflate(*request->data);
+		} else {
+			request->data->inflate();
+		}
+	} catch (std::exception& e) {
+		request->data.reset();
+		request->error = "Failed to inflate: " + String(e.what());
+	}
+
+	Executors::getMainThread().addToQueue([state, request] ()
+	{
+		finish(state, request);
+	});
+}
+
+void ResourceLoadQueue::finish(const std::shared_ptr<State>& state, std::shared_ptr<Request> request)
+{
+	if (!state->alive) {
+		return;
+	}
+
+	auto iter = state->pending.find(request->key);
+	if (iter != state->pending.end() && iter->second == request) {
+		state->pending.erase(iter);
+	}
+
+	std::vector<ResourceLoadWaiter> waiters;
+	{
+		std::unique_lock<std::mutex> lock(state->mutex);
+		waiters = std::move(request->waiters);
+	}
+
+	bool wanted = false;
+	for (auto& w: waiters) {
+		wanted = wanted || w.isWanted();
+	}
+	if (!wanted) {
+		return;
+	}
+
+	std::shared_ptr<Resource> result;
+	try {
+		if (!request->error.isEmpty()) {
+			throw Exception(request->error, HalleyExceptions::Resources);
+		}
+		result = request->collection->finishAsyncLoad(request->assetId, request->priority, std::move(request->data), request->timing);
+	} catch (std::exception& e) {
+		Logger::logError("Error while loading " + request->assetId + ": " + e.what());
+	}
+
+	for (auto& w: waiters) {
+		w.deliver(result);
+	}
+}
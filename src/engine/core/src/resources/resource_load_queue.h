@@ -0,0 +1,74 @@
+#pragma once
+
+#include "resources/resource_collection.h"
+#include "resources/resource_locator.h"
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Halley {
+	// Schedules asynchronous loads. Reads happen one at a time on the disk IO thread, highest priority first, and
+	// in order of where they are in each pack, so a whole level's worth of requests mostly reads forwards. Inflating
+	// happens on the CPU workers, and constructing the resource on the main thread, like a synchronous load would.
+	// Requests for the same asset share one load, and any that nobody wants anymore are skipped.
+	class ResourceLoadQueue {
+	public:
+		explicit ResourceLoadQueue(ResourceLocator& locator);
+		~ResourceLoadQueue();
+
+		// Main thread only
+		void enqueue(ResourceCollectionBase& collection, const String& assetId, ResourceLoadPriority priority, ResourceLoadWaiter waiter);
+		size_t getNumPending() const;
+
+	private:
+		struct Request {
+			ResourceCollectionBase* collection = nullptr;
+			String key;
+			String assetId;
+			AssetType type;
+			ResourceDataLocation location;
+			bool prefetch = false; // Otherwise the data is left for loadResource to get (streams, or overridden loaders)
+			bool inflate = false;
+
+			// Guarded by the queue mutex
+			ResourceLoadPriority priority = ResourceLoadPriority::Normal;
+			bool started = false;
+			std::vector<ResourceLoadWaiter> waiters;
+
+			// Disk IO thread, then handed to the main thread
+			std::unique_ptr<ResourceDataStatic> data;
+			String error;
+
+			std::shared_ptr<ResourceLoadTiming> timing; // Only while tracing, see ResourceLoadTrace
+			int64_t enqueueTime = 0;
+
+			bool isWanted() const;
+		};
+
+		// Shared with the tasks in flight, which may outlive the queue
+		struct State {
+			explicit State(ResourceLocator& locator);
+
+			ResourceLocator& locator;
+			bool alive = true; // Only cleared on the main thread, with both mutexes held
+
+			std::mutex mutex;
+			std::array<std::vector<std::shared_ptr<Request>>, 3> queued; // By priority
+			ResourceDataLocation lastRead;
+
+			std::mutex readMutex; // Held while reading, so the locator isn't destroyed under a read
+
+			HashMap<String, std::shared_ptr<Request>> pending; // Main thread only
+
+			std::shared_ptr<Request> takeNext();
+		};
+
+		std::shared_ptr<State> state;
+
+		static void read(const std::shared_ptr<State>& state);
+		static void decode(const std::shared_ptr<State>& state, std::shared_ptr<Request> request);
+		static void finish(const std::shared_ptr<State>& state, std::shared_ptr<Request> request);
+	};
+}
@@ -0,0 +1,55 @@
+#include "resources/resource_load_trace.h"
+#include <halley/resources/resource.h>
+#include <halley/resources/resource_data.h>
+#include "halley/support/profiler.h"
+#include "halley/text/string_converter.h"
+#include <cstring>
+
+using namespace Halley;
+
+ResourceLoadTrace::ResourceLoadTrace()
+	: mainThreadId(std::this_thread::get_id())
+	, startTime(Profiler::getTimeNs())
+{}
+
+std::shared_ptr<ResourceLoadTiming> ResourceLoadTrace::start(const String& asset, AssetType type, bool async)
+{
+	auto timing = std::make_shared<ResourceLoadTiming>();
+	const double time = double(Profiler::getTimeNs() - startTime) / 1000000000.0;
+	const bool mainThread = !async && std::this_thread::get_id() == mainThreadId;
+
+	std::unique_lock<std::mutex> lock(mutex);
+	entries.push_back(Entry{ time, toString(type) + ":" + asset, mainThread, async, timing });
+	return timing;
+}
+
+std::vector<ResourceLoadTrace::Entry> ResourceLoadTrace::getEntries() const
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	return entries;
+}
+
+void ResourceLoadTrace::clear()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	entries.clear();
+}
+
+Bytes ResourceLoadTrace::toCSV() const
+{
+	auto ms = [] (const std::atomic<int64_t>& ns)
+	{
+		return toString(double(ns.load(std::memory_order_relaxed)) / 1000000.0, 3);
+	};
+
+	String result = "time,asset,main_thread,async,queue_ms,io_ms,unpack_ms,decode_ms,upload_ms\n";
+	for (auto& e: getEntries()) {
+		auto& t = *e.timing;
+		result += toString(e.time, 3) + ",\"" + e.asset.replaceAll("\"", "\"\"") + "\"," + (e.mainThread ? "1" : "0") + "," + (e.async ? "1" : "0")
+			+ "," + ms(t.queue) + "," + ms(t.io) + "," + ms(t.unpack) + "," + ms(t.decode) + "," + ms(t.upload) + "\n";
+	}
+
+	Bytes bytes(result.size());
+	memcpy(bytes.data(), result.c_str(), result.size());
+	return bytes;
+}
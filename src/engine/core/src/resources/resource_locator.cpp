@@ -4,6 +4,9 @@
 #include <set>
 #include <halley/support/exception.h>
 #include "resource_pack.h"
+#include "resources/asset_pack.h"
+#include "resources/asset_database.h"
+#include "resources/resource_access_trace.h"
 #include "halley/support/logger.h"
 #include "api/system_api.h"
 
@@ -28,9 +31,17 @@ void ResourceLocator::add(std::unique_ptr<IResourceLocatorProvider> locator)
 
 std::unique_ptr<ResourceData> ResourceLocator::getResource(const String& asset, AssetType type, bool stream)
 {
-	auto result = locators.find(asset);
+	if (accessTrace) {
+		accessTrace->record(asset, type);
+	}
+
+	String dataAsset = asset;
+	AssetType dataType = type;
+	resolveSharedData(dataAsset, dataType);
+
+	auto result = locators.find(dataAsset);
 	if (result != locators.end()) {
-		auto data = result->second->getData(asset, type, stream);
+		auto data = result->second->getData(dataAsset, dataType, stream);
 		if (data) {
 			return data;
 		} else {
@@ -41,6 +52,15 @@ std::unique_ptr<ResourceData> ResourceLocator::getResource(const String& asset,
 	}
 }
 
+void ResourceLocator::resolveSharedData(String& asset, AssetType& type) const
+{
+	// Packs can store an asset as identical data kept in another pack, under another asset's name (see AssetPacker)
+	auto result = locators.find(asset);
+	if (result != locators.end()) {
+		AssetPack::getSharedSource(result->second->getAssetDatabase().getDatabase(type).get(asset).path, type, asset);
+	}
+}
+
 std::unique_ptr<ResourceDataStatic> ResourceLocator::getStatic(const String& asset, AssetType type)
 {
 	auto rawPtr = getResource(asset, type, false).release();
@@ -77,6 +97,23 @@ void ResourceLocator::purge(const String& asset, AssetType type)
 	}
 }
 
+ResourceDataLocation ResourceLocator::getDataLocation(const String& asset, AssetType type)
+{
+	String dataAsset = asset;
+	AssetType dataType = type;
+	resolveSharedData(dataAsset, dataType);
+
+	auto result = locators.find(dataAsset);
+	if (result != locators.end()) {
+		ResourceDataLocation location;
+		location.provider = result->second;
+		location.offset = result->second->getDataOffset(dataAsset, dataType);
+		return location;
+	} else {
+		throw Exception("Unable to locate resource: " + asset, HalleyExceptions::Resources);
+	}
+}
+
 std::vector<String> ResourceLocator::enumerate(const AssetType type)
 {
 	std::vector<String> result;
@@ -88,6 +125,11 @@ std::vector<String> ResourceLocator::enumerate(const AssetType type)
 	return result;
 }
 
+void ResourceLocator::setAccessTrace(std::shared_ptr<ResourceAccessTrace> trace)
+{
+	accessTrace = std::move(trace);
+}
+
 void ResourceLocator::addFileSystem(const Path& path)
 {
 	add(std::make_unique<FileSystemResourceLocator>(system, path));
@@ -1,7 +1,9 @@
 #include "resource_pack.h"
 #include <utility>
 #include "resources/asset_pack.h"
+#include "resources/asset_database.h"
 #include "api/system_api.h"
+#include "halley/os/os.h"
 using namespace Halley;
 
 PackResourceLocator::PackResourceLocator(std::unique_ptr<ResourceDataReader> reader, Path path, String key, bool preLoad)
@@ -9,7 +11,7 @@ PackResourceLocator::PackResourceLocator(std::unique_ptr<ResourceDataReader> rea
 	, encryptionKey(std::move(key))
 	, preLoad(preLoad)
 {
-	assetPack = std::make_unique<AssetPack>(std::move(reader), encryptionKey, preLoad);
+	assetPack = openPack(std::move(reader));
 }
 
 PackResourceLocator::~PackResourceLocator()
@@ -38,7 +40,37 @@ void PackResourceLocator::purge(SystemAPI& sys)
 	system = &sys;
 }
 
+uint64_t PackResourceLocator::getDataOffset(const String& asset, AssetType type)
+{
+	// Entries are "pos:size", optionally followed by more fields
+	const auto& entryPath = getAssetDatabase().getDatabase(type).get(asset).path;
+	AssetType sourceType;
+	String sourceName;
+	if (AssetPack::getSharedSource(entryPath, sourceType, sourceName)) {
+		return 0;
+	}
+	return uint64_t(entryPath.split(':').at(0).toInteger64());
+}
+
 void PackResourceLocator::loadAfterPurge()
 {
-	assetPack = std::make_unique<AssetPack>(system->getDataReader(path.string()), encryptionKey, preLoad);
+	assetPack = openPack({});
+}
+
+std::unique_ptr<AssetPack> PackResourceLocator::openPack(std::unique_ptr<ResourceDataReader> reader)
+{
+	// Mapped packs don't take up memory up front, and can be read from any thread without locking.
+	// Packs some platforms can't map (e.g. inside an APK) are read as before.
+	auto mapping = OS::get().mapFile(path);
+	if (mapping) {
+		if (preLoad) {
+			mapping->prefetch();
+		}
+		return std::make_unique<AssetPack>(std::move(mapping), encryptionKey);
+	}
+
+	if (!reader) {
+		reader = system->getDataReader(path.string());
+	}
+	return std::make_unique<AssetPack>(std::move(reader), encryptionKey, preLoad);
 }
@@ -16,9 +16,11 @@ namespace Halley {
 		std::unique_ptr<ResourceData> getData(const String& asset, AssetType type, bool stream) override;
 		const AssetDatabase& getAssetDatabase() override;
 		void purge(SystemAPI& system) override;
+		uint64_t getDataOffset(const String& asset, AssetType type) override;
 
 	private:
 		void loadAfterPurge();
+		std::unique_ptr<AssetPack> openPack(std::unique_ptr<ResourceDataReader> reader);
 
 		std::unique_ptr<AssetPack> assetPack;
 
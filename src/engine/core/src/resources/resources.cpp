@@ -1,5 +1,12 @@
 #include "resources/resources.h"
 #include "resources/resource_locator.h"
+#include "resources/asset_database.h"
+#include "resource_load_queue.h"
+#include "halley/support/logger.h"
+#include <halley/concurrency/concurrent.h>
+#include <halley/resources/metadata.h>
+#include <functional>
+#include <set>
 #include "api/halley_api.h"
 
 using namespace Halley;
@@ -7,6 +14,233 @@ using namespace Halley;
 Resources::Resources(std::unique_ptr<ResourceLocator> locator, const HalleyAPI* api)
 	: locator(std::move(locator))
 	, api(api)
+	, loadQueue(std::make_unique<ResourceLoadQueue>(*this->locator))
 {}
 
-Resources::~Resources() = default;
+Resources::~Resources()
+{
+	// Reads in flight use the locator
+	for (auto& batch: pendingReloads) {
+		for (auto& r: batch) {
+			if (r.prefetch) {
+				r.data.wait();
+			}
+		}
+	}
+}
+
+size_t Resources::getNumPendingLoads() const
+{
+	return loadQueue->getNumPending();
+}
+
+void Resources::setMemoryBudget(AssetType type, size_t bytes)
+{
+	ofType(type).setMemoryBudget(bytes);
+}
+
+size_t Resources::getMemoryUsage(AssetType type) const
+{
+	return ofType(type).getMemoryUsage();
+}
+
+void Resources::setLoadTrace(std::shared_ptr<ResourceLoadTrace> trace)
+{
+	loadTrace = std::move(trace);
+}
+
+const std::shared_ptr<ResourceLoadTrace>& Resources::getLoadTrace() const
+{
+	return loadTrace;
+}
+
+void Resources::setHotReloadEnabled(bool enabled)
+{
+	hotReloadEnabled = enabled;
+}
+
+bool Resources::isHotReloadEnabled() const
+{
+	return hotReloadEnabled;
+}
+
+void Resources::reloadAssets(const std::vector<String>& assets)
+{
+	std::vector<PendingReload> batch;
+	for (auto& asset: assets) {
+		const auto split = asset.find(':');
+		try {
+			if (split == String::npos) {
+				throw Exception("Missing asset type", HalleyExceptions::Resources);
+			}
+			const auto type = fromString<AssetType>(asset.left(split));
+			if (int(type) < int(resources.size()) && resources[int(type)]) {
+				batch.push_back(PendingReload{ type, asset.mid(split + 1) });
+			}
+		} catch (std::exception& e) {
+			Logger::logWarning("Invalid asset in reload list: \"" + asset + "\" (" + e.what() + ")");
+		}
+	}
+
+	// Purge everything first, so any affected packs are re-read
+	for (auto& r: batch) {
+		ofType(r.type).purge(r.name);
+	}
+
+	// Order matters, since types depend on earlier ones; within one, keep the order they were listed in
+	std::stable_sort(batch.begin(), batch.end(), [] (const PendingReload& a, const PendingReload& b)
+	{
+		return a.type < b.type;
+	});
+
+	for (auto& r: batch) {
+		auto& collection = ofType(r.type);
+		if (collection.resourceLoader || collection.resources.find(r.name) == collection.resources.end()) {
+			continue;
+		}
+
+		try {
+			auto& meta = locator->getMetaData(r.name, r.type);
+			if (collection.loadsFromStream(meta)) {
+				continue;
+			}
+			const bool inflate = meta.getString("asset_compression", "") == "deflate";
+
+			// Failures are left for the reload to report, which reads it again itself
+			auto& loc = *locator;
+			const auto name = r.name;
+			const auto type = r.type;
+			r.prefetch = true;
+			r.data = Concurrent::execute(Executors::getDiskIO(), [&loc, name, type] () -> std::unique_ptr<ResourceDataStatic>
+			{
+				try {
+					return loc.getStatic(name, type);
+				} catch (...) {
+					return {};
+				}
+			}).then(Executors::getCPU(), [inflate] (std::unique_ptr<ResourceDataStatic> data) -> std::unique_ptr<ResourceDataStatic>
+			{
+				if (data && inflate) {
+					try {
+						data->inflate();
+					} catch (...) {
+						return {};
+					}
+				}
+				return data;
+			});
+		} catch (...) {
+			// Probably gone from the database, which the reload will say
+		}
+	}
+
+	pendingReloads.push_back(std::move(batch));
+}
+
+void Resources::applyReloads()
+{
+	// Each batch waits for all of its data, so a whole reimport shows up on the same frame
+	while (!pendingReloads.empty()) {
+		auto& batch = pendingReloads.front();
+		for (auto& r: batch) {
+			if (r.prefetch && !r.data.isReady()) {
+				return;
+			}
+		}
+
+		for (size_t i = 0; i < batch.size(); ++i) {
+			auto& r = batch[i];
+			const bool firstOfType = i == 0 || batch[i - 1].type != r.type;
+			const bool lastOfType = i + 1 == batch.size() || batch[i + 1].type != r.type;
+
+			if (firstOfType && r.type == AssetType::AudioClip && api->audio) {
+				api->audio->pausePlayback();
+			}
+
+			Logger::logInfo("Reloading " + toString(r.type) + ": " + r.name);
+			ofType(r.type).reload(r.name, r.prefetch ? r.data.get() : std::unique_ptr<ResourceDataStatic>());
+
+			if (lastOfType && r.type == AssetType::SpriteSheet) {
+				ofType(AssetType::Sprite).unloadAll();
+			}
+			if (lastOfType && r.type == AssetType::AudioClip && api->audio) {
+				api->audio->resumePlayback();
+			}
+		}
+
+		pendingReloads.erase(pendingReloads.begin());
+	}
+}
+
+void Resources::update()
+{
+	if (!pendingReloads.empty()) {
+		applyReloads();
+	}
+
+	// Counting up every resource isn't free, so budgets are only checked every so often
+	if (++frame % memoryBudgetCheckInterval != 0) {
+		return;
+	}
+	for (auto& collection: resources) {
+		if (collection) {
+			collection->enforceMemoryBudget();
+		}
+	}
+}
+
+std::shared_ptr<ResourcePreload> Resources::preload(const std::vector<String>& assets, ResourceLoadPriority priority)
+{
+	std::vector<std::pair<AssetType, String>> toLoad;
+	std::set<String> visited;
+	std::function<void(AssetType, const String&)> visit = [&] (AssetType type, const String& name)
+	{
+		if (!visited.insert(toString(type) + ":" + name).second) {
+			return;
+		}
+
+		// Dependencies can name assets this build doesn't have, such as shaders for other video backends
+		if (int(type) >= int(resources.size()) || !resources[int(type)] || !locator->exists(name)) {
+			return;
+		}
+		try {
+			for (auto& dep: AssetDatabase::getDependencies(locator->getMetaData(name, type))) {
+				visit(dep.first, dep.second);
+			}
+		} catch (...) {
+			return;
+		}
+		toLoad.emplace_back(type, name);
+	};
+
+	for (auto& asset: assets) {
+		const auto split = asset.find(':');
+		try {
+			if (split == String::npos) {
+				throw Exception("Missing asset type", HalleyExceptions::Resources);
+			}
+			visit(fromString<AssetType>(asset.left(split)), asset.mid(split + 1));
+		} catch (std::exception& e) {
+			Logger::logWarning("Invalid asset in preload list: \"" + asset + "\" (" + e.what() + ")");
+		}
+	}
+
+	auto result = std::make_shared<ResourcePreload>();
+	result->numAssets = toLoad.size();
+	std::weak_ptr<ResourcePreload> weak = result;
+	for (auto& asset: toLoad) {
+		ResourceLoadWaiter waiter;
+		waiter.isWanted = [weak] ()
+		{
+			return !weak.expired();
+		};
+		waiter.deliver = [weak] (std::shared_ptr<Resource>)
+		{
+			if (auto p = weak.lock()) {
+				++p->numDone;
+			}
+		};
+		ofType(asset.first).doGetAsync(asset.second, priority, std::move(waiter));
+	}
+	return result;
+}
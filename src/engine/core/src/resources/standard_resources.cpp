@@ -12,9 +12,18 @@
 #include "halley/audio/audio_event.h"
 #include "halley/file_formats/binary_file.h"
 #include "halley/file_formats/image.h"
+#include "halley/entity/prefab.h"
 
 using namespace Halley;
 
+void StandardResources::initializeHeadless(Resources& resources)
+{
+	resources.init<BinaryFile>();
+	resources.init<TextFile>();
+	resources.init<ConfigFile>();
+	resources.init<Prefab>();
+}
+
 void StandardResources::initialize(Resources& resources)
 {
 	resources.init<Animation>();
@@ -30,6 +39,7 @@ void StandardResources::initialize(Resources& resources)
 	resources.init<ConfigFile>();
 	resources.init<AudioClip>();
 	resources.init<AudioEvent>();
+	resources.init<Prefab>();
 
 	resources.of<SpriteResource>().setResourceLoader([&] (const String& name, ResourceLoadPriority) -> std::shared_ptr<Resource>
 	{
@@ -10,7 +10,10 @@ std::unique_ptr<World> EntityStage::createWorld(String configName, std::function
 	auto world = std::make_unique<World>(&getAPI(), getGame().isDevMode());
 
 	auto config = getResource<ConfigFile>(configName);
-	world->loadSystems(getResource<ConfigFile>(configName)->getRoot(), createFunction);
+	auto& root = config->getRoot();
+	world->setArchetypeStorage(root["storage"].asString("pointer") == "archetype");
+	world->setParallelSystems(root["parallelSystems"].asBool(false));
+	world->loadSystems(root, createFunction);
 
 	return world;
 }
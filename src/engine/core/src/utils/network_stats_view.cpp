@@ -0,0 +1,111 @@
+#include "utils/network_stats_view.h"
+#include "halley/core/graphics/render_context.h"
+#include "graphics/text/font.h"
+#include "resources/resources.h"
+#include "halley/core/api/core_api.h"
+#include "halley/core/api/network_api.h"
+#include "halley/text/string_converter.h"
+#include <algorithm>
+
+using namespace Halley;
+
+NetworkStatsView::NetworkStatsView(CoreAPI& coreAPI, NetworkAPI& networkAPI)
+	: networkAPI(networkAPI)
+	, text(coreAPI.getResources().get<Font>("Ubuntu Bold"), "", 16, Colour(1, 1, 1), 1.0f, Colour(0.1f, 0.1f, 0.1f))
+	, lastTime(std::chrono::steady_clock::now())
+{
+}
+
+void NetworkStatsView::draw(RenderContext& context)
+{
+	const auto stats = networkAPI.getStats();
+	updateRates(stats);
+
+	const auto& conn = stats.connections;
+	const auto& queues = stats.messageQueues;
+	const float lossRate = conn.packetsAcked + conn.packetsLost > 0 ? float(conn.packetsLost) / float(conn.packetsAcked + conn.packetsLost) : 0.0f;
+	const float resendRate = queues.packetsResent > 0 ? float(queues.packetsResent) / float(std::max(conn.traffic.packetsSent, uint64_t(1))) : 0.0f;
+
+	String str;
+	str += toString(stats.numConnections) + " connections, " + toString(stats.numMessageQueues) + " message queues, " + toString(stats.numSessions) + " sessions\n";
+	str += "Out: " + String::prettySize(static_cast<long long>(bytesSentPerSecond)) + "/s, in: " + String::prettySize(static_cast<long long>(bytesReceivedPerSecond)) + "/s\n";
+	str += "Total: " + formatTraffic(conn.traffic) + "\n";
+	str += "Loss: " + toString(int(lossRate * 1000.0f) / 10.0f) + "%, resent: " + toString(int(resendRate * 1000.0f) / 10.0f) + "%, unreliable dropped: " + toString(queues.unreliableDropped) + "\n";
+	str += "RTT: " + formatHistogram(conn.roundTripTime) + "\n";
+	str += "Ack delay: " + formatHistogram(conn.ackDelay) + "\n";
+	str += "Serialization: " + formatHistogram(queues.serializationTime) + "\n";
+	str += "Pending: " + toString(queues.pendingMessages) + " messages, " + toString(queues.pendingPackets) + " packets awaiting ack\n";
+
+	str += "\nChannels:\n";
+	for (size_t i = 0; i < queues.channels.size(); ++i) {
+		const auto& c = queues.channels[i];
+		if (c.packetsSent + c.packetsReceived > 0) {
+			str += "  " + toString(i) + ": " + formatTraffic(c) + "\n";
+		}
+	}
+
+	// Busiest message types first, as those are usually what's behind a spike
+	Vector<size_t> order(queues.messageTypes.size());
+	for (size_t i = 0; i < order.size(); ++i) {
+		order[i] = i;
+	}
+	std::sort(order.begin(), order.end(), [&] (size_t a, size_t b)
+	{
+		const auto& ta = queues.messageTypes[a];
+		const auto& tb = queues.messageTypes[b];
+		return ta.bytesSent + ta.bytesReceived > tb.bytesSent + tb.bytesReceived;
+	});
+	str += "\nMessage types:\n";
+	for (size_t i = 0; i < std::min(order.size(), size_t(12)); ++i) {
+		str += "  " + queues.messageTypeNames[order[i]] + ": " + formatTraffic(queues.messageTypes[order[i]]) + "\n";
+	}
+
+	if (stats.numSessions > 0) {
+		const char* sessionTypes[] = { "Control", "To peers", "To master" };
+		str += "\nSession:\n";
+		for (size_t i = 0; i < stats.sessions.messageTypes.size(); ++i) {
+			str += "  " + String(sessionTypes[i]) + ": " + formatTraffic(stats.sessions.messageTypes[i]) + "\n";
+		}
+		str += "  Relayed: " + formatTraffic(stats.sessions.relayed) + "\n";
+	}
+
+	context.bind([&] (Painter& painter) {
+		text
+			.setColour(Colour(1, 1, 1))
+			.setText(str)
+			.setPosition(Vector2f(20, 20))
+			.draw(painter);
+	});
+}
+
+void NetworkStatsView::updateRates(const NetworkStats& stats)
+{
+	const auto now = std::chrono::steady_clock::now();
+	const float elapsed = std::chrono::duration<float>(now - lastTime).count();
+	if (elapsed < 0.5f) {
+		return;
+	}
+
+	// Connections come and go, so don't let the totals going down show up as negative rates
+	const auto& cur = stats.connections.traffic;
+	const auto& prev = lastStats.connections.traffic;
+	bytesSentPerSecond = cur.bytesSent >= prev.bytesSent ? float(cur.bytesSent - prev.bytesSent) / elapsed : 0.0f;
+	bytesReceivedPerSecond = cur.bytesReceived >= prev.bytesReceived ? float(cur.bytesReceived - prev.bytesReceived) / elapsed : 0.0f;
+
+	lastStats = stats;
+	lastTime = now;
+}
+
+String NetworkStatsView::formatHistogram(const NetworkHistogram& histogram) const
+{
+	if (histogram.getCount() == 0) {
+		return "-";
+	}
+	auto ms = [] (float seconds) { return toString(int(lround(seconds * 10000.0f)) / 10.0f); };
+	return "mean " + ms(histogram.getMean()) + " ms, p50 " + ms(histogram.getPercentile(0.5f)) + ", p95 " + ms(histogram.getPercentile(0.95f)) + ", p99 " + ms(histogram.getPercentile(0.99f)) + ", max " + ms(histogram.getMax());
+}
+
+String NetworkStatsView::formatTraffic(const NetworkTrafficCounters& traffic) const
+{
+	return "out " + String::prettySize(static_cast<long long>(traffic.bytesSent)) + " (" + toString(traffic.packetsSent) + "), in " + String::prettySize(static_cast<long long>(traffic.bytesReceived)) + " (" + toString(traffic.packetsReceived) + ")";
+}
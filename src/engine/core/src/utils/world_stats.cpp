@@ -6,6 +6,7 @@
 #include <halley/entity/world.h>
 #include <halley/entity/system.h>
 #include "halley/text/string_converter.h"
+#include "halley/support/memory_tracker.h"
 
 using namespace Halley;
 
@@ -23,6 +24,7 @@ void WorldStatsView::draw(RenderContext& context)
 		TimeLine timelines[] = { TimeLine::FixedUpdate, TimeLine::VariableUpdate, TimeLine::Render };
 		String timelineLabels[] = { "Fixed", "Variable", "Render" };
 		int i = 0;
+		float maxY = 0;
 		float width = (float(context.getCamera().getActiveViewPort().getWidth()) - 40.0f) / 3.0f;
 
 		auto drawStats = [&] (String name, int nEntities, int64_t time, Vector2f& basePos)
@@ -69,11 +71,24 @@ void WorldStatsView::draw(RenderContext& context)
 			if (timeline == TimeLine::Render) {
 				vsyncTime = coreAPI.getTime(CoreAPITimer::Vsync, TimeLine::Render, StopwatchAveraging::Mode::Average);
 				drawStats("[VSync]", 0, vsyncTime, pos);
+
+				// Not part of the frame's CPU time, so it's just listed
+				const int64_t gpuTime = coreAPI.getTime(CoreAPITimer::GPU, TimeLine::Render, StopwatchAveraging::Mode::Average);
+				if (gpuTime > 0) {
+					text.setColour(Colour(0.8f, 0.8f, 1.0f));
+					drawStats("[GPU]", 0, gpuTime, pos);
+					text.setColour(Colour(1, 1, 1));
+				}
 			}
 
 			drawStats("[Engine]", 0, total - gameTotal - vsyncTime, pos);
 			text.setColour(Colour(0.8f, 1.0f, 0.8f));
 			drawStats("Total", world ? int(world->numEntities()) : 0, total, pos);
+			maxY = std::max(maxY, pos.y);
+		}
+
+		if (MemoryTracker::isEnabled()) {
+			drawMemoryStats(painter, Vector2f(20, maxY + 20), width);
 		}
 
 		int maxFPS = int(lround(1'000'000'000.0 / grandTotal));
@@ -85,6 +100,34 @@ void WorldStatsView::draw(RenderContext& context)
 	});
 }
 
+void WorldStatsView::drawMemoryStats(Painter& painter, Vector2f pos, float width)
+{
+	const auto snapshot = MemoryTracker::capture();
+
+	auto drawLine = [&] (const String& name, const MemoryTagStats& stats)
+	{
+		text.setText(name).setAlignment(0).setPosition(pos + Vector2f(10, 0)).draw(painter);
+		text.setAlignment(1);
+		text.setText(String::prettySize(stats.liveBytes)).setPosition(pos + Vector2f(width - 120, 0)).draw(painter);
+		text.setText(toString(stats.lastFrameAllocations)).setPosition(pos + Vector2f(width - 50, 0)).draw(painter);
+		text.setAlignment(0);
+		pos.y += 20;
+	};
+
+	text.setColour(Colour(0.2f, 1.0f, 0.3f)).setText("Memory (live, allocations last frame):").setPosition(pos).draw(painter);
+	text.setColour(Colour(1, 1, 1));
+	pos.y += 20;
+
+	for (size_t i = 0; i < snapshot.tags.size(); ++i) {
+		if (snapshot.tags[i].liveBytes > 0 || snapshot.tags[i].lastFrameAllocations > 0) {
+			drawLine(MemoryTracker::getTagName(i), snapshot.tags[i]);
+		}
+	}
+	text.setColour(Colour(0.8f, 1.0f, 0.8f));
+	drawLine("Total", snapshot.total);
+	text.setColour(Colour(1, 1, 1));
+}
+
 void WorldStatsView::setWorld(const World* w)
 {
 	world = w;
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include "family_mask.h"
+#include <halley/data_structures/vector.h>
+
+namespace Halley {
+	class Component;
+
+	// Stores all components of entities sharing the same mask in contiguous, per-type columns.
+	// Columns are split into fixed-size chunks so that growing never relocates existing components.
+	class ArchetypeStorage
+	{
+	public:
+		constexpr static size_t chunkSize = 256;
+
+		explicit ArchetypeStorage(FamilyMaskType mask);
+		~ArchetypeStorage();
+
+		ArchetypeStorage(const ArchetypeStorage& other) = delete;
+		ArchetypeStorage& operator=(const ArchetypeStorage& other) = delete;
+
+		FamilyMaskType getMask() const { return mask; }
+		size_t count() const { return liveSlots; }
+
+		size_t allocSlot();
+		void freeSlot(size_t slot);
+
+		Component* getComponent(size_t slot, int componentId) const
+		{
+			if (componentId < 0 || componentId >= int(columnIndex.size())) {
+				return nullptr;
+			}
+			const int col = columnIndex[componentId];
+			if (col < 0) {
+				return nullptr;
+			}
+			auto& column = columns[col];
+			return reinterpret_cast<Component*>(column.chunks[slot / chunkSize] + (slot % chunkSize) * column.stride);
+		}
+
+	private:
+		struct Column
+		{
+			int componentId = -1;
+			size_t stride = 0;
+			size_t alignment = 0;
+			Vector<char*> chunks;
+			Vector<char*> allocations;
+		};
+
+		FamilyMaskType mask;
+		Vector<Column> columns;
+		Vector<int> columnIndex;
+		Vector<size_t> freeSlots;
+		size_t slotCount = 0;
+		size_t liveSlots = 0;
+
+		void addChunk();
+	};
+}
@@ -12,17 +12,7 @@
 namespace Halley {
 	class World;
 	class System;
-
-	class MessageEntry
-	{
-	public:
-		std::unique_ptr<Message> msg;
-		int type = -1;
-		int age = -1;
-
-		MessageEntry() {}
-		MessageEntry(std::unique_ptr<Message> msg, int type, int age) : msg(std::move(msg)), type(type), age(age) {}
-	};
+	class ArchetypeStorage;
 
 	class EntityRef;
 
@@ -31,6 +21,7 @@ namespace Halley {
 		friend class World;
 		friend class System;
 		friend class EntityRef;
+		friend class EntityReplicator;
 
 	public:
 		~Entity();
@@ -39,6 +30,11 @@ namespace Halley {
 		T* tryGetComponent()
 		{
 			constexpr int id = FamilyMask::RetrieveComponentIndex<T>::componentIndex;
+			if (!dirty) {
+				// Components are sorted by id when refreshed, so the mask knows where each one is
+				const uint8_t slot = componentSlots[id];
+				return slot == FamilyMask::noComponentSlot ? nullptr : static_cast<T*>(components[slot].second);
+			}
 			for (size_t i = 0; i < components.size(); i++) {
 				if (components[i].first == id) {
 					return static_cast<T*>(components[i].second);
@@ -62,7 +58,7 @@ namespace Halley {
 		bool hasComponent()
 		{
 			if (dirty) {
-				return getComponent<T>() != nullptr;
+				return tryGetComponent<T>() != nullptr;
 			} else {
 				return FamilyMask::hasBit(mask, FamilyMask::RetrieveComponentIndex<T>::componentIndex);
 			}
@@ -80,14 +76,33 @@ namespace Halley {
 		FamilyMaskType getMask() const;
 		EntityId getEntityId() const;
 
-		void refresh();
+		// Version of the World when each component was last added or marked as changed. Indexed by the slots of the last
+		// refreshed mask, which is still valid while the entity is dirty, as the versions are only remapped on refresh.
+		uint32_t getComponentVersion(int id) const
+		{
+			const uint8_t slot = componentSlots[id];
+			return slot == FamilyMask::noComponentSlot ? 0 : componentVersions[slot];
+		}
+
+		void markComponentChanged(int id, uint32_t version)
+		{
+			const uint8_t slot = componentSlots[id];
+			if (slot != FamilyMask::noComponentSlot) {
+				componentVersions[slot] = version;
+			}
+		}
+
+		void refresh(uint32_t version);
 		void destroy();
 
 	private:
 		Vector<std::pair<int, Component*>> components;
-		Vector<MessageEntry> inbox;
+		Vector<uint32_t> componentVersions;
 		FamilyMaskType mask;
+		const uint8_t* componentSlots;
 		EntityId uid;
+		ArchetypeStorage* archetype = nullptr;
+		size_t archetypeSlot = 0;
 		int liveComponents = 0;
 		bool dirty = false;
 		bool alive = true;
@@ -122,6 +137,8 @@ namespace Halley {
 		void addComponent(Component* component, int id);
 		void removeComponentAt(int index);
 		void deleteComponent(Component* component, int id);
+		bool isOwnedByArchetype(Component* component, int id) const;
+		void moveToArchetype(ArchetypeStorage& storage);
 		void onReady();
 
 		void markDirty(World& world);
@@ -174,6 +191,7 @@ namespace Halley {
 
 	private:
 		friend class World;
+		friend class EntityCommandBuffer;
 		EntityRef(Entity& e, World& w)
 			: entity(e)
 			, world(w)
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+#include <new>
+#include "entity_id.h"
+#include "entity.h"
+#include <halley/data_structures/vector.h>
+
+namespace Halley {
+	class World;
+
+	// Records structural changes (creation, destruction, adding and removing components) so they can be made from
+	// systems running in parallel. The World keeps one per thread and applies them all at its next sync point.
+	//
+	// Commands are applied in order of their sort key, which the World and System::invokeParallel set to the
+	// index of the system and of the entity being processed, so the result doesn't depend on thread scheduling.
+	class EntityCommandBuffer
+	{
+	public:
+		class PendingEntity
+		{
+			friend class EntityCommandBuffer;
+		public:
+			PendingEntity() {}
+
+		private:
+			explicit PendingEntity(int index) : index(index) {}
+			int index = -1;
+		};
+
+		class SortKeyScope
+		{
+		public:
+			explicit SortKeyScope(uint64_t key);
+			~SortKeyScope();
+
+			SortKeyScope(const SortKeyScope& other) = delete;
+			SortKeyScope& operator=(const SortKeyScope& other) = delete;
+
+		private:
+			uint64_t prevKey;
+		};
+
+		EntityCommandBuffer() = default;
+		~EntityCommandBuffer();
+
+		EntityCommandBuffer(const EntityCommandBuffer& other) = delete;
+		EntityCommandBuffer& operator=(const EntityCommandBuffer& other) = delete;
+
+		PendingEntity createEntity();
+		void destroyEntity(EntityId id);
+
+		template <typename T>
+		void addComponent(EntityId id, T component)
+		{
+			recordAddComponent<T>(Target(id), std::move(component));
+		}
+
+		template <typename T>
+		void addComponent(PendingEntity entity, T component)
+		{
+			recordAddComponent<T>(Target(entity), std::move(component));
+		}
+
+		template <typename T>
+		void removeComponent(EntityId id)
+		{
+			Command cmd(CommandType::RemoveComponent, Target(id));
+			cmd.apply = [] (EntityRef& e, Component*) { e.removeComponent<T>(); };
+			commands.push_back(cmd);
+		}
+
+		bool empty() const;
+		void clear();
+
+		// Applies this buffer on its own. Use World::spawnPending to apply the per-thread buffers owned by the World.
+		void apply(World& world);
+		static void apply(World& world, const Vector<EntityCommandBuffer*>& buffers);
+
+		static uint64_t makeSortKey(uint32_t major, uint32_t minor);
+		static uint64_t getSortKey();
+		static void setSortKey(uint64_t key);
+
+	private:
+		enum class CommandType
+		{
+			CreateEntity,
+			DestroyEntity,
+			AddComponent,
+			RemoveComponent
+		};
+
+		struct Target
+		{
+			EntityId id;
+			int pending = -1;
+
+			explicit Target(EntityId id) : id(id) {}
+			explicit Target(PendingEntity e) : pending(e.index) {}
+		};
+
+		struct Command
+		{
+			CommandType type;
+			Target target;
+			uint64_t sortKey;
+			Component* component = nullptr;
+			void (*apply)(EntityRef& entity, Component* component) = nullptr;
+			void (*destroy)(Component* component) = nullptr;
+
+			Command(CommandType type, Target target);
+		};
+
+		Vector<Command> commands;
+		Vector<EntityId> created;
+		int nPending = 0;
+
+		template <typename T>
+		void recordAddComponent(Target target, T&& component)
+		{
+			static_assert(std::is_base_of<Component, T>::value, "Components must extend the Component class");
+			// Component's allocator isn't thread-safe, so this is held on the regular heap until it's applied
+			Command cmd(CommandType::AddComponent, target);
+			cmd.component = ::new (::operator new(sizeof(T))) T(std::move(component));
+			cmd.apply = [] (EntityRef& e, Component* c)
+			{
+				e.addComponent(std::move(*static_cast<T*>(c)));
+			};
+			cmd.destroy = [] (Component* c)
+			{
+				static_cast<T*>(c)->~T();
+				::operator delete(c);
+			};
+			commands.push_back(cmd);
+		}
+
+		EntityId resolve(const Target& target) const;
+		static void applyCommand(World& world, EntityCommandBuffer& buffer, Command& cmd);
+	};
+}
+
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "entity_id.h"
+#include "message.h"
+#include <halley/data_structures/vector.h>
+#include <mutex>
+#include <utility>
+
+namespace Halley {
+	// All the messages of one type sent in the World, stored by value in a single array, along with their targets.
+	// Before they're read, they're sorted by target (keeping the order they were sent in for each target), so that
+	// receivers can find each entity's messages with a binary search, and read them in order in memory. Broadcasts
+	// have an invalid target, so they sort first.
+	//
+	// Each message is kept until its sender updates again, like entity inboxes used to (see System::doUpdate).
+	class EntityMessageQueueBase
+	{
+	public:
+		virtual ~EntityMessageQueueBase() = default;
+
+		size_t size() const { return entries.size(); }
+		bool empty() const { return entries.empty(); }
+
+		EntityId getTarget(size_t idx) const { return entries[idx].target; }
+		virtual Message* getMessage(size_t idx) = 0;
+
+		// Sorts by target, if anything was sent out of order since the last call. Safe to call from several receivers
+		// at once, but not while messages are being sent.
+		void prepareForReading();
+
+		// Indices of the messages sent to target; must be prepared for reading
+		std::pair<size_t, size_t> getRange(EntityId target) const;
+
+		void removeFromSender(int sender);
+		void clear();
+
+	protected:
+		struct Entry
+		{
+			EntityId target;
+			int sender;
+		};
+
+		Vector<Entry> entries;
+
+		void addEntry(EntityId target, int sender);
+
+		// Keeps only the messages at the given indices, in that order
+		virtual void reorderMessages(const Vector<uint32_t>& indices) = 0;
+
+	private:
+		std::mutex mutex;
+		bool sorted = true;
+		Vector<uint32_t> scratch;
+
+		void reorder(const Vector<uint32_t>& indices);
+	};
+
+	template <typename T>
+	class EntityMessageQueue final : public EntityMessageQueueBase
+	{
+	public:
+		void push(EntityId target, const T& msg, int sender)
+		{
+			addEntry(target, sender);
+			messages.push_back(msg);
+		}
+
+		Message* getMessage(size_t idx) override
+		{
+			return &messages[idx];
+		}
+
+	protected:
+		void reorderMessages(const Vector<uint32_t>& indices) override
+		{
+			Vector<T> result;
+			result.reserve(indices.size());
+			for (auto i: indices) {
+				result.push_back(std::move(messages[i]));
+			}
+			messages = std::move(result);
+		}
+
+	private:
+		Vector<T> messages;
+	};
+}
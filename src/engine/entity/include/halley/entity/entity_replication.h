@@ -0,0 +1,140 @@
+#pragma once
+
+#include "entity_id.h"
+#include <halley/net/connection/network_message.h>
+#include <halley/data_structures/vector.h>
+#include <halley/data_structures/hash_map.h>
+#include <halley/data_structures/maybe.h>
+#include <halley/maths/vector2.h>
+#include <halley/time/halleytime.h>
+#include <halley/utils/utils.h>
+#include <memory>
+
+namespace Halley {
+	class World;
+	class Entity;
+	class MessageQueue;
+	class SpatialIndexService;
+
+	enum class EntityReplicationMsgType : uint8_t
+	{
+		Create,
+		Update,
+		Destroy
+	};
+
+	class EntityReplicationMsg : public NetworkMessage
+	{
+	public:
+		explicit EntityReplicationMsg(gsl::span<const gsl::byte> data);
+		EntityReplicationMsg(EntityReplicationMsgType type, EntityId id, uint32_t tick, Bytes data = {});
+
+		void serialize(Serializer& s) const override;
+
+		EntityReplicationMsgType getType() const { return type; }
+		EntityId getEntityId() const { return id; }
+		uint32_t getTick() const { return tick; }
+		const Bytes& getData() const { return data; }
+
+	private:
+		EntityReplicationMsgType type;
+		EntityId id;
+		uint32_t tick = 0;
+		Bytes data;
+	};
+
+	struct EntityReplicationSettings
+	{
+		int reliableChannel = 0; // Creates and destroys, which are reliable and ordered
+		int updateChannel = 1; // State updates, which are unreliable; anything lost is healed by later updates
+
+		float interestRadius = 1024.0f; // Entities in the spatial index within this distance of a peer's focus are relevant to it
+		size_t bytesPerPeerPerTick = 4096; // Budget for creates and updates; destroys are always sent
+		float idlePriorityScale = 0.1f; // Unchanged entities still accumulate priority at this rate, so lost updates get resent
+	};
+
+	// Server side of entity replication. Each update, every peer gets the entities relevant to it: those in the spatial
+	// index around its focus, plus any marked as always relevant. Relevant entities accumulate priority over time, faster
+	// when their replicated components change, and each peer is sent the highest priority ones that fit in its byte budget.
+	// Only components generated with "replicated: true" are sent, and removing components isn't replicated.
+	class EntityReplicator
+	{
+	public:
+		// Without a spatial index, only entities marked as always relevant are replicated
+		EntityReplicator(World& world, SpatialIndexService* spatialIndex, EntityReplicationSettings settings = {});
+
+		// Registers the replication message and channels on a queue; call on both ends
+		static void setupMessageQueue(MessageQueue& queue, const EntityReplicationSettings& settings = {});
+
+		void addPeer(int peerId, std::shared_ptr<MessageQueue> queue);
+		void removePeer(int peerId);
+		void setPeerFocus(int peerId, Vector2f focus);
+
+		void setPriority(EntityId id, float priority); // Defaults to 1
+		void setAlwaysRelevant(EntityId id, bool relevant);
+
+		// Call after systems have run; doesn't call sendAll on the queues
+		void update(Time t);
+
+	private:
+		struct PeerEntityState
+		{
+			float accumulator = 0;
+			uint32_t sentVersion = 0;
+			bool created = false;
+			bool relevant = false;
+		};
+
+		struct Peer
+		{
+			std::shared_ptr<MessageQueue> queue;
+			Maybe<Vector2f> focus;
+			HashMap<EntityId, PeerEntityState> entities;
+		};
+
+		struct Candidate
+		{
+			EntityId id;
+			PeerEntityState* state;
+			uint32_t version;
+		};
+
+		World& world;
+		SpatialIndexService* spatialIndex;
+		EntityReplicationSettings settings;
+		HashMap<int, Peer> peers;
+		HashMap<EntityId, float> priorities;
+		Vector<EntityId> alwaysRelevant;
+		uint32_t tick = 0;
+
+		Vector<EntityId> relevantScratch;
+		Vector<Candidate> candidatesScratch;
+
+		void updatePeer(Peer& peer, Time t);
+		float getPriority(EntityId id) const;
+		uint32_t getReplicatedVersion(const Entity& entity) const;
+	};
+
+	// Client side of entity replication. Replicated entities get local ids of their own; use getLocalId to map them.
+	class EntityReplicaReceiver
+	{
+	public:
+		explicit EntityReplicaReceiver(World& world);
+
+		// Returns false if the message isn't a replication message, so it can be handled elsewhere
+		bool onMessage(NetworkMessage& msg);
+
+		Maybe<EntityId> getLocalId(EntityId remoteId) const;
+		void clear(); // Destroys all replicated entities
+
+	private:
+		struct Replica
+		{
+			EntityId localId;
+			uint32_t lastTick = 0;
+		};
+
+		World& world;
+		HashMap<EntityId, Replica> replicas;
+	};
+}
@@ -18,7 +18,7 @@ namespace Halley {
 		friend class World;
 
 	public:
-		Family(FamilyMaskType mask);
+		Family(FamilyMaskType inclusionMask, FamilyMaskType optionalMask, Vector<int> componentIndices);
 		virtual ~Family() {}
 
 		size_t count() const
@@ -43,6 +43,7 @@ namespace Halley {
 		virtual void addEntity(Entity& entity) = 0;
 		void removeEntity(Entity& entity);
 		virtual void updateEntities() = 0;
+		virtual void removeDeadEntities() = 0;
 		virtual void clearEntities() = 0;
 		
 		void* elems = nullptr;
@@ -55,6 +56,8 @@ namespace Halley {
 
 	private:
 		FamilyMaskType inclusionMask;
+		FamilyMaskType optionalMask;
+		Vector<int> componentIndices;
 	};
 
 	class FamilyBase {
@@ -63,6 +66,7 @@ namespace Halley {
 
 	public:
 		EntityId entityId;
+		Entity* entityPtr = nullptr;
 	};
 
 	template <typename T>
@@ -100,7 +104,7 @@ namespace Halley {
 		};
 
 	public:
-		FamilyImpl() : Family(T::Type::inclusionMask()) {}
+		FamilyImpl() : Family(T::Type::inclusionMask(), T::Type::optionalMask(), T::Type::componentIndices()) {}
 				
 	protected:
 		void addEntity(Entity& entity) override
@@ -108,6 +112,7 @@ namespace Halley {
 			entities.push_back(StorageType());
 			auto& e = entities.back();
 			e.entityId = entity.getEntityId();
+			e.entityPtr = &entity;
 			T::Type::loadComponents(entity, &e.data[0]);
 
 			dirty = true;
@@ -140,18 +145,7 @@ namespace Halley {
 			updateElems();
 		}
 
-	private:
-		Vector<StorageType> entities;
-		bool dirty = false;
-
-		void updateElems()
-		{
-			elems = entities.empty() ? nullptr : entities.data();
-			elemCount = entities.size();
-			elemSize = sizeof(StorageType);
-		}
-
-		void removeDeadEntities()
+		void removeDeadEntities() override
 		{
 			// Performance-critical code
 			// Benchmarks suggest that using a Vector is faster than std::set and std::unordered_set
@@ -202,5 +196,16 @@ namespace Halley {
 			}
 			Ensures(toRemove.empty());
 		}
+
+	private:
+		Vector<StorageType> entities;
+		bool dirty = false;
+
+		void updateElems()
+		{
+			elems = entities.empty() ? nullptr : entities.data();
+			elemCount = entities.size();
+			elemSize = sizeof(StorageType);
+		}
 	};
 }
@@ -1,11 +1,14 @@
 #pragma once
 
 #include <bitset>
+#include <cstdint>
 #include "halley/data_structures/maybe_ref.h"
 
 namespace Halley {
 	namespace FamilyMask {
-		using RealType = std::bitset<256>;
+		constexpr static int maxComponents = 256;
+		constexpr static uint8_t noComponentSlot = 0xFF;
+		using RealType = std::bitset<maxComponents>;
 
 
 		class Handle
@@ -25,6 +28,10 @@ namespace Halley {
 			Handle operator&(const Handle& h) const;
 
 			const RealType& getRealValue() const;
+			int getHandleIndex() const { return value; }
+
+			// Maps each component id to its position in a list of this mask's components sorted by id, or noComponentSlot
+			const uint8_t* getComponentSlots() const;
 			
 			bool contains(const Handle& handle) const;
 
@@ -146,6 +153,33 @@ namespace Halley {
 				return getHandle(mask);
 			}
 		};
+
+
+		template <typename... Ts>
+		struct OptionalEvaluator;
+
+		template <>
+		struct OptionalEvaluator <> {
+			static RealType makeMask(RealType startValue) {
+				return startValue;
+			}
+		};
+
+		template <typename T, typename... Ts>
+		struct OptionalEvaluator <T, Ts...> {
+			static void makeMask(RealType& mask) {
+				if (IsMaybeRef<T>::value) {
+					FamilyMask::setBit(mask, RetrieveComponentIndex<T>::componentIndex);
+				}
+				OptionalEvaluator<Ts...>::makeMask(mask);
+			}
+
+			static HandleType getMask() {
+				RealType mask;
+				makeMask(mask);
+				return getHandle(mask);
+			}
+		};
 	}
 
 	class MaskStorageInterface
@@ -157,3 +191,14 @@ namespace Halley {
 
 	using FamilyMaskType = FamilyMask::HandleType;
 }
+
+namespace std {
+	template<>
+	struct hash<Halley::FamilyMask::Handle>
+	{
+		size_t operator()(const Halley::FamilyMask::Handle& h) const
+		{
+			return std::hash<int>()(h.getHandleIndex());
+		}
+	};
+}
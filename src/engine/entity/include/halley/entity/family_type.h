@@ -6,16 +6,30 @@ namespace Halley {
 	template <typename... Ts>
 	class FamilyType {
 	public:
+		// The masks only depend on the component types, so they're built once; only the handle lookup is left per call
 		static FamilyMaskType writeMask() {
-			return FamilyMask::MutableEvaluator<Ts...>::getMask();
+			static const FamilyMask::RealType mask = makeMask<FamilyMask::MutableEvaluator<Ts...>>();
+			return FamilyMask::getHandle(mask);
 		}
 
 		static FamilyMaskType readMask() {
-			return FamilyMask::Evaluator<Ts...>::getMask();
+			static const FamilyMask::RealType mask = makeMask<FamilyMask::Evaluator<Ts...>>();
+			return FamilyMask::getHandle(mask);
 		}
 
 		static FamilyMaskType inclusionMask() {
-			return FamilyMask::InclusionEvaluator<Ts...>::getMask();
+			static const FamilyMask::RealType mask = makeMask<FamilyMask::InclusionEvaluator<Ts...>>();
+			return FamilyMask::getHandle(mask);
+		}
+
+		static FamilyMaskType optionalMask() {
+			static const FamilyMask::RealType mask = makeMask<FamilyMask::OptionalEvaluator<Ts...>>();
+			return FamilyMask::getHandle(mask);
+		}
+
+		// Order matters, as it defines the layout of the family's elements
+		static Vector<int> componentIndices() {
+			return { FamilyMask::RetrieveComponentIndex<Ts>::componentIndex... };
 		}
 
 		static void loadComponents(Entity& entity, char* data) {
@@ -26,5 +40,14 @@ namespace Halley {
 		{
 			return sizeof...(Ts);
 		}
+
+	private:
+		template <typename E>
+		static FamilyMask::RealType makeMask()
+		{
+			FamilyMask::RealType mask;
+			E::makeMask(mask);
+			return mask;
+		}
 	};
 }
@@ -11,9 +11,8 @@ namespace Halley
 		virtual ~Message() {}
 		virtual size_t getSize() const = 0;
 
-		/*
+		// Messages are short-lived and sent in bulk, so they're kept in size-matched pools
 		void* operator new(size_t size);
-		void operator delete(void* ptr);
-		*/
+		void operator delete(void* ptr, size_t size);
 	};
 }
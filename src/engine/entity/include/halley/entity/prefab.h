@@ -0,0 +1,96 @@
+#pragma once
+
+#include <memory>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include "entity.h"
+#include <halley/resources/resource.h>
+#include <halley/file_formats/config_file.h>
+#include <halley/data_structures/vector.h>
+
+namespace Halley {
+	class ResourceLoader;
+	class Serializer;
+	class Deserializer;
+
+	// Imported from prefab/*.yaml. The data is already in binary ConfigNode form, so loading doesn't touch YAML,
+	// but it still needs to be turned into a PrefabTemplate before spawning anything.
+	class Prefab : public Resource
+	{
+	public:
+		struct ComponentData
+		{
+			String name;
+			ConfigNode data;
+
+			void serialize(Serializer& s) const;
+			void deserialize(Deserializer& s);
+		};
+
+		Prefab();
+		explicit Prefab(Vector<ComponentData> components);
+
+		const Vector<ComponentData>& getComponents() const;
+
+		void serialize(Serializer& s) const;
+		void deserialize(Deserializer& s);
+
+		static std::unique_ptr<Prefab> loadResource(ResourceLoader& loader);
+		constexpr static AssetType getAssetType() { return AssetType::Prefab; }
+
+		void reload(Resource&& resource) override;
+
+	private:
+		Vector<ComponentData> components;
+	};
+
+	// A set of ready-made components. Instantiating copy-constructs each one straight from its prototype, so
+	// spawning many copies only pays for reading the prefab's config once, when the template is built.
+	// Copies of a template share the same prototypes.
+	class PrefabTemplate
+	{
+	public:
+		// Called for each component in the prefab, and expected to add it to the template
+		using ComponentLoader = std::function<void(PrefabTemplate& target, const String& componentName, const ConfigNode& data)>;
+
+		PrefabTemplate() = default;
+		PrefabTemplate(const Prefab& prefab, const ComponentLoader& loader);
+
+		template <typename T>
+		PrefabTemplate& addComponent(T component)
+		{
+			static_assert(std::is_base_of<Component, T>::value, "Components must extend the Component class");
+			static_assert(std::is_copy_constructible<T>::value, "Prefab components must be copy constructible");
+
+			// Kept off the component pool, since templates can outlive worlds and be built on other threads
+			T* prototype = ::new (::operator new(sizeof(T))) T(std::move(component));
+			Entry entry;
+			entry.prototype = std::shared_ptr<const Component>(prototype, [] (const Component* c)
+			{
+				static_cast<const T*>(c)->~T();
+				::operator delete(const_cast<Component*>(c));
+			});
+			entry.clone = [] (EntityRef& e, const Component& c)
+			{
+				e.addComponent(T(static_cast<const T&>(c)));
+			};
+			components.push_back(std::move(entry));
+			return *this;
+		}
+
+		void instantiate(EntityRef& entity) const;
+
+		size_t getNumComponents() const;
+		bool isEmpty() const;
+
+	private:
+		struct Entry
+		{
+			std::shared_ptr<const Component> prototype;
+			void (*clone)(EntityRef& entity, const Component& prototype) = nullptr;
+		};
+
+		Vector<Entry> components;
+	};
+}
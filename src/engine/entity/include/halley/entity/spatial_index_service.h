@@ -0,0 +1,66 @@
+#pragma once
+
+#include <halley/text/halleystring.h>
+#include "service.h"
+#include "entity_id.h"
+#include <halley/maths/rect.h>
+#include <halley/maths/vector2.h>
+#include <halley/data_structures/vector.h>
+#include <halley/data_structures/hash_map.h>
+#include <halley/data_structures/maybe.h>
+#include <halley/data_structures/aabb_tree.h>
+#include <gsl/span>
+
+namespace Halley {
+	// Entity bounds, kept in a dynamic AABB tree (see AABBTree). Bounds that move a little, by less than the margin, are
+	// updated without touching the tree.
+	//
+	// Typically fed by a system that calls update() for entities whose position changed (see System::invokeChanged)
+	// and remove() from onEntitiesRemoved.
+	// Queries are const and don't use any shared scratch space, so any number of them can run concurrently,
+	// including from parallel systems. Updates must not overlap with queries; declaring this service in both the
+	// updating and querying systems makes the scheduler keep them apart.
+	class SpatialIndexService : public Service
+	{
+	public:
+		struct RayHit
+		{
+			EntityId entity;
+			float distance;
+		};
+
+		using EntityPair = std::pair<EntityId, EntityId>;
+
+		explicit SpatialIndexService(float margin = 4.0f);
+
+		void update(EntityId entity, Rect4f bounds);
+		bool remove(EntityId entity);
+		void clear();
+
+		size_t size() const;
+		Maybe<Rect4f> getBounds(EntityId entity) const;
+
+		// Results are appended to the given vector
+		void query(Rect4f area, Vector<EntityId>& result) const;
+		void queryRadius(Vector2f centre, float radius, Vector<EntityId>& result) const;
+		Maybe<RayHit> raycast(Vector2f from, Vector2f to) const;
+
+		// Broadphase: entities whose bounds overlap, either all of them or only the ones involving an entity updated
+		// since the last call to getMovedPairs(). Results are appended.
+		void getOverlappingPairs(Vector<EntityPair>& result) const;
+		void getMovedPairs(Vector<EntityPair>& result);
+
+		// Batch versions, which spread the queries over the CPU executors
+		void query(gsl::span<const Rect4f> areas, Vector<Vector<EntityId>>& results) const;
+		void queryRadius(gsl::span<const Vector2f> centres, float radius, Vector<Vector<EntityId>>& results) const;
+		void raycast(gsl::span<const std::pair<Vector2f, Vector2f>> rays, Vector<Maybe<RayHit>>& results) const;
+
+	private:
+		AABBTree tree;
+		HashMap<EntityId, AABBTree::ProxyId> proxies;
+		Vector<AABBTree::Pair> pairScratch;
+
+		static EntityId getEntity(uint64_t data);
+		void toEntityPairs(const Vector<AABBTree::Pair>& pairs, Vector<EntityPair>& result) const;
+	};
+}
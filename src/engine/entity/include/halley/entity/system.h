@@ -1,13 +1,17 @@
 #pragma once
 
 #include <halley/data_structures/vector.h>
+#include <halley/data_structures/flat_map.h>
 #include <halley/concurrency/concurrent.h>
+#include <halley/support/profiler.h>
+#include <halley/text/string_id.h>
 #include <initializer_list>
 
 #include "family_binding.h"
 #include "family_mask.h"
 #include "family_type.h"
 #include "entity.h"
+#include "entity_command_buffer.h"
 #include "halley/utils/type_traits.h"
 
 namespace Halley {
@@ -28,30 +32,83 @@ namespace Halley {
 	template <class, class, class = Halley::void_t<>> struct HasOnEntitiesRemoved : std::false_type {};
 	template <class T, class F> struct HasOnEntitiesRemoved<T, F, decltype(std::declval<T>().onEntitiesRemoved(std::declval<Span<F>>()))> : std::true_type { };
 
-	
+
+	// Describes what a system touches, so the World can tell which systems may run concurrently.
+	// A default-constructed instance is exclusive, i.e. it never runs alongside any other system.
+	class SystemDependencies
+	{
+	public:
+		enum Flags {
+			None = 0,
+			Exclusive = 1,
+			API = 2,
+			Resources = 4,
+			SendsMessages = 8,
+			ReceivesMessages = 16
+		};
+
+		SystemDependencies();
+		SystemDependencies(std::initializer_list<int> componentsRead, std::initializer_list<int> componentsWritten, int flags, std::initializer_list<String> services = {});
+
+		bool isExclusive() const;
+		bool conflictsWith(const SystemDependencies& other) const;
+
+	private:
+		FamilyMask::RealType read;
+		FamilyMask::RealType written;
+		Vector<String> services;
+		int flags;
+	};
+
+	// Limits how much of its families a system visits each update through invokeAmortized. Zero means no limit.
+	struct SystemBudget
+	{
+		size_t maxEntities = 0;
+		int64_t maxNanoSeconds = 0;
+
+		SystemBudget() = default;
+		SystemBudget(size_t maxEntities, int64_t maxNanoSeconds = 0) : maxEntities(maxEntities), maxNanoSeconds(maxNanoSeconds) {}
+	};
+
 	class System
 	{
 	public:
-		System(std::initializer_list<FamilyBindingBase*> families, std::initializer_list<int> messageTypesReceived);
+		System(std::initializer_list<FamilyBindingBase*> families, std::initializer_list<int> messageTypesReceived, SystemDependencies dependencies = SystemDependencies());
 		virtual ~System() {}
 
 		String getName() const { return name; }
-		void setName(String n) { name = n; }
+		StringId getNameId() const { return nameId; }
+		void setName(String n) { name = n; nameId = StringId(name); profileName = nameId.getString().c_str(); }
 		size_t getEntityCount() const;
 		void tryInit();
 
 		long long getNanoSecondsTaken() const { return timer.lastElapsedNanoSeconds(); }
 		long long getNanoSecondsTakenAvg() const { return timer.averageElapsedNanoSeconds(); }
+		TimeHistogramStats getTimeStats(TimeHistogram::Window window) const { return timer.getHistogram().getStats(window); }
 		void setCollectSamples(bool collect);
+		const SystemDependencies& getDependencies() const { return dependencies; }
+
+		// For systems that don't need to see every entity every frame (path refreshes, AI re-planning...). Both limits
+		// are scaled down by the World when its steps go over target (see World::setStepTimeTarget).
+		void setBudget(SystemBudget budget);
+		const SystemBudget& getBudget() const;
 
 	protected:
 		const HalleyAPI& doGetAPI() const { return *api; }
 		World& doGetWorld() const { return *world; }
 
+		// Structural changes made through this are safe from parallel systems and invokeParallel
+		EntityCommandBuffer& getCommandBuffer() const;
+
 		virtual void initBase() {}
 		virtual void updateBase(Time) {}
 		virtual void renderBase(RenderContext&) {}
+
+		// Called on the main thread before render when rendering is pipelined (see Stage::isRenderPipelined). Render
+		// systems that support it should copy what they draw here, and only read that copy while rendering.
+		virtual void onPrepareRender() {}
 		virtual void onMessagesReceived(int, Message**, size_t*, size_t) {}
+		virtual void onMessagesBroadcast(int, Message**, size_t) {}
 
 		template <typename F, typename V>
 		static void invokeIndividual(F&& f, V& fam)
@@ -62,19 +119,101 @@ namespace Halley {
 		}
 
 		template <typename F, typename V>
-		static void invokeParallel(F&& f, V& fam)
+		static void invokeParallel(F&& f, V& fam, size_t grain = 16)
 		{
-			Concurrent::foreach(std::begin(fam), std::end(fam), [&] (auto& e) {
-				f(e);
+			// Commands recorded while processing each element are keyed by its index, to keep them deterministic
+			auto first = std::begin(fam);
+			const uint64_t sortKey = EntityCommandBuffer::getSortKey() & ~uint64_t(0xFFFFFFFF);
+			Concurrent::parallelFor(Range<size_t>(0, fam.size()), grain, [&] (size_t begin, size_t end) {
+				EntityCommandBuffer::SortKeyScope scope(sortKey);
+				for (size_t i = begin; i < end; ++i) {
+					EntityCommandBuffer::setSortKey(sortKey | uint64_t(i));
+					f(first[i]);
+				}
 			});
 		}
 
+		// Visits family elements round-robin, resuming where the last update left off, until the system's budget runs out
+		// or every element has been visited once. Time is shared between all calls in the same update, and checked every
+		// few elements, so it can go over by a little. Returns how many elements were visited.
+		template <typename F, typename V>
+		size_t invokeAmortized(F&& f, V& fam)
+		{
+			const size_t n = fam.size();
+			if (n == 0) {
+				return 0;
+			}
+
+			auto& cursor = amortizedCursors[static_cast<const void*>(&fam)];
+			cursor %= n;
+			const size_t maxCount = getAmortizedCount(n);
+			const int64_t deadline = getAmortizedDeadline();
+
+			auto first = std::begin(fam);
+			size_t visited = 0;
+			while (visited < maxCount) {
+				f(first[cursor]);
+				cursor = cursor + 1 == n ? 0 : cursor + 1;
+				++visited;
+				if (deadline != 0 && (visited & 15) == 0 && Profiler::getTimeNs() >= deadline) {
+					break;
+				}
+			}
+			return visited;
+		}
+
+		// Marks component T of a family element as changed by this system
+		template <typename T, typename E>
+		void markChanged(E& element)
+		{
+			constexpr int id = FamilyMask::RetrieveComponentIndex<T>::componentIndex;
+			element.entityPtr->markComponentChanged(id, changeVersion);
+			markComponentTypeChanged(id);
+		}
+
+		// True if any of the components Ts of a family element was added or marked as changed since this system last ran
+		template <typename... Ts, typename E>
+		bool hasChanged(const E& element) const
+		{
+			const int ids[] = { FamilyMask::RetrieveComponentIndex<Ts>::componentIndex... };
+			for (int id: ids) {
+				if (element.entityPtr->getComponentVersion(id) > lastRunVersion) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		// Like invokeIndividual, but only visits elements for which hasChanged<Ts...> is true
+		template <typename... Ts, typename F, typename V>
+		void invokeChanged(F&& f, V& fam)
+		{
+			const int ids[] = { FamilyMask::RetrieveComponentIndex<Ts>::componentIndex... };
+			if (!anyComponentTypeChanged(ids, sizeof...(Ts))) {
+				return;
+			}
+			for (auto& e : fam) {
+				if (hasChanged<Ts...>(e)) {
+					f(e);
+				}
+			}
+		}
+
+		uint32_t getLastRunVersion() const { return lastRunVersion; }
+		uint32_t getChangeVersion() const { return changeVersion; }
+
 		template <typename T>
 		void sendMessageGeneric(EntityId entityId, const T& msg)
 		{
-			auto toSend = std::make_unique<T>();
-			*toSend = msg;
-			doSendMessage(entityId, std::move(toSend), sizeof(T), T::messageIndex);
+			world->template getMessageQueue<T>().push(entityId, msg, systemId);
+			onMessageTypeSent(T::messageIndex);
+		}
+
+		// Stored once, and delivered once to each system receiving T through onMessagesBroadcast
+		template <typename T>
+		void broadcastMessageGeneric(const T& msg)
+		{
+			sendMessageGeneric(EntityId(), msg);
 		}
 
 		template <typename T, typename std::enable_if<HasInitMember<T>::value, int>::type = 0>
@@ -125,26 +264,44 @@ namespace Halley {
 
 		Vector<FamilyBindingBase*> families;
 		Vector<int> messageTypesReceived;
-		Vector<EntityId> messagesSentTo;
-		Vector<std::pair<EntityId, MessageEntry>> outbox;
+		Vector<int> messageTypesSent;
+
+		// Scratch space for delivery, kept between frames so its storage is reused
+		Vector<std::pair<size_t, size_t>> messageMatches; // Queue index, element index
+		Vector<Message*> messageBox;
+		Vector<size_t> messageElemIdx;
+		SystemDependencies dependencies;
 
 		World* world = nullptr;
 		const HalleyAPI* api = nullptr;
 		String name;
+		StringId nameId;
+		const char* profileName = "";
 		int systemId = -1;
+		uint32_t lastRunVersion = 0;
+		uint32_t changeVersion = 0;
 		bool initialised = false;
 		bool collectSamples = false;
 
 		StopwatchAveraging timer;
 
+		SystemBudget budget;
+		FlatMap<const void*, size_t> amortizedCursors; // By family, for invokeAmortized
+		int64_t updateStartNs = 0;
+
 		void doUpdate(Time time);
 		void doRender(RenderContext& rc);
+		void doPrepareRender();
 		void onAddedToWorld(World& world, int id);
+		void advanceChangeVersion(uint32_t version);
+		void markComponentTypeChanged(int id);
+		bool anyComponentTypeChanged(const int* ids, size_t n) const;
+		size_t getAmortizedCount(size_t familySize) const;
+		int64_t getAmortizedDeadline() const;
 
 		void purgeMessages();
 		void processMessages();
-		void doSendMessage(EntityId target, std::unique_ptr<Message> msg, size_t msgSize, int msgId);
-		void dispatchMessages();
+		void onMessageTypeSent(int msgType);
 	};
 
 }
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "entity_id.h"
+#include "service.h"
+#include <halley/maths/transform2d.h>
+#include <halley/data_structures/vector.h>
+#include <halley/data_structures/hash_map.h>
+#include <halley/data_structures/maybe.h>
+
+namespace Halley {
+	// Parent/child transforms for entities. Nodes are kept in flat arrays, one per depth level, with siblings
+	// next to each other and ordered by their parent's position in the level above. update() walks the levels
+	// in order, so every parent is done before its children, and each level is split over the CPU executors.
+	// Only nodes whose local transform changed, and their descendants, are recomputed.
+	//
+	// Typically a game system calls setLocalTransform() when a transform component changes (see System::invokeChanged),
+	// calls update() once, and then applies getWorldTransform() to its sprites (see Sprite::setTransform) before
+	// handing them to the SpritePainter. Changing parents is more expensive, as the levels are rebuilt on the next update.
+	class TransformHierarchyService : public Service
+	{
+	public:
+		// A node whose parent isn't in the hierarchy by the next update() becomes a root, keeping its local transform.
+		// That includes the children of removed nodes.
+		void add(EntityId entity, const Transform2D& local = Transform2D(), EntityId parent = EntityId());
+		bool remove(EntityId entity);
+		void clear();
+
+		bool contains(EntityId entity) const;
+		size_t size() const;
+
+		void setParent(EntityId entity, EntityId parent);
+		EntityId getParent(EntityId entity) const;
+
+		void setLocalTransform(EntityId entity, const Transform2D& local);
+		const Transform2D& getLocalTransform(EntityId entity) const;
+
+		// These are only up to date after update()
+		const Transform2D& getWorldTransform(EntityId entity) const;
+		size_t getDepth(EntityId entity) const;
+
+		void update();
+
+	private:
+		struct Level
+		{
+			Vector<EntityId> entities;
+			Vector<EntityId> parentIds;
+			Vector<uint32_t> parents;
+			Vector<Transform2D> local;
+			Vector<Transform2D> world;
+			Vector<uint8_t> dirty;
+
+			size_t size() const { return entities.size(); }
+			void push(EntityId entity, EntityId parentId, uint32_t parent, const Transform2D& t);
+			void clear();
+		};
+
+		struct Location
+		{
+			uint32_t depth;
+			uint32_t index;
+		};
+
+		static constexpr uint32_t noParent = 0xFFFFFFFFu;
+		static constexpr uint8_t removedNode = 0xFF;
+
+		Vector<Level> levels;
+		HashMap<EntityId, Location> locations;
+		bool structureDirty = false;
+
+		const Location& getLocation(EntityId entity) const;
+		void rebuild();
+		void updateLevel(size_t depth);
+	};
+}
@@ -1,6 +1,13 @@
 #pragma once
 
+#include <new>
+#include <typeinfo>
+#include <utility>
+#include <type_traits>
 #include <halley/data_structures/vector.h>
+#include <halley/bytes/byte_serializer.h>
+#include <halley/support/exception.h>
+#include "component.h"
 
 namespace Halley {
 	class TypeDeleterBase
@@ -8,9 +15,31 @@ namespace Halley {
 	public:
 		virtual ~TypeDeleterBase() {}
 		virtual size_t getSize() = 0;
+		virtual size_t getAlignment() = 0;
 		virtual void callDestructor(void* ptr) = 0;
+		virtual void moveConstruct(void* dst, void* src) = 0;
+
+		virtual Component* create() = 0;
+		virtual bool isSerializable() = 0;
+		virtual bool isReplicated() = 0;
+		virtual void serialize(Serializer& s, const void* ptr) = 0;
+		virtual void deserialize(Deserializer& s, void* ptr) = 0;
 	};
 
+	// Components generated with "serializable: true" have serialize/deserialize methods, used by World snapshots
+	template <typename T, typename = void>
+	struct IsSerializableComponent : std::false_type {};
+
+	template <typename T>
+	struct IsSerializableComponent<T, decltype(std::declval<const T&>().serialize(std::declval<Serializer&>()), std::declval<T&>().deserialize(std::declval<Deserializer&>()), void())> : std::true_type {};
+
+	// Components generated with "replicated: true" are sent over the network by EntityReplicator
+	template <typename T, typename = void>
+	struct IsReplicatedComponent : std::false_type {};
+
+	template <typename T>
+	struct IsReplicatedComponent<T, typename std::enable_if<T::replicated>::type> : IsSerializableComponent<T> {};
+
 	class ComponentDeleterTable
 	{
 	public:
@@ -28,6 +57,13 @@ namespace Halley {
 			return (*getDeleters())[uid];
 		}
 
+		// Returns null if no component of that type has been created yet
+		static TypeDeleterBase* tryGet(int uid)
+		{
+			auto& m = *getDeleters();
+			return uid >= 0 && uid < int(m.size()) ? m[uid] : nullptr;
+		}
+
 		static Vector<TypeDeleterBase*>*& getDeleters()
 		{
 			static Vector<TypeDeleterBase*>* map;
@@ -53,6 +89,11 @@ namespace Halley {
 			return sizeof(T);
 		}
 
+		size_t getAlignment() override
+		{
+			return alignof(T);
+		}
+
 		void callDestructor(void* ptr) override
 		{
 #ifdef _MSC_VER
@@ -60,5 +101,49 @@ namespace Halley {
 #endif
 			static_cast<T*>(ptr)->~T();
 		}
+
+		void moveConstruct(void* dst, void* src) override
+		{
+			::new (dst) T(std::move(*static_cast<T*>(src)));
+		}
+
+		Component* create() override
+		{
+			return new T();
+		}
+
+		bool isSerializable() override
+		{
+			return IsSerializableComponent<T>::value;
+		}
+
+		bool isReplicated() override
+		{
+			return IsReplicatedComponent<T>::value;
+		}
+
+		void serialize(Serializer& s, const void* ptr) override
+		{
+			doSerialize(s, static_cast<const T*>(ptr), IsSerializableComponent<T>());
+		}
+
+		void deserialize(Deserializer& s, void* ptr) override
+		{
+			doDeserialize(s, static_cast<T*>(ptr), IsSerializableComponent<T>());
+		}
+
+	private:
+		static void doSerialize(Serializer& s, const T* ptr, std::true_type) { ptr->serialize(s); }
+		static void doDeserialize(Deserializer& s, T* ptr, std::true_type) { ptr->deserialize(s); }
+
+		static void doSerialize(Serializer&, const T*, std::false_type)
+		{
+			throw Exception("Component " + String(typeid(T).name()) + " is not serializable.", HalleyExceptions::Entity);
+		}
+
+		static void doDeserialize(Deserializer&, T*, std::false_type)
+		{
+			throw Exception("Component " + String(typeid(T).name()) + " is not serializable.", HalleyExceptions::Entity);
+		}
 	};
 }
@@ -3,16 +3,25 @@
 #include <memory>
 #include <typeinfo>
 #include <type_traits>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <array>
+#include <functional>
+#include <gsl/span>
 #include "entity_id.h"
 #include "family_mask.h"
 #include "family.h"
 #include <halley/time/halleytime.h>
 #include <halley/text/halleystring.h>
+#include <halley/text/string_id.h>
 #include <halley/data_structures/mapped_pool.h>
 #include <halley/time/stopwatch.h>
 #include <halley/data_structures/vector.h>
 #include <halley/data_structures/tree_map.h>
+#include <halley/data_structures/hash_map.h>
 #include "service.h"
+#include "entity_message_queue.h"
 
 namespace Halley {
 	class ConfigNode;
@@ -21,6 +30,13 @@ namespace Halley {
 	class System;
 	class Painter;
 	class HalleyAPI;
+	class ArchetypeStorage;
+	class EntityCommandBuffer;
+	class PrefabTemplate;
+	class WorldSnapshot;
+	class Serializer;
+	class Deserializer;
+	struct TelemetryFrame;
 
 	class World
 	{
@@ -30,14 +46,23 @@ namespace Halley {
 
 		void step(TimeLine timeline, Time elapsed);
 		void render(RenderContext& rc) const;
+		void prepareRender(); // For pipelined rendering, see Stage::isRenderPipelined
 		bool hasSystemsOnTimeLine(TimeLine timeline) const;
 		
 		int64_t getAverageTime(TimeLine timeline) const;
+		TimeHistogramStats getTimeStats(TimeLine timeline, TimeHistogram::Window window) const;
+
+		// Whole-run percentiles of the world and each of its systems, if collecting metrics
+		String getTimeReport() const;
+
+		// The entity count, plus the average time of each system as "system.<name>", if collecting metrics
+		void addTelemetry(TelemetryFrame& frame) const;
 
 		System& addSystem(std::unique_ptr<System> system, TimeLine timeline);
 		void removeSystem(System& system);
 		Vector<System*> getSystems();
 		System& getSystem(const String& name);
+		System& getSystem(StringId name);
 		Vector<std::unique_ptr<System>>& getSystems(TimeLine timeline);
 		const Vector<std::unique_ptr<System>>& getSystems(TimeLine timeline) const;
 
@@ -51,32 +76,96 @@ namespace Halley {
 			return *dynamic_cast<T*>(&getService(typeid(T).name()));
 		}
 
+		// Archetype storage keeps components of entities with the same mask in contiguous arrays.
+		// Component pointers are only stable until the entity's mask changes. Must be set before any entity is created.
+		void setArchetypeStorage(bool enabled);
+		bool hasArchetypeStorage() const;
+
+		// Runs systems whose SystemDependencies don't conflict concurrently on the CPU executors. Update timelines only.
+		void setParallelSystems(bool enabled);
+		bool hasParallelSystems() const;
+
+		// When a step takes longer than this, the budgets of amortized systems (see System::setBudget) shrink for the
+		// next steps, down to a tenth, and then grow back while steps are under it. Zero (the default) disables it.
+		void setStepTimeTarget(int64_t ns);
+		float getBudgetScale() const;
+
 		EntityRef createEntity();
 		void destroyEntity(EntityId id);
+
+		// Bulk versions of the above, for level loads and mass spawns. The prototype, if given, is invoked on each new entity.
+		Vector<EntityId> createEntities(size_t count, std::function<void(EntityRef&)> prototype = {});
+		void destroyEntities(gsl::span<const EntityId> ids);
+
+		// Spawns copies of the template's components, without going through config
+		EntityRef instantiatePrefab(const PrefabTemplate& prefab);
+		Vector<EntityId> instantiatePrefab(const PrefabTemplate& prefab, size_t count);
+
 		EntityRef getEntity(EntityId id);
 		Entity* tryGetEntity(EntityId id);
 		size_t numEntities() const;
 
 		void spawnPending(); // Warning: use with care, will invalidate entities
 
+		// Writes every entity and its components into the snapshot, reusing its buffers. Pending entities are spawned first.
+		// Restoring replaces all entities with the ones in the snapshot, keeping their ids, and puts the id allocator
+		// back in the same state, so entities created afterwards get the same ids as they did the first time.
+		// Message queues and system state aren't included.
+		void snapshot(WorldSnapshot& snapshot);
+		void restore(const WorldSnapshot& snapshot);
+
+		// Takes entities out of the world, writing them into the snapshot (replacing its contents), but keeps their ids
+		// reserved, so restoreEntities can bring them back as they were. Until then, they're not in any family and
+		// tryGetEntity doesn't find them. Ids that aren't alive are skipped. Used by WorldPartition.
+		void evictEntities(gsl::span<const EntityId> ids, WorldSnapshot& snapshot);
+		void restoreEntities(const WorldSnapshot& snapshot);
+
+		// Writes the components of a single entity, or applies them, updating the ones it already has and adding the rest.
+		// With replicatedOnly, only components generated with "replicated: true" are written. Used by entity replication.
+		void serializeEntity(const Entity& entity, Serializer& s, bool replicatedOnly) const;
+		void deserializeEntity(Entity& entity, Deserializer& s);
+
+		// Messages sent by systems, by type; see System::sendMessageGeneric
+		template <typename T>
+		EntityMessageQueue<T>& getMessageQueue()
+		{
+			auto& queue = getMessageQueueSlot(T::messageIndex);
+			if (!queue) {
+				queue = std::make_unique<EntityMessageQueue<T>>();
+			}
+			return static_cast<EntityMessageQueue<T>&>(*queue);
+		}
+		EntityMessageQueueBase* tryGetMessageQueue(int msgType) const;
+
+		// Returns the calling thread's command buffer. It's safe to record into it from parallel systems and tasks,
+		// and all buffers are applied by the next spawnPending.
+		EntityCommandBuffer& getCommandBuffer();
+
 		void onEntityDirty();
 
+		// Change tracking: the version is bumped for every system update and every entity refresh
+		uint32_t getChangeVersion() const;
+		uint32_t getComponentTypeVersion(int componentId) const;
+		void markComponentTypeChanged(int componentId, uint32_t version);
+
 		template <typename T>
 		Family& getFamily()
 		{
-			// Disable re-using of families due to optional components messing them up
-			/*
-			FamilyMaskType mask = T::Type::readMask();
-			auto iter = families.find(mask);
-			if (iter != families.end()) {
-				return *iter->second;
+			// Families are shared between systems when they have the same components in the same order,
+			// as that's what defines their storage layout. Optional components must match too.
+			const auto optionalMask = T::Type::optionalMask();
+			const auto componentIndices = T::Type::componentIndices();
+			auto& candidates = familyIndex[T::Type::inclusionMask()];
+			for (auto& f: candidates) {
+				if (f->optionalMask == optionalMask && f->componentIndices == componentIndices) {
+					return *f;
+				}
 			}
-			*/
 
 			auto newFam = std::make_unique<FamilyImpl<T>>();
 			Family* newFamPtr = newFam.get();
 			onAddFamily(*newFamPtr);
-			//families[mask] = std::move(newFam);
+			candidates.push_back(newFamPtr);
 			families.emplace_back(std::move(newFam));
 			return *newFamPtr;
 		}
@@ -84,33 +173,56 @@ namespace Halley {
 	private:
 		const HalleyAPI* api;
 		std::array<Vector<std::unique_ptr<System>>, static_cast<int>(TimeLine::NUMBER_OF_TIMELINES)> systems;
+		std::array<Vector<size_t>, static_cast<int>(TimeLine::NUMBER_OF_TIMELINES)> systemBatchEnds;
 		bool collectMetrics = false;
 		bool entityDirty = false;
+		bool archetypeStorage = false;
+		bool parallelSystems = false;
+		bool systemBatchesDirty = true;
+		int64_t stepTimeTarget = 0;
+		float budgetScale = 1.0f;
 		
 		Vector<Entity*> entities;
 		Vector<Entity*> entitiesPendingCreation;
 		MappedPool<Entity*> entityMap;
 
-		//TreeMap<FamilyMaskType, std::unique_ptr<Family>> families;
 		Vector<std::unique_ptr<Family>> families;
+		HashMap<FamilyMaskType, Vector<Family*>> familyIndex;
 		TreeMap<String, std::shared_ptr<Service>> services;
+		Vector<std::unique_ptr<EntityMessageQueueBase>> messageQueues;
+		int nextSystemId = 0;
 
-		TreeMap<FamilyMaskType, std::vector<Family*>> familyCache;
+		HashMap<FamilyMaskType, std::vector<Family*>> familyCache;
+		TreeMap<FamilyMaskType, std::unique_ptr<ArchetypeStorage>> archetypes;
 
 		mutable std::array<StopwatchAveraging, 3> timer;
 
-		void allocateEntity(Entity* entity);
+		const uint64_t worldId;
+		uint32_t changeVersion = 0;
+		std::array<std::atomic<uint32_t>, FamilyMask::maxComponents> componentTypeVersions;
+		std::mutex commandBuffersMutex;
+		Vector<std::pair<std::thread::id, std::unique_ptr<EntityCommandBuffer>>> commandBuffers;
+		Vector<EntityCommandBuffer*> commandBuffersToApply;
+
+		Entity& allocateEntity();
+		void restoreEntity(EntityId id, gsl::span<const gsl::byte> data);
 		void updateEntities();
 		void initSystems() const;
 		void deleteEntity(Entity* entity);
+		void applyCommandBuffers();
 
 		void updateSystems(TimeLine timeline, Time elapsed);
+		void updateSystemsParallel(TimeLine timeline, Time elapsed);
+		void buildSystemBatches();
 		void renderSystems(RenderContext& rc) const;
+		void prepareRenderSystems();
 		
 		void onAddFamily(Family& family);
 
 		Service& getService(const String& name) const;
+		std::unique_ptr<EntityMessageQueueBase>& getMessageQueueSlot(int msgType);
 
 		const std::vector<Family*>& getFamiliesFor(const FamilyMaskType& mask);
+		ArchetypeStorage& getArchetype(const FamilyMaskType& mask);
 	};
 }
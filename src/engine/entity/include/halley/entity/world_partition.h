@@ -0,0 +1,93 @@
+#pragma once
+
+#include "entity_id.h"
+#include "world_snapshot.h"
+#include <halley/maths/vector2.h>
+#include <halley/data_structures/vector.h>
+#include <halley/data_structures/hash_map.h>
+#include <halley/concurrency/future.h>
+#include <halley/file/path.h>
+#include <gsl/span>
+#include <memory>
+
+namespace Halley {
+	class World;
+
+	// Splits a large map into square cells, and keeps only the cells near the focus points (cameras, players...) in the
+	// World. Far cells are evicted (see World::evictEntities), so their entities aren't in any family and cost nothing,
+	// and their snapshot is written to storageDir on the disk executor. Cells coming back into range are read back in
+	// the background and restored a later update, with the same entity ids.
+	//
+	// Which cell each entity is in is up to the game: add() it once it's created, move() it when it crosses into
+	// another cell (e.g. from a system with the position), and remove() it when it's destroyed. An entity that moves
+	// into a cell that isn't loaded is evicted along with it, and comes back when the cell does.
+	//
+	// Entities in other cells must not be referenced by id while evicted, as tryGetEntity won't find them.
+	class WorldPartition
+	{
+	public:
+		WorldPartition(World& world, Path storageDir, float cellSize, float activeRadius, float evictRadius);
+		~WorldPartition();
+
+		WorldPartition(const WorldPartition& other) = delete;
+		WorldPartition& operator=(const WorldPartition& other) = delete;
+
+		void add(EntityId id, Vector2f position);
+		void move(EntityId id, Vector2f position);
+		void remove(EntityId id);
+
+		// Cells within activeRadius of any focus point are loaded, and ones further than evictRadius from all of them
+		// are evicted. Call once per frame, before the world steps.
+		void update(gsl::span<const Vector2f> focusPoints);
+
+		// Blocks until every cell that's in range is loaded, e.g. while on a loading screen
+		void waitForLoads(gsl::span<const Vector2f> focusPoints);
+
+		Vector2i getCell(Vector2f position) const;
+		bool isLoaded(Vector2i cell) const;
+		size_t getNumLoadedCells() const;
+		size_t getNumEvictedEntities() const;
+
+	private:
+		enum class CellState
+		{
+			Loaded,
+			Evicted,
+			Loading
+		};
+
+		struct Cell
+		{
+			Vector2i coords;
+			CellState state = CellState::Loaded;
+			Vector<EntityId> entities; // Live, while loaded; otherwise, the ones waiting to join it
+			size_t numEvicted = 0;
+
+			std::shared_ptr<WorldSnapshot> evicted; // Until it's written to disk
+			Vector<WorldSnapshot> strays; // Evicted after the cell was, kept in memory until it's loaded
+			Future<void> saving;
+			Future<Bytes> loading;
+		};
+
+		World& world;
+		Path storageDir;
+		float cellSize;
+		float activeRadius;
+		float evictRadius;
+
+		HashMap<Vector2i, Cell> cells;
+		HashMap<EntityId, Vector2i> entityCells;
+		size_t numEvictedEntities = 0;
+
+		Cell& getOrCreateCell(Vector2i coords);
+		float getDistance(const Cell& cell, gsl::span<const Vector2f> focusPoints) const;
+		Path getCellPath(Vector2i coords) const;
+
+		void evict(Cell& cell);
+		void evictStrays(Cell& cell);
+		void load(Cell& cell);
+		void finishLoading(Cell& cell);
+		void finishSaving(Cell& cell);
+		void restore(Cell& cell, const WorldSnapshot& snapshot);
+	};
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "entity_id.h"
+#include <halley/data_structures/vector.h>
+#include <halley/utils/utils.h>
+#include <gsl/span>
+
+namespace Halley {
+	class Serializer;
+	class Deserializer;
+	class WorldSnapshotDelta;
+
+	// Every entity and component of a World, taken with World::snapshot. Each entity's data is contiguous in a
+	// single buffer, so snapshots can be kept around cheaply (e.g. a ring of them for rollback) and compared per entity.
+	// Only components generated with "serializable: true" can be snapshotted.
+	class WorldSnapshot
+	{
+		friend class World;
+
+	public:
+		void clear();
+
+		size_t getNumEntities() const;
+		size_t getSizeBytes() const;
+		EntityId getEntityId(size_t idx) const;
+		gsl::span<const gsl::byte> getEntityData(size_t idx) const;
+
+		void serialize(Serializer& s) const;
+		void deserialize(Deserializer& s);
+
+		// Only keeps the entities that were added or changed since base, plus the order of the entities
+		static WorldSnapshotDelta makeDelta(const WorldSnapshot& base, const WorldSnapshot& current);
+		static WorldSnapshot applyDelta(const WorldSnapshot& base, const WorldSnapshotDelta& delta);
+
+	private:
+		Bytes poolState;
+		Vector<EntityId> entityIds;
+		Vector<uint32_t> offsets;
+		Bytes data;
+
+		void addEntity(EntityId id, gsl::span<const gsl::byte> entityData);
+	};
+
+	class WorldSnapshotDelta
+	{
+		friend class WorldSnapshot;
+
+	public:
+		size_t getNumChanged() const;
+
+		void serialize(Serializer& s) const;
+		void deserialize(Deserializer& s);
+
+	private:
+		Vector<EntityId> order;
+		WorldSnapshot changed;
+	};
+}
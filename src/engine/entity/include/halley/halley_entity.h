@@ -5,7 +5,14 @@ namespace Halley {} // Get GitHub to realise this is C++ :3
 #include "entity/component.h"
 #include "entity/message.h"
 #include "entity/service.h"
+#include "entity/spatial_index_service.h"
 #include "entity/system.h"
+#include "entity/transform_hierarchy_service.h"
 #include "entity/world.h"
+#include "entity/world_snapshot.h"
+#include "entity/world_partition.h"
+#include "entity/entity_command_buffer.h"
+#include "entity/entity_replication.h"
 #include "entity/family_binding.h"
 #include "entity/family.h"
+#include "entity/prefab.h"
@@ -0,0 +1,88 @@
+#include "archetype_storage.h"
+#include "type_deleter.h"
+#include <halley/support/exception.h>
+#include <halley/utils/utils.h>
+#include <halley/text/string_converter.h>
+
+using namespace Halley;
+
+ArchetypeStorage::ArchetypeStorage(FamilyMaskType mask)
+	: mask(mask)
+{
+	auto& bits = mask.getRealValue();
+	for (size_t i = 0; i < bits.size(); ++i) {
+		if (bits[i]) {
+			TypeDeleterBase* deleter = ComponentDeleterTable::get(int(i));
+			if (!deleter) {
+				throw Exception("Component type " + toString(i) + " has not been registered.", HalleyExceptions::Entity);
+			}
+
+			Column column;
+			column.componentId = int(i);
+			column.alignment = std::max(deleter->getAlignment(), sizeof(void*));
+			column.stride = alignUp(std::max(deleter->getSize(), size_t(1)), column.alignment);
+
+			if (int(columnIndex.size()) <= column.componentId) {
+				columnIndex.resize(column.componentId + 1, -1);
+			}
+			columnIndex[column.componentId] = int(columns.size());
+			columns.push_back(std::move(column));
+		}
+	}
+}
+
+ArchetypeStorage::~ArchetypeStorage()
+{
+	// Components are destroyed by their entities; this only releases the memory
+	for (auto& column: columns) {
+		for (auto& allocation: column.allocations) {
+			delete[] allocation;
+		}
+	}
+}
+
+size_t ArchetypeStorage::allocSlot()
+{
+	++liveSlots;
+	if (!freeSlots.empty()) {
+		size_t slot = freeSlots.back();
+		freeSlots.pop_back();
+		return slot;
+	}
+
+	if (slotCount % chunkSize == 0) {
+		addChunk();
+	}
+	return slotCount++;
+}
+
+void ArchetypeStorage::freeSlot(size_t slot)
+{
+	Expects(slot < slotCount);
+	Expects(liveSlots > 0);
+	--liveSlots;
+
+	if (liveSlots == 0) {
+		// Everything is free, so start filling from the front again
+		freeSlots.clear();
+		slotCount = 0;
+	} else {
+		freeSlots.push_back(slot);
+	}
+}
+
+void ArchetypeStorage::addChunk()
+{
+	const size_t chunkIdx = slotCount / chunkSize;
+	for (auto& column: columns) {
+		if (column.chunks.size() > chunkIdx) {
+			// Reusing a chunk left over from a previous fill
+			continue;
+		}
+
+		char* allocation = new char[column.stride * chunkSize + column.alignment];
+		auto base = reinterpret_cast<size_t>(allocation);
+		column.allocations.push_back(allocation);
+		column.chunks.push_back(reinterpret_cast<char*>(alignUp(base, column.alignment)));
+	}
+}
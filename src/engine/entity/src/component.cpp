@@ -8,7 +8,7 @@ using namespace Halley;
 
 void* Component::operator new(size_t size)
 {
-	return PoolPool::getPool(size)->alloc();
+	return PoolPool::alloc(size);
 }
 
 void Component::operator delete(void*)
@@ -1,10 +1,13 @@
 #include <halley/data_structures/memory_pool.h>
 #include "entity.h"
 #include "world.h"
+#include "archetype_storage.h"
+#include <algorithm>
 
 using namespace Halley;
 
 Entity::Entity()
+	: componentSlots(mask.getComponentSlots())
 {
 	liveComponents = 0;
 }
@@ -15,6 +18,11 @@ Entity::~Entity()
 		deleteComponent(i->second, i->first);
 	}
 	liveComponents = 0;
+
+	if (archetype) {
+		archetype->freeSlot(archetypeSlot);
+		archetype = nullptr;
+	}
 }
 
 void Entity::addComponent(Component* component, int id)
@@ -38,7 +46,37 @@ void Entity::deleteComponent(Component* component, int id)
 {
 	TypeDeleterBase* deleter = ComponentDeleterTable::get(id);
 	deleter->callDestructor(component);
-	PoolPool::getPool(deleter->getSize())->free(component);
+	if (!isOwnedByArchetype(component, id)) {
+		PoolPool::free(component, deleter->getSize());
+	}
+}
+
+bool Entity::isOwnedByArchetype(Component* component, int id) const
+{
+	return archetype && archetype->getComponent(archetypeSlot, id) == component;
+}
+
+void Entity::moveToArchetype(ArchetypeStorage& storage)
+{
+	Expects(storage.getMask() == mask);
+	if (archetype == &storage) {
+		return;
+	}
+
+	const size_t slot = storage.allocSlot();
+	for (auto& c: components) {
+		Component* dst = storage.getComponent(slot, c.first);
+		Expects(dst);
+		ComponentDeleterTable::get(c.first)->moveConstruct(dst, c.second);
+		deleteComponent(c.second, c.first);
+		c.second = dst;
+	}
+
+	if (archetype) {
+		archetype->freeSlot(archetypeSlot);
+	}
+	archetype = &storage;
+	archetypeSlot = slot;
 }
 
 void Entity::onReady()
@@ -58,10 +96,11 @@ FamilyMaskType Entity::getMask() const
 	return mask;
 }
 
-void Entity::refresh()
+void Entity::refresh(uint32_t version)
 {
 	if (dirty) {
 		dirty = false;
+		const uint8_t* oldSlots = componentSlots;
 
 		// Delete stale components
 		for (int i = liveComponents; i < int(components.size()); ++i) {
@@ -69,12 +108,33 @@ void Entity::refresh()
 		}
 		components.resize(liveComponents);
 
+		// Sort by id, so the mask's slot table can find them. If a component was added twice, the first one wins.
+		std::stable_sort(components.begin(), components.end(), [] (const std::pair<int, Component*>& a, const std::pair<int, Component*>& b) { return a.first < b.first; });
+		for (size_t i = 1; i < components.size(); ) {
+			if (components[i].first == components[i - 1].first) {
+				deleteComponent(components[i].second, components[i].first);
+				components.erase(components.begin() + i);
+			} else {
+				++i;
+			}
+		}
+		liveComponents = int(components.size());
+
 		// Re-generate mask
 		auto m = FamilyMask::RealType();
 		for (auto i : components) {
 			FamilyMask::setBit(m, i.first);
 		}
 		mask = FamilyMask::getHandle(m);
+		componentSlots = mask.getComponentSlots();
+
+		// Components that were already there keep their version, new ones are stamped with the current one
+		Vector<uint32_t> newVersions(components.size());
+		for (size_t i = 0; i < components.size(); ++i) {
+			const uint8_t oldSlot = oldSlots[components[i].first];
+			newVersions[i] = oldSlot == FamilyMask::noComponentSlot ? version : componentVersions[oldSlot];
+		}
+		componentVersions = std::move(newVersions);
 	}
 }
 
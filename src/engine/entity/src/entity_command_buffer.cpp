@@ -0,0 +1,143 @@
+#include "entity_command_buffer.h"
+#include "world.h"
+#include <algorithm>
+
+using namespace Halley;
+
+namespace {
+	thread_local uint64_t currentSortKey = 0;
+}
+
+EntityCommandBuffer::SortKeyScope::SortKeyScope(uint64_t key)
+	: prevKey(currentSortKey)
+{
+	currentSortKey = key;
+}
+
+EntityCommandBuffer::SortKeyScope::~SortKeyScope()
+{
+	currentSortKey = prevKey;
+}
+
+EntityCommandBuffer::Command::Command(CommandType type, Target target)
+	: type(type)
+	, target(target)
+	, sortKey(currentSortKey)
+{
+}
+
+EntityCommandBuffer::~EntityCommandBuffer()
+{
+	clear();
+}
+
+EntityCommandBuffer::PendingEntity EntityCommandBuffer::createEntity()
+{
+	PendingEntity result(nPending++);
+	commands.push_back(Command(CommandType::CreateEntity, Target(result)));
+	return result;
+}
+
+void EntityCommandBuffer::destroyEntity(EntityId id)
+{
+	commands.push_back(Command(CommandType::DestroyEntity, Target(id)));
+}
+
+bool EntityCommandBuffer::empty() const
+{
+	return commands.empty();
+}
+
+void EntityCommandBuffer::clear()
+{
+	for (auto& cmd: commands) {
+		if (cmd.component) {
+			cmd.destroy(cmd.component);
+		}
+	}
+	commands.clear();
+	created.clear();
+	nPending = 0;
+}
+
+void EntityCommandBuffer::apply(World& world)
+{
+	apply(world, Vector<EntityCommandBuffer*>{ this });
+}
+
+void EntityCommandBuffer::apply(World& world, const Vector<EntityCommandBuffer*>& buffers)
+{
+	struct Entry {
+		EntityCommandBuffer* buffer;
+		Command* cmd;
+	};
+
+	Vector<Entry> entries;
+	for (auto& buffer: buffers) {
+		buffer->created.resize(size_t(buffer->nPending));
+		for (auto& cmd: buffer->commands) {
+			entries.push_back(Entry{ buffer, &cmd });
+		}
+	}
+
+	// Stable, so commands with the same key keep the order they were recorded in
+	std::stable_sort(entries.begin(), entries.end(), [] (const Entry& a, const Entry& b) { return a.cmd->sortKey < b.cmd->sortKey; });
+
+	// Create all entities first, so pending entities can be resolved regardless of which key they were used with
+	for (auto& e: entries) {
+		if (e.cmd->type == CommandType::CreateEntity) {
+			e.buffer->created[e.cmd->target.pending] = world.createEntity().getEntityId();
+		}
+	}
+	for (auto& e: entries) {
+		applyCommand(world, *e.buffer, *e.cmd);
+	}
+
+	for (auto& buffer: buffers) {
+		buffer->clear();
+	}
+}
+
+uint64_t EntityCommandBuffer::makeSortKey(uint32_t major, uint32_t minor)
+{
+	return (uint64_t(major) << 32) | uint64_t(minor);
+}
+
+uint64_t EntityCommandBuffer::getSortKey()
+{
+	return currentSortKey;
+}
+
+void EntityCommandBuffer::setSortKey(uint64_t key)
+{
+	currentSortKey = key;
+}
+
+EntityId EntityCommandBuffer::resolve(const Target& target) const
+{
+	return target.pending >= 0 ? created[target.pending] : target.id;
+}
+
+void EntityCommandBuffer::applyCommand(World& world, EntityCommandBuffer& buffer, Command& cmd)
+{
+	switch (cmd.type) {
+	case CommandType::CreateEntity:
+		break;
+
+	case CommandType::DestroyEntity:
+		world.destroyEntity(buffer.resolve(cmd.target));
+		break;
+
+	case CommandType::AddComponent:
+	case CommandType::RemoveComponent:
+		{
+			// The entity might have been destroyed since this was recorded
+			Entity* entity = world.tryGetEntity(buffer.resolve(cmd.target));
+			if (entity && entity->isAlive()) {
+				EntityRef ref(*entity, world);
+				cmd.apply(ref, cmd.component);
+			}
+		}
+		break;
+	}
+}
@@ -0,0 +1,66 @@
+#include "entity_message_queue.h"
+#include <algorithm>
+
+using namespace Halley;
+
+void EntityMessageQueueBase::prepareForReading()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (sorted) {
+		return;
+	}
+
+	scratch.resize(entries.size());
+	for (size_t i = 0; i < scratch.size(); ++i) {
+		scratch[i] = uint32_t(i);
+	}
+	std::stable_sort(scratch.begin(), scratch.end(), [&] (uint32_t a, uint32_t b) { return entries[a].target < entries[b].target; });
+	reorder(scratch);
+	sorted = true;
+}
+
+std::pair<size_t, size_t> EntityMessageQueueBase::getRange(EntityId target) const
+{
+	const auto range = std::equal_range(entries.begin(), entries.end(), Entry{ target, 0 }, [] (const Entry& a, const Entry& b) { return a.target < b.target; });
+	return std::make_pair(size_t(range.first - entries.begin()), size_t(range.second - entries.begin()));
+}
+
+void EntityMessageQueueBase::removeFromSender(int sender)
+{
+	// Removing keeps the rest in order, so it stays sorted if it was
+	scratch.clear();
+	for (size_t i = 0; i < entries.size(); ++i) {
+		if (entries[i].sender != sender) {
+			scratch.push_back(uint32_t(i));
+		}
+	}
+	if (scratch.size() != entries.size()) {
+		reorder(scratch);
+	}
+}
+
+void EntityMessageQueueBase::clear()
+{
+	scratch.clear();
+	reorder(scratch);
+	sorted = true;
+}
+
+void EntityMessageQueueBase::addEntry(EntityId target, int sender)
+{
+	if (!entries.empty() && target < entries.back().target) {
+		sorted = false;
+	}
+	entries.push_back(Entry{ target, sender });
+}
+
+void EntityMessageQueueBase::reorder(const Vector<uint32_t>& indices)
+{
+	Vector<Entry> result;
+	result.reserve(indices.size());
+	for (auto i: indices) {
+		result.push_back(entries[i]);
+	}
+	entries = std::move(result);
+	reorderMessages(indices);
+}
@@ -0,0 +1,269 @@
+#include "entity_replication.h"
+#include "world.h"
+#include "entity.h"
+#include "spatial_index_service.h"
+#include <halley/net/connection/message_queue.h>
+#include <halley/bytes/byte_serializer.h>
+#include <halley/support/logger.h>
+#include <algorithm>
+
+using namespace Halley;
+
+namespace {
+	// Component data is bit-packed, as it's only ever read back by the same build
+	SerializerOptions getComponentSerializerOptions()
+	{
+		SerializerOptions options;
+		options.compact = true;
+		return options;
+	}
+
+	// Leaves room for the message headers in a 1200 byte MessageQueueUDP packet
+	constexpr size_t maxMessageSize = 1100;
+}
+
+EntityReplicationMsg::EntityReplicationMsg(gsl::span<const gsl::byte> src)
+{
+	Deserializer s(src);
+	uint8_t t;
+	s >> t;
+	type = EntityReplicationMsgType(t);
+	s >> id.value;
+	s >> tick;
+	s >> data;
+}
+
+EntityReplicationMsg::EntityReplicationMsg(EntityReplicationMsgType type, EntityId id, uint32_t tick, Bytes data)
+	: type(type)
+	, id(id)
+	, tick(tick)
+	, data(std::move(data))
+{}
+
+void EntityReplicationMsg::serialize(Serializer& s) const
+{
+	s << uint8_t(type);
+	s << id.value;
+	s << tick;
+	s << data;
+}
+
+EntityReplicator::EntityReplicator(World& world, SpatialIndexService* spatialIndex, EntityReplicationSettings settings)
+	: world(world)
+	, spatialIndex(spatialIndex)
+	, settings(settings)
+{}
+
+void EntityReplicator::setupMessageQueue(MessageQueue& queue, const EntityReplicationSettings& settings)
+{
+	queue.setChannel(settings.reliableChannel, ChannelSettings(true, true));
+	queue.setChannel(settings.updateChannel, ChannelSettings(false, false));
+	queue.addFactory<EntityReplicationMsg>();
+}
+
+void EntityReplicator::addPeer(int peerId, std::shared_ptr<MessageQueue> queue)
+{
+	auto& peer = peers[peerId];
+	peer.queue = std::move(queue);
+	peer.entities.clear();
+}
+
+void EntityReplicator::removePeer(int peerId)
+{
+	peers.erase(peerId);
+}
+
+void EntityReplicator::setPeerFocus(int peerId, Vector2f focus)
+{
+	auto iter = peers.find(peerId);
+	if (iter == peers.end()) {
+		throw Exception("Unknown replication peer: " + toString(peerId), HalleyExceptions::Entity);
+	}
+	iter->second.focus = focus;
+}
+
+void EntityReplicator::setPriority(EntityId id, float priority)
+{
+	priorities[id] = priority;
+}
+
+void EntityReplicator::setAlwaysRelevant(EntityId id, bool relevant)
+{
+	auto iter = std::find(alwaysRelevant.begin(), alwaysRelevant.end(), id);
+	if (relevant && iter == alwaysRelevant.end()) {
+		alwaysRelevant.push_back(id);
+	} else if (!relevant && iter != alwaysRelevant.end()) {
+		alwaysRelevant.erase(iter);
+	}
+}
+
+void EntityReplicator::update(Time t)
+{
+	++tick;
+	for (auto& p: peers) {
+		updatePeer(p.second, t);
+	}
+}
+
+void EntityReplicator::updatePeer(Peer& peer, Time t)
+{
+	// Find out what's relevant to this peer
+	relevantScratch.clear();
+	if (spatialIndex && peer.focus) {
+		spatialIndex->queryRadius(peer.focus.get(), settings.interestRadius, relevantScratch);
+	}
+	relevantScratch.insert(relevantScratch.end(), alwaysRelevant.begin(), alwaysRelevant.end());
+
+	for (auto& e: peer.entities) {
+		e.second.relevant = false;
+	}
+
+	// Candidates point into the map, so it mustn't rehash while they're being gathered
+	peer.entities.reserve(peer.entities.size() + relevantScratch.size());
+	candidatesScratch.clear();
+	for (auto id: relevantScratch) {
+		Entity* entity = world.tryGetEntity(id);
+		if (!entity || !entity->isAlive()) {
+			continue;
+		}
+
+		auto& state = peer.entities[id];
+		if (state.relevant) {
+			continue;
+		}
+		state.relevant = true;
+
+		const uint32_t version = getReplicatedVersion(*entity);
+		const bool changed = !state.created || version != state.sentVersion;
+		state.accumulator += getPriority(id) * float(t) * (changed ? 1.0f : settings.idlePriorityScale);
+		candidatesScratch.push_back(Candidate{ id, &state, version });
+	}
+
+	// Anything that's no longer relevant (or no longer alive) gets destroyed on the peer
+	for (auto iter = peer.entities.begin(); iter != peer.entities.end(); ) {
+		if (iter->second.relevant) {
+			++iter;
+		} else {
+			if (iter->second.created) {
+				peer.queue->enqueue(std::make_unique<EntityReplicationMsg>(EntityReplicationMsgType::Destroy, iter->first, tick), settings.reliableChannel);
+			}
+			iter = peer.entities.erase(iter);
+		}
+	}
+
+	// Fill the budget, highest priority first. Entities that don't fit keep their priority, so they'll go out soon.
+	std::sort(candidatesScratch.begin(), candidatesScratch.end(), [] (const Candidate& a, const Candidate& b)
+	{
+		return a.state->accumulator > b.state->accumulator;
+	});
+
+	size_t budget = settings.bytesPerPeerPerTick;
+	for (auto& c: candidatesScratch) {
+		if (budget < 16) {
+			break;
+		}
+
+		Entity& entity = *world.tryGetEntity(c.id);
+		auto data = Serializer::toBytes([&] (Serializer& s) { world.serializeEntity(entity, s, true); }, getComponentSerializerOptions());
+		const auto type = c.state->created ? EntityReplicationMsgType::Update : EntityReplicationMsgType::Create;
+		auto msg = std::make_unique<EntityReplicationMsg>(type, c.id, tick, std::move(data));
+
+		const size_t size = msg->getSerializedSize();
+		if (size > maxMessageSize) {
+			Logger::logWarning("Entity " + c.id.toString() + " is too large to replicate (" + toString(size) + " bytes).");
+			c.state->accumulator = 0;
+			continue;
+		}
+		if (size > budget) {
+			continue;
+		}
+
+		budget -= size;
+		peer.queue->enqueue(std::move(msg), c.state->created ? settings.updateChannel : settings.reliableChannel);
+		c.state->accumulator = 0;
+		c.state->sentVersion = c.version;
+		c.state->created = true;
+	}
+}
+
+float EntityReplicator::getPriority(EntityId id) const
+{
+	auto iter = priorities.find(id);
+	return iter == priorities.end() ? 1.0f : iter->second;
+}
+
+uint32_t EntityReplicator::getReplicatedVersion(const Entity& entity) const
+{
+	uint32_t version = 0;
+	for (int i = 0; i < entity.liveComponents; ++i) {
+		const int id = entity.components[i].first;
+		if (ComponentDeleterTable::get(id)->isReplicated()) {
+			version = std::max(version, entity.getComponentVersion(id));
+		}
+	}
+	return version;
+}
+
+EntityReplicaReceiver::EntityReplicaReceiver(World& world)
+	: world(world)
+{}
+
+bool EntityReplicaReceiver::onMessage(NetworkMessage& networkMsg)
+{
+	auto msg = dynamic_cast<EntityReplicationMsg*>(&networkMsg);
+	if (!msg) {
+		return false;
+	}
+
+	const auto remoteId = msg->getEntityId();
+	auto iter = replicas.find(remoteId);
+
+	switch (msg->getType()) {
+	case EntityReplicationMsgType::Create:
+		if (iter == replicas.end()) {
+			Replica replica;
+			replica.localId = world.createEntity().getEntityId();
+			iter = replicas.emplace(remoteId, replica).first;
+		}
+		break;
+
+	case EntityReplicationMsgType::Update:
+		// Updates are unreliable, so they can arrive before the create, after the destroy, or out of order
+		if (iter == replicas.end() || msg->getTick() <= iter->second.lastTick) {
+			return true;
+		}
+		break;
+
+	case EntityReplicationMsgType::Destroy:
+		if (iter != replicas.end()) {
+			world.destroyEntity(iter->second.localId);
+			replicas.erase(iter);
+		}
+		return true;
+	}
+
+	Entity* entity = world.tryGetEntity(iter->second.localId);
+	if (entity) {
+		Deserializer s(msg->getData(), getComponentSerializerOptions());
+		world.deserializeEntity(*entity, s);
+	}
+	iter->second.lastTick = msg->getTick();
+	return true;
+}
+
+Maybe<EntityId> EntityReplicaReceiver::getLocalId(EntityId remoteId) const
+{
+	auto iter = replicas.find(remoteId);
+	if (iter == replicas.end()) {
+		return {};
+	}
+	return iter->second.localId;
+}
+
+void EntityReplicaReceiver::clear()
+{
+	for (auto& r: replicas) {
+		world.destroyEntity(r.second.localId);
+	}
+	replicas.clear();
+}
@@ -3,8 +3,10 @@
 
 using namespace Halley;
 
-Family::Family(FamilyMaskType mask) 
-	: inclusionMask(mask)
+Family::Family(FamilyMaskType inclusionMask, FamilyMaskType optionalMask, Vector<int> componentIndices)
+	: inclusionMask(inclusionMask)
+	, optionalMask(optionalMask)
+	, componentIndices(std::move(componentIndices))
 {}
 
 void Family::addOnEntitiesAdded(FamilyBindingBase* bind)
@@ -2,6 +2,7 @@
 #include <unordered_set>
 #include <halley/data_structures/vector.h>
 #include <functional>
+#include <array>
 
 using namespace Halley;
 using namespace FamilyMask;
@@ -10,10 +11,12 @@ struct MaskEntry
 {
 	RealType mask;
 	int idx;
+	std::array<uint8_t, maxComponents> slots;
 
 	MaskEntry(MaskEntry&& o) noexcept
 		: mask(std::move(o.mask))
 		, idx(o.idx)
+		, slots(o.slots)
 	{}
 
 	MaskEntry(const RealType& m, int i)
@@ -21,6 +24,14 @@ struct MaskEntry
 		, idx(i)
 	{}
 
+	void computeSlots()
+	{
+		uint8_t n = 0;
+		for (int i = 0; i < maxComponents; ++i) {
+			slots[i] = mask[i] ? n++ : noComponentSlot;
+		}
+	}
+
 	/*
 	bool operator<(const MaskEntry& o) const {
 		return mask < o.mask;
@@ -63,6 +74,7 @@ public:
 			// Not found
 			int idx = static_cast<int>(instance.values.size());
 			entry.idx = idx;
+			entry.computeSlots();
 			auto result = instance.entries.insert(std::move(entry));
 			instance.values.push_back(const_cast<MaskEntry*>(&*result.first));
 			return idx;
@@ -72,6 +84,23 @@ public:
 		}
 	}
 
+	static const uint8_t* retrieveSlots(int handle)
+	{
+		static const std::array<uint8_t, maxComponents> empty = makeEmptySlots();
+		if (handle == -1) {
+			return empty.data();
+		} else {
+			return (*getInstance()).values[handle]->slots.data();
+		}
+	}
+
+	static std::array<uint8_t, maxComponents> makeEmptySlots()
+	{
+		std::array<uint8_t, maxComponents> result;
+		result.fill(noComponentSlot);
+		return result;
+	}
+
 	static RealType& retrieve(int handle)
 	{
 		static RealType dummy;
@@ -139,6 +168,11 @@ const RealType& Handle::getRealValue() const
 	return MaskStorage::retrieve(value);
 }
 
+const uint8_t* Handle::getComponentSlots() const
+{
+	return MaskStorage::retrieveSlots(value);
+}
+
 bool Handle::contains(const Handle& handle) const
 {
 	auto& mine = getRealValue();
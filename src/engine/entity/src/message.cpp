@@ -1,15 +1,15 @@
 #include "message.h"
+#include <halley/data_structures/memory_pool.h>
 
 using namespace Halley;
 
-/*
 void* Message::operator new(size_t size)
 {
-	return PoolPool::getPool(size)->alloc();
+	return PoolPool::alloc(size);
 }
 
-void Message::operator delete(void* ptr)
+void Message::operator delete(void* ptr, size_t size)
 {
-	PoolPool::getPool(static_cast<Message*>(ptr)->getSize())->free(ptr);
+	// Message has a virtual destructor, so size is always that of the most derived type
+	PoolPool::free(ptr, size);
 }
-*/
@@ -0,0 +1,85 @@
+#include "prefab.h"
+#include <halley/bytes/byte_serializer.h>
+#include <halley/resources/resource_data.h>
+
+using namespace Halley;
+
+void Prefab::ComponentData::serialize(Serializer& s) const
+{
+	s << name;
+	s << data;
+}
+
+void Prefab::ComponentData::deserialize(Deserializer& s)
+{
+	s >> name;
+	s >> data;
+}
+
+Prefab::Prefab() = default;
+
+Prefab::Prefab(Vector<ComponentData> components)
+	: components(std::move(components))
+{
+}
+
+const Vector<Prefab::ComponentData>& Prefab::getComponents() const
+{
+	return components;
+}
+
+void Prefab::serialize(Serializer& s) const
+{
+	int version = ConfigFile::curVersion;
+	s << version;
+	s << components;
+}
+
+void Prefab::deserialize(Deserializer& s)
+{
+	int version;
+	s >> version;
+	s.setVersion(version);
+	s >> components;
+}
+
+std::unique_ptr<Prefab> Prefab::loadResource(ResourceLoader& loader)
+{
+	auto prefab = std::make_unique<Prefab>();
+
+	auto data = loader.getStatic();
+	Deserializer s(data->getSpan());
+	s >> *prefab;
+
+	return prefab;
+}
+
+void Prefab::reload(Resource&& resource)
+{
+	*this = std::move(dynamic_cast<Prefab&>(resource));
+}
+
+PrefabTemplate::PrefabTemplate(const Prefab& prefab, const ComponentLoader& loader)
+{
+	components.reserve(prefab.getComponents().size());
+	for (auto& component: prefab.getComponents()) {
+		loader(*this, component.name, component.data);
+	}
+}
+
+void PrefabTemplate::instantiate(EntityRef& entity) const
+{
+	for (auto& c: components) {
+		c.clone(entity, *c.prototype);
+	}
+}
+
+size_t PrefabTemplate::getNumComponents() const
+{
+	return components.size();
+}
+
+bool PrefabTemplate::isEmpty() const
+{
+	return components.empty();
+}
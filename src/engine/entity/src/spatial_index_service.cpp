@@ -0,0 +1,170 @@
+#include "spatial_index_service.h"
+#include <halley/concurrency/concurrent.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace Halley;
+
+SpatialIndexService::SpatialIndexService(float margin)
+	: tree(margin)
+{
+}
+
+void SpatialIndexService::update(EntityId entity, Rect4f bounds)
+{
+	auto iter = proxies.find(entity);
+	if (iter != proxies.end()) {
+		const auto prev = tree.getBounds(iter->second);
+		tree.move(iter->second, bounds, bounds.getCenter() - prev.getCenter());
+	} else {
+		proxies[entity] = tree.insert(bounds, uint64_t(entity.value));
+	}
+}
+
+bool SpatialIndexService::remove(EntityId entity)
+{
+	auto iter = proxies.find(entity);
+	if (iter == proxies.end()) {
+		return false;
+	}
+	tree.remove(iter->second);
+	proxies.erase(iter);
+	return true;
+}
+
+void SpatialIndexService::clear()
+{
+	tree.clear();
+	proxies.clear();
+}
+
+size_t SpatialIndexService::size() const
+{
+	return proxies.size();
+}
+
+Maybe<Rect4f> SpatialIndexService::getBounds(EntityId entity) const
+{
+	auto iter = proxies.find(entity);
+	if (iter == proxies.end()) {
+		return {};
+	}
+	return tree.getBounds(iter->second);
+}
+
+void SpatialIndexService::query(Rect4f area, Vector<EntityId>& result) const
+{
+	tree.query(area, [&] (AABBTree::ProxyId proxy)
+	{
+		if (tree.getBounds(proxy).overlaps(area)) {
+			result.push_back(getEntity(tree.getData(proxy)));
+		}
+	});
+}
+
+void SpatialIndexService::queryRadius(Vector2f centre, float radius, Vector<EntityId>& result) const
+{
+	const float radius2 = radius * radius;
+	const Vector2f extent(radius, radius);
+	tree.query(Rect4f(centre - extent, centre + extent), [&] (AABBTree::ProxyId proxy)
+	{
+		// Distance from the centre to the closest point of the bounds
+		const auto bounds = tree.getBounds(proxy);
+		const auto& p1 = bounds.getTopLeft();
+		const auto& p2 = bounds.getBottomRight();
+		const Vector2f closest(clamp(centre.x, p1.x, p2.x), clamp(centre.y, p1.y, p2.y));
+		if ((closest - centre).squaredLength() <= radius2) {
+			result.push_back(getEntity(tree.getData(proxy)));
+		}
+	});
+}
+
+Maybe<SpatialIndexService::RayHit> SpatialIndexService::raycast(Vector2f from, Vector2f to) const
+{
+	const Vector2f delta = to - from;
+	const float length = delta.length();
+	if (length <= 0) {
+		return {};
+	}
+	const Vector2f dir = delta / length;
+
+	Maybe<RayHit> best;
+	tree.raycast(from, to, [&] (AABBTree::ProxyId proxy, float maxDistance)
+	{
+		// Ties at the same distance go to the lowest id, so the search is only clipped to the best distance, not below it
+		const float t = AABBTree::intersectRay(tree.getBounds(proxy), from, dir, maxDistance);
+		const auto entity = getEntity(tree.getData(proxy));
+		if (t >= 0 && (!best || t < best->distance || (t == best->distance && entity < best->entity))) {
+			best = RayHit{ entity, t };
+			return t;
+		}
+		return maxDistance;
+	});
+	return best;
+}
+
+void SpatialIndexService::getOverlappingPairs(Vector<EntityPair>& result) const
+{
+	Vector<AABBTree::Pair> pairs;
+	tree.getOverlappingPairs(pairs);
+	toEntityPairs(pairs, result);
+}
+
+void SpatialIndexService::getMovedPairs(Vector<EntityPair>& result)
+{
+	pairScratch.clear();
+	tree.getMovedPairs(pairScratch);
+	toEntityPairs(pairScratch, result);
+}
+
+void SpatialIndexService::query(gsl::span<const Rect4f> areas, Vector<Vector<EntityId>>& results) const
+{
+	results.resize(size_t(areas.size()));
+	Concurrent::parallelFor(Executors::getCPU(), Range<size_t>(0, results.size()), 8, [&] (size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i) {
+			results[i].clear();
+			query(areas[i], results[i]);
+		}
+	});
+}
+
+void SpatialIndexService::queryRadius(gsl::span<const Vector2f> centres, float radius, Vector<Vector<EntityId>>& results) const
+{
+	results.resize(size_t(centres.size()));
+	Concurrent::parallelFor(Executors::getCPU(), Range<size_t>(0, results.size()), 8, [&] (size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i) {
+			results[i].clear();
+			queryRadius(centres[i], radius, results[i]);
+		}
+	});
+}
+
+void SpatialIndexService::raycast(gsl::span<const std::pair<Vector2f, Vector2f>> rays, Vector<Maybe<RayHit>>& results) const
+{
+	results.resize(size_t(rays.size()));
+	Concurrent::parallelFor(Executors::getCPU(), Range<size_t>(0, results.size()), 8, [&] (size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i) {
+			results[i] = raycast(rays[i].first, rays[i].second);
+		}
+	});
+}
+
+EntityId SpatialIndexService::getEntity(uint64_t data)
+{
+	EntityId result;
+	result.value = int64_t(data);
+	return result;
+}
+
+void SpatialIndexService::toEntityPairs(const Vector<AABBTree::Pair>& pairs, Vector<EntityPair>& result) const
+{
+	result.reserve(result.size() + pairs.size());
+	for (auto& p: pairs) {
+		auto a = getEntity(tree.getData(p.first));
+		auto b = getEntity(tree.getData(p.second));
+		result.emplace_back(std::min(a, b), std::max(a, b));
+	}
+}
@@ -1,13 +1,74 @@
 #include "system.h"
-#include <halley/data_structures/flat_map.h>
+#include "world.h"
 #include "halley/support/debug.h"
+#include "halley/support/profiler.h"
 
 using namespace Halley;
 
-System::System(std::initializer_list<FamilyBindingBase*> uninitializedFamilies, std::initializer_list<int> messageTypesReceived)
+SystemDependencies::SystemDependencies()
+	: flags(Exclusive)
+{
+}
+
+SystemDependencies::SystemDependencies(std::initializer_list<int> componentsRead, std::initializer_list<int> componentsWritten, int flags, std::initializer_list<String> services)
+	: services(services)
+	, flags(flags)
+{
+	for (int c: componentsRead) {
+		FamilyMask::setBit(read, c);
+	}
+	for (int c: componentsWritten) {
+		FamilyMask::setBit(written, c);
+	}
+}
+
+bool SystemDependencies::isExclusive() const
+{
+	return (flags & Exclusive) != 0;
+}
+
+bool SystemDependencies::conflictsWith(const SystemDependencies& other) const
+{
+	if (isExclusive() || other.isExclusive()) {
+		return true;
+	}
+
+	// Components: any write overlapping with a read or write of the other system
+	if ((written & (other.read | other.written)).any() || (other.written & read).any()) {
+		return true;
+	}
+
+	// Messages are sent into queues read by all receivers, and purged by their senders
+	const bool sends = (flags & SendsMessages) != 0;
+	const bool otherSends = (other.flags & SendsMessages) != 0;
+	if ((sends && (other.flags & (SendsMessages | ReceivesMessages)) != 0) || (otherSends && (flags & ReceivesMessages) != 0)) {
+		return true;
+	}
+
+	// The API and resources aren't safe for concurrent use
+	if ((flags & other.flags & (API | Resources)) != 0) {
+		return true;
+	}
+
+	for (auto& s: services) {
+		if (std::find(other.services.begin(), other.services.end(), s) != other.services.end()) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+System::System(std::initializer_list<FamilyBindingBase*> uninitializedFamilies, std::initializer_list<int> messageTypesReceived, SystemDependencies dependencies)
 	: families(uninitializedFamilies)
 	, messageTypesReceived(messageTypesReceived)
+	, dependencies(std::move(dependencies))
+{
+}
+
+EntityCommandBuffer& System::getCommandBuffer() const
 {
+	return world->getCommandBuffer();
 }
 
 size_t System::getEntityCount() const
@@ -32,6 +93,34 @@ void System::setCollectSamples(bool collect)
 	collectSamples = collect;
 }
 
+void System::setBudget(SystemBudget b)
+{
+	budget = b;
+}
+
+const SystemBudget& System::getBudget() const
+{
+	return budget;
+}
+
+size_t System::getAmortizedCount(size_t familySize) const
+{
+	if (budget.maxEntities == 0) {
+		return familySize;
+	}
+	// Always some progress, however far over target the world is
+	const size_t scaled = size_t(float(budget.maxEntities) * world->getBudgetScale());
+	return std::min(std::max(scaled, size_t(1)), familySize);
+}
+
+int64_t System::getAmortizedDeadline() const
+{
+	if (budget.maxNanoSeconds == 0) {
+		return 0;
+	}
+	return updateStartNs + int64_t(float(budget.maxNanoSeconds) * world->getBudgetScale());
+}
+
 void System::onAddedToWorld(World& w, int id) {
 	world = &w;
 	systemId = id;
@@ -40,77 +129,94 @@ void System::onAddedToWorld(World& w, int id) {
 	}
 }
 
-void System::purgeMessages()
+void System::advanceChangeVersion(uint32_t version)
 {
-	if (messagesSentTo.size() > 0) {
-		for (auto& target: messagesSentTo) {
-			// Purge all messages of this age
-			Entity* entity = world->tryGetEntity(target);
+	lastRunVersion = changeVersion;
+	changeVersion = version;
+}
 
-			if (entity) {
-				auto& inbox = entity->inbox;
-				inbox.erase(std::remove_if(inbox.begin(), inbox.end(), [&] (const MessageEntry& e) { return e.age == systemId; }), inbox.end());
-			}
+void System::markComponentTypeChanged(int id)
+{
+	world->markComponentTypeChanged(id, changeVersion);
+}
+
+bool System::anyComponentTypeChanged(const int* ids, size_t n) const
+{
+	for (size_t i = 0; i < n; ++i) {
+		if (world->getComponentTypeVersion(ids[i]) > lastRunVersion) {
+			return true;
 		}
-		messagesSentTo.clear();
 	}
+	return false;
+}
+
+void System::purgeMessages()
+{
+	// Messages last until their sender runs again, so every system gets to see them once
+	for (int msgType: messageTypesSent) {
+		world->tryGetMessageQueue(msgType)->removeFromSender(systemId);
+	}
+	messageTypesSent.clear();
 }
 
 void System::processMessages()
 {
-	// This whole method is probably very inefficient.
-	struct MessageBox
-	{
-		Vector<Message*> msg;
-		Vector<size_t> elemIdx;
-	};
-	FlatMap<int, MessageBox> inboxes;
+	for (int msgType: messageTypesReceived) {
+		auto queue = world->tryGetMessageQueue(msgType);
+		if (!queue || queue->empty()) {
+			continue;
+		}
+		queue->prepareForReading();
 
-	if (!families.empty()) {
+		// Broadcasts have no target, so they're sorted first
+		const size_t nBroadcast = queue->getRange(EntityId()).second;
+		if (nBroadcast > 0) {
+			messageBox.clear();
+			for (size_t i = 0; i < nBroadcast; ++i) {
+				messageBox.push_back(queue->getMessage(i));
+			}
+			onMessagesBroadcast(msgType, messageBox.data(), messageBox.size());
+		}
+
+		if (families.empty() || queue->size() == nBroadcast) {
+			continue;
+		}
+
+		// Match the main family's entities to their messages, and deliver them in queue order, i.e. sorted by target
+		messageMatches.clear();
 		auto& fam = *families[0];
-		size_t sz = fam.count();
-		for (size_t i = 0; i < sz; i++) {
-			FamilyBase* elem = reinterpret_cast<FamilyBase*>(fam.getElement(i));
-			Entity* entity = world->tryGetEntity(elem->entityId);
-			if (entity) {
-				for (const auto& msg: entity->inbox) {
-					if (std::find(messageTypesReceived.begin(), messageTypesReceived.end(), msg.type) != messageTypesReceived.end()) {
-						auto& inbox = inboxes[msg.type];
-						inbox.msg.emplace_back(msg.msg.get());
-						inbox.elemIdx.emplace_back(i);
-					}
-				}
+		const size_t n = fam.count();
+		for (size_t i = 0; i < n; ++i) {
+			const auto range = queue->getRange(reinterpret_cast<FamilyBase*>(fam.getElement(i))->entityId);
+			for (size_t j = range.first; j < range.second; ++j) {
+				messageMatches.emplace_back(j, i);
 			}
 		}
-		for (auto& iter : inboxes) {
-			int id = iter.first;
-			auto& inbox = iter.second;
-			onMessagesReceived(id, inbox.msg.data(), inbox.elemIdx.data(), inbox.msg.size());
+		if (messageMatches.empty()) {
+			continue;
 		}
-	}
-}
+		std::sort(messageMatches.begin(), messageMatches.end());
 
-void System::doSendMessage(EntityId entityId, std::unique_ptr<Message> msg, size_t, int id)
-{
-	outbox.emplace_back(std::make_pair(entityId, MessageEntry(std::move(msg), id, systemId)));
+		messageBox.clear();
+		messageElemIdx.clear();
+		for (auto& m: messageMatches) {
+			messageBox.push_back(queue->getMessage(m.first));
+			messageElemIdx.push_back(m.second);
+		}
+		onMessagesReceived(msgType, messageBox.data(), messageElemIdx.data(), messageBox.size());
+	}
 }
 
-void System::dispatchMessages()
+void System::onMessageTypeSent(int msgType)
 {
-	if (!outbox.empty()) {
-		for (auto& o: outbox) {
-			Entity* entity = world->tryGetEntity(o.first);
-			if (entity) {
-				entity->inbox.emplace_back(std::move(o.second));
-				messagesSentTo.push_back(o.first);
-			}
-		}
-		outbox.clear();
+	if (std::find(messageTypesSent.begin(), messageTypesSent.end(), msgType) == messageTypesSent.end()) {
+		messageTypesSent.push_back(msgType);
 	}
 }
 
 void System::doUpdate(Time time) {
 	HALLEY_DEBUG_TRACE_COMMENT(name.c_str());
+	Profiler::Scope profile(profileName, ProfilerEventType::System);
 	if (collectSamples) {
 		timer.beginSample();
 	}
@@ -119,9 +225,11 @@ void System::doUpdate(Time time) {
 	if (!messageTypesReceived.empty()) {
 		processMessages();
 	}
-	
+
+	if (budget.maxNanoSeconds != 0) {
+		updateStartNs = Profiler::getTimeNs();
+	}
 	updateBase(time);
-	dispatchMessages();
 
 	if (collectSamples) {
 		timer.endSample();
@@ -129,8 +237,15 @@ void System::doUpdate(Time time) {
 	HALLEY_DEBUG_TRACE_COMMENT(name.c_str());
 }
 
+void System::doPrepareRender()
+{
+	Profiler::Scope profile(profileName, ProfilerEventType::System);
+	onPrepareRender();
+}
+
 void System::doRender(RenderContext& rc) {
 	HALLEY_DEBUG_TRACE_COMMENT(name.c_str());
+	Profiler::Scope profile(profileName, ProfilerEventType::System);
 	if (collectSamples) {
 		timer.beginSample();
 	}
@@ -0,0 +1,277 @@
+#include "transform_hierarchy_service.h"
+#include <halley/concurrency/concurrent.h>
+#include <halley/support/exception.h>
+#include <algorithm>
+
+using namespace Halley;
+
+void TransformHierarchyService::Level::push(EntityId entity, EntityId parentId, uint32_t parent, const Transform2D& t)
+{
+	entities.push_back(entity);
+	parentIds.push_back(parentId);
+	parents.push_back(parent);
+	local.push_back(t);
+	world.push_back(t);
+	dirty.push_back(1);
+}
+
+void TransformHierarchyService::Level::clear()
+{
+	entities.clear();
+	parentIds.clear();
+	parents.clear();
+	local.clear();
+	world.clear();
+	dirty.clear();
+}
+
+void TransformHierarchyService::add(EntityId entity, const Transform2D& local, EntityId parent)
+{
+	if (locations.find(entity) != locations.end()) {
+		throw Exception("Entity " + entity.toString() + " is already in the transform hierarchy.", HalleyExceptions::Entity);
+	}
+	if (levels.empty()) {
+		levels.resize(1);
+	}
+
+	// New nodes start as roots, and get moved to their level on the next rebuild
+	auto& root = levels[0];
+	locations[entity] = Location{ 0, uint32_t(root.size()) };
+	root.push(entity, parent, noParent, local);
+	if (parent.isValid()) {
+		structureDirty = true;
+	}
+}
+
+bool TransformHierarchyService::remove(EntityId entity)
+{
+	auto iter = locations.find(entity);
+	if (iter == locations.end()) {
+		return false;
+	}
+	levels[iter->second.depth].dirty[iter->second.index] = removedNode;
+	locations.erase(iter);
+	structureDirty = true;
+	return true;
+}
+
+void TransformHierarchyService::clear()
+{
+	levels.clear();
+	locations.clear();
+	structureDirty = false;
+}
+
+bool TransformHierarchyService::contains(EntityId entity) const
+{
+	return locations.find(entity) != locations.end();
+}
+
+size_t TransformHierarchyService::size() const
+{
+	return locations.size();
+}
+
+void TransformHierarchyService::setParent(EntityId entity, EntityId parent)
+{
+	if (entity == parent) {
+		throw Exception("Entity " + entity.toString() + " can't be its own parent.", HalleyExceptions::Entity);
+	}
+	auto& loc = getLocation(entity);
+	auto& level = levels[loc.depth];
+	if (level.parentIds[loc.index] != parent) {
+		level.parentIds[loc.index] = parent;
+		structureDirty = true;
+	}
+}
+
+EntityId TransformHierarchyService::getParent(EntityId entity) const
+{
+	auto& loc = getLocation(entity);
+	return levels[loc.depth].parentIds[loc.index];
+}
+
+void TransformHierarchyService::setLocalTransform(EntityId entity, const Transform2D& local)
+{
+	auto& loc = getLocation(entity);
+	auto& level = levels[loc.depth];
+	level.local[loc.index] = local;
+	level.dirty[loc.index] = 1;
+}
+
+const Transform2D& TransformHierarchyService::getLocalTransform(EntityId entity) const
+{
+	auto& loc = getLocation(entity);
+	return levels[loc.depth].local[loc.index];
+}
+
+const Transform2D& TransformHierarchyService::getWorldTransform(EntityId entity) const
+{
+	auto& loc = getLocation(entity);
+	return levels[loc.depth].world[loc.index];
+}
+
+size_t TransformHierarchyService::getDepth(EntityId entity) const
+{
+	return getLocation(entity).depth;
+}
+
+void TransformHierarchyService::update()
+{
+	if (structureDirty) {
+		rebuild();
+	}
+
+	for (size_t depth = 0; depth < levels.size(); ++depth) {
+		updateLevel(depth);
+
+		// The level above is only read from this one, so its flags can go now
+		if (depth > 0) {
+			auto& dirty = levels[depth - 1].dirty;
+			std::fill(dirty.begin(), dirty.end(), uint8_t(0));
+		}
+	}
+	if (!levels.empty()) {
+		auto& dirty = levels.back().dirty;
+		std::fill(dirty.begin(), dirty.end(), uint8_t(0));
+	}
+}
+
+const TransformHierarchyService::Location& TransformHierarchyService::getLocation(EntityId entity) const
+{
+	auto iter = locations.find(entity);
+	if (iter == locations.end()) {
+		throw Exception("Entity " + entity.toString() + " is not in the transform hierarchy.", HalleyExceptions::Entity);
+	}
+	return iter->second;
+}
+
+void TransformHierarchyService::rebuild()
+{
+	struct Node
+	{
+		EntityId entity;
+		EntityId parentId;
+		Transform2D local;
+		int depth;
+	};
+
+	// Gather everything, in the current order so that rebuilding is stable
+	Vector<Node> nodes;
+	nodes.reserve(locations.size());
+	HashMap<EntityId, size_t> nodeIndices;
+	for (auto& level: levels) {
+		for (size_t i = 0; i < level.size(); ++i) {
+			if (level.dirty[i] != removedNode) {
+				nodeIndices[level.entities[i]] = nodes.size();
+				nodes.push_back(Node{ level.entities[i], level.parentIds[i], level.local[i], -1 });
+			}
+		}
+	}
+
+	// Work out depths, walking up until a node with a known depth is found. Nodes whose parent isn't in the hierarchy become roots.
+	constexpr int visiting = -2;
+	size_t maxDepth = 0;
+	Vector<size_t> chain;
+	for (size_t i = 0; i < nodes.size(); ++i) {
+		size_t cur = i;
+		while (nodes[cur].depth == -1) {
+			auto parentIter = nodeIndices.find(nodes[cur].parentId);
+			if (parentIter == nodeIndices.end()) {
+				nodes[cur].parentId = EntityId();
+				nodes[cur].depth = 0;
+				break;
+			}
+			nodes[cur].depth = visiting;
+			chain.push_back(cur);
+			cur = parentIter->second;
+		}
+		if (nodes[cur].depth == visiting) {
+			throw Exception("Cycle in transform hierarchy at entity " + nodes[cur].entity.toString() + ".", HalleyExceptions::Entity);
+		}
+		int depth = nodes[cur].depth;
+		while (!chain.empty()) {
+			nodes[chain.back()].depth = ++depth;
+			chain.pop_back();
+		}
+		maxDepth = std::max(maxDepth, size_t(nodes[i].depth));
+	}
+
+	// Bucket by depth, keeping the gathered order within each
+	Vector<Vector<size_t>> byDepth(nodes.empty() ? 0 : maxDepth + 1);
+	for (size_t i = 0; i < nodes.size(); ++i) {
+		byDepth[nodes[i].depth].push_back(i);
+	}
+
+	levels.resize(byDepth.size());
+	for (auto& level: levels) {
+		level.clear();
+	}
+	for (size_t depth = 0; depth < byDepth.size(); ++depth) {
+		auto& bucket = byDepth[depth];
+		auto& level = levels[depth];
+
+		uint32_t parentIndex = noParent;
+		if (depth > 0) {
+			// Siblings end up together, and in the same order as their parents
+			std::stable_sort(bucket.begin(), bucket.end(), [&] (size_t a, size_t b)
+			{
+				return locations[nodes[a].parentId].index < locations[nodes[b].parentId].index;
+			});
+		}
+
+		level.entities.reserve(bucket.size());
+		for (auto idx: bucket) {
+			auto& node = nodes[idx];
+			if (depth > 0) {
+				parentIndex = locations[node.parentId].index;
+			}
+			locations[node.entity] = Location{ uint32_t(depth), uint32_t(level.size()) };
+			level.push(node.entity, node.parentId, parentIndex, node.local);
+		}
+	}
+
+	structureDirty = false;
+}
+
+void TransformHierarchyService::updateLevel(size_t depth)
+{
+	auto& level = levels[depth];
+	if (depth == 0) {
+		Concurrent::parallelFor(Executors::getCPU(), Range<size_t>(0, level.size()), 256, [&] (size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i) {
+				if (level.dirty[i]) {
+					level.world[i] = level.local[i];
+				}
+			}
+		}, TaskPriority::Critical);
+	} else {
+		const auto& parentLevel = levels[depth - 1];
+		Concurrent::parallelFor(Executors::getCPU(), Range<size_t>(0, level.size()), 256, [&] (size_t begin, size_t end)
+		{
+			// Siblings are next to each other, so each run of them is done together
+			for (size_t i = begin; i < end; ) {
+				const uint32_t parent = level.parents[i];
+				size_t runEnd = i + 1;
+				while (runEnd < end && level.parents[runEnd] == parent) {
+					++runEnd;
+				}
+
+				const auto& parentWorld = parentLevel.world[parent];
+				if (parentLevel.dirty[parent]) {
+					std::fill(level.dirty.begin() + i, level.dirty.begin() + runEnd, uint8_t(1));
+					const auto n = std::ptrdiff_t(runEnd - i);
+					parentWorld.combine(gsl::span<const Transform2D>(level.local.data() + i, n), gsl::span<Transform2D>(level.world.data() + i, n));
+				} else {
+					for (size_t j = i; j < runEnd; ++j) {
+						if (level.dirty[j]) {
+							level.world[j] = parentWorld * level.local[j];
+						}
+					}
+				}
+				i = runEnd;
+			}
+		}, TaskPriority::Critical);
+	}
+}
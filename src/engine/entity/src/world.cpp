@@ -6,22 +6,43 @@
 #include "world.h"
 #include "system.h"
 #include "family.h"
+#include "archetype_storage.h"
+#include "entity_command_buffer.h"
+#include "prefab.h"
+#include "world_snapshot.h"
+#include <halley/bytes/byte_serializer.h>
 #include "halley/text/string_converter.h"
 #include "halley/support/debug.h"
+#include "halley/support/memory_tracker.h"
+#include "halley/support/profiler.h"
 #include "halley/file_formats/config_file.h"
+#include "halley/core/devcon/devcon_telemetry.h"
 
 using namespace Halley;
 
+namespace {
+	std::atomic<uint64_t> nextWorldId(1);
+
+	struct CommandBufferCache {
+		uint64_t worldId = 0;
+		EntityCommandBuffer* buffer = nullptr;
+	};
+	thread_local CommandBufferCache commandBufferCache;
+}
+
 World::World(const HalleyAPI* api, bool collectMetrics)
 	: api(api)
 	, collectMetrics(collectMetrics)
-{	
+	, worldId(nextWorldId++)
+{
+	for (auto& v: componentTypeVersions) {
+		v.store(0, std::memory_order_relaxed);
+	}	
 }
 
 World::~World()
 {
 	for (auto& f: families) {
-		//f.second->clearEntities();
 		f->clearEntities();
 	}
 	for (auto& tl: systems) {
@@ -33,8 +54,12 @@ World::~World()
 	for (auto e: entities) {
 		deleteEntity(e);
 	}
+	familyIndex.clear();
 	families.clear();
 	services.clear();
+	messageQueues.clear();
+	commandBuffers.clear();
+	archetypes.clear();
 }
 
 System& World::addSystem(std::unique_ptr<System> system, TimeLine timelineType)
@@ -44,7 +69,8 @@ System& World::addSystem(std::unique_ptr<System> system, TimeLine timelineType)
 	auto& ref = *system.get();
 	auto& timeline = getSystems(timelineType);
 	timeline.emplace_back(std::move(system));
-	ref.onAddedToWorld(*this, int(timeline.size()));
+	ref.onAddedToWorld(*this, nextSystemId++);
+	systemBatchesDirty = true;
 	return ref;
 }
 
@@ -54,6 +80,7 @@ void World::removeSystem(System& system)
 		for (size_t i = 0; i < sys.size(); i++) {
 			if (sys[i].get() == &system) {
 				sys.erase(sys.begin() + i);
+				systemBatchesDirty = true;
 				return;
 			}
 		}
@@ -99,6 +126,18 @@ System& World::getSystem(const String& name)
 	throw Exception("System not found: " + name, HalleyExceptions::Entity);
 }
 
+System& World::getSystem(StringId name)
+{
+	for (auto& tl : systems) {
+		for (auto& s : tl) {
+			if (s->nameId == name) {
+				return *s.get();
+			}
+		}
+	}
+	throw Exception("System not found: " + name.getString(), HalleyExceptions::Entity);
+}
+
 Service& World::addService(std::shared_ptr<Service> service)
 {
 	auto& ref = *service;
@@ -129,6 +168,20 @@ void World::loadSystems(const ConfigNode& root, std::function<std::unique_ptr<Sy
 	}
 }
 
+EntityMessageQueueBase* World::tryGetMessageQueue(int msgType) const
+{
+	return msgType >= 0 && size_t(msgType) < messageQueues.size() ? messageQueues[msgType].get() : nullptr;
+}
+
+std::unique_ptr<EntityMessageQueueBase>& World::getMessageQueueSlot(int msgType)
+{
+	Expects(msgType >= 0);
+	if (size_t(msgType) >= messageQueues.size()) {
+		messageQueues.resize(size_t(msgType) + 1);
+	}
+	return messageQueues[msgType];
+}
+
 Service& World::getService(const String& name) const
 {
 	auto iter = services.find(name);
@@ -138,15 +191,74 @@ Service& World::getService(const String& name) const
 	return *iter->second;
 }
 
+void World::setArchetypeStorage(bool enabled)
+{
+	if (enabled != archetypeStorage && (!entities.empty() || !entitiesPendingCreation.empty())) {
+		throw Exception("Archetype storage must be set before any entities are created.", HalleyExceptions::Entity);
+	}
+	archetypeStorage = enabled;
+}
+
+bool World::hasArchetypeStorage() const
+{
+	return archetypeStorage;
+}
+
+void World::setParallelSystems(bool enabled)
+{
+	parallelSystems = enabled;
+}
+
+bool World::hasParallelSystems() const
+{
+	return parallelSystems;
+}
+
+void World::setStepTimeTarget(int64_t ns)
+{
+	stepTimeTarget = ns;
+	if (ns == 0) {
+		budgetScale = 1.0f;
+	}
+}
+
+float World::getBudgetScale() const
+{
+	return budgetScale;
+}
+
 EntityRef World::createEntity()
 {
-	Entity* entity = new(PoolAllocator<Entity>::alloc()) Entity();
-	if (entity == nullptr) {
-		throw Exception("Error creating entity - out of memory?", HalleyExceptions::Entity);
+	return EntityRef(allocateEntity(), *this);
+}
+
+Vector<EntityId> World::createEntities(size_t count, std::function<void(EntityRef&)> prototype)
+{
+	entityMap.reserve(count);
+	entitiesPendingCreation.reserve(entitiesPendingCreation.size() + count);
+
+	Vector<EntityId> result;
+	result.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		EntityRef ref(allocateEntity(), *this);
+		if (prototype) {
+			prototype(ref);
+		}
+		result.push_back(ref.getEntityId());
 	}
-	entitiesPendingCreation.push_back(entity);
-	allocateEntity(entity);
-	return EntityRef(*entity, *this);
+	return result;
+}
+
+EntityRef World::instantiatePrefab(const PrefabTemplate& prefab)
+{
+	EntityRef ref(allocateEntity(), *this);
+	prefab.instantiate(ref);
+	return ref;
+}
+
+Vector<EntityId> World::instantiatePrefab(const PrefabTemplate& prefab, size_t count)
+{
+	return createEntities(count, [&] (EntityRef& e) { prefab.instantiate(e); });
 }
 
 void World::destroyEntity(EntityId id)
@@ -158,6 +270,17 @@ void World::destroyEntity(EntityId id)
 	}
 }
 
+void World::destroyEntities(gsl::span<const EntityId> ids)
+{
+	for (auto& id: ids) {
+		auto e = tryGetEntity(id);
+		if (e) {
+			e->destroy();
+		}
+	}
+	entityDirty = true;
+}
+
 EntityRef World::getEntity(EntityId id)
 {
 	Entity* entity = tryGetEntity(id);
@@ -181,11 +304,65 @@ size_t World::numEntities() const
 	return entities.size();
 }
 
+EntityCommandBuffer& World::getCommandBuffer()
+{
+	auto& cache = commandBufferCache;
+	if (cache.worldId != worldId) {
+		std::lock_guard<std::mutex> lock(commandBuffersMutex);
+		const auto threadId = std::this_thread::get_id();
+		auto iter = std::find_if(commandBuffers.begin(), commandBuffers.end(), [&] (const std::pair<std::thread::id, std::unique_ptr<EntityCommandBuffer>>& b) { return b.first == threadId; });
+		if (iter == commandBuffers.end()) {
+			commandBuffers.emplace_back(threadId, std::make_unique<EntityCommandBuffer>());
+			iter = commandBuffers.end() - 1;
+		}
+		cache.worldId = worldId;
+		cache.buffer = iter->second.get();
+	}
+	return *cache.buffer;
+}
+
+void World::applyCommandBuffers()
+{
+	{
+		std::lock_guard<std::mutex> lock(commandBuffersMutex);
+		commandBuffersToApply.clear();
+		for (auto& b: commandBuffers) {
+			if (!b.second->empty()) {
+				commandBuffersToApply.push_back(b.second.get());
+			}
+		}
+	}
+
+	if (!commandBuffersToApply.empty()) {
+		HALLEY_DEBUG_TRACE();
+		EntityCommandBuffer::apply(*this, commandBuffersToApply);
+	}
+}
+
 void World::onEntityDirty()
 {
 	entityDirty = true;
 }
 
+uint32_t World::getChangeVersion() const
+{
+	return changeVersion;
+}
+
+uint32_t World::getComponentTypeVersion(int componentId) const
+{
+	return componentTypeVersions[componentId].load(std::memory_order_relaxed);
+}
+
+void World::markComponentTypeChanged(int componentId, uint32_t version)
+{
+	// May be called from many threads at once, so avoid writing unless it'd change
+	auto& v = componentTypeVersions[componentId];
+	if (v.load(std::memory_order_relaxed) < version) {
+		v.store(version, std::memory_order_relaxed);
+	}
+}
+
 void World::deleteEntity(Entity* entity)
 {
 	Expects (entity);
@@ -203,18 +380,66 @@ int64_t World::getAverageTime(TimeLine timeline) const
 	return timer[int(timeline)].averageElapsedNanoSeconds();
 }
 
+TimeHistogramStats World::getTimeStats(TimeLine timeline, TimeHistogram::Window window) const
+{
+	return timer[int(timeline)].getHistogram().getStats(window);
+}
+
+String World::getTimeReport() const
+{
+	String result;
+	if (collectMetrics) {
+		const char* timelineNames[] = { "Fixed", "Variable", "Render" };
+		for (int i = 0; i < int(TimeLine::NUMBER_OF_TIMELINES); ++i) {
+			const auto stats = getTimeStats(TimeLine(i), TimeHistogram::Window::Total);
+			if (stats.samples > 0) {
+				result += String(timelineNames[i]) + " world: " + stats.toString() + "\n";
+			}
+			for (auto& system: systems[i]) {
+				result += "  " + system->getName() + ": " + system->getTimeStats(TimeHistogram::Window::Total).toString() + "\n";
+			}
+		}
+	}
+	return result;
+}
+
+void World::addTelemetry(TelemetryFrame& frame) const
+{
+	frame.add("world.entities", double(numEntities()));
+	if (collectMetrics) {
+		for (auto& tl: systems) {
+			for (auto& system: tl) {
+				frame.add("system." + system->getName(), double(system->getNanoSecondsTakenAvg()));
+			}
+		}
+	}
+}
+
 void World::step(TimeLine timeline, Time elapsed)
 {
+	MemoryTagScope memoryTag(MemoryTag::Entity);
 	auto& t = timer[int(timeline)];
 	if (collectMetrics) {
 		t.beginSample();
 	}
+	const int64_t startNs = stepTimeTarget != 0 ? Profiler::getTimeNs() : 0;
 
 	spawnPending();
 
 	initSystems();
 	updateSystems(timeline, elapsed);
 
+	if (stepTimeTarget != 0) {
+		// Shrink quickly in proportion to how far over it went, and recover slowly, so it doesn't oscillate
+		const int64_t stepNs = Profiler::getTimeNs() - startNs;
+		if (stepNs > stepTimeTarget) {
+			budgetScale *= std::max(float(stepTimeTarget) / float(stepNs), 0.5f);
+		} else {
+			budgetScale += 0.05f;
+		}
+		budgetScale = clamp(budgetScale, 0.1f, 1.0f);
+	}
+
 	if (collectMetrics) {
 		t.endSample();
 	}
@@ -235,20 +460,36 @@ void World::render(RenderContext& rc) const
 	}
 }
 
-void World::allocateEntity(Entity* entity) {
+void World::prepareRender()
+{
+	initSystems();
+	prepareRenderSystems();
+}
+
+Entity& World::allocateEntity()
+{
+	Entity* entity = new(PoolAllocator<Entity>::alloc()) Entity();
+	if (entity == nullptr) {
+		throw Exception("Error creating entity - out of memory?", HalleyExceptions::Entity);
+	}
+	entitiesPendingCreation.push_back(entity);
+
 	auto res = entityMap.alloc();
 	*res.first = entity;
 	entity->uid.value = res.second;
+	return *entity;
 }
 
 void World::spawnPending()
 {
+	applyCommandBuffers();
+
 	if (!entitiesPendingCreation.empty()) {
 		HALLEY_DEBUG_TRACE();
 		for (auto& e : entitiesPendingCreation) {
 			e->onReady();
 		}
-		std::move(entitiesPendingCreation.begin(), entitiesPendingCreation.end(), std::insert_iterator<decltype(entities)>(entities, entities.end()));
+		entities.insert(entities.end(), entitiesPendingCreation.begin(), entitiesPendingCreation.end());
 		entitiesPendingCreation.clear();
 		entityDirty = true;
 		HALLEY_DEBUG_TRACE();
@@ -257,6 +498,168 @@ void World::spawnPending()
 	updateEntities();
 }
 
+void World::snapshot(WorldSnapshot& snapshot)
+{
+	spawnPending();
+
+	auto writeEntity = [this] (Serializer& s, const Entity& entity)
+	{
+		serializeEntity(entity, s, false);
+	};
+
+	snapshot.entityIds.resize(entities.size());
+	snapshot.offsets.resize(entities.size());
+	Serializer s(snapshot.data);
+	for (size_t i = 0; i < entities.size(); ++i) {
+		snapshot.entityIds[i] = entities[i]->getEntityId();
+		snapshot.offsets[i] = uint32_t(s.getSize());
+		writeEntity(s, *entities[i]);
+	}
+
+	snapshot.poolState = Serializer::toBytes([&] (Serializer& s) { entityMap.serializeState(s); });
+}
+
+void World::restore(const WorldSnapshot& snapshot)
+{
+	HALLEY_DEBUG_TRACE();
+
+	// Remove everything that's currently alive
+	spawnPending();
+	for (auto& e: entities) {
+		e->destroy();
+	}
+	entityDirty = true;
+	updateEntities();
+
+	{
+		Deserializer s(snapshot.poolState);
+		entityMap.deserializeState(s);
+	}
+
+	entitiesPendingCreation.reserve(snapshot.getNumEntities());
+	for (size_t i = 0; i < snapshot.getNumEntities(); ++i) {
+		restoreEntity(snapshot.getEntityId(i), snapshot.getEntityData(i));
+	}
+
+	spawnPending();
+	HALLEY_DEBUG_TRACE();
+}
+
+void World::evictEntities(gsl::span<const EntityId> ids, WorldSnapshot& snapshot)
+{
+	HALLEY_DEBUG_TRACE();
+	spawnPending();
+
+	snapshot.clear();
+	Serializer s(snapshot.data);
+	for (auto& id: ids) {
+		auto slot = entityMap.get(id.value);
+		Entity* entity = slot ? *slot : nullptr;
+		if (!entity || !entity->isAlive()) {
+			continue;
+		}
+
+		snapshot.entityIds.push_back(id);
+		snapshot.offsets.push_back(uint32_t(s.getSize()));
+		serializeEntity(*entity, s, false);
+
+		// Detached from its slot, so updateEntities deletes it without freeing the id
+		*slot = nullptr;
+		entity->destroy();
+	}
+
+	entityDirty = true;
+	updateEntities();
+}
+
+void World::restoreEntities(const WorldSnapshot& snapshot)
+{
+	entitiesPendingCreation.reserve(entitiesPendingCreation.size() + snapshot.getNumEntities());
+	for (size_t i = 0; i < snapshot.getNumEntities(); ++i) {
+		const EntityId id = snapshot.getEntityId(i);
+		auto slot = entityMap.get(id.value);
+		if (!slot || *slot) {
+			throw Exception("Entity " + id.toString() + " is not evicted, so it can't be restored.", HalleyExceptions::Entity);
+		}
+		restoreEntity(id, snapshot.getEntityData(i));
+	}
+}
+
+void World::restoreEntity(EntityId id, gsl::span<const gsl::byte> data)
+{
+	auto slot = entityMap.get(id.value);
+	if (!slot) {
+		throw Exception("Entity " + id.toString() + " in snapshot doesn't match the allocator state.", HalleyExceptions::Entity);
+	}
+
+	Entity* entity = new(PoolAllocator<Entity>::alloc()) Entity();
+	entity->uid = id;
+	*slot = entity;
+	entitiesPendingCreation.push_back(entity);
+
+	Deserializer s(data);
+	deserializeEntity(*entity, s);
+}
+
+void World::serializeEntity(const Entity& entity, Serializer& s, bool replicatedOnly) const
+{
+	int32_t nComponents = 0;
+	for (int i = 0; i < entity.liveComponents; ++i) {
+		if (!replicatedOnly || ComponentDeleterTable::get(entity.components[i].first)->isReplicated()) {
+			++nComponents;
+		}
+	}
+
+	s << nComponents;
+	for (int i = 0; i < entity.liveComponents; ++i) {
+		const auto& c = entity.components[i];
+		auto deleter = ComponentDeleterTable::get(c.first);
+		if (!replicatedOnly || deleter->isReplicated()) {
+			s << int32_t(c.first);
+			deleter->serialize(s, c.second);
+		}
+	}
+}
+
+void World::deserializeEntity(Entity& entity, Deserializer& s)
+{
+	bool added = false;
+
+	int32_t nComponents;
+	s >> nComponents;
+	for (int32_t j = 0; j < nComponents; ++j) {
+		int32_t componentId;
+		s >> componentId;
+		auto deleter = ComponentDeleterTable::tryGet(componentId);
+		if (!deleter) {
+			throw Exception("Component type " + toString(componentId) + " has never been used in this process, so it can't be deserialized.", HalleyExceptions::Entity);
+		}
+
+		Component* existing = nullptr;
+		for (int i = 0; i < entity.liveComponents; ++i) {
+			if (entity.components[i].first == componentId) {
+				existing = entity.components[i].second;
+				break;
+			}
+		}
+
+		if (existing) {
+			deleter->deserialize(s, existing);
+			entity.markComponentChanged(componentId, changeVersion);
+			markComponentTypeChanged(componentId, changeVersion);
+		} else {
+			Component* component = deleter->create();
+			deleter->deserialize(s, component);
+			entity.addComponent(component, componentId);
+			added = true;
+		}
+	}
+
+	if (added) {
+		entity.markDirty(*this);
+	}
+}
+
 void World::updateEntities()
 {
 	if (!entityDirty) {
@@ -265,8 +668,10 @@ void World::updateEntities()
 
 	HALLEY_DEBUG_TRACE();
 	size_t nEntities = entities.size();
+	const uint32_t version = ++changeVersion;
 
 	std::vector<size_t> entitiesRemoved;
+	std::vector<Entity*> entitiesRelocated;
 
 	struct FamilyTodo {
 		std::vector<Entity*> toAdd;
@@ -274,6 +679,17 @@ void World::updateEntities()
 	};
 	std::map<FamilyMaskType, FamilyTodo> pending;
 
+	// Entities that are spawned or changed together usually share masks, so skip the map lookup when it's the same as last time
+	FamilyMaskType lastMask;
+	FamilyTodo* lastTodo = nullptr;
+	auto getTodo = [&] (const FamilyMaskType& mask) -> FamilyTodo& {
+		if (!lastTodo || lastMask != mask) {
+			lastMask = mask;
+			lastTodo = &pending[mask];
+		}
+		return *lastTodo;
+	};
+
 	// Update all entities
 	// This loop should be as fast as reasonably possible
 	for (size_t i = 0; i < nEntities; i++) {
@@ -287,18 +703,21 @@ void World::updateEntities()
 			// First of all, let's check if it's dead
 			if (!entity.isAlive()) {
 				// Remove from systems
-				pending[entity.getMask()].toRemove.push_back(&entity);
+				getTodo(entity.getMask()).toRemove.push_back(&entity);
 				entitiesRemoved.push_back(i);
 			} else {
 				// It's alive, so check old and new system inclusions
 				FamilyMaskType oldMask = entity.getMask();
-				entity.refresh();
+				entity.refresh(version);
 				FamilyMaskType newMask = entity.getMask();
 
 				// Did it change?
 				if (oldMask != newMask) {
-					pending[oldMask].toRemove.push_back(&entity);
-					pending[newMask].toAdd.push_back(&entity);
+					getTodo(oldMask).toRemove.push_back(&entity);
+					getTodo(newMask).toAdd.push_back(&entity);
+					if (archetypeStorage) {
+						entitiesRelocated.push_back(&entity);
+					}
 				}
 			}
 		}
@@ -310,6 +729,31 @@ void World::updateEntities()
 			for (auto& e: todo.second.toRemove) {
 				fam->removeEntity(*e);
 			}
+		}
+	}
+
+	if (!entitiesRelocated.empty()) {
+		HALLEY_DEBUG_TRACE();
+		// Families must let go of the old component addresses before they're moved
+		for (auto& iter : families) {
+			iter->removeDeadEntities();
+		}
+		for (auto& e: entitiesRelocated) {
+			e->moveToArchetype(getArchetype(e->getMask()));
+		}
+	}
+
+	for (auto& todo: pending) {
+		if (!todo.second.toAdd.empty()) {
+			// Conservative, but it's only used to skip work when nothing of a type changed at all
+			auto& bits = todo.first.getRealValue();
+			for (size_t i = 0; i < bits.size(); ++i) {
+				if (bits[i]) {
+					markComponentTypeChanged(int(i), version);
+				}
+			}
+		}
+		for (auto& fam: getFamiliesFor(todo.first)) {
 			for (auto& e: todo.second.toAdd) {
 				fam->addEntity(*e);
 			}
@@ -330,8 +774,11 @@ void World::updateEntities()
 			size_t idx = entitiesRemoved[i];
 			auto& entity = *entities[idx];
 
-			// Remove
-			entityMap.freeId(entity.getEntityId().value);
+			// Remove, keeping the id reserved if it was evicted
+			auto slot = entityMap.get(entity.getEntityId().value);
+			if (slot && *slot == &entity) {
+				entityMap.freeId(entity.getEntityId().value);
+			}
 			deleteEntity(&entity);
 
 			// Put it at the back of the array, so it's removed when the array gets resized
@@ -355,12 +802,97 @@ void World::initSystems() const
 
 void World::updateSystems(TimeLine timeline, Time time)
 {
-	for (auto& system : getSystems(timeline)) {
-		system->doUpdate(time);
+	if (parallelSystems && Executors::getCPU().threadCount() > 1) {
+		updateSystemsParallel(timeline, time);
+		return;
+	}
+
+	auto& timelineSystems = getSystems(timeline);
+	for (size_t i = 0; i < timelineSystems.size(); ++i) {
+		EntityCommandBuffer::SortKeyScope sortKey(EntityCommandBuffer::makeSortKey(uint32_t(i), 0));
+		timelineSystems[i]->advanceChangeVersion(++changeVersion);
+		timelineSystems[i]->doUpdate(time);
+		spawnPending();
+	}
+}
+
+void World::updateSystemsParallel(TimeLine timeline, Time time)
+{
+	if (systemBatchesDirty) {
+		buildSystemBatches();
+	}
+
+	auto& timelineSystems = getSystems(timeline);
+	size_t start = 0;
+	for (size_t end: systemBatchEnds[int(timeline)]) {
+		// Recorded entity commands are ordered by system, so they're applied the same way regardless of which thread ran what
+		EntityCommandBuffer::SortKeyScope sortKey(EntityCommandBuffer::makeSortKey(uint32_t(start), 0));
+		for (size_t i = start; i < end; ++i) {
+			timelineSystems[i]->advanceChangeVersion(++changeVersion);
+		}
+		if (end - start == 1) {
+			timelineSystems[start]->doUpdate(time);
+		} else {
+			// Run the first system of the batch on this thread, and the rest on the CPU executors
+			Vector<std::exception_ptr> errors(end - start);
+			Vector<Future<void>> futures;
+			futures.reserve(end - start - 1);
+			for (size_t i = start + 1; i < end; ++i) {
+				System* system = timelineSystems[i].get();
+				std::exception_ptr* error = &errors[i - start];
+				const uint64_t key = EntityCommandBuffer::makeSortKey(uint32_t(i), 0);
+				futures.push_back(Concurrent::execute(Executors::getCPU(), TaskPriority::Critical, [system, error, time, key] () {
+					EntityCommandBuffer::SortKeyScope sortKey(key);
+					try {
+						system->doUpdate(time);
+					} catch (...) {
+						*error = std::current_exception();
+					}
+				}));
+			}
+
+			try {
+				timelineSystems[start]->doUpdate(time);
+			} catch (...) {
+				errors[0] = std::current_exception();
+			}
+			Concurrent::whenAll(futures.begin(), futures.end()).wait();
+
+			for (auto& e: errors) {
+				if (e) {
+					std::rethrow_exception(e);
+				}
+			}
+		}
 		spawnPending();
+		start = end;
 	}
 }
 
+void World::buildSystemBatches()
+{
+	// Batches are runs of consecutive systems with no conflicts between them, so that conflicting systems
+	// still execute in the order they were declared in
+	for (size_t t = 0; t < systems.size(); ++t) {
+		auto& timelineSystems = systems[t];
+		auto& batchEnds = systemBatchEnds[t];
+		batchEnds.clear();
+
+		size_t batchStart = 0;
+		for (size_t i = 1; i <= timelineSystems.size(); ++i) {
+			bool canJoin = i < timelineSystems.size();
+			for (size_t j = batchStart; j < i && canJoin; ++j) {
+				canJoin = !timelineSystems[j]->getDependencies().conflictsWith(timelineSystems[i]->getDependencies());
+			}
+			if (!canJoin) {
+				batchEnds.push_back(i);
+				batchStart = i;
+			}
+		}
+	}
+	systemBatchesDirty = false;
+}
+
 void World::renderSystems(RenderContext& rc) const
 {
 	for (auto& system : getSystems(TimeLine::Render)) {
@@ -368,6 +900,13 @@ void World::renderSystems(RenderContext& rc) const
 	}
 }
 
+void World::prepareRenderSystems()
+{
+	for (auto& system : getSystems(TimeLine::Render)) {
+		system->doPrepareRender();
+	}
+}
+
 void World::onAddFamily(Family& family)
 {
 	// Add any existing entities to this new family
@@ -401,3 +940,15 @@ const std::vector<Family*>& World::getFamiliesFor(const FamilyMaskType& mask)
 		return familyCache[mask];
 	}
 }
+
+ArchetypeStorage& World::getArchetype(const FamilyMaskType& mask)
+{
+	auto i = archetypes.find(mask);
+	if (i != archetypes.end()) {
+		return *i->second;
+	}
+	auto storage = std::make_unique<ArchetypeStorage>(mask);
+	auto& result = *storage;
+	archetypes[mask] = std::move(storage);
+	return result;
+}
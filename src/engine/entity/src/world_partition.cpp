@@ -0,0 +1,251 @@
+#include "world_partition.h"
+#include "world.h"
+#include <halley/bytes/byte_serializer.h>
+#include <halley/concurrency/concurrent.h>
+#include <halley/text/string_converter.h>
+#include <limits>
+
+using namespace Halley;
+
+WorldPartition::WorldPartition(World& world, Path storageDir, float cellSize, float activeRadius, float evictRadius)
+	: world(world)
+	, storageDir(std::move(storageDir))
+	, cellSize(cellSize)
+	, activeRadius(activeRadius)
+	, evictRadius(std::max(evictRadius, activeRadius))
+{
+	Expects(cellSize > 0);
+}
+
+WorldPartition::~WorldPartition()
+{
+	// Let the writes finish, so the files aren't left half-written
+	for (auto& c: cells) {
+		if (c.second.evicted) {
+			c.second.saving.wait();
+		}
+		if (c.second.state == CellState::Loading) {
+			c.second.loading.wait();
+		}
+	}
+}
+
+void WorldPartition::add(EntityId id, Vector2f position)
+{
+	const auto coords = getCell(position);
+	entityCells[id] = coords;
+	getOrCreateCell(coords).entities.push_back(id);
+}
+
+void WorldPartition::move(EntityId id, Vector2f position)
+{
+	const auto iter = entityCells.find(id);
+	if (iter == entityCells.end()) {
+		add(id, position);
+		return;
+	}
+
+	const auto coords = getCell(position);
+	if (iter->second == coords) {
+		return;
+	}
+
+	remove(id);
+	add(id, position);
+}
+
+void WorldPartition::remove(EntityId id)
+{
+	const auto iter = entityCells.find(id);
+	if (iter == entityCells.end()) {
+		return;
+	}
+
+	auto& entities = cells.at(iter->second).entities;
+	const auto entityIter = std::find(entities.begin(), entities.end(), id);
+	if (entityIter != entities.end()) {
+		std::swap(*entityIter, entities.back());
+		entities.pop_back();
+	}
+	entityCells.erase(iter);
+}
+
+void WorldPartition::update(gsl::span<const Vector2f> focusPoints)
+{
+	for (auto& c: cells) {
+		finishSaving(c.second);
+		finishLoading(c.second);
+	}
+
+	if (!focusPoints.empty()) {
+		for (auto& c: cells) {
+			auto& cell = c.second;
+			const float distance = getDistance(cell, focusPoints);
+			if (cell.state == CellState::Loaded && distance > evictRadius && !cell.entities.empty()) {
+				evict(cell);
+			} else if (cell.state == CellState::Evicted && distance <= activeRadius) {
+				load(cell);
+			}
+		}
+	}
+
+	for (auto& c: cells) {
+		evictStrays(c.second);
+	}
+}
+
+void WorldPartition::waitForLoads(gsl::span<const Vector2f> focusPoints)
+{
+	update(focusPoints);
+	for (auto& c: cells) {
+		auto& cell = c.second;
+		if (cell.state == CellState::Loading) {
+			cell.loading.wait();
+			finishLoading(cell);
+		}
+	}
+}
+
+Vector2i WorldPartition::getCell(Vector2f position) const
+{
+	return Vector2i(int(std::floor(position.x / cellSize)), int(std::floor(position.y / cellSize)));
+}
+
+bool WorldPartition::isLoaded(Vector2i coords) const
+{
+	const auto iter = cells.find(coords);
+	return iter == cells.end() || iter->second.state == CellState::Loaded;
+}
+
+size_t WorldPartition::getNumLoadedCells() const
+{
+	size_t n = 0;
+	for (auto& c: cells) {
+		if (c.second.state == CellState::Loaded) {
+			++n;
+		}
+	}
+	return n;
+}
+
+size_t WorldPartition::getNumEvictedEntities() const
+{
+	return numEvictedEntities;
+}
+
+WorldPartition::Cell& WorldPartition::getOrCreateCell(Vector2i coords)
+{
+	auto iter = cells.find(coords);
+	if (iter != cells.end()) {
+		return iter->second;
+	}
+	auto& cell = cells[coords];
+	cell.coords = coords;
+	return cell;
+}
+
+float WorldPartition::getDistance(const Cell& cell, gsl::span<const Vector2f> focusPoints) const
+{
+	const Vector2f topLeft = Vector2f(cell.coords) * cellSize;
+	const Vector2f bottomRight = topLeft + Vector2f(cellSize, cellSize);
+
+	float best = std::numeric_limits<float>::max();
+	for (auto& p: focusPoints) {
+		const float dx = std::max(std::max(topLeft.x - p.x, p.x - bottomRight.x), 0.0f);
+		const float dy = std::max(std::max(topLeft.y - p.y, p.y - bottomRight.y), 0.0f);
+		best = std::min(best, Vector2f(dx, dy).length());
+	}
+	return best;
+}
+
+Path WorldPartition::getCellPath(Vector2i coords) const
+{
+	return storageDir / ("cell_" + toString(coords.x) + "_" + toString(coords.y) + ".dat");
+}
+
+void WorldPartition::evict(Cell& cell)
+{
+	auto snapshot = std::make_shared<WorldSnapshot>();
+	world.evictEntities(cell.entities, *snapshot);
+	cell.entities.clear();
+	cell.numEvicted = snapshot->getNumEntities();
+	numEvictedEntities += cell.numEvicted;
+	cell.state = CellState::Evicted;
+
+	// Kept in memory until it's written, so the cell can come back straight away. The disk executor runs tasks in
+	// order, so a cell that's evicted again can't have its file overwritten by an older write.
+	cell.evicted = snapshot;
+	cell.saving = Concurrent::execute(Executors::getDiskIO(), [snapshot, path = getCellPath(cell.coords)] ()
+	{
+		Path::writeFile(path, Serializer::toBytes(*snapshot));
+	});
+}
+
+void WorldPartition::evictStrays(Cell& cell)
+{
+	if (cell.state == CellState::Loaded || cell.entities.empty()) {
+		return;
+	}
+
+	WorldSnapshot snapshot;
+	world.evictEntities(cell.entities, snapshot);
+	cell.entities.clear();
+	numEvictedEntities += snapshot.getNumEntities();
+	cell.strays.push_back(std::move(snapshot));
+}
+
+void WorldPartition::load(Cell& cell)
+{
+	if (cell.evicted) {
+		const auto snapshot = std::move(cell.evicted);
+		restore(cell, *snapshot);
+	} else {
+		cell.state = CellState::Loading;
+		cell.loading = Concurrent::execute(Executors::getDiskIO(), [path = getCellPath(cell.coords)] ()
+		{
+			return Path::readFile(path);
+		});
+	}
+}
+
+void WorldPartition::finishLoading(Cell& cell)
+{
+	if (cell.state != CellState::Loading || !cell.loading.isReady()) {
+		return;
+	}
+
+	const auto bytes = cell.loading.get();
+	cell.loading = Future<Bytes>();
+	const auto snapshot = Deserializer::fromBytes<WorldSnapshot>(bytes);
+	if (snapshot.getNumEntities() != cell.numEvicted) {
+		throw Exception("Partition cell " + toString(cell.coords.x) + ", " + toString(cell.coords.y) + " failed to load from " + getCellPath(cell.coords).string(), HalleyExceptions::Entity);
+	}
+	restore(cell, snapshot);
+}
+
+void WorldPartition::finishSaving(Cell& cell)
+{
+	if (cell.evicted && cell.saving.isReady()) {
+		cell.evicted.reset();
+	}
+}
+
+void WorldPartition::restore(Cell& cell, const WorldSnapshot& snapshot)
+{
+	auto addAll = [&] (const WorldSnapshot& s)
+	{
+		world.restoreEntities(s);
+		for (size_t i = 0; i < s.getNumEntities(); ++i) {
+			cell.entities.push_back(s.getEntityId(i));
+		}
+		numEvictedEntities -= s.getNumEntities();
+	};
+
+	addAll(snapshot);
+	for (auto& s: cell.strays) {
+		addAll(s);
+	}
+	cell.strays.clear();
+	cell.numEvicted = 0;
+	cell.state = CellState::Loaded;
+}
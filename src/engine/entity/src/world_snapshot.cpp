@@ -0,0 +1,153 @@
+#include "world_snapshot.h"
+#include <halley/bytes/byte_serializer.h>
+#include <halley/data_structures/hash_map.h>
+#include <halley/support/exception.h>
+#include <cstring>
+
+using namespace Halley;
+
+void WorldSnapshot::clear()
+{
+	poolState.clear();
+	entityIds.clear();
+	offsets.clear();
+	data.clear();
+}
+
+size_t WorldSnapshot::getNumEntities() const
+{
+	return entityIds.size();
+}
+
+size_t WorldSnapshot::getSizeBytes() const
+{
+	return poolState.size() + data.size() + entityIds.size() * (sizeof(EntityId) + sizeof(uint32_t));
+}
+
+EntityId WorldSnapshot::getEntityId(size_t idx) const
+{
+	return entityIds[idx];
+}
+
+gsl::span<const gsl::byte> WorldSnapshot::getEntityData(size_t idx) const
+{
+	const uint32_t start = offsets[idx];
+	const uint32_t end = idx + 1 < offsets.size() ? offsets[idx + 1] : uint32_t(data.size());
+	return gsl::as_bytes(gsl::span<const Byte>(data.data() + start, end - start));
+}
+
+void WorldSnapshot::serialize(Serializer& s) const
+{
+	s << poolState;
+	s << uint32_t(entityIds.size());
+	for (size_t i = 0; i < entityIds.size(); ++i) {
+		s << entityIds[i].value;
+		s << offsets[i];
+	}
+	s << data;
+}
+
+void WorldSnapshot::deserialize(Deserializer& s)
+{
+	clear();
+	s >> poolState;
+	uint32_t n;
+	s >> n;
+	entityIds.resize(n);
+	offsets.resize(n);
+	for (size_t i = 0; i < n; ++i) {
+		s >> entityIds[i].value;
+		s >> offsets[i];
+	}
+	s >> data;
+}
+
+WorldSnapshotDelta WorldSnapshot::makeDelta(const WorldSnapshot& base, const WorldSnapshot& current)
+{
+	HashMap<EntityId, size_t> baseIndices;
+	baseIndices.reserve(base.getNumEntities());
+	for (size_t i = 0; i < base.getNumEntities(); ++i) {
+		baseIndices[base.entityIds[i]] = i;
+	}
+
+	WorldSnapshotDelta delta;
+	delta.order = current.entityIds;
+	delta.changed.poolState = current.poolState;
+	for (size_t i = 0; i < current.getNumEntities(); ++i) {
+		const auto entityData = current.getEntityData(i);
+		auto iter = baseIndices.find(current.entityIds[i]);
+		if (iter != baseIndices.end()) {
+			const auto baseData = base.getEntityData(iter->second);
+			if (baseData.size() == entityData.size() && memcmp(baseData.data(), entityData.data(), size_t(entityData.size())) == 0) {
+				continue;
+			}
+		}
+		delta.changed.addEntity(current.entityIds[i], entityData);
+	}
+	return delta;
+}
+
+WorldSnapshot WorldSnapshot::applyDelta(const WorldSnapshot& base, const WorldSnapshotDelta& delta)
+{
+	HashMap<EntityId, size_t> baseIndices;
+	baseIndices.reserve(base.getNumEntities());
+	for (size_t i = 0; i < base.getNumEntities(); ++i) {
+		baseIndices[base.entityIds[i]] = i;
+	}
+
+	const auto& changed = delta.changed;
+	size_t nextChanged = 0;
+
+	WorldSnapshot result;
+	result.poolState = changed.poolState;
+	result.data.reserve(base.data.size());
+	for (auto& id: delta.order) {
+		// Changed entities are stored in the same order as they appear in order
+		if (nextChanged < changed.getNumEntities() && changed.entityIds[nextChanged] == id) {
+			result.addEntity(id, changed.getEntityData(nextChanged++));
+		} else {
+			auto iter = baseIndices.find(id);
+			if (iter == baseIndices.end()) {
+				throw Exception("Entity " + id.toString() + " missing from base snapshot when applying delta.", HalleyExceptions::Entity);
+			}
+			result.addEntity(id, base.getEntityData(iter->second));
+		}
+	}
+	return result;
+}
+
+void WorldSnapshot::addEntity(EntityId id, gsl::span<const gsl::byte> entityData)
+{
+	entityIds.push_back(id);
+	offsets.push_back(uint32_t(data.size()));
+	const size_t start = data.size();
+	data.resize(start + size_t(entityData.size()));
+	if (entityData.size() > 0) {
+		memcpy(data.data() + start, entityData.data(), size_t(entityData.size()));
+	}
+}
+
+size_t WorldSnapshotDelta::getNumChanged() const
+{
+	return changed.getNumEntities();
+}
+
+void WorldSnapshotDelta::serialize(Serializer& s) const
+{
+	s << uint32_t(order.size());
+	for (auto& id: order) {
+		s << id.value;
+	}
+	s << changed;
+}
+
+void WorldSnapshotDelta::deserialize(Deserializer& s)
+{
+	uint32_t n;
+	s >> n;
+	order.resize(n);
+	for (auto& id: order) {
+		s >> id.value;
+	}
+	s >> changed;
+}
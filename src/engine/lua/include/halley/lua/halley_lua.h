@@ -1,3 +1,5 @@
 #pragma once
 
 #include "lua_state.h"
+#include "lua_profiler.h"
+#include "lua_state_pool.h"
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <gsl/gsl>
+#include "lua_reference.h"
+#include "lua_state.h"
+
+namespace Halley {
+	template <typename T>
+	class LuaFunction;
+
+	// Handle to a Lua function that's resolved once and kept pinned in the registry, so calls don't look it up by name.
+	// Calls go through LuaState::callWithPinnedErrorHandler, which uses the error handler kept at the bottom of the
+	// stack instead of pushing and popping one each time.
+	//
+	// For per-entity callbacks, make the function take a gsl::span<T> and loop over it in Lua; the whole span is
+	// then handed over as an array in a single call.
+	template <typename R, typename... Args>
+	class LuaFunction<R(Args...)> {
+	public:
+		LuaFunction() = default;
+
+		explicit LuaFunction(LuaReference function)
+			: function(std::move(function))
+		{}
+
+		LuaFunction(const LuaReference& table, const String& name)
+			: function(table[name])
+		{}
+
+		bool isValid() const
+		{
+			return function.isValid();
+		}
+
+		R operator()(Args... args) const
+		{
+			auto& state = function.getState();
+			function.pushToLuaStack();
+			int pushed[] = { 0, (ToLua<Args>()(state, args), 0)... };
+			(void)pushed;
+			state.callWithPinnedErrorHandler(int(sizeof...(Args)), LuaReturnSize<R>::value);
+			return FromLua<R>()(state);
+		}
+
+	private:
+		LuaReference function;
+	};
+
+	template <typename T>
+	struct ToLua<gsl::span<T>> {
+		inline void operator()(LuaState& state, gsl::span<T>& value) const {
+			auto ops = LuaStackOps(state);
+			ops.pushTable(int(value.size()), 0);
+			for (size_t i = 0; i < size_t(value.size()); ++i) {
+				ToLua<T>()(state, value[i]);
+				ops.setField(int(i + 1));
+			}
+		}
+	};
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <halley/text/halleystring.h>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+struct lua_State;
+struct lua_Debug;
+
+namespace Halley {
+	class LuaState;
+	class GameConsole;
+
+	// Sampling profiler for a LuaState. A count hook interrupts the VM every few hundred instructions and charges the
+	// time since the previous sample to whichever function is running, so its cost depends on the sample rate rather
+	// than on how many calls are made. While the engine Profiler is on, consecutive samples in the same function are
+	// also recorded into it as "script" spans.
+	//
+	// Once the hook has used up its budget for the frame, sampling is suspended until nextFrame, which must be called every frame.
+	// Hooks are per Lua thread and only inherited by new ones, so coroutines created before start() aren't sampled.
+	class LuaProfiler {
+	public:
+		struct Entry {
+			String name;
+			const char* traceName = nullptr;
+			uint64_t samples = 0;
+			int64_t timeNs = 0;
+		};
+
+		explicit LuaProfiler(LuaState& state);
+		~LuaProfiler();
+
+		LuaProfiler(const LuaProfiler& other) = delete;
+		LuaProfiler& operator=(const LuaProfiler& other) = delete;
+
+		// Must be called from outside of any Lua calls
+		void start(int instructionsPerSample = 1000);
+		void stop();
+		bool isRunning() const;
+
+		void setBudget(int64_t nsPerFrame); // 0 for no limit
+		void nextFrame();
+		void reset();
+
+		std::vector<Entry> getEntries() const; // Most time first
+		String generateReport(size_t maxEntries = 20) const;
+
+		// Registers "<command> [start [instructions]|stop|reset|N]", where N is how many entries to report.
+		// The devcon can run it too, through DevConServer::runConsoleCommand.
+		void registerConsoleCommand(GameConsole& console, const String& command = "luaprofile");
+		String onConsoleCommand(std::vector<String> args);
+
+	private:
+		using Key = std::pair<const void*, int>; // Source and line the function was defined at
+
+		LuaState& state;
+		lua_State* hookedState = nullptr;
+		int instructionsPerSample = 0;
+		bool suspended = false;
+
+		int64_t budgetNs = 0;
+		int64_t frameOverheadNs = 0;
+		uint64_t suspendedFrames = 0;
+
+		std::map<Key, Entry> entries;
+		uint64_t totalSamples = 0;
+
+		Entry* runEntry = nullptr;
+		int64_t runStartNs = 0;
+		int64_t lastSampleNs = 0;
+
+		static void hook(lua_State* lua, lua_Debug* ar);
+		void onSample(lua_State* lua, int64_t now);
+		void flushRun();
+		void setHook(bool enabled);
+	};
+}
@@ -81,6 +81,8 @@ namespace Halley {
 		}
 
 		int getRefId() const { return refId; }
+		bool isValid() const;
+		LuaState& getState() const;
 
 	private:
 		LuaState* lua;
@@ -10,10 +10,21 @@ struct lua_State;
 namespace Halley {
 	class Resources;
 	class LuaState;
+	class LuaProfiler;
+
+	struct LuaHeapStats {
+		size_t bytes = 0;
+		size_t peakBytes = 0;
+		size_t allocations = 0; // Live
+		uint64_t totalAllocations = 0;
+		int64_t lastGCStepNs = 0;
+	};
 
 	class LuaState {
 	public:
-		LuaState(Resources& resources);
+		// Modules are loaded from the precompiled copies made by the importer when available, unless useBytecode is false,
+		// which is meant for dev builds, where the sources give better error messages
+		LuaState(Resources& resources, bool useBytecode = true);
 		~LuaState();
 
 		const LuaReference* tryGetModule(const String& moduleName) const;
@@ -24,6 +35,20 @@ namespace Halley {
 
 		void call(int nArgs, int nRets);
 
+		// Same as call, but with the error handler already in place, rather than having to be pushed around each call
+		void callWithPinnedErrorHandler(int nArgs, int nRets);
+
+		// With automatic collection off, garbage is only collected by stepGC, so that it can be done at a chosen point
+		// of the frame instead of whenever an allocation happens to trigger it. stepGC then has to be called every frame,
+		// or memory will just keep growing.
+		void setAutomaticGC(bool enabled);
+		void setGCParameters(int pause, int stepMultiplier); // See LUA_GCSETPAUSE and LUA_GCSETSTEPMUL
+		bool stepGC(int64_t budgetNs); // Returns true if it finished a collection cycle
+		const LuaHeapStats& getHeapStats() const;
+
+		void setProfiler(LuaProfiler* profiler); // Called by LuaProfiler itself
+		LuaProfiler* getProfiler() const;
+
 		lua_State* getRawState();
 		
 		void pushCallback(LuaCallback&& callback);
@@ -35,16 +60,24 @@ namespace Halley {
 		String errorHandler(String message);
 
 	private:
+		LuaHeapStats heapStats; // Before lua, as it's used while creating it
 		lua_State* lua;
 		std::vector<lua_State*> pushedStates;
 		Resources* resources;
+		bool useBytecode;
 
 		std::unordered_map<String, LuaReference> modules;
 		std::vector<std::unique_ptr<LuaCallback>> closures;
 		std::unique_ptr<LuaReference> errorHandlerRef;
 		std::vector<int> errorHandlerStackPos;
+		int pinnedErrorHandlerPos = 0;
+		LuaProfiler* profiler = nullptr;
 
 		LuaReference loadScript(const String& chunkName, gsl::span<const gsl::byte> data);
+		LuaReference runChunk();
+		const LuaReference& loadModuleFromResources(const String& moduleName, const String& assetId);
+
+		static void* allocate(void* userData, void* ptr, size_t oldSize, size_t newSize);
 
 		void print(String string);
 		const LuaReference& packageLoader(String moduleName);
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "lua_state.h"
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Halley {
+	class Resources;
+
+	struct LuaMessage {
+		String channel;
+		String data;
+	};
+
+	// A set of independent LuaStates, for running scripts on several threads at once. Nothing is shared between the
+	// states: each one loads its own modules, so read-only data that every script needs has to be set up on all of them
+	// with forEachState. Scripts send results back by calling postMessage(channel, data), with data serialized to a string.
+	class LuaStatePool {
+	public:
+		// nStates defaults to one per CPU worker plus one for the calling thread, which takes part in parallelFor
+		LuaStatePool(Resources& resources, size_t nStates = 0, bool useBytecode = true);
+		LuaStatePool(const LuaStatePool& other) = delete;
+		LuaStatePool& operator=(const LuaStatePool& other) = delete;
+
+		size_t size() const;
+		LuaState& getState(size_t idx);
+
+		// Runs on the calling thread, and must not overlap with parallelFor
+		void forEachState(std::function<void(LuaState&)> f);
+
+		// Calls f(state, begin, end) over sub-ranges of [0, n) on Executors::getCPU(), with no state ever used by two threads at once
+		void parallelFor(size_t n, size_t grain, std::function<void(LuaState&, size_t, size_t)> f);
+
+		// Everything posted since the last call, grouped by the state that posted it
+		std::vector<LuaMessage> takeMessages();
+
+	private:
+		struct Entry {
+			std::unique_ptr<LuaState> state;
+			std::vector<LuaMessage> outbox;
+		};
+
+		std::vector<Entry> entries;
+		std::vector<size_t> freeEntries;
+		std::mutex mutex;
+		std::condition_variable condition;
+
+		size_t acquire();
+		void release(size_t idx);
+	};
+}
@@ -0,0 +1,197 @@
+#include <lua.hpp>
+#include "lua_profiler.h"
+#include "lua_state.h"
+#include "halley/core/game/game_console.h"
+#include "halley/support/profiler.h"
+#include "halley/text/string_converter.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+using namespace Halley;
+
+namespace {
+	// Longer gaps between samples mean that Lua wasn't running in between (e.g. it returned to C++), so they aren't counted
+	constexpr int64_t maxSampleGapNs = 1000000;
+}
+
+LuaProfiler::LuaProfiler(LuaState& state)
+	: state(state)
+{
+}
+
+LuaProfiler::~LuaProfiler()
+{
+	stop();
+}
+
+void LuaProfiler::start(int instructions)
+{
+	stop();
+	instructionsPerSample = std::max(instructions, 1);
+	hookedState = state.getRawState();
+	state.setProfiler(this);
+	setHook(true);
+}
+
+void LuaProfiler::stop()
+{
+	if (hookedState) {
+		setHook(false);
+		flushRun();
+		state.setProfiler(nullptr);
+		hookedState = nullptr;
+	}
+}
+
+bool LuaProfiler::isRunning() const
+{
+	return hookedState != nullptr;
+}
+
+void LuaProfiler::setBudget(int64_t nsPerFrame)
+{
+	budgetNs = nsPerFrame;
+}
+
+void LuaProfiler::nextFrame()
+{
+	flushRun();
+	frameOverheadNs = 0;
+	if (suspended && hookedState) {
+		setHook(true);
+	}
+}
+
+void LuaProfiler::reset()
+{
+	flushRun();
+	entries.clear();
+	totalSamples = 0;
+	suspendedFrames = 0;
+}
+
+std::vector<LuaProfiler::Entry> LuaProfiler::getEntries() const
+{
+	std::vector<Entry> result;
+	result.reserve(entries.size());
+	for (auto& e: entries) {
+		result.push_back(e.second);
+	}
+	std::sort(result.begin(), result.end(), [] (const Entry& a, const Entry& b)
+	{
+		return a.timeNs != b.timeNs ? a.timeNs > b.timeNs : a.samples > b.samples;
+	});
+	return result;
+}
+
+String LuaProfiler::generateReport(size_t maxEntries) const
+{
+	const auto sorted = getEntries();
+
+	std::stringstream ss;
+	ss << std::fixed << std::setprecision(2);
+	ss << totalSamples << " samples";
+	if (suspendedFrames > 0) {
+		ss << ", cut short by the budget on " << suspendedFrames << " frames";
+	}
+	ss << "\n" << std::right << std::setw(10) << "ms" << std::setw(10) << "Samples" << std::setw(8) << "%" << "  " << std::left << "Function" << "\n";
+	for (size_t i = 0; i < std::min(maxEntries, sorted.size()); ++i) {
+		const auto& e = sorted[i];
+		ss << std::right << std::setw(10) << (double(e.timeNs) / 1000000.0) << std::setw(10) << e.samples
+			<< std::setw(8) << (totalSamples > 0 ? 100.0 * double(e.samples) / double(totalSamples) : 0.0) << "  " << std::left << e.name.cppStr() << "\n";
+	}
+	return ss.str();
+}
+
+void LuaProfiler::registerConsoleCommand(GameConsole& console, const String& command)
+{
+	console.registerConsoleCommand(command, [this] (std::vector<String> args) -> String { return onConsoleCommand(std::move(args)); });
+}
+
+String LuaProfiler::onConsoleCommand(std::vector<String> args)
+{
+	if (!args.empty() && args[0] == "start") {
+		start(args.size() > 1 ? args[1].toInteger() : 1000);
+		return "Lua profiler started.";
+	} else if (!args.empty() && args[0] == "stop") {
+		stop();
+		return "Lua profiler stopped.\n" + generateReport();
+	} else if (!args.empty() && args[0] == "reset") {
+		reset();
+		return "Lua profiler reset.";
+	} else {
+		return generateReport(args.empty() ? 20 : size_t(std::max(args[0].toInteger(), 1)));
+	}
+}
+
+void LuaProfiler::hook(lua_State* lua, lua_Debug*)
+{
+	const int64_t start = Profiler::getTimeNs();
+
+	// The allocator's user data is the LuaState (coroutines included), which saves looking it up in the registry
+	void* userData = nullptr;
+	lua_getallocf(lua, &userData);
+	auto profiler = static_cast<LuaState*>(userData)->getProfiler();
+	if (profiler) {
+		profiler->onSample(lua, start);
+		profiler->frameOverheadNs += Profiler::getTimeNs() - start;
+		if (profiler->budgetNs > 0 && profiler->frameOverheadNs > profiler->budgetNs) {
+			profiler->setHook(false);
+			profiler->flushRun();
+			++profiler->suspendedFrames;
+		}
+	}
+}
+
+void LuaProfiler::onSample(lua_State* lua, int64_t now)
+{
+	lua_Debug ar;
+	if (!lua_getstack(lua, 0, &ar) || !lua_getinfo(lua, "Sn", &ar)) {
+		return;
+	}
+
+	// C functions all share the same source, so they're told apart by name instead
+	const bool isC = ar.what[0] == 'C';
+	const Key key(isC ? static_cast<const void*>(ar.name) : static_cast<const void*>(ar.source), ar.linedefined);
+	auto iter = entries.find(key);
+	if (iter == entries.end()) {
+		Entry entry;
+		entry.name = String(ar.name ? ar.name : "?") + " (" + (isC ? String("C") : String(ar.short_src) + ":" + toString(ar.linedefined)) + ")";
+		entry.traceName = Profiler::internName(entry.name);
+		iter = entries.emplace(key, std::move(entry)).first;
+	}
+	auto& entry = iter->second;
+
+	const bool contiguous = runEntry && now - lastSampleNs < maxSampleGapNs;
+	if (contiguous) {
+		entry.timeNs += now - lastSampleNs;
+	}
+	++entry.samples;
+	++totalSamples;
+
+	if (!contiguous || runEntry != &entry) {
+		if (contiguous) {
+			// The run ends where this one picks up
+			lastSampleNs = now;
+		}
+		flushRun();
+		runEntry = &entry;
+		runStartNs = now;
+	}
+	lastSampleNs = now;
+}
+
+void LuaProfiler::flushRun()
+{
+	if (runEntry && lastSampleNs > runStartNs && Profiler::isEnabled()) {
+		Profiler::record(runEntry->traceName, ProfilerEventType::Script, runStartNs, lastSampleNs);
+	}
+	runEntry = nullptr;
+}
+
+void LuaProfiler::setHook(bool enabled)
+{
+	suspended = !enabled;
+	lua_sethook(hookedState, enabled ? &LuaProfiler::hook : nullptr, enabled ? LUA_MASKCOUNT : 0, instructionsPerSample);
+}
@@ -47,6 +47,17 @@ void LuaReference::pushToLuaStack() const
 	lua_rawgeti(lua->getRawState(), LUA_REGISTRYINDEX, refId);
 }
 
+bool LuaReference::isValid() const
+{
+	return lua != nullptr && refId != LUA_NOREF;
+}
+
+LuaState& LuaReference::getState() const
+{
+	Expects(lua);
+	return *lua;
+}
+
 LuaReference LuaReference::operator[](const String& name) const
 {
 	pushToLuaStack();
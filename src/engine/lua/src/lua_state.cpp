@@ -4,6 +4,9 @@
 #include "halley/support/logger.h"
 #include "halley/core/resources/resources.h"
 #include "halley/file_formats/binary_file.h"
+#include "halley/data_structures/memory_pool.h"
+#include "halley/time/stopwatch.h"
+#include <cstring>
 
 using namespace Halley;
 
@@ -23,10 +26,21 @@ int handleCoroutineError(LuaState& state)
 	return 1;
 }
 
-LuaState::LuaState(Resources& resources)
-	: lua(luaL_newstate())
+static int luaPanic(lua_State* lua)
+{
+	Logger::logError("Unprotected error in Lua call: " + String(lua_tostring(lua, -1)));
+	return 0;
+}
+
+LuaState::LuaState(Resources& resources, bool useBytecode)
+	: lua(lua_newstate(&LuaState::allocate, this))
 	, resources(&resources)
+	, useBytecode(useBytecode)
 {
+	if (!lua) {
+		throw Exception("Unable to create Lua state", HalleyExceptions::Lua);
+	}
+	lua_atpanic(lua, &luaPanic);
 	luaL_openlibs(lua);
 			
 	// TODO: convert this into an automatic table
@@ -46,8 +60,11 @@ LuaState::LuaState(Resources& resources)
 	errorHandlerRef = std::make_unique<LuaReference>(*this);
 	lua_pop(lua, 1);
 
-	auto res = resources.get<BinaryFile>("lua/halley/halley.lua");
-	loadModule("halley", res->getSpan());
+	// Left at the bottom of the main stack for good, for callWithPinnedErrorHandler
+	errorHandlerRef->pushToLuaStack();
+	pinnedErrorHandlerPos = lua_gettop(lua);
+
+	loadModuleFromResources("halley", "lua/halley/halley.lua");
 }
 
 LuaState::~LuaState()
@@ -80,12 +97,31 @@ const LuaReference& LuaState::getOrLoadModule(const String& moduleName)
 {
 	auto result = tryGetModule(moduleName);
 	if (!result) {
-		auto res = resources->get<BinaryFile>("lua/" + moduleName + ".lua");
-		return loadModule(moduleName, res->getSpan());
+		return loadModuleFromResources(moduleName, "lua/" + moduleName + ".lua");
 	}
 	return *result;
 }
 
+const LuaReference& LuaState::loadModuleFromResources(const String& moduleName, const String& assetId)
+{
+	const auto bytecodeId = assetId + "c";
+	if (useBytecode && resources->exists<BinaryFile>(bytecodeId)) {
+		auto res = resources->get<BinaryFile>(bytecodeId);
+		auto data = res->getSpan();
+
+		// Only accepts binary chunks. Bytecode is rejected if it was built for different type sizes or endianness.
+		const int result = luaL_loadbufferx(lua, reinterpret_cast<const char*>(data.data()), data.size_bytes(), moduleName.c_str(), "b");
+		if (result == 0) {
+			modules[moduleName] = runChunk();
+			return getModule(moduleName);
+		}
+		Logger::logWarning("Unable to load precompiled Lua module \"" + moduleName + "\", loading source instead: " + LuaStackOps(*this).popString());
+	}
+
+	auto res = resources->get<BinaryFile>(assetId);
+	return loadModule(moduleName, res->getSpan());
+}
+
 const LuaReference& LuaState::loadModule(const String& moduleName, gsl::span<const gsl::byte> data)
 {
 	modules[moduleName] = loadScript(moduleName, data);
@@ -110,17 +146,126 @@ void LuaState::call(int nArgs, int nRets)
 	}
 }
 
+void LuaState::callWithPinnedErrorHandler(int nArgs, int nRets)
+{
+	if (!pushedStates.empty()) {
+		// Inside a callback or a coroutine, where stack indices are relative to a different frame, so the handler
+		// has to go under the function, as pushErrorHandler would have done
+		const int funcPos = lua_gettop(lua) - nArgs;
+		errorHandlerRef->pushToLuaStack();
+		lua_insert(lua, funcPos);
+
+		const int result = lua_pcall(lua, nArgs, nRets, funcPos);
+		lua_remove(lua, funcPos);
+		if (result != 0) {
+			throw Exception("Lua exception:\n\t" + LuaStackOps(*this).popString(), HalleyExceptions::Lua);
+		}
+		return;
+	}
+
+	const int result = lua_pcall(lua, nArgs, nRets, pinnedErrorHandlerPos);
+	if (result != 0) {
+		throw Exception("Lua exception:\n\t" + LuaStackOps(*this).popString(), HalleyExceptions::Lua);
+	}
+}
+
 lua_State* LuaState::getRawState()
 {
 	return lua;
 }
 
+void* LuaState::allocate(void* userData, void* ptr, size_t oldSize, size_t newSize)
+{
+	// Lua's heap is almost all small objects of a few sizes (strings, tables, closures), which the size class pools are
+	// made for. When ptr is null, oldSize is the type of object being allocated, not a size.
+	auto& stats = static_cast<LuaState*>(userData)->heapStats;
+	const size_t prevSize = ptr ? oldSize : 0;
+
+	if (newSize == 0) {
+		if (ptr) {
+			PoolPool::free(ptr, prevSize);
+			stats.bytes -= prevSize;
+			--stats.allocations;
+		}
+		return nullptr;
+	}
+
+	// Resizing within the same size class keeps the same slot
+	if (ptr && prevSize <= PoolPool::maxSizeClass && newSize <= PoolPool::maxSizeClass && PoolPool::getPool(prevSize) == PoolPool::getPool(newSize)) {
+		stats.bytes = stats.bytes - prevSize + newSize;
+		stats.peakBytes = std::max(stats.peakBytes, stats.bytes);
+		return ptr;
+	}
+
+	void* result;
+	try {
+		result = PoolPool::alloc(newSize);
+	} catch (...) {
+		// Must not throw through Lua; it raises its own memory error when this returns null
+		return nullptr;
+	}
+
+	if (ptr) {
+		memcpy(result, ptr, std::min(prevSize, newSize));
+		PoolPool::free(ptr, prevSize);
+	} else {
+		++stats.allocations;
+		++stats.totalAllocations;
+	}
+	stats.bytes = stats.bytes - prevSize + newSize;
+	stats.peakBytes = std::max(stats.peakBytes, stats.bytes);
+	return result;
+}
+
+void LuaState::setAutomaticGC(bool enabled)
+{
+	lua_gc(lua, enabled ? LUA_GCRESTART : LUA_GCSTOP, 0);
+}
+
+void LuaState::setGCParameters(int pause, int stepMultiplier)
+{
+	lua_gc(lua, LUA_GCSETPAUSE, pause);
+	lua_gc(lua, LUA_GCSETSTEPMUL, stepMultiplier);
+}
+
+bool LuaState::stepGC(int64_t budgetNs)
+{
+	// Basic steps are small, so this doesn't overshoot the budget by much
+	Stopwatch timer;
+	bool finished = false;
+	while (!finished && timer.elapsedNanoSeconds() < budgetNs) {
+		finished = lua_gc(lua, LUA_GCSTEP, 0) != 0;
+	}
+	heapStats.lastGCStepNs = timer.elapsedNanoSeconds();
+	return finished;
+}
+
+const LuaHeapStats& LuaState::getHeapStats() const
+{
+	return heapStats;
+}
+
+void LuaState::setProfiler(LuaProfiler* p)
+{
+	profiler = p;
+}
+
+LuaProfiler* LuaState::getProfiler() const
+{
+	return profiler;
+}
+
 LuaReference LuaState::loadScript(const String& chunkName, gsl::span<const gsl::byte> data)
 {
 	int result = luaL_loadbuffer(lua, reinterpret_cast<const char*>(data.data()), data.size_bytes(), chunkName.c_str());
 	if (result != 0) {
 		throw Exception("Error loading Lua chunk:\n\t" + LuaStackOps(*this).popString(), HalleyExceptions::Lua);
 	}
+	return runChunk();
+}
+
+LuaReference LuaState::runChunk()
+{
 	call(0, 1);
 
 	// Store chunk in registry
@@ -0,0 +1,107 @@
+#include "lua_state_pool.h"
+#include "lua_stack_ops.h"
+#include "halley/concurrency/concurrent.h"
+
+using namespace Halley;
+
+LuaStatePool::LuaStatePool(Resources& resources, size_t nStates, bool useBytecode)
+{
+	if (nStates == 0) {
+		nStates = Executors::hasInstance() ? Executors::getCPU().threadCount() + 1 : 1;
+	}
+
+	entries.resize(nStates);
+	for (size_t i = 0; i < nStates; ++i) {
+		auto& state = *(entries[i].state = std::make_unique<LuaState>(resources, useBytecode));
+
+		// Each state only ever runs on one thread at a time, so its outbox needs no locking
+		auto& outbox = entries[i].outbox;
+		LuaStackOps ops(state);
+		ops.push(LuaCallback([&outbox] (LuaState& s) -> int
+		{
+			LuaStackOps ops(s);
+			auto data = ops.popString();
+			auto channel = ops.popString();
+			outbox.push_back(LuaMessage{ std::move(channel), std::move(data) });
+			return 0;
+		}));
+		ops.makeGlobal("postMessage");
+
+		freeEntries.push_back(i);
+	}
+}
+
+size_t LuaStatePool::size() const
+{
+	return entries.size();
+}
+
+LuaState& LuaStatePool::getState(size_t idx)
+{
+	return *entries.at(idx).state;
+}
+
+void LuaStatePool::forEachState(std::function<void(LuaState&)> f)
+{
+	for (auto& e: entries) {
+		f(*e.state);
+	}
+}
+
+void LuaStatePool::parallelFor(size_t n, size_t grain, std::function<void(LuaState&, size_t, size_t)> f)
+{
+	if (!Executors::hasInstance() || entries.size() == 1) {
+		const size_t idx = acquire();
+		try {
+			f(*entries[idx].state, 0, n);
+		} catch (...) {
+			release(idx);
+			throw;
+		}
+		release(idx);
+		return;
+	}
+
+	// Chunks are claimed dynamically, so a state is taken for each one rather than tied to a thread
+	Concurrent::parallelFor(Executors::getCPU(), Range<size_t>(0, n), grain, [this, &f] (size_t begin, size_t end)
+	{
+		const size_t idx = acquire();
+		try {
+			f(*entries[idx].state, begin, end);
+		} catch (...) {
+			release(idx);
+			throw;
+		}
+		release(idx);
+	});
+}
+
+std::vector<LuaMessage> LuaStatePool::takeMessages()
+{
+	std::vector<LuaMessage> result;
+	for (auto& e: entries) {
+		for (auto& m: e.outbox) {
+			result.push_back(std::move(m));
+		}
+		e.outbox.clear();
+	}
+	return result;
+}
+
+size_t LuaStatePool::acquire()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	condition.wait(lock, [&] () { return !freeEntries.empty(); });
+	const size_t idx = freeEntries.back();
+	freeEntries.pop_back();
+	return idx;
+}
+
+void LuaStatePool::release(size_t idx)
+{
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		freeEntries.push_back(idx);
+	}
+	condition.notify_one();
+}
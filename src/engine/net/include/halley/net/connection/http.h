@@ -23,6 +23,14 @@
 
 #include <halley/text/halleystring.h>
 #include <halley/utils/utils.h>
+#include <halley/data_structures/vector.h>
+#include <halley/data_structures/hash_map.h>
+#include <halley/concurrency/future.h>
+#include <halley/concurrency/executor.h>
+#include <gsl/gsl>
+#include <functional>
+#include <memory>
+#include <mutex>
 
 namespace Halley {
 	class HTTPPostEntry {
@@ -33,12 +41,68 @@ namespace Halley {
 		Bytes data;
 	};
 
+	class HTTPResponse {
+	public:
+		int status = 0;
+		Bytes body;
+
+		bool isOk() const { return status >= 200 && status < 300; }
+	};
+
+	// Receives the body of a response in pieces, as they arrive
+	using HTTPBodySink = std::function<void(gsl::span<const gsl::byte>)>;
+
+	// HTTP/1.1 client, keeping connections alive and reusing them for later requests to the same host. Requests run on
+	// the client's own threads, one per connection, so that up to maxConnections can be in flight at once. Requests
+	// aren't pipelined, since too many servers and proxies get that wrong; concurrency comes from the connections.
+	// Hosts can specify a port as "host:port".
+	class HTTPClient {
+	public:
+		explicit HTTPClient(size_t maxConnections = 4, size_t maxIdlePerHost = 4);
+		~HTTPClient();
+
+		HTTPClient(const HTTPClient& other) = delete;
+		HTTPClient& operator=(const HTTPClient& other) = delete;
+
+		// Only fails if the server can't be reached
+		Future<HTTPResponse> request(String method, String host, String path, Bytes content = {}, String contentType = "application/octet-stream");
+
+		// As above, but the body is handed to onBody as it arrives instead of being collected in the response. onBody
+		// is called from the client's threads.
+		Future<HTTPResponse> request(String method, String host, String path, HTTPBodySink onBody, Bytes content = {}, String contentType = "application/octet-stream");
+
+		// Blocks the calling thread instead, but still shares the pooled connections
+		HTTPResponse requestSync(const String& method, const String& host, const String& path, gsl::span<const gsl::byte> content = {}, const String& contentType = "application/octet-stream", HTTPBodySink onBody = {});
+
+		// Shared by the static HTTP methods
+		static HTTPClient& getDefault();
+
+	private:
+		class Connection;
+		class IOService;
+
+		const size_t maxIdlePerHost;
+		std::unique_ptr<IOService> ioService;
+
+		std::mutex mutex;
+		HashMap<String, Vector<std::unique_ptr<Connection>>> idleConnections;
+
+		ExecutionQueue queue;
+		std::unique_ptr<ThreadPool> threads;
+
+		std::unique_ptr<Connection> connect(const String& host);
+		std::unique_ptr<Connection> takeConnection(const String& host);
+		void returnConnection(const String& host, std::unique_ptr<Connection> connection);
+	};
+
+	// Blocking requests, through the default HTTPClient.
 	class HTTP {
 	public:
+		// These throw if the server doesn't reply with a 2xx status
 		static Bytes get(String host, String path);
 		static Bytes post(String host, String path, std::vector<HTTPPostEntry>& entries);
 
-	private:
-		static Bytes request(String host, String path, bool isPost, String& content, String boundary);
+		// Throws only if the server can't be reached
+		static HTTPResponse request(const String& method, const String& host, const String& path, const Bytes& content = {}, const String& contentType = "application/octet-stream");
 	};
 }
@@ -10,10 +10,12 @@ namespace Halley
 	struct ChannelSettings
 	{
 	public:
-		ChannelSettings(bool reliable = false, bool ordered = false, bool keepLastSent = false);
+		ChannelSettings(bool reliable = false, bool ordered = false, bool keepLastSent = false, int priority = 0, float bandwidthShare = 0);
 		bool reliable;
 		bool ordered;
 		bool keepLastSent;
+		int priority; // Higher priority channels get the send budget first
+		float bandwidthShare; // Fraction of the send budget guaranteed to this channel, regardless of priority
 	};
 
 	class MessageQueue
@@ -34,9 +36,14 @@ namespace Halley
 
 		virtual void setChannel(int channel, ChannelSettings settings);
 
+		// Compresses everything sent from here on, primed with a dictionary of typical content if given.
+		// Both ends must enable it with the same dictionary before anything is sent.
+		virtual void enableCompression(const Bytes& dictionary = {});
+
 	protected:
 		void addFactory(std::unique_ptr<NetworkMessageFactoryBase> factory);
 		int getMessageType(NetworkMessage& msg) const;
+		String getMessageTypeName(int msgType) const;
 		std::unique_ptr<NetworkMessage> deserializeMessage(gsl::span<const gsl::byte> data, unsigned short msgType, unsigned short seq);
 
 	private:
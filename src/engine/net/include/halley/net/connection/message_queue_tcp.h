@@ -2,6 +2,7 @@
 
 #include "message_queue.h"
 #include "iconnection.h"
+#include "halley/bytes/compression.h"
 
 namespace Halley
 {	
@@ -14,8 +15,10 @@ namespace Halley
 		void enqueue(std::unique_ptr<NetworkMessage> msg, int channel) override;
 		void sendAll() override;
 		std::vector<std::unique_ptr<NetworkMessage>> receiveAll() override;
+		void enableCompression(const Bytes& dictionary = {}) override;
 				
 	private:
 		std::shared_ptr<IConnection> connection;
+		std::unique_ptr<StreamCompression> compression;
 	};
 }
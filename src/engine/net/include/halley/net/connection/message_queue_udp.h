@@ -8,13 +8,37 @@
 #include <list>
 #include <chrono>
 #include "message_queue.h"
+#include "halley/bytes/compression.h"
+#include "network_stats.h"
 
 namespace Halley
 {
 	class ReliableConnection;
 
+	// Reliable messages too large for a single packet are split into fragments, and put back together on the other end.
+	// Fragments go out through a window per channel, refilled as they're acked, so a large message never takes more
+	// than a window's worth of each send and doesn't hold up other channels.
 	class MessageQueueUDP : public MessageQueue, private IReliableConnectionAckListener
 	{
+		// A piece of a fragmented message, or of a stream (see writeStream)
+		class Fragment final : public NetworkMessage
+		{
+		public:
+			Fragment(Bytes data, bool stream, int msgType, unsigned short index, unsigned short count);
+			void serialize(Serializer& s) const override;
+
+			bool stream;
+			int msgType;
+			unsigned short index; // For streams, 1 if it's the last piece
+			unsigned short count;
+		};
+
+		struct IncomingMessage
+		{
+			Vector<Bytes> fragments;
+			size_t received = 0;
+		};
+
 		struct PendingPacket
 		{
 			std::vector<std::unique_ptr<NetworkMessage>> msgs;
@@ -34,6 +58,12 @@ namespace Halley
 			ChannelSettings settings;
 			bool initialized = false;
 
+			std::list<std::unique_ptr<NetworkMessage>> fragmentQueue; // Waiting for room in the window
+			size_t fragmentsInFlight = 0;
+			std::map<unsigned short, IncomingMessage> incoming; // By seq
+			Bytes streamData; // Received but not read yet
+			bool streamEnded = false;
+
 			void getReadyMessages(std::vector<std::unique_ptr<NetworkMessage>>& out);
 		};
 
@@ -41,14 +71,38 @@ namespace Halley
 		MessageQueueUDP(std::shared_ptr<ReliableConnection> connection);
 		~MessageQueueUDP();
 		
+		bool isConnected() const override;
 		void setChannel(int channel, ChannelSettings settings) override;
+		void enableCompression(const Bytes& dictionary = {}) override;
 
 		std::vector<std::unique_ptr<NetworkMessage>> receiveAll() override;
 
 		void enqueue(std::unique_ptr<NetworkMessage> msg, int channel) override;
 		void sendAll() override;
 
+		// Streams a blob (map data, replays...) on a reliable ordered channel, a piece at a time as it's produced, without
+		// ever having it all in memory as one message. Pieces are ordered along with the channel's messages, and go out
+		// through its fragment window. The other end reads them back with readStream.
+		void writeStream(int channel, gsl::span<const gsl::byte> data, bool last = false);
+
+		// Appends whatever has arrived of the stream so far; returns true once that includes its end
+		bool readStream(int channel, Bytes& data);
+
+		// Bytes queued on the channel behind its fragment window, for writers to pace themselves
+		size_t getFragmentBacklog(int channel) const;
+
+		const MessageQueueStats& getStats() const { return stats; }
+
 	private:
+		constexpr static size_t maxPacketSize = 1200;
+		constexpr static size_t fragmentSize = 1024;
+		constexpr static size_t fragmentWindow = 32;
+
+		// Flags in the channel byte of each message's header
+		constexpr static unsigned char fragmentFlag = 0x40;
+		constexpr static unsigned char streamFlag = 0x20;
+		constexpr static unsigned char channelMask = 0x1F;
+
 		std::shared_ptr<ReliableConnection> connection;
 		std::vector<Channel> channels;
 
@@ -56,12 +110,25 @@ namespace Halley
 		std::map<int, PendingPacket> pendingPackets;
 		int nextPacketId = 0;
 
+		std::unique_ptr<DictionaryCompression> compression; // Each packet is compressed on its own, as they can be lost or reordered
+
+		MessageQueueStats stats;
+
+		void enqueueFragments(std::unique_ptr<NetworkMessage> msg, Channel& channel);
+		void releaseFragments();
+		void onFragmentReceived(Channel& channel, int msgType, unsigned short seq, unsigned short index, unsigned short count, gsl::span<const gsl::byte> data);
+		const Fragment* asFragment(const NetworkMessage& msg) const;
+
 		void onPacketAcked(int tag) override;
-		void checkReSend(std::vector<ReliableSubPacket>& collect);
+		void checkReSend(std::vector<ReliableSubPacket>& collect, size_t& budget);
+		void selectMessages(std::list<std::unique_ptr<NetworkMessage>>& selected, size_t& budget);
+		size_t getMessageSize(NetworkMessage& msg);
+		NetworkTrafficCounters& getMessageTypeStats(int msgType);
 
-		ReliableSubPacket createPacket();
+		ReliableSubPacket createPacket(std::list<std::unique_ptr<NetworkMessage>>& msgs);
 		ReliableSubPacket makeTaggedPacket(std::vector<std::unique_ptr<NetworkMessage>>& msgs, size_t size, bool resends = false, unsigned short resendSeq = 0);
-		std::vector<gsl::byte> serializeMessages(const std::vector<std::unique_ptr<NetworkMessage>>& msgs, size_t size) const;
+		OutboundNetworkPacket serializeMessages(const std::vector<std::unique_ptr<NetworkMessage>>& msgs, size_t size) const;
+		OutboundNetworkPacket compressPacket(OutboundNetworkPacket packet) const;
 
 		void receiveMessages();
 	};
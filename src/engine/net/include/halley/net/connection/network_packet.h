@@ -5,32 +5,52 @@
 
 namespace Halley
 {
+	class NetworkPacketBuffer;
+
+	// Packets keep their data in reference counted buffers, recycled through a pool, so steady traffic doesn't allocate.
+	// Copies share the buffer (e.g. the same update sent to every peer), and one is only copied if it's written to while shared.
 	class NetworkPacketBase
 	{
 	public:
+		constexpr static size_t headroom = 128; // Reserved in front of outbound data, for each layer to write its header into
+		constexpr static size_t pooledSize = 2048; // Fits any datagram with its headroom; bigger buffers (e.g. over TCP) aren't pooled
+
 		size_t copyTo(gsl::span<gsl::byte> dst) const;
 		size_t getSize() const;
 		gsl::span<const gsl::byte> getBytes() const;
 
-		NetworkPacketBase(NetworkPacketBase&& other) = delete;
-		NetworkPacketBase& operator=(NetworkPacketBase&& other) = delete;
-
 	protected:
 		NetworkPacketBase();
 		NetworkPacketBase(gsl::span<const gsl::byte> data, size_t prePadding);
+		NetworkPacketBase(size_t size, size_t prePadding);
+		NetworkPacketBase(const NetworkPacketBase& other);
+		NetworkPacketBase(NetworkPacketBase&& other) noexcept;
+		~NetworkPacketBase();
+
+		NetworkPacketBase& operator=(const NetworkPacketBase& other);
+		NetworkPacketBase& operator=(NetworkPacketBase&& other) noexcept;
 
-		size_t dataStart;
-		std::vector<gsl::byte> data;
+		// Copies the data into a buffer of its own if it's shared, or doesn't have prePadding bytes free in front
+		void makeWriteable(size_t prePadding);
+
+		NetworkPacketBuffer* buffer = nullptr;
+		size_t dataStart = 0;
+		size_t dataEnd = 0;
 	};
 
 	class OutboundNetworkPacket : public NetworkPacketBase
 	{
 	public:
+		OutboundNetworkPacket();
 		OutboundNetworkPacket(const OutboundNetworkPacket& other);
-		explicit OutboundNetworkPacket(OutboundNetworkPacket&& other) noexcept;
+		OutboundNetworkPacket(OutboundNetworkPacket&& other) noexcept;
 		explicit OutboundNetworkPacket(gsl::span<const gsl::byte> data);
 		explicit OutboundNetworkPacket(const Bytes& data);
-		
+		explicit OutboundNetworkPacket(size_t size); // To be filled in through getWriteableBytes, instead of copying data in
+
+		gsl::span<gsl::byte> getWriteableBytes();
+		void resize(size_t size); // Up to the size it was created with
+
 		void addHeader(gsl::span<const gsl::byte> src);
 
 		template <typename T>
@@ -39,6 +59,7 @@ namespace Halley
 			addHeader(gsl::as_bytes(gsl::span<const T>(&h, 1)));
 		}
 
+		OutboundNetworkPacket& operator=(const OutboundNetworkPacket& other);
 		OutboundNetworkPacket& operator=(OutboundNetworkPacket&& other) noexcept;
 	};
 
@@ -46,7 +67,7 @@ namespace Halley
 	{
 	public:
 		InboundNetworkPacket();
-		explicit InboundNetworkPacket(InboundNetworkPacket&& other);
+		InboundNetworkPacket(InboundNetworkPacket&& other) noexcept;
 		explicit InboundNetworkPacket(gsl::span<const gsl::byte> data);
 		void extractHeader(gsl::span<gsl::byte> dst);
 
@@ -56,6 +77,6 @@ namespace Halley
 			extractHeader(gsl::as_writeable_bytes(gsl::span<T>(&h, 1)));
 		}
 
-		InboundNetworkPacket& operator=(InboundNetworkPacket&& other);
+		InboundNetworkPacket& operator=(InboundNetworkPacket&& other) noexcept;
 	};
 }
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "halley/text/halleystring.h"
+#include "halley/data_structures/vector.h"
+#include <array>
+#include <cstdint>
+#include <mutex>
+
+namespace Halley
+{
+	// Distribution of durations, in seconds. Buckets grow geometrically from 1 ms, so recording is cheap
+	// and percentiles are accurate to within a bucket.
+	class NetworkHistogram
+	{
+	public:
+		constexpr static size_t numBuckets = 24;
+
+		void record(float seconds);
+		void merge(const NetworkHistogram& other);
+		void reset();
+
+		uint64_t getCount() const { return count; }
+		float getMean() const;
+		float getMax() const { return maxValue; }
+		float getPercentile(float percentile) const; // Upper bound of the bucket containing it
+
+		static float getBucketUpperBound(size_t bucket);
+
+	private:
+		std::array<uint64_t, numBuckets> buckets = {};
+		uint64_t count = 0;
+		double total = 0;
+		float maxValue = 0;
+	};
+
+	struct NetworkTrafficCounters
+	{
+		uint64_t bytesSent = 0;
+		uint64_t bytesReceived = 0;
+		uint64_t packetsSent = 0; // Messages, when counting per channel or message type
+		uint64_t packetsReceived = 0;
+
+		void onSent(size_t bytes) { bytesSent += bytes; ++packetsSent; }
+		void onReceived(size_t bytes) { bytesReceived += bytes; ++packetsReceived; }
+		NetworkTrafficCounters& operator+=(const NetworkTrafficCounters& other);
+	};
+
+	// Kept by each ReliableConnection
+	struct ConnectionStats
+	{
+		NetworkTrafficCounters traffic;
+		uint64_t packetsAcked = 0;
+		uint64_t packetsLost = 0;
+		NetworkHistogram roundTripTime;
+		NetworkHistogram ackDelay; // From receiving a packet to sending its ack back
+
+		void merge(const ConnectionStats& other);
+	};
+
+	// Kept by each MessageQueueUDP
+	struct MessageQueueStats
+	{
+		std::array<NetworkTrafficCounters, 32> channels;
+		Vector<NetworkTrafficCounters> messageTypes; // Indexed by message type, named by messageTypeNames
+		Vector<String> messageTypeNames;
+		uint64_t packetsResent = 0;
+		uint64_t messagesResent = 0;
+		uint64_t unreliableDropped = 0; // Didn't fit in the send budget
+		size_t pendingMessages = 0; // Queue depths as of the last sendAll
+		size_t pendingPackets = 0;
+		NetworkHistogram serializationTime; // Per message
+
+		void merge(const MessageQueueStats& other); // Message types are matched by name
+	};
+
+	// Kept by each NetworkSession
+	struct SessionStats
+	{
+		std::array<NetworkTrafficCounters, 3> messageTypes; // By NetworkSessionMessageType
+		std::array<NetworkTrafficCounters, 4> controlMessages; // By NetworkSessionControlMessageType
+		NetworkTrafficCounters relayed; // Forwarded by the host from one peer to the others
+
+		void merge(const SessionStats& other);
+	};
+
+	struct NetworkStats
+	{
+		size_t numConnections = 0;
+		size_t numMessageQueues = 0;
+		size_t numSessions = 0;
+		ConnectionStats connections;
+		MessageQueueStats messageQueues;
+		SessionStats sessions;
+	};
+
+	// Every live ReliableConnection and MessageQueueUDP registers its stats here, so the totals can be gathered from
+	// anywhere, e.g. NetworkAPI::getStats. Registration is thread-safe, but gathering reads the stats without locking them,
+	// so it should happen on the thread that updates the connections.
+	class NetworkStatsRegistry
+	{
+	public:
+		static NetworkStatsRegistry& get();
+
+		void add(const ConnectionStats& stats);
+		void remove(const ConnectionStats& stats);
+		void add(const MessageQueueStats& stats);
+		void remove(const MessageQueueStats& stats);
+		void add(const SessionStats& stats);
+		void remove(const SessionStats& stats);
+
+		NetworkStats gather() const;
+
+	private:
+		mutable std::mutex mutex;
+		Vector<const ConnectionStats*> connections;
+		Vector<const MessageQueueStats*> messageQueues;
+		Vector<const SessionStats*> sessions;
+	};
+}
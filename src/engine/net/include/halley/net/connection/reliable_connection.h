@@ -2,6 +2,7 @@
 
 #include "iconnection.h"
 #include "network_packet.h"
+#include "network_stats.h"
 #include <memory>
 #include <vector>
 #include <chrono>
@@ -21,30 +22,40 @@ namespace Halley
 	class ReliableSubPacket
 	{
 	public:
-		std::vector<gsl::byte> data;
+		OutboundNetworkPacket data;
 		int tag = -1;
 		//bool reliable = false;
 		bool resends = false;
 		unsigned short seq = std::numeric_limits<unsigned short>::max();
 		unsigned short resendSeq = 0;
 
-		ReliableSubPacket()
-		{}
-
 		ReliableSubPacket(ReliableSubPacket&& other) = default;
 
-		ReliableSubPacket(std::vector<gsl::byte>&& data)
-			: data(data)
+		ReliableSubPacket(OutboundNetworkPacket&& data)
+			: data(std::move(data))
 			, resends(false)
 		{}
 
-		ReliableSubPacket(std::vector<gsl::byte>&& data, unsigned short resendSeq)
-			: data(data)
+		ReliableSubPacket(OutboundNetworkPacket&& data, unsigned short resendSeq)
+			: data(std::move(data))
 			, resends(true)
 			, resendSeq(resendSeq)
 		{}
 	};
 
+	// AIMD congestion control: the send rate grows steadily while packets are acked, and is cut when the ack bitfield
+	// shows packets being lost. Senders should stay within getSendBudget; anything sent regardless still uses it up.
+	struct CongestionSettings
+	{
+		bool enabled = true;
+		float initialRate = 64 * 1024; // All rates are in bytes per second
+		float minRate = 8 * 1024;
+		float maxRate = 1024 * 1024;
+		float increasePerRoundTrip = 4 * 1024;
+		float decreaseFactor = 0.5f; // Applied at most once per round trip, as losses tend to come in bursts
+		float maxBurst = 0.05f; // Seconds worth of rate that can build up while idle
+	};
+
 	class ReliableConnection : public IConnection
 	{
 		using Clock = std::chrono::steady_clock;
@@ -53,22 +64,31 @@ namespace Halley
 		{
 			bool waiting = false;
 			int tag = -1;
+			size_t size = 0;
 			Clock::time_point timestamp;
 		};
 
 	public:
-		ReliableConnection(std::shared_ptr<IConnection> parent);
+		ReliableConnection(std::shared_ptr<IConnection> parent, CongestionSettings congestion = {});
+		~ReliableConnection();
 
 		void close() override;
 		ConnectionStatus getStatus() const override;
 		void send(OutboundNetworkPacket&& packet) override;
 		bool receive(InboundNetworkPacket& packet) override;
 
-		void sendTagged(gsl::span<ReliableSubPacket> subPackets);
+		void sendTagged(gsl::span<ReliableSubPacket> subPackets); // Consumes the data of each sub-packet
 		void addAckListener(IReliableConnectionAckListener& listener);
 		void removeAckListener(IReliableConnectionAckListener& listener);
 
 		float getLatency() const { return lag; }
+		float getSendRate() const { return sendRate; }
+		float getPacketLoss() const { return packetLoss; }
+		size_t getSendBudget(); // Bytes that can be sent right now without going over the send rate
+
+		void setCongestionSettings(CongestionSettings settings);
+
+		const ConnectionStats& getStats() const { return stats; }
 		float getTimeSinceLastSend() const;
 		float getTimeSinceLastReceive() const;
 
@@ -88,12 +108,27 @@ namespace Halley
 		Clock::time_point lastReceive;
 		Clock::time_point lastSend;
 
+		CongestionSettings congestion;
+		float sendRate;
+		float sendBudget;
+		float packetLoss = 0;
+		Clock::time_point lastBudgetUpdate;
+		Clock::time_point lastRateDecrease;
+
+		ConnectionStats stats;
+		bool hasUnackedReceive = false;
+		Clock::time_point firstUnackedReceive;
+
 		void processReceivedPacket(InboundNetworkPacket& packet);
 		unsigned int generateAckBits();
 
 		void processReceivedAcks(unsigned short ack, unsigned int ackBits);
 		bool onSeqReceived(unsigned short sequence, bool isResend, unsigned short resendOf);
 		void onAckReceived(unsigned short sequence);
+		void onPacketLost(unsigned short sequence);
 		void reportLatency(float lag);
+
+		void updateSendBudget();
+		float getMaxBudget() const;
 	};
 }
@@ -10,6 +10,7 @@ namespace Halley {}
 #include <halley/net/connection/network_message.h>
 #include <halley/net/connection/network_packet.h>
 #include <halley/net/connection/network_service.h>
+#include <halley/net/connection/network_stats.h>
 #include <halley/net/connection/reliable_connection.h>
 #include <halley/net/connection/standard_message_stream.h>
 
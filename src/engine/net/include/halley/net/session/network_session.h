@@ -3,9 +3,13 @@
 #include "halley/bytes/byte_serializer.h"
 #include "../connection/iconnection.h"
 #include "../connection/network_packet.h"
+#include "../connection/network_stats.h"
 #include "network_session_messages.h"
 #include "shared_data.h"
 #include "network_session_control_messages.h"
+#include <array>
+#include <chrono>
+#include <map>
 
 namespace Halley {
 	class NetworkService;
@@ -28,6 +32,7 @@ namespace Halley {
 		void update();
 
 		NetworkSessionType getType() const;
+		const SessionStats& getStats() const;
 
 		void close() final override; // Called from destructor, hence final
 		ConnectionStatus getStatus() const override;
@@ -51,6 +56,30 @@ namespace Halley {
 		virtual void onDisconnected(int peerId);
 		
 	private:
+		using Clock = std::chrono::steady_clock;
+
+		// What a given peer has of one shared data, so it's only sent what changed since then
+		struct PeerReplicationState
+		{
+			bool acked = false;
+			uint32_t ackedVersion = 0;
+			bool sent = false;
+			uint32_t sentVersion = 0;
+			Clock::time_point lastSent;
+		};
+
+		// Outbound replication of one shared data. Each change to it bumps its version, recording which fields changed.
+		struct SharedDataReplication
+		{
+			constexpr static uint32_t historySize = 32;
+
+			uint32_t version = 0;
+			std::array<uint64_t, historySize> changes = {};
+			std::map<int, PeerReplicationState> peers;
+
+			uint64_t getChangesSince(const PeerReplicationState& peer) const;
+		};
+
 		NetworkService& service;
 		NetworkSessionType type = NetworkSessionType::Undefined;
 
@@ -59,25 +88,32 @@ namespace Halley {
 
 		std::unique_ptr<SharedData> sessionSharedData;
 		std::map<int, std::unique_ptr<SharedData>> sharedData;
+		std::map<int, SharedDataReplication> replication; // By owner, -1 for the session
+		std::map<int, uint32_t> receivedStateVersions; // By owner, -1 for the session
 
 		std::vector<std::shared_ptr<IConnection>> connections;
 		std::vector<InboundNetworkPacket> inbox;
 
+		SessionStats stats;
+
 		OutboundNetworkPacket makeOutbound(gsl::span<const gsl::byte> data, NetworkSessionMessageHeader header);
 		void sendToAll(OutboundNetworkPacket&& packet, int except = -1);
 		void closeConnection(int peerId, const String& reason);
 		void processReceive();
 
-		void retransmitControlMessage(int peerId, gsl::span<const gsl::byte> bytes);
 		void receiveControlMessage(int peerId, InboundNetworkPacket& packet);
 		void onControlMessage(int peerId, const ControlMsgSetPeerId& msg);
 		void onControlMessage(int peerId, const ControlMsgSetPeerState& msg);
 		void onControlMessage(int peerId, const ControlMsgSetSessionState& msg);
+		void onControlMessage(int peerId, const ControlMsgAckState& msg);
 
 		void setMyPeerId(int id);
 
+		SharedData& getSharedData(int ownerId);
 		void checkForOutboundStateChanges(int ownerId);
-		OutboundNetworkPacket makeUpdateSharedDataPacket(int ownerId);
+		OutboundNetworkPacket makeUpdateSharedDataPacket(int ownerId, uint64_t fields, uint32_t version);
+		bool isNewStateVersion(int ownerId, uint32_t version);
+		void sendStateAck(int peerId, int ownerId, uint32_t version);
 		
 		OutboundNetworkPacket doMakeControlPacket(NetworkSessionControlMessageType msgType, OutboundNetworkPacket&& packet);
 	};
@@ -6,7 +6,8 @@ namespace Halley {
 	enum class NetworkSessionControlMessageType : int8_t {
 		SetPeerId,
 		SetSessionState,
-		SetPeerState
+		SetPeerState,
+		AckState
 	};
 
 	struct ControlMsgHeader
@@ -22,7 +23,9 @@ namespace Halley {
 		void deserialize(Deserializer& s);
 	};
 
+	// State is a delta of the fields that changed since the last version the receiver acknowledged
 	struct ControlMsgSetSessionState {
+		uint32_t version = 0;
 		Bytes state;
 
 		void serialize(Serializer& s) const;
@@ -31,9 +34,18 @@ namespace Halley {
 
 	struct ControlMsgSetPeerState {
 		int8_t peerId;
+		uint32_t version = 0;
 		Bytes state;
 
 		void serialize(Serializer& s) const;
 		void deserialize(Deserializer& s);
 	};
+
+	struct ControlMsgAckState {
+		int8_t ownerId; // -1 for the session state
+		uint32_t version = 0;
+
+		void serialize(Serializer& s) const;
+		void deserialize(Deserializer& s);
+	};
 }
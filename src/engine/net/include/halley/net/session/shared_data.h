@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 
 namespace Halley {
 	class Deserializer;
@@ -8,14 +9,28 @@ namespace Halley {
     public:
 		virtual ~SharedData() = default;
 
-		void markModified();
+		void markModified(); // Whole object
+		void markFieldModified(int field);
+		void markFieldsModified(uint64_t fields);
 		void markUnmodified();
 		bool isModified() const;
+		uint64_t getModifiedFields() const;
 
 		virtual void serialize(Serializer& s) const = 0;
 		virtual void deserialize(Deserializer& s) = 0;
 
+		// Optional field-level replication: data reporting fields (up to 64) only has the fields that changed sent over.
+		// Otherwise, the whole object is sent whenever anything changes.
+		virtual int getFieldCount() const;
+		virtual void serializeField(Serializer& s, int field) const;
+		virtual void deserializeField(Deserializer& s, int field);
+
+		void serializeDelta(Serializer& s, uint64_t fields) const;
+		uint64_t deserializeDelta(Deserializer& s); // Returns the fields that were updated
+
 	private:
-		bool modified = false;
+		uint64_t modifiedFields = 0;
+
+		uint64_t getAllFields() const;
     };
 }
@@ -19,11 +19,17 @@
 
 \*****************************************************************/
 
-// Comment this whole thing out for now
-#ifdef false
-
-#include "http.h"
+#include "connection/http.h"
 #include <halley/support/exception.h>
+#include "halley/text/string_converter.h"
+#include "halley/concurrency/concurrent.h"
+#include "halley/data_structures/maybe.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <thread>
 
 using namespace Halley;
 
@@ -32,17 +38,21 @@ using namespace Halley;
 #endif
 
 #define BOOST_SYSTEM_NO_DEPRECATED
+#define BOOST_ERROR_CODE_HEADER_ONLY
 #include <boost/asio.hpp>
 
 Bytes HTTP::get(String host, String path)
 {
-	String content = "";
-	return request(host, path, false, content, "");
+	auto response = request("GET", host, path);
+	if (!response.isOk()) {
+		throw Exception("HTTP GET " + host + path + " failed with status " + toString(response.status), HalleyExceptions::Network);
+	}
+	return std::move(response.body);
 }
 
-Bytes HTTP::post(String host, String path, Vector<HTTPPostEntry>& entries)
+Bytes HTTP::post(String host, String path, std::vector<HTTPPostEntry>& entries)
 {
-	String boundary = "=.AaB03xBOunDaRyyy--";
+	const String boundary = "=.AaB03xBOunDaRyyy--";
 
 	std::stringstream c;
 	for (size_t i=0; i<entries.size(); i++) {
@@ -55,68 +65,303 @@ Bytes HTTP::post(String host, String path, Vector<HTTPPostEntry>& entries)
 			c << "Content-Transfer-Encoding: binary\r\n\r\n";
 		}
 		c.write(reinterpret_cast<const char*>(entries[i].data.data()), entries[i].data.size());
-		if (i != entries.size() - 1) c << "\r\n";
+		c << "\r\n";
 	}
-	String content = c.str();
+	c << "--" << boundary << "--\r\n";
+	const auto str = c.str();
+
+	Bytes content(str.size());
+	memcpy(content.data(), str.data(), str.size());
 
-	return request(host, path, true, content, boundary);
+	auto response = request("POST", host, path, content, "multipart/form-data; boundary=" + boundary);
+	if (!response.isOk()) {
+		throw Exception("HTTP POST " + host + path + " failed with status " + toString(response.status), HalleyExceptions::Network);
+	}
+	return std::move(response.body);
 }
 
-Bytes HTTP::request(String host, String path, bool isPost, String& content, String boundary)
+HTTPResponse HTTP::request(const String& method, const String& host, const String& path, const Bytes& content, const String& contentType)
 {
-	// Code adapted from http://www.boost.org/doc/libs/1_49_0_beta1/doc/html/boost_asio/example/http/client/sync_client.cpp
-	
-	using boost::asio::ip::tcp;
-	boost::asio::io_service io_service;
-
-	// Get a list of endpoints corresponding to the server name.
-    tcp::resolver resolver(io_service);
-    tcp::resolver::query query(host.c_str(), "http");
-    tcp::resolver::iterator endpoint_iterator = resolver.resolve(query);
-
-    // Try each endpoint until we successfully establish a connection.
-    tcp::socket socket(io_service);
-    boost::asio::connect(socket, endpoint_iterator);
-
-    // Form the request. We specify the "Connection: close" header so that the
-    // server will close the socket after transmitting the response. This will
-    // allow us to treat all data up until the EOF as the content.
-    boost::asio::streambuf request;
-    std::ostream request_stream(&request);
-    request_stream << (isPost ? "POST " : "GET ") << path.c_str() << " HTTP/1.0\r\n";
-    request_stream << "Host: " << host.c_str() << "\r\n";
-    request_stream << "Accept: */*\r\n";
-	if (isPost) {
-		request_stream << "Content-Length: " << content.length() << "\r\n";
-		request_stream << "Content-Type: multipart/form-data; boundary=" << boundary << "\r\n";
-	}
-    request_stream << "Connection: close\r\n\r\n";
-	if (isPost) {
-		request_stream << content;
-	}
-
-	// Send the request.
-	write(socket, request);
-
-	// Read the reply
-	Bytes result;
-	size_t pos = 0;
-	while (true) {
-		std::array<char, 128> buf;
+	return HTTPClient::getDefault().requestSync(method, host, path, gsl::as_bytes(gsl::span<const Byte>(content)), contentType);
+}
+
+using boost::asio::ip::tcp;
+
+class HTTPClient::IOService {
+public:
+	boost::asio::io_service service;
+};
+
+class HTTPClient::Connection {
+public:
+	explicit Connection(boost::asio::io_service& service)
+		: socket(service)
+	{}
+
+	tcp::socket socket;
+	boost::asio::streambuf buffer; // Read from the socket, but not consumed yet
+};
+
+namespace {
+	struct ResponseHead {
+		int status = 0;
+		bool http11 = false;
+		bool chunked = false;
+		bool close = false;
+		bool keepAlive = false;
+		Maybe<size_t> contentLength;
+	};
+
+	std::string toLower(std::string str)
+	{
+		std::transform(str.begin(), str.end(), str.begin(), [] (char c) { return char(::tolower(c)); });
+		return str;
+	}
+
+	std::string trim(const std::string& str)
+	{
+		const auto start = str.find_first_not_of(" \t");
+		const auto end = str.find_last_not_of(" \t\r");
+		return start == std::string::npos ? std::string() : str.substr(start, end - start + 1);
+	}
+
+	void checkError(const boost::system::error_code& error, const String& host)
+	{
+		if (error) {
+			throw Exception("Error reading from " + host + ": " + error.message(), HalleyExceptions::Network);
+		}
+	}
+
+	// Reads a line, or the whole head if the delimiter is a blank line, leaving anything after it in the buffer
+	std::string readUntil(tcp::socket& socket, boost::asio::streambuf& buffer, const char* delimiter, const String& host)
+	{
 		boost::system::error_code error;
+		const size_t n = boost::asio::read_until(socket, buffer, delimiter, error);
+		checkError(error, host);
+		const auto data = boost::asio::buffer_cast<const char*>(buffer.data());
+		std::string result(data, n);
+		buffer.consume(n);
+		return result;
+	}
+
+	ResponseHead parseHead(const std::string& head, const String& host)
+	{
+		ResponseHead result;
+		std::istringstream lines(head);
+		std::string line;
+
+		std::getline(lines, line);
+		std::istringstream statusLine(line);
+		std::string httpVersion;
+		statusLine >> httpVersion >> result.status;
+		if (!statusLine || httpVersion.substr(0, 5) != "HTTP/") {
+			throw Exception("Malformed HTTP response from " + host, HalleyExceptions::Network);
+		}
+		result.http11 = httpVersion != "HTTP/1.0";
+
+		while (std::getline(lines, line)) {
+			const auto colon = line.find(':');
+			if (colon == std::string::npos) {
+				continue;
+			}
+			const auto name = toLower(trim(line.substr(0, colon)));
+			const auto value = toLower(trim(line.substr(colon + 1)));
+			if (name == "content-length") {
+				result.contentLength = size_t(std::stoull(value));
+			} else if (name == "transfer-encoding") {
+				result.chunked = value.find("chunked") != std::string::npos;
+			} else if (name == "connection") {
+				result.close = value.find("close") != std::string::npos;
+				result.keepAlive = value.find("keep-alive") != std::string::npos;
+			}
+		}
+		return result;
+	}
+
+	// Passes on what's already buffered first, and then reads the rest straight from the socket. Without a size, reads
+	// until the server closes the connection.
+	void readBody(tcp::socket& socket, boost::asio::streambuf& buffer, Maybe<size_t> size, const HTTPBodySink& sink, const String& host)
+	{
+		const size_t buffered = size ? std::min(size.get(), buffer.size()) : buffer.size();
+		if (buffered > 0) {
+			sink(gsl::as_bytes(gsl::span<const char>(boost::asio::buffer_cast<const char*>(buffer.data()), buffered)));
+			buffer.consume(buffered);
+		}
+
+		size_t left = size ? size.get() - buffered : std::numeric_limits<size_t>::max();
+		std::vector<char> chunk(std::min(left, size_t(64 * 1024)));
+		while (left > 0) {
+			boost::system::error_code error;
+			const size_t n = socket.read_some(boost::asio::buffer(chunk.data(), std::min(left, chunk.size())), error);
+			if (!size && error == boost::asio::error::eof) {
+				break;
+			}
+			checkError(error, host);
+			sink(gsl::as_bytes(gsl::span<const char>(chunk.data(), n)));
+			left -= n;
+		}
+	}
+
+	void readChunkedBody(tcp::socket& socket, boost::asio::streambuf& buffer, const HTTPBodySink& sink, const String& host)
+	{
+		while (true) {
+			const auto sizeLine = readUntil(socket, buffer, "\r\n", host);
+			const size_t size = size_t(std::stoull(sizeLine, nullptr, 16)); // Stops at any extensions
+			if (size == 0) {
+				break;
+			}
+			readBody(socket, buffer, size, sink, host);
+			readUntil(socket, buffer, "\r\n", host);
+		}
+
+		// Skip trailers, up to the blank line
+		while (readUntil(socket, buffer, "\r\n", host) != "\r\n") {}
+	}
+}
+
+HTTPClient::HTTPClient(size_t maxConnections, size_t maxIdlePerHost)
+	: maxIdlePerHost(maxIdlePerHost)
+	, ioService(std::make_unique<IOService>())
+{
+	threads = std::make_unique<ThreadPool>("HTTP", queue, maxConnections, [] (String name, std::function<void()> runnable)
+	{
+		return std::thread(runnable);
+	});
+}
+
+HTTPClient::~HTTPClient()
+{
+	threads.reset();
+}
+
+Future<HTTPResponse> HTTPClient::request(String method, String host, String path, Bytes content, String contentType)
+{
+	return request(std::move(method), std::move(host), std::move(path), HTTPBodySink(), std::move(content), std::move(contentType));
+}
+
+Future<HTTPResponse> HTTPClient::request(String method, String host, String path, HTTPBodySink onBody, Bytes content, String contentType)
+{
+	// Shared, so the task can be copied around without copying the content
+	auto data = std::make_shared<const Bytes>(std::move(content));
+	return Concurrent::execute(queue, [=] () -> HTTPResponse
+	{
+		return requestSync(method, host, path, gsl::as_bytes(gsl::span<const Byte>(*data)), contentType, onBody);
+	});
+}
+
+HTTPResponse HTTPClient::requestSync(const String& method, const String& host, const String& path, gsl::span<const gsl::byte> content, const String& contentType, HTTPBodySink onBody)
+{
+	boost::asio::streambuf request;
+	std::ostream requestStream(&request);
+	requestStream << method.c_str() << " " << path.c_str() << " HTTP/1.1\r\n";
+	requestStream << "Host: " << host.c_str() << "\r\n";
+	requestStream << "Accept: */*\r\n";
+	if (method != "GET" && method != "HEAD") {
+		requestStream << "Content-Length: " << content.size() << "\r\n";
+		requestStream << "Content-Type: " << contentType.c_str() << "\r\n";
+	}
+	requestStream << "\r\n";
+
+	HTTPResponse response;
+	const HTTPBodySink sink = onBody ? onBody : [&] (gsl::span<const gsl::byte> data)
+	{
+		response.body.insert(response.body.end(), reinterpret_cast<const Byte*>(data.data()), reinterpret_cast<const Byte*>(data.data()) + data.size());
+	};
 
-		size_t len = socket.read_some(boost::asio::buffer(buf), error);
-		if (error == boost::asio::error::eof) {
+	// A pooled connection might have been closed by the server while idle. If so, it fails before getting anything
+	// back, and the request is tried again once on a fresh connection.
+	auto connection = takeConnection(host);
+	const bool reused = connection != nullptr;
+	for (int attempt = 0; ; ++attempt) {
+		if (!connection) {
+			connection = connect(host);
+		}
+
+		boost::system::error_code error;
+		std::array<boost::asio::const_buffer, 2> buffers = {{ request.data(), boost::asio::buffer(content.data(), size_t(content.size())) }};
+		boost::asio::write(connection->socket, buffers, error);
+		if (!error) {
+			boost::asio::read_until(connection->socket, connection->buffer, "\r\n\r\n", error);
+		}
+		if (!error) {
 			break;
-		} else if (error) {
-			throw Exception("Error reading from socket: " + error.message());
 		}
+		if (!reused || attempt > 0 || connection->buffer.size() > 0) {
+			throw Exception("Error communicating with " + host + ": " + error.message(), HalleyExceptions::Network);
+		}
+		connection.reset();
+	}
 
-		result.resize(result.size() + len);
-		memcpy(&result[pos], &buf[0], len);
-		pos += len;
+	const auto head = parseHead(readUntil(connection->socket, connection->buffer, "\r\n\r\n", host), host);
+	response.status = head.status;
+
+	bool canReuse = head.http11 ? !head.close : head.keepAlive;
+	const bool hasBody = method != "HEAD" && head.status != 204 && head.status != 304 && head.status >= 200;
+	if (!hasBody) {
+		// Nothing to read
+	} else if (head.chunked) {
+		readChunkedBody(connection->socket, connection->buffer, sink, host);
+	} else if (head.contentLength) {
+		readBody(connection->socket, connection->buffer, head.contentLength, sink, host);
+	} else {
+		readBody(connection->socket, connection->buffer, {}, sink, host);
+		canReuse = false;
 	}
-	return result;
+
+	if (canReuse) {
+		returnConnection(host, std::move(connection));
+	}
+	return response;
 }
 
-#endif
+HTTPClient& HTTPClient::getDefault()
+{
+	static HTTPClient client;
+	return client;
+}
+
+std::unique_ptr<HTTPClient::Connection> HTTPClient::connect(const String& host)
+{
+	String hostName = host;
+	String port = "http";
+	const auto colon = host.find(':');
+	if (colon != String::npos) {
+		hostName = host.left(colon);
+		port = host.mid(colon + 1);
+	}
+
+	// Try each endpoint for that name until one accepts the connection
+	auto connection = std::make_unique<Connection>(ioService->service);
+	boost::system::error_code error;
+	tcp::resolver resolver(ioService->service);
+	auto endpoints = resolver.resolve(tcp::resolver::query(hostName.c_str(), port.c_str()), error);
+	if (!error) {
+		boost::asio::connect(connection->socket, endpoints, error);
+	}
+	if (error) {
+		throw Exception("Unable to connect to " + host + ": " + error.message(), HalleyExceptions::Network);
+	}
+	connection->socket.set_option(tcp::no_delay(true));
+	return connection;
+}
+
+std::unique_ptr<HTTPClient::Connection> HTTPClient::takeConnection(const String& host)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	const auto iter = idleConnections.find(host);
+	if (iter == idleConnections.end() || iter->second.empty()) {
+		return {};
+	}
+	auto connection = std::move(iter->second.back());
+	iter->second.pop_back();
+	return connection;
+}
+
+void HTTPClient::returnConnection(const String& host, std::unique_ptr<Connection> connection)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	auto& connections = idleConnections[host];
+	if (connections.size() < maxIdlePerHost) {
+		connections.push_back(std::move(connection));
+	}
+}
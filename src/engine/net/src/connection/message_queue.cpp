@@ -14,6 +14,10 @@ void MessageQueue::setChannel(int channel, ChannelSettings settings)
 {
 }
 
+void MessageQueue::enableCompression(const Bytes& dictionary)
+{
+}
+
 void MessageQueue::addFactory(std::unique_ptr<NetworkMessageFactoryBase> factory)
 {
 	typeToMsgIndex[factory->getTypeIndex()] = int(factories.size());
@@ -29,6 +33,11 @@ int MessageQueue::getMessageType(NetworkMessage& msg) const
 	return idxIter->second;
 }
 
+String MessageQueue::getMessageTypeName(int msgType) const
+{
+	return factories.at(msgType)->getTypeIndex().name();
+}
+
 std::unique_ptr<NetworkMessage> MessageQueue::deserializeMessage(gsl::span<const gsl::byte> data, unsigned short msgType, unsigned short seq)
 {
 	auto msg = factories.at(msgType)->create(data);
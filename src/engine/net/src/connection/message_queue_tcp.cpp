@@ -2,6 +2,8 @@
 #include "connection/network_packet.h"
 using namespace Halley;
 
+constexpr static size_t maxMessageSize = 64 * 1024 * 1024;
+
 MessageQueueTCP::MessageQueueTCP(std::shared_ptr<IConnection> connection)
 	: connection(connection)
 {
@@ -15,7 +17,11 @@ bool MessageQueueTCP::isConnected() const
 void MessageQueueTCP::enqueue(std::unique_ptr<NetworkMessage> msg, int channel)
 {
 	if (isConnected()) {
-		auto packet = OutboundNetworkPacket(Serializer::toBytes(*msg));
+		auto bytes = Serializer::toBytes(*msg);
+		if (compression) {
+			bytes = compression->compress(gsl::as_bytes(gsl::span<const Byte>(bytes)));
+		}
+		auto packet = OutboundNetworkPacket(bytes);
 		packet.addHeader(getMessageType(*msg));
 		connection->send(std::move(packet));
 	}
@@ -25,6 +31,11 @@ void MessageQueueTCP::sendAll()
 {
 }
 
+void MessageQueueTCP::enableCompression(const Bytes& dictionary)
+{
+	compression = std::make_unique<StreamCompression>(dictionary);
+}
+
 std::vector<std::unique_ptr<NetworkMessage>> MessageQueueTCP::receiveAll()
 {
 	std::vector<std::unique_ptr<NetworkMessage>> result;
@@ -34,7 +45,12 @@ std::vector<std::unique_ptr<NetworkMessage>> MessageQueueTCP::receiveAll()
 		while (connection->receive(packet)) {
 			int messageType = -1;
 			packet.extractHeader(messageType);
-			result.push_back(deserializeMessage(packet.getBytes(), messageType, 0));
+			if (compression) {
+				auto bytes = compression->decompress(packet.getBytes(), maxMessageSize);
+				result.push_back(deserializeMessage(gsl::as_bytes(gsl::span<const Byte>(bytes)), messageType, 0));
+			} else {
+				result.push_back(deserializeMessage(packet.getBytes(), messageType, 0));
+			}
 		}
 	}
 
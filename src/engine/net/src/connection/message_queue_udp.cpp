@@ -1,10 +1,27 @@
 #include "halley/net/connection/message_queue_udp.h"
+#include <array>
 using namespace Halley;
 
-ChannelSettings::ChannelSettings(bool reliable, bool ordered, bool keepLastSent)
+MessageQueueUDP::Fragment::Fragment(Bytes data, bool stream, int msgType, unsigned short index, unsigned short count)
+	: stream(stream)
+	, msgType(msgType)
+	, index(index)
+	, count(count)
+{
+	serialized = std::move(data);
+}
+
+void MessageQueueUDP::Fragment::serialize(Serializer& s) const
+{
+	s << gsl::as_bytes(gsl::span<const Byte>(serialized.get()));
+}
+
+ChannelSettings::ChannelSettings(bool reliable, bool ordered, bool keepLastSent, int priority, float bandwidthShare)
 	: reliable(reliable)
 	, ordered(ordered)
 	, keepLastSent(keepLastSent)
+	, priority(priority)
+	, bandwidthShare(bandwidthShare)
 {}
 
 void MessageQueueUDP::Channel::getReadyMessages(std::vector<std::unique_ptr<NetworkMessage>>& out)
@@ -65,13 +82,20 @@ MessageQueueUDP::MessageQueueUDP(std::shared_ptr<ReliableConnection> conn)
 {
 	Expects(connection);
 	connection->addAckListener(*this);
+	NetworkStatsRegistry::get().add(stats);
 }
 
 MessageQueueUDP::~MessageQueueUDP()
 {
+	NetworkStatsRegistry::get().remove(stats);
 	connection->removeAckListener(*this);
 }
 
+bool MessageQueueUDP::isConnected() const
+{
+	return connection->getStatus() == ConnectionStatus::Connected;
+}
+
 void MessageQueueUDP::setChannel(int channel, ChannelSettings settings)
 {
 	Expects(channel >= 0);
@@ -86,26 +110,52 @@ void MessageQueueUDP::setChannel(int channel, ChannelSettings settings)
 	c.initialized = true;
 }
 
+void MessageQueueUDP::enableCompression(const Bytes& dictionary)
+{
+	compression = std::make_unique<DictionaryCompression>(dictionary);
+}
+
 void MessageQueueUDP::receiveMessages()
 {
 	try {
 		InboundNetworkPacket packet;
+		Bytes decompressed;
 		while (connection->receive(packet)) {
 			auto data = packet.getBytes();
 
+			if (compression) {
+				// Read compression flag
+				if (data.size() < 1) {
+					throw Exception("Missing compression flag", HalleyExceptions::Network);
+				}
+				unsigned char compressed;
+				memcpy(&compressed, data.data(), 1);
+				data = data.subspan(1);
+				if (compressed) {
+					decompressed = compression->decompress(data, 4096);
+					data = gsl::as_bytes(gsl::span<const Byte>(decompressed));
+				}
+			}
+
 			while (data.size() > 0) {
 				// Read channel
-				char channelN;
-				memcpy(&channelN, data.data(), 1);
+				unsigned char channelByte;
+				memcpy(&channelByte, data.data(), 1);
 				data = data.subspan(1);
-				if (channelN < 0 || channelN >= 32) {
+				const bool isFragment = (channelByte & fragmentFlag) != 0;
+				const bool isStream = (channelByte & streamFlag) != 0;
+				const int channelN = channelByte & channelMask;
+				if ((channelByte & 0x80) != 0 || (isFragment && isStream)) {
 					throw Exception("Received invalid channel", HalleyExceptions::Network);
 				}
 				auto& channel = channels[channelN];
+				if ((isFragment || isStream) && !channel.settings.reliable) {
+					throw Exception("Received fragment on unreliable channel", HalleyExceptions::Network);
+				}
 
 				// Read sequence
 				unsigned short sequence = 0;
-				if (channel.settings.ordered) {
+				if (channel.settings.ordered || isFragment || isStream) {
 					if (data.size() < 2) {
 						throw Exception("Missing sequence data", HalleyExceptions::Network);
 					}
@@ -113,6 +163,26 @@ void MessageQueueUDP::receiveMessages()
 					data = data.subspan(2);
 				}
 
+				// Read fragment position, or whether it's the end of the stream
+				unsigned short fragIndex = 0;
+				unsigned short fragCount = 0;
+				if (isFragment) {
+					if (data.size() < 4) {
+						throw Exception("Missing fragment data", HalleyExceptions::Network);
+					}
+					memcpy(&fragIndex, data.data(), 2);
+					memcpy(&fragCount, data.data() + 2, 2);
+					data = data.subspan(4);
+				} else if (isStream) {
+					if (data.size() < 1) {
+						throw Exception("Missing stream data", HalleyExceptions::Network);
+					}
+					unsigned char streamEnd;
+					memcpy(&streamEnd, data.data(), 1);
+					data = data.subspan(1);
+					fragIndex = streamEnd;
+				}
+
 				// Read size
 				size_t size;
 				unsigned char b0;
@@ -134,8 +204,10 @@ void MessageQueueUDP::receiveMessages()
 				}
 
 				// Read message type
-				unsigned short msgType;
-				if (data.size() < 1) {
+				unsigned short msgType = 0;
+				if (isStream) {
+					// No type
+				} else if (data.size() < 1) {
 					throw Exception("Missing msgType data", HalleyExceptions::Network);
 				}
 				memcpy(&b0, data.data(), 1);
@@ -156,7 +228,22 @@ void MessageQueueUDP::receiveMessages()
 				if (data.size() < signed(size)) {
 					throw Exception("Message does not contain enough data", HalleyExceptions::Network);
 				}
-				channel.receiveQueue.emplace_back(deserializeMessage(data.subspan(0, size), msgType, sequence));
+				const auto msgData = data.subspan(0, size);
+				if (isFragment) {
+					onFragmentReceived(channel, msgType, sequence, fragIndex, fragCount, msgData);
+				} else if (isStream) {
+					Bytes bytes(size);
+					memcpy(bytes.data(), msgData.data(), size);
+					auto piece = std::make_unique<Fragment>(std::move(bytes), true, 0, fragIndex, 0);
+					piece->seq = sequence;
+					channel.receiveQueue.emplace_back(std::move(piece));
+				} else {
+					channel.receiveQueue.emplace_back(deserializeMessage(msgData, msgType, sequence));
+				}
+				stats.channels[channelN].onReceived(size);
+				if (!isStream) {
+					getMessageTypeStats(msgType).onReceived(size);
+				}
 				data = data.subspan(size);
 			}
 		}
@@ -175,12 +262,61 @@ std::vector<std::unique_ptr<NetworkMessage>> MessageQueueUDP::receiveAll()
 	}
 
 	std::vector<std::unique_ptr<NetworkMessage>> result;
+	std::vector<std::unique_ptr<NetworkMessage>> ready;
 	for (auto& c: channels) {
-		c.getReadyMessages(result);
+		c.getReadyMessages(ready);
+
+		// Stream pieces come out in order with the channel's messages, but are kept aside for readStream
+		for (auto& m: ready) {
+			const auto piece = asFragment(*m);
+			if (piece) {
+				const auto& bytes = piece->serialized.get();
+				c.streamData.insert(c.streamData.end(), bytes.begin(), bytes.end());
+				c.streamEnded = c.streamEnded || piece->index != 0;
+			} else {
+				result.push_back(std::move(m));
+			}
+		}
+		ready.clear();
 	}
 	return result;
 }
 
+void MessageQueueUDP::onFragmentReceived(Channel& channel, int msgType, unsigned short seq, unsigned short index, unsigned short count, gsl::span<const gsl::byte> data)
+{
+	if (index >= count) {
+		throw Exception("Received invalid fragment", HalleyExceptions::Network);
+	}
+
+	auto& incoming = channel.incoming[seq];
+	if (incoming.fragments.empty()) {
+		incoming.fragments.resize(count);
+	} else if (incoming.fragments.size() != count) {
+		throw Exception("Received mismatched fragment", HalleyExceptions::Network);
+	}
+
+	auto& fragment = incoming.fragments[index];
+	if (!fragment.empty() || data.empty()) {
+		return;
+	}
+	fragment.resize(size_t(data.size()));
+	memcpy(fragment.data(), data.data(), fragment.size());
+
+	if (++incoming.received == count) {
+		Bytes msgData;
+		for (auto& f: incoming.fragments) {
+			msgData.insert(msgData.end(), f.begin(), f.end());
+		}
+		channel.incoming.erase(seq);
+		channel.receiveQueue.emplace_back(deserializeMessage(gsl::as_bytes(gsl::span<const Byte>(msgData)), static_cast<unsigned short>(msgType), seq));
+	}
+}
+
+const MessageQueueUDP::Fragment* MessageQueueUDP::asFragment(const NetworkMessage& msg) const
+{
+	return dynamic_cast<const Fragment*>(&msg);
+}
+
 void MessageQueueUDP::enqueue(std::unique_ptr<NetworkMessage> msg, int channelNumber)
 {
 	Expects(channelNumber >= 0);
@@ -194,20 +330,114 @@ void MessageQueueUDP::enqueue(std::unique_ptr<NetworkMessage> msg, int channelNu
 	msg->channel = channelNumber;
 	msg->seq = ++channel.lastSentSeq;
 
-	pendingMsgs.push_back(std::move(msg));
+	if (getMessageSize(*msg) > maxPacketSize) {
+		if (!channel.settings.reliable) {
+			throw Exception("Message of " + toString(msg->getSerializedSize()) + " bytes is too large for unreliable channel " + toString(channelNumber), HalleyExceptions::Network);
+		}
+		enqueueFragments(std::move(msg), channel);
+	} else {
+		pendingMsgs.push_back(std::move(msg));
+	}
+}
+
+void MessageQueueUDP::enqueueFragments(std::unique_ptr<NetworkMessage> msg, Channel& channel)
+{
+	const auto& data = msg->serialized.get();
+	const size_t count = (data.size() + fragmentSize - 1) / fragmentSize;
+	if (count > 0xFFFF) {
+		throw Exception("Message of " + toString(data.size()) + " bytes is too large to send", HalleyExceptions::Network);
+	}
+
+	const int msgType = getMessageType(*msg);
+	for (size_t i = 0; i < count; ++i) {
+		const size_t start = i * fragmentSize;
+		const size_t end = std::min(start + fragmentSize, data.size());
+		auto fragment = std::make_unique<Fragment>(Bytes(data.begin() + start, data.begin() + end), false, msgType, static_cast<unsigned short>(i), static_cast<unsigned short>(count));
+		fragment->channel = msg->channel;
+		fragment->seq = msg->seq;
+		channel.fragmentQueue.push_back(std::move(fragment));
+	}
+}
+
+void MessageQueueUDP::writeStream(int channelNumber, gsl::span<const gsl::byte> data, bool last)
+{
+	Expects(channelNumber >= 0);
+	Expects(channelNumber < 32);
+
+	auto& channel = channels[channelNumber];
+	if (!channel.initialized || !channel.settings.reliable || !channel.settings.ordered) {
+		throw Exception("Streams need a reliable, ordered channel, and channel " + toString(channelNumber) + " isn't one", HalleyExceptions::Network);
+	}
+
+	size_t pos = 0;
+	do {
+		const size_t size = std::min(fragmentSize, size_t(data.size()) - pos);
+		const bool isLast = last && pos + size == size_t(data.size());
+		Bytes bytes(size);
+		memcpy(bytes.data(), data.data() + pos, size);
+		pos += size;
+
+		auto piece = std::make_unique<Fragment>(std::move(bytes), true, 0, isLast ? 1 : 0, 0);
+		piece->channel = static_cast<char>(channelNumber);
+		piece->seq = ++channel.lastSentSeq;
+		channel.fragmentQueue.push_back(std::move(piece));
+	} while (pos < size_t(data.size()));
+}
+
+bool MessageQueueUDP::readStream(int channelNumber, Bytes& data)
+{
+	Expects(channelNumber >= 0);
+	Expects(channelNumber < 32);
+
+	auto& channel = channels[channelNumber];
+	data.insert(data.end(), channel.streamData.begin(), channel.streamData.end());
+	channel.streamData.clear();
+
+	// Reset, so the channel can carry another stream
+	const bool ended = channel.streamEnded;
+	channel.streamEnded = false;
+	return ended;
+}
+
+size_t MessageQueueUDP::getFragmentBacklog(int channelNumber) const
+{
+	Expects(channelNumber >= 0);
+	Expects(channelNumber < 32);
+
+	size_t total = 0;
+	for (auto& f: channels[channelNumber].fragmentQueue) {
+		total += f->getSerializedSize();
+	}
+	return total;
+}
+
+void MessageQueueUDP::releaseFragments()
+{
+	for (auto& channel: channels) {
+		while (!channel.fragmentQueue.empty() && channel.fragmentsInFlight < fragmentWindow) {
+			pendingMsgs.splice(pendingMsgs.end(), channel.fragmentQueue, channel.fragmentQueue.begin());
+			++channel.fragmentsInFlight;
+		}
+	}
 }
 
 void MessageQueueUDP::sendAll()
 {
 	//int firstTag = nextPacketId;
 	std::vector<ReliableSubPacket> toSend;
+	size_t budget = connection->getSendBudget();
 
 	// Add packets which need to be re-sent
-	checkReSend(toSend);
+	checkReSend(toSend, budget);
+
+	// Let through the fragments that fit in each channel's window
+	releaseFragments();
 
-	// Create packets of pending messages
-	while (!pendingMsgs.empty()) {
-		toSend.emplace_back(createPacket());
+	// Create packets of pending messages that fit in the budget
+	std::list<std::unique_ptr<NetworkMessage>> selected;
+	selectMessages(selected, budget);
+	while (!selected.empty()) {
+		toSend.emplace_back(createPacket(selected));
 	}
 
 	// Send and update sequences
@@ -215,6 +445,9 @@ void MessageQueueUDP::sendAll()
 	for (auto& pending: toSend) {
 		pendingPackets[pending.tag].seq = pending.seq;
 	}
+
+	stats.pendingMessages = pendingMsgs.size();
+	stats.pendingPackets = pendingPackets.size();
 }
 
 void MessageQueueUDP::onPacketAcked(int tag)
@@ -225,9 +458,13 @@ void MessageQueueUDP::onPacketAcked(int tag)
 
 		for (auto& m : packet.msgs) {
 			auto& channel = channels[m->channel];
+			const bool isFragment = asFragment(*m) != nullptr;
+			if (isFragment) {
+				--channel.fragmentsInFlight;
+			}
 			if (m->seq - channel.lastAckSeq < 0x7FFFFFFF) {
 				channel.lastAckSeq = m->seq;
-				if (channel.settings.keepLastSent) {
+				if (channel.settings.keepLastSent && !isFragment) {
 					channel.lastAck = std::move(m);
 				}
 			}
@@ -238,7 +475,7 @@ void MessageQueueUDP::onPacketAcked(int tag)
 	}
 }
 
-void MessageQueueUDP::checkReSend(std::vector<ReliableSubPacket>& collect)
+void MessageQueueUDP::checkReSend(std::vector<ReliableSubPacket>& collect, size_t& budget)
 {
 	auto next = pendingPackets.begin();
 	for (auto iter = pendingPackets.begin(); iter != pendingPackets.end(); iter = next) {
@@ -248,8 +485,12 @@ void MessageQueueUDP::checkReSend(std::vector<ReliableSubPacket>& collect)
 		// Check how long it's been waiting
 		float elapsed = std::chrono::duration<float>(std::chrono::steady_clock::now() - pending.timeSent).count();
 		if (elapsed > 0.1f && elapsed > connection->getLatency() * 3.0f) {
-			// Re-send if it's reliable
+			// Re-send if it's reliable. If it doesn't fit in the budget, it waits for the next send.
 			if (pending.reliable) {
+				if (pending.size > budget) {
+					continue;
+				}
+				budget -= pending.size;
 				collect.push_back(makeTaggedPacket(pending.msgs, pending.size, true, pending.seq));
 			}
 			pendingPackets.erase(iter);
@@ -257,37 +498,111 @@ void MessageQueueUDP::checkReSend(std::vector<ReliableSubPacket>& collect)
 	}
 }
 
-ReliableSubPacket MessageQueueUDP::createPacket()
+void MessageQueueUDP::selectMessages(std::list<std::unique_ptr<NetworkMessage>>& selected, size_t& budget)
+{
+	// Highest priority first, and reliable before unreliable, otherwise in the order they were queued
+	pendingMsgs.sort([&] (const std::unique_ptr<NetworkMessage>& a, const std::unique_ptr<NetworkMessage>& b)
+	{
+		auto& ca = channels[a->channel].settings;
+		auto& cb = channels[b->channel].settings;
+		if (ca.priority != cb.priority) {
+			return ca.priority > cb.priority;
+		}
+		return ca.reliable && !cb.reliable;
+	});
+
+	auto take = [&] (std::list<std::unique_ptr<NetworkMessage>>::iterator iter, size_t size)
+	{
+		budget -= size;
+		selected.splice(selected.end(), pendingMsgs, iter);
+	};
+
+	// Channels with a bandwidth share get to use it first
+	const float totalBudget = float(budget);
+	std::array<size_t, 32> channelUsed = {};
+	for (auto iter = pendingMsgs.begin(); iter != pendingMsgs.end(); ) {
+		auto next = std::next(iter);
+		const int channel = (*iter)->channel;
+		const float share = channels[channel].settings.bandwidthShare;
+		const size_t size = getMessageSize(**iter);
+		if (share > 0 && size <= budget && float(channelUsed[channel] + size) <= share * totalBudget) {
+			channelUsed[channel] += size;
+			take(iter, size);
+		}
+		iter = next;
+	}
+
+	// Then everyone else, by priority
+	for (auto iter = pendingMsgs.begin(); iter != pendingMsgs.end(); ) {
+		auto next = std::next(iter);
+		const size_t size = getMessageSize(**iter);
+		if (size <= budget) {
+			take(iter, size);
+		}
+		iter = next;
+	}
+
+	// Under pressure, unreliable messages are dropped, as they'd be stale by the time they went out.
+	// Reliable ones stay queued for the next send.
+	const size_t prevSize = pendingMsgs.size();
+	pendingMsgs.remove_if([&] (const std::unique_ptr<NetworkMessage>& msg)
+	{
+		return !channels[msg->channel].settings.reliable;
+	});
+	stats.unreliableDropped += prevSize - pendingMsgs.size();
+}
+
+size_t MessageQueueUDP::getMessageSize(NetworkMessage& msg)
+{
+	if (!msg.serialized) {
+		const auto start = std::chrono::steady_clock::now();
+		msg.getSerializedSize();
+		stats.serializationTime.record(std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count());
+	}
+
+	const size_t msgSize = msg.getSerializedSize();
+	const size_t sizeBytes = msgSize >= 128 ? 2 : 1;
+	const auto fragment = asFragment(msg);
+	if (fragment) {
+		if (fragment->stream) {
+			return 1 + 2 + 1 + sizeBytes + msgSize;
+		}
+		return 1 + 2 + 4 + sizeBytes + (fragment->msgType >= 128 ? 2 : 1) + msgSize;
+	}
+
+	const int msgType = getMessageType(msg);
+	const bool isOrdered = channels[msg.channel].settings.ordered;
+	const size_t headerSize = 1 + (isOrdered ? 2 : 0) + sizeBytes + (msgType >= 128 ? 2 : 1);
+	return headerSize + msgSize;
+}
+
+ReliableSubPacket MessageQueueUDP::createPacket(std::list<std::unique_ptr<NetworkMessage>>& msgs)
 {
 	std::vector<std::unique_ptr<NetworkMessage>> sentMsgs;
-	size_t maxSize = 1200;
+	size_t maxSize = maxPacketSize;
 	size_t size = 0;
 	bool first = true;
 	bool packetReliable = false;
 
 	// Figure out what messages are going in this packet
-	auto next = pendingMsgs.begin();
-	for (auto iter = pendingMsgs.begin(); iter != pendingMsgs.end(); iter = next) {
+	auto next = msgs.begin();
+	for (auto iter = msgs.begin(); iter != msgs.end(); iter = next) {
 		++next;
 		auto& msg = *iter;
 
 		// Check if this message is compatible
 		auto& channel = channels[msg->channel];
 		bool isReliable = channel.settings.reliable;
-		bool isOrdered = channel.settings.ordered;
 		if (first || isReliable == packetReliable) {
 			// Check if the message fits
-			size_t msgSize = (*iter)->getSerializedSize();
-			int msgType = getMessageType(**iter);
-			size_t headerSize = 1 + (isOrdered ? 2 : 0) + (msgSize >= 128 ? 2 : 1) + (msgType >= 128 ? 2 : 1);
-			size_t totalSize = headerSize + msgSize;
+			size_t totalSize = getMessageSize(**iter);
 
 			if (size + totalSize <= maxSize) {
 				// It fits, so add it
 				size += totalSize;
 
 				sentMsgs.push_back(std::move(*iter));
-				pendingMsgs.erase(iter);
+				msgs.erase(iter);
 
 				first = false;
 				packetReliable = isReliable;
@@ -308,6 +623,21 @@ ReliableSubPacket MessageQueueUDP::makeTaggedPacket(std::vector<std::unique_ptr<
 
 	auto data = serializeMessages(msgs, size);
 
+	for (auto& msg: msgs) {
+		const size_t msgSize = getMessageSize(*msg);
+		stats.channels[msg->channel].onSent(msgSize);
+		const auto fragment = asFragment(*msg);
+		if (!fragment) {
+			getMessageTypeStats(getMessageType(*msg)).onSent(msgSize);
+		} else if (!fragment->stream) {
+			getMessageTypeStats(fragment->msgType).onSent(msgSize);
+		}
+	}
+	if (resends) {
+		++stats.packetsResent;
+		stats.messagesResent += msgs.size();
+	}
+
 	int tag = nextPacketId++;
 	auto& pendingData = pendingPackets[tag];
 	pendingData.msgs = std::move(msgs);
@@ -322,27 +652,53 @@ ReliableSubPacket MessageQueueUDP::makeTaggedPacket(std::vector<std::unique_ptr<
 	return result;
 }
 
-std::vector<gsl::byte> MessageQueueUDP::serializeMessages(const std::vector<std::unique_ptr<NetworkMessage>>& msgs, size_t size) const
+NetworkTrafficCounters& MessageQueueUDP::getMessageTypeStats(int msgType)
+{
+	if (size_t(msgType) >= stats.messageTypes.size()) {
+		const size_t prevSize = stats.messageTypes.size();
+		stats.messageTypes.resize(size_t(msgType) + 1);
+		stats.messageTypeNames.resize(size_t(msgType) + 1);
+		for (size_t i = prevSize; i < stats.messageTypes.size(); ++i) {
+			stats.messageTypeNames[i] = getMessageTypeName(int(i));
+		}
+	}
+	return stats.messageTypes[msgType];
+}
+
+OutboundNetworkPacket MessageQueueUDP::serializeMessages(const std::vector<std::unique_ptr<NetworkMessage>>& msgs, size_t size) const
 {
-	std::vector<gsl::byte> result(size);
+	OutboundNetworkPacket packet(size);
+	auto result = packet.getWriteableBytes();
 	size_t pos = 0;
 	
 	for (auto& msg: msgs) {
 		size_t msgSize = msg->getSerializedSize();
-		int msgType = getMessageType(*msg);
+		const auto fragment = asFragment(*msg);
+		const bool isStream = fragment && fragment->stream;
+		int msgType = fragment ? fragment->msgType : getMessageType(*msg);
 		char channelN = msg->channel;
 
 		auto& channel = channels[channelN];
 		bool isOrdered = channel.settings.ordered;
 
 		// Write header
-		memcpy(&result[pos], &channelN, 1);
+		const unsigned char channelByte = static_cast<unsigned char>(channelN) | (fragment ? (isStream ? streamFlag : fragmentFlag) : 0);
+		memcpy(&result[pos], &channelByte, 1);
 		pos += 1;
-		if (isOrdered) {
+		if (isOrdered || fragment) {
 			unsigned short sequence = static_cast<unsigned short>(msg->seq);
 			memcpy(&result[pos], &sequence, 2);
 			pos += 2;
 		}
+		if (isStream) {
+			const unsigned char streamEnd = fragment->index != 0 ? 1 : 0;
+			memcpy(&result[pos], &streamEnd, 1);
+			pos += 1;
+		} else if (fragment) {
+			memcpy(&result[pos], &fragment->index, 2);
+			memcpy(&result[pos + 2], &fragment->count, 2);
+			pos += 4;
+		}
 		if (msgSize >= 128) {
 			std::array<unsigned char, 2> bytes;
 			bytes[0] = static_cast<unsigned char>(msgSize >> 8) | 0x80;
@@ -354,7 +710,9 @@ std::vector<gsl::byte> MessageQueueUDP::serializeMessages(const std::vector<std:
 			memcpy(&result[pos], &byte, 1);
 			pos += 1;
 		}
-		if (msgType >= 128) {
+		if (isStream) {
+			// No type
+		} else if (msgType >= 128) {
 			std::array<unsigned char, 2> bytes;
 			bytes[0] = static_cast<unsigned char>(msgType >> 8) | 0x80;
 			bytes[1] = static_cast<unsigned char>(msgType & 0xFF);
@@ -368,9 +726,24 @@ std::vector<gsl::byte> MessageQueueUDP::serializeMessages(const std::vector<std:
 		}
 
 		// Write message
-		msg->serializeTo(gsl::span<gsl::byte>(result).subspan(pos, msgSize));
+		msg->serializeTo(result.subspan(pos, msgSize));
 		pos += msgSize;
 	}
 
-	return result;
+	if (compression) {
+		return compressPacket(std::move(packet));
+	}
+	return packet;
+}
+
+OutboundNetworkPacket MessageQueueUDP::compressPacket(OutboundNetworkPacket packet) const
+{
+	// Flag whether it's compressed, as small packets may not get any smaller
+	auto compressed = compression->compress(packet.getBytes());
+	const unsigned char isCompressed = compressed.size() < packet.getSize() ? 1 : 0;
+	if (isCompressed) {
+		packet = OutboundNetworkPacket(compressed);
+	}
+	packet.addHeader(isCompressed);
+	return packet;
 }
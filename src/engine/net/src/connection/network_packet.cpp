@@ -1,18 +1,172 @@
 #include "connection/network_packet.h"
 #include <halley/support/exception.h>
+#include <atomic>
 #include <cassert>
+#include <mutex>
 
 using namespace Halley;
 
+namespace Halley {
+	class NetworkPacketBuffer
+	{
+	public:
+		std::atomic<int> refCount{ 1 };
+		std::vector<gsl::byte> data;
+	};
+}
+
+namespace {
+	class NetworkPacketPool
+	{
+	public:
+		~NetworkPacketPool()
+		{
+			for (auto b: free) {
+				delete b;
+			}
+		}
+
+		NetworkPacketBuffer* acquire(size_t size)
+		{
+			if (size > NetworkPacketBase::pooledSize) {
+				auto buffer = new NetworkPacketBuffer();
+				buffer->data.resize(size);
+				return buffer;
+			}
+
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				if (!free.empty()) {
+					auto buffer = free.back();
+					free.pop_back();
+					buffer->refCount = 1;
+					return buffer;
+				}
+			}
+
+			auto buffer = new NetworkPacketBuffer();
+			buffer->data.resize(NetworkPacketBase::pooledSize);
+			return buffer;
+		}
+
+		void release(NetworkPacketBuffer* buffer)
+		{
+			if (buffer->data.size() == NetworkPacketBase::pooledSize) {
+				std::unique_lock<std::mutex> lock(mutex);
+				if (free.size() < maxFree) {
+					free.push_back(buffer);
+					return;
+				}
+			}
+			delete buffer;
+		}
+
+	private:
+		constexpr static size_t maxFree = 4096;
+
+		std::mutex mutex;
+		std::vector<NetworkPacketBuffer*> free;
+	};
+
+	NetworkPacketPool& getPool()
+	{
+		static NetworkPacketPool pool;
+		return pool;
+	}
+
+	void addRef(NetworkPacketBuffer* buffer)
+	{
+		if (buffer) {
+			buffer->refCount.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	void removeRef(NetworkPacketBuffer* buffer)
+	{
+		if (buffer && buffer->refCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			getPool().release(buffer);
+		}
+	}
+}
+
 NetworkPacketBase::NetworkPacketBase()
-	: dataStart(0)
 {}
 
 NetworkPacketBase::NetworkPacketBase(gsl::span<const gsl::byte> src, size_t prePadding)
-	: dataStart(prePadding)
+	: NetworkPacketBase(size_t(src.size_bytes()), prePadding)
+{
+	memcpy(buffer->data.data() + dataStart, src.data(), src.size_bytes());
+}
+
+NetworkPacketBase::NetworkPacketBase(size_t size, size_t prePadding)
+	: buffer(getPool().acquire(size + prePadding))
+	, dataStart(prePadding)
+	, dataEnd(prePadding + size)
+{}
+
+NetworkPacketBase::NetworkPacketBase(const NetworkPacketBase& other)
+	: buffer(other.buffer)
+	, dataStart(other.dataStart)
+	, dataEnd(other.dataEnd)
+{
+	addRef(buffer);
+}
+
+NetworkPacketBase::NetworkPacketBase(NetworkPacketBase&& other) noexcept
+	: buffer(other.buffer)
+	, dataStart(other.dataStart)
+	, dataEnd(other.dataEnd)
+{
+	other.buffer = nullptr;
+	other.dataStart = other.dataEnd = 0;
+}
+
+NetworkPacketBase::~NetworkPacketBase()
+{
+	removeRef(buffer);
+}
+
+NetworkPacketBase& NetworkPacketBase::operator=(const NetworkPacketBase& other)
+{
+	if (this != &other) {
+		addRef(other.buffer);
+		removeRef(buffer);
+		buffer = other.buffer;
+		dataStart = other.dataStart;
+		dataEnd = other.dataEnd;
+	}
+	return *this;
+}
+
+NetworkPacketBase& NetworkPacketBase::operator=(NetworkPacketBase&& other) noexcept
+{
+	if (this != &other) {
+		removeRef(buffer);
+		buffer = other.buffer;
+		dataStart = other.dataStart;
+		dataEnd = other.dataEnd;
+		other.buffer = nullptr;
+		other.dataStart = other.dataEnd = 0;
+	}
+	return *this;
+}
+
+void NetworkPacketBase::makeWriteable(size_t prePadding)
 {
-	data.resize(src.size_bytes() + prePadding);
-	memcpy(data.data() + prePadding, src.data(), src.size_bytes());
+	if (buffer && dataStart >= prePadding && buffer->refCount.load(std::memory_order_acquire) == 1) {
+		return;
+	}
+
+	const size_t size = getSize();
+	const size_t newStart = std::max(prePadding, headroom);
+	auto newBuffer = getPool().acquire(newStart + size);
+	if (size > 0) {
+		memcpy(newBuffer->data.data() + newStart, buffer->data.data() + dataStart, size);
+	}
+	removeRef(buffer);
+	buffer = newBuffer;
+	dataStart = newStart;
+	dataEnd = newStart + size;
 }
 
 size_t NetworkPacketBase::copyTo(gsl::span<gsl::byte> dst) const
@@ -20,57 +174,82 @@ size_t NetworkPacketBase::copyTo(gsl::span<gsl::byte> dst) const
 	if (dst.size() < signed(getSize())) {
 		throw Exception("Destination buffer is too small for network packet.", HalleyExceptions::Network);
 	}
-	memcpy(dst.data(), data.data() + dataStart, getSize());
+	if (getSize() > 0) {
+		memcpy(dst.data(), buffer->data.data() + dataStart, getSize());
+	}
 	return getSize();
 }
 
 size_t NetworkPacketBase::getSize() const
 {
-	Expects(data.size() >= dataStart);
-	return data.size() - dataStart;
+	Expects(dataEnd >= dataStart);
+	return dataEnd - dataStart;
 }
 
 gsl::span<const gsl::byte> NetworkPacketBase::getBytes() const
 {
-	return gsl::span<const gsl::byte>(data).subspan(dataStart, getSize());
+	if (!buffer) {
+		return {};
+	}
+	return gsl::span<const gsl::byte>(buffer->data).subspan(dataStart, getSize());
 }
 
-OutboundNetworkPacket::OutboundNetworkPacket(const OutboundNetworkPacket& other)
+OutboundNetworkPacket::OutboundNetworkPacket()
 	: NetworkPacketBase()
-{
-	data = other.data;
-	dataStart = other.dataStart;
-}
+{}
+
+OutboundNetworkPacket::OutboundNetworkPacket(const OutboundNetworkPacket& other)
+	: NetworkPacketBase(other)
+{}
 
 OutboundNetworkPacket::OutboundNetworkPacket(OutboundNetworkPacket&& other) noexcept
-{
-	data = other.data;
-	dataStart = other.dataStart;
-	other.dataStart = 0;
-}
+	: NetworkPacketBase(std::move(other))
+{}
 
 OutboundNetworkPacket::OutboundNetworkPacket(gsl::span<const gsl::byte> data)
-	: NetworkPacketBase(data, 128)
+	: NetworkPacketBase(data, headroom)
 {}
 
 OutboundNetworkPacket::OutboundNetworkPacket(const Bytes& data)
-	: NetworkPacketBase(gsl::as_bytes(gsl::span<const Byte>(data)), 128)
+	: NetworkPacketBase(gsl::as_bytes(gsl::span<const Byte>(data)), headroom)
+{
+}
+
+OutboundNetworkPacket::OutboundNetworkPacket(size_t size)
+	: NetworkPacketBase(size, headroom)
+{}
+
+gsl::span<gsl::byte> OutboundNetworkPacket::getWriteableBytes()
+{
+	makeWriteable(0);
+	return gsl::span<gsl::byte>(buffer->data).subspan(dataStart, getSize());
+}
+
+void OutboundNetworkPacket::resize(size_t size)
 {
+	makeWriteable(0);
+	Expects(dataStart + size <= buffer->data.size());
+	dataEnd = dataStart + size;
 }
 
 void OutboundNetworkPacket::addHeader(gsl::span<const gsl::byte> src)
 {
-	Expects(src.size_bytes() <= signed(dataStart));
-	
-	dataStart -= src.size_bytes();
-	memcpy(data.data() + dataStart, src.data(), src.size_bytes());
+	const size_t size = size_t(src.size_bytes());
+	makeWriteable(size);
+
+	dataStart -= size;
+	memcpy(buffer->data.data() + dataStart, src.data(), size);
+}
+
+OutboundNetworkPacket& OutboundNetworkPacket::operator=(const OutboundNetworkPacket& other)
+{
+	NetworkPacketBase::operator=(other);
+	return *this;
 }
 
 OutboundNetworkPacket& OutboundNetworkPacket::operator=(OutboundNetworkPacket&& other) noexcept
 {
-	data = other.data;
-	dataStart = other.dataStart;
-	other.dataStart = 0;
+	NetworkPacketBase::operator=(std::move(other));
 	return *this;
 }
 
@@ -78,13 +257,9 @@ InboundNetworkPacket::InboundNetworkPacket()
 	: NetworkPacketBase()
 {}
 
-InboundNetworkPacket::InboundNetworkPacket(InboundNetworkPacket&& other)
-	: NetworkPacketBase()
-{
-	data = other.data;
-	dataStart = other.dataStart;
-	other.dataStart = 0;
-}
+InboundNetworkPacket::InboundNetworkPacket(InboundNetworkPacket&& other) noexcept
+	: NetworkPacketBase(std::move(other))
+{}
 
 InboundNetworkPacket::InboundNetworkPacket(gsl::span<const gsl::byte> data)
 	: NetworkPacketBase(data, 0)
@@ -92,16 +267,14 @@ InboundNetworkPacket::InboundNetworkPacket(gsl::span<const gsl::byte> data)
 
 void InboundNetworkPacket::extractHeader(gsl::span<gsl::byte> dst)
 {
-	Expects(dst.size_bytes() <= signed(data.size()));
+	Expects(dst.size_bytes() <= signed(getSize()));
 
-	memcpy(dst.data(), data.data() + dataStart, dst.size_bytes());
+	memcpy(dst.data(), buffer->data.data() + dataStart, dst.size_bytes());
 	dataStart += dst.size_bytes();
 }
 
-InboundNetworkPacket& InboundNetworkPacket::operator=(InboundNetworkPacket&& other)
+InboundNetworkPacket& InboundNetworkPacket::operator=(InboundNetworkPacket&& other) noexcept
 {
-	data = other.data;
-	dataStart = other.dataStart;
-	other.dataStart = 0;
+	NetworkPacketBase::operator=(std::move(other));
 	return *this;
 }
@@ -0,0 +1,174 @@
+#include "connection/network_stats.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace Halley;
+
+namespace {
+	constexpr float firstBucketBound = 0.001f;
+	constexpr float bucketGrowth = 1.5f;
+}
+
+void NetworkHistogram::record(float seconds)
+{
+	size_t bucket = 0;
+	if (seconds > firstBucketBound) {
+		bucket = std::min(size_t(std::ceil(std::log(seconds / firstBucketBound) / std::log(bucketGrowth))), numBuckets - 1);
+	}
+	++buckets[bucket];
+	++count;
+	total += seconds;
+	maxValue = std::max(maxValue, seconds);
+}
+
+void NetworkHistogram::merge(const NetworkHistogram& other)
+{
+	for (size_t i = 0; i < numBuckets; ++i) {
+		buckets[i] += other.buckets[i];
+	}
+	count += other.count;
+	total += other.total;
+	maxValue = std::max(maxValue, other.maxValue);
+}
+
+void NetworkHistogram::reset()
+{
+	*this = NetworkHistogram();
+}
+
+float NetworkHistogram::getMean() const
+{
+	return count > 0 ? float(total / double(count)) : 0.0f;
+}
+
+float NetworkHistogram::getPercentile(float percentile) const
+{
+	const auto target = uint64_t(std::ceil(double(count) * double(percentile)));
+	uint64_t accumulated = 0;
+	for (size_t i = 0; i < numBuckets; ++i) {
+		accumulated += buckets[i];
+		if (accumulated >= target && accumulated > 0) {
+			return std::min(getBucketUpperBound(i), maxValue);
+		}
+	}
+	return maxValue;
+}
+
+float NetworkHistogram::getBucketUpperBound(size_t bucket)
+{
+	return firstBucketBound * std::pow(bucketGrowth, float(bucket));
+}
+
+NetworkTrafficCounters& NetworkTrafficCounters::operator+=(const NetworkTrafficCounters& other)
+{
+	bytesSent += other.bytesSent;
+	bytesReceived += other.bytesReceived;
+	packetsSent += other.packetsSent;
+	packetsReceived += other.packetsReceived;
+	return *this;
+}
+
+void ConnectionStats::merge(const ConnectionStats& other)
+{
+	traffic += other.traffic;
+	packetsAcked += other.packetsAcked;
+	packetsLost += other.packetsLost;
+	roundTripTime.merge(other.roundTripTime);
+	ackDelay.merge(other.ackDelay);
+}
+
+void MessageQueueStats::merge(const MessageQueueStats& other)
+{
+	for (size_t i = 0; i < channels.size(); ++i) {
+		channels[i] += other.channels[i];
+	}
+	for (size_t i = 0; i < other.messageTypes.size(); ++i) {
+		const auto& name = other.messageTypeNames[i];
+		auto iter = std::find(messageTypeNames.begin(), messageTypeNames.end(), name);
+		if (iter == messageTypeNames.end()) {
+			messageTypeNames.push_back(name);
+			messageTypes.push_back(other.messageTypes[i]);
+		} else {
+			messageTypes[iter - messageTypeNames.begin()] += other.messageTypes[i];
+		}
+	}
+	packetsResent += other.packetsResent;
+	messagesResent += other.messagesResent;
+	unreliableDropped += other.unreliableDropped;
+	pendingMessages += other.pendingMessages;
+	pendingPackets += other.pendingPackets;
+	serializationTime.merge(other.serializationTime);
+}
+
+void SessionStats::merge(const SessionStats& other)
+{
+	for (size_t i = 0; i < messageTypes.size(); ++i) {
+		messageTypes[i] += other.messageTypes[i];
+	}
+	for (size_t i = 0; i < controlMessages.size(); ++i) {
+		controlMessages[i] += other.controlMessages[i];
+	}
+	relayed += other.relayed;
+}
+
+NetworkStatsRegistry& NetworkStatsRegistry::get()
+{
+	static NetworkStatsRegistry registry;
+	return registry;
+}
+
+void NetworkStatsRegistry::add(const ConnectionStats& stats)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	connections.push_back(&stats);
+}
+
+void NetworkStatsRegistry::remove(const ConnectionStats& stats)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	connections.erase(std::remove(connections.begin(), connections.end(), &stats), connections.end());
+}
+
+void NetworkStatsRegistry::add(const MessageQueueStats& stats)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	messageQueues.push_back(&stats);
+}
+
+void NetworkStatsRegistry::remove(const MessageQueueStats& stats)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	messageQueues.erase(std::remove(messageQueues.begin(), messageQueues.end(), &stats), messageQueues.end());
+}
+
+void NetworkStatsRegistry::add(const SessionStats& stats)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	sessions.push_back(&stats);
+}
+
+void NetworkStatsRegistry::remove(const SessionStats& stats)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	sessions.erase(std::remove(sessions.begin(), sessions.end(), &stats), sessions.end());
+}
+
+NetworkStats NetworkStatsRegistry::gather() const
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	NetworkStats result;
+	result.numConnections = connections.size();
+	result.numMessageQueues = messageQueues.size();
+	result.numSessions = sessions.size();
+	for (auto c: connections) {
+		result.connections.merge(*c);
+	}
+	for (auto q: messageQueues) {
+		result.messageQueues.merge(*q);
+	}
+	for (auto s: sessions) {
+		result.sessions.merge(*s);
+	}
+	return result;
+}
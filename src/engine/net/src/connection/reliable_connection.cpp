@@ -23,13 +23,23 @@ struct ReliableSubHeader
 };
 
 constexpr size_t BUFFER_SIZE = 1024;
+constexpr int LOSS_REORDER_THRESHOLD = 3; // A packet is only considered lost once this many later packets have been acked
 
-ReliableConnection::ReliableConnection(std::shared_ptr<IConnection> parent)
+ReliableConnection::ReliableConnection(std::shared_ptr<IConnection> parent, CongestionSettings congestion)
 	: parent(parent)
 	, receivedSeqs(BUFFER_SIZE)
 	, sentPackets(BUFFER_SIZE)
+	, congestion(congestion)
+	, sendRate(congestion.initialRate)
 {
-	lastSend = lastReceive = Clock::now();
+	lastSend = lastReceive = lastBudgetUpdate = lastRateDecrease = Clock::now();
+	sendBudget = getMaxBudget();
+	NetworkStatsRegistry::get().add(stats);
+}
+
+ReliableConnection::~ReliableConnection()
+{
+	NetworkStatsRegistry::get().remove(stats);
 }
 
 void ReliableConnection::close()
@@ -44,59 +54,59 @@ ConnectionStatus ReliableConnection::getStatus() const
 
 void ReliableConnection::send(OutboundNetworkPacket&& packet)
 {
-	ReliableSubPacket subPacket;
-	subPacket.data.resize(packet.getSize());
-	packet.copyTo(subPacket.data);
-	subPacket.resends = false;
+	ReliableSubPacket subPacket(std::move(packet));
 	subPacket.tag = -1;
 
 	sendTagged(gsl::span<ReliableSubPacket>(&subPacket, 1));
 }
 
+static size_t writeSubHeader(gsl::span<gsl::byte, 4> dst, const ReliableSubPacket& subPacket)
+{
+	bool isResend = subPacket.resends;
+	unsigned short resending = subPacket.resendSeq;
+	size_t size = subPacket.data.getSize();
+	size_t pos = 0;
+
+	bool longSize = size >= 64;
+	if (longSize) {
+		std::array<unsigned char, 2> b;
+		b[0] = static_cast<unsigned char>((size >> 8) & 0x3F) | 0x40 | (isResend ? 0x80 : 0);
+		b[1] = static_cast<unsigned char>(size & 0xFF);
+		memcpy(dst.subspan(pos, 2).data(), b.data(), 2);
+		pos += 2;
+	} else {
+		unsigned char b = static_cast<unsigned char>(size) | (isResend ? 0x80 : 0);
+		memcpy(dst.subspan(pos, 1).data(), &b, 1);
+		pos += 1;
+	}
+	if (resending) {
+		memcpy(dst.subspan(pos, 2).data(), &resending, 2);
+		pos += 2;
+	}
+	return pos;
+}
+
 void ReliableConnection::sendTagged(gsl::span<ReliableSubPacket> subPackets)
 {
 	unsigned short firstSeq = nextSequenceToSend;
-	std::array<gsl::byte, 2048> buffer;
-	gsl::span<gsl::byte, 2048> dst(buffer);
-	size_t pos = sizeof(ReliableHeader);
+	updateSendBudget();
 
-	for (auto& subPacket : subPackets) {
-		// Add reliable sub-header
-		bool isResend = subPacket.resends;
-		unsigned short resending = subPacket.resendSeq;
-		size_t size = subPacket.data.size();
-		bool longSize = size >= 64;
-		if (longSize) {
-			std::array<unsigned char, 2> b;
-			b[0] = static_cast<unsigned char>((size >> 8) & 0x3F) | 0x40 | (isResend ? 0x80 : 0);
-			b[1] = static_cast<unsigned char>(size & 0xFF);
-			memcpy(dst.subspan(pos, 2).data(), b.data(), 2);
-			pos += 2;
-		} else {
-			unsigned char b = static_cast<unsigned char>(size) | (isResend ? 0x80 : 0);
-			memcpy(dst.subspan(pos, 1).data(), &b, 1);
-			pos += 1;
-		}
-		if (resending) {
-			memcpy(dst.subspan(pos, 2).data(), &resending, 2);
-			pos += 2;
-		}
-
-		// Add data
-#ifdef _MSC_VER
-		memcpy_s(dst.subspan(pos).data(), dst.subspan(pos).size_bytes(), subPacket.data.data(), subPacket.data.size());
-#else
-		memcpy(dst.subspan(pos).data(), subPacket.data.data(), subPacket.data.size());
-#endif
-		pos += subPacket.data.size();
+	// Every packet carries acks, so this is when the other end hears about what we received
+	if (hasUnackedReceive) {
+		hasUnackedReceive = false;
+		stats.ackDelay.record(std::chrono::duration<float>(Clock::now() - firstUnackedReceive).count());
+	}
 
+	for (auto& subPacket : subPackets) {
 		// Get sequence
 		unsigned short seq = nextSequenceToSend++;
 		size_t idx = seq % BUFFER_SIZE;
 		auto& sent = sentPackets[idx];
 		sent.waiting = true;
 		sent.tag = subPacket.tag;
+		sent.size = subPacket.data.getSize();
 		lastSend = sent.timestamp = Clock::now();
+		sendBudget -= float(sent.size);
 
 		// Update caller on the sequence number of this
 		subPacket.seq = seq;
@@ -105,20 +115,45 @@ void ReliableConnection::sendTagged(gsl::span<ReliableSubPacket> subPackets)
 		}
 	}
 
-	// Add reliable header
+	// Reliable header
 	ReliableHeader header;
 	header.sequence = firstSeq;
 	header.ack = highestReceived;
 	header.ackBits = generateAckBits();
-	auto headerData = gsl::as_bytes(gsl::span<ReliableHeader>(&header, 1));
-#ifdef _MSC_VER
-	memcpy_s(dst.data(), dst.size_bytes(), headerData.data(), headerData.size());
-#else
-	memcpy(dst.data(), headerData.data(), headerData.size());
-#endif
+
+	std::array<gsl::byte, 4> subHeader;
+	if (subPackets.size() == 1) {
+		// Common case, write the headers in front of the data in place
+		auto& subPacket = subPackets[0];
+		const size_t subHeaderSize = writeSubHeader(subHeader, subPacket);
+		OutboundNetworkPacket packet = std::move(subPacket.data);
+		packet.addHeader(gsl::span<const gsl::byte>(subHeader).subspan(0, subHeaderSize));
+		packet.addHeader(header);
+		stats.traffic.onSent(packet.getSize());
+		parent->send(std::move(packet));
+		return;
+	}
+
+	// Aggregate all sub-packets into a single packet
+	size_t totalSize = sizeof(ReliableHeader);
+	for (auto& subPacket : subPackets) {
+		totalSize += writeSubHeader(subHeader, subPacket) + subPacket.data.getSize();
+	}
+	OutboundNetworkPacket packet(totalSize);
+	auto dst = packet.getWriteableBytes();
+
+	memcpy(dst.data(), &header, sizeof(ReliableHeader));
+	size_t pos = sizeof(ReliableHeader);
+	for (auto& subPacket : subPackets) {
+		const size_t subHeaderSize = writeSubHeader(subHeader, subPacket);
+		memcpy(dst.subspan(pos, subHeaderSize).data(), subHeader.data(), subHeaderSize);
+		pos += subHeaderSize;
+		pos += subPacket.data.copyTo(dst.subspan(pos));
+	}
 
 	// Send
-	parent->send(OutboundNetworkPacket(dst.subspan(0, pos)));
+	stats.traffic.onSent(packet.getSize());
+	parent->send(std::move(packet));
 }
 
 bool ReliableConnection::receive(InboundNetworkPacket& packet)
@@ -128,6 +163,11 @@ bool ReliableConnection::receive(InboundNetworkPacket& packet)
 		InboundNetworkPacket tmp;
 		while (parent->receive(tmp)) {
 			lastReceive = Clock::now();
+			stats.traffic.onReceived(tmp.getSize());
+			if (!hasUnackedReceive) {
+				hasUnackedReceive = true;
+				firstUnackedReceive = lastReceive;
+			}
 			processReceivedPacket(tmp);
 		}
 	} catch (std::exception& e) {
@@ -215,9 +255,11 @@ void ReliableConnection::processReceivedAcks(unsigned short ack, unsigned int ac
 	}
 
 	for (int i = 32; --i >= 0; ) {
+		unsigned short seq = static_cast<unsigned short>(ack - (i + 1));
 		if (ackBits & (1 << i)) {
-			unsigned short seq = static_cast<unsigned short>(ack - (i + 1));
 			onAckReceived(seq);
+		} else if (i + 1 >= LOSS_REORDER_THRESHOLD) {
+			onPacketLost(seq);
 		}
 	}
 	onAckReceived(ack);
@@ -271,6 +313,31 @@ void ReliableConnection::onAckReceived(unsigned short sequence)
 		}
 		float msgLag = std::chrono::duration<float>(Clock::now() - data.timestamp).count();
 		reportLatency(msgLag);
+		++stats.packetsAcked;
+		stats.roundTripTime.record(msgLag);
+
+		// Additive increase, spread over the acks of a round trip
+		const float inFlight = std::max(sendRate * std::max(lag, 0.001f), 1.0f);
+		sendRate = std::min(sendRate + congestion.increasePerRoundTrip * float(data.size) / inFlight, congestion.maxRate);
+		packetLoss = lerp(packetLoss, 0.0f, 0.05f);
+	}
+}
+
+void ReliableConnection::onPacketLost(unsigned short sequence)
+{
+	auto& data = sentPackets[sequence % BUFFER_SIZE];
+	if (data.waiting) {
+		// Listeners aren't told, they'll time out and re-send as usual
+		data.waiting = false;
+		packetLoss = lerp(packetLoss, 1.0f, 0.05f);
+		++stats.packetsLost;
+
+		// Multiplicative decrease, once per round trip
+		const auto now = Clock::now();
+		if (std::chrono::duration<float>(now - lastRateDecrease).count() > lag) {
+			lastRateDecrease = now;
+			sendRate = std::max(sendRate * congestion.decreaseFactor, congestion.minRate);
+		}
 	}
 }
 
@@ -295,6 +362,35 @@ void ReliableConnection::reportLatency(float lastMeasuredLag)
 	}
 }
 
+size_t ReliableConnection::getSendBudget()
+{
+	if (!congestion.enabled) {
+		return std::numeric_limits<size_t>::max();
+	}
+	updateSendBudget();
+	return sendBudget > 0 ? size_t(sendBudget) : 0;
+}
+
+void ReliableConnection::setCongestionSettings(CongestionSettings settings)
+{
+	congestion = settings;
+	sendRate = clamp(sendRate, congestion.minRate, congestion.maxRate);
+}
+
+void ReliableConnection::updateSendBudget()
+{
+	const auto now = Clock::now();
+	const float elapsed = std::chrono::duration<float>(now - lastBudgetUpdate).count();
+	lastBudgetUpdate = now;
+	sendBudget = std::min(sendBudget + sendRate * elapsed, getMaxBudget());
+}
+
+float ReliableConnection::getMaxBudget() const
+{
+	// Always allow at least one full packet through
+	return std::max(sendRate * congestion.maxBurst, 1500.0f);
+}
+
 float ReliableConnection::getTimeSinceLastSend() const
 {
 	return std::chrono::duration<float>(Clock::now() - lastSend).count();
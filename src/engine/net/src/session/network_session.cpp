@@ -2,11 +2,35 @@
 #include "session/network_session_control_messages.h"
 #include "connection/network_service.h"
 #include "connection/network_packet.h"
+#include "halley/support/memory_tracker.h"
 using namespace Halley;
 
+namespace {
+	constexpr auto stateResendInterval = std::chrono::milliseconds(100);
+
+	SerializerOptions getStateSerializerOptions()
+	{
+		SerializerOptions options;
+		options.compact = true;
+		return options;
+	}
+
+	struct SharedDataDelta
+	{
+		const SharedData& data;
+		uint64_t fields;
+
+		void serialize(Serializer& s) const
+		{
+			data.serializeDelta(s, fields);
+		}
+	};
+}
+
 NetworkSession::NetworkSession(NetworkService& service)
 	: service(service)
 {
+	NetworkStatsRegistry::get().add(stats);
 }
 
 NetworkSession::~NetworkSession()
@@ -15,6 +39,7 @@ NetworkSession::~NetworkSession()
 		service.setAcceptingConnections(false);
 	}
 	NetworkSession::close();
+	NetworkStatsRegistry::get().remove(stats);
 }
 
 void NetworkSession::host(int port)
@@ -93,17 +118,22 @@ void NetworkSession::acceptConnection(std::shared_ptr<IConnection> incoming)
 	Bytes bytes = Serializer::toBytes(msg);
 	sharedData[msg.peerId] = makePeerSharedData();
 
+	// Forget anything about a previous peer with this id; it'll be sent all state on the next update, as it hasn't acked any.
+	// Its own data is new, so the other peers get all of it as the next version.
+	receivedStateVersions.erase(msg.peerId);
+	for (auto& r: replication) {
+		r.second.peers.erase(msg.peerId);
+	}
+	sharedData[msg.peerId]->markModified();
+
 	auto& conn = *connections.back();
 	conn.send(doMakeControlPacket(NetworkSessionControlMessageType::SetPeerId, OutboundNetworkPacket(bytes)));
-	conn.send(makeUpdateSharedDataPacket(-1));
-	for (auto& i: sharedData) {
-		conn.send(makeUpdateSharedDataPacket(i.first));
-	}
 	onConnected(msg.peerId);
 }
 
 void NetworkSession::update()
 {
+	MemoryTagScope memoryTag(MemoryTag::Net);
 	// Remove dead connections
 	service.update();
 	connections.erase(std::remove_if(connections.begin(), connections.end(), [] (const std::shared_ptr<IConnection>& c) { return c->getStatus() == ConnectionStatus::Closed; }), connections.end());
@@ -119,17 +149,17 @@ void NetworkSession::update()
 			service.setAcceptingConnections(false);
 		}
 
+		// Host relays everyone's state
 		checkForOutboundStateChanges(-1);
+		for (auto& i: sharedData) {
+			checkForOutboundStateChanges(i.first);
+		}
 	}
 
 	if (type == NetworkSessionType::Client) {
 		if (connections.empty()) {
 			close();
-		}
-	}
-
-	if (type == NetworkSessionType::Host || type == NetworkSessionType::Client) {
-		if (myPeerId != -1) {
+		} else if (myPeerId != -1) {
 			auto iter = sharedData.find(myPeerId);
 			if (iter != sharedData.end()) {
 				checkForOutboundStateChanges(myPeerId);
@@ -147,6 +177,11 @@ NetworkSessionType NetworkSession::getType() const
 	return type;
 }
 
+const SessionStats& NetworkSession::getStats() const
+{
+	return stats;
+}
+
 SharedData& NetworkSession::doGetMySharedData()
 {
 	if (type == NetworkSessionType::Undefined || myPeerId == -1) {
@@ -242,6 +277,7 @@ void NetworkSession::sendToAll(OutboundNetworkPacket&& packet, int except)
 {
 	for (size_t i = 0; i < connections.size(); ++i) {
 		if (int(i) != except) {
+			stats.relayed.onSent(packet.getSize());
 			connections[i]->send(OutboundNetworkPacket(packet));
 		}
 	}
@@ -253,9 +289,14 @@ void NetworkSession::send(OutboundNetworkPacket&& packet)
 	header.type = NetworkSessionMessageType::ToPeers;
 	header.srcPeerId = myPeerId;
 
-	auto out = makeOutbound(packet.getBytes(), header);
-	for (auto& c: connections) {
-		c->send(OutboundNetworkPacket(out));
+	packet.addHeader(header);
+	for (size_t i = 0; i < connections.size(); ++i) {
+		stats.messageTypes[int(NetworkSessionMessageType::ToPeers)].onSent(packet.getSize());
+		if (i + 1 == connections.size()) {
+			connections[i]->send(std::move(packet));
+		} else {
+			connections[i]->send(OutboundNetworkPacket(packet));
+		}
 	}
 }
 
@@ -279,6 +320,9 @@ void NetworkSession::processReceive()
 			int peerId = type == NetworkSessionType::Host ? int(i) + 1 : 0;
 			NetworkSessionMessageHeader header;
 			packet.extractHeader(header);
+			if (size_t(header.type) < stats.messageTypes.size()) {
+				stats.messageTypes[size_t(header.type)].onReceived(packet.getSize());
+			}
 
 			if (type == NetworkSessionType::Host) {
 				// Broadcast to other connections
@@ -326,20 +370,13 @@ void NetworkSession::closeConnection(int peerId, const String& reason)
 	connections.at(connId)->close();
 }
 
-void NetworkSession::retransmitControlMessage(int peerId, gsl::span<const gsl::byte> bytes)
-{
-	NetworkSessionMessageHeader header;
-	header.type = NetworkSessionMessageType::Control;
-	header.srcPeerId = peerId;
-	sendToAll(makeOutbound(bytes, header), peerId);
-}
-
 void NetworkSession::receiveControlMessage(int peerId, InboundNetworkPacket& packet)
 {
-	auto origData = packet.getBytes();
-
 	ControlMsgHeader header;
 	packet.extractHeader(header);
+	if (size_t(header.type) < stats.controlMessages.size()) {
+		stats.controlMessages[size_t(header.type)].onReceived(packet.getSize());
+	}
 
 	switch (header.type) {
 	case NetworkSessionControlMessageType::SetPeerId:
@@ -358,7 +395,12 @@ void NetworkSession::receiveControlMessage(int peerId, InboundNetworkPacket& pac
 		{
 			ControlMsgSetPeerState msg = Deserializer::fromBytes<ControlMsgSetPeerState>(packet.getBytes());
 			onControlMessage(peerId, msg);
-			retransmitControlMessage(peerId, origData);
+		}
+		break;
+	case NetworkSessionControlMessageType::AckState:
+		{
+			ControlMsgAckState msg = Deserializer::fromBytes<ControlMsgAckState>(packet.getBytes());
+			onControlMessage(peerId, msg);
 		}
 		break;
 	default:
@@ -378,29 +420,54 @@ void NetworkSession::onControlMessage(int peerId, const ControlMsgSetPeerState&
 {
 	if (peerId != 0 && peerId != msg.peerId) {
 		closeConnection(peerId, "Unauthorised control message: SetPeerState");
+		return;
 	}
-	auto iter = sharedData.find(msg.peerId);
 
-	auto s = Deserializer(msg.state);
-	if (iter != sharedData.end()) {
-		iter->second->deserialize(s);
-	} else {
-		sharedData[msg.peerId] = makePeerSharedData();
-		sharedData[msg.peerId]->deserialize(s);
+	if (isNewStateVersion(msg.peerId, msg.version)) {
+		auto& data = sharedData[msg.peerId];
+		if (!data) {
+			data = makePeerSharedData();
+		}
+
+		auto s = Deserializer(msg.state, getStateSerializerOptions());
+		const uint64_t fields = data->deserializeDelta(s);
+		if (type == NetworkSessionType::Host) {
+			// Relay to the other peers
+			data->markFieldsModified(fields);
+		}
 	}
+	sendStateAck(peerId, msg.peerId, msg.version);
 }
 
 void NetworkSession::onControlMessage(int peerId, const ControlMsgSetSessionState& msg)
 {
 	if (peerId != 0) {
 		closeConnection(peerId, "Unauthorised control message: SetSessionState");
+		return;
+	}
+
+	if (isNewStateVersion(-1, msg.version)) {
+		if (!sessionSharedData) {
+			sessionSharedData = makeSessionSharedData();
+		}
+		auto s = Deserializer(msg.state, getStateSerializerOptions());
+		sessionSharedData->deserializeDelta(s);
 	}
+	sendStateAck(peerId, -1, msg.version);
+}
 
-	if (!sessionSharedData) {
-		sessionSharedData = makeSessionSharedData();
+void NetworkSession::onControlMessage(int peerId, const ControlMsgAckState& msg)
+{
+	auto iter = replication.find(msg.ownerId);
+	if (iter == replication.end() || msg.version > iter->second.version) {
+		return;
+	}
+
+	auto& peer = iter->second.peers[peerId];
+	if (!peer.acked || msg.version > peer.ackedVersion) {
+		peer.acked = true;
+		peer.ackedVersion = msg.version;
 	}
-	auto s = Deserializer(msg.state);
-	sessionSharedData->deserialize(s);
 }
 
 void NetworkSession::setMyPeerId(int id)
@@ -412,32 +479,101 @@ void NetworkSession::setMyPeerId(int id)
 	onPeerIdAssigned();
 }
 
+SharedData& NetworkSession::getSharedData(int ownerId)
+{
+	return ownerId == -1 ? *sessionSharedData : *sharedData.at(ownerId);
+}
+
 void NetworkSession::checkForOutboundStateChanges(int ownerId)
 {
-	SharedData& data = ownerId == -1 ? *sessionSharedData : *sharedData.at(ownerId);
+	SharedData& data = getSharedData(ownerId);
+	auto& rep = replication[ownerId];
 	if (data.isModified()) {
-		sendToAll(makeUpdateSharedDataPacket(ownerId));
+		++rep.version;
+		rep.changes[rep.version % SharedDataReplication::historySize] = data.getModifiedFields();
 		data.markUnmodified();
 	}
+
+	// Send each peer what changed since the last version it acked, re-sending periodically until it does
+	const auto now = Clock::now();
+	for (size_t i = 0; i < connections.size(); ++i) {
+		const int peerId = type == NetworkSessionType::Host ? int(i) + 1 : 0;
+		if (peerId == ownerId) {
+			continue;
+		}
+
+		auto& peer = rep.peers[peerId];
+		if (peer.acked && peer.ackedVersion == rep.version) {
+			continue;
+		}
+		if (peer.sent && peer.sentVersion == rep.version && now - peer.lastSent < stateResendInterval) {
+			continue;
+		}
+
+		connections[i]->send(makeUpdateSharedDataPacket(ownerId, rep.getChangesSince(peer), rep.version));
+		peer.sent = true;
+		peer.sentVersion = rep.version;
+		peer.lastSent = now;
+	}
 }
 
-OutboundNetworkPacket NetworkSession::makeUpdateSharedDataPacket(int ownerId)
+uint64_t NetworkSession::SharedDataReplication::getChangesSince(const PeerReplicationState& peer) const
 {
-	SharedData& data = ownerId == -1 ? *sessionSharedData : *sharedData.at(ownerId);
+	if (!peer.acked || version - peer.ackedVersion >= historySize) {
+		return ~uint64_t(0);
+	}
+
+	uint64_t result = 0;
+	for (uint32_t v = peer.ackedVersion + 1; v <= version; ++v) {
+		result |= changes[v % historySize];
+	}
+	return result;
+}
+
+OutboundNetworkPacket NetworkSession::makeUpdateSharedDataPacket(int ownerId, uint64_t fields, uint32_t version)
+{
+	SharedDataDelta delta{ getSharedData(ownerId), fields };
 	if (ownerId == -1) {
 		ControlMsgSetSessionState state;
-		state.state = Serializer::toBytes(data);
+		state.version = version;
+		state.state = Serializer::toBytes(delta, getStateSerializerOptions());
 		Bytes bytes = Serializer::toBytes(state);
 		return doMakeControlPacket(NetworkSessionControlMessageType::SetSessionState, OutboundNetworkPacket(bytes));
 	} else {
 		ControlMsgSetPeerState state;
 		state.peerId = ownerId;
-		state.state = Serializer::toBytes(data);
+		state.version = version;
+		state.state = Serializer::toBytes(delta, getStateSerializerOptions());
 		Bytes bytes = Serializer::toBytes(state);
 		return doMakeControlPacket(NetworkSessionControlMessageType::SetPeerState, OutboundNetworkPacket(bytes));
 	}
 }
 
+bool NetworkSession::isNewStateVersion(int ownerId, uint32_t version)
+{
+	// Deltas carry the latest values of their fields, so one that arrives after a newer one must be dropped
+	auto iter = receivedStateVersions.find(ownerId);
+	if (iter != receivedStateVersions.end() && version <= iter->second) {
+		return false;
+	}
+	receivedStateVersions[ownerId] = version;
+	return true;
+}
+
+void NetworkSession::sendStateAck(int peerId, int ownerId, uint32_t version)
+{
+	const size_t connId = size_t(type == NetworkSessionType::Host ? peerId - 1 : 0);
+	if (connId >= connections.size()) {
+		return;
+	}
+
+	ControlMsgAckState msg;
+	msg.ownerId = int8_t(ownerId);
+	msg.version = version;
+	Bytes bytes = Serializer::toBytes(msg);
+	connections[connId]->send(doMakeControlPacket(NetworkSessionControlMessageType::AckState, OutboundNetworkPacket(bytes)));
+}
+
 OutboundNetworkPacket NetworkSession::doMakeControlPacket(NetworkSessionControlMessageType msgType, OutboundNetworkPacket&& packet)
 {
 	ControlMsgHeader ctrlHeader;
@@ -449,5 +585,9 @@ OutboundNetworkPacket NetworkSession::doMakeControlPacket(NetworkSessionControlM
 	header.srcPeerId = myPeerId;
 	packet.addHeader(header);
 
+	// Each control packet goes to a single connection
+	stats.controlMessages[size_t(msgType)].onSent(packet.getSize());
+	stats.messageTypes[int(NetworkSessionMessageType::Control)].onSent(packet.getSize());
+
 	return packet;
 }
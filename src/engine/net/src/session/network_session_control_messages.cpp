@@ -13,22 +13,38 @@ void ControlMsgSetPeerId::deserialize(Deserializer& s)
 
 void ControlMsgSetSessionState::serialize(Serializer& s) const
 {
+	s << version;
 	s << state;
 }
 
 void ControlMsgSetSessionState::deserialize(Deserializer& s)
 {
+	s >> version;
 	s >> state;
 }
 
 void ControlMsgSetPeerState::serialize(Serializer& s) const
 {
 	s << peerId;
+	s << version;
 	s << state;
 }
 
 void ControlMsgSetPeerState::deserialize(Deserializer& s)
 {
 	s >> peerId;
+	s >> version;
 	s >> state;
 }
+
+void ControlMsgAckState::serialize(Serializer& s) const
+{
+	s << ownerId;
+	s << version;
+}
+
+void ControlMsgAckState::deserialize(Deserializer& s)
+{
+	s >> ownerId;
+	s >> version;
+}
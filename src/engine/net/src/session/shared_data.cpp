@@ -1,17 +1,96 @@
 #include "session/shared_data.h"
+#include "halley/bytes/byte_serializer.h"
+#include "halley/support/exception.h"
 using namespace Halley;
 
 void SharedData::markModified()
 {
-	modified = true;
+	modifiedFields = getAllFields();
+}
+
+void SharedData::markFieldModified(int field)
+{
+	Expects(field >= 0 && field < getFieldCount());
+	modifiedFields |= uint64_t(1) << field;
+}
+
+void SharedData::markFieldsModified(uint64_t fields)
+{
+	modifiedFields |= fields & getAllFields();
 }
 
 void SharedData::markUnmodified()
 {
-	modified = false;
+	modifiedFields = 0;
 }
 
 bool SharedData::isModified() const
 {
-	return modified;
+	return modifiedFields != 0;
+}
+
+uint64_t SharedData::getModifiedFields() const
+{
+	return modifiedFields;
+}
+
+int SharedData::getFieldCount() const
+{
+	return 0;
+}
+
+void SharedData::serializeField(Serializer& s, int field) const
+{
+	throw Exception("SharedData doesn't implement field serialization.", HalleyExceptions::Network);
+}
+
+void SharedData::deserializeField(Deserializer& s, int field)
+{
+	throw Exception("SharedData doesn't implement field deserialization.", HalleyExceptions::Network);
+}
+
+void SharedData::serializeDelta(Serializer& s, uint64_t fields) const
+{
+	const int nFields = getFieldCount();
+	fields &= getAllFields();
+	s << fields;
+
+	if (nFields == 0) {
+		serialize(s);
+	} else {
+		for (int i = 0; i < nFields; ++i) {
+			if (fields & (uint64_t(1) << i)) {
+				serializeField(s, i);
+			}
+		}
+	}
+}
+
+uint64_t SharedData::deserializeDelta(Deserializer& s)
+{
+	const int nFields = getFieldCount();
+	uint64_t fields;
+	s >> fields;
+	fields &= getAllFields();
+
+	if (nFields == 0) {
+		deserialize(s);
+	} else {
+		for (int i = 0; i < nFields; ++i) {
+			if (fields & (uint64_t(1) << i)) {
+				deserializeField(s, i);
+			}
+		}
+	}
+	return fields;
+}
+
+uint64_t SharedData::getAllFields() const
+{
+	const int nFields = getFieldCount();
+	Expects(nFields >= 0 && nFields <= 64);
+	if (nFields == 0 || nFields == 64) {
+		return ~uint64_t(0);
+	}
+	return (uint64_t(1) << nFields) - 1;
 }
@@ -12,6 +12,7 @@ namespace Halley {} // Get GitHub to realise this is C++ :3
 #include "ui_input.h"
 #include "ui_root.h"
 #include "ui_sizer.h"
+#include "ui_stats.h"
 #include "ui_style.h"
 #include "ui_stylesheet.h"
 #include "ui_validator.h"
@@ -7,6 +7,8 @@ namespace Halley {
 	class UIWidget;
 	class String;
 
+	// Bound values are pushed: setValue only records the change, and the widget reads it on its next update, so a value
+	// that changes many times in a frame (or not at all) costs at most one refresh of the widget.
 	class UIDataBind {
 		friend class UIWidget;
 
@@ -27,6 +29,7 @@ namespace Halley {
 		virtual String getStringData();
 
 		void pushData();
+		int getVersion() const;
 
 		virtual Format getFormat() const = 0;
 
@@ -37,10 +40,12 @@ namespace Halley {
 		virtual void onDataFromWidget(const String& data);
 
 		bool canWriteData() const;
+		void notifyChanged();
 
 	private:
 		UIWidget* widgetBound = nullptr;
 		bool acceptingData = false;
+		int version = 0;
 
 		void setWidget(UIWidget* widget);
 		void setAcceptingDataFromWidget(bool accepting);
@@ -52,6 +57,8 @@ namespace Halley {
 
 		UIDataBindBool(bool initialValue, WriteCallback writeCallback);
 
+		void setValue(bool value);
+
 		bool getBoolData() override;
 		int getIntData() override;
 		float getFloatData() override;
@@ -66,8 +73,10 @@ namespace Halley {
 		void onDataFromWidget(const String& data) override;
 
 	private:
-		int initialValue;
+		bool value;
 		WriteCallback writeCallback;
+
+		void write(bool data);
 	};
 
 	class UIDataBindInt : public UIDataBind {
@@ -76,6 +85,8 @@ namespace Halley {
 
 		UIDataBindInt(int initialValue, WriteCallback writeCallback);
 
+		void setValue(int value);
+
 		int getIntData() override;
 		float getFloatData() override;
 		String getStringData() override;
@@ -89,8 +100,10 @@ namespace Halley {
 		void onDataFromWidget(const String& data) override;
 
 	private:
-		int initialValue;
+		int value;
 		WriteCallback writeCallback;
+
+		void write(int data);
 	};
 
 	class UIDataBindFloat : public UIDataBind {
@@ -99,6 +112,8 @@ namespace Halley {
 
 		UIDataBindFloat(float initialValue, WriteCallback writeCallback);
 
+		void setValue(float value);
+
 		int getIntData() override;
 		float getFloatData() override;
 		String getStringData() override;
@@ -112,8 +127,10 @@ namespace Halley {
 		void onDataFromWidget(const String& data) override;
 
 	private:
-		float initialValue;
+		float value;
 		WriteCallback writeCallback;
+
+		void write(float data);
 	};
 
 	class UIDataBindString : public UIDataBind {
@@ -122,6 +139,8 @@ namespace Halley {
 
 		UIDataBindString(String initialValue, WriteCallback writeCallback);
 
+		void setValue(const String& value);
+
 		bool getBoolData() override;
 		int getIntData() override;
 		float getFloatData() override;
@@ -136,7 +155,9 @@ namespace Halley {
 		void onDataFromWidget(const String& data) override;
 
 	private:
-		String initialValue;
+		String value;
 		WriteCallback writeCallback;
+
+		void write(String data);
 	};
 }
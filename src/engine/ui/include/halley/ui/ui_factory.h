@@ -7,6 +7,8 @@
 #include <functional>
 #include "ui_input.h"
 #include "halley/text/i18n.h"
+#include "halley/file_formats/config_file.h"
+#include "halley/data_structures/hash_map.h"
 
 namespace Halley
 {
@@ -64,6 +66,7 @@ namespace Halley
 		Maybe<UISizer> makeSizer(const ConfigNode& node);
 		UISizer makeSizerOrDefault(const ConfigNode& node, UISizer&& defaultSizer);
 		void loadSizerChildren(UISizer& sizer, const ConfigNode& node);
+		std::shared_ptr<UIWidget> makeWidget(const ConfigNode& node, const WidgetFactory* factory);
 
 		static Maybe<Vector2f> asMaybeVector2f(const ConfigNode& node);
 		static Vector2f asVector2f(const ConfigNode& node, Maybe<Vector2f> defaultValue);
@@ -98,11 +101,56 @@ namespace Halley
 		bool resolveConditions(const ConfigNode& node) const;
 
 	private:
+		enum class SizerEntryType {
+			None,
+			Widget,
+			Sizer,
+			Spacer,
+			StretchSpacer
+		};
+
+		struct SizerEntryPlan {
+			const ConfigNode* node;
+			SizerEntryType type;
+			float proportion;
+			Vector4f border;
+			int fill;
+			const WidgetFactory* factory;
+		};
+
+		// Everything makeSizer reads from a node, so instances of the same UI file don't parse it again
+		struct SizerPlan {
+			bool exists = false;
+			bool hasSizer = false;
+			UISizerType type = UISizerType::Horizontal;
+			float gap = 1.0f;
+			int columns = 1;
+			std::vector<SizerEntryPlan> entries;
+		};
+
+		// The plans for a UI file, keyed by node address, which holds until the file is reloaded. Only nodes reached
+		// through the file's own children are registered, so a node from anywhere else is never mistaken for one.
+		struct Prototype {
+			std::shared_ptr<const ConfigFile> file;
+			ConfigObserver observer;
+			HashMap<const ConfigNode*, std::unique_ptr<SizerPlan>> sizers;
+		};
+
 		std::shared_ptr<UIStyleSheet> styleSheet;
 		std::vector<String> conditions;
 		std::vector<size_t> conditionStack;
 
 		std::map<String, WidgetFactory> factories;
 		std::map<String, UIInputButtons> inputButtons;
+
+		std::map<String, Prototype> prototypes;
+		Prototype* curPrototype = nullptr;
+
+		Prototype& getPrototype(const String& configName);
+		std::shared_ptr<UIWidget> makeWidgetFromPrototype(Prototype* prototype, const ConfigNode& node);
+		const SizerPlan& getSizerPlan(const ConfigNode& node, SizerPlan& scratch);
+		SizerPlan makeSizerPlan(const ConfigNode& node) const;
+		void makeSizerEntryPlans(const ConfigNode& node, std::vector<SizerEntryPlan>& entries) const;
+		void loadSizerChildren(UISizer& sizer, const std::vector<SizerEntryPlan>& entries);
 	};
 }
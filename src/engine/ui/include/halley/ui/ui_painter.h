@@ -1,12 +1,39 @@
 #pragma once
 #include "halley/maths/rect.h"
 #include "halley/data_structures/maybe.h"
+#include "halley/core/graphics/sprite/sprite.h"
+#include "halley/core/graphics/text/text_renderer.h"
+#include <vector>
 
 namespace Halley {
-	class TextRenderer;
-	class Sprite;
 	class SpritePainter;
 
+	// Copies of what a widget subtree drew, so it can be drawn again without going through the widgets (see UIWidget::setDrawCached)
+	class UIDrawCache {
+		friend class UIPainter;
+
+	public:
+		bool isValid() const;
+		void invalidate();
+
+	private:
+		struct Entry {
+			size_t index;
+			int mask;
+			int layer; // Relative to the painter it was recorded with
+			bool text;
+		};
+
+		std::vector<Entry> entries;
+		std::vector<Sprite> sprites;
+		std::vector<TextRenderer> texts;
+
+		Maybe<Rect4f> clip;
+		int mask = 0;
+		int layer = 0;
+		bool valid = false;
+	};
+
 	class UIPainter {
 	public:
 		UIPainter(SpritePainter& painter, int mask, int layer);
@@ -14,11 +41,21 @@ namespace Halley {
 		void draw(const Sprite& sprite, bool forceCopy = false);
 		void draw(const TextRenderer& text, bool forceCopy = false);
 
+		// Submits a recording by reference, so nothing is copied. Needs canDraw(cache).
+		void draw(const UIDrawCache& cache);
+		bool canDraw(const UIDrawCache& cache) const;
+
 		UIPainter clone();
 		UIPainter withAdjustedLayer(int delta);
 		UIPainter withClip(Maybe<Rect4f> clip);
 		UIPainter withMask(int mask);
 
+		// Everything drawn with the returned painter, and the painters derived from it, is recorded into cache instead of drawn
+		UIPainter withRecording(UIDrawCache& cache);
+
+		// Entries submitted to the SpritePainter so far, by this painter and the ones derived from it
+		int getEntriesDrawn() const;
+
 	private:
 		SpritePainter& painter;
 		Maybe<Rect4f> clip;
@@ -26,7 +63,11 @@ namespace Halley {
 		int layer;
 		int n;
 		UIPainter* parent = nullptr;
+		UIDrawCache* recording = nullptr;
 
 		float getCurrentPriority();
+		void submit(const Sprite& sprite, bool copy);
+		void submit(Sprite&& sprite);
+		void submit(const TextRenderer& text, bool copy);
 	};
 }
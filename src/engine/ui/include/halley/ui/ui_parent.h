@@ -2,6 +2,7 @@
 #include <memory>
 #include <vector>
 #include "halley/text/halleystring.h"
+#include "halley/text/string_id.h"
 #include "halley/maths/rect.h"
 
 namespace Halley {
@@ -29,12 +30,17 @@ namespace Halley {
 		bool isWaitingToSpawnChildren() const;
 
 		virtual void markAsNeedingLayout();
+		virtual void invalidateDraw();
 
 		std::vector<std::shared_ptr<UIWidget>>& getChildren();
 		const std::vector<std::shared_ptr<UIWidget>>& getChildren() const;
 
 		std::shared_ptr<UIWidget> getWidget(const String& id);
 		std::shared_ptr<UIWidget> tryGetWidget(const String& id);
+
+		// Faster versions, comparing interned ids instead of strings
+		std::shared_ptr<UIWidget> getWidget(StringId id);
+		std::shared_ptr<UIWidget> tryGetWidget(StringId id);
 		
 		template <typename T>
 		std::shared_ptr<T> tryGetWidgetAs(const String& id)
@@ -42,10 +48,36 @@ namespace Halley {
 			return std::dynamic_pointer_cast<T>(tryGetWidget(id));
 		}
 
+		template <typename T>
+		std::shared_ptr<T> tryGetWidgetAs(StringId id)
+		{
+			return std::dynamic_pointer_cast<T>(tryGetWidget(id));
+		}
+
 		template <typename T>
 		std::shared_ptr<T> getWidgetAs(const String& id)
 		{
-			auto widget = getWidget(id);
+			return castWidget<T>(getWidget(id), id);
+		}
+
+		template <typename T>
+		std::shared_ptr<T> getWidgetAs(StringId id)
+		{
+			return castWidget<T>(getWidget(id), id.getString());
+		}
+
+		virtual bool isDescendentOf(const UIWidget& ancestor) const;
+		
+	private:
+		std::vector<std::shared_ptr<UIWidget>> children;
+		std::vector<std::shared_ptr<UIWidget>> childrenWaiting;
+
+		std::shared_ptr<UIWidget> doGetWidget(const String& id) const;
+		std::shared_ptr<UIWidget> doGetWidget(StringId id) const;
+
+		template <typename T>
+		static std::shared_ptr<T> castWidget(std::shared_ptr<UIWidget> widget, const String& id)
+		{
 			if (widget) {
 				auto w = std::dynamic_pointer_cast<T>(widget);
 				if (!w) {
@@ -56,13 +88,5 @@ namespace Halley {
 				return {};
 			}
 		}
-
-		virtual bool isDescendentOf(const UIWidget& ancestor) const;
-		
-	private:
-		std::vector<std::shared_ptr<UIWidget>> children;
-		std::vector<std::shared_ptr<UIWidget>> childrenWaiting;
-
-		std::shared_ptr<UIWidget> doGetWidget(const String& id) const;
 	};
 }
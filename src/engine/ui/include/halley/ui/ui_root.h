@@ -6,6 +6,8 @@
 #include "ui_parent.h"
 #include "ui_input.h"
 #include "halley/core/api/audio_api.h"
+#include "halley/data_structures/frame_arena.h"
+#include "ui_stats.h"
 
 namespace Halley {
 	class SpritePainter;
@@ -20,6 +22,8 @@ namespace Halley {
 	};
 	
 	class UIRoot : public UIParent {
+		friend class UIWidget;
+
 	public:
 		explicit UIRoot(AudioAPI* audio, Rect4f rect = {});
 
@@ -37,6 +41,7 @@ namespace Halley {
 		
 		Maybe<AudioHandle> playSound(const String& eventName);
 		void sendEvent(UIEvent&& event) const override;
+		void markAsNeedingLayout() override;
 
 		bool hasModalUI() const;
 		bool isMouseOverUI() const;
@@ -49,9 +54,26 @@ namespace Halley {
 		void setUIMouseRemapping(std::function<Vector2f(Vector2f)> remapFunction);
 		void unsetUIMouseRemapping();
 
-		std::vector<std::shared_ptr<UIWidget>> collectWidgets();
+		FrameVector<std::shared_ptr<UIWidget>> collectWidgets();
+
+		// Costs a walk of the whole tree per layout pass, so only meant for debugging (see UIStatsView)
+		void setProfiling(bool enabled);
+		bool isProfiling() const;
+		const UIStats& getStats() const;
+		void addTextLayoutStat();
 
 	private:
+		struct MouseTarget {
+			UIWidget* widget;
+			Rect4f rect;
+			bool enabled;
+		};
+
+		struct InputTarget {
+			UIWidget* widget;
+			bool accepting;
+		};
+
 		String id;
 		std::weak_ptr<UIWidget> currentMouseOver;
 		std::weak_ptr<UIWidget> currentFocus;
@@ -65,13 +87,33 @@ namespace Halley {
 
 		std::function<Vector2f(Vector2f)> mouseRemap;
 
+		bool profiling = false;
+		UIStats stats;
+
+		// Flattened view of the widgets that take input, rebuilt only when something in the tree changed, so that finding
+		// what's under the mouse doesn't have to walk every widget every frame. Mouse targets are kept in the order the
+		// tree would be searched in, and bucketed into a grid over their mouse rects.
+		mutable bool inputIndexDirty = true;
+		mutable std::vector<MouseTarget> mouseTargets;
+		mutable std::vector<InputTarget> inputTargets;
+		mutable Vector2f mouseGridOrigin;
+		mutable Vector2i mouseGridSize;
+		mutable float mouseGridCellSize = 1.0f;
+		mutable std::vector<uint32_t> mouseGridCellStart;
+		mutable std::vector<uint32_t> mouseGridEntries;
+
 		void updateMouse(spInputDevice mouse);
-		void updateInputTree(const spInputDevice& input, UIWidget& c, std::vector<UIWidget*>& inputTargets, UIInput::Priority& bestPriority, bool accepting);
 		void updateInput(spInputDevice input);
 
+		void invalidateInputIndex();
+		void updateInputIndex() const;
+		void collectMouseTargets(UIWidget& widget, bool enabled) const;
+		void collectInputTargets(UIWidget& widget, bool accepting) const;
+		void buildMouseGrid() const;
+
 		std::shared_ptr<UIWidget> getWidgetUnderMouse(Vector2f mousePos, bool includeDisabled = false) const;
-		std::shared_ptr<UIWidget> getWidgetUnderMouse(const std::shared_ptr<UIWidget>& start, Vector2f mousePos, bool includeDisabled = false) const;
 		void updateMouseOver(const std::shared_ptr<UIWidget>& underMouse);
-		void collectWidgets(const std::shared_ptr<UIWidget>& start, std::vector<std::shared_ptr<UIWidget>>& output);
+		void collectWidgets(const std::shared_ptr<UIWidget>& start, FrameVector<std::shared_ptr<UIWidget>>& output);
+		void collectLayoutStats(UIWidget& widget, std::vector<UIWidget*>& relayoutSources);
 	};
 }
@@ -0,0 +1,53 @@
+#pragma once
+#include "halley/core/graphics/text/text_renderer.h"
+#include "halley/core/graphics/sprite/sprite.h"
+#include "halley/maths/rect.h"
+#include <cstdint>
+#include <vector>
+
+namespace Halley
+{
+	class Resources;
+	class RenderContext;
+	class Painter;
+	class UIRoot;
+
+	// What a UIRoot did in its last frame, collected while UIRoot::setProfiling is on
+	struct UIStats
+	{
+		int widgets = 0;
+		int activeWidgets = 0;
+
+		int layoutPasses = 0;
+		int widgetsMeasured = 0; // Had their minimum size recomputed
+		int widgetsPlaced = 0;
+		int textLayouts = 0;
+
+		int drawEntries = 0; // Sprites and texts handed over to the SpritePainter
+
+		int64_t updateNs = 0; // Including layout
+		int64_t layoutNs = 0;
+		int64_t drawNs = 0;
+
+		std::vector<Rect4f> relayoutRects; // The widgets that asked for a layout, i.e. the deepest ones marked as needing it
+	};
+
+	// Overlay showing a UIRoot's stats, with the subtrees that were laid out outlined.
+	// Needs to be drawn with the same camera as the UI itself for the outlines to line up.
+	class UIStatsView
+	{
+	public:
+		UIStatsView(Resources& resources);
+
+		void draw(RenderContext& context);
+		void setRoot(UIRoot* root);
+
+	private:
+		String formatTime(int64_t ns) const;
+		void drawOutline(Painter& painter, Rect4f rect);
+
+		UIRoot* root = nullptr;
+		TextRenderer text;
+		Sprite box;
+	};
+}
@@ -2,7 +2,8 @@
 
 #include "halley/core/graphics/sprite/sprite.h"
 #include "halley/core/graphics/text/text_renderer.h"
-#include "halley/data_structures/flat_map.h"
+#include "halley/data_structures/hash_map.h"
+#include "halley/file_formats/config_file.h"
 #include <map>
 
 namespace Halley {
@@ -12,6 +13,8 @@ namespace Halley {
 	class AudioClip;
 	class UISTyle;
 
+	// Each property is parsed from the config the first time it's asked for and kept from then on, and so is the
+	// default handed out for a missing one, so neither costs more than a hash lookup after that.
 	class UIStyleDefinition
 	{
 	public:
@@ -25,17 +28,33 @@ namespace Halley {
 		float getFloat(const String& name) const;
 		std::shared_ptr<const UIStyleDefinition> getSubStyle(const String& name) const;
 
+		// Takes new values from node in place, so every UIStyle already pointing at this (or its sub-styles) sees them
+		void reload(const ConfigNode& node);
+
 	private:
+		template <typename T>
+		struct Properties
+		{
+			HashMap<String, T> values;
+			T defaultValue;
+
+			explicit Properties(T defaultValue = T()) : defaultValue(std::move(defaultValue)) {}
+		};
+
 		const String styleName;
-		const ConfigNode& node;
+		ConfigNode node;
 		Resources& resources;
 
-		mutable FlatMap<String, Sprite> sprites;
-		mutable FlatMap<String, TextRenderer> textRenderers;
-		mutable FlatMap<String, Vector4f> borders;
-		mutable FlatMap<String, String> strings;
-		mutable FlatMap<String, float> floats;
-		mutable FlatMap<String, std::shared_ptr<const UIStyleDefinition>> subStyles;
+		mutable Properties<Sprite> sprites;
+		mutable Properties<TextRenderer> textRenderers;
+		mutable Properties<Vector4f> borders;
+		mutable Properties<String> strings;
+		mutable Properties<float> floats;
+		mutable Properties<std::shared_ptr<UIStyleDefinition>> subStyles;
+		mutable HashMap<String, bool> missing;
+
+		template <typename T>
+		const T& getValue(const String& key, Properties<T>& properties) const;
 	};
 
 	class UIStyleSheet {
@@ -52,7 +71,7 @@ namespace Halley {
 
 	private:
 		Resources& resources;
-		FlatMap<String, std::shared_ptr<UIStyleDefinition>> styles;
+		HashMap<String, std::shared_ptr<UIStyleDefinition>> styles;
 		std::map<String, ConfigObserver> observers;
 
 		void load(const ConfigNode& node);
@@ -63,6 +63,7 @@ namespace Halley {
 
 		void setId(const String& id);
 		const String& getId() const override;
+		StringId getStringId() const { return stringId; }
 
 		Vector2f getPosition() const;
 		virtual Vector2f getLayoutOriginPosition() const;
@@ -119,13 +120,15 @@ namespace Halley {
 		void setDataBind(std::shared_ptr<UIDataBind> dataBind);
 		std::shared_ptr<UIDataBind> getDataBind() const;
 		virtual void readFromDataBind();
-		void bindData(const String& childId, bool initialValue, UIDataBindBool::WriteCallback callback = {});
-		void bindData(const String& childId, int initialValue, UIDataBindInt::WriteCallback callback = {});
-		void bindData(const String& childId, float initialValue, UIDataBindFloat::WriteCallback callback = {});
-		void bindData(const String& childId, const String& initialValue, UIDataBindString::WriteCallback callback = {});
+		// The returned binding can be kept to push new values to the widget with setValue
+		std::shared_ptr<UIDataBindBool> bindData(const String& childId, bool initialValue, UIDataBindBool::WriteCallback callback = {});
+		std::shared_ptr<UIDataBindInt> bindData(const String& childId, int initialValue, UIDataBindInt::WriteCallback callback = {});
+		std::shared_ptr<UIDataBindFloat> bindData(const String& childId, float initialValue, UIDataBindFloat::WriteCallback callback = {});
+		std::shared_ptr<UIDataBindString> bindData(const String& childId, const String& initialValue, UIDataBindString::WriteCallback callback = {});
 		
 		bool isDescendentOf(const UIWidget& ancestor) const override;
 		void setMouseClip(Maybe<Rect4f> mouseClip);
+		const Maybe<Rect4f>& getMouseClip() const;
 
 		virtual void onManualControlCycleValue(int delta);
 		virtual void onManualControlAnalogueAdjustValue(float delta, Time t);
@@ -149,6 +152,13 @@ namespace Halley {
 		bool needsLayout() const;
 		void markAsNeedingLayout() override;
 
+		// Keeps a copy of what this subtree draws and submits that instead while nothing in it changes, which makes
+		// static parts of the UI nearly free to draw. Layout, movement, hover, focus and the state changes of the
+		// standard widgets are picked up; anything else that changes how a widget looks has to call invalidateDraw.
+		void setDrawCached(bool cached);
+		bool isDrawCached() const;
+		void invalidateDraw() override;
+
 	protected:
 		virtual void draw(UIPainter& painter) const;
 		virtual void drawAfterChildren(UIPainter& painter) const;
@@ -183,11 +193,15 @@ namespace Halley {
 		void setParent(UIParent* parent);
 
 		void setWidgetRect(Rect4f rect);
+		void invalidateInputIndex();
+		void drawContents(UIPainter& painter) const;
 		void resetInputResults();
+		void readDataBindChanges();
 		void updateActive(bool wasActiveBefore);
 
 		UIParent* parent = nullptr;
 		String id;
+		StringId stringId;
 
 		std::vector<UIInputType> onlyEnabledWithInputs;
 		std::unique_ptr<UIInputButtons> inputButtons;
@@ -201,14 +215,20 @@ namespace Halley {
 		Vector4f innerBorder;
 		Maybe<UISizer> sizer;
 
+		// Measurement (getLayoutMinimumSize) and placement (setRect) are each only redone when something in the subtree
+		// called markAsNeedingLayout, which marks every ancestor along with it
 		mutable Vector2f layoutSize;
 		mutable int layoutNeeded = 1;
+		bool placementNeeded = true;
+		Vector2f lastLayoutOrigin;
 
 		std::shared_ptr<UIEventHandler> eventHandler;
 		std::shared_ptr<UIValidator> validator;
 		std::shared_ptr<UIDataBind> dataBind;
+		int dataBindVersion = 0;
 		std::unique_ptr<UIAnchor> anchor;
 		std::vector<std::shared_ptr<UIBehaviour>> behaviours;
+		std::unique_ptr<UIDrawCache> drawCache;
 
 		int childLayerAdjustment = 0;
 
@@ -9,6 +9,10 @@ namespace Halley {
 		void addTextItem(const String& id, const LocalisedString& label);
 	    void addDivider();
 
+		// Shows the items from source with a virtual UIList (see UIList::setDataSource), which then also takes mouse and
+		// keyboard input in place of the buttons. Replaces any items added before.
+		void setDataSource(std::shared_ptr<IUIListDataSource> source, Maybe<float> fixedItemSize = {});
+
 		void setInputButtons(const UIInputButtons& button);
 		void setItemEnabled(const String& id, bool enabled);
 
@@ -35,6 +35,7 @@ namespace Halley {
 		
 		void draw(UIPainter& painter) const override;
 		void update(Time t, bool moved) override;
+		void readFromDataBind() override;
 
 		void setMarquee(bool enabled);
 
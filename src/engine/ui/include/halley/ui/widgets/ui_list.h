@@ -10,6 +10,44 @@ namespace Halley {
 	class UIStyle;
 	class UIListItem;
 
+	// Supplies the items of a virtual UIList (see UIList::setDataSource)
+	class IUIListDataSource {
+	public:
+		virtual ~IUIListDataSource() = default;
+
+		virtual size_t getCount() const = 0;
+		virtual String getItemId(size_t index) const = 0;
+
+		// Size along the list's axis of an item that hasn't been created yet.
+		// Items are measured once they're created, so this only needs to be a reasonable guess.
+		virtual float getEstimatedItemSize(size_t index) const = 0;
+
+		// recycled is either empty or something returned earlier for an item that has since gone out of view,
+		// possibly with a different index. Updating and returning it avoids creating new widgets.
+		virtual std::shared_ptr<IUIElement> getItemContents(size_t index, std::shared_ptr<IUIElement> recycled) = 0;
+
+		virtual int getItemFillFlags() const { return UISizerFillFlags::Fill; }
+	};
+
+	// Text labels, as added by UIList::addTextItem
+	class UIListTextSource : public IUIListDataSource {
+	public:
+		UIListTextSource(UIStyle style, std::vector<String> ids, std::vector<LocalisedString> labels, bool centre = false);
+
+		size_t getCount() const override;
+		String getItemId(size_t index) const override;
+		float getEstimatedItemSize(size_t index) const override;
+		std::shared_ptr<IUIElement> getItemContents(size_t index, std::shared_ptr<IUIElement> recycled) override;
+		int getItemFillFlags() const override;
+
+	private:
+		UIStyle style;
+		std::vector<String> ids;
+		std::vector<LocalisedString> labels;
+		bool centre;
+		float estimatedSize;
+	};
+
 	class UIList : public UIWidget {
 		friend class UIListItem;
 
@@ -28,9 +66,19 @@ namespace Halley {
 		void addItem(const String& id, std::shared_ptr<IUIElement> element, float proportion = 0, Vector4f border = {}, int fillFlags = UISizerFillFlags::Fill, Maybe<UIStyle> styleOverride = {});
 		void clear();
 
+		// Only for items added with addItem/addTextItem
 		void setItemEnabled(const String& id, bool enabled);
 		void setItemActive(const String& id, bool active);
 
+		// Takes the items from source instead, and only keeps widgets for the ones in view (e.g. inside a UIScrollPane)
+		// plus a margin, recycling them as they scroll in and out. Without fixedItemSize, items start with the
+		// source's estimated size and are adjusted as they're measured. Not available for grids, or with dragging.
+		void setDataSource(std::shared_ptr<IUIListDataSource> source, Maybe<float> fixedItemSize = {});
+		std::shared_ptr<IUIListDataSource> getDataSource() const;
+
+		// Call when the data source's items change
+		void refreshDataSource();
+
 		Rect4f getOptionRect(int curOption) const;
 
 		void onManualControlCycleValue(int delta) override;
@@ -46,12 +94,21 @@ namespace Halley {
 
 		void setUniformSizedItems(bool enabled);
 
+		Vector2f getLayoutMinimumSize(bool force) const override;
+		void setRect(Rect4f rect) override;
+
 	protected:
 		void draw(UIPainter& painter) const override;
 		void update(Time t, bool moved) override;
 		void onInput(const UIInputResults& input, Time time) override;
 
 	private:
+		struct VirtualItem {
+			size_t index = 0;
+			std::shared_ptr<UIListItem> item;
+			std::shared_ptr<IUIElement> contents;
+		};
+
 		UIStyle style;
 		UISizerType orientation;
 		Sprite sprite;
@@ -65,6 +122,16 @@ namespace Halley {
 		bool manualDragging = false;
 		bool uniformSizedItems = false;
 
+		std::shared_ptr<IUIListDataSource> dataSource;
+		Maybe<float> virtualFixedItemSize;
+		size_t virtualCount = 0;
+		float virtualGap = 0;
+		float virtualCrossSize = 0;
+		std::vector<float> virtualItemSizes;
+		std::vector<float> virtualItemOffsets; // Where each item starts, plus one past the end of the last
+		std::vector<VirtualItem> virtualItems; // In view, sorted by index
+		std::vector<VirtualItem> virtualPool; // Out of view, waiting to be reused
+
 		void onItemClicked(UIListItem& item);
 		void onItemDragged(UIListItem& item, int index, Vector2f pos);
 		void addItem(std::shared_ptr<UIListItem> item);
@@ -72,6 +139,20 @@ namespace Halley {
 		void onCancel();
 		void reassignIds();
 		size_t getNumberOfItems() const;
+		std::shared_ptr<UIListItem> tryGetItem(int n) const;
+		String getOptionId(int n) const;
+
+		void updateVirtualItems();
+		VirtualItem acquireVirtualItem(size_t index);
+		void releaseVirtualItem(VirtualItem item);
+		void placeVirtualItems();
+		void updateVirtualOffsets();
+		int getVirtualAxis() const;
+		float getVirtualItemOffset(size_t index) const;
+		float getVirtualItemSize(size_t index) const;
+		float getVirtualContentsSize() const;
+		size_t getVirtualItemAt(float pos) const;
+		Rect4f getVirtualItemRect(size_t index) const;
 
 		void swapItems(int idxA, int idxB);
 		bool isManualDragging() const;
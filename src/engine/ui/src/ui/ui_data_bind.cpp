@@ -57,6 +57,16 @@ void UIDataBind::pushData()
 	widgetBound->readFromDataBind();
 }
 
+int UIDataBind::getVersion() const
+{
+	return version;
+}
+
+void UIDataBind::notifyChanged()
+{
+	++version;
+}
+
 void UIDataBind::setWidget(UIWidget* widget)
 {
 	Expects((widgetBound == nullptr) ^ (widget == nullptr));
@@ -64,24 +74,41 @@ void UIDataBind::setWidget(UIWidget* widget)
 }
 
 UIDataBindInt::UIDataBindInt(int initialValue, WriteCallback writeCallback)
-	: initialValue(initialValue)
+	: value(initialValue)
 	, writeCallback(writeCallback)
 {
 }
 
+void UIDataBindInt::setValue(int v)
+{
+	if (value != v) {
+		value = v;
+		notifyChanged();
+	}
+}
+
+void UIDataBindInt::write(int data)
+{
+	// The widget is showing this now, so setValue has to compare against it
+	value = data;
+	if (writeCallback) {
+		writeCallback(data);
+	}
+}
+
 int UIDataBindInt::getIntData()
 {
-	return initialValue;
+	return value;
 }
 
 float UIDataBindInt::getFloatData()
 {
-	return float(initialValue);
+	return float(value);
 }
 
 String UIDataBindInt::getStringData()
 {
-	return toString(initialValue);
+	return toString(value);
 }
 
 UIDataBind::Format UIDataBindInt::getFormat() const
@@ -91,15 +118,15 @@ UIDataBind::Format UIDataBindInt::getFormat() const
 
 void UIDataBindInt::onDataFromWidget(bool data)
 {
-	if (canWriteData() && writeCallback) {
-		writeCallback(data ? 1 : 0);
+	if (canWriteData()) {
+		write(data ? 1 : 0);
 	}
 }
 
 void UIDataBindFloat::onDataFromWidget(bool data)
 {
-	if (canWriteData() && writeCallback) {
-		writeCallback(data ? 1.0f : 0.0f);
+	if (canWriteData()) {
+		write(data ? 1.0f : 0.0f);
 	}
 }
 
@@ -109,29 +136,45 @@ void UIDataBind::setAcceptingDataFromWidget(bool accepting)
 }
 
 UIDataBindBool::UIDataBindBool(bool initialValue, WriteCallback writeCallback)
-	: initialValue(initialValue)
+	: value(initialValue)
 	, writeCallback(writeCallback)
 {
 }
 
+void UIDataBindBool::setValue(bool v)
+{
+	if (value != v) {
+		value = v;
+		notifyChanged();
+	}
+}
+
+void UIDataBindBool::write(bool data)
+{
+	value = data;
+	if (writeCallback) {
+		writeCallback(data);
+	}
+}
+
 bool UIDataBindBool::getBoolData()
 {
-	return initialValue;
+	return value;
 }
 
 int UIDataBindBool::getIntData()
 {
-	return initialValue ? 1 : 0;
+	return value ? 1 : 0;
 }
 
 float UIDataBindBool::getFloatData()
 {
-	return initialValue ? 1.0f : 0.0f;
+	return value ? 1.0f : 0.0f;
 }
 
 String UIDataBindBool::getStringData()
 {
-	return initialValue ? "true" : "false";
+	return value ? "true" : "false";
 }
 
 UIDataBind::Format UIDataBindBool::getFormat() const
@@ -141,72 +184,88 @@ UIDataBind::Format UIDataBindBool::getFormat() const
 
 void UIDataBindBool::onDataFromWidget(bool data)
 {
-	if (canWriteData() && writeCallback) {
-		writeCallback(data);
+	if (canWriteData()) {
+		write(data);
 	}
 }
 
 void UIDataBindBool::onDataFromWidget(int data)
 {
-	if (canWriteData() && writeCallback) {
-		writeCallback(data != 0);
+	if (canWriteData()) {
+		write(data != 0);
 	}
 }
 
 void UIDataBindBool::onDataFromWidget(float data)
 {
-	if (canWriteData() && writeCallback) {
-		writeCallback(data != 0);
+	if (canWriteData()) {
+		write(data != 0);
 	}
 }
 
 void UIDataBindBool::onDataFromWidget(const String& data)
 {
-	if (canWriteData() && writeCallback) {
-		writeCallback(data == "true");
+	if (canWriteData()) {
+		write(data == "true");
 	}
 }
 
 void UIDataBindInt::onDataFromWidget(int data)
 {
-	if (canWriteData() && writeCallback) {
-		writeCallback(data);
+	if (canWriteData()) {
+		write(data);
 	}
 }
 
 void UIDataBindInt::onDataFromWidget(float data)
 {
-	if (canWriteData() && writeCallback) {
-		writeCallback(lround(data));
+	if (canWriteData()) {
+		write(lround(data));
 	}
 }
 
 void UIDataBindInt::onDataFromWidget(const String& data)
 {
-	if (canWriteData() && writeCallback) {
-		writeCallback(data.toInteger());
+	if (canWriteData()) {
+		write(data.toInteger());
 	}
 }
 
 UIDataBindFloat::UIDataBindFloat(float initialValue, WriteCallback writeCallback)
-	: initialValue(initialValue)
+	: value(initialValue)
 	, writeCallback(writeCallback)
 {
 }
 
+void UIDataBindFloat::setValue(float v)
+{
+	if (value != v) {
+		value = v;
+		notifyChanged();
+	}
+}
+
+void UIDataBindFloat::write(float data)
+{
+	value = data;
+	if (writeCallback) {
+		writeCallback(data);
+	}
+}
+
 int UIDataBindFloat::getIntData()
 {
-	return lround(initialValue);
+	return lround(value);
 }
 
 float UIDataBindFloat::getFloatData()
 {
-	return initialValue;
+	return value;
 }
 
 String UIDataBindFloat::getStringData()
 {
-	return toString(initialValue);
+	return toString(value);
 }
 
 UIDataBind::Format UIDataBindFloat::getFormat() const
@@ -216,49 +275,65 @@ UIDataBind::Format UIDataBindFloat::getFormat() const
 
 void UIDataBindFloat::onDataFromWidget(int data)
 {
-	if (canWriteData() && writeCallback) {
-		writeCallback(float(data));
+	if (canWriteData()) {
+		write(float(data));
 	}
 }
 
 void UIDataBindFloat::onDataFromWidget(float data)
 {
-	if (canWriteData() && writeCallback) {
-		writeCallback(data);
+	if (canWriteData()) {
+		write(data);
 	}
 }
 
 void UIDataBindFloat::onDataFromWidget(const String& data)
 {
-	if (canWriteData() && writeCallback) {
-		writeCallback(data.toFloat());
+	if (canWriteData()) {
+		write(data.toFloat());
 	}
 }
 
 UIDataBindString::UIDataBindString(String initialValue, WriteCallback writeCallback)
-	: initialValue(std::move(initialValue))
+	: value(std::move(initialValue))
 	, writeCallback(writeCallback)
 {
 }
 
+void UIDataBindString::setValue(const String& v)
+{
+	if (value != v) {
+		value = v;
+		notifyChanged();
+	}
+}
+
+void UIDataBindString::write(String data)
+{
+	value = data;
+	if (writeCallback) {
+		writeCallback(std::move(data));
+	}
+}
+
 bool UIDataBindString::getBoolData()
 {
-	return initialValue == "true";
+	return value == "true";
 }
 
 int UIDataBindString::getIntData()
 {
-	return initialValue.toInteger();
+	return value.toInteger();
 }
 
 float UIDataBindString::getFloatData()
 {
-	return initialValue.toFloat();
+	return value.toFloat();
 }
 
 String UIDataBindString::getStringData()
 {
-	return initialValue;
+	return value;
 }
 
 UIDataBind::Format UIDataBindString::getFormat() const
@@ -268,28 +343,28 @@ UIDataBind::Format UIDataBindString::getFormat() const
 
 void UIDataBindString::onDataFromWidget(bool data)
 {
-	if (canWriteData() && writeCallback) {
-		writeCallback(data ? "true" : "false");
+	if (canWriteData()) {
+		write(data ? "true" : "false");
 	}
 }
 
 void UIDataBindString::onDataFromWidget(int data)
 {
-	if (canWriteData() && writeCallback) {
-		writeCallback(toString(data));
+	if (canWriteData()) {
+		write(toString(data));
 	}
 }
 
 void UIDataBindString::onDataFromWidget(float data)
 {
-	if (canWriteData() && writeCallback) {
-		writeCallback(toString(data));
+	if (canWriteData()) {
+		write(toString(data));
 	}
 }
 
 void UIDataBindString::onDataFromWidget(const String& data)
 {
-	if (canWriteData() && writeCallback) {
-		writeCallback(data);
+	if (canWriteData()) {
+		write(data);
 	}
 }
@@ -87,7 +87,8 @@ void UIFactory::popConditions()
 
 std::shared_ptr<UIWidget> UIFactory::makeUI(const String& configName)
 {
-	return makeUIFromNode(resources.get<ConfigFile>(configName)->getRoot());
+	auto& prototype = getPrototype(configName);
+	return makeWidgetFromPrototype(&prototype, prototype.file->getRoot());
 }
 
 std::shared_ptr<UIWidget> UIFactory::makeUI(const String& configName, std::vector<String> conditions)
@@ -105,7 +106,40 @@ std::shared_ptr<UIWidget> UIFactory::makeUI(const String& configName, std::vecto
 
 std::shared_ptr<UIWidget> UIFactory::makeUIFromNode(const ConfigNode& node)
 {
-	return makeWidget(node);
+	return makeWidgetFromPrototype(nullptr, node);
+}
+
+UIFactory::Prototype& UIFactory::getPrototype(const String& configName)
+{
+	auto iter = prototypes.find(configName);
+	if (iter == prototypes.end()) {
+		auto file = resources.get<ConfigFile>(configName);
+		iter = prototypes.emplace(configName, Prototype{ file, ConfigObserver(*file), {} }).first;
+	} else if (iter->second.observer.needsUpdate()) {
+		// Reloaded, so the nodes have all moved
+		iter->second.observer.update();
+		iter->second.sizers.clear();
+	}
+
+	auto& prototype = iter->second;
+	if (prototype.sizers.empty()) {
+		prototype.sizers[&prototype.file->getRoot()] = {};
+	}
+	return prototype;
+}
+
+std::shared_ptr<UIWidget> UIFactory::makeWidgetFromPrototype(Prototype* prototype, const ConfigNode& node)
+{
+	auto prevPrototype = curPrototype;
+	curPrototype = prototype;
+	try {
+		auto result = makeWidget(node);
+		curPrototype = prevPrototype;
+		return result;
+	} catch (...) {
+		curPrototype = prevPrototype;
+		throw;
+	}
 }
 
 void UIFactory::setInputButtons(const String& key, UIInputButtons buttons)
@@ -124,15 +158,23 @@ std::shared_ptr<UIStyleSheet> UIFactory::getStyleSheet() const
 }
 
 std::shared_ptr<UIWidget> UIFactory::makeWidget(const ConfigNode& entryNode)
+{
+	return makeWidget(entryNode, nullptr);
+}
+
+std::shared_ptr<UIWidget> UIFactory::makeWidget(const ConfigNode& entryNode, const WidgetFactory* factory)
 {
 	auto& widgetNode = entryNode["widget"];
-	auto widgetClass = widgetNode["class"].asString();
-	auto iter = factories.find(widgetClass);
-	if (iter == factories.end()) {
-		throw Exception("Unknown widget class: " + widgetClass, HalleyExceptions::UI);
+	if (!factory) {
+		auto widgetClass = widgetNode["class"].asString();
+		auto iter = factories.find(widgetClass);
+		if (iter == factories.end()) {
+			throw Exception("Unknown widget class: " + widgetClass, HalleyExceptions::UI);
+		}
+		factory = &iter->second;
 	}
 	
-	auto widget = iter->second(entryNode);
+	auto widget = (*factory)(entryNode);
 	if (widgetNode.hasKey("size")) {
 		widget->setMinSize(asVector2f(widgetNode["size"], {}));
 	}
@@ -145,31 +187,70 @@ std::shared_ptr<UIWidget> UIFactory::makeWidget(const ConfigNode& entryNode)
 	if (widgetNode.hasKey("childLayerAdjustment")) {
 		widget->setChildLayerAdjustment(widgetNode["childLayerAdjustment"].asInt());
 	}
+	if (widgetNode.hasKey("drawCached")) {
+		widget->setDrawCached(widgetNode["drawCached"].asBool(false));
+	}
 	return widget;
 }
 
 Maybe<UISizer> UIFactory::makeSizer(const ConfigNode& entryNode)
 {
+	SizerPlan scratch;
+	const auto& plan = getSizerPlan(entryNode, scratch);
+	if (!plan.exists) {
+		return {};
+	}
+
+	UISizer sizer;
+	if (plan.hasSizer) {
+		sizer = UISizer(plan.type, plan.gap, plan.columns);
+	}
+	loadSizerChildren(sizer, plan.entries);
+
+	return std::move(sizer);
+}
+
+const UIFactory::SizerPlan& UIFactory::getSizerPlan(const ConfigNode& node, SizerPlan& scratch)
+{
+	if (curPrototype) {
+		auto iter = curPrototype->sizers.find(&node);
+		if (iter != curPrototype->sizers.end()) {
+			if (!iter->second) {
+				iter->second = std::make_unique<SizerPlan>(makeSizerPlan(node));
+				for (auto& e: iter->second->entries) {
+					if (e.type == SizerEntryType::Widget || e.type == SizerEntryType::Sizer) {
+						curPrototype->sizers[e.node];
+					}
+				}
+			}
+			return *iter->second;
+		}
+	}
+
+	scratch = makeSizerPlan(node);
+	return scratch;
+}
+
+UIFactory::SizerPlan UIFactory::makeSizerPlan(const ConfigNode& entryNode) const
+{
+	SizerPlan plan;
 	const bool hasSizer = entryNode.hasKey("sizer");
 	const bool hasChildren = entryNode.hasKey("children");
 	if (!hasSizer && !hasChildren) {
-		return {};
+		return plan;
 	}
 
-	UISizer sizer;
-	
+	plan.exists = true;
 	if (hasSizer) {
 		auto& sizerNode = entryNode["sizer"];
-		auto sizerType = fromString<UISizerType>(sizerNode["type"].asString("horizontal"));
-		float gap = sizerNode["gap"].asFloat(1.0f);
-		int nColumns = sizerNode["columns"].asInt(1);
-		
-		sizer = UISizer(sizerType, gap, nColumns);
+		plan.hasSizer = true;
+		plan.type = fromString<UISizerType>(sizerNode["type"].asString("horizontal"));
+		plan.gap = sizerNode["gap"].asFloat(1.0f);
+		plan.columns = sizerNode["columns"].asInt(1);
 	}
 
-	loadSizerChildren(sizer, entryNode["children"]);
-
-	return std::move(sizer);
+	makeSizerEntryPlans(entryNode["children"], plan.entries);
+	return plan;
 }
 
 UISizer UIFactory::makeSizerOrDefault(const ConfigNode& entryNode, UISizer&& defaultSizer)
@@ -193,11 +274,43 @@ std::shared_ptr<UISizer> UIFactory::makeSizerPtr(const ConfigNode& entryNode)
 }
 
 void UIFactory::loadSizerChildren(UISizer& sizer, const ConfigNode& node)
+{
+	std::vector<SizerEntryPlan> entries;
+	makeSizerEntryPlans(node, entries);
+	loadSizerChildren(sizer, entries);
+}
+
+void UIFactory::loadSizerChildren(UISizer& sizer, const std::vector<SizerEntryPlan>& entries)
+{
+	for (auto& e: entries) {
+		switch (e.type) {
+		case SizerEntryType::Widget:
+			sizer.add(makeWidget(*e.node, e.factory), e.proportion, e.border, e.fill);
+			break;
+		case SizerEntryType::Sizer:
+			sizer.add(makeSizerPtr(*e.node), e.proportion, e.border, e.fill);
+			break;
+		case SizerEntryType::Spacer:
+			sizer.addSpacer(e.proportion);
+			break;
+		case SizerEntryType::StretchSpacer:
+			sizer.addStretchSpacer(e.proportion);
+			break;
+		case SizerEntryType::None:
+			break;
+		}
+	}
+}
+
+void UIFactory::makeSizerEntryPlans(const ConfigNode& node, std::vector<SizerEntryPlan>& entries) const
 {
 	if (node.getType() == ConfigNodeType::Sequence) {
 		for (auto& childNode: node.asSequence()) {
-			float proportion = childNode["proportion"].asFloat(0);
-			Vector4f border = asVector4f(childNode["border"], Vector4f());
+			SizerEntryPlan entry;
+			entry.node = &childNode;
+			entry.proportion = childNode["proportion"].asFloat(0);
+			entry.border = asVector4f(childNode["border"], Vector4f());
+			entry.factory = nullptr;
 			int fill = 0;
 
 			auto addFill = [&] (const String& fillName)
@@ -235,15 +348,24 @@ void UIFactory::loadSizerChildren(UISizer& sizer, const ConfigNode& node)
 				fill = UISizerFillFlags::Fill;
 			}
 
+			entry.fill = fill;
+
 			if (childNode.hasKey("widget")) {
-				sizer.add(makeWidget(childNode), proportion, border, fill);
+				entry.type = SizerEntryType::Widget;
+				const auto iter = factories.find(childNode["widget"]["class"].asString());
+				if (iter != factories.end()) {
+					entry.factory = &iter->second;
+				}
 			} else if (childNode.hasKey("sizer") || childNode.hasKey("children")) {
-				sizer.add(makeSizerPtr(childNode), proportion, border, fill);
+				entry.type = SizerEntryType::Sizer;
 			} else if (childNode.hasKey("spacer")) {
-				sizer.addSpacer(proportion);
+				entry.type = SizerEntryType::Spacer;
 			} else if (childNode.hasKey("stretchSpacer")) {
-				sizer.addStretchSpacer(proportion);
+				entry.type = SizerEntryType::StretchSpacer;
+			} else {
+				entry.type = SizerEntryType::None;
 			}
+			entries.push_back(entry);
 		}
 	}
 }
@@ -263,7 +385,7 @@ void UIFactory::applyInputButtons(UIWidget& widget, const String& key)
 Maybe<Vector2f> UIFactory::asMaybeVector2f(const ConfigNode& node)
 {
 	if (node.getType() == ConfigNodeType::Sequence) {
-		auto seq = node.asSequence();
+		auto& seq = node.asSequence();
 		return Vector2f(seq.at(0).asFloat(), seq.at(1).asFloat());
 	} else {
 		return {};
@@ -273,7 +395,7 @@ Maybe<Vector2f> UIFactory::asMaybeVector2f(const ConfigNode& node)
 Vector2f UIFactory::asVector2f(const ConfigNode& node, Maybe<Vector2f> defaultValue)
 {
 	if (node.getType() == ConfigNodeType::Sequence) {
-		auto seq = node.asSequence();
+		auto& seq = node.asSequence();
 		return Vector2f(seq.at(0).asFloat(), seq.at(1).asFloat());
 	} else if (defaultValue) {
 		return defaultValue.get();
@@ -321,7 +443,7 @@ std::vector<UIFactory::ParsedOption> UIFactory::parseOptions(const ConfigNode& n
 Vector4f UIFactory::asVector4f(const ConfigNode& node, Maybe<Vector4f> defaultValue)
 {
 	if (node.getType() == ConfigNodeType::Sequence) {
-		auto seq = node.asSequence();
+		auto& seq = node.asSequence();
 		return Vector4f(seq.at(0).asFloat(), seq.at(1).asFloat(), seq.at(2).asFloat(), seq.at(3).asFloat());
 	} else if (defaultValue) {
 		return defaultValue.get();
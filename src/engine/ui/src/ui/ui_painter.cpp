@@ -4,6 +4,16 @@
 #include "halley/core/graphics/text/text_renderer.h"
 using namespace Halley;
 
+bool UIDrawCache::isValid() const
+{
+	return valid;
+}
+
+void UIDrawCache::invalidate()
+{
+	valid = false;
+}
+
 UIPainter::UIPainter(SpritePainter& painter, int mask, int layer)
 	: painter(painter)
 	, mask(mask)
@@ -17,6 +27,7 @@ UIPainter UIPainter::clone()
 	auto result = UIPainter(painter, mask, layer);
 	result.parent = this;
 	result.clip = clip;
+	result.recording = recording;
 	return result;
 }
 
@@ -47,6 +58,54 @@ UIPainter UIPainter::withMask(int mask)
 	return result;
 }
 
+UIPainter UIPainter::withRecording(UIDrawCache& cache)
+{
+	cache.entries.clear();
+	cache.sprites.clear();
+	cache.texts.clear();
+	cache.clip = clip;
+	cache.mask = mask;
+	cache.layer = layer;
+	cache.valid = true;
+
+	auto result = clone();
+	result.recording = &cache;
+	return result;
+}
+
+bool UIPainter::canDraw(const UIDrawCache& cache) const
+{
+	// Clipping is baked into the recorded copies, and the mask is absolute, so those have to match
+	const bool sameClip = clip ? (cache.clip && cache.clip.get() == clip.get()) : !cache.clip;
+	return cache.valid && sameClip && cache.mask == mask;
+}
+
+void UIPainter::draw(const UIDrawCache& cache)
+{
+	// Priorities are handed out in the same order as when recorded, so it interleaves with everything else just the same
+	for (auto& e: cache.entries) {
+		const int entryLayer = layer + e.layer;
+		if (recording) {
+			// A cached subtree inside one that's being recorded
+			recording->entries.push_back(UIDrawCache::Entry{ e.text ? recording->texts.size() : recording->sprites.size(), e.mask, entryLayer - recording->layer, e.text });
+			if (e.text) {
+				recording->texts.push_back(cache.texts[e.index]);
+			} else {
+				recording->sprites.push_back(cache.sprites[e.index]);
+			}
+		} else if (e.text) {
+			painter.add(cache.texts[e.index], e.mask, entryLayer, getCurrentPriority());
+		} else {
+			painter.add(cache.sprites[e.index], e.mask, entryLayer, getCurrentPriority());
+		}
+	}
+}
+
+int UIPainter::getEntriesDrawn() const
+{
+	return parent ? parent->getEntriesDrawn() : n;
+}
+
 float UIPainter::getCurrentPriority()
 {
 	if (parent) {
@@ -66,14 +125,12 @@ void UIPainter::draw(const Sprite& sprite, bool forceCopy)
 
 		auto onScreen = sprite.getAABB().intersection(targetClip + sprite.getPosition());
 		if (onScreen.getWidth() > 0.1f && onScreen.getHeight() > 0.1f) {
-			painter.addCopy(sprite.clone().setClip(targetClip), mask, layer, getCurrentPriority());
+			auto clipped = sprite.clone();
+			clipped.setClip(targetClip);
+			submit(std::move(clipped));
 		}
 	} else {
-		if (forceCopy) {
-			painter.addCopy(sprite, mask, layer, getCurrentPriority());
-		} else {
-			painter.add(sprite, mask, layer, getCurrentPriority());
-		}
+		submit(sprite, forceCopy);
 	}
 }
 
@@ -87,13 +144,44 @@ void UIPainter::draw(const TextRenderer& text, bool forceCopy)
 		
 		auto onScreen = Rect4f(Vector2f(), text.getExtents()).intersection(targetClip);
 		if (onScreen.getWidth() > 0.1f && onScreen.getHeight() > 0.1f) {
-			painter.addCopy(text.clone().setClip(clip.get() - text.getPosition()), mask, layer, getCurrentPriority());
+			submit(text.clone().setClip(clip.get() - text.getPosition()), true);
 		}
 	} else {
-		if (forceCopy) {
-			painter.addCopy(text, mask, layer, getCurrentPriority());
-		} else {
-			painter.add(text, mask, layer, getCurrentPriority());
-		}
+		submit(text, forceCopy);
+	}
+}
+
+void UIPainter::submit(const Sprite& sprite, bool copy)
+{
+	if (recording) {
+		recording->entries.push_back(UIDrawCache::Entry{ recording->sprites.size(), mask, layer - recording->layer, false });
+		recording->sprites.push_back(sprite);
+	} else if (copy) {
+		painter.addCopy(sprite, mask, layer, getCurrentPriority());
+	} else {
+		painter.add(sprite, mask, layer, getCurrentPriority());
+	}
+}
+
+void UIPainter::submit(Sprite&& sprite)
+{
+	// A copy made here, so it's moved into place rather than copied again
+	if (recording) {
+		recording->entries.push_back(UIDrawCache::Entry{ recording->sprites.size(), mask, layer - recording->layer, false });
+		recording->sprites.push_back(std::move(sprite));
+	} else {
+		painter.addCopy(std::move(sprite), mask, layer, getCurrentPriority());
+	}
+}
+
+void UIPainter::submit(const TextRenderer& text, bool copy)
+{
+	if (recording) {
+		recording->entries.push_back(UIDrawCache::Entry{ recording->texts.size(), mask, layer - recording->layer, true });
+		recording->texts.push_back(text);
+	} else if (copy) {
+		painter.addCopy(text, mask, layer, getCurrentPriority());
+	} else {
+		painter.add(text, mask, layer, getCurrentPriority());
 	}
 }
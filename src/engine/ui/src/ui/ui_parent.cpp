@@ -75,6 +75,8 @@ bool UIParent::isWaitingToSpawnChildren() const
 
 void UIParent::markAsNeedingLayout() {}
 
+void UIParent::invalidateDraw() {}
+
 std::vector<std::shared_ptr<UIWidget>>& UIParent::getChildren()
 {
 	/*
@@ -141,6 +143,44 @@ std::shared_ptr<UIWidget> UIParent::doGetWidget(const String& id) const
 	return {};
 }
 
+std::shared_ptr<UIWidget> UIParent::getWidget(StringId id)
+{
+	auto widget = tryGetWidget(id);
+	if (!widget) {
+		throw Exception("Widget with id \"" + id.getString() + "\" not found.", HalleyExceptions::UI);
+	}
+	return widget;
+}
+
+std::shared_ptr<UIWidget> UIParent::tryGetWidget(StringId id)
+{
+	auto widgetThis = dynamic_cast<UIWidget*>(this);
+	if (widgetThis && widgetThis->getStringId() == id) {
+		return widgetThis->shared_from_this();
+	}
+
+	return doGetWidget(id);
+}
+
+std::shared_ptr<UIWidget> UIParent::doGetWidget(StringId id) const
+{
+	auto lists = { children, childrenWaiting };
+	for (auto& cs : lists) {
+		for (auto& c: cs) {
+			if (c->isAlive()) {
+				if (c->getStringId() == id) {
+					return c;
+				}
+				auto c2 = c->doGetWidget(id);
+				if (c2) {
+					return c2;
+				}
+			}
+		}
+	}
+	return {};
+}
+
 
 bool UIParent::isDescendentOf(const UIWidget& ancestor) const
 {
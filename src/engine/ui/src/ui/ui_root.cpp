@@ -5,6 +5,8 @@
 #include "halley/audio/audio_position.h"
 #include "halley/audio/audio_clip.h"
 #include "halley/maths/random.h"
+#include "halley/support/memory_tracker.h"
+#include "halley/time/stopwatch.h"
 
 using namespace Halley;
 
@@ -46,6 +48,17 @@ Rect4f UIRoot::getRect() const
 
 void UIRoot::update(Time t, UIInputType activeInputType, spInputDevice mouse, spInputDevice manual)
 {
+	MemoryTagScope memoryTag(MemoryTag::UI);
+	Stopwatch timer(profiling);
+	if (profiling) {
+		stats.layoutPasses = 0;
+		stats.widgetsMeasured = 0;
+		stats.widgetsPlaced = 0;
+		stats.textLayouts = 0;
+		stats.layoutNs = 0;
+		stats.relayoutRects.clear();
+	}
+
 	auto joystickType = manual->getJoystickType();
 	bool first = true;
 
@@ -75,6 +88,10 @@ void UIRoot::update(Time t, UIInputType activeInputType, spInputDevice mouse, sp
 		// For subsequent iterations, make sure t = 0
 		t = 0;
 	} while (isWaitingToSpawnChildren());
+
+	if (profiling) {
+		stats.updateNs = timer.elapsedNanoSeconds();
+	}
 }
 
 void UIRoot::updateMouse(spInputDevice mouse)
@@ -130,54 +147,29 @@ void UIRoot::updateMouse(spInputDevice mouse)
 	updateMouseOver(activeMouseOver);
 }
 
-void UIRoot::updateInputTree(const spInputDevice& input, UIWidget& widget, std::vector<UIWidget*>& inputTargets, UIInput::Priority& bestPriority, bool accepting)
+void UIRoot::updateInput(spInputDevice input)
 {
-	if (!widget.isActive()) {
-		return;
-	}
+	updateInputIndex();
 
-	if (!widget.isEnabled()) {
-		accepting = false;
-	}
-
-	for (auto& c: widget.getChildren()) {
-		// Depth-first
-		updateInputTree(input, *c, inputTargets, bestPriority, accepting);
-	}
-
-	if (widget.inputButtons) {
+	std::vector<UIWidget*> activeTargets;
+	UIInput::Priority bestPriority = UIInput::Priority::Lowest;
+	for (auto& target: inputTargets) {
+		auto& widget = *target.widget;
 		widget.inputResults.reset();
-		if (accepting) {
+		if (target.accepting) {
 			auto priority = widget.getInputPriority();
 
 			if (int(priority) > int(bestPriority)) {
 				bestPriority = priority;
-				inputTargets.clear();
+				activeTargets.clear();
 			}
 			if (priority == bestPriority) {
-				inputTargets.push_back(&widget);
+				activeTargets.push_back(&widget);
 			}
 		}
 	}
-}
 
-void UIRoot::updateInput(spInputDevice input)
-{
-	auto& cs = getChildren();
-	std::vector<UIWidget*> inputTargets;
-	UIInput::Priority bestPriority = UIInput::Priority::Lowest;
-
-	bool accepting = true;
-	for (int i = int(cs.size()); --i >= 0; ) {
-		auto& c = *cs[i];
-		updateInputTree(input, c, inputTargets, bestPriority, accepting);
-				
-		if (c.isMouseBlocker()) {
-			accepting = false;
-		}
-	}
-
-	for (auto& target: inputTargets) {
+	for (auto& target: activeTargets) {
 		auto& b = *target->inputButtons;
 		auto& results = target->inputResults;
 		results.reset();
@@ -225,9 +217,76 @@ void UIRoot::mouseOverNext(bool forward)
 
 void UIRoot::runLayout()
 {
+	if (!profiling) {
+		for (auto& c: getChildren()) {
+			c->layout();
+		}
+		return;
+	}
+
+	stats.widgets = 0;
+	stats.activeWidgets = 0;
+	std::vector<UIWidget*> relayoutSources;
+	for (auto& c: getChildren()) {
+		collectLayoutStats(*c, relayoutSources);
+	}
+
+	Stopwatch timer;
 	for (auto& c: getChildren()) {
 		c->layout();
 	}
+	stats.layoutNs += timer.elapsedNanoSeconds();
+	++stats.layoutPasses;
+
+	// Read after laying out, so the outlines are where the widgets ended up
+	for (auto& w: relayoutSources) {
+		stats.relayoutRects.push_back(w->getRect());
+	}
+}
+
+void UIRoot::collectLayoutStats(UIWidget& widget, std::vector<UIWidget*>& relayoutSources)
+{
+	++stats.widgets;
+	if (!widget.isActive()) {
+		return;
+	}
+	++stats.activeWidgets;
+
+	// Ancestors of a changed widget are marked along with it, so only count the ones at the bottom as the cause
+	bool childNeedsLayout = false;
+	for (auto& c: widget.getChildren()) {
+		childNeedsLayout = childNeedsLayout || c->placementNeeded;
+		collectLayoutStats(*c, relayoutSources);
+	}
+
+	stats.widgetsMeasured += widget.layoutNeeded != 0 ? 1 : 0;
+	stats.widgetsPlaced += widget.placementNeeded ? 1 : 0;
+	if (widget.placementNeeded && !childNeedsLayout) {
+		relayoutSources.push_back(&widget);
+	}
+}
+
+void UIRoot::setProfiling(bool enabled)
+{
+	profiling = enabled;
+	stats = UIStats();
+}
+
+bool UIRoot::isProfiling() const
+{
+	return profiling;
+}
+
+const UIStats& UIRoot::getStats() const
+{
+	return stats;
+}
+
+void UIRoot::addTextLayoutStat()
+{
+	if (profiling) {
+		++stats.textLayouts;
+	}
 }
 
 void UIRoot::setFocus(std::shared_ptr<UIWidget> focus)
@@ -262,40 +321,152 @@ void UIRoot::updateMouseOver(const std::shared_ptr<UIWidget>& underMouse)
 
 std::shared_ptr<UIWidget> UIRoot::getWidgetUnderMouse(Vector2f mousePos, bool includeDisabled) const
 {
+	updateInputIndex();
+
+	const auto cell = Vector2i((mousePos - mouseGridOrigin) / mouseGridCellSize);
+	if (mouseTargets.empty() || mousePos.x < mouseGridOrigin.x || mousePos.y < mouseGridOrigin.y || cell.x >= mouseGridSize.x || cell.y >= mouseGridSize.y) {
+		return {};
+	}
+
+	// Entries are in search order, so the first one that's still under the mouse is the one the tree walk would have found
+	const auto cellIdx = cell.x + cell.y * mouseGridSize.x;
+	for (auto i = mouseGridCellStart[cellIdx]; i < mouseGridCellStart[cellIdx + 1]; ++i) {
+		auto& target = mouseTargets[mouseGridEntries[i]];
+		if ((includeDisabled || target.enabled) && target.widget->canInteractWithMouse() && target.widget->getMouseRect().contains(mousePos)) {
+			return target.widget->shared_from_this();
+		}
+	}
+	return {};
+}
+
+void UIRoot::markAsNeedingLayout()
+{
+	invalidateInputIndex();
+}
+
+void UIRoot::invalidateInputIndex()
+{
+	inputIndexDirty = true;
+}
+
+void UIRoot::updateInputIndex() const
+{
+	if (!inputIndexDirty) {
+		return;
+	}
+	inputIndexDirty = false;
+
+	mouseTargets.clear();
+	inputTargets.clear();
+
 	auto& cs = getChildren();
 	for (int i = int(cs.size()); --i >= 0; ) {
-		auto curRootWidget = cs[i];
-		auto widget = getWidgetUnderMouse(curRootWidget, mousePos, includeDisabled);
-		if (widget) {
-			return widget;
-		} else {
-			if (curRootWidget->isMouseBlocker()) {
-				return {};
-			}
+		collectMouseTargets(*cs[i], true);
+		if (cs[i]->isMouseBlocker()) {
+			break;
 		}
 	}
-	return {};
+
+	bool accepting = true;
+	for (int i = int(cs.size()); --i >= 0; ) {
+		collectInputTargets(*cs[i], accepting);
+		if (cs[i]->isMouseBlocker()) {
+			accepting = false;
+		}
+	}
+
+	buildMouseGrid();
 }
 
-std::shared_ptr<UIWidget> UIRoot::getWidgetUnderMouse(const std::shared_ptr<UIWidget>& start, Vector2f mousePos, bool includeDisabled) const
+void UIRoot::collectMouseTargets(UIWidget& widget, bool enabled) const
 {
-	if (!start->isActive() || (!includeDisabled && !start->isEnabled())) {
-		return {};
+	if (!widget.isActive()) {
+		return;
 	}
 
+	enabled = enabled && widget.isEnabled();
+
 	// Depth first
-	for (auto& c: start->getChildren()) {
-		auto result = getWidgetUnderMouse(c, mousePos, includeDisabled);
-		if (result) {
-			return result;
+	for (auto& c: widget.getChildren()) {
+		collectMouseTargets(*c, enabled);
+	}
+
+	if (widget.canInteractWithMouse()) {
+		const auto rect = widget.getMouseRect();
+		if (!rect.isEmpty()) {
+			mouseTargets.push_back(MouseTarget{ &widget, rect, enabled });
 		}
 	}
+}
 
-	auto rect = start->getMouseRect();
-	if (start->canInteractWithMouse() && rect.contains(mousePos)) {
-		return start;
-	} else {
-		return {};
+void UIRoot::collectInputTargets(UIWidget& widget, bool accepting) const
+{
+	if (!widget.isActive()) {
+		return;
+	}
+
+	accepting = accepting && widget.isEnabled();
+
+	// Depth first
+	for (auto& c: widget.getChildren()) {
+		collectInputTargets(*c, accepting);
+	}
+
+	if (widget.inputButtons) {
+		inputTargets.push_back(InputTarget{ &widget, accepting });
+	}
+}
+
+void UIRoot::buildMouseGrid() const
+{
+	mouseGridCellStart.clear();
+	mouseGridEntries.clear();
+	if (mouseTargets.empty()) {
+		mouseGridSize = Vector2i();
+		return;
+	}
+
+	Rect4f bounds = mouseTargets[0].rect;
+	for (auto& t: mouseTargets) {
+		bounds = bounds.merge(t.rect);
+	}
+
+	// Cells of around 64 pixels, but never more than 64x64 of them
+	constexpr int maxCells = 64;
+	mouseGridOrigin = bounds.getTopLeft();
+	mouseGridCellSize = std::max(64.0f, std::max(bounds.getWidth(), bounds.getHeight()) / float(maxCells));
+	mouseGridSize = Vector2i(int(bounds.getWidth() / mouseGridCellSize) + 1, int(bounds.getHeight() / mouseGridCellSize) + 1);
+
+	auto getCells = [&] (const Rect4f& rect) -> Rect4i
+	{
+		const auto p0 = Vector2i((rect.getTopLeft() - mouseGridOrigin) / mouseGridCellSize);
+		const auto p1 = Vector2i((rect.getBottomRight() - mouseGridOrigin) / mouseGridCellSize);
+		return Rect4i(p0, Vector2i(std::min(p1.x, mouseGridSize.x - 1), std::min(p1.y, mouseGridSize.y - 1)));
+	};
+
+	// Count, then fill, keeping each cell's entries in search order
+	mouseGridCellStart.resize(size_t(mouseGridSize.x * mouseGridSize.y) + 1, 0);
+	for (auto& t: mouseTargets) {
+		const auto cells = getCells(t.rect);
+		for (int y = cells.getTop(); y <= cells.getBottom(); ++y) {
+			for (int x = cells.getLeft(); x <= cells.getRight(); ++x) {
+				++mouseGridCellStart[x + y * mouseGridSize.x + 1];
+			}
+		}
+	}
+	for (size_t i = 1; i < mouseGridCellStart.size(); ++i) {
+		mouseGridCellStart[i] += mouseGridCellStart[i - 1];
+	}
+
+	mouseGridEntries.resize(mouseGridCellStart.back());
+	auto next = mouseGridCellStart;
+	for (uint32_t i = 0; i < uint32_t(mouseTargets.size()); ++i) {
+		const auto cells = getCells(mouseTargets[i].rect);
+		for (int y = cells.getTop(); y <= cells.getBottom(); ++y) {
+			for (int x = cells.getLeft(); x <= cells.getRight(); ++x) {
+				mouseGridEntries[next[x + y * mouseGridSize.x]++] = i;
+			}
+		}
 	}
 }
 
@@ -308,9 +479,9 @@ void UIRoot::unsetUIMouseRemapping() {
 	mouseRemap = [](Vector2f p) { return p; };
 }
 
-std::vector<std::shared_ptr<UIWidget>> UIRoot::collectWidgets()
+FrameVector<std::shared_ptr<UIWidget>> UIRoot::collectWidgets()
 {
-	std::vector<std::shared_ptr<UIWidget>> output;
+	FrameVector<std::shared_ptr<UIWidget>> output;
 	if (getChildren().empty()) {
 		return {};
 	}
@@ -318,7 +489,7 @@ std::vector<std::shared_ptr<UIWidget>> UIRoot::collectWidgets()
 	return output;
 }
 
-void UIRoot::collectWidgets(const std::shared_ptr<UIWidget>& start, std::vector<std::shared_ptr<UIWidget>>& output)
+void UIRoot::collectWidgets(const std::shared_ptr<UIWidget>& start, FrameVector<std::shared_ptr<UIWidget>>& output)
 {
 	for (auto& c: start->getChildren()) {
 		collectWidgets(c, output);
@@ -331,11 +502,17 @@ void UIRoot::collectWidgets(const std::shared_ptr<UIWidget>& start, std::vector<
 
 void UIRoot::draw(SpritePainter& painter, int mask, int layer)
 {
+	Stopwatch timer(profiling);
 	UIPainter p(painter, mask, layer);
 
 	for (auto& c: getChildren()) {
 		c->doDraw(p);
 	}
+
+	if (profiling) {
+		stats.drawNs = timer.elapsedNanoSeconds();
+		stats.drawEntries = p.getEntriesDrawn();
+	}
 }
 
 Maybe<AudioHandle> UIRoot::playSound(const String& eventName)
@@ -233,6 +233,9 @@ void UISizer::updateEnabled() const
 void UISizer::swapItems(int idxA, int idxB)
 {
 	std::swap(entries[idxA], entries[idxB]);
+	if (curParent) {
+		curParent->markAsNeedingLayout();
+	}
 }
 
 void UISizer::clear()
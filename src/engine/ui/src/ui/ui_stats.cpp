@@ -0,0 +1,81 @@
+#include "ui_stats.h"
+#include "ui_root.h"
+#include "halley/core/graphics/render_context.h"
+#include "halley/core/graphics/painter.h"
+#include "halley/core/graphics/text/font.h"
+#include "halley/core/resources/resources.h"
+#include "halley/text/string_converter.h"
+#include <iomanip>
+#include <sstream>
+
+using namespace Halley;
+
+UIStatsView::UIStatsView(Resources& resources)
+	: text(resources.get<Font>("Ubuntu Bold"), "", 16, Colour(1, 1, 1), 1.0f, Colour(0.1f, 0.1f, 0.1f))
+	, box(Sprite().setMaterial(resources, "Halley/SolidColour").setColour(Colour4f(1.0f, 0.3f, 0.2f, 0.8f)))
+{
+}
+
+void UIStatsView::setRoot(UIRoot* r)
+{
+	if (root) {
+		root->setProfiling(false);
+	}
+	root = r;
+	if (root) {
+		root->setProfiling(true);
+	}
+}
+
+void UIStatsView::draw(RenderContext& context)
+{
+	if (!root) {
+		return;
+	}
+
+	const auto& stats = root->getStats();
+	context.bind([&] (Painter& painter) {
+		for (auto& rect: stats.relayoutRects) {
+			drawOutline(painter, rect);
+		}
+
+		Vector2f pos(20, 20);
+		auto drawLine = [&] (const String& name, const String& value)
+		{
+			text.setText(name).setAlignment(0).setPosition(pos).draw(painter);
+			text.setText(value).setAlignment(1).setPosition(pos + Vector2f(280, 0)).draw(painter);
+			text.setAlignment(0);
+			pos.y += 20;
+		};
+
+		text.setColour(Colour(0.2f, 1.0f, 0.3f)).setText("UI:").setPosition(pos).draw(painter);
+		text.setColour(Colour(1, 1, 1));
+		pos.y += 20;
+
+		drawLine("Widgets (active)", toString(stats.widgets) + " (" + toString(stats.activeWidgets) + ")");
+		drawLine("Update", formatTime(stats.updateNs));
+		drawLine("Layout (" + toString(stats.layoutPasses) + " passes)", formatTime(stats.layoutNs));
+		drawLine("Measured / placed", toString(stats.widgetsMeasured) + " / " + toString(stats.widgetsPlaced));
+		drawLine("Text layouts", toString(stats.textLayouts));
+		drawLine("Draw", formatTime(stats.drawNs));
+		drawLine("Draw entries", toString(stats.drawEntries));
+	});
+}
+
+void UIStatsView::drawOutline(Painter& painter, Rect4f rect)
+{
+	const auto p0 = rect.getTopLeft();
+	const auto size = rect.getSize();
+	box.clone().setPosition(p0).setSize(Vector2f(size.x, 1)).draw(painter);
+	box.clone().setPosition(p0 + Vector2f(0, size.y - 1)).setSize(Vector2f(size.x, 1)).draw(painter);
+	box.clone().setPosition(p0).setSize(Vector2f(1, size.y)).draw(painter);
+	box.clone().setPosition(p0 + Vector2f(size.x - 1, 0)).setSize(Vector2f(1, size.y)).draw(painter);
+}
+
+String UIStatsView::formatTime(int64_t ns) const
+{
+	int64_t us = (ns + 500) / 1000;
+	std::stringstream ss;
+	ss << (us / 1000) << '.' << std::setw(3) << std::setfill('0') << (us % 1000) << " ms";
+	return ss.str();
+}
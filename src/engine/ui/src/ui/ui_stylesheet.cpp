@@ -60,7 +60,7 @@ void loadStyleData(Resources& resources, const String& name, const ConfigNode& n
 }
 
 template <>
-void loadStyleData(Resources& resources, const String& name, const ConfigNode& node, std::shared_ptr<const UIStyleDefinition>& data)
+void loadStyleData(Resources& resources, const String& name, const ConfigNode& node, std::shared_ptr<UIStyleDefinition>& data)
 {
 	if (node.getType() != ConfigNodeType::Map) {
 		data = {};
@@ -69,92 +69,88 @@ void loadStyleData(Resources& resources, const String& name, const ConfigNode& n
 	}
 }
 
+UIStyleDefinition::UIStyleDefinition(String styleName, const ConfigNode& node, Resources& resources)
+	: styleName(std::move(styleName))
+	, node(node)
+	, resources(resources)
+{
+}
+
 template <typename T>
-const T& getValue(const ConfigNode& node, Resources& resources, const String& name, const String& key, FlatMap<String, T>& cache)
+const T& UIStyleDefinition::getValue(const String& key, Properties<T>& properties) const
 {
-	// Is it already in cache?
-	const auto iter = cache.find(key);
-	if (iter != cache.end()) {
+	const auto iter = properties.values.find(key);
+	if (iter != properties.values.end()) {
 		return iter->second;
 	}
 
-	// Not in cache, try to load it
 	if (node.hasKey(key)) {
 		T data;
 		loadStyleData(resources, key, node[key], data);
-		cache[key] = data;
-		return cache[key];
-	} else {
-		// Not found. Use a default.
-		const auto iter2 = cache.find(":default");
-		if (iter2 != cache.end()) {
-			Logger::logWarning(String(typeid(T).name()) + " not found in UI style: " + name + "." + key);
-			return iter2->second;
-		} else {
-			throw Exception(String(typeid(T).name()) + " not found in UI style: " + name + "." + key + ". Additionally, default was not set.", HalleyExceptions::Tools);
-		}
+		return properties.values[key] = std::move(data);
 	}
-}
 
-template <typename T>
-bool hasValue(const ConfigNode& node, Resources& resources, const String& name, const String& key, FlatMap<String, T>& cache)
-{
-	// Is it already in cache?
-	const auto iter = cache.find(key);
-	if (iter != cache.end()) {
-		return true;
+	// Not found, use the default, only warning about it the first time
+	if (missing.find(key) == missing.end()) {
+		missing[key] = true;
+		Logger::logWarning(String(typeid(T).name()) + " not found in UI style: " + styleName + "." + key);
 	}
-
-	return node.hasKey(key);
+	return properties.defaultValue;
 }
 
-UIStyleDefinition::UIStyleDefinition(String styleName, const ConfigNode& node, Resources& resources)
-	: styleName(std::move(styleName))
-	, node(node)
-	, resources(resources)
+void UIStyleDefinition::reload(const ConfigNode& newNode)
 {
-	// Load defaults
-	sprites[":default"] = Sprite();
-	textRenderers[":default"] = TextRenderer();
-	floats[":default"] = 0.0f;
-	borders[":default"] = Vector4f();
-	strings[":default"] = "";
-	subStyles[":default"] = {};
+	node = ConfigNode(newNode);
+	sprites.values.clear();
+	textRenderers.values.clear();
+	borders.values.clear();
+	strings.values.clear();
+	floats.values.clear();
+	missing.clear();
+
+	// Sub-styles are reloaded rather than replaced, as widgets may be holding on to them
+	for (auto& sub: subStyles.values) {
+		if (sub.second && node.hasKey(sub.first) && node[sub.first].getType() == ConfigNodeType::Map) {
+			sub.second->reload(node[sub.first]);
+		} else {
+			loadStyleData(resources, sub.first, node.hasKey(sub.first) ? node[sub.first] : ConfigNode(), sub.second);
+		}
+	}
 }
 
 std::shared_ptr<const UIStyleDefinition> UIStyleDefinition::getSubStyle(const String& name) const
 {
-	return getValue(node, resources, styleName, name, subStyles);
+	return getValue(name, subStyles);
 }
 
 const Sprite& UIStyleDefinition::getSprite(const String& name) const
 {
-	return getValue(node, resources, styleName, name, sprites);
+	return getValue(name, sprites);
 }
 
 const TextRenderer& UIStyleDefinition::getTextRenderer(const String& name) const
 {
-	return getValue(node, resources, styleName, name, textRenderers);
+	return getValue(name, textRenderers);
 }
 
 bool UIStyleDefinition::hasTextRenderer(const String& name) const
 {
-	return hasValue(node, resources, styleName, name, textRenderers);
+	return textRenderers.values.find(name) != textRenderers.values.end() || node.hasKey(name);
 }
 
 Vector4f UIStyleDefinition::getBorder(const String& name) const
 {
-	return getValue(node, resources, styleName, name, borders);
+	return getValue(name, borders);
 }
 
 const String& UIStyleDefinition::getString(const String& name) const
 {
-	return getValue(node, resources, styleName, name, strings);
+	return getValue(name, strings);
 }
 
 float UIStyleDefinition::getFloat(const String& name) const
 {
-	return getValue(node, resources, styleName, name, floats);
+	return getValue(name, floats);
 }
 
 UIStyleSheet::UIStyleSheet(Resources& resources)
@@ -186,16 +182,24 @@ bool UIStyleSheet::needsUpdate() const
 
 void UIStyleSheet::update()
 {
+	// Only the files that changed, and the styles are updated in place, so existing UIStyles pick up the new values
 	for (auto& o: observers) {
-		o.second.update();
-		load(o.second.getRoot());
+		if (o.second.needsUpdate()) {
+			o.second.update();
+			load(o.second.getRoot());
+		}
 	}
 }
 
 void UIStyleSheet::load(const ConfigNode& root)
 {
 	for (const auto& node: root["uiStyle"].asMap()) {
-		styles[node.first] = std::make_unique<UIStyleDefinition>(node.first, node.second, resources);
+		auto iter = styles.find(node.first);
+		if (iter != styles.end()) {
+			iter->second->reload(node.second);
+		} else {
+			styles[node.first] = std::make_shared<UIStyleDefinition>(node.first, node.second, resources);
+		}
 	}
 }
 
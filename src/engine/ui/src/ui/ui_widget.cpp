@@ -9,6 +9,7 @@ using namespace Halley;
 
 UIWidget::UIWidget(String id, Vector2f minSize, Maybe<UISizer> sizer, Vector4f innerBorder)
 	: id(id)
+	, stringId(id)
 	, size(minSize)
 	, minSize(minSize)
 	, innerBorder(innerBorder)
@@ -30,17 +31,30 @@ UIWidget::~UIWidget()
 void UIWidget::doDraw(UIPainter& painter) const
 {
 	if (isActive()) {
-		draw(painter);
-
-		if (childLayerAdjustment == 0) {
-			drawChildren(painter);
+		if (drawCache) {
+			if (!painter.canDraw(*drawCache)) {
+				auto recorder = painter.withRecording(*drawCache);
+				drawContents(recorder);
+			}
+			painter.draw(*drawCache);
 		} else {
-			UIPainter p2 = painter.withAdjustedLayer(childLayerAdjustment);
-			drawChildren(p2);
+			drawContents(painter);
 		}
+	}
+}
+
+void UIWidget::drawContents(UIPainter& painter) const
+{
+	draw(painter);
 
-		drawAfterChildren(painter);
+	if (childLayerAdjustment == 0) {
+		drawChildren(painter);
+	} else {
+		UIPainter p2 = painter.withAdjustedLayer(childLayerAdjustment);
+		drawChildren(p2);
 	}
+
+	drawAfterChildren(painter);
 }
 
 void UIWidget::doUpdate(UIWidgetUpdateType updateType, Time t, UIInputType inputType, JoystickType joystickType)
@@ -57,6 +71,10 @@ void UIWidget::doUpdate(UIWidgetUpdateType updateType, Time t, UIInputType input
 	}
 
 	if (isActive()) {
+		if (dataBind && dataBind->getVersion() != dataBindVersion) {
+			readDataBindChanges();
+		}
+
 		updateBehaviours(t);
 		update(t, positionUpdated);
 		positionUpdated = false;
@@ -102,10 +120,18 @@ Vector2f UIWidget::getLayoutMinimumSize(bool force) const
 
 void UIWidget::setRect(Rect4f rect)
 {
+	// If nothing in this subtree was marked since it was last placed at the same spot, every descendant is still where
+	// it should be, so there's no need to go through them again. This keeps relayouts to the branches that changed.
+	if (!placementNeeded && rect == getRect() && getLayoutOriginPosition() == lastLayoutOrigin) {
+		return;
+	}
+	placementNeeded = false; // Before placing the children, so anything they mark during it is picked up next time
+
 	setWidgetRect(rect);
+	lastLayoutOrigin = getLayoutOriginPosition();
 	if (sizer) {
 		auto border = getInnerBorder();
-		auto p0 = getLayoutOriginPosition();
+		auto p0 = lastLayoutOrigin;
 		sizer.get().setRect(Rect4f(p0 + Vector2f(border.x, border.y), p0 + rect.getSize() - Vector2f(border.z, border.w)));
 	} else {
 		for (auto& c: getChildren()) {
@@ -210,6 +236,7 @@ bool UIWidget::isFocused() const
 void UIWidget::setId(const String& i)
 {
 	id = i;
+	stringId = StringId(i);
 }
 
 bool UIWidget::isFocusLocked() const
@@ -254,6 +281,13 @@ Rect4f UIWidget::getRect() const
 
 void UIWidget::setPosition(Vector2f pos)
 {
+	if (position != pos) {
+		invalidateDraw();
+		if (parent) {
+			// Moved by hand, so the parent has to place it again, or it would be left here once whatever moved it stops
+			parent->markAsNeedingLayout();
+		}
+	}
 	position = pos;
 	positionUpdated = true;
 }
@@ -278,6 +312,7 @@ void UIWidget::setFocused(bool f)
 {
 	if (focused != f) {
 		focused = f;
+		invalidateDraw();
 		if (focused) {
 			onFocus();
 			sendEvent(UIEvent(UIEventType::FocusGained, getId()));
@@ -290,7 +325,10 @@ void UIWidget::setFocused(bool f)
 
 void UIWidget::setMouseOver(bool mo)
 {
-	mouseOver = mo;
+	if (mouseOver != mo) {
+		mouseOver = mo;
+		invalidateDraw();
+	}
 }
 
 void UIWidget::pressMouse(Vector2f mousePos, int button)
@@ -445,12 +483,20 @@ void UIWidget::onInput(const UIInputResults& input, Time time)
 
 void UIWidget::setMouseClip(Maybe<Rect4f> clip)
 {
+	if (mouseClip != clip) {
+		invalidateInputIndex();
+	}
 	mouseClip = clip;
 	for (auto& c: getChildren()) {
 		c->setMouseClip(clip);
 	}
 }
 
+const Maybe<Rect4f>& UIWidget::getMouseClip() const
+{
+	return mouseClip;
+}
+
 void UIWidget::onManualControlCycleValue(int delta)
 {
 }
@@ -577,6 +623,7 @@ const std::vector<UIInputType>& UIWidget::getOnlyEnabledWithInput() const
 void UIWidget::setInputButtons(const UIInputButtons& buttons)
 {
 	inputButtons = std::make_unique<UIInputButtons>(buttons);
+	invalidateInputIndex();
 }
 
 Rect4f UIWidget::getMouseRect() const
@@ -678,9 +725,37 @@ bool UIWidget::needsLayout() const
 	return layoutNeeded > 0;
 }
 
+void UIWidget::setDrawCached(bool cached)
+{
+	if (cached && !drawCache) {
+		drawCache = std::make_unique<UIDrawCache>();
+	} else if (!cached) {
+		drawCache.reset();
+	}
+}
+
+bool UIWidget::isDrawCached() const
+{
+	return static_cast<bool>(drawCache);
+}
+
+void UIWidget::invalidateDraw()
+{
+	if (drawCache) {
+		drawCache->invalidate();
+	}
+	if (parent) {
+		parent->invalidateDraw();
+	}
+}
+
 void UIWidget::markAsNeedingLayout()
 {
 	layoutNeeded = 1;
+	placementNeeded = true;
+	if (drawCache) {
+		drawCache->invalidate();
+	}
 	if (parent) {
 		parent->markAsNeedingLayout();
 	}
@@ -695,13 +770,21 @@ void UIWidget::checkActive()
 
 void UIWidget::setWidgetRect(Rect4f rect)
 {
-	if (position != rect.getTopLeft()) {
+	if (position != rect.getTopLeft() || size != rect.getSize()) {
 		position = rect.getTopLeft();
-		positionUpdated = true;
-	}
-	if (size != rect.getSize()) {
 		size = rect.getSize();
 		positionUpdated = true;
+		invalidateDraw();
+		invalidateInputIndex();
+	}
+}
+
+void UIWidget::invalidateInputIndex()
+{
+	// Changes that affect where the widget takes input from, but that don't go through markAsNeedingLayout
+	auto root = getRoot();
+	if (root) {
+		root->invalidateInputIndex();
 	}
 }
 
@@ -744,6 +827,15 @@ void UIWidget::setDataBind(std::shared_ptr<UIDataBind> d)
 	dataBind = d;
 	dataBind->setAcceptingDataFromWidget(false);
 	dataBind->setWidget(this);
+	dataBindVersion = dataBind->getVersion();
+	readFromDataBind();
+	dataBind->setAcceptingDataFromWidget(true);
+}
+
+void UIWidget::readDataBindChanges()
+{
+	dataBindVersion = dataBind->getVersion();
+	dataBind->setAcceptingDataFromWidget(false);
 	readFromDataBind();
 	dataBind->setAcceptingDataFromWidget(true);
 }
@@ -757,36 +849,44 @@ void UIWidget::readFromDataBind()
 {
 }
 
-void UIWidget::bindData(const String& childId, bool initialValue, UIDataBindBool::WriteCallback callback)
+std::shared_ptr<UIDataBindBool> UIWidget::bindData(const String& childId, bool initialValue, UIDataBindBool::WriteCallback callback)
 {
+	auto bind = std::make_shared<UIDataBindBool>(initialValue, std::move(callback));
 	auto widget = tryGetWidget(childId);
 	if (widget) {
-		widget->setDataBind(std::make_shared<UIDataBindBool>(initialValue, std::move(callback)));
+		widget->setDataBind(bind);
 	}
+	return bind;
 }
 
-void UIWidget::bindData(const String& childId, int initialValue, UIDataBindInt::WriteCallback callback)
+std::shared_ptr<UIDataBindInt> UIWidget::bindData(const String& childId, int initialValue, UIDataBindInt::WriteCallback callback)
 {
+	auto bind = std::make_shared<UIDataBindInt>(initialValue, std::move(callback));
 	auto widget = tryGetWidget(childId);
 	if (widget) {
-		widget->setDataBind(std::make_shared<UIDataBindInt>(initialValue, std::move(callback)));
+		widget->setDataBind(bind);
 	}
+	return bind;
 }
 
-void UIWidget::bindData(const String& childId, float initialValue, UIDataBindFloat::WriteCallback callback)
+std::shared_ptr<UIDataBindFloat> UIWidget::bindData(const String& childId, float initialValue, UIDataBindFloat::WriteCallback callback)
 {
+	auto bind = std::make_shared<UIDataBindFloat>(initialValue, std::move(callback));
 	auto widget = tryGetWidget(childId);
 	if (widget) {
-		widget->setDataBind(std::make_shared<UIDataBindFloat>(initialValue, std::move(callback)));
+		widget->setDataBind(bind);
 	}
+	return bind;
 }
 
-void UIWidget::bindData(const String& childId, const String& initialValue, UIDataBindString::WriteCallback callback)
+std::shared_ptr<UIDataBindString> UIWidget::bindData(const String& childId, const String& initialValue, UIDataBindString::WriteCallback callback)
 {
+	auto bind = std::make_shared<UIDataBindString>(initialValue, std::move(callback));
 	auto widget = tryGetWidget(childId);
 	if (widget) {
-		widget->setDataBind(std::make_shared<UIDataBindString>(initialValue, std::move(callback)));
+		widget->setDataBind(bind);
 	}
+	return bind;
 }
 
 bool UIWidget::isModal() const
@@ -806,7 +906,10 @@ bool UIWidget::isMouseBlocker() const
 
 void UIWidget::setMouseBlocker(bool blocker)
 {
-	mouseBlocker = blocker;
+	if (mouseBlocker != blocker) {
+		mouseBlocker = blocker;
+		invalidateInputIndex();
+	}
 }
 
 bool UIWidget::shrinksOnLayout() const
@@ -100,6 +100,7 @@ bool UIClickable::setState(State state)
 	if (state != curState || forceUpdate) {
 		curState = state;
 		doSetState(state);
+		invalidateDraw();
 		return true;
 	}
 	return false;
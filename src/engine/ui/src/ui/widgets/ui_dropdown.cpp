@@ -199,11 +199,13 @@ void UIDropdown::open()
 	if (!isOpen) {
 		isOpen = true;
 	
-		dropdownList = std::make_shared<UIList>(getId() + "_list", listStyle);
-		int i = 0;
-		for (auto& o: options) {
-			dropdownList->addTextItem(toString(i++), o);
+		// Only the options in view get widgets, so long lists still open quickly
+		std::vector<String> ids(options.size());
+		for (size_t i = 0; i < ids.size(); ++i) {
+			ids[i] = toString(i);
 		}
+		dropdownList = std::make_shared<UIList>(getId() + "_list", listStyle);
+		dropdownList->setDataSource(std::make_shared<UIListTextSource>(listStyle, std::move(ids), options));
 		dropdownList->setSelectedOption(curOption);
 		dropdownList->setInputButtons(inputButtons);
 		dropdownList->setFocused(true);
@@ -56,6 +56,16 @@ void UIHybridList::addDivider()
 	list->add(std::make_shared<UIImage>(dividerStyle.getSprite("image")), 0, dividerStyle.getBorder("border"));
 }
 
+void UIHybridList::setDataSource(std::shared_ptr<IUIListDataSource> source, Maybe<float> fixedItemSize)
+{
+	// A button per item is exactly what the data source is there to avoid, so the list handles every input type
+	buttons->getSizer().clear();
+	buttons->setActive(false);
+	cancelButton.reset();
+	list->setOnlyEnabledWithInputs({ UIInputType::Mouse, UIInputType::Keyboard, UIInputType::Gamepad });
+	list->setDataSource(std::move(source), fixedItemSize);
+}
+
 void UIHybridList::setInputButtons(const UIInputButtons& inputButtons)
 {
 	list->setInputButtons(inputButtons);
@@ -61,6 +61,7 @@ void UIImage::setSprite(Sprite s)
 		setMinSize(spriteSize);
 	}
 	dirty = true;
+	invalidateDraw();
 }
 
 Sprite& UIImage::getSprite()
@@ -76,11 +77,13 @@ const Sprite& UIImage::getSprite() const
 void UIImage::setLayerAdjustment(int adjustment)
 {
 	layerAdjustment = adjustment;
+	invalidateDraw();
 }
 
 void UIImage::setWorldClip(Maybe<Rect4f> wc)
 {
 	worldClip = wc;
+	invalidateDraw();
 }
 
 void UIImage::setSelectable(Colour4f normalColour, Colour4f selColour)
@@ -92,6 +95,7 @@ void UIImage::setSelectable(Colour4f normalColour, Colour4f selColour)
 		} else {
 			sprite.setColour(normalColour);
 		}
+		invalidateDraw();
 	});
 }
 
@@ -105,5 +109,6 @@ void UIImage::setSelectable(Sprite normalSprite, Sprite selectedSprite)
 			sprite = normalSprite;
 		}
 		dirty = true;
+		invalidateDraw();
 	});
 }
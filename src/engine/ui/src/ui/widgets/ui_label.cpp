@@ -28,6 +28,9 @@ void UILabel::update(Time t, bool moved)
 	if (text.checkForUpdates()) {
 		updateText();
 	}
+	if (marquee && needsClip) {
+		invalidateDraw();
+	}
 	if (moved || marquee) {
 		renderer.setPosition(getPosition() + Vector2f(renderer.getAlignment() * textExtents.x - marqueePos, 0.0f));
 	}
@@ -65,11 +68,17 @@ void UILabel::updateMinSize()
 		needsClip = true;
 	}
 	setMinSize(textExtents);
+	invalidateDraw();
 }
 
 void UILabel::updateText() {
 	renderer.setText(text);
 	updateMinSize();
+
+	auto root = getRoot();
+	if (root) {
+		root->addTextLayoutStat();
+	}
 }
 
 void UILabel::updateMarquee(Time t)
@@ -102,9 +111,15 @@ void UILabel::setText(const LocalisedString& t)
 	}
 }
 
+void UILabel::readFromDataBind()
+{
+	setText(LocalisedString::fromUserString(getDataBind()->getStringData()));
+}
+
 void UILabel::setColourOverride(const std::vector<ColourOverride>& overrides)
 {
 	renderer.setColourOverride(overrides);
+	invalidateDraw();
 }
 
 void UILabel::setMaxWidth(float m)
@@ -147,6 +162,7 @@ bool UILabel::isClipped() const
 void UILabel::setAlignment(float alignment)
 {
 	renderer.setAlignment(alignment);
+	invalidateDraw();
 }
 
 TextRenderer& UILabel::getTextRenderer()
@@ -174,6 +190,7 @@ void UILabel::setTextRenderer(TextRenderer r)
 void UILabel::setColour(Colour4f colour)
 {
 	renderer.setColour(colour);
+	invalidateDraw();
 }
 
 void UILabel::setSelectable(TextRenderer normalRenderer, TextRenderer selectedRenderer)
@@ -29,24 +29,31 @@ bool UIList::setSelectedOption(int option)
 
 	auto newSel = clamp(option, 0, numberOfItems - 1);
 	if (newSel != curOption) {
-		if (!getItem(newSel)->isEnabled()) {
+		// Items of a virtual list only exist while in view
+		auto newItem = tryGetItem(newSel);
+		if (newItem && !newItem->isEnabled()) {
 			return false;
 		}
 
 		if (curOption >= 0 && curOption < numberOfItems) {
-			getItem(curOption)->setSelected(false);
+			auto prevItem = tryGetItem(curOption);
+			if (prevItem) {
+				prevItem->setSelected(false);
+			}
 		}
 		curOption = newSel;
-		auto curItem = getItem(curOption);
-		curItem->setSelected(true);
+		if (newItem) {
+			newItem->setSelected(true);
+		}
+		const auto curId = getOptionId(curOption);
 
 		playSound(style.getString("selectionChangedSound"));
 
-		sendEvent(UIEvent(UIEventType::ListSelectionChanged, getId(), curItem->getId(), curOption));
+		sendEvent(UIEvent(UIEventType::ListSelectionChanged, getId(), curId, curOption));
 		sendEvent(UIEvent(UIEventType::MakeAreaVisible, getId(), getOptionRect(curOption)));
 		
 		if (getDataBindFormat() == UIDataBind::Format::String) {
-			notifyDataBind(curItem->getId());
+			notifyDataBind(curId);
 		} else {
 			notifyDataBind(curOption);
 		}
@@ -66,7 +73,7 @@ String UIList::getSelectedOptionId() const
 	if (curOption < 0 || curOption >= int(getNumberOfItems())) {
 		return "";
 	}
-	return getItem(curOption)->getId();
+	return getOptionId(curOption);
 }
 
 size_t UIList::getCount() const
@@ -113,6 +120,20 @@ void UIList::clear()
 	curOption = -1;
 	curOptionHighlight = -1;
 	getSizer().clear();
+
+	for (auto& v: virtualItems) {
+		v.item->destroy();
+	}
+	for (auto& v: virtualPool) {
+		v.item->destroy();
+	}
+	virtualItems.clear();
+	virtualPool.clear();
+	virtualItemSizes.clear();
+	virtualItemOffsets.clear();
+	virtualCount = 0;
+	virtualCrossSize = 0;
+	dataSource.reset();
 }
 
 void UIList::setItemEnabled(const String& id, bool enabled)
@@ -153,6 +174,10 @@ void UIList::setItemActive(const String& id, bool active)
 
 void UIList::addItem(std::shared_ptr<UIListItem> item)
 {
+	if (dataSource) {
+		throw Exception("Can't add items to a list that has a data source", HalleyExceptions::UI);
+	}
+
 	add(item, uniformSizedItems ? 1.0f : 0.0f);
 	bool wasEmpty = getNumberOfItems() == 0;
 	items.push_back(item);
@@ -172,12 +197,12 @@ void UIList::draw(UIPainter& painter) const
 
 void UIList::onAccept()
 {
-	sendEvent(UIEvent(UIEventType::ListAccept, getId(), getItem(curOption)->getId(), curOption));
+	sendEvent(UIEvent(UIEventType::ListAccept, getId(), getOptionId(curOption), curOption));
 }
 
 void UIList::onCancel()
 {
-	sendEvent(UIEvent(UIEventType::ListCancel, getId(), getItem(curOption)->getId(), curOption));
+	sendEvent(UIEvent(UIEventType::ListCancel, getId(), getOptionId(curOption), curOption));
 }
 
 void UIList::reassignIds()
@@ -194,9 +219,42 @@ void UIList::reassignIds()
 
 std::shared_ptr<UIListItem> UIList::getItem(int n) const
 {
-	if (n < 0) {
+	auto item = tryGetItem(n);
+	if (!item) {
 		throw Exception("Invalid item", HalleyExceptions::UI);
 	}
+	return item;
+}
+
+std::shared_ptr<UIListItem> UIList::getItem(const String& id) const
+{
+	for (auto& item: items) {
+		if (item->getId() == id) {
+			return item;
+		}
+	}
+	for (auto& v: virtualItems) {
+		if (v.item->getId() == id) {
+			return v.item;
+		}
+	}
+	throw Exception("Invalid item", HalleyExceptions::UI);
+}
+
+std::shared_ptr<UIListItem> UIList::tryGetItem(int n) const
+{
+	if (n < 0) {
+		return {};
+	}
+
+	if (dataSource) {
+		auto iter = std::lower_bound(virtualItems.begin(), virtualItems.end(), size_t(n), [] (const VirtualItem& v, size_t index) { return v.index < index; });
+		if (iter != virtualItems.end() && iter->index == size_t(n)) {
+			return iter->item;
+		}
+		return {};
+	}
+
 	int i = 0;
 	for (auto& item: items) {
 		if (item->isActive() && item->isEnabled()) {
@@ -205,22 +263,23 @@ std::shared_ptr<UIListItem> UIList::getItem(int n) const
 			}
 		}
 	}
-	throw Exception("Invalid item", HalleyExceptions::UI);
+	return {};
 }
 
-std::shared_ptr<UIListItem> UIList::getItem(const String& id) const
+String UIList::getOptionId(int n) const
 {
-	for (auto& item: items) {
-		if (item->getId() == id) {
-			return item;
+	if (dataSource) {
+		if (n < 0 || size_t(n) >= virtualCount) {
+			throw Exception("Invalid item", HalleyExceptions::UI);
 		}
+		return dataSource->getItemId(size_t(n));
 	}
-	throw Exception("Invalid item", HalleyExceptions::UI);
+	return getItem(n)->getId();
 }
 
 bool UIList::canDrag() const
 {
-	return dragEnabled;
+	return dragEnabled && !dataSource;
 }
 
 void UIList::setDrag(bool drag)
@@ -233,8 +292,274 @@ void UIList::setUniformSizedItems(bool enabled)
 	uniformSizedItems = enabled;
 }
 
+void UIList::setDataSource(std::shared_ptr<IUIListDataSource> source, Maybe<float> fixedItemSize)
+{
+	if (orientation == UISizerType::Grid) {
+		throw Exception("Lists with a data source can't be grids", HalleyExceptions::UI);
+	}
+
+	clear();
+	dataSource = std::move(source);
+	virtualFixedItemSize = fixedItemSize;
+	virtualGap = style.getFloat("gap");
+	refreshDataSource();
+}
+
+std::shared_ptr<IUIListDataSource> UIList::getDataSource() const
+{
+	return dataSource;
+}
+
+void UIList::refreshDataSource()
+{
+	if (!dataSource) {
+		return;
+	}
+
+	// Anything in view might now be showing a different item, so fill them again on the next update
+	for (auto& v: virtualItems) {
+		releaseVirtualItem(std::move(v));
+	}
+	virtualItems.clear();
+
+	virtualCount = dataSource->getCount();
+	if (!virtualFixedItemSize) {
+		virtualItemSizes.resize(virtualCount);
+		for (size_t i = 0; i < virtualCount; ++i) {
+			virtualItemSizes[i] = dataSource->getEstimatedItemSize(i);
+		}
+		updateVirtualOffsets();
+	}
+	markAsNeedingLayout();
+
+	if (curOption < 0 || curOption >= int(virtualCount)) {
+		curOption = -1;
+		setSelectedOption(0);
+	}
+}
+
+Vector2f UIList::getLayoutMinimumSize(bool force) const
+{
+	auto size = UIWidget::getLayoutMinimumSize(force);
+	if (dataSource && (force || isActive())) {
+		// The whole list is measured as if every item existed, so scroll panes work out the right range
+		const auto border = getInnerBorder();
+		const float length = getVirtualContentsSize();
+		const auto contentsSize = getVirtualAxis() == 0 ? Vector2f(length, virtualCrossSize) : Vector2f(virtualCrossSize, length);
+		size = Vector2f::max(size, contentsSize + Vector2f(border.x + border.z, border.y + border.w));
+	}
+	return size;
+}
+
+void UIList::setRect(Rect4f rect)
+{
+	UIWidget::setRect(rect);
+	if (dataSource) {
+		placeVirtualItems();
+	}
+}
+
+void UIList::updateVirtualItems()
+{
+	const int axis = getVirtualAxis();
+	const auto border = getInnerBorder();
+	const float origin = getLayoutOriginPosition()[axis] + (axis == 0 ? border.x : border.y);
+
+	// Find the part of the list that can be seen, i.e. inside the scroll pane (which sets the mouse clip) and the screen
+	float viewStart = getPosition()[axis];
+	float viewEnd = viewStart + getSize()[axis];
+	auto clipView = [&] (Rect4f rect)
+	{
+		viewStart = std::max(viewStart, rect.getTopLeft()[axis]);
+		viewEnd = std::min(viewEnd, rect.getBottomRight()[axis]);
+	};
+	if (getMouseClip()) {
+		clipView(getMouseClip().get());
+	}
+	if (getRoot()) {
+		clipView(getRoot()->getRect());
+	}
+
+	// Keep some items either side, so they're ready before they scroll into view
+	const float margin = std::max(0.0f, viewEnd - viewStart) * 0.5f;
+	const float from = viewStart - margin - origin;
+	const float to = viewEnd + margin - origin;
+	const bool anyInView = virtualCount > 0 && to > from && to >= 0 && from <= getVirtualContentsSize();
+	const size_t first = anyInView ? getVirtualItemAt(from) : 0;
+	const size_t last = anyInView ? getVirtualItemAt(to) : 0;
+
+	if (anyInView && virtualItems.size() == last - first + 1 && virtualItems.front().index == first && virtualItems.back().index == last) {
+		return;
+	}
+
+	// Recycle the ones that went out of view first, so they can be reused for the ones that came in
+	bool changed = false;
+	std::vector<VirtualItem> kept;
+	for (auto& v: virtualItems) {
+		if (anyInView && v.index >= first && v.index <= last) {
+			kept.push_back(std::move(v));
+		} else {
+			releaseVirtualItem(std::move(v));
+			changed = true;
+		}
+	}
+
+	std::vector<VirtualItem> inView;
+	size_t next = first;
+	for (auto& v: kept) {
+		for (; next < v.index; ++next) {
+			inView.push_back(acquireVirtualItem(next));
+			changed = true;
+		}
+		next = v.index + 1;
+		inView.push_back(std::move(v));
+	}
+	for (; anyInView && next <= last; ++next) {
+		inView.push_back(acquireVirtualItem(next));
+		changed = true;
+	}
+	virtualItems = std::move(inView);
+
+	if (!changed) {
+		return;
+	}
+
+	// Replace the estimates with the actual sizes of the new items
+	bool resized = false;
+	for (auto& v: virtualItems) {
+		const auto itemSize = v.item->getLayoutMinimumSize(false);
+		if (itemSize[1 - axis] > virtualCrossSize) {
+			virtualCrossSize = itemSize[1 - axis];
+		}
+		if (!virtualFixedItemSize && std::abs(itemSize[axis] - virtualItemSizes[v.index]) > 0.01f) {
+			virtualItemSizes[v.index] = itemSize[axis];
+			resized = true;
+		}
+	}
+	if (resized) {
+		updateVirtualOffsets();
+	}
+
+	markAsNeedingLayout();
+	placeVirtualItems();
+}
+
+UIList::VirtualItem UIList::acquireVirtualItem(size_t index)
+{
+	VirtualItem v;
+	if (virtualPool.empty()) {
+		v.item = std::make_shared<UIListItem>("", *this, style.getSubStyle("item"), int(index), style.getBorder("extraMouseBorder"));
+		addChild(v.item);
+	} else {
+		v = std::move(virtualPool.back());
+		virtualPool.pop_back();
+		v.item->setActive(true);
+	}
+
+	v.index = index;
+	v.item->setId(dataSource->getItemId(index));
+	v.item->setIndex(int(index));
+	v.item->setMouseClip(getMouseClip());
+
+	auto contents = dataSource->getItemContents(index, v.contents);
+	if (contents != v.contents) {
+		v.item->getSizer().clear();
+		v.item->add(contents, 0, {}, dataSource->getItemFillFlags());
+		v.contents = std::move(contents);
+	}
+
+	v.item->setSelected(int(index) == curOption);
+	return v;
+}
+
+void UIList::releaseVirtualItem(VirtualItem v)
+{
+	v.item->setSelected(false);
+	v.item->setActive(false);
+	virtualPool.push_back(std::move(v));
+}
+
+void UIList::placeVirtualItems()
+{
+	for (auto& v: virtualItems) {
+		v.item->setRect(getVirtualItemRect(v.index));
+	}
+}
+
+void UIList::updateVirtualOffsets()
+{
+	virtualItemOffsets.resize(virtualCount + 1);
+	float pos = 0;
+	for (size_t i = 0; i < virtualCount; ++i) {
+		virtualItemOffsets[i] = pos;
+		pos += virtualItemSizes[i] + virtualGap;
+	}
+	virtualItemOffsets[virtualCount] = pos;
+}
+
+int UIList::getVirtualAxis() const
+{
+	return orientation == UISizerType::Horizontal ? 0 : 1;
+}
+
+float UIList::getVirtualItemOffset(size_t index) const
+{
+	if (virtualFixedItemSize) {
+		return float(index) * (virtualFixedItemSize.get() + virtualGap);
+	}
+	return virtualItemOffsets[index];
+}
+
+float UIList::getVirtualItemSize(size_t index) const
+{
+	if (virtualFixedItemSize) {
+		return virtualFixedItemSize.get();
+	}
+	return virtualItemSizes[index];
+}
+
+float UIList::getVirtualContentsSize() const
+{
+	if (virtualCount == 0) {
+		return 0;
+	}
+	return getVirtualItemOffset(virtualCount - 1) + getVirtualItemSize(virtualCount - 1);
+}
+
+size_t UIList::getVirtualItemAt(float pos) const
+{
+	Expects(virtualCount > 0);
+
+	if (virtualFixedItemSize) {
+		const auto index = int(std::floor(pos / (virtualFixedItemSize.get() + virtualGap)));
+		return size_t(clamp(index, 0, int(virtualCount) - 1));
+	}
+
+	const auto iter = std::upper_bound(virtualItemOffsets.begin(), virtualItemOffsets.begin() + virtualCount, pos);
+	return size_t(clamp(int(iter - virtualItemOffsets.begin()) - 1, 0, int(virtualCount) - 1));
+}
+
+Rect4f UIList::getVirtualItemRect(size_t index) const
+{
+	const auto border = getInnerBorder();
+	const auto origin = getLayoutOriginPosition() + Vector2f(border.x, border.y);
+	const auto innerSize = getSize() - Vector2f(border.x + border.z, border.y + border.w);
+	const float offset = getVirtualItemOffset(index);
+	const float size = getVirtualItemSize(index);
+
+	if (getVirtualAxis() == 0) {
+		return Rect4f(origin + Vector2f(offset, 0), origin + Vector2f(offset + size, innerSize.y));
+	} else {
+		return Rect4f(origin + Vector2f(0, offset), origin + Vector2f(innerSize.x, offset + size));
+	}
+}
+
 size_t UIList::getNumberOfItems() const
 {
+	if (dataSource) {
+		return virtualCount;
+	}
+
 	size_t n = 0;
 	for (auto& item: items) {
 		if (item->isActive() && item->isEnabled()) {
@@ -280,7 +605,7 @@ void UIList::onInput(const UIInputResults& input, Time time)
 	Expects(nColumns >= 1);
 
 	// Drag
-	if (dragEnabled && input.isButtonHeld(UIInput::Button::Hold)) {
+	if (canDrag() && input.isButtonHeld(UIInput::Button::Hold)) {
 		// Manual dragging
 		manualDragging = true;
 
@@ -358,6 +683,10 @@ void UIList::onInput(const UIInputResults& input, Time time)
 
 void UIList::update(Time t, bool moved)
 {
+	if (dataSource) {
+		updateVirtualItems();
+	}
+
 	if (moved) {
 		if (sprite.hasMaterial()) {
 			sprite.scaleTo(getSize()).setPos(getPosition());
@@ -373,7 +702,9 @@ void UIList::update(Time t, bool moved)
 void UIList::onItemClicked(UIListItem& item)
 {
 	setSelectedOption(item.getIndex());
-	sendEvent(UIEvent(UIEventType::ListAccept, getId(), curOption));
+	if (curOption >= 0) {
+		sendEvent(UIEvent(UIEventType::ListAccept, getId(), getOptionId(curOption), curOption));
+	}
 }
 
 void UIList::onItemDragged(UIListItem& item, int index, Vector2f pos)
@@ -613,6 +944,16 @@ Vector2f UIListItem::getOrigPosition() const
 
 bool UIList::setSelectedOptionId(const String& id)
 {
+	if (dataSource) {
+		for (size_t i = 0; i < virtualCount; ++i) {
+			if (dataSource->getItemId(i) == id) {
+				setSelectedOption(int(i));
+				return true;
+			}
+		}
+		return false;
+	}
+
 	for (auto& i: items) {
 		if (i->getId() == id) {
 			if (i->isActive()) {
@@ -628,6 +969,8 @@ Rect4f UIList::getOptionRect(int curOption) const
 {
 	if (getNumberOfItems() == 0) {
 		return Rect4f();
+	} else if (dataSource) {
+		return getVirtualItemRect(size_t(clamp(curOption, 0, int(virtualCount) - 1))) - getPosition();
 	} else {
 		const auto item = getItem(clamp(curOption, 0, int(getNumberOfItems()) - 1));
 		return item->getRawRect() - getPosition();
@@ -660,3 +1003,57 @@ void UIList::readFromDataBind()
 		setSelectedOption(data->getIntData());
 	}
 }
+
+
+UIListTextSource::UIListTextSource(UIStyle style, std::vector<String> ids, std::vector<LocalisedString> labels, bool centre)
+	: style(style)
+	, ids(std::move(ids))
+	, labels(std::move(labels))
+	, centre(centre)
+{
+	if (this->ids.size() != this->labels.size()) {
+		throw Exception("Size mismatch between ids and labels", HalleyExceptions::UI);
+	}
+
+	const auto itemBorder = style.getSubStyle("item").getBorder("innerBorder");
+	estimatedSize = style.getTextRenderer("label").getLineHeight() + itemBorder.y + itemBorder.w;
+}
+
+size_t UIListTextSource::getCount() const
+{
+	return ids.size();
+}
+
+String UIListTextSource::getItemId(size_t index) const
+{
+	return ids[index];
+}
+
+float UIListTextSource::getEstimatedItemSize(size_t index) const
+{
+	return estimatedSize;
+}
+
+std::shared_ptr<IUIElement> UIListTextSource::getItemContents(size_t index, std::shared_ptr<IUIElement> recycled)
+{
+	auto label = std::dynamic_pointer_cast<UILabel>(recycled);
+	if (label) {
+		label->setId(ids[index] + "_label");
+		label->setText(labels[index]);
+		return label;
+	}
+
+	label = std::make_shared<UILabel>(ids[index] + "_label", style.getTextRenderer("label"), labels[index]);
+	if (style.hasTextRenderer("selectedLabel")) {
+		label->setSelectable(style.getTextRenderer("label"), style.getTextRenderer("selectedLabel"));
+	}
+	if (style.hasTextRenderer("disabledStyle")) {
+		label->setDisablable(style.getTextRenderer("label"), style.getTextRenderer("disabledStyle"));
+	}
+	return label;
+}
+
+int UIListTextSource::getItemFillFlags() const
+{
+	return centre ? UISizerAlignFlags::CentreHorizontal : UISizerFillFlags::Fill;
+}
@@ -92,8 +92,15 @@ float UIScrollPane::getCoverageSize(UIScrollDirection direction) const
 
 void UIScrollPane::drawChildren(UIPainter& painter) const
 {
-	auto p = painter.withClip(Rect4f(getPosition(), getPosition() + getSize()));
-	UIWidget::drawChildren(p);
+	const auto rect = Rect4f(getPosition(), getPosition() + getSize());
+	auto p = painter.withClip(rect);
+
+	// Anything scrolled out of view would be clipped away entirely anyway
+	for (auto& c: getChildren()) {
+		if (c->getRect().overlaps(rect)) {
+			c->doDraw(p);
+		}
+	}
 }
 
 Vector2f UIScrollPane::getLayoutMinimumSize(bool force) const
@@ -34,6 +34,13 @@ Rename this file to lodepng.cpp to use it for C++, or to lodepng.c to use it for
 #include <stdio.h>
 #include <stdlib.h>
 
+/*Halley: SSE2 unfiltering for 4 byte pixels, see unfilterScanline4SSE2*/
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define LODEPNG_SSE2
+#include <emmintrin.h>
+#include <string.h>
+#endif
+
 #if defined(_MSC_VER) && (_MSC_VER >= 1310) /*Visual Studio: A few warning types are not desired here.*/
 #pragma warning( disable : 4244 ) /*implicit conversions: not warned by gcc -Wall -Wextra and requires too much casts*/
 #pragma warning( disable : 4996 ) /*VS does not like fopen, but fopen_s is not standard C so unusable here*/
@@ -3961,6 +3968,109 @@ unsigned lodepng_inspect(unsigned* w, unsigned* h, LodePNGState* state,
   return state->error;
 }
 
+#ifdef LODEPNG_SSE2
+static __m128i load4SSE2(const unsigned char* p)
+{
+  int v;
+  memcpy(&v, p, 4);
+  return _mm_cvtsi32_si128(v);
+}
+
+static void store4SSE2(unsigned char* p, __m128i v)
+{
+  int r = _mm_cvtsi128_si32(v);
+  memcpy(p, &r, 4);
+}
+
+static __m128i abs16SSE2(__m128i x)
+{
+  __m128i negative = _mm_cmplt_epi16(x, _mm_setzero_si128());
+  return _mm_sub_epi16(_mm_xor_si128(x, negative), negative);
+}
+
+static __m128i selectSSE2(__m128i mask, __m128i a, __m128i b)
+{
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+/*
+Halley: RGBA8 versions of the filters which depend on the previous pixel. These can't be vectorised across pixels,
+but all four channels of a pixel are done at once. Returns 0 if the filter type isn't handled here.
+Same aliasing rules as unfilterScanline.
+*/
+static int unfilterScanline4SSE2(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                                 unsigned char filterType, size_t length)
+{
+  size_t i;
+  const __m128i zero = _mm_setzero_si128();
+  switch(filterType)
+  {
+    case 1:
+    {
+      __m128i a = zero;
+      for(i = 0; i != length; i += 4)
+      {
+        a = _mm_add_epi8(a, load4SSE2(&scanline[i]));
+        store4SSE2(&recon[i], a);
+      }
+      return 1;
+    }
+    case 2:
+    {
+      if(!precon) return 0;
+      for(i = 0; i + 16 <= length; i += 16)
+      {
+        __m128i x = _mm_loadu_si128((const __m128i*)&scanline[i]);
+        __m128i b = _mm_loadu_si128((const __m128i*)&precon[i]);
+        _mm_storeu_si128((__m128i*)&recon[i], _mm_add_epi8(x, b));
+      }
+      for(; i != length; ++i) recon[i] = scanline[i] + precon[i];
+      return 1;
+    }
+    case 3:
+    {
+      /*_mm_avg_epu8 rounds up, so take off the carried bit to floor it*/
+      const __m128i one = _mm_set1_epi8(1);
+      __m128i a = zero;
+      if(!precon) return 0;
+      for(i = 0; i != length; i += 4)
+      {
+        __m128i b = load4SSE2(&precon[i]);
+        __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+        a = _mm_add_epi8(load4SSE2(&scanline[i]), avg);
+        store4SSE2(&recon[i], a);
+      }
+      return 1;
+    }
+    case 4:
+    {
+      /*a, b and c as in paethPredictor, widened to 16 bits*/
+      __m128i a = zero, c = zero;
+      if(!precon) return 0;
+      for(i = 0; i != length; i += 4)
+      {
+        __m128i b = _mm_unpacklo_epi8(load4SSE2(&precon[i]), zero);
+        __m128i pa = _mm_sub_epi16(b, c);
+        __m128i pb = _mm_sub_epi16(a, c);
+        __m128i pc = abs16SSE2(_mm_add_epi16(pa, pb));
+        __m128i smallest;
+        __m128i predictor;
+        pa = abs16SSE2(pa);
+        pb = abs16SSE2(pb);
+        smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+        predictor = selectSSE2(_mm_cmpeq_epi16(pa, smallest), a, selectSSE2(_mm_cmpeq_epi16(pb, smallest), b, c));
+        a = _mm_add_epi8(_mm_unpacklo_epi8(load4SSE2(&scanline[i]), zero), predictor);
+        a = _mm_and_si128(a, _mm_set1_epi16(0xFF));
+        store4SSE2(&recon[i], _mm_packus_epi16(a, a));
+        c = b;
+      }
+      return 1;
+    }
+    default: return 0;
+  }
+}
+#endif /*LODEPNG_SSE2*/
+
 static unsigned unfilterScanline(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
                                  size_t bytewidth, unsigned char filterType, size_t length)
 {
@@ -3974,6 +4084,9 @@ static unsigned unfilterScanline(unsigned char* recon, const unsigned char* scan
   */
 
   size_t i;
+#ifdef LODEPNG_SSE2
+  if(bytewidth == 4 && unfilterScanline4SSE2(recon, scanline, precon, filterType, length)) return 0;
+#endif
   switch(filterType)
   {
     case 0:
@@ -2,6 +2,7 @@
 
 #include <gsl/gsl>
 #include <memory>
+#include <vector>
 
 struct SpeexResamplerState_;
 typedef struct SpeexResamplerState_ SpeexResamplerState;
@@ -14,6 +15,8 @@ namespace Halley
 		size_t nWritten;
 	};
 
+	// Ratios that reduce to a small fraction (44.1 <-> 48 kHz, 2x, most pitch shifts by round amounts) go through
+	// precomputed polyphase filters, with the channels processed together. Anything else uses speex.
 	class AudioResampler
 	{
 	public:
@@ -23,12 +26,35 @@ namespace Halley
 		AudioResamplerResult resample(gsl::span<const float> src, gsl::span<float> dst, size_t channel);
 		AudioResamplerResult resampleInterleaved(gsl::span<const float> src, gsl::span<float> dst);
 		AudioResamplerResult resampleInterleaved(gsl::span<const short> src, gsl::span<short> dst);
+
+		// One span per channel, all resampled in lockstep; the counts are per channel
+		AudioResamplerResult resampleChannels(gsl::span<const gsl::span<const float>> src, gsl::span<const gsl::span<float>> dst);
+
 		size_t numOutputSamples(size_t numInputSamples) const;
+		bool isPolyphase() const;
 
 	private:
+		struct PolyphaseChannel
+		{
+			std::vector<float> buffer; // The last numTaps - 1 input samples, then whatever is being resampled
+			size_t position = 0; // Of the next output, in 1/numPhases of an input sample
+		};
+
 		std::unique_ptr<SpeexResamplerState, void(*)(SpeexResamplerState*)> resampler;
 		size_t nChannels;
 		int from;
 		int to;
+
+		size_t numPhases = 0;
+		size_t phaseStep = 0;
+		size_t numTaps = 0;
+		std::vector<float> taps; // numTaps per phase
+		std::vector<PolyphaseChannel> channels;
+		std::vector<float> scratch;
+		std::vector<float*> outputs;
+
+		bool makePolyphase(float quality);
+		float* getPolyphaseInput(size_t channel, size_t nIn);
+		size_t runPolyphase(size_t firstChannel, size_t numChannels, size_t nIn, size_t maxOut, size_t dstStride);
 	};
-}
\ No newline at end of file
+}
@@ -4,6 +4,7 @@
 #include <vector>
 #include <gsl/gsl>
 #include "halley/data_structures/flat_map.h"
+#include "halley/data_structures/flat_hash_map.h"
 #include "halley/maths/vector2.h"
 #include "halley/maths/rect.h"
 #include "halley/file/path.h"
@@ -14,45 +15,73 @@
 #include <set>
 #include <boost/optional.hpp>
 #include "halley/maths/vector4.h"
+#include "halley/maths/range.h"
+#include "halley/support/exception.h"
+#include <limits>
+#include <string>
 
 namespace Halley {
 	class String;
 
+	struct SerializerOptions {
+		// Compact mode packs data at the bit level: bools take one bit, wider integers are (zig-zag) varints,
+		// and quantized values take only the bits asked for. Meant for network packets and save data.
+		bool compact = false;
+
+		// In compact mode, each distinct string is only written out the first time, and referenced by index afterwards.
+		bool stringTable = true;
+	};
+
+	// Types whose in-memory layout is exactly what the (non-compact) serializer writes out for them, so that
+	// arrays of them can be copied in one go
+	template <typename T>
+	struct IsPodSerializable : std::integral_constant<bool, (std::is_arithmetic<T>::value || std::is_enum<T>::value) && !std::is_same<T, bool>::value> {};
+
+	template <typename T, typename U>
+	struct IsPodSerializable<Vector2D<T, U>> : std::integral_constant<bool, IsPodSerializable<T>::value && sizeof(Vector2D<T, U>) == 2 * sizeof(T)> {};
+
+	template <typename T>
+	struct IsPodSerializable<Vector4D<T>> : std::integral_constant<bool, IsPodSerializable<T>::value && sizeof(Vector4D<T>) == 4 * sizeof(T)> {};
+
 	class Serializer {
 	public:
-		Serializer();
-		explicit Serializer(gsl::span<gsl::byte> dst);
+		Serializer(SerializerOptions options = {});
+		explicit Serializer(gsl::span<gsl::byte> dst, SerializerOptions options = {});
+		explicit Serializer(Bytes& dst, SerializerOptions options = {}); // Replaces the contents of dst, growing it as needed
 
 		template <typename T, typename std::enable_if<std::is_convertible<T, std::function<void(Serializer&)>>::value, int>::type = 0>
-		static Bytes toBytes(const T& f)
+		static Bytes toBytes(const T& f, SerializerOptions options = {})
 		{
-			Serializer dry;
-			f(dry);
-			Bytes result(dry.getSize());
-			Serializer s(gsl::as_writeable_bytes(gsl::span<Halley::Byte>(result)));
+			Bytes result;
+			Serializer s(result, options);
 			f(s);
 			return result;
 		}
 
 		template <typename T, typename std::enable_if<!std::is_convertible<T, std::function<void(Serializer&)>>::value, int>::type = 0>
-		static Bytes toBytes(const T& value)
+		static Bytes toBytes(const T& value, SerializerOptions options = {})
 		{
-			return toBytes([&value](Serializer& s) { s << value; });
+			return toBytes([&value](Serializer& s) { s << value; }, options);
 		}
 
-		size_t getSize() const { return size; }
+		size_t getSize() const { return options.compact ? (bitPos + 7) / 8 : size; }
+		const SerializerOptions& getOptions() const { return options; }
+
+		Serializer& operator<<(bool val) { return options.compact ? writeBits(val ? 1 : 0, 1) : serializePod(val); }
+		Serializer& operator<<(int8_t val) { return options.compact ? writeBits(uint8_t(val), 8) : serializePod(val); }
+		Serializer& operator<<(uint8_t val) { return options.compact ? writeBits(val, 8) : serializePod(val); }
+		Serializer& operator<<(int16_t val) { return options.compact ? writeVarInt(val) : serializePod(val); }
+		Serializer& operator<<(uint16_t val) { return options.compact ? writeVarUInt(val) : serializePod(val); }
+		Serializer& operator<<(int32_t val) { return options.compact ? writeVarInt(val) : serializePod(val); }
+		Serializer& operator<<(uint32_t val) { return options.compact ? writeVarUInt(val) : serializePod(val); }
+		Serializer& operator<<(int64_t val) { return options.compact ? writeVarInt(val) : serializePod(val); }
+		Serializer& operator<<(uint64_t val) { return options.compact ? writeVarUInt(val) : serializePod(val); }
+		Serializer& operator<<(float val) { return options.compact ? writePodBits(val) : serializePod(val); }
+		Serializer& operator<<(double val) { return options.compact ? writePodBits(val) : serializePod(val); }
 
-		Serializer& operator<<(bool val) { return serializePod(val); }
-		Serializer& operator<<(int8_t val) { return serializePod(val); }
-		Serializer& operator<<(uint8_t val) { return serializePod(val); }
-		Serializer& operator<<(int16_t val) { return serializePod(val); }
-		Serializer& operator<<(uint16_t val) { return serializePod(val); }
-		Serializer& operator<<(int32_t val) { return serializePod(val); }
-		Serializer& operator<<(uint32_t val) { return serializePod(val); }
-		Serializer& operator<<(int64_t val) { return serializePod(val); }
-		Serializer& operator<<(uint64_t val) { return serializePod(val); }
-		Serializer& operator<<(float val) { return serializePod(val); }
-		Serializer& operator<<(double val) { return serializePod(val); }
+		// Stores the value in the given number of bits (up to 32), clamped to the range. Only quantized in compact mode.
+		Serializer& serializeQuantized(float value, Range<float> range, int bits);
+		Serializer& serializeQuantized(Vector2f value, Range<float> range, int bits);
 
 		Serializer& operator<<(const std::string& str);
 		Serializer& operator<<(const String& str);
@@ -65,9 +94,7 @@ namespace Halley {
 		{
 			unsigned int sz = static_cast<unsigned int>(val.size());
 			*this << sz;
-			for (unsigned int i = 0; i < sz; i++) {
-				*this << val[i];
-			}
+			serializeElements(val, IsPodSerializable<T>());
 			return *this;
 		}
 
@@ -101,6 +128,16 @@ namespace Halley {
 			return (*this << m);
 		}
 
+		template <typename T, typename U>
+		Serializer& operator<<(const FlatHashMap<T, U>& val)
+		{
+			std::map<T, U> m;
+			for (auto& kv: val) {
+				m[kv.first] = kv.second;
+			}
+			return (*this << m);
+		}
+
 		template <typename T>
 		Serializer& operator<<(const std::set<T>& val)
 		{
@@ -169,67 +206,119 @@ namespace Halley {
 	private:
 		bool dryRun;
 		size_t size = 0;
+		size_t bitPos = 0;
 		gsl::span<gsl::byte> dst;
+		Bytes* growable = nullptr;
+		SerializerOptions options;
+		std::unordered_map<std::string, uint32_t> stringTable;
 
 		template <typename T>
 		Serializer& serializePod(T val)
 		{
 			if (!dryRun) {
+				ensureSize(size + sizeof(T));
 				memcpy(dst.data() + size, &val, sizeof(T));
 			}
 			size += sizeof(T);
 			return *this;
 		}
+
+		template <typename T>
+		void serializeElements(const std::vector<T>& val, std::true_type)
+		{
+			if (options.compact) {
+				serializeElements(val, std::false_type());
+			} else {
+				writeRawBytes(gsl::as_bytes(gsl::span<const T>(val.data(), val.size())));
+			}
+		}
+
+		template <typename T>
+		void serializeElements(const std::vector<T>& val, std::false_type)
+		{
+			for (size_t i = 0; i < val.size(); i++) {
+				*this << val[i];
+			}
+		}
+
+		void ensureSize(size_t bytes)
+		{
+			if (growable && bytes > size_t(dst.size())) {
+				grow(bytes);
+			}
+		}
+
+		template <typename T>
+		Serializer& writePodBits(T val)
+		{
+			static_assert(sizeof(T) == 4 || sizeof(T) == 8, "Only 32 and 64-bit values supported");
+			using U = typename std::conditional<sizeof(T) == 4, uint32_t, uint64_t>::type;
+			U bits;
+			memcpy(&bits, &val, sizeof(T));
+			return writeBits(bits, int(sizeof(T) * 8));
+		}
+
+		Serializer& writeBits(uint64_t value, int nBits);
+		Serializer& writeVarUInt(uint64_t value);
+		Serializer& writeVarInt(int64_t value);
+		void alignToByte();
+		void writeRawBytes(gsl::span<const gsl::byte> bytes);
+		void grow(size_t bytes);
 	};
 
 	class Deserializer {
 	public:
-		Deserializer(gsl::span<const gsl::byte> src);
-		explicit Deserializer(const Bytes& src);
+		Deserializer(gsl::span<const gsl::byte> src, SerializerOptions options = {});
+		explicit Deserializer(const Bytes& src, SerializerOptions options = {});
 		
 		template <typename T>
-		static T fromBytes(const Bytes& src)
+		static T fromBytes(const Bytes& src, SerializerOptions options = {})
 		{
 			T result;
-			Deserializer s(src);
+			Deserializer s(src, options);
 			s >> result;
 			return result;
 		}
 
 		template <typename T>
-		static T fromBytes(gsl::span<const gsl::byte> src)
+		static T fromBytes(gsl::span<const gsl::byte> src, SerializerOptions options = {})
 		{
 			T result;
-			Deserializer s(src);
+			Deserializer s(src, options);
 			s >> result;
 			return result;
 		}
 
 		template <typename T>
-		static void fromBytes(T& target, const Bytes& src)
+		static void fromBytes(T& target, const Bytes& src, SerializerOptions options = {})
 		{
-			Deserializer s(src);
+			Deserializer s(src, options);
 			s >> target;
 		}
 
 		template <typename T>
-		static void fromBytes(T& target, gsl::span<const gsl::byte> src)
+		static void fromBytes(T& target, gsl::span<const gsl::byte> src, SerializerOptions options = {})
 		{
-			Deserializer s(src);
+			Deserializer s(src, options);
 			s >> target;
 		}
 
-		Deserializer& operator>>(bool& val) { return deserializePod(val); }
-		Deserializer& operator>>(int8_t& val) { return deserializePod(val); }
-		Deserializer& operator>>(uint8_t& val) { return deserializePod(val); }
-		Deserializer& operator>>(int16_t& val) { return deserializePod(val); }
-		Deserializer& operator>>(uint16_t& val) { return deserializePod(val); }
-		Deserializer& operator>>(int32_t& val) { return deserializePod(val); }
-		Deserializer& operator>>(uint32_t& val) { return deserializePod(val); }
-		Deserializer& operator>>(int64_t& val) { return deserializePod(val); }
-		Deserializer& operator>>(uint64_t& val) { return deserializePod(val); }
-		Deserializer& operator>>(float& val) { return deserializePod(val); }
-		Deserializer& operator>>(double& val) { return deserializePod(val); }
+		const SerializerOptions& getOptions() const { return options; }
+
+		Deserializer& operator>>(bool& val);
+		Deserializer& operator>>(int8_t& val) { return options.compact ? readBitsInto(val, 8) : deserializePod(val); }
+		Deserializer& operator>>(uint8_t& val) { return options.compact ? readBitsInto(val, 8) : deserializePod(val); }
+		Deserializer& operator>>(int16_t& val) { return options.compact ? readVarIntInto(val) : deserializePod(val); }
+		Deserializer& operator>>(uint16_t& val) { return options.compact ? readVarUIntInto(val) : deserializePod(val); }
+		Deserializer& operator>>(int32_t& val) { return options.compact ? readVarIntInto(val) : deserializePod(val); }
+		Deserializer& operator>>(uint32_t& val) { return options.compact ? readVarUIntInto(val) : deserializePod(val); }
+		Deserializer& operator>>(int64_t& val) { return options.compact ? readVarIntInto(val) : deserializePod(val); }
+		Deserializer& operator>>(uint64_t& val) { return options.compact ? readVarUIntInto(val) : deserializePod(val); }
+		Deserializer& operator>>(float& val) { return options.compact ? readPodBits(val) : deserializePod(val); }
+		Deserializer& operator>>(double& val) { return options.compact ? readPodBits(val) : deserializePod(val); }
+
+		Deserializer& deserializeQuantized(float& value, Range<float> range, int bits);
+		Deserializer& deserializeQuantized(Vector2f& value, Range<float> range, int bits);
 
 		Deserializer& operator>>(std::string& str);
 		Deserializer& operator>>(String& str);
@@ -242,14 +331,9 @@ namespace Halley {
 		{
 			unsigned int sz;
 			*this >> sz;
-			ensureSufficientBytesRemaining(sz); // Expect at least one byte per vector entry
+			ensureSufficientElementsRemaining(sz); // Expect at least one byte (or bit, if compact) per vector entry
 
-			val.clear();
-			val.reserve(sz);
-			for (unsigned int i = 0; i < sz; i++) {
-				val.push_back(T());
-				*this >> val[i];
-			}
+			deserializeElements(val, sz, IsPodSerializable<T>());
 			return *this;
 		}
 
@@ -258,7 +342,7 @@ namespace Halley {
 		{
 			unsigned int sz;
 			*this >> sz;
-			ensureSufficientBytesRemaining(sz * 2); // Expect at least two bytes per map entry
+			ensureSufficientElementsRemaining(sz * 2); // Expect at least two bytes (or bits, if compact) per map entry
 
 			std::vector<std::pair<T, U>> tmpData(sz);
 			for (unsigned int i = 0; i < sz; i++) {
@@ -273,7 +357,7 @@ namespace Halley {
 		{
 			unsigned int sz;
 			*this >> sz;
-			ensureSufficientBytesRemaining(sz * 2); // Expect at least two bytes per map entry
+			ensureSufficientElementsRemaining(sz * 2); // Expect at least two bytes (or bits, if compact) per map entry
 
 			for (unsigned int i = 0; i < sz; i++) {
 				T key;
@@ -289,7 +373,7 @@ namespace Halley {
 		{
 			unsigned int sz;
 			*this >> sz;
-			ensureSufficientBytesRemaining(sz * 2); // Expect at least two bytes per map entry
+			ensureSufficientElementsRemaining(sz * 2); // Expect at least two bytes (or bits, if compact) per map entry
 
 			for (unsigned int i = 0; i < sz; i++) {
 				T key;
@@ -300,12 +384,29 @@ namespace Halley {
 			return *this;
 		}
 
+		template <typename T, typename U>
+		Deserializer& operator >> (FlatHashMap<T, U>& val)
+		{
+			unsigned int sz;
+			*this >> sz;
+			ensureSufficientElementsRemaining(sz * 2);
+
+			val.reserve(val.size() + sz);
+			for (unsigned int i = 0; i < sz; i++) {
+				T key;
+				U value;
+				*this >> key >> value;
+				val[std::move(key)] = std::move(value);
+			}
+			return *this;
+		}
+
 		template <typename T>
 		Deserializer& operator>>(std::set<T>& val)
 		{
 			unsigned int sz;
 			*this >> sz;
-			ensureSufficientBytesRemaining(sz); // Expect at least one byte per set entry
+			ensureSufficientElementsRemaining(sz); // Expect at least one byte (or bit, if compact) per set entry
 
 			val.clear();
 			for (unsigned int i = 0; i < sz; i++) {
@@ -392,8 +493,11 @@ namespace Halley {
 
 	private:
 		size_t pos = 0;
+		size_t bitPos = 0;
 		gsl::span<const gsl::byte> src;
 		int version = 0;
+		SerializerOptions options;
+		std::vector<std::string> stringTable;
 
 		template <typename T>
 		Deserializer& deserializePod(T& val)
@@ -404,7 +508,82 @@ namespace Halley {
 			return *this;
 		}
 
+		template <typename T>
+		void deserializeElements(std::vector<T>& val, unsigned int sz, std::true_type)
+		{
+			if (options.compact) {
+				deserializeElements(val, sz, std::false_type());
+				return;
+			}
+
+			// One bounds check for the whole array
+			const size_t bytes = size_t(sz) * sizeof(T);
+			ensureSufficientBytesRemaining(bytes);
+			val.clear();
+			val.resize(sz);
+			if (bytes > 0) {
+				memcpy(val.data(), src.data() + pos, bytes);
+			}
+			pos += bytes;
+		}
+
+		template <typename T>
+		void deserializeElements(std::vector<T>& val, unsigned int sz, std::false_type)
+		{
+			val.clear();
+			val.reserve(sz);
+			for (unsigned int i = 0; i < sz; i++) {
+				val.push_back(T());
+				*this >> val[i];
+			}
+		}
+
+		template <typename T>
+		Deserializer& readBitsInto(T& val, int nBits)
+		{
+			val = T(readBits(nBits));
+			return *this;
+		}
+
+		template <typename T>
+		Deserializer& readVarUIntInto(T& val)
+		{
+			const uint64_t v = readVarUInt();
+			if (v > uint64_t(std::numeric_limits<T>::max())) {
+				throw Exception("Varint out of range", HalleyExceptions::File);
+			}
+			val = T(v);
+			return *this;
+		}
+
+		template <typename T>
+		Deserializer& readVarIntInto(T& val)
+		{
+			const int64_t v = readVarInt();
+			if (v > int64_t(std::numeric_limits<T>::max()) || v < int64_t(std::numeric_limits<T>::min())) {
+				throw Exception("Varint out of range", HalleyExceptions::File);
+			}
+			val = T(v);
+			return *this;
+		}
+
+		template <typename T>
+		Deserializer& readPodBits(T& val)
+		{
+			static_assert(sizeof(T) == 4 || sizeof(T) == 8, "Only 32 and 64-bit values supported");
+			using U = typename std::conditional<sizeof(T) == 4, uint32_t, uint64_t>::type;
+			U bits = U(readBits(int(sizeof(T) * 8)));
+			memcpy(&val, &bits, sizeof(T));
+			return *this;
+		}
+
+		uint64_t readBits(int nBits);
+		uint64_t readVarUInt();
+		int64_t readVarInt();
+		void alignToByte();
+
 		void ensureSufficientBytesRemaining(size_t bytes);
+		void ensureSufficientElementsRemaining(size_t n);
 		size_t getBytesRemaining() const;
 	};
 }
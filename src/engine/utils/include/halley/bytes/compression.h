@@ -1,9 +1,56 @@
 #pragma once
 #include "../utils/utils.h"
+#include "../text/string_converter.h"
 #include <gsl/gsl>
 #include <limits>
+#include <memory>
+
+struct z_stream_s;
 
 namespace Halley {
+	enum class CompressionCodec : uint8_t {
+		None, // Stored as is
+		Deflate // zlib format, as used by Compression
+	};
+
+	template <>
+	struct EnumNames<CompressionCodec> {
+		constexpr std::array<const char*, 2> operator()() const {
+			return{{
+				"none",
+				"deflate"
+			}};
+		}
+	};
+
+	// Compresses data as it comes, so it doesn't all need to be in memory at once. Output is appended to the given
+	// buffer as the codec produces it, which may lag behind the input until flush() or finish().
+	class CompressionStream {
+	public:
+		virtual ~CompressionStream() = default;
+
+		virtual void feed(gsl::span<const gsl::byte> input, Bytes& output) = 0;
+		virtual void flush(Bytes& output) = 0; // Everything so far can be decompressed, and more can still be fed
+		virtual void finish(Bytes& output) = 0; // Ends the stream
+
+		// Level is codec-specific, with -1 being its default
+		static std::unique_ptr<CompressionStream> create(CompressionCodec codec, int level = -1);
+	};
+
+	// Decompresses data as it comes. Input isn't copied: it must stay valid until it's been consumed, which is what lets
+	// this decompress straight out of memory mapped data. Output can be read in pieces of any size.
+	class DecompressionStream {
+	public:
+		virtual ~DecompressionStream() = default;
+
+		virtual void feed(gsl::span<const gsl::byte> input) = 0; // Only once needsInput()
+		virtual size_t read(gsl::span<gsl::byte> output) = 0; // Returns how much was written, which is 0 if it's out of input
+		virtual bool needsInput() const = 0;
+		virtual bool isFinished() const = 0;
+
+		static std::unique_ptr<DecompressionStream> create(CompressionCodec codec);
+	};
+
 	class Compression {
 	public:
 		static Bytes compress(const Bytes& bytes);
@@ -13,6 +60,46 @@ namespace Halley {
 		static std::shared_ptr<const char> decompressToSharedPtr(gsl::span<const gsl::byte> bytes, size_t& outSize, size_t maxSize = std::numeric_limits<size_t>::max());
 
 		static Bytes compressRaw(gsl::span<const gsl::byte> bytes, bool insertLength);
+
+		// Same zlib stream format as compressRaw (without the length), but with blocks deflated in parallel on the
+		// default execution queue. Output is marginally larger, so only worth it on large inputs (e.g. image data).
+		static Bytes compressRawParallel(gsl::span<const gsl::byte> bytes, int level = -1);
 		static Bytes decompressRaw(gsl::span<const gsl::byte> bytes, size_t maxSize, size_t expectedSize = 0);
+
+		// Decompresses into dst, which must be exactly the size of the decompressed data
+		static void decompressRawInto(gsl::span<const gsl::byte> bytes, gsl::span<gsl::byte> dst, CompressionCodec codec = CompressionCodec::Deflate);
+	};
+
+	// Compresses small, independent buffers, such as network packets, against a preset dictionary of typical content.
+	// On buffers this small, the dictionary is where most of the gains come from. Both ends must use the same dictionary.
+	// The zlib state is kept between calls, so this is cheap to call per packet, but it's not thread-safe.
+	class DictionaryCompression {
+	public:
+		explicit DictionaryCompression(Bytes dictionary = {}, int level = 1);
+		~DictionaryCompression();
+
+		Bytes compress(gsl::span<const gsl::byte> bytes);
+		Bytes decompress(gsl::span<const gsl::byte> bytes, size_t maxSize);
+
+	private:
+		Bytes dictionary;
+		std::unique_ptr<z_stream_s> deflater;
+		std::unique_ptr<z_stream_s> inflater;
+	};
+
+	// A deflate stream in each direction, for ordered and reliable transports such as TCP. History carries over from one
+	// buffer to the next, so data that repeats across messages compresses well. Each compressed buffer is flushed,
+	// so it can be decompressed as soon as it arrives, as long as they're all decompressed in order.
+	class StreamCompression {
+	public:
+		explicit StreamCompression(const Bytes& dictionary = {}, int level = 1);
+		~StreamCompression();
+
+		Bytes compress(gsl::span<const gsl::byte> bytes);
+		Bytes decompress(gsl::span<const gsl::byte> bytes, size_t maxSize);
+
+	private:
+		std::unique_ptr<z_stream_s> deflater;
+		std::unique_ptr<z_stream_s> inflater;
 	};
 }
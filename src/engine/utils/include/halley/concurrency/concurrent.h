@@ -1,10 +1,15 @@
 #pragma once
+#include <algorithm>
 #include <array>
 #include <functional>
+#include <exception>
+#include <cstdint>
 #include <halley/text/halleystring.h>
+#include <halley/maths/range.h>
 #include "executor.h"
 #include "future.h"
 #include "task.h"
+#include <gsl/span>
 
 #define HAS_THREADS 1
 
@@ -16,6 +21,17 @@ namespace Halley
 		High
 	};
 
+	struct ThreadSettings {
+		ThreadPriority priority = ThreadPriority::Normal;
+		uint64_t affinityMask = 0; // Bit n allows the thread to run on core n; 0 leaves it up to the OS
+
+		ThreadSettings() = default;
+		ThreadSettings(ThreadPriority priority, uint64_t affinityMask = 0)
+			: priority(priority)
+			, affinityMask(affinityMask)
+		{}
+	};
+
 	namespace Concurrent
 	{
 		template <typename T>
@@ -30,6 +46,13 @@ namespace Halley
 			return execute(e, Task<typename std::result_of<F()>::type>(f));
 		}
 
+		// See TaskPriority. The deadline is in Profiler::getTimeNs time, 0 for none.
+		template <typename F>
+		auto execute(ExecutionQueue& e, TaskPriority priority, F f, int64_t deadlineNs = 0) -> Future<typename std::result_of<F()>::type>
+		{
+			return Task<typename std::result_of<F()>::type>(f).enqueueOn(e, priority, deadlineNs);
+		}
+
 		template <typename T>
 		auto execute(Task<T> task) -> Future<T>
 		{
@@ -52,28 +75,117 @@ namespace Halley
 			return future.getFuture();
 		}
 
+		// The join notification fits in each future's inline continuation storage, so this doesn't allocate per element
+		template <typename T>
+		auto whenAll(gsl::span<Future<T>> futures) -> Future<void>
+		{
+			return whenAll(futures.begin(), futures.end());
+		}
+
+		// Shared between the participants of a parallelFor. Chunks are handed out guided-style: large at first,
+		// shrinking down to the grain size as the range runs out, so that uneven workloads still balance.
+		class ParallelForState
+		{
+		public:
+			ParallelForState(size_t begin, size_t end, size_t grain, size_t nParticipants);
+
+			bool claim(size_t& chunkStart, size_t& chunkEnd);
+			void complete(size_t count);
+			void fail(std::exception_ptr e);
+			void wait();
+
+		private:
+			const size_t end;
+			const size_t grain;
+			const size_t nParticipants;
+			const size_t total;
+			std::atomic<size_t> next;
+			std::atomic<size_t> completed;
+			std::exception_ptr error;
+			std::mutex mutex;
+			std::condition_variable condition;
+		};
+
+		template <typename F>
+		void runParallelForChunks(ParallelForState& state, F& f)
+		{
+			size_t chunkStart;
+			size_t chunkEnd;
+			while (state.claim(chunkStart, chunkEnd)) {
+				try {
+					f(chunkStart, chunkEnd);
+				} catch (...) {
+					state.fail(std::current_exception());
+				}
+				state.complete(chunkEnd - chunkStart);
+			}
+		}
+
+		// Calls f(begin, end) over sub-ranges of at least grain elements. The calling thread takes part in the work,
+		// so this is safe to call from inside tasks running on the same queue. The helpers are queued with priority.
+		template <typename F>
+		void parallelFor(ExecutionQueue& e, Range<size_t> range, size_t grain, F f, TaskPriority priority = TaskPriority::Normal)
+		{
+			const size_t n = range.end - range.start;
+			grain = std::max(grain, size_t(1));
+			if (n == 0) {
+				return;
+			}
+			const size_t nHelpers = std::min(e.threadCount(), (n - 1) / grain);
+			if (nHelpers == 0) {
+				f(range.start, range.end);
+				return;
+			}
+
+			// Helpers may start after everything is done, so they share ownership of the state
+			auto state = std::make_shared<ParallelForState>(range.start, range.end, grain, nHelpers + 1);
+			for (size_t i = 0; i < nHelpers; ++i) {
+				e.addToQueue([state, f] () mutable {
+					runParallelForChunks(*state, f);
+				}, priority);
+			}
+			runParallelForChunks(*state, f);
+			state->wait();
+		}
+
+		template <typename F>
+		void parallelFor(Range<size_t> range, size_t grain, F f)
+		{
+			parallelFor(ExecutionQueue::getDefault(), range, grain, f);
+		}
+
+		// Each chunk is folded into a fresh copy of identity with f(acc, begin, end), and the partial results are then
+		// merged into the result with combine(a, b). Since chunking isn't deterministic, combine must be associative and commutative.
+		template <typename T, typename F, typename C>
+		T parallelReduce(ExecutionQueue& e, Range<size_t> range, size_t grain, T identity, F f, C combine)
+		{
+			std::mutex mutex;
+			T result = identity;
+			parallelFor(e, range, grain, [&] (size_t begin, size_t end) {
+				T acc = identity;
+				f(acc, begin, end);
+				std::unique_lock<std::mutex> lock(mutex);
+				result = combine(std::move(result), std::move(acc));
+			});
+			return result;
+		}
+
+		template <typename T, typename F, typename C>
+		T parallelReduce(Range<size_t> range, size_t grain, T identity, F f, C combine)
+		{
+			return parallelReduce(ExecutionQueue::getDefault(), range, grain, std::move(identity), f, combine);
+		}
+
 		template <typename T, typename F>
 		void foreach(ExecutionQueue& e, T begin, T end, F f)
 		{
 			const size_t n = end - begin;
-			constexpr size_t maxThreads = 8;
-			size_t nThreads = std::max(size_t(1), std::min(maxThreads, e.threadCount()));
-			std::array<Future<void>, maxThreads> futures;
-
-			size_t prevEnd = 0;
-			for (size_t j = 0; j < nThreads; ++j) {
-				size_t curStart = prevEnd;
-				size_t curEnd = n * (j + 1) / nThreads;
-				prevEnd = curEnd;
-
-				futures[j] = execute([begin, f, curStart, curEnd]() {
-					for (auto i = begin + curStart; i < begin + curEnd; ++i) {
-						f(*i);
-					}
-				});
-			}
-
-			whenAll(futures.data(), futures.data() + nThreads).wait();
+			const size_t grain = std::max(size_t(1), n / (std::max(size_t(1), e.threadCount()) * 4));
+			parallelFor(e, Range<size_t>(0, n), grain, [begin, &f] (size_t chunkStart, size_t chunkEnd) {
+				for (auto i = begin + chunkStart; i < begin + chunkEnd; ++i) {
+					f(*i);
+				}
+			});
 		}
 
 		template <typename T, typename F>
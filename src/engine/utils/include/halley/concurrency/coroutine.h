@@ -0,0 +1,165 @@
+#pragma once
+
+// Coroutine support for Futures and ExecutionQueues. The engine itself builds as C++14, so this is only available
+// to code compiled in C++20 mode (or with MSVC's /await); check HALLEY_COROUTINES before using it.
+//
+// A function returning Future<T> can be written as a coroutine:
+//
+//     Future<int> loadThing(String path)
+//     {
+//         co_await Executors::getDiskIO();      // Carries on in a disk IO thread
+//         auto bytes = Path::readFile(path);
+//         co_await Executors::getCPU();         // ...and then in a CPU thread
+//         int result = decode(bytes);
+//         co_return result;
+//     }
+//
+// Awaiting a Future<T> suspends until it's set, and resumes on the thread that set it.
+
+#include "future.h"
+#include <exception>
+
+#if defined(__has_include)
+	#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+		#include <coroutine>
+		#define HALLEY_COROUTINES 1
+		namespace Halley { namespace CoroutineStd = std; }
+	#elif (defined(__cpp_coroutines) || defined(_RESUMABLE_FUNCTIONS_SUPPORTED)) && __has_include(<experimental/coroutine>)
+		#include <experimental/coroutine>
+		#define HALLEY_COROUTINES 1
+		namespace Halley { namespace CoroutineStd = std::experimental; }
+	#endif
+#endif
+
+#ifdef HALLEY_COROUTINES
+
+namespace Halley
+{
+	class ExecutionQueueAwaiter
+	{
+	public:
+		explicit ExecutionQueueAwaiter(ExecutionQueue& queue)
+			: queue(queue)
+		{}
+
+		bool await_ready() const { return false; }
+
+		void await_suspend(CoroutineStd::coroutine_handle<> handle)
+		{
+			queue.addToQueue([handle] () { handle.resume(); });
+		}
+
+		void await_resume() {}
+
+	private:
+		ExecutionQueue& queue;
+	};
+
+	inline ExecutionQueueAwaiter operator co_await(ExecutionQueue& queue)
+	{
+		return ExecutionQueueAwaiter(queue);
+	}
+
+	template <typename T>
+	class FutureAwaiter
+	{
+	public:
+		explicit FutureAwaiter(Future<T> future)
+			: future(std::move(future))
+		{}
+
+		bool await_ready() const { return false; }
+
+		void await_suspend(CoroutineStd::coroutine_handle<> handle)
+		{
+			// If the future is already set, this resumes right here, before returning
+			future.thenInline([this, handle] (T v) {
+				value = std::move(v);
+				handle.resume();
+			});
+		}
+
+		T await_resume()
+		{
+			return std::move(value.get());
+		}
+
+	private:
+		Future<T> future;
+		boost::optional<T> value;
+	};
+
+	template <>
+	class FutureAwaiter<void>
+	{
+	public:
+		explicit FutureAwaiter(Future<void> future)
+			: future(std::move(future))
+		{}
+
+		bool await_ready() const { return false; }
+
+		void await_suspend(CoroutineStd::coroutine_handle<> handle)
+		{
+			future.thenInline([handle] (VoidWrapper) {
+				handle.resume();
+			});
+		}
+
+		void await_resume() {}
+
+	private:
+		Future<void> future;
+	};
+
+	template <typename T>
+	FutureAwaiter<T> operator co_await(Future<T> future)
+	{
+		return FutureAwaiter<T>(std::move(future));
+	}
+
+	template <typename T>
+	class FutureCoroutinePromiseBase
+	{
+	public:
+		Future<T> get_return_object() { return promise.getFuture(); }
+
+		// Starts running straight away on the calling thread; the frame frees itself once it finishes
+		CoroutineStd::suspend_never initial_suspend() noexcept { return {}; }
+		CoroutineStd::suspend_never final_suspend() noexcept { return {}; }
+
+		// Futures can't carry exceptions, so there's nowhere to report this to
+		void unhandled_exception() { std::terminate(); }
+
+	protected:
+		Promise<T> promise;
+	};
+
+	template <typename T>
+	class FutureCoroutinePromise : public FutureCoroutinePromiseBase<T>
+	{
+	public:
+		void return_value(T value)
+		{
+			this->promise.setValue(std::move(value));
+		}
+	};
+
+	template <>
+	class FutureCoroutinePromise<void> : public FutureCoroutinePromiseBase<void>
+	{
+	public:
+		void return_void()
+		{
+			promise.set();
+		}
+	};
+}
+
+template <typename T, typename... Args>
+struct Halley::CoroutineStd::coroutine_traits<Halley::Future<T>, Args...>
+{
+	using promise_type = Halley::FutureCoroutinePromise<T>;
+};
+
+#endif
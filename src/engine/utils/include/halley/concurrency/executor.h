@@ -1,10 +1,13 @@
 #pragma once
+#include <array>
 #include <deque>
+#include <memory>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <functional>
 #include <atomic>
+#include <cstdint>
 #include <vector>
 #include "halley/text/halleystring.h"
 
@@ -12,30 +15,82 @@ namespace Halley
 {
 	using TaskBase = std::function<void()>;
 
+	class WorkStealingDeque;
+	struct MPSCTaskNode;
+
+	// Tasks waiting in a queue are taken critical first, then any whose deadline has passed, then normal, then background.
+	// Tasks without a deadline are given one from when they were queued (see ExecutionQueue::maxWaitNs), so a steady
+	// stream of normal work doesn't starve background work forever. Tasks already running are never preempted.
+	enum class TaskPriority
+	{
+		Critical, // Work the current frame is waiting on
+		Normal,
+		Background // Loading, decoding, anything nobody is blocked on yet
+	};
+
+	enum class ExecutionQueueMode
+	{
+		SingleQueue,
+		WorkStealing, // Each attached executor gets its own lock-free deque, and steals from the others when idle
+		MPSC // Lock-free for any number of producers, but only one thread may ever take tasks out. Always in order; ignores priorities.
+	};
+
 	class ExecutionQueue
 	{
 	public:
-		ExecutionQueue();
-		void addToQueue(TaskBase task);
+		explicit ExecutionQueue(ExecutionQueueMode mode = ExecutionQueueMode::SingleQueue);
+		~ExecutionQueue();
+		void addToQueue(TaskBase task, TaskPriority priority = TaskPriority::Normal, int64_t deadlineNs = 0); // Deadline in Profiler::getTimeNs time, 0 for none
 
 		TaskBase getNext();
 		std::vector<TaskBase> getAll();
+		size_t runAll();
 
 		size_t threadCount() const;
-		void onAttached();
+		int onAttached();
 		void onDetached();
+		void onWorkerStarted(int workerIndex);
 		void abort();
 
 		static ExecutionQueue& getDefault();
 
 	private:
-		std::deque<TaskBase> queue;
+		constexpr static int maxWorkers = 64;
+		constexpr static int numPriorities = 3;
+		constexpr static std::array<int64_t, numPriorities> maxWaitNs = {{ 0, 20'000'000, 200'000'000 }};
+
+		struct QueuedTask
+		{
+			TaskBase task;
+			int64_t dueTime;
+		};
+
+		const ExecutionQueueMode mode;
+		std::array<std::deque<QueuedTask>, numPriorities> queues; // By priority, each sorted by due time
 		std::mutex mutex;
 		std::condition_variable condition;
 
 		std::atomic<int> attachedCount;
-		std::atomic<bool> hasTasks;
+		std::atomic<uint32_t> queuedMask; // Bit n is set while queues[n] isn't empty
 		std::atomic<bool> aborted;
+
+		std::array<std::unique_ptr<WorkStealingDeque>, maxWorkers> workers;
+		std::atomic<int> workerCount;
+		std::atomic<int> pendingTasks;
+		std::atomic<int> sleepingWorkers;
+
+		std::atomic<MPSCTaskNode*> mpscHead; // Most recently added first
+		MPSCTaskNode* mpscPending = nullptr; // Owned by the consumer, oldest first
+
+		void pushQueued(TaskBase task, TaskPriority priority, int64_t deadlineNs);
+		bool popQueued(TaskBase& result, TaskPriority lowest);
+		TaskBase* tryGetQueued(TaskPriority lowest, uint32_t mask);
+		TaskBase* tryGetTask(int workerIndex);
+		TaskBase getNextStealing();
+		void wakeWorker();
+
+		MPSCTaskNode* takeAllMPSC();
+		TaskBase getNextMPSC();
 	};
 
 	class Executors
@@ -43,6 +98,7 @@ namespace Halley
 	public:
 		static Executors& get();
 		static void set(Executors& e);
+		static bool hasInstance() { return instance != nullptr; }
 
 		static ExecutionQueue& getCPU() { return instance->cpu; }
 		static ExecutionQueue& getCPUAux() { return instance->cpuAux; }
@@ -53,10 +109,10 @@ namespace Halley
 	private:
 		static Executors* instance;
 
-		ExecutionQueue cpu;
-		ExecutionQueue cpuAux;
-		ExecutionQueue videoAux;
-		ExecutionQueue mainThread;
+		ExecutionQueue cpu { ExecutionQueueMode::WorkStealing };
+		ExecutionQueue cpuAux { ExecutionQueueMode::WorkStealing };
+		ExecutionQueue videoAux { ExecutionQueueMode::MPSC };
+		ExecutionQueue mainThread { ExecutionQueueMode::MPSC };
 		ExecutionQueue diskIO;
 	};
 
@@ -73,6 +129,7 @@ namespace Halley
 	private:
 		ExecutionQueue& queue;
 		std::atomic<bool> running;
+		int workerIndex = -1;
 	};
 
 	class ThreadPool
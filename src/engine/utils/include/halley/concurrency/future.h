@@ -3,6 +3,10 @@
 #include "executor.h"
 #include <memory>
 #include <atomic>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
 #include <boost/optional.hpp>
 #include <thread>
 #include <mutex>
@@ -70,15 +74,31 @@ namespace Halley
 		}
 	};
 
+	// The continuations are a lock-free list, which gets swapped for a marker once the value is set. Adding a
+	// continuation after that just runs it inline. The first continuation is constructed in place when it's small
+	// enough, since most futures only ever get one, and only threads that actually block in wait() touch a mutex.
 	template <typename T>
 	class FutureData
 	{
 	public:
 		FutureData()
-			: available(false)
+			: continuations(nullptr)
+			, inlineUsed(false)
 			, cancelled(false)
 		{}
 
+		~FutureData()
+		{
+			Continuation* c = continuations.load(std::memory_order_acquire);
+			if (c != getReadyMarker()) {
+				while (c) {
+					auto next = c->next;
+					c->runAndRelease(nullptr);
+					c = next;
+				}
+			}
+		}
+
 		FutureData(FutureData&&) = delete;
 		FutureData(const FutureData&) = delete;
 		FutureData& operator=(FutureData&&) = delete;
@@ -98,31 +118,36 @@ namespace Halley
 
 		void wait()
 		{
-			if (!available) {
-				std::unique_lock<std::mutex> lock(mutex);
-				while (!available) {
-					condition.wait(lock);
+			if (!hasValue()) {
+				Waiter waiter;
+				if (push(&waiter)) {
+					waiter.wait();
 				}
 			}
 		}
 
 		bool hasValue() const
 		{
-			return available.load();
+			return continuations.load(std::memory_order_acquire) == getReadyMarker();
 		}
 
-		void addContinuation(std::function<void(T)> f)
+		template <typename F>
+		void addContinuation(F f)
 		{
-			if (available.load()) {
-				apply(f);
+			if (hasValue()) {
+				f(doGet<T>(0));
+				return;
+			}
+
+			Continuation* c;
+			if (sizeof(ContinuationImpl<F>) <= inlineCapacity && alignof(ContinuationImpl<F>) <= alignof(std::max_align_t) && !inlineUsed.exchange(true)) {
+				c = new (&inlineStorage) ContinuationImpl<F>(std::move(f), true);
 			} else {
-				std::unique_lock<std::mutex> lock(mutex);
-				if (available.load()) {
-					lock.unlock();
-					apply(f);
-				} else {
-					continuations.push_back(f);
-				}
+				c = new ContinuationImpl<F>(std::move(f), false);
+			}
+
+			if (!push(c)) {
+				c->runAndRelease(this);
 			}
 		}
 
@@ -137,8 +162,86 @@ namespace Halley
 		}
 
 	private:
-		void apply(std::function<void(T)> f) {
-			f(doGet<T>(0));
+		class Continuation
+		{
+		public:
+			virtual ~Continuation() = default;
+
+			// Runs against data (or just discards itself, if data is null). This must be the last access to the object.
+			virtual void runAndRelease(FutureData* data) = 0;
+
+			Continuation* next = nullptr;
+		};
+
+		template <typename F>
+		class ContinuationImpl final : public Continuation
+		{
+		public:
+			ContinuationImpl(F&& f, bool isInline)
+				: f(std::move(f))
+				, isInline(isInline)
+			{}
+
+			void runAndRelease(FutureData* data) override
+			{
+				if (data) {
+					f(data->template doGet<T>(0));
+				}
+				if (isInline) {
+					this->~ContinuationImpl();
+				} else {
+					delete this;
+				}
+			}
+
+		private:
+			F f;
+			bool isInline;
+		};
+
+		// Lives on the stack of the thread blocked in wait()
+		class Waiter final : public Continuation
+		{
+		public:
+			void runAndRelease(FutureData* data) override
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				done = true;
+				condition.notify_one();
+			}
+
+			void wait()
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				while (!done) {
+					condition.wait(lock);
+				}
+			}
+
+		private:
+			std::mutex mutex;
+			std::condition_variable condition;
+			bool done = false;
+		};
+
+		constexpr static size_t inlineCapacity = 96;
+
+		static Continuation* getReadyMarker()
+		{
+			return reinterpret_cast<Continuation*>(uintptr_t(1));
+		}
+
+		// Returns false if the value was already available, in which case the continuation wasn't added
+		bool push(Continuation* c)
+		{
+			Continuation* head = continuations.load(std::memory_order_acquire);
+			do {
+				if (head == getReadyMarker()) {
+					return false;
+				}
+				c->next = head;
+			} while (!continuations.compare_exchange_weak(head, c, std::memory_order_acq_rel, std::memory_order_acquire));
+			return true;
 		}
 
 		template<typename T0>
@@ -163,28 +266,28 @@ namespace Halley
 
 		void makeAvailable()
 		{
-			std::vector<std::function<void(T)>> toRun;
-
-			{
-				std::unique_lock<std::mutex> lock(mutex);
-				toRun = std::move(continuations);
-				continuations.clear();
-				available.store(true);
-				condition.notify_all();
+			// Continuations were pushed to the front, so reverse them to run in the order they were added
+			Continuation* c = continuations.exchange(getReadyMarker(), std::memory_order_acq_rel);
+			Continuation* toRun = nullptr;
+			while (c) {
+				auto next = c->next;
+				c->next = toRun;
+				toRun = c;
+				c = next;
 			}
 
-			for (auto f : toRun) {
-				apply(f);
+			while (toRun) {
+				auto next = toRun->next;
+				toRun->runAndRelease(this);
+				toRun = next;
 			}
 		}
 
-		std::atomic<bool> available;
+		std::atomic<Continuation*> continuations;
+		std::atomic<bool> inlineUsed;
 		std::atomic<bool> cancelled;
 		boost::optional<T> data;
-
-		std::vector<std::function<void(T)>> continuations;
-		std::mutex mutex;
-		std::condition_variable condition;
+		typename std::aligned_storage<inlineCapacity, alignof(std::max_align_t)>::type inlineStorage;
 	};
 
 	template <typename T>
@@ -248,6 +351,16 @@ namespace Halley
 		template <typename E, typename F>
 		auto then(E& e, F f)->Future<typename TaskHelper<T>::template FunctionHelper<F>::ReturnType>;
 
+		// Calls f(value) on whichever thread sets the value, or right away if it's already set
+		template <typename F>
+		void thenInline(F f)
+		{
+			if (!data) {
+				throw Exception("Future has not been bound.", HalleyExceptions::Utils);
+			}
+			data->addContinuation(std::move(f));
+		}
+
 		template <typename F>
 		auto thenNotify(F joinFuture) -> void
 		{
@@ -333,23 +446,10 @@ namespace Halley
 
 		int notify()
 		{
-			std::unique_lock<std::mutex> lock(mutex);
-			return --waitingFor;
-			/*
-			// Lock-free, juggling razors here!
-			while (true) {
-				int prev = waitingFor;
-				int next = prev - 1;
-				if (waitingFor.exchange(next) == prev) {
-					return next; // Swapped successfully
-				}
-				// Nope, race condition. Try again.
-			}
-			*/
+			return waitingFor.fetch_sub(1, std::memory_order_acq_rel) - 1;
 		}
 
 	private:
-		std::mutex mutex;
 		std::atomic<int> waitingFor;
 	};
 
@@ -468,11 +568,11 @@ namespace Halley
 			payload = std::move(f);
 		}
 
-		Future<T> enqueueOn(ExecutionQueue& e)
+		Future<T> enqueueOn(ExecutionQueue& e, TaskPriority priority = TaskPriority::Normal, int64_t deadlineNs = 0)
 		{
 			e.addToQueue([payload(std::move(payload)), promise(promise)]() mutable {
 				TaskHelper<T>::setPromise(promise, payload);
-			});
+			}, priority, deadlineNs);
 			return getFuture();
 		}
 
@@ -498,11 +598,13 @@ namespace Halley
 		using R = typename TaskHelper<T>::template FunctionHelper<F>::ReturnType;
 		std::reference_wrapper<E> executor(e);
 
-		auto task = Task<R>();
-		data->addContinuation([task, f, executor](typename TaskHelper<T>::DataType v) mutable {
-			task.setPayload(MovableFunction<R>(f, std::move(v)));
-			task.enqueueOn(executor.get());
+		Promise<R> promise;
+		data->addContinuation([promise, f, executor](typename TaskHelper<T>::DataType v) mutable {
+			MovableFunction<R> payload(f, std::move(v));
+			executor.get().addToQueue([payload, promise] () mutable {
+				TaskHelper<R>::setPromise(promise, payload);
+			});
 		});
-		return task.getFuture();
+		return promise.getFuture();
 	}
 }
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "halley/utils/utils.h"
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <gsl/gsl>
+
+namespace Halley {
+	// Bounded queue for any number of producer and consumer threads (after Dmitry Vyukov's). Each slot has a sequence
+	// number saying whether it's ready to be written or read, so threads only contend on claiming a position, and never
+	// block or take a lock: tryPush fails when the queue is full, and tryPop when it's empty.
+	//
+	// Elements come out in the order their positions were claimed. Batch versions push or pop one element at a time,
+	// so elements from other threads may be interleaved with the batch.
+	template <typename T>
+	class MPMCQueue {
+	public:
+		explicit MPMCQueue(size_t capacity)
+			: capacity(nextPowerOf2(capacity))
+			, mask(this->capacity - 1)
+			, slots(new Slot[this->capacity])
+		{
+			Expects(capacity > 0);
+			for (size_t i = 0; i < this->capacity; ++i) {
+				slots[i].sequence.store(i, std::memory_order_relaxed);
+			}
+		}
+
+		size_t getCapacity() const { return capacity; }
+
+		bool tryPush(T&& value)
+		{
+			size_t position;
+			return tryPush(std::move(value), position);
+		}
+
+		// Also returns the position the element was given; positions are consecutive, starting from 0
+		bool tryPush(T&& value, size_t& position)
+		{
+			size_t pos = enqueuePos.load(std::memory_order_relaxed);
+			while (true) {
+				auto& slot = slots[pos & mask];
+				const size_t seq = slot.sequence.load(std::memory_order_acquire);
+				const auto diff = std::ptrdiff_t(seq) - std::ptrdiff_t(pos);
+				if (diff == 0) {
+					if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+						slot.value = std::move(value);
+						slot.sequence.store(pos + 1, std::memory_order_release);
+						position = pos;
+						return true;
+					}
+				} else if (diff < 0) {
+					return false;
+				} else {
+					pos = enqueuePos.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		bool tryPop(T& value)
+		{
+			size_t pos = dequeuePos.load(std::memory_order_relaxed);
+			while (true) {
+				auto& slot = slots[pos & mask];
+				const size_t seq = slot.sequence.load(std::memory_order_acquire);
+				const auto diff = std::ptrdiff_t(seq) - std::ptrdiff_t(pos + 1);
+				if (diff == 0) {
+					if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+						value = std::move(slot.value);
+						slot.value = T(); // Don't keep whatever the moved-from value still holds alive
+						slot.sequence.store(pos + capacity, std::memory_order_release);
+						return true;
+					}
+				} else if (diff < 0) {
+					return false;
+				} else {
+					pos = dequeuePos.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		// Moves from the start of values, and returns how many were pushed
+		size_t tryPushBatch(gsl::span<T> values)
+		{
+			size_t n = 0;
+			while (n < size_t(values.size()) && tryPush(std::move(values[n]))) {
+				++n;
+			}
+			return n;
+		}
+
+		// Fills the start of values, and returns how many were popped
+		size_t tryPopBatch(gsl::span<T> values)
+		{
+			size_t n = 0;
+			while (n < size_t(values.size()) && tryPop(values[n])) {
+				++n;
+			}
+			return n;
+		}
+
+		// Positions claimed so far, i.e. the position the next push will get. Pushes up to here may still be in progress.
+		size_t getPushCount() const
+		{
+			return enqueuePos.load(std::memory_order_acquire);
+		}
+
+		bool isEmpty() const
+		{
+			const size_t pos = dequeuePos.load(std::memory_order_relaxed);
+			return slots[pos & mask].sequence.load(std::memory_order_acquire) != pos + 1;
+		}
+
+	private:
+		struct Slot
+		{
+			std::atomic<size_t> sequence;
+			T value;
+		};
+
+		const size_t capacity;
+		const size_t mask;
+		std::unique_ptr<Slot[]> slots;
+
+		// On separate cache lines, so producers and consumers don't contend with each other
+		alignas(64) std::atomic<size_t> enqueuePos { 0 };
+		alignas(64) std::atomic<size_t> dequeuePos { 0 };
+	};
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "halley/data_structures/vector.h"
+#include "halley/utils/utils.h"
+#include <atomic>
+#include <algorithm>
+#include <gsl/gsl>
+
+namespace Halley {
+	// Bounded queue between exactly one producer thread and one consumer thread.
+	// Neither side ever blocks or takes a lock: tryPush fails when the queue is full, and tryPop when it's empty.
+	// Batch versions move as many elements as fit or are available, and only publish them once.
+	template <typename T>
+	class SPSCQueue {
+	public:
+		explicit SPSCQueue(size_t capacity)
+			: slots(nextPowerOf2(capacity))
+			, mask(slots.size() - 1)
+		{
+			Expects(capacity > 0);
+		}
+
+		size_t getCapacity() const { return slots.size(); }
+
+		// Producer only
+		bool tryPush(T&& value)
+		{
+			const size_t write = writePos.load(std::memory_order_relaxed);
+			if (getFreeSpace(write, 1) == 0) {
+				return false;
+			}
+			slots[write & mask] = std::move(value);
+			writePos.store(write + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Producer only; moves from the start of values, and returns how many were pushed
+		size_t tryPushBatch(gsl::span<T> values)
+		{
+			const size_t write = writePos.load(std::memory_order_relaxed);
+			const size_t n = std::min(size_t(values.size()), getFreeSpace(write, size_t(values.size())));
+			for (size_t i = 0; i < n; ++i) {
+				slots[(write + i) & mask] = std::move(values[i]);
+			}
+			if (n > 0) {
+				writePos.store(write + n, std::memory_order_release);
+			}
+			return n;
+		}
+
+		// Consumer only
+		bool tryPop(T& value)
+		{
+			const size_t read = readPos.load(std::memory_order_relaxed);
+			if (getAvailable(read, 1) == 0) {
+				return false;
+			}
+			auto& slot = slots[read & mask];
+			value = std::move(slot);
+			slot = T(); // Don't keep whatever the moved-from value still holds alive
+			readPos.store(read + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Consumer only; fills the start of values, and returns how many were popped
+		size_t tryPopBatch(gsl::span<T> values)
+		{
+			const size_t read = readPos.load(std::memory_order_relaxed);
+			const size_t n = std::min(size_t(values.size()), getAvailable(read, size_t(values.size())));
+			for (size_t i = 0; i < n; ++i) {
+				auto& slot = slots[(read + i) & mask];
+				values[i] = std::move(slot);
+				slot = T();
+			}
+			if (n > 0) {
+				readPos.store(read + n, std::memory_order_release);
+			}
+			return n;
+		}
+
+		// Only safe while neither thread is using the queue
+		void clear()
+		{
+			for (auto& slot: slots) {
+				slot = T();
+			}
+			readPos = 0;
+			writePos = 0;
+			cachedReadPos = 0;
+			cachedWritePos = 0;
+		}
+
+	private:
+		Vector<T> slots;
+		const size_t mask;
+
+		// Kept on separate cache lines, so the two threads don't keep invalidating each other. Each side also keeps the
+		// last position it saw from the other, and only reloads it (touching the other side's line) when that's not enough.
+		alignas(64) std::atomic<size_t> readPos { 0 };
+		size_t cachedWritePos = 0;
+		alignas(64) std::atomic<size_t> writePos { 0 };
+		size_t cachedReadPos = 0;
+
+		size_t getFreeSpace(size_t write, size_t wanted)
+		{
+			size_t space = slots.size() - (write - cachedReadPos);
+			if (space < wanted) {
+				cachedReadPos = readPos.load(std::memory_order_acquire);
+				space = slots.size() - (write - cachedReadPos);
+			}
+			return space;
+		}
+
+		size_t getAvailable(size_t read, size_t wanted)
+		{
+			size_t available = cachedWritePos - read;
+			if (available < wanted) {
+				cachedWritePos = writePos.load(std::memory_order_acquire);
+				available = cachedWritePos - read;
+			}
+			return available;
+		}
+	};
+}
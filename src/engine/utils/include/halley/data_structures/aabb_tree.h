@@ -0,0 +1,147 @@
+#pragma once
+
+#include "halley/maths/rect.h"
+#include "halley/maths/vector2.h"
+#include "vector.h"
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+
+namespace Halley {
+	// Dynamic bounding volume hierarchy over float rectangles, for collision broadphase and spatial queries.
+	//
+	// Leaves store "fat" bounds, grown by a margin and stretched along the displacement passed to move(), so an
+	// object moving a little doesn't touch the tree at all. Only leaving its fat bounds re-inserts a leaf, which is
+	// O(log n), as the tree is kept balanced with rotations. The exact bounds are kept too, and used for pairs.
+	//
+	// Queries are const and don't use any shared scratch space, so they can run concurrently with each other,
+	// but not with changes to the tree.
+	class AABBTree {
+	public:
+		using ProxyId = int32_t;
+		using Pair = std::pair<ProxyId, ProxyId>;
+		constexpr static ProxyId nullProxy = -1;
+
+		explicit AABBTree(float margin = 4.0f);
+
+		ProxyId insert(Rect4f bounds, uint64_t data);
+		void remove(ProxyId proxy);
+		bool move(ProxyId proxy, Rect4f bounds, Vector2f displacement = Vector2f()); // Returns true if the leaf had to be re-inserted
+		void clear();
+
+		size_t size() const;
+		int getHeight() const;
+
+		Rect4f getBounds(ProxyId proxy) const;
+		Rect4f getFatBounds(ProxyId proxy) const;
+		uint64_t getData(ProxyId proxy) const;
+
+		// Calls f(ProxyId) for every leaf whose fat bounds touch the area; check getBounds() for an exact test
+		template <typename F>
+		void query(Rect4f area, F f) const
+		{
+			visit([&] (const Node& node) { return touches(node.fat, area); }, f);
+		}
+
+		// Calls f(ProxyId, float maxDistance) for every leaf whose fat bounds the segment crosses, in no particular order.
+		// f returns the new maximum distance along the segment, so returning a hit's distance clips the rest of the search,
+		// returning maxDistance carries on unchanged, and returning a negative value stops it.
+		template <typename F>
+		void raycast(Vector2f from, Vector2f to, F f) const
+		{
+			const Vector2f delta = to - from;
+			float maxDistance = delta.length();
+			if (maxDistance <= 0) {
+				return;
+			}
+			const Vector2f dir = delta / maxDistance;
+
+			visit([&] (const Node& node) { return maxDistance >= 0 && rayHits(node.fat, from, dir, maxDistance); }, [&] (ProxyId proxy)
+			{
+				maxDistance = std::min(maxDistance, f(proxy, maxDistance));
+			});
+		}
+
+		// Appends all pairs whose exact bounds overlap, each once, with the lower id first
+		void getOverlappingPairs(Vector<Pair>& pairs) const;
+
+		// Same, but only pairs involving a proxy inserted or moved since the last call
+		void getMovedPairs(Vector<Pair>& pairs);
+
+		// Distance along the ray where it enters the rect, or a negative value if it misses within maxDistance
+		static float intersectRay(Rect4f rect, Vector2f from, Vector2f dir, float maxDistance);
+
+	private:
+		struct Node
+		{
+			Rect4f fat;
+			Rect4f bounds;
+			uint64_t data = 0;
+			ProxyId parent = nullProxy; // Next free node, when not in use
+			ProxyId child1 = nullProxy;
+			ProxyId child2 = nullProxy;
+			int32_t height = -1; // 0 for leaves, -1 for free nodes
+			bool moved = false;
+
+			bool isLeaf() const { return child1 == nullProxy; }
+		};
+
+		constexpr static size_t maxStackDepth = 256;
+
+		float margin;
+		Vector<Node> nodes;
+		ProxyId root = nullProxy;
+		ProxyId freeList = nullProxy;
+		size_t nLeaves = 0;
+		Vector<ProxyId> moved;
+
+		ProxyId allocateNode();
+		void freeNode(ProxyId id);
+		void insertLeaf(ProxyId leaf);
+		void removeLeaf(ProxyId leaf);
+		ProxyId balance(ProxyId a);
+		void fixUpwards(ProxyId id);
+		void compactMoved();
+		const Node& getLeaf(ProxyId proxy) const;
+
+		static bool touches(const Rect4f& a, const Rect4f& b)
+		{
+			const auto a1 = a.getTopLeft();
+			const auto a2 = a.getBottomRight();
+			const auto b1 = b.getTopLeft();
+			const auto b2 = b.getBottomRight();
+			return !(a2.x < b1.x || b2.x < a1.x || a2.y < b1.y || b2.y < a1.y);
+		}
+
+		static bool rayHits(const Rect4f& rect, Vector2f from, Vector2f dir, float maxDistance)
+		{
+			return intersectRay(rect, from, dir, maxDistance) >= 0;
+		}
+
+		// Depth first, with an explicit stack; trees deeper than that are impossible while balanced
+		template <typename Accept, typename F>
+		void visit(Accept accept, F f) const
+		{
+			if (root == nullProxy) {
+				return;
+			}
+			std::array<ProxyId, maxStackDepth> stack;
+			size_t stackSize = 0;
+			stack[stackSize++] = root;
+			while (stackSize > 0) {
+				const ProxyId id = stack[--stackSize];
+				const Node& node = nodes[id];
+				if (!accept(node)) {
+					continue;
+				}
+				if (node.isLeaf()) {
+					f(id);
+				} else {
+					stack[stackSize++] = node.child1;
+					stack[stackSize++] = node.child2;
+				}
+			}
+		}
+	};
+}
@@ -41,15 +41,36 @@ namespace Halley
 	class BinPackResult
 	{
 	public:
-		BinPackResult(Rect4i rect, bool rotated, void* data)
+		BinPackResult(Rect4i rect, bool rotated, void* data, int bin = 0)
 			: rect(rect)
 			, rotated(rotated)
 			, data(data)
+			, bin(bin)
 		{}
 
 		Rect4i rect;
 		bool rotated;
 		void* data;
+		int bin;
+	};
+
+	// A single bin, packed with MaxRects (best short side fit). Rectangles can be added one at a time, so it can
+	// also be used to pack around rectangles that are already in place.
+	class MaxRectsBin
+	{
+	public:
+		explicit MaxRectsBin(Vector2i size);
+
+		boost::optional<BinPackResult> insert(const BinPackEntry& entry);
+		bool occupy(Rect4i rect); // Returns false if it's not entirely free
+		Vector2i getSize() const { return size; }
+
+	private:
+		Vector2i size;
+		std::vector<Rect4i> freeRects;
+
+		void place(Rect4i rect);
+		void pruneFreeRects(size_t firstNew);
 	};
 
 	class BinPack
@@ -57,5 +78,13 @@ namespace Halley
 	public:
 		static boost::optional<Vector<BinPackResult>> pack(const std::vector<BinPackEntry>& entries, Vector2i binSize);
 		static boost::optional<Vector<BinPackResult>> fastPack(const std::vector<BinPackEntry>& entries, Vector2i binSize);
+
+		// Uses as many bins of binSize as needed, which are identified by BinPackResult::bin. Fails only if an entry
+		// is too large for a bin.
+		static boost::optional<Vector<BinPackResult>> packMultiple(const std::vector<BinPackEntry>& entries, Vector2i binSize);
+
+		// As pack(), but keeps each entry at its previous position (if given, same order as entries) whenever that
+		// position is still free, so that small changes don't move everything else around.
+		static boost::optional<Vector<BinPackResult>> packIncremental(const std::vector<BinPackEntry>& entries, Vector2i binSize, const std::vector<boost::optional<Vector2i>>& previousPositions);
 	};
 }
@@ -1,81 +1,287 @@
 #pragma once
 
 #include <halley/data_structures/vector.h>
+#include <halley/data_structures/hash_map.h>
+#include <halley/maths/vector2.h>
+#include <halley/maths/rect.h>
+#include <array>
+#include <memory>
+#include <new>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <type_traits>
 
 namespace Halley {
-	template <typename T>
+	// Unbounded sparse grid, stored in square chunks of 2^ChunkShift cells per side. Chunks are allocated on demand,
+	// aligned to cache lines, and never move, so touching a far away cell only costs one chunk.
+	//
+	// Each chunk has a dirty flag, which is set whenever it's accessed mutably. Together with serializeChunk(),
+	// deserializeChunk() and removeChunk(), that's enough to stream chunks in and out of a large world.
+	template <typename T, int ChunkShift = 4>
 	class DynamicGrid {
 	public:
-		DynamicGrid() {
-			makeGrid(-8, 8, -8, 8);
+		constexpr static int chunkSize = 1 << ChunkShift;
+		constexpr static int cellsPerChunk = chunkSize * chunkSize;
+
+		DynamicGrid() = default;
+		DynamicGrid(const DynamicGrid& other) = delete;
+		DynamicGrid(DynamicGrid&& other) = default;
+		DynamicGrid& operator=(const DynamicGrid& other) = delete;
+		DynamicGrid& operator=(DynamicGrid&& other) = default;
+
+		// Creates the chunk if needed
+		T& get(int x, int y)
+		{
+			auto& chunk = getOrCreateChunk(getChunkCoord(x, y));
+			chunk.dirty = true;
+			return chunk.cells[getCellIndex(x, y)];
 		}
 
-		T& get(int x, int y) {
-			if (x < minX || x >= maxX || y < minY || y >= maxY) {
-				resizeToFit(x, y);
+		// Null if the chunk doesn't exist
+		T* tryGet(int x, int y)
+		{
+			auto* chunk = findChunk(getChunkCoord(x, y));
+			if (!chunk) {
+				return nullptr;
 			}
-			return getElement(x, y);
+			chunk->dirty = true;
+			return &chunk->cells[getCellIndex(x, y)];
+		}
+
+		const T* tryGet(int x, int y) const
+		{
+			auto* chunk = findChunk(getChunkCoord(x, y));
+			return chunk ? &chunk->cells[getCellIndex(x, y)] : nullptr;
+		}
+
+		static Vector2i getChunkCoord(int x, int y)
+		{
+			return Vector2i(x >> ChunkShift, y >> ChunkShift);
+		}
+
+		// Cells covered by the chunk, as a half-open rect
+		static Rect4i getChunkArea(Vector2i chunk)
+		{
+			return Rect4i(chunk * chunkSize, chunkSize, chunkSize);
+		}
+
+		size_t getNumChunks() const
+		{
+			return chunks.size();
+		}
+
+		bool hasChunk(Vector2i chunk) const
+		{
+			return findChunk(chunk) != nullptr;
+		}
+
+		void removeChunk(Vector2i chunk)
+		{
+			chunks.erase(getChunkKey(chunk));
+			lastChunk = nullptr;
+		}
+
+		void clear()
+		{
+			chunks.clear();
+			lastChunk = nullptr;
+		}
+
+		bool isChunkDirty(Vector2i chunk) const
+		{
+			auto* c = findChunk(chunk);
+			return c && c->dirty;
+		}
+
+		void clearChunkDirty(Vector2i chunk)
+		{
+			if (auto* c = findChunk(chunk)) {
+				c->dirty = false;
+			}
+		}
+
+		// f(Vector2i chunk), for every chunk that exists
+		template <typename F>
+		void forEachChunk(F f) const
+		{
+			for (auto& c: chunks) {
+				f(getChunkFromKey(c.first));
+			}
+		}
+
+		// f(Vector2i chunk), for every dirty chunk, clearing their flags afterwards
+		template <typename F>
+		void forEachDirtyChunk(F f)
+		{
+			for (auto& c: chunks) {
+				if (c.second->dirty) {
+					f(getChunkFromKey(c.first));
+					c.second->dirty = false;
+				}
+			}
+		}
+
+		// f(int x, int y, T& value), for every existing cell no further than maxDistance from the centre on either axis.
+		// Chunks are visited one at a time, and nothing is allocated. The non-const version marks the chunks it visits as dirty.
+		template <typename F>
+		void forEachInRange(Vector2i centre, int maxDistance, F f)
+		{
+			visitRange(*this, centre, maxDistance, f);
+		}
+
+		template <typename F>
+		void forEachInRange(Vector2i centre, int maxDistance, F f) const
+		{
+			visitRange(*this, centre, maxDistance, f);
+		}
+
+		// Writes the chunk's cells with s << value; the chunk must exist
+		template <typename S>
+		void serializeChunk(Vector2i chunk, S& s) const
+		{
+			auto* c = findChunk(chunk);
+			Expects(c);
+			for (auto& cell: c->cells) {
+				s << cell;
+			}
+		}
+
+		// Reads the chunk's cells with s >> value, creating it if needed. The chunk is left clean.
+		template <typename S>
+		void deserializeChunk(Vector2i chunk, S& s)
+		{
+			auto& c = getOrCreateChunk(chunk);
+			for (auto& cell: c.cells) {
+				s >> cell;
+			}
+			c.dirty = false;
 		}
 
 	private:
-		Vector<T> grid;
-		int minX = 0;
-		int maxX = 0;
-		int minY = 0;
-		int maxY = 0;
-
-		void makeGrid(int _minX, int _maxX, int _minY, int _maxY) {
-			minX = _minX;
-			maxX = _maxX;
-			minY = _minY;
-			maxY = _maxY;
-			int w = maxX - minX;
-			int h = maxY - minY;
-			grid.clear();
-			grid.resize(w * h);
-		}
-
-		T& getElement(int x, int y) {
-			int w = maxX - minX;
-			int idx = (x - minX) + (y - minY) * w;
-			return grid[idx];
-		}
-
-		void resizeToFit(int x, int y) {
-			// Compute new bounds
-			int x0 = minX;
-			int x1 = maxX;
-			int y0 = minY;
-			int y1 = maxY;
-			while (x < x0) {
-				x0 *= 2;
+		constexpr static size_t cacheLineSize = 64;
+
+		struct alignas(cacheLineSize) Chunk
+		{
+			std::array<T, cellsPerChunk> cells;
+			void* allocation = nullptr;
+			bool dirty = false;
+		};
+
+		// Over-aligned new isn't guaranteed before C++17, so chunks are aligned by hand
+		struct ChunkDeleter
+		{
+			void operator()(Chunk* chunk) const
+			{
+				void* allocation = chunk->allocation;
+				chunk->~Chunk();
+				::operator delete(allocation);
 			}
-			while (x >= x1) {
-				x1 *= 2;
+		};
+		using ChunkPtr = std::unique_ptr<Chunk, ChunkDeleter>;
+
+		HashMap<uint64_t, ChunkPtr> chunks;
+		Chunk* lastChunk = nullptr;
+		uint64_t lastChunkKey = 0;
+
+		static ChunkPtr makeChunk()
+		{
+			void* allocation = ::operator new(sizeof(Chunk) + alignof(Chunk));
+			const auto address = reinterpret_cast<uintptr_t>(allocation);
+			void* aligned = reinterpret_cast<void*>((address + alignof(Chunk) - 1) & ~uintptr_t(alignof(Chunk) - 1));
+			Chunk* chunk;
+			try {
+				chunk = new (aligned) Chunk();
+			} catch (...) {
+				::operator delete(allocation);
+				throw;
 			}
-			while (y < y0) {
-				y0 *= 2;
+			chunk->allocation = allocation;
+			return ChunkPtr(chunk);
+		}
+
+		static uint64_t getChunkKey(Vector2i chunk)
+		{
+			return (uint64_t(uint32_t(chunk.x)) << 32) | uint64_t(uint32_t(chunk.y));
+		}
+
+		static Vector2i getChunkFromKey(uint64_t key)
+		{
+			return Vector2i(int32_t(uint32_t(key >> 32)), int32_t(uint32_t(key & 0xFFFFFFFFull)));
+		}
+
+		static size_t getCellIndex(int x, int y)
+		{
+			constexpr int mask = chunkSize - 1;
+			return size_t((x & mask) + ((y & mask) << ChunkShift));
+		}
+
+		Chunk& getOrCreateChunk(Vector2i chunk)
+		{
+			// Accesses tend to stay in the same chunk
+			const uint64_t key = getChunkKey(chunk);
+			if (lastChunk && lastChunkKey == key) {
+				return *lastChunk;
 			}
-			while (y >= y1) {
-				y1 *= 2;
+
+			auto iter = chunks.find(key);
+			if (iter == chunks.end()) {
+				iter = chunks.emplace(key, makeChunk()).first;
 			}
+			lastChunk = iter->second.get();
+			lastChunkKey = key;
+			return *lastChunk;
+		}
 
-			// Store data
-			Vector<T> oldGrid = std::move(grid);
+		Chunk* findChunk(Vector2i chunk) const
+		{
+			auto iter = chunks.find(getChunkKey(chunk));
+			return iter == chunks.end() ? nullptr : iter->second.get();
+		}
 
-			// Compute copy parameters
-			int oldX = minX;
-			int oldY = minY;
-			int oldW = maxX - minX;
-			int oldH = maxY - minY;
+		static void markDirty(Chunk& chunk) { chunk.dirty = true; }
+		static void markDirty(const Chunk&) {}
 
-			// Allocate
-			makeGrid(x0, x1, y0, y1);
+		template <typename Grid, typename F>
+		static void visitRange(Grid& grid, Vector2i centre, int maxDistance, F& f)
+		{
+			const Vector2i p0 = centre - Vector2i(maxDistance, maxDistance);
+			const Vector2i p1 = centre + Vector2i(maxDistance, maxDistance);
+			const Vector2i c0 = getChunkCoord(p0.x, p0.y);
+			const Vector2i c1 = getChunkCoord(p1.x, p1.y);
 
-			// Copy data
-			for (int cy = 0; cy < oldH; cy++) {
-				for (int cx = 0; cx < oldW; cx++) {
-					getElement(oldX + cx, oldY + cy) = std::move(oldGrid[cx + cy * oldW]);
+			using ChunkRef = typename std::conditional<std::is_const<Grid>::value, const Chunk&, Chunk&>::type;
+			auto visitChunk = [&] (Vector2i chunkCoord, ChunkRef chunk)
+			{
+				if (chunkCoord.x < c0.x || chunkCoord.x > c1.x || chunkCoord.y < c0.y || chunkCoord.y > c1.y) {
+					return;
+				}
+				markDirty(chunk);
+				const Vector2i origin = chunkCoord * chunkSize;
+				const int x0 = std::max(p0.x, origin.x);
+				const int x1 = std::min(p1.x, origin.x + chunkSize - 1);
+				const int y0 = std::max(p0.y, origin.y);
+				const int y1 = std::min(p1.y, origin.y + chunkSize - 1);
+				for (int y = y0; y <= y1; ++y) {
+					for (int x = x0; x <= x1; ++x) {
+						f(x, y, chunk.cells[getCellIndex(x, y)]);
+					}
+				}
+			};
+
+			const int64_t rangeChunks = int64_t(c1.x - c0.x + 1) * int64_t(c1.y - c0.y + 1);
+			if (rangeChunks > int64_t(grid.chunks.size())) {
+				// Large range compared to what exists, so go through the existing chunks instead
+				for (auto& c: grid.chunks) {
+					visitChunk(getChunkFromKey(c.first), *c.second);
+				}
+			} else {
+				for (int cy = c0.y; cy <= c1.y; ++cy) {
+					for (int cx = c0.x; cx <= c1.x; ++cx) {
+						if (auto* chunk = grid.findChunk(Vector2i(cx, cy))) {
+							visitChunk(Vector2i(cx, cy), *chunk);
+						}
+					}
 				}
 			}
 		}
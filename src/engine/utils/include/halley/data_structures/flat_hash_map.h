@@ -0,0 +1,896 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <algorithm>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <halley/text/halleystring.h>
+#include <halley/utils/hash.h>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386) || defined(__SSE2__)
+#include <emmintrin.h>
+#define HALLEY_FLAT_HASH_MAP_SSE2
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace Halley {
+	// Hashers used by FlatHashMap. Sequential keys are common (ids, indices), and std::hash is the identity for integers on
+	// most standard libraries, so everything is mixed before use: the low bits pick the slot, and the top bits are stored
+	// alongside it to filter out mismatches without touching the keys.
+	template <typename Key>
+	struct FlatHashMapHasher
+	{
+		size_t operator()(const Key& key) const
+		{
+			uint64_t h = uint64_t(std::hash<Key>()(key)) * 0x9E3779B97F4A7C15ull;
+			return size_t(h ^ (h >> 32));
+		}
+	};
+
+	// String keys can be looked up by const char* or std::string, without building a String first
+	template <>
+	struct FlatHashMapHasher<String>
+	{
+		using is_transparent = void;
+
+		size_t operator()(const String& key) const { return hash(key.c_str(), key.size()); }
+		size_t operator()(const std::string& key) const { return hash(key.c_str(), key.size()); }
+		size_t operator()(const char* key) const { return hash(key, strlen(key)); }
+
+	private:
+		static size_t hash(const char* str, size_t len)
+		{
+			return size_t(Hash::hash(gsl::as_bytes(gsl::span<const char>(str, len))));
+		}
+	};
+
+	template <typename Key>
+	struct FlatHashMapKeyEqual
+	{
+		bool operator()(const Key& a, const Key& b) const { return a == b; }
+	};
+
+	template <>
+	struct FlatHashMapKeyEqual<String>
+	{
+		using is_transparent = void;
+
+		bool operator()(const String& a, const String& b) const { return a.cppStr() == b.cppStr(); }
+		bool operator()(const String& a, const std::string& b) const { return a.cppStr() == b; }
+		bool operator()(const String& a, const char* b) const { return a.cppStr() == b; }
+	};
+
+	namespace FlatHashMapDetail {
+		// Control bytes, one per slot. Full slots store the top 7 bits of their hash, so they're never negative.
+		constexpr int8_t ctrlEmpty = -128;
+		constexpr int8_t ctrlDeleted = -2;
+		constexpr int8_t ctrlSentinel = -1; // Marks the end, for iteration
+
+		constexpr size_t groupWidth = 16;
+
+		// Bitmask of the slots in a group that matched, lowest slot first
+		class BitMask
+		{
+		public:
+			explicit BitMask(uint32_t mask) : mask(mask) {}
+
+			explicit operator bool() const { return mask != 0; }
+			size_t lowest() const
+			{
+#if defined(_MSC_VER)
+				unsigned long index;
+				_BitScanForward(&index, mask);
+				return index;
+#else
+				return size_t(__builtin_ctz(mask));
+#endif
+			}
+			void next() { mask &= mask - 1; }
+
+		private:
+			uint32_t mask;
+		};
+
+		// Looks at a whole group of control bytes at once
+		class Group
+		{
+		public:
+			explicit Group(const int8_t* pos)
+			{
+#ifdef HALLEY_FLAT_HASH_MAP_SSE2
+				ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+#else
+				memcpy(ctrl, pos, groupWidth);
+#endif
+			}
+
+			BitMask match(int8_t h2) const
+			{
+#ifdef HALLEY_FLAT_HASH_MAP_SSE2
+				return BitMask(uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl))));
+#else
+				uint32_t mask = 0;
+				for (size_t i = 0; i < groupWidth; ++i) {
+					mask |= uint32_t(ctrl[i] == h2) << i;
+				}
+				return BitMask(mask);
+#endif
+			}
+
+			BitMask matchEmpty() const
+			{
+				return match(ctrlEmpty);
+			}
+
+			BitMask matchEmptyOrDeleted() const
+			{
+#ifdef HALLEY_FLAT_HASH_MAP_SSE2
+				return BitMask(uint32_t(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(ctrlSentinel), ctrl))));
+#else
+				uint32_t mask = 0;
+				for (size_t i = 0; i < groupWidth; ++i) {
+					mask |= uint32_t(ctrl[i] < ctrlSentinel) << i;
+				}
+				return BitMask(mask);
+#endif
+			}
+
+		private:
+#ifdef HALLEY_FLAT_HASH_MAP_SSE2
+			__m128i ctrl;
+#else
+			int8_t ctrl[groupWidth];
+#endif
+		};
+
+		// Control bytes of tables with no storage yet: lookups find an empty group straight away, and iteration stops at the sentinel
+		inline const int8_t* getEmptyCtrl()
+		{
+			alignas(16) static const int8_t empty[groupWidth] = {
+				ctrlSentinel, ctrlEmpty, ctrlEmpty, ctrlEmpty, ctrlEmpty, ctrlEmpty, ctrlEmpty, ctrlEmpty,
+				ctrlEmpty, ctrlEmpty, ctrlEmpty, ctrlEmpty, ctrlEmpty, ctrlEmpty, ctrlEmpty, ctrlEmpty
+			};
+			return empty;
+		}
+
+		template <typename T>
+		struct MakeVoid { using type = void; };
+
+		template <typename T, typename = void>
+		struct IsTransparent : std::false_type {};
+
+		template <typename T>
+		struct IsTransparent<T, typename MakeVoid<typename T::is_transparent>::type> : std::true_type {};
+	}
+
+	// Open addressing hash map, in the style of Swiss tables. Slots are stored in one flat array, with a parallel array of
+	// control bytes that is probed a group (16 slots) at a time, with SSE2 where available. Lookups rarely touch more than
+	// one cache line of control bytes, and only compare keys whose stored hash bits match.
+	//
+	// Mostly a drop-in for std::unordered_map, with one important difference: inserting can move every element, so
+	// pointers, references and iterators into the map are invalidated by any insertion (erasing only invalidates
+	// the erased element).
+	template <typename Key, typename T, typename Hasher = FlatHashMapHasher<Key>, typename KeyEqual = FlatHashMapKeyEqual<Key>>
+	class FlatHashMap
+	{
+	public:
+		using key_type = Key;
+		using mapped_type = T;
+		using value_type = std::pair<const Key, T>;
+		using size_type = size_t;
+		using difference_type = ptrdiff_t;
+		using hasher = Hasher;
+		using key_equal = KeyEqual;
+		using reference = value_type&;
+		using const_reference = const value_type&;
+		using pointer = value_type*;
+		using const_pointer = const value_type*;
+
+		template <bool Const>
+		class Iterator
+		{
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = typename FlatHashMap::value_type;
+			using difference_type = ptrdiff_t;
+			using reference = typename std::conditional<Const, const value_type&, value_type&>::type;
+			using pointer = typename std::conditional<Const, const value_type*, value_type*>::type;
+
+			Iterator() = default;
+
+			template <bool C = Const, typename = typename std::enable_if<C>::type>
+			Iterator(const Iterator<false>& other)
+				: ctrl(other.ctrl)
+				, slot(other.slot)
+			{}
+
+			reference operator*() const { return *slot; }
+			pointer operator->() const { return slot; }
+
+			Iterator& operator++()
+			{
+				++ctrl;
+				++slot;
+				skipEmpty();
+				return *this;
+			}
+
+			Iterator operator++(int)
+			{
+				auto prev = *this;
+				++*this;
+				return prev;
+			}
+
+			template <bool C>
+			bool operator==(const Iterator<C>& other) const { return ctrl == other.ctrl; }
+			template <bool C>
+			bool operator!=(const Iterator<C>& other) const { return ctrl != other.ctrl; }
+
+		private:
+			friend class FlatHashMap;
+			template <bool> friend class Iterator;
+
+			const int8_t* ctrl = nullptr;
+			pointer slot = nullptr;
+
+			Iterator(const int8_t* ctrl, pointer slot)
+				: ctrl(ctrl)
+				, slot(slot)
+			{}
+
+			void skipEmpty()
+			{
+				while (*ctrl < FlatHashMapDetail::ctrlSentinel) {
+					++ctrl;
+					++slot;
+				}
+			}
+		};
+
+		using iterator = Iterator<false>;
+		using const_iterator = Iterator<true>;
+
+		FlatHashMap() = default;
+
+		explicit FlatHashMap(size_t bucketCount, const Hasher& hash = Hasher(), const KeyEqual& equal = KeyEqual())
+			: hash(hash)
+			, equal(equal)
+		{
+			reserve(bucketCount);
+		}
+
+		template <typename InputIt>
+		FlatHashMap(InputIt first, InputIt last)
+		{
+			insert(first, last);
+		}
+
+		FlatHashMap(std::initializer_list<value_type> values)
+		{
+			insert(values.begin(), values.end());
+		}
+
+		FlatHashMap(const FlatHashMap& other)
+			: hash(other.hash)
+			, equal(other.equal)
+		{
+			reserve(other.size());
+			for (auto& v: other) {
+				insertUnique(hashOf(v.first), v);
+			}
+		}
+
+		FlatHashMap(FlatHashMap&& other) noexcept
+			: hash(std::move(other.hash))
+			, equal(std::move(other.equal))
+		{
+			takeStorage(other);
+		}
+
+		~FlatHashMap()
+		{
+			destroyStorage();
+		}
+
+		FlatHashMap& operator=(const FlatHashMap& other)
+		{
+			if (this != &other) {
+				FlatHashMap copy(other);
+				swap(copy);
+			}
+			return *this;
+		}
+
+		FlatHashMap& operator=(FlatHashMap&& other) noexcept
+		{
+			if (this != &other) {
+				destroyStorage();
+				hash = std::move(other.hash);
+				equal = std::move(other.equal);
+				takeStorage(other);
+			}
+			return *this;
+		}
+
+		FlatHashMap& operator=(std::initializer_list<value_type> values)
+		{
+			clear();
+			insert(values.begin(), values.end());
+			return *this;
+		}
+
+		iterator begin()
+		{
+			iterator iter(ctrl, slots);
+			iter.skipEmpty();
+			return iter;
+		}
+
+		const_iterator begin() const
+		{
+			const_iterator iter(ctrl, slots);
+			iter.skipEmpty();
+			return iter;
+		}
+
+		iterator end() { return iterator(ctrl + capacity, slots + capacity); }
+		const_iterator end() const { return const_iterator(ctrl + capacity, slots + capacity); }
+		const_iterator cbegin() const { return begin(); }
+		const_iterator cend() const { return end(); }
+
+		bool empty() const { return numElements == 0; }
+		size_t size() const { return numElements; }
+		size_t max_size() const { return std::numeric_limits<size_t>::max() / sizeof(value_type); }
+		size_t bucket_count() const { return capacity; }
+		float load_factor() const { return capacity > 0 ? float(numElements) / float(capacity) : 0.0f; }
+		hasher hash_function() const { return hash; }
+		key_equal key_eq() const { return equal; }
+
+		void clear()
+		{
+			if (numElements > 0) {
+				destroySlots();
+			}
+			if (capacity > 0) {
+				memset(ctrl, FlatHashMapDetail::ctrlEmpty, capacity + FlatHashMapDetail::groupWidth);
+				ctrl[capacity] = FlatHashMapDetail::ctrlSentinel;
+			}
+			numElements = 0;
+			resetGrowthLeft();
+		}
+
+		// Afterwards, the map can grow to n elements without moving any of them
+		void reserve(size_t n)
+		{
+			if (n > numElements + growthLeft) {
+				size_t newCapacity = 7;
+				while (getMaxLoad(newCapacity) < n) {
+					newCapacity = newCapacity * 2 + 1;
+				}
+				resize(std::max(newCapacity, capacity));
+			}
+		}
+
+		void rehash(size_t n)
+		{
+			reserve(std::max(n, numElements));
+		}
+
+		std::pair<iterator, bool> insert(const value_type& value)
+		{
+			return emplaceKey(value.first, value);
+		}
+
+		std::pair<iterator, bool> insert(value_type&& value)
+		{
+			return emplaceKey(value.first, std::move(value));
+		}
+
+		template <typename P, typename = typename std::enable_if<std::is_constructible<value_type, P&&>::value>::type>
+		std::pair<iterator, bool> insert(P&& value)
+		{
+			return emplace(std::forward<P>(value));
+		}
+
+		iterator insert(const_iterator, const value_type& value)
+		{
+			return insert(value).first;
+		}
+
+		template <typename InputIt>
+		void insert(InputIt first, InputIt last)
+		{
+			for (; first != last; ++first) {
+				insert(*first);
+			}
+		}
+
+		void insert(std::initializer_list<value_type> values)
+		{
+			insert(values.begin(), values.end());
+		}
+
+		template <typename V>
+		std::pair<iterator, bool> insert_or_assign(const Key& key, V&& value)
+		{
+			auto result = try_emplace(key, std::forward<V>(value));
+			if (!result.second) {
+				result.first->second = std::forward<V>(value);
+			}
+			return result;
+		}
+
+		template <typename V>
+		std::pair<iterator, bool> insert_or_assign(Key&& key, V&& value)
+		{
+			auto result = try_emplace(std::move(key), std::forward<V>(value));
+			if (!result.second) {
+				result.first->second = std::forward<V>(value);
+			}
+			return result;
+		}
+
+		// The key is needed before the slot is known, so the value is built up front (and discarded if the key is present)
+		template <typename... Args>
+		std::pair<iterator, bool> emplace(Args&&... args)
+		{
+			value_type value(std::forward<Args>(args)...);
+			return emplaceKey(value.first, std::move(value));
+		}
+
+		template <typename... Args>
+		iterator emplace_hint(const_iterator, Args&&... args)
+		{
+			return emplace(std::forward<Args>(args)...).first;
+		}
+
+		template <typename... Args>
+		std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args)
+		{
+			return emplaceKey(key, std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+		}
+
+		template <typename... Args>
+		std::pair<iterator, bool> try_emplace(Key&& key, Args&&... args)
+		{
+			return emplaceKey(key, std::piecewise_construct, std::forward_as_tuple(std::move(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+		}
+
+		T& operator[](const Key& key)
+		{
+			return try_emplace(key).first->second;
+		}
+
+		T& operator[](Key&& key)
+		{
+			return try_emplace(std::move(key)).first->second;
+		}
+
+		T& at(const Key& key)
+		{
+			auto iter = find(key);
+			if (iter == end()) {
+				throw std::out_of_range("Key not found in FlatHashMap");
+			}
+			return iter->second;
+		}
+
+		const T& at(const Key& key) const
+		{
+			auto iter = find(key);
+			if (iter == end()) {
+				throw std::out_of_range("Key not found in FlatHashMap");
+			}
+			return iter->second;
+		}
+
+		iterator find(const Key& key)
+		{
+			return findKey(key);
+		}
+
+		const_iterator find(const Key& key) const
+		{
+			return const_cast<FlatHashMap*>(this)->findKey(key);
+		}
+
+		// Heterogeneous lookup, e.g. by const char* on String keys
+		template <typename K, typename H = Hasher, typename = typename std::enable_if<FlatHashMapDetail::IsTransparent<H>::value>::type>
+		iterator find(const K& key)
+		{
+			return findKey(key);
+		}
+
+		template <typename K, typename H = Hasher, typename = typename std::enable_if<FlatHashMapDetail::IsTransparent<H>::value>::type>
+		const_iterator find(const K& key) const
+		{
+			return const_cast<FlatHashMap*>(this)->findKey(key);
+		}
+
+		size_t count(const Key& key) const
+		{
+			return find(key) != end() ? 1 : 0;
+		}
+
+		template <typename K, typename H = Hasher, typename = typename std::enable_if<FlatHashMapDetail::IsTransparent<H>::value>::type>
+		size_t count(const K& key) const
+		{
+			return find(key) != end() ? 1 : 0;
+		}
+
+		bool contains(const Key& key) const
+		{
+			return find(key) != end();
+		}
+
+		std::pair<iterator, iterator> equal_range(const Key& key)
+		{
+			auto iter = find(key);
+			if (iter == end()) {
+				return std::make_pair(iter, iter);
+			}
+			auto next = iter;
+			return std::make_pair(iter, ++next);
+		}
+
+		std::pair<const_iterator, const_iterator> equal_range(const Key& key) const
+		{
+			auto iter = find(key);
+			if (iter == end()) {
+				return std::make_pair(iter, iter);
+			}
+			auto next = iter;
+			return std::make_pair(iter, ++next);
+		}
+
+		// Doesn't move any other elements, so iterating and erasing is fine
+		iterator erase(const_iterator pos)
+		{
+			const size_t index = size_t(pos.ctrl - ctrl);
+			eraseAt(index);
+			iterator next(ctrl + index, slots + index);
+			++next;
+			return next;
+		}
+
+		iterator erase(iterator pos)
+		{
+			return erase(const_iterator(pos));
+		}
+
+		iterator erase(const_iterator first, const_iterator last)
+		{
+			while (first != last) {
+				first = erase(first);
+			}
+			return iterator(const_cast<int8_t*>(last.ctrl), const_cast<pointer>(last.slot));
+		}
+
+		size_t erase(const Key& key)
+		{
+			auto iter = find(key);
+			if (iter == end()) {
+				return 0;
+			}
+			eraseAt(size_t(iter.ctrl - ctrl));
+			return 1;
+		}
+
+		void swap(FlatHashMap& other) noexcept
+		{
+			using std::swap;
+			swap(hash, other.hash);
+			swap(equal, other.equal);
+			swap(ctrl, other.ctrl);
+			swap(slots, other.slots);
+			swap(capacity, other.capacity);
+			swap(numElements, other.numElements);
+			swap(growthLeft, other.growthLeft);
+		}
+
+		bool operator==(const FlatHashMap& other) const
+		{
+			if (size() != other.size()) {
+				return false;
+			}
+			for (auto& v: *this) {
+				auto iter = other.find(v.first);
+				if (iter == other.end() || !(iter->second == v.second)) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		bool operator!=(const FlatHashMap& other) const
+		{
+			return !(*this == other);
+		}
+
+	private:
+		using MutableValue = std::pair<Key, T>;
+
+		// Capacity is always zero or a power of two minus one, so it doubles as the probing mask.
+		// ctrl has capacity + groupWidth bytes: the sentinel, then a copy of the first groupWidth - 1 bytes, so that
+		// groups can be loaded from any slot without wrapping around.
+		int8_t* ctrl = const_cast<int8_t*>(FlatHashMapDetail::getEmptyCtrl());
+		value_type* slots = nullptr;
+		size_t capacity = 0;
+		size_t numElements = 0;
+		size_t growthLeft = 0; // Insertions into empty slots left before a rehash is due
+		Hasher hash;
+		KeyEqual equal;
+
+		// Up to 7/8 full, always leaving at least one empty slot so that probing for a missing key ends
+		static size_t getMaxLoad(size_t capacity)
+		{
+			return capacity - std::max(capacity / 8, size_t(std::min(capacity, size_t(1))));
+		}
+
+		static int8_t getH2(size_t h)
+		{
+			return int8_t(h >> (sizeof(size_t) * 8 - 7));
+		}
+
+		template <typename K>
+		size_t hashOf(const K& key) const
+		{
+			return hash(key);
+		}
+
+		// Quadratic probing over groups, which visits every group once as the capacity is a power of two minus one
+		class ProbeSequence
+		{
+		public:
+			ProbeSequence(size_t h, size_t mask)
+				: mask(mask)
+				, offset(h & mask)
+			{}
+
+			size_t getOffset(size_t i) const { return (offset + i) & mask; }
+			void next()
+			{
+				index += FlatHashMapDetail::groupWidth;
+				offset = (offset + index) & mask;
+			}
+
+		private:
+			size_t mask;
+			size_t offset;
+			size_t index = 0;
+		};
+
+		template <typename K>
+		iterator findKey(const K& key)
+		{
+			const size_t h = hashOf(key);
+			const int8_t h2 = getH2(h);
+			ProbeSequence seq(h, capacity);
+			while (true) {
+				FlatHashMapDetail::Group group(ctrl + seq.getOffset(0));
+				for (auto match = group.match(h2); match; match.next()) {
+					const size_t index = seq.getOffset(match.lowest());
+					if (equal(slots[index].first, key)) {
+						return iterator(ctrl + index, slots + index);
+					}
+				}
+				if (group.matchEmpty()) {
+					return end();
+				}
+				seq.next();
+			}
+		}
+
+		template <typename... Args>
+		std::pair<iterator, bool> emplaceKey(const Key& key, Args&&... args)
+		{
+			const size_t h = hashOf(key);
+			auto iter = findWithHash(key, h);
+			if (iter != end()) {
+				return std::make_pair(iter, false);
+			}
+			return std::make_pair(insertUnique(h, std::forward<Args>(args)...), true);
+		}
+
+		iterator findWithHash(const Key& key, size_t h)
+		{
+			const int8_t h2 = getH2(h);
+			ProbeSequence seq(h, capacity);
+			while (true) {
+				FlatHashMapDetail::Group group(ctrl + seq.getOffset(0));
+				for (auto match = group.match(h2); match; match.next()) {
+					const size_t index = seq.getOffset(match.lowest());
+					if (equal(slots[index].first, key)) {
+						return iterator(ctrl + index, slots + index);
+					}
+				}
+				if (group.matchEmpty()) {
+					return end();
+				}
+				seq.next();
+			}
+		}
+
+		// Inserts a key known not to be present
+		template <typename... Args>
+		iterator insertUnique(size_t h, Args&&... args)
+		{
+			size_t index = findInsertSlot(h);
+			if (growthLeft == 0 && ctrl[index] != FlatHashMapDetail::ctrlDeleted) {
+				rehashForInsert();
+				index = findInsertSlot(h);
+			}
+
+			new (slots + index) value_type(std::forward<Args>(args)...);
+			if (ctrl[index] == FlatHashMapDetail::ctrlEmpty) {
+				--growthLeft;
+			}
+			setCtrl(index, getH2(h));
+			++numElements;
+			return iterator(ctrl + index, slots + index);
+		}
+
+		size_t findInsertSlot(size_t h) const
+		{
+			ProbeSequence seq(h, capacity);
+			while (true) {
+				FlatHashMapDetail::Group group(ctrl + seq.getOffset(0));
+				auto mask = group.matchEmptyOrDeleted();
+				if (mask) {
+					const size_t index = seq.getOffset(mask.lowest());
+					if (index < capacity) {
+						return index;
+					}
+				}
+				if (capacity == 0) {
+					return 0;
+				}
+				seq.next();
+			}
+		}
+
+		void rehashForInsert()
+		{
+			// If tombstones are taking up much of the table, clearing them out is enough
+			if (capacity > FlatHashMapDetail::groupWidth && numElements * 32 <= capacity * 25) {
+				resize(capacity);
+			} else {
+				resize(capacity == 0 ? 7 : capacity * 2 + 1);
+			}
+		}
+
+		void setCtrl(size_t index, int8_t value)
+		{
+			ctrl[index] = value;
+			ctrl[((index - (FlatHashMapDetail::groupWidth - 1)) & capacity) + ((FlatHashMapDetail::groupWidth - 1) & capacity)] = value;
+		}
+
+		void eraseAt(size_t index)
+		{
+			slots[index].~value_type();
+			--numElements;
+
+			// If this slot was never part of a full group, nothing probing through it can be depending on it, so it can go
+			// back to empty. Otherwise it has to stay a tombstone, so that lookups carry on past it.
+			const size_t before = (index - FlatHashMapDetail::groupWidth) & capacity;
+			const auto emptyBefore = FlatHashMapDetail::Group(ctrl + before).matchEmpty();
+			const auto emptyAfter = FlatHashMapDetail::Group(ctrl + index).matchEmpty();
+			const bool wasNeverFull = emptyBefore && emptyAfter && (leadingZeros(emptyBefore) + trailingZeros(emptyAfter)) < FlatHashMapDetail::groupWidth;
+			if (wasNeverFull) {
+				setCtrl(index, FlatHashMapDetail::ctrlEmpty);
+				++growthLeft;
+			} else {
+				setCtrl(index, FlatHashMapDetail::ctrlDeleted);
+			}
+		}
+
+		static size_t trailingZeros(FlatHashMapDetail::BitMask mask)
+		{
+			return mask.lowest();
+		}
+
+		static size_t leadingZeros(FlatHashMapDetail::BitMask mask)
+		{
+			size_t highest = 0;
+			for (; mask; mask.next()) {
+				highest = mask.lowest();
+			}
+			return FlatHashMapDetail::groupWidth - 1 - highest;
+		}
+
+		void resize(size_t newCapacity)
+		{
+			int8_t* oldCtrl = ctrl;
+			value_type* oldSlots = slots;
+			const size_t oldCapacity = capacity;
+
+			allocate(newCapacity);
+
+			for (size_t i = 0; i < oldCapacity; ++i) {
+				if (oldCtrl[i] >= 0) {
+					// Keys are const in value_type, but the old slot is destroyed straight after, so moving from it is safe
+					auto& old = reinterpret_cast<MutableValue&>(oldSlots[i]);
+					const size_t h = hashOf(old.first);
+					const size_t index = findInsertSlot(h);
+					new (slots + index) value_type(std::move(old.first), std::move(old.second));
+					setCtrl(index, getH2(h));
+					oldSlots[i].~value_type();
+				}
+			}
+
+			if (oldCapacity > 0) {
+				::operator delete(oldSlots);
+				delete[] oldCtrl;
+			}
+		}
+
+		void allocate(size_t newCapacity)
+		{
+			capacity = newCapacity;
+			ctrl = new int8_t[capacity + FlatHashMapDetail::groupWidth];
+			memset(ctrl, FlatHashMapDetail::ctrlEmpty, capacity + FlatHashMapDetail::groupWidth);
+			ctrl[capacity] = FlatHashMapDetail::ctrlSentinel;
+			slots = static_cast<value_type*>(::operator new(sizeof(value_type) * capacity));
+			resetGrowthLeft();
+		}
+
+		void resetGrowthLeft()
+		{
+			growthLeft = getMaxLoad(capacity) - numElements;
+		}
+
+		void destroySlots()
+		{
+			for (size_t i = 0; i < capacity; ++i) {
+				if (ctrl[i] >= 0) {
+					slots[i].~value_type();
+				}
+			}
+		}
+
+		void destroyStorage()
+		{
+			if (capacity > 0) {
+				destroySlots();
+				::operator delete(slots);
+				delete[] ctrl;
+			}
+			ctrl = const_cast<int8_t*>(FlatHashMapDetail::getEmptyCtrl());
+			slots = nullptr;
+			capacity = 0;
+			numElements = 0;
+			growthLeft = 0;
+		}
+
+		void takeStorage(FlatHashMap& other)
+		{
+			ctrl = other.ctrl;
+			slots = other.slots;
+			capacity = other.capacity;
+			numElements = other.numElements;
+			growthLeft = other.growthLeft;
+			other.ctrl = const_cast<int8_t*>(FlatHashMapDetail::getEmptyCtrl());
+			other.slots = nullptr;
+			other.capacity = 0;
+			other.numElements = 0;
+			other.growthLeft = 0;
+		}
+	};
+
+	template <typename Key, typename T, typename Hasher, typename KeyEqual>
+	void swap(FlatHashMap<Key, T, Hasher, KeyEqual>& a, FlatHashMap<Key, T, Hasher, KeyEqual>& b) noexcept
+	{
+		a.swap(b);
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Halley {
+	// Linear allocator for temporaries that don't outlive the frame. Each thread has its own, so allocating is a pointer
+	// bump with no locking, and freeing is a no-op (except for the most recent allocation, which is given back, so that
+	// growing vectors don't waste as much).
+	//
+	// Core calls nextFrame() at the start of every frame. Memory is double-buffered: anything allocated during a frame
+	// stays valid until the end of the following one, so it's safe to hand over to the render thread, which submits a
+	// frame while the next one is being updated. Don't keep it for any longer than that, including in tasks that may
+	// still be running or queued by then. Nothing resets it without Core, so code that can run outside of its frame loop
+	// (such as World, in headless servers and tools) shouldn't use it.
+	class FrameArena {
+	public:
+		FrameArena();
+		~FrameArena();
+		FrameArena(const FrameArena& other) = delete;
+		FrameArena& operator=(const FrameArena& other) = delete;
+
+		static FrameArena& get(); // This thread's arena
+		static void nextFrame();
+		static uint64_t getFrameNumber();
+
+		void* alloc(size_t size, size_t alignment = alignof(std::max_align_t));
+		void free(void* ptr, size_t size);
+
+		size_t getBytesUsed() const; // This frame's, on this thread
+		size_t getCapacity() const;
+
+	private:
+		struct Block {
+			std::unique_ptr<char[]> data;
+			size_t size = 0;
+		};
+
+		struct Buffer {
+			std::vector<Block> blocks;
+			size_t curBlock = 0;
+			size_t pos = 0;
+			size_t used = 0;
+
+			void reset();
+		};
+
+		std::array<Buffer, 2> buffers;
+		size_t current = 0;
+		uint64_t frame = 0;
+
+		void sync();
+		void* allocSlow(size_t size, size_t alignment);
+	};
+
+	// STL allocator over the calling thread's FrameArena
+	template <typename T>
+	class FrameAllocator {
+	public:
+		using value_type = T;
+
+		FrameAllocator() = default;
+
+		template <typename U>
+		FrameAllocator(const FrameAllocator<U>&) {}
+
+		T* allocate(size_t n)
+		{
+			return static_cast<T*>(FrameArena::get().alloc(n * sizeof(T), alignof(T)));
+		}
+
+		void deallocate(T* ptr, size_t n)
+		{
+			FrameArena::get().free(ptr, n * sizeof(T));
+		}
+
+		template <typename U>
+		bool operator==(const FrameAllocator<U>&) const { return true; }
+
+		template <typename U>
+		bool operator!=(const FrameAllocator<U>&) const { return false; }
+	};
+
+	template <typename T>
+	using FrameVector = std::vector<T, FrameAllocator<T>>;
+}
@@ -1,19 +1,8 @@
 #pragma once
 
-#include <unordered_map>
-
-#if HAS_EASTL
-
-#include <EASTL/hash_map.h>
+#include "flat_hash_map.h"
 
 namespace Halley {
-	template<typename Key, typename T> using HashMap = eastl::hash_map<Key, T, std::hash<Key>>;
+	// Unlike std::unordered_map, inserting invalidates references to existing elements; see FlatHashMap
+	template<typename Key, typename T> using HashMap = FlatHashMap<Key, T>;
 }
-
-#else
-
-namespace Halley {
-	template<typename Key, typename T> using HashMap = std::unordered_map<Key, T, std::hash<Key>>;
-}
-
-#endif
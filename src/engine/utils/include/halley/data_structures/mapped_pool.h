@@ -62,6 +62,9 @@ namespace Halley {
 			if (blockIdx >= blocks.size()) {
 				blocks.push_back(Block(blocks.size()));
 			}
+			if (entryIdx >= highWater) {
+				highWater = entryIdx + 1;
+			}
 			auto& block = blocks[blockIdx];
 
 			// Find the local entry inside that block and initialize it
@@ -78,6 +81,16 @@ namespace Halley {
 			return std::pair<T*, int64_t>(result, externalIdx);
 		}
 
+		// Makes sure that the next "count" allocations won't need to create any blocks
+		void reserve(size_t count) {
+			// Entries past the high water mark have never been used, so they're handed out sequentially
+			const size_t blocksNeeded = (size_t(highWater) + count + blockLen - 1) / blockLen;
+			blocks.reserve(blocksNeeded);
+			while (blocks.size() < blocksNeeded) {
+				blocks.push_back(Block(blocks.size()));
+			}
+		}
+
 		void free(T* p) {
 			// Swaps the data with the next, so this will actually be the next one to be allocated
 			Entry* entry = reinterpret_cast<Entry*>(p);
@@ -111,8 +124,46 @@ namespace Halley {
 			return reinterpret_cast<T*>(&(data.data));
 		}
 
+		// Allocation state (free list and revisions, but not the contents), so that after restoring it the same
+		// ids are valid and the same ones get allocated next. The contents of live entries must be set again afterwards.
+		template <typename S>
+		void serializeState(S& s) const
+		{
+			s << next;
+			s << highWater;
+			for (uint32_t i = 0; i < highWater; ++i) {
+				auto& entry = blocks[i / blockLen].data[i % blockLen];
+				s << entry.nextFreeEntryIndex;
+				s << entry.revision;
+			}
+		}
+
+		template <typename S>
+		void deserializeState(S& s)
+		{
+			uint32_t prevHighWater = highWater;
+			s >> next;
+			s >> highWater;
+			while (size_t(highWater) > blocks.size() * blockLen) {
+				blocks.push_back(Block(blocks.size()));
+			}
+			for (uint32_t i = 0; i < highWater; ++i) {
+				auto& entry = blocks[i / blockLen].data[i % blockLen];
+				s >> entry.nextFreeEntryIndex;
+				s >> entry.revision;
+			}
+
+			// Entries past the restored high water mark go back to their pristine sequential state
+			for (uint32_t i = highWater; i < prevHighWater; ++i) {
+				auto& entry = blocks[i / blockLen].data[i % blockLen];
+				entry.nextFreeEntryIndex = i + 1;
+				entry.revision = 0;
+			}
+		}
+
 	private:
 		Vector<Block> blocks;
 		uint32_t next = 0;
+		uint32_t highWater = 0;
 	};
 }
@@ -1,8 +1,30 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include "flat_map.h"
+#include "vector.h"
 
 namespace Halley {
+	struct SizePoolStats
+	{
+		size_t elementSize = 0;
+		size_t capacity = 0; // Elements carved out of the memory reserved so far
+		size_t globalFree = 0; // Free elements in the shared free list
+		size_t inUse = 0; // Elements that are either allocated or sitting in a thread's cache
+		size_t bytesReserved = 0;
+	};
+
+	// Pool of fixed size elements, which is safe to use from any thread. Each thread keeps a small cache of free
+	// elements per pool, so alloc() and free() normally don't touch anything shared. Caches are refilled from and
+	// returned to the pool in batches, through lock-free lists; a lock is only taken to reserve more memory.
+	//
+	// Memory is only given back to the system when the pool is destroyed. Elements may be freed from a different
+	// thread than the one that allocated them.
 	class SizePool
 	{
 	public:
@@ -13,21 +35,70 @@ namespace Halley {
 		void* alloc();
 		void free(void* p);
 
+		SizePoolStats getStats() const;
+
 	private:
-		void* pimpl;
-		size_t size;
+		struct Batch;
+		struct ThreadCache;
+		friend struct SizePoolThreadCaches;
+
+		using BatchChunk = std::array<Batch, 1024>;
+		constexpr static size_t maxBatchChunks = 1024;
+
+		const size_t size;
+		const uint32_t batchSize;
+		const uint32_t id;
+
+		// Treiber stacks of batch indices; the top 32 bits are a counter to avoid ABA
+		std::atomic<uint64_t> fullBatches { 0 };
+		std::atomic<uint64_t> emptyBatches { 0 };
+
+		std::array<std::atomic<BatchChunk*>, maxBatchChunks> batchChunks;
+		std::atomic<uint32_t> numBatches { 0 };
+
+		std::mutex reserveMutex;
+		Vector<std::unique_ptr<char[]>> slabs;
+		std::atomic<size_t> capacity { 0 };
+		std::atomic<size_t> globalFree { 0 };
+		std::atomic<size_t> bytesReserved { 0 };
+
+		ThreadCache& getThreadCache();
+		void refill(ThreadCache& cache);
+		void flush(ThreadCache& cache, uint32_t count);
+		void reserveMore(ThreadCache& cache);
+
+		Batch& getBatch(uint32_t idx) const;
+		uint32_t makeBatch();
+		bool pop(std::atomic<uint64_t>& stack, uint32_t& idx);
+		void push(std::atomic<uint64_t>& stack, uint32_t idx);
 	};
 
-	// yo dawg
+	// Routes allocations to pools by size class. Sizes up to maxSizeClass share a pool per class, and larger ones get a
+	// pool of their own. Thread-safe.
 	class PoolPool
 	{
 	public:
+		constexpr static size_t maxSizeClass = 4096;
+
 		static SizePool* getPool(size_t size);
 
+		// For allocations of any size: the ones over maxSizeClass go to the system allocator instead
+		static void* alloc(size_t size);
+		static void free(void* p, size_t size);
+
+		static Vector<SizePoolStats> getStats();
+
 	private:
+		constexpr static size_t numSizeClasses = 40;
+
+		PoolPool();
 		static PoolPool& get();
+		static size_t getSizeClass(size_t size);
+		static size_t getClassSize(size_t sizeClass);
 
-		FlatMap<size_t, SizePool*> pools;
+		std::array<std::atomic<SizePool*>, numSizeClasses> classPools;
+		std::mutex mutex;
+		FlatMap<size_t, SizePool*> largePools;
 	};
 
 	template <typename T>
@@ -36,27 +107,20 @@ namespace Halley {
 	public:
 		static void* alloc()
 		{
-			return get().pool->alloc();
+			return get()->alloc();
 		}
 
 		static void free(void* p)
 		{
-			get().pool->free(p);
+			get()->free(p);
 		}
 
 	private:
-		PoolAllocator()
+		static SizePool* get()
 		{
-			pool = new SizePool(sizeof(T));
+			static SizePool* pool = PoolPool::getPool(sizeof(T));
+			return pool;
 		}
-
-		static PoolAllocator& get()
-		{
-			static PoolAllocator instance;
-			return instance;
-		}
-
-		SizePool* pool;
 	};
-	
+
 }
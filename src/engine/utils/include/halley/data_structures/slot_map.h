@@ -0,0 +1,178 @@
+#pragma once
+
+#include "vector.h"
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <gsl/gsl>
+
+namespace Halley {
+	struct SlotMapHandle {
+		constexpr static uint32_t invalidIndex = std::numeric_limits<uint32_t>::max();
+
+		uint32_t index = invalidIndex;
+		uint32_t generation = 0;
+
+		SlotMapHandle() = default;
+		SlotMapHandle(uint32_t index, uint32_t generation) : index(index), generation(generation) {}
+
+		// Packed into a single value, e.g. to be stored as an id elsewhere
+		explicit SlotMapHandle(uint64_t value) : index(uint32_t(value & 0xFFFFFFFFull)), generation(uint32_t(value >> 32)) {}
+		uint64_t getValue() const { return uint64_t(index) | (uint64_t(generation) << 32); }
+
+		bool isValid() const { return index != invalidIndex; }
+
+		bool operator==(const SlotMapHandle& other) const { return index == other.index && generation == other.generation; }
+		bool operator!=(const SlotMapHandle& other) const { return !(*this == other); }
+	};
+
+	// Values are kept densely packed, so iterating is as fast as going through a Vector, and looked up through
+	// handles that stay valid until that value is removed. Removing swaps the last value into the hole, so it's O(1),
+	// but it changes the order of values (and invalidates pointers to them; only handles are stable).
+	//
+	// Each slot has a generation counter, which is odd while the slot is in use and bumped on removal, so a stale
+	// handle to a reused slot is never mistaken for the new value.
+	template <typename T>
+	class SlotMap {
+	public:
+		using Handle = SlotMapHandle;
+		using iterator = typename Vector<T>::iterator;
+		using const_iterator = typename Vector<T>::const_iterator;
+
+		template <typename... Args>
+		Handle emplace(Args&&... args)
+		{
+			values.emplace_back(std::forward<Args>(args)...);
+
+			uint32_t slotIndex;
+			if (freeList != Handle::invalidIndex) {
+				slotIndex = freeList;
+				freeList = slots[slotIndex].index;
+			} else {
+				Expects(slots.size() < size_t(Handle::invalidIndex));
+				slotIndex = uint32_t(slots.size());
+				slots.push_back(Slot());
+			}
+
+			auto& slot = slots[slotIndex];
+			slot.index = uint32_t(values.size() - 1);
+			++slot.generation;
+			denseToSlot.push_back(slotIndex);
+			return Handle(slotIndex, slot.generation);
+		}
+
+		Handle insert(T value)
+		{
+			return emplace(std::move(value));
+		}
+
+		// Returns false if the handle was already stale
+		bool remove(Handle handle)
+		{
+			if (!contains(handle)) {
+				return false;
+			}
+			removeAt(slots[handle.index].index);
+			return true;
+		}
+
+		// Removes by position in the dense array, e.g. while iterating; the last value takes its place
+		void removeAt(size_t denseIndex)
+		{
+			Expects(denseIndex < values.size());
+			const uint32_t slotIndex = denseToSlot[denseIndex];
+			const size_t last = values.size() - 1;
+			if (denseIndex != last) {
+				values[denseIndex] = std::move(values[last]);
+				denseToSlot[denseIndex] = denseToSlot[last];
+				slots[denseToSlot[denseIndex]].index = uint32_t(denseIndex);
+			}
+			values.pop_back();
+			denseToSlot.pop_back();
+
+			auto& slot = slots[slotIndex];
+			++slot.generation;
+			slot.index = freeList;
+			freeList = slotIndex;
+		}
+
+		bool contains(Handle handle) const
+		{
+			return handle.index < slots.size() && slots[handle.index].generation == handle.generation && (handle.generation & 1) != 0;
+		}
+
+		T* tryGet(Handle handle)
+		{
+			return contains(handle) ? &values[slots[handle.index].index] : nullptr;
+		}
+
+		const T* tryGet(Handle handle) const
+		{
+			return contains(handle) ? &values[slots[handle.index].index] : nullptr;
+		}
+
+		T& get(Handle handle)
+		{
+			Expects(contains(handle));
+			return values[slots[handle.index].index];
+		}
+
+		const T& get(Handle handle) const
+		{
+			Expects(contains(handle));
+			return values[slots[handle.index].index];
+		}
+
+		// Handle of the value at this position in the dense array
+		Handle getHandleAt(size_t denseIndex) const
+		{
+			const uint32_t slotIndex = denseToSlot[denseIndex];
+			return Handle(slotIndex, slots[slotIndex].generation);
+		}
+
+		T& operator[](size_t denseIndex) { return values[denseIndex]; }
+		const T& operator[](size_t denseIndex) const { return values[denseIndex]; }
+
+		gsl::span<T> getValues() { return values; }
+		gsl::span<const T> getValues() const { return values; }
+
+		iterator begin() { return values.begin(); }
+		iterator end() { return values.end(); }
+		const_iterator begin() const { return values.begin(); }
+		const_iterator end() const { return values.end(); }
+
+		size_t size() const { return values.size(); }
+		bool empty() const { return values.empty(); }
+
+		void reserve(size_t count)
+		{
+			values.reserve(count);
+			denseToSlot.reserve(count);
+			slots.reserve(count);
+		}
+
+		// Invalidates every handle, but keeps the generations, so old handles don't match values added afterwards
+		void clear()
+		{
+			for (auto slotIndex: denseToSlot) {
+				auto& slot = slots[slotIndex];
+				++slot.generation;
+				slot.index = freeList;
+				freeList = slotIndex;
+			}
+			values.clear();
+			denseToSlot.clear();
+		}
+
+	private:
+		struct Slot {
+			uint32_t index = Handle::invalidIndex; // Into the dense array while in use, or the next free slot
+			uint32_t generation = 0;
+		};
+
+		Vector<T> values;
+		Vector<uint32_t> denseToSlot;
+		Vector<Slot> slots;
+		uint32_t freeList = Handle::invalidIndex;
+	};
+}
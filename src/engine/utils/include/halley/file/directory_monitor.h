@@ -1,19 +1,29 @@
 #pragma once
 
 #include <memory>
+#include <vector>
+#include "halley/file/path.h"
 
 namespace Halley
 {
-	class Path;
 	class DirectoryMonitorPimpl;
-	
+
 	class DirectoryMonitor
 	{
 	public:
+		struct Changes
+		{
+			std::vector<Path> paths; // Relative to the monitored directory, sorted, each listed once. May be files or directories.
+			bool fullRescan = false; // Individual changes couldn't be tracked (e.g. the event queue overflowed), so anything might have changed
+
+			bool any() const { return fullRescan || !paths.empty(); }
+		};
+
 		explicit DirectoryMonitor(const Path& p);
 		~DirectoryMonitor();
 
 		bool poll();
+		Changes pollChanges(); // Everything that changed since the last poll
 		bool hasRealImplementation() const;
 
 	private:
@@ -31,6 +31,7 @@ namespace Halley
 		String toString() const;
 
 		size_t getNumberPaths() const;
+		const std::vector<String>& getParts() const;
 
 		Path dropFront(int numberFolders) const;
 
@@ -2,6 +2,8 @@
 
 #include <map>
 #include <vector>
+#include <atomic>
+#include <mutex>
 #include "halley/text/halleystring.h"
 #include "halley/maths/vector2.h"
 #include "halley/resources/resource.h"
@@ -9,6 +11,8 @@
 namespace Halley
 {
 	class ResourceLoader;
+	class ResourceDataStatic;
+	class ConfigNodeView;
 	class Serializer;
 	class Deserializer;
 
@@ -47,6 +51,7 @@ namespace Halley
 	class ConfigNode
 	{
 		friend class ConfigFile;
+		friend class ConfigNodeView;
 
 	public:
 		using MapType = std::map<String, ConfigNode>;
@@ -54,7 +59,7 @@ namespace Halley
 
 		ConfigNode();
 		explicit ConfigNode(const ConfigNode& other);
-		ConfigNode(ConfigNode&& other);
+		ConfigNode(ConfigNode&& other) noexcept;
 		ConfigNode(MapType&& entryMap);
 		ConfigNode(SequenceType&& entryList);
 		ConfigNode(String&& value);
@@ -68,7 +73,7 @@ namespace Halley
 		~ConfigNode();
 		
 		ConfigNode& operator=(const ConfigNode& other) = delete;
-		ConfigNode& operator=(ConfigNode&& other);
+		ConfigNode& operator=(ConfigNode&& other) noexcept;
 		ConfigNode& operator=(bool value);
 		ConfigNode& operator=(int value);
 		ConfigNode& operator=(float value);
@@ -163,16 +168,26 @@ namespace Halley
 	class ConfigFile : public Resource
 	{
 	public:
+		// Version of the serialized ConfigNode format
+		constexpr static int curVersion = 2;
+
 		ConfigFile();
 		ConfigFile(const ConfigFile& other) = delete;
 		ConfigFile(ConfigFile&& other);
+		~ConfigFile();
 
 		ConfigFile& operator=(const ConfigFile& other) = delete;
 		ConfigFile& operator=(ConfigFile&& other);
 
+		// Files loaded from binary data (see BinaryConfig) only decode it into ConfigNodes the first time these are called
 		ConfigNode& getRoot();
 		const ConfigNode& getRoot() const;
 
+		// Reads the binary data in place if the file was loaded from it, or the root ConfigNode otherwise. Prefer this
+		// to getRoot() for read-only access, as it never decodes anything.
+		ConfigNodeView getRootView() const;
+		bool isBinary() const;
+
 		void serialize(Serializer& s) const;
 		void deserialize(Deserializer& s);
 
@@ -180,11 +195,16 @@ namespace Halley
 		constexpr static AssetType getAssetType() { return AssetType::ConfigFile; }
 
 		void reload(Resource&& resource) override;
+		size_t getMemoryUsage() const override;
 
 	private:
-		ConfigNode root;
+		mutable ConfigNode root;
+		std::unique_ptr<ResourceDataStatic> binaryData;
+		mutable std::atomic<bool> rootDecoded { true };
+		mutable std::mutex decodeMutex;
 
-		void updateRoot();
+		void updateRoot() const;
+		void decodeRoot() const;
 	};
 
 	class ConfigObserver
@@ -195,6 +215,7 @@ namespace Halley
 		ConfigObserver(const ConfigFile& file);
 
 		const ConfigNode& getRoot() const;
+		ConfigNodeView getRootView() const;
 		
 		bool needsUpdate() const;
 		void update();
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "config_file.h"
+#include "halley/data_structures/vector.h"
+
+namespace Halley {
+	// Assembles a ConfigNode from a stream of parser events, so that readers don't need to build a tree of their own first.
+	// Containers are opened with beginMap()/beginSequence() and closed with end(); inside a map, every value must be
+	// preceded by setKey(). Values and containers get the position last passed to setPosition().
+	class ConfigNodeBuilder {
+	public:
+		void setPosition(int line, int column);
+
+		void beginMap();
+		void beginSequence();
+		ConfigNode& end(); // Returns the finished container, which is only valid until the next event
+
+		void setKey(String key);
+		ConfigNode& addValue(ConfigNode value); // Same as end()
+
+		bool isInMap() const;
+		bool isExpectingKey() const;
+		bool isDone() const;
+
+		ConfigNode takeResult();
+
+	private:
+		struct Frame {
+			ConfigNode node;
+			String key;
+			bool hasKey = false;
+			int line = 0;
+			int column = 0;
+		};
+
+		Vector<Frame> stack;
+		ConfigNode result;
+		bool done = false;
+		int line = 0;
+		int column = 0;
+
+		void beginContainer(ConfigNode node);
+	};
+}
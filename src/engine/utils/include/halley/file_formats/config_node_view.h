@@ -0,0 +1,117 @@
+#pragma once
+
+#include "config_file.h"
+#include "halley/support/exception.h"
+#include <gsl/gsl>
+
+namespace Halley
+{
+	namespace BinaryConfigDetail {
+		struct Node;
+	}
+
+	// Read-only handle to a config node, which is either inside binary config data (see BinaryConfig) or a ConfigNode.
+	// Navigating binary data doesn't allocate or decode anything: maps are looked up through a hash table stored in the
+	// data, and sequence elements are at fixed offsets. Use toConfigNode() when a mutable copy is needed.
+	//
+	// Views don't own anything, so they're only valid for as long as the data or ConfigNode they point to. A default
+	// constructed view, or one for a missing key, is undefined, so the "default value" accessors work as in ConfigNode.
+	class ConfigNodeView
+	{
+		friend class BinaryConfig;
+
+	public:
+		ConfigNodeView();
+		ConfigNodeView(const ConfigNode& node);
+
+		ConfigNodeType getType() const;
+		bool isBinary() const;
+
+		int asInt() const;
+		float asFloat() const;
+		bool asBool() const;
+		Vector2i asVector2i() const;
+		Vector2f asVector2f() const;
+		String asString() const;
+		const char* asCString() const; // Only for string nodes, and doesn't allocate
+		gsl::span<const gsl::byte> asBytes() const;
+
+		int asInt(int defaultValue) const;
+		float asFloat(float defaultValue) const;
+		bool asBool(bool defaultValue) const;
+		String asString(const String& defaultValue) const;
+		Vector2i asVector2i(Vector2i defaultValue) const;
+		Vector2f asVector2f(Vector2f defaultValue) const;
+
+		size_t size() const; // Number of elements in a sequence or entries in a map
+		bool hasKey(const String& key) const;
+		ConfigNodeView operator[](const String& key) const;
+		ConfigNodeView operator[](size_t idx) const;
+
+		// Literal keys are looked up without making a String
+		template <size_t N>
+		bool hasKey(const char (&key)[N]) const
+		{
+			return getType() == ConfigNodeType::Map && findKey(key, N - 1).getType() != ConfigNodeType::Undefined;
+		}
+
+		template <size_t N>
+		ConfigNodeView operator[](const char (&key)[N]) const
+		{
+			return findKey(key, N - 1);
+		}
+
+		// Visits map entries in key order, which is the same order as ConfigNode::MapType
+		template <typename F>
+		void forEachEntry(F f) const
+		{
+			const size_t n = size();
+			if (getType() != ConfigNodeType::Map) {
+				throw Exception(getNodeDebugId() + " is not a map type", HalleyExceptions::Resources);
+			}
+			if (binaryNode) {
+				for (size_t i = 0; i < n; ++i) {
+					f(getBinaryMapKey(i), getBinaryMapValue(i));
+				}
+			} else {
+				for (auto& e: node->asMap()) {
+					f(e.first.c_str(), ConfigNodeView(e.second));
+				}
+			}
+		}
+
+		ConfigNode toConfigNode() const;
+
+		int getLine() const;
+		int getColumn() const;
+
+	private:
+		const ConfigNode* node = nullptr;
+		const BinaryConfigDetail::Node* binaryNode = nullptr;
+		const gsl::byte* data = nullptr;
+		size_t dataSize = 0;
+
+		ConfigNodeView(const BinaryConfigDetail::Node* binaryNode, const gsl::byte* data, size_t dataSize);
+
+		ConfigNodeView getBinaryChild(uint32_t offset) const;
+		const char* getBinaryMapKey(size_t idx) const;
+		ConfigNodeView getBinaryMapValue(size_t idx) const;
+		ConfigNodeView findKey(const char* key, size_t length) const;
+		const gsl::byte* getBinaryRange(uint32_t offset, size_t length) const;
+
+		String getNodeDebugId() const;
+	};
+
+	// Flat, little-endian serialization of a ConfigNode tree, made to be memory mapped and read in place with
+	// ConfigNodeView. Everything is 4 byte aligned, and all references are offsets from the start of the data.
+	class BinaryConfig
+	{
+	public:
+		constexpr static uint32_t magic = 0x47464348; // "HCFG"
+		constexpr static uint32_t curVersion = 1;
+
+		static Bytes write(const ConfigNode& root);
+		static bool isBinaryConfig(gsl::span<const gsl::byte> data);
+		static ConfigNodeView getRoot(gsl::span<const gsl::byte> data); // The data must be 4 byte aligned
+	};
+}
@@ -62,6 +62,7 @@ namespace Halley {
 		char* getPixels() { return px.get(); }
 		const char* getPixels() const { return px.get(); }
 		size_t getByteSize() const;
+		size_t getMemoryUsage() const override;
 
 		static unsigned int convertRGBAToInt(unsigned int r, unsigned int g, unsigned int b, unsigned int a=255);
 		static void convertIntToRGBA(unsigned int col, unsigned int& r, unsigned int& g, unsigned int& b, unsigned int& a);
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "halley/text/halleystring.h"
+#include "config_file.h"
+#include <cstdint>
+#include <gsl/gsl>
+
+namespace Halley {
+	class ExecutionQueue;
+
+	// Receives the contents of a JSON document as it's read, in document order.
+	// Inside objects, every value is preceded by onKey().
+	class IJSONReaderHandler {
+	public:
+		virtual ~IJSONReaderHandler() {}
+
+		virtual void onNull() = 0;
+		virtual void onBool(bool value) = 0;
+		virtual void onInt(int64_t value) = 0; // Integers without a fraction or exponent, that fit
+		virtual void onFloat(double value) = 0;
+		virtual void onString(String value) = 0;
+		virtual void onKey(String key) = 0;
+		virtual void onStartObject() = 0;
+		virtual void onEndObject() = 0;
+		virtual void onStartArray() = 0;
+		virtual void onEndArray() = 0;
+	};
+
+	// Event based JSON reader. Nothing is kept besides the nesting of the current position, so memory use doesn't
+	// depend on the size of the document, and nesting depth isn't limited by the call stack.
+	class JSONReader {
+	public:
+		explicit JSONReader(gsl::span<const gsl::byte> data, int firstLine = 1);
+
+		// Reads exactly one value, throwing on malformed input
+		void parse(IJSONReaderHandler& handler);
+
+		// Position of the start of the last token read, for handlers to use. Both start at 1.
+		int getLine() const { return tokenLine; }
+		int getColumn() const { return tokenColumn; }
+
+		// Builds the ConfigNode directly, without any intermediate tree. Like the YAML importer, booleans are stored
+		// as the strings "true" and "false", and null as an undefined node.
+		static ConfigNode parseConfigNode(gsl::span<const gsl::byte> data);
+
+		// For newline delimited JSON: a sequence with one entry per non-blank line. Lines are independent, so if a queue
+		// is given, they're read in parallel on it when there are enough of them.
+		static ConfigNode parseJSONLines(gsl::span<const gsl::byte> data, ExecutionQueue* queue = nullptr);
+
+	private:
+		const char* pos;
+		const char* end;
+		const char* lineStart;
+		int line;
+		int tokenLine = 0;
+		int tokenColumn = 0;
+		std::string scratch;
+
+		void markToken();
+		void skipWhitespace();
+		char peek() const;
+		void expect(char c);
+		void readKey(IJSONReaderHandler& handler);
+		void readString();
+		void readNumber(IJSONReaderHandler& handler);
+		void readLiteral(const char* literal);
+		uint32_t readHex4();
+		[[noreturn]] void fail(const String& message) const;
+	};
+}
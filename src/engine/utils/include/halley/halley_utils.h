@@ -3,14 +3,18 @@
 namespace Halley {} // Get GitHub to realise this is C++ :3
 
 #include "concurrency/concurrent.h"
+#include "concurrency/mpmc_queue.h"
+#include "concurrency/spsc_queue.h"
 
 #include "bytes/byte_serializer.h"
 #include "bytes/compression.h"
 #include "bytes/fuzzer.h"
 
+#include "data_structures/aabb_tree.h"
 #include "data_structures/bin_pack.h"
 #include "data_structures/circular_buffer.h"
 #include "data_structures/dynamic_grid.h"
+#include "data_structures/frame_arena.h"
 #include "data_structures/hash_map.h"
 #include "data_structures/mapped_pool.h"
 #include "data_structures/maybe.h"
@@ -18,6 +22,7 @@ namespace Halley {} // Get GitHub to realise this is C++ :3
 #include "data_structures/memory_pool.h"
 #include "data_structures/nullable_reference.h"
 #include "data_structures/rect_spatial_checker.h"
+#include "data_structures/slot_map.h"
 #include "data_structures/tree_map.h"
 #include "data_structures/vector.h"
 
@@ -26,9 +31,12 @@ namespace Halley {} // Get GitHub to realise this is C++ :3
 
 #include "file_formats/binary_file.h"
 #include "file_formats/config_file.h"
+#include "file_formats/config_node_view.h"
+#include "file_formats/config_node_builder.h"
 #include "file_formats/image.h"
 #include "file_formats/ini_reader.h"
 #include "file_formats/json_file.h"
+#include "file_formats/json_reader.h"
 #include "file_formats/text_file.h"
 #include "file_formats/text_reader.h"
 #include "file_formats/xml_file.h"
@@ -44,6 +52,7 @@ namespace Halley {} // Get GitHub to realise this is C++ :3
 #include "maths/random.h"
 #include "maths/range.h"
 #include "maths/rect.h"
+#include "maths/transform2d.h"
 #include "maths/tween.h"
 #include "maths/vector2.h"
 #include "maths/vector3.h"
@@ -62,16 +71,21 @@ namespace Halley {} // Get GitHub to realise this is C++ :3
 #include "support/debug.h"
 #include "support/exception.h"
 #include "support/logger.h"
+#include "support/memory_tracker.h"
+#include "support/profiler.h"
 #include "support/redirect_stream.h"
 
 #include "text/encode.h"
 #include "text/halleystring.h"
 #include "text/i18n.h"
+#include "text/string_builder.h"
 #include "text/string_converter.h"
+#include "text/string_id.h"
 #include "text/string_serializer.h"
 
 #include "time/halleytime.h"
 #include "time/stopwatch.h"
+#include "time/time_histogram.h"
 
 #include "utils/algorithm.h"
 #include "utils/encrypt.h"
@@ -38,6 +38,10 @@ namespace Halley {
 		Matrix4f operator*(const Matrix4f& param) const;
 		Vector2f operator*(const Vector2f& param) const;
 
+		// Same as applying operator* to each point, but faster; dst must be at least as large as src, and may be the same span
+		void transformPoints(gsl::span<const Vector2f> src, gsl::span<Vector2f> dst) const;
+		bool isAffine2D() const; // True if the bottom row is (0, 0, 0, 1), i.e. there's no perspective divide
+
 		static Matrix4f makeIdentity();
 		static Matrix4f makeRotationZ(Angle1f angle);
 		static Matrix4f makeScaling2D(float scaleX, float scaleY);
@@ -23,19 +23,31 @@
 
 #include <halley/utils/utils.h>
 #include <halley/support/exception.h>
+#include <halley/maths/range.h>
 #include <gsl/span>
+#include <array>
 #include <cstdint>
 
 namespace Halley {
 	class MT199937AR;
 
+	enum class RandomEngine {
+		MersenneTwister, // Default, so existing seeds keep producing the same sequences
+		Xoshiro // xoshiro256**: 32 bytes of state, much cheaper to seed, copy and split
+	};
+
 	class Random {
 	public:
 		static Random& getGlobal();
 
+		// A generator for one of many independent streams derived from the same seed (e.g. world seed and entity id),
+		// without having to keep a parent generator around. Always uses Xoshiro.
+		static Random makeStream(uint64_t seed, uint64_t stream);
+
 		Random();
-		Random(uint32_t seed);
-		Random(gsl::span<const gsl::byte> data);
+		explicit Random(RandomEngine engine);
+		Random(uint32_t seed, RandomEngine engine = RandomEngine::MersenneTwister);
+		Random(gsl::span<const gsl::byte> data, RandomEngine engine = RandomEngine::MersenneTwister);
 		~Random();
 
 		Random(const Random& other) = delete;
@@ -67,16 +79,42 @@ namespace Halley {
 			return vec[getRandomIndex(vec)];
 		}
 
+		// Bulk generation, for when many values are needed at once (particles, procedural generation, noise...).
+		// These run several Xoshiro lanes side by side so the compiler can vectorize them, so they don't produce the
+		// same values as calling getFloat/getInt repeatedly would, but are still deterministic for a given state.
+		void fill(gsl::span<float> dst, float min, float max); // [min, max)
+		void fill(gsl::span<float> dst, Range<float> range) { fill(dst, range.start, range.end); }
+		void fill(gsl::span<int32_t> dst, int32_t min, int32_t max); // [min, max]
+		void fill(gsl::span<uint32_t> dst, uint32_t min, uint32_t max); // [min, max]
+
 		void getBytes(gsl::span<gsl::byte> dst);
 		void setSeed(uint32_t seed);
 		void setSeed(gsl::span<const gsl::byte> data);
 
+		// Returns a new Xoshiro generator seeded from this one and the stream id, e.g. one per worker thread or entity
+		Random split(uint64_t stream);
+
+		// Xoshiro only: skips ahead 2^128 values, so generators copied from the same state and jumped a different number
+		// of times never overlap
+		void jump();
+
+		RandomEngine getEngine() const;
+
 		uint32_t getRawInt();
+		uint64_t getRawInt64();
 		float getRawFloat();
 		double getRawDouble();
 
 	private:
+		RandomEngine engine;
 		std::unique_ptr<MT199937AR> generator;
+		std::array<uint64_t, 4> state;
+
+		uint64_t nextXoshiro();
+		void seedXoshiro(uint64_t seed);
+
+		template <typename F>
+		void generateBulk(size_t n, F f);
 	};
 
 }
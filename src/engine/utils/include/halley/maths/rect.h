@@ -186,6 +186,11 @@ namespace Halley {
 			return Rect2D<T>(Vector2D<T>(x.start, y.start), Vector2D<T>(x.end, y.end));
 		}
 
+		Rect2D<T> merge(Rect2D<T> p) const
+		{
+			return Rect2D<T>(Vector2D<T>(std::min(p1.x, p.p1.x), std::min(p1.y, p.p1.y)), Vector2D<T>(std::max(p2.x, p.p2.x), std::max(p2.y, p.p2.y)));
+		}
+
 		Range<T> getHorizontal() const
 		{
 			return Range<T>(p1.x, p2.x);
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "vector2.h"
+#include "angle.h"
+
+namespace Halley {
+	// Position, rotation and scale, applied in the order scale -> rotate -> translate.
+	// Combining transforms keeps this decomposed form, which is exact for uniform scales; a non-uniform parent
+	// scale combined with a rotated child would really introduce shear, which sprites can't represent anyway.
+	class Transform2D {
+	public:
+		Vector2f position;
+		Angle1f rotation;
+		Vector2f scale = Vector2f(1, 1);
+
+		Transform2D() = default;
+		Transform2D(Vector2f position, Angle1f rotation = Angle1f(), Vector2f scale = Vector2f(1, 1))
+			: position(position)
+			, rotation(rotation)
+			, scale(scale)
+		{}
+
+		Vector2f transformPoint(Vector2f p) const
+		{
+			return position + (p * scale).rotate(rotation);
+		}
+
+		Vector2f inverseTransformPoint(Vector2f p) const
+		{
+			return (p - position).rotate(-rotation) / scale;
+		}
+
+		// Returns the transform of a child with this as its parent
+		Transform2D operator*(const Transform2D& child) const
+		{
+			return Transform2D(transformPoint(child.position), rotation + child.rotation, scale * child.scale);
+		}
+
+		// Batch versions of transformPoint() and operator*, which only evaluate the rotation once.
+		// dst/result must be at least as large as the input, and may be the same span.
+		void transformPoints(gsl::span<const Vector2f> src, gsl::span<Vector2f> dst) const
+		{
+			Expects(dst.size() >= src.size());
+			float s, c;
+			rotation.sincos(s, c);
+			for (std::ptrdiff_t i = 0; i < src.size(); ++i) {
+				dst[i] = position + (src[i] * scale).rotate(s, c);
+			}
+		}
+
+		void combine(gsl::span<const Transform2D> children, gsl::span<Transform2D> result) const
+		{
+			Expects(result.size() >= children.size());
+			float s, c;
+			rotation.sincos(s, c);
+			for (std::ptrdiff_t i = 0; i < children.size(); ++i) {
+				const auto& child = children[i];
+				result[i] = Transform2D(position + (child.position * scale).rotate(s, c), rotation + child.rotation, scale * child.scale);
+			}
+		}
+
+		bool operator==(const Transform2D& other) const
+		{
+			return position == other.position && rotation == other.rotation && scale == other.scale;
+		}
+
+		bool operator!=(const Transform2D& other) const
+		{
+			return !(*this == other);
+		}
+	};
+}
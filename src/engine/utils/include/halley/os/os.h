@@ -24,6 +24,8 @@
 #include "halley/text/halleystring.h"
 #include "halley/file/path.h"
 #include "halley/core/api/system_api.h"
+#include <gsl/span>
+#include <memory>
 
 namespace Halley {
 	class ComputerData {
@@ -36,6 +38,32 @@ namespace Halley {
 		long long RAM = 0;
 	};
 
+	// A read-only view of a whole file, which any thread can read from at once
+	class MappedFile {
+	public:
+		virtual ~MappedFile() {}
+		virtual gsl::span<const gsl::byte> getSpan() const = 0;
+
+		// Hints that all of it is about to be read
+		virtual void prefetch() {}
+	};
+
+	// A process started by OS::startProcess, which is talked to through its stdin and stdout (stderr is shared with ours).
+	// Destroying it terminates the process, if it's still running.
+	class ChildProcess {
+	public:
+		virtual ~ChildProcess() {}
+
+		// Both block. read returns 0 once the process closes its stdout, e.g. by exiting or being terminated,
+		// so terminate() can be called from another thread to unblock a reader.
+		virtual bool write(gsl::span<const gsl::byte> data) = 0;
+		virtual size_t read(gsl::span<gsl::byte> dst) = 0;
+
+		virtual bool isRunning() = 0;
+		virtual Maybe<int> getExitCode() = 0; // Empty while it's running
+		virtual void terminate() = 0;
+	};
+
 	class OS {
 	public:
 		virtual ~OS() {}
@@ -59,13 +87,24 @@ namespace Halley {
 		virtual void atomicWriteFile(const Path& path, const Bytes& data, Maybe<Path> backupOldVersionPath = {});
 		virtual std::vector<Path> enumerateDirectory(const Path& path);
 
+		// Null if the file can't be mapped (or this platform can't do it), so callers can fall back to reading it
+		virtual std::shared_ptr<MappedFile> mapFile(const Path& path);
+
 		virtual void setConsoleColor(int foreground, int background);
 		virtual int runCommand(String command);
+		virtual std::unique_ptr<ChildProcess> startProcess(const Path& executable, const std::vector<String>& args);
 
 		virtual std::shared_ptr<IClipboard> getClipboard();
 
 		virtual void openURL(const String& url);
 
+		// These apply to the calling thread, and are best-effort: they quietly do nothing if the OS refuses
+		virtual void setThreadPriority(ThreadPriority priority);
+		virtual void setThreadAffinity(uint64_t affinityMask);
+
+		// Highest resident memory of this process so far, in bytes, or 0 if unknown
+		virtual size_t getPeakMemoryUsage();
+
 	private:
 		static OS* osInstance;
 	};
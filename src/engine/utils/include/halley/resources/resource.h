@@ -26,7 +26,35 @@ namespace Halley
 		AudioEvent,
 		Sprite,
 		SpriteSheet,
-		Shader
+		Shader,
+		Prefab,
+		LuaScript
+	};
+
+	template <>
+	struct EnumNames<ImportAssetType> {
+		constexpr std::array<const char*, 18> operator()() const {
+			return{{
+				"undefined",
+				"skip",
+				"codegen",
+				"simpleCopy",
+				"font",
+				"bitmapFont",
+				"image",
+				"texture",
+				"material",
+				"animation",
+				"config",
+				"audio",
+				"audioEvent",
+				"sprite",
+				"spriteSheet",
+				"shader",
+				"prefab",
+				"luaScript"
+			}};
+		}
 	};
 
 	// This order matters.
@@ -46,12 +74,13 @@ namespace Halley
 		Animation,
 		Font,
 		AudioClip,
-		AudioEvent
+		AudioEvent,
+		Prefab
 	};
 
 	template <>
 	struct EnumNames<AssetType> {
-		constexpr std::array<const char*, 13> operator()() const {
+		constexpr std::array<const char*, 14> operator()() const {
 			return{{
 				"binaryFile",
 				"textFile",
@@ -65,13 +94,15 @@ namespace Halley
 				"animation",
 				"font",
 				"audioClip",
-				"audioEvent"
+				"audioEvent",
+				"prefab"
 			}};
 		}
 	};
 
 	class ResourceObserver;
 	class Resources;
+	class ResourceLoader;
 
 	class Resource
 	{
@@ -83,9 +114,25 @@ namespace Halley
 		void setAssetId(const String& name);
 		const String& getAssetId() const;
 		virtual void onLoaded(Resources& resources);
-		
+
+		// Resources whose loadResource reads with getStream() hide this, so their data isn't fetched ahead of time
+		static bool loadsFromStream(const Metadata& meta) { return false; }
+
+		// Roughly how many bytes this is holding on to, counted against its collection's memory budget
+		virtual size_t getMemoryUsage() const;
+
+		// Called on the main thread when its collection is over budget, least recently used first, before anything gets
+		// unloaded. Drops down to a cheaper representation if there is one, and must leave the resource usable, as it
+		// may still be in use. Returns whether anything will be released.
+		virtual bool reduceMemoryUsage();
+
+		// Resources that can apply a reimport to themselves, without being rebuilt, hide this. Called on the main thread
+		// with the new version's loader before falling back to loading it anew, which happens if this returns false.
+		static bool updateInPlace(Resource& resource, ResourceLoader& loader) { return false; }
+
 		int getAssetVersion() const;
 		void reloadResource(Resource&& resource);
+		void onUpdatedInPlace(const Metadata& meta);
 
 	protected:
 		virtual void reload(Resource&& resource);
@@ -25,6 +25,7 @@ This file is subject to the terms of halley_license.txt.
 #include "halley/file/path.h"
 #include <memory>
 #include <functional>
+#include <atomic>
 #include <halley/concurrency/future.h>
 #include <gsl/gsl>
 #include "metadata.h"
@@ -59,6 +60,7 @@ namespace Halley {
 	public:
 		ResourceDataStatic(String path);
 		ResourceDataStatic(const void* data, size_t size, String path, bool owning = true);
+		ResourceDataStatic(std::shared_ptr<const char> data, size_t size, String path); // Keeps whatever owns the data alive
 
 		void set(const void* data, size_t size, bool owning = true);
 		bool isLoaded() const;
@@ -98,6 +100,23 @@ namespace Halley {
 	};
 
 
+	// Nanoseconds spent on each stage of loading one resource, see ResourceLoadTrace. Stages that finish after the resource
+	// is handed out, such as the reads for textures (which load asynchronously) and GPU uploads, add to it from their own threads.
+	struct ResourceLoadTiming {
+		std::atomic<int64_t> queue{ 0 }; // Waiting for the load queue to get to it
+		std::atomic<int64_t> io{ 0 };
+		std::atomic<int64_t> unpack{ 0 }; // Decrypting and decompressing
+		std::atomic<int64_t> decode{ 0 }; // Constructing the resource, not counting other resources it loads
+		std::atomic<int64_t> upload{ 0 };
+
+		// Whatever providers report unpacking while reading goes to unpack, and the rest of it to io
+		std::unique_ptr<ResourceDataStatic> read(IResourceLocator& locator, const String& asset, AssetType type);
+		void inflate(ResourceDataStatic& data);
+
+		// The timing being read for on this thread, if any, for providers to add their unpacking to
+		static ResourceLoadTiming* getCurrent();
+	};
+
 	enum class ResourceLoadPriority {
 		Low = 0,
 		Normal = 1,
@@ -121,6 +140,9 @@ namespace Halley {
 		std::unique_ptr<ResourceDataStream> getStream();
 		Future<std::unique_ptr<ResourceDataStatic>> getAsync() const;
 
+		// Only while load tracing is on, for resources to add stages that happen after loading, like GPU uploads
+		const std::shared_ptr<ResourceLoadTiming>& getTiming() const { return timing; }
+
 	private:
 		ResourceLoader(ResourceLoader&& loader) noexcept;
 		ResourceLoader(IResourceLocator& locator, const String& name, AssetType type, ResourceLoadPriority priority, const HalleyAPI* api);
@@ -133,6 +155,9 @@ namespace Halley {
 		const HalleyAPI* api;
 		const Metadata* metadata;
 		bool loaded = false;
+		mutable std::unique_ptr<ResourceDataStatic> prefetched; // Already read (and inflated) by the load queue
+		std::shared_ptr<ResourceLoadTiming> timing;
+		int64_t syncReadTime = 0; // Spent in getStatic, which isn't decoding
 	};
 
 }
@@ -1,5 +1,6 @@
 #pragma once
 #include <halley/time/halleytime.h>
+#include <cstdint>
 
 namespace Halley
 {
@@ -7,6 +8,24 @@ namespace Halley
 	class GameLoader;
 	class HalleyAPI;
 
+	enum class FramePacingMode
+	{
+		Timer,          // Frames start on a fixed schedule at the target FPS
+		VSync,          // Presenting blocks until the display is ready, which sets the pace; deltas are snapped to whole refresh intervals
+		VariableRefresh // Each frame starts as soon as the previous one is done, capped at the target FPS, with deltas as measured
+	};
+
+	struct FramePacing
+	{
+		FramePacingMode mode = FramePacingMode::Timer;
+		int maxFixedStepsPerFrame = 5; // Any steps beyond this are dropped, so that a slow frame doesn't make the next ones even slower
+		int refreshRate = 0; // Of the display, in Hz; if 0, VSync assumes it matches the target FPS
+
+		// VSync only: delays the start of each frame so that it finishes just before presenting, rather than waiting
+		// for the display after it's done, which cuts down the time between reading input and showing its effect
+		bool lateInputSampling = false;
+	};
+
 	class IMainLoopable
 	{
 	public:
@@ -24,6 +43,9 @@ namespace Halley
 		virtual void onTerminatedInError(const std::string& error) = 0;
 
 		virtual int getTargetFPS() = 0;
+		virtual FramePacing getFramePacing() { return FramePacing(); }
+		virtual int64_t getLastPresentWaitNs() const { return 0; } // How long the last frame was blocked waiting for the display
+		virtual bool isHeadless() const { return false; } // Only fixed updates are run, and getFramePacing is ignored
 	};
 
 	class MainLoop
@@ -38,6 +60,7 @@ namespace Halley
 
 		int fps = 60;
 		bool capFrameRate = false;
+		FramePacing pacing;
 
 		void runLoop();
 		bool isRunning() const;
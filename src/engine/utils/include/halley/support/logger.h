@@ -3,10 +3,14 @@
 #include <exception>
 #include <set>
 #include <mutex>
+#include <atomic>
+#include <memory>
+#include <cstdint>
 
 namespace Halley
 {
 	class String;
+	class AsyncLogQueue;
 
 	enum class LoggerLevel
 	{
@@ -33,24 +37,74 @@ namespace Halley
 		bool devMode;
 	};
 
+	// Limits how often a single place in the code can log. Declare one as a static next to the call, and log through it:
+	//   static LoggerCallSite callSite("Pathfinder::findPath");
+	//   Logger::log(callSite, LoggerLevel::Warning, "No path found");
+	// Messages over the limit within a second are dropped, and their count is logged with the next one that gets through.
+	class LoggerCallSite
+	{
+	public:
+		explicit LoggerCallSite(const char* name, uint32_t maxPerSecond = 10);
+
+		bool tryLog(uint32_t& suppressedBefore); // suppressedBefore is set to how many were dropped since the last one let through
+		const char* getName() const { return name; }
+
+	private:
+		const char* name;
+		const uint32_t maxPerSecond;
+		std::atomic<int64_t> windowStart;
+		std::atomic<uint32_t> count;
+		std::atomic<uint32_t> suppressed;
+	};
+
+	struct LoggerStats
+	{
+		uint64_t logged = 0; // Handed to the sinks so far
+		uint64_t droppedQueueFull = 0; // Async mode only
+		uint64_t droppedRateLimited = 0;
+	};
+
 	class Logger
 	{
+		friend class AsyncLogQueue;
+
 	public:
+		Logger();
+		~Logger();
+
 		static void setInstance(Logger& logger);
 
 		static void addSink(ILoggerSink& sink);
 		static void removeSink(ILoggerSink& sink);
 
+		// In async mode, log() only pushes the message into a fixed size queue, and a background thread hands it to the
+		// sinks, so sinks are always called from that thread. If the queue is full, the message is dropped and counted.
+		// Errors still wait until they've been handed to the sinks, so they aren't lost if the program is about to go down.
+		// Switch modes only while no other threads are logging.
+		static void setAsync(bool enabled, size_t queueSize = 4096);
+		static bool isAsync();
+		static void flush(); // Waits for everything logged so far to reach the sinks
+
 		static void log(LoggerLevel level, const String& msg);
+		static void log(LoggerCallSite& callSite, LoggerLevel level, const String& msg);
 		static void logDev(const String& msg);
 		static void logInfo(const String& msg);
 		static void logWarning(const String& msg);
 		static void logError(const String& msg);
 		static void logException(const std::exception& e);
 
+		static LoggerStats getStats();
+
 	private:
 		static Logger* instance;
 
 		std::set<ILoggerSink*> sinks;
+		std::recursive_mutex sinksMutex;
+		std::unique_ptr<AsyncLogQueue> asyncQueue;
+
+		std::atomic<uint64_t> logged { 0 };
+		std::atomic<uint64_t> droppedRateLimited { 0 };
+
+		void dispatch(LoggerLevel level, const String& msg);
 	};
 }
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "halley/text/halleystring.h"
+#include "halley/data_structures/vector.h"
+#include <cstdint>
+
+namespace Halley {
+	enum class AssetType;
+
+	enum class MemoryTag : uint8_t
+	{
+		Untagged,
+		Entity,
+		Resources,
+		Audio,
+		UI,
+		Net,
+		Graphics
+	};
+
+	struct MemoryTagStats
+	{
+		size_t liveBytes = 0;
+		size_t peakBytes = 0;
+		size_t liveAllocations = 0;
+		uint64_t totalAllocations = 0;
+		uint64_t lastFrameAllocations = 0; // Made during the last complete frame
+	};
+
+	class MemorySnapshot
+	{
+	public:
+		MemoryTagStats total;
+		Vector<MemoryTagStats> tags; // Indexed by MemoryTracker tag
+
+		String toString() const;
+		String diff(const MemorySnapshot& before) const; // What changed since "before", per tag
+	};
+
+	// Counts live bytes and allocations for each tag. A tag is set per thread with MemoryTagScope, and everything
+	// allocated with operator new while it's set is charged to it, even if it's freed elsewhere. Resource loads are
+	// further broken down by asset type.
+	//
+	// Counting only happens in builds with HALLEY_MEMORY_TRACKING (the USE_MEMORY_TRACKING CMake option), which replace
+	// the global operator new and delete; everywhere else the stats are all zero. On Windows, this only covers the
+	// module Halley is linked into.
+	class MemoryTracker
+	{
+	public:
+		static constexpr bool isEnabled()
+		{
+#ifdef HALLEY_MEMORY_TRACKING
+			return true;
+#else
+			return false;
+#endif
+		}
+
+		static size_t getNumTags();
+		static size_t getTag(MemoryTag tag);
+		static size_t getTag(AssetType type);
+		static String getTagName(size_t tag);
+
+		static size_t getCurrentTag();
+		static void setCurrentTag(size_t tag);
+
+		static void nextFrame();
+		static MemorySnapshot capture();
+	};
+
+	class MemoryTagScope
+	{
+	public:
+		explicit MemoryTagScope(MemoryTag tag);
+		explicit MemoryTagScope(AssetType type);
+		~MemoryTagScope();
+
+		MemoryTagScope(const MemoryTagScope& other) = delete;
+		MemoryTagScope& operator=(const MemoryTagScope& other) = delete;
+
+	private:
+		size_t prevTag;
+	};
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "halley/text/halleystring.h"
+#include "halley/text/string_converter.h"
+#include "halley/data_structures/vector.h"
+#include <cstdint>
+#include <atomic>
+#include <array>
+
+namespace Halley {
+	class Path;
+
+	enum class ProfilerEventType : uint8_t
+	{
+		Frame,
+		System,
+		Render,
+		GPU,
+		ResourceLoad,
+		Audio,
+		Task,
+		Custom,
+		Counter,
+		Script
+	};
+
+	template <>
+	struct EnumNames<ProfilerEventType> {
+		constexpr std::array<const char*, 10> operator()() const {
+			return{{
+				"frame",
+				"system",
+				"render",
+				"gpu",
+				"resourceLoad",
+				"audio",
+				"task",
+				"custom",
+				"counter",
+				"script"
+			}};
+		}
+	};
+
+	struct ProfilerEvent
+	{
+		const char* name;
+		int64_t startNs;
+		int64_t endNs;
+		uint32_t frame;
+		ProfilerEventType type;
+		float value = 0.0f; // Counters only
+	};
+
+	// Frame profiler. While enabled, begin/end events are recorded into a fixed-size ring buffer per thread, so
+	// recording never takes a lock or allocates (other than the first event on each thread). The last few seconds
+	// can then be exported as Chrome trace JSON, which opens in chrome://tracing and Perfetto.
+	//
+	// Names are kept by pointer, so they must outlive the profiler: use string literals or internName().
+	class Profiler
+	{
+	public:
+		class Scope
+		{
+		public:
+			Scope(const char* name, ProfilerEventType type);
+			~Scope();
+
+			Scope(const Scope& other) = delete;
+			Scope& operator=(const Scope& other) = delete;
+
+		private:
+			const char* name;
+			int64_t startNs;
+			ProfilerEventType type;
+			bool active;
+		};
+
+		static constexpr size_t eventsPerThread = 64 * 1024;
+
+		static void setEnabled(bool enabled);
+		static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+		static void nextFrame();
+		static uint32_t getFrameNumber();
+
+		static int64_t getTimeNs();
+		static void record(const char* name, ProfilerEventType type, int64_t startNs, int64_t endNs);
+
+		// GPU events go on their own track; times must already be converted to CPU time.
+		// Only one thread may record them at a time (the one running the video backend).
+		static void recordGPU(const char* name, int64_t startNs, int64_t endNs);
+
+		// A value over time, which the trace shows as a graph
+		static void recordCounter(const char* name, float value);
+
+		static void setThreadName(const String& name);
+		static const char* internName(const String& name);
+
+		// Events still in the ring buffers, for each thread that recorded any
+		static Vector<std::pair<String, Vector<ProfilerEvent>>> getEvents();
+
+		static String exportChromeTrace();
+		static void exportChromeTrace(const Path& path);
+
+	private:
+		static std::atomic<bool> enabled;
+	};
+}
@@ -26,6 +26,7 @@
 #include <sstream>
 #include <halley/data_structures/vector.h>
 #include <gsl/gsl_assert>
+#include <gsl/span>
 #include <iomanip>
 #include <cstdint>
 
@@ -46,6 +47,7 @@ namespace Halley {
 		String(const char* utf8);
 		String(const char* utf8,size_t bytes);
 		String(const std::basic_string<Character>& str);
+		String(std::basic_string<Character>&& str) noexcept;
 		String(const String& str) noexcept;
 		String(String&& str) noexcept;
 
@@ -129,6 +131,7 @@ namespace Halley {
 		// Unicode routines
 		StringUTF16 getUTF16() const;
 		StringUTF32 getUTF32() const;
+		size_t getUTF32(gsl::span<utf32type> dst) const; // Writes up to dst.size() code points, returns how many were written
 		size_t getUTF32Len() const;
 
 		// Static unicode routines
@@ -145,12 +148,12 @@ namespace Halley {
 
 		//////////
 
-		String operator += (const String &p);
-		String operator += (const char* p);
-		String operator += (const wchar_t* p);
-		String operator += (const double &p);
-		String operator += (const int &p);
-		String operator += (const Character &p);
+		String& operator += (const String &p);
+		String& operator += (const char* p);
+		String& operator += (const wchar_t* p);
+		String& operator += (const double &p);
+		String& operator += (const int &p);
+		String& operator += (const Character &p);
 
 		bool operator== (const String& rhp) const;
 		bool operator!= (const String& rhp) const;
@@ -169,6 +172,10 @@ namespace Halley {
 	};
 
 	String operator+ (const String& lhp, const String& rhp);
+	String operator+ (String&& lhp, const String& rhp);
+	String operator+ (const String& lhp, const char* rhp);
+	String operator+ (String&& lhp, const char* rhp);
+	String operator+ (const char* lhp, const String& rhp);
 	std::ostream& operator<< (std::ostream& os, const String& rhp);
 	std::istream& operator>> (std::istream& is, String& rhp);
 
@@ -3,9 +3,10 @@
 #include "halleystring.h"
 #include <map>
 #include "halley/data_structures/maybe.h"
+#include "halley/data_structures/vector.h"
 
 namespace Halley {
-	class ConfigNode;
+	class ConfigNodeView;
 	class ConfigFile;
 	class ConfigObserver;
 	class I18N;
@@ -75,9 +76,13 @@ namespace Halley {
 		Maybe<String> countryCode;
 	};
 
+	// Strings aren't copied out of the localisation files: lookups go straight to the files' own hashed tables, which
+	// for binary configs (the importer's output) are read in place from the mapped asset. So loading and switching
+	// language cost next to nothing, and lookups don't allocate until a LocalisedString is made.
 	class I18N {
 	public:
 		I18N();
+		~I18N();
 
 		void update();
 		void loadLocalisationFile(const ConfigFile& config);
@@ -87,6 +92,7 @@ namespace Halley {
 		std::vector<I18NLanguage> getLanguagesAvailable() const;
 
 		LocalisedString get(const String& key) const;
+		const char* getCString(const String& key) const; // Null if missing from both current and fallback language
 		LocalisedString getPreProcessedUserString(const String& string) const;
 
 		template <typename T>
@@ -105,13 +111,22 @@ namespace Halley {
 		char getDecimalSeparator() const;
 
 	private:
+		struct LanguageTable {
+			const ConfigFile* file;
+			String key; // Of the language's entry in the file
+		};
+
+		struct LocalisationFile;
+
 		I18NLanguage currentLanguage;
 		Maybe<I18NLanguage> fallbackLanguage;
-		std::map<I18NLanguage, std::map<String, String>> strings;
-		std::map<String, ConfigObserver> observers;
+		std::map<I18NLanguage, Vector<LanguageTable>> languages; // Files loaded later take priority
+		std::map<String, LocalisationFile> files;
 		int version = 0;
 
-		void loadLocalisation(const ConfigNode& node);
+		void addLanguageTables(const ConfigFile& file);
+		ConfigNodeView find(const I18NLanguage& language, const String& key) const;
+		ConfigNodeView find(const String& key) const;
 	};
 }
 
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "halleystring.h"
+#include "string_converter.h"
+
+namespace Halley
+{
+	// Builds strings into a buffer that is kept between uses, so code that makes a lot of short-lived strings (logging,
+	// UI labels) can clear and reuse one builder instead of allocating for every toString and operator+.
+	//
+	// format() replaces each "{}" in the format string with the next argument, and "{{" and "}}" with "{" and "}".
+	// Numbers, strings and characters are written straight into the buffer; anything else goes through toString.
+	class StringBuilder
+	{
+	public:
+		explicit StringBuilder(size_t capacity = 256);
+
+		void clear(); // Keeps the buffer
+		void reserve(size_t capacity);
+
+		bool isEmpty() const { return buffer.empty(); }
+		size_t size() const { return buffer.size(); }
+		const char* c_str() const { return buffer.c_str(); }
+		const std::string& cppStr() const { return buffer; }
+
+		String toString() const; // Copies, leaving the buffer for reuse
+		String release(); // Moves the buffer out, leaving the builder empty
+
+		StringBuilder& append(const char* str);
+		StringBuilder& append(const char* str, size_t length);
+		StringBuilder& append(const String& str);
+		StringBuilder& append(const std::string& str);
+		StringBuilder& append(char c);
+		StringBuilder& append(bool value);
+		StringBuilder& appendFloat(double value, int precisionDigits = -1, char decimalSeparator = '.');
+
+		template <typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+		StringBuilder& append(T value)
+		{
+			return appendFloat(value);
+		}
+
+		template <typename T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value && !StringConverterDetail::IsCharacter<T>::value, int>::type = 0>
+		StringBuilder& append(T value, int base = 10)
+		{
+			Expects(base == 10 || base == 16 || base == 8);
+			char tmp[StringConverterDetail::integerBufferSize];
+			return append(tmp, StringConverterDetail::writeInteger(tmp, value, base));
+		}
+
+		template <typename T, typename std::enable_if<!std::is_arithmetic<T>::value && !std::is_convertible<const T&, const char*>::value, int>::type = 0>
+		StringBuilder& append(const T& value)
+		{
+			return append(Halley::toString(value));
+		}
+
+		template <typename T>
+		StringBuilder& operator<<(const T& value)
+		{
+			return append(value);
+		}
+
+		template <typename... Args>
+		StringBuilder& format(const char* fmt, const Args&... args)
+		{
+			doFormat(fmt, args...);
+			return *this;
+		}
+
+	private:
+		std::string buffer;
+
+		// Appends the format string up to the next "{}" and returns what follows it, or nullptr if it ended
+		const char* appendFormatUntilPlaceholder(const char* fmt);
+
+		void doFormat(const char* fmt)
+		{
+			if (appendFormatUntilPlaceholder(fmt)) {
+				throw Exception("Too few arguments for format string.", HalleyExceptions::Utils);
+			}
+		}
+
+		template <typename T, typename... Args>
+		void doFormat(const char* fmt, const T& arg, const Args&... args)
+		{
+			fmt = appendFormatUntilPlaceholder(fmt);
+			if (!fmt) {
+				throw Exception("Too many arguments for format string.", HalleyExceptions::Utils);
+			}
+			append(arg);
+			doFormat(fmt, args...);
+		}
+	};
+}
@@ -7,6 +7,39 @@
 
 namespace Halley
 {
+	// Formats numbers into a caller-provided buffer, so that neither toString nor StringBuilder need a stringstream
+	namespace StringConverterDetail {
+		constexpr size_t integerBufferSize = 72; // Enough for 64 bits in base 2 with a sign
+		constexpr size_t floatBufferSize = 64;
+
+		size_t writeInteger(char* dst, uint64_t magnitude, bool negative, int base);
+		size_t writeFloat(char* dst, size_t dstSize, long double value, int precisionDigits, char decimalSeparator); // Returns the size needed, which may be larger than dstSize
+
+		template <typename T, typename std::enable_if<std::is_signed<T>::value, int>::type = 0>
+		size_t writeInteger(char* dst, T value, int base)
+		{
+			if (base == 10) {
+				const bool negative = value < 0;
+				const uint64_t magnitude = negative ? uint64_t(0) - uint64_t(int64_t(value)) : uint64_t(value);
+				return writeInteger(dst, magnitude, negative, base);
+			} else {
+				// Streams print negative numbers in bases other than 10 as their two's complement
+				return writeInteger(dst, uint64_t(typename std::make_unsigned<T>::type(value)), false, base);
+			}
+		}
+
+		template <typename T, typename std::enable_if<!std::is_signed<T>::value, int>::type = 0>
+		size_t writeInteger(char* dst, T value, int base)
+		{
+			return writeInteger(dst, uint64_t(value), false, base);
+		}
+
+		template <typename T>
+		struct IsCharacter {
+			constexpr static bool value = std::is_same<T, char>::value || std::is_same<T, signed char>::value || std::is_same<T, unsigned char>::value;
+		};
+	}
+
 
 	template <typename T>
 	struct EnumNames {
@@ -150,35 +183,38 @@ namespace Halley
 	String toString(T src, int precisionDigits = -1, char decimalSeparator = '.')
 	{
 		Expects(precisionDigits >= -1 && precisionDigits <= 20);
-		std::stringstream str;
-		if (precisionDigits != -1) {
-			str << std::fixed << std::setprecision(precisionDigits);
+		char buffer[StringConverterDetail::floatBufferSize];
+		const size_t len = StringConverterDetail::writeFloat(buffer, sizeof(buffer), src, precisionDigits, decimalSeparator);
+		if (len < sizeof(buffer)) {
+			return String(buffer, len);
 		}
-		str << src;
 
-		String result;
-		if (precisionDigits == -1) {
-			result = String::prettyFloat(str.str());
-		} else {
-			result = str.str();
-		}
-
-		if (decimalSeparator != '.') {
-			result = result.replaceAll(String("."), String(decimalSeparator));
-		}
-
-		return result;
+		// Only huge numbers with fixed precision end up here
+		std::string result(len + 1, '\0');
+		StringConverterDetail::writeFloat(&result[0], result.size(), src, precisionDigits, decimalSeparator);
+		result.resize(len);
+		return String(std::move(result));
 	}
 
-	template <typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+	template <typename T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value && !StringConverterDetail::IsCharacter<T>::value, int>::type = 0>
 	String toString(T value, int base = 10)
 	{
 		Expects(base == 10 || base == 16 || base == 8);
-		std::stringstream ss;
-		if (base == 16) ss.setf(std::ios::hex, std::ios::basefield);
-		else if (base == 8) ss.setf(std::ios::oct, std::ios::basefield);
-		ss << value;
-		return ss.str();
+		char buffer[StringConverterDetail::integerBufferSize];
+		return String(buffer, StringConverterDetail::writeInteger(buffer, value, base));
+	}
+
+	// Same as streaming them: characters are written as they are, and bools as 0 or 1
+	template <typename T, typename std::enable_if<StringConverterDetail::IsCharacter<T>::value, int>::type = 0>
+	String toString(T value)
+	{
+		return String(char(value));
+	}
+
+	template <typename T, typename std::enable_if<std::is_same<T, bool>::value, int>::type = 0>
+	String toString(T value)
+	{
+		return String(value ? "1" : "0");
 	}
 
 	template <typename T, typename std::enable_if<!std::is_integral<T>::value && !std::is_floating_point<T>::value, int>::type = 0>
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "halleystring.h"
+#include <cstdint>
+#include <functional>
+
+namespace Halley
+{
+	// FNV-1a. It's a poor hash for hash tables, but it's simple enough to run at compile time; StringId hashes are
+	// mixed again before being used as keys.
+	constexpr uint64_t hashStringLiteral(const char* str, size_t length)
+	{
+		uint64_t hash = 0xcbf29ce484222325ull;
+		for (size_t i = 0; i < length; ++i) {
+			hash ^= uint64_t(uint8_t(str[i]));
+			hash *= 0x100000001b3ull;
+		}
+		return hash;
+	}
+
+	// A string literal along with its hash, worked out at compile time
+	class StringIdLiteral
+	{
+	public:
+		template <size_t N>
+		constexpr StringIdLiteral(const char (&str)[N])
+			: str(str)
+			, length(N - 1)
+			, hash(hashStringLiteral(str, N - 1))
+		{}
+
+		constexpr const char* getString() const { return str; }
+		constexpr size_t getLength() const { return length; }
+		constexpr uint64_t getHash() const { return hash; }
+
+	private:
+		const char* str;
+		size_t length;
+		uint64_t hash;
+	};
+
+	// Handle to an interned string. Interning takes a hash and a lookup in a global table (which is thread-safe), so make
+	// ids once, e.g. when loading or into constants, and then use them for comparisons and lookups, which are integer
+	// operations. The same string always has the same id within a run, but ids aren't stable across runs, so serialize
+	// the string instead. Interned strings are never freed.
+	//
+	// The empty string is id 0, which is also what default constructed ids are.
+	class StringId
+	{
+	public:
+		constexpr StringId() = default;
+		explicit StringId(const String& str);
+		explicit StringId(const char* str);
+		explicit StringId(const StringIdLiteral& literal);
+
+		bool isValid() const { return value != 0; }
+		uint32_t getValue() const { return value; }
+		const String& getString() const;
+		uint64_t getHash() const; // Same as hashStringLiteral, so it can be switched on against compile-time hashes
+
+		bool operator==(const StringId& other) const { return value == other.value; }
+		bool operator!=(const StringId& other) const { return value != other.value; }
+		bool operator<(const StringId& other) const { return value < other.value; } // Interning order, not alphabetical
+
+		static size_t getNumInterned();
+
+	private:
+		uint32_t value = 0;
+
+		static uint32_t intern(const char* str, size_t length, uint64_t hash);
+	};
+}
+
+namespace std {
+	template<>
+	struct hash<Halley::StringId>
+	{
+		size_t operator()(const Halley::StringId& id) const
+		{
+			return std::hash<uint32_t>()(id.getValue());
+		}
+	};
+}
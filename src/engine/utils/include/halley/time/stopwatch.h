@@ -22,6 +22,7 @@
 \*****************************************************************/
 
 #include "halleytime.h"
+#include "time_histogram.h"
 #include <chrono>
 #include <cstdint>
 
@@ -56,11 +57,16 @@ namespace Halley {
 		explicit StopwatchAveraging(int nSamples = 30);
 		void beginSample();
 		void endSample();
+		void addSample(int64_t ns);
 
 		int64_t elapsedNanoSeconds(Mode mode) const;
 		int64_t averageElapsedNanoSeconds() const;
 		int64_t lastElapsedNanoSeconds() const;
 
+		// Percentiles, to catch the spikes that averages hide
+		TimeHistogram& getHistogram();
+		const TimeHistogram& getHistogram() const;
+
 	private:
 		int nSamples;
 		int nsTakenAvgSamples = 0;
@@ -70,5 +76,7 @@ namespace Halley {
 		int64_t nsTaken = 0;
 		int64_t nsTakenAvg = 0;
 		int64_t nsTakenAvgAccum = 0;
+
+		TimeHistogram histogram;
 	};
 }
\ No newline at end of file
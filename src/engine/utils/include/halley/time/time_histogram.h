@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include "halley/text/halleystring.h"
+
+namespace Halley {
+	struct TimeHistogramStats {
+		size_t samples = 0;
+		int64_t mean = 0;
+		int64_t p50 = 0;
+		int64_t p95 = 0;
+		int64_t p99 = 0;
+		int64_t max = 0;
+
+		String toString() const; // In milliseconds
+	};
+
+	// Records durations (in nanoseconds) into log-linear buckets, in the style of HdrHistogram: each power of two is
+	// split into 32 buckets, so percentiles are within about 3% of the real value, at a fixed size and O(1) per
+	// sample. Anything over a minute is clamped.
+	//
+	// Samples are reported over two windows: the last complete run of windowSamples (or the current one, until the
+	// first is complete), and the whole run since the last reset.
+	class TimeHistogram {
+	public:
+		enum class Window {
+			Recent,
+			Total
+		};
+
+		explicit TimeHistogram(size_t windowSamples = 300);
+
+		void addSample(int64_t ns);
+		void reset();
+
+		void setWindowSamples(size_t samples);
+		size_t getWindowSamples() const;
+
+		TimeHistogramStats getStats(Window window) const;
+
+	private:
+		constexpr static int subBucketBits = 5;
+		constexpr static int maxValueBits = 36;
+		constexpr static size_t numBuckets = size_t(maxValueBits - subBucketBits + 1) << subBucketBits;
+
+		struct Buckets {
+			std::array<uint32_t, numBuckets> counts;
+			size_t samples = 0;
+			int64_t total = 0;
+			int64_t max = 0;
+
+			Buckets();
+			void add(int64_t ns);
+			void clear();
+			TimeHistogramStats getStats() const;
+		};
+
+		size_t windowSamples;
+		Buckets current;
+		Buckets total;
+		TimeHistogramStats lastWindow;
+
+		static size_t getBucket(int64_t ns);
+		static int64_t getBucketValue(size_t bucket);
+	};
+}
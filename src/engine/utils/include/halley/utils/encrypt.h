@@ -4,10 +4,21 @@
 
 namespace Halley {
 	class String;
+	class ExecutionQueue;
 
+	// AES-128 in CBC mode, with PKCS7 padding. Uses the CPU's AES instructions when it has them.
 	class Encrypt {
 	public:
 		static Bytes encrypt(const Bytes& iv, const String& key, const Bytes& data);
 		static Bytes decrypt(const Bytes& iv, const String& key, const Bytes& data);
+
+		// Same result, but large buffers are split into ranges that are decrypted in parallel on the queue. Unlike
+		// encryption, CBC decryption of a block only needs its own ciphertext and the previous block's.
+		static Bytes decrypt(const Bytes& iv, const String& key, const Bytes& data, ExecutionQueue& queue);
+
+		static bool hasHardwareSupport();
+
+	private:
+		static Bytes doDecrypt(const Bytes& iv, const String& key, const Bytes& data, ExecutionQueue* queue);
 	};
-}
\ No newline at end of file
+}
@@ -1,5 +1,16 @@
 #include "halley/audio/resampler.h"
 #include "../../contrib/speex/speex_resampler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386)
+#define RESAMPLER_SSE
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define RESAMPLER_NEON
+#include <arm_neon.h>
+#endif
 
 using namespace Halley;
 
@@ -10,18 +21,89 @@ static std::unique_ptr<SpeexResamplerState, void(*)(SpeexResamplerState*)> makeR
 	return std::unique_ptr<SpeexResamplerState, void(*)(SpeexResamplerState*)>(rawResampler, [] (SpeexResamplerState* s) { speex_resampler_destroy(s); });
 }
 
+namespace {
+	constexpr size_t maxPhases = 320; // 44.1 <-> 48 kHz needs 160
+	constexpr double pi = 3.14159265358979323846;
+
+	size_t greatestCommonDivisor(size_t a, size_t b)
+	{
+		while (b != 0) {
+			const size_t t = a % b;
+			a = b;
+			b = t;
+		}
+		return a;
+	}
+
+	// n is always a multiple of 8
+	float dotProduct(const float* a, const float* b, size_t n)
+	{
+#if defined(RESAMPLER_SSE)
+		__m128 acc0 = _mm_setzero_ps();
+		__m128 acc1 = _mm_setzero_ps();
+		for (size_t i = 0; i < n; i += 8) {
+			acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+			acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+		}
+		__m128 acc = _mm_add_ps(acc0, acc1);
+		acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+		acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+		return _mm_cvtss_f32(acc);
+#elif defined(RESAMPLER_NEON)
+		float32x4_t acc0 = vdupq_n_f32(0.0f);
+		float32x4_t acc1 = vdupq_n_f32(0.0f);
+		for (size_t i = 0; i < n; i += 8) {
+			acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+			acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+		}
+		const float32x4_t acc = vaddq_f32(acc0, acc1);
+		const float32x2_t acc2 = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+		return vget_lane_f32(vpadd_f32(acc2, acc2), 0);
+#else
+		float acc[8] = {};
+		for (size_t i = 0; i < n; i += 8) {
+			for (size_t j = 0; j < 8; ++j) {
+				acc[j] += a[i + j] * b[i + j];
+			}
+		}
+		return ((acc[0] + acc[4]) + (acc[1] + acc[5])) + ((acc[2] + acc[6]) + (acc[3] + acc[7]));
+#endif
+	}
+
+	double blackmanHarris(double x) // x from -1 to 1
+	{
+		const double t = pi * (x + 1.0);
+		return 0.35875 - 0.48829 * std::cos(t) + 0.14128 * std::cos(2 * t) - 0.01168 * std::cos(3 * t);
+	}
+}
+
 AudioResampler::AudioResampler(int from, int to, int nChannels, float quality)
-	: resampler(makeResampler(from, to, nChannels, quality))
+	: resampler(nullptr, [] (SpeexResamplerState* s) { speex_resampler_destroy(s); })
 	, nChannels(size_t(nChannels))
 	, from(from)
 	, to(to)
 {
+	if (!makePolyphase(quality)) {
+		resampler = makeResampler(from, to, nChannels, quality);
+	}
 }
 
 AudioResampler::~AudioResampler() = default;
 
 AudioResamplerResult AudioResampler::resample(gsl::span<const float> src, gsl::span<float> dst, size_t channel)
 {
+	if (isPolyphase()) {
+		Expects(channel < nChannels);
+		const size_t nIn = size_t(src.size());
+		memcpy(getPolyphaseInput(channel, nIn), src.data(), nIn * sizeof(float));
+		outputs[channel] = dst.data();
+		AudioResamplerResult result;
+		result.nWritten = runPolyphase(channel, 1, nIn, size_t(dst.size()), 1);
+		result.nRead = nIn - (channels[channel].buffer.size() - (numTaps - 1));
+		channels[channel].buffer.resize(numTaps - 1);
+		return result;
+	}
+
 	unsigned inLen = unsigned(src.size() / nChannels);
 	unsigned outLen = unsigned(dst.size() / nChannels);
 	speex_resampler_process_float(resampler.get(), unsigned(channel), src.data(), &inLen, dst.data(), &outLen);
@@ -33,6 +115,24 @@ AudioResamplerResult AudioResampler::resample(gsl::span<const float> src, gsl::s
 
 AudioResamplerResult AudioResampler::resampleInterleaved(gsl::span<const float> src, gsl::span<float> dst)
 {
+	if (isPolyphase()) {
+		const size_t nIn = size_t(src.size()) / nChannels;
+		for (size_t c = 0; c < nChannels; ++c) {
+			float* in = getPolyphaseInput(c, nIn);
+			for (size_t i = 0; i < nIn; ++i) {
+				in[i] = src[i * nChannels + c];
+			}
+			outputs[c] = dst.data() + c;
+		}
+		AudioResamplerResult result;
+		result.nWritten = runPolyphase(0, nChannels, nIn, size_t(dst.size()) / nChannels, nChannels);
+		result.nRead = nIn - (channels[0].buffer.size() - (numTaps - 1));
+		for (auto& c: channels) {
+			c.buffer.resize(numTaps - 1);
+		}
+		return result;
+	}
+
 	unsigned inLen = unsigned(src.size() / nChannels);
 	unsigned outLen = unsigned(dst.size() / nChannels);
 	speex_resampler_process_interleaved_float(resampler.get(), src.data(), &inLen, dst.data(), &outLen);
@@ -44,6 +144,29 @@ AudioResamplerResult AudioResampler::resampleInterleaved(gsl::span<const float>
 
 AudioResamplerResult AudioResampler::resampleInterleaved(gsl::span<const short> src, gsl::span<short> dst)
 {
+	if (isPolyphase()) {
+		const size_t nIn = size_t(src.size()) / nChannels;
+		const size_t maxOut = size_t(dst.size()) / nChannels;
+		scratch.resize(maxOut * nChannels);
+		for (size_t c = 0; c < nChannels; ++c) {
+			float* in = getPolyphaseInput(c, nIn);
+			for (size_t i = 0; i < nIn; ++i) {
+				in[i] = float(src[i * nChannels + c]);
+			}
+			outputs[c] = scratch.data() + c;
+		}
+		AudioResamplerResult result;
+		result.nWritten = runPolyphase(0, nChannels, nIn, maxOut, nChannels);
+		result.nRead = nIn - (channels[0].buffer.size() - (numTaps - 1));
+		for (auto& c: channels) {
+			c.buffer.resize(numTaps - 1);
+		}
+		for (size_t i = 0; i < result.nWritten * nChannels; ++i) {
+			dst[i] = short(std::max(-32768.0f, std::min(std::round(scratch[i]), 32767.0f)));
+		}
+		return result;
+	}
+
 	unsigned inLen = unsigned(src.size() / nChannels);
 	unsigned outLen = unsigned(dst.size() / nChannels);
 	speex_resampler_process_interleaved_int(resampler.get(), src.data(), &inLen, dst.data(), &outLen);
@@ -53,7 +176,135 @@ AudioResamplerResult AudioResampler::resampleInterleaved(gsl::span<const short>
 	return result;
 }
 
+AudioResamplerResult AudioResampler::resampleChannels(gsl::span<const gsl::span<const float>> src, gsl::span<const gsl::span<float>> dst)
+{
+	Expects(size_t(src.size()) == nChannels);
+	Expects(size_t(dst.size()) == nChannels);
+
+	size_t nIn = size_t(src[0].size());
+	size_t maxOut = size_t(dst[0].size());
+	for (size_t c = 1; c < nChannels; ++c) {
+		nIn = std::min(nIn, size_t(src[c].size()));
+		maxOut = std::min(maxOut, size_t(dst[c].size()));
+	}
+
+	AudioResamplerResult result;
+	if (isPolyphase()) {
+		for (size_t c = 0; c < nChannels; ++c) {
+			memcpy(getPolyphaseInput(c, nIn), src[c].data(), nIn * sizeof(float));
+			outputs[c] = dst[c].data();
+		}
+		result.nWritten = runPolyphase(0, nChannels, nIn, maxOut, 1);
+		result.nRead = nIn - (channels[0].buffer.size() - (numTaps - 1));
+		for (auto& c: channels) {
+			c.buffer.resize(numTaps - 1);
+		}
+	} else {
+		result.nRead = nIn;
+		result.nWritten = maxOut;
+		for (size_t c = 0; c < nChannels; ++c) {
+			unsigned inLen = unsigned(nIn);
+			unsigned outLen = unsigned(maxOut);
+			speex_resampler_process_float(resampler.get(), unsigned(c), src[c].data(), &inLen, dst[c].data(), &outLen);
+			result.nRead = std::min(result.nRead, size_t(inLen));
+			result.nWritten = std::min(result.nWritten, size_t(outLen));
+		}
+	}
+	return result;
+}
+
 size_t AudioResampler::numOutputSamples(size_t numInputSamples) const
 {
 	return numInputSamples * to / from;
 }
+
+bool AudioResampler::isPolyphase() const
+{
+	return numPhases > 0;
+}
+
+bool AudioResampler::makePolyphase(float quality)
+{
+	if (from <= 0 || to <= 0) {
+		return false;
+	}
+
+	// Upsample by numPhases, then take every phaseStep-th sample
+	const size_t divisor = greatestCommonDivisor(size_t(from), size_t(to));
+	const size_t phases = size_t(to) / divisor;
+	const size_t step = size_t(from) / divisor;
+	if (phases > maxPhases || step > 2 * phases) {
+		return false; // Too many phases to keep around, or downsampling so much it'd need a lot of taps
+	}
+
+	// Stretched when downsampling, as the cutoff comes down with the output rate
+	const size_t baseTaps = quality < 0.25f ? 8 : (quality < 0.5f ? 16 : (quality < 0.75f ? 32 : 64));
+	numTaps = (baseTaps * std::max(step, phases) / phases + 7) / 8 * 8;
+	numPhases = phases;
+	phaseStep = step;
+
+	const double cutoff = 0.9 * std::min(1.0, double(phases) / double(step)); // Relative to the input's Nyquist frequency
+	const double halfWidth = double(numTaps) / 2;
+	taps.resize(numPhases * numTaps);
+	for (size_t p = 0; p < numPhases; ++p) {
+		// Each output lands between the two middle taps, a fraction of the way along
+		const double centre = halfWidth - 1 + double(p) / double(numPhases);
+		double sum = 0;
+		for (size_t k = 0; k < numTaps; ++k) {
+			const double d = double(k) - centre;
+			const double x = pi * cutoff * d;
+			const double sinc = std::abs(x) < 1e-9 ? 1.0 : std::sin(x) / x;
+			const double value = sinc * blackmanHarris(std::max(-1.0, std::min(d / halfWidth, 1.0)));
+			taps[p * numTaps + k] = float(value);
+			sum += value;
+		}
+		// Unity gain at DC for every phase, so a constant signal doesn't pick up a ripple
+		for (size_t k = 0; k < numTaps; ++k) {
+			taps[p * numTaps + k] = float(taps[p * numTaps + k] / sum);
+		}
+	}
+
+	channels.resize(nChannels);
+	for (auto& c: channels) {
+		c.buffer.assign(numTaps - 1, 0.0f);
+	}
+	outputs.resize(nChannels);
+
+	return true;
+}
+
+float* AudioResampler::getPolyphaseInput(size_t channel, size_t nIn)
+{
+	auto& buffer = channels[channel].buffer;
+	buffer.resize(numTaps - 1 + nIn);
+	return buffer.data() + numTaps - 1;
+}
+
+size_t AudioResampler::runPolyphase(size_t firstChannel, size_t numChannels, size_t nIn, size_t maxOut, size_t dstStride)
+{
+	// Every channel is at the same position, so each output's phase and taps are only worked out once
+	size_t position = channels[firstChannel].position;
+	size_t n = 0;
+	for (; n < maxOut; ++n) {
+		const size_t start = position / numPhases;
+		if (start >= nIn) {
+			break;
+		}
+		const float* phaseTaps = taps.data() + (position % numPhases) * numTaps;
+		for (size_t c = firstChannel; c < firstChannel + numChannels; ++c) {
+			outputs[c][n * dstStride] = dotProduct(channels[c].buffer.data() + start, phaseTaps, numTaps);
+		}
+		position += phaseStep;
+	}
+
+	// Keep the history the next outputs will need at the front, and leave whatever wasn't read after it
+	const size_t consumed = std::min(nIn, position / numPhases);
+	for (size_t c = firstChannel; c < firstChannel + numChannels; ++c) {
+		auto& channel = channels[c];
+		std::copy(channel.buffer.begin() + consumed, channel.buffer.end(), channel.buffer.begin());
+		channel.buffer.resize(channel.buffer.size() - consumed);
+		channel.position = position - consumed * numPhases;
+	}
+
+	return n;
+}
@@ -5,17 +5,37 @@
 
 using namespace Halley;
 
-Serializer::Serializer()
+Serializer::Serializer(SerializerOptions options)
 	: dryRun(true)
+	, options(options)
 {}
 
-Serializer::Serializer(gsl::span<gsl::byte> dst)
+Serializer::Serializer(gsl::span<gsl::byte> dst, SerializerOptions options)
 	: dryRun(false)
 	, dst(dst)
+	, options(options)
 {}
 
+Serializer::Serializer(Bytes& dst, SerializerOptions options)
+	: dryRun(false)
+	, growable(&dst)
+	, options(options)
+{
+	dst.clear();
+}
+
 Serializer& Serializer::operator<<(const std::string& str)
 {
+	if (options.compact && options.stringTable) {
+		// 0 for a new string, written in full, otherwise 1 + index of a string already written
+		const auto iter = stringTable.find(str);
+		if (iter != stringTable.end()) {
+			return writeVarUInt(uint64_t(iter->second) + 1);
+		}
+		writeVarUInt(0);
+		stringTable[str] = uint32_t(stringTable.size());
+	}
+
 	const unsigned int sz = static_cast<unsigned int>(str.size());
 	*this << sz;
 	*this << gsl::as_bytes(gsl::span<const char>(str.data(), sz));
@@ -34,10 +54,7 @@ Serializer& Serializer::operator<<(const Path& path)
 
 Serializer& Serializer::operator<<(gsl::span<const gsl::byte> span)
 {
-	if (!dryRun) {
-		memcpy(dst.data() + size, span.data(), span.size_bytes());
-	}
-	size += span.size_bytes();
+	writeRawBytes(span);
 	return *this;
 }
 
@@ -45,35 +62,155 @@ Serializer& Serializer::operator<<(const Bytes& bytes)
 {
 	const unsigned int byteSize = static_cast<unsigned int>(bytes.size());
 	*this << byteSize;
+	writeRawBytes(gsl::as_bytes(gsl::span<const Byte>(bytes)));
+	return *this;
+}
 
+Serializer& Serializer::serializeQuantized(float value, Range<float> range, int bits)
+{
+	Expects(bits > 0 && bits <= 32);
+	if (!options.compact) {
+		return *this << value;
+	}
+
+	const uint64_t maxValue = (uint64_t(1) << bits) - 1;
+	const float t = clamp((value - range.start) / (range.end - range.start), 0.0f, 1.0f);
+	return writeBits(uint64_t(lround(t * float(maxValue))), bits);
+}
+
+Serializer& Serializer::serializeQuantized(Vector2f value, Range<float> range, int bits)
+{
+	serializeQuantized(value.x, range, bits);
+	return serializeQuantized(value.y, range, bits);
+}
+
+Serializer& Serializer::writeBits(uint64_t value, int nBits)
+{
+	Expects(nBits >= 0 && nBits <= 64);
 	if (!dryRun) {
-		memcpy(dst.data() + size, bytes.data(), bytes.size());
+		ensureSize((bitPos + size_t(nBits) + 7) / 8);
+	}
+	while (nBits > 0) {
+		const size_t byteIdx = bitPos >> 3;
+		const int bitOffset = int(bitPos & 7);
+		const int n = std::min(8 - bitOffset, nBits);
+		if (!dryRun) {
+			const auto bits = uint8_t((value & ((1u << n) - 1)) << bitOffset);
+			auto& dstByte = reinterpret_cast<uint8_t&>(dst[byteIdx]);
+			dstByte = bitOffset == 0 ? bits : uint8_t(dstByte | bits);
+		}
+		value >>= n;
+		nBits -= n;
+		bitPos += n;
 	}
-	size += bytes.size();
 	return *this;
 }
 
-Deserializer::Deserializer(gsl::span<const gsl::byte> src)
+Serializer& Serializer::writeVarUInt(uint64_t value)
+{
+	// 7 bits per group, with the top bit flagging that another group follows
+	do {
+		uint8_t group = value & 0x7F;
+		value >>= 7;
+		if (value != 0) {
+			group |= 0x80;
+		}
+		writeBits(group, 8);
+	} while (value != 0);
+	return *this;
+}
+
+Serializer& Serializer::writeVarInt(int64_t value)
+{
+	// Zig-zag, so small negative numbers stay small
+	return writeVarUInt((uint64_t(value) << 1) ^ uint64_t(value >> 63));
+}
+
+void Serializer::alignToByte()
+{
+	bitPos = (bitPos + 7) & ~size_t(7);
+}
+
+void Serializer::writeRawBytes(gsl::span<const gsl::byte> bytes)
+{
+	if (options.compact) {
+		alignToByte();
+		size = bitPos / 8;
+	}
+	if (!dryRun && bytes.size_bytes() > 0) {
+		ensureSize(size + size_t(bytes.size_bytes()));
+		memcpy(dst.data() + size, bytes.data(), bytes.size_bytes());
+	}
+	size += bytes.size_bytes();
+	if (options.compact) {
+		bitPos = size * 8;
+	}
+}
+
+void Serializer::grow(size_t bytes)
+{
+	// The buffer is always kept at the exact size written so far (so it never needs trimming), with the capacity
+	// growing geometrically
+	if (bytes > size_t(growable->capacity())) {
+		growable->reserve(std::max(bytes, size_t(growable->capacity()) * 2));
+	}
+	growable->resize(bytes);
+	dst = gsl::as_writeable_bytes(gsl::span<Byte>(*growable));
+}
+
+Deserializer::Deserializer(gsl::span<const gsl::byte> src, SerializerOptions options)
 	: pos(0)
 	, src(src)
+	, options(options)
 {
 }
 
-Deserializer::Deserializer(const Bytes& src)
+Deserializer::Deserializer(const Bytes& src, SerializerOptions options)
 	: pos(0)
 	, src(gsl::as_bytes(gsl::span<const Halley::Byte>(src)))
+	, options(options)
+{
+}
+
+Deserializer& Deserializer::operator>>(bool& val)
 {
+	if (options.compact) {
+		val = readBits(1) != 0;
+		return *this;
+	}
+	return deserializePod(val);
 }
 
 Deserializer& Deserializer::operator>>(std::string& str)
 {
+	if (options.compact && options.stringTable) {
+		const uint64_t ref = readVarUInt();
+		if (ref != 0) {
+			if (ref > stringTable.size()) {
+				throw Exception("Invalid string table reference", HalleyExceptions::File);
+			}
+			str = stringTable[size_t(ref - 1)];
+			return *this;
+		}
+	}
+
 	unsigned int sz;
 	*this >> sz;
 
+	if (options.compact) {
+		alignToByte();
+		pos = bitPos / 8;
+	}
 	ensureSufficientBytesRemaining(sz);
 
 	str = std::string(reinterpret_cast<const char*>(src.data() + pos), sz);
 	pos += sz;
+	if (options.compact) {
+		bitPos = pos * 8;
+		if (options.stringTable) {
+			stringTable.push_back(str);
+		}
+	}
 	return *this;
 }
 
@@ -100,10 +237,17 @@ Deserializer& Deserializer::operator>>(gsl::span<gsl::byte>& span)
 	}
 	Expects(span.size_bytes() > 0);
 
+	if (options.compact) {
+		alignToByte();
+		pos = bitPos / 8;
+	}
 	ensureSufficientBytesRemaining(size_t(span.size_bytes()));
 
 	memcpy(span.data(), src.data() + pos, span.size_bytes());
 	pos += span.size_bytes();
+	if (options.compact) {
+		bitPos = pos * 8;
+	}
 	return *this;
 }
 
@@ -119,6 +263,69 @@ Deserializer& Deserializer::operator>>(Bytes& bytes)
 	return *this;
 }
 
+Deserializer& Deserializer::deserializeQuantized(float& value, Range<float> range, int bits)
+{
+	Expects(bits > 0 && bits <= 32);
+	if (!options.compact) {
+		return *this >> value;
+	}
+
+	const uint64_t maxValue = (uint64_t(1) << bits) - 1;
+	value = range.start + (range.end - range.start) * (float(readBits(bits)) / float(maxValue));
+	return *this;
+}
+
+Deserializer& Deserializer::deserializeQuantized(Vector2f& value, Range<float> range, int bits)
+{
+	deserializeQuantized(value.x, range, bits);
+	return deserializeQuantized(value.y, range, bits);
+}
+
+uint64_t Deserializer::readBits(int nBits)
+{
+	Expects(nBits >= 0 && nBits <= 64);
+	if (bitPos + size_t(nBits) > size_t(src.size_bytes()) * 8) {
+		throw Exception("Attempt to deserialize out of bounds", HalleyExceptions::File);
+	}
+
+	uint64_t value = 0;
+	int written = 0;
+	while (written < nBits) {
+		const size_t byteIdx = bitPos >> 3;
+		const int bitOffset = int(bitPos & 7);
+		const int n = std::min(8 - bitOffset, nBits - written);
+		const uint64_t bits = (uint64_t(uint8_t(src[byteIdx])) >> bitOffset) & ((1u << n) - 1);
+		value |= bits << written;
+		written += n;
+		bitPos += n;
+	}
+	return value;
+}
+
+uint64_t Deserializer::readVarUInt()
+{
+	uint64_t value = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		const auto group = uint8_t(readBits(8));
+		value |= uint64_t(group & 0x7F) << shift;
+		if ((group & 0x80) == 0) {
+			return value;
+		}
+	}
+	throw Exception("Varint too long", HalleyExceptions::File);
+}
+
+int64_t Deserializer::readVarInt()
+{
+	const uint64_t v = readVarUInt();
+	return int64_t(v >> 1) ^ -int64_t(v & 1);
+}
+
+void Deserializer::alignToByte()
+{
+	bitPos = (bitPos + 7) & ~size_t(7);
+}
+
 void Deserializer::setVersion(int v)
 {
 	version = v;
@@ -136,6 +343,17 @@ void Deserializer::ensureSufficientBytesRemaining(size_t bytes)
 	}
 }
 
+void Deserializer::ensureSufficientElementsRemaining(size_t n)
+{
+	if (options.compact) {
+		if (n > size_t(src.size_bytes()) * 8 - std::min(bitPos, size_t(src.size_bytes()) * 8)) {
+			throw Exception("Attempt to deserialize out of bounds", HalleyExceptions::File);
+		}
+	} else {
+		ensureSufficientBytesRemaining(n);
+	}
+}
+
 size_t Deserializer::getBytesRemaining() const
 {
 	if (pos > size_t(src.size_bytes())) {
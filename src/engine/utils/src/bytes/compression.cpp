@@ -5,6 +5,7 @@
 #include "../../contrib/zlib/zlib.h"
 #include "halley/support/exception.h"
 #include "halley/text/string_converter.h"
+#include "halley/concurrency/concurrent.h"
 
 using namespace Halley;
 
@@ -50,12 +51,17 @@ static void deleter(const char* data)
 
 std::shared_ptr<const char> Compression::decompressToSharedPtr(gsl::span<const gsl::byte> bytes, size_t& size, size_t maxSize)
 {
-	auto out = decompress(bytes, maxSize);
-	
-	size = out.size();
-	auto rawResult = new char[out.size()];
-	memcpy(rawResult, out.data(), out.size());
-	auto result = std::shared_ptr<const char>(rawResult, deleter);
+	Expects (bytes.size_bytes() >= 8);
+	uint64_t expectedOutSize;
+	memcpy(&expectedOutSize, bytes.data(), 8);
+	if (expectedOutSize > uint64_t(maxSize)) {
+		throw Exception("File is too big to inflate: " + String::prettySize(expectedOutSize), HalleyExceptions::Compression);
+	}
+
+	// Straight into the final buffer
+	size = size_t(expectedOutSize);
+	auto result = std::shared_ptr<const char>(new char[size], deleter);
+	decompressRawInto(bytes.subspan(8), gsl::as_writeable_bytes(gsl::span<char>(const_cast<char*>(result.get()), size)));
 	return result;
 }
 
@@ -168,3 +174,399 @@ Bytes Compression::decompressRaw(gsl::span<const gsl::byte> bytes, size_t maxSiz
 		return result;
 	}
 }
+
+void Compression::decompressRawInto(gsl::span<const gsl::byte> bytes, gsl::span<gsl::byte> dst, CompressionCodec codec)
+{
+	auto stream = DecompressionStream::create(codec);
+	stream->feed(bytes);
+
+	size_t pos = 0;
+	while (pos < size_t(dst.size())) {
+		const size_t n = stream->read(dst.subspan(pos));
+		if (n == 0) {
+			throw Exception("Unable to inflate stream, it's shorter than expected (" + toString(pos) + " out of " + toString(dst.size()) + " bytes).", HalleyExceptions::Compression);
+		}
+		pos += n;
+	}
+
+	// It should end right there (stored data has no end marker, so it just ends with the input)
+	gsl::byte extra;
+	const bool hasMore = stream->read(gsl::span<gsl::byte>(&extra, 1)) != 0;
+	if (hasMore || (codec != CompressionCodec::None && !stream->isFinished())) {
+		throw Exception("Unable to inflate stream, it doesn't end at the expected size (" + toString(dst.size()) + " bytes).", HalleyExceptions::Compression);
+	}
+}
+
+namespace {
+	class StoredCompressionStream final : public CompressionStream {
+	public:
+		void feed(gsl::span<const gsl::byte> input, Bytes& output) override
+		{
+			const size_t pos = output.size();
+			output.resize(pos + size_t(input.size()));
+			memcpy(output.data() + pos, input.data(), size_t(input.size()));
+		}
+
+		void flush(Bytes&) override {}
+		void finish(Bytes&) override {}
+	};
+
+	class StoredDecompressionStream final : public DecompressionStream {
+	public:
+		void feed(gsl::span<const gsl::byte> in) override
+		{
+			input = in;
+		}
+
+		size_t read(gsl::span<gsl::byte> output) override
+		{
+			const size_t n = std::min(size_t(input.size()), size_t(output.size()));
+			if (n > 0) {
+				memcpy(output.data(), input.data(), n);
+				input = input.subspan(n);
+			}
+			return n;
+		}
+
+		bool needsInput() const override { return input.empty(); }
+		bool isFinished() const override { return false; } // There's no end marker, so it's up to whoever feeds it
+
+	private:
+		gsl::span<const gsl::byte> input;
+	};
+
+	class DeflateCompressionStream final : public CompressionStream {
+	public:
+		explicit DeflateCompressionStream(int level)
+		{
+			stream.zalloc = &zlibAlloc;
+			stream.zfree = &zlibFree;
+			stream.opaque = nullptr;
+			if (deflateInit(&stream, level < 0 ? Z_DEFAULT_COMPRESSION : level) != Z_OK) {
+				throw Exception("Unable to initialize zlib compression", HalleyExceptions::Compression);
+			}
+		}
+
+		~DeflateCompressionStream()
+		{
+			deflateEnd(&stream);
+		}
+
+		void feed(gsl::span<const gsl::byte> input, Bytes& output) override
+		{
+			run(input, output, Z_NO_FLUSH);
+		}
+
+		void flush(Bytes& output) override
+		{
+			run({}, output, Z_SYNC_FLUSH);
+		}
+
+		void finish(Bytes& output) override
+		{
+			run({}, output, Z_FINISH);
+		}
+
+	private:
+		z_stream stream;
+
+		void run(gsl::span<const gsl::byte> input, Bytes& output, int flush)
+		{
+			constexpr size_t minSpace = 16 * 1024;
+
+			stream.avail_in = uInt(input.size_bytes());
+			stream.next_in = reinterpret_cast<unsigned char*>(const_cast<gsl::byte*>(input.data()));
+
+			size_t pos = output.size();
+			while (true) {
+				output.resize(std::max(output.size(), pos + std::max(minSpace, size_t(input.size_bytes()) / 2)));
+				stream.avail_out = uInt(output.size() - pos);
+				stream.next_out = output.data() + pos;
+				const int res = deflate(&stream, flush);
+				pos = output.size() - stream.avail_out;
+				if (res == Z_STREAM_ERROR) {
+					throw Exception("Unable to compress data.", HalleyExceptions::Compression);
+				}
+				// deflate only stops short of filling the output when it's done with this call
+				if (res == Z_STREAM_END || (stream.avail_in == 0 && stream.avail_out > 0 && flush != Z_FINISH)) {
+					break;
+				}
+			}
+			output.resize(pos);
+		}
+	};
+
+	class InflateDecompressionStream final : public DecompressionStream {
+	public:
+		InflateDecompressionStream()
+		{
+			stream.zalloc = &zlibAlloc;
+			stream.zfree = &zlibFree;
+			stream.opaque = nullptr;
+			stream.avail_in = 0;
+			stream.next_in = nullptr;
+			if (inflateInit(&stream) != Z_OK) {
+				throw Exception("Unable to initialise zlib", HalleyExceptions::Compression);
+			}
+		}
+
+		~InflateDecompressionStream()
+		{
+			inflateEnd(&stream);
+		}
+
+		void feed(gsl::span<const gsl::byte> input) override
+		{
+			Expects(stream.avail_in == 0);
+			stream.avail_in = uInt(input.size_bytes());
+			stream.next_in = reinterpret_cast<unsigned char*>(const_cast<gsl::byte*>(input.data()));
+		}
+
+		size_t read(gsl::span<gsl::byte> output) override
+		{
+			if (finished) {
+				return 0;
+			}
+
+			// zlib wants somewhere to write, even when there's nothing to write
+			unsigned char dummy;
+			stream.avail_out = uInt(output.size_bytes());
+			stream.next_out = output.empty() ? &dummy : reinterpret_cast<unsigned char*>(output.data());
+
+			const int res = inflate(&stream, Z_NO_FLUSH);
+			if (res == Z_STREAM_END) {
+				finished = true;
+			} else if (res != Z_OK && res != Z_BUF_ERROR) {
+				throw Exception("Unable to inflate stream.", HalleyExceptions::Compression);
+			}
+			return size_t(output.size_bytes()) - stream.avail_out;
+		}
+
+		bool needsInput() const override { return stream.avail_in == 0 && !finished; }
+		bool isFinished() const override { return finished; }
+
+	private:
+		z_stream stream;
+		bool finished = false;
+	};
+}
+
+std::unique_ptr<CompressionStream> CompressionStream::create(CompressionCodec codec, int level)
+{
+	switch (codec) {
+	case CompressionCodec::None:
+		return std::make_unique<StoredCompressionStream>();
+	case CompressionCodec::Deflate:
+		return std::make_unique<DeflateCompressionStream>(level);
+	default:
+		throw Exception("Unknown compression codec: " + toString(int(codec)), HalleyExceptions::Compression);
+	}
+}
+
+std::unique_ptr<DecompressionStream> DecompressionStream::create(CompressionCodec codec)
+{
+	switch (codec) {
+	case CompressionCodec::None:
+		return std::make_unique<StoredDecompressionStream>();
+	case CompressionCodec::Deflate:
+		return std::make_unique<InflateDecompressionStream>();
+	default:
+		throw Exception("Unknown compression codec: " + toString(int(codec)), HalleyExceptions::Compression);
+	}
+}
+
+namespace {
+	// Raw deflate, without the zlib header and checksum, as these are for small buffers and the transport checks integrity
+	constexpr int rawWindowBits = -15;
+
+	std::unique_ptr<z_stream> makeDeflater(int level, gsl::span<const gsl::byte> dictionary)
+	{
+		auto stream = std::make_unique<z_stream>();
+		stream->zalloc = &zlibAlloc;
+		stream->zfree = &zlibFree;
+		stream->opaque = nullptr;
+		if (deflateInit2(stream.get(), level, Z_DEFLATED, rawWindowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+			throw Exception("Unable to initialize zlib compression", HalleyExceptions::Compression);
+		}
+		if (!dictionary.empty()) {
+			deflateSetDictionary(stream.get(), reinterpret_cast<const Bytef*>(dictionary.data()), uInt(dictionary.size_bytes()));
+		}
+		return stream;
+	}
+
+	std::unique_ptr<z_stream> makeInflater(gsl::span<const gsl::byte> dictionary)
+	{
+		auto stream = std::make_unique<z_stream>();
+		stream->zalloc = &zlibAlloc;
+		stream->zfree = &zlibFree;
+		stream->opaque = nullptr;
+		stream->avail_in = 0;
+		stream->next_in = nullptr;
+		if (inflateInit2(stream.get(), rawWindowBits) != Z_OK) {
+			throw Exception("Unable to initialise zlib", HalleyExceptions::Compression);
+		}
+		if (!dictionary.empty()) {
+			// Raw streams take the dictionary up front
+			inflateSetDictionary(stream.get(), reinterpret_cast<const Bytef*>(dictionary.data()), uInt(dictionary.size_bytes()));
+		}
+		return stream;
+	}
+
+	Bytes runDeflate(z_stream& stream, gsl::span<const gsl::byte> bytes, int flush)
+	{
+		Bytes result(size_t(deflateBound(&stream, uLong(bytes.size_bytes()))) + 16);
+		stream.avail_in = uInt(bytes.size_bytes());
+		stream.next_in = reinterpret_cast<unsigned char*>(const_cast<gsl::byte*>(bytes.data()));
+
+		size_t pos = 0;
+		while (true) {
+			stream.avail_out = uInt(result.size() - pos);
+			stream.next_out = result.data() + pos;
+			const int res = deflate(&stream, flush);
+			pos = result.size() - stream.avail_out;
+			if (res == Z_STREAM_ERROR) {
+				throw Exception("Unable to compress data.", HalleyExceptions::Compression);
+			}
+			if (res == Z_STREAM_END || (stream.avail_in == 0 && stream.avail_out > 0)) {
+				break;
+			}
+			result.resize(result.size() * 2);
+		}
+
+		result.resize(pos);
+		return result;
+	}
+
+	Bytes runInflate(z_stream& stream, gsl::span<const gsl::byte> bytes, size_t maxSize)
+	{
+		Bytes result(std::min(std::max(size_t(bytes.size_bytes()) * 4, size_t(256)), maxSize));
+		stream.avail_in = uInt(bytes.size_bytes());
+		stream.next_in = reinterpret_cast<unsigned char*>(const_cast<gsl::byte*>(bytes.data()));
+
+		size_t pos = 0;
+		while (true) {
+			stream.avail_out = uInt(result.size() - pos);
+			stream.next_out = result.data() + pos;
+			const int res = inflate(&stream, Z_SYNC_FLUSH);
+			pos = result.size() - stream.avail_out;
+			if (res != Z_OK && res != Z_STREAM_END && res != Z_BUF_ERROR) {
+				throw Exception("Unable to inflate stream.", HalleyExceptions::Compression);
+			}
+			if (res == Z_STREAM_END || (stream.avail_in == 0 && stream.avail_out > 0)) {
+				break;
+			}
+			if (result.size() >= maxSize) {
+				throw Exception("Unable to inflate stream, maximum size has been exceeded.", HalleyExceptions::Compression);
+			}
+			result.resize(std::min(result.size() * 2, maxSize));
+		}
+
+		result.resize(pos);
+		return result;
+	}
+}
+
+Bytes Compression::compressRawParallel(gsl::span<const gsl::byte> bytes, int level)
+{
+	// Each block is primed with the window before it, so matches can still reach back across block boundaries, and all
+	// but the last end on a sync flush, which leaves them byte aligned and ready to be concatenated into one stream
+	constexpr size_t blockSize = 256 * 1024;
+	constexpr size_t windowSize = 32 * 1024;
+	const size_t inSize = size_t(bytes.size_bytes());
+	const size_t nBlocks = std::max(size_t(1), (inSize + blockSize - 1) / blockSize);
+
+	Vector<Bytes> blocks(nBlocks);
+	Vector<uLong> checksums(nBlocks);
+	Concurrent::parallelFor(Range<size_t>(0, nBlocks), 1, [&] (size_t start, size_t end) {
+		for (size_t i = start; i < end; ++i) {
+			const size_t offset = i * blockSize;
+			const auto block = bytes.subspan(offset, std::min(blockSize, inSize - offset));
+			const auto window = bytes.subspan(offset - std::min(offset, windowSize), std::min(offset, windowSize));
+
+			auto stream = makeDeflater(level < 0 ? Z_DEFAULT_COMPRESSION : level, window);
+			blocks[i] = runDeflate(*stream, block, i == nBlocks - 1 ? Z_FINISH : Z_SYNC_FLUSH);
+			deflateEnd(stream.get());
+			checksums[i] = adler32(adler32(0, nullptr, 0), reinterpret_cast<const Bytef*>(block.data()), uInt(block.size_bytes()));
+		}
+	});
+
+	size_t totalSize = 2 + 4;
+	for (auto& b: blocks) {
+		totalSize += b.size();
+	}
+	Bytes result;
+	result.reserve(totalSize);
+
+	// Deflate with a 32k window and default compression, as deflateInit would write it
+	result.push_back(0x78);
+	result.push_back(0x9C);
+
+	uLong checksum = checksums[0];
+	for (size_t i = 0; i < nBlocks; ++i) {
+		result.insert(result.end(), blocks[i].begin(), blocks[i].end());
+		if (i > 0) {
+			checksum = adler32_combine(checksum, checksums[i], z_off_t(std::min(blockSize, inSize - i * blockSize)));
+		}
+	}
+	for (int i = 3; i >= 0; --i) {
+		result.push_back(Byte((checksum >> (i * 8)) & 0xFF));
+	}
+
+	return result;
+}
+
+DictionaryCompression::DictionaryCompression(Bytes dict, int level)
+	: dictionary(std::move(dict))
+{
+	const auto dictSpan = gsl::as_bytes(gsl::span<const Byte>(dictionary));
+	deflater = makeDeflater(level, dictSpan);
+	inflater = makeInflater(dictSpan);
+}
+
+DictionaryCompression::~DictionaryCompression()
+{
+	deflateEnd(deflater.get());
+	inflateEnd(inflater.get());
+}
+
+Bytes DictionaryCompression::compress(gsl::span<const gsl::byte> bytes)
+{
+	// Each buffer is compressed on its own, so start over from the dictionary every time
+	deflateReset(deflater.get());
+	if (!dictionary.empty()) {
+		deflateSetDictionary(deflater.get(), dictionary.data(), uInt(dictionary.size()));
+	}
+	return runDeflate(*deflater, bytes, Z_FINISH);
+}
+
+Bytes DictionaryCompression::decompress(gsl::span<const gsl::byte> bytes, size_t maxSize)
+{
+	inflateReset(inflater.get());
+	if (!dictionary.empty()) {
+		inflateSetDictionary(inflater.get(), dictionary.data(), uInt(dictionary.size()));
+	}
+	return runInflate(*inflater, bytes, maxSize);
+}
+
+StreamCompression::StreamCompression(const Bytes& dictionary, int level)
+{
+	const auto dictSpan = gsl::as_bytes(gsl::span<const Byte>(dictionary));
+	deflater = makeDeflater(level, dictSpan);
+	inflater = makeInflater(dictSpan);
+}
+
+StreamCompression::~StreamCompression()
+{
+	deflateEnd(deflater.get());
+	inflateEnd(inflater.get());
+}
+
+Bytes StreamCompression::compress(gsl::span<const gsl::byte> bytes)
+{
+	return runDeflate(*deflater, bytes, Z_SYNC_FLUSH);
+}
+
+Bytes StreamCompression::decompress(gsl::span<const gsl::byte> bytes, size_t maxSize)
+{
+	return runInflate(*inflater, bytes, maxSize);
+}
@@ -30,3 +30,56 @@ using namespace Halley;
 static thread_local String threadName;
 #endif
 
+Concurrent::ParallelForState::ParallelForState(size_t begin, size_t end, size_t grain, size_t nParticipants)
+	: end(end)
+	, grain(grain)
+	, nParticipants(nParticipants)
+	, total(end - begin)
+	, next(begin)
+	, completed(0)
+{
+}
+
+bool Concurrent::ParallelForState::claim(size_t& chunkStart, size_t& chunkEnd)
+{
+	size_t start = next.load();
+	while (start < end) {
+		const size_t remaining = end - start;
+		const size_t size = std::min(remaining, std::max(grain, remaining / (2 * nParticipants)));
+		if (next.compare_exchange_weak(start, start + size)) {
+			chunkStart = start;
+			chunkEnd = start + size;
+			return true;
+		}
+	}
+	return false;
+}
+
+void Concurrent::ParallelForState::complete(size_t count)
+{
+	if (completed.fetch_add(count) + count == total) {
+		std::unique_lock<std::mutex> lock(mutex);
+		condition.notify_all();
+	}
+}
+
+void Concurrent::ParallelForState::fail(std::exception_ptr e)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	if (!error) {
+		error = e;
+	}
+}
+
+void Concurrent::ParallelForState::wait()
+{
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while (completed.load() != total) {
+			condition.wait(lock);
+		}
+	}
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
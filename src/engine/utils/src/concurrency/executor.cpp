@@ -3,50 +3,293 @@
 #include <halley/support/exception.h>
 #include "halley/text/string_converter.h"
 #include "halley/support/logger.h"
+#include "halley/support/profiler.h"
 
 using namespace Halley;
 
 Executors* Executors::instance = nullptr;
+constexpr std::array<int64_t, ExecutionQueue::numPriorities> ExecutionQueue::maxWaitNs;
 
-ExecutionQueue::ExecutionQueue()
-	: aborted(false)
+#if defined(_WIN32) || defined(__linux__) || defined(__APPLE__)
+#define HAS_THREAD_LOCAL
+#endif
+
+namespace {
+	struct CurrentWorker
+	{
+		ExecutionQueue* queue = nullptr;
+		int index = -1;
+	};
+
+#ifdef HAS_THREAD_LOCAL
+	thread_local CurrentWorker currentWorker;
+	thread_local uint32_t stealSeed = 0;
+#else
+	CurrentWorker currentWorker;
+	uint32_t stealSeed = 0;
+#endif
+}
+
+namespace Halley {
+	// Chase-Lev deque, as described in "Correct and Efficient Work-Stealing for Weak Memory Models" (Le et al., 2013)
+	// The owner pushes and pops at the bottom, any other thread can steal from the top.
+	class WorkStealingDeque
+	{
+	public:
+		WorkStealingDeque()
+			: top(0)
+			, bottom(0)
+		{
+			retired.push_back(std::make_unique<Buffer>(1024));
+			buffer.store(retired.back().get());
+		}
+
+		~WorkStealingDeque()
+		{
+			while (auto task = pop()) {
+				delete task;
+			}
+		}
+
+		void push(TaskBase* task)
+		{
+			const int64_t b = bottom.load(std::memory_order_relaxed);
+			const int64_t t = top.load(std::memory_order_acquire);
+			Buffer* buf = buffer.load(std::memory_order_relaxed);
+			if (b - t > buf->capacity - 1) {
+				buf = grow(buf, t, b);
+			}
+			buf->put(b, task);
+			bottom.store(b + 1, std::memory_order_release);
+		}
+
+		TaskBase* pop()
+		{
+			const int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+			Buffer* buf = buffer.load(std::memory_order_relaxed);
+			bottom.store(b, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t t = top.load(std::memory_order_relaxed);
+
+			if (t > b) {
+				// Empty
+				bottom.store(b + 1, std::memory_order_relaxed);
+				return nullptr;
+			}
+
+			TaskBase* result = buf->get(b);
+			if (t == b) {
+				// Last element, race against stealers
+				if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+					result = nullptr;
+				}
+				bottom.store(b + 1, std::memory_order_relaxed);
+			}
+			return result;
+		}
+
+		TaskBase* steal()
+		{
+			int64_t t = top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			const int64_t b = bottom.load(std::memory_order_acquire);
+			if (t >= b) {
+				return nullptr;
+			}
+
+			TaskBase* result = buffer.load(std::memory_order_acquire)->get(t);
+			if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+				return nullptr;
+			}
+			return result;
+		}
+
+	private:
+		struct Buffer
+		{
+			explicit Buffer(int64_t capacity)
+				: capacity(capacity)
+				, data(new std::atomic<TaskBase*>[size_t(capacity)])
+			{}
+
+			TaskBase* get(int64_t i) const { return data[size_t(i & (capacity - 1))].load(std::memory_order_relaxed); }
+			void put(int64_t i, TaskBase* task) { data[size_t(i & (capacity - 1))].store(task, std::memory_order_relaxed); }
+
+			const int64_t capacity;
+			std::unique_ptr<std::atomic<TaskBase*>[]> data;
+		};
+
+		std::atomic<int64_t> top;
+		std::atomic<int64_t> bottom;
+		std::atomic<Buffer*> buffer;
+		std::vector<std::unique_ptr<Buffer>> retired; // Stealers may still be reading old buffers, so they're kept until destruction
+
+		Buffer* grow(Buffer* old, int64_t t, int64_t b)
+		{
+			retired.push_back(std::make_unique<Buffer>(old->capacity * 2));
+			Buffer* buf = retired.back().get();
+			for (int64_t i = t; i < b; ++i) {
+				buf->put(i, old->get(i));
+			}
+			buffer.store(buf, std::memory_order_release);
+			return buf;
+		}
+	};
+}
+
+namespace Halley {
+	struct MPSCTaskNode
+	{
+		explicit MPSCTaskNode(TaskBase task)
+			: task(std::move(task))
+		{}
+
+		TaskBase task;
+		MPSCTaskNode* next = nullptr;
+	};
+}
+
+ExecutionQueue::ExecutionQueue(ExecutionQueueMode mode)
+	: mode(mode)
+	, attachedCount(0)
+	, queuedMask(0)
+	, aborted(false)
+	, workerCount(0)
+	, pendingTasks(0)
+	, sleepingWorkers(0)
+	, mpscHead(nullptr)
 {
-	hasTasks.store(false);
+}
+
+ExecutionQueue::~ExecutionQueue()
+{
+	for (int i = 0; i < workerCount.load(); ++i) {
+		workers[i].reset();
+	}
+
+	for (auto node = takeAllMPSC(); node; ) {
+		auto next = node->next;
+		delete node;
+		node = next;
+	}
 }
 
 TaskBase ExecutionQueue::getNext()
 {
+	if (mode == ExecutionQueueMode::WorkStealing) {
+		return getNextStealing();
+	}
+	if (mode == ExecutionQueueMode::MPSC) {
+		return getNextMPSC();
+	}
+
 	std::unique_lock<std::mutex> lock(mutex);
-	while (queue.empty()) {
+	TaskBase value;
+	while (!popQueued(value, TaskPriority::Background)) {
 		if (!aborted) {
 			condition.wait(lock);
 		}
 		if (aborted) {
-			queue.clear();
+			for (auto& q: queues) {
+				q.clear();
+			}
+			queuedMask.store(0);
 			return TaskBase([] () {});
 		}
 	}
-
-	TaskBase value = queue.front();
-	queue.pop_front();
 	return value;
 }
 
 std::vector<TaskBase> ExecutionQueue::getAll()
 {
+	if (mode == ExecutionQueueMode::MPSC) {
+		std::vector<TaskBase> tasks;
+		for (auto node = takeAllMPSC(); node; ) {
+			tasks.emplace_back(std::move(node->task));
+			auto next = node->next;
+			delete node;
+			node = next;
+		}
+		return tasks;
+	}
+
 	std::unique_lock<std::mutex> lock(mutex);
-	hasTasks.store(false);
-	std::vector<TaskBase> tasks(queue.begin(), queue.end());
-	queue.clear();
+	std::vector<TaskBase> tasks;
+	for (auto& q: queues) {
+		for (auto& t: q) {
+			tasks.emplace_back(std::move(t.task));
+		}
+		q.clear();
+	}
+	queuedMask.store(0);
+	pendingTasks -= int(tasks.size());
+
+	if (mode == ExecutionQueueMode::WorkStealing) {
+		const int n = workerCount.load(std::memory_order_acquire);
+		for (int i = 0; i < n; ++i) {
+			while (TaskBase* task = workers[i]->steal()) {
+				tasks.emplace_back(std::move(*task));
+				delete task;
+				--pendingTasks;
+			}
+		}
+	}
 	return tasks;
 }
 
-void ExecutionQueue::addToQueue(TaskBase task)
+size_t ExecutionQueue::runAll()
+{
+	if (mode != ExecutionQueueMode::MPSC) {
+		auto tasks = getAll();
+		for (auto& t: tasks) {
+			Profiler::Scope profile("Task", ProfilerEventType::Task);
+			t();
+		}
+		return tasks.size();
+	}
+
+	// Only takes what was queued up to this point, so tasks queueing more tasks doesn't keep us here forever
+	size_t n = 0;
+	for (auto node = takeAllMPSC(); node; ++n) {
+		{
+			Profiler::Scope profile("Task", ProfilerEventType::Task);
+			node->task();
+		}
+		auto next = node->next;
+		delete node;
+		node = next;
+	}
+	return n;
+}
+
+void ExecutionQueue::addToQueue(TaskBase task, TaskPriority priority, int64_t deadlineNs)
 {
 #if HAS_THREADS
+	if (mode == ExecutionQueueMode::MPSC) {
+		auto node = new MPSCTaskNode(std::move(task));
+		MPSCTaskNode* head = mpscHead.load(std::memory_order_relaxed);
+		do {
+			node->next = head;
+		} while (!mpscHead.compare_exchange_weak(head, node, std::memory_order_seq_cst, std::memory_order_relaxed));
+		wakeWorker();
+		return;
+	}
+
+	if (mode == ExecutionQueueMode::WorkStealing) {
+		++pendingTasks;
+		if (currentWorker.queue == this && priority == TaskPriority::Normal && deadlineNs == 0) {
+			// Submitted from one of our own workers, so it goes into its local deque
+			workers[currentWorker.index]->push(new TaskBase(std::move(task)));
+		} else {
+			std::unique_lock<std::mutex> lock(mutex);
+			pushQueued(std::move(task), priority, deadlineNs);
+		}
+		wakeWorker();
+		return;
+	}
+
 	std::unique_lock<std::mutex> lock(mutex);
-	queue.emplace_back(task);
-	hasTasks.store(true);
+	pushQueued(std::move(task), priority, deadlineNs);
 
 	condition.notify_one();
 #else
@@ -54,6 +297,194 @@ void ExecutionQueue::addToQueue(TaskBase task)
 #endif
 }
 
+void ExecutionQueue::wakeWorker()
+{
+	// Paired with the check in getNextStealing: either we see the sleeper, or it sees the pending task
+	if (sleepingWorkers.load() > 0) {
+		std::unique_lock<std::mutex> lock(mutex);
+		condition.notify_one();
+	}
+}
+
+void ExecutionQueue::pushQueued(TaskBase task, TaskPriority priority, int64_t deadlineNs)
+{
+	const int level = int(priority);
+	int64_t dueTime = deadlineNs;
+	if (dueTime == 0 && priority != TaskPriority::Critical) {
+		dueTime = Profiler::getTimeNs() + maxWaitNs[level];
+	}
+
+	// Without deadlines, due times only go up, so this is nearly always an append
+	auto& q = queues[level];
+	auto pos = q.end();
+	while (pos != q.begin() && std::prev(pos)->dueTime > dueTime) {
+		--pos;
+	}
+	q.insert(pos, QueuedTask{ std::move(task), dueTime });
+	queuedMask.fetch_or(1u << level);
+}
+
+bool ExecutionQueue::popQueued(TaskBase& result, TaskPriority lowest)
+{
+	// Must be called with the mutex held
+	int level = -1;
+	if (!queues[0].empty()) {
+		level = 0;
+	} else if (lowest != TaskPriority::Critical) {
+		// Overdue tasks of any priority go first, then the rest in priority order
+		int64_t now = 0;
+		for (int i = 1; i < numPriorities; ++i) {
+			if (!queues[i].empty()) {
+				now = now != 0 ? now : Profiler::getTimeNs();
+				if (queues[i].front().dueTime <= now && (level == -1 || queues[i].front().dueTime < queues[level].front().dueTime)) {
+					level = i;
+				}
+			}
+		}
+		for (int i = 1; i <= int(lowest) && level == -1; ++i) {
+			if (!queues[i].empty()) {
+				level = i;
+			}
+		}
+	}
+	if (level == -1) {
+		return false;
+	}
+
+	auto& q = queues[level];
+	result = std::move(q.front().task);
+	q.pop_front();
+	if (q.empty()) {
+		queuedMask.fetch_and(~(1u << level));
+	}
+	return true;
+}
+
+TaskBase* ExecutionQueue::tryGetQueued(TaskPriority lowest, uint32_t mask)
+{
+	if ((queuedMask.load() & mask) != 0) {
+		std::unique_lock<std::mutex> lock(mutex);
+		TaskBase task;
+		if (popQueued(task, lowest)) {
+			return new TaskBase(std::move(task));
+		}
+	}
+	return nullptr;
+}
+
+TaskBase* ExecutionQueue::tryGetTask(int workerIndex)
+{
+	// Critical tasks first, wherever they were submitted from
+	if (TaskBase* task = tryGetQueued(TaskPriority::Critical, 1u)) {
+		return task;
+	}
+
+	// Then our own deque
+	if (workerIndex >= 0) {
+		if (TaskBase* task = workers[workerIndex]->pop()) {
+			return task;
+		}
+	}
+
+	// Then normal tasks submitted from outside of the pool, and anything overdue
+	if (TaskBase* task = tryGetQueued(TaskPriority::Normal, ~0u)) {
+		return task;
+	}
+
+	// Finally, try to steal from a random victim
+	const int n = workerCount.load(std::memory_order_acquire);
+	if (n > 0) {
+		stealSeed = stealSeed * 1664525u + 1013904223u + uint32_t(workerIndex + 1);
+		const int start = int((stealSeed >> 16) % uint32_t(n));
+		for (int i = 0; i < n; ++i) {
+			const int victim = (start + i) % n;
+			if (victim != workerIndex) {
+				if (TaskBase* task = workers[victim]->steal()) {
+					return task;
+				}
+			}
+		}
+	}
+
+	// Background work only once there's nothing else to do
+	return tryGetQueued(TaskPriority::Background, 1u << int(TaskPriority::Background));
+}
+
+TaskBase ExecutionQueue::getNextStealing()
+{
+	const int workerIndex = currentWorker.queue == this ? currentWorker.index : -1;
+
+	while (true) {
+		if (aborted) {
+			return TaskBase([] () {});
+		}
+
+		for (int spin = 0; spin < 64; ++spin) {
+			if (TaskBase* task = tryGetTask(workerIndex)) {
+				--pendingTasks;
+				TaskBase result = std::move(*task);
+				delete task;
+				return result;
+			}
+			if (pendingTasks.load() == 0) {
+				break;
+			}
+			std::this_thread::yield();
+		}
+
+		std::unique_lock<std::mutex> lock(mutex);
+		++sleepingWorkers;
+		while (pendingTasks.load() == 0 && !aborted) {
+			condition.wait(lock);
+		}
+		--sleepingWorkers;
+	}
+}
+
+MPSCTaskNode* ExecutionQueue::takeAllMPSC()
+{
+	// Producers push to the front, so the list is reversed to get it back into submission order
+	MPSCTaskNode* result = mpscPending;
+	mpscPending = nullptr;
+	if (!result) {
+		MPSCTaskNode* node = mpscHead.exchange(nullptr, std::memory_order_seq_cst);
+		while (node) {
+			auto next = node->next;
+			node->next = result;
+			result = node;
+			node = next;
+		}
+	}
+	return result;
+}
+
+TaskBase ExecutionQueue::getNextMPSC()
+{
+	while (true) {
+		if (aborted) {
+			return TaskBase([] () {});
+		}
+
+		if (!mpscPending) {
+			mpscPending = takeAllMPSC();
+		}
+		if (mpscPending) {
+			auto node = mpscPending;
+			mpscPending = node->next;
+			TaskBase result = std::move(node->task);
+			delete node;
+			return result;
+		}
+
+		std::unique_lock<std::mutex> lock(mutex);
+		++sleepingWorkers;
+		while (!mpscHead.load() && !aborted) {
+			condition.wait(lock);
+		}
+		--sleepingWorkers;
+	}
+}
+
 Executors& Executors::get()
 {
 	if (!instance) {
@@ -72,9 +503,29 @@ size_t ExecutionQueue::threadCount() const
 	return attachedCount.load();
 }
 
-void ExecutionQueue::onAttached()
+int ExecutionQueue::onAttached()
 {
 	++attachedCount;
+
+	if (mode == ExecutionQueueMode::WorkStealing) {
+		std::unique_lock<std::mutex> lock(mutex);
+		const int idx = workerCount.load();
+		if (idx < maxWorkers) {
+			workers[idx] = std::make_unique<WorkStealingDeque>();
+			workerCount.store(idx + 1, std::memory_order_release);
+			return idx;
+		}
+	}
+	return -1;
+}
+
+void ExecutionQueue::onWorkerStarted(int workerIndex)
+{
+	if (workerIndex >= 0) {
+		currentWorker.queue = this;
+		currentWorker.index = workerIndex;
+		stealSeed = uint32_t(workerIndex) * 2654435761u;
+	}
 }
 
 void ExecutionQueue::onDetached()
@@ -104,7 +555,7 @@ Executor::Executor(ExecutionQueue& queue)
 	, running(true)
 {
 #if HAS_THREADS
-	queue.onAttached();
+	workerIndex = queue.onAttached();
 #endif
 }
 
@@ -118,10 +569,7 @@ Executor::~Executor()
 bool Executor::runPending()
 {
 #if HAS_THREADS
-	auto tasks = queue.getAll();
-	for (auto& t : tasks) {
-		t();
-	}
+	queue.runAll();
 #endif
 	return false;
 }
@@ -129,10 +577,12 @@ bool Executor::runPending()
 void Executor::runForever()
 {
 #if HAS_THREADS
+	queue.onWorkerStarted(workerIndex);
 	try {
 		while (running)	{
 			auto next = queue.getNext();
 			if (running) {
+				Profiler::Scope profile("Task", ProfilerEventType::Task);
 				next();
 			}
 		}
@@ -165,6 +615,7 @@ ThreadPool::ThreadPool(const String& name, ExecutionQueue& queue, size_t n, Make
 	for (size_t i = 0; i < n; i++) {
 		threads[i] = makeThread(name + " Pool " + toString(i), [this, i]()
 		{
+			Profiler::setThreadName(this->name + " Pool " + toString(i));
 			try {
 				executors[i]->runForever();
 			} catch (std::exception& e) {
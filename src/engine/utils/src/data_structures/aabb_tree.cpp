@@ -0,0 +1,370 @@
+#include "halley/data_structures/aabb_tree.h"
+#include <gsl/gsl_assert>
+
+using namespace Halley;
+
+namespace {
+	float getPerimeter(const Rect4f& r)
+	{
+		return 2.0f * (r.getWidth() + r.getHeight());
+	}
+
+	bool containsRect(const Rect4f& outer, const Rect4f& inner)
+	{
+		const auto o1 = outer.getTopLeft();
+		const auto o2 = outer.getBottomRight();
+		const auto i1 = inner.getTopLeft();
+		const auto i2 = inner.getBottomRight();
+		return o1.x <= i1.x && o1.y <= i1.y && i2.x <= o2.x && i2.y <= o2.y;
+	}
+}
+
+AABBTree::AABBTree(float margin)
+	: margin(margin)
+{
+	Expects(margin >= 0);
+}
+
+AABBTree::ProxyId AABBTree::insert(Rect4f bounds, uint64_t data)
+{
+	const ProxyId id = allocateNode();
+	auto& node = nodes[id];
+	node.bounds = bounds;
+	node.fat = bounds.grow(margin);
+	node.data = data;
+	node.height = 0;
+	node.moved = true;
+	if (moved.size() >= nodes.size()) {
+		// Only grows with removals when getMovedPairs() isn't being called
+		compactMoved();
+	}
+	moved.push_back(id);
+
+	insertLeaf(id);
+	++nLeaves;
+	return id;
+}
+
+void AABBTree::remove(ProxyId proxy)
+{
+	getLeaf(proxy);
+	removeLeaf(proxy);
+	freeNode(proxy);
+	--nLeaves;
+}
+
+bool AABBTree::move(ProxyId proxy, Rect4f bounds, Vector2f displacement)
+{
+	getLeaf(proxy);
+	auto& node = nodes[proxy];
+	node.bounds = bounds;
+	if (!node.moved) {
+		node.moved = true;
+		moved.push_back(proxy);
+	}
+
+	// Stretch the fat bounds along the direction it's moving in, to anticipate the next few moves
+	Rect4f fat = bounds.grow(margin);
+	auto p1 = fat.getTopLeft();
+	auto p2 = fat.getBottomRight();
+	const Vector2f stretch = displacement * 2.0f;
+	(stretch.x < 0 ? p1.x : p2.x) += stretch.x;
+	(stretch.y < 0 ? p1.y : p2.y) += stretch.y;
+	fat = Rect4f(p1, p2);
+
+	if (containsRect(node.fat, bounds)) {
+		// Still fits, unless the fat bounds have become far too large for it (e.g. after a big displacement)
+		if (containsRect(fat.grow(4.0f * margin), node.fat)) {
+			return false;
+		}
+	}
+
+	removeLeaf(proxy);
+	nodes[proxy].fat = fat;
+	insertLeaf(proxy);
+	return true;
+}
+
+void AABBTree::clear()
+{
+	nodes.clear();
+	moved.clear();
+	root = nullProxy;
+	freeList = nullProxy;
+	nLeaves = 0;
+}
+
+size_t AABBTree::size() const
+{
+	return nLeaves;
+}
+
+int AABBTree::getHeight() const
+{
+	return root == nullProxy ? 0 : nodes[root].height;
+}
+
+Rect4f AABBTree::getBounds(ProxyId proxy) const
+{
+	return getLeaf(proxy).bounds;
+}
+
+Rect4f AABBTree::getFatBounds(ProxyId proxy) const
+{
+	return getLeaf(proxy).fat;
+}
+
+uint64_t AABBTree::getData(ProxyId proxy) const
+{
+	return getLeaf(proxy).data;
+}
+
+void AABBTree::getOverlappingPairs(Vector<Pair>& pairs) const
+{
+	for (ProxyId a = 0; a < ProxyId(nodes.size()); ++a) {
+		const auto& node = nodes[a];
+		if (node.height != 0) {
+			continue;
+		}
+		query(node.bounds, [&] (ProxyId b)
+		{
+			if (b > a && node.bounds.overlaps(nodes[b].bounds)) {
+				pairs.emplace_back(a, b);
+			}
+		});
+	}
+}
+
+void AABBTree::getMovedPairs(Vector<Pair>& pairs)
+{
+	compactMoved();
+	for (const ProxyId a: moved) {
+		const auto& node = nodes[a];
+		query(node.bounds, [&] (ProxyId b)
+		{
+			// A pair of moved proxies is reported from the lower one
+			if (b != a && !(nodes[b].moved && b < a) && node.bounds.overlaps(nodes[b].bounds)) {
+				pairs.emplace_back(std::min(a, b), std::max(a, b));
+			}
+		});
+	}
+
+	for (const ProxyId a: moved) {
+		nodes[a].moved = false;
+	}
+	moved.clear();
+}
+
+float AABBTree::intersectRay(Rect4f rect, Vector2f from, Vector2f dir, float maxDistance)
+{
+	// Slab test
+	float t0 = 0;
+	float t1 = maxDistance;
+	const float origin[] = { from.x, from.y };
+	const float d[] = { dir.x, dir.y };
+	const float lo[] = { rect.getLeft(), rect.getTop() };
+	const float hi[] = { rect.getRight(), rect.getBottom() };
+	for (int axis = 0; axis < 2; ++axis) {
+		if (d[axis] == 0) {
+			if (origin[axis] < lo[axis] || origin[axis] > hi[axis]) {
+				return -1;
+			}
+		} else {
+			const float inv = 1.0f / d[axis];
+			float tNear = (lo[axis] - origin[axis]) * inv;
+			float tFar = (hi[axis] - origin[axis]) * inv;
+			if (tNear > tFar) {
+				std::swap(tNear, tFar);
+			}
+			t0 = std::max(t0, tNear);
+			t1 = std::min(t1, tFar);
+			if (t0 > t1) {
+				return -1;
+			}
+		}
+	}
+	return t0;
+}
+
+void AABBTree::compactMoved()
+{
+	// Removed proxies have their flag cleared, and ones removed and then reused may be listed twice
+	std::sort(moved.begin(), moved.end());
+	moved.erase(std::unique(moved.begin(), moved.end()), moved.end());
+	moved.erase(std::remove_if(moved.begin(), moved.end(), [&] (ProxyId id) { return !nodes[id].moved; }), moved.end());
+}
+
+AABBTree::ProxyId AABBTree::allocateNode()
+{
+	if (freeList == nullProxy) {
+		nodes.emplace_back();
+		return ProxyId(nodes.size() - 1);
+	}
+	const ProxyId id = freeList;
+	freeList = nodes[id].parent;
+	nodes[id] = Node();
+	return id;
+}
+
+void AABBTree::freeNode(ProxyId id)
+{
+	nodes[id] = Node();
+	nodes[id].parent = freeList;
+	freeList = id;
+}
+
+void AABBTree::insertLeaf(ProxyId leaf)
+{
+	if (root == nullProxy) {
+		root = leaf;
+		nodes[leaf].parent = nullProxy;
+		return;
+	}
+
+	// Walk down to the best sibling, by the surface area heuristic (perimeter, in 2D)
+	const Rect4f leafFat = nodes[leaf].fat;
+	ProxyId index = root;
+	while (!nodes[index].isLeaf()) {
+		const auto& node = nodes[index];
+		const float perimeter = getPerimeter(node.fat);
+		const float combined = getPerimeter(node.fat.merge(leafFat));
+
+		// Cost of making a new parent for this node and the leaf, and the minimum cost of pushing it further down
+		const float cost = 2.0f * combined;
+		const float inheritance = 2.0f * (combined - perimeter);
+
+		auto getDescendCost = [&] (ProxyId child)
+		{
+			const auto& c = nodes[child];
+			const float merged = getPerimeter(c.fat.merge(leafFat));
+			return (c.isLeaf() ? merged : merged - getPerimeter(c.fat)) + inheritance;
+		};
+		const float cost1 = getDescendCost(node.child1);
+		const float cost2 = getDescendCost(node.child2);
+
+		if (cost < cost1 && cost < cost2) {
+			break;
+		}
+		index = cost1 < cost2 ? node.child1 : node.child2;
+	}
+
+	const ProxyId sibling = index;
+	const ProxyId oldParent = nodes[sibling].parent;
+	const ProxyId newParent = allocateNode();
+	auto& parent = nodes[newParent];
+	parent.parent = oldParent;
+	parent.fat = nodes[sibling].fat.merge(leafFat);
+	parent.height = nodes[sibling].height + 1;
+	parent.child1 = sibling;
+	parent.child2 = leaf;
+
+	if (oldParent != nullProxy) {
+		auto& p = nodes[oldParent];
+		(p.child1 == sibling ? p.child1 : p.child2) = newParent;
+	} else {
+		root = newParent;
+	}
+	nodes[sibling].parent = newParent;
+	nodes[leaf].parent = newParent;
+
+	fixUpwards(newParent);
+}
+
+void AABBTree::removeLeaf(ProxyId leaf)
+{
+	if (leaf == root) {
+		root = nullProxy;
+		return;
+	}
+
+	const ProxyId parent = nodes[leaf].parent;
+	const ProxyId grandParent = nodes[parent].parent;
+	const ProxyId sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+	if (grandParent != nullProxy) {
+		auto& g = nodes[grandParent];
+		(g.child1 == parent ? g.child1 : g.child2) = sibling;
+		nodes[sibling].parent = grandParent;
+		freeNode(parent);
+		fixUpwards(grandParent);
+	} else {
+		root = sibling;
+		nodes[sibling].parent = nullProxy;
+		freeNode(parent);
+	}
+	nodes[leaf].parent = nullProxy;
+}
+
+void AABBTree::fixUpwards(ProxyId id)
+{
+	while (id != nullProxy) {
+		id = balance(id);
+		auto& node = nodes[id];
+		const auto& c1 = nodes[node.child1];
+		const auto& c2 = nodes[node.child2];
+		node.height = 1 + std::max(c1.height, c2.height);
+		node.fat = c1.fat.merge(c2.fat);
+		id = node.parent;
+	}
+}
+
+AABBTree::ProxyId AABBTree::balance(ProxyId iA)
+{
+	// If one child is more than one level taller than the other, it's rotated up to take A's place
+	auto& a = nodes[iA];
+	if (a.isLeaf() || a.height < 2) {
+		return iA;
+	}
+
+	auto rotateUp = [&] (ProxyId iUp, ProxyId iOther, ProxyId& aSlot) -> ProxyId
+	{
+		auto& up = nodes[iUp];
+		auto& other = nodes[iOther];
+		const ProxyId iF = up.child1;
+		const ProxyId iG = up.child2;
+		auto& f = nodes[iF];
+		auto& g = nodes[iG];
+
+		up.child1 = iA;
+		up.parent = a.parent;
+		a.parent = iUp;
+		if (up.parent != nullProxy) {
+			auto& p = nodes[up.parent];
+			(p.child1 == iA ? p.child1 : p.child2) = iUp;
+		} else {
+			root = iUp;
+		}
+
+		// The taller grandchild stays under the rotated node, and the other one goes to A
+		const bool keepF = f.height > g.height;
+		const ProxyId iKeep = keepF ? iF : iG;
+		const ProxyId iGive = keepF ? iG : iF;
+		auto& keep = nodes[iKeep];
+		auto& give = nodes[iGive];
+
+		up.child2 = iKeep;
+		aSlot = iGive;
+		give.parent = iA;
+		a.fat = other.fat.merge(give.fat);
+		a.height = 1 + std::max(other.height, give.height);
+		up.fat = a.fat.merge(keep.fat);
+		up.height = 1 + std::max(a.height, keep.height);
+		return iUp;
+	};
+
+	const ProxyId iB = a.child1;
+	const ProxyId iC = a.child2;
+	const int32_t diff = nodes[iC].height - nodes[iB].height;
+	if (diff > 1) {
+		return rotateUp(iC, iB, a.child2);
+	} else if (diff < -1) {
+		return rotateUp(iB, iC, a.child1);
+	}
+	return iA;
+}
+
+const AABBTree::Node& AABBTree::getLeaf(ProxyId proxy) const
+{
+	Expects(proxy >= 0 && size_t(proxy) < nodes.size() && nodes[proxy].height == 0);
+	return nodes[proxy];
+}
@@ -1,38 +1,229 @@
 #include "halley/data_structures/bin_pack.h"
-
-#ifdef _MSC_VER
-#pragma warning(disable: 4456 4458)
-#endif
-#include "binpack2d.hpp"
 #include <queue>
+#include <limits>
 #include "halley/support/logger.h"
 
 using namespace Halley;
 
+MaxRectsBin::MaxRectsBin(Vector2i size)
+	: size(size)
+{
+	freeRects.emplace_back(Vector2i(), size);
+}
+
+boost::optional<BinPackResult> MaxRectsBin::insert(const BinPackEntry& entry)
+{
+	// Best short side fit: the free rect where the entry leaves the least space along its tightest side
+	int bestShort = std::numeric_limits<int>::max();
+	int bestLong = std::numeric_limits<int>::max();
+	Rect4i bestRect;
+	bool bestRotated = false;
+
+	auto tryFit = [&] (const Rect4i& freeRect, Vector2i entrySize, bool rotated)
+	{
+		const int leftoverX = freeRect.getWidth() - entrySize.x;
+		const int leftoverY = freeRect.getHeight() - entrySize.y;
+		if (leftoverX >= 0 && leftoverY >= 0) {
+			const int shortSide = std::min(leftoverX, leftoverY);
+			const int longSide = std::max(leftoverX, leftoverY);
+			if (shortSide < bestShort || (shortSide == bestShort && longSide < bestLong)) {
+				bestShort = shortSide;
+				bestLong = longSide;
+				bestRect = Rect4i(freeRect.getTopLeft(), entrySize.x, entrySize.y);
+				bestRotated = rotated;
+			}
+		}
+	};
+
+	for (auto& freeRect: freeRects) {
+		tryFit(freeRect, entry.size, false);
+		if (entry.canRotate && entry.size.x != entry.size.y) {
+			tryFit(freeRect, Vector2i(entry.size.y, entry.size.x), true);
+		}
+	}
+
+	if (bestShort == std::numeric_limits<int>::max()) {
+		return {};
+	}
+
+	place(bestRect);
+	return BinPackResult(bestRect, bestRotated, entry.data);
+}
+
+bool MaxRectsBin::occupy(Rect4i rect)
+{
+	if (rect.getLeft() < 0 || rect.getTop() < 0 || rect.getRight() > size.x || rect.getBottom() > size.y) {
+		return false;
+	}
+
+	// It's entirely free if any one free rect contains it, since free rects are maximal
+	for (auto& freeRect: freeRects) {
+		if (freeRect.getLeft() <= rect.getLeft() && freeRect.getTop() <= rect.getTop() && freeRect.getRight() >= rect.getRight() && freeRect.getBottom() >= rect.getBottom()) {
+			place(rect);
+			return true;
+		}
+	}
+	return false;
+}
+
+void MaxRectsBin::place(Rect4i used)
+{
+	// Split every free rect that overlaps the used one into the (up to four) maximal rects around it
+	const size_t nOriginal = freeRects.size();
+	size_t nKept = 0;
+	for (size_t i = 0; i < nOriginal; ++i) {
+		const auto free = freeRects[i];
+		if (used.getLeft() >= free.getRight() || used.getRight() <= free.getLeft() || used.getTop() >= free.getBottom() || used.getBottom() <= free.getTop()) {
+			freeRects[nKept++] = free;
+			continue;
+		}
+
+		if (used.getTop() > free.getTop()) {
+			freeRects.emplace_back(free.getLeft(), free.getTop(), free.getWidth(), used.getTop() - free.getTop());
+		}
+		if (used.getBottom() < free.getBottom()) {
+			freeRects.emplace_back(free.getLeft(), used.getBottom(), free.getWidth(), free.getBottom() - used.getBottom());
+		}
+		if (used.getLeft() > free.getLeft()) {
+			freeRects.emplace_back(free.getLeft(), free.getTop(), used.getLeft() - free.getLeft(), free.getHeight());
+		}
+		if (used.getRight() < free.getRight()) {
+			freeRects.emplace_back(used.getRight(), free.getTop(), free.getRight() - used.getRight(), free.getHeight());
+		}
+	}
+
+	// Move the new ones down to fill the gaps left by the removed ones
+	const size_t nNew = freeRects.size() - nOriginal;
+	std::move(freeRects.begin() + nOriginal, freeRects.end(), freeRects.begin() + nKept);
+	freeRects.resize(nKept + nNew);
+
+	pruneFreeRects(nKept);
+}
+
+void MaxRectsBin::pruneFreeRects(size_t firstNew)
+{
+	// Drop free rects contained in others. Untouched rects can't contain each other, so only the new ones need checking
+	auto isContainedIn = [] (const Rect4i& a, const Rect4i& b)
+	{
+		return a.getLeft() >= b.getLeft() && a.getTop() >= b.getTop() && a.getRight() <= b.getRight() && a.getBottom() <= b.getBottom();
+	};
+
+	std::vector<char> removed(freeRects.size(), 0);
+	for (size_t i = firstNew; i < freeRects.size(); ++i) {
+		for (size_t j = 0; j < freeRects.size(); ++j) {
+			if (i == j || removed[j]) {
+				continue;
+			}
+			if (isContainedIn(freeRects[i], freeRects[j])) {
+				removed[i] = 1;
+				break;
+			}
+			if (j < firstNew && isContainedIn(freeRects[j], freeRects[i])) {
+				removed[j] = 1;
+			}
+		}
+	}
+
+	size_t n = 0;
+	for (size_t i = 0; i < freeRects.size(); ++i) {
+		if (!removed[i]) {
+			freeRects[n++] = freeRects[i];
+		}
+	}
+	freeRects.resize(n);
+}
+
+static std::vector<size_t> getPackingOrder(const std::vector<BinPackEntry>& entries)
+{
+	// Largest first
+	std::vector<size_t> order(entries.size());
+	for (size_t i = 0; i < order.size(); ++i) {
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), [&] (size_t a, size_t b) { return entries[b] < entries[a]; });
+	return order;
+}
+
 boost::optional<Vector<BinPackResult>> BinPack::pack(const std::vector<BinPackEntry>& entries, Vector2i binSize)
 {
-	using T = void*;
+	MaxRectsBin bin(binSize);
+	Vector<BinPackResult> results;
+	results.reserve(entries.size());
+	for (size_t i: getPackingOrder(entries)) {
+		auto result = bin.insert(entries[i]);
+		if (!result) {
+			return {};
+		}
+		results.push_back(result.get());
+	}
+	return results;
+}
 
-	BinPack2D::ContentAccumulator<T> inputContent;
-	for (auto& e: entries) {
-		inputContent += BinPack2D::Content<T>(e.data, BinPack2D::Coord(), BinPack2D::Size(e.size.x, e.size.y), false);
+boost::optional<Vector<BinPackResult>> BinPack::packMultiple(const std::vector<BinPackEntry>& entries, Vector2i binSize)
+{
+	std::vector<MaxRectsBin> bins;
+	Vector<BinPackResult> results;
+	results.reserve(entries.size());
+	for (size_t i: getPackingOrder(entries)) {
+		// First fit on the existing bins, otherwise start a new one
+		bool placed = false;
+		for (size_t j = 0; j < bins.size() && !placed; ++j) {
+			auto result = bins[j].insert(entries[i]);
+			if (result) {
+				result->bin = int(j);
+				results.push_back(result.get());
+				placed = true;
+			}
+		}
+
+		if (!placed) {
+			bins.emplace_back(binSize);
+			auto result = bins.back().insert(entries[i]);
+			if (!result) {
+				return {};
+			}
+			result->bin = int(bins.size() - 1);
+			results.push_back(result.get());
+		}
+	}
+	return results;
+}
+
+boost::optional<Vector<BinPackResult>> BinPack::packIncremental(const std::vector<BinPackEntry>& entries, Vector2i binSize, const std::vector<boost::optional<Vector2i>>& previousPositions)
+{
+	MaxRectsBin bin(binSize);
+	Vector<BinPackResult> results;
+	results.reserve(entries.size());
+
+	// Keep what can stay where it was, largest first, since those are the hardest to fit elsewhere
+	const auto order = getPackingOrder(entries);
+	std::vector<char> done(entries.size(), 0);
+	for (size_t i: order) {
+		if (i >= previousPositions.size() || !previousPositions[i]) {
+			continue;
+		}
+		const auto& e = entries[i];
+		const auto pos = previousPositions[i].get();
+		if (bin.occupy(Rect4i(pos, e.size.x, e.size.y))) {
+			results.push_back(BinPackResult(Rect4i(pos, e.size.x, e.size.y), false, e.data));
+			done[i] = 1;
+		} else if (e.canRotate && bin.occupy(Rect4i(pos, e.size.y, e.size.x))) {
+			results.push_back(BinPackResult(Rect4i(pos, e.size.y, e.size.x), true, e.data));
+			done[i] = 1;
+		}
 	}
-	inputContent.Sort();
-	BinPack2D::CanvasArray<T> canvasArray = BinPack2D::UniformCanvasArrayBuilder<T>(binSize.x, binSize.y, 1).Build();
-	BinPack2D::ContentAccumulator<T> remainder;
-	bool success = canvasArray.Place(inputContent, remainder);
-	BinPack2D::ContentAccumulator<T> outputContent;
-	canvasArray.CollectContent(outputContent);
-
-	if (success) {
-		Vector<BinPackResult> results;
-		for (auto& content: outputContent.Get()) {
-			results.push_back(BinPackResult(Rect4i(content.coord.x, content.coord.y, content.size.w, content.size.h), content.rotated, content.content));
-		}
-		return boost::optional<Vector<BinPackResult>>(std::move(results));
-	} else {
-		return boost::optional<Vector<BinPackResult>>();
+
+	// Then the rest around them
+	for (size_t i: order) {
+		if (!done[i]) {
+			auto result = bin.insert(entries[i]);
+			if (!result) {
+				return {};
+			}
+			results.push_back(result.get());
+		}
 	}
+	return results;
 }
 
 boost::optional<Vector<BinPackResult>> BinPack::fastPack(const std::vector<BinPackEntry>& entries, Vector2i binSize)
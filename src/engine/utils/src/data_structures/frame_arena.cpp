@@ -0,0 +1,138 @@
+#include "halley/data_structures/frame_arena.h"
+#include <algorithm>
+
+using namespace Halley;
+
+namespace {
+	std::atomic<uint64_t> globalFrame { 0 };
+	constexpr size_t minBlockSize = 64 * 1024;
+
+	size_t alignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+}
+
+void FrameArena::Buffer::reset()
+{
+	curBlock = 0;
+	pos = 0;
+	used = 0;
+}
+
+FrameArena::FrameArena()
+	: frame(globalFrame.load(std::memory_order_relaxed))
+{
+}
+
+FrameArena::~FrameArena()
+{
+}
+
+FrameArena& FrameArena::get()
+{
+	thread_local FrameArena arena;
+	return arena;
+}
+
+void FrameArena::nextFrame()
+{
+	globalFrame.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t FrameArena::getFrameNumber()
+{
+	return globalFrame.load(std::memory_order_relaxed);
+}
+
+void* FrameArena::alloc(size_t size, size_t alignment)
+{
+	sync();
+
+	auto& buffer = buffers[current];
+	if (buffer.curBlock < buffer.blocks.size()) {
+		auto& block = buffer.blocks[buffer.curBlock];
+		const size_t start = alignUp(reinterpret_cast<uintptr_t>(block.data.get()) + buffer.pos, alignment) - reinterpret_cast<uintptr_t>(block.data.get());
+		if (start + size <= block.size) {
+			buffer.pos = start + size;
+			buffer.used += size;
+			return block.data.get() + start;
+		}
+	}
+	return allocSlow(size, alignment);
+}
+
+void FrameArena::free(void* ptr, size_t size)
+{
+	// Only the last allocation of this frame can be given back
+	auto& buffer = buffers[current];
+	if (ptr && buffer.curBlock < buffer.blocks.size()) {
+		auto* base = buffer.blocks[buffer.curBlock].data.get();
+		if (static_cast<char*>(ptr) + size == base + buffer.pos) {
+			buffer.pos = size_t(static_cast<char*>(ptr) - base);
+			buffer.used -= size;
+		}
+	}
+}
+
+size_t FrameArena::getBytesUsed() const
+{
+	return buffers[current].used;
+}
+
+size_t FrameArena::getCapacity() const
+{
+	size_t total = 0;
+	for (auto& buffer: buffers) {
+		for (auto& block: buffer.blocks) {
+			total += block.size;
+		}
+	}
+	return total;
+}
+
+void FrameArena::sync()
+{
+	const uint64_t curFrame = globalFrame.load(std::memory_order_relaxed);
+	if (curFrame != frame) {
+		// The other buffer holds memory from two or more frames ago, so it's free to reuse
+		current = 1 - current;
+		buffers[current].reset();
+		if (curFrame - frame > 1) {
+			// Nothing was allocated on the last frame, so the buffer that is kept around isn't needed either
+			buffers[1 - current].reset();
+		}
+		frame = curFrame;
+	}
+}
+
+void* FrameArena::allocSlow(size_t size, size_t alignment)
+{
+	auto& buffer = buffers[current];
+
+	// Try the blocks that are already there before making a new one
+	while (buffer.curBlock + 1 < buffer.blocks.size()) {
+		++buffer.curBlock;
+		buffer.pos = 0;
+		auto& block = buffer.blocks[buffer.curBlock];
+		const size_t start = alignUp(reinterpret_cast<uintptr_t>(block.data.get()), alignment) - reinterpret_cast<uintptr_t>(block.data.get());
+		if (start + size <= block.size) {
+			buffer.pos = start + size;
+			buffer.used += size;
+			return block.data.get() + start;
+		}
+	}
+
+	const size_t lastSize = buffer.blocks.empty() ? 0 : buffer.blocks.back().size;
+	Block block;
+	block.size = std::max(std::max(minBlockSize, lastSize * 2), size + alignment);
+	block.data.reset(new char[block.size]);
+	buffer.blocks.push_back(std::move(block));
+	buffer.curBlock = buffer.blocks.size() - 1;
+
+	auto& newBlock = buffer.blocks.back();
+	const size_t start = alignUp(reinterpret_cast<uintptr_t>(newBlock.data.get()), alignment) - reinterpret_cast<uintptr_t>(newBlock.data.get());
+	buffer.pos = start + size;
+	buffer.used += size;
+	return newBlock.data.get() + start;
+}
@@ -1,49 +1,377 @@
-#include <boost/pool/pool.hpp>
 #include "halley/data_structures/memory_pool.h"
+#include "halley/support/exception.h"
+#include "halley/text/string_converter.h"
+#include <algorithm>
 
 using namespace Halley;
 
-PoolPool& PoolPool::get()
+struct SizePool::Batch
 {
-	static PoolPool* pools = nullptr;
-	if (!pools) {
-		pools = new PoolPool();
-	}
-	return *pools;
-}
+	void* head = nullptr;
+	uint32_t count = 0;
+	std::atomic<uint32_t> next { 0 };
+};
 
-SizePool* PoolPool::getPool(size_t size)
+struct SizePool::ThreadCache
 {
-	auto& pools = get().pools;
-	auto iter = pools.find(size);
-	if (iter != pools.end()) {
-		return iter->second;
-	}
+	void* head = nullptr;
+	uint32_t count = 0;
+};
 
-	auto pool = new SizePool(size);
-	pools[size] = pool;
-	return pool;
+namespace Halley {
+	// Pools by id, so that thread caches can tell whether their pool is still alive when the thread exits
+	struct SizePoolRegistry
+	{
+		std::mutex mutex;
+		Vector<SizePool*> pools;
+
+		static SizePoolRegistry& get()
+		{
+			static SizePoolRegistry* registry = new SizePoolRegistry();
+			return *registry;
+		}
+	};
+
+	struct SizePoolThreadCaches
+	{
+		Vector<SizePool::ThreadCache> caches;
+
+		~SizePoolThreadCaches()
+		{
+			// Give everything back, so it's not lost along with the thread
+			auto& registry = SizePoolRegistry::get();
+			std::unique_lock<std::mutex> lock(registry.mutex);
+			for (size_t i = 0; i < caches.size(); ++i) {
+				auto& cache = caches[i];
+				auto* pool = registry.pools[i];
+				while (pool && cache.count > 0) {
+					pool->flush(cache, std::min(cache.count, pool->batchSize));
+				}
+			}
+		}
+	};
 }
 
-typedef boost::pool<boost::default_user_allocator_malloc_free> PoolType;
+namespace {
+	constexpr size_t elementAlignment = 16;
+
+	size_t getElementSize(size_t size)
+	{
+		return (std::max(size, sizeof(void*)) + elementAlignment - 1) & ~(elementAlignment - 1);
+	}
+
+	uint32_t getBatchSize(size_t elementSize)
+	{
+		return uint32_t(std::max(size_t(8), std::min(size_t(256), size_t(16384) / elementSize)));
+	}
+
+	uint32_t registerPool(SizePool* pool)
+	{
+		auto& registry = SizePoolRegistry::get();
+		std::unique_lock<std::mutex> lock(registry.mutex);
+		registry.pools.push_back(pool);
+		return uint32_t(registry.pools.size() - 1);
+	}
+
+	void*& nextOf(void* element)
+	{
+		return *static_cast<void**>(element);
+	}
+}
 
 SizePool::SizePool(size_t size)
-	: size(size)
+	: size(getElementSize(size))
+	, batchSize(getBatchSize(this->size))
+	, id(registerPool(this))
 {
-	pimpl = new PoolType(size);
+	for (auto& c: batchChunks) {
+		c.store(nullptr, std::memory_order_relaxed);
+	}
 }
 
 SizePool::~SizePool()
 {
-	delete reinterpret_cast<PoolType*>(pimpl);
+	{
+		auto& registry = SizePoolRegistry::get();
+		std::unique_lock<std::mutex> lock(registry.mutex);
+		registry.pools[id] = nullptr;
+	}
+
+	for (auto& c: batchChunks) {
+		delete c.load(std::memory_order_relaxed);
+	}
 }
 
 void* SizePool::alloc()
 {
-	return reinterpret_cast<PoolType*>(pimpl)->malloc();
+	auto& cache = getThreadCache();
+	if (!cache.head) {
+		refill(cache);
+	}
+
+	void* result = cache.head;
+	cache.head = nextOf(result);
+	--cache.count;
+	return result;
 }
 
 void SizePool::free(void* p)
 {
-	reinterpret_cast<PoolType*>(pimpl)->free(p);
+	if (!p) {
+		return;
+	}
+
+	auto& cache = getThreadCache();
+	nextOf(p) = cache.head;
+	cache.head = p;
+	++cache.count;
+
+	// Keep one batch around, so that alternating allocs and frees don't keep moving the same batch back and forth
+	if (cache.count >= 2 * batchSize) {
+		flush(cache, batchSize);
+	}
+}
+
+SizePoolStats SizePool::getStats() const
+{
+	SizePoolStats stats;
+	stats.elementSize = size;
+	stats.capacity = capacity.load(std::memory_order_relaxed);
+	stats.globalFree = globalFree.load(std::memory_order_relaxed);
+	stats.inUse = stats.capacity - std::min(stats.capacity, stats.globalFree);
+	stats.bytesReserved = bytesReserved.load(std::memory_order_relaxed);
+	return stats;
+}
+
+SizePool::ThreadCache& SizePool::getThreadCache()
+{
+	thread_local SizePoolThreadCaches threadCaches;
+	auto& caches = threadCaches.caches;
+	if (id >= caches.size()) {
+		caches.resize(id + 1);
+	}
+	return caches[id];
+}
+
+void SizePool::refill(ThreadCache& cache)
+{
+	uint32_t idx;
+	if (pop(fullBatches, idx)) {
+		auto& batch = getBatch(idx);
+		cache.head = batch.head;
+		cache.count = batch.count;
+		globalFree.fetch_sub(batch.count, std::memory_order_relaxed);
+		batch.head = nullptr;
+		batch.count = 0;
+		push(emptyBatches, idx);
+	} else {
+		reserveMore(cache);
+	}
+}
+
+void SizePool::flush(ThreadCache& cache, uint32_t count)
+{
+	Expects(count > 0 && count <= cache.count);
+
+	void* first = cache.head;
+	void* last = first;
+	for (uint32_t i = 1; i < count; ++i) {
+		last = nextOf(last);
+	}
+	cache.head = nextOf(last);
+	cache.count -= count;
+	nextOf(last) = nullptr;
+
+	uint32_t idx;
+	if (!pop(emptyBatches, idx)) {
+		idx = makeBatch();
+	}
+	auto& batch = getBatch(idx);
+	batch.head = first;
+	batch.count = count;
+	globalFree.fetch_add(count, std::memory_order_relaxed);
+	push(fullBatches, idx);
+}
+
+void SizePool::reserveMore(ThreadCache& cache)
+{
+	const size_t numElements = size_t(batchSize) * 8;
+	const size_t slabSize = numElements * size;
+
+	char* slab;
+	{
+		std::unique_lock<std::mutex> lock(reserveMutex);
+		slabs.emplace_back(new char[slabSize]);
+		slab = slabs.back().get();
+	}
+	capacity.fetch_add(numElements, std::memory_order_relaxed);
+	bytesReserved.fetch_add(slabSize, std::memory_order_relaxed);
+
+	// Link up the whole slab into the cache, and then send everything but one batch to the shared list
+	for (size_t i = numElements; i-- > 0; ) {
+		void* element = slab + i * size;
+		nextOf(element) = cache.head;
+		cache.head = element;
+	}
+	cache.count += uint32_t(numElements);
+	while (cache.count > batchSize) {
+		flush(cache, batchSize);
+	}
+}
+
+SizePool::Batch& SizePool::getBatch(uint32_t idx) const
+{
+	return (*batchChunks[idx / std::tuple_size<BatchChunk>::value].load(std::memory_order_acquire))[idx % std::tuple_size<BatchChunk>::value];
+}
+
+uint32_t SizePool::makeBatch()
+{
+	const uint32_t idx = numBatches.fetch_add(1, std::memory_order_relaxed);
+	const size_t chunkIdx = idx / std::tuple_size<BatchChunk>::value;
+	if (chunkIdx >= maxBatchChunks) {
+		throw Exception("Too many batches in pool of size " + toString(size), HalleyExceptions::Utils);
+	}
+
+	auto& chunk = batchChunks[chunkIdx];
+	if (!chunk.load(std::memory_order_acquire)) {
+		// Whoever gets there first wins
+		auto* newChunk = new BatchChunk();
+		BatchChunk* expected = nullptr;
+		if (!chunk.compare_exchange_strong(expected, newChunk, std::memory_order_acq_rel)) {
+			delete newChunk;
+		}
+	}
+	return idx;
+}
+
+bool SizePool::pop(std::atomic<uint64_t>& stack, uint32_t& idx)
+{
+	uint64_t top = stack.load(std::memory_order_acquire);
+	while (true) {
+		const uint32_t topIdx = uint32_t(top);
+		if (topIdx == 0) {
+			return false;
+		}
+		// If the batch is popped by someone else in the meantime, this reads garbage, but then the counter will have
+		// changed and the exchange will fail
+		const uint32_t next = getBatch(topIdx - 1).next.load(std::memory_order_relaxed);
+		const uint64_t newTop = ((top >> 32) + 1) << 32 | next;
+		if (stack.compare_exchange_weak(top, newTop, std::memory_order_acq_rel, std::memory_order_acquire)) {
+			idx = topIdx - 1;
+			return true;
+		}
+	}
+}
+
+void SizePool::push(std::atomic<uint64_t>& stack, uint32_t idx)
+{
+	auto& batch = getBatch(idx);
+	uint64_t top = stack.load(std::memory_order_relaxed);
+	while (true) {
+		batch.next.store(uint32_t(top), std::memory_order_relaxed);
+		const uint64_t newTop = ((top >> 32) + 1) << 32 | (idx + 1);
+		if (stack.compare_exchange_weak(top, newTop, std::memory_order_release, std::memory_order_relaxed)) {
+			return;
+		}
+	}
+}
+
+PoolPool::PoolPool()
+{
+	for (auto& p: classPools) {
+		p.store(nullptr, std::memory_order_relaxed);
+	}
+}
+
+PoolPool& PoolPool::get()
+{
+	static PoolPool* pools = new PoolPool();
+	return *pools;
+}
+
+size_t PoolPool::getSizeClass(size_t size)
+{
+	size = std::max(size, size_t(1));
+	if (size <= 256) {
+		return (size + 15) / 16 - 1;
+	} else if (size <= 1024) {
+		return 16 + (size - 256 + 63) / 64 - 1;
+	} else {
+		return 28 + (size - 1024 + 255) / 256 - 1;
+	}
+}
+
+size_t PoolPool::getClassSize(size_t sizeClass)
+{
+	if (sizeClass < 16) {
+		return (sizeClass + 1) * 16;
+	} else if (sizeClass < 28) {
+		return 256 + (sizeClass - 15) * 64;
+	} else {
+		return 1024 + (sizeClass - 27) * 256;
+	}
+}
+
+SizePool* PoolPool::getPool(size_t size)
+{
+	auto& pools = get();
+
+	if (size <= maxSizeClass) {
+		const size_t sizeClass = getSizeClass(size);
+		auto& slot = pools.classPools[sizeClass];
+		auto* pool = slot.load(std::memory_order_acquire);
+		if (!pool) {
+			std::unique_lock<std::mutex> lock(pools.mutex);
+			pool = slot.load(std::memory_order_relaxed);
+			if (!pool) {
+				pool = new SizePool(getClassSize(sizeClass));
+				slot.store(pool, std::memory_order_release);
+			}
+		}
+		return pool;
+	}
+
+	std::unique_lock<std::mutex> lock(pools.mutex);
+	auto iter = pools.largePools.find(size);
+	if (iter != pools.largePools.end()) {
+		return iter->second;
+	}
+	auto pool = new SizePool(size);
+	pools.largePools[size] = pool;
+	return pool;
+}
+
+void* PoolPool::alloc(size_t size)
+{
+	if (size > maxSizeClass) {
+		return ::operator new(size);
+	}
+	return getPool(size)->alloc();
+}
+
+void PoolPool::free(void* p, size_t size)
+{
+	if (size > maxSizeClass) {
+		::operator delete(p);
+	} else {
+		getPool(size)->free(p);
+	}
+}
+
+Vector<SizePoolStats> PoolPool::getStats()
+{
+	auto& pools = get();
+	std::unique_lock<std::mutex> lock(pools.mutex);
+
+	Vector<SizePoolStats> result;
+	for (auto& p: pools.classPools) {
+		auto* pool = p.load(std::memory_order_acquire);
+		if (pool) {
+			result.push_back(pool->getStats());
+		}
+	}
+	for (auto& p: pools.largePools) {
+		result.push_back(p.second->getStats());
+	}
+	return result;
 }
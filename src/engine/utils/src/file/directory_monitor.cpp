@@ -1,9 +1,19 @@
 #include "halley/file/directory_monitor.h"
 #include "halley/support/exception.h"
+#include "halley/support/logger.h"
 #include "halley/file/path.h"
+#include <set>
+#include <cstring>
+
+#if defined(__APPLE__)
+#include <TargetConditionals.h>
+#endif
 
 using namespace Halley;
 
+// Every implementation collects the changed paths (relative, with forward slashes) into a set, and returns false from
+// poll() when it lost track of changes and everything needs to be rescanned.
+
 #if defined(_WIN32) && !defined(WINDOWS_STORE)
 
 #define WIN32_LEAN_AND_MEAN
@@ -14,31 +24,57 @@ namespace Halley {
 	{
 	public:
 		DirectoryMonitorPimpl(const Path& path)
-			: path(path)
+			: buffer(16 * 1024) // 64 KB, the most ReadDirectoryChangesW takes over the network
 		{
-			handle = FindFirstChangeNotification(path.string().c_str(), true, FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE);
+			handle = CreateFileA(path.string().c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+			if (handle == INVALID_HANDLE_VALUE) {
+				throw Exception("Unable to monitor directory \"" + path.getString() + "\".", HalleyExceptions::Utils);
+			}
+			memset(&overlapped, 0, sizeof(overlapped));
+			overlapped.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+			listening = requestChanges();
 		}
 
 		~DirectoryMonitorPimpl()
 		{
-			FindCloseChangeNotification(handle);
+			if (listening) {
+				// The buffer is in use until the cancelled request completes
+				CancelIo(handle);
+				DWORD bytes;
+				GetOverlappedResult(handle, &overlapped, &bytes, TRUE);
+			}
+			CloseHandle(overlapped.hEvent);
+			CloseHandle(handle);
 		}
 
-		bool poll()
+		bool poll(std::set<String>& changed)
 		{
-			bool changed = false;
+			if (!listening) {
+				listening = requestChanges();
+				return false;
+			}
+
+			bool complete = true;
 			while (true) {
-				auto result = WaitForSingleObject(handle, 0);
-				if (result == WAIT_OBJECT_0) {
-					changed = true;
-					FindNextChangeNotification(handle);
-				} else if (result == WAIT_TIMEOUT) {
-					break;
-				} else if (result == WAIT_FAILED || WAIT_ABANDONED) {
-					throw Exception("Failed to wait for object.", HalleyExceptions::Utils);
+				DWORD bytes = 0;
+				if (!GetOverlappedResult(handle, &overlapped, &bytes, FALSE)) {
+					if (GetLastError() == ERROR_IO_INCOMPLETE) {
+						break;
+					}
+					complete = false;
+				} else if (bytes == 0) {
+					// The buffer overflowed and the changes were discarded
+					complete = false;
+				} else {
+					readChanges(changed);
+				}
+
+				listening = requestChanges();
+				if (!listening) {
+					return false;
 				}
 			}
-			return changed;
+			return complete;
 		}
 
 		bool hasRealImplementation() const
@@ -48,7 +84,287 @@ namespace Halley {
 
 	private:
 		HANDLE handle;
-		Path path;
+		OVERLAPPED overlapped;
+		std::vector<DWORD> buffer; // DWORD aligned, as required
+		bool listening = false;
+
+		bool requestChanges()
+		{
+			ResetEvent(overlapped.hEvent);
+			const DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE;
+			return ReadDirectoryChangesW(handle, buffer.data(), DWORD(buffer.size() * sizeof(DWORD)), TRUE, filter, nullptr, &overlapped, nullptr) != 0;
+		}
+
+		void readChanges(std::set<String>& changed)
+		{
+			auto* data = reinterpret_cast<const char*>(buffer.data());
+			while (true) {
+				auto* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(data);
+				const std::wstring name(info->FileName, info->FileNameLength / sizeof(WCHAR));
+				changed.insert(String(name.c_str()).replaceAll("\\", "/"));
+
+				if (info->NextEntryOffset == 0) {
+					break;
+				}
+				data += info->NextEntryOffset;
+			}
+		}
+	};
+}
+
+#elif defined(__linux__)
+
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <cerrno>
+#include <map>
+
+namespace Halley {
+	class DirectoryMonitorPimpl
+	{
+	public:
+		DirectoryMonitorPimpl(const Path& path)
+			: root(path.string())
+		{
+			fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+			if (fd < 0) {
+				throw Exception("Unable to initialise inotify.", HalleyExceptions::Utils);
+			}
+			watching = addWatches("", nullptr);
+		}
+
+		~DirectoryMonitorPimpl()
+		{
+			close(fd);
+		}
+
+		bool poll(std::set<String>& changed)
+		{
+			bool complete = !outOfWatches;
+
+			alignas(inotify_event) char buffer[16 * 1024];
+			while (true) {
+				const ssize_t len = read(fd, buffer, sizeof(buffer));
+				if (len <= 0) {
+					break;
+				}
+
+				for (const char* p = buffer; p < buffer + len; ) {
+					auto* event = reinterpret_cast<const inotify_event*>(p);
+					p += sizeof(inotify_event) + event->len;
+
+					if (event->mask & IN_Q_OVERFLOW) {
+						complete = false;
+						continue;
+					}
+
+					auto dir = dirs.find(event->wd);
+					if (dir == dirs.end()) {
+						continue;
+					}
+					if (event->mask & IN_IGNORED) {
+						dirs.erase(dir);
+						continue;
+					}
+					if ((event->mask & IN_DELETE_SELF) && dir->second.empty()) {
+						watching = false;
+						complete = false;
+						continue;
+					}
+					if (event->len == 0) {
+						continue;
+					}
+
+					const std::string path = join(dir->second, event->name);
+					changed.insert(path);
+					if (event->mask & IN_ISDIR) {
+						if (event->mask & IN_MOVED_FROM) {
+							removeWatches(path);
+						} else if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+							// Anything created in it before the watch was added would be missed otherwise
+							addWatches(path, &changed);
+						}
+					}
+				}
+			}
+
+			if (!watching) {
+				// The root didn't exist, or was deleted; once it's back, its contents are unknown
+				for (auto& d: dirs) {
+					inotify_rm_watch(fd, d.first);
+				}
+				dirs.clear();
+				watching = addWatches("", nullptr);
+				if (watching) {
+					complete = false;
+				}
+			}
+
+			return complete && !outOfWatches;
+		}
+
+		bool hasRealImplementation() const
+		{
+			// Without watches for every directory, it degrades to rescanning everything
+			return !outOfWatches;
+		}
+
+	private:
+		int fd = -1;
+		std::string root;
+		std::map<int, std::string> dirs; // Watch descriptor to path, relative to root
+		bool watching = false;
+		bool outOfWatches = false;
+
+		static std::string join(const std::string& dir, const char* name)
+		{
+			return dir.empty() ? std::string(name) : dir + "/" + name;
+		}
+
+		bool addWatches(const std::string& relPath, std::set<String>* contents)
+		{
+			// inotify isn't recursive, so every directory gets its own watch
+			const std::string fullPath = relPath.empty() ? root : root + "/" + relPath;
+			const uint32_t mask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_ONLYDIR;
+			const int wd = inotify_add_watch(fd, fullPath.c_str(), mask);
+			if (wd < 0) {
+				if (errno == ENOSPC && !outOfWatches) {
+					outOfWatches = true;
+					Logger::logWarning("Out of inotify watches monitoring \"" + String(root) + "\", raise fs.inotify.max_user_watches.");
+				}
+				return false;
+			}
+			dirs[wd] = relPath;
+
+			DIR* dir = opendir(fullPath.c_str());
+			if (!dir) {
+				return false;
+			}
+			while (auto* entry = readdir(dir)) {
+				const std::string name = entry->d_name;
+				if (name == "." || name == "..") {
+					continue;
+				}
+				const std::string childPath = join(relPath, name.c_str());
+
+				bool isDir = entry->d_type == DT_DIR;
+				if (entry->d_type == DT_UNKNOWN) {
+					struct stat st;
+					isDir = stat((root + "/" + childPath).c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+				}
+
+				if (contents) {
+					contents->insert(childPath);
+				}
+				if (isDir) {
+					addWatches(childPath, contents);
+				}
+			}
+			closedir(dir);
+			return true;
+		}
+
+		void removeWatches(const std::string& relPath)
+		{
+			const std::string prefix = relPath + "/";
+			for (auto iter = dirs.begin(); iter != dirs.end(); ) {
+				if (iter->second == relPath || iter->second.compare(0, prefix.size(), prefix) == 0) {
+					inotify_rm_watch(fd, iter->first);
+					iter = dirs.erase(iter);
+				} else {
+					++iter;
+				}
+			}
+		}
+	};
+}
+
+#elif defined(__APPLE__) && TARGET_OS_MAC && !TARGET_OS_IPHONE
+
+#include <CoreServices/CoreServices.h>
+#include <dispatch/dispatch.h>
+#include <climits>
+#include <cstdlib>
+#include <mutex>
+
+namespace Halley {
+	class DirectoryMonitorPimpl
+	{
+	public:
+		DirectoryMonitorPimpl(const Path& path)
+		{
+			// Events are reported with symlinks resolved, so the root has to be too
+			char resolved[PATH_MAX];
+			if (!realpath(path.string().c_str(), resolved)) {
+				throw Exception("Unable to monitor directory \"" + path.getString() + "\".", HalleyExceptions::Utils);
+			}
+			root = resolved;
+
+			CFStringRef cfPath = CFStringCreateWithCString(nullptr, root.c_str(), kCFStringEncodingUTF8);
+			CFArrayRef paths = CFArrayCreate(nullptr, reinterpret_cast<const void**>(&cfPath), 1, &kCFTypeArrayCallBacks);
+			FSEventStreamContext context = { 0, this, nullptr, nullptr, nullptr };
+			const auto flags = kFSEventStreamCreateFlagFileEvents | kFSEventStreamCreateFlagNoDefer | kFSEventStreamCreateFlagWatchRoot;
+			stream = FSEventStreamCreate(nullptr, &onEvents, &context, paths, kFSEventStreamEventIdSinceNow, 0.05, flags);
+			CFRelease(paths);
+			CFRelease(cfPath);
+
+			queue = dispatch_queue_create("halley.directory_monitor", DISPATCH_QUEUE_SERIAL);
+			FSEventStreamSetDispatchQueue(stream, queue);
+			FSEventStreamStart(stream);
+		}
+
+		~DirectoryMonitorPimpl()
+		{
+			FSEventStreamStop(stream);
+			FSEventStreamInvalidate(stream);
+			FSEventStreamRelease(stream);
+			dispatch_release(queue);
+		}
+
+		bool poll(std::set<String>& changed)
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			for (auto& p: pending) {
+				changed.insert(p);
+			}
+			pending.clear();
+			const bool complete = !lostEvents;
+			lostEvents = false;
+			return complete;
+		}
+
+		bool hasRealImplementation() const
+		{
+			return true;
+		}
+
+	private:
+		std::string root;
+		FSEventStreamRef stream;
+		dispatch_queue_t queue;
+
+		std::mutex mutex;
+		std::set<std::string> pending;
+		bool lostEvents = false;
+
+		static void onEvents(ConstFSEventStreamRef, void* info, size_t n, void* eventPaths, const FSEventStreamEventFlags flags[], const FSEventStreamEventId[])
+		{
+			auto& self = *static_cast<DirectoryMonitorPimpl*>(info);
+			auto paths = static_cast<const char**>(eventPaths);
+			const auto lostFlags = kFSEventStreamEventFlagMustScanSubDirs | kFSEventStreamEventFlagUserDropped | kFSEventStreamEventFlagKernelDropped | kFSEventStreamEventFlagRootChanged;
+			const std::string prefix = self.root + "/";
+
+			std::unique_lock<std::mutex> lock(self.mutex);
+			for (size_t i = 0; i < n; ++i) {
+				if (flags[i] & lostFlags) {
+					self.lostEvents = true;
+				} else if (strncmp(paths[i], prefix.c_str(), prefix.size()) == 0) {
+					self.pending.insert(paths[i] + prefix.size());
+				}
+			}
+		}
 	};
 }
 
@@ -60,7 +376,7 @@ namespace Halley {
 	{
 	public:
 		DirectoryMonitorPimpl(const Path&) {}
-		bool poll() { return true; };
+		bool poll(std::set<String>&) { return false; };
 		bool hasRealImplementation() const { return false; }
 	};
 }
@@ -75,7 +391,19 @@ DirectoryMonitor::~DirectoryMonitor() = default;
 
 bool DirectoryMonitor::poll()
 {
-	return pimpl->poll();
+	return pollChanges().any();
+}
+
+DirectoryMonitor::Changes DirectoryMonitor::pollChanges()
+{
+	std::set<String> changed;
+	Changes result;
+	result.fullRescan = !pimpl->poll(changed);
+	result.paths.reserve(changed.size());
+	for (auto& path: changed) {
+		result.paths.emplace_back(path);
+	}
+	return result;
 }
 
 bool DirectoryMonitor::hasRealImplementation() const
@@ -147,6 +147,11 @@ size_t Path::getNumberPaths() const
 	return pathParts.size();
 }
 
+const std::vector<String>& Path::getParts() const
+{
+	return pathParts;
+}
+
 Path Path::dropFront(int numberFolders) const
 {
 	return Path(std::vector<String>(pathParts.begin() + numberFolders, pathParts.end()));
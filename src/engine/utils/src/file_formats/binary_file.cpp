@@ -43,6 +43,11 @@ void BinaryFile::reload(Resource&& resource)
 	*this = std::move(dynamic_cast<BinaryFile&>(resource));
 }
 
+size_t BinaryFile::getMemoryUsage() const
+{
+	return data.size();
+}
+
 const Bytes& BinaryFile::getBytes() const
 {
 	Expects(!streaming);
@@ -1,4 +1,7 @@
 #include "halley/file_formats/config_file.h"
+#include "halley/file_formats/config_node_view.h"
+#include "halley/resources/resource_data.h"
+#include <cstring>
 #include "halley/bytes/byte_serializer.h"
 #include "halley/support/exception.h"
 #include "halley/core/resources/resource_collection.h"
@@ -43,7 +46,7 @@ ConfigNode::ConfigNode(const ConfigNode& other)
 	}
 }
 
-ConfigNode::ConfigNode(ConfigNode&& other)
+ConfigNode::ConfigNode(ConfigNode&& other) noexcept
 {
 	*this = std::move(other);
 }
@@ -103,7 +106,7 @@ ConfigNode::~ConfigNode()
 	reset();
 }
 
-ConfigNode& ConfigNode::operator=(ConfigNode&& other)
+ConfigNode& ConfigNode::operator=(ConfigNode&& other) noexcept
 {
 	reset();
 
@@ -717,34 +720,67 @@ ConfigFile::ConfigFile()
 
 ConfigFile::ConfigFile(ConfigFile&& other)
 {
-	root = std::move(other.root);
-	updateRoot();
+	*this = std::move(other);
+}
+
+ConfigFile::~ConfigFile()
+{
 }
 
 ConfigFile& ConfigFile::operator=(ConfigFile&& other)
 {
+	std::unique_lock<std::mutex> lock(other.decodeMutex);
 	root = std::move(other.root);
+	binaryData = std::move(other.binaryData);
+	rootDecoded = other.rootDecoded.load();
+	other.rootDecoded = true;
 	updateRoot();
 	return *this;
 }
 
 ConfigNode& ConfigFile::getRoot()
 {
+	decodeRoot();
 	return root;
 }
 
 const ConfigNode& ConfigFile::getRoot() const
 {
+	decodeRoot();
 	return root;
 }
 
-constexpr int curVersion = 2;
+ConfigNodeView ConfigFile::getRootView() const
+{
+	if (binaryData) {
+		return BinaryConfig::getRoot(binaryData->getSpan());
+	} else {
+		return ConfigNodeView(root);
+	}
+}
+
+bool ConfigFile::isBinary() const
+{
+	return binaryData != nullptr;
+}
+
+void ConfigFile::decodeRoot() const
+{
+	if (!rootDecoded.load(std::memory_order_acquire)) {
+		std::unique_lock<std::mutex> lock(decodeMutex);
+		if (!rootDecoded.load(std::memory_order_relaxed)) {
+			root = BinaryConfig::getRoot(binaryData->getSpan()).toConfigNode();
+			updateRoot();
+			rootDecoded.store(true, std::memory_order_release);
+		}
+	}
+}
 
 void ConfigFile::serialize(Serializer& s) const
 {
 	int version = curVersion;
 	s << version;
-	s << root;
+	s << getRoot();
 }
 
 void ConfigFile::deserialize(Deserializer& s)
@@ -754,6 +790,8 @@ void ConfigFile::deserialize(Deserializer& s)
 	s.setVersion(version);
 	s >> root;
 
+	binaryData.reset();
+	rootDecoded = true;
 	updateRoot();
 }
 
@@ -762,8 +800,22 @@ std::unique_ptr<ConfigFile> ConfigFile::loadResource(ResourceLoader& loader)
 	auto config = std::make_unique<ConfigFile>();
 
 	auto data = loader.getStatic();
-	Deserializer s(data->getSpan());
-	s >> *config;
+	if (BinaryConfig::isBinaryConfig(data->getSpan())) {
+		if (reinterpret_cast<uintptr_t>(data->getData()) % alignof(uint32_t) != 0) {
+			// Assets in packs aren't aligned, so this needs a copy to be read in place
+			auto copy = new char[data->getSize()];
+			memcpy(copy, data->getData(), data->getSize());
+			data = std::make_unique<ResourceDataStatic>(copy, data->getSize(), data->getPath());
+		}
+
+		// Validates the header now, rather than on first access
+		BinaryConfig::getRoot(data->getSpan());
+		config->binaryData = std::move(data);
+		config->rootDecoded = false;
+	} else {
+		Deserializer s(data->getSpan());
+		s >> *config;
+	}
 
 	return config;
 }
@@ -774,7 +826,12 @@ void ConfigFile::reload(Resource&& resource)
 	updateRoot();
 }
 
-void ConfigFile::updateRoot()
+size_t ConfigFile::getMemoryUsage() const
+{
+	return binaryData ? binaryData->getSize() : 0;
+}
+
+void ConfigFile::updateRoot() const
 {
 	root.propagateParentingInformation(this);
 	Ensures(root.parentIdx == 0);
@@ -793,16 +850,28 @@ ConfigObserver::ConfigObserver(const ConfigNode& node)
 
 ConfigObserver::ConfigObserver(const ConfigFile& file)
 	: file(&file)
-	, node(&file.getRoot())
 {
 }
 
 const ConfigNode& ConfigObserver::getRoot() const
 {
+	// Asked from the file every time, so that observing a binary file doesn't decode it unless needed
+	if (file) {
+		return file->getRoot();
+	}
 	Expects(node);
 	return *node;
 }
 
+ConfigNodeView ConfigObserver::getRootView() const
+{
+	if (file) {
+		return file->getRootView();
+	}
+	Expects(node);
+	return ConfigNodeView(*node);
+}
+
 bool ConfigObserver::needsUpdate() const
 {
 	return file && assetVersion != file->getAssetVersion();
@@ -812,7 +881,6 @@ void ConfigObserver::update()
 {
 	if (file) {
 		assetVersion = file->getAssetVersion();
-		node = &file->getRoot();
 	}
 }
 
@@ -0,0 +1,117 @@
+#include "halley/file_formats/config_node_builder.h"
+#include "halley/support/exception.h"
+
+using namespace Halley;
+
+void ConfigNodeBuilder::setPosition(int l, int c)
+{
+	line = l;
+	column = c;
+}
+
+void ConfigNodeBuilder::beginMap()
+{
+	beginContainer(ConfigNode(ConfigNode::MapType()));
+}
+
+void ConfigNodeBuilder::beginSequence()
+{
+	beginContainer(ConfigNode(ConfigNode::SequenceType()));
+}
+
+ConfigNode& ConfigNodeBuilder::end()
+{
+	if (stack.empty()) {
+		throw Exception("Unbalanced end of container when building ConfigNode.", HalleyExceptions::Resources);
+	}
+	Frame frame = std::move(stack.back());
+	stack.pop_back();
+
+	// The container keeps the position where it started
+	const int l = line;
+	const int c = column;
+	line = frame.line;
+	column = frame.column;
+	auto& node = addValue(std::move(frame.node));
+	line = l;
+	column = c;
+	return node;
+}
+
+void ConfigNodeBuilder::setKey(String key)
+{
+	if (!isInMap()) {
+		throw Exception("Key \"" + key + "\" found outside of a map.", HalleyExceptions::Resources);
+	}
+	auto& frame = stack.back();
+	frame.key = std::move(key);
+	frame.hasKey = true;
+}
+
+ConfigNode& ConfigNodeBuilder::addValue(ConfigNode value)
+{
+	value.setOriginalPosition(line, column);
+
+	if (stack.empty()) {
+		if (done) {
+			throw Exception("Multiple root values when building ConfigNode.", HalleyExceptions::Resources);
+		}
+		done = true;
+		result = std::move(value);
+		return result;
+	}
+
+	auto& frame = stack.back();
+	if (frame.node.getType() == ConfigNodeType::Map) {
+		if (!frame.hasKey) {
+			throw Exception("Value without a key inside a map.", HalleyExceptions::Resources);
+		}
+		frame.hasKey = false;
+		auto& entry = frame.node.asMap()[frame.key];
+		entry = std::move(value);
+		return entry;
+	} else {
+		auto& seq = frame.node.asSequence();
+		seq.push_back(std::move(value));
+		return seq.back();
+	}
+}
+
+bool ConfigNodeBuilder::isInMap() const
+{
+	return !stack.empty() && stack.back().node.getType() == ConfigNodeType::Map;
+}
+
+bool ConfigNodeBuilder::isExpectingKey() const
+{
+	return isInMap() && !stack.back().hasKey;
+}
+
+bool ConfigNodeBuilder::isDone() const
+{
+	return done && stack.empty();
+}
+
+ConfigNode ConfigNodeBuilder::takeResult()
+{
+	if (!isDone()) {
+		throw Exception("ConfigNode is incomplete.", HalleyExceptions::Resources);
+	}
+	done = false;
+	return std::move(result);
+}
+
+void ConfigNodeBuilder::beginContainer(ConfigNode node)
+{
+	if (isExpectingKey()) {
+		throw Exception("Map keys must be scalars.", HalleyExceptions::Resources);
+	}
+	if (stack.empty() && done) {
+		throw Exception("Multiple root values when building ConfigNode.", HalleyExceptions::Resources);
+	}
+	stack.emplace_back();
+	auto& frame = stack.back();
+	frame.node = std::move(node);
+	frame.line = line;
+	frame.column = column;
+}
@@ -0,0 +1,655 @@
+#include "halley/file_formats/config_node_view.h"
+#include "halley/text/string_id.h"
+#include <cstddef>
+#include <cstring>
+
+using namespace Halley;
+
+namespace Halley {
+	namespace BinaryConfigDetail {
+		// Layout of the data:
+		//   Header
+		//   Everything else, reached through offsets
+		//
+		// Payloads, by node type:
+		//   Int: a is the value
+		//   Float: a is the value's bits
+		//   Int2, Float2: a and b are x and y, as above
+		//   String: a is the offset of the characters, which are null terminated, and b is the length
+		//   Bytes: a is the offset of the data, and b is the length
+		//   Sequence: a is the offset of b consecutive Nodes
+		//   Map: a is the offset of a MapTable, and b is the number of entries
+		//
+		// A MapTable is made of:
+		//   uint32_t numSlots, a power of two
+		//   uint32_t slots[numSlots], each holding 1 + the index of an entry, or 0 if it's empty (linear probing)
+		//   MapEntry entries[count], sorted by key
+		//   Node values[count]
+		struct Node
+		{
+			uint8_t type;
+			uint8_t reserved[3];
+			int32_t line;
+			int32_t column;
+			uint32_t a;
+			uint32_t b;
+		};
+		static_assert(sizeof(Node) == 20, "Unexpected BinaryConfig node size");
+
+		struct MapEntry
+		{
+			uint32_t keyHash;
+			uint32_t keyOffset;
+			uint32_t keyLength;
+		};
+		static_assert(sizeof(MapEntry) == 12, "Unexpected BinaryConfig map entry size");
+
+		struct Header
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint32_t size;
+			Node root;
+		};
+
+		static uint32_t hashKey(const char* key, size_t length)
+		{
+			const uint64_t hash = hashStringLiteral(key, length);
+			return uint32_t(hash ^ (hash >> 32));
+		}
+
+		static uint32_t getNumSlots(size_t count)
+		{
+			uint32_t slots = 1;
+			while (slots < count * 2) {
+				slots *= 2;
+			}
+			return count == 0 ? 0 : slots;
+		}
+
+		class Writer
+		{
+		public:
+			Bytes write(const ConfigNode& root)
+			{
+				const uint32_t headerOffset = allocate(sizeof(Header));
+				Header header = {};
+				header.magic = BinaryConfig::magic;
+				header.version = BinaryConfig::curVersion;
+				header.root = Node();
+				put(headerOffset, header);
+
+				writeNode(headerOffset + uint32_t(offsetof(Header, root)), root);
+
+				header.size = uint32_t(data.size());
+				header.root = get<Node>(headerOffset + uint32_t(offsetof(Header, root)));
+				put(headerOffset, header);
+				return std::move(data);
+			}
+
+		private:
+			Bytes data;
+
+			uint32_t allocate(size_t size)
+			{
+				const size_t offset = (data.size() + 3) & ~size_t(3);
+				if (offset + size > std::numeric_limits<uint32_t>::max()) {
+					throw Exception("Config is too large to be stored as binary.", HalleyExceptions::Resources);
+				}
+				data.resize(offset + size, 0);
+				return uint32_t(offset);
+			}
+
+			uint32_t writeRaw(const void* src, size_t size, bool nullTerminate)
+			{
+				const uint32_t offset = allocate(size + (nullTerminate ? 1 : 0));
+				if (size > 0) {
+					memcpy(data.data() + offset, src, size);
+				}
+				return offset;
+			}
+
+			template <typename T>
+			void put(uint32_t offset, const T& value)
+			{
+				memcpy(data.data() + offset, &value, sizeof(T));
+			}
+
+			template <typename T>
+			T get(uint32_t offset) const
+			{
+				T value;
+				memcpy(&value, data.data() + offset, sizeof(T));
+				return value;
+			}
+
+			// Children are written before the node itself, as they can grow (and so move) the data
+			void writeNode(uint32_t offset, const ConfigNode& node)
+			{
+				Node result = {};
+				result.type = uint8_t(node.getType());
+				result.line = ConfigNodeView(node).getLine();
+				result.column = ConfigNodeView(node).getColumn();
+
+				switch (node.getType()) {
+					case ConfigNodeType::Int:
+						result.a = uint32_t(node.asInt());
+						break;
+					case ConfigNodeType::Float:
+						{
+							const float value = node.asFloat();
+							memcpy(&result.a, &value, sizeof(float));
+						}
+						break;
+					case ConfigNodeType::Int2:
+						{
+							const auto value = node.asVector2i();
+							result.a = uint32_t(value.x);
+							result.b = uint32_t(value.y);
+						}
+						break;
+					case ConfigNodeType::Float2:
+						{
+							const auto value = node.asVector2f();
+							memcpy(&result.a, &value.x, sizeof(float));
+							memcpy(&result.b, &value.y, sizeof(float));
+						}
+						break;
+					case ConfigNodeType::String:
+						{
+							const auto value = node.asString();
+							result.a = writeRaw(value.c_str(), value.size(), true);
+							result.b = uint32_t(value.size());
+						}
+						break;
+					case ConfigNodeType::Bytes:
+						{
+							const auto& value = node.asBytes();
+							result.a = writeRaw(value.data(), value.size(), false);
+							result.b = uint32_t(value.size());
+						}
+						break;
+					case ConfigNodeType::Sequence:
+						{
+							const auto& seq = node.asSequence();
+							result.a = allocate(seq.size() * sizeof(Node));
+							result.b = uint32_t(seq.size());
+							for (size_t i = 0; i < seq.size(); ++i) {
+								writeNode(result.a + uint32_t(i * sizeof(Node)), seq[i]);
+							}
+						}
+						break;
+					case ConfigNodeType::Map:
+						{
+							const auto& map = node.asMap();
+							const size_t count = map.size();
+							const uint32_t numSlots = getNumSlots(count);
+							result.a = allocate(sizeof(uint32_t) * (1 + numSlots) + count * (sizeof(MapEntry) + sizeof(Node)));
+							result.b = uint32_t(count);
+
+							const uint32_t slotsOffset = result.a + sizeof(uint32_t);
+							const uint32_t entriesOffset = slotsOffset + numSlots * sizeof(uint32_t);
+							const uint32_t valuesOffset = entriesOffset + uint32_t(count * sizeof(MapEntry));
+							put(result.a, numSlots);
+
+							uint32_t i = 0;
+							for (auto& kv: map) {
+								MapEntry entry;
+								entry.keyHash = hashKey(kv.first.c_str(), kv.first.size());
+								entry.keyOffset = writeRaw(kv.first.c_str(), kv.first.size(), true);
+								entry.keyLength = uint32_t(kv.first.size());
+								put(entriesOffset + i * uint32_t(sizeof(MapEntry)), entry);
+
+								for (uint32_t slot = entry.keyHash & (numSlots - 1); ; slot = (slot + 1) & (numSlots - 1)) {
+									const uint32_t slotOffset = slotsOffset + slot * uint32_t(sizeof(uint32_t));
+									if (get<uint32_t>(slotOffset) == 0) {
+										put(slotOffset, i + 1);
+										break;
+									}
+								}
+
+								writeNode(valuesOffset + i * uint32_t(sizeof(Node)), kv.second);
+								++i;
+							}
+						}
+						break;
+					case ConfigNodeType::Undefined:
+						break;
+					default:
+						throw Exception("Unknown configuration node type.", HalleyExceptions::Resources);
+				}
+
+				put(offset, result);
+			}
+		};
+	}
+}
+
+using namespace BinaryConfigDetail;
+
+ConfigNodeView::ConfigNodeView()
+{
+}
+
+ConfigNodeView::ConfigNodeView(const ConfigNode& node)
+	: node(&node)
+{
+}
+
+ConfigNodeView::ConfigNodeView(const Node* binaryNode, const gsl::byte* data, size_t dataSize)
+	: binaryNode(binaryNode)
+	, data(data)
+	, dataSize(dataSize)
+{
+}
+
+ConfigNodeType ConfigNodeView::getType() const
+{
+	if (binaryNode) {
+		return ConfigNodeType(binaryNode->type);
+	} else if (node) {
+		return node->getType();
+	} else {
+		return ConfigNodeType::Undefined;
+	}
+}
+
+bool ConfigNodeView::isBinary() const
+{
+	return binaryNode != nullptr;
+}
+
+int ConfigNodeView::asInt() const
+{
+	if (node) {
+		return node->asInt();
+	}
+
+	switch (getType()) {
+		case ConfigNodeType::Int:
+			return int(int32_t(binaryNode->a));
+		case ConfigNodeType::Float:
+			return int(asFloat());
+		case ConfigNodeType::String:
+			return String(asCString()).toInteger();
+		default:
+			throw Exception(getNodeDebugId() + " cannot be converted to int.", HalleyExceptions::Resources);
+	}
+}
+
+float ConfigNodeView::asFloat() const
+{
+	if (node) {
+		return node->asFloat();
+	}
+
+	switch (getType()) {
+		case ConfigNodeType::Int:
+			return float(int32_t(binaryNode->a));
+		case ConfigNodeType::Float:
+			{
+				float value;
+				memcpy(&value, &binaryNode->a, sizeof(float));
+				return value;
+			}
+		case ConfigNodeType::String:
+			return String(asCString()).toFloat();
+		default:
+			throw Exception(getNodeDebugId() + " cannot be converted to float.", HalleyExceptions::Resources);
+	}
+}
+
+bool ConfigNodeView::asBool() const
+{
+	if (node) {
+		return node->asBool();
+	}
+
+	if (getType() == ConfigNodeType::Int) {
+		return binaryNode->a != 0;
+	} else {
+		return asString() == "true";
+	}
+}
+
+Vector2i ConfigNodeView::asVector2i() const
+{
+	if (node) {
+		return node->asVector2i();
+	}
+
+	switch (getType()) {
+		case ConfigNodeType::Int2:
+			return Vector2i(int(int32_t(binaryNode->a)), int(int32_t(binaryNode->b)));
+		case ConfigNodeType::Float2:
+			return Vector2i(asVector2f());
+		case ConfigNodeType::Sequence:
+			if (size() < 2) {
+				throw Exception(getNodeDebugId() + " is too short to be a vector", HalleyExceptions::Resources);
+			}
+			return Vector2i((*this)[0].asInt(), (*this)[1].asInt());
+		default:
+			throw Exception(getNodeDebugId() + " is not a vector type", HalleyExceptions::Resources);
+	}
+}
+
+Vector2f ConfigNodeView::asVector2f() const
+{
+	if (node) {
+		return node->asVector2f();
+	}
+
+	switch (getType()) {
+		case ConfigNodeType::Int2:
+			return Vector2f(asVector2i());
+		case ConfigNodeType::Float2:
+			{
+				Vector2f value;
+				memcpy(&value.x, &binaryNode->a, sizeof(float));
+				memcpy(&value.y, &binaryNode->b, sizeof(float));
+				return value;
+			}
+		case ConfigNodeType::Sequence:
+			if (size() < 2) {
+				throw Exception(getNodeDebugId() + " is too short to be a vector", HalleyExceptions::Resources);
+			}
+			return Vector2f((*this)[0].asFloat(), (*this)[1].asFloat());
+		default:
+			throw Exception(getNodeDebugId() + " is not a vector type", HalleyExceptions::Resources);
+	}
+}
+
+String ConfigNodeView::asString() const
+{
+	if (node) {
+		return node->asString();
+	}
+
+	switch (getType()) {
+		case ConfigNodeType::String:
+			return String(asCString(), binaryNode->b);
+		case ConfigNodeType::Int:
+			return toString(asInt());
+		case ConfigNodeType::Float:
+			return toString(asFloat());
+		default:
+			throw Exception(getNodeDebugId() + " is not a string type", HalleyExceptions::Resources);
+	}
+}
+
+const char* ConfigNodeView::asCString() const
+{
+	if (getType() != ConfigNodeType::String) {
+		throw Exception(getNodeDebugId() + " is not a string type", HalleyExceptions::Resources);
+	}
+
+	if (binaryNode) {
+		return reinterpret_cast<const char*>(getBinaryRange(binaryNode->a, binaryNode->b + 1));
+	} else {
+		// Safe, as string nodes hold a String, and asString() only makes a copy of it
+		return reinterpret_cast<const String*>(node->ptrData)->c_str();
+	}
+}
+
+gsl::span<const gsl::byte> ConfigNodeView::asBytes() const
+{
+	if (node) {
+		return gsl::as_bytes(gsl::span<const Byte>(node->asBytes()));
+	}
+
+	if (getType() != ConfigNodeType::Bytes) {
+		throw Exception(getNodeDebugId() + " is not a byte sequence type", HalleyExceptions::Resources);
+	}
+	return gsl::span<const gsl::byte>(getBinaryRange(binaryNode->a, binaryNode->b), binaryNode->b);
+}
+
+int ConfigNodeView::asInt(int defaultValue) const
+{
+	return getType() == ConfigNodeType::Undefined ? defaultValue : asInt();
+}
+
+float ConfigNodeView::asFloat(float defaultValue) const
+{
+	return getType() == ConfigNodeType::Undefined ? defaultValue : asFloat();
+}
+
+bool ConfigNodeView::asBool(bool defaultValue) const
+{
+	return getType() == ConfigNodeType::Undefined ? defaultValue : asBool();
+}
+
+String ConfigNodeView::asString(const String& defaultValue) const
+{
+	return getType() == ConfigNodeType::Undefined ? defaultValue : asString();
+}
+
+Vector2i ConfigNodeView::asVector2i(Vector2i defaultValue) const
+{
+	return getType() == ConfigNodeType::Undefined ? defaultValue : asVector2i();
+}
+
+Vector2f ConfigNodeView::asVector2f(Vector2f defaultValue) const
+{
+	return getType() == ConfigNodeType::Undefined ? defaultValue : asVector2f();
+}
+
+size_t ConfigNodeView::size() const
+{
+	switch (getType()) {
+		case ConfigNodeType::Sequence:
+			return binaryNode ? binaryNode->b : node->asSequence().size();
+		case ConfigNodeType::Map:
+			return binaryNode ? binaryNode->b : node->asMap().size();
+		default:
+			throw Exception(getNodeDebugId() + " is not a sequence or map type", HalleyExceptions::Resources);
+	}
+}
+
+bool ConfigNodeView::hasKey(const String& key) const
+{
+	return getType() == ConfigNodeType::Map && findKey(key.c_str(), key.size()).getType() != ConfigNodeType::Undefined;
+}
+
+ConfigNodeView ConfigNodeView::operator[](const String& key) const
+{
+	return findKey(key.c_str(), key.size());
+}
+
+ConfigNodeView ConfigNodeView::operator[](size_t idx) const
+{
+	if (getType() != ConfigNodeType::Sequence) {
+		throw Exception(getNodeDebugId() + " is not a sequence type", HalleyExceptions::Resources);
+	}
+	if (idx >= size()) {
+		throw Exception("Index " + toString(idx) + " is out of range in " + getNodeDebugId(), HalleyExceptions::Resources);
+	}
+
+	if (binaryNode) {
+		return getBinaryChild(binaryNode->a + uint32_t(idx * sizeof(Node)));
+	} else {
+		return ConfigNodeView(node->asSequence()[idx]);
+	}
+}
+
+ConfigNodeView ConfigNodeView::findKey(const char* key, size_t length) const
+{
+	if (getType() != ConfigNodeType::Map) {
+		throw Exception(getNodeDebugId() + " is not a map type", HalleyExceptions::Resources);
+	}
+
+	if (!binaryNode) {
+		auto& map = node->asMap();
+		const auto iter = map.find(String(key, length));
+		return iter != map.end() ? ConfigNodeView(iter->second) : ConfigNodeView();
+	}
+
+	const uint32_t count = binaryNode->b;
+	if (count == 0) {
+		return ConfigNodeView();
+	}
+
+	const auto* table = getBinaryRange(binaryNode->a, sizeof(uint32_t));
+	uint32_t numSlots;
+	memcpy(&numSlots, table, sizeof(uint32_t));
+	const auto* slots = getBinaryRange(binaryNode->a + uint32_t(sizeof(uint32_t)), numSlots * sizeof(uint32_t));
+	const uint32_t entriesOffset = binaryNode->a + uint32_t(sizeof(uint32_t) * (1 + numSlots));
+	const uint32_t hash = hashKey(key, length);
+
+	for (uint32_t i = 0, slot = hash & (numSlots - 1); i < numSlots; ++i, slot = (slot + 1) & (numSlots - 1)) {
+		uint32_t entryIdx;
+		memcpy(&entryIdx, slots + slot * sizeof(uint32_t), sizeof(uint32_t));
+		if (entryIdx == 0 || entryIdx > count) {
+			break;
+		}
+
+		MapEntry entry;
+		memcpy(&entry, getBinaryRange(entriesOffset + (entryIdx - 1) * uint32_t(sizeof(MapEntry)), sizeof(MapEntry)), sizeof(MapEntry));
+		if (entry.keyHash == hash && entry.keyLength == length && memcmp(getBinaryRange(entry.keyOffset, length), key, length) == 0) {
+			return getBinaryMapValue(entryIdx - 1);
+		}
+	}
+	return ConfigNodeView();
+}
+
+const char* ConfigNodeView::getBinaryMapKey(size_t idx) const
+{
+	uint32_t numSlots;
+	memcpy(&numSlots, getBinaryRange(binaryNode->a, sizeof(uint32_t)), sizeof(uint32_t));
+	const uint32_t entriesOffset = binaryNode->a + uint32_t(sizeof(uint32_t) * (1 + numSlots));
+
+	MapEntry entry;
+	memcpy(&entry, getBinaryRange(entriesOffset + uint32_t(idx * sizeof(MapEntry)), sizeof(MapEntry)), sizeof(MapEntry));
+	return reinterpret_cast<const char*>(getBinaryRange(entry.keyOffset, entry.keyLength + 1));
+}
+
+ConfigNodeView ConfigNodeView::getBinaryMapValue(size_t idx) const
+{
+	uint32_t numSlots;
+	memcpy(&numSlots, getBinaryRange(binaryNode->a, sizeof(uint32_t)), sizeof(uint32_t));
+	const uint32_t valuesOffset = binaryNode->a + uint32_t(sizeof(uint32_t) * (1 + numSlots) + binaryNode->b * sizeof(MapEntry));
+	return getBinaryChild(valuesOffset + uint32_t(idx * sizeof(Node)));
+}
+
+ConfigNodeView ConfigNodeView::getBinaryChild(uint32_t offset) const
+{
+	return ConfigNodeView(reinterpret_cast<const Node*>(getBinaryRange(offset, sizeof(Node))), data, dataSize);
+}
+
+const gsl::byte* ConfigNodeView::getBinaryRange(uint32_t offset, size_t length) const
+{
+	if (size_t(offset) + length > dataSize) {
+		throw Exception("Binary config data is corrupted.", HalleyExceptions::Resources);
+	}
+	return data + offset;
+}
+
+ConfigNode ConfigNodeView::toConfigNode() const
+{
+	if (!binaryNode) {
+		return node ? ConfigNode(*node) : ConfigNode();
+	}
+
+	ConfigNode result;
+	switch (getType()) {
+		case ConfigNodeType::Int:
+			result = asInt();
+			break;
+		case ConfigNodeType::Float:
+			result = asFloat();
+			break;
+		case ConfigNodeType::Int2:
+			result = asVector2i();
+			break;
+		case ConfigNodeType::Float2:
+			result = asVector2f();
+			break;
+		case ConfigNodeType::String:
+			result = String(asCString(), binaryNode->b);
+			break;
+		case ConfigNodeType::Bytes:
+			{
+				const auto bytes = asBytes();
+				result = Bytes(reinterpret_cast<const Byte*>(bytes.data()), reinterpret_cast<const Byte*>(bytes.data()) + bytes.size());
+			}
+			break;
+		case ConfigNodeType::Sequence:
+			{
+				ConfigNode::SequenceType seq;
+				const size_t n = size();
+				seq.reserve(n);
+				for (size_t i = 0; i < n; ++i) {
+					seq.push_back((*this)[i].toConfigNode());
+				}
+				result = std::move(seq);
+			}
+			break;
+		case ConfigNodeType::Map:
+			{
+				// Entries are stored sorted, so they can all go at the end
+				ConfigNode::MapType map;
+				forEachEntry([&] (const char* key, const ConfigNodeView& value)
+				{
+					map.emplace_hint(map.end(), String(key), value.toConfigNode());
+				});
+				result = std::move(map);
+			}
+			break;
+		case ConfigNodeType::Undefined:
+			break;
+		default:
+			throw Exception("Unknown configuration node type.", HalleyExceptions::Resources);
+	}
+
+	result.setOriginalPosition(getLine(), getColumn());
+	return result;
+}
+
+int ConfigNodeView::getLine() const
+{
+	return binaryNode ? binaryNode->line : (node ? node->line : 0);
+}
+
+int ConfigNodeView::getColumn() const
+{
+	return binaryNode ? binaryNode->column : (node ? node->column : 0);
+}
+
+String ConfigNodeView::getNodeDebugId() const
+{
+	return "Node (" + toString(getType()) + ") at (" + toString(getLine() + 1) + ":" + toString(getColumn() + 1) + ")";
+}
+
+Bytes BinaryConfig::write(const ConfigNode& root)
+{
+	return Writer().write(root);
+}
+
+bool BinaryConfig::isBinaryConfig(gsl::span<const gsl::byte> data)
+{
+	uint32_t value;
+	if (size_t(data.size()) < sizeof(Header)) {
+		return false;
+	}
+	memcpy(&value, data.data(), sizeof(uint32_t));
+	return value == magic;
+}
+
+ConfigNodeView BinaryConfig::getRoot(gsl::span<const gsl::byte> data)
+{
+	if (!isBinaryConfig(data)) {
+		throw Exception("Data is not a binary config.", HalleyExceptions::Resources);
+	}
+	if (reinterpret_cast<uintptr_t>(data.data()) % alignof(uint32_t) != 0) {
+		throw Exception("Binary config data must be 4 byte aligned.", HalleyExceptions::Resources);
+	}
+
+	const auto* header = reinterpret_cast<const Header*>(data.data());
+	if (header->version != curVersion) {
+		throw Exception("Unsupported binary config version: " + toString(header->version), HalleyExceptions::Resources);
+	}
+	if (header->size > size_t(data.size())) {
+		throw Exception("Binary config data is truncated.", HalleyExceptions::Resources);
+	}
+
+	return ConfigNodeView(&header->root, data.data(), header->size);
+}
@@ -28,9 +28,278 @@
 #include "halley/text/string_converter.h"
 #include "halley/bytes/byte_serializer.h"
 #include "halley/support/logger.h"
+#include "halley/concurrency/concurrent.h"
+#include "halley/bytes/compression.h"
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define IMAGE_SSE
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define IMAGE_NEON
+#include <arm_neon.h>
+#endif
 
 using namespace Halley;
 
+namespace {
+	// Four 32-bit pixels at a time. The kernels below are written once against these, for each instruction set.
+#if defined(IMAGE_SSE)
+	struct SIMD {
+		using Int = __m128i;
+		using Float = __m128;
+
+		static Int load(const uint32_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+		static void store(uint32_t* p, Int v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+		static Int splat(uint32_t v) { return _mm_set1_epi32(int(v)); }
+		static Int loadBytes(const uint8_t* p) // Zero-extends 4 bytes
+		{
+			int32_t v;
+			memcpy(&v, p, 4);
+			const __m128i zero = _mm_setzero_si128();
+			return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(v), zero), zero);
+		}
+
+		static Int bitAnd(Int a, Int b) { return _mm_and_si128(a, b); }
+		static Int bitOr(Int a, Int b) { return _mm_or_si128(a, b); }
+		template <int n> static Int shiftLeft(Int a) { return _mm_slli_epi32(a, n); }
+		template <int n> static Int shiftRight(Int a) { return _mm_srli_epi32(a, n); }
+		static Int max8(Int a, Int b) { return _mm_max_epi16(a, b); } // Only for values that fit in 8 bits
+		static Int isZero(Int a) { return _mm_cmpeq_epi32(a, _mm_setzero_si128()); }
+		static bool anyNonZero(Int a) { return _mm_movemask_epi8(isZero(a)) != 0xFFFF; }
+		static Int select(Int mask, Int a, Int b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+
+		static void transpose(Int& a, Int& b, Int& c, Int& d)
+		{
+			__m128 fa = _mm_castsi128_ps(a);
+			__m128 fb = _mm_castsi128_ps(b);
+			__m128 fc = _mm_castsi128_ps(c);
+			__m128 fd = _mm_castsi128_ps(d);
+			_MM_TRANSPOSE4_PS(fa, fb, fc, fd);
+			a = _mm_castps_si128(fa);
+			b = _mm_castps_si128(fb);
+			c = _mm_castps_si128(fc);
+			d = _mm_castps_si128(fd);
+		}
+
+		static Float toFloat(Int a) { return _mm_cvtepi32_ps(a); }
+		static Int truncate(Float a) { return _mm_cvttps_epi32(a); }
+		static Float splatFloat(float v) { return _mm_set1_ps(v); }
+		static Float add(Float a, Float b) { return _mm_add_ps(a, b); }
+		static Float sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+		static Float mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+		static Float div(Float a, Float b) { return _mm_div_ps(a, b); }
+	};
+#elif defined(IMAGE_NEON)
+	struct SIMD {
+		using Int = uint32x4_t;
+		using Float = float32x4_t;
+
+		static Int load(const uint32_t* p) { return vld1q_u32(p); }
+		static void store(uint32_t* p, Int v) { vst1q_u32(p, v); }
+		static Int splat(uint32_t v) { return vdupq_n_u32(v); }
+		static Int loadBytes(const uint8_t* p) // Zero-extends 4 bytes
+		{
+			uint32_t v;
+			memcpy(&v, p, 4);
+			return vmovl_u16(vget_low_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(v)))));
+		}
+
+		static Int bitAnd(Int a, Int b) { return vandq_u32(a, b); }
+		static Int bitOr(Int a, Int b) { return vorrq_u32(a, b); }
+		template <int n> static Int shiftLeft(Int a) { return vshlq_n_u32(a, n); }
+		template <int n> static Int shiftRight(Int a) { return vshrq_n_u32(a, n); }
+		static Int max8(Int a, Int b) { return vmaxq_u32(a, b); }
+		static Int isZero(Int a) { return vceqq_u32(a, vdupq_n_u32(0)); }
+		static bool anyNonZero(Int a) { return vmaxvq_u32(a) != 0; }
+		static Int select(Int mask, Int a, Int b) { return vbslq_u32(mask, a, b); }
+
+		static void transpose(Int& a, Int& b, Int& c, Int& d)
+		{
+			const uint32x4x2_t ab = vtrnq_u32(a, b);
+			const uint32x4x2_t cd = vtrnq_u32(c, d);
+			a = vcombine_u32(vget_low_u32(ab.val[0]), vget_low_u32(cd.val[0]));
+			b = vcombine_u32(vget_low_u32(ab.val[1]), vget_low_u32(cd.val[1]));
+			c = vcombine_u32(vget_high_u32(ab.val[0]), vget_high_u32(cd.val[0]));
+			d = vcombine_u32(vget_high_u32(ab.val[1]), vget_high_u32(cd.val[1]));
+		}
+
+		static Float toFloat(Int a) { return vcvtq_f32_u32(a); }
+		static Int truncate(Float a) { return vcvtq_u32_f32(a); }
+		static Float splatFloat(float v) { return vdupq_n_f32(v); }
+		static Float add(Float a, Float b) { return vaddq_f32(a, b); }
+		static Float sub(Float a, Float b) { return vsubq_f32(a, b); }
+		static Float mul(Float a, Float b) { return vmulq_f32(a, b); }
+		static Float div(Float a, Float b) { return vdivq_f32(a, b); }
+	};
+#endif
+
+	// Below this many pixels, it's not worth waking up other threads
+	constexpr size_t parallelPixelThreshold = 256 * 256;
+
+	// lodepng's own inflate and deflate are much slower than zlib's, so it's given these instead. Errors can't be
+	// thrown through it, so they're returned as lodepng's out of memory error code.
+	constexpr unsigned pngZlibError = 83;
+
+	// If the context is set, it's the exact size of the inflated data, which lodepng has already reserved in out
+	unsigned pngInflate(unsigned char** out, size_t* outSize, const unsigned char* in, size_t inSize, const LodePNGDecompressSettings* settings)
+	{
+		try {
+			const auto src = gsl::as_bytes(gsl::span<const unsigned char>(in, inSize));
+			const auto expectedSize = static_cast<const size_t*>(settings->custom_context);
+			if (expectedSize) {
+				*out = static_cast<unsigned char*>(realloc(*out, *expectedSize));
+				if (!*out) {
+					return pngZlibError;
+				}
+				Compression::decompressRawInto(src, gsl::as_writeable_bytes(gsl::span<unsigned char>(*out, *expectedSize)));
+				*outSize = *expectedSize;
+			} else {
+				const auto result = Compression::decompressRaw(src, std::numeric_limits<size_t>::max());
+				*out = static_cast<unsigned char*>(realloc(*out, result.size()));
+				if (!*out) {
+					return pngZlibError;
+				}
+				memcpy(*out, result.data(), result.size());
+				*outSize = result.size();
+			}
+			return 0;
+		} catch (...) {
+			return pngZlibError;
+		}
+	}
+
+	unsigned pngDeflate(unsigned char** out, size_t* outSize, const unsigned char* in, size_t inSize, const LodePNGCompressSettings* settings)
+	{
+		try {
+			const auto result = Compression::compressRawParallel(gsl::as_bytes(gsl::span<const unsigned char>(in, inSize)));
+			*out = static_cast<unsigned char*>(realloc(*out, result.size()));
+			if (!*out) {
+				return pngZlibError;
+			}
+			memcpy(*out, result.data(), result.size());
+			*outSize = result.size();
+			return 0;
+		} catch (...) {
+			return pngZlibError;
+		}
+	}
+
+	template <typename F>
+	void forEachRow(size_t nRows, size_t rowLength, F f)
+	{
+		if (nRows * rowLength >= parallelPixelThreshold) {
+			const size_t grain = std::max(size_t(1), size_t(16384) / std::max(rowLength, size_t(1)));
+			Concurrent::parallelFor(Range<size_t>(0, nRows), grain, [&] (size_t start, size_t end) {
+				for (size_t y = start; y < end; ++y) {
+					f(y);
+				}
+			});
+		} else {
+			for (size_t y = 0; y < nRows; ++y) {
+				f(y);
+			}
+		}
+	}
+
+	void fillRow(uint32_t* dst, size_t n, uint32_t value)
+	{
+		size_t i = 0;
+#if defined(IMAGE_SSE) || defined(IMAGE_NEON)
+		const auto v = SIMD::splat(value);
+		for (; i + 4 <= n; i += 4) {
+			SIMD::store(dst + i, v);
+		}
+#endif
+		for (; i < n; ++i) {
+			dst[i] = value;
+		}
+	}
+
+	// Expands alpha-only pixels to white with that alpha
+	void expandAlphaRow(uint32_t* dst, const uint8_t* src, size_t n)
+	{
+		size_t i = 0;
+#if defined(IMAGE_SSE) || defined(IMAGE_NEON)
+		const auto white = SIMD::splat(0x00FFFFFF);
+		for (; i + 4 <= n; i += 4) {
+			SIMD::store(dst + i, SIMD::bitOr(white, SIMD::shiftLeft<24>(SIMD::loadBytes(src + i))));
+		}
+#endif
+		for (; i < n; ++i) {
+			dst[i] = 0x00FFFFFFu | (uint32_t(src[i]) << 24);
+		}
+	}
+
+	// Finds the first and last pixels with non-zero alpha, returning false if there are none
+	bool findOpaqueRange(const uint32_t* row, size_t n, size_t& first, size_t& last)
+	{
+		size_t i = 0;
+#if defined(IMAGE_SSE) || defined(IMAGE_NEON)
+		const auto alphaMask = SIMD::splat(0xFF000000);
+		while (i + 4 <= n && !SIMD::anyNonZero(SIMD::bitAnd(SIMD::load(row + i), alphaMask))) {
+			i += 4;
+		}
+#endif
+		while (i < n && (row[i] >> 24) == 0) {
+			++i;
+		}
+		if (i == n) {
+			return false;
+		}
+		first = i;
+
+		// There's at least one opaque pixel, so this stops at or after first
+		size_t j = n;
+#if defined(IMAGE_SSE) || defined(IMAGE_NEON)
+		while (j >= first + 4 && !SIMD::anyNonZero(SIMD::bitAnd(SIMD::load(row + j - 4), alphaMask))) {
+			j -= 4;
+		}
+#endif
+		while ((row[j - 1] >> 24) == 0) {
+			--j;
+		}
+		last = j - 1;
+		return true;
+	}
+
+	// dst[x + y * dstStride] = srcLastRow[y - x * srcStride] for x < n and y < m, i.e. the source turned clockwise
+	void rotateBlock(uint32_t* dst, size_t dstStride, const uint32_t* srcLastRow, size_t srcStride, size_t n, size_t m)
+	{
+		const ptrdiff_t ss = ptrdiff_t(srcStride);
+		size_t y = 0;
+#if defined(IMAGE_SSE) || defined(IMAGE_NEON)
+		for (; y + 4 <= m; y += 4) {
+			size_t x = 0;
+			for (; x + 4 <= n; x += 4) {
+				// Four source rows, which become four columns of the destination
+				const uint32_t* s = srcLastRow + ptrdiff_t(y) - ptrdiff_t(x) * ss;
+				auto a = SIMD::load(s);
+				auto b = SIMD::load(s - ss);
+				auto c = SIMD::load(s - 2 * ss);
+				auto d = SIMD::load(s - 3 * ss);
+				SIMD::transpose(a, b, c, d);
+				SIMD::store(dst + x + y * dstStride, a);
+				SIMD::store(dst + x + (y + 1) * dstStride, b);
+				SIMD::store(dst + x + (y + 2) * dstStride, c);
+				SIMD::store(dst + x + (y + 3) * dstStride, d);
+			}
+			for (; x < n; ++x) {
+				for (size_t k = 0; k < 4; ++k) {
+					dst[x + (y + k) * dstStride] = srcLastRow[ptrdiff_t(y + k) - ptrdiff_t(x) * ss];
+				}
+			}
+		}
+#endif
+		for (; y < m; ++y) {
+			for (size_t x = 0; x < n; ++x) {
+				dst[x + y * dstStride] = srcLastRow[ptrdiff_t(y) - ptrdiff_t(x) * ss];
+			}
+		}
+	}
+}
+
+
 Image::Image(Format format, Vector2i size)
 	: px(nullptr, [](char*){})
 	, dataLen(0)
@@ -86,6 +355,11 @@ size_t Image::getByteSize() const
 	return dataLen;
 }
 
+size_t Image::getMemoryUsage() const
+{
+	return dataLen;
+}
+
 unsigned int Image::convertRGBAToInt(unsigned int r, unsigned int g, unsigned int b, unsigned int a)
 {
 	return (a << 24) | (b << 16) | (g << 8) | r;
@@ -131,31 +405,44 @@ Image::Format Image::getFormat() const
 
 Rect4i Image::getTrimRect() const
 {
-	int x0 = w;
-	int x1 = 0;
-	int y0 = h;
-	int y1 = 0;
-
-	const unsigned int* src = reinterpret_cast<const unsigned int*>(px.get());
-	for (int y = 0; y < int(h); y++) {
-		for (int x = 0; x < int(w); x++) {
-			unsigned int px = src[x + y * w];
-			int alpha = int(px >> 24);
-
-			if (alpha > 0) {
-				x0 = std::min(x0, x);
-				y0 = std::min(y0, y);
-				x1 = std::max(x1, x);
-				y1 = std::max(y1, y);
+	struct Bounds {
+		int x0;
+		int y0;
+		int x1;
+		int y1;
+	};
+
+	const uint32_t* src = reinterpret_cast<const uint32_t*>(px.get());
+	const Bounds empty = { int(w), int(h), -1, -1 };
+	auto findBounds = [&] (Bounds& bounds, size_t start, size_t end)
+	{
+		for (size_t y = start; y < end; y++) {
+			size_t first;
+			size_t last;
+			if (findOpaqueRange(src + y * w, w, first, last)) {
+				bounds.x0 = std::min(bounds.x0, int(first));
+				bounds.x1 = std::max(bounds.x1, int(last));
+				bounds.y0 = std::min(bounds.y0, int(y));
+				bounds.y1 = std::max(bounds.y1, int(y));
 			}
 		}
+	};
+
+	Bounds bounds = empty;
+	if (size_t(w) * h >= parallelPixelThreshold) {
+		bounds = Concurrent::parallelReduce(Range<size_t>(0, h), std::max(size_t(1), size_t(16384) / w), empty, findBounds, [] (Bounds a, Bounds b)
+		{
+			return Bounds{ std::min(a.x0, b.x0), std::min(a.y0, b.y0), std::max(a.x1, b.x1), std::max(a.y1, b.y1) };
+		});
+	} else {
+		findBounds(bounds, 0, h);
 	}
 
-	if (x0 > x1 || y0 > y1) {
+	if (bounds.x0 > bounds.x1 || bounds.y0 > bounds.y1) {
 		return Rect4i();
 	}
 
-	return Rect4i(Vector2i(x0, y0), Vector2i(x1 + 1, y1 + 1));
+	return Rect4i(Vector2i(bounds.x0, bounds.y0), Vector2i(bounds.x1 + 1, bounds.y1 + 1));
 }
 
 Rect4i Image::getRect() const
@@ -165,12 +452,11 @@ Rect4i Image::getRect() const
 
 void Image::clear(int colour)
 {
-	int* dst = reinterpret_cast<int*>(px.get());
-	for (unsigned int y = 0; y < h; y++) {
-		for (unsigned int x = 0; x < w; x++) {
-			*dst++ = colour;
-		}
-	}
+	uint32_t* dst = reinterpret_cast<uint32_t*>(px.get());
+	forEachRow(h, w, [&] (size_t y)
+	{
+		fillRow(dst + y * w, w, uint32_t(colour));
+	});
 }
 
 void Image::blitFrom(Vector2i pos, const char* buffer, size_t width, size_t height, size_t pitch, size_t bpp)
@@ -192,19 +478,19 @@ void Image::blitFrom(Vector2i pos, const char* buffer, size_t width, size_t heig
 			}
 		}
 	} else if (bpp == 8) {
-		const char* src = reinterpret_cast<const char*>(buffer);
-		for (size_t y = yMin; y < yMax; y++) {
-			for (size_t x = xMin; x < xMax; x++) {
-				dst[x + y * w] = convertRGBAToInt(255, 255, 255, src[x + y * pitch]);
-			}
-		}
+		const uint8_t* src = reinterpret_cast<const uint8_t*>(buffer);
+		forEachRow(yMax - yMin, xMax - xMin, [&] (size_t i)
+		{
+			const size_t y = yMin + i;
+			expandAlphaRow(reinterpret_cast<uint32_t*>(dst + xMin + y * w), src + xMin + y * pitch, xMax - xMin);
+		});
 	} else if (bpp == 32) {
 		const int* src = reinterpret_cast<const int*>(buffer);
-		for (size_t y = yMin; y < yMax; y++) {
-			for (size_t x = xMin; x < xMax; x++) {
-				dst[x + y * w] = src[x + y * pitch];
-			}
-		}
+		forEachRow(yMax - yMin, xMax - xMin, [&] (size_t i)
+		{
+			const size_t y = yMin + i;
+			memcpy(dst + xMin + y * w, src + xMin + y * pitch, (xMax - xMin) * sizeof(int));
+		});
 	} else {
 		throw Exception("Unknown amount of bits per pixel: " + toString(bpp), HalleyExceptions::Utils);
 	}
@@ -218,21 +504,23 @@ void Image::blitFromRotated(Vector2i pos, const char* buffer, size_t width, size
 	Rect4i srcRect = Rect4i(pos, int(height), int(width)); // Rotated
 	Rect4i intersection = dstRect.intersection(srcRect);
 
-	auto xMin = intersection.getLeft();
-	auto yMin = intersection.getTop();
-	auto xMax = intersection.getRight();
-	auto yMax = intersection.getBottom();
-	int* dst = reinterpret_cast<int*>(px.get());
+	const size_t xMin = intersection.getLeft();
+	const size_t yMin = intersection.getTop();
+	const size_t xMax = std::max(intersection.getRight(), intersection.getLeft());
+	const size_t yMax = std::max(intersection.getBottom(), intersection.getTop());
+	uint32_t* dst = reinterpret_cast<uint32_t*>(px.get()) + xMin + yMin * w;
 
 	if (bpp == 32) {
-		const int* src = reinterpret_cast<const int*>(buffer);
-		for (auto y = yMin; y < yMax; y++) {
-			for (auto x = xMin; x < xMax; x++) {
-				auto srcX = y - yMin;
-				auto srcY = height - (x - xMin) - 1;
-				dst[x + y * w] = src[srcX + srcY * pitch];
-			}
-		}
+		// Pixel (x, y) in the destination comes from (y, height - 1 - x) in the source, relative to their corners
+		const uint32_t* srcLastRow = reinterpret_cast<const uint32_t*>(buffer) + (height - 1) * pitch;
+		const size_t blockRows = 4;
+		const size_t nBlocks = (yMax - yMin + blockRows - 1) / blockRows;
+		forEachRow(nBlocks, (xMax - xMin) * blockRows, [&] (size_t block)
+		{
+			const size_t y = block * blockRows;
+			const size_t rows = std::min(blockRows, yMax - yMin - y);
+			rotateBlock(dst + y * w, w, srcLastRow + y, pitch, xMax - xMin, rows);
+		});
 	} else {
 		throw Exception("Unknown amount of bits per pixel: " + toString(bpp), HalleyExceptions::Utils);
 	}
@@ -316,36 +604,101 @@ inline constexpr static uint32_t lightenBlend(uint32_t src, uint32_t dst, uint32
 	}
 }
 
-template<typename F>
-void blendImages(F f, const Image& src, Image& dst, Vector2i pos, uint8_t opacity)
-{
-	if (dst.getFormat() != Image::Format::RGBA || src.getFormat() != Image::Format::RGBA) {
-		throw Exception("Both images must be RGBA for drawing with alpha", HalleyExceptions::Utils);
+namespace {
+	enum class BlendMode {
+		Alpha,
+		Lighten
+	};
+
+#if defined(IMAGE_SSE) || defined(IMAGE_NEON)
+	// Same as alphaBlend and lightenBlend, for four pixels. Every product here is an integer below 2^24, so it's exact
+	// as a float, and truncating the correctly rounded quotient gives the same result as the integer division.
+	template <BlendMode mode>
+	SIMD::Int blend4(SIMD::Int src, SIMD::Int dst, SIMD::Float opacity)
+	{
+		using S = SIMD;
+		const auto byteMask = S::splat(0xFF);
+		const auto f255 = S::splatFloat(255.0f);
+
+		const auto sr = S::toFloat(S::bitAnd(src, byteMask));
+		const auto sg = S::toFloat(S::bitAnd(S::shiftRight<8>(src), byteMask));
+		const auto sb = S::toFloat(S::bitAnd(S::shiftRight<16>(src), byteMask));
+		const auto sa = S::toFloat(S::shiftRight<24>(src));
+		const auto drInt = S::bitAnd(dst, byteMask);
+		const auto dgInt = S::bitAnd(S::shiftRight<8>(dst), byteMask);
+		const auto dbInt = S::bitAnd(S::shiftRight<16>(dst), byteMask);
+		const auto da = S::toFloat(S::shiftRight<24>(dst));
+
+		const auto srcAlphaInt = S::truncate(S::div(S::mul(sa, opacity), f255));
+		const auto srcAlpha = S::toFloat(srcAlphaInt);
+		const auto oneMinusSrcAlpha = S::sub(f255, srcAlpha);
+		const auto dstAlpha = S::toFloat(S::truncate(S::div(S::mul(oneMinusSrcAlpha, da), f255)));
+		const auto a = S::add(srcAlpha, S::toFloat(S::truncate(S::div(S::mul(dstAlpha, oneMinusSrcAlpha), f255))));
+
+		S::Int r;
+		S::Int g;
+		S::Int b;
+		if (mode == BlendMode::Alpha) {
+			// Lanes where this divides by zero have no source alpha, and are discarded below
+			const auto totalAlpha = S::add(srcAlpha, dstAlpha);
+			r = S::truncate(S::div(S::add(S::mul(sr, srcAlpha), S::mul(S::toFloat(drInt), dstAlpha)), totalAlpha));
+			g = S::truncate(S::div(S::add(S::mul(sg, srcAlpha), S::mul(S::toFloat(dgInt), dstAlpha)), totalAlpha));
+			b = S::truncate(S::div(S::add(S::mul(sb, srcAlpha), S::mul(S::toFloat(dbInt), dstAlpha)), totalAlpha));
+		} else {
+			r = S::max8(S::truncate(S::div(S::mul(sr, srcAlpha), f255)), drInt);
+			g = S::max8(S::truncate(S::div(S::mul(sg, srcAlpha), f255)), dgInt);
+			b = S::max8(S::truncate(S::div(S::mul(sb, srcAlpha), f255)), dbInt);
+		}
+
+		const auto result = S::bitOr(S::bitOr(r, S::shiftLeft<8>(g)), S::bitOr(S::shiftLeft<16>(b), S::shiftLeft<24>(S::truncate(a))));
+		return S::select(S::isZero(srcAlphaInt), dst, result);
 	}
-	uint32_t opacity32 = opacity;
-
-	const Rect4i srcRect = src.getRect().intersection(dst.getRect() - pos);
-	const Rect4i dstRect = dst.getRect().intersection(src.getRect() + pos);
-
-	const size_t rectW = srcRect.getWidth();
-	const size_t rectH = srcRect.getHeight();
-	for (size_t i = 0; i < rectH; ++i) {
-		const uint32_t* srcData = reinterpret_cast<const uint32_t*>(src.getPixels()) + ((i + srcRect.getTop()) * src.getWidth() + srcRect.getLeft());
-		uint32_t* dstData = reinterpret_cast<uint32_t*>(dst.getPixels()) + ((i + dstRect.getTop()) * dst.getWidth() + dstRect.getLeft());
-		for (size_t j = 0; j < rectW; ++j) {
-			dstData[j] = f(srcData[j], dstData[j], opacity32);
+#endif
+
+	template <BlendMode mode>
+	void blendRow(const uint32_t* src, uint32_t* dst, size_t n, uint32_t opacity)
+	{
+		size_t i = 0;
+#if defined(IMAGE_SSE) || defined(IMAGE_NEON)
+		const auto opacityVec = SIMD::splatFloat(float(opacity));
+		for (; i + 4 <= n; i += 4) {
+			SIMD::store(dst + i, blend4<mode>(SIMD::load(src + i), SIMD::load(dst + i), opacityVec));
+		}
+#endif
+		for (; i < n; ++i) {
+			dst[i] = mode == BlendMode::Alpha ? alphaBlend(src[i], dst[i], opacity) : lightenBlend(src[i], dst[i], opacity);
 		}
 	}
+
+	template <BlendMode mode>
+	void blendImages(const Image& src, Image& dst, Vector2i pos, uint8_t opacity)
+	{
+		if (dst.getFormat() != Image::Format::RGBA || src.getFormat() != Image::Format::RGBA) {
+			throw Exception("Both images must be RGBA for drawing with alpha", HalleyExceptions::Utils);
+		}
+
+		const Rect4i srcRect = src.getRect().intersection(dst.getRect() - pos);
+		const Rect4i dstRect = dst.getRect().intersection(src.getRect() + pos);
+
+		const size_t rectW = srcRect.getWidth();
+		const size_t rectH = srcRect.getHeight();
+		forEachRow(rectH, rectW, [&] (size_t i)
+		{
+			const uint32_t* srcData = reinterpret_cast<const uint32_t*>(src.getPixels()) + ((i + srcRect.getTop()) * src.getWidth() + srcRect.getLeft());
+			uint32_t* dstData = reinterpret_cast<uint32_t*>(dst.getPixels()) + ((i + dstRect.getTop()) * dst.getWidth() + dstRect.getLeft());
+			blendRow<mode>(srcData, dstData, rectW, opacity);
+		});
+	}
 }
 
 void Image::drawImageAlpha(const Image& src, Vector2i pos, uint8_t opacity)
 {
-	blendImages(alphaBlend, src, *this, pos, opacity);
+	blendImages<BlendMode::Alpha>(src, *this, pos, opacity);
 }
 
 void Image::drawImageLighten(const Image& src, Vector2i pos, uint8_t opacity)
 {
-	blendImages(lightenBlend, src, *this, pos, opacity);
+	blendImages<BlendMode::Lighten>(src, *this, pos, opacity);
 }
 
 std::unique_ptr<Image> Image::loadResource(ResourceLoader& loader)
@@ -384,7 +737,7 @@ void Image::deserialize(Deserializer& s)
 void Image::load(gsl::span<const gsl::byte> bytes, Format targetFormat)
 {
 	if (isPNG(bytes)) {
-		unsigned char* pixels;
+		unsigned char* pixels = nullptr;
 		unsigned int x, y;
 		lodepng::State state;
 		LodePNGColorType colorFormat;
@@ -398,7 +751,25 @@ void Image::load(gsl::span<const gsl::byte> bytes, Format targetFormat)
 		default:
 			colorFormat = LCT_RGBA;
 		}
-		lodepng_decode_memory(&pixels, &x, &y, reinterpret_cast<const unsigned char*>(bytes.data()), bytes.size(), colorFormat, 8);
+		state.info_raw.colortype = colorFormat;
+		state.info_raw.bitdepth = 8;
+		state.decoder.read_text_chunks = 0;
+		state.decoder.zlibsettings.custom_zlib = &pngInflate;
+
+		// Same prediction lodepng makes for the scanlines (plus a filter byte each), which it checks the result against.
+		// Interlaced images have a few smaller passes, so those just grow as needed.
+		const auto data = reinterpret_cast<const unsigned char*>(bytes.data());
+		size_t inflatedSize = 0;
+		if (lodepng_inspect(&x, &y, &state, data, bytes.size()) == 0 && state.info_png.interlace_method == 0) {
+			inflatedSize = size_t(y) * (1 + (size_t(x) * lodepng_get_bpp(&state.info_png.color) + 7) / 8);
+			state.decoder.zlibsettings.custom_context = &inflatedSize;
+		}
+
+		const unsigned error = lodepng_decode(&pixels, &x, &y, &state, data, bytes.size());
+		if (error != 0) {
+			free(pixels);
+			throw Exception("Unable to load PNG data: " + String(lodepng_error_text(error)), HalleyExceptions::Utils);
+		}
 
 		px = std::unique_ptr<char, void(*)(char*)>(reinterpret_cast<char*>(pixels), [](char* data) { free(data); });
 		w = x;
@@ -427,18 +798,37 @@ void Image::preMultiply()
 {
 	Expects(format == Format::RGBA);
 
-	size_t n = w * h;
 	unsigned int* data = reinterpret_cast<unsigned int*>(px.get());
-	for (size_t i = 0; i < n; i++) {
-		unsigned int cur = data[i];
-		unsigned int r, g, b, a;
-		convertIntToRGBA(cur, r, g, b, a);
-		++a;
-		data[i] = ((r * a >> 8) & 0xFF)
-			    | ((g * a) & 0xFF00)
+	forEachRow(h, w, [&] (size_t y)
+	{
+		unsigned int* row = data + y * w;
+		size_t x = 0;
+#if defined(IMAGE_SSE) || defined(IMAGE_NEON)
+		// As below: r * (a + 1) is at most 2^16, so it's exact as a float, as is dividing it by 256
+		const auto byteMask = SIMD::splat(0xFF);
+		const auto alphaMask = SIMD::splat(0xFF000000);
+		const auto one = SIMD::splatFloat(1.0f);
+		const auto scale = SIMD::splatFloat(1.0f / 256.0f);
+		for (; x + 4 <= w; x += 4) {
+			const auto v = SIMD::load(row + x);
+			const auto a = SIMD::mul(SIMD::add(SIMD::toFloat(SIMD::shiftRight<24>(v)), one), scale);
+			const auto r = SIMD::truncate(SIMD::mul(SIMD::toFloat(SIMD::bitAnd(v, byteMask)), a));
+			const auto g = SIMD::truncate(SIMD::mul(SIMD::toFloat(SIMD::bitAnd(SIMD::shiftRight<8>(v), byteMask)), a));
+			const auto b = SIMD::truncate(SIMD::mul(SIMD::toFloat(SIMD::bitAnd(SIMD::shiftRight<16>(v), byteMask)), a));
+			SIMD::store(row + x, SIMD::bitOr(SIMD::bitOr(r, SIMD::shiftLeft<8>(g)), SIMD::bitOr(SIMD::shiftLeft<16>(b), SIMD::bitAnd(v, alphaMask))));
+		}
+#endif
+		for (; x < w; x++) {
+			unsigned int cur = row[x];
+			unsigned int r, g, b, a;
+			convertIntToRGBA(cur, r, g, b, a);
+			++a;
+			row[x] = ((r * a >> 8) & 0xFF)
+				| ((g * a) & 0xFF00)
 				| ((b * a << 8) & 0xFF0000)
 				| ((a-1) << 24);
-	}
+		}
+	});
 
 	format = Format::RGBAPremultiplied;
 }
@@ -482,6 +872,7 @@ Bytes Image::savePNGToBytes(bool allowDepthReduce) const
 	state.info_png.color.colortype = colFormat;
 	state.info_png.color.bitdepth = 8;
 	state.encoder.auto_convert = allowDepthReduce ? 1 : 0;
+	state.encoder.zlibsettings.custom_zlib = &pngDeflate;
 	lodepng_encode(&bytes, &size, reinterpret_cast<unsigned char*>(px.get()), w, h, &state);
 	auto errorCode = state.error;
 	lodepng_state_cleanup(&state);
@@ -0,0 +1,473 @@
+#include "halley/file_formats/json_reader.h"
+#include "halley/file_formats/config_node_builder.h"
+#include "halley/concurrency/concurrent.h"
+#include "halley/support/exception.h"
+#include "halley/data_structures/vector.h"
+#include "halley/text/string_converter.h"
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+using namespace Halley;
+
+namespace {
+	class ConfigNodeJSONHandler final : public IJSONReaderHandler {
+	public:
+		explicit ConfigNodeJSONHandler(const JSONReader& reader)
+			: reader(reader)
+		{}
+
+		void onNull() override { add(ConfigNode()); }
+		void onBool(bool value) override { add(ConfigNode(String(value ? "true" : "false"))); }
+		void onString(String value) override { add(ConfigNode(std::move(value))); }
+
+		void onInt(int64_t value) override
+		{
+			if (value >= std::numeric_limits<int>::min() && value <= std::numeric_limits<int>::max()) {
+				add(ConfigNode(int(value)));
+			} else {
+				add(ConfigNode(float(value)));
+			}
+		}
+
+		void onFloat(double value) override { add(ConfigNode(float(value))); }
+		void onKey(String key) override { builder.setKey(std::move(key)); }
+
+		void onStartObject() override
+		{
+			updatePosition();
+			builder.beginMap();
+		}
+
+		void onStartArray() override
+		{
+			updatePosition();
+			builder.beginSequence();
+		}
+
+		void onEndObject() override { builder.end(); }
+		void onEndArray() override { builder.end(); }
+
+		ConfigNode takeResult() { return builder.takeResult(); }
+
+	private:
+		const JSONReader& reader;
+		ConfigNodeBuilder builder;
+
+		void updatePosition()
+		{
+			builder.setPosition(reader.getLine() - 1, reader.getColumn() - 1); // YAML marks are zero-based
+		}
+
+		void add(ConfigNode node)
+		{
+			updatePosition();
+			builder.addValue(std::move(node));
+		}
+	};
+
+	void appendUTF8(std::string& str, uint32_t c)
+	{
+		if (c < 0x80) {
+			str.push_back(char(c));
+		} else if (c < 0x800) {
+			str.push_back(char(0xC0 | (c >> 6)));
+			str.push_back(char(0x80 | (c & 0x3F)));
+		} else if (c < 0x10000) {
+			str.push_back(char(0xE0 | (c >> 12)));
+			str.push_back(char(0x80 | ((c >> 6) & 0x3F)));
+			str.push_back(char(0x80 | (c & 0x3F)));
+		} else {
+			str.push_back(char(0xF0 | (c >> 18)));
+			str.push_back(char(0x80 | ((c >> 12) & 0x3F)));
+			str.push_back(char(0x80 | ((c >> 6) & 0x3F)));
+			str.push_back(char(0x80 | (c & 0x3F)));
+		}
+	}
+
+	bool isBlank(const char* start, const char* end)
+	{
+		for (const char* c = start; c != end; ++c) {
+			if (*c != ' ' && *c != '\t' && *c != '\r') {
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+JSONReader::JSONReader(gsl::span<const gsl::byte> data, int firstLine)
+	: pos(reinterpret_cast<const char*>(data.data()))
+	, end(pos + data.size())
+	, lineStart(pos)
+	, line(firstLine)
+{
+	// Skip UTF-8 BOM
+	if (end - pos >= 3 && std::memcmp(pos, "\xEF\xBB\xBF", 3) == 0) {
+		pos += 3;
+		lineStart = pos;
+	}
+}
+
+void JSONReader::parse(IJSONReaderHandler& handler)
+{
+	// Nesting is tracked here instead of by recursion: true for objects, false for arrays
+	Vector<bool> stack;
+	bool needValue = true;
+
+	skipWhitespace();
+	while (true) {
+		if (needValue) {
+			markToken();
+			const char c = peek();
+			if (c == '{') {
+				++pos;
+				handler.onStartObject();
+				skipWhitespace();
+				if (peek() == '}') {
+					++pos;
+					handler.onEndObject();
+				} else {
+					stack.push_back(true);
+					readKey(handler);
+					continue;
+				}
+			} else if (c == '[') {
+				++pos;
+				handler.onStartArray();
+				skipWhitespace();
+				if (peek() == ']') {
+					++pos;
+					handler.onEndArray();
+				} else {
+					stack.push_back(false);
+					continue;
+				}
+			} else if (c == '"') {
+				readString();
+				handler.onString(String(std::move(scratch)));
+			} else if (c == 't') {
+				readLiteral("true");
+				handler.onBool(true);
+			} else if (c == 'f') {
+				readLiteral("false");
+				handler.onBool(false);
+			} else if (c == 'n') {
+				readLiteral("null");
+				handler.onNull();
+			} else if (c == '-' || (c >= '0' && c <= '9')) {
+				readNumber(handler);
+			} else if (c == 0 && pos == end) {
+				fail("unexpected end of data");
+			} else {
+				fail("unexpected character '" + String(c) + "'");
+			}
+			needValue = false;
+		}
+
+		// After a value: either the document is done, or the container continues or ends
+		skipWhitespace();
+		if (stack.empty()) {
+			break;
+		}
+		markToken();
+		const bool inObject = stack.back();
+		const char c = peek();
+		if (c == ',') {
+			++pos;
+			skipWhitespace();
+			if (inObject) {
+				readKey(handler);
+			}
+			needValue = true;
+		} else if (c == (inObject ? '}' : ']')) {
+			++pos;
+			stack.pop_back();
+			if (inObject) {
+				handler.onEndObject();
+			} else {
+				handler.onEndArray();
+			}
+		} else {
+			fail(inObject ? "expected ',' or '}'" : "expected ',' or ']'");
+		}
+	}
+
+	if (pos != end) {
+		markToken();
+		fail("unexpected data after the end of the document");
+	}
+}
+
+ConfigNode JSONReader::parseConfigNode(gsl::span<const gsl::byte> data)
+{
+	JSONReader reader(data);
+	ConfigNodeJSONHandler handler(reader);
+	reader.parse(handler);
+	return handler.takeResult();
+}
+
+ConfigNode JSONReader::parseJSONLines(gsl::span<const gsl::byte> data, ExecutionQueue* queue)
+{
+	struct Line {
+		const char* start;
+		const char* end;
+		int number;
+	};
+
+	Vector<Line> lines;
+	const char* start = reinterpret_cast<const char*>(data.data());
+	const char* const dataEnd = start + data.size();
+	for (int number = 1; start != dataEnd; ++number) {
+		const char* lineEnd = static_cast<const char*>(std::memchr(start, '\n', dataEnd - start));
+		const char* next = lineEnd ? lineEnd + 1 : dataEnd;
+		if (!lineEnd) {
+			lineEnd = dataEnd;
+		}
+		if (!isBlank(start, lineEnd)) {
+			lines.push_back(Line{ start, lineEnd, number });
+		}
+		start = next;
+	}
+
+	ConfigNode::SequenceType result(lines.size());
+	auto parseLines = [&] (size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i) {
+			const auto& l = lines[i];
+			JSONReader reader(gsl::as_bytes(gsl::span<const char>(l.start, l.end - l.start)), l.number);
+			ConfigNodeJSONHandler handler(reader);
+			reader.parse(handler);
+			result[i] = handler.takeResult();
+		}
+	};
+
+	constexpr size_t grain = 256;
+	if (queue) {
+		Concurrent::parallelFor(*queue, Range<size_t>(0, lines.size()), grain, parseLines);
+	} else {
+		parseLines(0, lines.size());
+	}
+
+	return ConfigNode(std::move(result));
+}
+
+void JSONReader::markToken()
+{
+	tokenLine = line;
+	tokenColumn = int(pos - lineStart) + 1;
+}
+
+void JSONReader::skipWhitespace()
+{
+	while (pos != end) {
+		const char c = *pos;
+		if (c == '\n') {
+			++line;
+			lineStart = pos + 1;
+		} else if (c != ' ' && c != '\t' && c != '\r') {
+			return;
+		}
+		++pos;
+	}
+}
+
+char JSONReader::peek() const
+{
+	return pos != end ? *pos : 0;
+}
+
+void JSONReader::expect(char c)
+{
+	if (peek() != c) {
+		markToken();
+		fail("expected '" + String(c) + "'");
+	}
+	++pos;
+}
+
+void JSONReader::readKey(IJSONReaderHandler& handler)
+{
+	skipWhitespace();
+	markToken();
+	if (peek() != '"') {
+		fail("expected a string key");
+	}
+	readString();
+	handler.onKey(String(std::move(scratch)));
+	skipWhitespace();
+	expect(':');
+	skipWhitespace();
+}
+
+void JSONReader::readString()
+{
+	scratch.clear();
+	++pos; // Opening quote
+
+	while (true) {
+		// Copy plain runs in one go
+		const char* runStart = pos;
+		while (pos != end && *pos != '"' && *pos != '\\' && static_cast<unsigned char>(*pos) >= 0x20) {
+			++pos;
+		}
+		scratch.append(runStart, pos);
+
+		if (pos == end) {
+			fail("unterminated string");
+		}
+		const char c = *pos++;
+		if (c == '"') {
+			return;
+		}
+		if (c != '\\') {
+			markToken();
+			fail("control character in string");
+		}
+
+		if (pos == end) {
+			fail("unterminated string");
+		}
+		const char escape = *pos++;
+		switch (escape) {
+		case '"': scratch.push_back('"'); break;
+		case '\\': scratch.push_back('\\'); break;
+		case '/': scratch.push_back('/'); break;
+		case 'b': scratch.push_back('\b'); break;
+		case 'f': scratch.push_back('\f'); break;
+		case 'n': scratch.push_back('\n'); break;
+		case 'r': scratch.push_back('\r'); break;
+		case 't': scratch.push_back('\t'); break;
+		case 'u':
+			{
+				uint32_t code = readHex4();
+				if (code >= 0xD800 && code < 0xDC00) {
+					// High surrogate, which must be followed by an escaped low surrogate
+					if (end - pos < 6 || pos[0] != '\\' || pos[1] != 'u') {
+						fail("unpaired surrogate in string");
+					}
+					pos += 2;
+					const uint32_t low = readHex4();
+					if (low < 0xDC00 || low >= 0xE000) {
+						fail("invalid surrogate pair in string");
+					}
+					code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+				} else if (code >= 0xDC00 && code < 0xE000) {
+					fail("unpaired surrogate in string");
+				}
+				appendUTF8(scratch, code);
+				break;
+			}
+		default:
+			markToken();
+			fail("invalid escape sequence");
+		}
+	}
+}
+
+uint32_t JSONReader::readHex4()
+{
+	if (end - pos < 4) {
+		fail("truncated unicode escape");
+	}
+	uint32_t result = 0;
+	for (int i = 0; i < 4; ++i) {
+		const char c = *pos++;
+		result <<= 4;
+		if (c >= '0' && c <= '9') {
+			result |= uint32_t(c - '0');
+		} else if (c >= 'a' && c <= 'f') {
+			result |= uint32_t(c - 'a' + 10);
+		} else if (c >= 'A' && c <= 'F') {
+			result |= uint32_t(c - 'A' + 10);
+		} else {
+			fail("invalid unicode escape");
+		}
+	}
+	return result;
+}
+
+void JSONReader::readNumber(IJSONReaderHandler& handler)
+{
+	const char* start = pos;
+	const bool negative = peek() == '-';
+	if (negative) {
+		++pos;
+	}
+
+	// Integer part, accumulated as a negative number so that the minimum value fits
+	const char* digitsStart = pos;
+	int64_t value = 0;
+	bool overflow = false;
+	while (pos != end && *pos >= '0' && *pos <= '9') {
+		const int digit = *pos - '0';
+		if (value < (std::numeric_limits<int64_t>::min() + digit) / 10) {
+			overflow = true;
+		} else {
+			value = value * 10 - digit;
+		}
+		++pos;
+	}
+	if (pos == digitsStart) {
+		fail("invalid number");
+	}
+	if (*digitsStart == '0' && pos - digitsStart > 1) {
+		fail("leading zeros in number");
+	}
+
+	bool isFloat = false;
+	if (peek() == '.') {
+		isFloat = true;
+		++pos;
+		const char* fractionStart = pos;
+		while (pos != end && *pos >= '0' && *pos <= '9') {
+			++pos;
+		}
+		if (pos == fractionStart) {
+			fail("invalid number");
+		}
+	}
+	if (peek() == 'e' || peek() == 'E') {
+		isFloat = true;
+		++pos;
+		if (peek() == '+' || peek() == '-') {
+			++pos;
+		}
+		const char* exponentStart = pos;
+		while (pos != end && *pos >= '0' && *pos <= '9') {
+			++pos;
+		}
+		if (pos == exponentStart) {
+			fail("invalid number");
+		}
+	}
+
+	if (!isFloat && !overflow && (negative || value != std::numeric_limits<int64_t>::min())) {
+		handler.onInt(negative ? value : -value);
+	} else {
+		// The data isn't null terminated, so strtod needs a copy
+		char buffer[64];
+		const size_t len = size_t(pos - start);
+		if (len < sizeof(buffer)) {
+			std::memcpy(buffer, start, len);
+			buffer[len] = 0;
+			handler.onFloat(std::strtod(buffer, nullptr));
+		} else {
+			handler.onFloat(std::strtod(std::string(start, pos).c_str(), nullptr));
+		}
+	}
+}
+
+void JSONReader::readLiteral(const char* literal)
+{
+	const size_t len = std::strlen(literal);
+	if (size_t(end - pos) < len || std::memcmp(pos, literal, len) != 0) {
+		fail("invalid literal");
+	}
+	pos += len;
+}
+
+void JSONReader::fail(const String& message) const
+{
+	throw Exception("JSON error at line " + toString(tokenLine) + ", column " + toString(tokenColumn) + ": " + message, HalleyExceptions::Resources);
+}
@@ -28,3 +28,8 @@ void TextFile::reload(Resource&& resource)
 {
 	*this = std::move(dynamic_cast<TextFile&>(resource));
 }
+
+size_t TextFile::getMemoryUsage() const
+{
+	return data.size();
+}
@@ -21,6 +21,15 @@
 
 #include <cstring>
 #include "halley/maths/matrix4.h"
+
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define MATRIX_SSE
+#include <xmmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define MATRIX_NEON
+#include <arm_neon.h>
+#endif
+
 using namespace Halley;
 
 Matrix4f::Matrix4f()
@@ -56,31 +65,119 @@ Matrix4f& Matrix4f::operator*=(const Matrix4f& param)
 
 Matrix4f Matrix4f::operator*(const Matrix4f& param) const
 {
+	// Each column of the result is a combination of the columns of this matrix
 	Matrix4f result;
-	for (size_t y = 0; y < 4; y++) {
-		for (size_t x = 0; x < 4; x++) {
+	const float* a = elements.data();
+	const float* b = param.elements.data();
+	float* r = result.elements.data();
+
+#if defined(MATRIX_SSE)
+	const __m128 a0 = _mm_loadu_ps(a);
+	const __m128 a1 = _mm_loadu_ps(a + 4);
+	const __m128 a2 = _mm_loadu_ps(a + 8);
+	const __m128 a3 = _mm_loadu_ps(a + 12);
+	for (size_t x = 0; x < 4; x++) {
+		const float* col = b + 4 * x;
+		__m128 accum = _mm_mul_ps(a0, _mm_set1_ps(col[0]));
+		accum = _mm_add_ps(accum, _mm_mul_ps(a1, _mm_set1_ps(col[1])));
+		accum = _mm_add_ps(accum, _mm_mul_ps(a2, _mm_set1_ps(col[2])));
+		accum = _mm_add_ps(accum, _mm_mul_ps(a3, _mm_set1_ps(col[3])));
+		_mm_storeu_ps(r + 4 * x, accum);
+	}
+#elif defined(MATRIX_NEON)
+	const float32x4_t a0 = vld1q_f32(a);
+	const float32x4_t a1 = vld1q_f32(a + 4);
+	const float32x4_t a2 = vld1q_f32(a + 8);
+	const float32x4_t a3 = vld1q_f32(a + 12);
+	for (size_t x = 0; x < 4; x++) {
+		const float* col = b + 4 * x;
+		float32x4_t accum = vmulq_n_f32(a0, col[0]);
+		accum = vaddq_f32(accum, vmulq_n_f32(a1, col[1]));
+		accum = vaddq_f32(accum, vmulq_n_f32(a2, col[2]));
+		accum = vaddq_f32(accum, vmulq_n_f32(a3, col[3]));
+		vst1q_f32(r + 4 * x, accum);
+	}
+#else
+	for (size_t x = 0; x < 4; x++) {
+		for (size_t y = 0; y < 4; y++) {
 			float accum = 0.0f;
 			for (size_t i = 0; i < 4; i++) {
-				accum += getElement(i, y) * param.getElement(x, i);
+				accum += a[4 * i + y] * b[4 * x + i];
 			}
-			result.getElement(x, y) = accum;
+			r[4 * x + y] = accum;
 		}
 	}
+#endif
+
 	return result;
 }
 
 Vector2f Matrix4f::operator*(const Vector2f& param) const
 {
-	float src[4] = { param.x, param.y, 0.0f, 1.0f };
-	float result[4];
-	for (size_t i = 0; i < 4; i++) {
-		float accum = 0.0f;
-		for (size_t j = 0; j < 4; j++) {
-			accum += getElement(j, i) * src[j];
+	// z is 0, so the third column doesn't contribute
+	const float* e = elements.data();
+	const float x = e[0] * param.x + e[4] * param.y + e[12];
+	const float y = e[1] * param.x + e[5] * param.y + e[13];
+	const float w = e[3] * param.x + e[7] * param.y + e[15];
+	return Vector2f(x / w, y / w);
+}
+
+bool Matrix4f::isAffine2D() const
+{
+	return elements[3] == 0.0f && elements[7] == 0.0f && elements[11] == 0.0f && elements[15] == 1.0f;
+}
+
+void Matrix4f::transformPoints(gsl::span<const Vector2f> src, gsl::span<Vector2f> dst) const
+{
+	Expects(dst.size() >= src.size());
+
+	const float* e = elements.data();
+	const size_t n = size_t(src.size());
+	size_t i = 0;
+
+	if (!isAffine2D()) {
+		for (; i < n; ++i) {
+			dst[i] = (*this) * src[i];
 		}
-		result[i] = accum;
+		return;
+	}
+
+	// Two points per vector, as (x0, y0, x1, y1)
+	static_assert(sizeof(Vector2f) == 2 * sizeof(float), "Vector2f must be tightly packed");
+	const float* in = reinterpret_cast<const float*>(src.data());
+	float* out = reinterpret_cast<float*>(dst.data());
+
+#if defined(MATRIX_SSE)
+	const __m128 cx = _mm_setr_ps(e[0], e[1], e[0], e[1]);
+	const __m128 cy = _mm_setr_ps(e[4], e[5], e[4], e[5]);
+	const __m128 t = _mm_setr_ps(e[12], e[13], e[12], e[13]);
+	for (; i + 2 <= n; i += 2) {
+		const __m128 p = _mm_loadu_ps(in + 2 * i);
+		const __m128 xs = _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 0, 0));
+		const __m128 ys = _mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 1, 1));
+		_mm_storeu_ps(out + 2 * i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(xs, cx), _mm_mul_ps(ys, cy)), t));
+	}
+#elif defined(MATRIX_NEON)
+	const float cxData[] = { e[0], e[1], e[0], e[1] };
+	const float cyData[] = { e[4], e[5], e[4], e[5] };
+	const float tData[] = { e[12], e[13], e[12], e[13] };
+	const float32x4_t cx = vld1q_f32(cxData);
+	const float32x4_t cy = vld1q_f32(cyData);
+	const float32x4_t t = vld1q_f32(tData);
+	for (; i + 2 <= n; i += 2) {
+		const float32x4_t p = vld1q_f32(in + 2 * i);
+		const float32x4_t xs = vtrn1q_f32(p, p);
+		const float32x4_t ys = vtrn2q_f32(p, p);
+		vst1q_f32(out + 2 * i, vaddq_f32(vaddq_f32(vmulq_f32(xs, cx), vmulq_f32(ys, cy)), t));
+	}
+#endif
+
+	for (; i < n; ++i) {
+		const float x = in[2 * i];
+		const float y = in[2 * i + 1];
+		out[2 * i] = e[0] * x + e[4] * y + e[12];
+		out[2 * i + 1] = e[1] * x + e[5] * y + e[13];
 	}
-	return Vector2f(result[0] / result[3], result[1] / result[3]);
 }
 
 void Matrix4f::loadIdentity()
@@ -26,19 +26,55 @@
 #include "mt199937ar.h"
 using namespace Halley;
 
+namespace {
+	inline uint64_t rotl(uint64_t x, int k)
+	{
+		return (x << k) | (x >> (64 - k));
+	}
+
+	inline uint64_t splitMix64(uint64_t& x)
+	{
+		uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+	inline float toUnitFloat(uint64_t x)
+	{
+		// Top 24 bits, which fit exactly in a float. Going through int32 rather than uint32/uint64 lets it vectorize.
+		return float(int32_t(x >> 40)) * (1.0f / 16777216.0f);
+	}
+
+	inline uint32_t toRange(uint64_t x, uint64_t range)
+	{
+		// Multiply-shift rather than modulo, which doesn't vectorize. range can be up to 2^32.
+		return uint32_t(((x >> 32) * range) >> 32);
+	}
+}
+
 Random::Random()
-	: generator(std::make_unique<MT199937AR>())
+	: Random(RandomEngine::MersenneTwister)
 {
 }
 
-Random::Random(uint32_t seed)
-	: generator(std::make_unique<MT199937AR>())
+Random::Random(RandomEngine engine)
+	: engine(engine)
+	, generator(engine == RandomEngine::MersenneTwister ? std::make_unique<MT199937AR>() : std::unique_ptr<MT199937AR>())
+{
+	if (engine == RandomEngine::Xoshiro) {
+		seedXoshiro(0);
+	}
+}
+
+Random::Random(uint32_t seed, RandomEngine engine)
+	: Random(engine)
 {
 	setSeed(seed);
 }
 
-Random::Random(gsl::span<const gsl::byte> data)
-	: generator(std::make_unique<MT199937AR>())
+Random::Random(gsl::span<const gsl::byte> data, RandomEngine engine)
+	: Random(engine)
 {
 	setSeed(data);
 }
@@ -80,7 +116,7 @@ int64_t Random::getInt(int64_t min, int64_t max)
 	if (min > max) {
 		std::swap(min, max);
 	}
-	const int64_t base = int64_t((uint64_t(getRawInt()) << 32ull) | uint64_t(getRawInt()));
+	const int64_t base = int64_t(getRawInt64());
 	const uint64_t range = uint64_t(max - min + 1);
 	if (range == 0) { // If min and max correspond to the whole range represented, this blows up
 		return int64_t(base);
@@ -93,7 +129,7 @@ uint64_t Random::getInt(uint64_t min, uint64_t max)
 	if (min > max) {
 		std::swap(min, max);
 	}
-	const uint64_t base = (uint64_t(getRawInt()) << 32ull) | uint64_t(getRawInt());
+	const uint64_t base = getRawInt64();
 	const uint64_t range = max - min + 1;
 	if (range == 0) { // If min and max correspond to the whole range represented, this blows up
 		return base;
@@ -116,6 +152,85 @@ double Random::getDouble(double min, double max)
 	return getRawDouble() * (max - min) + min;
 }
 
+void Random::fill(gsl::span<float> dst, float min, float max)
+{
+	const float scale = max - min;
+	float* out = dst.data();
+	generateBulk(size_t(dst.size()), [=] (size_t i, uint64_t x)
+	{
+		out[i] = toUnitFloat(x) * scale + min;
+	});
+}
+
+void Random::fill(gsl::span<int32_t> dst, int32_t min, int32_t max)
+{
+	if (min > max) {
+		std::swap(min, max);
+	}
+	const uint64_t range = uint64_t(int64_t(max) - int64_t(min)) + 1;
+	int32_t* out = dst.data();
+	generateBulk(size_t(dst.size()), [=] (size_t i, uint64_t x)
+	{
+		out[i] = int32_t(uint32_t(min) + toRange(x, range));
+	});
+}
+
+void Random::fill(gsl::span<uint32_t> dst, uint32_t min, uint32_t max)
+{
+	if (min > max) {
+		std::swap(min, max);
+	}
+	const uint64_t range = uint64_t(max - min) + 1;
+	uint32_t* out = dst.data();
+	generateBulk(size_t(dst.size()), [=] (size_t i, uint64_t x)
+	{
+		out[i] = min + toRange(x, range);
+	});
+}
+
+template <typename F>
+void Random::generateBulk(size_t n, F f)
+{
+	constexpr size_t lanes = 4;
+	constexpr size_t minBulk = 4 * lanes;
+
+	if (n < minBulk) {
+		// Not worth seeding the lanes
+		for (size_t i = 0; i < n; ++i) {
+			f(i, getRawInt64());
+		}
+		return;
+	}
+
+	// Lane state is laid out struct-of-arrays, so each step below is the same operation across all lanes
+	uint64_t s0[lanes], s1[lanes], s2[lanes], s3[lanes];
+	for (size_t l = 0; l < lanes; ++l) {
+		uint64_t seed = getRawInt64();
+		s0[l] = splitMix64(seed);
+		s1[l] = splitMix64(seed);
+		s2[l] = splitMix64(seed);
+		s3[l] = splitMix64(seed);
+	}
+
+	size_t i = 0;
+	for (; i + lanes <= n; i += lanes) {
+		for (size_t l = 0; l < lanes; ++l) {
+			const uint64_t result = rotl(s1[l] * 5, 7) * 9;
+			const uint64_t t = s1[l] << 17;
+			s2[l] ^= s0[l];
+			s3[l] ^= s1[l];
+			s1[l] ^= s2[l];
+			s0[l] ^= s3[l];
+			s2[l] ^= t;
+			s3[l] = rotl(s3[l], 45);
+			f(i + l, result);
+		}
+	}
+	for (; i < n; ++i) {
+		f(i, getRawInt64());
+	}
+}
+
 Random& Random::getGlobal()
 {
 	static Random* global = nullptr;
@@ -148,28 +263,119 @@ void Random::getBytes(gsl::span<gsl::byte> dst)
 
 void Random::setSeed(uint32_t seed)
 {
-	 generator->init_genrand(seed);
+	if (engine == RandomEngine::Xoshiro) {
+		seedXoshiro(seed);
+	} else {
+		generator->init_genrand(seed);
+	}
 }
 
 void Random::setSeed(gsl::span<const gsl::byte> data)
 {
-	std::vector<uint32_t> initData(alignUp(size_t(data.size_bytes()), sizeof(uint32_t)) / sizeof(uint32_t), 0);
-	memcpy(initData.data(), data.data(), data.size_bytes());
-	generator->init_by_array(initData.data(), initData.size());
+	if (engine == RandomEngine::Xoshiro) {
+		uint64_t hash = 0;
+		for (size_t pos = 0; pos < size_t(data.size_bytes()); pos += sizeof(uint64_t)) {
+			uint64_t word = 0;
+			memcpy(&word, data.data() + pos, std::min(sizeof(uint64_t), size_t(data.size_bytes()) - pos));
+			hash = splitMix64(hash) ^ word;
+		}
+		seedXoshiro(hash);
+	} else {
+		std::vector<uint32_t> initData(alignUp(size_t(data.size_bytes()), sizeof(uint32_t)) / sizeof(uint32_t), 0);
+		memcpy(initData.data(), data.data(), data.size_bytes());
+		generator->init_by_array(initData.data(), initData.size());
+	}
+}
+
+Random Random::makeStream(uint64_t seed, uint64_t stream)
+{
+	Random result(RandomEngine::Xoshiro);
+	uint64_t mixed = seed;
+	result.seedXoshiro(splitMix64(mixed) ^ stream);
+	return result;
+}
+
+Random Random::split(uint64_t stream)
+{
+	return makeStream(getRawInt64(), stream);
+}
+
+void Random::jump()
+{
+	if (engine != RandomEngine::Xoshiro) {
+		throw Exception("Only Xoshiro generators can jump.", HalleyExceptions::Utils);
+	}
+
+	constexpr uint64_t jumpTable[] = { 0x180EC6D33CFD0ABAull, 0xD5A61266F0C9392Cull, 0xA9582618E03FC9AAull, 0x39ABDC4529B1661Cull };
+	std::array<uint64_t, 4> result = {{ 0, 0, 0, 0 }};
+	for (auto j: jumpTable) {
+		for (int b = 0; b < 64; ++b) {
+			if (j & (1ull << b)) {
+				for (size_t k = 0; k < 4; ++k) {
+					result[k] ^= state[k];
+				}
+			}
+			nextXoshiro();
+		}
+	}
+	state = result;
+}
+
+RandomEngine Random::getEngine() const
+{
+	return engine;
 }
 
 uint32_t Random::getRawInt()
 {
+	if (engine == RandomEngine::Xoshiro) {
+		return uint32_t(nextXoshiro() >> 32);
+	}
 	return generator->genrand_int32();
 }
 
+uint64_t Random::getRawInt64()
+{
+	if (engine == RandomEngine::Xoshiro) {
+		return nextXoshiro();
+	}
+	return (uint64_t(getRawInt()) << 32ull) | uint64_t(getRawInt());
+}
+
 float Random::getRawFloat()
 {
+	if (engine == RandomEngine::Xoshiro) {
+		return toUnitFloat(nextXoshiro());
+	}
 	return float(generator->genrand_real2());
 }
 
 double Random::getRawDouble()
 {
+	if (engine == RandomEngine::Xoshiro) {
+		return double(nextXoshiro() >> 11) * (1.0 / 9007199254740992.0);
+	}
 	return generator->genrand_res53();
 }
 
+uint64_t Random::nextXoshiro()
+{
+	const uint64_t result = rotl(state[1] * 5, 7) * 9;
+	const uint64_t t = state[1] << 17;
+	state[2] ^= state[0];
+	state[3] ^= state[1];
+	state[1] ^= state[2];
+	state[0] ^= state[3];
+	state[2] ^= t;
+	state[3] = rotl(state[3], 45);
+	return result;
+}
+
+void Random::seedXoshiro(uint64_t seed)
+{
+	// splitmix64 never outputs four zeroes in a row, which is the one state xoshiro can't get out of
+	for (auto& s: state) {
+		s = splitMix64(seed);
+	}
+}
+
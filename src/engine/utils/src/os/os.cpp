@@ -119,6 +119,11 @@ std::vector<Path> OS::enumerateDirectory(const Path& path)
 	return {};
 }
 
+std::shared_ptr<MappedFile> OS::mapFile(const Path& path)
+{
+	return {};
+}
+
 void Halley::OS::setConsoleColor(int, int)
 {
 }
@@ -128,6 +133,11 @@ int OS::runCommand(String)
 	throw Exception("Running commands is not implemented in this platform.", HalleyExceptions::OS);
 }
 
+std::unique_ptr<ChildProcess> OS::startProcess(const Path&, const std::vector<String>&)
+{
+	throw Exception("Starting processes is not implemented in this platform.", HalleyExceptions::OS);
+}
+
 std::shared_ptr<IClipboard> OS::getClipboard()
 {
 	return {};
@@ -137,4 +147,17 @@ void OS::openURL(const String& url)
 {
 }
 
+void OS::setThreadPriority(ThreadPriority priority)
+{
+}
+
+void OS::setThreadAffinity(uint64_t affinityMask)
+{
+}
+
+size_t OS::getPeakMemoryUsage()
+{
+	return 0;
+}
+
 OS* OS::osInstance = nullptr;
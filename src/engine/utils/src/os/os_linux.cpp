@@ -27,6 +27,10 @@
 #include <pwd.h>
 #include <unistd.h>
 #include <sys/sysinfo.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <pthread.h>
+#include <sched.h>
 #include <cstring>
 
 using namespace Halley;
@@ -118,4 +122,27 @@ void OSLinux::openURL(const String& url)
 	}
 }
 
+void OSLinux::setThreadPriority(ThreadPriority priority)
+{
+	// Linux keeps a nice value per thread. Going above normal needs CAP_SYS_NICE, so High might not stick.
+	const int nice = priority == ThreadPriority::Low ? 10 : (priority == ThreadPriority::High ? -5 : 0);
+	setpriority(PRIO_PROCESS, id_t(syscall(SYS_gettid)), nice);
+}
+
+void OSLinux::setThreadAffinity(uint64_t affinityMask)
+{
+	if (affinityMask == 0) {
+		return;
+	}
+
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (int i = 0; i < 64; ++i) {
+		if (affinityMask & (uint64_t(1) << i)) {
+			CPU_SET(i, &set);
+		}
+	}
+	pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
 #endif
\ No newline at end of file
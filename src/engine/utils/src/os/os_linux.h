@@ -34,6 +34,9 @@ namespace Halley {
 		Path parseProgramPath(const String&) override;
 
 		void openURL(const String& url) override;
+
+		void setThreadPriority(ThreadPriority priority) override;
+		void setThreadAffinity(uint64_t affinityMask) override;
 	};
 }
 
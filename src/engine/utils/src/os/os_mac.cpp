@@ -28,6 +28,8 @@
 #include <unistd.h>
 #include <iostream>
 #include <mach-o/dyld.h>
+#include <pthread.h>
+#include <pthread/qos.h>
 
 using namespace Halley;
 
@@ -66,4 +68,16 @@ void OSMac::openURL(const String& url)
 	}
 }
 
+void OSMac::setThreadPriority(ThreadPriority priority)
+{
+	// The QoS class is also what decides between performance and efficiency cores on Apple silicon
+	qos_class_t qos = QOS_CLASS_USER_INITIATED;
+	if (priority == ThreadPriority::Low) {
+		qos = QOS_CLASS_UTILITY;
+	} else if (priority == ThreadPriority::High) {
+		qos = QOS_CLASS_USER_INTERACTIVE;
+	}
+	pthread_set_qos_class_self_np(qos, 0);
+}
+
 #endif
\ No newline at end of file
@@ -32,6 +32,9 @@ namespace Halley {
 		String getUserDataDir() override;
 		Path parseProgramPath(const String&) override;
 		void openURL(const String& url) override;
+
+		// macOS has no way to pin threads to cores, so affinity is left to the default (ignored)
+		void setThreadPriority(ThreadPriority priority) override;
 	};
 }
 
@@ -23,6 +23,7 @@
 #ifdef IS_UNIX
 
 #include <halley/support/exception.h>
+#include <halley/support/logger.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -33,6 +34,10 @@
 #include <sys/wait.h>
 #include <sys/stat.h>
 #include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <signal.h>
 
 using namespace Halley;
 
@@ -170,4 +175,235 @@ std::vector<Path> Halley::OSUnix::enumerateDirectory(const Path& path)
 	return result;
 }
 
+namespace {
+	class MappedFileUnix final : public MappedFile {
+	public:
+		MappedFileUnix(void* data, size_t size)
+			: data(data)
+			, size(size)
+		{}
+
+		~MappedFileUnix()
+		{
+			munmap(data, size);
+		}
+
+		gsl::span<const gsl::byte> getSpan() const override
+		{
+			return gsl::span<const gsl::byte>(static_cast<const gsl::byte*>(data), size);
+		}
+
+		void prefetch() override
+		{
+			madvise(data, size, MADV_WILLNEED);
+		}
+
+	private:
+		void* data;
+		size_t size;
+	};
+}
+
+std::shared_ptr<MappedFile> Halley::OSUnix::mapFile(const Path& path)
+{
+	const int fd = open(path.string().c_str(), O_RDONLY);
+	if (fd == -1) {
+		return {};
+	}
+
+	struct stat st;
+	void* data = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && st.st_size > 0) {
+		data = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+	}
+	close(fd); // The mapping holds on to the file by itself
+
+	if (data == MAP_FAILED) {
+		return {};
+	}
+	return std::make_shared<MappedFileUnix>(data, size_t(st.st_size));
+}
+
+void Halley::OSUnix::atomicWriteFile(const Path& path, const Bytes& data, Maybe<Path> backupOldVersionPath)
+{
+	// Written in full and synced before being renamed over the old one, so there's never a partial file at the destination
+	const auto dst = path.string();
+	const auto temp = path.replaceExtension(path.getExtension() + ".tmp").string();
+
+	const int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	bool ok = fd != -1;
+	size_t written = 0;
+	while (ok && written < data.size()) {
+		const auto n = write(fd, data.data() + written, data.size() - written);
+		if (n < 0 && errno != EINTR) {
+			ok = false;
+		} else if (n > 0) {
+			written += size_t(n);
+		}
+	}
+	if (fd != -1) {
+		ok = fsync(fd) == 0 && ok;
+		ok = close(fd) == 0 && ok;
+	}
+
+	if (ok && backupOldVersionPath) {
+		// Hard link, so the old version stays at the destination until the rename replaces it
+		const auto backup = backupOldVersionPath->string();
+		unlink(backup.c_str());
+		link(dst.c_str(), backup.c_str());
+	}
+
+	if (!ok || rename(temp.c_str(), dst.c_str()) != 0) {
+		Logger::logWarning("Unable to safely overwrite file " + path.getString());
+		unlink(temp.c_str());
+		OS::atomicWriteFile(path, data, {});
+	}
+}
+
+namespace {
+	class ChildProcessUnix final : public ChildProcess {
+	public:
+		ChildProcessUnix(pid_t pid, int stdinFd, int stdoutFd)
+			: pid(pid)
+			, stdinFd(stdinFd)
+			, stdoutFd(stdoutFd)
+		{}
+
+		~ChildProcessUnix()
+		{
+			close(stdinFd);
+			close(stdoutFd);
+			terminate();
+			if (!exitCode) {
+				int status;
+				waitpid(pid, &status, 0);
+			}
+		}
+
+		bool write(gsl::span<const gsl::byte> data) override
+		{
+			auto src = reinterpret_cast<const char*>(data.data());
+			size_t left = size_t(data.size());
+			while (left > 0) {
+				const auto n = ::write(stdinFd, src, left);
+				if (n < 0 && errno == EINTR) {
+					continue;
+				}
+				if (n <= 0) {
+					return false;
+				}
+				src += n;
+				left -= size_t(n);
+			}
+			return true;
+		}
+
+		size_t read(gsl::span<gsl::byte> dst) override
+		{
+			while (true) {
+				const auto n = ::read(stdoutFd, dst.data(), size_t(dst.size()));
+				if (n < 0 && errno == EINTR) {
+					continue;
+				}
+				return n > 0 ? size_t(n) : 0;
+			}
+		}
+
+		bool isRunning() override
+		{
+			if (exitCode) {
+				return false;
+			}
+			int status;
+			const auto result = waitpid(pid, &status, WNOHANG);
+			if (result == pid) {
+				exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+				return false;
+			}
+			return result == 0;
+		}
+
+		Maybe<int> getExitCode() override
+		{
+			isRunning();
+			return exitCode;
+		}
+
+		void terminate() override
+		{
+			if (isRunning()) {
+				kill(pid, SIGKILL);
+			}
+		}
+
+	private:
+		pid_t pid;
+		int stdinFd;
+		int stdoutFd;
+		Maybe<int> exitCode;
+	};
+}
+
+std::unique_ptr<ChildProcess> Halley::OSUnix::startProcess(const Path& executable, const std::vector<String>& args)
+{
+	// Writing to a child that died would otherwise kill us with SIGPIPE, rather than just failing
+	signal(SIGPIPE, SIG_IGN);
+
+	int inPipe[2];
+	int outPipe[2];
+	if (pipe(inPipe) != 0) {
+		throw Exception("Unable to create stdin pipe", HalleyExceptions::OS);
+	}
+	if (pipe(outPipe) != 0) {
+		close(inPipe[0]);
+		close(inPipe[1]);
+		throw Exception("Unable to create stdout pipe", HalleyExceptions::OS);
+	}
+	// Our ends shouldn't leak into this or any other child
+	fcntl(inPipe[1], F_SETFD, FD_CLOEXEC);
+	fcntl(outPipe[0], F_SETFD, FD_CLOEXEC);
+
+	const auto exe = executable.string();
+	std::vector<char*> argv;
+	argv.push_back(const_cast<char*>(exe.c_str()));
+	for (auto& arg: args) {
+		argv.push_back(const_cast<char*>(arg.c_str()));
+	}
+	argv.push_back(nullptr);
+
+	const auto pid = fork();
+	if (pid == -1) {
+		close(inPipe[0]);
+		close(inPipe[1]);
+		close(outPipe[0]);
+		close(outPipe[1]);
+		throw Exception("Unable to fork process.", HalleyExceptions::OS);
+	} else if (pid == 0) {
+		// Child
+		dup2(inPipe[0], STDIN_FILENO);
+		dup2(outPipe[1], STDOUT_FILENO);
+		close(inPipe[0]);
+		close(outPipe[1]);
+		execv(exe.c_str(), argv.data());
+		_exit(127);
+	}
+
+	close(inPipe[0]);
+	close(outPipe[1]);
+	return std::make_unique<ChildProcessUnix>(pid, inPipe[1], outPipe[0]);
+}
+
+size_t Halley::OSUnix::getPeakMemoryUsage()
+{
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) {
+		return 0;
+	}
+#ifdef __APPLE__
+	return size_t(usage.ru_maxrss); // Bytes on macOS
+#else
+	return size_t(usage.ru_maxrss) * 1024; // Kilobytes elsewhere
+#endif
+}
+
 #endif
@@ -37,8 +37,12 @@ namespace Halley {
 		virtual String getUserDataDir() override;
 		void createDirectories(const Path& path) override;
 		std::vector<Path> enumerateDirectory(const Path& path) override;
+		std::shared_ptr<MappedFile> mapFile(const Path& path) override;
+		void atomicWriteFile(const Path& path, const Bytes& data, Maybe<Path> backupOldVersionPath) override;
 
 		int runCommand(String command) override;
+		std::unique_ptr<ChildProcess> startProcess(const Path& executable, const std::vector<String>& args) override;
+		size_t getPeakMemoryUsage() override;
 	};
 }
 
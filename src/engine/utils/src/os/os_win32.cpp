@@ -41,6 +41,7 @@
 #include <fstream>
 #include <Windows.h>
 #include <shellapi.h>
+#include <psapi.h>
 
 #pragma comment(lib, "wbemuuid.lib")
 //#pragma comment(lib, "comsupp.lib")
@@ -465,6 +466,193 @@ static String readPipeToString(HANDLE pipe)
 	return result;
 }
 
+namespace {
+	class MappedFileWin32 final : public MappedFile {
+	public:
+		MappedFileWin32(HANDLE mapping, const void* data, size_t size)
+			: mapping(mapping)
+			, data(data)
+			, size(size)
+		{}
+
+		~MappedFileWin32()
+		{
+			UnmapViewOfFile(data);
+			CloseHandle(mapping);
+		}
+
+		gsl::span<const gsl::byte> getSpan() const override
+		{
+			return gsl::span<const gsl::byte>(static_cast<const gsl::byte*>(data), size);
+		}
+
+	private:
+		HANDLE mapping;
+		const void* data;
+		size_t size;
+	};
+}
+
+std::shared_ptr<MappedFile> OSWin32::mapFile(const Path& path)
+{
+	const auto file = CreateFileW(path.getString().replaceAll("/", "\\").getUTF16().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return {};
+	}
+
+	LARGE_INTEGER fileSize;
+	HANDLE mapping = nullptr;
+	if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+		mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	}
+	CloseHandle(file); // The mapping holds on to the file by itself
+
+	if (!mapping) {
+		return {};
+	}
+	const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!data) {
+		CloseHandle(mapping);
+		return {};
+	}
+	return std::make_shared<MappedFileWin32>(mapping, data, size_t(fileSize.QuadPart));
+}
+
+namespace {
+	class ChildProcessWin32 final : public ChildProcess {
+	public:
+		ChildProcessWin32(HANDLE process, HANDLE stdinWrite, HANDLE stdoutRead)
+			: process(process)
+			, stdinWrite(stdinWrite)
+			, stdoutRead(stdoutRead)
+		{}
+
+		~ChildProcessWin32()
+		{
+			CloseHandle(stdinWrite);
+			terminate();
+			CloseHandle(stdoutRead);
+			CloseHandle(process);
+		}
+
+		bool write(gsl::span<const gsl::byte> data) override
+		{
+			auto src = reinterpret_cast<const char*>(data.data());
+			size_t left = size_t(data.size());
+			while (left > 0) {
+				DWORD written = 0;
+				if (!WriteFile(stdinWrite, src, DWORD(std::min(left, size_t(1 << 20))), &written, nullptr) || written == 0) {
+					return false;
+				}
+				src += written;
+				left -= written;
+			}
+			return true;
+		}
+
+		size_t read(gsl::span<gsl::byte> dst) override
+		{
+			DWORD n = 0;
+			if (!ReadFile(stdoutRead, dst.data(), DWORD(std::min(size_t(dst.size()), size_t(1 << 20))), &n, nullptr)) {
+				return 0;
+			}
+			return size_t(n);
+		}
+
+		bool isRunning() override
+		{
+			return WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+		}
+
+		Maybe<int> getExitCode() override
+		{
+			if (isRunning()) {
+				return {};
+			}
+			DWORD exitCode = DWORD(-1);
+			GetExitCodeProcess(process, &exitCode);
+			return int(exitCode);
+		}
+
+		void terminate() override
+		{
+			if (isRunning()) {
+				TerminateProcess(process, DWORD(-1));
+				WaitForSingleObject(process, INFINITE);
+			}
+		}
+
+	private:
+		HANDLE process;
+		HANDLE stdinWrite;
+		HANDLE stdoutRead;
+	};
+
+	String quoteArgument(const String& arg)
+	{
+		if (!arg.isEmpty() && !arg.contains(" ") && !arg.contains("\t") && !arg.contains("\"")) {
+			return arg;
+		}
+		return "\"" + arg.replaceAll("\"", "\\\"") + "\"";
+	}
+}
+
+std::unique_ptr<ChildProcess> OSWin32::startProcess(const Path& executable, const std::vector<String>& args)
+{
+	const auto exe = executable.getString().replaceAll("/", "\\");
+	String commandLine = quoteArgument(exe);
+	for (auto& arg: args) {
+		commandLine += " " + quoteArgument(arg);
+	}
+	auto commandLine16 = commandLine.getUTF16();
+	std::vector<wchar_t> buffer(commandLine16.begin(), commandLine16.end());
+	buffer.push_back(0);
+
+	// Only the child's ends of the pipes get inherited
+	SECURITY_ATTRIBUTES saAttr;
+	saAttr.nLength = sizeof(SECURITY_ATTRIBUTES);
+	saAttr.bInheritHandle = TRUE;
+	saAttr.lpSecurityDescriptor = nullptr;
+	HANDLE inRead;
+	HANDLE inWrite;
+	HANDLE outRead;
+	HANDLE outWrite;
+	if (!CreatePipe(&inRead, &inWrite, &saAttr, 0)) {
+		throw Exception("Unable to create stdin pipe", HalleyExceptions::OS);
+	}
+	SetHandleInformation(inWrite, HANDLE_FLAG_INHERIT, 0);
+	if (!CreatePipe(&outRead, &outWrite, &saAttr, 0)) {
+		CloseHandle(inRead);
+		CloseHandle(inWrite);
+		throw Exception("Unable to create stdout pipe", HalleyExceptions::OS);
+	}
+	SetHandleInformation(outRead, HANDLE_FLAG_INHERIT, 0);
+
+	STARTUPINFOW si;
+	memset(&si, 0, sizeof(STARTUPINFOW));
+	si.cb = sizeof(STARTUPINFOW);
+	si.hStdInput = inRead;
+	si.hStdOutput = outWrite;
+	si.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+	si.dwFlags |= STARTF_USESTDHANDLES;
+
+	PROCESS_INFORMATION pi;
+	memset(&pi, 0, sizeof(PROCESS_INFORMATION));
+	const bool ok = CreateProcessW(exe.getUTF16().c_str(), buffer.data(), nullptr, nullptr, TRUE, CREATE_NO_WINDOW, nullptr, nullptr, &si, &pi);
+
+	// The child has its own copies now; closing ours means reads fail once it exits
+	CloseHandle(inRead);
+	CloseHandle(outWrite);
+	if (!ok) {
+		CloseHandle(inWrite);
+		CloseHandle(outRead);
+		throw Exception("Unable to start " + exe + " due to error " + toString(GetLastError()), HalleyExceptions::OS);
+	}
+
+	CloseHandle(pi.hThread);
+	return std::make_unique<ChildProcessWin32>(pi.hProcess, inWrite, outRead);
+}
+
 int OSWin32::runCommand(String rawCommand)
 {
 	using namespace std::chrono_literals;
@@ -622,4 +810,31 @@ void OSWin32::openURL(const String& url)
 	}
 }
 
+void OSWin32::setThreadPriority(ThreadPriority priority)
+{
+	int value = THREAD_PRIORITY_NORMAL;
+	if (priority == ThreadPriority::Low) {
+		value = THREAD_PRIORITY_BELOW_NORMAL;
+	} else if (priority == ThreadPriority::High) {
+		value = THREAD_PRIORITY_HIGHEST;
+	}
+	SetThreadPriority(GetCurrentThread(), value);
+}
+
+void OSWin32::setThreadAffinity(uint64_t affinityMask)
+{
+	if (affinityMask != 0) {
+		SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(affinityMask));
+	}
+}
+
+size_t OSWin32::getPeakMemoryUsage()
+{
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		return 0;
+	}
+	return counters.PeakWorkingSetSize;
+}
+
 #endif
@@ -46,16 +46,22 @@ namespace Halley {
 		void createDirectories(const Path& path) override;
 		void atomicWriteFile(const Path& path, const Bytes& data, Maybe<Path> backupOldVersionPath) override;
 		std::vector<Path> enumerateDirectory(const Path& path) override;
+		std::shared_ptr<MappedFile> mapFile(const Path& path) override;
 
 		void displayError(const std::string& cs) override;
 		void onWindowCreated(void* window) override;
 
 		int runCommand(String command) override;
+		std::unique_ptr<ChildProcess> startProcess(const Path& executable, const std::vector<String>& args) override;
 
 		std::shared_ptr<IClipboard> getClipboard() override;
 
 		void openURL(const String& url) override;
 
+		void setThreadPriority(ThreadPriority priority) override;
+		void setThreadAffinity(uint64_t affinityMask) override;
+		size_t getPeakMemoryUsage() override;
+
 	private:
 		String runWMIQuery(String query, String parameter) const;
 		void loadWindowIcon(HWND hwnd);
@@ -29,6 +29,16 @@ void Resource::onLoaded(Resources& resources)
 {
 }
 
+size_t Resource::getMemoryUsage() const
+{
+	return 0;
+}
+
+bool Resource::reduceMemoryUsage()
+{
+	return false;
+}
+
 int Resource::getAssetVersion() const
 {
 	return assetVersion;
@@ -41,6 +51,12 @@ void Resource::reloadResource(Resource&& resource)
 	reload(std::move(resource));
 }
 
+void Resource::onUpdatedInPlace(const Metadata& m)
+{
+	++assetVersion;
+	meta = m;
+}
+
 void Resource::reload(Resource&& resource)
 {
 }
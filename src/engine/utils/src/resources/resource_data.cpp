@@ -4,9 +4,14 @@
 #include "halley/support/exception.h"
 #include <halley/concurrency/concurrent.h>
 #include "halley/bytes/compression.h"
+#include "halley/support/profiler.h"
 
 using namespace Halley;
 
+namespace {
+	thread_local ResourceLoadTiming* currentTiming = nullptr;
+}
+
 Bytes ResourceDataReader::readAll()
 {
 	Bytes result(size() - tell());
@@ -32,6 +37,14 @@ ResourceDataStatic::ResourceDataStatic(const void* _data, size_t _size, String p
 	set(_data, _size, owning);
 }
 
+ResourceDataStatic::ResourceDataStatic(std::shared_ptr<const char> _data, size_t _size, String path)
+	: ResourceData(path)
+	, data(std::move(_data))
+	, size(_size)
+	, loaded(true)
+{
+}
+
 static void deleter(const char* data)
 {
 	delete[] data;
@@ -114,11 +127,45 @@ ResourceDataStream::ResourceDataStream(String path, ResourceDataMakeReader makeR
 {
 }
 
+std::unique_ptr<ResourceDataStatic> ResourceLoadTiming::read(IResourceLocator& locator, const String& asset, AssetType type)
+{
+	const auto start = Profiler::getTimeNs();
+	const auto unpackBefore = unpack.load();
+	auto prev = currentTiming;
+	currentTiming = this;
+
+	std::unique_ptr<ResourceDataStatic> result;
+	try {
+		result = locator.getStatic(asset, type);
+	} catch (...) {
+		currentTiming = prev;
+		throw;
+	}
+
+	currentTiming = prev;
+	io += Profiler::getTimeNs() - start - (unpack.load() - unpackBefore);
+	return result;
+}
+
+void ResourceLoadTiming::inflate(ResourceDataStatic& data)
+{
+	const auto start = Profiler::getTimeNs();
+	data.inflate();
+	unpack += Profiler::getTimeNs() - start;
+}
+
+ResourceLoadTiming* ResourceLoadTiming::getCurrent()
+{
+	return currentTiming;
+}
+
 ResourceLoader::ResourceLoader(ResourceLoader&& loader) noexcept
 	: locator(loader.locator)
 	, name(std::move(loader.name))
 	, priority(loader.priority)
 	, api(loader.api)
+	, timing(std::move(loader.timing))
+	, syncReadTime(loader.syncReadTime)
 {
 }
 
@@ -138,17 +185,30 @@ ResourceLoader::ResourceLoader(IResourceLocator& locator, const String& name, As
 
 std::unique_ptr<ResourceDataStatic> ResourceLoader::getStatic()
 {
-	auto result = locator.getStatic(name, type);
+	if (prefetched) {
+		loaded = true;
+		return std::move(prefetched);
+	}
+
+	const auto start = timing ? Profiler::getTimeNs() : 0;
+	auto result = timing ? timing->read(locator, name, type) : locator.getStatic(name, type);
 	if (result) {
 		if (metadata->getString("asset_compression", "") == "deflate") {
 			try {
-				result->inflate();
+				if (timing) {
+					timing->inflate(*result);
+				} else {
+					result->inflate();
+				}
 			} catch (Exception &e) {
 				throw Exception("Failed to load resource \"" + getName() + "\" due to inflate exception: " + e.what(), HalleyExceptions::Resources);
 			}
 		}
 		loaded = true;
 	}
+	if (timing) {
+		syncReadTime += Profiler::getTimeNs() - start;
+	}
 	return result;
 }
 
@@ -163,15 +223,26 @@ std::unique_ptr<ResourceDataStream> ResourceLoader::getStream()
 
 Future<std::unique_ptr<ResourceDataStatic>> ResourceLoader::getAsync() const
 {
+	if (prefetched) {
+		Promise<std::unique_ptr<ResourceDataStatic>> promise;
+		promise.setValue(std::move(prefetched));
+		return promise.getFuture();
+	}
+
 	std::reference_wrapper<IResourceLocator> loc = locator;
 	auto n = name;
 	auto t = type;
 	auto meta = getMeta();
-	return Concurrent::execute(Executors::getDiskIO(), [meta, loc, n, t] () -> std::unique_ptr<ResourceDataStatic>
+	auto tm = timing;
+	return Concurrent::execute(Executors::getDiskIO(), [meta, loc, n, t, tm] () -> std::unique_ptr<ResourceDataStatic>
 	{
-		auto result = loc.get().getStatic(n, t);
+		auto result = tm ? tm->read(loc.get(), n, t) : loc.get().getStatic(n, t);
 		if (meta.getString("asset_compression", "") == "deflate") {
-			result->inflate();
+			if (tm) {
+				tm->inflate(*result);
+			} else {
+				result->inflate();
+			}
 		}
 		return result;
 	});
@@ -7,7 +7,9 @@
 
 #include "halley/core/api/halley_api.h"
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <thread>
 #include <cstdint>
 
@@ -19,10 +21,36 @@ MainLoop::MainLoop(IMainLoopable& target, GameLoader& reloader)
 {
 }
 
+namespace {
+	using Clock = std::chrono::steady_clock;
+
+	// Sleeping is only accurate to a millisecond or two, so the last stretch is spent yielding instead
+	void waitUntil(Clock::time_point time)
+	{
+		using namespace std::chrono_literals;
+		for (auto now = Clock::now(); now < time; now = Clock::now()) {
+			if (time - now > 2ms) {
+				std::this_thread::sleep_for(time - now - 1500us);
+			} else {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	// Frames presented on vsync really are whole refresh intervals apart, but the time measured between them jitters around
+	// that; feeding the jitter into the fixed steps is what makes them alternate between one and two steps per frame
+	Time snapToRefresh(Time delta, Time refreshInterval)
+	{
+		const Time intervals = std::max(1.0, std::round(delta / refreshInterval));
+		return std::abs(delta - intervals * refreshInterval) < 0.002 ? intervals * refreshInterval : delta;
+	}
+}
+
 void MainLoop::run()
 {
 	capFrameRate = true;
 	fps = target.getTargetFPS();
+	pacing = target.getFramePacing();
 
 	do {
 		runLoop();
@@ -33,16 +61,27 @@ void MainLoop::runLoop()
 {
 	std::cout << ConsoleColour(Console::GREEN) << "\nStarting main loop." << ConsoleColour() << std::endl;
 
-	using Clock = std::chrono::steady_clock;
-	using namespace std::chrono_literals;
-
-	int64_t nSteps = 0;
-	Clock::time_point startTime;
-	Clock::time_point targetTime;
-	Clock::time_point lastTime;
-	startTime = targetTime = lastTime = Clock::now();
+	if (target.isHeadless()) {
+		// Ticks at the target rate, or back to back if there's none
+		const Time fixedDelta = 1.0 / (fps > 0 ? fps : 60);
+		const auto tickInterval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<Time>(fixedDelta));
+		Clock::time_point nextTickTime = Clock::now();
+		while (isRunning()) {
+			if (target.transitionStage()) {
+				nextTickTime = Clock::now();
+			}
+			target.onFixedUpdate(fixedDelta);
 
-	if (fps <= 0) {
+			if (fps > 0) {
+				nextTickTime += tickInterval;
+				const auto now = Clock::now();
+				if (nextTickTime + tickInterval < now) {
+					nextTickTime = now;
+				}
+				waitUntil(nextTickTime);
+			}
+		}
+	} else if (fps <= 0) {
 		while (isRunning()) {
 			target.transitionStage();
 			constexpr Time fixedDelta = 1.0 / 60.0;
@@ -50,36 +89,62 @@ void MainLoop::runLoop()
 			target.onVariableUpdate(fixedDelta);
 		}
 	} else {
+		const Time fixedDelta = 1.0 / fps;
+		const auto frameInterval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<Time>(fixedDelta));
+		const Time refreshInterval = 1.0 / (pacing.refreshRate > 0 ? pacing.refreshRate : fps);
+		const int maxSteps = std::max(pacing.maxFixedStepsPerFrame, 1);
+
+		Clock::time_point lastTime = Clock::now();
+		Clock::time_point nextFrameTime = lastTime;
+		Time accumulator = 0;
+		Time workTime = 0; // Average time taken by a frame, not counting the wait for the display
+
 		while (isRunning()) {
 			if (target.transitionStage()) {
-				// Reset counters
-				startTime = targetTime = lastTime = Clock::now();
-				nSteps = 0;
+				lastTime = nextFrameTime = Clock::now();
+				accumulator = 0;
 			}
-			Clock::time_point curTime = Clock::now();
 
-			// Got any fixed updates to do?
-			if (curTime >= targetTime) {
-				// Figure out how many steps we need...
-				const Time fixedDelta = 1.0 / fps;
-				int stepsNeeded = int(std::chrono::duration<float>(targetTime - curTime).count() * fps);
-
-				// Run up to 5 (if we're more than 5 frames late, ignore them. C'est la vie)
-				for (int i = 0; i < std::min(stepsNeeded, 5); i++) {
-					target.onFixedUpdate(fixedDelta);
+			if (pacing.mode == FramePacingMode::VSync && pacing.lateInputSampling) {
+				// Leave a margin, as finishing late would miss the refresh altogether
+				const Time delay = refreshInterval - workTime * 1.25 - 0.001;
+				if (delay > 0) {
+					waitUntil(lastTime + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<Time>(delay)));
 				}
+			}
 
-				// Update target
-				nSteps += stepsNeeded;
-				targetTime = startTime + std::chrono::microseconds((nSteps * 1000000ll) / fps);
-			} else {
-				// Nope, release CPU
-				std::this_thread::yield();
+			const auto frameStart = Clock::now();
+			Time delta = std::min(std::chrono::duration<Time>(frameStart - lastTime).count(), 0.1); // Never step by more than 100ms
+			if (pacing.mode == FramePacingMode::VSync) {
+				delta = snapToRefresh(delta, refreshInterval);
 			}
+			lastTime = frameStart;
+
+			// If we're too far behind to catch up, the remaining steps are dropped
+			accumulator += delta;
+			const int stepsNeeded = int(accumulator / fixedDelta);
+			const int steps = std::min(stepsNeeded, maxSteps);
+			accumulator -= stepsNeeded * fixedDelta;
+			for (int i = 0; i < steps; i++) {
+				target.onFixedUpdate(fixedDelta);
+			}
+
+			target.onVariableUpdate(delta);
 
-			// Run variable update
-			target.onVariableUpdate(std::min(std::chrono::duration<float>(curTime - lastTime).count(), 0.1f)); // Never step by more than 100ms
-			lastTime = curTime;
+			const Time frameTime = std::chrono::duration<Time>(Clock::now() - frameStart).count() - double(target.getLastPresentWaitNs()) / 1000000000.0;
+			workTime = workTime * 0.9 + std::max(frameTime, 0.0) * 0.1;
+
+			if (pacing.mode == FramePacingMode::Timer) {
+				// Stay on schedule, unless we've fallen a whole frame behind, in which case the schedule starts over
+				nextFrameTime += frameInterval;
+				const auto now = Clock::now();
+				if (nextFrameTime + frameInterval < now) {
+					nextFrameTime = now;
+				}
+				waitUntil(nextFrameTime);
+			} else if (pacing.mode == FramePacingMode::VariableRefresh) {
+				waitUntil(frameStart + frameInterval);
+			}
 		}
 	}
 
@@ -1,11 +1,157 @@
 #include "halley/support/logger.h"
+#include "halley/support/profiler.h"
+#include "halley/concurrency/mpmc_queue.h"
 #include "halley/text/halleystring.h"
+#include "halley/text/string_converter.h"
 #include <gsl/gsl_assert>
 #include <iostream>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <array>
 #include "halley/support/console.h"
 
 using namespace Halley;
 
+namespace {
+	thread_local bool dispatchingLog = false;
+}
+
+namespace Halley {
+	// Log messages are pushed into a lock-free queue, and a single consumer thread dispatches them to the sinks.
+	// Producers never block, and only touch the mutex to wake the consumer up if it's asleep.
+	class AsyncLogQueue
+	{
+	public:
+		AsyncLogQueue(Logger& logger, size_t size)
+			: logger(logger)
+			, queue(std::max(size, size_t(16)))
+		{
+			thread = std::thread([this] () { run(); });
+		}
+
+		~AsyncLogQueue()
+		{
+			running = false;
+			wake();
+			thread.join();
+		}
+
+		bool push(LoggerLevel level, const String& msg, size_t& position)
+		{
+			if (queue.tryPush(Record{ level, msg }, position)) {
+				wake();
+				return true;
+			}
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		// Waits until everything before the given position has been dispatched
+		void waitFor(size_t position)
+		{
+			if (dispatchingLog) {
+				// Either the consumer thread itself or a sink, which would never see its message go through
+				return;
+			}
+
+			wake();
+			std::unique_lock<std::mutex> lock(mutex);
+			++flushWaiters;
+			flushCondition.wait(lock, [&] () { return dispatchedCount.load() >= position; });
+			--flushWaiters;
+		}
+
+		void flush()
+		{
+			waitFor(queue.getPushCount());
+		}
+
+		uint64_t getDropped() const
+		{
+			return dropped.load(std::memory_order_relaxed);
+		}
+
+	private:
+		struct Record
+		{
+			LoggerLevel level = LoggerLevel::Info;
+			String msg;
+		};
+
+		constexpr static size_t batchSize = 64;
+
+		Logger& logger;
+		MPMCQueue<Record> queue;
+		std::atomic<size_t> dispatchedCount { 0 };
+
+		std::atomic<uint64_t> dropped { 0 };
+		uint64_t droppedReported = 0;
+
+		std::atomic<bool> running { true };
+		std::atomic<bool> sleeping { false };
+		std::atomic<int> flushWaiters { 0 };
+		std::mutex mutex;
+		std::condition_variable wakeCondition;
+		std::condition_variable flushCondition;
+		std::thread thread;
+
+		void wake()
+		{
+			if (sleeping.exchange(false)) {
+				std::unique_lock<std::mutex> lock(mutex);
+				wakeCondition.notify_one();
+			}
+		}
+
+		void run()
+		{
+			Profiler::setThreadName("Logger");
+			dispatchingLog = true;
+
+			std::array<Record, batchSize> batch;
+			size_t count = 0;
+			while (true) {
+				// With a single consumer, records come out in position order
+				const size_t n = queue.tryPopBatch(batch);
+				for (size_t i = 0; i < n; ++i) {
+					logger.dispatch(batch[i].level, batch[i].msg);
+					batch[i].msg = String();
+				}
+				count += n;
+
+				const uint64_t droppedNow = dropped.load(std::memory_order_relaxed);
+				if (droppedNow != droppedReported) {
+					logger.dispatch(LoggerLevel::Warning, "Logger queue was full, " + toString(droppedNow - droppedReported) + " messages were dropped.");
+					droppedReported = droppedNow;
+				}
+
+				if (n > 0) {
+					dispatchedCount.store(count);
+					if (flushWaiters.load() > 0) {
+						std::unique_lock<std::mutex> lock(mutex);
+						flushCondition.notify_all();
+					}
+					continue;
+				}
+
+				if (!running) {
+					break;
+				}
+
+				std::unique_lock<std::mutex> lock(mutex);
+				sleeping = true;
+				if (!queue.isEmpty() || !running) {
+					sleeping = false;
+					continue;
+				}
+				wakeCondition.wait_for(lock, std::chrono::milliseconds(100));
+				sleeping = false;
+			}
+		}
+	};
+}
+
 StdOutSink::StdOutSink(bool devMode)
 	: devMode(devMode)
 {
@@ -33,6 +179,39 @@ void StdOutSink::log(LoggerLevel level, const String& msg)
 	std::cout << msg << ConsoleColour() << std::endl;
 }
 
+LoggerCallSite::LoggerCallSite(const char* name, uint32_t maxPerSecond)
+	: name(name)
+	, maxPerSecond(maxPerSecond)
+	, windowStart(0)
+	, count(0)
+	, suppressed(0)
+{
+}
+
+bool LoggerCallSite::tryLog(uint32_t& suppressedBefore)
+{
+	using namespace std::chrono;
+	const int64_t now = duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+	int64_t start = windowStart.load(std::memory_order_relaxed);
+	if (now - start >= 1000 && windowStart.compare_exchange_strong(start, now, std::memory_order_relaxed)) {
+		count.store(0, std::memory_order_relaxed);
+	}
+
+	if (count.fetch_add(1, std::memory_order_relaxed) < maxPerSecond) {
+		suppressedBefore = suppressed.exchange(0, std::memory_order_relaxed);
+		return true;
+	}
+	suppressed.fetch_add(1, std::memory_order_relaxed);
+	return false;
+}
+
+Logger::Logger() = default;
+
+Logger::~Logger()
+{
+	asyncQueue.reset();
+}
+
 void Logger::setInstance(Logger& logger)
 {
 	instance = &logger;
@@ -41,26 +220,77 @@ void Logger::setInstance(Logger& logger)
 void Logger::addSink(ILoggerSink& sink)
 {
 	Expects(instance);
+	std::unique_lock<std::recursive_mutex> lock(instance->sinksMutex);
 	instance->sinks.insert(&sink);
 }
 
 void Logger::removeSink(ILoggerSink& sink)
 {
 	Expects(instance);
+	std::unique_lock<std::recursive_mutex> lock(instance->sinksMutex);
 	instance->sinks.erase(&sink);
 }
 
+void Logger::setAsync(bool enabled, size_t queueSize)
+{
+	Expects(instance);
+	if (enabled && !instance->asyncQueue) {
+		instance->asyncQueue = std::make_unique<AsyncLogQueue>(*instance, queueSize);
+	} else if (!enabled) {
+		instance->asyncQueue.reset();
+	}
+}
+
+bool Logger::isAsync()
+{
+	return instance && instance->asyncQueue;
+}
+
+void Logger::flush()
+{
+	if (instance && instance->asyncQueue) {
+		instance->asyncQueue->flush();
+	}
+}
+
 void Logger::log(LoggerLevel level, const String& msg)
 {
 	if (instance) {
-		for (auto& s: instance->sinks) {
-			s->log(level, msg);
+		if (auto* queue = instance->asyncQueue.get()) {
+			size_t position;
+			if (queue->push(level, msg, position)) {
+				if (level == LoggerLevel::Error) {
+					queue->waitFor(position + 1);
+				}
+			} else if (level == LoggerLevel::Error) {
+				// Never drop errors; this is out of order, but better than nothing
+				instance->dispatch(level, msg);
+			}
+		} else {
+			instance->dispatch(level, msg);
 		}
 	} else {
 		std::cout << msg << std::endl;
 	}
 }
 
+void Logger::log(LoggerCallSite& callSite, LoggerLevel level, const String& msg)
+{
+	uint32_t suppressed;
+	if (!callSite.tryLog(suppressed)) {
+		if (instance) {
+			instance->droppedRateLimited.fetch_add(1, std::memory_order_relaxed);
+		}
+		return;
+	}
+
+	if (suppressed > 0) {
+		log(level, msg + " (" + toString(suppressed) + " more from " + callSite.getName() + " were suppressed)");
+	} else {
+		log(level, msg);
+	}
+}
+
 void Logger::logDev(const String& msg)
 {
 	log(LoggerLevel::Dev, msg);
@@ -86,4 +316,29 @@ void Logger::logException(const std::exception& e)
 	logError(e.what());
 }
 
+LoggerStats Logger::getStats()
+{
+	LoggerStats stats;
+	if (instance) {
+		stats.logged = instance->logged.load(std::memory_order_relaxed);
+		stats.droppedQueueFull = instance->asyncQueue ? instance->asyncQueue->getDropped() : 0;
+		stats.droppedRateLimited = instance->droppedRateLimited.load(std::memory_order_relaxed);
+	}
+	return stats;
+}
+
+void Logger::dispatch(LoggerLevel level, const String& msg)
+{
+	logged.fetch_add(1, std::memory_order_relaxed);
+	const bool wasDispatching = dispatchingLog;
+	dispatchingLog = true;
+	{
+		std::unique_lock<std::recursive_mutex> lock(sinksMutex);
+		for (auto& s: sinks) {
+			s->log(level, msg);
+		}
+	}
+	dispatchingLog = wasDispatching;
+}
+
 Logger* Logger::instance = nullptr;
@@ -0,0 +1,262 @@
+#include "halley/support/memory_tracker.h"
+#include "halley/resources/resource.h"
+#include "halley/text/string_converter.h"
+#include <gsl/gsl>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+#include <iomanip>
+
+using namespace Halley;
+
+namespace {
+	constexpr size_t numFixedTags = size_t(MemoryTag::Graphics) + 1;
+	constexpr size_t numAssetTypes = EnumNames<AssetType>()().size();
+	constexpr size_t numTags = numFixedTags + numAssetTypes;
+
+	thread_local size_t currentTag = 0;
+
+#ifdef HALLEY_MEMORY_TRACKING
+	struct TagCounters
+	{
+		std::atomic<size_t> liveBytes { 0 };
+		std::atomic<size_t> peakBytes { 0 };
+		std::atomic<size_t> liveAllocations { 0 };
+		std::atomic<uint64_t> totalAllocations { 0 };
+		std::atomic<uint64_t> frameStartAllocations { 0 };
+		std::atomic<uint64_t> lastFrameAllocations { 0 };
+
+		void onAlloc(size_t bytes)
+		{
+			const size_t live = liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+			size_t peak = peakBytes.load(std::memory_order_relaxed);
+			while (live > peak && !peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+			liveAllocations.fetch_add(1, std::memory_order_relaxed);
+			totalAllocations.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		void onFree(size_t bytes)
+		{
+			liveBytes.fetch_sub(bytes, std::memory_order_relaxed);
+			liveAllocations.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+		void nextFrame()
+		{
+			const uint64_t total = totalAllocations.load(std::memory_order_relaxed);
+			lastFrameAllocations.store(total - frameStartAllocations.exchange(total, std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+
+		MemoryTagStats getStats() const
+		{
+			MemoryTagStats stats;
+			stats.liveBytes = liveBytes.load(std::memory_order_relaxed);
+			stats.peakBytes = peakBytes.load(std::memory_order_relaxed);
+			stats.liveAllocations = liveAllocations.load(std::memory_order_relaxed);
+			stats.totalAllocations = totalAllocations.load(std::memory_order_relaxed);
+			stats.lastFrameAllocations = lastFrameAllocations.load(std::memory_order_relaxed);
+			return stats;
+		}
+	};
+
+	// These are constant initialized, so they're usable by allocations made before main()
+	TagCounters tagCounters[numTags];
+	TagCounters totalCounters;
+
+	// Keeps the allocation aligned as malloc's would be
+	struct alignas(16) AllocationHeader
+	{
+		size_t size;
+		uint32_t tag;
+	};
+
+	void* trackedAlloc(size_t size) noexcept
+	{
+		auto* header = static_cast<AllocationHeader*>(std::malloc(sizeof(AllocationHeader) + size));
+		if (!header) {
+			return nullptr;
+		}
+		header->size = size;
+		header->tag = uint32_t(currentTag);
+		tagCounters[currentTag].onAlloc(size);
+		totalCounters.onAlloc(size);
+		return header + 1;
+	}
+
+	void* trackedAllocOrThrow(size_t size)
+	{
+		while (true) {
+			void* result = trackedAlloc(size);
+			if (result) {
+				return result;
+			}
+			auto handler = std::get_new_handler();
+			if (!handler) {
+				throw std::bad_alloc();
+			}
+			handler();
+		}
+	}
+
+	void trackedFree(void* p) noexcept
+	{
+		if (p) {
+			auto* header = static_cast<AllocationHeader*>(p) - 1;
+			tagCounters[header->tag].onFree(header->size);
+			totalCounters.onFree(header->size);
+			std::free(header);
+		}
+	}
+#endif
+
+	String formatBytesDelta(long long bytes)
+	{
+		return (bytes < 0 ? "-" : "+") + String::prettySize(std::abs(bytes));
+	}
+
+	String formatCountDelta(long long count)
+	{
+		return (count < 0 ? "" : "+") + toString(count);
+	}
+}
+
+#ifdef HALLEY_MEMORY_TRACKING
+void* operator new(size_t size) { return trackedAllocOrThrow(size); }
+void* operator new[](size_t size) { return trackedAllocOrThrow(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return trackedAlloc(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return trackedAlloc(size); }
+void operator delete(void* p) noexcept { trackedFree(p); }
+void operator delete[](void* p) noexcept { trackedFree(p); }
+void operator delete(void* p, size_t) noexcept { trackedFree(p); }
+void operator delete[](void* p, size_t) noexcept { trackedFree(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { trackedFree(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { trackedFree(p); }
+#endif
+
+size_t MemoryTracker::getNumTags()
+{
+	return numTags;
+}
+
+size_t MemoryTracker::getTag(MemoryTag tag)
+{
+	return size_t(tag);
+}
+
+size_t MemoryTracker::getTag(AssetType type)
+{
+	return numFixedTags + size_t(type);
+}
+
+String MemoryTracker::getTagName(size_t tag)
+{
+	if (tag >= numFixedTags) {
+		return "resources/" + toString(AssetType(tag - numFixedTags));
+	}
+	const char* names[] = { "untagged", "entity", "resources", "audio", "ui", "net", "graphics" };
+	static_assert(sizeof(names) / sizeof(names[0]) == numFixedTags, "Missing tag names");
+	return names[tag];
+}
+
+size_t MemoryTracker::getCurrentTag()
+{
+	return currentTag;
+}
+
+void MemoryTracker::setCurrentTag(size_t tag)
+{
+	Expects(tag < numTags);
+	currentTag = tag;
+}
+
+void MemoryTracker::nextFrame()
+{
+#ifdef HALLEY_MEMORY_TRACKING
+	for (auto& c: tagCounters) {
+		c.nextFrame();
+	}
+	totalCounters.nextFrame();
+#endif
+}
+
+MemorySnapshot MemoryTracker::capture()
+{
+	MemorySnapshot result;
+	result.tags.resize(numTags);
+#ifdef HALLEY_MEMORY_TRACKING
+	for (size_t i = 0; i < numTags; ++i) {
+		result.tags[i] = tagCounters[i].getStats();
+	}
+	result.total = totalCounters.getStats();
+#endif
+	return result;
+}
+
+String MemorySnapshot::toString() const
+{
+	std::stringstream ss;
+	ss << std::left << std::setw(28) << "tag" << std::right << std::setw(14) << "live" << std::setw(14) << "peak"
+		<< std::setw(12) << "allocs" << std::setw(12) << "last frame" << "\n";
+
+	auto writeLine = [&] (const String& name, const MemoryTagStats& stats)
+	{
+		ss << std::left << std::setw(28) << name.cppStr() << std::right
+			<< std::setw(14) << String::prettySize(stats.liveBytes).cppStr()
+			<< std::setw(14) << String::prettySize(stats.peakBytes).cppStr()
+			<< std::setw(12) << stats.liveAllocations
+			<< std::setw(12) << stats.lastFrameAllocations << "\n";
+	};
+
+	for (size_t i = 0; i < tags.size(); ++i) {
+		if (tags[i].totalAllocations > 0) {
+			writeLine(MemoryTracker::getTagName(i), tags[i]);
+		}
+	}
+	writeLine("total", total);
+	return ss.str();
+}
+
+String MemorySnapshot::diff(const MemorySnapshot& before) const
+{
+	std::stringstream ss;
+	ss << std::left << std::setw(28) << "tag" << std::right << std::setw(14) << "live" << std::setw(12) << "allocs"
+		<< std::setw(12) << "new allocs" << "\n";
+
+	auto writeLine = [&] (const String& name, const MemoryTagStats& now, const MemoryTagStats& prev)
+	{
+		const long long bytes = static_cast<long long>(now.liveBytes) - static_cast<long long>(prev.liveBytes);
+		const long long allocs = static_cast<long long>(now.liveAllocations) - static_cast<long long>(prev.liveAllocations);
+		ss << std::left << std::setw(28) << name.cppStr() << std::right
+			<< std::setw(14) << formatBytesDelta(bytes).cppStr()
+			<< std::setw(12) << formatCountDelta(allocs).cppStr()
+			<< std::setw(12) << (now.totalAllocations - prev.totalAllocations) << "\n";
+	};
+
+	const MemoryTagStats none;
+	for (size_t i = 0; i < tags.size(); ++i) {
+		const auto& prev = i < before.tags.size() ? before.tags[i] : none;
+		if (tags[i].totalAllocations != prev.totalAllocations) {
+			writeLine(MemoryTracker::getTagName(i), tags[i], prev);
+		}
+	}
+	writeLine("total", total, before.total);
+	return ss.str();
+}
+
+MemoryTagScope::MemoryTagScope(MemoryTag tag)
+	: prevTag(currentTag)
+{
+	currentTag = MemoryTracker::getTag(tag);
+}
+
+MemoryTagScope::MemoryTagScope(AssetType type)
+	: prevTag(currentTag)
+{
+	currentTag = MemoryTracker::getTag(type);
+}
+
+MemoryTagScope::~MemoryTagScope()
+{
+	currentTag = prevTag;
+}
@@ -0,0 +1,249 @@
+#include "halley/support/profiler.h"
+#include "halley/file/path.h"
+#include "halley/text/string_id.h"
+#include <chrono>
+#include <mutex>
+#include <memory>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cstring>
+
+using namespace Halley;
+
+namespace {
+	// Single producer (the owning thread), read by whoever exports. The reader copies without locking and then
+	// discards anything that might have been overwritten while it was copying.
+	class ThreadBuffer
+	{
+	public:
+		ThreadBuffer(size_t index)
+			: index(index)
+			, events(Profiler::eventsPerThread)
+			, written(0)
+		{}
+
+		void push(const ProfilerEvent& e)
+		{
+			const uint64_t pos = written.load(std::memory_order_relaxed);
+			events[pos % events.size()] = e;
+			written.store(pos + 1, std::memory_order_release);
+		}
+
+		Vector<ProfilerEvent> read() const
+		{
+			const uint64_t cap = events.size();
+			const uint64_t end = written.load(std::memory_order_acquire);
+			const uint64_t start = end > cap ? end - cap : 0;
+
+			Vector<ProfilerEvent> result;
+			result.reserve(size_t(end - start));
+			for (uint64_t i = start; i < end; ++i) {
+				result.push_back(events[i % cap]);
+			}
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			const uint64_t after = written.load(std::memory_order_relaxed);
+			const uint64_t firstValid = after + 1 > cap ? after + 1 - cap : 0;
+			if (firstValid > start) {
+				result.erase(result.begin(), result.begin() + std::min(size_t(firstValid - start), result.size()));
+			}
+			return result;
+		}
+
+		size_t index;
+		String name;
+
+	private:
+		Vector<ProfilerEvent> events;
+		std::atomic<uint64_t> written;
+	};
+
+	struct ProfilerState
+	{
+		std::mutex mutex;
+		Vector<std::unique_ptr<ThreadBuffer>> threads;
+		ThreadBuffer* gpu = nullptr;
+		std::atomic<uint32_t> frame;
+		const std::chrono::steady_clock::time_point epoch;
+
+		ProfilerState()
+			: frame(0)
+			, epoch(std::chrono::steady_clock::now())
+		{}
+	};
+
+	ProfilerState& getState()
+	{
+		static ProfilerState state;
+		return state;
+	}
+
+	thread_local ThreadBuffer* currentThread = nullptr;
+	thread_local String currentThreadName;
+
+	ThreadBuffer& getThreadBuffer()
+	{
+		if (!currentThread) {
+			auto& state = getState();
+			std::unique_lock<std::mutex> lock(state.mutex);
+			state.threads.push_back(std::make_unique<ThreadBuffer>(state.threads.size()));
+			currentThread = state.threads.back().get();
+			currentThread->name = currentThreadName.isEmpty() ? "Thread " + toString(currentThread->index) : currentThreadName;
+		}
+		return *currentThread;
+	}
+
+	void writeJSONString(std::ostream& os, const char* str)
+	{
+		os << '"';
+		for (const char* c = str; *c; ++c) {
+			if (*c == '"' || *c == '\\') {
+				os << '\\' << *c;
+			} else if (static_cast<unsigned char>(*c) >= 0x20) {
+				os << *c;
+			}
+		}
+		os << '"';
+	}
+}
+
+std::atomic<bool> Profiler::enabled(false);
+
+Profiler::Scope::Scope(const char* name, ProfilerEventType type)
+	: name(name)
+	, type(type)
+	, active(isEnabled())
+{
+	startNs = active ? getTimeNs() : 0;
+}
+
+Profiler::Scope::~Scope()
+{
+	if (active) {
+		record(name, type, startNs, getTimeNs());
+	}
+}
+
+void Profiler::setEnabled(bool e)
+{
+	enabled.store(e, std::memory_order_relaxed);
+}
+
+void Profiler::nextFrame()
+{
+	getState().frame.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint32_t Profiler::getFrameNumber()
+{
+	return getState().frame.load(std::memory_order_relaxed);
+}
+
+int64_t Profiler::getTimeNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - getState().epoch).count();
+}
+
+void Profiler::record(const char* name, ProfilerEventType type, int64_t startNs, int64_t endNs)
+{
+	if (isEnabled()) {
+		getThreadBuffer().push(ProfilerEvent{ name, startNs, endNs, getFrameNumber(), type });
+	}
+}
+
+void Profiler::recordGPU(const char* name, int64_t startNs, int64_t endNs)
+{
+	if (isEnabled()) {
+		auto& state = getState();
+		if (!state.gpu) {
+			std::unique_lock<std::mutex> lock(state.mutex);
+			state.threads.push_back(std::make_unique<ThreadBuffer>(state.threads.size()));
+			state.gpu = state.threads.back().get();
+			state.gpu->name = "GPU";
+		}
+		state.gpu->push(ProfilerEvent{ name, startNs, endNs, getFrameNumber(), ProfilerEventType::GPU });
+	}
+}
+
+void Profiler::recordCounter(const char* name, float value)
+{
+	if (isEnabled()) {
+		const auto now = getTimeNs();
+		getThreadBuffer().push(ProfilerEvent{ name, now, now, getFrameNumber(), ProfilerEventType::Counter, value });
+	}
+}
+
+void Profiler::setThreadName(const String& name)
+{
+	// The buffer itself is only allocated once this thread records something
+	currentThreadName = name;
+	if (currentThread) {
+		std::unique_lock<std::mutex> lock(getState().mutex);
+		currentThread->name = name;
+	}
+}
+
+const char* Profiler::internName(const String& name)
+{
+	// Interned strings are never freed or moved
+	return StringId(name).getString().c_str();
+}
+
+Vector<std::pair<String, Vector<ProfilerEvent>>> Profiler::getEvents()
+{
+	auto& state = getState();
+	std::unique_lock<std::mutex> lock(state.mutex);
+
+	Vector<std::pair<String, Vector<ProfilerEvent>>> result;
+	for (auto& t: state.threads) {
+		auto events = t->read();
+		if (!events.empty()) {
+			result.emplace_back(t->name, std::move(events));
+		}
+	}
+	return result;
+}
+
+String Profiler::exportChromeTrace()
+{
+	std::stringstream ss;
+	ss << std::fixed << std::setprecision(3);
+	ss << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+	bool first = true;
+	int tid = 0;
+	for (auto& thread: getEvents()) {
+		ss << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << tid << ",\"args\":{\"name\":";
+		writeJSONString(ss, thread.first.c_str());
+		ss << "}}";
+		first = false;
+
+		for (auto& e: thread.second) {
+			if (e.type == ProfilerEventType::Counter) {
+				ss << ",\n{\"name\":";
+				writeJSONString(ss, e.name);
+				ss << ",\"ph\":\"C\",\"pid\":0,\"ts\":" << (double(e.startNs) / 1000.0) << ",\"args\":{\"value\":" << e.value << "}}";
+				continue;
+			}
+
+			ss << ",\n{\"name\":";
+			writeJSONString(ss, e.name);
+			ss << ",\"cat\":\"" << toString(e.type) << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << tid
+				<< ",\"ts\":" << (double(e.startNs) / 1000.0) << ",\"dur\":" << (double(e.endNs - e.startNs) / 1000.0)
+				<< ",\"args\":{\"frame\":" << e.frame << "}}";
+		}
+		++tid;
+	}
+
+	ss << "\n]}\n";
+	return ss.str();
+}
+
+void Profiler::exportChromeTrace(const Path& path)
+{
+	const auto json = exportChromeTrace();
+	Bytes bytes(json.size());
+	memcpy(bytes.data(), json.c_str(), json.size());
+	Path::writeFile(path, bytes);
+}
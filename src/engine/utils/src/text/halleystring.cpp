@@ -60,6 +60,12 @@ String::String(const std::basic_string<Character>& _str)
 }
 
 
+String::String(std::basic_string<Character>&& _str) noexcept
+: str(std::move(_str))
+{
+}
+
+
 String::String(const wchar_t* utf16)
 {
 	size_t len = getUTF8Len(utf16);
@@ -76,13 +82,13 @@ String::String(const StringUTF32& utf32)
 }
 
 String::String(const String& other) noexcept
+: str(other.str)
 {
-	str = other.str;
 }
 
 String::String(String&& other) noexcept
+: str(std::move(other.str))
 {
-	str = std::move(other.str);
 }
 
 
@@ -466,45 +472,45 @@ void String::asciiMakeLower()
 
 ///////////////
 
-String String::operator += (const String &p)
+String& String::operator += (const String &p)
 {
 	str.append(p);
 	return *this;
 }
 
 #ifdef WX_COMPAT
-String String::operator += (const wxString &p)
+String& String::operator += (const wxString &p)
 {
 	str.append(String(p));
 	return *this;
 }
 #endif
 
-String String::operator += (const char* p)
+String& String::operator += (const char* p)
 {
 	str.append(p);
 	return *this;
 }
 
-String String::operator += (const wchar_t* p)
+String& String::operator += (const wchar_t* p)
 {
 	str.append(String(p));
 	return *this;
 }
 
-String String::operator += (const double &p)
+String& String::operator += (const double &p)
 {
 	str.append(toString(p));
 	return *this;
 }
 
-String String::operator += (const int &p)
+String& String::operator += (const int &p)
 {
 	str.append(toString(p));
 	return *this;
 }
 
-String String::operator += (const Character &p)
+String& String::operator += (const Character &p)
 {
 	str.append(1,p);
 	return *this;
@@ -786,11 +792,19 @@ StringUTF16 String::getUTF16() const
 StringUTF32 String::getUTF32() const
 {
 	StringUTF32 result(getUTF32Len(), wchar_t(0));
+	if (!result.empty()) {
+		getUTF32(gsl::span<utf32type>(&result[0], result.size()));
+	}
+	return result;
+}
 
+size_t String::getUTF32(gsl::span<utf32type> result) const
+{
+	const size_t dstLen = size_t(result.size());
 	size_t len = length();
 	size_t dst = 0;
 	utf32type dstChar = 0;
-	for (size_t i=0; i<len;) {
+	for (size_t i=0; i<len && dst<dstLen;) {
 		unsigned int c0 = static_cast<unsigned char>(operator[](i++));
 
 		// 1 byte
@@ -829,7 +843,7 @@ StringUTF32 String::getUTF32() const
 		dstChar = 0;
 	}
 
-	return result;
+	return dst;
 }
 
 size_t Halley::String::getUTF32Len() const
@@ -998,7 +1012,44 @@ std::istream& Halley::operator>> (std::istream& is, String& rhp)
 
 String Halley::operator+ (const String& lhp, const String& rhp)
 {
-	return String(lhp.cppStr() + rhp.cppStr());
+	std::string result;
+	result.reserve(lhp.size() + rhp.size());
+	result.append(lhp.cppStr());
+	result.append(rhp.cppStr());
+	return String(std::move(result));
+}
+
+String Halley::operator+ (String&& lhp, const String& rhp)
+{
+	// Appending to the temporary on the left reuses its buffer, which makes chains of + a single growing allocation
+	lhp.cppStr().append(rhp.cppStr());
+	return std::move(lhp);
+}
+
+String Halley::operator+ (const String& lhp, const char* rhp)
+{
+	const size_t rhpLen = strlen(rhp);
+	std::string result;
+	result.reserve(lhp.size() + rhpLen);
+	result.append(lhp.cppStr());
+	result.append(rhp, rhpLen);
+	return String(std::move(result));
+}
+
+String Halley::operator+ (String&& lhp, const char* rhp)
+{
+	lhp.cppStr().append(rhp);
+	return std::move(lhp);
+}
+
+String Halley::operator+ (const char* lhp, const String& rhp)
+{
+	const size_t lhpLen = strlen(lhp);
+	std::string result;
+	result.reserve(lhpLen + rhp.size());
+	result.append(lhp, lhpLen);
+	result.append(rhp.cppStr());
+	return String(std::move(result));
 }
 
 bool String::operator== (const String& rhp) const
@@ -1,19 +1,29 @@
 #include <utility>
+#include <algorithm>
 #include "halley/text/i18n.h"
 #include "halley/file_formats/config_file.h"
+#include "halley/file_formats/config_node_view.h"
 
 using namespace Halley;
 
+struct I18N::LocalisationFile {
+	const ConfigFile* file;
+	ConfigObserver observer;
+};
+
 I18N::I18N()
 {
 }
 
+I18N::~I18N() = default;
+
 void I18N::update()
 {
-	for (auto& o: observers) {
-		if (o.second.needsUpdate()) {
-			o.second.update();
-			loadLocalisation(o.second.getRoot());
+	for (auto& f: files) {
+		if (f.second.observer.needsUpdate()) {
+			f.second.observer.update();
+			addLanguageTables(*f.second.file);
+			++version;
 		}
 	}
 }
@@ -31,26 +41,54 @@ void I18N::setFallbackLanguage(const I18NLanguage& code)
 
 void I18N::loadLocalisationFile(const ConfigFile& config)
 {
-	loadLocalisation(config.getRoot());
-	observers[config.getAssetId()] = ConfigObserver(config);
+	addLanguageTables(config);
+	files[config.getAssetId()] = LocalisationFile{ &config, ConfigObserver(config) };
+	++version;
+}
+
+void I18N::addLanguageTables(const ConfigFile& file)
+{
+	// Only the language entries are indexed; the strings themselves are looked up in the file when needed
+	for (auto& lang: languages) {
+		auto& tables = lang.second;
+		tables.erase(std::remove_if(tables.begin(), tables.end(), [&] (const LanguageTable& t) { return t.file == &file; }), tables.end());
+	}
+
+	file.getRootView().forEachEntry([&] (const char* language, const ConfigNodeView&)
+	{
+		languages[I18NLanguage(language)].push_back(LanguageTable{ &file, language });
+	});
 }
 
-void I18N::loadLocalisation(const ConfigNode& root)
+ConfigNodeView I18N::find(const I18NLanguage& language, const String& key) const
 {
-	for (auto& language: root.asMap()) {
-		auto langCode = I18NLanguage(language.first);
-		auto& lang = strings[langCode];
-		for (auto& e: language.second.asMap()) {
-			lang[e.first] = e.second.asString();
+	const auto lang = languages.find(language);
+	if (lang != languages.end()) {
+		const auto& tables = lang->second;
+		for (auto i = tables.rbegin(); i != tables.rend(); ++i) {
+			// Asked from the file every time, as its data is replaced when it's reloaded
+			auto value = i->file->getRootView()[i->key][key];
+			if (value.getType() != ConfigNodeType::Undefined) {
+				return value;
+			}
 		}
 	}
-	++version;
+	return ConfigNodeView();
+}
+
+ConfigNodeView I18N::find(const String& key) const
+{
+	auto value = find(currentLanguage, key);
+	if (value.getType() == ConfigNodeType::Undefined && fallbackLanguage && fallbackLanguage.get() != currentLanguage) {
+		value = find(fallbackLanguage.get(), key);
+	}
+	return value;
 }
 
 std::vector<I18NLanguage> I18N::getLanguagesAvailable() const
 {
 	std::vector<I18NLanguage> result;
-	for (auto& e: strings) {
+	for (auto& e: languages) {
 		result.push_back(e.first);
 	}
 	return result;
@@ -58,27 +96,19 @@ std::vector<I18NLanguage> I18N::getLanguagesAvailable() const
 
 LocalisedString I18N::get(const String& key) const
 {
-	auto curLang = strings.find(currentLanguage);
-	if (curLang != strings.end()) {
-		auto i = curLang->second.find(key);
-		if (i != curLang->second.end()) {
-			return LocalisedString(*this, key, i->second);
-		}
+	const auto value = find(key);
+	if (value.getType() != ConfigNodeType::Undefined) {
+		return LocalisedString(*this, key, value.asString());
 	}
-
-	if (fallbackLanguage && fallbackLanguage.get() != currentLanguage) {
-		auto defLang = strings.find(fallbackLanguage.get());
-		if (defLang != strings.end()) {
-			auto i = defLang->second.find(key);
-			if (i != defLang->second.end()) {
-				return LocalisedString(*this, key, i->second);
-			}
-		}
-	}
-
 	return LocalisedString(*this, key, "#MISSING#");
 }
 
+const char* I18N::getCString(const String& key) const
+{
+	const auto value = find(key);
+	return value.getType() == ConfigNodeType::String ? value.asCString() : nullptr;
+}
+
 LocalisedString I18N::getPreProcessedUserString(const String& string) const
 {
 	if (string.startsWith("$")) {
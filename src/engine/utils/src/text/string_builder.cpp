@@ -0,0 +1,100 @@
+#include "halley/text/string_builder.h"
+#include <cstring>
+
+using namespace Halley;
+
+StringBuilder::StringBuilder(size_t capacity)
+{
+	buffer.reserve(capacity);
+}
+
+void StringBuilder::clear()
+{
+	buffer.clear();
+}
+
+void StringBuilder::reserve(size_t capacity)
+{
+	buffer.reserve(capacity);
+}
+
+String StringBuilder::toString() const
+{
+	return String(buffer);
+}
+
+String StringBuilder::release()
+{
+	String result(std::move(buffer));
+	buffer.clear();
+	return result;
+}
+
+StringBuilder& StringBuilder::append(const char* str)
+{
+	buffer.append(str);
+	return *this;
+}
+
+StringBuilder& StringBuilder::append(const char* str, size_t length)
+{
+	buffer.append(str, length);
+	return *this;
+}
+
+StringBuilder& StringBuilder::append(const String& str)
+{
+	buffer.append(str.cppStr());
+	return *this;
+}
+
+StringBuilder& StringBuilder::append(const std::string& str)
+{
+	buffer.append(str);
+	return *this;
+}
+
+StringBuilder& StringBuilder::append(char c)
+{
+	buffer.push_back(c);
+	return *this;
+}
+
+StringBuilder& StringBuilder::append(bool value)
+{
+	buffer.push_back(value ? '1' : '0');
+	return *this;
+}
+
+StringBuilder& StringBuilder::appendFloat(double value, int precisionDigits, char decimalSeparator)
+{
+	Expects(precisionDigits >= -1 && precisionDigits <= 20);
+
+	// Written straight into the end of the buffer, growing it if the first attempt didn't fit
+	const size_t start = buffer.size();
+	buffer.resize(start + StringConverterDetail::floatBufferSize);
+	const size_t len = StringConverterDetail::writeFloat(&buffer[start], StringConverterDetail::floatBufferSize, value, precisionDigits, decimalSeparator);
+	if (len >= StringConverterDetail::floatBufferSize) {
+		buffer.resize(start + len + 1);
+		StringConverterDetail::writeFloat(&buffer[start], len + 1, value, precisionDigits, decimalSeparator);
+	}
+	buffer.resize(start + len);
+	return *this;
+}
+
+const char* StringBuilder::appendFormatUntilPlaceholder(const char* fmt)
+{
+	const char* runStart = fmt;
+	for (const char* c = fmt; *c; ++c) {
+		if ((c[0] == '{' && c[1] == '{') || (c[0] == '}' && c[1] == '}')) {
+			buffer.append(runStart, c + 1);
+			runStart = c + 2;
+			++c;
+		} else if (c[0] == '{' && c[1] == '}') {
+			buffer.append(runStart, c);
+			return c + 2;
+		}
+	}
+	buffer.append(runStart);
+	return nullptr;
+}
@@ -0,0 +1,71 @@
+#include "halley/text/string_converter.h"
+#include <cstdio>
+#include <cstring>
+
+using namespace Halley;
+
+size_t StringConverterDetail::writeInteger(char* dst, uint64_t magnitude, bool negative, int base)
+{
+	constexpr const char* digits = "0123456789abcdef";
+
+	// Written backwards from the end of a scratch buffer, then moved into place
+	char tmp[integerBufferSize];
+	size_t pos = integerBufferSize;
+	do {
+		tmp[--pos] = digits[magnitude % uint64_t(base)];
+		magnitude /= uint64_t(base);
+	} while (magnitude != 0);
+	if (negative) {
+		tmp[--pos] = '-';
+	}
+
+	const size_t len = integerBufferSize - pos;
+	memcpy(dst, tmp + pos, len);
+	return len;
+}
+
+size_t StringConverterDetail::writeFloat(char* dst, size_t dstSize, long double value, int precisionDigits, char decimalSeparator)
+{
+	// %g and %f are what streams use for the default and fixed formats
+	const int result = precisionDigits == -1
+		? snprintf(dst, dstSize, "%Lg", value)
+		: snprintf(dst, dstSize, "%.*Lf", precisionDigits, value);
+	if (result < 0) {
+		throw Exception("Unable to format number.", HalleyExceptions::Utils);
+	}
+	size_t len = size_t(result);
+	if (len >= dstSize) {
+		return len;
+	}
+
+	char* point = static_cast<char*>(memchr(dst, '.', len));
+	if (!point) {
+		return len;
+	}
+
+	if (precisionDigits == -1) {
+		// %g already drops trailing zeros, but String::prettyFloat used to make sure of it
+		char* exponent = static_cast<char*>(memchr(point, 'e', len - size_t(point - dst)));
+		char* mantissaEnd = exponent ? exponent : dst + len;
+		char* newEnd = mantissaEnd;
+		while (newEnd[-1] == '0') {
+			--newEnd;
+		}
+		if (newEnd - 1 == point) {
+			--newEnd;
+			point = nullptr;
+		}
+		if (newEnd != mantissaEnd) {
+			const size_t exponentLen = size_t(dst + len - mantissaEnd);
+			memmove(newEnd, mantissaEnd, exponentLen);
+			len -= size_t(mantissaEnd - newEnd);
+			dst[len] = 0;
+		}
+	}
+
+	if (decimalSeparator != '.' && point) {
+		*point = decimalSeparator;
+	}
+
+	return len;
+}
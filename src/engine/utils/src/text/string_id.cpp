@@ -0,0 +1,170 @@
+#include "halley/text/string_id.h"
+#include "halley/data_structures/hash_map.h"
+#include "halley/support/exception.h"
+#include "halley/text/string_converter.h"
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <shared_mutex>
+
+using namespace Halley;
+
+namespace {
+	struct Entry
+	{
+		String str;
+		uint64_t hash = 0;
+		uint32_t nextWithSameHash = 0; // Ids are never 0 here, as that's always the empty string
+	};
+
+	// Entries live in fixed size chunks that are never moved or freed, so reading an id's entry doesn't need a lock
+	class StringIdTable
+	{
+	public:
+		constexpr static size_t chunkBits = 12;
+		constexpr static size_t chunkSize = size_t(1) << chunkBits;
+		constexpr static size_t maxChunks = 4096;
+
+		StringIdTable()
+		{
+			for (auto& c: chunks) {
+				c.store(nullptr, std::memory_order_relaxed);
+			}
+			const uint32_t emptyId = add("", 0, hashStringLiteral("", 0));
+			Ensures(emptyId == 0);
+		}
+
+		uint32_t intern(const char* str, size_t length, uint64_t hash)
+		{
+			{
+				std::shared_lock<std::shared_timed_mutex> lock(mutex);
+				const uint32_t id = find(str, length, hash);
+				if (id != notFound) {
+					return id;
+				}
+			}
+
+			std::unique_lock<std::shared_timed_mutex> lock(mutex);
+			const uint32_t id = find(str, length, hash);
+			if (id != notFound) {
+				return id;
+			}
+			return add(str, length, hash);
+		}
+
+		const Entry& get(uint32_t id) const
+		{
+			if (id >= count.load(std::memory_order_acquire)) {
+				throw Exception("Invalid StringId: " + toString(id), HalleyExceptions::Utils);
+			}
+			return chunks[id >> chunkBits].load(std::memory_order_acquire)[id & (chunkSize - 1)];
+		}
+
+		size_t size() const
+		{
+			return count.load(std::memory_order_acquire);
+		}
+
+	private:
+		constexpr static uint32_t notFound = std::numeric_limits<uint32_t>::max();
+
+		std::shared_timed_mutex mutex;
+		HashMap<uint64_t, uint32_t> byHash; // First id with each hash; the rest are chained from its entry
+		std::array<std::atomic<Entry*>, maxChunks> chunks;
+		std::atomic<uint32_t> count { 0 };
+
+		uint32_t find(const char* str, size_t length, uint64_t hash) const
+		{
+			auto iter = byHash.find(hash);
+			if (iter == byHash.end()) {
+				return notFound;
+			}
+			for (uint32_t id = iter->second; ; ) {
+				const auto& entry = getUnchecked(id);
+				if (entry.str.size() == length && memcmp(entry.str.c_str(), str, length) == 0) {
+					return id;
+				}
+				if (entry.nextWithSameHash == 0) {
+					return notFound;
+				}
+				id = entry.nextWithSameHash;
+			}
+		}
+
+		uint32_t add(const char* str, size_t length, uint64_t hash)
+		{
+			const uint32_t id = count.load(std::memory_order_relaxed);
+			const size_t chunk = id >> chunkBits;
+			if (chunk >= maxChunks) {
+				throw Exception("Too many interned strings.", HalleyExceptions::Utils);
+			}
+			if (!chunks[chunk].load(std::memory_order_relaxed)) {
+				chunks[chunk].store(new Entry[chunkSize], std::memory_order_release);
+			}
+
+			auto& entry = getUnchecked(id);
+			entry.str = String(str, length);
+			entry.hash = hash;
+
+			auto iter = byHash.find(hash);
+			if (iter == byHash.end()) {
+				byHash[hash] = id;
+			} else {
+				// Append to the end of the chain
+				auto* last = &getUnchecked(iter->second);
+				while (last->nextWithSameHash != 0) {
+					last = &getUnchecked(last->nextWithSameHash);
+				}
+				last->nextWithSameHash = id;
+			}
+
+			count.store(id + 1, std::memory_order_release);
+			return id;
+		}
+
+		Entry& getUnchecked(uint32_t id) const
+		{
+			return chunks[id >> chunkBits].load(std::memory_order_acquire)[id & (chunkSize - 1)];
+		}
+	};
+
+	StringIdTable& getTable()
+	{
+		static StringIdTable table;
+		return table;
+	}
+}
+
+StringId::StringId(const String& str)
+	: value(intern(str.c_str(), str.size(), hashStringLiteral(str.c_str(), str.size())))
+{}
+
+StringId::StringId(const char* str)
+	: value(intern(str, strlen(str), hashStringLiteral(str, strlen(str))))
+{}
+
+StringId::StringId(const StringIdLiteral& literal)
+	: value(intern(literal.getString(), literal.getLength(), literal.getHash()))
+{}
+
+const String& StringId::getString() const
+{
+	return getTable().get(value).str;
+}
+
+uint64_t StringId::getHash() const
+{
+	return getTable().get(value).hash;
+}
+
+size_t StringId::getNumInterned()
+{
+	return getTable().size();
+}
+
+uint32_t StringId::intern(const char* str, size_t length, uint64_t hash)
+{
+	return getTable().intern(str, length, hash);
+}
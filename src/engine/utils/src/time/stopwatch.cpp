@@ -82,7 +82,13 @@ void StopwatchAveraging::beginSample()
 void StopwatchAveraging::endSample()
 {
 	auto now = high_resolution_clock::now();
-	nsTaken = duration_cast<nanoseconds>(now - startTime).count();
+	addSample(duration_cast<nanoseconds>(now - startTime).count());
+}
+
+void StopwatchAveraging::addSample(int64_t ns)
+{
+	nsTaken = ns;
+	histogram.addSample(ns);
 
 	nsTakenAvgAccum += nsTaken;
 	nsTakenAvgSamples++;
@@ -107,3 +113,13 @@ int64_t StopwatchAveraging::lastElapsedNanoSeconds() const
 {
 	return nsTaken;
 }
+
+TimeHistogram& StopwatchAveraging::getHistogram()
+{
+	return histogram;
+}
+
+const TimeHistogram& StopwatchAveraging::getHistogram() const
+{
+	return histogram;
+}
@@ -0,0 +1,126 @@
+#include "halley/time/time_histogram.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+using namespace Halley;
+
+String TimeHistogramStats::toString() const
+{
+	std::stringstream ss;
+	ss << std::fixed << std::setprecision(3);
+	ss << "mean " << mean * 1e-6 << ", p50 " << p50 * 1e-6 << ", p95 " << p95 * 1e-6 << ", p99 " << p99 * 1e-6 << ", max " << max * 1e-6 << " ms (" << samples << " samples)";
+	return ss.str();
+}
+
+TimeHistogram::Buckets::Buckets()
+{
+	counts.fill(0);
+}
+
+void TimeHistogram::Buckets::add(int64_t ns)
+{
+	++counts[getBucket(ns)];
+	++samples;
+	total += ns;
+	max = std::max(max, ns);
+}
+
+void TimeHistogram::Buckets::clear()
+{
+	counts.fill(0);
+	samples = 0;
+	total = 0;
+	max = 0;
+}
+
+TimeHistogramStats TimeHistogram::Buckets::getStats() const
+{
+	TimeHistogramStats result;
+	result.samples = samples;
+	if (samples == 0) {
+		return result;
+	}
+	result.mean = total / int64_t(samples);
+	result.max = max;
+
+	// Walk the buckets once, picking each percentile as its rank is reached
+	const std::array<std::pair<double, int64_t*>, 3> percentiles = {{ { 0.50, &result.p50 }, { 0.95, &result.p95 }, { 0.99, &result.p99 } }};
+	size_t next = 0;
+	size_t seen = 0;
+	for (size_t i = 0; i < numBuckets && next < percentiles.size(); ++i) {
+		seen += counts[i];
+		while (next < percentiles.size() && double(seen) >= percentiles[next].first * double(samples)) {
+			*percentiles[next].second = std::min(getBucketValue(i), max);
+			++next;
+		}
+	}
+	return result;
+}
+
+TimeHistogram::TimeHistogram(size_t windowSamples)
+	: windowSamples(std::max(windowSamples, size_t(1)))
+{
+}
+
+void TimeHistogram::addSample(int64_t ns)
+{
+	ns = std::max(ns, int64_t(0));
+	current.add(ns);
+	total.add(ns);
+
+	if (current.samples >= windowSamples) {
+		lastWindow = current.getStats();
+		current.clear();
+	}
+}
+
+void TimeHistogram::reset()
+{
+	current.clear();
+	total.clear();
+	lastWindow = TimeHistogramStats();
+}
+
+void TimeHistogram::setWindowSamples(size_t samples)
+{
+	windowSamples = std::max(samples, size_t(1));
+}
+
+size_t TimeHistogram::getWindowSamples() const
+{
+	return windowSamples;
+}
+
+TimeHistogramStats TimeHistogram::getStats(Window window) const
+{
+	if (window == Window::Total) {
+		return total.getStats();
+	}
+	return lastWindow.samples > 0 ? lastWindow : current.getStats();
+}
+
+size_t TimeHistogram::getBucket(int64_t ns)
+{
+	const uint64_t value = std::min(uint64_t(ns), (uint64_t(1) << maxValueBits) - 1);
+
+	// Values under 2^(subBucketBits + 1) get a bucket each; above that, each power of two gets 2^subBucketBits
+	int msb = 0;
+	for (uint64_t v = value >> 1; v != 0; v >>= 1) {
+		++msb;
+	}
+	const int shift = std::max(msb - subBucketBits, 0);
+	return (size_t(shift) << subBucketBits) + size_t(value >> shift);
+}
+
+int64_t TimeHistogram::getBucketValue(size_t bucket)
+{
+	// Middle of the range covered by the bucket
+	constexpr size_t subBuckets = size_t(1) << subBucketBits;
+	if (bucket < 2 * subBuckets) {
+		return int64_t(bucket);
+	}
+	const int shift = int(bucket >> subBucketBits) - 1;
+	const uint64_t base = uint64_t(bucket - (size_t(shift) << subBucketBits)) << shift;
+	return int64_t(base + ((uint64_t(1) << shift) >> 1));
+}
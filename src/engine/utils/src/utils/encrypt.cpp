@@ -1,13 +1,42 @@
 #include <cstring>
 #include "halley/utils/encrypt.h"
 #include "../contrib/tiny-aes/aes.hpp"
+#include "encrypt_hw.h"
 #include "halley/text/halleystring.h"
 #include "halley/support/exception.h"
 #include "halley/support/logger.h"
 #include "halley/text/encode.h"
+#include "halley/concurrency/concurrent.h"
 
 using namespace Halley;
 
+namespace {
+	// Splitting finer than this isn't worth the scheduling
+	constexpr size_t blocksPerRange = 64 * 1024 / AES_BLOCKLEN;
+
+	void encryptBlocks(const AES_ctx& keys, const uint8_t* iv, uint8_t* data, size_t nBlocks)
+	{
+		if (HardwareAES::isAvailable()) {
+			HardwareAES::encryptCBC(keys.RoundKey, iv, data, nBlocks);
+		} else {
+			AES_ctx ctx = keys;
+			AES_ctx_set_iv(&ctx, iv);
+			AES_CBC_encrypt_buffer(&ctx, data, uint32_t(nBlocks * AES_BLOCKLEN));
+		}
+	}
+
+	void decryptBlocks(const AES_ctx& keys, const uint8_t* iv, uint8_t* data, size_t nBlocks)
+	{
+		if (HardwareAES::isAvailable()) {
+			HardwareAES::decryptCBC(keys.RoundKey, iv, data, nBlocks);
+		} else {
+			AES_ctx ctx = keys;
+			AES_ctx_set_iv(&ctx, iv);
+			AES_CBC_decrypt_buffer(&ctx, data, uint32_t(nBlocks * AES_BLOCKLEN));
+		}
+	}
+}
+
 Bytes Encrypt::encrypt(const Bytes& iv, const String& key, const Bytes& data)
 {
 	Expects(iv.size() == 16);
@@ -30,13 +59,28 @@ Bytes Encrypt::encrypt(const Bytes& iv, const String& key, const Bytes& data)
 
 	// Encrypt
 	AES_ctx ctx;
-	AES_init_ctx_iv(&ctx, reinterpret_cast<const uint8_t*>(key.c_str()), iv.data());
-	AES_CBC_encrypt_buffer(&ctx, result.data(), uint32_t(result.size()));
+	AES_init_ctx(&ctx, reinterpret_cast<const uint8_t*>(key.c_str()));
+	encryptBlocks(ctx, iv.data(), result.data(), result.size() / AES_BLOCKLEN);
 
 	return result;
 }
 
 Bytes Encrypt::decrypt(const Bytes& iv, const String& key, const Bytes& data)
+{
+	return doDecrypt(iv, key, data, nullptr);
+}
+
+Bytes Encrypt::decrypt(const Bytes& iv, const String& key, const Bytes& data, ExecutionQueue& queue)
+{
+	return doDecrypt(iv, key, data, &queue);
+}
+
+bool Encrypt::hasHardwareSupport()
+{
+	return HardwareAES::isAvailable();
+}
+
+Bytes Encrypt::doDecrypt(const Bytes& iv, const String& key, const Bytes& data, ExecutionQueue* queue)
 {
 	Expects(iv.size() == 16);
 	Expects(key.size() >= 16);
@@ -53,8 +97,28 @@ Bytes Encrypt::decrypt(const Bytes& iv, const String& key, const Bytes& data)
 	// Decrypt
 	AES_ctx ctx;
 	std::memset(&ctx, 0, sizeof(ctx));
-	AES_init_ctx_iv(&ctx, reinterpret_cast<const uint8_t*>(key.c_str()), iv.data());
-	AES_CBC_decrypt_buffer(&ctx, result.data(), uint32_t(result.size()));
+	AES_init_ctx(&ctx, reinterpret_cast<const uint8_t*>(key.c_str()));
+	const size_t nBlocks = result.size() / AES_BLOCKLEN;
+	const size_t nRanges = (nBlocks + blocksPerRange - 1) / blocksPerRange;
+	if (queue && nRanges > 1) {
+		// Each range's IV is the ciphertext just before it, which has to be kept before the previous range overwrites it
+		Bytes rangeIvs(nRanges * AES_BLOCKLEN);
+		memcpy(rangeIvs.data(), iv.data(), AES_BLOCKLEN);
+		for (size_t i = 1; i < nRanges; ++i) {
+			memcpy(rangeIvs.data() + i * AES_BLOCKLEN, result.data() + (i * blocksPerRange - 1) * AES_BLOCKLEN, AES_BLOCKLEN);
+		}
+
+		Concurrent::parallelFor(*queue, Range<size_t>(0, nRanges), 1, [&] (size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i) {
+				const size_t firstBlock = i * blocksPerRange;
+				const size_t n = std::min(blocksPerRange, nBlocks - firstBlock);
+				decryptBlocks(ctx, rangeIvs.data() + i * AES_BLOCKLEN, result.data() + firstBlock * AES_BLOCKLEN, n);
+			}
+		});
+	} else {
+		decryptBlocks(ctx, iv.data(), result.data(), nBlocks);
+	}
 
 	// Remove padding
 	unsigned char padSize = result.back();
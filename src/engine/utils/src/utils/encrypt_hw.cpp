@@ -0,0 +1,219 @@
+#include "encrypt_hw.h"
+
+// On x86 this file is built with AES-NI enabled (see CMakeLists.txt), and only used after checking the CPU for it
+#if defined(_M_X64) || defined(__x86_64__)
+#define AES_HW_X86
+#elif defined(__aarch64__) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES))
+#define AES_HW_ARM
+#endif
+
+#if defined(AES_HW_X86)
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#elif defined(AES_HW_ARM)
+#include <arm_neon.h>
+#endif
+
+using namespace Halley;
+
+namespace {
+	constexpr size_t numRounds = 10; // AES-128
+	constexpr size_t blockSize = 16;
+}
+
+#if defined(AES_HW_X86)
+
+namespace {
+	struct RoundKeys
+	{
+		__m128i enc[numRounds + 1];
+		__m128i dec[numRounds + 1];
+
+		explicit RoundKeys(const uint8_t* roundKeys)
+		{
+			for (size_t i = 0; i <= numRounds; ++i) {
+				enc[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(roundKeys + i * blockSize));
+			}
+
+			// Equivalent inverse cipher: reversed, with InvMixColumns applied to the middle keys
+			dec[0] = enc[numRounds];
+			for (size_t i = 1; i < numRounds; ++i) {
+				dec[i] = _mm_aesimc_si128(enc[numRounds - i]);
+			}
+			dec[numRounds] = enc[0];
+		}
+	};
+
+	inline __m128i decryptBlock(__m128i x, const RoundKeys& keys)
+	{
+		x = _mm_xor_si128(x, keys.dec[0]);
+		for (size_t r = 1; r < numRounds; ++r) {
+			x = _mm_aesdec_si128(x, keys.dec[r]);
+		}
+		return _mm_aesdeclast_si128(x, keys.dec[numRounds]);
+	}
+}
+
+bool HardwareAES::isAvailable()
+{
+	static const bool available = [] ()
+	{
+#ifdef _MSC_VER
+		int regs[4];
+		__cpuid(regs, 1);
+		return (regs[2] & (1 << 25)) != 0;
+#else
+		unsigned int a = 0, b = 0, c = 0, d = 0;
+		if (!__get_cpuid(1, &a, &b, &c, &d)) {
+			return false;
+		}
+		return (c & (1u << 25)) != 0;
+#endif
+	}();
+	return available;
+}
+
+void HardwareAES::encryptCBC(const uint8_t* roundKeys, const uint8_t* iv, uint8_t* data, size_t nBlocks)
+{
+	// Each block depends on the previous result, so this can't be interleaved
+	const RoundKeys keys(roundKeys);
+	__m128i prev = _mm_loadu_si128(reinterpret_cast<const __m128i*>(iv));
+	for (size_t i = 0; i < nBlocks; ++i) {
+		auto* block = reinterpret_cast<__m128i*>(data + i * blockSize);
+		__m128i x = _mm_xor_si128(_mm_loadu_si128(block), prev);
+		x = _mm_xor_si128(x, keys.enc[0]);
+		for (size_t r = 1; r < numRounds; ++r) {
+			x = _mm_aesenc_si128(x, keys.enc[r]);
+		}
+		x = _mm_aesenclast_si128(x, keys.enc[numRounds]);
+		_mm_storeu_si128(block, x);
+		prev = x;
+	}
+}
+
+void HardwareAES::decryptCBC(const uint8_t* roundKeys, const uint8_t* iv, uint8_t* data, size_t nBlocks)
+{
+	const RoundKeys keys(roundKeys);
+	__m128i prev = _mm_loadu_si128(reinterpret_cast<const __m128i*>(iv));
+
+	// Blocks don't depend on each other's results, so four are kept in flight to hide the instructions' latency
+	size_t i = 0;
+	for (; i + 4 <= nBlocks; i += 4) {
+		auto* blocks = reinterpret_cast<__m128i*>(data + i * blockSize);
+		const __m128i c0 = _mm_loadu_si128(blocks + 0);
+		const __m128i c1 = _mm_loadu_si128(blocks + 1);
+		const __m128i c2 = _mm_loadu_si128(blocks + 2);
+		const __m128i c3 = _mm_loadu_si128(blocks + 3);
+		__m128i x0 = _mm_xor_si128(c0, keys.dec[0]);
+		__m128i x1 = _mm_xor_si128(c1, keys.dec[0]);
+		__m128i x2 = _mm_xor_si128(c2, keys.dec[0]);
+		__m128i x3 = _mm_xor_si128(c3, keys.dec[0]);
+		for (size_t r = 1; r < numRounds; ++r) {
+			x0 = _mm_aesdec_si128(x0, keys.dec[r]);
+			x1 = _mm_aesdec_si128(x1, keys.dec[r]);
+			x2 = _mm_aesdec_si128(x2, keys.dec[r]);
+			x3 = _mm_aesdec_si128(x3, keys.dec[r]);
+		}
+		x0 = _mm_aesdeclast_si128(x0, keys.dec[numRounds]);
+		x1 = _mm_aesdeclast_si128(x1, keys.dec[numRounds]);
+		x2 = _mm_aesdeclast_si128(x2, keys.dec[numRounds]);
+		x3 = _mm_aesdeclast_si128(x3, keys.dec[numRounds]);
+		_mm_storeu_si128(blocks + 0, _mm_xor_si128(x0, prev));
+		_mm_storeu_si128(blocks + 1, _mm_xor_si128(x1, c0));
+		_mm_storeu_si128(blocks + 2, _mm_xor_si128(x2, c1));
+		_mm_storeu_si128(blocks + 3, _mm_xor_si128(x3, c2));
+		prev = c3;
+	}
+	for (; i < nBlocks; ++i) {
+		auto* block = reinterpret_cast<__m128i*>(data + i * blockSize);
+		const __m128i c = _mm_loadu_si128(block);
+		_mm_storeu_si128(block, _mm_xor_si128(decryptBlock(c, keys), prev));
+		prev = c;
+	}
+}
+
+#elif defined(AES_HW_ARM)
+
+namespace {
+	struct RoundKeys
+	{
+		uint8x16_t enc[numRounds + 1];
+		uint8x16_t dec[numRounds + 1];
+
+		explicit RoundKeys(const uint8_t* roundKeys)
+		{
+			for (size_t i = 0; i <= numRounds; ++i) {
+				enc[i] = vld1q_u8(roundKeys + i * blockSize);
+			}
+			dec[0] = enc[numRounds];
+			for (size_t i = 1; i < numRounds; ++i) {
+				dec[i] = vaesimcq_u8(enc[numRounds - i]);
+			}
+			dec[numRounds] = enc[0];
+		}
+	};
+
+	// AESD/AESE add the round key first, unlike AES-NI, so the last key is applied separately
+	inline uint8x16_t decryptBlock(uint8x16_t x, const RoundKeys& keys)
+	{
+		for (size_t r = 0; r < numRounds - 1; ++r) {
+			x = vaesimcq_u8(vaesdq_u8(x, keys.dec[r]));
+		}
+		return veorq_u8(vaesdq_u8(x, keys.dec[numRounds - 1]), keys.dec[numRounds]);
+	}
+}
+
+bool HardwareAES::isAvailable()
+{
+	return true;
+}
+
+void HardwareAES::encryptCBC(const uint8_t* roundKeys, const uint8_t* iv, uint8_t* data, size_t nBlocks)
+{
+	const RoundKeys keys(roundKeys);
+	uint8x16_t prev = vld1q_u8(iv);
+	for (size_t i = 0; i < nBlocks; ++i) {
+		uint8_t* block = data + i * blockSize;
+		uint8x16_t x = veorq_u8(vld1q_u8(block), prev);
+		for (size_t r = 0; r < numRounds - 1; ++r) {
+			x = vaesmcq_u8(vaeseq_u8(x, keys.enc[r]));
+		}
+		x = veorq_u8(vaeseq_u8(x, keys.enc[numRounds - 1]), keys.enc[numRounds]);
+		vst1q_u8(block, x);
+		prev = x;
+	}
+}
+
+void HardwareAES::decryptCBC(const uint8_t* roundKeys, const uint8_t* iv, uint8_t* data, size_t nBlocks)
+{
+	const RoundKeys keys(roundKeys);
+	uint8x16_t prev = vld1q_u8(iv);
+	for (size_t i = 0; i < nBlocks; ++i) {
+		uint8_t* block = data + i * blockSize;
+		const uint8x16_t c = vld1q_u8(block);
+		vst1q_u8(block, veorq_u8(decryptBlock(c, keys), prev));
+		prev = c;
+	}
+}
+
+#else
+
+bool HardwareAES::isAvailable()
+{
+	return false;
+}
+
+void HardwareAES::encryptCBC(const uint8_t*, const uint8_t*, uint8_t*, size_t)
+{
+}
+
+void HardwareAES::decryptCBC(const uint8_t*, const uint8_t*, uint8_t*, size_t)
+{
+}
+
+#endif
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace Halley {
+	// AES-128 CBC using the CPU's AES instructions: AES-NI on x86, checked at runtime, or the ARMv8 crypto extensions
+	// where the compiler targets them. The round keys are the expanded encryption key, as produced by tiny-aes.
+	namespace HardwareAES {
+		bool isAvailable();
+
+		// iv is the block before the first one; data is nBlocks blocks, processed in place
+		void encryptCBC(const uint8_t* roundKeys, const uint8_t* iv, uint8_t* data, size_t nBlocks);
+		void decryptCBC(const uint8_t* roundKeys, const uint8_t* iv, uint8_t* data, size_t nBlocks);
+	}
+}
@@ -4,12 +4,12 @@
 
 using namespace Halley;
 
-std::unique_ptr<NetworkService> AsioNetworkAPI::createService(NetworkProtocol protocol, int port)
+std::unique_ptr<NetworkService> AsioNetworkAPI::createService(NetworkProtocol protocol, int port, int networkThreads)
 {
 	if (protocol == NetworkProtocol::TCP) {
 		return std::make_unique<AsioTCPNetworkService>(port);
 	} else if (protocol == NetworkProtocol::UDP) {
-		return std::make_unique<AsioUDPNetworkService>(port);
+		return std::make_unique<AsioUDPNetworkService>(port, IPVersion::IPv4, networkThreads);
 	} else {
 		return {};
 	}
@@ -20,12 +20,19 @@ struct HandshakeAccept
 
 
 
-AsioUDPConnection::AsioUDPConnection(UDPSocket& socket, UDPEndpoint remote)
+constexpr static size_t threadedQueueSize = 4096;
+
+AsioUDPConnection::AsioUDPConnection(UDPSocket& socket, UDPEndpoint remote, AsioUDPSendMode mode)
 	: socket(socket)
 	, remote(remote)
 	, status(ConnectionStatus::Connecting)
 	, connectionId(0)
+	, mode(mode)
 {
+	if (mode == AsioUDPSendMode::Threaded) {
+		outbox = std::make_unique<SPSCQueue<OutboundNetworkPacket>>(threadedQueueSize);
+		inbox = std::make_unique<SPSCQueue<InboundNetworkPacket>>(threadedQueueSize);
+	}
 }
 
 void AsioUDPConnection::close()
@@ -46,26 +53,44 @@ void AsioUDPConnection::send(OutboundNetworkPacket&& packet)
 		// Insert header
 		std::array<unsigned char, 2> id = { 0, 0 };
 		size_t len = 0;
-		if (connectionId >= 128) {
-			id[0] = (connectionId >> 8) & 0x7F;
-			id[1] = connectionId & 0xFF;
+		const short curId = connectionId;
+		if (curId >= 128) {
+			id[0] = (curId >> 8) & 0x7F;
+			id[1] = curId & 0xFF;
 			len = 2;
 		} else {
-			id[0] = connectionId & 0x7F;
+			id[0] = curId & 0x7F;
 			len = 1;
 		}
 		packet.addHeader(gsl::as_bytes(gsl::span<unsigned char>(id).subspan(0, len)));
 
-		bool needsSend = pendingSend.empty();
-		pendingSend.emplace_back(std::move(packet));
-		if (needsSend) {
-			sendNext();
+		if (mode == AsioUDPSendMode::Threaded) {
+			if (!outbox->tryPush(std::move(packet))) {
+				// Network thread has fallen behind, so drop it like the network would
+				return;
+			}
+			if (!flushScheduled.exchange(true)) {
+				boost::asio::post(socket.get_executor(), [self = shared_from_this()] ()
+				{
+					self->flushOutbox();
+				});
+			}
+		} else {
+			bool needsSend = pendingSend.empty() && mode == AsioUDPSendMode::Direct;
+			pendingSend.emplace_back(std::move(packet));
+			if (needsSend) {
+				sendNext();
+			}
 		}
 	}
 }
 
 bool AsioUDPConnection::receive(InboundNetworkPacket& packet)
 {
+	if (mode == AsioUDPSendMode::Threaded) {
+		return inbox->tryPop(packet);
+	}
+
 	if (pendingReceive.empty()) {
 		return false;
 	} else {
@@ -95,7 +120,11 @@ void AsioUDPConnection::onReceive(gsl::span<const gsl::byte> data)
 		}
 	} else if (status == ConnectionStatus::Connected) {
 		if (data.size() <= 1500) {
-			pendingReceive.push_back(InboundNetworkPacket(data));
+			if (mode == AsioUDPSendMode::Threaded) {
+				inbox->tryPush(InboundNetworkPacket(data));
+			} else {
+				pendingReceive.push_back(InboundNetworkPacket(data));
+			}
 		}
 	}
 }
@@ -105,6 +134,14 @@ void AsioUDPConnection::setError(const std::string& cs)
 	error = cs;
 }
 
+void AsioUDPConnection::onSendError(const std::string& cs)
+{
+	std::cout << "Error sending packet: " << cs << std::endl;
+	pendingSend.clear();
+	setError(cs);
+	close();
+}
+
 void AsioUDPConnection::open(short id)
 {
 	if (status == ConnectionStatus::Connecting) {
@@ -130,17 +167,32 @@ void AsioUDPConnection::sendNext()
 		return;
 	}
 
-	auto& packet = pendingSend.front();
-	size_t size = packet.copyTo(sendBuffer);
-	pendingSend.pop_front();
-
-	socket.async_send_to(boost::asio::buffer(sendBuffer, size), remote, [this] (const boost::system::error_code& error, std::size_t)
+	// The packet stays at the front of the queue until the send completes, so its buffer is sent directly
+	auto bytes = pendingSend.front().getBytes();
+	socket.async_send_to(boost::asio::buffer(bytes.data(), bytes.size_bytes()), remote, [self = shared_from_this()] (const boost::system::error_code& error, std::size_t)
 	{
+		self->pendingSend.pop_front();
 		if (error) {
 			std::cout << "Error sending packet: " << error.message() << std::endl;
-			close();
-		} else if (!pendingSend.empty()) {
-			sendNext();
+			self->close();
+		} else if (!self->pendingSend.empty()) {
+			self->sendNext();
 		}
 	});
 }
+
+void AsioUDPConnection::flushOutbox()
+{
+	// On the network thread
+	flushScheduled = false;
+
+	const bool idle = pendingSend.empty();
+	OutboundNetworkPacket packet;
+	while (outbox->tryPop(packet)) {
+		pendingSend.emplace_back(std::move(packet));
+	}
+
+	if (idle) {
+		sendNext();
+	}
+}
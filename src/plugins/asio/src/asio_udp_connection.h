@@ -2,6 +2,7 @@
 
 #include "halley/net/connection/iconnection.h"
 #include "halley/net/connection/network_packet.h"
+#include "halley/concurrency/spsc_queue.h"
 
 #ifdef _MSC_VER
 #pragma warning(disable: 4834)
@@ -12,6 +13,8 @@
 
 #include <deque>
 #include <array>
+#include <atomic>
+#include <memory>
 #include <string>
 #include <gsl/gsl>
 
@@ -21,10 +24,17 @@ namespace Halley
 	using UDPEndpoint = boost::asio::ip::udp::endpoint;
 	using UDPSocket = boost::asio::ip::udp::socket;
 
-	class AsioUDPConnection : public IConnection
+	enum class AsioUDPSendMode
+	{
+		Direct, // Each packet is sent as soon as the previous one is done, as the service is polled
+		Batched, // Packets queue up until the network service flushes them all at once
+		Threaded // The socket lives on a network thread; packets are handed over to it through a lock-free queue
+	};
+
+	class AsioUDPConnection : public IConnection, public std::enable_shared_from_this<AsioUDPConnection>
 	{
 	public:
-		AsioUDPConnection(UDPSocket& socket, UDPEndpoint remote);
+		AsioUDPConnection(UDPSocket& socket, UDPEndpoint remote, AsioUDPSendMode mode = AsioUDPSendMode::Direct);
 
 		void close() override;
 		ConnectionStatus getStatus() const override { return status; }
@@ -40,17 +50,29 @@ namespace Halley
 		void terminateConnection();
 		short getConnectionId() const { return connectionId; }
 
+		// Used by the network service to flush batched sends
+		const UDPEndpoint& getRemote() const { return remote; }
+		UDPSocket& getSocket() const { return socket; }
+		std::deque<OutboundNetworkPacket>& getPendingSend() { return pendingSend; }
+		void onSendError(const std::string& error);
+
 	private:
 		UDPSocket& socket;
 		UDPEndpoint remote;
-		ConnectionStatus status;
-		short connectionId;
+		std::atomic<ConnectionStatus> status;
+		std::atomic<short> connectionId;
+		AsioUDPSendMode mode;
 
 		std::deque<OutboundNetworkPacket> pendingSend;
 		std::deque<InboundNetworkPacket> pendingReceive;
-		std::array<gsl::byte, 2048> sendBuffer;
 		std::string error;
 
+		// Threaded mode only, between the game thread and the network thread
+		std::unique_ptr<SPSCQueue<OutboundNetworkPacket>> outbox;
+		std::unique_ptr<SPSCQueue<InboundNetworkPacket>> inbox;
+		std::atomic<bool> flushScheduled{ false };
+
 		void sendNext();
+		void flushOutbox();
 	};
 }
@@ -6,6 +6,14 @@
 #include <iostream>
 #include <unordered_map>
 #include <halley/support/exception.h>
+#include <halley/support/profiler.h>
+#include <halley/text/string_converter.h>
+
+#ifdef __linux__
+#include <sys/socket.h>
+#include <cerrno>
+#include <cstring>
+#endif
 
 using namespace Halley;
 namespace asio = boost::asio;
@@ -23,51 +31,164 @@ struct HandshakeOpen
 };
 
 
+#ifdef __linux__
+// Receives and sends whole batches of datagrams per syscall, with recvmmsg/sendmmsg
+struct AsioUDPNetworkService::BatchIO
+{
+	constexpr static size_t batchSize = 64;
+	constexpr static size_t maxReceiveBatchesPerUpdate = 32;
+
+	std::array<std::array<gsl::byte, 2048>, batchSize> receiveRing;
+	std::array<UDPEndpoint, batchSize> receiveEndpoints;
+	std::array<iovec, batchSize> receiveIov;
+	std::array<mmsghdr, batchSize> receiveMsgs;
+
+	std::array<iovec, batchSize> sendIov;
+	std::array<mmsghdr, batchSize> sendMsgs;
+	std::array<AsioUDPConnection*, batchSize> sendOwners;
+
+	BatchIO()
+	{
+		memset(receiveMsgs.data(), 0, sizeof(receiveMsgs));
+		memset(sendMsgs.data(), 0, sizeof(sendMsgs));
+		for (size_t i = 0; i < batchSize; ++i) {
+			receiveIov[i].iov_base = receiveRing[i].data();
+			receiveIov[i].iov_len = receiveRing[i].size();
+			receiveMsgs[i].msg_hdr.msg_iov = &receiveIov[i];
+			receiveMsgs[i].msg_hdr.msg_iovlen = 1;
+			sendMsgs[i].msg_hdr.msg_iov = &sendIov[i];
+			sendMsgs[i].msg_hdr.msg_iovlen = 1;
+		}
+	}
+};
+#else
+struct AsioUDPNetworkService::BatchIO {};
+#endif
+
+
+#if defined(__linux__)
+using ReusePort = asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+#endif
 
-AsioUDPNetworkService::AsioUDPNetworkService(int port, IPVersion version)
-	: localEndpoint(version == IPVersion::IPv4 ? asio::ip::udp::v4() : asio::ip::udp::v6(), static_cast<unsigned short>(port))
-	, socket(service, localEndpoint)
+AsioUDPNetworkService::Shard::Shard(const UDPEndpoint& localEndpoint, bool reusePort)
+	: socket(service)
+{
+	socket.open(localEndpoint.protocol());
+#if defined(__linux__)
+	if (reusePort) {
+		socket.set_option(ReusePort(true));
+	}
+#endif
+	socket.bind(localEndpoint);
+}
+
+AsioUDPNetworkService::AsioUDPNetworkService(int port, IPVersion version, int networkThreads)
+	: threaded(networkThreads > 0)
+	, localEndpoint(version == IPVersion::IPv4 ? asio::ip::udp::v4() : asio::ip::udp::v6(), static_cast<unsigned short>(port))
 {
 	Expects(port == 0 || port > 1024);
 	Expects(port < 65536);
+	Expects(networkThreads >= 0);
+
+	// Sharding needs a fixed port for every socket to share
+	int nShards = 1;
+#if defined(__linux__)
+	if (port != 0) {
+		nShards = std::max(networkThreads, 1);
+	}
+#endif
+	for (int i = 0; i < nShards; ++i) {
+		shards.push_back(std::make_unique<Shard>(localEndpoint, nShards > 1));
+	}
+
+	if (threaded) {
+		for (size_t i = 0; i < shards.size(); ++i) {
+			auto& shard = *shards[i];
+			shard.thread = std::thread([this, &shard, i] ()
+			{
+				Profiler::setThreadName("Network " + toString(i));
+				auto work = asio::make_work_guard(shard.service);
+				while (!shard.service.stopped()) {
+					try {
+						shard.service.run();
+					} catch (std::exception& e) {
+						std::cout << "Exception on network thread: " << e.what() << std::endl;
+					}
+				}
+			});
+		}
+	}
+
+#ifdef __linux__
+	if (!threaded) {
+		batch = std::make_unique<BatchIO>();
+	}
+#endif
 }
 
 
 AsioUDPNetworkService::~AsioUDPNetworkService()
 {
-	for (auto& conn : activeConnections) {
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		for (auto& conn : activeConnections) {
+			try {
+				conn.second->terminateConnection();
+			} catch (...) {
+				std::cout << "Error terminating connection on ~NetworkService()" << std::endl;
+			}
+		}
+	}
+
+	for (auto& shard: shards) {
 		try {
-			conn.second->terminateConnection();
+			if (threaded) {
+				shard->service.stop();
+				shard->thread.join();
+			} else {
+				if (batch) {
+					sendBatch();
+				}
+				shard->service.poll();
+			}
+			shard->socket.shutdown(UDPSocket::shutdown_both);
 		} catch (...) {
-			std::cout << "Error terminating connection on ~NetworkService()" << std::endl;
+			std::cout << "Error polling service on ~NetworkService()" << std::endl;
 		}
 	}
-	try {
-		service.poll();
-		socket.shutdown(UDPSocket::shutdown_both);
-	} catch (...) {
-		std::cout << "Error polling service on ~NetworkService()" << std::endl;
-	}
 }
 
 void AsioUDPNetworkService::update()
 {
 	// Remove closed connections
-	std::vector<short> toErase;
-	auto& active = activeConnections;
-	for (auto& conn: active) {
-		if (conn.second->getStatus() == ConnectionStatus::Closing) {
-			conn.second->terminateConnection();
-			toErase.push_back(conn.first);
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		std::vector<short> toErase;
+		auto& active = activeConnections;
+		for (auto& conn: active) {
+			if (conn.second->getStatus() == ConnectionStatus::Closing) {
+				conn.second->terminateConnection();
+				toErase.push_back(conn.first);
+			}
 		}
-	}
 
-	for (auto i: toErase) {
-		active.erase(i);
+		for (auto i: toErase) {
+			active.erase(i);
+		}
 	}
 
-	// Update service
-	service.poll();
+	// Update service, unless it's running on its own threads
+	if (!threaded) {
+		if (batch) {
+			if (startedListening) {
+				receiveBatch();
+			}
+			sendBatch();
+		}
+		for (auto& shard: shards) {
+			shard->service.poll();
+		}
+	}
 }
 
 void AsioUDPNetworkService::setAcceptingConnections(bool accepting)
@@ -76,18 +197,20 @@ void AsioUDPNetworkService::setAcceptingConnections(bool accepting)
 	if (accepting) {
 		startListening();
 	} else {
+		std::unique_lock<std::mutex> lock(mutex);
 		pendingIncomingConnections.clear();
 	}
 }
 
 std::shared_ptr<IConnection> AsioUDPNetworkService::tryAcceptConnection()
 {
+	std::unique_lock<std::mutex> lock(mutex);
 	auto& pending = pendingIncomingConnections;
 
 	if (pending.empty()) {
 		return nullptr;
 	} else {
-		auto conn = std::make_shared<AsioUDPConnection>(socket, pending.front());
+		auto conn = std::make_shared<AsioUDPConnection>(pending.front().shard->socket, pending.front().remote, getSendMode());
 		short id = getFreeId();
 		conn->open(id);
 
@@ -103,8 +226,11 @@ std::shared_ptr<IConnection> AsioUDPNetworkService::connect(String addr, int por
 	Expects(port < 65536);
 	auto remoteAddr = asio::ip::address::from_string(addr.cppStr());
 	auto remote = UDPEndpoint(remoteAddr, static_cast<unsigned short>(port)); 
-	auto conn = std::make_shared<AsioUDPConnection>(socket, remote);
-	activeConnections[0] = conn;
+	auto conn = std::make_shared<AsioUDPConnection>(shards[0]->socket, remote, getSendMode());
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		activeConnections[0] = conn;
+	}
 
 	// Handshake
 	HandshakeOpen open;
@@ -115,21 +241,42 @@ std::shared_ptr<IConnection> AsioUDPNetworkService::connect(String addr, int por
 	return conn;
 }
 
+AsioUDPSendMode AsioUDPNetworkService::getSendMode() const
+{
+	if (threaded) {
+		return AsioUDPSendMode::Threaded;
+	} else if (batch) {
+		return AsioUDPSendMode::Batched;
+	} else {
+		return AsioUDPSendMode::Direct;
+	}
+}
+
 void AsioUDPNetworkService::startListening()
 {
 	if (!startedListening) {
 		startedListening = true;
-		receiveNext();
+		if (!batch) {
+			for (auto& shard: shards) {
+				// Posted, so the receive is started from the thread that owns the socket
+				Shard* s = shard.get();
+				asio::post(s->service, [this, s] () { receiveNext(*s); });
+			}
+		}
 	}
 }
 
-void AsioUDPNetworkService::receiveNext()
+void AsioUDPNetworkService::receiveNext(Shard& shard)
 {
-	auto buffer = asio::buffer(receiveBuffer);
-	socket.async_receive_from(buffer, remoteEndpoint, [this] (const boost::system::error_code& error, size_t size)
+	auto buffer = asio::buffer(shard.receiveBuffer);
+	shard.socket.async_receive_from(buffer, shard.remoteEndpoint, [this, &shard] (const boost::system::error_code& error, size_t size)
 	{
+		if (error == asio::error::operation_aborted) {
+			return;
+		}
+
 		try {
-			Expects(size <= receiveBuffer.size());
+			Expects(size <= shard.receiveBuffer.size());
 
 			std::string errorMsg;
 			std::string* errorMsgPtr = nullptr;
@@ -138,22 +285,117 @@ void AsioUDPNetworkService::receiveNext()
 				errorMsgPtr = &errorMsg;
 			}
 
-			receivePacket(gsl::span<gsl::byte>(receiveBuffer.data(), size), errorMsgPtr);
+			receivePacket(shard, gsl::span<gsl::byte>(shard.receiveBuffer.data(), size), shard.remoteEndpoint, errorMsgPtr);
 		} catch (...) {
 			std::cout << "Exception while receiving a packet." << std::endl;
 		}
 
-		receiveNext();
+		receiveNext(shard);
 	});
 }
 
-void AsioUDPNetworkService::receivePacket(gsl::span<gsl::byte> received, std::string* error)
+void AsioUDPNetworkService::receiveBatch()
+{
+#ifdef __linux__
+	auto& b = *batch;
+	auto& shard = *shards[0];
+	for (size_t n = 0; n < BatchIO::maxReceiveBatchesPerUpdate; ++n) {
+		for (size_t i = 0; i < BatchIO::batchSize; ++i) {
+			b.receiveMsgs[i].msg_hdr.msg_name = b.receiveEndpoints[i].data();
+			b.receiveMsgs[i].msg_hdr.msg_namelen = socklen_t(b.receiveEndpoints[i].capacity());
+			b.receiveMsgs[i].msg_hdr.msg_flags = 0;
+		}
+
+		int received = recvmmsg(shard.socket.native_handle(), b.receiveMsgs.data(), unsigned(BatchIO::batchSize), MSG_DONTWAIT, nullptr);
+		if (received < 0) {
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+				std::string errorMsg = strerror(errno);
+				receivePacket(shard, {}, shard.remoteEndpoint, &errorMsg);
+			}
+			return;
+		}
+
+		for (int i = 0; i < received; ++i) {
+			auto& msg = b.receiveMsgs[i];
+			if (msg.msg_hdr.msg_flags & MSG_TRUNC) {
+				continue;
+			}
+
+			auto& endpoint = b.receiveEndpoints[i];
+			endpoint.resize(msg.msg_hdr.msg_namelen);
+			shard.remoteEndpoint = endpoint;
+			try {
+				receivePacket(shard, gsl::span<gsl::byte>(b.receiveRing[i].data(), msg.msg_len), endpoint, nullptr);
+			} catch (...) {
+				std::cout << "Exception while receiving a packet." << std::endl;
+			}
+		}
+
+		if (size_t(received) < BatchIO::batchSize) {
+			return;
+		}
+	}
+#endif
+}
+
+void AsioUDPNetworkService::sendBatch()
 {
+#ifdef __linux__
+	auto& b = *batch;
+	auto& shard = *shards[0];
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		// Gather the front of each connection's queue, in order
+		size_t count = 0;
+		for (auto& conn: activeConnections) {
+			for (auto& packet: conn.second->getPendingSend()) {
+				if (count == BatchIO::batchSize) {
+					break;
+				}
+				auto bytes = packet.getBytes();
+				b.sendIov[count].iov_base = const_cast<gsl::byte*>(bytes.data());
+				b.sendIov[count].iov_len = size_t(bytes.size_bytes());
+				auto& remote = conn.second->getRemote();
+				b.sendMsgs[count].msg_hdr.msg_name = const_cast<sockaddr*>(remote.data());
+				b.sendMsgs[count].msg_hdr.msg_namelen = socklen_t(remote.size());
+				b.sendOwners[count] = conn.second.get();
+				++count;
+			}
+		}
+		if (count == 0) {
+			return;
+		}
+
+		int sent = sendmmsg(shard.socket.native_handle(), b.sendMsgs.data(), unsigned(count), MSG_DONTWAIT);
+		if (sent < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				// Socket buffer is full, try again on the next update
+				return;
+			} else if (errno != EINTR) {
+				b.sendOwners[0]->onSendError(strerror(errno));
+			}
+			continue;
+		}
+
+		for (int i = 0; i < sent; ++i) {
+			b.sendOwners[i]->getPendingSend().pop_front();
+		}
+		if (size_t(sent) < count) {
+			return;
+		}
+	}
+#endif
+}
+
+void AsioUDPNetworkService::receivePacket(Shard& shard, gsl::span<gsl::byte> received, const UDPEndpoint& sender, std::string* error)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
 	if (error) {
 		std::cout << "Error receiving packet: " << (*error) << std::endl;
 		// Find the owner of this remote endpoint
 		for (auto& conn : activeConnections) {
-			if (conn.second->matchesEndpoint(remoteEndpoint)) {
+			if (conn.second->matchesEndpoint(sender)) {
 				conn.second->setError(*error);
 				conn.second->close();
 			}
@@ -187,8 +429,8 @@ void AsioUDPNetworkService::receivePacket(gsl::span<gsl::byte> received, std::st
 	// No connection id, check if it's a connection request
 	if (id == 0 && isValidConnectionRequest(received)) {
 		auto& pending = pendingIncomingConnections;
-		if (std::find(pending.begin(), pending.end(), remoteEndpoint) == pending.end()) {
-			pending.push_back(remoteEndpoint);
+		if (std::find_if(pending.begin(), pending.end(), [&] (const PendingConnection& p) { return p.remote == sender; }) == pending.end()) {
+			pending.push_back(PendingConnection{ sender, &shard });
 		}
 		// Pending connection is valid
 		return;
@@ -205,8 +447,8 @@ void AsioUDPNetworkService::receivePacket(gsl::span<gsl::byte> received, std::st
 		}
 	}
 
-	// Validate that this connection is who it claims to be
-	if (conn->second->matchesEndpoint(remoteEndpoint)) {
+	// Validate that this connection is who it claims to be, and that it's on the socket it came through
+	if (conn->second->matchesEndpoint(sender) && &conn->second->getSocket() == &shard.socket) {
 		auto connection = conn->second;
 
 		if (error) {
@@ -10,14 +10,18 @@
 namespace asio = boost::asio;
 
 #include "asio_udp_connection.h"
+#include <list>
 #include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 namespace Halley
 {
 	class AsioUDPNetworkService : public NetworkService
 	{
 	public:
-		AsioUDPNetworkService(int port, IPVersion version = IPVersion::IPv4);
+		AsioUDPNetworkService(int port, IPVersion version = IPVersion::IPv4, int networkThreads = 0);
 		~AsioUDPNetworkService();
 
 		void update() override;
@@ -27,21 +31,46 @@ namespace Halley
 		std::shared_ptr<IConnection> connect(String address, int port) override;
 
 	private:
-		bool acceptingConnections = false;
+		struct BatchIO;
+
+		// A socket and the service driving it. When threaded, each shard runs on its own network thread,
+		// and servers with several shards have the OS spread clients across their sockets.
+		struct Shard
+		{
+			asio::io_service service;
+			UDPSocket socket;
+			UDPEndpoint remoteEndpoint;
+			std::array<gsl::byte, 2048> receiveBuffer;
+			std::thread thread;
+
+			Shard(const UDPEndpoint& localEndpoint, bool reusePort);
+		};
+
+		struct PendingConnection
+		{
+			UDPEndpoint remote;
+			Shard* shard;
+		};
+
+		std::atomic<bool> acceptingConnections{ false };
 		bool startedListening = false;
+		bool threaded = false;
 
-		asio::io_service service;
 		UDPEndpoint localEndpoint;
-		UDPEndpoint remoteEndpoint;
-		asio::ip::udp::socket socket;
-		std::list<UDPEndpoint> pendingIncomingConnections;
+		std::vector<std::unique_ptr<Shard>> shards;
+
+		std::mutex mutex; // Guards the connection lists below, which network threads also access when threaded
+		std::list<PendingConnection> pendingIncomingConnections;
 		std::unordered_map<short, std::shared_ptr<AsioUDPConnection>> activeConnections;
 
-		std::array<gsl::byte, 2048> receiveBuffer;
+		std::unique_ptr<BatchIO> batch; // Only on platforms with batched socket calls when not threaded, otherwise each datagram goes through asio
 
+		AsioUDPSendMode getSendMode() const;
 		void startListening();
-		void receiveNext();
-		void receivePacket(gsl::span<gsl::byte> data, std::string* error);
+		void receiveNext(Shard& shard);
+		void receiveBatch();
+		void sendBatch();
+		void receivePacket(Shard& shard, gsl::span<gsl::byte> data, const UDPEndpoint& sender, std::string* error);
 		bool isValidConnectionRequest(gsl::span<const gsl::byte> data);
 		short getFreeId() const;
 	};
@@ -8,6 +8,9 @@ DX11Buffer::DX11Buffer(DX11Video& video, Type type, size_t initialSize)
 	: video(video)
 	, type(type)
 {
+	// Constant buffers are bound in units of 16 constants
+	alignment = type == Type::Constant ? 256 : 16;
+
 	if (initialSize > 0) {
 		resize(initialSize);
 	}
@@ -21,6 +24,7 @@ DX11Buffer::DX11Buffer(DX11Buffer&& other) noexcept
 	, curPos(other.curPos)
 	, lastSize(other.lastSize)
 	, lastPos(other.lastPos)
+	, alignment(other.alignment)
 	, waitingReset(other.waitingReset)
 {
 	other.buffer = nullptr;
@@ -68,12 +72,16 @@ void DX11Buffer::setData(gsl::span<const gsl::byte> data)
 
 		video.getDevice().CreateBuffer(&bd, &resData, &buffer);
 	} else {
-		if (size_t(data.size_bytes()) > curSize) {
-			resize(size_t(data.size_bytes()));
+		const size_t alignedSize = alignUp(size_t(data.size_bytes()), alignment);
+		if (alignedSize > curSize) {
+			resize(alignedSize);
+		} else if (curPos + alignedSize > curSize) {
+			// Wrap around; discarding lets the driver hand us fresh memory while the GPU still reads the old contents
+			reset();
 		}
 
 		lastPos = curPos;
-		lastSize = alignUp(size_t(data.size_bytes()), size_t(256));
+		lastSize = alignedSize;
 
 		D3D11_MAPPED_SUBRESOURCE ms;
 		ZeroMemory(&ms, sizeof(ms));
@@ -87,7 +95,7 @@ void DX11Buffer::setData(gsl::span<const gsl::byte> data)
 		memcpy(dst, data.data(), data.size_bytes());
 		devCon.Unmap(buffer, 0);
 
-		curPos = alignUp(size_t(lastPos + lastSize), size_t(256));
+		curPos = lastPos + lastSize;
 		waitingReset = false;
 	}
 }
@@ -109,7 +117,7 @@ UINT DX11Buffer::getLastSize() const
 
 bool DX11Buffer::canFit(size_t size) const
 {
-	return curPos + alignUp(size, size_t(256)) <= curSize;
+	return curPos + alignUp(size, alignment) <= curSize;
 }
 
 void DX11Buffer::reset()
@@ -7,6 +7,9 @@
 namespace Halley {
 	class DX11Video;
 
+	// Dynamic buffer used as a ring: each setData is appended after the previous one with D3D11_MAP_WRITE_NO_OVERWRITE,
+	// and only once it wraps around (or after reset) is the buffer mapped with D3D11_MAP_WRITE_DISCARD.
+	// getOffset() and getLastSize() describe where the last data was written.
 	class DX11Buffer {
     public:
 		enum class Type
@@ -42,6 +45,7 @@ namespace Halley {
 		size_t curPos = 0;
 		size_t lastSize = 0;
 		size_t lastPos = 0;
+		size_t alignment = 16;
 		bool waitingReset = false;
 
 		void resize(size_t size);
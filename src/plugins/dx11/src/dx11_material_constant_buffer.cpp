@@ -1,18 +1,93 @@
 #include "dx11_material_constant_buffer.h"
+#include "dx11_video.h"
 using namespace Halley;
 
 DX11MaterialConstantBuffer::DX11MaterialConstantBuffer(DX11Video& video)
-	: buffer(video, DX11Buffer::Type::Constant)
+	: video(video)
+	, buffer(video, DX11Buffer::Type::Constant, 1024 * 1024)
 {
 }
 
-void DX11MaterialConstantBuffer::update(const MaterialDataBlock& dataBlock)
+void DX11MaterialConstantBuffer::bind(const MaterialDataBlock& dataBlock)
 {
-	buffer.reset();
-	buffer.setData(dataBlock.getData());
+	const auto data = dataBlock.getData();
+	const uint64_t hash = dataBlock.getHash();
+	const int bindPoint = dataBlock.getBindPoint();
+	if (data.empty()) {
+		return;
+	}
+
+	if (size_t(bindPoint) >= bound.size()) {
+		bound.resize(size_t(bindPoint) + 1);
+	}
+	auto& block = bound[bindPoint];
+	const bool changed = block.data.empty() || block.hash != hash;
+	if (changed) {
+		block.data.assign(reinterpret_cast<const Byte*>(data.data()), reinterpret_cast<const Byte*>(data.data()) + data.size_bytes());
+		block.hash = hash;
+	}
+
+	if (video.canOffsetConstantBuffers()) {
+		auto iter = ranges.find(hash);
+		bindRange(bindPoint, iter != ranges.end() ? iter->second : write(data, hash));
+	} else if (changed) {
+		bindOwnBuffer(bindPoint, data);
+	}
+}
+
+DX11MaterialConstantBuffer::Range DX11MaterialConstantBuffer::write(gsl::span<const gsl::byte> data, uint64_t hash)
+{
+	buffer.setData(data);
+	const Range range = { buffer.getOffset(), buffer.getLastSize() };
+
+	if (range.offset == 0) {
+		// The ring wrapped around (or was resized), which discards everything in it, including the blocks already bound
+		ranges.clear();
+		ranges[hash] = range;
+		rebindAll();
+	} else {
+		ranges[hash] = range;
+	}
+
+	return range;
+}
+
+void DX11MaterialConstantBuffer::bindRange(int bindPoint, Range range)
+{
+	auto& devCon = video.getDeviceContext();
+	auto dxBuffer = buffer.getBuffer();
+	UINT firstConstant[] = { range.offset / 16 };
+	UINT numConstants[] = { range.size / 16 };
+	devCon.VSSetConstantBuffers1(UINT(bindPoint), 1, &dxBuffer, firstConstant, numConstants);
+	devCon.PSSetConstantBuffers1(UINT(bindPoint), 1, &dxBuffer, firstConstant, numConstants);
+}
+
+void DX11MaterialConstantBuffer::bindOwnBuffer(int bindPoint, gsl::span<const gsl::byte> data)
+{
+	if (size_t(bindPoint) >= ownBuffers.size()) {
+		ownBuffers.resize(size_t(bindPoint) + 1);
+	}
+	auto& own = ownBuffers[bindPoint];
+	if (!own) {
+		own = std::make_unique<DX11Buffer>(video, DX11Buffer::Type::Constant, 4 * 1024);
+	}
+
+	// Shaders always read from the start of the buffer, so it has to be discarded every time
+	own->reset();
+	own->setData(data);
+
+	auto& devCon = video.getDeviceContext();
+	devCon.VSSetConstantBuffers(UINT(bindPoint), 1, &own->getBuffer());
+	devCon.PSSetConstantBuffers(UINT(bindPoint), 1, &own->getBuffer());
 }
 
-DX11Buffer& DX11MaterialConstantBuffer::getBuffer()
+void DX11MaterialConstantBuffer::rebindAll()
 {
-	return buffer;
+	for (size_t i = 0; i < bound.size(); ++i) {
+		auto& block = bound[i];
+		if (!block.data.empty()) {
+			auto iter = ranges.find(block.hash);
+			bindRange(int(i), iter != ranges.end() ? iter->second : write(gsl::as_bytes(gsl::span<const Byte>(block.data)), block.hash));
+		}
+	}
 }
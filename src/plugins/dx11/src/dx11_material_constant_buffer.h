@@ -1,18 +1,42 @@
 #pragma once
 #include "halley/core/graphics/material/material.h"
+#include "halley/data_structures/hash_map.h"
 #include "dx11_buffer.h"
 
 namespace Halley
 {
-	class DX11MaterialConstantBuffer : public MaterialConstantBuffer
+	// Uniform blocks of every material drawn, packed into one DX11Buffer ring and bound by offset. Blocks with the same
+	// contents are only written once, until the ring wraps around. Without constant buffer offsets (i.e. D3D 11.0),
+	// each binding point gets a buffer of its own instead, rewritten whenever its contents change.
+	class DX11MaterialConstantBuffer
 	{
 	public:
-		DX11MaterialConstantBuffer(DX11Video& video);
+		explicit DX11MaterialConstantBuffer(DX11Video& video);
 
-		void update(const MaterialDataBlock& dataBlock) override;
-		DX11Buffer& getBuffer();
+		void bind(const MaterialDataBlock& dataBlock);
 
 	private:
+		struct Range
+		{
+			UINT offset;
+			UINT size;
+		};
+
+		struct BoundBlock
+		{
+			Bytes data;
+			uint64_t hash = 0;
+		};
+
+		DX11Video& video;
 		DX11Buffer buffer;
+		HashMap<uint64_t, Range> ranges;
+		Vector<BoundBlock> bound;
+		Vector<std::unique_ptr<DX11Buffer>> ownBuffers;
+
+		Range write(gsl::span<const gsl::byte> data, uint64_t hash);
+		void bindRange(int bindPoint, Range range);
+		void bindOwnBuffer(int bindPoint, gsl::span<const gsl::byte> data);
+		void rebindAll();
 	};
 }
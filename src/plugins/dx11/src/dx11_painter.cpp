@@ -3,29 +3,36 @@
 #include "halley/core/graphics/material/material.h"
 #include "halley/core/graphics/material/material_definition.h"
 #include "dx11_shader.h"
-#include "dx11_material_constant_buffer.h"
 #include "dx11_blend.h"
+#include "dx11_depth_stencil.h"
 #include "halley/core/graphics/material/material_parameter.h"
 #include "dx11_texture.h"
 #include "dx11_rasterizer.h"
 #include "halley/core/graphics/render_target/render_target.h"
 #include "dx11_render_target.h"
-#include "halley/core/game/game_platform.h"
+#include <array>
 using namespace Halley;
 
 DX11Painter::DX11Painter(DX11Video& video, Resources& resources)
 	: Painter(resources)
 	, video(video)
+	, vertexBuffer(video, DX11Buffer::Type::Vertex, 8 * 1024 * 1024)
+	, indexBuffer(video, DX11Buffer::Type::Index, 128 * 1024)
+	, unitQuadBuffer(video, DX11Buffer::Type::Vertex)
+	, unitQuadIndexBuffer(video, DX11Buffer::Type::Index)
+	, constantBuffer(video)
 {
-#ifdef WINDOWS_STORE
-	// Due to the architecture of "some" platforms available here, updating a dynamic buffer is extremely slow if it's still in use
-	constexpr size_t numBuffers = 2;
-#else
-	constexpr size_t numBuffers = 1;
-#endif
-	for (size_t i = 0; i < numBuffers; ++i) {
-		vertexBuffers.emplace_back(video, DX11Buffer::Type::Vertex, 8 * 1024 * 1024);
-		indexBuffers.emplace_back(video, DX11Buffer::Type::Index, 128 * 1024);
+}
+
+DX11Painter::~DX11Painter()
+{
+	for (auto& queries: timestampQueries) {
+		if (queries.disjoint) {
+			queries.disjoint->Release();
+		}
+		for (auto& q: queries.timestamps) {
+			q->Release();
+		}
 	}
 }
 
@@ -35,18 +42,36 @@ void DX11Painter::doStartRender()
 		normalRaster = std::make_unique<DX11Rasterizer>(video, false);
 		scissorRaster = std::make_unique<DX11Rasterizer>(video, true);
 	}
-	normalRaster->bind(video);
+
+	boundShader = nullptr;
+	boundBlend = nullptr;
+	boundDepthStencil = nullptr;
+	boundRaster = nullptr;
+	bindRasterizer(*normalRaster);
 }
 
 void DX11Painter::doEndRender()
 {
 }
 
-void DX11Painter::clear(Colour colour)
+void DX11Painter::doClear(Colour colour)
 {
 	const float col[] = { colour.r, colour.g, colour.b, colour.a };
-	auto view = dynamic_cast<IDX11RenderTarget&>(getActiveRenderTarget()).getRenderTargetView();
-	video.getDeviceContext().ClearRenderTargetView(view, col);
+	auto& renderTarget = dynamic_cast<IDX11RenderTarget&>(getActiveRenderTarget());
+	video.getDeviceContext().ClearRenderTargetView(renderTarget.getRenderTargetView(), col);
+
+	auto depthStencilView = renderTarget.getDepthStencilView();
+	if (depthStencilView) {
+		video.getDeviceContext().ClearDepthStencilView(depthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+	}
+}
+
+void DX11Painter::doClearDepth()
+{
+	auto depthStencilView = dynamic_cast<IDX11RenderTarget&>(getActiveRenderTarget()).getDepthStencilView();
+	if (depthStencilView) {
+		video.getDeviceContext().ClearDepthStencilView(depthStencilView, D3D11_CLEAR_DEPTH, 1.0f, 0);
+	}
 }
 
 void DX11Painter::setMaterialPass(const Material& material, int passN)
@@ -54,12 +79,27 @@ void DX11Painter::setMaterialPass(const Material& material, int passN)
 	auto& pass = material.getDefinition().getPass(passN);
 
 	// Shader
-	auto& shader = static_cast<DX11Shader&>(pass.getShader());
+	auto& shader = static_cast<DX11Shader&>(pass.getShader(material.getVariant()));
 	shader.setMaterialLayout(video, material.getDefinition().getAttributes());
-	shader.bind(video);
+	if (boundShader != &shader || boundShaderInstanced != instanced) {
+		shader.bind(video, instanced);
+		boundShader = &shader;
+		boundShaderInstanced = instanced;
+	}
 
 	// Blend
-	getBlendMode(pass.getBlend()).bind(video);
+	auto& blend = getBlendMode(pass.getBlend());
+	if (boundBlend != &blend) {
+		blend.bind(video);
+		boundBlend = &blend;
+	}
+
+	// Depth and stencil
+	auto& depthStencil = getDepthStencil(pass.getDepthStencil());
+	if (boundDepthStencil != &depthStencil) {
+		depthStencil.bind(video);
+		boundDepthStencil = &depthStencil;
+	}
 
 	// Texture
 	int textureUnit = 0;
@@ -76,20 +116,9 @@ void DX11Painter::setMaterialPass(const Material& material, int passN)
 
 void DX11Painter::setMaterialData(const Material& material)
 {
-	auto& devCon = video.getDeviceContext();
 	for (auto& block: material.getDataBlocks()) {
 		if (block.getType() != MaterialDataBlockType::SharedExternal) {
-			auto& buffer = static_cast<DX11MaterialConstantBuffer&>(block.getConstantBuffer()).getBuffer();
-			auto dxBuffer = buffer.getBuffer();
-			if (Halley::getPlatform() == GamePlatform::UWP || Halley::getPlatform() == GamePlatform::XboxOne) {
-				UINT firstConstant[] = { buffer.getOffset() / 16 };
-				UINT numConstants[] = { buffer.getLastSize() / 16 };
-				devCon.VSSetConstantBuffers1(block.getBindPoint(), 1, &dxBuffer, firstConstant, numConstants);
-				devCon.PSSetConstantBuffers1(block.getBindPoint(), 1, &dxBuffer, firstConstant, numConstants);
-			} else {
-				devCon.VSSetConstantBuffers(block.getBindPoint(), 1, &dxBuffer);
-				devCon.PSSetConstantBuffers(block.getBindPoint(), 1, &dxBuffer);
-			}
+			constantBuffer.bind(block);
 		}
 	}
 }
@@ -98,13 +127,10 @@ void DX11Painter::setVertices(const MaterialDefinition& material, size_t numVert
 {
 	const size_t stride = material.getVertexStride();
 	const size_t vertexDataSize = stride * numVertices;
-
-	if (!vertexBuffers[curBuffer].canFit(vertexDataSize) || !indexBuffers[curBuffer].canFit(numIndices * sizeof(unsigned short))) {
-		rotateBuffers();
-	}
+	instanced = false;
 
 	{
-		auto& vb = vertexBuffers[curBuffer];
+		auto& vb = vertexBuffer;
 		vb.setData(gsl::span<const gsl::byte>(reinterpret_cast<const gsl::byte*>(vertexData), vertexDataSize));
 		ID3D11Buffer* buffers[] = { vb.getBuffer() };
 		UINT strides[] = { UINT(stride) };
@@ -113,7 +139,7 @@ void DX11Painter::setVertices(const MaterialDefinition& material, size_t numVert
 	}
 
 	{
-		auto& ib = indexBuffers[curBuffer];
+		auto& ib = indexBuffer;
 		ib.setData(gsl::as_bytes(gsl::span<unsigned short>(indices, numIndices)));
 		video.getDeviceContext().IASetIndexBuffer(ib.getBuffer(), DXGI_FORMAT_R16_UINT, ib.getOffset());
 	}
@@ -126,6 +152,42 @@ void DX11Painter::drawTriangles(size_t numIndices)
 	devCon.DrawIndexed(UINT(numIndices), 0, 0);
 }
 
+bool DX11Painter::supportsInstancing() const
+{
+	return true;
+}
+
+void DX11Painter::setInstancedVertices(const MaterialDefinition& material, size_t numInstances, void* instanceData)
+{
+	if (!unitQuadReady) {
+		// Same vertPos values as Painter::drawSprites generates; these are only written once, so they're never discarded
+		const std::array<Vector4f, 4> quad = {{ Vector4f(0, 0, 0, 0), Vector4f(1, 0, 1, 0), Vector4f(1, 1, 1, 1), Vector4f(0, 1, 0, 1) }};
+		std::array<unsigned short, 6> quadIndices;
+		generateQuadIndices(0, 1, quadIndices.data());
+		unitQuadBuffer.setData(gsl::as_bytes(gsl::span<const Vector4f>(quad)));
+		unitQuadIndexBuffer.setData(gsl::as_bytes(gsl::span<const unsigned short>(quadIndices)));
+		unitQuadReady = true;
+	}
+
+	const size_t stride = material.getVertexStride();
+	vertexBuffer.setData(gsl::span<const gsl::byte>(reinterpret_cast<const gsl::byte*>(instanceData), stride * numInstances));
+	instanced = true;
+
+	ID3D11Buffer* buffers[] = { unitQuadBuffer.getBuffer(), vertexBuffer.getBuffer() };
+	UINT strides[] = { UINT(sizeof(Vector4f)), UINT(stride) };
+	UINT offsets[] = { unitQuadBuffer.getOffset(), vertexBuffer.getOffset() };
+	auto& devCon = video.getDeviceContext();
+	devCon.IASetVertexBuffers(0, 2, buffers, strides, offsets);
+	devCon.IASetIndexBuffer(unitQuadIndexBuffer.getBuffer(), DXGI_FORMAT_R16_UINT, unitQuadIndexBuffer.getOffset());
+}
+
+void DX11Painter::drawInstancedQuads(size_t numInstances)
+{
+	auto& devCon = video.getDeviceContext();
+	devCon.IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	devCon.DrawIndexedInstanced(6, UINT(numInstances), 0, 0, 0);
+}
+
 void DX11Painter::setViewPort(Rect4i rect)
 {
 	auto fRect = Rect4f(rect);
@@ -144,7 +206,7 @@ void DX11Painter::setViewPort(Rect4i rect)
 void DX11Painter::setClip(Rect4i clip, bool enable)
 {
 	if (enable) {
-		scissorRaster->bind(video);
+		bindRasterizer(*scissorRaster);
 		D3D11_RECT rect;
 		rect.top = clip.getTop();
 		rect.bottom = clip.getBottom();
@@ -152,13 +214,20 @@ void DX11Painter::setClip(Rect4i clip, bool enable)
 		rect.right = clip.getRight();
 		video.getDeviceContext().RSSetScissorRects(1, &rect);
 	} else {
-		normalRaster->bind(video);
+		bindRasterizer(*normalRaster);
+	}
+}
+
+void DX11Painter::bindRasterizer(DX11Rasterizer& raster)
+{
+	if (boundRaster != &raster) {
+		raster.bind(video);
+		boundRaster = &raster;
 	}
 }
 
 void DX11Painter::onUpdateProjection(Material& material)
 {
-	material.uploadData(*this);
 	setMaterialData(material);
 }
 
@@ -173,10 +242,75 @@ DX11Blend& DX11Painter::getBlendMode(BlendType type)
 	return getBlendMode(type);
 }
 
-void DX11Painter::rotateBuffers()
+DX11DepthStencil& DX11Painter::getDepthStencil(const MaterialDepthStencil& definition)
 {
-	Expects (vertexBuffers.size() == indexBuffers.size());
-	curBuffer = (curBuffer + 1) % vertexBuffers.size();
-	indexBuffers[curBuffer].reset();
-	vertexBuffers[curBuffer].reset();
+	const auto key = DX11DepthStencil::getKey(definition);
+	auto iter = depthStencilModes.find(key);
+	if (iter != depthStencilModes.end()) {
+		return iter->second;
+	}
+
+	depthStencilModes.emplace(std::make_pair(key, DX11DepthStencil(video, definition)));
+	return getDepthStencil(definition);
+}
+
+bool DX11Painter::supportsTimestamps() const
+{
+	return true;
+}
+
+void DX11Painter::beginTimestamps(int slot)
+{
+	auto& queries = timestampQueries[slot];
+	if (!queries.disjoint) {
+		D3D11_QUERY_DESC desc = { D3D11_QUERY_TIMESTAMP_DISJOINT, 0 };
+		if (video.getDevice().CreateQuery(&desc, &queries.disjoint) != S_OK) {
+			throw Exception("Error creating timestamp query", HalleyExceptions::VideoPlugin);
+		}
+	}
+	video.getDeviceContext().Begin(queries.disjoint);
+}
+
+void DX11Painter::writeTimestamp(int slot, size_t index)
+{
+	auto& queries = timestampQueries[slot];
+	while (index >= queries.timestamps.size()) {
+		D3D11_QUERY_DESC desc = { D3D11_QUERY_TIMESTAMP, 0 };
+		ID3D11Query* query = nullptr;
+		if (video.getDevice().CreateQuery(&desc, &query) != S_OK) {
+			throw Exception("Error creating timestamp query", HalleyExceptions::VideoPlugin);
+		}
+		queries.timestamps.push_back(query);
+	}
+	video.getDeviceContext().End(queries.timestamps[index]);
+}
+
+void DX11Painter::endTimestamps(int slot)
+{
+	video.getDeviceContext().End(timestampQueries[slot].disjoint);
+}
+
+bool DX11Painter::readTimestamps(int slot, size_t count, Vector<int64_t>& nanoseconds)
+{
+	auto& queries = timestampQueries[slot];
+	auto& dc = video.getDeviceContext();
+	if (!queries.disjoint || count > queries.timestamps.size()) {
+		return false;
+	}
+
+	// Don't flush: the slot is a few frames old, so if it's not done yet, it's not worth waiting for
+	D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+	if (dc.GetData(queries.disjoint, &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK || disjoint.Disjoint) {
+		return false;
+	}
+
+	nanoseconds.resize(count);
+	for (size_t i = 0; i < count; ++i) {
+		UINT64 ticks = 0;
+		if (dc.GetData(queries.timestamps[i], &ticks, sizeof(ticks), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK) {
+			return false;
+		}
+		nanoseconds[i] = int64_t(double(ticks) * 1000000000.0 / double(disjoint.Frequency));
+	}
+	return true;
 }
@@ -1,46 +1,80 @@
 #pragma once
 #include "halley/core/graphics/painter.h"
 #include "dx11_buffer.h"
+#include "dx11_material_constant_buffer.h"
 #include <map>
 
 namespace Halley
 {
 	class DX11Video;
 	class DX11Blend;
+	class DX11DepthStencil;
 	class DX11Rasterizer;
+	class DX11Shader;
 
 	class DX11Painter : public Painter
 	{
 	public:
 		explicit DX11Painter(DX11Video& video, Resources& resources);
+		~DX11Painter();
 		
-		void clear(Colour colour) override;
 		void setMaterialPass(const Material& material, int pass) override;
 		void setMaterialData(const Material& material) override;
 
 		void doStartRender() override;
 		void doEndRender() override;
+		void doClear(Colour colour) override;
+		void doClearDepth() override;
 
 		void setVertices(const MaterialDefinition& material, size_t numVertices, void* vertexData, size_t numIndices, unsigned short* indices, bool standardQuadsOnly) override;
 		void drawTriangles(size_t numIndices) override;
+		bool supportsInstancing() const override;
+		void setInstancedVertices(const MaterialDefinition& material, size_t numInstances, void* instanceData) override;
+		void drawInstancedQuads(size_t numInstances) override;
 		void setViewPort(Rect4i rect) override;
 		void setClip(Rect4i clip, bool enable) override;
 
 		void onUpdateProjection(Material& material) override;
 
+		bool supportsTimestamps() const override;
+		void beginTimestamps(int slot) override;
+		void writeTimestamp(int slot, size_t index) override;
+		void endTimestamps(int slot) override;
+		bool readTimestamps(int slot, size_t count, Vector<int64_t>& nanoseconds) override;
+
 	private:
+		struct TimestampQueries
+		{
+			ID3D11Query* disjoint = nullptr;
+			Vector<ID3D11Query*> timestamps;
+		};
+
 		DX11Video& video;
 
-		std::vector<DX11Buffer> vertexBuffers;
-		std::vector<DX11Buffer> indexBuffers;
+		DX11Buffer vertexBuffer;
+		DX11Buffer indexBuffer;
+		DX11Buffer unitQuadBuffer;
+		DX11Buffer unitQuadIndexBuffer;
+		DX11MaterialConstantBuffer constantBuffer;
+		bool unitQuadReady = false;
+		bool instanced = false;
 		ID3D11InputLayout* layout;
 		std::map<BlendType, DX11Blend> blendModes;
+		std::map<uint64_t, DX11DepthStencil> depthStencilModes;
 		std::unique_ptr<DX11Rasterizer> normalRaster;
 		std::unique_ptr<DX11Rasterizer> scissorRaster;
+		std::array<TimestampQueries, gpuTimerLatency> timestampQueries;
+
+		// Device state cache, reset every frame
+		const DX11Shader* boundShader = nullptr;
+		bool boundShaderInstanced = false;
+		const DX11Blend* boundBlend = nullptr;
+		const DX11DepthStencil* boundDepthStencil = nullptr;
+		const DX11Rasterizer* boundRaster = nullptr;
 
-		size_t curBuffer = 0;
+		void bindRasterizer(DX11Rasterizer& raster);
 
 		DX11Blend& getBlendMode(BlendType type);
-		void rotateBuffers();
+		DX11DepthStencil& getDepthStencil(const MaterialDepthStencil& definition);
 	};
 }
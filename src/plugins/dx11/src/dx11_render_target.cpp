@@ -3,10 +3,11 @@
 #include "dx11_texture.h"
 using namespace Halley;
 
-DX11ScreenRenderTarget::DX11ScreenRenderTarget(DX11Video& video, const Rect4i& viewPort, ID3D11RenderTargetView* view)
+DX11ScreenRenderTarget::DX11ScreenRenderTarget(DX11Video& video, const Rect4i& viewPort, ID3D11RenderTargetView* view, ID3D11DepthStencilView* depthStencilView)
 	: ScreenRenderTarget(viewPort)
 	, video(video)
 	, view(view)
+	, depthStencilView(depthStencilView)
 {
 }
 
@@ -23,7 +24,7 @@ bool DX11ScreenRenderTarget::getViewportFlipVertical() const
 void DX11ScreenRenderTarget::onBind(Painter& painter)
 {
 	ID3D11RenderTargetView* views[] = { view };
-	video.getDeviceContext().OMSetRenderTargets(1, views, nullptr);
+	video.getDeviceContext().OMSetRenderTargets(1, views, depthStencilView);
 }
 
 ID3D11RenderTargetView* DX11ScreenRenderTarget::getRenderTargetView()
@@ -31,6 +32,11 @@ ID3D11RenderTargetView* DX11ScreenRenderTarget::getRenderTargetView()
 	return view;
 }
 
+ID3D11DepthStencilView* DX11ScreenRenderTarget::getDepthStencilView()
+{
+	return depthStencilView;
+}
+
 DX11TextureRenderTarget::DX11TextureRenderTarget(DX11Video& video)
 	: video(video)
 {
@@ -63,6 +69,12 @@ ID3D11RenderTargetView* DX11TextureRenderTarget::getRenderTargetView()
 	return views.at(0);
 }
 
+ID3D11DepthStencilView* DX11TextureRenderTarget::getDepthStencilView()
+{
+	update();
+	return depthStencilView;
+}
+
 void DX11TextureRenderTarget::update()
 {
 	if (dirty) {
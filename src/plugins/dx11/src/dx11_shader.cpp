@@ -2,6 +2,7 @@
 #include "dx11_video.h"
 #include "halley/core/graphics/material/material_definition.h"
 #include "halley/support/logger.h"
+#include <algorithm>
 using namespace Halley;
 
 DX11Shader::DX11Shader(DX11Video& video, const ShaderDefinition& definition)
@@ -30,6 +31,10 @@ DX11Shader::~DX11Shader()
 		layout->Release();
 		layout = nullptr;
 	}
+	if (instancedLayout) {
+		instancedLayout->Release();
+		instancedLayout = nullptr;
+	}
 }
 
 void DX11Shader::loadShader(DX11Video& video, ShaderType type, const Bytes& bytes)
@@ -69,17 +74,17 @@ int DX11Shader::getBlockLocation(const String& name, ShaderType stage)
 	return -1;
 }
 
-void DX11Shader::bind(DX11Video& video)
+void DX11Shader::bind(DX11Video& video, bool instanced)
 {
 	Expects(vertexShader);
-	Expects(layout);
+	Expects(instanced ? instancedLayout : layout);
 
 	auto& devCon = video.getDeviceContext();
 	devCon.VSSetShader(vertexShader, nullptr, 0);
 	devCon.GSSetShader(geometryShader, nullptr, 0);
 	devCon.PSSetShader(pixelShader, nullptr, 0);
 
-	devCon.IASetInputLayout(layout);
+	devCon.IASetInputLayout(instanced ? instancedLayout : layout);
 }
 
 static DXGI_FORMAT getDX11Format(ShaderParameterType type)
@@ -114,6 +119,16 @@ void DX11Shader::setMaterialLayout(DX11Video& video, const std::vector<MaterialA
 
 	Expects(!vertexBlob.empty());
 
+	layout = createLayout(video, attributes, false);
+	const bool instanceable = std::any_of(attributes.begin(), attributes.end(), [] (const MaterialAttribute& a) { return a.perInstance; });
+	if (instanceable) {
+		instancedLayout = createLayout(video, attributes, true);
+	}
+	vertexBlob.clear();
+}
+
+ID3D11InputLayout* DX11Shader::createLayout(DX11Video& video, const std::vector<MaterialAttribute>& attributes, bool instanced)
+{
 	std::vector<std::array<char, 64>> names(attributes.size());
 	std::vector<D3D11_INPUT_ELEMENT_DESC> desc(attributes.size());
 
@@ -121,9 +136,12 @@ void DX11Shader::setMaterialLayout(DX11Video& video, const std::vector<MaterialA
 		auto& a = attributes[i];
 		
 		UINT semanticIndex = 0;
-		UINT inputSlot = 0;
 		DXGI_FORMAT format = getDX11Format(a.type);
-		UINT byteOffset = a.offset;
+
+		// When instanced, slot 0 holds the unit quad (the per-vertex attributes) and slot 1 the instances
+		const bool perInstance = instanced && a.perInstance;
+		UINT inputSlot = instanced ? (perInstance ? 1 : 0) : 0;
+		UINT byteOffset = instanced && !perInstance ? 0 : a.offset;
 
 		String name = a.name.asciiUpper();
 		if (name.startsWith("A_")) {
@@ -135,12 +153,13 @@ void DX11Shader::setMaterialLayout(DX11Video& video, const std::vector<MaterialA
 		}
 		strcpy_s(names[i].data(), 64, name.c_str());
 
-		desc[i] = { names[i].data(), semanticIndex, format, inputSlot, byteOffset, D3D11_INPUT_PER_VERTEX_DATA, 0 };
+		desc[i] = { names[i].data(), semanticIndex, format, inputSlot, byteOffset, perInstance ? D3D11_INPUT_PER_INSTANCE_DATA : D3D11_INPUT_PER_VERTEX_DATA, perInstance ? 1u : 0u };
 	}
 
-	HRESULT result = video.getDevice().CreateInputLayout(desc.data(), UINT(desc.size()), vertexBlob.data(), vertexBlob.size(), &layout);
-	if (result != S_OK) {
+	ID3D11InputLayout* result = nullptr;
+	HRESULT hr = video.getDevice().CreateInputLayout(desc.data(), UINT(desc.size()), vertexBlob.data(), vertexBlob.size(), &result);
+	if (hr != S_OK) {
 		throw Exception("Unable to create input layout for shader " + name, HalleyExceptions::VideoPlugin);
 	}
-	vertexBlob.clear();
+	return result;
 }
@@ -18,7 +18,7 @@ namespace Halley
 		int getUniformLocation(const String& name, ShaderType stage) override;
 		int getBlockLocation(const String& name, ShaderType stage) override;
 
-		void bind(DX11Video& video);
+		void bind(DX11Video& video, bool instanced = false);
 		void setMaterialLayout(DX11Video& video, const std::vector<MaterialAttribute>& attributes);
 
 	private:
@@ -27,8 +27,10 @@ namespace Halley
 		ID3D11PixelShader* pixelShader = nullptr;
 		ID3D11GeometryShader* geometryShader = nullptr;
 		ID3D11InputLayout* layout = nullptr;
+		ID3D11InputLayout* instancedLayout = nullptr;
 		Bytes vertexBlob;
 
 		void loadShader(DX11Video& video, ShaderType type, const Bytes& bytes);
+		ID3D11InputLayout* createLayout(DX11Video& video, const std::vector<MaterialAttribute>& attributes, bool instanced);
 	};
 }
@@ -1,6 +1,7 @@
 #include "dx11_texture.h"
 #include "dx11_video.h"
 #include "halley/core/graphics/texture_descriptor.h"
+#include <gsl/gsl_assert>
 using namespace Halley;
 
 DX11Texture::DX11Texture(DX11Video& video, Vector2i size)
@@ -30,6 +31,16 @@ DX11Texture& DX11Texture::operator=(DX11Texture&& other) noexcept
 {
 	other.waitForLoad();
 
+	if (samplerState) {
+		samplerState->Release();
+	}
+	if (srv) {
+		srv->Release();
+	}
+	if (texture) {
+		texture->Release();
+	}
+
 	texture = other.texture;
 	srv = other.srv;
 	samplerState = other.samplerState;
@@ -48,11 +59,14 @@ DX11Texture& DX11Texture::operator=(DX11Texture&& other) noexcept
 void DX11Texture::load(TextureDescriptor&& descriptor)
 {
 	int bpp = 0;
+	const bool compressed = TextureDescriptor::isCompressed(descriptor.format);
+	const int mipLevels = descriptor.pixelData.empty() ? 1 : descriptor.mipLevels;
 
 	CD3D11_TEXTURE2D_DESC desc;
-	desc.Width = size.x;
-	desc.Height = size.y;
-	desc.MipLevels = desc.ArraySize = 1;
+	desc.Width = descriptor.size.x;
+	desc.Height = descriptor.size.y;
+	desc.MipLevels = mipLevels;
+	desc.ArraySize = 1;
 	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
 
 	switch (descriptor.format) {
@@ -71,6 +85,18 @@ void DX11Texture::load(TextureDescriptor&& descriptor)
 		desc.Format = DXGI_FORMAT_D32_FLOAT;
 		bpp = 4;
 		break;
+	case TextureFormat::BC1:
+		desc.Format = DXGI_FORMAT_BC1_UNORM;
+		break;
+	case TextureFormat::BC3:
+		desc.Format = DXGI_FORMAT_BC3_UNORM;
+		break;
+	case TextureFormat::BC7:
+		desc.Format = DXGI_FORMAT_BC7_UNORM;
+		break;
+	case TextureFormat::ETC2:
+	case TextureFormat::ASTC4x4:
+		throw Exception("Texture format " + toString(descriptor.format) + " is not supported by DX11", HalleyExceptions::VideoPlugin);
 	default:
 		throw Exception("Unknown texture format", HalleyExceptions::VideoPlugin);
 	}
@@ -87,8 +113,27 @@ void DX11Texture::load(TextureDescriptor&& descriptor)
 
 	D3D11_SUBRESOURCE_DATA* res = nullptr;
 	D3D11_SUBRESOURCE_DATA subResData;
+	std::vector<D3D11_SUBRESOURCE_DATA> mipData;
+
+	if (compressed && descriptor.pixelData.empty()) {
+		throw Exception("Compressed textures must be created with their data.", HalleyExceptions::VideoPlugin);
+	}
+
+	if (compressed || mipLevels > 1) {
+		desc.Usage = D3D11_USAGE_IMMUTABLE;
+		desc.CPUAccessFlags = 0;
 
-	if (descriptor.pixelData.empty()) {
+		// Levels are tightly packed; for compressed formats, a row is a row of 4x4 blocks
+		mipData.resize(mipLevels);
+		for (int i = 0; i < mipLevels; ++i) {
+			const auto levelSize = TextureDescriptor::getMipLevelSize(descriptor.size, i);
+			const auto data = descriptor.pixelData.getMipLevel(descriptor.format, descriptor.size, i);
+			mipData[i].pSysMem = data.data();
+			mipData[i].SysMemPitch = UINT(TextureDescriptor::getDataSize(descriptor.format, Vector2i(levelSize.x, 1)));
+			mipData[i].SysMemSlicePitch = UINT(data.size());
+		}
+		res = mipData.data();
+	} else if (descriptor.pixelData.empty()) {
 		desc.Usage = D3D11_USAGE_DEFAULT;
 		desc.CPUAccessFlags = 0;
 	} else {
@@ -99,7 +144,7 @@ void DX11Texture::load(TextureDescriptor&& descriptor)
 		}
 		desc.CPUAccessFlags = 0;
 		subResData.pSysMem = descriptor.pixelData.getSpan().data();
-		subResData.SysMemPitch = descriptor.pixelData.getStrideOr(bpp * size.x);
+		subResData.SysMemPitch = descriptor.pixelData.getStrideOr(bpp * descriptor.size.x);
 		subResData.SysMemSlicePitch = subResData.SysMemPitch;
 		res = &subResData;
 	}
@@ -112,7 +157,7 @@ void DX11Texture::load(TextureDescriptor&& descriptor)
 	CD3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
 	srvDesc.Format = desc.Format;
 	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-	srvDesc.Texture2D.MipLevels = 1;
+	srvDesc.Texture2D.MipLevels = mipLevels;
 	srvDesc.Texture2D.MostDetailedMip = 0;
 
 	result = video.getDevice().CreateShaderResourceView(texture, &srvDesc, &srv);
@@ -136,10 +181,43 @@ void DX11Texture::reload(Resource&& resource)
 	*this = std::move(dynamic_cast<DX11Texture&>(resource));
 }
 
+void DX11Texture::updateRegion(Rect4i area, TextureFormat format, Bytes&& pixels)
+{
+	Expects(!TextureDescriptor::isCompressed(format));
+	Expects(pixels.size() == TextureDescriptor::getDataSize(format, area.getSize()));
+
+	// The immediate context belongs to the render thread, so this is applied on the next bind
+	std::unique_lock<std::mutex> lock(regionMutex);
+	pendingRegions.push_back(PendingRegion{ area, format, std::move(pixels) });
+	hasPendingRegions.store(true, std::memory_order_release);
+}
+
+void DX11Texture::uploadPendingRegions() const
+{
+	std::unique_lock<std::mutex> lock(regionMutex);
+	for (auto& region: pendingRegions) {
+		D3D11_BOX box;
+		box.left = UINT(region.area.getLeft());
+		box.top = UINT(region.area.getTop());
+		box.right = UINT(region.area.getRight());
+		box.bottom = UINT(region.area.getBottom());
+		box.front = 0;
+		box.back = 1;
+		const UINT rowPitch = UINT(TextureDescriptor::getDataSize(region.format, Vector2i(region.area.getWidth(), 1)));
+		video.getDeviceContext().UpdateSubresource(texture, 0, &box, region.pixels.data(), rowPitch, 0);
+	}
+	pendingRegions.clear();
+	hasPendingRegions.store(false, std::memory_order_relaxed);
+}
+
 void DX11Texture::bind(DX11Video& video, int textureUnit) const
 {
 	waitForLoad();
 
+	if (hasPendingRegions.load(std::memory_order_acquire)) {
+		uploadPendingRegions();
+	}
+
 	ID3D11ShaderResourceView* srvs[] = { srv };
 	ID3D11SamplerState* samplers[] = { samplerState };
 	video.getDeviceContext().PSSetShaderResources(textureUnit, 1, srvs);
@@ -1,6 +1,8 @@
 #pragma once
 #include "halley/core/graphics/texture.h"
 #include <d3d11.h>
+#include <mutex>
+#include <atomic>
 #undef min
 #undef max
 
@@ -18,6 +20,7 @@ namespace Halley
 
 		void load(TextureDescriptor&& descriptor) override;
 		void reload(Resource&& resource) override;
+		void updateRegion(Rect4i area, TextureFormat format, Bytes&& pixels) override;
 
 		void bind(DX11Video& video, int textureUnit) const;
 		
@@ -25,10 +28,23 @@ namespace Halley
 		ID3D11Texture2D* getTexture() const;
 
 	private:
+		struct PendingRegion
+		{
+			Rect4i area;
+			TextureFormat format;
+			Bytes pixels;
+		};
+
 		DX11Video& video;
 		ID3D11Texture2D* texture = nullptr;
 		ID3D11ShaderResourceView* srv = nullptr;
 		ID3D11SamplerState* samplerState = nullptr;
 		DXGI_FORMAT format;
+
+		mutable std::mutex regionMutex;
+		mutable Vector<PendingRegion> pendingRegions;
+		mutable std::atomic<bool> hasPendingRegions{ false };
+
+		void uploadPendingRegions() const;
 	};
 }
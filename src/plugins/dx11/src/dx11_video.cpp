@@ -3,7 +3,6 @@
 #include "dx11_shader.h"
 #include "dx11_texture.h"
 #include "dx11_render_target.h"
-#include "dx11_material_constant_buffer.h"
 
 #include <windows.h>
 #include <windowsx.h>
@@ -69,6 +68,13 @@ void DX11Video::initD3D(Window& window)
 		throw Exception("Unable to initialise DX11.1", HalleyExceptions::VideoPlugin);
 	}
 
+	// Constant buffers can only be streamed (bound at an offset and appended to with NO_OVERWRITE) on 11.1 runtimes that support it
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options;
+	ZeroMemory(&options, sizeof(options));
+	if (SUCCEEDED(device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options)))) {
+		constantBufferOffsets = options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer;
+	}
+
 	ID3D10Multithread* mt;
 	device->QueryInterface(__uuidof(ID3D10Multithread), reinterpret_cast<void**>(&mt));
 	if (mt) {
@@ -136,23 +142,52 @@ void DX11Video::initSwapChain(Window& window)
 
 void DX11Video::initBackBuffer()
 {
-	if (backbuffer) {
-		backbuffer->Release();
-		backbuffer = nullptr;
-	}
+	releaseBackBuffer();
 
 	ID3D11Texture2D *pBackBuffer;
     swapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), reinterpret_cast<LPVOID*>(&pBackBuffer));
     device->CreateRenderTargetView(pBackBuffer, nullptr, &backbuffer);
     pBackBuffer->Release();
+
+	D3D11_TEXTURE2D_DESC depthDesc;
+	ZeroMemory(&depthDesc, sizeof(D3D11_TEXTURE2D_DESC));
+	depthDesc.Width = swapChainSize.x;
+	depthDesc.Height = swapChainSize.y;
+	depthDesc.MipLevels = 1;
+	depthDesc.ArraySize = 1;
+	depthDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+	depthDesc.SampleDesc.Count = 1;
+	depthDesc.Usage = D3D11_USAGE_DEFAULT;
+	depthDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+
+	ID3D11Texture2D* depthTexture;
+	auto result = device->CreateTexture2D(&depthDesc, nullptr, &depthTexture);
+	if (result != S_OK) {
+		throw Exception("Unable to create depth buffer", HalleyExceptions::VideoPlugin);
+	}
+	result = device->CreateDepthStencilView(depthTexture, nullptr, &backbufferDepth);
+	depthTexture->Release();
+	if (result != S_OK) {
+		throw Exception("Unable to create depth stencil view for depth buffer", HalleyExceptions::VideoPlugin);
+	}
 }
 
-void DX11Video::resizeSwapChain(Vector2i size)
+void DX11Video::releaseBackBuffer()
 {
 	if (backbuffer) {
 		backbuffer->Release();
 		backbuffer = nullptr;
 	}
+
+	if (backbufferDepth) {
+		backbufferDepth->Release();
+		backbufferDepth = nullptr;
+	}
+}
+
+void DX11Video::resizeSwapChain(Vector2i size)
+{
+	releaseBackBuffer();
 	
 	HRESULT result = swapChain->ResizeBuffers(0, size.x, size.y, DXGI_FORMAT_UNKNOWN, 0);
 	if (result != S_OK) {
@@ -170,10 +205,7 @@ void DX11Video::releaseD3D()
 		return;
 	}
 
-	if (backbuffer) {
-		backbuffer->Release();
-		backbuffer = nullptr;
-	}
+	releaseBackBuffer();
 
 	if (swapChain) {
 		swapChain->Release();
@@ -241,12 +273,7 @@ std::unique_ptr<ScreenRenderTarget> DX11Video::createScreenRenderTarget()
 		resizeSwapChain(view.getSize());
 	}
 
-	return std::make_unique<DX11ScreenRenderTarget>(*this, view, backbuffer);
-}
-
-std::unique_ptr<MaterialConstantBuffer> DX11Video::createConstantBuffer()
-{
-	return std::make_unique<DX11MaterialConstantBuffer>(*this);
+	return std::make_unique<DX11ScreenRenderTarget>(*this, view, backbuffer, backbufferDepth);
 }
 
 std::unique_ptr<Painter> DX11Video::makePainter(Resources& resources)
@@ -269,6 +296,17 @@ ID3D11DeviceContext1& DX11Video::getDeviceContext()
 	return *deviceContext;
 }
 
+bool DX11Video::canRenderOnAnyThread() const
+{
+	// The device is created with multithread protection on, so the immediate context can be used from one other thread
+	return true;
+}
+
+bool DX11Video::canOffsetConstantBuffers() const
+{
+	return constantBufferOffsets;
+}
+
 SystemAPI& DX11Video::getSystem()
 {
 	return system;
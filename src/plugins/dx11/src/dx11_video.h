@@ -29,7 +29,6 @@ namespace Halley {
 		std::unique_ptr<Shader> createShader(const ShaderDefinition& definition) override;
 		std::unique_ptr<TextureRenderTarget> createTextureRenderTarget() override;
 		std::unique_ptr<ScreenRenderTarget> createScreenRenderTarget() override;
-		std::unique_ptr<MaterialConstantBuffer> createConstantBuffer() override;
 		
 		void init() override;
 		void deInit() override;
@@ -37,9 +36,11 @@ namespace Halley {
 		std::unique_ptr<Painter> makePainter(Resources& resources) override;
 
 		String getShaderLanguage() override;
+		bool canRenderOnAnyThread() const override;
 
 		ID3D11Device& getDevice();
 		ID3D11DeviceContext1& getDeviceContext();
+		bool canOffsetConstantBuffers() const;
 		
 		SystemAPI& getSystem();
 
@@ -53,16 +54,19 @@ namespace Halley {
 		ID3D11DeviceContext1* deviceContext = nullptr;
 		IDXGISwapChain1* swapChain = nullptr;
 		ID3D11RenderTargetView* backbuffer = nullptr;
+		ID3D11DepthStencilView* backbufferDepth = nullptr;
 
 		Vector2i swapChainSize;
 		bool initialised = false;
 		bool useVsync = false;
+		bool constantBufferOffsets = false;
 
 		std::unique_ptr<DX11Loader> loader;
 
 		void initD3D(Window& window);
 		void initSwapChain(Window& window);
 		void initBackBuffer();
+		void releaseBackBuffer();
 		void resizeSwapChain(Vector2i size);
 		void releaseD3D();
 	};
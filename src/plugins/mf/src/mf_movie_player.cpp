@@ -171,6 +171,7 @@ void MFMoviePlayer::init()
 						hr = nativeType->GetUINT32(MF_MT_DEFAULT_STRIDE, &stride);
 
 						setVideoSize(videoSize);
+						setPlaneLayout(alignUp(videoSize.y, 16));
 						curStream.type = MoviePlayerStreamType::Video;
 						subType = MFVideoFormat_NV12; // NV12 is the only format supported by DX accelerated decoding
 
@@ -361,6 +362,11 @@ HRESULT MFMoviePlayer::onReadSample(HRESULT hr, DWORD streamIndex, DWORD streamF
 	return S_OK;
 }
 
+bool MFMoviePlayer::shouldRecycleTextures() const
+{
+	return true;
+}
+
 void MFMoviePlayer::readVideoSample(Time time, const gsl::byte* data, int stride)
 {
 	if (!data) {
@@ -376,15 +382,25 @@ void MFMoviePlayer::readVideoSample(Time time, const gsl::byte* data, int stride
 	const int width = alignUp(videoSize.x, 16);
 	const int height = yPlaneHeight + uvPlaneHeight;
 
-	auto srcData = gsl::span<const gsl::byte>(data, stride * height);
-	Bytes myData(srcData.size_bytes());
-	memcpy(myData.data(), data, myData.size());
+	if (stride < width) {
+		throw Exception("MFMoviePlayer::readVideoSample, Stride is smaller than the frame: " + toString(stride), HalleyExceptions::MoviePlugin);
+	}
+
+	// Drop the row padding while copying out of the sample, so recycled textures can be updated directly with it
+	Bytes myData(size_t(width) * size_t(height));
+	if (stride == width) {
+		memcpy(myData.data(), data, myData.size());
+	} else {
+		for (int y = 0; y < height; ++y) {
+			memcpy(myData.data() + size_t(y) * width, data + size_t(y) * stride, size_t(width));
+		}
+	}
 
 	TextureDescriptor descriptor;
 	descriptor.format = TextureFormat::Indexed;
 	descriptor.pixelFormat = PixelDataFormat::Image;
 	descriptor.size = Vector2i(width, height);
-	descriptor.pixelData = TextureDescriptorImageData(std::move(myData), stride);
+	descriptor.pixelData = TextureDescriptorImageData(std::move(myData));
 
 	onVideoFrameAvailable(time, std::move(descriptor));
 }
@@ -1,29 +1,87 @@
 #include "constant_buffer_opengl.h"
-#include "halley/core/graphics/material/material_parameter.h"
-#include "halley/core/graphics/material/material_definition.h"
 #include "gl_utils.h"
-#include "halley/support/exception.h"
-#include "texture_opengl.h"
 
 using namespace Halley;
 
-ConstantBufferOpenGL::ConstantBufferOpenGL()
+void ConstantBufferOpenGL::init()
 {
-	buffer.init(GL_UNIFORM_BUFFER);
+	if (initialised) {
+		return;
+	}
+	initialised = true;
+
+	GLint align = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align);
+	alignment = std::max(size_t(align), size_t(16));
+	buffer.init(GL_UNIFORM_BUFFER, 256 * 1024);
+	generation = buffer.getGeneration();
+	glCheckError();
 }
 
-ConstantBufferOpenGL::~ConstantBufferOpenGL()
+void ConstantBufferOpenGL::beginFrame()
 {
-	
+	// Last frame's segment will be overwritten a few frames from now, so whatever is still bound moves to this one
+	buffer.beginFrame();
+	offsets.clear();
+	rebindAll();
 }
 
-void ConstantBufferOpenGL::update(const MaterialDataBlock& dataBlock)
+void ConstantBufferOpenGL::endFrame()
 {
-	buffer.setData(dataBlock.getData());
+	buffer.endFrame();
 }
 
-void ConstantBufferOpenGL::bind(int bindPoint)
+void ConstantBufferOpenGL::bind(const MaterialDataBlock& dataBlock)
 {
-	buffer.bindToTarget(bindPoint);
-	glCheckError();
+	bind(dataBlock.getBindPoint(), dataBlock.getData(), dataBlock.getHash());
+}
+
+void ConstantBufferOpenGL::bind(int bindPoint, gsl::span<const gsl::byte> data, uint64_t hash)
+{
+	if (data.empty()) {
+		return;
+	}
+
+	// Kept in case the block has to be written again, see rebindAll
+	if (size_t(bindPoint) >= bound.size()) {
+		bound.resize(size_t(bindPoint) + 1);
+	}
+	auto& block = bound[bindPoint];
+	if (block.data.empty() || block.hash != hash) {
+		block.data.assign(reinterpret_cast<const Byte*>(data.data()), reinterpret_cast<const Byte*>(data.data()) + data.size_bytes());
+		block.hash = hash;
+	}
+
+	auto iter = offsets.find(hash);
+	const size_t offset = iter != offsets.end() ? iter->second : write(data, hash);
+	buffer.bindRange(GLuint(bindPoint), offset, size_t(data.size_bytes()));
+}
+
+size_t ConstantBufferOpenGL::write(gsl::span<const gsl::byte> data, uint64_t hash)
+{
+	const size_t offset = buffer.write(data, alignment);
+	offsets[hash] = offset;
+
+	if (buffer.getGeneration() != generation) {
+		// The buffer grew, which drops everything written to the old one, including the blocks already bound
+		generation = buffer.getGeneration();
+		offsets.clear();
+		offsets[hash] = offset;
+		rebindAll();
+	}
+
+	return offset;
+}
+
+void ConstantBufferOpenGL::rebindAll()
+{
+	for (size_t i = 0; i < bound.size(); ++i) {
+		auto& block = bound[i];
+		if (!block.data.empty()) {
+			auto iter = offsets.find(block.hash);
+			const auto data = gsl::as_bytes(gsl::span<const Byte>(block.data));
+			const size_t offset = iter != offsets.end() ? iter->second : write(data, block.hash);
+			buffer.bindRange(GLuint(i), offset, block.data.size());
+		}
+	}
 }
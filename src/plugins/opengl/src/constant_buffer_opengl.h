@@ -1,18 +1,37 @@
 #pragma once
 #include "halley/core/graphics/material/material.h"
+#include "halley/data_structures/hash_map.h"
 #include "gl_buffer.h"
 
 namespace Halley
 {
-	class ConstantBufferOpenGL : public MaterialConstantBuffer
+	// Uniform blocks of every material drawn in a frame, packed into one GLStreamBuffer and bound by range.
+	// Blocks with the same contents are only written once per frame.
+	class ConstantBufferOpenGL
 	{
 	public:
-		explicit ConstantBufferOpenGL();
-		~ConstantBufferOpenGL();
-		void update(const MaterialDataBlock& dataBlock) override;
-		void bind(int bindPoint);
+		void init();
+		void beginFrame();
+		void endFrame();
+
+		void bind(const MaterialDataBlock& dataBlock);
 
 	private:
-		GLBuffer buffer;
+		struct BoundBlock
+		{
+			Bytes data;
+			uint64_t hash = 0;
+		};
+
+		GLStreamBuffer buffer;
+		size_t alignment = 256;
+		size_t generation = 0;
+		bool initialised = false;
+		HashMap<uint64_t, size_t> offsets;
+		Vector<BoundBlock> bound;
+
+		void bind(int bindPoint, gsl::span<const gsl::byte> data, uint64_t hash);
+		size_t write(gsl::span<const gsl::byte> data, uint64_t hash);
+		void rebindAll();
 	};
 }
@@ -1,4 +1,6 @@
 #include "gl_buffer.h"
+#include <cstring>
+#include <algorithm>
 
 using namespace Halley;
 
@@ -50,3 +52,247 @@ void GLBuffer::bindToTarget(GLuint index)
 	glBindBufferRange(target, index, name, 0, size);
 	glCheckError();
 }
+
+GLStreamBuffer::GLStreamBuffer()
+{
+#ifdef WITH_OPENGL
+	fences.fill(nullptr);
+#endif
+}
+
+GLStreamBuffer::~GLStreamBuffer()
+{
+	release();
+}
+
+void GLStreamBuffer::init(GLenum t, size_t size)
+{
+	if (name == 0) {
+		target = t;
+		allocate(size);
+	}
+}
+
+void GLStreamBuffer::bind()
+{
+	glBindBuffer(target, name);
+	glCheckError();
+}
+
+void GLStreamBuffer::beginFrame()
+{
+	// Wait until the GPU is done with whatever was written into this segment numSegments frames ago
+	waitForSegment(segment);
+	pos = 0;
+}
+
+void GLStreamBuffer::endFrame()
+{
+#ifdef WITH_OPENGL
+	Expects(fences[segment] == nullptr);
+	fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glCheckError();
+#endif
+	segment = (segment + 1) % numSegments;
+}
+
+size_t GLStreamBuffer::write(gsl::span<const gsl::byte> data, size_t alignment)
+{
+	const size_t size = size_t(data.size_bytes());
+	size_t start = alignUp(pos, alignment);
+
+	if (start + size > segmentSize) {
+		// Too much data this frame; move to a bigger buffer. The old one is only freed by the driver once the GPU is
+		// done with it, so nothing in flight needs waiting for.
+		release();
+		allocate(nextPowerOf2(std::max(segmentSize * 2, size + alignment)));
+		start = 0;
+	}
+
+	const size_t offset = segment * segmentSize + start;
+	pos = start + size;
+
+	bind();
+	if (persistent) {
+		memcpy(mapped + offset, data.data(), size);
+	} else {
+#ifdef WITH_OPENGL
+		// Fences already guarantee that this range isn't in use, so skip the driver's own synchronization
+		auto dst = glMapBufferRange(target, GLintptr(offset), GLsizeiptr(size), GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+		memcpy(dst, data.data(), size);
+		glUnmapBuffer(target);
+#else
+		glBufferSubData(target, GLintptr(offset), GLsizeiptr(size), data.data());
+#endif
+	}
+	glCheckError();
+
+	return offset;
+}
+
+void GLStreamBuffer::bindRange(GLuint index, size_t offset, size_t size)
+{
+	glBindBufferRange(target, index, name, GLintptr(offset), GLsizeiptr(size));
+	glCheckError();
+}
+
+size_t GLStreamBuffer::getGeneration() const
+{
+	return generation;
+}
+
+void GLStreamBuffer::allocate(size_t size)
+{
+	++generation;
+	segmentSize = size;
+	const size_t totalSize = segmentSize * numSegments;
+
+	glGenBuffers(1, &name);
+	bind();
+
+#ifdef WITH_OPENGL
+	persistent = ogl_ext_ARB_buffer_storage == ogl_LOAD_SUCCEEDED;
+	if (persistent) {
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(target, GLsizeiptr(totalSize), nullptr, flags);
+		mapped = static_cast<gsl::byte*>(glMapBufferRange(target, 0, GLsizeiptr(totalSize), flags));
+		persistent = mapped != nullptr;
+	}
+	if (!persistent) {
+		glBufferData(target, GLsizeiptr(totalSize), nullptr, GL_STREAM_DRAW);
+	}
+#else
+	glBufferData(target, GLsizeiptr(totalSize), nullptr, GL_STREAM_DRAW);
+#endif
+
+	glCheckError();
+}
+
+void GLStreamBuffer::release()
+{
+#ifdef WITH_OPENGL
+	for (auto& fence: fences) {
+		if (fence) {
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+#endif
+
+	if (name != 0) {
+		if (mapped) {
+			bind();
+			glUnmapBuffer(target);
+			mapped = nullptr;
+		}
+		glBindBuffer(target, 0);
+		glDeleteBuffers(1, &name);
+		name = 0;
+	}
+	persistent = false;
+}
+
+void GLStreamBuffer::waitForSegment(size_t idx)
+{
+#ifdef WITH_OPENGL
+	auto& fence = fences[idx];
+	if (fence) {
+		GLenum result = glClientWaitSync(fence, 0, 0);
+		while (result == GL_TIMEOUT_EXPIRED) {
+			result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+		}
+		glDeleteSync(fence);
+		fence = nullptr;
+		glCheckError();
+	}
+#endif
+}
+
+#ifdef WITH_OPENGL
+GLPixelBufferPool::~GLPixelBufferPool()
+{
+	for (auto& b: freeBuffers) {
+		destroy(b);
+	}
+}
+
+std::shared_ptr<GLPixelBufferPool::Buffer> GLPixelBufferPool::acquire(size_t size)
+{
+	// Smallest buffer that fits and isn't still being read from
+	auto best = freeBuffers.end();
+	for (auto i = freeBuffers.begin(); i != freeBuffers.end(); ++i) {
+		if (i->buffer->capacity >= size && (best == freeBuffers.end() || i->buffer->capacity < best->buffer->capacity) && isDone(*i)) {
+			best = i;
+		}
+	}
+
+	std::shared_ptr<Buffer> buffer;
+	if (best != freeBuffers.end()) {
+		buffer = std::move(best->buffer);
+		glDeleteSync(best->fence);
+		freeBuffers.erase(best);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer->name);
+	} else {
+		buffer = std::make_shared<Buffer>();
+		buffer->capacity = nextPowerOf2(size);
+		glGenBuffers(1, &buffer->name);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer->name);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, GLsizeiptr(buffer->capacity), nullptr, GL_STREAM_DRAW);
+	}
+
+	// The fence already made sure nothing is reading from it
+	buffer->mapped = static_cast<gsl::byte*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, GLsizeiptr(size), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glCheckError();
+
+	if (!buffer->mapped) {
+		glDeleteBuffers(1, &buffer->name);
+		return {};
+	}
+	return buffer;
+}
+
+bool GLPixelBufferPool::bindForUpload(Buffer& buffer)
+{
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.name);
+	const bool ok = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+	buffer.mapped = nullptr;
+	if (!ok) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+	glCheckError();
+	return ok;
+}
+
+void GLPixelBufferPool::release(std::shared_ptr<Buffer> buffer)
+{
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	if (buffer->mapped) {
+		// Never got to bindForUpload
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer->name);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		buffer->mapped = nullptr;
+	}
+
+	if (freeBuffers.size() == maxFreeBuffers) {
+		destroy(freeBuffers.front());
+		freeBuffers.erase(freeBuffers.begin());
+	}
+	freeBuffers.push_back(FreeBuffer{ std::move(buffer), glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) });
+	glCheckError();
+}
+
+bool GLPixelBufferPool::isDone(const FreeBuffer& buffer)
+{
+	const GLenum result = glClientWaitSync(buffer.fence, 0, 0);
+	return result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED;
+}
+
+void GLPixelBufferPool::destroy(FreeBuffer& buffer)
+{
+	// Deleting is deferred by the driver if it's still in use
+	glDeleteSync(buffer.fence);
+	glDeleteBuffers(1, &buffer.buffer->name);
+}
+#endif
@@ -2,6 +2,9 @@
 
 #include "halley_gl.h"
 #include <gsl/gsl>
+#include <array>
+#include <memory>
+#include <halley/data_structures/vector.h>
 
 namespace Halley
 {
@@ -24,4 +27,91 @@ namespace Halley
 		size_t capacity = 0;
 		size_t size = 0;
 	};
+
+	// Ring buffer for data that is written once and drawn once (e.g. sprite vertices).
+	// The buffer is split in one segment per frame in flight, each guarded by a fence, so data is appended without
+	// ever stalling on or re-specifying storage that the GPU might still be reading from.
+	// Uses a persistently mapped buffer if ARB_buffer_storage is available, and unsynchronized maps otherwise.
+	class GLStreamBuffer
+	{
+	public:
+		static constexpr size_t numSegments = 3;
+
+		GLStreamBuffer();
+		~GLStreamBuffer();
+
+		void init(GLenum target, size_t segmentSize);
+		void bind();
+
+		void beginFrame();
+		void endFrame();
+
+		// Appends data to the current segment and leaves the buffer bound; returns its offset in the buffer
+		size_t write(gsl::span<const gsl::byte> data, size_t alignment);
+
+		// Binds a range of the buffer to an indexed target (e.g. a uniform block binding point)
+		void bindRange(GLuint index, size_t offset, size_t size);
+
+		// Changes whenever write has to move to a bigger buffer, which invalidates all offsets returned before
+		size_t getGeneration() const;
+
+	private:
+		GLenum target = 0;
+		GLuint name = 0;
+		size_t segmentSize = 0;
+		size_t segment = 0;
+		size_t pos = 0;
+		size_t generation = 0;
+		bool persistent = false;
+		gsl::byte* mapped = nullptr;
+
+#ifdef WITH_OPENGL
+		std::array<GLsync, numSegments> fences;
+#endif
+
+		void allocate(size_t segmentSize);
+		void release();
+		void waitForSegment(size_t segment);
+	};
+
+#ifdef WITH_OPENGL
+	// Pixel unpack buffers for staging texture uploads. Buffers are handed out already mapped, so they can be filled
+	// from any thread, and only go back into circulation once the GPU is done with the uploads that read from them.
+	// Every method must be called on the same context (the loader thread's).
+	class GLPixelBufferPool
+	{
+	public:
+		struct Buffer
+		{
+			GLuint name = 0;
+			size_t capacity = 0;
+			gsl::byte* mapped = nullptr;
+		};
+
+		~GLPixelBufferPool();
+
+		// Returns a buffer mapped for writing at least size bytes, or null if it couldn't be mapped
+		std::shared_ptr<Buffer> acquire(size_t size);
+
+		// Unmaps the buffer and leaves it bound, so texture uploads take offsets into it instead of pointers.
+		// Returns false (with nothing bound) if the contents were lost while it was mapped.
+		bool bindForUpload(Buffer& buffer);
+
+		// Unbinds the buffer, and fences it behind the uploads issued so far
+		void release(std::shared_ptr<Buffer> buffer);
+
+	private:
+		constexpr static size_t maxFreeBuffers = 4;
+
+		struct FreeBuffer
+		{
+			std::shared_ptr<Buffer> buffer;
+			GLsync fence;
+		};
+		Vector<FreeBuffer> freeBuffers;
+
+		static bool isDone(const FreeBuffer& buffer);
+		static void destroy(FreeBuffer& buffer);
+	};
+#endif
 }
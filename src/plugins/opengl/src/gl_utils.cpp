@@ -105,6 +105,11 @@ namespace Halley {
 			scissoring = false;
 			curBlend = BlendType::Undefined;
 			hasClearCol = false;
+			depthTest = false;
+			depthWrite = true;
+			depthFunc = GL_LESS;
+			stencilTest = false;
+			stencilWriteMask = 0xFF;
 		}
 
 		int curTexUnit;
@@ -115,6 +120,13 @@ namespace Halley {
 		Colour clearCol;
 		bool scissoring;
 		bool hasClearCol;
+
+		// Initial values are the GL defaults, except for the tests, which VideoOpenGL disables
+		bool depthTest;
+		bool depthWrite;
+		GLenum depthFunc;
+		bool stencilTest;
+		int stencilWriteMask;
 	};
 
 }
@@ -210,6 +222,96 @@ void GLUtils::setBlendType(BlendType type)
 	}
 }
 
+static GLenum getGLComparisonFunction(DepthStencilComparisonFunction func)
+{
+	switch (func) {
+	case DepthStencilComparisonFunction::Never:
+		return GL_NEVER;
+	case DepthStencilComparisonFunction::Less:
+		return GL_LESS;
+	case DepthStencilComparisonFunction::Equal:
+		return GL_EQUAL;
+	case DepthStencilComparisonFunction::LessEqual:
+		return GL_LEQUAL;
+	case DepthStencilComparisonFunction::Greater:
+		return GL_GREATER;
+	case DepthStencilComparisonFunction::NotEqual:
+		return GL_NOTEQUAL;
+	case DepthStencilComparisonFunction::GreaterEqual:
+		return GL_GEQUAL;
+	case DepthStencilComparisonFunction::Always:
+	default:
+		return GL_ALWAYS;
+	}
+}
+
+static GLenum getGLStencilOp(StencilWriteOperation op)
+{
+	switch (op) {
+	case StencilWriteOperation::Zero:
+		return GL_ZERO;
+	case StencilWriteOperation::Replace:
+		return GL_REPLACE;
+	case StencilWriteOperation::IncrementClamp:
+		return GL_INCR;
+	case StencilWriteOperation::DecrementClamp:
+		return GL_DECR;
+	case StencilWriteOperation::Invert:
+		return GL_INVERT;
+	case StencilWriteOperation::IncrementWrap:
+		return GL_INCR_WRAP;
+	case StencilWriteOperation::DecrementWrap:
+		return GL_DECR_WRAP;
+	case StencilWriteOperation::Keep:
+	default:
+		return GL_KEEP;
+	}
+}
+
+void GLUtils::setDepthStencil(const MaterialDepthStencil& depthStencil)
+{
+	// GL skips depth writes when the test is disabled, so writing without testing is done with an "always" test
+	const bool depthTest = depthStencil.isDepthTestEnabled() || depthStencil.isDepthWriteEnabled();
+	const GLenum depthFunc = depthStencil.isDepthTestEnabled() ? getGLComparisonFunction(depthStencil.getDepthComparisonFunction()) : GL_ALWAYS;
+	const bool depthWrite = depthStencil.isDepthWriteEnabled();
+
+	if (!checked || state.depthTest != depthTest) {
+		if (depthTest) {
+			glEnable(GL_DEPTH_TEST);
+		} else {
+			glDisable(GL_DEPTH_TEST);
+		}
+		state.depthTest = depthTest;
+	}
+	if (depthTest && (!checked || state.depthFunc != depthFunc)) {
+		glDepthFunc(depthFunc);
+		state.depthFunc = depthFunc;
+	}
+	if (!checked || state.depthWrite != depthWrite) {
+		glDepthMask(depthWrite ? GL_TRUE : GL_FALSE);
+		state.depthWrite = depthWrite;
+	}
+
+	const bool stencilTest = depthStencil.isStencilTestEnabled();
+	if (!checked || state.stencilTest != stencilTest) {
+		if (stencilTest) {
+			glEnable(GL_STENCIL_TEST);
+		} else {
+			glDisable(GL_STENCIL_TEST);
+		}
+		state.stencilTest = stencilTest;
+	}
+	if (stencilTest) {
+		glStencilFunc(getGLComparisonFunction(depthStencil.getStencilComparisonFunction()), depthStencil.getStencilReference(), GLuint(depthStencil.getStencilReadMask()));
+		glStencilOp(getGLStencilOp(depthStencil.getStencilOpStencilFail()), getGLStencilOp(depthStencil.getStencilOpDepthFail()), getGLStencilOp(depthStencil.getStencilOpPass()));
+		if (state.stencilWriteMask != depthStencil.getStencilWriteMask()) {
+			glStencilMask(GLuint(depthStencil.getStencilWriteMask()));
+			state.stencilWriteMask = depthStencil.getStencilWriteMask();
+		}
+	}
+	glCheckError();
+}
+
 void GLUtils::setTextureUnit(int n)
 {
 	Expects(n >= 0);
@@ -308,6 +410,26 @@ void GLUtils::clear(Colour col)
 		state.clearCol = col;
 		state.hasClearCol = true;
 	}
-	glClear(GL_COLOR_BUFFER_BIT);
+
+	// Masks also apply to clears
+	if (!state.depthWrite) {
+		glDepthMask(GL_TRUE);
+		state.depthWrite = true;
+	}
+	if (state.stencilWriteMask != 0xFF) {
+		glStencilMask(0xFF);
+		state.stencilWriteMask = 0xFF;
+	}
+
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+}
+
+void GLUtils::clearDepth()
+{
+	if (!state.depthWrite) {
+		glDepthMask(GL_TRUE);
+		state.depthWrite = true;
+	}
+	glClear(GL_DEPTH_BUFFER_BIT);
 }
 
@@ -25,6 +25,7 @@
 #include "halley/maths/rect.h"
 #include "halley/maths/colour.h"
 #include <halley/core/graphics/blend.h>
+#include <halley/core/graphics/material/material_definition.h>
 
 namespace Halley {
 
@@ -39,6 +40,7 @@ namespace Halley {
 		GLUtils& operator=(const GLUtils&) = delete;
 
 		void setBlendType(BlendType type);
+		void setDepthStencil(const MaterialDepthStencil& depthStencil);
 
 		void bindTexture(int id);
 		void setTextureUnit(int n);
@@ -50,6 +52,7 @@ namespace Halley {
 		Rect4i getViewPort() const;
 
 		void clear(Colour col);
+		void clearDepth();
 		static void doGlCheckError(const char* file = "", long line = 0);
 		
 	private:
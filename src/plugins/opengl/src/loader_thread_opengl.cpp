@@ -1,6 +1,7 @@
 #include "loader_thread_opengl.h"
 #include "halley/core/api/system_api.h"
 #include "halley_gl.h"
+#include "gl_buffer.h"
 #include "halley/core/halley_core.h"
 #include "halley/concurrency/concurrent.h"
 
@@ -33,10 +34,19 @@ std::thread::id LoaderThreadOpenGL::getThreadId()
 #endif
 }
 
+GLPixelBufferPool* LoaderThreadOpenGL::getPixelBufferPool() const
+{
+	return pixelBuffers.get();
+}
+
 void LoaderThreadOpenGL::run()
 {
 #if HAS_THREADS
 	context->bind();
+#ifdef WITH_OPENGL
+	pixelBuffers = std::make_unique<GLPixelBufferPool>();
+#endif
 	executor.runForever();
+	pixelBuffers.reset();
 #endif
 }
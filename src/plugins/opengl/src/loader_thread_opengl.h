@@ -6,6 +6,7 @@ namespace Halley
 {
 	class SystemAPI;
 	class GLContext;
+	class GLPixelBufferPool;
 
 	class LoaderThreadOpenGL
 	{
@@ -14,11 +15,15 @@ namespace Halley
 		~LoaderThreadOpenGL();
 		std::thread::id getThreadId();
 
+		// Only available on the loader thread itself
+		GLPixelBufferPool* getPixelBufferPool() const;
+
 	private:
 		std::thread workerThread;
 		Executor executor;
 		
 		std::unique_ptr<GLContext> context;
+		std::unique_ptr<GLPixelBufferPool> pixelBuffers;
 		
 		void run();
 	};
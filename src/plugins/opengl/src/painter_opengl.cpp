@@ -2,7 +2,6 @@
 #include "halley/core/graphics/material/material_definition.h"
 #include <gsl/gsl_assert>
 #include "shader_opengl.h"
-#include "constant_buffer_opengl.h"
 #include "halley/core/graphics/material/material_parameter.h"
 #include "texture_opengl.h"
 
@@ -20,6 +19,11 @@ PainterOpenGL::~PainterOpenGL()
 		glDeleteVertexArrays(1, &vao);
 		vao = 0;
 	}
+	for (auto& queries: timestampQueries) {
+		if (!queries.empty()) {
+			glDeleteQueries(GLsizei(queries.size()), queries.data());
+		}
+	}
 #endif
 }
 
@@ -35,9 +39,14 @@ void PainterOpenGL::doStartRender()
 	glUtils->bindTexture(0);
 	glUtils->setScissor(Rect4i(), false);
 
-	vertexBuffer.init(GL_ARRAY_BUFFER);
-	elementBuffer.init(GL_ELEMENT_ARRAY_BUFFER);
+	vertexBuffer.init(GL_ARRAY_BUFFER, 1024 * 1024);
+	elementBuffer.init(GL_ELEMENT_ARRAY_BUFFER, 256 * 1024);
+	constantBuffer.init();
 	stdQuadElementBuffer.init(GL_ELEMENT_ARRAY_BUFFER, GL_STATIC_DRAW);
+	unitQuadBuffer.init(GL_ARRAY_BUFFER, GL_STATIC_DRAW);
+	vertexBuffer.beginFrame();
+	elementBuffer.beginFrame();
+	constantBuffer.beginFrame();
 
 #ifdef WITH_OPENGL
 	if (vao == 0) {
@@ -52,38 +61,50 @@ void PainterOpenGL::doStartRender()
 	glBindVertexArray(vao);
 #endif
 
-	clear(Colour(0, 0, 0, 1.0f));
+	doClear(Colour(0, 0, 0, 1.0f));
 }
 
 void PainterOpenGL::doEndRender()
 {
+	vertexBuffer.endFrame();
+	elementBuffer.endFrame();
+	constantBuffer.endFrame();
+
 #ifdef WITH_OPENGL
 	glBindVertexArray(0);
 #endif
 	glCheckError();
 }
 
-void PainterOpenGL::clear(Colour colour)
+void PainterOpenGL::doClear(Colour colour)
+{
+	glCheckError();
+	glUtils->clear(colour);
+	glCheckError();
+}
+
+void PainterOpenGL::doClearDepth()
 {
 	glCheckError();
-	glClearColor(colour.r, colour.g, colour.b, colour.a);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glUtils->clearDepth();
 	glCheckError();
 }
 
 void PainterOpenGL::setMaterialPass(const Material& material, int passNumber)
 {
 	auto& pass = material.getDefinition().getPass(passNumber);
+	const auto variant = material.getVariant();
 
-	// Set blend and shader
+	// Set blend, depth/stencil and shader
 	glUtils->setBlendType(pass.getBlend());
-	ShaderOpenGL& shader = static_cast<ShaderOpenGL&>(pass.getShader());
+	glUtils->setDepthStencil(pass.getDepthStencil());
+	ShaderOpenGL& shader = static_cast<ShaderOpenGL&>(pass.getShader(variant));
 	shader.bind();
 
 	// Bind constant buffer
 	// TODO: move this logic to Painter?
 	for (auto& dataBlock: material.getDataBlocks()) {
-		int address = dataBlock.getAddress(passNumber, ShaderType::Combined);
+		int address = dataBlock.getAddress(passNumber, ShaderType::Combined, variant);
 		if (address != -1) {
 			shader.setUniformBlockBinding(address, dataBlock.getBindPoint());
 		}
@@ -93,7 +114,7 @@ void PainterOpenGL::setMaterialPass(const Material& material, int passNumber)
 	// TODO: move this logic to Painter?
 	int textureUnit = 0;
 	for (auto& tex: material.getTextureUniforms()) {
-		int location = tex.getAddress(passNumber, ShaderType::Combined);
+		int location = tex.getAddress(passNumber, ShaderType::Combined, variant);
 		if (location != -1) {
 			auto texture = std::static_pointer_cast<const TextureOpenGL>(material.getTexture(textureUnit));
 			if (!texture) {
@@ -111,7 +132,7 @@ void PainterOpenGL::setMaterialData(const Material& material)
 {
 	for (auto& dataBlock: material.getDataBlocks()) {
 		if (dataBlock.getType() != MaterialDataBlockType::SharedExternal) {
-			static_cast<ConstantBufferOpenGL&>(dataBlock.getConstantBuffer()).bind(dataBlock.getBindPoint());
+			constantBuffer.bind(dataBlock);
 		}
 	}
 }
@@ -128,7 +149,6 @@ void PainterOpenGL::setViewPort(Rect4i rect)
 
 void PainterOpenGL::onUpdateProjection(Material& material)
 {
-	material.uploadData(*this);
 	setMaterialData(material);
 }
 
@@ -141,27 +161,93 @@ void PainterOpenGL::setVertices(const MaterialDefinition& material, size_t numVe
 
 	// Load indices into VBO
 	if (standardQuadsOnly) {
-		if (stdQuadElementBuffer.getSize() < numIndices * sizeof(unsigned short)) {
-			size_t indicesToAllocate = nextPowerOf2(numIndices);
-			std::vector<unsigned short> tmp(indicesToAllocate);
-			generateQuadIndices(0, indicesToAllocate / 6, tmp.data());
-			stdQuadElementBuffer.setData(gsl::as_bytes(gsl::span<unsigned short>(tmp)));
-		} else {
-			stdQuadElementBuffer.bind();
-		}
+		bindStandardQuadIndices(numIndices);
 	} else {
-		elementBuffer.setData(gsl::as_bytes(gsl::span<unsigned short>(indices, numIndices)));
+		elementOffset = elementBuffer.write(gsl::as_bytes(gsl::span<unsigned short>(indices, numIndices)), 4);
 	}
 
-	// Load vertices into VBO
+	// Append vertices to the ring buffer
 	size_t bytesSize = numVertices * material.getVertexStride();
-	vertexBuffer.setData(gsl::as_bytes(gsl::span<char>(static_cast<char*>(vertexData), bytesSize)));
+	size_t vertexOffset = vertexBuffer.write(gsl::as_bytes(gsl::span<char>(static_cast<char*>(vertexData), bytesSize)), 16);
 
 	// Set attributes
-	setupVertexAttributes(material);
+	setupVertexAttributes(material, vertexOffset, false);
 }
 
-void PainterOpenGL::setupVertexAttributes(const MaterialDefinition& material)
+bool PainterOpenGL::supportsInstancing() const
+{
+#ifdef WITH_OPENGL
+	return true;
+#else
+	return false;
+#endif
+}
+
+void PainterOpenGL::setInstancedVertices(const MaterialDefinition& material, size_t numInstances, void* instanceData)
+{
+	Expects(numInstances > 0);
+	Expects(instanceData);
+
+	bindStandardQuadIndices(6);
+
+	if (unitQuadBuffer.getSize() == 0) {
+		// Same vertPos values as Painter::drawSprites generates
+		const std::array<Vector4f, 4> quad = {{ Vector4f(0, 0, 0, 0), Vector4f(1, 0, 1, 0), Vector4f(1, 1, 1, 1), Vector4f(0, 1, 0, 1) }};
+		unitQuadBuffer.setData(gsl::as_bytes(gsl::span<const Vector4f>(quad)));
+	}
+
+	// Append instances to the ring buffer
+	size_t bytesSize = numInstances * material.getVertexStride();
+	size_t instanceOffset = vertexBuffer.write(gsl::as_bytes(gsl::span<char>(static_cast<char*>(instanceData), bytesSize)), 16);
+
+	// Set attributes
+	setupVertexAttributes(material, instanceOffset, true);
+}
+
+void PainterOpenGL::drawInstancedQuads(size_t numInstances)
+{
+	Expects(numInstances > 0);
+
+#ifdef WITH_OPENGL
+	glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, nullptr, GLsizei(numInstances));
+	glCheckError();
+#endif
+}
+
+std::unique_ptr<StaticGeometryBuffer> PainterOpenGL::createStaticGeometryBuffer(const StaticGeometry& geometry)
+{
+	auto result = std::make_unique<StaticGeometryBufferOpenGL>();
+	result->vertices.init(GL_ARRAY_BUFFER, GL_STATIC_DRAW);
+	result->vertices.setData(gsl::as_bytes(gsl::span<const char>(geometry.vertexData)));
+	result->indices.init(GL_ELEMENT_ARRAY_BUFFER, GL_STATIC_DRAW);
+	result->indices.setData(gsl::as_bytes(gsl::span<const unsigned short>(geometry.indexData)));
+	return result;
+}
+
+void PainterOpenGL::setStaticVertices(const MaterialDefinition& material, StaticGeometryBuffer& buffer, size_t vertexStart, size_t indexStart)
+{
+	auto& buffers = static_cast<StaticGeometryBufferOpenGL&>(buffer);
+
+	buffers.indices.bind();
+	elementOffset = indexStart * sizeof(unsigned short);
+
+	setupVertexAttributes(material, vertexStart, false, &buffers.vertices);
+}
+
+void PainterOpenGL::bindStandardQuadIndices(size_t numIndices)
+{
+	if (stdQuadElementBuffer.getSize() < numIndices * sizeof(unsigned short)) {
+		size_t indicesToAllocate = nextPowerOf2(numIndices);
+		std::vector<unsigned short> tmp(indicesToAllocate);
+		generateQuadIndices(0, indicesToAllocate / 6, tmp.data());
+		stdQuadElementBuffer.setData(gsl::as_bytes(gsl::span<unsigned short>(tmp)));
+	} else {
+		stdQuadElementBuffer.bind();
+	}
+	elementOffset = 0;
+}
+
+void PainterOpenGL::setupVertexAttributes(const MaterialDefinition& material, size_t vertexOffset, bool instanced, GLBuffer* source)
 {
 	// Set vertex attribute pointers in VBO
 	size_t vertexStride = material.getVertexStride();
@@ -205,8 +291,23 @@ void PainterOpenGL::setupVertexAttributes(const MaterialDefinition& material)
 			break;
 		}
 		glEnableVertexAttribArray(attribute.location);
-		size_t offset = attribute.offset;
-		glVertexAttribPointer(attribute.location, count, type, GL_FALSE, GLsizei(vertexStride), reinterpret_cast<GLvoid*>(offset));
+		if (instanced && !attribute.perInstance) {
+			// Comes from the unit quad instead
+			unitQuadBuffer.bind();
+			glVertexAttribPointer(attribute.location, count, type, GL_FALSE, GLsizei(sizeof(Vector4f)), nullptr);
+		} else {
+			if (source) {
+				source->bind();
+			} else {
+				vertexBuffer.bind();
+			}
+			size_t offset = vertexOffset + attribute.offset;
+			glVertexAttribPointer(attribute.location, count, type, GL_FALSE, GLsizei(vertexStride), reinterpret_cast<GLvoid*>(offset));
+		}
+#ifdef WITH_OPENGL
+		// The divisor is part of the VAO, so it needs resetting for non-instanced draws too
+		glVertexAttribDivisor(attribute.location, instanced && attribute.perInstance ? 1 : 0);
+#endif
 		glCheckError();
 	}
 
@@ -218,6 +319,58 @@ void PainterOpenGL::drawTriangles(size_t numIndices)
 	Expects(numIndices > 0);
 	Expects(numIndices % 3 == 0);
 
-	glDrawElements(GL_TRIANGLES, int(numIndices), GL_UNSIGNED_SHORT, nullptr);
+	glDrawElements(GL_TRIANGLES, int(numIndices), GL_UNSIGNED_SHORT, reinterpret_cast<GLvoid*>(elementOffset));
+	glCheckError();
+}
+
+bool PainterOpenGL::supportsTimestamps() const
+{
+#ifdef WITH_OPENGL
+	// Timer queries are core since 3.3
+	return true;
+#else
+	return false;
+#endif
+}
+
+void PainterOpenGL::writeTimestamp(int slot, size_t index)
+{
+#ifdef WITH_OPENGL
+	auto& queries = timestampQueries[slot];
+	if (index >= queries.size()) {
+		const size_t prevSize = queries.size();
+		queries.resize(std::max(index + 1, prevSize * 2));
+		glGenQueries(GLsizei(queries.size() - prevSize), queries.data() + prevSize);
+	}
+	glQueryCounter(queries[index], GL_TIMESTAMP);
+	glCheckError();
+#endif
+}
+
+bool PainterOpenGL::readTimestamps(int slot, size_t count, Vector<int64_t>& nanoseconds)
+{
+#ifdef WITH_OPENGL
+	auto& queries = timestampQueries[slot];
+	if (count == 0 || count > queries.size()) {
+		return false;
+	}
+
+	// Queries complete in order, so if the last one is in, all of them are
+	GLint available = 0;
+	glGetQueryObjectiv(queries[count - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available) {
+		return false;
+	}
+
+	nanoseconds.resize(count);
+	for (size_t i = 0; i < count; ++i) {
+		GLuint64 result = 0;
+		glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &result);
+		nanoseconds[i] = int64_t(result);
+	}
 	glCheckError();
+	return true;
+#else
+	return false;
+#endif
 }
@@ -3,12 +3,20 @@
 #include "halley/core/graphics/painter.h"
 #include "halley_gl.h"
 #include "gl_buffer.h"
+#include "constant_buffer_opengl.h"
 
 namespace Halley
 {
 	class Resources;
 	class MaterialPass;
 
+	class StaticGeometryBufferOpenGL final : public StaticGeometryBuffer
+	{
+	public:
+		GLBuffer vertices;
+		GLBuffer indices;
+	};
+
 	class PainterOpenGL final : public Painter
 	{
 	public:
@@ -17,8 +25,9 @@ namespace Halley
 
 		void doStartRender() override;
 		void doEndRender() override;
+		void doClear(Colour colour) override;
+		void doClearDepth() override;
 
-		void clear(Colour colour) override;
 		void setMaterialPass(const Material& material, int pass) override;
 		void setMaterialData(const Material& material) override;
 
@@ -27,18 +36,32 @@ namespace Halley
 	protected:
 		void setVertices(const MaterialDefinition& material, size_t numVertices, void* vertexData, size_t numIndices, unsigned short* indices, bool standardQuadsOnly) override;
 		void drawTriangles(size_t numIndices) override;
+		bool supportsInstancing() const override;
+		void setInstancedVertices(const MaterialDefinition& material, size_t numInstances, void* instanceData) override;
+		void drawInstancedQuads(size_t numInstances) override;
+		std::unique_ptr<StaticGeometryBuffer> createStaticGeometryBuffer(const StaticGeometry& geometry) override;
+		void setStaticVertices(const MaterialDefinition& material, StaticGeometryBuffer& buffer, size_t vertexStart, size_t indexStart) override;
 		void setViewPort(Rect4i rect) override;
 		void onUpdateProjection(Material& material) override;
 
+		bool supportsTimestamps() const override;
+		void writeTimestamp(int slot, size_t index) override;
+		bool readTimestamps(int slot, size_t count, Vector<int64_t>& nanoseconds) override;
+
 	private:
 #ifdef WITH_OPENGL
 		GLuint vao = 0;
+		std::array<Vector<GLuint>, gpuTimerLatency> timestampQueries;
 #endif
-		GLBuffer vertexBuffer;
-		GLBuffer elementBuffer;
+		GLStreamBuffer vertexBuffer;
+		GLStreamBuffer elementBuffer;
+		ConstantBufferOpenGL constantBuffer;
 		GLBuffer stdQuadElementBuffer;
+		GLBuffer unitQuadBuffer;
+		size_t elementOffset = 0;
 		std::unique_ptr<GLUtils> glUtils;
 
-		void setupVertexAttributes(const MaterialDefinition& material);
+		void bindStandardQuadIndices(size_t numIndices);
+		void setupVertexAttributes(const MaterialDefinition& material, size_t vertexOffset, bool instanced, GLBuffer* source = nullptr);
 	};
 }
@@ -0,0 +1,151 @@
+#include "shader_cache_opengl.h"
+#include "halley_gl.h"
+#include "gl_utils.h"
+#include <halley/core/api/save_data.h>
+#include <halley/core/graphics/shader.h>
+#include <halley/core/graphics/material/material_definition.h>
+#include <halley/bytes/byte_serializer.h>
+#include <halley/utils/hash.h>
+#include <halley/support/logger.h>
+
+using namespace Halley;
+
+namespace {
+	constexpr uint32_t cacheVersion = 1;
+
+	String getGLString(GLenum name)
+	{
+		auto str = reinterpret_cast<const char*>(glGetString(name));
+		return str ? String(str) : String();
+	}
+
+	void feedString(Hash::Hasher& hasher, const String& str)
+	{
+		hasher.feed(str.size());
+		hasher.feedBytes(gsl::as_bytes(gsl::span<const char>(str.c_str(), str.size())));
+	}
+}
+
+ShaderCacheOpenGL::ShaderCacheOpenGL(std::shared_ptr<ISaveData> storage)
+	: storage(std::move(storage))
+{
+	driverId = getGLString(GL_VENDOR) + "|" + getGLString(GL_RENDERER) + "|" + getGLString(GL_VERSION);
+}
+
+bool ShaderCacheOpenGL::isSupported()
+{
+#ifdef WITH_OPENGL
+	if (ogl_ext_ARB_get_program_binary != ogl_LOAD_SUCCEEDED) {
+		return false;
+	}
+
+	// Some drivers expose the extension but won't actually give out any binaries
+	GLint numFormats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+	glCheckError();
+	return numFormats > 0;
+#else
+	return false;
+#endif
+}
+
+uint64_t ShaderCacheOpenGL::getKey(const ShaderDefinition& definition) const
+{
+	Hash::Hasher hasher;
+	hasher.feed(cacheVersion);
+	feedString(hasher, driverId);
+	feedString(hasher, definition.name);
+	for (auto& shader: definition.shaders) {
+		hasher.feed(shader.first);
+		hasher.feed(shader.second.size());
+		hasher.feedBytes(gsl::as_bytes(gsl::span<const Byte>(shader.second)));
+	}
+	for (auto& attribute: definition.vertexAttributes) {
+		feedString(hasher, attribute.name);
+		hasher.feed(attribute.location);
+	}
+	return hasher.digest();
+}
+
+bool ShaderCacheOpenGL::load(uint64_t key, unsigned int program)
+{
+#ifdef WITH_OPENGL
+	Bytes data;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (!storage->isReady()) {
+			return false;
+		}
+		data = storage->getData(getPath(key));
+	}
+	if (data.empty()) {
+		return false;
+	}
+
+	uint64_t storedKey = 0;
+	uint32_t format = 0;
+	Bytes binary;
+	try {
+		auto s = Deserializer(data);
+		s >> storedKey;
+		s >> format;
+		s >> binary;
+	} catch (...) {
+		return false;
+	}
+	if (storedKey != key || binary.empty()) {
+		return false;
+	}
+
+	glProgramBinary(program, GLenum(format), binary.data(), GLsizei(binary.size()));
+	// A stale or rejected binary is an expected outcome here, so don't let it trip glCheckError
+	while (glGetError() != GL_NO_ERROR) {}
+
+	GLint result = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &result);
+	glCheckError();
+	return result == GL_TRUE;
+#else
+	return false;
+#endif
+}
+
+void ShaderCacheOpenGL::store(uint64_t key, unsigned int program)
+{
+#ifdef WITH_OPENGL
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	glCheckError();
+	if (length <= 0) {
+		return;
+	}
+
+	Bytes binary(static_cast<size_t>(length));
+	GLenum format = 0;
+	GLsizei written = 0;
+	glGetProgramBinary(program, GLsizei(length), &written, &format, binary.data());
+	glCheckError();
+	binary.resize(size_t(written));
+
+	auto data = Serializer::toBytes([&] (Serializer& s)
+	{
+		s << key;
+		s << uint32_t(format);
+		s << binary;
+	});
+
+	std::unique_lock<std::mutex> lock(mutex);
+	if (storage->isReady()) {
+		try {
+			storage->setData(getPath(key), data);
+		} catch (std::exception& e) {
+			Logger::logWarning("Unable to write shader cache: " + String(e.what()));
+		}
+	}
+#endif
+}
+
+String ShaderCacheOpenGL::getPath(uint64_t key)
+{
+	return "gl_" + toString(key, 16) + ".bin";
+}
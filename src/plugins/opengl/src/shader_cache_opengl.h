@@ -0,0 +1,36 @@
+#pragma once
+
+#include <halley/text/halleystring.h>
+#include <memory>
+#include <mutex>
+
+namespace Halley
+{
+	class ISaveData;
+	class ShaderDefinition;
+
+	// Keeps linked program binaries (GL_ARB_get_program_binary) in the cache storage container, so shaders
+	// don't have to be compiled and linked again on every run. Binaries are only valid for the driver that
+	// produced them, so the driver identification is part of the key; a binary that fails to load is simply
+	// compiled again and replaced.
+	class ShaderCacheOpenGL
+	{
+	public:
+		explicit ShaderCacheOpenGL(std::shared_ptr<ISaveData> storage);
+
+		static bool isSupported();
+
+		uint64_t getKey(const ShaderDefinition& definition) const;
+
+		// Returns true if the program was linked from the cached binary
+		bool load(uint64_t key, unsigned int program);
+		void store(uint64_t key, unsigned int program);
+
+	private:
+		std::shared_ptr<ISaveData> storage;
+		String driverId;
+		std::mutex mutex;
+
+		static String getPath(uint64_t key);
+	};
+}
@@ -2,6 +2,7 @@
 #include "halley/support/exception.h"
 #include "halley/support/console.h"
 #include "shader_opengl.h"
+#include "shader_cache_opengl.h"
 #include "halley/core/graphics/material/material_definition.h"
 #include "gl_utils.h"
 #include "halley_gl.h"
@@ -14,15 +15,33 @@ static ShaderOpenGL* currentShader = nullptr;
 #pragma warning(disable: 4996)
 #endif
 
-ShaderOpenGL::ShaderOpenGL(const ShaderDefinition& definition)
+ShaderOpenGL::ShaderOpenGL(const ShaderDefinition& definition, ShaderCacheOpenGL* cache)
 {
 	id = glCreateProgram();
 	glCheckError();	
 
 	name = definition.name;
 	setAttributes(definition.vertexAttributes);
+
+	uint64_t cacheKey = 0;
+	if (cache) {
+		cacheKey = cache->getKey(definition);
+		if (cache->load(cacheKey, id)) {
+			ready = true;
+			return;
+		}
+#ifdef WITH_OPENGL
+		glProgramParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		glCheckError();
+#endif
+	}
+
 	loadShaders(definition.shaders);
 	compile();
+
+	if (cache) {
+		cache->store(cacheKey, id);
+	}
 }
 
 ShaderOpenGL::~ShaderOpenGL()
@@ -5,10 +5,12 @@
 
 namespace Halley
 {
+	class ShaderCacheOpenGL;
+
 	class ShaderOpenGL final : public Shader
 	{
 	public:
-		explicit ShaderOpenGL(const ShaderDefinition& definition);
+		ShaderOpenGL(const ShaderDefinition& definition, ShaderCacheOpenGL* cache);
 		~ShaderOpenGL();
 
 		void bind();
@@ -1,6 +1,7 @@
 #include "halley/concurrency/concurrent.h"
 #include "halley/support/exception.h"
 #include "halley_gl.h"
+#include "gl_buffer.h"
 #include "texture_opengl.h"
 #include "halley/core/graphics/texture_descriptor.h"
 #include <gsl/gsl_assert>
@@ -10,6 +11,23 @@
 
 using namespace Halley;
 
+// Extension formats, which might be missing from the headers of older GL versions
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+#ifndef GL_COMPRESSED_RGBA8_ETC2_EAC
+#define GL_COMPRESSED_RGBA8_ETC2_EAC 0x9278
+#endif
+#ifndef GL_COMPRESSED_RGBA_ASTC_4x4_KHR
+#define GL_COMPRESSED_RGBA_ASTC_4x4_KHR 0x93B0
+#endif
+
 TextureOpenGL::TextureOpenGL(VideoOpenGL& parent, Vector2i size)
 	: Texture(size)
 	, parent(parent)
@@ -31,9 +49,14 @@ TextureOpenGL& TextureOpenGL::operator=(TextureOpenGL&& other) noexcept
 {
 	other.waitForOpenGLLoad();
 
+	// Take ownership of the other texture's id, so it doesn't get deleted along with it
+	if (textureId != 0) {
+		glDeleteTextures(1, &textureId);
+	}
 	size = other.size;
 	textureId = other.textureId;
 	texSize = other.texSize;
+	other.textureId = 0;
 
 	doneLoading();
 
@@ -41,16 +64,75 @@ TextureOpenGL& TextureOpenGL::operator=(TextureOpenGL&& other) noexcept
 }
 
 void TextureOpenGL::load(TextureDescriptor&& d)
+{
+#ifdef WITH_OPENGL
+	// Large uploads are staged through a pixel buffer: a CPU worker fills it, and the upload itself then returns
+	// straight away, rather than holding up the loader thread while the driver copies the pixels
+	const auto pixelBuffers = parent.getPixelBufferPool();
+	if (pixelBuffers && !d.pixelData.empty() && size_t(d.pixelData.getSpan().size_bytes()) >= minStagedUploadSize) {
+		loadStaged(std::make_shared<TextureDescriptor>(std::move(d)), *pixelBuffers);
+		return;
+	}
+#endif
+
+	upload(d);
+	finishLoading();
+}
+
+void TextureOpenGL::loadStaged(std::shared_ptr<TextureDescriptor> d, GLPixelBufferPool& pixelBuffers)
+{
+	auto buffer = pixelBuffers.acquire(size_t(d->pixelData.getSpan().size_bytes()));
+	if (!buffer) {
+		upload(*d);
+		finishLoading();
+		return;
+	}
+
+	Concurrent::execute(Executors::getCPU(), [d, buffer] () -> std::shared_ptr<GLPixelBufferPool::Buffer>
+	{
+		const auto pixels = d->pixelData.getSpan();
+		memcpy(buffer->mapped, pixels.data(), size_t(pixels.size_bytes()));
+		return buffer;
+	}).then(Executors::getVideoAux(), [this, d] (std::shared_ptr<GLPixelBufferPool::Buffer> buffer)
+	{
+		// The loader thread might have been restarted in the meantime, in which case the buffer is lost
+		const auto pixelBuffers = parent.getPixelBufferPool();
+		if (pixelBuffers && pixelBuffers->bindForUpload(*buffer)) {
+			stagedData = d->pixelData.getSpan().data();
+		}
+		upload(*d);
+		stagedData = nullptr;
+		if (pixelBuffers) {
+			pixelBuffers->release(buffer);
+		}
+		finishLoading();
+	});
+}
+
+const void* TextureOpenGL::getUploadPointer(const void* data) const
+{
+	// With a pixel unpack buffer bound, GL takes the offset into it in place of the pointer
+	if (stagedData) {
+		return reinterpret_cast<const void*>(static_cast<const gsl::byte*>(data) - stagedData);
+	}
+	return data;
+}
+
+void TextureOpenGL::upload(TextureDescriptor& d)
 {
 	GLUtils glUtils;
 	glUtils.bindTexture(textureId);
 	
-	if (texSize != d.size) {
+	if (TextureDescriptor::isCompressed(d.format)) {
+		createCompressed(d);
+	} else if (texSize != d.size) {
 		create(d.size, d.format, d.useMipMap, d.useFiltering, d.clamp, d.pixelData);
+		if (d.mipLevels > 1) {
+			uploadMipLevels(d);
+		}
 	} else if (!d.pixelData.empty()) {
 		updateImage(d.pixelData, d.format, d.useMipMap);
 	}
-	finishLoading();
 }
 
 void TextureOpenGL::reload(Resource&& resource)
@@ -58,6 +140,29 @@ void TextureOpenGL::reload(Resource&& resource)
 	*this = std::move(dynamic_cast<TextureOpenGL&>(resource));
 }
 
+void TextureOpenGL::updateRegion(Rect4i area, TextureFormat format, Bytes&& pixels)
+{
+	Expects(!TextureDescriptor::isCompressed(format));
+	Expects(pixels.size() == TextureDescriptor::getDataSize(format, area.getSize()));
+
+	// Uploaded by whichever thread binds it next, since the caller might not have a context
+	std::unique_lock<std::mutex> lock(regionMutex);
+	pendingRegions.push_back(PendingRegion{ area, format, std::move(pixels) });
+	hasPendingRegions.store(true, std::memory_order_release);
+}
+
+void TextureOpenGL::uploadPendingRegions() const
+{
+	std::unique_lock<std::mutex> lock(regionMutex);
+	for (auto& region: pendingRegions) {
+		glPixelStorei(GL_UNPACK_ALIGNMENT, TextureDescriptor::getBitsPerPixel(region.format));
+		glTexSubImage2D(GL_TEXTURE_2D, 0, region.area.getLeft(), region.area.getTop(), region.area.getWidth(), region.area.getHeight(), getGLFormat(region.format), GL_UNSIGNED_BYTE, region.pixels.data());
+	}
+	glCheckError();
+	pendingRegions.clear();
+	hasPendingRegions.store(false, std::memory_order_relaxed);
+}
+
 unsigned TextureOpenGL::getNativeId() const
 {
 	return textureId;
@@ -104,6 +209,10 @@ void TextureOpenGL::bind(int textureUnit) const
 	GLUtils glUtils;
 	glUtils.setTextureUnit(textureUnit);
 	glUtils.bindTexture(textureId);
+
+	if (hasPendingRegions.load(std::memory_order_acquire)) {
+		uploadPendingRegions();
+	}
 }
 
 void TextureOpenGL::create(Vector2i size, TextureFormat format, bool useMipMap, bool useFiltering, bool clamp, TextureDescriptorImageData& pixelData)
@@ -114,23 +223,8 @@ void TextureOpenGL::create(Vector2i size, TextureFormat format, bool useMipMap,
 	Expects(size.y <= 4096);
 	glCheckError();
 
-#ifdef WITH_OPENGL
-	GLuint pixFormat = GL_UNSIGNED_BYTE;
-
-	if (useMipMap) {
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_LOD_BIAS, -1);
-	}
-
-	GLuint wrap = clamp ? GL_CLAMP_TO_EDGE : GL_REPEAT;
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
-#else
 	GLuint pixFormat = GL_UNSIGNED_BYTE;
-#endif
-	int filtering = useFiltering ? GL_LINEAR : GL_NEAREST;
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, useMipMap ? GL_LINEAR_MIPMAP_LINEAR : filtering);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filtering);
+	setParameters(useMipMap, useFiltering, clamp);
 
 #ifdef WITH_OPENGL
 	if (format == TextureFormat::DEPTH) {
@@ -156,13 +250,71 @@ void TextureOpenGL::create(Vector2i size, TextureFormat format, bool useMipMap,
 		blank.resize(size.x * size.y * TextureDescriptor::getBitsPerPixel(format));
 		glTexImage2D(GL_TEXTURE_2D, 0, glFormat, size.x, size.y, 0, format2, pixFormat, blank.data());
 	} else {
-		glTexImage2D(GL_TEXTURE_2D, 0, glFormat, size.x, size.y, 0, format2, pixFormat, pixelData.getBytes());
+		glTexImage2D(GL_TEXTURE_2D, 0, glFormat, size.x, size.y, 0, format2, pixFormat, getUploadPointer(pixelData.getBytes()));
 	}
 	glCheckError();
 
 	texSize = size;
 }
 
+void TextureOpenGL::createCompressed(const TextureDescriptor& d)
+{
+	Expects(d.size.x > 0);
+	Expects(d.size.y > 0);
+	Expects(d.mipLevels >= 1);
+	if (d.pixelData.empty()) {
+		throw Exception("Compressed textures must be created with their data.", HalleyExceptions::VideoPlugin);
+	}
+	glCheckError();
+
+	setParameters(d.mipLevels > 1, d.useFiltering, d.clamp);
+#ifndef WITH_OPENGL_ES2
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, d.mipLevels - 1);
+#endif
+
+	const GLenum glFormat = getGLCompressedFormat(d.format);
+	for (int i = 0; i < d.mipLevels; ++i) {
+		const auto levelSize = TextureDescriptor::getMipLevelSize(d.size, i);
+		const auto data = d.pixelData.getMipLevel(d.format, d.size, i);
+		glCompressedTexImage2D(GL_TEXTURE_2D, i, glFormat, levelSize.x, levelSize.y, 0, GLsizei(data.size()), getUploadPointer(data.data()));
+	}
+	glCheckError();
+
+	texSize = d.size;
+}
+
+void TextureOpenGL::uploadMipLevels(const TextureDescriptor& d)
+{
+	// Level 0 was uploaded by create
+	const GLuint glFormat = getGLFormat(d.format);
+	for (int i = 1; i < d.mipLevels; ++i) {
+		const auto levelSize = TextureDescriptor::getMipLevelSize(d.size, i);
+		const auto data = d.pixelData.getMipLevel(d.format, d.size, i);
+		glTexImage2D(GL_TEXTURE_2D, i, glFormat, levelSize.x, levelSize.y, 0, glFormat, GL_UNSIGNED_BYTE, getUploadPointer(data.data()));
+	}
+#ifndef WITH_OPENGL_ES2
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, d.mipLevels - 1);
+#endif
+	glCheckError();
+}
+
+void TextureOpenGL::setParameters(bool useMipMap, bool useFiltering, bool clamp)
+{
+#ifdef WITH_OPENGL
+	if (useMipMap) {
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_LOD_BIAS, -1);
+	}
+
+	GLuint wrap = clamp ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+#endif
+	int filtering = useFiltering ? GL_LINEAR : GL_NEAREST;
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, useMipMap ? GL_LINEAR_MIPMAP_LINEAR : filtering);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filtering);
+}
+
 void TextureOpenGL::updateImage(TextureDescriptorImageData& pixelData, TextureFormat format, bool useMipMap)
 {
 	int stride = pixelData.getStrideOr(size.x);
@@ -171,7 +323,7 @@ void TextureOpenGL::updateImage(TextureDescriptorImageData& pixelData, TextureFo
 	glPixelStorei(GL_UNPACK_ALIGNMENT, TextureDescriptor::getBitsPerPixel(format));
 	glPixelStorei(GL_PACK_ROW_LENGTH, stride);
 #endif
-	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size.x, size.y, getGLFormat(format), GL_UNSIGNED_BYTE, pixelData.getBytes());
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size.x, size.y, getGLFormat(format), GL_UNSIGNED_BYTE, getUploadPointer(pixelData.getBytes()));
 	glCheckError();
 
 #ifndef WITH_OPENGL_ES
@@ -202,3 +354,22 @@ unsigned TextureOpenGL::getGLFormat(TextureFormat format)
 		throw Exception("Unknown texture format: " + toString(static_cast<int>(format)), HalleyExceptions::VideoPlugin);
 	}
 }
+
+unsigned TextureOpenGL::getGLCompressedFormat(TextureFormat format)
+{
+	// Whether the driver takes these depends on the hardware: BC on desktop, ETC2/ASTC mostly on mobile
+	switch (format) {
+	case TextureFormat::BC1:
+		return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+	case TextureFormat::BC3:
+		return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case TextureFormat::BC7:
+		return GL_COMPRESSED_RGBA_BPTC_UNORM;
+	case TextureFormat::ETC2:
+		return GL_COMPRESSED_RGBA8_ETC2_EAC;
+	case TextureFormat::ASTC4x4:
+		return GL_COMPRESSED_RGBA_ASTC_4x4_KHR;
+	default:
+		throw Exception("Not a compressed texture format: " + toString(format), HalleyExceptions::VideoPlugin);
+	}
+}
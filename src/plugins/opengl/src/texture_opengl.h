@@ -3,10 +3,12 @@
 #include <halley/core/graphics/texture.h>
 #include <halley/core/graphics/texture_descriptor.h>
 #include "halley_gl.h"
+#include <mutex>
 
 namespace Halley
 {
 	class VideoOpenGL;
+	class GLPixelBufferPool;
 	enum class TextureFormat;
 
 	class TextureOpenGL final : public Texture
@@ -22,19 +24,45 @@ namespace Halley
 
 		void load(TextureDescriptor&& descriptor) override;
 		void reload(Resource&& resource) override;
+		void updateRegion(Rect4i area, TextureFormat format, Bytes&& pixels) override;
 
 	private:
+		struct PendingRegion
+		{
+			Rect4i area;
+			TextureFormat format;
+			Bytes pixels;
+		};
+
+		constexpr static size_t minStagedUploadSize = 64 * 1024;
+
+		void upload(TextureDescriptor& descriptor);
+		void loadStaged(std::shared_ptr<TextureDescriptor> descriptor, GLPixelBufferPool& pixelBuffers);
+		const void* getUploadPointer(const void* data) const;
+
 		void updateImage(TextureDescriptorImageData& pixelData, TextureFormat format, bool useMipMap);
 		void create(Vector2i size, TextureFormat format, bool useMipMap, bool useFiltering, bool clamp, TextureDescriptorImageData& imgData);
+		void createCompressed(const TextureDescriptor& descriptor);
+		void uploadMipLevels(const TextureDescriptor& descriptor);
+		void setParameters(bool useMipMap, bool useFiltering, bool clamp);
 
 		static unsigned int getGLFormat(TextureFormat format);
+		static unsigned int getGLCompressedFormat(TextureFormat format);
 
 		void waitForOpenGLLoad() const;
 		void finishLoading();
+		void uploadPendingRegions() const;
 
 		unsigned int textureId = 0;
 		Vector2i texSize;
 		VideoOpenGL& parent;
+
+		mutable std::mutex regionMutex;
+		mutable Vector<PendingRegion> pendingRegions;
+		mutable std::atomic<bool> hasPendingRegions{ false };
+
+		const gsl::byte* stagedData = nullptr; // Start of the data in the pixel buffer being uploaded from, if any
+
 #ifdef WITH_OPENGL
 		mutable GLsync fence = nullptr;
 #endif
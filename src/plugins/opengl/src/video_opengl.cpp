@@ -9,8 +9,8 @@
 #include <halley/support/debug.h>
 #include <halley/core/graphics/window.h>
 #include "halley/text/string_converter.h"
-#include "constant_buffer_opengl.h"
 #include "halley/core/graphics/material/uniform_type.h"
+#include "halley/core/api/save_data.h"
 using namespace Halley;
 
 #ifdef _MSC_VER
@@ -37,6 +37,7 @@ void VideoOpenGL::init()
 void VideoOpenGL::deInit()
 {
 	loaderThread.reset();
+	shaderCache.reset();
 
 	context.reset();
 	system.destroyWindow(window);
@@ -129,6 +130,10 @@ void VideoOpenGL::initOpenGL()
 
 	setupDebugCallback();
 
+	if (ShaderCacheOpenGL::isSupported()) {
+		shaderCache = std::make_unique<ShaderCacheOpenGL>(system.getStorageContainer(SaveDataType::Cache, "shaders"));
+	}
+
 	std::cout << ConsoleColour(Console::GREEN) << "OpenGL init done.\n" << ConsoleColour() << std::endl;
 }
 
@@ -354,11 +359,6 @@ static std::function<void(int, void*)> getUniformBinding(UniformType type, int n
 	}
 }
 
-std::unique_ptr<MaterialConstantBuffer> VideoOpenGL::createConstantBuffer()
-{
-	return std::make_unique<ConstantBufferOpenGL>();
-}
-
 String VideoOpenGL::getShaderLanguage()
 {
 	return "glsl";
@@ -376,7 +376,7 @@ std::unique_ptr<Texture> VideoOpenGL::createTexture(Vector2i size)
 
 std::unique_ptr<Shader> VideoOpenGL::createShader(const ShaderDefinition& definition)
 {
-	return std::make_unique<ShaderOpenGL>(definition);
+	return std::make_unique<ShaderOpenGL>(definition, shaderCache.get());
 }
 
 std::unique_ptr<ScreenRenderTarget> VideoOpenGL::createScreenRenderTarget()
@@ -394,6 +394,11 @@ bool VideoOpenGL::isLoaderThread() const
 	return loaderThread && std::this_thread::get_id() == loaderThread->getThreadId();
 }
 
+GLPixelBufferPool* VideoOpenGL::getPixelBufferPool() const
+{
+	return isLoaderThread() ? loaderThread->getPixelBufferPool() : nullptr;
+}
+
 void VideoOpenGL::startRender()
 {
 	HALLEY_DEBUG_TRACE();
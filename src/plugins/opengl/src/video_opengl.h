@@ -6,6 +6,7 @@
 #include "halley/core/api/halley_api_internal.h"
 #include "halley/core/graphics/window.h"
 #include "loader_thread_opengl.h"
+#include "shader_cache_opengl.h"
 
 namespace Halley {
 	class SystemAPI;
@@ -28,11 +29,11 @@ namespace Halley {
 		std::unique_ptr<Shader> createShader(const ShaderDefinition& definition) override;
 		std::unique_ptr<TextureRenderTarget> createTextureRenderTarget() override;
 		std::unique_ptr<ScreenRenderTarget> createScreenRenderTarget() override;
-		std::unique_ptr<MaterialConstantBuffer> createConstantBuffer() override;
 
 		String getShaderLanguage() override;
 
 		bool isLoaderThread() const;
+		GLPixelBufferPool* getPixelBufferPool() const; // Null unless called from the loader thread
 
 	protected:
 		void init() override;
@@ -62,6 +63,7 @@ namespace Halley {
 		bool initialized = false;
 
 		std::unique_ptr<LoaderThreadOpenGL> loaderThread;
+		std::unique_ptr<ShaderCacheOpenGL> shaderCache;
 				
 		std::shared_ptr<Window> window;
 		bool useVsync = false;
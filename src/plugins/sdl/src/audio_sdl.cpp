@@ -25,7 +25,7 @@ void AudioSDL::init()
 
 bool AudioSDL::needsAudioThread() const
 {
-	return false;
+	return outputFormat.lowLatency;
 }
 
 void AudioSDL::deInit()
@@ -65,9 +65,15 @@ AudioSpec AudioSDL::openAudioDevice(const AudioSpec& requestedFormat, const Audi
 	desired.format = f == AudioSampleFormat::Int16 ? AUDIO_S16SYS : (f == AudioSampleFormat::Int32 ? AUDIO_S32SYS : AUDIO_F32SYS);
 	desired.userdata = this;
 
+	// In low latency mode the callback copies straight out of the ring, so let SDL do any conversion
+	const bool lowLatency = requestedFormat.lowLatency;
+	if (lowLatency) {
+		desired.format = AUDIO_F32SYS;
+	}
+
 	SDL_AudioSpec obtained;
 
-	device = SDL_OpenAudioDevice(deviceName, 0, &desired, &obtained, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_FORMAT_CHANGE);
+	device = SDL_OpenAudioDevice(deviceName, 0, &desired, &obtained, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | (lowLatency ? 0 : SDL_AUDIO_ALLOW_FORMAT_CHANGE));
 	if (device == 0) {
 		throw Exception("Unable to open audio device \"" + (name != "" ? name : "default") + "\"", HalleyExceptions::AudioOutPlugin);
 	}
@@ -80,7 +86,18 @@ AudioSpec AudioSDL::openAudioDevice(const AudioSpec& requestedFormat, const Audi
 	result.bufferSize = obtained.samples;
 	result.numChannels = obtained.channels;
 	result.sampleRate = obtained.freq;
+	result.lowLatency = lowLatency;
 	outputFormat = result;
+
+	if (lowLatency) {
+		// Room for 100ms, well beyond what the engine will ever ask to keep queued
+		ring = std::make_unique<SPSCQueue<float>>(size_t(result.sampleRate / 10 * result.numChannels));
+		ringSamples = 0;
+		targetRingSamples = size_t(result.bufferSize * result.numChannels);
+	} else {
+		ring.reset();
+	}
+
 	return result;
 }
 
@@ -91,6 +108,8 @@ void AudioSDL::closeAudioDevice()
 		SDL_CloseAudioDevice(device);
 		device = 0;
 	}
+	ring.reset();
+	outputFormat.lowLatency = false;
 }
 
 void AudioSDL::startPlayback()
@@ -109,6 +128,13 @@ void AudioSDL::stopPlayback()
 	if (device && playing) {
 		SDL_PauseAudioDevice(device, 1);
 		playing = false;
+
+		// Whatever was left would play late on resume. The audio thread has already stopped at this point.
+		if (ring) {
+			ring->clear();
+			ringSamples = 0;
+			ringStarted = false;
+		}
 	}
 }
 
@@ -118,6 +144,15 @@ void AudioSDL::queueAudio(gsl::span<const float> data)
 
 	const size_t numSamples = data.size();
 
+	if (ring) {
+		if (tmpFloat.size() < numSamples) {
+			tmpFloat.resize(numSamples);
+		}
+		std::copy(data.begin(), data.end(), tmpFloat.begin());
+		ringSamples += ring->tryPushBatch(gsl::span<float>(tmpFloat.data(), numSamples));
+		return;
+	}
+
 	// Float
 	if (outputFormat.format == AudioSampleFormat::Float) {
 		doQueueAudio(gsl::as_bytes(data));
@@ -148,8 +183,26 @@ void AudioSDL::queueAudio(gsl::span<const float> data)
 	}
 }
 
+size_t AudioSDL::getUnderrunCount() const
+{
+	return underruns;
+}
+
+void AudioSDL::setTargetLatency(size_t frames)
+{
+	if (ring) {
+		// Always leave room for one more buffer, as the engine only checks before mixing it
+		const size_t maxSamples = ring->getCapacity() - size_t(outputFormat.bufferSize * outputFormat.numChannels);
+		targetRingSamples = std::min(frames * size_t(outputFormat.numChannels), maxSamples);
+	}
+}
+
 bool AudioSDL::needsMoreAudio()
 {
+	if (ring) {
+		return ringSamples < targetRingSamples;
+	}
+
 	/*
 	size_t sizePerSample = outputFormat.format == AudioSampleFormat::Int16 ? 2 : 4;
 	size_t queuedAudioSize = queuedSize / (outputFormat.numChannels * sizePerSample);
@@ -171,6 +224,11 @@ void AudioSDL::doQueueAudio(gsl::span<const gsl::byte> data)
 
 void AudioSDL::onCallback(unsigned char* stream, int len) 
 {
+	if (ring) {
+		onLowLatencyCallback(reinterpret_cast<float*>(stream), size_t(len) / sizeof(float));
+		return;
+	}
+
 	size_t remaining = size_t(len);
 	size_t pos = 0;
 
@@ -206,8 +264,24 @@ void AudioSDL::onCallback(unsigned char* stream, int len)
 
 	if (remaining > 0) {
 		// :(
+		++underruns;
 		Logger::logWarning("Insufficient audio data, padding with zeroes.");
 		memset(stream + pos, 0, remaining);
 	}
 }
 
+void AudioSDL::onLowLatencyCallback(float* stream, size_t numSamples)
+{
+	const size_t n = ring->tryPopBatch(gsl::span<float>(stream, numSamples));
+	ringSamples -= n;
+
+	if (n < numSamples) {
+		// Silence before the first buffer arrives is just the audio thread starting up.
+		// Not logged, as it happens while the engine is still working out how far ahead it needs to stay.
+		if (ringStarted) {
+			++underruns;
+		}
+		std::fill(stream + n, stream + numSamples, 0.0f);
+	}
+	ringStarted = ringStarted || n > 0;
+}
@@ -1,8 +1,10 @@
 #pragma once
 #include "halley/core/api/halley_api_internal.h"
 #include "input_sdl.h"
+#include "halley/concurrency/spsc_queue.h"
 #include <cstdint>
 #include <vector>
+#include <atomic>
 
 namespace Halley
 {
@@ -34,6 +36,8 @@ namespace Halley
 		void onCallback(unsigned char* stream, int len);
 
 		bool needsAudioThread() const override;
+		size_t getUnderrunCount() const override;
+		void setTargetLatency(size_t frames) override;
 
 	private:
 		bool playing = false;
@@ -47,9 +51,18 @@ namespace Halley
 		std::list<std::vector<unsigned char>> audioQueue;
 		size_t readPos = 0;
 		size_t queuedSize = 0;
+		std::atomic<size_t> underruns { 0 };
+
+		// Low latency mode: the audio thread keeps this topped up, and the device callback only ever reads from it
+		std::unique_ptr<SPSCQueue<float>> ring;
+		std::vector<float> tmpFloat;
+		std::atomic<size_t> ringSamples { 0 };
+		std::atomic<size_t> targetRingSamples { 0 };
+		bool ringStarted = false;
 
 		AudioCallback prepareAudioCallback;
 
 		void doQueueAudio(gsl::span<const gsl::byte> data);
+		void onLowLatencyCallback(float* stream, size_t numSamples);
 	};
 }
@@ -24,6 +24,7 @@
 #include "input_mouse_sdl.h"
 #include "input_keyboard_sdl.h"
 #include "halley/core/input/input_touch.h"
+#include "halley/core/input/input_event_queue.h"
 #include <SDL.h>
 #include "halley/support/console.h"
 #include "halley/text/string_converter.h"
@@ -36,6 +37,7 @@ using namespace Halley;
 
 InputSDL::InputSDL(SystemAPI& system)
 	: system(system)
+	, samplingRate(0)
 {
 }
 
@@ -44,6 +46,7 @@ InputSDL::~InputSDL() = default;
 void InputSDL::init()
 {
 	mouseRemap = [] (Vector2i p) { return Vector2f(p); };
+	eventQueue = std::make_unique<InputEventQueue>();
 
 	keyboards.push_back(std::unique_ptr<InputKeyboardSDL>(new InputKeyboardSDL(system.getClipboard())));
 	mice.push_back(std::unique_ptr<InputMouseSDL>(new InputMouseSDL()));
@@ -70,6 +73,7 @@ void InputSDL::init()
 		if (!hasXInput || !isXinputController) {
 			joysticks.push_back(std::move(joy));
 			sdlJoys[i] = dynamic_cast<InputJoystickSDL*>(joysticks.back().get());
+			sdlJoyDevices[i] = int(joysticks.size()) - 1;
 
 			std::cout << "\tInitialized SDL joystick: \"" << ConsoleColour(Console::DARK_GREY) << name << ConsoleColour() << "\".\n";
 		}
@@ -77,10 +81,16 @@ void InputSDL::init()
 
 	SDL_JoystickEventState(SDL_QUERY);
 	SDL_JoystickEventState(SDL_ENABLE);
+
+	SDL_AddEventWatch(&InputSDL::onEventPushed, this);
 }
 
 void InputSDL::deInit()
 {
+	stopSampling();
+	SDL_DelEventWatch(&InputSDL::onEventPushed, this);
+	sdlJoyDevices.clear();
+
 	keyboards.clear();
 	mice.clear();
 	sdlJoys.clear();
@@ -264,3 +274,133 @@ Vector<spInputTouch> Halley::InputSDL::getTouchEvents()
 	}
 	return result;
 }
+
+InputEventQueue* InputSDL::getEventQueue()
+{
+	return eventQueue.get();
+}
+
+void InputSDL::setSamplingRate(int hz)
+{
+	const int prev = samplingRate.exchange(std::max(hz, 0));
+	if (prev == 0 && hz > 0) {
+		samplingThread = system.createThread("input", ThreadPriority::High, [this] () { runSampling(); });
+	} else if (prev > 0 && hz <= 0) {
+		samplingThread.join();
+	}
+}
+
+void InputSDL::stopSampling()
+{
+	setSamplingRate(0);
+}
+
+void InputSDL::runSampling()
+{
+	auto next = std::chrono::steady_clock::now();
+	int rate;
+	while ((rate = samplingRate.load()) > 0) {
+		// Pushes any joystick events straight into SDL's queue, which is thread-safe, and through onEventPushed into ours
+		SDL_LockJoysticks();
+		SDL_JoystickUpdate();
+		SDL_UnlockJoysticks();
+
+#ifdef XINPUT_AVAILABLE
+		for (size_t i = 0; i < joysticks.size(); ++i) {
+			auto xinput = dynamic_cast<InputJoystickXInput*>(joysticks[i].get());
+			if (xinput) {
+				xinput->pollEvents(*eventQueue, int(i));
+			}
+		}
+#endif
+
+		next += std::chrono::nanoseconds(1000000000 / rate);
+		const auto now = std::chrono::steady_clock::now();
+		if (next < now) {
+			next = now;
+		}
+		std::this_thread::sleep_until(next);
+	}
+}
+
+int SDLCALL InputSDL::onEventPushed(void* userData, SDL_Event* event)
+{
+	static_cast<InputSDL*>(userData)->recordEvent(*event);
+	return 1;
+}
+
+void InputSDL::recordEvent(const SDL_Event& event)
+{
+	InputEvent e;
+	e.timeNs = InputEventQueue::getTimeNs();
+
+	auto joyDevice = [&] (int which)
+	{
+		auto iter = sdlJoyDevices.find(which);
+		return iter != sdlJoyDevices.end() ? iter->second : -1;
+	};
+
+	switch (event.type) {
+		case SDL_KEYDOWN:
+		case SDL_KEYUP:
+			if (event.key.repeat != 0) {
+				return;
+			}
+			e.type = event.type == SDL_KEYDOWN ? InputEventType::KeyDown : InputEventType::KeyUp;
+			e.code = event.key.keysym.scancode;
+			break;
+
+		case SDL_MOUSEMOTION:
+			// Mouse events are only pushed by SDL_PumpEvents, on the main thread, which is the one that owns mouseRemap
+			e.type = InputEventType::MouseMotion;
+			e.value = mouseRemap(Vector2i(event.motion.x, event.motion.y));
+			break;
+		case SDL_MOUSEBUTTONDOWN:
+		case SDL_MOUSEBUTTONUP:
+			e.type = event.type == SDL_MOUSEBUTTONDOWN ? InputEventType::MouseButtonDown : InputEventType::MouseButtonUp;
+			e.code = event.button.button - 1;
+			e.value = mouseRemap(Vector2i(event.button.x, event.button.y));
+			break;
+		case SDL_MOUSEWHEEL:
+			e.type = InputEventType::MouseWheel;
+			e.value = Vector2f(float(event.wheel.x), float(event.wheel.y));
+			break;
+
+		case SDL_JOYAXISMOTION:
+			e.type = InputEventType::JoystickAxis;
+			e.device = joyDevice(event.jaxis.which);
+			e.code = event.jaxis.axis;
+			e.value = Vector2f(event.jaxis.value / 32768.0f, 0);
+			break;
+		case SDL_JOYBUTTONDOWN:
+		case SDL_JOYBUTTONUP:
+			e.type = event.type == SDL_JOYBUTTONDOWN ? InputEventType::JoystickButtonDown : InputEventType::JoystickButtonUp;
+			e.device = joyDevice(event.jbutton.which);
+			e.code = event.jbutton.button;
+			break;
+		case SDL_JOYHATMOTION:
+		{
+			const int v = event.jhat.value;
+			e.type = InputEventType::JoystickHat;
+			e.device = joyDevice(event.jhat.which);
+			e.code = event.jhat.hat;
+			e.value = Vector2f(float(((v & SDL_HAT_RIGHT) != 0) - ((v & SDL_HAT_LEFT) != 0)), float(((v & SDL_HAT_DOWN) != 0) - ((v & SDL_HAT_UP) != 0)));
+			break;
+		}
+
+		case SDL_FINGERDOWN:
+		case SDL_FINGERUP:
+		case SDL_FINGERMOTION:
+			e.type = event.type == SDL_FINGERDOWN ? InputEventType::TouchDown : (event.type == SDL_FINGERUP ? InputEventType::TouchUp : InputEventType::TouchMotion);
+			e.device = int(event.tfinger.fingerId);
+			e.value = Vector2f(event.tfinger.x, event.tfinger.y);
+			break;
+
+		default:
+			return;
+	}
+
+	if (e.device >= 0) {
+		eventQueue->push(e);
+	}
+}
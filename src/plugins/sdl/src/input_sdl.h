@@ -23,6 +23,8 @@
 
 #include "halley/core/api/halley_api_internal.h"
 #include <map>
+#include <atomic>
+#include <thread>
 #include <SDL.h>
 #include "input_joystick_sdl.h"
 
@@ -30,6 +32,7 @@ namespace Halley {
 
 	class InputKeyboardSDL;
 	class InputMouseSDL;
+	class InputEventQueue;
 
 	class InputSDL final : public InputAPIInternal {
 		friend class HalleyAPI;
@@ -54,6 +57,9 @@ namespace Halley {
 
 		void setMouseRemapping(std::function<Vector2f(Vector2i)> remapFunction) override;
 
+		InputEventQueue* getEventQueue() override;
+		void setSamplingRate(int hz) override;
+
 	private:
 		void init() override;
 		void deInit() override;
@@ -62,6 +68,12 @@ namespace Halley {
 		void processJoyEvent(int n, SDL_Event& event);
 		void processTouch(int type, long long touchId, long long fingerId, float x, float y);
 
+		// Called by SDL as each event is pushed, on whichever thread pushed it, so the timestamps are as early as they can be
+		static int SDLCALL onEventPushed(void* userData, SDL_Event* event);
+		void recordEvent(const SDL_Event& event);
+		void runSampling();
+		void stopSampling();
+
 		SystemAPI& system;
 		
 		Vector<std::shared_ptr<InputKeyboardSDL>> keyboards;
@@ -72,6 +84,11 @@ namespace Halley {
 		std::map<int, std::shared_ptr<InputTouch>> touchEvents;
 
 		std::function<Vector2f(Vector2i)> mouseRemap;
+
+		std::unique_ptr<InputEventQueue> eventQueue;
+		std::map<int, int> sdlJoyDevices; // Same keys as sdlJoys, to their index in joysticks
+		std::thread samplingThread;
+		std::atomic<int> samplingRate;
 	};
 
 };
@@ -174,6 +174,7 @@ void SDLSaveData::setData(const String& path, const Bytes& rawData, bool commit)
 	auto dstPath = dir / path;
 	auto dstPathStr = dstPath.getString();
 	Maybe<Path> backupPath;
+	std::unique_lock<std::mutex> lock(corruptedFilesMutex);
 	if (corruptedFiles.find(dstPathStr) != corruptedFiles.end()) {
 		// File we're writing to was corrupted; don't back up, but do remove it from the list
 		corruptedFiles.erase(dstPathStr);
@@ -184,6 +185,7 @@ void SDLSaveData::setData(const String& path, const Bytes& rawData, bool commit)
 			backupPath = dstPath.replaceExtension(dstPath.getExtension() + ".bak");
 		}
 	}
+	lock.unlock();
 
 	// Write
 	OS::get().createDirectories(dir);
@@ -237,6 +239,7 @@ Maybe<Bytes> SDLSaveData::doGetData(const Path& path, const String& filename)
 	if (header.v0.version >= 1 && header.v1.dataHash != Hash::hash(finalData)) {
 		Logger::logError("Corrupted save file: " + filename);
 		if (!path.getExtension().endsWith(".bak")) {
+			std::unique_lock<std::mutex> lock(corruptedFilesMutex);
 			corruptedFiles.insert(path.getString());
 		}
 ;		return {};
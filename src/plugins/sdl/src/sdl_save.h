@@ -2,6 +2,7 @@
 
 #include "halley/core/api/halley_api_internal.h"
 #include <set>
+#include <mutex>
 
 namespace Halley {
 	struct SDLSaveHeaderV0
@@ -49,6 +50,7 @@ namespace Halley {
 		Path dir;
 		Maybe<String> key;
 		std::set<String> corruptedFiles;
+		std::mutex corruptedFilesMutex; // Async saves use this from the disk IO thread
 
 		String getKey() const;
 		Maybe<Bytes> doGetData(const Path& path, const String& filename);
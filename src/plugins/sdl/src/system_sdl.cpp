@@ -7,6 +7,7 @@
 #include "sdl_rw_ops.h"
 #include "halley/core/graphics/window.h"
 #include "halley/os/os.h"
+#include "halley/core/game/environment.h"
 #include "sdl_window.h"
 #include "sdl_gl_context.h"
 #include "input_sdl.h"
@@ -245,6 +246,17 @@ Rect4i SystemSDL::getDisplayRect(int screen) const
 	return Rect4i(rect.x, rect.y, rect.w, rect.h);
 }
 
+int SystemSDL::getRefreshRate(int screen) const
+{
+	initVideo();
+	SDL_DisplayMode info;
+	if (SDL_GetDesktopDisplayMode(screen, &info) == 0) {
+		return info.refresh_rate;
+	} else {
+		return 0;
+	}
+}
+
 Vector2i SystemSDL::getCenteredWindow(Vector2i size, int screen) const
 {
 	Rect4i rect = getDisplayRect(screen);
@@ -273,6 +285,8 @@ std::shared_ptr<ISaveData> SystemSDL::getStorageContainer(SaveDataType type, con
 
 void SystemSDL::setEnvironment(Environment* env)
 {
+	environment = env;
+
 	for (int i = 0; i <= int(SaveDataType::Cache); ++i) {
 		SaveDataType type = SaveDataType(i);
 		auto dir = env->getDataPath() / toString(type) / ".";
@@ -334,6 +348,18 @@ void SystemSDL::setThreadName(const String& name)
 #endif
 }
 
+std::thread SystemSDL::createThread(const String& name, ThreadPriority priority, std::function<void()> runnable)
+{
+	const auto settings = environment ? environment->getThreadSettings(name, ThreadSettings(priority)) : ThreadSettings(priority);
+	return std::thread([=] () {
+		setThreadName(name);
+		Profiler::setThreadName(name);
+		OS::get().setThreadPriority(settings.priority);
+		OS::get().setThreadAffinity(settings.affinityMask);
+		runnable();
+	});
+}
+
 void SystemSDL::printDebugInfo() const
 {
 	std::cout << std::endl << ConsoleColour(Console::GREEN) << "Initializing Video Display...\n" << ConsoleColour();
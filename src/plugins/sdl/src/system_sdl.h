@@ -28,6 +28,7 @@ namespace Halley
 
 		Vector2i getScreenSize(int n) const override;
 		Rect4i getDisplayRect(int screen) const override;
+		int getRefreshRate(int screen) const override;
 		Vector2i getCenteredWindow(Vector2i size, int screen) const;
 		std::unique_ptr<GLContext> createGLContext() override;
 
@@ -42,6 +43,7 @@ namespace Halley
 		std::shared_ptr<IClipboard> getClipboard() const override;
 
 		void setThreadName(const String& name) override;
+		std::thread createThread(const String& name, ThreadPriority priority, std::function<void()> runnable) override;
 
 	private:
 		void processVideoEvent(VideoAPI* video, const SDL_Event& event);
@@ -57,5 +59,6 @@ namespace Halley
 		std::map<SaveDataType, Path> saveDir;
 		std::shared_ptr<IClipboard> clipboard;
 		Maybe<String> saveCryptKey;
+		Environment* environment = nullptr;
 	};
 }
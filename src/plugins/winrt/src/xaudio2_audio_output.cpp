@@ -24,6 +24,7 @@ XAudio2SourceVoice::XAudio2SourceVoice(XAudio2AudioOutput& audio, const AudioSpe
 	: running(false)
 	, audio(audio)
 	, callback(callback)
+	, spec(spec)
 {
 	WAVEFORMATEX format;
 	ZeroMemory(&format, sizeof(format));
@@ -61,12 +62,11 @@ void XAudio2SourceVoice::queueAudio(gsl::span<const float> samples)
 	XAUDIO2_BUFFER buffer;
 	ZeroMemory(&buffer, sizeof(buffer));
 
-	float* data = new float[samples.size()];
-	memcpy_s(data, samples.size_bytes(), samples.data(), samples.size_bytes());
+	auto data = new std::vector<float>(samples.begin(), samples.end());
 
 	buffer.Flags = 0;
 	buffer.AudioBytes = samples.size_bytes();
-	buffer.pAudioData = reinterpret_cast<const BYTE*>(data);
+	buffer.pAudioData = reinterpret_cast<const BYTE*>(data->data());
 	buffer.PlayBegin = 0;
 	buffer.PlayLength = 0;
 	buffer.LoopBegin = 0;
@@ -74,6 +74,7 @@ void XAudio2SourceVoice::queueAudio(gsl::span<const float> samples)
 	buffer.LoopCount = 0;
 	buffer.pContext = data;
 
+	queuedFrames += samples.size() / spec.numChannels;
 	voice->SubmitSourceBuffer(&buffer, nullptr);
 }
 
@@ -84,7 +85,21 @@ void XAudio2SourceVoice::play()
 	if (result != S_OK) {
 		throw Exception("Unable to start voice playback", HalleyExceptions::AudioOutPlugin);
 	}
-	callback();
+
+	// In low latency mode, the audio thread feeds it instead
+	if (!spec.lowLatency) {
+		callback();
+	}
+}
+
+size_t XAudio2SourceVoice::getQueuedFrames() const
+{
+	return queuedFrames;
+}
+
+size_t XAudio2SourceVoice::getUnderrunCount() const
+{
+	return underruns;
 }
 
 void XAudio2SourceVoice::OnVoiceProcessingPassStart(UINT32 BytesRequired) {}
@@ -98,14 +113,20 @@ void XAudio2SourceVoice::OnStreamEnd()
 
 void XAudio2SourceVoice::OnBufferStart(void* pBufferContext)
 {
-	if (running) {
+	if (running && !spec.lowLatency) {
 		callback();
 	}
 }
 
 void XAudio2SourceVoice::OnBufferEnd(void* pBufferContext)
 {
-	delete[] reinterpret_cast<float*>(pBufferContext);
+	auto data = reinterpret_cast<std::vector<float>*>(pBufferContext);
+	queuedFrames -= data->size() / spec.numChannels;
+	delete data;
+
+	if (running && queuedFrames == 0) {
+		++underruns;
+	}
 }
 
 void XAudio2SourceVoice::OnLoopEnd(void* pBufferContext) {}
@@ -179,12 +200,22 @@ void XAudio2AudioOutput::queueAudio(gsl::span<const float> data)
 
 bool XAudio2AudioOutput::needsMoreAudio()
 {
-	return false;
+	return voice && voice->getQueuedFrames() < targetLatency;
 }
 
 bool XAudio2AudioOutput::needsAudioThread() const
 {
-	return false;
+	return format.lowLatency;
+}
+
+size_t XAudio2AudioOutput::getUnderrunCount() const
+{
+	return voice ? voice->getUnderrunCount() : 0;
+}
+
+void XAudio2AudioOutput::setTargetLatency(size_t frames)
+{
+	targetLatency = frames;
 }
 
 IXAudio2& XAudio2AudioOutput::getXAudio2()
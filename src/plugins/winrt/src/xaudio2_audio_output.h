@@ -1,6 +1,7 @@
 #pragma once
 #include "halley/core/api/halley_api_internal.h"
 #include "xaudio2.h"
+#include <atomic>
 
 namespace Halley
 {
@@ -25,6 +26,9 @@ namespace Halley
 		void queueAudio(gsl::span<const float> samples);
 		void play();
 
+		size_t getQueuedFrames() const;
+		size_t getUnderrunCount() const;
+
 		void __stdcall OnVoiceProcessingPassStart(UINT32 BytesRequired) override;
 		void __stdcall OnVoiceProcessingPassEnd() override;
 
@@ -41,6 +45,10 @@ namespace Halley
 		bool running;
 		XAudio2AudioOutput& audio;
 		AudioCallback callback;
+		AudioSpec spec;
+
+		std::atomic<size_t> queuedFrames { 0 };
+		std::atomic<size_t> underruns { 0 };
 
 		IXAudio2SourceVoice* voice = nullptr;
 
@@ -76,6 +84,8 @@ namespace Halley
 		bool needsMoreAudio() override;
 
 		bool needsAudioThread() const override;
+		size_t getUnderrunCount() const override;
+		void setTargetLatency(size_t frames) override;
 
 		IXAudio2& getXAudio2();
 
@@ -85,5 +95,6 @@ namespace Halley
 		std::unique_ptr<XAudio2SourceVoice> voice;
 		AudioCallback callback;
 		AudioSpec format;
+		std::atomic<size_t> targetLatency { 0 };
 	};
 }
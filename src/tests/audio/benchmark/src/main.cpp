@@ -0,0 +1,338 @@
+#include <halley/audio/audio_clip.h>
+#include <halley/audio/audio_position.h>
+#include <halley/audio/resampler.h>
+#include <halley/concurrency/executor.h>
+#include <halley/file/path.h>
+#include <halley/resources/metadata.h>
+#include <halley/resources/resource_data.h>
+#include <halley/time/stopwatch.h>
+#include <halley/text/halleystring.h>
+#include <halley/text/string_converter.h>
+#include "audio_engine.h"
+#include "audio_mixer.h"
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <limits>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+using namespace Halley;
+
+// Stand-ins for what the platform plugins and resource locators provide
+
+// Takes everything the engine produces, straight away, so it mixes as fast as it can
+class NullAudioOutput final : public AudioOutputAPI
+{
+public:
+	size_t samplesQueued = 0;
+
+	Vector<std::unique_ptr<const AudioDevice>> getAudioDevices() override { return {}; }
+	AudioSpec openAudioDevice(const AudioSpec& requestedFormat, const AudioDevice*, AudioCallback) override { return requestedFormat; }
+	void closeAudioDevice() override {}
+	void startPlayback() override {}
+	void stopPlayback() override {}
+	void queueAudio(gsl::span<const float> data) override { samplesQueued += size_t(data.size()); }
+	bool needsMoreAudio() override { return true; }
+	bool needsAudioThread() const override { return false; }
+};
+
+class MemoryDataReader final : public ResourceDataReader
+{
+public:
+	explicit MemoryDataReader(std::shared_ptr<const Bytes> data)
+		: data(std::move(data))
+	{}
+
+	size_t size() const override { return data->size(); }
+
+	int read(gsl::span<gsl::byte> dst) override
+	{
+		const size_t n = std::min(size_t(dst.size()), data->size() - pos);
+		memcpy(dst.data(), data->data() + pos, n);
+		pos += n;
+		return int(n);
+	}
+
+	void seek(int64_t offset, int whence) override
+	{
+		if (whence == SEEK_SET) {
+			pos = size_t(offset);
+		} else if (whence == SEEK_CUR) {
+			pos = size_t(int64_t(pos) + offset);
+		} else if (whence == SEEK_END) {
+			pos = size_t(int64_t(data->size()) + offset);
+		}
+		pos = std::min(pos, data->size());
+	}
+
+	size_t tell() const override { return pos; }
+	void close() override {}
+
+private:
+	std::shared_ptr<const Bytes> data;
+	size_t pos = 0;
+};
+
+// Harness
+
+namespace {
+	bool firstResult = true;
+	volatile float sink = 0;
+
+	// Samples per second are per channel, counting every voice that was mixed
+	void report(const String& name, const String& variant, size_t voices, int64_t ns, size_t samples, double audioSeconds = 0.0)
+	{
+		const double seconds = double(ns) * 1e-9;
+		std::cout << (firstResult ? "" : ",\n") << "\t{ \"name\": \"" << name << "\", \"variant\": \"" << variant << "\", \"voices\": " << voices
+			<< ", \"total_ns\": " << ns << ", \"samples_per_second\": " << (ns > 0 ? double(samples) / seconds : 0.0);
+		if (audioSeconds > 0) {
+			std::cout << ", \"realtime_factor\": " << (ns > 0 ? audioSeconds / seconds : 0.0);
+		}
+		std::cout << " }";
+		firstResult = false;
+	}
+
+	// Returns the fastest of the runs, which is the least affected by noise
+	template <typename F>
+	int64_t measure(F f, int runs = 1)
+	{
+		int64_t best = std::numeric_limits<int64_t>::max();
+		for (int i = 0; i < runs; ++i) {
+			Stopwatch timer;
+			f();
+			timer.pause();
+			best = std::min(best, timer.elapsedNanoSeconds());
+		}
+		return best;
+	}
+
+	constexpr int repeatedRuns = 5;
+	constexpr double audioLength = 10.0; // seconds of audio mixed per run
+
+	struct Clips
+	{
+		std::shared_ptr<const Bytes> shortData;
+		std::shared_ptr<const Bytes> longData;
+		std::shared_ptr<AudioClip> staticClip;
+	};
+
+	template <typename F>
+	void waitFor(F f)
+	{
+		using namespace std::chrono_literals;
+		while (!f()) {
+			std::this_thread::sleep_for(1ms);
+		}
+	}
+
+	std::shared_ptr<AudioClip> loadStatic(const String& path, std::shared_ptr<const Bytes> data)
+	{
+		auto clip = std::make_shared<AudioClip>(0);
+		clip->loadFromStatic(std::make_shared<ResourceDataStatic>(data->data(), data->size(), path, false), Metadata());
+		clip->keepDecoded();
+		waitFor([&] () { return clip->isDecoded(); });
+		return clip;
+	}
+
+	std::shared_ptr<AudioClip> loadStream(const String& path, std::shared_ptr<const Bytes> data)
+	{
+		auto clip = std::make_shared<AudioClip>(0);
+		clip->loadFromStream(std::make_shared<ResourceDataStream>(path, [=] () -> std::unique_ptr<ResourceDataReader>
+		{
+			return std::make_unique<MemoryDataReader>(data);
+		}), Metadata());
+		return clip;
+	}
+
+	AudioPosition makePosition(size_t i, bool positional)
+	{
+		if (positional) {
+			const float angle = float(i) * 2.399963f; // Spread them around the listener
+			return AudioPosition::makePositional(Vector2f(std::cos(angle), std::sin(angle)) * float(50 + (i * 37) % 300));
+		} else {
+			return AudioPosition::makeUI(float(i % 21) / 10.0f - 1.0f);
+		}
+	}
+
+	void runEngine(AudioEngine& engine, NullAudioOutput& out, size_t bufferSize)
+	{
+		const size_t samplesToMix = size_t(audioLength * AudioConfig::sampleRate);
+		for (size_t mixed = 0; mixed < samplesToMix; mixed += bufferSize) {
+			engine.generateBuffer();
+		}
+		sink = float(out.samplesQueued);
+	}
+
+	void benchVoices(const Clips& clips, const String& mixerName, size_t voices, size_t bufferSize, bool streaming, bool positional)
+	{
+		NullAudioOutput out;
+		AudioEngine engine;
+		engine.setMixer(AudioMixer::makeMixer(mixerName));
+		engine.setMaxVoices(voices);
+		engine.start(AudioSpec(AudioConfig::sampleRate, 2, int(bufferSize), AudioSampleFormat::Float), out);
+
+		for (size_t i = 0; i < voices; ++i) {
+			auto clip = streaming ? std::shared_ptr<const IAudioClip>(loadStream("long.ogg", clips.longData)) : std::shared_ptr<const IAudioClip>(clips.staticClip);
+			engine.play(i + 1, clip, makePosition(i, positional), 1.0f / float(voices), true);
+		}
+
+		// Let every voice get started, and anything streaming get decoded ahead
+		engine.generateBuffer();
+		if (streaming) {
+			using namespace std::chrono_literals;
+			std::this_thread::sleep_for(200ms);
+		}
+
+		const String name = String(streaming ? "voices_streaming" : "voices_static") + (positional ? "_positional" : "") + "_" + toString(bufferSize);
+		report(name, mixerName, voices, measure([&] () { runEngine(engine, out, bufferSize); }, streaming ? 1 : repeatedRuns), size_t(audioLength * AudioConfig::sampleRate) * voices * 2, audioLength);
+	}
+
+	void benchMixer(const String& mixerName)
+	{
+		constexpr size_t numPacks = 1024 / AudioSamplePack::NumSamples;
+		constexpr int iterations = 20000;
+		constexpr size_t samples = numPacks * AudioSamplePack::NumSamples * iterations;
+
+		auto mixer = AudioMixer::makeMixer(mixerName);
+		std::vector<AudioSamplePack> src(numPacks);
+		std::vector<AudioSamplePack> dst(numPacks);
+		std::vector<AudioSamplePack> interleaved(numPacks * 2);
+		for (size_t i = 0; i < numPacks; ++i) {
+			for (size_t j = 0; j < AudioSamplePack::NumSamples; ++j) {
+				src[i].samples[j] = std::sin(float(i * AudioSamplePack::NumSamples + j) * 0.01f);
+				dst[i].samples[j] = 0.0f;
+			}
+		}
+		AudioBuffer left { src };
+		AudioBuffer right { src };
+		std::array<AudioBuffer*, 2> channels = {{ &left, &right }};
+
+		report("mix", mixerName, 1, measure([&] () {
+			for (int i = 0; i < iterations; ++i) {
+				mixer->mixAudio(src, dst, 0.5f, 0.5f);
+			}
+		}, repeatedRuns), samples);
+
+		report("mix_ramp", mixerName, 1, measure([&] () {
+			for (int i = 0; i < iterations; ++i) {
+				mixer->mixAudio(src, dst, 0.25f, 0.5f);
+			}
+		}, repeatedRuns), samples);
+
+		report("interleave", mixerName, 1, measure([&] () {
+			for (int i = 0; i < iterations; ++i) {
+				mixer->interleaveChannels(interleaved, channels);
+			}
+		}, repeatedRuns), samples * 2);
+
+		report("compress", mixerName, 1, measure([&] () {
+			for (int i = 0; i < iterations; ++i) {
+				mixer->compressRange(interleaved);
+			}
+		}, repeatedRuns), samples * 2);
+
+		AudioBiquadCoefficients coefficients;
+		coefficients.b0 = 0.2f;
+		coefficients.b1 = 0.4f;
+		coefficients.b2 = 0.2f;
+		coefficients.a1 = -0.5f;
+		coefficients.a2 = 0.3f;
+		std::array<AudioBiquadState, 2> state;
+		report("biquad", mixerName, 1, measure([&] () {
+			for (int i = 0; i < iterations; ++i) {
+				mixer->filterBiquad(channels, numPacks, coefficients, state);
+			}
+		}, repeatedRuns), samples * 2);
+
+		sink = dst[0].samples[0] + interleaved[0].samples[0] + left.packs[0].samples[0];
+	}
+
+	void benchResampler(int from, int to, int nChannels, float quality)
+	{
+		constexpr size_t frames = 4800;
+		constexpr int iterations = 200;
+
+		AudioResampler resampler(from, to, nChannels, quality);
+		std::vector<float> src(frames * nChannels);
+		for (size_t i = 0; i < src.size(); ++i) {
+			src[i] = std::sin(float(i) * 0.01f);
+		}
+		std::vector<float> dst(resampler.numOutputSamples(frames) * nChannels + 64);
+
+		const String name = "resample_" + toString(from) + "_" + toString(to) + "_" + toString(nChannels) + "ch";
+		report(name, String(resampler.isPolyphase() ? "polyphase" : "speex") + "_q" + toString(quality), 1, measure([&] () {
+			for (int i = 0; i < iterations; ++i) {
+				resampler.resampleInterleaved(src, dst);
+			}
+		}, repeatedRuns), frames * nChannels * iterations);
+		sink = dst[0];
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Executors executors;
+	Executors::set(executors);
+	ThreadPool cpuAuxThreadPool("CPUAux", executors.getCPUAux(), std::thread::hardware_concurrency(), [] (String, std::function<void()> runnable)
+	{
+		return std::thread(runnable);
+	});
+
+	Vector<size_t> voiceCounts = { 16, 64, 256 };
+	if (argc > 1) {
+		voiceCounts = { size_t(String(argv[1]).toInteger()) };
+	}
+	const Path assetsPath = argc > 2 ? Path(argv[2]) : Path("../assets_src/audio");
+
+	Clips clips;
+	clips.shortData = std::make_shared<const Bytes>(Path::readFile(assetsPath / "c1.ogg"));
+	clips.longData = std::make_shared<const Bytes>(Path::readFile(assetsPath / "Loveshadow_-_Marcos_Theme.ogg"));
+	if (clips.shortData->empty() || clips.longData->empty()) {
+		std::cerr << "Unable to find the test clips in " << assetsPath.string() << std::endl;
+		return 1;
+	}
+	clips.staticClip = loadStatic("short.ogg", clips.shortData);
+
+	const auto mixers = AudioMixer::getAvailableMixers();
+	const Vector<size_t> bufferSizes = { 256, 512, 1024, 2048 };
+
+	std::cout << "{\n\"mixers\": [";
+	for (size_t i = 0; i < mixers.size(); ++i) {
+		std::cout << (i > 0 ? ", " : " ") << "\"" << mixers[i] << "\"";
+	}
+	std::cout << " ],\n\"results\": [\n";
+
+	for (auto& mixer: mixers) {
+		benchMixer(mixer);
+	}
+
+	for (auto& mixer: mixers) {
+		for (auto n: voiceCounts) {
+			benchVoices(clips, mixer, n, 1024, false, false);
+			benchVoices(clips, mixer, n, 1024, false, true);
+		}
+	}
+
+	// Buffer size and streaming only depend on each other, so just try them with the mixer the engine would pick
+	const auto& bestMixer = mixers.back();
+	const size_t bufferVoices = std::min(size_t(64), voiceCounts.back());
+	for (auto bufferSize: bufferSizes) {
+		benchVoices(clips, bestMixer, bufferVoices, bufferSize, false, false);
+	}
+	for (size_t n: { 4, 16 }) {
+		benchVoices(clips, bestMixer, n, 1024, true, false);
+	}
+
+	benchResampler(44100, 48000, 2, 0.5f);
+	benchResampler(48000, 44100, 2, 0.5f);
+	benchResampler(22050, 48000, 1, 0.5f);
+	benchResampler(24000, 48000, 2, 0.5f);
+	benchResampler(48000, 96000, 2, 0.5f);
+	benchResampler(44100, 48000, 2, 1.0f);
+	benchResampler(49781, 48000, 2, 0.5f); // An arbitrary pitch shift, which doesn't reduce to a small ratio
+	std::cout << "\n]\n}\n";
+
+	return 0;
+}
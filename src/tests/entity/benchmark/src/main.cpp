@@ -0,0 +1,340 @@
+#include <halley/entity/world.h>
+#include <halley/entity/system.h>
+#include <halley/entity/entity.h>
+#include <halley/entity/family_binding.h>
+#include <halley/entity/type_deleter.h>
+#include <halley/concurrency/executor.h>
+#include <halley/time/stopwatch.h>
+#include <halley/text/halleystring.h>
+#include <halley/text/string_converter.h>
+#include <iostream>
+#include <thread>
+#include <limits>
+#include <algorithm>
+
+using namespace Halley;
+
+// Stand-ins for what codegen would generate
+
+template <int N>
+class BenchComponent final : public Component
+{
+public:
+	static constexpr int componentIndex = N;
+	float value = 1.0f;
+
+	BenchComponent() {}
+	BenchComponent(float value) : value(value) {}
+};
+
+using C0 = BenchComponent<0>;
+using C1 = BenchComponent<1>;
+using C2 = BenchComponent<2>;
+using C3 = BenchComponent<3>;
+using C4 = BenchComponent<4>;
+using C5 = BenchComponent<5>;
+using C6 = BenchComponent<6>;
+using C7 = BenchComponent<7>;
+
+class PingMessage final : public Message
+{
+public:
+	static constexpr int messageIndex = 0;
+	int value = 0;
+
+	PingMessage() {}
+	PingMessage(int value) : value(value) {}
+	size_t getSize() const override { return sizeof(PingMessage); }
+};
+
+class Family1 : public FamilyBaseOf<Family1>
+{
+public:
+	C0& c0;
+	using Type = FamilyType<C0>;
+};
+
+class Family2 : public FamilyBaseOf<Family2>
+{
+public:
+	C0& c0;
+	const C1& c1;
+	using Type = FamilyType<C0, C1>;
+};
+
+class Family4 : public FamilyBaseOf<Family4>
+{
+public:
+	C0& c0;
+	const C1& c1;
+	const C2& c2;
+	const C3& c3;
+	using Type = FamilyType<C0, C1, C2, C3>;
+};
+
+class Family8 : public FamilyBaseOf<Family8>
+{
+public:
+	C0& c0;
+	const C1& c1;
+	const C2& c2;
+	const C3& c3;
+	const C4& c4;
+	const C5& c5;
+	const C6& c6;
+	const C7& c7;
+	using Type = FamilyType<C0, C1, C2, C3, C4, C5, C6, C7>;
+};
+
+template <int N>
+class MovementFamily : public FamilyBaseOf<MovementFamily<N>>
+{
+public:
+	BenchComponent<N>& target;
+	const C0& source;
+	using Type = FamilyType<BenchComponent<N>, C0>;
+};
+
+// Each instantiation writes a different component, so they're free to run concurrently
+template <int N>
+class MovementSystem final : public System
+{
+public:
+	MovementSystem()
+		: System({ &family }, {}, SystemDependencies({ C0::componentIndex }, { N }, SystemDependencies::None))
+	{}
+
+	void updateBase(Time) override
+	{
+		for (auto& e: family) {
+			e.target.value += e.source.value;
+		}
+	}
+
+private:
+	FamilyBinding<MovementFamily<N>> family;
+};
+
+class PingSendSystem final : public System
+{
+public:
+	PingSendSystem()
+		: System({ &family }, {}, SystemDependencies({ C0::componentIndex }, {}, SystemDependencies::SendsMessages))
+	{}
+
+	void updateBase(Time) override
+	{
+		int i = 0;
+		for (auto& e: family) {
+			sendMessageGeneric(e.entityId, PingMessage(i++));
+		}
+	}
+
+private:
+	FamilyBinding<Family1> family;
+};
+
+class PingReceiveSystem final : public System
+{
+public:
+	PingReceiveSystem()
+		: System({ &family }, { PingMessage::messageIndex }, SystemDependencies({}, { C0::componentIndex }, SystemDependencies::ReceivesMessages))
+	{}
+
+	void onMessagesReceived(int, Message** msgs, size_t* idx, size_t n) override
+	{
+		for (size_t i = 0; i < n; ++i) {
+			family[idx[i]].c0.value += float(static_cast<PingMessage*>(msgs[i])->value);
+		}
+	}
+
+private:
+	FamilyBinding<Family1> family;
+};
+
+// Harness
+
+namespace {
+	bool firstResult = true;
+	volatile float sink = 0;
+
+	void report(const String& name, size_t entities, int64_t ns, size_t operations)
+	{
+		std::cout << (firstResult ? "" : ",\n") << "\t{ \"name\": \"" << name << "\", \"entities\": " << entities
+			<< ", \"total_ns\": " << ns << ", \"ns_per_op\": " << (operations > 0 ? double(ns) / double(operations) : 0.0) << " }";
+		firstResult = false;
+	}
+
+	// Returns the fastest of the runs, which is the least affected by noise
+	template <typename F>
+	int64_t measure(F f, int runs = 1)
+	{
+		int64_t best = std::numeric_limits<int64_t>::max();
+		for (int i = 0; i < runs; ++i) {
+			Stopwatch timer;
+			f();
+			timer.pause();
+			best = std::min(best, timer.elapsedNanoSeconds());
+		}
+		return best;
+	}
+
+	constexpr int repeatedRuns = 10;
+
+	void addComponents(EntityRef& e, int n)
+	{
+		e.addComponent(C0(1.0f));
+		if (n > 1) e.addComponent(C1(1.0f));
+		if (n > 2) e.addComponent(C2(1.0f));
+		if (n > 3) e.addComponent(C3(1.0f));
+		if (n > 4) e.addComponent(C4(1.0f));
+		if (n > 5) e.addComponent(C5(1.0f));
+		if (n > 6) e.addComponent(C6(1.0f));
+		if (n > 7) e.addComponent(C7(1.0f));
+	}
+
+	Vector<EntityId> populate(World& world, size_t n, int components)
+	{
+		auto ids = world.createEntities(n, [&] (EntityRef& e) { addComponents(e, components); });
+		world.spawnPending();
+		return ids;
+	}
+
+	void benchSpawn(size_t n)
+	{
+		World world(nullptr, false);
+		world.getFamily<Family4>();
+
+		Vector<EntityId> ids;
+		ids.reserve(n);
+		report("spawn", n, measure([&] () {
+			for (size_t i = 0; i < n; ++i) {
+				auto e = world.createEntity();
+				addComponents(e, 4);
+				ids.push_back(e.getEntityId());
+			}
+			world.spawnPending();
+		}), n);
+
+		report("despawn", n, measure([&] () {
+			for (auto& id: ids) {
+				world.destroyEntity(id);
+			}
+			world.spawnPending();
+		}), n);
+
+		report("spawn_batched", n, measure([&] () {
+			ids = populate(world, n, 4);
+		}), n);
+
+		report("despawn_batched", n, measure([&] () {
+			world.destroyEntities(ids);
+			world.spawnPending();
+		}), n);
+	}
+
+	template <typename F, typename G>
+	void benchIterate(size_t n, int components, G g)
+	{
+		World world(nullptr, false);
+		auto& family = world.getFamily<F>();
+		populate(world, n, components);
+
+		float total = 0;
+		report("iterate_" + toString(components), n, measure([&] () {
+			for (size_t i = 0; i < family.count(); ++i) {
+				total += g(*reinterpret_cast<F*>(family.getElement(i)));
+			}
+		}, repeatedRuns), n);
+		sink = total;
+	}
+
+	void benchTryGetComponent(size_t n)
+	{
+		World world(nullptr, false);
+		auto ids = populate(world, n, 8);
+
+		float total = 0;
+		report("try_get_component", n, measure([&] () {
+			for (auto& id: ids) {
+				auto* e = world.tryGetEntity(id);
+				total += e->tryGetComponent<C5>()->value;
+			}
+		}, repeatedRuns), n);
+		sink = total;
+	}
+
+	void benchMessages(size_t n)
+	{
+		World world(nullptr, false);
+		world.addSystem(std::make_unique<PingSendSystem>(), TimeLine::FixedUpdate).setName("PingSend");
+		world.addSystem(std::make_unique<PingReceiveSystem>(), TimeLine::FixedUpdate).setName("PingReceive");
+		populate(world, n, 1);
+
+		// First step initialises the systems
+		world.step(TimeLine::FixedUpdate, 0.01);
+		report("messages", n, measure([&] () {
+			world.step(TimeLine::FixedUpdate, 0.01);
+		}, repeatedRuns), n);
+	}
+
+	void benchStep(size_t n, int nSystems, bool parallel)
+	{
+		World world(nullptr, false);
+		world.setParallelSystems(parallel);
+		const std::function<std::unique_ptr<System>()> factories[] = {
+			[] () { return std::make_unique<MovementSystem<1>>(); },
+			[] () { return std::make_unique<MovementSystem<2>>(); },
+			[] () { return std::make_unique<MovementSystem<3>>(); },
+			[] () { return std::make_unique<MovementSystem<4>>(); },
+			[] () { return std::make_unique<MovementSystem<5>>(); },
+			[] () { return std::make_unique<MovementSystem<6>>(); },
+			[] () { return std::make_unique<MovementSystem<7>>(); }
+		};
+		for (int i = 0; i < nSystems; ++i) {
+			world.addSystem(factories[i](), TimeLine::FixedUpdate).setName("Movement" + toString(i));
+		}
+		populate(world, n, 8);
+
+		world.step(TimeLine::FixedUpdate, 0.01);
+		report(String("step_") + toString(nSystems) + "_systems" + (parallel ? "_parallel" : ""), n, measure([&] () {
+			world.step(TimeLine::FixedUpdate, 0.01);
+		}, repeatedRuns), n * size_t(nSystems));
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Vector<TypeDeleterBase*> typeDeleters;
+	ComponentDeleterTable::getDeleters() = &typeDeleters;
+	MaskStorageInterface::createMaskStorage();
+
+	Executors executors;
+	Executors::set(executors);
+	ThreadPool cpuThreadPool("CPU", executors.getCPU(), std::thread::hardware_concurrency(), [] (String, std::function<void()> runnable)
+	{
+		return std::thread(runnable);
+	});
+
+	Vector<size_t> sizes = { 1000, 10000, 100000 };
+	if (argc > 1) {
+		sizes = { size_t(String(argv[1]).toInteger()) };
+	}
+
+	std::cout << "{\n\"threads\": " << executors.getCPU().threadCount() << ",\n\"results\": [\n";
+	for (auto n: sizes) {
+		benchSpawn(n);
+		benchIterate<Family1>(n, 1, [] (const Family1& e) { return e.c0.value; });
+		benchIterate<Family2>(n, 2, [] (const Family2& e) { return e.c0.value + e.c1.value; });
+		benchIterate<Family4>(n, 4, [] (const Family4& e) { return e.c0.value + e.c1.value + e.c2.value + e.c3.value; });
+		benchIterate<Family8>(n, 8, [] (const Family8& e) { return e.c0.value + e.c1.value + e.c2.value + e.c3.value + e.c4.value + e.c5.value + e.c6.value + e.c7.value; });
+		benchTryGetComponent(n);
+		benchMessages(n);
+		benchStep(n, 1, false);
+		benchStep(n, 7, false);
+		benchStep(n, 7, true);
+	}
+	std::cout << "\n]\n}\n";
+
+	return 0;
+}
@@ -0,0 +1,382 @@
+#include <halley/net/connection/instability_simulator.h>
+#include <halley/net/connection/reliable_connection.h>
+#include <halley/net/connection/message_queue_udp.h>
+#include <halley/net/connection/network_message.h>
+#include <halley/net/connection/network_stats.h>
+#include <halley/bytes/byte_serializer.h>
+#include <halley/text/halleystring.h>
+#include <halley/text/string_converter.h>
+#include "asio_udp_network_service.h"
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <thread>
+#include <ctime>
+
+using namespace Halley;
+
+// Headless load test for the UDP stack. A host echoes pings and soaks up data from any number of clients, each one
+// with its own socket, reliable connection and message queue, optionally behind an InstabilitySimulator.
+// Host and clients can share a process, or run in separate ones (e.g. several client processes against one host):
+//
+//   halley-network-loadtest local [options]
+//   halley-network-loadtest host [options]
+//   halley-network-loadtest clients <address> [options]
+//
+// Options: --port 4113 --clients 100 --duration 10 --rate 20 (data messages per client per second) --size 64 (bytes per
+// data message) --lag 0 --lagVariance 0 --loss 0 --duplication 0 (applied to everything sent) --threads 0 (host network threads)
+// Results are printed as JSON.
+
+namespace {
+	constexpr int pingChannel = 0;
+	constexpr int dataChannel = 1;
+	constexpr float pingInterval = 0.1f;
+	constexpr float tickInterval = 1.0f / 60.0f;
+
+	using Clock = std::chrono::steady_clock;
+
+	uint64_t getTimestamp()
+	{
+		return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count());
+	}
+
+	float getSeconds(Clock::duration d)
+	{
+		return std::chrono::duration<float>(d).count();
+	}
+
+	class LoadPingMsg final : public NetworkMessage
+	{
+	public:
+		explicit LoadPingMsg(gsl::span<const gsl::byte> src)
+		{
+			Deserializer s(src);
+			s >> sentTime;
+		}
+
+		explicit LoadPingMsg(uint64_t sentTime)
+			: sentTime(sentTime)
+		{}
+
+		void serialize(Serializer& s) const override
+		{
+			s << sentTime;
+		}
+
+		uint64_t sentTime = 0; // In the sender's clock; the host echoes it back untouched
+	};
+
+	class LoadDataMsg final : public NetworkMessage
+	{
+	public:
+		explicit LoadDataMsg(gsl::span<const gsl::byte> src)
+		{
+			Deserializer s(src);
+			s >> payload;
+		}
+
+		explicit LoadDataMsg(Bytes payload)
+			: payload(std::move(payload))
+		{}
+
+		void serialize(Serializer& s) const override
+		{
+			s << payload;
+		}
+
+		Bytes payload;
+	};
+
+	struct Options
+	{
+		String mode = "local";
+		String address = "127.0.0.1";
+		int port = 4113;
+		int clients = 100;
+		float duration = 10.0f;
+		float rate = 20.0f;
+		int size = 64;
+		float lag = 0;
+		float lagVariance = 0;
+		float loss = 0;
+		float duplication = 0;
+		int threads = 0;
+	};
+
+	struct Peer
+	{
+		std::unique_ptr<NetworkService> service; // Only owned by clients
+		std::shared_ptr<MessageQueueUDP> queue;
+		float pingTime = 0;
+		float dataTime = 0;
+	};
+
+	std::shared_ptr<MessageQueueUDP> makeQueue(std::shared_ptr<IConnection> connection, const Options& options)
+	{
+		if (options.lag > 0 || options.lagVariance > 0 || options.loss > 0 || options.duplication > 0) {
+			connection = std::make_shared<InstabilitySimulator>(connection, options.lag, options.lagVariance, options.loss, options.duplication);
+		}
+		auto queue = std::make_shared<MessageQueueUDP>(std::make_shared<ReliableConnection>(connection));
+		queue->setChannel(pingChannel, ChannelSettings(false, false));
+		queue->setChannel(dataChannel, ChannelSettings(true, true));
+		queue->addFactory<LoadPingMsg>();
+		queue->addFactory<LoadDataMsg>();
+		return queue;
+	}
+
+	class Host
+	{
+	public:
+		explicit Host(const Options& options)
+			: options(options)
+			, service(std::make_unique<AsioUDPNetworkService>(options.port, IPVersion::IPv4, options.threads))
+		{
+			service->setAcceptingConnections(true);
+		}
+
+		void update()
+		{
+			service->update();
+			while (auto connection = service->tryAcceptConnection()) {
+				peers.push_back(makeQueue(connection, options));
+			}
+
+			for (auto& queue: peers) {
+				for (auto& msg: queue->receiveAll()) {
+					if (auto ping = dynamic_cast<LoadPingMsg*>(msg.get())) {
+						queue->enqueue(std::make_unique<LoadPingMsg>(ping->sentTime), pingChannel);
+					} else if (dynamic_cast<LoadDataMsg*>(msg.get())) {
+						++dataReceived;
+					}
+				}
+				queue->sendAll();
+			}
+		}
+
+		size_t getNumPeers() const { return peers.size(); }
+		uint64_t getDataReceived() const { return dataReceived; }
+
+	private:
+		const Options& options;
+		std::unique_ptr<NetworkService> service;
+		Vector<std::shared_ptr<MessageQueueUDP>> peers;
+		uint64_t dataReceived = 0;
+	};
+
+	class Clients
+	{
+	public:
+		explicit Clients(const Options& options)
+			: options(options)
+			, payload(size_t(options.size))
+		{
+			for (int i = 0; i < options.clients; ++i) {
+				Peer peer;
+				peer.service = std::make_unique<AsioUDPNetworkService>(0);
+				peer.queue = makeQueue(peer.service->connect(options.address, options.port), options);
+				// Spread the clients' schedules out, so they don't all send on the same tick
+				peer.pingTime = pingInterval * float(i) / float(options.clients);
+				peers.push_back(std::move(peer));
+			}
+		}
+
+		void update(float t)
+		{
+			const float dataInterval = options.rate > 0 ? 1.0f / options.rate : 0;
+			for (auto& peer: peers) {
+				peer.service->update();
+				if (!peer.queue->isConnected()) {
+					continue;
+				}
+
+				for (auto& msg: peer.queue->receiveAll()) {
+					if (auto ping = dynamic_cast<LoadPingMsg*>(msg.get())) {
+						latency.record(float(double(getTimestamp() - ping->sentTime) * 0.000000001));
+					}
+				}
+
+				peer.pingTime -= t;
+				if (peer.pingTime <= 0) {
+					peer.pingTime += pingInterval;
+					peer.queue->enqueue(std::make_unique<LoadPingMsg>(getTimestamp()), pingChannel);
+				}
+
+				if (dataInterval > 0) {
+					peer.dataTime -= t;
+					while (peer.dataTime <= 0) {
+						peer.dataTime += dataInterval;
+						peer.queue->enqueue(std::make_unique<LoadDataMsg>(payload), dataChannel);
+						++dataSent;
+					}
+				}
+
+				peer.queue->sendAll();
+			}
+		}
+
+		size_t getNumConnected() const
+		{
+			size_t n = 0;
+			for (auto& peer: peers) {
+				n += peer.queue->isConnected() ? 1 : 0;
+			}
+			return n;
+		}
+
+		const NetworkHistogram& getLatency() const { return latency; }
+		uint64_t getDataSent() const { return dataSent; }
+
+	private:
+		const Options& options;
+		Bytes payload;
+		Vector<Peer> peers;
+		NetworkHistogram latency; // Round trip time of pings, as seen by the clients
+		uint64_t dataSent = 0;
+	};
+
+	Options parseOptions(int argc, char** argv)
+	{
+		Options options;
+		int i = 1;
+		if (i < argc && argv[i][0] != '-') {
+			options.mode = argv[i++];
+			if (options.mode == "clients" && i < argc && argv[i][0] != '-') {
+				options.address = argv[i++];
+			}
+		}
+
+		for (; i + 1 < argc; i += 2) {
+			const String key = argv[i];
+			const String value = argv[i + 1];
+			if (key == "--port") {
+				options.port = value.toInteger();
+			} else if (key == "--clients") {
+				options.clients = value.toInteger();
+			} else if (key == "--duration") {
+				options.duration = value.toFloat();
+			} else if (key == "--rate") {
+				options.rate = value.toFloat();
+			} else if (key == "--size") {
+				options.size = value.toInteger();
+			} else if (key == "--lag") {
+				options.lag = value.toFloat();
+			} else if (key == "--lagVariance") {
+				options.lagVariance = value.toFloat();
+			} else if (key == "--loss") {
+				options.loss = value.toFloat();
+			} else if (key == "--duplication") {
+				options.duplication = value.toFloat();
+			} else if (key == "--threads") {
+				options.threads = value.toInteger();
+			} else {
+				std::cerr << "Unknown option: " << key << std::endl;
+			}
+		}
+		return options;
+	}
+
+	// Resident set size in bytes, where the platform makes it easy to find
+	long long getMemoryUsage()
+	{
+#ifdef __linux__
+		std::ifstream status("/proc/self/status");
+		std::string line;
+		while (std::getline(status, line)) {
+			if (line.compare(0, 6, "VmRSS:") == 0) {
+				return std::stoll(line.substr(6)) * 1024;
+			}
+		}
+#endif
+		return 0;
+	}
+
+	void printHistogram(const char* name, const NetworkHistogram& histogram)
+	{
+		std::cout << "\"" << name << "\": { \"count\": " << histogram.getCount()
+			<< ", \"mean\": " << histogram.getMean()
+			<< ", \"p50\": " << histogram.getPercentile(0.5f)
+			<< ", \"p90\": " << histogram.getPercentile(0.9f)
+			<< ", \"p99\": " << histogram.getPercentile(0.99f)
+			<< ", \"max\": " << histogram.getMax() << " }";
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const auto options = parseOptions(argc, argv);
+	const bool runHost = options.mode == "local" || options.mode == "host";
+	const bool runClients = options.mode == "local" || options.mode == "clients";
+	if (!runHost && !runClients) {
+		std::cerr << "Usage: " << argv[0] << " [local|host|clients <address>] [--option value...]" << std::endl;
+		return 1;
+	}
+
+	const auto memoryStart = getMemoryUsage();
+	std::unique_ptr<Host> host;
+	std::unique_ptr<Clients> clients;
+	if (runHost) {
+		host = std::make_unique<Host>(options);
+	}
+	if (runClients) {
+		clients = std::make_unique<Clients>(options);
+	}
+
+	const auto cpuStart = std::clock();
+	const auto startTime = Clock::now();
+	auto lastTick = startTime;
+	NetworkHistogram tickTime;
+
+	while (getSeconds(Clock::now() - startTime) < options.duration) {
+		const auto tickStart = Clock::now();
+		const float t = getSeconds(tickStart - lastTick);
+		lastTick = tickStart;
+
+		if (host) {
+			host->update();
+		}
+		if (clients) {
+			clients->update(t);
+		}
+		const float workTime = getSeconds(Clock::now() - tickStart);
+		tickTime.record(workTime);
+
+		if (workTime < tickInterval) {
+			std::this_thread::sleep_for(std::chrono::duration<float>(tickInterval - workTime));
+		}
+	}
+
+	const double wallTime = getSeconds(Clock::now() - startTime);
+	const double cpuTime = double(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+	const auto stats = NetworkStatsRegistry::get().gather();
+	const auto& traffic = stats.connections.traffic;
+	const int numClients = clients ? options.clients : int(host->getNumPeers());
+
+	std::cout << "{\n\"mode\": \"" << options.mode << "\",\n";
+	std::cout << "\"clients\": " << numClients << ",\n";
+	std::cout << "\"connected\": " << (clients ? clients->getNumConnected() : host->getNumPeers()) << ",\n";
+	std::cout << "\"duration\": " << wallTime << ",\n";
+	std::cout << "\"bytes_sent_per_second\": " << double(traffic.bytesSent) / wallTime << ",\n";
+	std::cout << "\"bytes_received_per_second\": " << double(traffic.bytesReceived) / wallTime << ",\n";
+	std::cout << "\"packets_sent_per_second\": " << double(traffic.packetsSent) / wallTime << ",\n";
+	std::cout << "\"packets_received_per_second\": " << double(traffic.packetsReceived) / wallTime << ",\n";
+	std::cout << "\"packets_lost\": " << stats.connections.packetsLost << ",\n";
+	std::cout << "\"messages_resent\": " << stats.messageQueues.messagesResent << ",\n";
+	if (clients) {
+		std::cout << "\"data_sent\": " << clients->getDataSent() << ",\n";
+	}
+	if (host) {
+		std::cout << "\"data_received\": " << host->getDataReceived() << ",\n";
+	}
+	std::cout << "\"cpu_seconds\": " << cpuTime << ",\n";
+	std::cout << "\"cpu_per_client\": " << (numClients > 0 ? cpuTime / wallTime / numClients : 0.0) << ",\n";
+	std::cout << "\"memory\": " << getMemoryUsage() << ",\n";
+	std::cout << "\"memory_per_client\": " << (numClients > 0 ? (getMemoryUsage() - memoryStart) / numClients : 0) << ",\n";
+	if (clients) {
+		printHistogram("latency", clients->getLatency());
+		std::cout << ",\n";
+	}
+	printHistogram("tick_time", tickTime);
+	std::cout << "\n}\n";
+
+	return 0;
+}
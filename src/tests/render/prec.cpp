@@ -0,0 +1 @@
+#include "prec.h"
@@ -0,0 +1,6 @@
+#pragma once
+
+namespace Halley {} // Get GitHub to realise this is C++ :3
+
+#include <halley.hpp>
+
@@ -0,0 +1,319 @@
+#include "benchmark_stage.h"
+#include <iostream>
+#include <sstream>
+#include <cmath>
+
+using namespace Halley;
+
+namespace {
+	constexpr size_t numSprites = 20000;
+	constexpr size_t numMaterials = 8;
+	constexpr size_t numSliced = 2000;
+	constexpr size_t numRenderTargets = 4;
+	constexpr int renderTargetSize = 512;
+	const Rect4f worldArea(-640, -360, 2560, 1440);
+}
+
+Vector<BenchmarkScene> BenchmarkStage::getAllScenes()
+{
+	return { BenchmarkScene::Sprites, BenchmarkScene::SpritesMaterials, BenchmarkScene::MixedMaterials, BenchmarkScene::Text, BenchmarkScene::Sliced, BenchmarkScene::RenderTargets };
+}
+
+BenchmarkScene BenchmarkStage::parseScene(const String& name)
+{
+	for (auto scene: getAllScenes()) {
+		if (getSceneName(scene) == name) {
+			return scene;
+		}
+	}
+	throw Exception("Unknown benchmark scene: " + name, HalleyExceptions::Core);
+}
+
+String BenchmarkStage::getSceneName(BenchmarkScene scene)
+{
+	switch (scene) {
+	case BenchmarkScene::Sprites:
+		return "sprites";
+	case BenchmarkScene::SpritesMaterials:
+		return "sprites_materials";
+	case BenchmarkScene::MixedMaterials:
+		return "mixed_materials";
+	case BenchmarkScene::Text:
+		return "text";
+	case BenchmarkScene::Sliced:
+		return "sliced";
+	case BenchmarkScene::RenderTargets:
+		return "render_targets";
+	default:
+		return "unknown";
+	}
+}
+
+BenchmarkStage::BenchmarkStage(Vector<BenchmarkScene> scenes, String backend)
+	: scenes(std::move(scenes))
+	, backend(std::move(backend))
+{
+}
+
+void BenchmarkStage::init()
+{
+	spriteMaterial = getResource<MaterialDefinition>("Halley/Sprite");
+	makeTextures(numMaterials);
+	makeSprites();
+	makeLabels();
+	makeRenderTargets();
+
+	std::cout << "[\n";
+}
+
+void BenchmarkStage::onVariableUpdate(Time)
+{
+	if (sceneIdx >= scenes.size()) {
+		return;
+	}
+
+	// The first measured frame starts at the end of the warmup
+	const int64_t now = Profiler::getTimeNs();
+	if (frame > warmupFrames) {
+		results.frameTime.addSample(now - lastFrameNs);
+		results.renderTime.addSample(getCoreAPI().getTime(CoreAPITimer::Engine, TimeLine::Render, StopwatchAveraging::Mode::Latest));
+	}
+	lastFrameNs = now;
+
+	if (frame == warmupFrames + measuredFrames) {
+		reportScene();
+		results = SceneResults();
+		frame = 0;
+		if (++sceneIdx == scenes.size()) {
+			std::cout << "\n]" << std::endl;
+			getCoreAPI().quit();
+		}
+	} else {
+		++frame;
+	}
+}
+
+void BenchmarkStage::onRender(RenderContext& context) const
+{
+	if (sceneIdx >= scenes.size()) {
+		return;
+	}
+
+	if (scenes[sceneIdx] == BenchmarkScene::RenderTargets) {
+		drawToRenderTargets(context);
+	}
+
+	auto camera = getCamera(frame);
+	context.with(camera).bind([&] (Painter& painter)
+	{
+		painter.clear(Colour4f(0.1f, 0.1f, 0.15f));
+		drawScene(painter);
+
+		// Painter counts are for the whole of the previous frame, and GPU times lag a few frames more, which the
+		// warmup covers
+		if (frame > warmupFrames) {
+			results.drawCalls += painter.getPrevDrawCalls();
+			results.vertices += painter.getPrevVertices();
+			++results.frames;
+
+			const int64_t gpuTime = painter.getGPUTime(StopwatchAveraging::Mode::Latest);
+			if (gpuTime > 0) {
+				results.gpuTime.addSample(gpuTime);
+			}
+		}
+	});
+}
+
+void BenchmarkStage::makeTextures(size_t n)
+{
+	// Plain squares with a darker border, so slicing them shows
+	const Vector2i size(64, 64);
+	constexpr int border = 16;
+
+	auto& video = getVideoAPI();
+	for (size_t i = 0; i < n; ++i) {
+		const auto colour = Colour4f::fromHSV(float(i) / float(n), 0.6f, 0.9f);
+		Bytes pixels(size_t(size.x * size.y * 4));
+		for (int y = 0; y < size.y; ++y) {
+			for (int x = 0; x < size.x; ++x) {
+				const bool isBorder = x < border || y < border || x >= size.x - border || y >= size.y - border;
+				const float shade = isBorder ? 0.5f : 1.0f;
+				auto* pixel = &pixels[size_t(y * size.x + x) * 4];
+				pixel[0] = Byte(colour.r * shade * 255);
+				pixel[1] = Byte(colour.g * shade * 255);
+				pixel[2] = Byte(colour.b * shade * 255);
+				pixel[3] = 255;
+			}
+		}
+
+		std::shared_ptr<Texture> texture = video.createTexture(size);
+		TextureDescriptor descriptor(size, TextureFormat::RGBA);
+		descriptor.useFiltering = true;
+		descriptor.pixelData = TextureDescriptorImageData(std::move(pixels));
+		texture->load(std::move(descriptor));
+		textures.push_back(std::move(texture));
+	}
+}
+
+void BenchmarkStage::makeSprites()
+{
+	Vector<std::shared_ptr<Material>> materials;
+	for (auto& texture: textures) {
+		auto material = std::make_shared<Material>(spriteMaterial);
+		material->set("tex0", texture);
+		materials.push_back(std::move(material));
+	}
+
+	// Fixed seed, so every run draws exactly the same thing
+	Random rng(1234, RandomEngine::Xoshiro);
+	auto randomPosition = [&] () { return Vector2f(rng.getFloat(worldArea.getLeft(), worldArea.getRight()), rng.getFloat(worldArea.getTop(), worldArea.getBottom())); };
+
+	for (size_t i = 0; i < numSprites; ++i) {
+		const auto pos = randomPosition();
+		const auto scale = rng.getFloat(0.25f, 0.75f);
+		const auto rotation = Angle1f::fromDegrees(rng.getFloat(0, 360));
+		const auto colour = Colour4f(1, 1, 1, rng.getFloat(0.5f, 1.0f));
+
+		sprites.push_back(Sprite().setMaterial(materials[0]).setImageData(*textures[0]).setPivot(Vector2f(0.5f, 0.5f))
+			.setPosition(pos).setScale(scale).setRotation(rotation).setColour(colour));
+
+		const size_t matIdx = i % materials.size();
+		materialSprites.push_back(Sprite().setMaterial(materials[matIdx]).setImageData(*textures[matIdx]).setPivot(Vector2f(0.5f, 0.5f))
+			.setPosition(pos).setScale(scale).setRotation(rotation).setColour(colour));
+	}
+
+	for (size_t i = 0; i < numSliced; ++i) {
+		const size_t matIdx = i % materials.size();
+		slicedSprites.push_back(Sprite().setMaterial(materials[matIdx]).setImageData(*textures[matIdx])
+			.setSliced(Vector4s(16, 16, 16, 16)).setPosition(randomPosition())
+			.setSize(Vector2f(rng.getFloat(48, 320), rng.getFloat(48, 200))));
+	}
+}
+
+void BenchmarkStage::makeLabels()
+{
+	// A settings screen's worth of text: a column of headers, and rows of labels with values
+	const auto font = getResource<Font>("Ubuntu Bold");
+	const Vector<String> words = { "Volume", "Resolution", "Brightness", "Subtitles", "Difficulty", "Controls", "Language", "Vibration" };
+	for (int column = 0; column < 4; ++column) {
+		const float x = column * 320.0f;
+		labels.push_back(TextRenderer(font, "Section " + toString(column + 1), 32, Colour(1, 0.8f, 0.3f), 1.0f, Colour(0, 0, 0)).setPosition(Vector2f(x, 0)));
+		for (int row = 0; row < 40; ++row) {
+			const auto& word = words[(row + column) % words.size()];
+			labels.push_back(TextRenderer(font, word + " " + toString(row) + ": the quick brown fox jumps over the lazy dog", 14, Colour(1, 1, 1)).setPosition(Vector2f(x, 48 + row * 18.0f)));
+		}
+	}
+}
+
+void BenchmarkStage::makeRenderTargets()
+{
+	auto& video = getVideoAPI();
+	const Vector2i size(renderTargetSize, renderTargetSize);
+	for (size_t i = 0; i < numRenderTargets; ++i) {
+		std::shared_ptr<Texture> texture = video.createTexture(size);
+		TextureDescriptor descriptor(size, TextureFormat::RGBA);
+		descriptor.useFiltering = true;
+		descriptor.isRenderTarget = true;
+		texture->load(std::move(descriptor));
+
+		auto target = video.createTextureRenderTarget();
+		target->setTarget(0, texture);
+		target->setViewPort(Rect4i(Vector2i(), size));
+		renderTargets.push_back(std::move(target));
+
+		// Composited in a 2x2 grid
+		const auto pos = Vector2f(float(i % 2), float(i / 2)) * float(renderTargetSize) + Vector2f(128, 0);
+		renderTargetSprites.push_back(Sprite().setImage(texture, spriteMaterial).setImageData(*texture).setPosition(pos));
+	}
+}
+
+void BenchmarkStage::drawScene(Painter& painter) const
+{
+	switch (scenes[sceneIdx]) {
+	case BenchmarkScene::Sprites:
+		for (auto& sprite: sprites) {
+			sprite.draw(painter);
+		}
+		break;
+
+	case BenchmarkScene::SpritesMaterials:
+		for (auto& sprite: materialSprites) {
+			sprite.draw(painter);
+		}
+		break;
+
+	case BenchmarkScene::MixedMaterials:
+		Sprite::drawMixedMaterials(materialSprites.data(), materialSprites.size(), painter);
+		break;
+
+	case BenchmarkScene::Text:
+		for (auto& label: labels) {
+			label.draw(painter);
+		}
+		break;
+
+	case BenchmarkScene::Sliced:
+		for (auto& sprite: slicedSprites) {
+			sprite.draw(painter);
+		}
+		break;
+
+	case BenchmarkScene::RenderTargets:
+		for (auto& sprite: renderTargetSprites) {
+			sprite.draw(painter);
+		}
+		break;
+	}
+}
+
+void BenchmarkStage::drawToRenderTargets(RenderContext& context) const
+{
+	// Each target gets its own slice of the sprites, seen through its own camera
+	const size_t spritesPerTarget = sprites.size() / renderTargets.size();
+	for (size_t i = 0; i < renderTargets.size(); ++i) {
+		Camera camera(worldArea.getCenter() + Vector2f(float(i % 2) - 0.5f, float(i / 2) - 0.5f) * 800.0f);
+		camera.setZoom(0.5f);
+
+		context.with(*renderTargets[i]).with(camera).bind([&] (Painter& painter)
+		{
+			painter.clear(Colour4f(0, 0, 0));
+			Sprite::draw(sprites.data() + i * spritesPerTarget, spritesPerTarget, painter);
+		});
+	}
+}
+
+Camera BenchmarkStage::getCamera(int frame) const
+{
+	// Depends only on the frame, so every run and backend sees the same sequence of views
+	const float t = frame * 0.01f;
+	Camera camera(Vector2f(640, 360) + Vector2f(std::cos(t), std::sin(t)) * 200.0f);
+	camera.setZoom(1.0f + 0.25f * std::sin(t * 0.7f));
+	return camera;
+}
+
+void BenchmarkStage::reportScene()
+{
+	auto writeStats = [] (std::ostream& os, const char* name, const TimeHistogram& histogram)
+	{
+		const auto stats = histogram.getStats(TimeHistogram::Window::Total);
+		os << ", \"" << name << "\": ";
+		if (stats.samples == 0) {
+			os << "null";
+		} else {
+			os << "{ \"mean_ms\": " << stats.mean * 1e-6 << ", \"p50_ms\": " << stats.p50 * 1e-6 << ", \"p95_ms\": " << stats.p95 * 1e-6
+				<< ", \"p99_ms\": " << stats.p99 * 1e-6 << ", \"max_ms\": " << stats.max * 1e-6 << " }";
+		}
+	};
+
+	const size_t frames = std::max(results.frames, size_t(1));
+	std::stringstream ss;
+	ss << (firstResult ? "" : ",\n") << "\t{ \"scene\": \"" << getSceneName(scenes[sceneIdx]) << "\", \"backend\": \"" << backend << "\", \"frames\": " << results.frames
+		<< ", \"draw_calls\": " << results.drawCalls / frames << ", \"vertices\": " << results.vertices / frames;
+	writeStats(ss, "cpu_frame", results.frameTime);
+	writeStats(ss, "cpu_render", results.renderTime);
+	writeStats(ss, "gpu", results.gpuTime); // null if the backend has no timestamp queries
+	ss << " }";
+
+	std::cout << ss.str() << std::flush;
+	firstResult = false;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "prec.h"
+
+enum class BenchmarkScene
+{
+	Sprites, // Many sprites sharing one material, drawn one at a time
+	SpritesMaterials, // Same, but cycling through several materials, which breaks batches
+	MixedMaterials, // The same sprites as above, through Sprite::drawMixedMaterials
+	Text, // A text-heavy UI screen
+	Sliced, // Nine-sliced panels
+	RenderTargets // Sprites drawn to several render targets, which are then composited on screen
+};
+
+class BenchmarkStage final : public Halley::Stage
+{
+public:
+	static Halley::Vector<BenchmarkScene> getAllScenes();
+	static BenchmarkScene parseScene(const Halley::String& name);
+	static Halley::String getSceneName(BenchmarkScene scene);
+
+	BenchmarkStage(Halley::Vector<BenchmarkScene> scenes, Halley::String backend);
+
+	void init() override;
+	void onVariableUpdate(Halley::Time time) override;
+	void onRender(Halley::RenderContext& context) const override;
+
+private:
+	constexpr static int warmupFrames = 60; // Also covers the GPU timer's latency
+	constexpr static int measuredFrames = 600;
+
+	struct SceneResults
+	{
+		Halley::TimeHistogram frameTime;
+		Halley::TimeHistogram renderTime;
+		Halley::TimeHistogram gpuTime;
+		size_t drawCalls = 0;
+		size_t vertices = 0;
+		size_t frames = 0;
+	};
+
+	Halley::Vector<BenchmarkScene> scenes;
+	Halley::String backend;
+	size_t sceneIdx = 0;
+	int frame = 0;
+	int64_t lastFrameNs = 0;
+	mutable SceneResults results;
+	bool firstResult = true;
+
+	std::shared_ptr<const Halley::MaterialDefinition> spriteMaterial;
+	Halley::Vector<std::shared_ptr<Halley::Texture>> textures;
+	Halley::Vector<Halley::Sprite> sprites;
+	Halley::Vector<Halley::Sprite> materialSprites;
+	Halley::Vector<Halley::Sprite> slicedSprites;
+	Halley::Vector<Halley::TextRenderer> labels;
+	Halley::Vector<std::unique_ptr<Halley::TextureRenderTarget>> renderTargets;
+	Halley::Vector<Halley::Sprite> renderTargetSprites;
+
+	void makeTextures(size_t n);
+	void makeSprites();
+	void makeLabels();
+	void makeRenderTargets();
+
+	void drawScene(Halley::Painter& painter) const;
+	void drawToRenderTargets(Halley::RenderContext& context) const;
+	Halley::Camera getCamera(int frame) const;
+
+	void reportScene();
+};
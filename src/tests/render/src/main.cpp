@@ -0,0 +1,91 @@
+#include "prec.h"
+#include "benchmark_stage.h"
+
+using namespace Halley;
+
+void initOpenGLPlugin(IPluginRegistry &registry);
+void initSDLSystemPlugin(IPluginRegistry &registry, Maybe<String> cryptKey);
+void initSDLInputPlugin(IPluginRegistry &registry);
+#ifdef _WIN32
+void initDX11Plugin(IPluginRegistry &registry);
+#endif
+
+// Runs each scene for a fixed number of frames, uncapped and without vsync, then prints the results as JSON and quits.
+// Arguments:
+//   --dx11            Use the DX11 backend instead of OpenGL (Windows only)
+//   --scene <name>    Only run this scene (can be repeated)
+class RenderBenchmarkGame final : public Game
+{
+public:
+	void init(const Environment&, const Vector<String>& args) override
+	{
+		for (size_t i = 0; i < args.size(); ++i) {
+			if (args[i] == "--dx11") {
+#ifdef _WIN32
+				backend = "dx11";
+#else
+				throw Exception("The DX11 backend is only available on Windows.", HalleyExceptions::Core);
+#endif
+			} else if (args[i] == "--scene" && i + 1 < args.size()) {
+				scenes.push_back(BenchmarkStage::parseScene(args[++i]));
+			}
+		}
+		if (scenes.empty()) {
+			scenes = BenchmarkStage::getAllScenes();
+		}
+	}
+
+	int initPlugins(IPluginRegistry &registry) override
+	{
+		initSDLSystemPlugin(registry, {});
+		initSDLInputPlugin(registry);
+#ifdef _WIN32
+		if (backend == "dx11") {
+			initDX11Plugin(registry);
+		} else {
+			initOpenGLPlugin(registry);
+		}
+#else
+		initOpenGLPlugin(registry);
+#endif
+		return HalleyAPIFlags::Video | HalleyAPIFlags::Input;
+	}
+
+	void initResourceLocator(const Path& gamePath, const Path& assetsPath, const Path& unpackedAssetsPath, ResourceLocator& locator) override
+	{
+		locator.addFileSystem(unpackedAssetsPath);
+	}
+
+	String getName() const override
+	{
+		return "Render benchmark";
+	}
+
+	String getDataPath() const override
+	{
+		return "halley/render-benchmark";
+	}
+
+	bool isDevMode() const override
+	{
+		return false;
+	}
+
+	int getTargetFPS() const override
+	{
+		return 0;
+	}
+
+	std::unique_ptr<Stage> startGame(const HalleyAPI* api) override
+	{
+		api->video->setWindow(WindowDefinition(WindowType::Window, Vector2i(1280, 720), getName()));
+		api->video->setVsync(false);
+		return std::make_unique<BenchmarkStage>(scenes, backend);
+	}
+
+private:
+	String backend = "opengl";
+	Vector<BenchmarkScene> scenes;
+};
+
+HalleyGame(RenderBenchmarkGame);
@@ -0,0 +1,387 @@
+#include <halley/core/resources/resource_locator.h>
+#include <halley/core/resources/asset_database.h>
+#include <halley/core/resources/asset_pack.h>
+#include <halley/bytes/byte_serializer.h>
+#include <halley/concurrency/concurrent.h>
+#include <halley/concurrency/executor.h>
+#include <halley/file/path.h>
+#include <halley/file_formats/config_file.h>
+#include <halley/file_formats/image.h>
+#include <halley/maths/random.h>
+#include <halley/os/os.h>
+#include <halley/resources/metadata.h>
+#include <halley/support/profiler.h>
+#include <halley/text/halleystring.h>
+#include <halley/text/string_converter.h>
+#include "dummy/dummy_system.h"
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+
+using namespace Halley;
+
+// Stand-ins for what the platform plugins provide
+
+class FileDataReader final : public ResourceDataReader
+{
+public:
+	FileDataReader(FILE* fp, int64_t start, int64_t end)
+		: fp(fp)
+		, start(start)
+	{
+		fseek(fp, 0, SEEK_END);
+		const auto fileSize = int64_t(ftell(fp));
+		length = size_t((end < 0 ? fileSize : std::min(end, fileSize)) - start);
+		fseek(fp, long(start), SEEK_SET);
+	}
+
+	~FileDataReader()
+	{
+		close();
+	}
+
+	size_t size() const override { return length; }
+
+	int read(gsl::span<gsl::byte> dst) override
+	{
+		const size_t n = std::min(size_t(dst.size()), length - pos);
+		const size_t got = fread(dst.data(), 1, n, fp);
+		pos += got;
+		return int(got);
+	}
+
+	void seek(int64_t offset, int whence) override
+	{
+		if (whence == SEEK_SET) {
+			pos = size_t(offset);
+		} else if (whence == SEEK_CUR) {
+			pos = size_t(int64_t(pos) + offset);
+		} else if (whence == SEEK_END) {
+			pos = size_t(int64_t(length) + offset);
+		}
+		pos = std::min(pos, length);
+		fseek(fp, long(start + int64_t(pos)), SEEK_SET);
+	}
+
+	size_t tell() const override { return pos; }
+
+	void close() override
+	{
+		if (fp) {
+			fclose(fp);
+			fp = nullptr;
+		}
+	}
+
+private:
+	FILE* fp;
+	int64_t start;
+	size_t length = 0;
+	size_t pos = 0;
+};
+
+class FileSystemAPI final : public DummySystemAPI
+{
+public:
+	std::unique_ptr<ResourceDataReader> getDataReader(String path, int64_t start, int64_t end) override
+	{
+		FILE* fp = fopen(path.c_str(), "rb");
+		if (!fp) {
+			return {};
+		}
+		return std::make_unique<FileDataReader>(fp, start, end);
+	}
+};
+
+// Reads the pack through a file reader, as platforms that can't map files do. ResourceLocator::addPack maps it when it can.
+class ReaderPackProvider final : public IResourceLocatorProvider
+{
+public:
+	ReaderPackProvider(std::unique_ptr<ResourceDataReader> reader, const String& encryptionKey)
+		: pack(std::move(reader), encryptionKey)
+	{}
+
+	std::unique_ptr<ResourceData> getData(const String& path, AssetType type, bool stream) override { return pack.getData(path, type, stream); }
+	const AssetDatabase& getAssetDatabase() override { return pack.getAssetDatabase(); }
+	void purge(SystemAPI&) override {}
+
+private:
+	AssetPack pack;
+};
+
+// Synthetic asset set
+
+namespace {
+	struct SyntheticAsset
+	{
+		String name;
+		AssetType type;
+		Bytes data;
+	};
+
+	// Texture-like noise over gradients, which compresses a little, like real art does
+	Bytes makePNG(Random& rng, Vector2i size)
+	{
+		Image image(Image::Format::RGBA, size);
+		auto* pixels = reinterpret_cast<uint32_t*>(image.getPixels());
+		for (int y = 0; y < size.y; ++y) {
+			for (int x = 0; x < size.x; ++x) {
+				const auto noise = rng.getInt(0u, 31u);
+				pixels[y * size.x + x] = Image::convertRGBAToInt(x + noise, y + noise, (x ^ y) & 0xFF, 255);
+			}
+		}
+		return image.savePNGToBytes();
+	}
+
+	Bytes makeConfig(Random& rng, int entries)
+	{
+		ConfigFile config;
+		ConfigNode::SequenceType sequence;
+		for (int i = 0; i < entries; ++i) {
+			ConfigNode::MapType map;
+			map["name"] = ConfigNode(String("entry_" + toString(i)));
+			map["frame"] = ConfigNode(Vector2i(rng.getInt(0, 2048), rng.getInt(0, 2048)));
+			map["duration"] = ConfigNode(rng.getFloat(0.0f, 1.0f));
+			map["loop"] = ConfigNode(rng.getInt(0, 1) == 1);
+			sequence.push_back(ConfigNode(std::move(map)));
+		}
+		config.getRoot() = ConfigNode(std::move(sequence));
+		return Serializer::toBytes(config);
+	}
+
+	Bytes makeBinary(Random& rng, size_t size, bool compressible)
+	{
+		Bytes data(size);
+		rng.getBytes(gsl::as_writeable_bytes(gsl::span<Byte>(data)));
+		if (compressible) {
+			// Glyph outlines and tables repeat a lot
+			for (size_t i = 0; i < size; ++i) {
+				data[i] &= 0x0F;
+			}
+		}
+		return data;
+	}
+
+	Vector<SyntheticAsset> makeAssetSet()
+	{
+		Random rng(1234, RandomEngine::Xoshiro);
+		Vector<SyntheticAsset> assets;
+		for (int i = 0; i < 48; ++i) {
+			assets.push_back(SyntheticAsset{ "texture_" + toString(i), AssetType::Image, makePNG(rng, Vector2i(256, 256)) });
+		}
+		for (int i = 0; i < 48; ++i) {
+			assets.push_back(SyntheticAsset{ "sprites_" + toString(i), AssetType::SpriteSheet, makeConfig(rng, 200) });
+		}
+		for (int i = 0; i < 12; ++i) {
+			// Already compressed (e.g. Vorbis), so it stays as it is
+			assets.push_back(SyntheticAsset{ "audio_" + toString(i), AssetType::AudioClip, makeBinary(rng, 1536 * 1024, false) });
+		}
+		for (int i = 0; i < 200; ++i) {
+			assets.push_back(SyntheticAsset{ "config_" + toString(i), AssetType::ConfigFile, makeConfig(rng, 20) });
+		}
+		for (int i = 0; i < 4; ++i) {
+			assets.push_back(SyntheticAsset{ "font_" + toString(i), AssetType::Font, makeBinary(rng, 1024 * 1024, true) });
+		}
+		return assets;
+	}
+
+	void writeFileSystem(const Vector<SyntheticAsset>& assets, const Path& dir)
+	{
+		AssetDatabase db;
+		for (auto& asset: assets) {
+			const String fileName = toString(asset.type) + "_" + asset.name + ".dat";
+			Path::writeFile(dir / fileName, asset.data);
+			db.addAsset(asset.name, asset.type, AssetDatabase::Entry(fileName, Metadata()));
+		}
+		Path::writeFile(dir / "assets.db", db.toBytes());
+	}
+
+	void writePack(const Vector<SyntheticAsset>& assets, const Path& path, const String& encryptionKey)
+	{
+		AssetPack pack;
+		for (auto& asset: assets) {
+			pack.addAsset(asset.name, asset.type, gsl::as_bytes(gsl::span<const Byte>(asset.data)), Metadata(), encryptionKey);
+		}
+		Path::writeFile(path, pack.writeOut());
+	}
+}
+
+// Harness
+
+namespace {
+	enum class Provider
+	{
+		FileSystem,
+		Pack,
+		Mapped
+	};
+
+	struct RunConfig
+	{
+		Provider provider;
+		bool encrypted;
+		bool async;
+	};
+
+	struct StageTotals
+	{
+		std::atomic<int64_t> io{ 0 };
+		std::atomic<int64_t> unpack{ 0 };
+		std::atomic<int64_t> decode{ 0 };
+		std::atomic<size_t> bytes{ 0 };
+	};
+
+	const char* encryptionKey = "benchmarkkey0123";
+	std::atomic<size_t> sink{ 0 }; // Keeps decoding from being optimised away
+	bool firstResult = true;
+
+	String getProviderName(Provider provider)
+	{
+		switch (provider) {
+		case Provider::FileSystem:
+			return "filesystem";
+		case Provider::Pack:
+			return "pack";
+		case Provider::Mapped:
+			return "mmap";
+		default:
+			return "unknown";
+		}
+	}
+
+	std::unique_ptr<ResourceLocator> makeLocator(SystemAPI& system, const Path& dataDir, const RunConfig& config)
+	{
+		auto locator = std::make_unique<ResourceLocator>(system);
+		const auto packPath = dataDir / (config.encrypted ? "encrypted.dat" : "plain.dat");
+		const String key = config.encrypted ? encryptionKey : "";
+		switch (config.provider) {
+		case Provider::FileSystem:
+			locator->addFileSystem(dataDir / "files");
+			break;
+		case Provider::Pack:
+			locator->add(std::make_unique<ReaderPackProvider>(system.getDataReader(packPath.string()), key));
+			break;
+		case Provider::Mapped:
+			locator->addPack(packPath, key);
+			break;
+		}
+		return locator;
+	}
+
+	// Reads, unpacks and decodes one asset, adding how long each took to totals
+	void loadAsset(ResourceLocator& locator, const SyntheticAsset& asset, StageTotals& totals)
+	{
+		ResourceLoadTiming timing;
+		auto data = timing.read(locator, asset.name, asset.type);
+		timing.inflate(*data);
+
+		const auto decodeStart = Profiler::getTimeNs();
+		if (asset.type == AssetType::Image) {
+			Image image(data->getSpan());
+			sink += size_t(image.getSize().x);
+		} else if (asset.type == AssetType::ConfigFile || asset.type == AssetType::SpriteSheet) {
+			ConfigFile config;
+			Deserializer::fromBytes(config, data->getSpan());
+			sink += config.getRoot().asSequence().size();
+		} else {
+			// Audio and fonts are decoded by their own systems later, so only reading them counts here
+			sink += size_t(data->getSize());
+		}
+		timing.decode += Profiler::getTimeNs() - decodeStart;
+
+		totals.io += timing.io.load();
+		totals.unpack += timing.unpack.load();
+		totals.decode += timing.decode.load();
+		totals.bytes += data->getSize();
+	}
+
+	void loadAll(ResourceLocator& locator, const Vector<SyntheticAsset>& assets, bool async, StageTotals& totals)
+	{
+		if (async) {
+			Vector<Future<void>> futures;
+			for (auto& asset: assets) {
+				futures.push_back(Concurrent::execute(Executors::getCPUAux(), [&locator, &asset, &totals] ()
+				{
+					loadAsset(locator, asset, totals);
+				}));
+			}
+			for (auto& future: futures) {
+				future.wait();
+			}
+		} else {
+			for (auto& asset: assets) {
+				loadAsset(locator, asset, totals);
+			}
+		}
+	}
+
+	// Stage times are summed over every asset, so with async loads they can add up to more than the wall time
+	void report(const RunConfig& config, const String& pass, int64_t openNs, int64_t totalNs, const StageTotals& totals)
+	{
+		const double seconds = double(totalNs) * 1e-9;
+		const double megabytes = double(totals.bytes.load()) / (1024.0 * 1024.0);
+		std::cout << (firstResult ? "" : ",\n") << "\t{ \"provider\": \"" << getProviderName(config.provider) << "\", \"encrypted\": " << (config.encrypted ? "true" : "false")
+			<< ", \"mode\": \"" << (config.async ? "async" : "serial") << "\", \"pass\": \"" << pass << "\""
+			<< ", \"open_ms\": " << double(openNs) * 1e-6 << ", \"total_ms\": " << double(totalNs) * 1e-6
+			<< ", \"mb_per_second\": " << (seconds > 0 ? megabytes / seconds : 0.0)
+			<< ", \"io_ms\": " << double(totals.io.load()) * 1e-6 << ", \"unpack_ms\": " << double(totals.unpack.load()) * 1e-6
+			<< ", \"decode_ms\": " << double(totals.decode.load()) * 1e-6 << " }";
+		firstResult = false;
+	}
+
+	// Cold is the first pass through freshly opened providers; warm is a second pass through the same ones. The OS file
+	// cache isn't dropped between runs, so for cold storage numbers, flush it before running (e.g. drop_caches on Linux).
+	void bench(SystemAPI& system, const Path& dataDir, const Vector<SyntheticAsset>& assets, const RunConfig& config)
+	{
+		const auto openStart = Profiler::getTimeNs();
+		auto locator = makeLocator(system, dataDir, config);
+		const auto openNs = Profiler::getTimeNs() - openStart;
+
+		for (const char* pass: { "cold", "warm" }) {
+			StageTotals totals;
+			const auto start = Profiler::getTimeNs();
+			loadAll(*locator, assets, config.async, totals);
+			report(config, pass, openNs, Profiler::getTimeNs() - start, totals);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Executors executors;
+	Executors::set(executors);
+	auto makeThread = [] (String, std::function<void()> runnable)
+	{
+		return std::thread(runnable);
+	};
+	ThreadPool cpuThreadPool("CPU", executors.getCPU(), std::thread::hardware_concurrency(), makeThread);
+	ThreadPool cpuAuxThreadPool("CPUAux", executors.getCPUAux(), std::thread::hardware_concurrency(), makeThread);
+
+	const Path dataDir = argc > 1 ? Path(argv[1]) : Path("resource_benchmark_data");
+	FileSystemAPI system;
+
+	const auto assets = makeAssetSet();
+	size_t totalSize = 0;
+	for (auto& asset: assets) {
+		totalSize += asset.data.size();
+	}
+
+	OS::get().createDirectories(dataDir / "files");
+	std::cerr << "Writing " << assets.size() << " assets (" << (totalSize / 1024) << " kB) to " << dataDir.string() << std::endl;
+	writeFileSystem(assets, dataDir / "files");
+	writePack(assets, dataDir / "plain.dat", "");
+	writePack(assets, dataDir / "encrypted.dat", encryptionKey);
+
+	std::cout << "[\n";
+	for (bool async: { false, true }) {
+		bench(system, dataDir, assets, RunConfig{ Provider::FileSystem, false, async });
+		for (auto provider: { Provider::Pack, Provider::Mapped }) {
+			for (bool encrypted: { false, true }) {
+				bench(system, dataDir, assets, RunConfig{ provider, encrypted, async });
+			}
+		}
+	}
+	std::cout << "\n]" << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,180 @@
+#include <halley/data_structures/hash_map.h>
+#include <halley/time/stopwatch.h>
+#include <halley/text/halleystring.h>
+#include <halley/text/string_converter.h>
+#include <unordered_map>
+#include <iostream>
+#include <random>
+#include <limits>
+#include <algorithm>
+
+#if HAS_EASTL
+#include <EASTL/hash_map.h>
+#endif
+
+using namespace Halley;
+
+// Compares FlatHashMap, which is what HashMap uses, against the node-based maps it replaced
+
+namespace {
+	bool firstResult = true;
+	volatile size_t sink = 0;
+	constexpr int repeatedRuns = 5;
+
+	void report(const String& name, const String& map, size_t elements, int64_t ns, size_t operations)
+	{
+		std::cout << (firstResult ? "" : ",\n") << "\t{ \"name\": \"" << name << "\", \"map\": \"" << map << "\", \"elements\": " << elements
+			<< ", \"total_ns\": " << ns << ", \"ns_per_op\": " << (operations > 0 ? double(ns) / double(operations) : 0.0) << " }";
+		firstResult = false;
+	}
+
+	// Returns the fastest of the runs, which is the least affected by noise
+	template <typename F>
+	int64_t measure(F f, int runs = 1)
+	{
+		int64_t best = std::numeric_limits<int64_t>::max();
+		for (int i = 0; i < runs; ++i) {
+			Stopwatch timer;
+			f();
+			timer.pause();
+			best = std::min(best, timer.elapsedNanoSeconds());
+		}
+		return best;
+	}
+
+	// Shuffled, so that neither insertion nor lookups happen in hash order
+	Vector<uint64_t> makeIntKeys(size_t n, uint64_t seed)
+	{
+		Vector<uint64_t> keys(n);
+		for (size_t i = 0; i < n; ++i) {
+			keys[i] = i * 7919 + seed;
+		}
+		std::shuffle(keys.begin(), keys.end(), std::mt19937_64(seed));
+		return keys;
+	}
+
+	// Looks like asset names, which share long prefixes
+	Vector<String> makeStringKeys(size_t n, uint64_t seed)
+	{
+		Vector<String> keys(n);
+		for (size_t i = 0; i < n; ++i) {
+			keys[i] = "assets/sprites/characters/" + toString(i * 7919 + seed) + ".png";
+		}
+		std::shuffle(keys.begin(), keys.end(), std::mt19937_64(seed));
+		return keys;
+	}
+
+	template <typename Map, typename Key>
+	void benchMap(const String& mapName, const Vector<Key>& keys, const Vector<Key>& missing, const String& keyName)
+	{
+		const size_t n = keys.size();
+
+		report("insert_" + keyName, mapName, n, measure([&] () {
+			Map map;
+			for (size_t i = 0; i < n; ++i) {
+				map[keys[i]] = i;
+			}
+			sink = map.size();
+		}, repeatedRuns), n);
+
+		Map map;
+		for (size_t i = 0; i < n; ++i) {
+			map[keys[i]] = i;
+		}
+
+		report("find_hit_" + keyName, mapName, n, measure([&] () {
+			size_t total = 0;
+			for (auto& k: keys) {
+				total += map.find(k)->second;
+			}
+			sink = total;
+		}, repeatedRuns), n);
+
+		report("find_miss_" + keyName, mapName, n, measure([&] () {
+			size_t total = 0;
+			for (auto& k: missing) {
+				total += map.find(k) == map.end() ? 1 : 0;
+			}
+			sink = total;
+		}, repeatedRuns), n);
+
+		report("iterate_" + keyName, mapName, n, measure([&] () {
+			size_t total = 0;
+			for (auto& kv: map) {
+				total += kv.second;
+			}
+			sink = total;
+		}, repeatedRuns), n);
+
+		report("erase_insert_" + keyName, mapName, n, measure([&] () {
+			// Churn, as in caches: every element is removed and put back
+			for (size_t i = 0; i < n; ++i) {
+				map.erase(keys[i]);
+				map[keys[i]] = i;
+			}
+			sink = map.size();
+		}), n * 2);
+	}
+
+	template <typename Key>
+	void benchAll(const Vector<Key>& keys, const Vector<Key>& missing, const String& keyName)
+	{
+		benchMap<FlatHashMap<Key, size_t>>("flat_hash_map", keys, missing, keyName);
+		benchMap<std::unordered_map<Key, size_t>>("std_unordered_map", keys, missing, keyName);
+#if HAS_EASTL
+		benchMap<eastl::hash_map<Key, size_t, std::hash<Key>>>("eastl_hash_map", keys, missing, keyName);
+#endif
+	}
+
+	// Heterogeneous lookup saves building a String from a literal for every query
+	void benchStringLiteralLookup(const Vector<String>& keys)
+	{
+		const size_t n = keys.size();
+		Vector<std::string> literals;
+		for (auto& k: keys) {
+			literals.push_back(k.cppStr());
+		}
+
+		FlatHashMap<String, size_t> flat;
+		std::unordered_map<String, size_t> stdMap;
+		for (size_t i = 0; i < n; ++i) {
+			flat[keys[i]] = i;
+			stdMap[keys[i]] = i;
+		}
+
+		report("find_const_char", "flat_hash_map", n, measure([&] () {
+			size_t total = 0;
+			for (auto& l: literals) {
+				total += flat.find(l.c_str())->second;
+			}
+			sink = total;
+		}, repeatedRuns), n);
+
+		report("find_const_char", "std_unordered_map", n, measure([&] () {
+			size_t total = 0;
+			for (auto& l: literals) {
+				total += stdMap.find(String(l.c_str()))->second;
+			}
+			sink = total;
+		}, repeatedRuns), n);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Vector<size_t> sizes = { 100, 10000, 1000000 };
+	if (argc > 1) {
+		sizes = { size_t(String(argv[1]).toInteger()) };
+	}
+
+	std::cout << "{\n\"results\": [\n";
+	for (auto n: sizes) {
+		benchAll(makeIntKeys(n, 1), makeIntKeys(n, 2), "int");
+		const auto stringKeys = makeStringKeys(n, 1);
+		benchAll(stringKeys, makeStringKeys(n, 2), "string");
+		benchStringLiteralLookup(stringKeys);
+	}
+	std::cout << "\n]\n}\n";
+
+	return 0;
+}
@@ -11,13 +11,12 @@ ConsoleWindow::ConsoleWindow(Resources& resources)
 	background = Sprite()
 		.setImage(resources, "round_rect.png", "Halley/DistanceFieldSprite")
 		.setColour(Colour4f(0.0f, 0.0f, 0.0f, 0.4f))
-		.setPivot(Vector2f(0, 0));
+		.setPivot(Vector2f(0, 0))
+		.setCustom0(Vector2f(1.0f / 16.0f, 0.5f))
+		.setCustom1(Vector4f(0.47f, 0.47f, 0.47f, 1.0f));
 
 	background.getMaterial()
-		.set("tex0", resources.get<Texture>("round_rect.png"))
-		.set("u_smoothness", 1.0f / 16.0f)
-		.set("u_outline", 0.5f)
-		.set("u_outlineColour", Colour(0.47f, 0.47f, 0.47f));
+		.set("tex0", resources.get<Texture>("round_rect.png"));
 
 	font = resources.get<Font>("Inconsolata Medium");
 
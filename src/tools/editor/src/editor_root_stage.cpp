@@ -7,6 +7,9 @@
 #include "preferences.h"
 #include "ui/editor_ui_factory.h"
 #include "halley/tools/project/project.h"
+#include "halley/tools/assets/import_worker_pool.h"
+#include "halley/tools/file/filesystem.h"
+#include <thread>
 
 using namespace Halley;
 
@@ -102,11 +105,9 @@ void EditorRootStage::initSprites()
 			.setPivot(Vector2f(0.5f, 0.5f))
 			.setColour(col)
 			.setScale(Vector2f(8, 8))
-			.setPos(Vector2f(640, 360));
-		halleyLogo.getMaterial()
-			.set("u_smoothness", 0.125f)
-			.set("u_outline", 0.0f)
-			.set("u_outlineColour", col);
+			.setPos(Vector2f(640, 360))
+			.setCustom0(Vector2f(0.125f, 0.0f))
+			.setCustom1(Vector4f(col.r, col.g, col.b, col.a));
 	}
 }
 
@@ -169,6 +170,15 @@ void EditorRootStage::updateUI(Time time)
 void EditorRootStage::loadProject()
 {
 	project->setDevConServer(devConServer.get());
+
+	const auto halleyCmd = editor.getHalleyCmdPath();
+	if (FileSystem::exists(halleyCmd)) {
+		auto workerPool = std::make_shared<ImportWorkerPool>(halleyCmd, *project, std::thread::hardware_concurrency());
+		project->setImportWorkerPool(workerPool);
+		tasks->setImportWorkerPool(workerPool);
+	} else {
+		Logger::logWarning("halley-cmd not found at " + halleyCmd.getString() + ", importing in the editor process.");
+	}
 	tasks->addTask(EditorTaskAnchor(std::make_unique<CheckAssetsTask>(*project, false)));
 
 	console = std::make_unique<ConsoleWindow>(getResources());
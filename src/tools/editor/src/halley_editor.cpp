@@ -73,9 +73,19 @@ Preferences& HalleyEditor::getPreferences()
 	return *preferences;
 }
 
+Path HalleyEditor::getHalleyCmdPath() const
+{
+#ifdef _WIN32
+	return programPath / "halley-cmd.exe";
+#else
+	return programPath / "halley-cmd";
+#endif
+}
+
 void HalleyEditor::init(const Environment& environment, const Vector<String>& args)
 {
-	rootPath = environment.getProgramPath().parentPath();
+	programPath = environment.getProgramPath();
+	rootPath = programPath.parentPath();
 
 	parseArguments(args);
 }
@@ -19,6 +19,7 @@ namespace Halley
 		std::unique_ptr<Project> createProject(Path path);
 
 		Preferences& getPreferences();
+		Path getHalleyCmdPath() const;
 
 	protected:
 		void init(const Environment& environment, const Vector<String>& args) override;
@@ -35,6 +36,7 @@ namespace Halley
 		std::unique_ptr<ProjectLoader> projectLoader;
 		std::unique_ptr<Preferences> preferences;
 		Path rootPath;
+		Path programPath;
 
 		std::vector<String> platforms;
 		String projectPath;
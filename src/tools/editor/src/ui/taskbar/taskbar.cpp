@@ -11,11 +11,9 @@ TaskBar::TaskBar(Resources& resources)
 			.setImage(resources, "halley/halley_logo_dist.png", "Halley/DistanceFieldSprite")
 			.setPivot(Vector2f(0.5f, 0.5f))
 			.setScale(Vector2f(0.5f, 0.5f))
-			.setColour(col);
-		halleyLogo.getMaterial()
-			.set("u_smoothness", 1.0f / 8.0f)
-			.set("u_outline", 0.0f)
-			.set("u_outlineColour", col);
+			.setColour(col)
+			.setCustom0(Vector2f(1.0f / 8.0f, 0.0f))
+			.setCustom1(Vector4f(col.r, col.g, col.b, col.a));
 	}
 
 	{
@@ -97,12 +95,9 @@ void TaskBar::draw(Painter& painter)
 			.setImage(resources, "round_rect.png", "Halley/DistanceFieldSprite")
 			.setPos(drawPos + Vector2f(6.0f, 6.0f))
 			.scaleTo(size + Vector2f(12, 12))
-			.setPivot(Vector2f(0, 0));
-
-		sprite.getMaterial()
-			.set("u_smoothness", 1.0f / 16.0f)
-			.set("u_outline", 0.4f)
-			.set("u_outlineColour", col);
+			.setPivot(Vector2f(0, 0))
+			.setCustom0(Vector2f(1.0f / 16.0f, 0.4f))
+			.setCustom1(Vector4f(col.r, col.g, col.b, col.a));
 
 		// Background
 		sprite
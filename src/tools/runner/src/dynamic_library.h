@@ -22,6 +22,8 @@ namespace Halley
 
 		void* getFunction(std::string name) const;
 		void* getBaseAddress() const;
+		const boost::filesystem::path& getOriginalPath() const { return libOrigPath; }
+		const boost::filesystem::path& getLoadedPath() const { return libPath; }
 
 		bool hasChanged() const;
 
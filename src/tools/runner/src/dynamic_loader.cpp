@@ -76,7 +76,7 @@ void DynamicGameLoader::load()
 	}
 
 	prevSymbols = std::move(symbols);
-	symbols = SymbolLoader::loadSymbols(lib);
+	symbols = symbolLoader.loadSymbols(lib);
 
 	entry = getHalleyEntry();
 }
@@ -30,6 +30,7 @@ namespace Halley
 
 		Vector<DebugSymbol> symbols;
 		Vector<DebugSymbol> prevSymbols;
+		SymbolLoader symbolLoader;
 		
 		void load();
 		void unload();
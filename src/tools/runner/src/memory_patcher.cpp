@@ -2,8 +2,10 @@
 #include <iostream>
 #include <unordered_map>
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <functional>
+#include <thread>
 #include <gsl/gsl_assert>
 
 using namespace Halley;
@@ -16,28 +18,25 @@ void MemoryPatchingMappings::generate(const Vector<DebugSymbol>& prev, const Vec
 	{
 		void* from = nullptr;
 		void* to = nullptr;
-		std::string name;
+		const DebugSymbol* symbol = nullptr;
 	};
 
-	// Construct mapping
-	std::unordered_map<std::string, Mapping> mapping;
+	// Index the previous symbols by name, then look each new one up; symbols that didn't move need no mapping
+	std::unordered_map<std::string, void*> prevByName;
+	prevByName.reserve(prev.size());
 	for (const auto& p: prev) {
-		mapping[p.getName()].from = p.getAddress();
-	}
-	for (const auto& n: next) {
-		mapping[n.getName()].to = n.getAddress();
+		prevByName[p.getName()] = p.getAddress();
 	}
 
-	// Flatten
 	Vector<Mapping> flatMap;
-	for (auto& kv: mapping) {
-		const auto& m = kv.second;
-		if (m.from != nullptr && m.from != m.to) {
-			flatMap.push_back(m);
-			flatMap.back().name = kv.first;
+	flatMap.reserve(std::min(prev.size(), next.size()));
+	for (const auto& n: next) {
+		const auto iter = prevByName.find(n.getName());
+		if (iter != prevByName.end() && iter->second != nullptr && iter->second != n.getAddress()) {
+			flatMap.push_back(Mapping{ iter->second, n.getAddress(), &n });
 		}
 	}
-	mapping.clear();
+	prevByName.clear();
 
 	// Sort by from address
 	std::sort(flatMap.begin(), flatMap.end(), [](const Mapping& a, const Mapping& b) -> bool { return a.from < b.from; });
@@ -45,12 +44,16 @@ void MemoryPatchingMappings::generate(const Vector<DebugSymbol>& prev, const Vec
 	// Copy to src and dst arrays
 	minSrc = reinterpret_cast<void*>(-1);
 	maxSrc = nullptr;
+	src.reserve(flatMap.size());
+	dst.reserve(flatMap.size());
 	for (const auto& m: flatMap) {
 		minSrc = std::min(minSrc, m.from);
 		maxSrc = std::max(maxSrc, m.from);
 		src.push_back(m.from);
 		dst.push_back(m.to);
-		name.push_back(m.name);
+		#ifdef VERBOSE_MAPPING
+		name.push_back(m.symbol->getName());
+		#endif
 	}
 
 	std::cout << "Generated " << src.size() << " memory re-mappings. From " << prev.size() << " to " << next.size() << " symbols, on " << minSrc << " to " << maxSrc << " range." << std::endl;
@@ -66,32 +69,39 @@ void MemoryPatchingMappings::generate(const Vector<DebugSymbol>& prev, const Vec
 #include <Windows.h>
 #include <DbgHelp.h>
 
-static size_t scanProcessMemory(const MemoryPatchingMappings& mappings, std::function<size_t(void*, size_t, const MemoryPatchingMappings&)> patchMemory)
+static Vector<std::pair<char*, size_t>> findRegionsToPatch()
 {
-	size_t patchings = 0;
+	// Objects pointing at the old vtables live on the heap and stacks (private memory) and in the runner's own statics.
+	// Other modules' images and mapped files can't reference the game module's vtables, and the new game module starts
+	// out pointing at its own, so those are skipped.
+	const auto mainModule = reinterpret_cast<void*>(GetModuleHandle(nullptr));
+
+	Vector<std::pair<char*, size_t>> regions;
 	size_t totalMemory = 0;
 
 	MEMORY_BASIC_INFORMATION membasic;
 	for (char* address = 0; VirtualQuery(address, &membasic, sizeof(membasic)); address += membasic.RegionSize) {
 		if (membasic.State == MEM_COMMIT) {
 			constexpr unsigned int acceptMask = 0x04 | 0x08 | 0x40 | 0x80;
-			if ((membasic.Protect & acceptMask) == membasic.Protect) {
-				patchings += patchMemory(address, membasic.RegionSize, mappings);
+			const bool writable = (membasic.Protect & acceptMask) == membasic.Protect;
+			const bool relevant = membasic.Type == MEM_PRIVATE || (membasic.Type == MEM_IMAGE && membasic.AllocationBase == mainModule);
+			if (writable && relevant) {
+				regions.emplace_back(address, membasic.RegionSize);
 				totalMemory += membasic.RegionSize;
 			}
 		}
 	}
 
-	std::cout << "Total memory scanned: " << totalMemory << std::endl;
-	return patchings;
+	std::cout << "Total memory to scan: " << totalMemory << " in " << regions.size() << " regions." << std::endl;
+	return regions;
 }
 
 #else
 
-static size_t scanProcessMemory(const MemoryPatchingMappings&, std::function<size_t(void*, size_t, const MemoryPatchingMappings&)>)
+static Vector<std::pair<char*, size_t>> findRegionsToPatch()
 {
 	// TODO
-	return 0;
+	return {};
 }
 
 #endif
@@ -101,11 +111,40 @@ void MemoryPatcher::patch(const MemoryPatchingMappings& mappings)
 	if (mappings.src.size() == 0) {
 		std::cout << "Nothing to patch." << std::endl;
 	} else {
-		size_t n = scanProcessMemory(mappings, &patchMemory);
+		const auto regions = findRegionsToPatch();
+		size_t n = patchRegions(regions, mappings);
 		std::cout << "Patched " << n << " pointers." << std::endl;
 	}
 }
 
+size_t MemoryPatcher::patchRegions(const Vector<std::pair<char*, size_t>>& regions, const MemoryPatchingMappings& mappings)
+{
+	// Regions are independent, so split them over all cores. Nothing else should be running while the game is suspended.
+	const size_t nThreads = std::max(size_t(1), std::min(size_t(std::thread::hardware_concurrency()), regions.size()));
+	std::atomic<size_t> nextRegion(0);
+	std::atomic<size_t> patchings(0);
+
+	auto run = [&] ()
+	{
+		size_t count = 0;
+		for (size_t i = nextRegion++; i < regions.size(); i = nextRegion++) {
+			count += patchMemory(regions[i].first, regions[i].second, mappings);
+		}
+		patchings += count;
+	};
+
+	Vector<std::thread> threads;
+	for (size_t i = 1; i < nThreads; ++i) {
+		threads.emplace_back(run);
+	}
+	run();
+	for (auto& t: threads) {
+		t.join();
+	}
+
+	return patchings;
+}
+
 size_t MemoryPatcher::patchMemory(void* address, size_t len, const MemoryPatchingMappings& mappings)
 {
 	size_t count = 0;
@@ -7,9 +7,10 @@ namespace Halley
 	class MemoryPatchingMappings
 	{
 	public:
+		// Sorted by src. Kept as flat arrays (rather than a hash map) so the patcher can tell their storage apart from the memory it's patching.
 		Vector<void*> src;
 		Vector<void*> dst;
-		Vector<std::string> name;
+		Vector<std::string> name; // Only filled with VERBOSE_MAPPING
 		void* minSrc;
 		void* maxSrc;
 
@@ -23,5 +24,6 @@ namespace Halley
 
 	private:
 		static size_t patchMemory(void* address, size_t len, const MemoryPatchingMappings& mappings);
+		static size_t patchRegions(const Vector<std::pair<char*, size_t>>& regions, const MemoryPatchingMappings& mappings);
 	};
 }
@@ -1,6 +1,10 @@
 #include "symbol_loader.h"
 #include <halley/support/exception.h>
 #include "dynamic_library.h"
+#include <halley/bytes/byte_serializer.h>
+#include <halley/utils/hash.h>
+#include <boost/filesystem.hpp>
+#include <iostream>
 #include <sstream>
 
 using namespace Halley;
@@ -29,20 +33,24 @@ static void loadSymbolsImpl(DynamicLibrary& dll, Vector<DebugSymbol>& vector)
 {
 	DWORD options = SymGetOptions();
 	options &= ~SYMOPT_DEFERRED_LOADS;
-	options |= SYMOPT_LOAD_LINES;
+	options &= ~SYMOPT_LOAD_LINES;
 	options |= SYMOPT_IGNORE_NT_SYMPATH;
-	options |= SYMOPT_DEBUG;
 	options |= SYMOPT_UNDNAME;
 	SymSetOptions(options);
 
+	// Don't invade the process, that would load the symbols of every module in it; we only want the game's
 	HANDLE hProcess = GetCurrentProcess();
-	if(!SymInitialize(hProcess, nullptr, true)) {
+	if (!SymInitialize(hProcess, nullptr, FALSE)) {
 		throw Exception("Unable to initialize Symbol loading", HalleyExceptions::Core);
 	}
 
-	long long baseAddr = long long(dll.getBaseAddress());
+	const auto baseAddr = DWORD64(dll.getBaseAddress());
+	if (!SymLoadModuleEx(hProcess, nullptr, dll.getLoadedPath().string().c_str(), nullptr, baseAddr, 0, nullptr, 0)) {
+		SymCleanup(hProcess);
+		throw Exception("Unable to load symbols for " + dll.getLoadedPath().string(), HalleyExceptions::Core);
+	}
 
-	SymEnumSymbols(hProcess, baseAddr, "*", loadSymbolsCallback, &vector);
+	SymEnumSymbols(hProcess, baseAddr, "*table*", loadSymbolsCallback, &vector);
 
 	SymCleanup(hProcess);
 }
@@ -76,7 +84,57 @@ void DebugSymbol::appendToName(size_t id)
 	name += ss.str();
 }
 
+void DebugSymbol::rebase(void* from, void* to)
+{
+	address = ((address ^ mask) - size_t(from) + size_t(to)) ^ mask;
+}
+
+void DebugSymbol::serialize(Serializer& s) const
+{
+	s << name;
+	s << uint64_t(address ^ mask);
+	s << uint64_t(size);
+}
+
+void DebugSymbol::deserialize(Deserializer& s)
+{
+	uint64_t addr;
+	uint64_t sz;
+	s >> name;
+	s >> addr;
+	s >> sz;
+	address = size_t(addr) ^ mask;
+	size = size_t(sz);
+}
+
 Vector<DebugSymbol> SymbolLoader::loadSymbols(DynamicLibrary& dll)
+{
+	void* base = dll.getBaseAddress();
+	const uint64_t hash = Hash::hash(Path::readFile(Path(dll.getLoadedPath().string())));
+
+	const auto iter = cache.find(hash);
+	if (iter != cache.end()) {
+		std::cout << "Using cached symbols." << std::endl;
+		return rebased(iter->second, nullptr, base);
+	}
+
+	auto cachePath = dll.getOriginalPath();
+	cachePath.replace_extension("symcache");
+	auto fromFile = readCacheFile(Path(cachePath.string()), hash);
+	if (fromFile) {
+		std::cout << "Using symbols from " << cachePath.string() << std::endl;
+		cache[hash] = fromFile.get();
+		return rebased(fromFile.get(), nullptr, base);
+	}
+
+	auto results = enumerateSymbols(dll);
+	auto relative = rebased(results, base, nullptr);
+	writeCacheFile(Path(cachePath.string()), hash, relative);
+	cache[hash] = std::move(relative);
+	return results;
+}
+
+Vector<DebugSymbol> SymbolLoader::enumerateSymbols(DynamicLibrary& dll)
 {
 	Vector<DebugSymbol> results;
 	loadSymbolsImpl(dll, results);
@@ -115,3 +173,63 @@ Vector<DebugSymbol> SymbolLoader::loadSymbols(DynamicLibrary& dll)
 
 	return results;
 }
+
+Vector<DebugSymbol> SymbolLoader::rebased(const Vector<DebugSymbol>& symbols, void* from, void* to)
+{
+	Vector<DebugSymbol> result = symbols;
+	for (auto& s: result) {
+		s.rebase(from, to);
+	}
+	return result;
+}
+
+namespace {
+	constexpr int symCacheVersion = 1;
+}
+
+Maybe<Vector<DebugSymbol>> SymbolLoader::readCacheFile(const Path& path, uint64_t hash)
+{
+	try {
+		const auto bytes = Path::readFile(path);
+		if (bytes.empty()) {
+			return {};
+		}
+
+		Deserializer s(bytes);
+		int version;
+		uint64_t fileHash;
+		s >> version;
+		s >> fileHash;
+		if (version != symCacheVersion || fileHash != hash) {
+			return {};
+		}
+
+		uint32_t n;
+		s >> n;
+		Vector<DebugSymbol> result(n);
+		for (auto& symbol: result) {
+			s >> symbol;
+		}
+		return result;
+	} catch (...) {
+		// Unreadable or truncated, just enumerate again
+		return {};
+	}
+}
+
+void SymbolLoader::writeCacheFile(const Path& path, uint64_t hash, const Vector<DebugSymbol>& symbols)
+{
+	try {
+		Path::writeFile(path, Serializer::toBytes([&] (Serializer& s)
+		{
+			s << symCacheVersion;
+			s << hash;
+			s << uint32_t(symbols.size());
+			for (auto& symbol: symbols) {
+				s << symbol;
+			}
+		}));
+	} catch (std::exception& e) {
+		std::cout << "Unable to write symbol cache " << path.string() << ": " << e.what() << std::endl;
+	}
+}
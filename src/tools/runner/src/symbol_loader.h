@@ -1,28 +1,48 @@
 #pragma once
 #include <halley/text/halleystring.h>
+#include <halley/file/path.h>
+#include <halley/data_structures/maybe.h>
+#include <unordered_map>
 
 namespace Halley
 {
 	class DynamicLibrary;
+	class Serializer;
+	class Deserializer;
 
 	class DebugSymbol
 	{
 	public:
+		DebugSymbol() = default;
 		DebugSymbol(std::string name, void* address, size_t size);
 		std::string getName() const { return name; }
 		void* getAddress() const;
 		size_t getSize() const { return size; }
 		void appendToName(size_t id);
+		void rebase(void* from, void* to);
+
+		void serialize(Serializer& s) const;
+		void deserialize(Deserializer& s);
 
 	private:
 		std::string name;
-		size_t address;
-		size_t size;
+		size_t address = 0;
+		size_t size = 0;
 	};
 
+	// Symbol tables are cached by the hash of the module's contents, with addresses relative to the module base,
+	// both in memory and next to the module (as .symcache), so a module that was already seen doesn't go through DbgHelp again.
 	class SymbolLoader
 	{
 	public:
-		static Vector<DebugSymbol> loadSymbols(DynamicLibrary& dll);
+		Vector<DebugSymbol> loadSymbols(DynamicLibrary& dll);
+
+	private:
+		std::unordered_map<uint64_t, Vector<DebugSymbol>> cache;
+
+		static Vector<DebugSymbol> enumerateSymbols(DynamicLibrary& dll);
+		static Vector<DebugSymbol> rebased(const Vector<DebugSymbol>& symbols, void* from, void* to);
+		static Maybe<Vector<DebugSymbol>> readCacheFile(const Path& path, uint64_t hash);
+		static void writeCacheFile(const Path& path, uint64_t hash, const Vector<DebugSymbol>& symbols);
 	};
 }
@@ -91,6 +91,7 @@ namespace Halley
 		virtual ~IAssetImporter() {}
 
 		virtual ImportAssetType getType() const { return ImportAssetType::Skip; }
+		virtual int getVersion() const { return 0; } // Bump whenever the same input would now be imported differently, to invalidate cached imports
 		virtual void import(const ImportingAsset&, IAssetCollector&) {}
 		virtual int dropFrontCount() const { return 1; }
 
@@ -2,12 +2,14 @@
 #include "halley/plugin/iasset_importer.h"
 
 namespace Halley {
+	class FileSystemCache;
+
 	class AssetCollector final : public IAssetCollector
 	{
 	public:
 		using ProgressReporter = std::function<bool(float, const String&)>;
 
-		AssetCollector(const ImportingAsset& asset, const Path& dstDir, const std::vector<Path>& assetsSrc, ProgressReporter reporter);
+		AssetCollector(const ImportingAsset& asset, const Path& dstDir, const std::vector<Path>& assetsSrc, const FileSystemCache& fileSystem, ProgressReporter reporter);
 
 		void output(const String& name, AssetType type, const Bytes& data, Maybe<Metadata> metadata, const String& platform) override;
 
@@ -25,6 +27,7 @@ namespace Halley {
 		const ImportingAsset& asset;
 		Path dstDir;
 		std::vector<Path> assetsSrc;
+		const FileSystemCache& fileSystem;
 		ProgressReporter reporter;
 
 		std::vector<AssetResource> assets;
@@ -15,9 +15,11 @@ namespace Halley
 		IAssetImporter& getRootImporter(Path path) const;
 		std::vector<std::reference_wrapper<IAssetImporter>> getImporters(ImportAssetType type) const;
 		const std::vector<Path>& getAssetsSrc() const;
+		uint64_t getVersionHash() const; // Changes whenever any importer's version does
 
 	private:
 		std::map<ImportAssetType, std::vector<std::unique_ptr<IAssetImporter>>> importers;
 		std::vector<Path> assetsSrc;
+		uint64_t versionHash = 0;
 	};
 }
@@ -2,6 +2,7 @@
 #include "../tasks/editor_task.h"
 #include "import_assets_database.h"
 #include "halley/file/directory_monitor.h"
+#include <set>
 
 namespace Halley
 {
@@ -16,17 +17,55 @@ namespace Halley
 		void run() override;
 
 	private:
+		struct InputLocation
+		{
+			String assetId;
+			Path filePath; // Relative to its source directory
+		};
+
+		// Results of the last scan, so that only files reported as changed need to be looked at again
+		struct ScanState
+		{
+			std::map<String, ImportAssetsDatabaseEntry> assets;
+			std::map<String, InputLocation> inputs; // By full path
+			std::vector<Path> directoryMetas;
+			std::vector<uint64_t> generations; // Of the source directories and then the destination, see FileSystemCache
+		};
+
+		struct InputFileInfo
+		{
+			std::array<int64_t, 3> timestamps = {{ 0, 0, 0 }};
+			Maybe<Metadata> metadata; // Only loaded if the database's copy is out of date
+		};
+
+		struct SourceChanges
+		{
+			Path srcPath;
+			DirectoryMonitor::Changes changes;
+		};
+
 		Project& project;
 		DirectoryMonitor monitorAssets;
 		DirectoryMonitor monitorAssetsSrc;
 		DirectoryMonitor monitorSharedAssetsSrc;
 		DirectoryMonitor monitorGen;
 		DirectoryMonitor monitorGenSrc;
+		ScanState assetsState;
+		ScanState codegenState;
 		bool oneShot;
 
 		static std::vector<ImportAssetsDatabaseEntry> filterNeedsImporting(ImportAssetsDatabase& db, const std::map<String, ImportAssetsDatabaseEntry>& assets);
-		void checkAllAssets(ImportAssetsDatabase& db, std::vector<Path> srcPaths, Path dstPath, String taskName, bool packAfter);
+		DirectoryMonitor::Changes pollChanges(DirectoryMonitor& monitor, const Path& root, bool first);
+		std::vector<uint64_t> getGenerations(const std::vector<Path>& srcPaths, const Path& dstPath) const;
+		bool hasChangedSinceLastScan(const ScanState& state, const std::vector<Path>& srcPaths, const Path& dstPath) const;
+		bool needsFullScan(const Path& dstPath, const DirectoryMonitor::Changes& dstChanges, const std::vector<SourceChanges>& srcChanges);
+		void checkAllAssets(ScanState& state, ImportAssetsDatabase& db, std::vector<Path> srcPaths, Path dstPath, String taskName, bool packAfter);
+		void checkChangedAssets(ScanState& state, ImportAssetsDatabase& db, const std::vector<SourceChanges>& srcChanges, Path dstPath, String taskName, bool packAfter);
+		void queueTasks(const ScanState& state, ImportAssetsDatabase& db, const std::map<String, ImportAssetsDatabaseEntry>& candidates, Path dstPath, String taskName, bool packAfter);
 		Maybe<Path> findDirectoryMeta(const std::vector<Path>& metas, const Path& path) const;
-		bool importFile(ImportAssetsDatabase& db, std::map<String, ImportAssetsDatabaseEntry>& assets, const bool isCodegen, const std::vector<Path>& directoryMetas, const Path& srcPath, const Path& filePath);
+		bool importFile(ImportAssetsDatabase& db, ScanState& state, const bool isCodegen, const Path& srcPath, const Path& filePath);
+		InputFileInfo readInputFile(const ImportAssetsDatabase& db, const std::vector<Path>& directoryMetas, const Path& srcPath, const Path& filePath) const;
+		bool addInputFile(ImportAssetsDatabase& db, ScanState& state, bool isCodegen, const Path& srcPath, const Path& filePath, const InputFileInfo& info);
+		void removeInputs(ScanState& state, const Path& srcPath, const Path& path, std::set<String>& assetsChanged);
 	};
 }
@@ -10,6 +10,7 @@
 namespace Halley
 {
 	class Project;
+	class FileSystemCache;
 	class Deserializer;
 	class Serializer;
 	
@@ -68,7 +69,9 @@ namespace Halley
 		};
 
 	public:
-		ImportAssetsDatabase(Path directory, Path dbFile, Path assetsDbFile, std::vector<String> platforms);
+		ImportAssetsDatabase(Path directory, Path dbFile, Path assetsDbFile, std::vector<String> platforms, const FileSystemCache& fileSystem);
+
+		static int getAssetVersion();
 
 		void load();
 		void save() const;
@@ -95,6 +98,7 @@ namespace Halley
 		Path directory;
 		Path dbFile;
 		Path assetsDbFile;
+		const FileSystemCache& fileSystem;
 
 		std::map<String, AssetEntry> assetsImported;
 		std::map<String, AssetEntry> assetsFailed; // Ephemeral
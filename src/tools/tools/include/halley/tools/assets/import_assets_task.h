@@ -8,11 +8,13 @@
 namespace Halley
 {
 	class Project;
+	class ImportProfiler;
 	
 	class ImportAssetsTask : public EditorTask
 	{
 	public:
 		ImportAssetsTask(String taskName, ImportAssetsDatabase& db, const AssetImporter& importer, Path assetsPath, Vector<ImportAssetsDatabaseEntry> files, std::vector<String> deletedAssets, Project& project, bool packAfter);
+		~ImportAssetsTask();
 
 	protected:
 		void run() override;
@@ -28,7 +30,7 @@ namespace Halley
 		std::vector<String> deletedAssets;
 		std::set<String> outputAssets;
 		
-		std::atomic<int64_t> totalImportTime;
+		std::unique_ptr<ImportProfiler> profiler;
 		std::atomic<size_t> assetsImported{};
 		size_t assetsToImport{};
 
@@ -37,6 +39,7 @@ namespace Halley
 		std::string curFileLabel;
 
 		bool importAsset(ImportAssetsDatabaseEntry& asset);
+		void writeProfile() const;
 
 		std::vector<Path> loadFont(const ImportAssetsDatabaseEntry& asset, Path dstDir);
 		std::vector<Path> genericImporter(const ImportAssetsDatabaseEntry& asset, Path dstDir);
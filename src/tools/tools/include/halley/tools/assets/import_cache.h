@@ -0,0 +1,55 @@
+#pragma once
+#include "halley/file/path.h"
+#include "halley/plugin/iasset_importer.h"
+#include "halley/data_structures/maybe.h"
+#include <atomic>
+#include <vector>
+
+namespace Halley
+{
+	// Results of previous imports, keyed by a hash of everything that went into them (input contents, metadata,
+	// importer versions), so that they can be restored without running the importers again, e.g. after switching
+	// branches or on a fresh checkout. Output files are stored by the hash of their contents, so identical outputs
+	// are only kept once.
+	// Everything is written atomically, so it can be used from several imports (or tools) at once.
+	//
+	// Optionally, it can also be backed by a server shared by a whole team, given as "host[:port][/prefix]". This uses
+	// the same layout as the local cache, with plain GET and PUT requests, so any HTTP server that accepts uploads
+	// (e.g. nginx with WebDAV enabled) will do. Local misses are fetched from it, and new imports are uploaded to it.
+	class ImportCache
+	{
+	public:
+		struct Result
+		{
+			std::vector<AssetResource> assets;
+			std::vector<std::pair<Path, Bytes>> outFiles;
+			std::vector<TimestampedPath> additionalInputs;
+		};
+
+		ImportCache(Path directory, Path rootPath, String server = "");
+
+		// Returns nothing if it's not cached, or if any of the additional files the importer read have changed since
+		Maybe<Result> get(uint64_t key, const String& assetId) const;
+		void put(uint64_t key, const String& assetId, const Result& result);
+
+	private:
+		Path directory;
+		Path rootPath;
+		String serverHost;
+		String serverPath;
+		mutable std::atomic<bool> serverAvailable;
+
+		// Relative to the root of the cache
+		static Path getEntryPath(uint64_t key);
+		static Path getBlobPath(uint64_t hash);
+		static bool writeAtomically(const Path& path, const Bytes& data);
+
+		String toCachedInputPath(const Path& path) const;
+		Path fromCachedInputPath(const String& path) const;
+
+		bool download(uint64_t key) const;
+		Maybe<Bytes> serverGet(const Path& path) const;
+		bool serverPut(const Path& path, const Bytes& data) const;
+		void onServerError(const String& error) const;
+	};
+}
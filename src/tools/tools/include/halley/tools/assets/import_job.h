@@ -0,0 +1,65 @@
+#pragma once
+#include "halley/file/path.h"
+#include "halley/resources/metadata.h"
+#include "import_assets_database.h"
+#include "import_profiler.h"
+#include <functional>
+#include <vector>
+
+namespace Halley
+{
+	class Project;
+	class ImportingAsset;
+	class Serializer;
+	class Deserializer;
+
+	// One asset to import, with everything from the import database the importers need,
+	// so that it can be run somewhere that doesn't have the database (i.e. a worker process)
+	class ImportJob
+	{
+	public:
+		Path assetsPath;
+		ImportAssetsDatabaseEntry asset;
+		std::vector<std::pair<Path, Metadata>> metadata;
+
+		void serialize(Serializer& s) const;
+		void deserialize(Deserializer& s);
+	};
+
+	class ImportJobResult
+	{
+	public:
+		bool success = false;
+		bool cancelled = false;
+		String error;
+
+		bool cacheHit = false;
+		size_t bytesIn = 0;
+		size_t bytesOut = 0;
+		size_t peakMemoryIncrease = 0;
+		std::vector<ImportProfiler::ImporterTiming> importers; // Relative to the start of the job
+
+		std::vector<AssetResource> out;
+		std::vector<Path> outFiles; // Already written to the assets path
+		std::vector<TimestampedPath> additionalInputs;
+
+		static ImportJobResult makeError(String error);
+
+		void serialize(Serializer& s) const;
+		void deserialize(Deserializer& s);
+	};
+
+	// Runs the importers for a job in this process, using (and filling) the project's import cache
+	class ImportJobRunner
+	{
+	public:
+		explicit ImportJobRunner(Project& project);
+
+		ImportJobResult run(ImportJob& job, std::function<bool()> isCancelled) const;
+
+	private:
+		Project& project;
+
+		uint64_t getCacheKey(const ImportingAsset& asset) const;
+	};
+}
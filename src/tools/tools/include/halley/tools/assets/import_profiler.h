@@ -0,0 +1,73 @@
+#pragma once
+#include "halley/text/halleystring.h"
+#include "halley/data_structures/vector.h"
+#include "halley/resources/resource.h"
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace Halley
+{
+	// Collects timings, sizes and cache results for each asset in an import, to find out where the time goes.
+	// Results are a plain text report, sorted slowest first, and a Chrome trace JSON (chrome://tracing or Perfetto)
+	// with a track per import thread.
+	//
+	// Peak memory is the whole process's, so with parallel imports the increase is charged to whichever asset
+	// happened to be running when it went up; treat it as a pointer to where to look, not as an exact figure.
+	class ImportProfiler
+	{
+	public:
+		struct ImporterTiming
+		{
+			ImportAssetType type;
+			int64_t startNs;
+			int64_t endNs;
+			size_t bytesIn;
+		};
+
+		struct AssetEntry
+		{
+			String assetId;
+			ImportAssetType type = ImportAssetType::Undefined;
+			int64_t startNs = 0;
+			int64_t endNs = 0;
+			size_t bytesIn = 0;
+			size_t bytesOut = 0;
+			size_t peakMemoryIncrease = 0;
+			bool cacheHit = false;
+			bool failed = false;
+			Vector<ImporterTiming> importers; // Including the ones for additional assets generated on the way
+		};
+
+		ImportProfiler();
+
+		// Relative to the start of the import
+		int64_t getTimeNs() const;
+
+		// Can be called from any thread; the entry is placed on that thread's track
+		void addAsset(AssetEntry entry);
+
+		String generateSummary(size_t maxAssets = 10) const;
+		String generateReport() const;
+		String generateChromeTrace() const;
+
+	private:
+		struct TimedEntry
+		{
+			AssetEntry entry;
+			size_t thread;
+		};
+
+		std::chrono::steady_clock::time_point startTime;
+		size_t startPeakMemory;
+
+		mutable std::mutex mutex;
+		Vector<TimedEntry> assets;
+		std::map<std::thread::id, size_t> threads;
+
+		Vector<const TimedEntry*> getSortedAssets() const;
+		String generateTotals() const;
+		String generateAssetTable(const Vector<const TimedEntry*>& sorted, size_t maxAssets) const;
+	};
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "halley/file/path.h"
+#include "halley/utils/utils.h"
+#include "halley/data_structures/maybe.h"
+#include "import_job.h"
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Halley
+{
+	class ChildProcess;
+	class Project;
+
+	// Messages between the editor and an import worker, over the worker's stdin and stdout.
+	// Each is a 32-bit size, a type byte, and then the serialized payload.
+	enum class ImportWorkerMessageType : uint8_t
+	{
+		Job, // ImportJob, to the worker
+		Result, // ImportJobResult, from the worker
+		Log // LoggerLevel and message, from the worker
+	};
+
+	class ImportWorkerChannel
+	{
+	public:
+		using WriteFunction = std::function<bool(gsl::span<const gsl::byte>)>;
+		using ReadFunction = std::function<size_t(gsl::span<gsl::byte>)>;
+
+		static bool send(const WriteFunction& write, ImportWorkerMessageType type, const Bytes& payload);
+		static Maybe<std::pair<ImportWorkerMessageType, Bytes>> receive(const ReadFunction& read); // Empty if the other side went away
+	};
+
+	// Runs imports in separate processes ("halley-cmd importWorker"), so that heavy imports don't compete with the
+	// editor for its own threads, and a crashing importer only takes its worker down, failing that one asset.
+	// Workers are started when first needed, and restarted after a crash or a cancelled job.
+	class ImportWorkerPool
+	{
+	public:
+		ImportWorkerPool(Path executable, const Project& project, size_t nWorkers);
+		~ImportWorkerPool();
+
+		size_t getNumWorkers() const;
+
+		// Blocks until a worker is free and has run the job
+		ImportJobResult run(const ImportJob& job, std::function<bool()> isCancelled);
+
+		// Terminates the workers whose jobs have been cancelled, rather than letting them run to the end.
+		// Driven by EditorTaskSet::update.
+		void update();
+
+	private:
+		struct Worker
+		{
+			std::unique_ptr<ChildProcess> process;
+			std::function<bool()> isCancelled;
+			bool busy = false;
+		};
+
+		Path executable;
+		std::vector<String> args;
+
+		mutable std::mutex mutex;
+		std::condition_variable workerFreed;
+		std::vector<Worker> workers;
+
+		Worker& acquireWorker(std::function<bool()> isCancelled);
+		Maybe<int> releaseWorker(Worker& worker, bool keepProcess); // Returns the exit code if the process was dropped
+		bool runOnWorker(ChildProcess& process, const ImportJob& job, ImportJobResult& result);
+	};
+}
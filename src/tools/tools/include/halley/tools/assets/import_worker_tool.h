@@ -0,0 +1,26 @@
+#pragma once
+#include "halley/tools/cli_tool.h"
+#include "halley/support/logger.h"
+#include <mutex>
+
+namespace Halley
+{
+	// "halley-cmd importWorker projDir halleyDir", started by ImportWorkerPool. Runs the jobs it's sent on stdin
+	// until stdin is closed. Anything else written to stdout is diverted to stderr, and logs are sent back.
+	class ImportWorkerTool : public CommandLineTool, public ILoggerSink
+	{
+	public:
+		int run(Vector<std::string> args) override;
+		void log(LoggerLevel level, const String& msg) override;
+
+	protected:
+		bool shouldLogToStdOut() const override { return false; }
+
+	private:
+		std::mutex writeMutex;
+		int outFd = -1;
+
+		bool write(gsl::span<const gsl::byte> data);
+		size_t read(gsl::span<gsl::byte> dst);
+	};
+}
@@ -20,6 +20,8 @@ namespace Halley
 		virtual int run(Vector<std::string> args) = 0;
 
 	protected:
+		virtual bool shouldLogToStdOut() const { return true; }
+
 		std::unique_ptr<HalleyStatics> statics;
 		std::vector<String> platforms;
 		Environment env;
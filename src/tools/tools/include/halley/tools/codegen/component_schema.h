@@ -19,6 +19,8 @@ namespace Halley
 		int id = -1;
 		String name;
 		Vector<VariableSchema> members;
+		bool serializable = false;
+		bool replicated = false;
 		std::unordered_set<String> includeFiles;
 	};
 }
\ No newline at end of file
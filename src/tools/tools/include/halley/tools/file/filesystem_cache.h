@@ -0,0 +1,79 @@
+#pragma once
+
+#include <limits>
+#include <mutex>
+#include <vector>
+#include "halley/file/path.h"
+#include "halley/file/directory_monitor.h"
+#include "halley/data_structures/hash_map.h"
+#include "halley/data_structures/maybe.h"
+
+namespace Halley {
+	// Snapshot of the files under a set of root directories, so that the passes that check assets (CheckAssetsTask,
+	// ImportAssetsDatabase, AssetCollector) can query existence and timestamps without hitting the disk for each one.
+	// Each root is scanned once when added, and afterwards only the paths reported by its DirectoryMonitor are looked at again.
+	// Scanning happens outside the lock, with the subtrees of a full scan split across threads.
+	// Paths outside every root go straight to FileSystem. Safe to query from multiple threads.
+	class FileSystemCache
+	{
+	public:
+		void addRoot(const Path& root);
+		void applyChanges(const Path& root, const DirectoryMonitor::Changes& changes);
+		uint64_t getGeneration(const Path& root) const; // Changes whenever anything under root is added, removed or modified
+
+		bool exists(const Path& p) const;
+		bool isFile(const Path& p) const;
+		bool isDirectory(const Path& p) const;
+		int64_t getLastWriteTime(const Path& p) const;
+		std::vector<Path> enumerateDirectory(const Path& p) const; // Same results as FileSystem::enumerateDirectory
+
+	private:
+		constexpr static uint32_t invalidNode = std::numeric_limits<uint32_t>::max();
+
+		struct Node
+		{
+			uint32_t parent = invalidNode;
+			uint32_t segment = 0;
+			int64_t lastWriteTime = 0;
+			bool isDirectory = false;
+			std::vector<uint32_t> children;
+		};
+
+		// Nodes are keyed by their parent and their own name, both as indices, so lookups don't build any strings
+		struct Root
+		{
+			Path path;
+			std::vector<Node> nodes; // 0 is the root itself
+			std::vector<uint32_t> freeNodes;
+			HashMap<uint64_t, uint32_t> nodeLookup;
+			uint64_t generation = 0;
+		};
+
+		struct ScannedEntry;
+
+		mutable std::mutex mutex;
+		std::vector<Root> roots;
+		HashMap<String, uint32_t> segmentIds;
+		std::vector<String> segments;
+
+		uint32_t internSegment(const String& segment);
+		Maybe<uint32_t> findSegment(const String& segment) const;
+		static uint64_t makeKey(uint32_t parent, uint32_t segment);
+
+		Root& getRoot(const Path& rootPath);
+		const Root& getRoot(const Path& rootPath) const;
+		const Root* findRoot(const Path& p, size_t& firstPart) const;
+		const Node* findNode(const Path& p, bool& inRoot) const;
+		uint32_t findChild(const Root& root, uint32_t parent, uint32_t segment) const;
+
+		uint32_t addNode(Root& root, uint32_t parent, uint32_t segment);
+		void removeNode(Root& root, uint32_t idx);
+		void freeNode(Root& root, uint32_t idx);
+		static bool scanDisk(const Path& fullPath, ScannedEntry& entry, bool parallel);
+		Path findScanStart(const Root& root, const Path& relPath) const;
+		void applyScan(Root& root, const Path& relPath, ScannedEntry* scanned);
+		bool merge(Root& root, uint32_t idx, const ScannedEntry& scanned);
+
+		void collectFiles(const Root& root, const Node& node, const String& prefix, std::vector<Path>& result) const;
+	};
+}
@@ -51,6 +51,9 @@ namespace Halley
 		explicit FontGenerator(bool verbose = false, std::function<bool(float, String)> progressReporter = ignoreReport);
 		FontGeneratorResult generateFont(const Metadata& meta, gsl::span<const gsl::byte> fontFile, FontSizeInfo sizeInfo, float radius, int supersample, std::vector<int> characters);
 
+		// Glyphs are stored in the font one by one, for a runtime GlyphAtlas of atlasSize, instead of in an image
+		FontGeneratorResult generateDynamicFont(const Metadata& meta, gsl::span<const gsl::byte> fontFile, float fontSize, float replacementScale, Vector2i atlasSize, float radius, int supersample, std::vector<int> characters);
+
 	private:
 		std::unique_ptr<Font> generateFontMapBinary(const Metadata& meta, FontFace& font, Vector<CharcodeEntry>& entries, float scale, float renderScale, float radius, Vector2i imageSize) const;
 		static std::unique_ptr<Metadata> generateTextureMeta();
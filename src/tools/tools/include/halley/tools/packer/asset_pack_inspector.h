@@ -6,18 +6,27 @@
 #include "halley/core/resources/asset_database.h"
 
 namespace Halley {
+	class ResourceAccessTrace;
+
     class AssetPackInspector {
     public:
 	    explicit AssetPackInspector(String name);
 	    void parse(const Bytes& bytes);
 	    void printData() const;
 
+		// Sizes per type, duplicated content and unreferenced space in the data
+		void printStats() const;
+
+		// Given a trace of a play session, how reading each section's assets from this pack would go
+		void printAccessStats(const ResourceAccessTrace& trace) const;
+
     private:
 		String name;
 		size_t rawTableSize;
 		size_t tableSize;
 		uint64_t totalHash;
 	    uint64_t dataStartPos;
+		size_t dataSize;
 
 	    struct Entry
 		{
@@ -25,14 +34,18 @@ namespace Halley {
 			uint64_t hash;
 			String key;
 			AssetDatabase::Entry entry;
+			bool shared = false; // Stored in another pack
+			size_t pos = 0; // Relative to the start of the data
+			size_t size = 0; // Once decoded
+			size_t storedSize = 0;
 
 			Entry(int assetType, uint64_t hash, String key, AssetDatabase::Entry entry);
 		};
 		std::vector<Entry> entries;
 		std::vector<int> sortedEntries;
 
-		void parseTable(Deserializer s, const Bytes& packBytes);
-	    void parseTypedDB(Deserializer& s, const Bytes& packBytes);
+		void parseTable(const AssetDatabase& db, const Bytes& packBytes);
+		void parseTypedDB(int assetType, const AssetDatabase::TypedDB& db, const Bytes& packBytes);
 		void computeHash();
     };
 
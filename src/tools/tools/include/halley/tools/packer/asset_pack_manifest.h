@@ -17,9 +17,13 @@ namespace Halley {
 		bool isEncrypted() const;
 		const String& getEncryptionKey() const;
 
+		// Packs that are always installed and loaded together can point at identical data stored in one another
+		bool canShareData() const;
+
 	private:
 		String name;
 		String encryptionKey;
+		bool shareData = false;
 		std::vector<String> matches;
 	};
 
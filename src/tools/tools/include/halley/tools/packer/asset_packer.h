@@ -4,12 +4,14 @@
 #include "halley/resources/resource.h"
 #include "halley/core/resources/asset_database.h"
 #include "halley/data_structures/maybe.h"
+#include "halley/data_structures/hash_map.h"
 #include <set>
 
 namespace Halley {
 	class Project;
 	class AssetPackManifest;
 	class Path;
+	class ResourceAccessTrace;
 		
 	class AssetPackListing {
 	public:
@@ -23,19 +25,22 @@ namespace Halley {
 		};
 		
 		AssetPackListing();
-		AssetPackListing(String name, String encryptionKey);
+		AssetPackListing(String name, String encryptionKey, bool shareData = false);
 		
 		void addFile(AssetType type, const String& name, const AssetDatabase::Entry& entry);
 		const std::vector<Entry>& getEntries() const;
 		const String& getEncryptionKey() const;
+		bool canShareData() const;
 		
 		void setActive(bool active);
 		bool isActive() const;
 		void sort();
+		void sortByFirstUse(const HashMap<String, size_t>& firstUse); // Used assets in that order, then the rest by name
 
 	private:
 		String name;
 		String encryptionKey;
+		bool shareData = false;
 
 		bool active = false;
 
@@ -48,8 +53,21 @@ namespace Halley {
 		static void packPlatform(Project& project, Maybe<std::set<String>> assetsToPack, const std::vector<String>& deletedAssets, const String& platform);
 
 	private:
-		static std::map<String, AssetPackListing> sortIntoPacks(const AssetPackManifest& manifest, const AssetDatabase& srcAssetDb, Maybe<std::set<String>> assetsToPack, const std::vector<String>& deletedAssets);
+		struct PackedAsset {
+			String packId;
+			bool shareData;
+			String encryptionKey;
+			AssetType type;
+			String name;
+			String srcPath;
+		};
+		using PackedAssets = HashMap<uint64_t, std::vector<PackedAsset>>; // By hash of their contents
+
+		static std::map<String, AssetPackListing> sortIntoPacks(const AssetPackManifest& manifest, const AssetDatabase& srcAssetDb, Maybe<std::set<String>> assetsToPack, const std::vector<String>& deletedAssets, const ResourceAccessTrace* trace);
+		static void generatePreloadManifests(const ResourceAccessTrace& trace, const AssetDatabase& srcAssetDb, const Path& dst);
 		static void generatePacks(std::map<String, AssetPackListing> packs, const Path& src, const Path& dst);
-		static void generatePack(const String& packId, const AssetPackListing& pack, const Path& src, const Path& dst);
+		static void generatePack(const String& packId, const AssetPackListing& pack, const Path& src, const Path& dst, PackedAssets& packed);
+		static void writePack(const Path& dst, const Bytes& header, const Path& dataPath);
+		static const PackedAsset* findPacked(const PackedAssets& packed, uint64_t hash, const Bytes& data, const String& packId, const AssetPackListing& pack);
 	};
 }
@@ -8,6 +8,9 @@
 namespace Halley
 {
 	class ImportAssetsDatabase;
+	class ImportCache;
+	class FileSystemCache;
+	class ImportWorkerPool;
 
 	class HalleyStatics;
 	class IHalleyPlugin;
@@ -23,6 +26,7 @@ namespace Halley
 		std::vector<String> getPlatforms() const;
 
 		Path getRootPath() const;
+		Path getHalleyRootPath() const;
 		Path getUnpackedAssetsPath() const;
 		Path getPackedAssetsPath(const String& platform) const;
 		Path getAssetsSrcPath() const;
@@ -30,12 +34,17 @@ namespace Halley
 
 		Path getGenPath() const;
 		Path getGenSrcPath() const;
+		Path getImportCachePath() const;
+		String getImportCacheServer() const;
+		Path getImportReportPath() const;
 
 		void setAssetPackManifest(const Path& path);
 		Path getAssetPackManifestPath() const;
 
 		ImportAssetsDatabase& getImportAssetsDatabase() const;
 		ImportAssetsDatabase& getCodegenDatabase() const;
+		ImportCache& getImportCache() const;
+		FileSystemCache& getFileSystemCache() const;
 
 		const AssetImporter& getAssetImporter() const;
 		std::vector<std::unique_ptr<IAssetImporter>> getAssetImportersFromPlugins(ImportAssetType type) const;
@@ -43,15 +52,22 @@ namespace Halley
 		void setDevConServer(DevConServer* server);
 		DevConServer* getDevConServer() const;
 
+		// If set, imports run on these worker processes rather than in this one
+		void setImportWorkerPool(std::shared_ptr<ImportWorkerPool> pool);
+		const std::shared_ptr<ImportWorkerPool>& getImportWorkerPool() const;
+
 	private:
 		std::vector<String> platforms;
 		Path rootPath;
 		Path halleyRootPath;
 		Path assetPackManifest;
 		DevConServer* devConServer = nullptr;
+		std::shared_ptr<ImportWorkerPool> importWorkerPool;
 
+		std::unique_ptr<FileSystemCache> fileSystemCache;
 		std::unique_ptr<ImportAssetsDatabase> importAssetsDatabase;
 		std::unique_ptr<ImportAssetsDatabase> codegenDatabase;
+		std::unique_ptr<ImportCache> importCache;
 		std::unique_ptr<AssetImporter> assetImporter;
 
 		std::vector<HalleyPluginPtr> plugins;
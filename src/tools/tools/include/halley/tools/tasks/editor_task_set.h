@@ -5,6 +5,8 @@
 
 namespace Halley
 {
+	class ImportWorkerPool;
+
 	class EditorTaskSetListener
 	{
 	public:
@@ -24,12 +26,14 @@ namespace Halley
 		void addTask(EditorTaskAnchor&& editorTaskAnchor);
 
 		void setListener(EditorTaskSetListener& listener);
+		void setImportWorkerPool(std::shared_ptr<ImportWorkerPool> pool);
 
 		const std::list<std::shared_ptr<EditorTaskAnchor>>& getTasks() const;
 
 	private:
 		std::list<std::shared_ptr<EditorTaskAnchor>> tasks;
 		EditorTaskSetListener* listener = nullptr;
+		std::shared_ptr<ImportWorkerPool> importWorkerPool;
 		int nextId = 0;
 	};
 }
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <halley/maths/vector2.h>
+#include <halley/utils/utils.h>
+#include <halley/data_structures/vector.h>
+
+namespace Halley
+{
+	class Image;
+
+	// Builds mip chains for RGBA images at import time, so they don't have to be generated on upload.
+	// With sRGB filtering, colours are averaged in linear space and weighted by alpha, which keeps
+	// dark fringes off the edges of sprites and stops textures getting darker at lower levels.
+	class MipMapGenerator
+	{
+	public:
+		// Returns the RGBA pixels of each level, starting with a copy of src
+		static Vector<Bytes> generate(const Image& src, int mipLevels, bool sRGB);
+
+		static int getMaxMipLevels(Vector2i size);
+	};
+}
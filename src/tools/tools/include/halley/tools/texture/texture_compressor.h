@@ -0,0 +1,44 @@
+#pragma once
+
+#include <halley/maths/vector2.h>
+#include <halley/utils/utils.h>
+#include <halley/data_structures/vector.h>
+#include <halley/text/string_converter.h>
+
+namespace Halley
+{
+	enum class TextureFormat;
+
+	// How hard the encoders search for the best block. Fast is a bounding box fit, normal fits along the colours'
+	// main axis, and high refines that further. Each step is a few times slower than the previous one.
+	enum class TextureCompressionQuality
+	{
+		Fast,
+		Normal,
+		High
+	};
+
+	template <>
+	struct EnumNames<TextureCompressionQuality> {
+		constexpr std::array<const char*, 3> operator()() const {
+			return{{
+				"fast",
+				"normal",
+				"high"
+			}};
+		}
+	};
+
+	// Encodes RGBA mip chains (see MipMapGenerator) into GPU block compressed formats.
+	// The result holds every mip level back to back, as read by TextureDescriptorImageData::getMipLevel.
+	// Blocks are independent of each other, so they're encoded in parallel.
+	class TextureCompressor
+	{
+	public:
+		static bool canEncode(TextureFormat format);
+		static Bytes compress(const Vector<Bytes>& levels, Vector2i size, TextureFormat format, TextureCompressionQuality quality = TextureCompressionQuality::Normal);
+
+		// The cheapest BC format that keeps the image's alpha: BC1 if it's opaque or only has fully transparent pixels, BC3 otherwise
+		static TextureFormat pickBCFormat(const Bytes& rgba);
+	};
+}
@@ -1,5 +1,6 @@
 #include "halley/tools/assets/asset_collector.h"
 #include "halley/tools/file/filesystem.h"
+#include "halley/tools/file/filesystem_cache.h"
 #include "halley/bytes/byte_serializer.h"
 #include "halley/resources/metadata.h"
 #include "halley/support/logger.h"
@@ -8,10 +9,11 @@
 using namespace Halley;
 
 
-AssetCollector::AssetCollector(const ImportingAsset& asset, const Path& dstDir, const std::vector<Path>& assetsSrc, ProgressReporter reporter)
+AssetCollector::AssetCollector(const ImportingAsset& asset, const Path& dstDir, const std::vector<Path>& assetsSrc, const FileSystemCache& fileSystem, ProgressReporter reporter)
 	: asset(asset)
 	, dstDir(dstDir)
 	, assetsSrc(assetsSrc)
+	, fileSystem(fileSystem)
 	, reporter(reporter)
 {}
 
@@ -70,8 +72,8 @@ Bytes AssetCollector::readAdditionalFile(const Path& filePath)
 {
 	for (auto path : assetsSrc) {
 		Path f = path / filePath;
-		if (FileSystem::exists(f)) {
-			additionalInputs.push_back(TimestampedPath(f, FileSystem::getLastWriteTime(f)));
+		if (fileSystem.exists(f)) {
+			additionalInputs.push_back(TimestampedPath(f, fileSystem.getLastWriteTime(f)));
 			return FileSystem::readFile(f);
 		}
 	}
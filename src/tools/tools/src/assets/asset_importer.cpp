@@ -14,9 +14,12 @@
 #include "importers/bitmap_font_importer.h"
 #include "importers/shader_importer.h"
 #include "halley/text/string_converter.h"
+#include "halley/utils/hash.h"
 #include "halley/tools/project/project.h"
 #include <boost/variant/detail/substitute.hpp>
 #include "importers/texture_importer.h"
+#include "importers/prefab_importer.h"
+#include "importers/lua_importer.h"
 
 using namespace Halley;
 
@@ -38,6 +41,8 @@ AssetImporter::AssetImporter(Project& project, const std::vector<Path>& assetsSr
 		std::make_unique<SpriteSheetImporter>(),
 		std::make_unique<ShaderImporter>(),
 		std::make_unique<TextureImporter>(),
+		std::make_unique<PrefabImporter>(),
+		std::make_unique<LuaImporter>(),
 		std::make_unique<IAssetImporter>()
 	};
 
@@ -49,6 +54,21 @@ AssetImporter::AssetImporter(Project& project, const std::vector<Path>& assetsSr
 			importerSet.emplace_back(std::move(pluginImporter));
 		}
 	}
+
+	// Imports can produce additional assets of other types, so every importer's version is relevant to all of them
+	Hash::Hasher hasher;
+	for (auto& set: importers) {
+		hasher.feed(int(set.first));
+		for (auto& importer: set.second) {
+			hasher.feed(importer->getVersion());
+		}
+	}
+	versionHash = hasher.digest();
+}
+
+uint64_t AssetImporter::getVersionHash() const
+{
+	return versionHash;
 }
 
 IAssetImporter& AssetImporter::getRootImporter(Path path) const
@@ -78,6 +98,10 @@ IAssetImporter& AssetImporter::getRootImporter(Path path) const
 		type = ImportAssetType::Skip;
 	} else if (root == "texture") {
 		type = ImportAssetType::Texture;
+	} else if (root == "prefab") {
+		type = ImportAssetType::Prefab;
+	} else if (root == "lua") {
+		type = ImportAssetType::LuaScript;
 	}
 
 	return getImporters(type).at(0);
@@ -7,9 +7,11 @@
 #include "halley/tools/assets/delete_assets_task.h"
 #include <boost/filesystem/operations.hpp>
 #include "halley/tools/file/filesystem.h"
+#include "halley/tools/file/filesystem_cache.h"
 #include "halley/support/logger.h"
 #include "../yaml/halley-yamlcpp.h"
 #include "halley/resources/resource_data.h"
+#include "halley/concurrency/concurrent.h"
 
 using namespace Halley;
 using namespace std::chrono_literals;
@@ -29,14 +31,32 @@ void CheckAssetsTask::run()
 {
 	bool first = true;
 	while (!isCancelled()) {
-		if (first | monitorAssets.poll() | monitorAssetsSrc.poll() | monitorSharedAssetsSrc.poll()) { // Don't short-circuit
-			Logger::logInfo("Scanning for asset changes...");
-			checkAllAssets(project.getImportAssetsDatabase(), { project.getAssetsSrcPath(), project.getSharedAssetsSrcPath() }, project.getUnpackedAssetsPath(), "Importing assets", true);
+		// Every monitor is polled each time, so changes don't pile up
+		{
+			const auto dstChanges = pollChanges(monitorAssets, project.getUnpackedAssetsPath(), first);
+			const std::vector<SourceChanges> srcChanges = {
+				{ project.getAssetsSrcPath(), pollChanges(monitorAssetsSrc, project.getAssetsSrcPath(), first) },
+				{ project.getSharedAssetsSrcPath(), pollChanges(monitorSharedAssetsSrc, project.getSharedAssetsSrcPath(), first) }
+			};
+			if ((first || needsFullScan(project.getUnpackedAssetsPath(), dstChanges, srcChanges)) && hasChangedSinceLastScan(assetsState, { project.getAssetsSrcPath(), project.getSharedAssetsSrcPath() }, project.getUnpackedAssetsPath())) {
+				Logger::logInfo("Scanning for asset changes...");
+				checkAllAssets(assetsState, project.getImportAssetsDatabase(), { project.getAssetsSrcPath(), project.getSharedAssetsSrcPath() }, project.getUnpackedAssetsPath(), "Importing assets", true);
+			} else if (srcChanges[0].changes.any() || srcChanges[1].changes.any()) {
+				checkChangedAssets(assetsState, project.getImportAssetsDatabase(), srcChanges, project.getUnpackedAssetsPath(), "Importing assets", true);
+			}
 		}
 
-		if (first | monitorGen.poll() | monitorGenSrc.poll()) {
-			Logger::logInfo("Scanning for codegen changes...");
-			checkAllAssets(project.getCodegenDatabase(), { project.getGenSrcPath() }, project.getGenPath(), "Generating code", false);
+		{
+			const auto dstChanges = pollChanges(monitorGen, project.getGenPath(), first);
+			const std::vector<SourceChanges> srcChanges = {
+				{ project.getGenSrcPath(), pollChanges(monitorGenSrc, project.getGenSrcPath(), first) }
+			};
+			if ((first || needsFullScan(project.getGenPath(), dstChanges, srcChanges)) && hasChangedSinceLastScan(codegenState, { project.getGenSrcPath() }, project.getGenPath())) {
+				Logger::logInfo("Scanning for codegen changes...");
+				checkAllAssets(codegenState, project.getCodegenDatabase(), { project.getGenSrcPath() }, project.getGenPath(), "Generating code", false);
+			} else if (srcChanges[0].changes.any()) {
+				checkChangedAssets(codegenState, project.getCodegenDatabase(), srcChanges, project.getGenPath(), "Generating code", false);
+			}
 		}
 
 		first = false;
@@ -105,34 +125,107 @@ static Metadata getMetaData(Path inputFilePath, Maybe<Path> dirMetaPath, Maybe<P
 	return meta;
 }
 
-bool CheckAssetsTask::importFile(ImportAssetsDatabase& db, std::map<String, ImportAssetsDatabaseEntry>& assets, const bool isCodegen, const std::vector<Path>& directoryMetas, const Path& srcPath, const Path& filePath) {
-	std::array<int64_t, 3> timestamps = {{ 0, 0, 0 }};
-	bool dbChanged = false;
+DirectoryMonitor::Changes CheckAssetsTask::pollChanges(DirectoryMonitor& monitor, const Path& root, bool first)
+{
+	// Keeps the project's file system snapshot up to date, so every query after this doesn't need to touch the disk
+	auto changes = monitor.pollChanges();
+	auto& fileSystem = project.getFileSystemCache();
+	if (first) {
+		fileSystem.addRoot(root);
+	} else {
+		fileSystem.applyChanges(root, changes);
+	}
+	return changes;
+}
+
+bool CheckAssetsTask::needsFullScan(const Path& dstPath, const DirectoryMonitor::Changes& dstChanges, const std::vector<SourceChanges>& srcChanges)
+{
+	// Output files are only ever written by the importer, so only ones that went missing matter
+	if (dstChanges.fullRescan) {
+		return true;
+	}
+	for (auto& path: dstChanges.paths) {
+		if (!project.getFileSystemCache().exists(dstPath / path)) {
+			return true;
+		}
+	}
+
+	// Directory metas apply to everything under them
+	for (auto& src: srcChanges) {
+		if (src.changes.fullRescan) {
+			return true;
+		}
+		for (auto& path: src.changes.paths) {
+			if (path.getFilename() == "_dir.meta") {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+std::vector<uint64_t> CheckAssetsTask::getGenerations(const std::vector<Path>& srcPaths, const Path& dstPath) const
+{
+	std::vector<uint64_t> result;
+	for (auto& srcPath: srcPaths) {
+		result.push_back(project.getFileSystemCache().getGeneration(srcPath));
+	}
+	result.push_back(project.getFileSystemCache().getGeneration(dstPath));
+	return result;
+}
+
+bool CheckAssetsTask::hasChangedSinceLastScan(const ScanState& state, const std::vector<Path>& srcPaths, const Path& dstPath) const
+{
+	// If nothing was touched since the last full scan, another one would reach the same conclusions
+	return state.generations.empty() || state.generations != getGenerations(srcPaths, dstPath);
+}
+
+bool CheckAssetsTask::importFile(ImportAssetsDatabase& db, ScanState& state, const bool isCodegen, const Path& srcPath, const Path& filePath)
+{
+	return addInputFile(db, state, isCodegen, srcPath, filePath, readInputFile(db, state.directoryMetas, srcPath, filePath));
+}
+
+CheckAssetsTask::InputFileInfo CheckAssetsTask::readInputFile(const ImportAssetsDatabase& db, const std::vector<Path>& directoryMetas, const Path& srcPath, const Path& filePath) const
+{
+	InputFileInfo result;
+	auto& timestamps = result.timestamps;
+	const auto& fileSystem = project.getFileSystemCache();
 
 	// Collect data on main file
-	timestamps[0] = FileSystem::getLastWriteTime(srcPath / filePath);
+	timestamps[0] = fileSystem.getLastWriteTime(srcPath / filePath);
 
 	// Collect data on directory meta file
 	auto dirMetaPath = findDirectoryMeta(directoryMetas, filePath);
-	if (dirMetaPath && FileSystem::exists(srcPath / dirMetaPath.get())) {
+	if (dirMetaPath && fileSystem.exists(srcPath / dirMetaPath.get())) {
 		dirMetaPath = srcPath / dirMetaPath.get();
-		timestamps[1] = FileSystem::getLastWriteTime(dirMetaPath.get());
+		timestamps[1] = fileSystem.getLastWriteTime(dirMetaPath.get());
 	} else {
 		dirMetaPath = {};
 	}
 
 	// Collect data on private meta file
 	Maybe<Path> privateMetaPath = srcPath / filePath.replaceExtension(filePath.getExtension() + ".meta");
-	if (FileSystem::exists(privateMetaPath.get())) {
-		timestamps[2] = FileSystem::getLastWriteTime(privateMetaPath.get());
+	if (fileSystem.exists(privateMetaPath.get())) {
+		timestamps[2] = fileSystem.getLastWriteTime(privateMetaPath.get());
 	} else {
 		privateMetaPath = {};
 	}
 
 	// Load metadata if needed
 	if (db.needToLoadInputMetadata(filePath, timestamps)) {
-		Metadata meta = getMetaData(filePath, dirMetaPath, privateMetaPath);
-		db.setInputFileMetadata(filePath, timestamps, meta);
+		result.metadata = getMetaData(filePath, dirMetaPath, privateMetaPath);
+	}
+
+	return result;
+}
+
+bool CheckAssetsTask::addInputFile(ImportAssetsDatabase& db, ScanState& state, bool isCodegen, const Path& srcPath, const Path& filePath, const InputFileInfo& info)
+{
+	bool dbChanged = false;
+	const auto& timestamps = info.timestamps;
+	if (info.metadata) {
+		db.setInputFileMetadata(filePath, timestamps, info.metadata.get());
 		dbChanged = true;
 	}
 
@@ -147,6 +240,7 @@ bool CheckAssetsTask::importFile(ImportAssetsDatabase& db, std::map<String, Impo
 	auto input = TimestampedPath(filePath, std::max(timestamps[0], std::max(timestamps[1], timestamps[2])));
 
 	// Build the asset
+	auto& assets = state.assets;
 	auto iter = assets.find(assetId);
 	if (iter == assets.end()) {
 		// New; create it
@@ -167,22 +261,53 @@ bool CheckAssetsTask::importFile(ImportAssetsDatabase& db, std::map<String, Impo
 			throw Exception("Mixed source dir input for " + assetId, HalleyExceptions::Tools);
 		}
 	}
+	state.inputs[(srcPath / filePath).toString()] = InputLocation{ assetId, filePath };
 
 	return dbChanged;
 }
 
-void CheckAssetsTask::checkAllAssets(ImportAssetsDatabase& db, std::vector<Path> srcPaths, Path dstPath, String taskName, bool packAfter)
+void CheckAssetsTask::removeInputs(ScanState& state, const Path& srcPath, const Path& path, std::set<String>& assetsChanged)
+{
+	// Removes the file, or everything under it if it's a directory
+	const String fullPath = (srcPath / path).toString();
+	const String dirPrefix = fullPath + "/";
+
+	std::vector<std::map<String, InputLocation>::iterator> found;
+	const auto fileIter = state.inputs.find(fullPath);
+	if (fileIter != state.inputs.end()) {
+		found.push_back(fileIter);
+	}
+	for (auto iter = state.inputs.lower_bound(dirPrefix); iter != state.inputs.end() && iter->first.startsWith(dirPrefix); ++iter) {
+		found.push_back(iter);
+	}
+
+	for (auto& input: found) {
+		const auto& location = input->second;
+		auto assetIter = state.assets.find(location.assetId);
+		if (assetIter != state.assets.end()) {
+			auto& files = assetIter->second.inputFiles;
+			files.erase(std::remove_if(files.begin(), files.end(), [&] (const TimestampedPath& f) { return f.first == location.filePath; }), files.end());
+			if (files.empty()) {
+				state.assets.erase(assetIter);
+			}
+		}
+		assetsChanged.insert(location.assetId);
+		state.inputs.erase(input);
+	}
+}
+
+void CheckAssetsTask::checkAllAssets(ScanState& state, ImportAssetsDatabase& db, std::vector<Path> srcPaths, Path dstPath, String taskName, bool packAfter)
 {
-	std::map<String, ImportAssetsDatabaseEntry> assets;
+	state = ScanState();
+	state.generations = getGenerations(srcPaths, dstPath);
+	auto& directoryMetas = state.directoryMetas;
 
 	bool isCodegen = srcPaths.size() == 1 && srcPaths[0] == project.getGenSrcPath();
 	bool dbChanged = false;
 
-	std::vector<Path> directoryMetas;
-
 	// Enumerate all potential assets
 	for (auto srcPath : srcPaths) {
-		auto allFiles = FileSystem::enumerateDirectory(srcPath);
+		auto allFiles = project.getFileSystemCache().enumerateDirectory(srcPath);
 
 		// First, collect all directory metas
 		for (auto& filePath : allFiles) {
@@ -191,13 +316,70 @@ void CheckAssetsTask::checkAllAssets(ImportAssetsDatabase& db, std::vector<Path>
 			}
 		}
 
-		// Next, go through normal files
+		// Next, go through normal files. Their timestamps and metadata don't depend on each other, so those are gathered
+		// in parallel, and then added in order.
+		std::vector<Path> files;
 		for (auto& filePath : allFiles) {
-			if (filePath.getExtension() == ".meta") {
-				continue;
+			if (filePath.getExtension() != ".meta") {
+				files.push_back(filePath);
+			}
+		}
+
+		std::vector<InputFileInfo> infos(files.size());
+		Concurrent::parallelFor(Executors::getCPUAux(), Range<size_t>(0, files.size()), 16, [&] (size_t start, size_t end)
+		{
+			for (size_t i = start; i < end; ++i) {
+				infos[i] = readInputFile(db, directoryMetas, srcPath, files[i]);
+			}
+		});
+
+		for (size_t i = 0; i < files.size(); ++i) {
+			dbChanged = dbChanged | addInputFile(db, state, isCodegen, srcPath, files[i], infos[i]);
+		}
+	}
+
+	if (dbChanged) {
+		db.save();
+	}
+
+	queueTasks(state, db, state.assets, dstPath, taskName, packAfter);
+}
+
+void CheckAssetsTask::checkChangedAssets(ScanState& state, ImportAssetsDatabase& db, const std::vector<SourceChanges>& srcChanges, Path dstPath, String taskName, bool packAfter)
+{
+	bool isCodegen = srcChanges.size() == 1 && srcChanges[0].srcPath == project.getGenSrcPath();
+	bool dbChanged = false;
+	const auto& fileSystem = project.getFileSystemCache();
+
+	std::set<String> assetsChanged;
+	for (auto& src: srcChanges) {
+		for (auto& changedPath: src.changes.paths) {
+			// Changing a file's meta is the same as changing the file
+			const Path path = changedPath.getExtension() == ".meta" ? changedPath.replaceExtension("") : changedPath;
+
+			// Forget what was there, then add back whatever is there now
+			removeInputs(state, src.srcPath, path, assetsChanged);
+
+			const Path fullPath = src.srcPath / path;
+			std::vector<Path> files;
+			if (fileSystem.isDirectory(fullPath)) {
+				for (auto& filePath: fileSystem.enumerateDirectory(fullPath)) {
+					files.push_back(path / filePath);
+				}
+			} else if (fileSystem.isFile(fullPath)) {
+				files.push_back(path);
 			}
 
-			dbChanged = dbChanged | importFile(db, assets, isCodegen, directoryMetas, srcPath, filePath);
+			for (auto& filePath: files) {
+				if (filePath.getExtension() == ".meta") {
+					continue;
+				}
+				dbChanged = dbChanged | importFile(db, state, isCodegen, src.srcPath, filePath);
+				const auto iter = state.inputs.find((src.srcPath / filePath).toString());
+				if (iter != state.inputs.end()) {
+					assetsChanged.insert(iter->second.assetId);
+				}
+			}
 		}
 	}
 
@@ -205,8 +387,20 @@ void CheckAssetsTask::checkAllAssets(ImportAssetsDatabase& db, std::vector<Path>
 		db.save();
 	}
 
+	std::map<String, ImportAssetsDatabaseEntry> candidates;
+	for (auto& assetId: assetsChanged) {
+		const auto iter = state.assets.find(assetId);
+		if (iter != state.assets.end()) {
+			candidates[assetId] = iter->second;
+		}
+	}
+	queueTasks(state, db, candidates, dstPath, taskName, packAfter);
+}
+
+void CheckAssetsTask::queueTasks(const ScanState& state, ImportAssetsDatabase& db, const std::map<String, ImportAssetsDatabaseEntry>& candidates, Path dstPath, String taskName, bool packAfter)
+{
 	// Check for missing input files
-	db.markAssetsAsStillPresent(assets);
+	db.markAssetsAsStillPresent(state.assets);
 	auto toDelete = db.getAllMissing();
 	std::vector<String> deletedAssets;
 	if (!toDelete.empty()) {
@@ -221,7 +415,7 @@ void CheckAssetsTask::checkAllAssets(ImportAssetsDatabase& db, std::vector<Path>
 	}
 
 	// Import assets
-	auto toImport = filterNeedsImporting(db, assets);
+	auto toImport = filterNeedsImporting(db, candidates);
 	if (!toImport.empty() || !deletedAssets.empty()) {
 		Logger::logInfo("Assets to be imported: " + toString(toImport.size()));
 		addPendingTask(EditorTaskAnchor(std::make_unique<ImportAssetsTask>(taskName, db, project.getAssetImporter(), dstPath, std::move(toImport), std::move(deletedAssets), project, packAfter)));
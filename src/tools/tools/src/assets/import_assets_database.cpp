@@ -2,8 +2,9 @@
 #include "halley/bytes/byte_serializer.h"
 #include "halley/resources/resource_data.h"
 #include "halley/tools/file/filesystem.h"
+#include "halley/tools/file/filesystem_cache.h"
 
-constexpr static int currentAssetVersion = 53;
+constexpr static int currentAssetVersion = 56;
 
 using namespace Halley;
 
@@ -65,15 +66,21 @@ void ImportAssetsDatabase::InputFileEntry::deserialize(Deserializer& s)
 	s >> metadata;
 }
 
-ImportAssetsDatabase::ImportAssetsDatabase(Path directory, Path dbFile, Path assetsDbFile, std::vector<String> platforms)
+ImportAssetsDatabase::ImportAssetsDatabase(Path directory, Path dbFile, Path assetsDbFile, std::vector<String> platforms, const FileSystemCache& fileSystem)
 	: platforms(std::move(platforms))
 	, directory(directory)
 	, dbFile(dbFile)
 	, assetsDbFile(assetsDbFile)
+	, fileSystem(fileSystem)
 {
 	load();
 }
 
+int ImportAssetsDatabase::getAssetVersion()
+{
+	return currentAssetVersion;
+}
+
 void ImportAssetsDatabase::load()
 {
 	std::lock_guard<std::mutex> lock(mutex);
@@ -91,7 +98,7 @@ void ImportAssetsDatabase::save() const
 	for (auto& platform: platforms) {
 		// TODO: fix this
 		auto assetDb = makeAssetDatabase(platform);
-		FileSystem::writeFile(assetsDbFile, Serializer::toBytes(*assetDb));
+		FileSystem::writeFile(assetsDbFile, assetDb->toBytes());
 	}
 }
 
@@ -183,10 +190,10 @@ bool ImportAssetsDatabase::needsImporting(const ImportAssetsDatabaseEntry& asset
 
 	// Any of the additional input files changed?
 	for (auto& i: oldAsset.additionalInputFiles) {
-		if (!FileSystem::exists(i.first)) {
+		if (!fileSystem.exists(i.first)) {
 			// File removed
 			return true;
-		} else if  (FileSystem::getLastWriteTime(i.first) != i.second) {
+		} else if  (fileSystem.getLastWriteTime(i.first) != i.second) {
 			// Timestamp changed
 			return true;
 		}		
@@ -196,7 +203,7 @@ bool ImportAssetsDatabase::needsImporting(const ImportAssetsDatabaseEntry& asset
 	if (!failed) {
 		for (auto& o: oldAsset.outputFiles) {
 			for (auto& version: o.platformVersions) {
-				if (!FileSystem::exists(directory / version.second.filepath)) {
+				if (!fileSystem.exists(directory / version.second.filepath)) {
 					return true;
 				}
 			}
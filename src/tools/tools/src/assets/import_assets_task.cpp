@@ -1,19 +1,36 @@
 #include <thread>
+#include <numeric>
 #include "halley/tools/assets/import_assets_task.h"
 #include "halley/tools/assets/check_assets_task.h"
 #include "halley/tools/project/project.h"
 #include "halley/tools/assets/import_assets_database.h"
 #include "halley/resources/resource_data.h"
 #include "halley/tools/file/filesystem.h"
-#include "halley/tools/assets/asset_collector.h"
 #include "halley/concurrency/concurrent.h"
 #include "halley/tools/packer/asset_packer_task.h"
 #include "halley/support/logger.h"
-#include "halley/time/stopwatch.h"
 #include "halley/support/debug.h"
+#include "halley/tools/assets/import_profiler.h"
+#include "halley/tools/assets/import_job.h"
+#include "halley/tools/assets/import_worker_pool.h"
 
 using namespace Halley;
 
+namespace {
+	// Rough guess of how long an asset will take to import, so the slowest ones can be started first
+	size_t estimateImportCost(const ImportAssetsDatabaseEntry& asset)
+	{
+		size_t total = 0;
+		for (auto& f: asset.inputFiles) {
+			const auto path = asset.srcDir / f.first;
+			if (FileSystem::isFile(path)) {
+				total += FileSystem::fileSize(path);
+			}
+		}
+		return total;
+	}
+}
+
 ImportAssetsTask::ImportAssetsTask(String taskName, ImportAssetsDatabase& db, const AssetImporter& importer, Path assetsPath, Vector<ImportAssetsDatabaseEntry> files, std::vector<String> deletedAssets, Project& project, bool packAfter)
 	: EditorTask(taskName, true, true)
 	, db(db)
@@ -23,12 +40,13 @@ ImportAssetsTask::ImportAssetsTask(String taskName, ImportAssetsDatabase& db, co
 	, packAfter(packAfter)
 	, files(std::move(files))
 	, deletedAssets(std::move(deletedAssets))
-	, totalImportTime(0)
 {}
 
+ImportAssetsTask::~ImportAssetsTask() = default;
+
 void ImportAssetsTask::run()
 {
-	Stopwatch timer;
+	profiler = std::make_unique<ImportProfiler>();
 	using namespace std::chrono_literals;
 	auto lastSave = std::chrono::steady_clock::now();
 
@@ -36,9 +54,23 @@ void ImportAssetsTask::run()
 	assetsToImport = files.size();
 	std::vector<Future<void>> tasks;
 
-	constexpr bool parallelImport = !Debug::isDebug();
+	// Imports on worker processes are always parallel, since a crash can't take the editor down
+	const bool parallelImport = !Debug::isDebug() || project.getImportWorkerPool();
+
+	// Start with the largest assets: the import can't finish before the slowest one does, and the small ones can
+	// fill in the gaps around them. Importers also split their own work onto the same queue, which keeps every
+	// thread busy once only a few large assets remain.
+	std::vector<size_t> order(files.size());
+	std::iota(order.begin(), order.end(), size_t(0));
+	if (parallelImport) {
+		std::vector<size_t> costs(files.size());
+		for (size_t i = 0; i < files.size(); ++i) {
+			costs[i] = estimateImportCost(files[i]);
+		}
+		std::stable_sort(order.begin(), order.end(), [&] (size_t a, size_t b) { return costs[a] > costs[b]; });
+	}
 
-	for (size_t i = 0; i < files.size(); ++i) {
+	for (size_t i: order) {
 		auto importFunc = [&, i] () {
 			if (isCancelled()) {
 				return;
@@ -74,75 +106,57 @@ void ImportAssetsTask::run()
 		}
 	}
 
-	timer.pause();
-	Time realTime = timer.elapsedNanoSeconds() / 1000000000.0;
-	Time importTime = totalImportTime / 1000000000.0;
-	Logger::logInfo("Import took " + toString(realTime) + " seconds, on which " + toString(importTime) + " seconds of work were performed (" + toString(importTime / realTime) + "x realtime)");
+	writeProfile();
 }
 
 bool ImportAssetsTask::importAsset(ImportAssetsDatabaseEntry& asset)
 {
 	Logger::logInfo("Importing " + asset.assetId);
-	Stopwatch timer;
-
-	std::vector<AssetResource> out;
-	std::vector<std::pair<Path, Bytes>> outFiles;
-	std::vector<TimestampedPath> additionalInputs;
-	try {
-		// Create queue
-		std::list<ImportingAsset> toLoad;
-
-		// Load files from disk
-		ImportingAsset importingAsset;
-		importingAsset.assetId = asset.assetId;
-		importingAsset.assetType = asset.assetType;
-		for (auto& f: asset.inputFiles) {
-			auto meta = db.getMetadata(f.first);
-			importingAsset.inputFiles.emplace_back(ImportingAssetFile(f.first, FileSystem::readFile(asset.srcDir / f.first), meta ? meta.get() : Metadata()));
-		}
-		toLoad.emplace_back(std::move(importingAsset));
-
-		// Import
-		while (!toLoad.empty()) {
-			auto cur = std::move(toLoad.front());
-			toLoad.pop_front();
-			
-			AssetCollector collector(cur, assetsPath, importer.getAssetsSrc(), [=] (float assetProgress, const String& label) -> bool
-			{
-				//setProgress(lerp(curFileProgressStart, curFileProgressEnd, assetProgress), curFileLabel + " " + label);
-				return !isCancelled();
-			});
-
-			for (auto& importer: importer.getImporters(cur.assetType)) {
-				importer.get().import(cur, collector);
-			}
-			
-			for (auto& additional: collector.collectAdditionalAssets()) {
-				toLoad.emplace_front(std::move(additional));
-			}
 
-			for (auto& outFile: collector.collectOutFiles()) {
-				outFiles.push_back(std::move(outFile));
-			}
+	ImportProfiler::AssetEntry profile;
+	profile.assetId = asset.assetId;
+	profile.type = asset.assetType;
+	profile.startNs = profiler->getTimeNs();
+
+	ImportJob job;
+	job.assetsPath = assetsPath;
+	job.asset = asset;
+	for (auto& f: asset.inputFiles) {
+		auto meta = db.getMetadata(f.first);
+		if (meta) {
+			job.metadata.emplace_back(f.first, meta.get());
+		}
+	}
 
-			for (auto& o: collector.getAssets()) {
-				out.push_back(o);
-			}
+	auto isCancelledFunc = [this] () { return isCancelled(); };
+	auto workerPool = project.getImportWorkerPool();
+	auto result = workerPool ? workerPool->run(job, isCancelledFunc) : ImportJobRunner(project).run(job, isCancelledFunc);
 
-			for (auto& i: collector.getAdditionalInputs()) {
-				additionalInputs.push_back(i);
-			}
-		}
-	} catch (std::exception& e) {
-		addError("\"" + asset.assetId + "\" - " + e.what());
-		asset.additionalInputFiles = std::move(additionalInputs);
-		db.markFailed(asset);
+	profile.cacheHit = result.cacheHit;
+	profile.bytesIn = result.bytesIn;
+	profile.bytesOut = result.bytesOut;
+	profile.peakMemoryIncrease = result.peakMemoryIncrease;
+	for (auto& i: result.importers) {
+		profile.importers.push_back(ImportProfiler::ImporterTiming{ i.type, profile.startNs + i.startNs, profile.startNs + i.endNs, i.bytesIn });
+	}
+	auto addProfile = [&] (bool failed)
+	{
+		profile.failed = failed;
+		profile.endNs = profiler->getTimeNs();
+		profiler->addAsset(std::move(profile));
+	};
 
+	// Check if it didn't get cancelled
+	if (result.cancelled || isCancelled()) {
 		return false;
 	}
 
-	// Check if it didn't get cancelled
-	if (isCancelled()) {
+	if (!result.success) {
+		addError("\"" + asset.assetId + "\" - " + result.error);
+		asset.additionalInputFiles = std::move(result.additionalInputs);
+		db.markFailed(asset);
+
+		addProfile(true);
 		return false;
 	}
 
@@ -150,33 +164,41 @@ bool ImportAssetsTask::importAsset(ImportAssetsDatabaseEntry& asset)
 	auto previous = db.getOutFiles(asset.assetId);
 	for (auto& f: previous) {
 		for (auto& v: f.platformVersions) {
-			if (std::find_if(outFiles.begin(), outFiles.end(), [&] (const std::pair<Path, Bytes>& r) { return r.first == v.second.filepath; }) == outFiles.end()) {
+			if (std::find(result.outFiles.begin(), result.outFiles.end(), Path(v.second.filepath)) == result.outFiles.end()) {
 				// File no longer exists as part of this asset, remove it
 				FileSystem::remove(assetsPath / v.second.filepath);
 			}
 		}
 	}
 
-	// Write files
-	for (auto& outFile: outFiles) {
-		auto path = assetsPath / outFile.first;
-		Logger::logInfo("- " + asset.assetId + " -> " + path + " (" + String::prettySize(outFile.second.size()) + ")");
-		FileSystem::writeFile(path, outFile.second);
-	}
-
 	// Add to list of output assets
-	for (auto& o: out) {
+	for (auto& o: result.out) {
 		std::unique_lock<std::mutex> lock(mutex);
 		outputAssets.insert(toString(o.type) + ":" + o.name);
 	}
 
 	// Store output in db
-	asset.additionalInputFiles = std::move(additionalInputs);
-	asset.outputFiles = std::move(out);
+	asset.additionalInputFiles = std::move(result.additionalInputs);
+	asset.outputFiles = std::move(result.out);
 	db.markAsImported(asset);
 
-	timer.pause();
-	totalImportTime += timer.elapsedNanoSeconds();
-
+	addProfile(false);
 	return true;
 }
+
+void ImportAssetsTask::writeProfile() const
+{
+	if (files.empty()) {
+		return;
+	}
+
+	// The summary goes to the log (and so the editor's console); the full report and trace go next to the project
+	Logger::logInfo("Import profile:\n" + profiler->generateSummary());
+
+	const auto dir = project.getImportReportPath();
+	const auto report = profiler->generateReport();
+	const auto trace = profiler->generateChromeTrace();
+	FileSystem::writeFile(dir / "report.txt", gsl::as_bytes(gsl::span<const char>(report.c_str(), report.size())));
+	FileSystem::writeFile(dir / "trace.json", gsl::as_bytes(gsl::span<const char>(trace.c_str(), trace.size())));
+	Logger::logInfo("Import report written to " + dir.getString());
+}
@@ -0,0 +1,242 @@
+#include "halley/tools/assets/import_cache.h"
+#include "halley/tools/file/filesystem.h"
+#include "halley/bytes/byte_serializer.h"
+#include "halley/utils/hash.h"
+#include "halley/text/string_converter.h"
+#include "halley/support/logger.h"
+#include "halley/net/connection/http.h"
+#include <thread>
+
+using namespace Halley;
+
+constexpr static int currentCacheVersion = 2;
+
+namespace {
+	struct CacheEntry
+	{
+		String assetId;
+		std::vector<AssetResource> assets;
+		std::vector<std::pair<Path, uint64_t>> outFiles; // Path and hash of the contents
+		std::vector<std::pair<String, uint64_t>> additionalInputs; // Relative to the project root where possible, so entries can be shared between machines
+
+		void serialize(Serializer& s) const
+		{
+			s << currentCacheVersion;
+			s << assetId;
+			s << assets;
+			s << outFiles;
+			s << additionalInputs;
+		}
+
+		void deserialize(Deserializer& s)
+		{
+			int version;
+			s >> version;
+			if (version != currentCacheVersion) {
+				throw Exception("Import cache entry is from a different version.", HalleyExceptions::Tools);
+			}
+			s >> assetId;
+			s >> assets;
+			s >> outFiles;
+			s >> additionalInputs;
+		}
+	};
+}
+
+ImportCache::ImportCache(Path directory, Path rootPath, String server)
+	: directory(std::move(directory))
+	, rootPath(std::move(rootPath))
+	, serverAvailable(!server.isEmpty())
+{
+	const auto slash = server.find('/');
+	if (slash != String::npos) {
+		serverHost = server.left(slash);
+		serverPath = server.mid(slash);
+		if (serverPath.endsWith("/")) {
+			serverPath = serverPath.left(serverPath.size() - 1);
+		}
+	} else {
+		serverHost = server;
+	}
+}
+
+Maybe<ImportCache::Result> ImportCache::get(uint64_t key, const String& assetId) const
+{
+	const auto entryPath = directory / getEntryPath(key);
+	if (!FileSystem::exists(entryPath) && !download(key)) {
+		return {};
+	}
+
+	try {
+		auto entry = Deserializer::fromBytes<CacheEntry>(FileSystem::readFile(entryPath));
+		if (entry.assetId != assetId) {
+			return {};
+		}
+
+		Result result;
+		for (auto& input: entry.additionalInputs) {
+			const auto path = fromCachedInputPath(input.first);
+			if (!FileSystem::exists(path) || Hash::hash(FileSystem::readFile(path)) != input.second) {
+				return {};
+			}
+			result.additionalInputs.emplace_back(path, FileSystem::getLastWriteTime(path));
+		}
+
+		for (auto& out: entry.outFiles) {
+			auto data = FileSystem::readFile(directory / getBlobPath(out.second));
+			if (Hash::hash(data) != out.second) {
+				// Missing or damaged
+				return {};
+			}
+			result.outFiles.emplace_back(out.first, std::move(data));
+		}
+
+		result.assets = std::move(entry.assets);
+		return result;
+	} catch (std::exception& e) {
+		Logger::logWarning("Unable to read import cache entry for \"" + assetId + "\": " + e.what());
+		return {};
+	}
+}
+
+void ImportCache::put(uint64_t key, const String& assetId, const Result& result)
+{
+	CacheEntry entry;
+	entry.assetId = assetId;
+	entry.assets = result.assets;
+
+	for (auto& input: result.additionalInputs) {
+		entry.additionalInputs.emplace_back(toCachedInputPath(input.first), Hash::hash(FileSystem::readFile(input.first)));
+	}
+
+	for (auto& out: result.outFiles) {
+		const auto hash = Hash::hash(out.second);
+		const auto blobPath = getBlobPath(hash);
+		if (!FileSystem::exists(directory / blobPath) && !writeAtomically(directory / blobPath, out.second)) {
+			return;
+		}
+		entry.outFiles.emplace_back(out.first, hash);
+	}
+
+	// Written last, so that it never refers to missing blobs
+	const auto entryData = Serializer::toBytes(entry);
+	writeAtomically(directory / getEntryPath(key), entryData);
+
+	// Same on the server
+	if (serverAvailable) {
+		for (auto& out: result.outFiles) {
+			if (!serverPut(getBlobPath(Hash::hash(out.second)), out.second)) {
+				return;
+			}
+		}
+		serverPut(getEntryPath(key), entryData);
+	}
+}
+
+Path ImportCache::getEntryPath(uint64_t key)
+{
+	return Path("entries") / (toString(key, 16) + ".entry");
+}
+
+Path ImportCache::getBlobPath(uint64_t hash)
+{
+	// Spread over subdirectories, as some filesystems don't cope well with huge directories
+	const auto name = toString(hash, 16);
+	return Path("blobs") / name.left(2) / name;
+}
+
+bool ImportCache::writeAtomically(const Path& path, const Bytes& data)
+{
+	// Written under a name that's unique to this thread first, so readers never see a partial file
+	const auto threadId = uint64_t(std::hash<std::thread::id>()(std::this_thread::get_id()));
+	const auto tmpPath = path.parentPath() / (path.getFilename().getString() + ".tmp" + toString(threadId, 16));
+	FileSystem::writeFile(tmpPath, data);
+	if (!FileSystem::rename(tmpPath, path)) {
+		FileSystem::remove(tmpPath);
+		return false;
+	}
+	return true;
+}
+
+String ImportCache::toCachedInputPath(const Path& path) const
+{
+	const auto root = rootPath.getString() + "/";
+	const auto str = path.getString();
+	return str.startsWith(root) ? str.mid(root.size()) : str;
+}
+
+Path ImportCache::fromCachedInputPath(const String& path) const
+{
+	const auto p = Path(path);
+	return p.isAbsolute() ? p : rootPath / p;
+}
+
+bool ImportCache::download(uint64_t key) const
+{
+	if (!serverAvailable) {
+		return false;
+	}
+
+	const auto entryPath = getEntryPath(key);
+	auto entryData = serverGet(entryPath);
+	if (!entryData) {
+		return false;
+	}
+
+	try {
+		const auto entry = Deserializer::fromBytes<CacheEntry>(entryData.get());
+		for (auto& out: entry.outFiles) {
+			const auto blobPath = getBlobPath(out.second);
+			if (FileSystem::exists(directory / blobPath)) {
+				continue;
+			}
+			auto blob = serverGet(blobPath);
+			if (!blob || Hash::hash(blob.get()) != out.second || !writeAtomically(directory / blobPath, blob.get())) {
+				return false;
+			}
+		}
+	} catch (std::exception& e) {
+		Logger::logWarning("Unable to read import cache entry from server: " + String(e.what()));
+		return false;
+	}
+
+	return writeAtomically(directory / entryPath, entryData.get());
+}
+
+Maybe<Bytes> ImportCache::serverGet(const Path& path) const
+{
+	try {
+		auto response = HTTP::request("GET", serverHost, serverPath + "/" + path.getString());
+		if (response.isOk()) {
+			return std::move(response.body);
+		}
+		if (response.status != 404) {
+			Logger::logWarning("Import cache server replied to GET " + path.getString() + " with status " + toString(response.status));
+		}
+	} catch (std::exception& e) {
+		onServerError(e.what());
+	}
+	return {};
+}
+
+bool ImportCache::serverPut(const Path& path, const Bytes& data) const
+{
+	try {
+		auto response = HTTP::request("PUT", serverHost, serverPath + "/" + path.getString(), data);
+		if (response.isOk()) {
+			return true;
+		}
+		Logger::logWarning("Import cache server replied to PUT " + path.getString() + " with status " + toString(response.status));
+	} catch (std::exception& e) {
+		onServerError(e.what());
+	}
+	return false;
+}
+
+void ImportCache::onServerError(const String& error) const
+{
+	// Don't keep stalling every import on a server that's down, just carry on with the local cache
+	if (serverAvailable.exchange(false)) {
+		Logger::logWarning("Import cache server unavailable, disabling it for this session: " + error);
+	}
+}
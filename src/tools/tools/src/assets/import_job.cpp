@@ -0,0 +1,234 @@
+#include "halley/tools/assets/import_job.h"
+#include "halley/tools/assets/asset_collector.h"
+#include "halley/tools/assets/import_cache.h"
+#include "halley/tools/file/filesystem.h"
+#include "halley/tools/project/project.h"
+#include "halley/bytes/byte_serializer.h"
+#include "halley/os/os.h"
+#include "halley/support/logger.h"
+#include "halley/utils/hash.h"
+#include <chrono>
+#include <list>
+
+using namespace Halley;
+
+namespace {
+	void feedString(Hash::Hasher& hasher, const String& str)
+	{
+		hasher.feed(str.size());
+		hasher.feedBytes(gsl::as_bytes(gsl::span<const char>(str.c_str(), str.size())));
+	}
+}
+
+void ImportJob::serialize(Serializer& s) const
+{
+	s << assetsPath;
+	s << asset;
+	s << metadata;
+}
+
+void ImportJob::deserialize(Deserializer& s)
+{
+	s >> assetsPath;
+	s >> asset;
+	s >> metadata;
+}
+
+ImportJobResult ImportJobResult::makeError(String error)
+{
+	ImportJobResult result;
+	result.error = std::move(error);
+	return result;
+}
+
+void ImportJobResult::serialize(Serializer& s) const
+{
+	s << success;
+	s << cancelled;
+	s << error;
+	s << cacheHit;
+	s << uint64_t(bytesIn);
+	s << uint64_t(bytesOut);
+	s << uint64_t(peakMemoryIncrease);
+
+	s << uint32_t(importers.size());
+	for (auto& i: importers) {
+		s << int(i.type);
+		s << i.startNs;
+		s << i.endNs;
+		s << uint64_t(i.bytesIn);
+	}
+
+	s << out;
+	s << outFiles;
+	s << additionalInputs;
+}
+
+void ImportJobResult::deserialize(Deserializer& s)
+{
+	uint64_t bytesIn64;
+	uint64_t bytesOut64;
+	uint64_t peak64;
+	s >> success;
+	s >> cancelled;
+	s >> error;
+	s >> cacheHit;
+	s >> bytesIn64;
+	s >> bytesOut64;
+	s >> peak64;
+	bytesIn = size_t(bytesIn64);
+	bytesOut = size_t(bytesOut64);
+	peakMemoryIncrease = size_t(peak64);
+
+	uint32_t nImporters;
+	s >> nImporters;
+	importers.resize(nImporters);
+	for (auto& i: importers) {
+		int type;
+		uint64_t importerBytesIn;
+		s >> type;
+		s >> i.startNs;
+		s >> i.endNs;
+		s >> importerBytesIn;
+		i.type = ImportAssetType(type);
+		i.bytesIn = size_t(importerBytesIn);
+	}
+
+	s >> out;
+	s >> outFiles;
+	s >> additionalInputs;
+}
+
+ImportJobRunner::ImportJobRunner(Project& project)
+	: project(project)
+{}
+
+ImportJobResult ImportJobRunner::run(ImportJob& job, std::function<bool()> isCancelled) const
+{
+	const auto startTime = std::chrono::steady_clock::now();
+	auto getTimeNs = [&] () -> int64_t
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+	};
+	const auto startPeakMemory = OS::get().getPeakMemoryUsage();
+
+	const auto& asset = job.asset;
+	const auto& importer = project.getAssetImporter();
+
+	ImportJobResult result;
+	std::vector<std::pair<Path, Bytes>> outFiles;
+	try {
+		// Create queue
+		std::list<ImportingAsset> toLoad;
+
+		// Load files from disk
+		ImportingAsset importingAsset;
+		importingAsset.assetId = asset.assetId;
+		importingAsset.assetType = asset.assetType;
+		for (auto& f: asset.inputFiles) {
+			auto meta = std::find_if(job.metadata.begin(), job.metadata.end(), [&] (const std::pair<Path, Metadata>& m) { return m.first == f.first; });
+			importingAsset.inputFiles.emplace_back(ImportingAssetFile(f.first, FileSystem::readFile(asset.srcDir / f.first), meta != job.metadata.end() ? meta->second : Metadata()));
+			result.bytesIn += importingAsset.inputFiles.back().data.size();
+		}
+
+		// Restore from cache, if this exact import has been done before
+		const auto cacheKey = getCacheKey(importingAsset);
+		auto cached = project.getImportCache().get(cacheKey, asset.assetId);
+		result.cacheHit = bool(cached);
+		if (cached) {
+			result.out = std::move(cached->assets);
+			outFiles = std::move(cached->outFiles);
+			result.additionalInputs = std::move(cached->additionalInputs);
+		} else {
+			toLoad.emplace_back(std::move(importingAsset));
+		}
+
+		// Import
+		while (!toLoad.empty()) {
+			auto cur = std::move(toLoad.front());
+			toLoad.pop_front();
+
+			AssetCollector collector(cur, job.assetsPath, importer.getAssetsSrc(), project.getFileSystemCache(), [=] (float assetProgress, const String& label) -> bool
+			{
+				return !isCancelled();
+			});
+
+			size_t bytesIn = 0;
+			for (auto& f: cur.inputFiles) {
+				bytesIn += f.data.size();
+			}
+			for (auto& importer: importer.getImporters(cur.assetType)) {
+				const auto startNs = getTimeNs();
+				importer.get().import(cur, collector);
+				result.importers.push_back(ImportProfiler::ImporterTiming{ cur.assetType, startNs, getTimeNs(), bytesIn });
+			}
+
+			for (auto& additional: collector.collectAdditionalAssets()) {
+				toLoad.emplace_front(std::move(additional));
+			}
+
+			for (auto& outFile: collector.collectOutFiles()) {
+				outFiles.push_back(std::move(outFile));
+			}
+
+			for (auto& o: collector.getAssets()) {
+				result.out.push_back(o);
+			}
+
+			for (auto& i: collector.getAdditionalInputs()) {
+				result.additionalInputs.push_back(i);
+			}
+		}
+
+		if (!cached && !isCancelled()) {
+			project.getImportCache().put(cacheKey, asset.assetId, ImportCache::Result{ result.out, outFiles, result.additionalInputs });
+		}
+	} catch (std::exception& e) {
+		result.error = e.what();
+		result.peakMemoryIncrease = OS::get().getPeakMemoryUsage() - startPeakMemory;
+		return result;
+	}
+
+	// Check if it didn't get cancelled
+	if (isCancelled()) {
+		result.cancelled = true;
+		return result;
+	}
+
+	// Write files
+	for (auto& outFile: outFiles) {
+		auto path = job.assetsPath / outFile.first;
+		Logger::logInfo("- " + asset.assetId + " -> " + path + " (" + String::prettySize(outFile.second.size()) + ")");
+		FileSystem::writeFile(path, outFile.second);
+		result.bytesOut += outFile.second.size();
+		result.outFiles.push_back(outFile.first);
+	}
+
+	result.success = true;
+	result.peakMemoryIncrease = OS::get().getPeakMemoryUsage() - startPeakMemory;
+	return result;
+}
+
+uint64_t ImportJobRunner::getCacheKey(const ImportingAsset& asset) const
+{
+	// Everything that can affect the output of the import, other than additional inputs, which the cache checks itself
+	Hash::Hasher hasher;
+	hasher.feed(ImportAssetsDatabase::getAssetVersion());
+	hasher.feed(project.getAssetImporter().getVersionHash());
+	for (auto& platform: project.getPlatforms()) {
+		feedString(hasher, platform);
+	}
+	hasher.feed(int(asset.assetType));
+	feedString(hasher, asset.assetId);
+
+	for (auto& file: asset.inputFiles) {
+		feedString(hasher, file.name.getString());
+		hasher.feed(file.data.size());
+		hasher.feedBytes(gsl::as_bytes(gsl::span<const Byte>(file.data)));
+		const auto meta = Serializer::toBytes(file.metadata);
+		hasher.feed(meta.size());
+		hasher.feedBytes(gsl::as_bytes(gsl::span<const Byte>(meta)));
+	}
+
+	return hasher.digest();
+}
@@ -0,0 +1,198 @@
+#include "halley/tools/assets/import_profiler.h"
+#include "halley/os/os.h"
+#include "halley/text/string_converter.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+using namespace Halley;
+
+namespace {
+	double toMs(int64_t ns)
+	{
+		return double(ns) / 1000000.0;
+	}
+
+	void writeJSONString(std::ostream& os, const String& str)
+	{
+		os << '"';
+		for (char c: str.cppStr()) {
+			if (c == '"' || c == '\\') {
+				os << '\\' << c;
+			} else if (static_cast<unsigned char>(c) >= 0x20) {
+				os << c;
+			}
+		}
+		os << '"';
+	}
+
+	struct TypeTotals
+	{
+		size_t assets = 0;
+		size_t cacheHits = 0;
+		size_t failed = 0;
+		size_t bytesIn = 0;
+		size_t bytesOut = 0;
+		size_t importCalls = 0;
+		int64_t importNs = 0;
+		int64_t maxImportNs = 0;
+	};
+}
+
+ImportProfiler::ImportProfiler()
+	: startTime(std::chrono::steady_clock::now())
+	, startPeakMemory(OS::get().getPeakMemoryUsage())
+{
+}
+
+int64_t ImportProfiler::getTimeNs() const
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void ImportProfiler::addAsset(AssetEntry entry)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	auto iter = threads.find(std::this_thread::get_id());
+	if (iter == threads.end()) {
+		iter = threads.emplace(std::this_thread::get_id(), threads.size()).first;
+	}
+	assets.push_back(TimedEntry{ std::move(entry), iter->second });
+}
+
+String ImportProfiler::generateSummary(size_t maxAssets) const
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	return generateTotals() + "\nSlowest assets:\n" + generateAssetTable(getSortedAssets(), maxAssets);
+}
+
+String ImportProfiler::generateReport() const
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	// Broken down by importer. Assets are counted under their own type, import time under each importer that ran,
+	// since one asset can generate others of different types (e.g. a sprite sheet generating an image).
+	std::map<ImportAssetType, TypeTotals> byType;
+	for (auto& a: assets) {
+		auto& t = byType[a.entry.type];
+		++t.assets;
+		t.cacheHits += a.entry.cacheHit ? 1 : 0;
+		t.failed += a.entry.failed ? 1 : 0;
+		t.bytesIn += a.entry.bytesIn;
+		t.bytesOut += a.entry.bytesOut;
+		for (auto& i: a.entry.importers) {
+			auto& it = byType[i.type];
+			const auto ns = i.endNs - i.startNs;
+			++it.importCalls;
+			it.importNs += ns;
+			it.maxImportNs = std::max(it.maxImportNs, ns);
+		}
+	}
+
+	Vector<std::pair<ImportAssetType, TypeTotals>> types(byType.begin(), byType.end());
+	std::sort(types.begin(), types.end(), [] (const auto& a, const auto& b) { return a.second.importNs > b.second.importNs; });
+
+	std::stringstream ss;
+	ss << std::fixed << std::setprecision(1);
+	ss << std::left << std::setw(14) << "Importer" << std::right << std::setw(8) << "Assets" << std::setw(8) << "Hits" << std::setw(8) << "Failed"
+		<< std::setw(8) << "Runs" << std::setw(12) << "Total ms" << std::setw(10) << "Avg ms" << std::setw(10) << "Max ms"
+		<< std::setw(12) << "In" << std::setw(12) << "Out" << "\n";
+	for (auto& t: types) {
+		const auto& v = t.second;
+		ss << std::left << std::setw(14) << toString(t.first).cppStr() << std::right << std::setw(8) << v.assets << std::setw(8) << v.cacheHits << std::setw(8) << v.failed
+			<< std::setw(8) << v.importCalls << std::setw(12) << toMs(v.importNs) << std::setw(10) << (v.importCalls > 0 ? toMs(v.importNs) / double(v.importCalls) : 0.0) << std::setw(10) << toMs(v.maxImportNs)
+			<< std::setw(12) << String::prettySize(v.bytesIn).cppStr() << std::setw(12) << String::prettySize(v.bytesOut).cppStr() << "\n";
+	}
+
+	return generateTotals() + "\nBy importer:\n" + String(ss.str()) + "\nAll assets, slowest first:\n" + generateAssetTable(getSortedAssets(), assets.size());
+}
+
+String ImportProfiler::generateChromeTrace() const
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	std::stringstream ss;
+	ss << std::fixed << std::setprecision(3);
+	ss << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+	for (size_t i = 0; i < threads.size(); ++i) {
+		ss << (i == 0 ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << i << ",\"args\":{\"name\":\"Import thread " << i << "\"}}";
+	}
+
+	for (auto& a: assets) {
+		const auto& e = a.entry;
+		ss << ",\n{\"name\":";
+		writeJSONString(ss, e.assetId);
+		ss << ",\"cat\":\"" << (e.cacheHit ? "cache" : "import") << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << a.thread
+			<< ",\"ts\":" << (double(e.startNs) / 1000.0) << ",\"dur\":" << (double(e.endNs - e.startNs) / 1000.0)
+			<< ",\"args\":{\"type\":\"" << toString(e.type) << "\",\"bytesIn\":" << e.bytesIn << ",\"bytesOut\":" << e.bytesOut
+			<< ",\"peakMemoryIncrease\":" << e.peakMemoryIncrease << ",\"cacheHit\":" << (e.cacheHit ? "true" : "false") << ",\"failed\":" << (e.failed ? "true" : "false") << "}}";
+
+		for (auto& i: e.importers) {
+			ss << ",\n{\"name\":\"" << toString(i.type) << "\",\"cat\":\"importer\",\"ph\":\"X\",\"pid\":0,\"tid\":" << a.thread
+				<< ",\"ts\":" << (double(i.startNs) / 1000.0) << ",\"dur\":" << (double(i.endNs - i.startNs) / 1000.0)
+				<< ",\"args\":{\"bytesIn\":" << i.bytesIn << "}}";
+		}
+	}
+
+	ss << "\n]}\n";
+	return ss.str();
+}
+
+Vector<const ImportProfiler::TimedEntry*> ImportProfiler::getSortedAssets() const
+{
+	Vector<const TimedEntry*> result;
+	result.reserve(assets.size());
+	for (auto& a: assets) {
+		result.push_back(&a);
+	}
+	std::stable_sort(result.begin(), result.end(), [] (const TimedEntry* a, const TimedEntry* b)
+	{
+		return a->entry.endNs - a->entry.startNs > b->entry.endNs - b->entry.startNs;
+	});
+	return result;
+}
+
+String ImportProfiler::generateTotals() const
+{
+	size_t hits = 0;
+	size_t failed = 0;
+	size_t bytesIn = 0;
+	size_t bytesOut = 0;
+	int64_t workNs = 0;
+	int64_t endNs = 0;
+	for (auto& a: assets) {
+		hits += a.entry.cacheHit ? 1 : 0;
+		failed += a.entry.failed ? 1 : 0;
+		bytesIn += a.entry.bytesIn;
+		bytesOut += a.entry.bytesOut;
+		workNs += a.entry.endNs - a.entry.startNs;
+		endNs = std::max(endNs, a.entry.endNs);
+	}
+
+	const auto peakMemory = OS::get().getPeakMemoryUsage();
+
+	std::stringstream ss;
+	ss << std::fixed << std::setprecision(2);
+	ss << assets.size() << " assets in " << (toMs(endNs) / 1000.0) << " s (" << (toMs(workNs) / 1000.0) << " s of work on " << threads.size() << " threads), "
+		<< hits << " cache hits, " << (assets.size() - hits) << " misses, " << failed << " failed\n";
+	ss << "Read " << String::prettySize(bytesIn).cppStr() << ", wrote " << String::prettySize(bytesOut).cppStr() << "\n";
+	if (peakMemory > 0) {
+		ss << "Peak memory " << String::prettySize(peakMemory).cppStr() << " (" << String::prettySize(startPeakMemory).cppStr() << " before importing)\n";
+	}
+	return ss.str();
+}
+
+String ImportProfiler::generateAssetTable(const Vector<const TimedEntry*>& sorted, size_t maxAssets) const
+{
+	std::stringstream ss;
+	ss << std::fixed << std::setprecision(1);
+	ss << std::right << std::setw(10) << "ms" << std::setw(12) << "In" << std::setw(12) << "Out" << std::setw(12) << "Peak +" << std::setw(8) << "Cache" << "  " << std::left << "Asset" << "\n";
+	for (size_t i = 0; i < std::min(maxAssets, sorted.size()); ++i) {
+		const auto& e = sorted[i]->entry;
+		ss << std::right << std::setw(10) << toMs(e.endNs - e.startNs) << std::setw(12) << String::prettySize(e.bytesIn).cppStr() << std::setw(12) << String::prettySize(e.bytesOut).cppStr()
+			<< std::setw(12) << (e.peakMemoryIncrease > 0 ? String::prettySize(e.peakMemoryIncrease).cppStr() : std::string("-"))
+			<< std::setw(8) << (e.cacheHit ? "hit" : "miss") << "  " << std::left << e.assetId.cppStr() << " [" << toString(e.type).cppStr() << "]" << (e.failed ? " FAILED" : "") << "\n";
+	}
+	return ss.str();
+}
@@ -0,0 +1,178 @@
+#include "halley/tools/assets/import_worker_pool.h"
+#include "halley/tools/project/project.h"
+#include "halley/bytes/byte_serializer.h"
+#include "halley/support/logger.h"
+#include "halley/text/string_converter.h"
+#include "halley/os/os.h"
+
+using namespace Halley;
+
+bool ImportWorkerChannel::send(const WriteFunction& write, ImportWorkerMessageType type, const Bytes& payload)
+{
+	std::array<uint8_t, 5> header;
+	const auto size = uint32_t(payload.size());
+	for (size_t i = 0; i < 4; ++i) {
+		header[i] = uint8_t(size >> (i * 8));
+	}
+	header[4] = uint8_t(type);
+	return write(gsl::as_bytes(gsl::span<const uint8_t>(header))) && write(gsl::as_bytes(gsl::span<const Byte>(payload)));
+}
+
+Maybe<std::pair<ImportWorkerMessageType, Bytes>> ImportWorkerChannel::receive(const ReadFunction& read)
+{
+	auto readAll = [&] (gsl::span<gsl::byte> dst) -> bool
+	{
+		while (dst.size() > 0) {
+			const auto n = read(dst);
+			if (n == 0) {
+				return false;
+			}
+			dst = dst.subspan(n);
+		}
+		return true;
+	};
+
+	std::array<uint8_t, 5> header;
+	if (!readAll(gsl::as_writeable_bytes(gsl::span<uint8_t>(header)))) {
+		return {};
+	}
+	uint32_t size = 0;
+	for (size_t i = 0; i < 4; ++i) {
+		size |= uint32_t(header[i]) << (i * 8);
+	}
+
+	Bytes payload(size);
+	if (!readAll(gsl::as_writeable_bytes(gsl::span<Byte>(payload)))) {
+		return {};
+	}
+	return std::make_pair(ImportWorkerMessageType(header[4]), std::move(payload));
+}
+
+ImportWorkerPool::ImportWorkerPool(Path executable, const Project& project, size_t nWorkers)
+	: executable(std::move(executable))
+	, workers(std::max(size_t(1), nWorkers))
+{
+	args.push_back("importWorker");
+	args.push_back(project.getRootPath().getString());
+	args.push_back(project.getHalleyRootPath().getString());
+	args.push_back("--platforms=" + String::concatList(project.getPlatforms(), ","));
+}
+
+ImportWorkerPool::~ImportWorkerPool()
+{
+	// Workers exit by themselves once their stdin is closed, and are terminated otherwise
+	std::unique_lock<std::mutex> lock(mutex);
+	workers.clear();
+}
+
+size_t ImportWorkerPool::getNumWorkers() const
+{
+	return workers.size();
+}
+
+ImportJobResult ImportWorkerPool::run(const ImportJob& job, std::function<bool()> isCancelled)
+{
+	Worker* worker;
+	try {
+		worker = &acquireWorker(isCancelled);
+	} catch (std::exception& e) {
+		return ImportJobResult::makeError(String("Unable to start import worker: ") + e.what());
+	}
+
+	ImportJobResult result;
+	const bool ok = runOnWorker(*worker->process, job, result);
+	const auto exitCode = releaseWorker(*worker, ok);
+
+	if (!ok) {
+		if (isCancelled()) {
+			result = ImportJobResult();
+			result.cancelled = true;
+		} else {
+			result = ImportJobResult::makeError("Import worker exited with code " + toString(exitCode ? exitCode.get() : -1) + " while importing");
+		}
+	}
+	return result;
+}
+
+void ImportWorkerPool::update()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	for (auto& w: workers) {
+		if (w.busy && w.process && w.isCancelled && w.isCancelled()) {
+			// The job's reader will see the worker go away, and report it as cancelled
+			w.process->terminate();
+		}
+	}
+}
+
+ImportWorkerPool::Worker& ImportWorkerPool::acquireWorker(std::function<bool()> isCancelled)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		// Prefer workers that are already running, so that new ones are only started when needed
+		Worker* candidate = nullptr;
+		for (auto& w: workers) {
+			if (!w.busy && (!candidate || (w.process && !candidate->process))) {
+				candidate = &w;
+			}
+		}
+
+		if (candidate) {
+			if (candidate->process && !candidate->process->isRunning()) {
+				candidate->process.reset();
+			}
+			if (!candidate->process) {
+				candidate->process = OS::get().startProcess(executable, args);
+			}
+			candidate->busy = true;
+			candidate->isCancelled = std::move(isCancelled);
+			return *candidate;
+		}
+
+		workerFreed.wait(lock);
+	}
+}
+
+Maybe<int> ImportWorkerPool::releaseWorker(Worker& worker, bool keepProcess)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	Maybe<int> exitCode;
+	if (!keepProcess) {
+		worker.process->terminate();
+		exitCode = worker.process->getExitCode();
+		worker.process.reset();
+	}
+	worker.busy = false;
+	worker.isCancelled = {};
+	workerFreed.notify_one();
+	return exitCode;
+}
+
+bool ImportWorkerPool::runOnWorker(ChildProcess& process, const ImportJob& job, ImportJobResult& result)
+{
+	auto write = [&] (gsl::span<const gsl::byte> data) { return process.write(data); };
+	auto read = [&] (gsl::span<gsl::byte> data) { return process.read(data); };
+
+	if (!ImportWorkerChannel::send(write, ImportWorkerMessageType::Job, Serializer::toBytes(job))) {
+		return false;
+	}
+
+	while (true) {
+		auto msg = ImportWorkerChannel::receive(read);
+		if (!msg) {
+			return false;
+		}
+
+		Deserializer s(msg->second);
+		if (msg->first == ImportWorkerMessageType::Log) {
+			int level;
+			String text;
+			s >> level;
+			s >> text;
+			Logger::log(LoggerLevel(level), text);
+		} else if (msg->first == ImportWorkerMessageType::Result) {
+			s >> result;
+			return true;
+		}
+	}
+}
@@ -0,0 +1,123 @@
+#include "halley/tools/assets/import_worker_tool.h"
+#include "halley/tools/assets/import_job.h"
+#include "halley/tools/assets/import_worker_pool.h"
+#include "halley/tools/file/filesystem.h"
+#include "halley/tools/project/project.h"
+#include "halley/tools/project/project_loader.h"
+#include "halley/bytes/byte_serializer.h"
+#include "halley/core/game/halley_statics.h"
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+using namespace Halley;
+
+int ImportWorkerTool::run(Vector<std::string> args)
+{
+	if (args.size() < 2) {
+		Logger::logError("Usage: halley-cmd importWorker projDir halleyDir");
+		return 1;
+	}
+
+	// Keep stdout for the protocol, and send anything else printed there to stderr
+	#ifdef _WIN32
+	_setmode(0, _O_BINARY);
+	_setmode(1, _O_BINARY);
+	outFd = _dup(1);
+	_dup2(2, 1);
+	#else
+	outFd = dup(STDOUT_FILENO);
+	dup2(STDERR_FILENO, STDOUT_FILENO);
+	#endif
+	Logger::addSink(*this);
+
+	const Path projectPath = FileSystem::getAbsolute(Path(args[0]));
+	const Path halleyRootPath = FileSystem::getAbsolute(Path(args[1]));
+	ProjectLoader loader(*statics, halleyRootPath);
+	loader.setPlatforms(platforms);
+	auto project = loader.loadProject(projectPath);
+	if (!project) {
+		Logger::logError("Unable to load project at " + projectPath.getString());
+		Logger::removeSink(*this);
+		return 1;
+	}
+
+	ImportJobRunner runner(*project);
+	auto writeFunc = [this] (gsl::span<const gsl::byte> data) { return write(data); };
+	auto readFunc = [this] (gsl::span<gsl::byte> data) { return read(data); };
+
+	while (true) {
+		auto msg = ImportWorkerChannel::receive(readFunc);
+		if (!msg) {
+			break;
+		}
+		if (msg->first != ImportWorkerMessageType::Job) {
+			continue;
+		}
+
+		auto job = Deserializer::fromBytes<ImportJob>(msg->second);
+		const auto result = runner.run(job, [] () { return false; });
+
+		std::unique_lock<std::mutex> lock(writeMutex);
+		if (!ImportWorkerChannel::send(writeFunc, ImportWorkerMessageType::Result, Serializer::toBytes(result))) {
+			break;
+		}
+	}
+
+	Logger::removeSink(*this);
+	return 0;
+}
+
+void ImportWorkerTool::log(LoggerLevel level, const String& msg)
+{
+	auto bytes = Serializer::toBytes([&] (Serializer& s)
+	{
+		s << int(level);
+		s << msg;
+	});
+
+	std::unique_lock<std::mutex> lock(writeMutex);
+	ImportWorkerChannel::send([this] (gsl::span<const gsl::byte> data) { return write(data); }, ImportWorkerMessageType::Log, bytes);
+}
+
+bool ImportWorkerTool::write(gsl::span<const gsl::byte> data)
+{
+	auto src = reinterpret_cast<const char*>(data.data());
+	size_t left = size_t(data.size());
+	while (left > 0) {
+		#ifdef _WIN32
+		const auto n = _write(outFd, src, unsigned(std::min(left, size_t(1 << 20))));
+		#else
+		const auto n = ::write(outFd, src, left);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		#endif
+		if (n <= 0) {
+			return false;
+		}
+		src += n;
+		left -= size_t(n);
+	}
+	return true;
+}
+
+size_t ImportWorkerTool::read(gsl::span<gsl::byte> dst)
+{
+	while (true) {
+		#ifdef _WIN32
+		const auto n = _read(0, dst.data(), unsigned(std::min(size_t(dst.size()), size_t(1 << 20))));
+		#else
+		const auto n = ::read(STDIN_FILENO, dst.data(), size_t(dst.size()));
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		#endif
+		return n > 0 ? size_t(n) : 0;
+	}
+}
@@ -4,6 +4,7 @@
 #include "halley/support/exception.h"
 #include "halley/bytes/byte_serializer.h"
 #include "halley/tools/file/filesystem.h"
+#include "halley/core/resources/asset_database.h"
 
 using namespace Halley;
 
@@ -11,7 +12,11 @@ void AnimationImporter::import(const ImportingAsset& asset, IAssetCollector& col
 {
 	Animation animation;
 	parseAnimation(animation, gsl::as_bytes(gsl::span<const Byte>(asset.inputFiles.at(0).data)));
-	collector.output(animation.getName(), AssetType::Animation, Serializer::toBytes(animation));
+
+	Metadata meta;
+	AssetDatabase::addDependency(meta, AssetType::SpriteSheet, animation.getSpriteSheetName());
+	AssetDatabase::addDependency(meta, AssetType::MaterialDefinition, animation.getMaterialName());
+	collector.output(animation.getName(), AssetType::Animation, Serializer::toBytes(animation), meta);
 }
 
 void AnimationImporter::parseAnimation(Animation& animation, gsl::span<const gsl::byte> data)
@@ -1,16 +1,19 @@
 #include "audio_event_importer.h"
 #include "halley/audio/audio_event.h"
-#include <yaml-cpp/yaml.h>
+#include "halley/core/resources/asset_database.h"
 #include "config_importer.h"
 using namespace Halley;
 
 void AudioEventImporter::import(const ImportingAsset& asset, IAssetCollector& collector)
 {
 	const auto& data = gsl::as_bytes(gsl::span<const Byte>(asset.inputFiles.at(0).data));
-	const String strData(reinterpret_cast<const char*>(data.data()), data.size());
-	const YAML::Node yamlRoot = YAML::Load(strData.cppStr());
-	const auto root = ConfigImporter::parseYAMLNode(yamlRoot);
+	const auto root = ConfigImporter::parseYAML(data);
 
 	const auto event = AudioEvent(root);
-	collector.output(Path(asset.assetId).replaceExtension("").string(), AssetType::AudioEvent, Serializer::toBytes(event));
+
+	Metadata meta;
+	for (auto& clip: event.getClips()) {
+		AssetDatabase::addDependency(meta, AssetType::AudioClip, clip);
+	}
+	collector.output(Path(asset.assetId).replaceExtension("").string(), AssetType::AudioEvent, Serializer::toBytes(event), meta);
 }
@@ -4,6 +4,7 @@
 #include "halley/resources/metadata.h"
 #include "halley/audio/vorbis_dec.h"
 #include "halley/audio/resampler.h"
+#include "halley/audio/audio_clip_format.h"
 
 #include "ogg/ogg.h"
 #include "vorbis/codec.h"
@@ -16,10 +17,30 @@
 
 using namespace Halley;
 
+namespace {
+	// "auto" picks ADPCM for clips up to this long, as those are the ones played often enough for decoding to add up
+	constexpr float maxAutoADPCMLength = 2.0f;
+
+	AudioClipFormat getClipFormat(const Metadata& meta, size_t numSamples, int sampleRate)
+	{
+		// Only Vorbis can be streamed
+		if (meta.getBool("streaming", false)) {
+			return AudioClipFormat::Vorbis;
+		}
+
+		const auto name = meta.getString("format", "vorbis");
+		if (name == "auto") {
+			return float(numSamples) / float(sampleRate) <= maxAutoADPCMLength ? AudioClipFormat::ADPCM : AudioClipFormat::Vorbis;
+		}
+		return fromString<AudioClipFormat>(name);
+	}
+}
+
 void AudioImporter::import(const ImportingAsset& asset, IAssetCollector& collector)
 {
 	Path mainFile = asset.inputFiles.at(0).name;
 	auto& rawData = asset.inputFiles[0].data;
+	Metadata meta = asset.inputFiles.at(0).metadata;
 	auto resData = std::make_shared<ResourceDataStatic>(rawData.data(), rawData.size(), mainFile.string(), false);
 	Bytes encodedData;
 	const Bytes* fileData = &rawData;
@@ -29,6 +50,7 @@ void AudioImporter::import(const ImportingAsset& asset, IAssetCollector& collect
 	int sampleRate = 0;
 	bool needsEncoding = false;
 	bool needsResampling = false;
+	AudioClipFormat format = AudioClipFormat::Vorbis;
 
 	if (mainFile.getExtension() == ".ogg") { // assuming Ogg Vorbis
 		// Load vorbis data
@@ -42,9 +64,10 @@ void AudioImporter::import(const ImportingAsset& asset, IAssetCollector& collect
 		}
 
 		// Decode
-		if (sampleRate != 48000) {
+		format = getClipFormat(meta, numSamples, sampleRate);
+		if (sampleRate != 48000 || format != AudioClipFormat::Vorbis) {
 			vorbis.read(samples);
-			needsResampling = true;
+			needsResampling = sampleRate != 48000;
 		}
 	} else {
 		throw Exception("Unsupported audio format: " + mainFile.getExtension(), HalleyExceptions::Tools);
@@ -61,17 +84,22 @@ void AudioImporter::import(const ImportingAsset& asset, IAssetCollector& collect
 		needsEncoding = true;
 	}
 
-	// Encode to vorbis
-	if (needsEncoding) {
+	// Encode
+	if (format != AudioClipFormat::Vorbis) {
+		meta.set("samples", int(samples.at(0).size()));
+		encodedData = AudioClipCodec::encode(format, samples);
+		fileData = &encodedData;
+		samples.clear();
+	} else if (needsEncoding) {
 		encodedData = encodeVorbis(numChannels, sampleRate, samples);
 		fileData = &encodedData;
 		samples.clear();
 	}
 
 	// Write metadata
-	Metadata meta = asset.inputFiles.at(0).metadata;
 	meta.set("channels", numChannels);
 	meta.set("sampleRate", sampleRate);
+	meta.set("format", toString(format));
 
 	// Output
 	collector.output(asset.assetId, AssetType::AudioClip, *fileData, meta);
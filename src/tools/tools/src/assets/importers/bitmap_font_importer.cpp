@@ -1,4 +1,5 @@
 #include "bitmap_font_importer.h"
+#include "font_importer.h"
 #include "halley/support/exception.h"
 #include "../contrib/tinyxml/ticpp.h"
 #include "halley/core/graphics/text/font.h"
@@ -38,7 +39,7 @@ void BitmapFontImporter::import(const ImportingAsset& asset, IAssetCollector& co
 
 	// Generate font from XML
 	Font font = parseBitmapFontXML(imageSize, xmlData);
-	collector.output(font.getName(), AssetType::Font, Serializer::toBytes(font));
+	collector.output(font.getName(), AssetType::Font, Serializer::toBytes(font), FontImporter::getDependencies(font));
 
 	// Pass image forward
 	ImportingAsset image;
@@ -1,20 +1,139 @@
 #include "config_importer.h"
 #include "halley/bytes/byte_serializer.h"
 #include "halley/file_formats/config_file.h"
+#include "halley/file_formats/config_node_view.h"
+#include "halley/file_formats/config_node_builder.h"
+#include "halley/file_formats/json_reader.h"
+#include "halley/concurrency/executor.h"
+#include "halley/data_structures/hash_map.h"
 #include "../../yaml/halley-yamlcpp.h"
+#include <yaml-cpp/eventhandler.h>
 #include "halley/tools/file/filesystem.h"
+#include <streambuf>
+#include <istream>
 
 using namespace Halley;
 
+namespace {
+	// Reads straight from the imported bytes, instead of copying them into a string first
+	class MemoryStreamBuffer : public std::streambuf {
+	public:
+		explicit MemoryStreamBuffer(gsl::span<const gsl::byte> data)
+		{
+			char* start = const_cast<char*>(reinterpret_cast<const char*>(data.data()));
+			setg(start, start, start + data.size());
+		}
+	};
+
+	// Builds the ConfigNode from parser events, so the YAML::Node tree is never created
+	class ConfigNodeYAMLHandler : public YAML::EventHandler {
+	public:
+		void OnDocumentStart(const YAML::Mark&) override {}
+		void OnDocumentEnd() override {}
+
+		void OnNull(const YAML::Mark& mark, YAML::anchor_t anchor) override
+		{
+			if (builder.isExpectingKey()) {
+				builder.setKey("null");
+			} else {
+				add(mark, anchor, ConfigNode());
+			}
+		}
+
+		void OnAlias(const YAML::Mark& mark, YAML::anchor_t anchor) override
+		{
+			const auto iter = anchors.find(anchor);
+			if (iter == anchors.end()) {
+				throw Exception("Unknown YAML anchor at line " + toString(mark.line + 1), HalleyExceptions::Tools);
+			}
+			if (builder.isExpectingKey()) {
+				builder.setKey(iter->second.asString());
+			} else {
+				add(mark, 0, ConfigNode(iter->second));
+			}
+		}
+
+		void OnScalar(const YAML::Mark& mark, const std::string&, YAML::anchor_t anchor, const std::string& value) override
+		{
+			if (builder.isExpectingKey()) {
+				builder.setKey(value);
+				if (anchor != 0) {
+					anchors[anchor] = ConfigNode(String(value));
+				}
+			} else {
+				add(mark, anchor, ConfigImporter::parseYAMLScalar(value));
+			}
+		}
+
+		void OnSequenceStart(const YAML::Mark& mark, const std::string&, YAML::anchor_t anchor, YAML::EmitterStyle::value) override
+		{
+			builder.setPosition(mark.line, mark.column);
+			builder.beginSequence();
+			containerAnchors.push_back(anchor);
+		}
+
+		void OnMapStart(const YAML::Mark& mark, const std::string&, YAML::anchor_t anchor, YAML::EmitterStyle::value) override
+		{
+			builder.setPosition(mark.line, mark.column);
+			builder.beginMap();
+			containerAnchors.push_back(anchor);
+		}
+
+		void OnSequenceEnd() override { endContainer(); }
+		void OnMapEnd() override { endContainer(); }
+
+		ConfigNode takeResult()
+		{
+			// An empty document has no events at all
+			return builder.isDone() ? builder.takeResult() : ConfigNode();
+		}
+
+	private:
+		ConfigNodeBuilder builder;
+		Vector<YAML::anchor_t> containerAnchors;
+		HashMap<YAML::anchor_t, ConfigNode> anchors;
+
+		void add(const YAML::Mark& mark, YAML::anchor_t anchor, ConfigNode node)
+		{
+			builder.setPosition(mark.line, mark.column);
+			auto& added = builder.addValue(std::move(node));
+			if (anchor != 0) {
+				anchors[anchor] = ConfigNode(added);
+			}
+		}
+
+		void endContainer()
+		{
+			const auto anchor = containerAnchors.back();
+			containerAnchors.pop_back();
+			auto& node = builder.end();
+			if (anchor != 0) {
+				anchors[anchor] = ConfigNode(node);
+			}
+		}
+	};
+}
+
 void ConfigImporter::import(const ImportingAsset& asset, IAssetCollector& collector)
 {
+	const auto& file = asset.inputFiles.at(0);
+	const auto data = gsl::as_bytes(gsl::span<const Byte>(file.data));
+	const auto extension = file.name.getExtension();
+
+	// Large data exports are usually JSON, which is read directly rather than through the (much slower) YAML parser
 	ConfigFile config;
-	parseConfig(config, gsl::as_bytes(gsl::span<const Byte>(asset.inputFiles.at(0).data)));
+	if (extension == ".json") {
+		config.getRoot() = JSONReader::parseConfigNode(data);
+	} else if (extension == ".jsonl" || extension == ".ndjson") {
+		config.getRoot() = JSONReader::parseJSONLines(data, &Executors::getCPUAux());
+	} else {
+		parseConfig(config, data);
+	}
 	
+	// Stored uncompressed in the flat binary format, so it can be read in place from a mapped pack
 	Metadata meta = asset.inputFiles.at(0).metadata;
-	meta.set("asset_compression", "deflate");
 
-	collector.output(Path(asset.assetId).replaceExtension("").string(), AssetType::ConfigFile, Serializer::toBytes(config), meta);
+	collector.output(Path(asset.assetId).replaceExtension("").string(), AssetType::ConfigFile, BinaryConfig::write(config.getRoot()), meta);
 }
 
 ConfigNode ConfigImporter::parseYAMLNode(const YAML::Node& node)
@@ -35,26 +154,39 @@ ConfigNode ConfigImporter::parseYAMLNode(const YAML::Node& node)
 		}
 		result = std::move(list);
 	} else if (node.IsScalar()) {
-		auto str = String(node.as<std::string>());
-		if (str.isNumber()) {
-			if (str.isInteger()) {
-				result = str.toInteger();
-			} else {
-				result = str.toFloat();
-			}
-		} else {
-			result = str;
-		}
+		result = parseYAMLScalar(node.as<std::string>());
 	}
 
 	result.setOriginalPosition(node.Mark().line, node.Mark().column);
 	return result;
 }
 
-void ConfigImporter::parseConfig(ConfigFile& config, gsl::span<const gsl::byte> data)
+ConfigNode ConfigImporter::parseYAMLScalar(const std::string& value)
+{
+	auto str = String(value);
+	if (str.isNumber()) {
+		if (str.isInteger()) {
+			return ConfigNode(str.toInteger());
+		} else {
+			return ConfigNode(str.toFloat());
+		}
+	}
+	return ConfigNode(std::move(str));
+}
+
+ConfigNode ConfigImporter::parseYAML(gsl::span<const gsl::byte> data)
 {
-	String strData(reinterpret_cast<const char*>(data.data()), data.size());
-	YAML::Node root = YAML::Load(strData.cppStr());
+	MemoryStreamBuffer buffer(data);
+	std::istream stream(&buffer);
+	YAML::Parser parser(stream);
+
+	// Only the first document is read, like YAML::Load
+	ConfigNodeYAMLHandler handler;
+	parser.HandleNextDocument(handler);
+	return handler.takeResult();
+}
 
-	config.getRoot() = parseYAMLNode(root);
+void ConfigImporter::parseConfig(ConfigFile& config, gsl::span<const gsl::byte> data)
+{
+	config.getRoot() = parseYAML(data);
 }
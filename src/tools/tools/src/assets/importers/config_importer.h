@@ -16,6 +16,8 @@ namespace Halley
 		void import(const ImportingAsset& asset, IAssetCollector& collector) override;
 
 		static ConfigNode parseYAMLNode(const YAML::Node& node);
+		static ConfigNode parseYAMLScalar(const std::string& value);
+		static ConfigNode parseYAML(gsl::span<const gsl::byte> data); // Without building a YAML::Node tree
 		static void parseConfig(ConfigFile& config, gsl::span<const gsl::byte> data);
 	};
 }
@@ -6,9 +6,23 @@
 #include "halley/file_formats/image.h"
 #include "halley/tools/file/filesystem.h"
 #include "halley/core/graphics/text/font.h"
+#include "halley/core/resources/asset_database.h"
 
 using namespace Halley;
 
+Metadata FontImporter::getDependencies(const Font& font)
+{
+	Metadata meta;
+	if (!font.hasDynamicAtlas()) {
+		AssetDatabase::addDependency(meta, AssetType::Texture, font.getImageName());
+	}
+	AssetDatabase::addDependency(meta, AssetType::MaterialDefinition, font.isDistanceField() ? "Halley/Text" : "Halley/Sprite");
+	for (auto& fallback: font.getFallback()) {
+		AssetDatabase::addDependency(meta, AssetType::Font, fallback);
+	}
+	return meta;
+}
+
 void FontImporter::import(const ImportingAsset& asset, IAssetCollector& collector)
 {
 	const auto& meta = asset.inputFiles.at(0).metadata;
@@ -50,6 +64,19 @@ void FontImporter::import(const ImportingAsset& asset, IAssetCollector& collecto
 		characters.push_back(c);
 	}
 
+	if (meta.getBool("dynamicAtlas", false)) {
+		// The atlas is filled up at runtime, so there's no image size to fit the font to
+		if (fontSize == 0) {
+			throw Exception("Font \"" + asset.assetId + "\" uses dynamicAtlas, so it needs a fontSize.", HalleyExceptions::Tools);
+		}
+		const Vector2i atlasSize(meta.getInt("atlasWidth", 1024), meta.getInt("atlasHeight", 1024));
+		auto result = gen.generateDynamicFont(meta, data, fontSize, replacementScale, atlasSize, radius, supersample, characters);
+		if (result.success) {
+			collector.output(result.font->getName(), AssetType::Font, Serializer::toBytes(*result.font), getDependencies(*result.font));
+		}
+		return;
+	}
+
 	auto result = gen.generateFont(meta, data, sizeInfo, radius, supersample, characters);
 	if (!result.success) {
 		return;
@@ -57,7 +84,7 @@ void FontImporter::import(const ImportingAsset& asset, IAssetCollector& collecto
 
 	auto fontName = result.font->getName();
 
-	collector.output(fontName, AssetType::Font, Serializer::toBytes(*result.font));
+	collector.output(fontName, AssetType::Font, Serializer::toBytes(*result.font), getDependencies(*result.font));
 
 	if (meta.hasKey("filtering")) {
 		result.imageMeta->set("filtering", meta.getBool("filtering"));
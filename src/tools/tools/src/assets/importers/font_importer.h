@@ -3,11 +3,16 @@
 
 namespace Halley
 {
+	class Font;
+
 	class FontImporter : public IAssetImporter
 	{
 	public:
 		ImportAssetType getType() const override { return ImportAssetType::Font; }
 
 		void import(const ImportingAsset& asset, IAssetCollector& collector) override;
+
+		// Metadata for the font asset, recording its texture, material and fallbacks as dependencies
+		static Metadata getDependencies(const Font& font);
 	};
 }
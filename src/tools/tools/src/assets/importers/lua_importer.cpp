@@ -0,0 +1,43 @@
+#include "lua_importer.h"
+#include "halley/support/exception.h"
+#include <lua.hpp>
+
+using namespace Halley;
+
+void LuaImporter::import(const ImportingAsset& asset, IAssetCollector& collector)
+{
+	const auto& file = asset.inputFiles.at(0);
+	Metadata meta = file.metadata;
+
+	// The source is still needed by dev builds, and for platforms that can't read the bytecode
+	collector.output(asset.assetId, AssetType::BinaryFile, file.data, meta);
+	const auto moduleName = Path(asset.assetId).dropFront(1).replaceExtension("").string();
+	collector.output(asset.assetId + "c", AssetType::BinaryFile, compile(moduleName, file.data, meta.getBool("stripDebugInfo", true)), meta);
+}
+
+Bytes LuaImporter::compile(const String& chunkName, const Bytes& source, bool stripDebugInfo)
+{
+	auto lua = luaL_newstate();
+	if (!lua) {
+		throw Exception("Unable to create Lua state to compile " + chunkName, HalleyExceptions::Tools);
+	}
+
+	const int result = luaL_loadbuffer(lua, reinterpret_cast<const char*>(source.data()), source.size(), chunkName.c_str());
+	if (result != 0) {
+		const auto error = String(lua_tostring(lua, -1));
+		lua_close(lua);
+		throw Exception("Error compiling Lua script:\n\t" + error, HalleyExceptions::Tools);
+	}
+
+	Bytes bytecode;
+	lua_dump(lua, [] (lua_State*, const void* data, size_t size, void* userData) -> int
+	{
+		auto& out = *static_cast<Bytes*>(userData);
+		auto bytes = static_cast<const Byte*>(data);
+		out.insert(out.end(), bytes, bytes + size);
+		return 0;
+	}, &bytecode, stripDebugInfo ? 1 : 0);
+
+	lua_close(lua);
+	return bytecode;
+}
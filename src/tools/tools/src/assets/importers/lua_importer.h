@@ -0,0 +1,18 @@
+#pragma once
+#include "halley/plugin/iasset_importer.h"
+
+namespace Halley
+{
+	// Outputs the script as it is, plus a precompiled and stripped copy next to it with "c" appended to the name
+	// (e.g. "lua/foo.luac"), which LuaState loads instead when it's available. Syntax errors fail the import.
+	class LuaImporter : public IAssetImporter
+	{
+	public:
+		ImportAssetType getType() const override { return ImportAssetType::LuaScript; }
+
+		void import(const ImportingAsset& asset, IAssetCollector& collector) override;
+		int dropFrontCount() const override { return 0; }
+
+		static Bytes compile(const String& chunkName, const Bytes& source, bool stripDebugInfo);
+	};
+}
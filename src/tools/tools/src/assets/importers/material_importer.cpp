@@ -4,6 +4,7 @@
 #include "../../yaml/halley-yamlcpp.h"
 #include "halley/tools/file/filesystem.h"
 #include "halley/text/string_converter.h"
+#include "halley/core/resources/asset_database.h"
 #include "config_importer.h"
 
 using namespace Halley;
@@ -11,11 +12,12 @@ using namespace Halley;
 void MaterialImporter::import(const ImportingAsset& asset, IAssetCollector& collector)
 {
 	Path basePath = asset.inputFiles.at(0).name.parentPath();
-	auto material = parseMaterial(basePath, gsl::as_bytes(gsl::span<const Byte>(asset.inputFiles.at(0).data)), collector);
-	collector.output(material.getName(), AssetType::MaterialDefinition, Serializer::toBytes(material));
+	Metadata meta;
+	auto material = parseMaterial(basePath, gsl::as_bytes(gsl::span<const Byte>(asset.inputFiles.at(0).data)), collector, meta);
+	collector.output(material.getName(), AssetType::MaterialDefinition, Serializer::toBytes(material), meta);
 }
 
-MaterialDefinition MaterialImporter::parseMaterial(Path basePath, gsl::span<const gsl::byte> data, IAssetCollector& collector) const
+MaterialDefinition MaterialImporter::parseMaterial(Path basePath, gsl::span<const gsl::byte> data, IAssetCollector& collector, Metadata& meta) const
 {
 	String strData(reinterpret_cast<const char*>(data.data()), data.size());
 	YAML::Node yamlRoot = YAML::Load(strData.cppStr());
@@ -26,7 +28,7 @@ MaterialDefinition MaterialImporter::parseMaterial(Path basePath, gsl::span<cons
 	if (root.hasKey("base")) {
 		String baseName = root["base"].asString();
 		auto otherData = collector.readAdditionalFile(basePath / baseName);
-		material = parseMaterial(basePath, gsl::as_bytes(gsl::span<Byte>(otherData)), collector);
+		material = parseMaterial(basePath, gsl::as_bytes(gsl::span<Byte>(otherData)), collector, meta);
 	}
 	material.load(root);
 
@@ -34,34 +36,53 @@ MaterialDefinition MaterialImporter::parseMaterial(Path basePath, gsl::span<cons
 	int passN = 0;
 	if (root.hasKey("passes")) {
 		for (auto& passNode: root["passes"].asSequence()) {
-			loadPass(material, passNode, collector, passN++);
+			loadPass(material, passNode, collector, passN++, meta);
 		}
 	}
 
 	return material;
 }
 
-void MaterialImporter::loadPass(MaterialDefinition& material, const ConfigNode& node, IAssetCollector& collector, int passN)
+void MaterialImporter::loadPass(MaterialDefinition& material, const ConfigNode& node, IAssetCollector& collector, int passN, Metadata& meta)
 {
 	String passName = material.getName() + "_pass_" + toString(passN);
 
 	auto shaderTypes = { "vertex", "geometry", "pixel" };
+	auto& keywords = material.getKeywords();
 
 	for (auto& shaderEntry: node["shader"]) {
 		String language = shaderEntry["language"].asString();
-		String shaderName = passName;
-		ImportingAsset shaderAsset;
-		shaderAsset.assetId = shaderName + ":" + language;
-		shaderAsset.assetType = ImportAssetType::Shader;
-		for (auto& curType: shaderTypes) {
-			if (shaderEntry.hasKey(curType)) {
-				auto data = loadShader(shaderEntry[curType].asString(), collector);
-				Metadata meta;
-				meta.set("language", language);
-				shaderAsset.inputFiles.emplace_back(ImportingAssetFile(shaderName + "." + curType, std::move(data), meta));
+
+		// One shader asset per variant, each compiled with its keywords defined
+		for (int variant = 0; variant < material.getNumVariants(); ++variant) {
+			String defines;
+			for (size_t i = 0; i < keywords.size(); ++i) {
+				if (variant & (1 << i)) {
+					if (!defines.isEmpty()) {
+						defines += ",";
+					}
+					defines += keywords[i];
+				}
+			}
+
+			String shaderName = MaterialPass::getVariantAssetId(passName, variant);
+			ImportingAsset shaderAsset;
+			shaderAsset.assetId = shaderName + ":" + language;
+			shaderAsset.assetType = ImportAssetType::Shader;
+			for (auto& curType: shaderTypes) {
+				if (shaderEntry.hasKey(curType)) {
+					auto data = loadShader(shaderEntry[curType].asString(), collector);
+					Metadata shaderMeta;
+					shaderMeta.set("language", language);
+					if (!defines.isEmpty()) {
+						shaderMeta.set("defines", defines);
+					}
+					shaderAsset.inputFiles.emplace_back(ImportingAssetFile(shaderName + "." + curType, std::move(data), shaderMeta));
+				}
 			}
+			AssetDatabase::addDependency(meta, AssetType::Shader, shaderAsset.assetId);
+			collector.addAdditionalAsset(std::move(shaderAsset));
 		}
-		collector.addAdditionalAsset(std::move(shaderAsset));
 	}
 
 	material.addPass(MaterialPass(passName, node));
@@ -15,10 +15,10 @@ namespace Halley
 
 		void import(const ImportingAsset& asset, IAssetCollector& collector) override;
 
-		MaterialDefinition parseMaterial(Path basePath, gsl::span<const gsl::byte> data, IAssetCollector& collector) const;
+		MaterialDefinition parseMaterial(Path basePath, gsl::span<const gsl::byte> data, IAssetCollector& collector, Metadata& meta) const;
 
 	private:
-		static void loadPass(MaterialDefinition& material, const ConfigNode& node, IAssetCollector& collector, int passN);
+		static void loadPass(MaterialDefinition& material, const ConfigNode& node, IAssetCollector& collector, int passN, Metadata& meta);
 		static void loadUniforms(MaterialDefinition& material, const YAML::Node& topNode);
 		static void loadTextures(MaterialDefinition& material, const YAML::Node& topNode);
 		static void loadAttributes(MaterialDefinition& material, const YAML::Node& topNode);
@@ -0,0 +1,31 @@
+#include "prefab_importer.h"
+#include "halley/entity/prefab.h"
+#include "halley/bytes/byte_serializer.h"
+#include "halley/support/exception.h"
+#include "config_importer.h"
+using namespace Halley;
+
+void PrefabImporter::import(const ImportingAsset& asset, IAssetCollector& collector)
+{
+	const auto& data = gsl::as_bytes(gsl::span<const Byte>(asset.inputFiles.at(0).data));
+	auto root = ConfigImporter::parseYAML(data);
+
+	// Expected format is a "components" list, with each entry a map of the component name to its data
+	if (root.getType() != ConfigNodeType::Map || !root.hasKey("components") || root["components"].getType() != ConfigNodeType::Sequence) {
+		throw Exception("Prefab " + asset.assetId + " must have a list of components.", HalleyExceptions::Tools);
+	}
+
+	Vector<Prefab::ComponentData> components;
+	for (auto& entry: root["components"].asSequence()) {
+		if (entry.getType() != ConfigNodeType::Map || entry.asMap().size() != 1) {
+			throw Exception("Each component in prefab " + asset.assetId + " must be a single \"Name: data\" entry.", HalleyExceptions::Tools);
+		}
+		auto& kv = *entry.asMap().begin();
+		components.push_back(Prefab::ComponentData{ kv.first, ConfigNode(kv.second) });
+	}
+
+	Metadata meta = asset.inputFiles.at(0).metadata;
+	meta.set("asset_compression", "deflate");
+
+	collector.output(Path(asset.assetId).replaceExtension("").string(), AssetType::Prefab, Serializer::toBytes(Prefab(std::move(components))), meta);
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include "halley/plugin/iasset_importer.h"
+
+namespace Halley
+{
+	class PrefabImporter : public IAssetImporter
+	{
+	public:
+		ImportAssetType getType() const override { return ImportAssetType::Prefab; }
+
+		void import(const ImportingAsset& asset, IAssetCollector& collector) override;
+	};
+}
@@ -20,21 +20,29 @@ void ShaderImporter::import(const ImportingAsset& asset, IAssetCollector& collec
 		const auto shaderType = fromString<ShaderType>(input.name.getExtension().mid(1));
 		const String language = input.metadata.getString("language", "");
 
+		// Keywords enabled for this variant of the material's shaders, separated by commas
+		const String definesStr = input.metadata.getString("defines", "");
+		const auto defines = definesStr.isEmpty() ? Vector<String>() : definesStr.split(',');
+
 		if (language == "glsl") {
 			String strData = String(reinterpret_cast<const char*>(input.data.data()), input.data.size());
-			strData = "#version 330\n" + strData;
+			String header = "#version 330\n";
+			for (auto& define: defines) {
+				header += "#define " + define + " 1\n";
+			}
+			strData = header + strData;
 			Bytes data(strData.size());
 			memcpy(data.data(), strData.c_str(), data.size());
 			shader.shaders[shaderType] = data;
 		} else if (language == "hlsl") {
-			shader.shaders[shaderType] = compileHLSL(input.name.toString(), shaderType, input.data);
+			shader.shaders[shaderType] = compileHLSL(input.name.toString(), shaderType, input.data, defines);
 		}
 	}
 
 	collector.output(asset.assetId, AssetType::Shader, Serializer::toBytes(shader), asset.inputFiles.at(0).metadata);
 }
 
-Bytes ShaderImporter::compileHLSL(const String& name, ShaderType type, const Bytes& bytes) const
+Bytes ShaderImporter::compileHLSL(const String& name, ShaderType type, const Bytes& bytes, const Vector<String>& defines) const
 {
 #ifdef _MSC_VER
 
@@ -57,9 +65,15 @@ Bytes ShaderImporter::compileHLSL(const String& name, ShaderType type, const Byt
 		throw Exception("Unsupported shader type: " + toString(type), HalleyExceptions::Tools);
 	}
 
+	std::vector<D3D_SHADER_MACRO> macros;
+	for (auto& define: defines) {
+		macros.push_back(D3D_SHADER_MACRO{ define.c_str(), "1" });
+	}
+	macros.push_back(D3D_SHADER_MACRO{ nullptr, nullptr });
+
 	ID3D10Blob *codeBlob = nullptr;
 	ID3D10Blob *errorBlob = nullptr;
-	const HRESULT hResult = D3DCompile2(bytes.data(), bytes.size(), name.c_str(), nullptr, nullptr, "main", target.c_str(), 0, 0, 0, nullptr, 0, &codeBlob, &errorBlob);
+	const HRESULT hResult = D3DCompile2(bytes.data(), bytes.size(), name.c_str(), macros.data(), nullptr, "main", target.c_str(), 0, 0, 0, nullptr, 0, &codeBlob, &errorBlob);
 	if (hResult != S_OK) {
 		const auto errorMessage = String(reinterpret_cast<const char*>(errorBlob->GetBufferPointer()), errorBlob->GetBufferSize());
 		errorBlob->Release();
@@ -13,6 +13,6 @@ namespace Halley
 		void import(const ImportingAsset& asset, IAssetCollector& collector) override;
 
 	private:
-		Bytes compileHLSL(const String& name, ShaderType type, const Bytes& data) const;
+		Bytes compileHLSL(const String& name, ShaderType type, const Bytes& data, const Vector<String>& defines) const;
 	};
 }
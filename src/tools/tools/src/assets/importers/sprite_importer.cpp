@@ -6,10 +6,15 @@
 #include "halley/tools/file/filesystem.h"
 #include "halley/core/graphics/sprite/sprite_sheet.h"
 #include "halley/core/graphics/sprite/animation.h"
+#include "halley/core/resources/asset_database.h"
 #include "halley/data_structures/bin_pack.h"
 #include "halley/text/string_converter.h"
 #include "../../sprites/aseprite_reader.h"
 #include "halley/support/logger.h"
+#include "halley/concurrency/concurrent.h"
+#include "halley/concurrency/executor.h"
+
+#include <atomic>
 
 using namespace Halley;
 
@@ -41,23 +46,11 @@ void SpriteImporter::import(const ImportingAsset& asset, IAssetCollector& collec
 	Maybe<String> palette;
 
 	for (auto& inputFile: asset.inputFiles) {
-		auto fileInputId = Path(inputFile.name).dropFront(1);
-		const String spriteName = fileInputId.replaceExtension("").string();
-
 		// Meta
-		Metadata meta = inputFile.metadata;
+		const Metadata& meta = inputFile.metadata;
 		if (!startMeta) {
 			startMeta = meta;
 		}
-		Vector2i pivot;
-		pivot.x = meta.getInt("pivotX", 0);
-		pivot.y = meta.getInt("pivotY", 0);
-		Vector4s slices;
-		slices.x = gsl::narrow<short, int>(meta.getInt("slice_left", 0));
-		slices.y = gsl::narrow<short, int>(meta.getInt("slice_top", 0));
-		slices.z = gsl::narrow<short, int>(meta.getInt("slice_right", 0));
-		slices.w = gsl::narrow<short, int>(meta.getInt("slice_bottom", 0));
-		bool trim = meta.getBool("trim", true);
 
 		// Palette
 		auto thisPalette = meta.getString("palette", "");
@@ -68,49 +61,45 @@ void SpriteImporter::import(const ImportingAsset& asset, IAssetCollector& collec
 		} else {
 			palette = thisPalette;
 		}
+	}
 
-		// Import image data
-		std::vector<ImageData> frames;
-		if (inputFile.name.getExtension() == ".ase" || inputFile.name.getExtension() == ".aseprite") {
-			// Import Aseprite file
-			frames = AsepriteReader::importAseprite(spriteName, gsl::as_bytes(gsl::span<const Byte>(inputFile.data)), trim);
-		} else {
-			// Bitmap
-			auto span = gsl::as_bytes(gsl::span<const Byte>(inputFile.data));
-			auto image = std::make_unique<Image>(span, fromString<Image::Format>(meta.getString("format", "undefined")));
-
-			frames.emplace_back();
-			auto& imgData = frames.back();
-			imgData.clip = trim ? image->getTrimRect() : image->getRect(); // Be careful, make sure this is done before the std::move() below
-			imgData.img = std::move(image);
-			imgData.duration = 100;
-			imgData.filenames.emplace_back(":img:" + fileInputId.toString());
-			imgData.frameNumber = 0;
-			imgData.sequenceName = "";
-		}
-
-		// Update frames with pivot and slices
-		for (auto& f: frames) {
-			f.pivot = pivot;
-			f.slices = slices;
+	// Import image data, which is independent for each file
+	std::vector<std::vector<ImageData>> framesPerFile(asset.inputFiles.size());
+	Concurrent::parallelFor(Executors::getCPUAux(), Range<size_t>(0, asset.inputFiles.size()), 1, [&] (size_t start, size_t end)
+	{
+		for (size_t i = start; i < end; ++i) {
+			framesPerFile[i] = importImageData(asset.inputFiles[i]);
 		}
+	});
 
-		// Split into a grid
-		const Vector2i grid(meta.getInt("tileWidth", 0), meta.getInt("tileHeight", 0));
-		if (grid.x > 0 && grid.y > 0) {
-			frames = splitImagesInGrid(frames, grid);
-		}
+	for (size_t i = 0; i < asset.inputFiles.size(); ++i) {
+		auto& inputFile = asset.inputFiles[i];
+		auto& frames = framesPerFile[i];
+		const Metadata& meta = inputFile.metadata;
+		const String spriteName = Path(inputFile.name).dropFront(1).replaceExtension("").string();
 
 		// Write animation
 		Animation animation = generateAnimation(spriteName, spriteSheetName, meta.getString("material", "Halley/Sprite"), frames);
-		collector.output(spriteName, AssetType::Animation, Serializer::toBytes(animation));
+		Metadata animMeta;
+		AssetDatabase::addDependency(animMeta, AssetType::SpriteSheet, animation.getSpriteSheetName());
+		AssetDatabase::addDependency(animMeta, AssetType::MaterialDefinition, animation.getMaterialName());
+		collector.output(spriteName, AssetType::Animation, Serializer::toBytes(animation), animMeta);
 
 		std::move(frames.begin(), frames.end(), std::back_inserter(totalFrames));
 	}
 
+	// With mipmaps, each sprite is padded and aligned to the size of a texel of the smallest level, so that zoomed out
+	// sprites (which sample the smaller levels) don't pick up their neighbours
+	int padding = 0;
+	if (startMeta && startMeta->getBool("mipmap", false)) {
+		const int maxMipLevels = startMeta->getInt("maxMipLevels", 4);
+		startMeta->set("maxMipLevels", maxMipLevels);
+		padding = 1 << std::max(0, maxMipLevels - 1);
+	}
+
 	// Generate atlas + spritesheet
 	SpriteSheet spriteSheet;
-	auto atlasImage = generateAtlas(atlasName, totalFrames, spriteSheet);
+	auto atlasImage = generateAtlas(atlasName, totalFrames, spriteSheet, padding);
 	spriteSheet.setTextureName(atlasName);
 
 	// Image metafile
@@ -134,7 +123,9 @@ void SpriteImporter::import(const ImportingAsset& asset, IAssetCollector& collec
 	collector.addAdditionalAsset(std::move(image));
 
 	// Write spritesheet
-	collector.output(spriteSheetName, AssetType::SpriteSheet, Serializer::toBytes(spriteSheet));
+	Metadata sheetMeta;
+	AssetDatabase::addDependency(sheetMeta, AssetType::Texture, atlasName);
+	collector.output(spriteSheetName, AssetType::SpriteSheet, Serializer::toBytes(spriteSheet), sheetMeta);
 }
 
 String SpriteImporter::getAssetId(const Path& file, const Maybe<Metadata>& metadata) const
@@ -148,6 +139,56 @@ String SpriteImporter::getAssetId(const Path& file, const Maybe<Metadata>& metad
 	return IAssetImporter::getAssetId(file, metadata);
 }
 
+std::vector<ImageData> SpriteImporter::importImageData(const ImportingAssetFile& inputFile)
+{
+	const auto fileInputId = Path(inputFile.name).dropFront(1);
+	const String spriteName = fileInputId.replaceExtension("").string();
+	const Metadata& meta = inputFile.metadata;
+
+	Vector2i pivot;
+	pivot.x = meta.getInt("pivotX", 0);
+	pivot.y = meta.getInt("pivotY", 0);
+	Vector4s slices;
+	slices.x = gsl::narrow<short, int>(meta.getInt("slice_left", 0));
+	slices.y = gsl::narrow<short, int>(meta.getInt("slice_top", 0));
+	slices.z = gsl::narrow<short, int>(meta.getInt("slice_right", 0));
+	slices.w = gsl::narrow<short, int>(meta.getInt("slice_bottom", 0));
+	bool trim = meta.getBool("trim", true);
+
+	std::vector<ImageData> frames;
+	if (inputFile.name.getExtension() == ".ase" || inputFile.name.getExtension() == ".aseprite") {
+		// Import Aseprite file
+		frames = AsepriteReader::importAseprite(spriteName, gsl::as_bytes(gsl::span<const Byte>(inputFile.data)), trim, &asepriteFrameCache);
+	} else {
+		// Bitmap
+		auto span = gsl::as_bytes(gsl::span<const Byte>(inputFile.data));
+		auto image = std::make_unique<Image>(span, fromString<Image::Format>(meta.getString("format", "undefined")));
+
+		frames.emplace_back();
+		auto& imgData = frames.back();
+		imgData.clip = trim ? image->getTrimRect() : image->getRect(); // Be careful, make sure this is done before the std::move() below
+		imgData.img = std::move(image);
+		imgData.duration = 100;
+		imgData.filenames.emplace_back(":img:" + fileInputId.toString());
+		imgData.frameNumber = 0;
+		imgData.sequenceName = "";
+	}
+
+	// Update frames with pivot and slices
+	for (auto& f: frames) {
+		f.pivot = pivot;
+		f.slices = slices;
+	}
+
+	// Split into a grid
+	const Vector2i grid(meta.getInt("tileWidth", 0), meta.getInt("tileHeight", 0));
+	if (grid.x > 0 && grid.y > 0) {
+		frames = splitImagesInGrid(frames, grid);
+	}
+
+	return frames;
+}
+
 Animation SpriteImporter::generateAnimation(const String& spriteName, const String& spriteSheetName, const String& materialName, const std::vector<ImageData>& frameData)
 {
 	Animation animation;
@@ -178,62 +219,126 @@ Animation SpriteImporter::generateAnimation(const String& spriteName, const Stri
 	return animation;
 }
 
-std::unique_ptr<Image> SpriteImporter::generateAtlas(const String& atlasName, std::vector<ImageData>& images, SpriteSheet& spriteSheet)
+std::unique_ptr<Image> SpriteImporter::generateAtlas(const String& atlasName, std::vector<ImageData>& images, SpriteSheet& spriteSheet, int padding)
 {
 	if (images.size() > 1) {
 		Logger::logInfo("Generating atlas \"" + atlasName + "\" with " + toString(images.size()) + " sprites...");
 	}
 
-	// Generate entries
+	// Generate entries. With padding, they're packed in cells of that size, with a cell of padding on each side.
+	const int cellSize = std::max(1, padding);
 	int64_t totalImageArea = 0;
 	std::vector<BinPackEntry> entries;
 	entries.reserve(images.size());
 	for (auto& img: images) {
 		auto size = img.clip.getSize();
-		totalImageArea += size.x * size.y;
+		if (padding > 0) {
+			size = Vector2i((size.x + cellSize - 1) / cellSize + 2, (size.y + cellSize - 1) / cellSize + 2);
+		}
+		totalImageArea += int64_t(size.x) * size.y * cellSize * cellSize;
 		entries.emplace_back(size, &img);
 	}
 
+	// Keep everything where it was last time, if it still fits at the same size, so that changing a few sprites doesn't
+	// repack the rest. Unless most of the atlas is now empty, e.g. after removing sprites.
+	Vector2i size;
+	boost::optional<Vector<BinPackResult>> packed;
+	{
+		std::unique_lock<std::mutex> lock(packingMutex);
+		const auto iter = previousPackings.find(atlasName);
+		if (iter != previousPackings.end() && iter->second.padding == padding && int64_t(iter->second.size.x) * iter->second.size.y <= 4 * totalImageArea) {
+			const auto& previous = iter->second;
+			std::vector<boost::optional<Vector2i>> positions(images.size());
+			for (size_t i = 0; i < images.size(); ++i) {
+				const auto pos = previous.positions.find(images[i].filenames.at(0));
+				if (pos != previous.positions.end()) {
+					positions[i] = pos->second;
+				}
+			}
+			packed = BinPack::packIncremental(entries, Vector2i(previous.size.x / cellSize, previous.size.y / cellSize), positions);
+			size = previous.size;
+		}
+	}
+	if (!packed) {
+		size = packFromScratch(atlasName, entries, totalImageArea, cellSize, packed);
+	}
+
+	if (images.size() > 1) {
+		Logger::logInfo("Atlas \"" + atlasName + "\" generated at " + toString(size.x) + "x" + toString(size.y) + " px with " + toString(images.size()) + " sprites. Total image area is " + toString(totalImageArea) + " px^2, sqrt = " + toString(lround(sqrt(totalImageArea))) + " px.");
+	}
+
+	{
+		PreviousPacking next;
+		next.size = size;
+		next.padding = padding;
+		for (auto& r: packed.get()) {
+			next.positions[reinterpret_cast<const ImageData*>(r.data)->filenames.at(0)] = r.rect.getTopLeft();
+		}
+		std::unique_lock<std::mutex> lock(packingMutex);
+		previousPackings[atlasName] = std::move(next);
+	}
+
+	if (padding > 0) {
+		// Back from cells to the image's own rect, inside its padding
+		for (auto& r: packed.get()) {
+			const auto* img = reinterpret_cast<const ImageData*>(r.data);
+			r.rect = Rect4i(r.rect.getTopLeft() * cellSize + Vector2i(padding, padding), img->clip.getSize().x, img->clip.getSize().y);
+		}
+	}
+	return makeAtlas(packed.get(), size, spriteSheet, padding);
+}
+
+Vector2i SpriteImporter::packFromScratch(const String& atlasName, const std::vector<BinPackEntry>& entries, int64_t totalImageArea, int cellSize, boost::optional<Vector<BinPackResult>>& packed) const
+{
 	// Figure out a reasonable pack size to start with
 	const int minSize = nextPowerOf2(int(sqrt(double(totalImageArea)))) / 2;
 	const int64_t guessArea = int64_t(minSize) * int64_t(minSize);
 	const int maxSize = 4096;
 	int curSize = std::min(maxSize, std::max(32, int(minSize)));
 
-	// Try packing
+	// Candidate sizes, smallest first: 64x64, then 128x64, 128x128, 256x128, etc
+	std::vector<Vector2i> candidates;
 	bool wide = guessArea > 2 * totalImageArea;
 	while (true) {
 		Vector2i size(curSize * (wide ? 2 : 1), curSize);
 		if (size.x > maxSize || size.y > maxSize) {
-			// Give up!
-			throw Exception("Unable to pack " + toString(images.size()) + " sprites in a reasonably sized atlas! curSize at " + toString(curSize) + ", maxSize is " + toString(maxSize) + ". Total image area is " + toString(totalImageArea) + " px^2, sqrt = " + toString(lround(sqrt(totalImageArea))) + " px.", HalleyExceptions::Tools);
+			break;
 		}
-
-		Logger::logInfo("Trying " + toString(size.x) + "x" + toString(size.y) + " px...");
-		auto res = BinPack::pack(entries, size);
-		if (res.is_initialized()) {
-			// Found a pack
-			if (images.size() > 1) {
-				Logger::logInfo("Atlas \"" + atlasName + "\" generated at " + toString(size.x) + "x" + toString(size.y) + " px with " + toString(images.size()) + " sprites. Total image area is " + toString(totalImageArea) + " px^2, sqrt = " + toString(lround(sqrt(totalImageArea))) + " px.");
-			}
-
-			
-			return makeAtlas(res.get(), size, spriteSheet);
+		candidates.push_back(size);
+		if (wide) {
+			wide = false;
+			curSize *= 2;
 		} else {
-			// Try 64x64, then 128x64, 128x128, 256x128, etc
-			if (wide) {
-				wide = false;
-				curSize *= 2;
-			} else {
-				wide = true;
+			wide = true;
+		}
+	}
+
+	// Try them in parallel, skipping any larger than one that already worked
+	std::vector<boost::optional<Vector<BinPackResult>>> results(candidates.size());
+	std::atomic<size_t> firstSuccess(candidates.size());
+	Concurrent::parallelFor(Executors::getCPUAux(), Range<size_t>(0, candidates.size()), 1, [&] (size_t start, size_t end)
+	{
+		for (size_t i = start; i < end && i < firstSuccess; ++i) {
+			results[i] = BinPack::pack(entries, Vector2i(candidates[i].x / cellSize, candidates[i].y / cellSize));
+			if (results[i]) {
+				size_t prev = firstSuccess;
+				while (i < prev && !firstSuccess.compare_exchange_weak(prev, i)) {}
 			}
 		}
+	});
+
+	if (firstSuccess == candidates.size()) {
+		// Give up!
+		throw Exception("Unable to pack " + toString(entries.size()) + " sprites in a reasonably sized atlas \"" + atlasName + "\"! maxSize is " + toString(maxSize) + ". Total image area is " + toString(totalImageArea) + " px^2, sqrt = " + toString(lround(sqrt(totalImageArea))) + " px.", HalleyExceptions::Tools);
 	}
+
+	packed = std::move(results[firstSuccess]);
+	return candidates[firstSuccess];
 }
 
-std::unique_ptr<Image> SpriteImporter::makeAtlas(const std::vector<BinPackResult>& result, Vector2i origSize, SpriteSheet& spriteSheet)
+std::unique_ptr<Image> SpriteImporter::makeAtlas(const std::vector<BinPackResult>& result, Vector2i origSize, SpriteSheet& spriteSheet, int padding)
 {
-	Vector2i size = shrinkAtlas(result);
+	Vector2i size = shrinkAtlas(result, padding);
 
 	auto image = std::make_unique<Image>(Image::Format::RGBA, size);
 	image->clear(0);
@@ -241,6 +346,9 @@ std::unique_ptr<Image> SpriteImporter::makeAtlas(const std::vector<BinPackResult
 	for (auto& packedImg: result) {
 		ImageData* img = reinterpret_cast<ImageData*>(packedImg.data);
 		image->blitFrom(packedImg.rect.getTopLeft(), *img->img, img->clip, packedImg.rotated);
+		if (padding > 0) {
+			extrudeEdges(*image, packedImg.rect, padding);
+		}
 
 		const auto borderTL = img->clip.getTopLeft();
 		const auto borderBR = img->img->getSize() - img->clip.getSize() - borderTL;
@@ -264,19 +372,40 @@ std::unique_ptr<Image> SpriteImporter::makeAtlas(const std::vector<BinPackResult
 	return image;
 }
 
-Vector2i SpriteImporter::shrinkAtlas(const std::vector<BinPackResult>& results) const
+Vector2i SpriteImporter::shrinkAtlas(const std::vector<BinPackResult>& results, int padding) const
 {
 	int w = 0;
 	int h = 0;
 
 	for (auto& r: results) {
-		w = std::max(w, r.rect.getRight());
-		h = std::max(h, r.rect.getBottom());
+		w = std::max(w, r.rect.getRight() + padding);
+		h = std::max(h, r.rect.getBottom() + padding);
 	}
 
 	return Vector2i(nextPowerOf2(w), nextPowerOf2(h));
 }
 
+void SpriteImporter::extrudeEdges(Image& image, Rect4i rect, int padding) const
+{
+	// Fills the padding around rect with copies of its outermost pixels
+	const auto imageSize = image.getSize();
+	const auto pixels = reinterpret_cast<uint32_t*>(image.getPixels());
+	const int x0 = std::max(0, rect.getLeft() - padding);
+	const int y0 = std::max(0, rect.getTop() - padding);
+	const int x1 = std::min(imageSize.x, rect.getRight() + padding);
+	const int y1 = std::min(imageSize.y, rect.getBottom() + padding);
+
+	for (int y = y0; y < y1; ++y) {
+		const int srcY = clamp(y, rect.getTop(), rect.getBottom() - 1);
+		for (int x = x0; x < x1; ++x) {
+			if (y != srcY || x < rect.getLeft() || x >= rect.getRight()) {
+				const int srcX = clamp(x, rect.getLeft(), rect.getRight() - 1);
+				pixels[y * imageSize.x + x] = pixels[srcY * imageSize.x + srcX];
+			}
+		}
+	}
+}
+
 std::vector<ImageData> SpriteImporter::splitImagesInGrid(const std::vector<ImageData>& images, Vector2i grid)
 {
 	std::vector<ImageData> result;
@@ -3,6 +3,9 @@
 #include "halley/file_formats/image.h"
 #include "halley/core/graphics/sprite/sprite_sheet.h"
 #include "halley/data_structures/bin_pack.h"
+#include "halley/data_structures/hash_map.h"
+#include "../../sprites/aseprite_reader.h"
+#include <mutex>
 
 namespace Halley
 {
@@ -28,16 +31,33 @@ namespace Halley
 	{
 	public:
 		ImportAssetType getType() const override { return ImportAssetType::Sprite; }
+		int getVersion() const override { return 1; }
 
 		void import(const ImportingAsset& asset, IAssetCollector& collector) override;
 		String getAssetId(const Path& file, const Maybe<Metadata>& metadata) const override;
 
 	private:
+		// Where each sprite went the last time each atlas was generated, so that a reimport can keep whatever didn't
+		// change in place, instead of packing everything from scratch
+		struct PreviousPacking
+		{
+			Vector2i size;
+			int padding = 0;
+			HashMap<String, Vector2i> positions;
+		};
+
+		AsepriteFrameCache asepriteFrameCache;
+		std::mutex packingMutex;
+		HashMap<String, PreviousPacking> previousPackings;
+
+		std::vector<ImageData> importImageData(const ImportingAssetFile& inputFile);
 		Animation generateAnimation(const String& spriteName, const String& spriteSheetName, const String& materialName, const std::vector<ImageData>& frameData);
 
-		std::unique_ptr<Image> generateAtlas(const String& atlasName, std::vector<ImageData>& images, SpriteSheet& spriteSheet);
-		std::unique_ptr<Image> makeAtlas(const std::vector<BinPackResult>& result, Vector2i size, SpriteSheet& spriteSheet);
-		Vector2i shrinkAtlas(const std::vector<BinPackResult>& results) const;
+		std::unique_ptr<Image> generateAtlas(const String& atlasName, std::vector<ImageData>& images, SpriteSheet& spriteSheet, int padding);
+		Vector2i packFromScratch(const String& atlasName, const std::vector<BinPackEntry>& entries, int64_t totalImageArea, int cellSize, boost::optional<Vector<BinPackResult>>& packed) const;
+		std::unique_ptr<Image> makeAtlas(const std::vector<BinPackResult>& result, Vector2i size, SpriteSheet& spriteSheet, int padding);
+		Vector2i shrinkAtlas(const std::vector<BinPackResult>& results, int padding) const;
+		void extrudeEdges(Image& image, Rect4i rect, int padding) const;
 
 		std::vector<ImageData> splitImagesInGrid(const std::vector<ImageData>& images, Vector2i grid);
 	};
@@ -2,6 +2,7 @@
 #include "halley/core/graphics/sprite/sprite_sheet.h"
 #include "halley/tools/file/filesystem.h"
 #include "halley/bytes/byte_serializer.h"
+#include "halley/core/resources/asset_database.h"
 
 using namespace Halley;
 
@@ -9,5 +10,8 @@ void SpriteSheetImporter::import(const ImportingAsset& asset, IAssetCollector& c
 {
 	SpriteSheet sheet;
 	sheet.loadJson(gsl::as_bytes(gsl::span<const Byte>(asset.inputFiles.at(0).data)));
-	collector.output(asset.assetId, AssetType::SpriteSheet, Serializer::toBytes(sheet));
+
+	Metadata meta;
+	AssetDatabase::addDependency(meta, AssetType::Texture, sheet.getTextureName());
+	collector.output(asset.assetId, AssetType::SpriteSheet, Serializer::toBytes(sheet), meta);
 }
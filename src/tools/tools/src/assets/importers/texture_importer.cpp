@@ -1,6 +1,9 @@
 #include "texture_importer.h"
 #include "halley/tools/assets/import_assets_database.h"
 #include "halley/tools/file/filesystem.h"
+#include "halley/tools/texture/mipmap_generator.h"
+#include "halley/tools/texture/texture_compressor.h"
+#include "halley/core/graphics/texture_descriptor.h"
 #include "halley/file_formats/image.h"
 
 using namespace Halley;
@@ -16,6 +19,54 @@ void TextureImporter::import(const ImportingAsset& asset, IAssetCollector& colle
 	Deserializer s(asset.inputFiles.at(0).data);
 	s >> image;
 
-	// Encode to PNG and save
-	collector.output(asset.assetId, AssetType::Texture, image.savePNGToBytes(), meta);
+	// "gpuCompression" lists the block compressed format for each platform, e.g. "pc:bc3, android:etc2".
+	// A format on its own applies to pc. Platforms not listed get a PNG, which is decoded when loading.
+	// "bc" picks BC1 or BC3 depending on whether the image needs the smooth alpha.
+	std::map<String, String> gpuFormats;
+	for (auto& entry: meta.getString("gpuCompression", "").split(',')) {
+		auto e = entry.trimBoth();
+		if (e.isEmpty()) {
+			continue;
+		}
+		auto parts = e.split(':');
+		auto platform = parts.size() > 1 ? parts[0].trimBoth() : String("pc");
+		gpuFormats[platform] = parts.back().trimBoth().asciiLower();
+	}
+	const auto quality = fromString<TextureCompressionQuality>(meta.getString("gpuQuality", "normal"));
+
+	// Mip chains are built here rather than on upload. "mipmapSRGB: false" filters in linear space, for data textures.
+	const bool useMipMap = meta.getBool("mipmap", false);
+	const int mipLevels = useMipMap ? std::min(MipMapGenerator::getMaxMipLevels(image.getSize()), std::max(1, meta.getInt("maxMipLevels", std::numeric_limits<int>::max()))) : 1;
+	Vector<Bytes> levels;
+	if (useMipMap || !gpuFormats.empty()) {
+		levels = MipMapGenerator::generate(image, mipLevels, meta.getBool("mipmapSRGB", true));
+	}
+
+	if (gpuFormats.find("pc") == gpuFormats.end()) {
+		if (useMipMap) {
+			// Stored uncompressed, as every level back to back
+			Bytes data;
+			for (auto& level: levels) {
+				data.insert(data.end(), level.begin(), level.end());
+			}
+			meta.set("compression", "raw");
+			meta.set("mipLevels", mipLevels);
+			if (meta.getString("asset_compression", "").isEmpty()) {
+				meta.set("asset_compression", "deflate");
+			}
+			collector.output(asset.assetId, AssetType::Texture, data, meta);
+		} else {
+			// Encode to PNG and save
+			collector.output(asset.assetId, AssetType::Texture, image.savePNGToBytes(), meta);
+		}
+	}
+
+	for (auto& gpuFormat: gpuFormats) {
+		const auto format = gpuFormat.second == "bc" ? TextureCompressor::pickBCFormat(levels.at(0)) : fromString<TextureFormat>(gpuFormat.second);
+		auto platformMeta = meta;
+		platformMeta.set("compression", "gpu");
+		platformMeta.set("format", toString(format));
+		platformMeta.set("mipLevels", mipLevels);
+		collector.output(asset.assetId, AssetType::Texture, TextureCompressor::compress(levels, image.getSize(), format, quality), platformMeta, gpuFormat.first);
+	}
 }
@@ -8,6 +8,8 @@ ComponentSchema::ComponentSchema() {}
 ComponentSchema::ComponentSchema(YAML::Node node)
 {
 	name = node["name"].as<std::string>();
+	replicated = node["replicated"].as<bool>(false);
+	serializable = node["serializable"].as<bool>(false) || replicated; // Replication sends the serialized data
 
 	for (auto memberEntry : node["members"]) {
 		for (auto m = memberEntry.begin(); m != memberEntry.end(); ++m) {
@@ -4,6 +4,7 @@
 #include <set>
 #include <halley/support/exception.h>
 #include <algorithm>
+#include <cstring>
 #include "halley/text/string_converter.h"
 
 using namespace Halley;
@@ -94,6 +95,9 @@ CodeGenResult CodegenCPP::generateRegistry(const Vector<ComponentSchema>& compon
 {
 	Vector<String> registryCpp {
 		"#include <halley.hpp>",
+		"#include <algorithm>",
+		"#include <array>",
+		"#include <cstring>",
 		"using namespace Halley;",
 		"",
 		"// System factory functions"
@@ -103,32 +107,40 @@ CodeGenResult CodegenCPP::generateRegistry(const Vector<ComponentSchema>& compon
 		registryCpp.push_back("System* halleyCreate" + sys.name + "System();");
 	}
 
+	// Sorted by name, so lookups are a binary search over a static table, with nothing to build on startup
+	Vector<String> systemNames;
+	for (auto& sys: systems) {
+		systemNames.push_back(sys.name);
+	}
+	std::sort(systemNames.begin(), systemNames.end(), [] (const String& a, const String& b) { return strcmp((a + "System").c_str(), (b + "System").c_str()) < 0; });
+
 	registryCpp.insert(registryCpp.end(), {
 		"",
 		"",
-		"using SystemFactoryPtr = System* (*)();",
-		"using SystemFactoryMap = HashMap<String, SystemFactoryPtr>;",
+		"namespace {",
+		"	struct SystemFactoryEntry {",
+		"		const char* name;",
+		"		System* (*create)();",
+		"	};",
 		"",
-		"static SystemFactoryMap makeSystemFactories() {",
-		"	SystemFactoryMap result;"
+		"	const std::array<SystemFactoryEntry, " + toString(systems.size()) + "> systemFactories = {{"
 	});
 
-	for (auto& sys : systems) {
-		registryCpp.push_back("	result[\"" + sys.name + "System\"] = &halleyCreate" + sys.name + "System;");
+	for (auto& name: systemNames) {
+		registryCpp.push_back("		{ \"" + name + "System\", &halleyCreate" + name + "System },");
 	}
 
 	registryCpp.insert(registryCpp.end(), {
-		"	return result;",
+		"	}};",
 		"}",
 		"",
 		"namespace Halley {",
 		"	std::unique_ptr<System> createSystem(String name) {",
-		"		static SystemFactoryMap factories = makeSystemFactories();",
-		"		auto result = factories.find(name);",
-		"		if (result == factories.end()) {",
+		"		auto result = std::lower_bound(systemFactories.begin(), systemFactories.end(), name.c_str(), [] (const SystemFactoryEntry& e, const char* n) { return strcmp(e.name, n) < 0; });",
+		"		if (result == systemFactories.end() || strcmp(result->name, name.c_str()) != 0) {",
 		"			throw Exception(\"System not found: \" + name, HalleyExceptions::Entity);",
 		"		}",
-		"		return std::unique_ptr<System>(result->second());",
+		"		return std::unique_ptr<System>(result->create());",
 		"	}",
 		"}"
 	});
@@ -163,8 +175,14 @@ Vector<String> CodegenCPP::generateComponentHeader(ComponentSchema component)
 
 	auto gen = CPPClassGenerator(component.name + "Component", "Halley::Component", CPPAccess::Public, true)
 		.addAccessLevelSection(CPPAccess::Public)
-		.addMember(VariableSchema(TypeSchema("int", false, true, true), "componentIndex", toString(component.id)))
-		.addBlankLine()
+		.addMember(VariableSchema(TypeSchema("int", false, true, true), "componentIndex", toString(component.id)));
+
+	if (component.replicated) {
+		// Picked up by EntityReplicator
+		gen.addMember(VariableSchema(TypeSchema("bool", false, true, true), "replicated", "true"));
+	}
+
+	gen.addBlankLine()
 		.addMembers(component.members)
 		.addBlankLine()
 		.addDefaultConstructor();
@@ -174,6 +192,20 @@ Vector<String> CodegenCPP::generateComponentHeader(ComponentSchema component)
 			.addConstructor(component.members);
 	}
 
+	if (component.serializable) {
+		// Used by World::snapshot, World::restore and entity replication
+		Vector<String> serializeBody;
+		Vector<String> deserializeBody;
+		for (auto& m: component.members) {
+			serializeBody.push_back("s << " + m.name + ";");
+			deserializeBody.push_back("s >> " + m.name + ";");
+		}
+		gen.addBlankLine()
+			.addMethodDefinition(MethodSchema(TypeSchema("void"), { VariableSchema(TypeSchema("Halley::Serializer&"), "s") }, "serialize", true), serializeBody)
+			.addBlankLine()
+			.addMethodDefinition(MethodSchema(TypeSchema("void"), { VariableSchema(TypeSchema("Halley::Deserializer&"), "s") }, "deserialize"), deserializeBody);
+	}
+
 	gen.finish()
 		.writeTo(contents);
 
@@ -318,6 +350,7 @@ Vector<String> CodegenCPP::generateSystemHeader(SystemSchema& system) const
 	for (auto& msg : system.messages) {
 		if (msg.send) {
 			sysClassGen.addMethodDefinition(MethodSchema(TypeSchema("void"), { VariableSchema(TypeSchema("Halley::EntityId"), "entityId"), VariableSchema(TypeSchema(msg.name + "Message&", true), "msg") }, "sendMessage"), "sendMessageGeneric(entityId, msg);");
+			sysClassGen.addMethodDefinition(MethodSchema(TypeSchema("void"), { VariableSchema(TypeSchema(msg.name + "Message&", true), "msg") }, "broadcastMessage"), "broadcastMessageGeneric(msg);");
 		}
 		if (msg.receive) {
 			hasReceive = true;
@@ -374,9 +407,46 @@ Vector<String> CodegenCPP::generateSystemHeader(SystemSchema& system) const
 			.addBlankLine();
 	}
 
+	// Dependencies, used to schedule systems in parallel
+	std::set<String> componentsRead;
+	std::set<String> componentsWritten;
+	for (auto& fam : system.families) {
+		for (auto& comp : fam.components) {
+			(comp.write ? componentsWritten : componentsRead).insert(comp.name + "Component::componentIndex");
+		}
+	}
+	for (auto& comp : componentsWritten) {
+		componentsRead.erase(comp);
+	}
+
+	Vector<String> dependencyFlags;
+	if ((int(system.access) & int(SystemAccess::World)) != 0 || system.strategy == SystemStrategy::Parallel) {
+		dependencyFlags.push_back("Halley::SystemDependencies::Exclusive");
+	}
+	if ((int(system.access) & int(SystemAccess::API)) != 0) {
+		dependencyFlags.push_back("Halley::SystemDependencies::API");
+	}
+	if ((int(system.access) & int(SystemAccess::Resources)) != 0) {
+		dependencyFlags.push_back("Halley::SystemDependencies::Resources");
+	}
+	if (std::any_of(system.messages.begin(), system.messages.end(), [](auto& msg) { return msg.send; })) {
+		dependencyFlags.push_back("Halley::SystemDependencies::SendsMessages");
+	}
+	if (hasReceive) {
+		dependencyFlags.push_back("Halley::SystemDependencies::ReceivesMessages");
+	}
+	if (dependencyFlags.empty()) {
+		dependencyFlags.push_back("Halley::SystemDependencies::None");
+	}
+
+	auto services = convert<ServiceSchema, String>(system.services, [](auto& service) { return "\"" + service.name + "\""; });
+	String dependencies = "Halley::SystemDependencies({" + String::concatList(Vector<String>(componentsRead.begin(), componentsRead.end()), ", ") + "}, {"
+		+ String::concatList(Vector<String>(componentsWritten.begin(), componentsWritten.end()), ", ") + "}, "
+		+ String::concatList(dependencyFlags, " | ") + ", {" + String::concatList(services, ", ") + "})";
+
 	sysClassGen
 		.addAccessLevelSection(CPPAccess::Public)
-		.addCustomConstructor({}, { VariableSchema(TypeSchema(""), "System", "{" + String::concatList(convert<FamilySchema, String>(system.families, [](auto& fam) { return "&" + fam.name + "Family"; }), ", ") + "}, {" + String::concatList(msgsReceived, ", ") + "}") })
+		.addCustomConstructor({}, { VariableSchema(TypeSchema(""), "System", "{" + String::concatList(convert<FamilySchema, String>(system.families, [](auto& fam) { return "&" + fam.name + "Family"; }), ", ") + "}, {" + String::concatList(msgsReceived, ", ") + "}, " + dependencies) })
 		.finish()
 		.writeTo(contents);
 
@@ -1,36 +1,137 @@
 #include "halley/tools/distance_field/distance_field_generator.h"
 #include <cassert>
+#include <climits>
+#include <vector>
 #include <halley/file_formats/image.h>
+#include <halley/concurrency/concurrent.h>
+#include <halley/concurrency/executor.h>
 #include <gsl/gsl_assert>
 
 using namespace Halley;
 
-static float getDistanceAt(const int* src, int srcW, int srcH, int xCentre, int yCentre, float radius)
-{
-	auto getAlpha = [&](int x, int y) { return (src[x + y * srcW] & 0xFF000000) >> 24; };
-	bool isInside = getAlpha(xCentre, yCentre) > 127;
-	if (radius < 0.001f) {
-		return isInside ? 1.0f : 0.0f;
+namespace {
+	constexpr float infinity = 1e20f;
+
+	template <typename F>
+	void forEachRange(size_t n, size_t grain, F f)
+	{
+		if (Executors::hasInstance()) {
+			Concurrent::parallelFor(Executors::getCPU(), Range<size_t>(0, n), grain, f);
+		} else {
+			f(0, n);
+		}
 	}
 
-	int iRadius = int(ceil(radius));
-	int x0 = std::max(0, xCentre - iRadius);
-	int x1 = std::min(xCentre + iRadius, srcW - 1);
-	int y0 = std::max(0, yCentre - iRadius);
-	int y1 = std::min(yCentre + iRadius, srcH - 1);
-
-	int bestDistSqr = 2147483647;
-	for (int y = y0; y <= y1; y++) {
-		for (int x = x0; x <= x1; x++) {
-			bool thisInside = getAlpha(x, y) > 127;
-			if (isInside != thisInside) {
-				// Candidate for best neighbour
-				int distSqr = (x - xCentre) * (x - xCentre) + (y - yCentre) * (y - yCentre);
-				bestDistSqr = std::min(distSqr, bestDistSqr);
+	// Felzenszwalb & Huttenlocher's squared distance transform of a sampled function, in one dimension: each sample
+	// becomes min over q of (p - q)^2 + f(q), in linear time, by keeping the lower envelope of the parabolas rooted at
+	// each sample. f is read and written with the given stride; the rest is scratch space for n samples.
+	void transform1D(float* f, int n, size_t stride, float* d, int* v, float* z)
+	{
+		int k = 0;
+		v[0] = 0;
+		z[0] = -infinity;
+		z[1] = infinity;
+		for (int q = 1; q < n; ++q) {
+			const float fq = f[q * stride] + float(q) * float(q);
+			float s = (fq - (f[v[k] * stride] + float(v[k]) * float(v[k]))) / float(2 * (q - v[k]));
+			while (s <= z[k]) {
+				--k;
+				s = (fq - (f[v[k] * stride] + float(v[k]) * float(v[k]))) / float(2 * (q - v[k]));
+			}
+			++k;
+			v[k] = q;
+			z[k] = s;
+			z[k + 1] = infinity;
+		}
+
+		k = 0;
+		for (int q = 0; q < n; ++q) {
+			while (z[k + 1] < float(q)) {
+				++k;
 			}
+			const float dq = float(q - v[k]);
+			d[q] = dq * dq + f[v[k] * stride];
 		}
+		for (int q = 0; q < n; ++q) {
+			f[q * stride] = d[q];
+		}
+	}
+
+	// Squared distance from each pixel to the nearest one set to 0, with the others set to infinity.
+	// Rows and then columns are independent of each other, so each pass is spread over the CPU.
+	void transform2D(std::vector<float>& grid, int w, int h)
+	{
+		forEachRange(size_t(h), 16, [&] (size_t start, size_t end)
+		{
+			std::vector<float> d(w);
+			std::vector<int> v(w);
+			std::vector<float> z(w + 1);
+			for (size_t y = start; y < end; ++y) {
+				transform1D(grid.data() + y * w, w, 1, d.data(), v.data(), z.data());
+			}
+		});
+
+		forEachRange(size_t(w), 16, [&] (size_t start, size_t end)
+		{
+			std::vector<float> d(h);
+			std::vector<int> v(h);
+			std::vector<float> z(h + 1);
+			for (size_t x = start; x < end; ++x) {
+				transform1D(grid.data() + x, h, size_t(w), d.data(), v.data(), z.data());
+			}
+		});
 	}
 
+	class DistanceMap
+	{
+	public:
+		DistanceMap(const int* src, int w, int h)
+			: w(w)
+			, inside(size_t(w) * size_t(h))
+			, toInside(inside.size())
+			, toOutside(inside.size())
+		{
+			for (size_t i = 0; i < inside.size(); ++i) {
+				inside[i] = ((src[i] & 0xFF000000) >> 24) > 127;
+				toInside[i] = inside[i] ? 0.0f : infinity;
+				toOutside[i] = inside[i] ? infinity : 0.0f;
+			}
+			transform2D(toInside, w, h);
+			transform2D(toOutside, w, h);
+		}
+
+		bool isInside(int x, int y) const
+		{
+			return inside[x + size_t(y) * w] != 0;
+		}
+
+		// Squared distance to the nearest pixel on the other side of the edge
+		float getDistanceSqr(int x, int y) const
+		{
+			const size_t i = x + size_t(y) * w;
+			return inside[i] ? toOutside[i] : toInside[i];
+		}
+
+	private:
+		int w;
+		std::vector<char> inside;
+		std::vector<float> toInside;
+		std::vector<float> toOutside;
+	};
+}
+
+static float getDistanceAt(const DistanceMap& map, int xCentre, int yCentre, float radius)
+{
+	bool isInside = map.isInside(xCentre, yCentre);
+	if (radius < 0.001f) {
+		return isInside ? 1.0f : 0.0f;
+	}
+
+	// Anything beyond the corners of the square that was searched before counts as not found, and saturates
+	const int iRadius = int(ceil(radius));
+	const float distSqr = map.getDistanceSqr(xCentre, yCentre);
+	const int bestDistSqr = distSqr <= float(2 * iRadius * iRadius) ? int(distSqr) : 2147483647;
+
 	const float dist = float(sqrt(bestDistSqr));
 	const float normalDistance = (2 * dist - 1) / (2 * radius);
 	const float finalValue = 0.5f * (isInside ? 1.0f + normalDistance : 1.0f - normalDistance);
@@ -54,21 +155,26 @@ std::unique_ptr<Image> DistanceFieldGenerator::generate(Image& srcImg, Vector2i
 	int texelW = srcW / w;
 	int texelH = srcH / h;
 
-	for (int y = 0; y < h; y++) {
-		for (int x = 0; x < w; x++) {
-			int* dst = dstStart + x + y * w;
-			float distAcc = 0;
-			// For each sub-pixel, compute the distance to closest pixel of the opposite value
-			// Then average it all
-			for (int j = 0; j < texelH; j++) {
-				for (int i = 0; i < texelW; i++) {
-					distAcc += getDistanceAt(src, srcW, srcH, x * srcW / w + i, y * srcH / h + j, radius * srcW / w);
+	const DistanceMap map(src, srcW, srcH);
+
+	forEachRange(size_t(h), 8, [&] (size_t start, size_t end)
+	{
+		for (int y = int(start); y < int(end); y++) {
+			for (int x = 0; x < w; x++) {
+				int* dst = dstStart + x + y * w;
+				float distAcc = 0;
+				// For each sub-pixel, find the distance to closest pixel of the opposite value
+				// Then average it all
+				for (int j = 0; j < texelH; j++) {
+					for (int i = 0; i < texelW; i++) {
+						distAcc += getDistanceAt(map, x * srcW / w + i, y * srcH / h + j, radius * srcW / w);
+					}
 				}
+				int distance = clamp(int(distAcc * 255 / (texelW * texelH)), 0, 255);
+				*dst = Image::convertRGBAToInt(255, 255, 255, distance);
 			}
-			int distance = clamp(int(distAcc * 255 / (texelW * texelH)), 0, 255);
-			*dst = Image::convertRGBAToInt(255, 255, 255, distance);
 		}
-	}
+	});
 
 	return dstImg;
 }
@@ -68,6 +68,13 @@ bool FileSystem::remove(const Path& path)
 	return nRemoved > 0 && ec.value() == 0;
 }
 
+bool FileSystem::rename(const Path& from, const Path& to)
+{
+	boost::system::error_code ec;
+	boost::filesystem::rename(getNative(from), getNative(to), ec);
+	return ec.value() == 0;
+}
+
 void FileSystem::writeFile(const Path& path, gsl::span<const gsl::byte> data)
 {
 	createParentDir(path);
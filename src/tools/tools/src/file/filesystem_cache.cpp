@@ -0,0 +1,409 @@
+#include "halley/tools/file/filesystem_cache.h"
+#include "halley/tools/file/filesystem.h"
+#include "halley/support/exception.h"
+#include "halley/concurrency/concurrent.h"
+#include <boost/filesystem.hpp>
+#include <algorithm>
+
+using namespace Halley;
+
+struct FileSystemCache::ScannedEntry
+{
+	String name;
+	bool isDirectory = false;
+	int64_t lastWriteTime = 0;
+	std::vector<ScannedEntry> children;
+};
+
+void FileSystemCache::addRoot(const Path& rootPath)
+{
+	ScannedEntry scanned;
+	const bool found = scanDisk(rootPath, scanned, true);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto iter = std::find_if(roots.begin(), roots.end(), [&] (const Root& r) { return r.path == rootPath; });
+	if (iter == roots.end()) {
+		roots.emplace_back();
+		roots.back().path = rootPath;
+		iter = roots.end() - 1;
+	}
+	applyScan(*iter, Path("."), found ? &scanned : nullptr);
+}
+
+void FileSystemCache::applyChanges(const Path& rootPath, const DirectoryMonitor::Changes& changes)
+{
+	// Work out what to scan, scan it without holding the lock, then merge the results in
+	std::vector<Path> toScan;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		const auto& root = getRoot(rootPath);
+		if (changes.fullRescan || root.nodes.empty()) {
+			toScan.push_back(Path("."));
+		} else {
+			for (auto& path: changes.paths) {
+				toScan.push_back(findScanStart(root, path));
+			}
+		}
+	}
+	toScan.erase(std::unique(toScan.begin(), toScan.end()), toScan.end());
+
+	std::vector<ScannedEntry> scanned(toScan.size());
+	std::vector<char> found(toScan.size());
+	for (size_t i = 0; i < toScan.size(); ++i) {
+		found[i] = scanDisk(rootPath / toScan[i], scanned[i], changes.fullRescan) ? 1 : 0;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto& root = getRoot(rootPath);
+	for (size_t i = 0; i < toScan.size(); ++i) {
+		applyScan(root, toScan[i], found[i] ? &scanned[i] : nullptr);
+	}
+}
+
+uint64_t FileSystemCache::getGeneration(const Path& rootPath) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return getRoot(rootPath).generation;
+}
+
+bool FileSystemCache::exists(const Path& p) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	bool inRoot;
+	const auto* node = findNode(p, inRoot);
+	return inRoot ? node != nullptr : FileSystem::exists(p);
+}
+
+bool FileSystemCache::isFile(const Path& p) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	bool inRoot;
+	const auto* node = findNode(p, inRoot);
+	return inRoot ? node && !node->isDirectory : FileSystem::isFile(p);
+}
+
+bool FileSystemCache::isDirectory(const Path& p) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	bool inRoot;
+	const auto* node = findNode(p, inRoot);
+	return inRoot ? node && node->isDirectory : FileSystem::isDirectory(p);
+}
+
+int64_t FileSystemCache::getLastWriteTime(const Path& p) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	bool inRoot;
+	const auto* node = findNode(p, inRoot);
+	return inRoot ? (node ? node->lastWriteTime : 0) : FileSystem::getLastWriteTime(p);
+}
+
+std::vector<Path> FileSystemCache::enumerateDirectory(const Path& p) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	bool inRoot;
+	const auto* node = findNode(p, inRoot);
+	if (!inRoot) {
+		return FileSystem::enumerateDirectory(p);
+	}
+
+	std::vector<Path> result;
+	if (node && node->isDirectory) {
+		size_t firstPart;
+		collectFiles(*findRoot(p, firstPart), *node, "", result);
+	}
+	return result;
+}
+
+uint32_t FileSystemCache::internSegment(const String& segment)
+{
+	const auto iter = segmentIds.find(segment);
+	if (iter != segmentIds.end()) {
+		return iter->second;
+	}
+	const auto id = uint32_t(segments.size());
+	segments.push_back(segment);
+	segmentIds[segment] = id;
+	return id;
+}
+
+Maybe<uint32_t> FileSystemCache::findSegment(const String& segment) const
+{
+	const auto iter = segmentIds.find(segment);
+	if (iter != segmentIds.end()) {
+		return iter->second;
+	}
+	return {};
+}
+
+uint64_t FileSystemCache::makeKey(uint32_t parent, uint32_t segment)
+{
+	return (uint64_t(parent) << 32) | uint64_t(segment);
+}
+
+FileSystemCache::Root& FileSystemCache::getRoot(const Path& rootPath)
+{
+	return const_cast<Root&>(static_cast<const FileSystemCache*>(this)->getRoot(rootPath));
+}
+
+const FileSystemCache::Root& FileSystemCache::getRoot(const Path& rootPath) const
+{
+	for (auto& root: roots) {
+		if (root.path == rootPath) {
+			return root;
+		}
+	}
+	throw Exception("Path is not a root of this cache: " + rootPath.toString(), HalleyExceptions::Tools);
+}
+
+const FileSystemCache::Root* FileSystemCache::findRoot(const Path& p, size_t& firstPart) const
+{
+	// Longest root that's a prefix of p
+	const auto& parts = p.getParts();
+	const Root* result = nullptr;
+	firstPart = 0;
+	for (auto& root: roots) {
+		const auto& rootParts = root.path.getParts();
+		if (rootParts.size() <= parts.size() && (!result || rootParts.size() > firstPart) && std::equal(rootParts.begin(), rootParts.end(), parts.begin())) {
+			result = &root;
+			firstPart = rootParts.size();
+		}
+	}
+	return result;
+}
+
+const FileSystemCache::Node* FileSystemCache::findNode(const Path& p, bool& inRoot) const
+{
+	size_t firstPart;
+	const auto* root = findRoot(p, firstPart);
+	inRoot = root != nullptr;
+	if (!root || root->nodes.empty()) {
+		return nullptr;
+	}
+
+	const auto& parts = p.getParts();
+	uint32_t idx = 0;
+	for (size_t i = firstPart; i < parts.size(); ++i) {
+		if (parts[i] == ".") {
+			continue;
+		}
+		const auto segment = findSegment(parts[i]);
+		if (!segment) {
+			return nullptr;
+		}
+		idx = findChild(*root, idx, segment.get());
+		if (idx == invalidNode) {
+			return nullptr;
+		}
+	}
+	return &root->nodes[idx];
+}
+
+uint32_t FileSystemCache::findChild(const Root& root, uint32_t parent, uint32_t segment) const
+{
+	const auto iter = root.nodeLookup.find(makeKey(parent, segment));
+	return iter != root.nodeLookup.end() ? iter->second : invalidNode;
+}
+
+uint32_t FileSystemCache::addNode(Root& root, uint32_t parent, uint32_t segment)
+{
+	uint32_t idx;
+	if (root.freeNodes.empty()) {
+		idx = uint32_t(root.nodes.size());
+		root.nodes.emplace_back();
+	} else {
+		idx = root.freeNodes.back();
+		root.freeNodes.pop_back();
+	}
+
+	auto& node = root.nodes[idx];
+	node.parent = parent;
+	node.segment = segment;
+	root.nodes[parent].children.push_back(idx);
+	root.nodeLookup[makeKey(parent, segment)] = idx;
+	return idx;
+}
+
+void FileSystemCache::removeNode(Root& root, uint32_t idx)
+{
+	auto& siblings = root.nodes[root.nodes[idx].parent].children;
+	siblings.erase(std::find(siblings.begin(), siblings.end(), idx));
+	freeNode(root, idx);
+}
+
+void FileSystemCache::freeNode(Root& root, uint32_t idx)
+{
+	auto& node = root.nodes[idx];
+	for (auto child: node.children) {
+		freeNode(root, child);
+	}
+	root.nodeLookup.erase(makeKey(node.parent, node.segment));
+	node = Node();
+	root.freeNodes.push_back(idx);
+}
+
+bool FileSystemCache::scanDisk(const Path& fullPath, ScannedEntry& entry, bool parallel)
+{
+	using namespace boost::filesystem;
+
+	boost::system::error_code ec;
+	const path native(fullPath.string());
+	const auto fileStatus = status(native, ec);
+	if (ec || !boost::filesystem::exists(fileStatus)) {
+		return false;
+	}
+	entry.isDirectory = is_directory(fileStatus);
+	entry.lastWriteTime = last_write_time(native, ec);
+	if (ec) {
+		entry.lastWriteTime = 0;
+	}
+
+	if (entry.isDirectory) {
+		for (directory_iterator iter(native, ec), end; !ec && iter != end; iter.increment(ec)) {
+			entry.children.emplace_back();
+			entry.children.back().name = iter->path().filename().string();
+		}
+
+		// Subtrees are independent, so a full scan hands each entry at the top to a different thread
+		auto scanChildren = [&] (size_t start, size_t end)
+		{
+			for (size_t i = start; i < end; ++i) {
+				auto& child = entry.children[i];
+				if (!scanDisk(fullPath / child.name, child, false)) {
+					child.name = ""; // Removed since it was listed
+				}
+			}
+		};
+		if (parallel && Executors::hasInstance()) {
+			Concurrent::parallelFor(Executors::getCPUAux(), Range<size_t>(0, entry.children.size()), 1, scanChildren);
+		} else {
+			scanChildren(0, entry.children.size());
+		}
+		entry.children.erase(std::remove_if(entry.children.begin(), entry.children.end(), [] (const ScannedEntry& e) { return e.name.isEmpty(); }), entry.children.end());
+	}
+	return true;
+}
+
+Path FileSystemCache::findScanStart(const Root& root, const Path& relPath) const
+{
+	// A changed path under a directory the snapshot doesn't know about yet needs that whole directory scanned
+	const auto& parts = relPath.getParts();
+	uint32_t idx = 0;
+	for (size_t i = 0; i < parts.size() && !root.nodes.empty(); ++i) {
+		if (parts[i] == ".") {
+			continue;
+		}
+		const auto segment = findSegment(parts[i]);
+		idx = segment ? findChild(root, idx, segment.get()) : invalidNode;
+		if (idx == invalidNode) {
+			return relPath.getFront(i + 1);
+		}
+	}
+	return relPath;
+}
+
+void FileSystemCache::applyScan(Root& root, const Path& relPath, ScannedEntry* scanned)
+{
+	bool changed = false;
+
+	const auto& parts = relPath.getParts();
+	size_t last = parts.size();
+	while (last > 0 && parts[last - 1] == ".") {
+		--last;
+	}
+
+	if (last == 0) {
+		if (!scanned) {
+			changed = !root.nodes.empty();
+			root.nodes.clear();
+			root.freeNodes.clear();
+			root.nodeLookup.clear();
+		} else {
+			if (root.nodes.empty()) {
+				root.nodes.emplace_back();
+				changed = true;
+			}
+			changed |= merge(root, 0, *scanned);
+		}
+	} else if (!root.nodes.empty()) {
+		uint32_t idx = 0;
+		for (size_t i = 0; i < last; ++i) {
+			if (parts[i] == ".") {
+				continue;
+			}
+			const auto segment = internSegment(parts[i]);
+			auto child = findChild(root, idx, segment);
+			if (i == last - 1) {
+				if (scanned) {
+					if (child == invalidNode) {
+						child = addNode(root, idx, segment);
+						changed = true;
+					}
+					changed |= merge(root, child, *scanned);
+				} else if (child != invalidNode) {
+					removeNode(root, child);
+					changed = true;
+				}
+			} else if (child == invalidNode) {
+				// Its parent went missing in the meantime, which will show up as a change of its own
+				break;
+			}
+			idx = child;
+		}
+	}
+
+	if (changed) {
+		++root.generation;
+	}
+}
+
+bool FileSystemCache::merge(Root& root, uint32_t idx, const ScannedEntry& scanned)
+{
+	bool changed = false;
+	{
+		auto& node = root.nodes[idx];
+		changed = node.isDirectory != scanned.isDirectory || node.lastWriteTime != scanned.lastWriteTime;
+		node.isDirectory = scanned.isDirectory;
+		node.lastWriteTime = scanned.lastWriteTime;
+	}
+
+	std::vector<uint32_t> scannedSegments;
+	scannedSegments.reserve(scanned.children.size());
+	for (auto& child: scanned.children) {
+		scannedSegments.push_back(internSegment(child.name));
+	}
+
+	// Drop whatever isn't there anymore
+	auto sortedSegments = scannedSegments;
+	std::sort(sortedSegments.begin(), sortedSegments.end());
+	const auto oldChildren = root.nodes[idx].children;
+	for (auto child: oldChildren) {
+		if (!std::binary_search(sortedSegments.begin(), sortedSegments.end(), root.nodes[child].segment)) {
+			removeNode(root, child);
+			changed = true;
+		}
+	}
+
+	for (size_t i = 0; i < scanned.children.size(); ++i) {
+		auto child = findChild(root, idx, scannedSegments[i]);
+		if (child == invalidNode) {
+			child = addNode(root, idx, scannedSegments[i]);
+			changed = true;
+		}
+		changed |= merge(root, child, scanned.children[i]);
+	}
+
+	return changed;
+}
+
+void FileSystemCache::collectFiles(const Root& root, const Node& node, const String& prefix, std::vector<Path>& result) const
+{
+	for (auto childIdx: node.children) {
+		const auto& child = root.nodes[childIdx];
+		if (child.isDirectory) {
+			collectFiles(root, child, prefix + segments[child.segment] + "/", result);
+		} else {
+			result.push_back(Path(prefix + segments[child.segment]));
+		}
+	}
+}
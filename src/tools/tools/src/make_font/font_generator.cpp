@@ -10,11 +10,21 @@
 #include "halley/bytes/byte_serializer.h"
 #include "halley/file/path.h"
 #include "halley/concurrency/concurrent.h"
+#include "halley/concurrency/executor.h"
 #include "halley/tools/file/filesystem.h"
 #include "halley/core/graphics/text/font.h"
+#include "halley/bytes/compression.h"
 
 using namespace Halley;
 
+static Vector2i getFinalGlyphSize(FontFace& font, int code, float scale, float borderSuperSampled)
+{
+	Vector2i glyphSize = font.getGlyphSize(code);
+	int padding = int(2 * borderSuperSampled);
+	Vector2i superSampleSize = glyphSize + Vector2i(padding, padding);
+	return Vector2i(Vector2f(superSampleSize) * scale + Vector2f(1, 1));
+}
+
 static boost::optional<Vector<BinPackResult>> tryPacking(FontFace& font, float fontSize, Vector2i packSize, float scale, float borderSuperSampled, const std::vector<int>& characters)
 {
 	font.setSize(fontSize);
@@ -22,10 +32,7 @@ static boost::optional<Vector<BinPackResult>> tryPacking(FontFace& font, float f
 	Vector<BinPackEntry> entries;
 	for (int code : font.getCharCodes()) {
 		if (std::binary_search(characters.begin(), characters.end(), code)) {
-			Vector2i glyphSize = font.getGlyphSize(code);
-			int padding = int(2 * borderSuperSampled);
-			Vector2i superSampleSize = glyphSize + Vector2i(padding, padding);
-			Vector2i finalSize(Vector2f(superSampleSize) * scale + Vector2f(1, 1));
+			Vector2i finalSize = getFinalGlyphSize(font, code, scale, borderSuperSampled);
 
 			size_t payload = size_t(code);
 			entries.push_back(BinPackEntry(finalSize, reinterpret_cast<void*>(payload)));
@@ -132,7 +139,6 @@ FontGeneratorResult FontGenerator::generateFont(const Metadata& meta, gsl::span<
 	dstImg->clear(0);
 
 	Vector<CharcodeEntry> codes;
-	Vector<Future<void>> futures;
 	std::mutex m;
 	std::atomic<int> nDone(0);
 	std::atomic<bool> keepGoing(true);
@@ -143,16 +149,21 @@ FontGeneratorResult FontGenerator::generateFont(const Metadata& meta, gsl::span<
 	}
 
 	for (auto& r : pack) {
-		int charcode = int(reinterpret_cast<size_t>(r.data));
-		Rect4i dstRect = r.rect;
-		Rect4i srcRect = dstRect * superSample;
-		codes.push_back(CharcodeEntry(charcode, dstRect));
+		codes.push_back(CharcodeEntry(int(reinterpret_cast<size_t>(r.data)), r.rect));
+	}
 
-		futures.push_back(Concurrent::execute([=, &m, &font, &dstImg, &nDone, &keepGoing] {
+	// Runs on the same queue as the import itself (with this thread helping), so a font that takes a long time doesn't hold up a thread doing nothing
+	Concurrent::parallelFor(Executors::getCPUAux(), Range<size_t>(0, pack.size()), 1, [&] (size_t start, size_t end)
+	{
+		for (size_t i = start; i < end; ++i) {
 			if (!keepGoing) {
 				return;
 			}
 
+			const int charcode = codes[i].charcode;
+			const Rect4i dstRect = codes[i].rect;
+			const Rect4i srcRect = dstRect * superSample;
+
 			if (verbose) {
 				std::cout << "+";
 			}
@@ -181,13 +192,10 @@ FontGeneratorResult FontGenerator::generateFont(const Metadata& meta, gsl::span<
 			if (!progressReporter(progress, "Generating")) {
 				keepGoing = false;
 			}
-		}));
-	}
+		}
+	});
 	std::sort(codes.begin(), codes.end(), [](const CharcodeEntry& a, const CharcodeEntry& b) { return a.charcode < b.charcode; });
 
-	for (auto& f : futures) {
-		f.get();
-	}
 	if (!keepGoing) {
 		return FontGeneratorResult();
 	}
@@ -209,6 +217,96 @@ FontGeneratorResult FontGenerator::generateFont(const Metadata& meta, gsl::span<
 	return genResult;
 }
 
+FontGeneratorResult FontGenerator::generateDynamicFont(const Metadata& meta, gsl::span<const gsl::byte> fontFile, float fontSize, float replacementScale, Vector2i atlasSize, float radius, int superSample, std::vector<int> characters)
+{
+	std::sort(characters.begin(), characters.end());
+
+	const float scale = 1.0f / superSample;
+	const float borderFinal = ceil(radius);
+	const float borderSuperSample = borderFinal * superSample;
+
+	if (!progressReporter(0, "Measuring")) {
+		return FontGeneratorResult();
+	}
+
+	FontFace font(fontFile);
+	font.setSize(fontSize);
+
+	// Every glyph gets its own distance field, which the runtime packs into an atlas when it's first used
+	Vector<CharcodeEntry> codes;
+	for (int code : font.getCharCodes()) {
+		if (std::binary_search(characters.begin(), characters.end(), code)) {
+			codes.push_back(CharcodeEntry(code, Rect4i(Vector2i(), getFinalGlyphSize(font, code, scale, borderSuperSample))));
+		}
+	}
+
+	if (verbose) {
+		std::cout << "Rendering " << codes.size() << " glyphs";
+	}
+
+	Vector<Bytes> bitmaps(codes.size());
+	std::mutex m;
+	std::atomic<int> nDone(0);
+	std::atomic<bool> keepGoing(true);
+
+	Concurrent::parallelFor(Executors::getCPUAux(), Range<size_t>(0, codes.size()), 1, [&] (size_t start, size_t end)
+	{
+		for (size_t i = start; i < end; ++i) {
+			if (!keepGoing) {
+				return;
+			}
+
+			const int charcode = codes[i].charcode;
+			const Vector2i dstSize = codes[i].rect.getSize();
+
+			auto tmpImg = std::make_unique<Image>(Image::Format::RGBA, dstSize * superSample);
+			tmpImg->clear(0);
+			{
+				std::lock_guard<std::mutex> g(m);
+				font.drawGlyph(*tmpImg, charcode, Vector2i(lround(borderSuperSample), lround(borderSuperSample)));
+			}
+
+			if (!keepGoing) {
+				return;
+			}
+			auto finalGlyphImg = DistanceFieldGenerator::generate(*tmpImg, dstSize, radius);
+
+			// Only the distance (in alpha) is kept; the rest is always white
+			const size_t nPixels = size_t(dstSize.x) * size_t(dstSize.y);
+			const int* src = reinterpret_cast<const int*>(finalGlyphImg->getPixels());
+			Bytes alpha(nPixels);
+			for (size_t j = 0; j < nPixels; ++j) {
+				alpha[j] = Byte((src[j] & 0xFF000000) >> 24);
+			}
+			bitmaps[i] = Compression::compress(alpha);
+
+			float progress = lerp(0.05f, 0.95f, float(++nDone) / float(codes.size()));
+			if (!progressReporter(progress, "Generating")) {
+				keepGoing = false;
+			}
+		}
+	});
+
+	if (!keepGoing) {
+		return FontGeneratorResult();
+	}
+
+	if (verbose) {
+		std::cout << " Done generating." << std::endl;
+	}
+
+	FontGeneratorResult genResult;
+	genResult.success = true;
+	genResult.font = generateFontMapBinary(meta, font, codes, scale, replacementScale, radius, Vector2i());
+	genResult.font->setDynamicAtlas(atlasSize);
+	for (size_t i = 0; i < codes.size(); ++i) {
+		genResult.font->addGlyphBitmap(codes[i].charcode, std::move(bitmaps[i]));
+	}
+	progressReporter(1.0f, "Done");
+
+	return genResult;
+}
+
 std::unique_ptr<Font> FontGenerator::generateFontMapBinary(const Metadata& meta, FontFace& font, Vector<CharcodeEntry>& entries, float scale, float replacementScale, float radius, Vector2i imageSize) const
 {
 	String fontName = meta.getString("fontName", font.getName());
@@ -234,7 +332,8 @@ std::unique_ptr<Font> FontGenerator::generateFontMapBinary(const Metadata& meta,
 		auto metrics = font.getMetrics(c.charcode, scale);
 
 		int32_t charcode = c.charcode;
-		Rect4f area = Rect4f(c.rect) / Vector2f(imageSize);
+		// Fonts with a dynamic atlas don't know where their glyphs will be until runtime
+		Rect4f area = imageSize.x > 0 ? Rect4f(c.rect) / Vector2f(imageSize) : Rect4f();
 		Vector2f size = Vector2f(c.rect.getSize());
 		Vector2f horizontalBearing = metrics.bearingHorizontal + Vector2f(float(-padding), float(padding));
 		Vector2f verticalBearing = metrics.bearingVertical + Vector2f(float(-padding), float(padding));
@@ -267,6 +366,15 @@ std::vector<Path> FontGeneratorResult::write(Path dir, bool verbose) const
 	Path pngPath = imgName;
 	Path binPath = fileName.replaceExtension(".font");
 	Path metaPath = pngPath.replaceExtension(".png.meta");
+	if (!image) {
+		// Dynamic atlas, glyphs are in the font itself
+		if (verbose) {
+			std::cout << "Saving " << binPath << std::endl;
+		}
+		FileSystem::writeFile(dir / binPath, Serializer::toBytes(*font));
+		return {binPath};
+	}
+
 	if (verbose) {
 		std::cout << "Saving " << pngPath << ", " << binPath << ", and " << metaPath << std::endl;
 	}
@@ -7,6 +7,12 @@
 #include "halley/support/console.h"
 #include "halley/core/resources/asset_database.h"
 #include "halley/utils/hash.h"
+#include "halley/resources/resource.h"
+#include "halley/core/resources/resource_access_trace.h"
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <set>
 
 using namespace Halley;
 
@@ -23,15 +29,21 @@ void AssetPackInspector::parse(const Bytes& bytes)
 	auto headerSpan = gsl::as_writeable_bytes(gsl::span<AssetPackHeader>(&header, 1));
 	s >> headerSpan;
 	dataStartPos = header.dataStartPos;
+	dataSize = bytes.size() - size_t(dataStartPos);
 
 	Bytes tableData(header.dataStartPos - header.assetDbStartPos);
 	auto tableSpan = gsl::as_writeable_bytes(gsl::span<Byte>(tableData.data(), tableData.size()));
 	s >> tableSpan;
 
 	rawTableSize = tableData.size();
-	auto rawTableData = Compression::decompress(tableData);
-	tableSize = rawTableData.size();
-	parseTable(Deserializer(rawTableData), bytes);
+	if (!AssetDatabase::isFlat(gsl::as_bytes(gsl::span<const Byte>(tableData)))) {
+		// Older packs had it compressed
+		tableData = Compression::decompress(tableData);
+	}
+	tableSize = tableData.size();
+	AssetDatabase db;
+	db.load(std::move(tableData));
+	parseTable(db, bytes);
 
 	// Generated sorted entries
 	sortedEntries.resize(entries.size());
@@ -46,37 +58,41 @@ void AssetPackInspector::parse(const Bytes& bytes)
 	computeHash();
 }
 
-void AssetPackInspector::parseTable(Deserializer s, const Bytes& packBytes)
+void AssetPackInspector::parseTable(const AssetDatabase& db, const Bytes& packBytes)
 {
-	unsigned int numTypedDbs;
-	s >> numTypedDbs;
-
-	for (unsigned int i = 0; i < numTypedDbs; ++i) {
-		parseTypedDB(s, packBytes);
+	const int numTypes = int(EnumNames<AssetType>()().size());
+	for (int i = 0; i < numTypes; ++i) {
+		parseTypedDB(i, db.getDatabase(AssetType(i)), packBytes);
 	}
 }
 
-void AssetPackInspector::parseTypedDB(Deserializer& s, const Bytes& packBytes)
+void AssetPackInspector::parseTypedDB(int assetType, const AssetDatabase::TypedDB& db, const Bytes& packBytes)
 {
-	int curAssetType;
-	s >> curAssetType;
+	auto names = db.getNames();
+	std::sort(names.begin(), names.end());
+	entries.reserve(entries.size() + names.size());
 
-	unsigned int numEntries;
-	s >> numEntries;
+	for (auto& key: names) {
+		const auto& entry = db.get(key);
 
-	entries.reserve(entries.size() + numEntries);
-
-	for (unsigned int i = 0; i < numEntries; ++i) {
-		String key;
-		AssetDatabase::Entry entry;
-		s >> key >> entry;
+		AssetType sourceType;
+		String sourceName;
+		if (AssetPack::getSharedSource(entry.path, sourceType, sourceName)) {
+			// Stored in another pack
+			entries.emplace_back(assetType, 0, key, entry);
+			entries.back().shared = true;
+			continue;
+		}
 
 		auto splitPath = entry.path.split(':');
 		size_t pos = splitPath.at(0).toInteger64();
-		size_t size = splitPath.at(1).toInteger64();
+		size_t size = splitPath.size() >= 4 ? splitPath[2].toInteger64() : splitPath.at(1).toInteger64(); // Chunked ones are pos:size:storedSize:flags
 		auto hash = Hash::hash(gsl::as_bytes(gsl::span<const Byte>(packBytes.data() + pos + dataStartPos, size)));
 
-		entries.emplace_back(curAssetType, hash, std::move(key), std::move(entry));
+		entries.emplace_back(assetType, hash, key, entry);
+		entries.back().pos = pos;
+		entries.back().size = size_t(splitPath.at(1).toInteger64());
+		entries.back().storedSize = size;
 	}
 }
 
@@ -110,8 +126,16 @@ void AssetPackInspector::printData() const
 			std::cout << "  Assets of type " << infoCol << lastType << stdCol << ":\n";
 		}
 
+		AssetType sourceType;
+		String sourceName;
+		if (AssetPack::getSharedSource(entry.entry.path, sourceType, sourceName)) {
+			std::cout << "    [" << i << "] " << strCol << entry.key << stdCol << ": shared with " << strCol << toString(sourceType) << ":" << sourceName << stdCol << " in another pack, " << strCol << toString(entry.entry.meta) << stdCol << "\n";
+			++i;
+			continue;
+		}
+
 		auto splitPath = entry.entry.path.split(':');
-		std::cout << "    [" << i << "] " << strCol << entry.key << stdCol << " [" << infoCol << toString(entry.hash, 16) << stdCol << "]: at " << infoCol << splitPath.at(0) << stdCol << ", " << infoCol << splitPath.at(1) << stdCol << " bytes, " << strCol << toString(entry.entry.meta) <<  stdCol << "\n";
+		std::cout << "    [" << i << "] " << strCol << entry.key << stdCol << " [" << infoCol << toString(entry.hash, 16) << stdCol << "]: at " << infoCol << splitPath.at(0) << stdCol << ", " << infoCol << splitPath.at(1) << stdCol << " bytes" << (splitPath.size() >= 4 ? " (stored as " + splitPath[2] + ", " + splitPath[3] + ")" : String()) << ", " << strCol << toString(entry.entry.meta) <<  stdCol << "\n";
 
 		++i;
 	}
@@ -121,6 +145,154 @@ void AssetPackInspector::printData() const
 	std::cout << std::endl;
 }
 
+void AssetPackInspector::printStats() const
+{
+	auto stdCol = ConsoleColour();
+	auto infoCol = ConsoleColour(Console::MAGENTA);
+	auto strCol = ConsoleColour(Console::DARK_GREY);
+	auto pretty = [] (size_t bytes) { return String::prettySize(static_cast<long long>(bytes)); };
+
+	std::cout << "Pack " << strCol << name << stdCol << "\n";
+
+	// Per type. Aliases of data that's already counted (e.g. duplicated sprites) and shared assets are only counted as entries.
+	struct TypeTotals {
+		size_t entries = 0;
+		size_t size = 0;
+		size_t storedSize = 0;
+	};
+	std::map<int, TypeTotals> byType;
+	std::set<size_t> seenPos;
+	size_t aliases = 0;
+	size_t shared = 0;
+	for (auto& e: entries) {
+		auto& t = byType[e.assetType];
+		++t.entries;
+		if (e.shared) {
+			++shared;
+		} else if (!seenPos.insert(e.pos).second) {
+			++aliases;
+		} else {
+			t.size += e.size;
+			t.storedSize += e.storedSize;
+		}
+	}
+
+	TypeTotals total;
+	std::cout << "  " << std::left << std::setw(20) << "Type" << std::right << std::setw(10) << "Entries" << std::setw(14) << "Size" << std::setw(14) << "Stored" << std::setw(8) << "Ratio" << "\n";
+	for (auto& t: byType) {
+		total.entries += t.second.entries;
+		total.size += t.second.size;
+		total.storedSize += t.second.storedSize;
+		std::cout << "  " << std::left << std::setw(20) << toString(AssetType(t.first)) << std::right << infoCol << std::setw(10) << t.second.entries
+			<< std::setw(14) << pretty(t.second.size) << std::setw(14) << pretty(t.second.storedSize) << std::setw(7) << std::fixed << std::setprecision(1)
+			<< (t.second.size > 0 ? 100.0 * double(t.second.storedSize) / double(t.second.size) : 100.0) << "%" << stdCol << "\n";
+	}
+	std::cout << "  " << std::left << std::setw(20) << "Total" << std::right << infoCol << std::setw(10) << total.entries
+		<< std::setw(14) << pretty(total.size) << std::setw(14) << pretty(total.storedSize) << stdCol << "\n";
+	std::cout << "  " << infoCol << aliases << stdCol << " aliases of data already in the pack, " << infoCol << shared << stdCol << " stored in other packs\n";
+
+	// Identical content stored more than once
+	std::map<uint64_t, std::vector<const Entry*>> byHash;
+	std::set<size_t> hashedPos;
+	for (auto& e: entries) {
+		if (!e.shared && hashedPos.insert(e.pos).second) {
+			byHash[e.hash].push_back(&e);
+		}
+	}
+	std::vector<std::pair<size_t, const std::vector<const Entry*>*>> duplicates;
+	size_t wasted = 0;
+	for (auto& h: byHash) {
+		if (h.second.size() > 1) {
+			const size_t w = h.second.front()->storedSize * (h.second.size() - 1);
+			wasted += w;
+			duplicates.emplace_back(w, &h.second);
+		}
+	}
+	std::sort(duplicates.begin(), duplicates.end(), [] (const auto& a, const auto& b) { return a.first > b.first; });
+	std::cout << "  Duplicated content: " << infoCol << duplicates.size() << stdCol << " groups, " << infoCol << pretty(wasted) << stdCol << " that could be saved\n";
+	for (size_t i = 0; i < std::min(duplicates.size(), size_t(10)); ++i) {
+		std::cout << "    " << infoCol << pretty(duplicates[i].first) << stdCol << ":";
+		for (auto* e: *duplicates[i].second) {
+			std::cout << " " << strCol << toString(AssetType(e->assetType)) << ":" << e->key << stdCol;
+		}
+		std::cout << "\n";
+	}
+
+	// Space in the data that no entry refers to, e.g. left behind by assets that were removed
+	std::vector<std::pair<size_t, size_t>> ranges;
+	for (auto& e: entries) {
+		if (!e.shared) {
+			ranges.emplace_back(e.pos, e.pos + e.storedSize);
+		}
+	}
+	std::sort(ranges.begin(), ranges.end());
+	size_t gaps = 0;
+	size_t gapBytes = 0;
+	size_t end = 0;
+	for (auto& r: ranges) {
+		if (r.first > end) {
+			++gaps;
+			gapBytes += r.first - end;
+		}
+		end = std::max(end, r.second);
+	}
+	if (dataSize > end) {
+		++gaps;
+		gapBytes += dataSize - end;
+	}
+	std::cout << "  Data: " << infoCol << pretty(dataSize) << stdCol << ", of which " << infoCol << pretty(gapBytes) << stdCol << " unreferenced in " << infoCol << gaps << stdCol << " gaps\n";
+	std::cout << std::endl;
+}
+
+void AssetPackInspector::printAccessStats(const ResourceAccessTrace& trace) const
+{
+	auto stdCol = ConsoleColour();
+	auto infoCol = ConsoleColour(Console::MAGENTA);
+	auto strCol = ConsoleColour(Console::DARK_GREY);
+
+	std::map<String, const Entry*> byName;
+	for (auto& e: entries) {
+		byName[toString(AssetType(e.assetType)) + ":" + e.key] = &e;
+	}
+
+	// Each section's assets are read in the order they were first used. A read that doesn't start where the previous one
+	// ended is a seek; data that was already read in the same section (i.e. aliases) isn't read again.
+	std::cout << "Access in pack " << strCol << name << stdCol << "\n";
+	const auto traceEntries = trace.getEntries();
+	for (auto& section: trace.getSections()) {
+		size_t assets = 0;
+		size_t seeks = 0;
+		size_t bytesRead = 0;
+		size_t lastEnd = size_t(-1);
+		std::set<size_t> read;
+		for (auto& t: traceEntries) {
+			if (t.section != section) {
+				continue;
+			}
+			const auto iter = byName.find(t.asset);
+			if (iter == byName.end() || iter->second->shared) {
+				continue;
+			}
+			const auto& e = *iter->second;
+			++assets;
+			if (!read.insert(e.pos).second) {
+				continue;
+			}
+			if (e.pos != lastEnd) {
+				++seeks;
+			}
+			bytesRead += e.storedSize;
+			lastEnd = e.pos + e.storedSize;
+		}
+
+		if (assets > 0) {
+			std::cout << "  " << strCol << (section.isEmpty() ? String("(no section)") : section) << stdCol << ": " << infoCol << assets << stdCol << " assets, "
+				<< infoCol << seeks << stdCol << " seeks, " << infoCol << String::prettySize(static_cast<long long>(bytesRead)) << stdCol << " read\n";
+		}
+	}
+	std::cout << std::endl;
+}
+
 AssetPackInspector::Entry::Entry(int assetType, uint64_t hash, String key, AssetDatabase::Entry entry)
 	: assetType(assetType)
 	, hash(hash)
@@ -132,17 +304,37 @@ AssetPackInspector::Entry::Entry(int assetType, uint64_t hash, String key, Asset
 int AssetPackInspectorTool::run(Vector<std::string> args)
 {
 	try {
-		if (!args.empty()) {
-			for (auto& arg: args) {
-				auto data = FileSystem::readFile(arg);
-				AssetPackInspector inspector(arg);
+		bool stats = false;
+		std::unique_ptr<ResourceAccessTrace> trace;
+		Vector<std::string> packs;
+		for (size_t i = 0; i < args.size(); ++i) {
+			if (args[i] == "--stats") {
+				stats = true;
+			} else if (args[i] == "--trace" && i + 1 < args.size()) {
+				trace = std::make_unique<ResourceAccessTrace>(FileSystem::readFile(args[++i]));
+			} else {
+				packs.push_back(args[i]);
+			}
+		}
+
+		if (!packs.empty()) {
+			for (auto& pack: packs) {
+				auto data = FileSystem::readFile(pack);
+				AssetPackInspector inspector(pack);
 				inspector.parse(data);
-				inspector.printData();
+				if (stats) {
+					inspector.printStats();
+				} else {
+					inspector.printData();
+				}
+				if (trace) {
+					inspector.printAccessStats(*trace);
+				}
 			}
 
 			return 0;
 		} else {
-			Logger::logError("Usage: halley-cmd pack-inspector path/to/pack1.dat [path/to/pack2.dat ...]");
+			Logger::logError("Usage: halley-cmd pack-inspector [--stats] [--trace asset_trace.txt] path/to/pack1.dat [path/to/pack2.dat ...]");
 			return 1;
 		}
 	} catch (std::exception& e) {
@@ -1,7 +1,6 @@
 #include "halley/tools/packer/asset_pack_manifest.h"
 #include "halley/file_formats/config_file.h"
 #include "halley/tools/packer/asset_packer.h"
-#include <yaml-cpp/yaml.h>
 #include "../assets/importers/config_importer.h"
 using namespace Halley;
 
@@ -13,6 +12,7 @@ AssetPackManifestEntry::AssetPackManifestEntry(const ConfigNode& node)
 {
 	name = node["name"].asString();
 	encryptionKey = node["encryptionKey"].asString("");
+	shareData = node["shareData"].asBool(false);
 	if (node.hasKey("matches")) {
 		for (auto& m: node["matches"].asSequence()) {
 			matches.push_back(m.asString());
@@ -45,12 +45,15 @@ const String& AssetPackManifestEntry::getEncryptionKey() const
 	return encryptionKey;
 }
 
+bool AssetPackManifestEntry::canShareData() const
+{
+	return shareData;
+}
+
 AssetPackManifest::AssetPackManifest(const Bytes& data)
 {
 	ConfigFile config;
-	String strData(reinterpret_cast<const char*>(data.data()), data.size());
-	YAML::Node root = YAML::Load(strData.cppStr());
-	config.getRoot() = ConfigImporter::parseYAMLNode(root);
+	config.getRoot() = ConfigImporter::parseYAML(gsl::as_bytes(gsl::span<const Byte>(data)));
 	load(config);
 }
 
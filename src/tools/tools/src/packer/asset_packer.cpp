@@ -6,8 +6,15 @@
 #include "halley/tools/packer/asset_pack_manifest.h"
 #include "halley/resources/resource.h"
 #include "halley/core/resources/asset_pack.h"
+#include "halley/core/resources/resource_access_trace.h"
 #include "halley/tools/project/project.h"
 #include "halley/tools/assets/import_assets_database.h"
+#include "halley/utils/hash.h"
+#include "halley/concurrency/concurrent.h"
+#include "halley/concurrency/executor.h"
+#include <algorithm>
+#include <fstream>
+#include <limits>
 using namespace Halley;
 
 
@@ -20,9 +27,10 @@ AssetPackListing::AssetPackListing()
 {
 }
 
-AssetPackListing::AssetPackListing(String name, String encryptionKey)
+AssetPackListing::AssetPackListing(String name, String encryptionKey, bool shareData)
 	: name(name)
 	, encryptionKey(encryptionKey)
+	, shareData(shareData)
 {
 }
 
@@ -41,6 +49,11 @@ const String& AssetPackListing::getEncryptionKey() const
 	return encryptionKey;
 }
 
+bool AssetPackListing::canShareData() const
+{
+	return shareData;
+}
+
 void AssetPackListing::setActive(bool a)
 {
 	active = a;
@@ -56,6 +69,30 @@ void AssetPackListing::sort()
 	std::sort(entries.begin(), entries.end());
 }
 
+void AssetPackListing::sortByFirstUse(const HashMap<String, size_t>& firstUse)
+{
+	auto getOrder = [&] (const Entry& e) -> size_t
+	{
+		const auto iter = firstUse.find(toString(e.type) + ":" + e.name);
+		return iter != firstUse.end() ? iter->second : std::numeric_limits<size_t>::max();
+	};
+
+	std::vector<std::pair<size_t, Entry>> sorted;
+	sorted.reserve(entries.size());
+	for (auto& e: entries) {
+		sorted.emplace_back(getOrder(e), std::move(e));
+	}
+	std::sort(sorted.begin(), sorted.end(), [] (const std::pair<size_t, Entry>& a, const std::pair<size_t, Entry>& b)
+	{
+		return a.first != b.first ? a.first < b.first : a.second < b.second;
+	});
+
+	entries.clear();
+	for (auto& e: sorted) {
+		entries.push_back(std::move(e.second));
+	}
+}
+
 void AssetPacker::pack(Project& project, Maybe<std::set<String>> assetsToPack, const std::vector<String>& deletedAssets)
 {
 	for (auto& platform: project.getPlatforms()) {
@@ -72,14 +109,26 @@ void AssetPacker::packPlatform(Project& project, Maybe<std::set<String>> assetsT
 	const auto db = project.getImportAssetsDatabase().makeAssetDatabase(platform);
 	const auto manifest = AssetPackManifest(FileSystem::readFile(project.getAssetPackManifestPath()));
 
+	// A trace recorded by running the game with --record-asset-trace, see ResourceAccessTrace
+	std::unique_ptr<ResourceAccessTrace> trace;
+	const auto tracePath = project.getRootPath() / "asset_trace.txt";
+	if (FileSystem::exists(tracePath)) {
+		trace = std::make_unique<ResourceAccessTrace>(FileSystem::readFile(tracePath));
+		Logger::logInfo("Laying out packs by first use, from \"" + tracePath.string() + "\".");
+	}
+
 	// Sort into packs
-	const std::map<String, AssetPackListing> packs = sortIntoPacks(manifest, *db, assetsToPack, deletedAssets);
+	const std::map<String, AssetPackListing> packs = sortIntoPacks(manifest, *db, assetsToPack, deletedAssets, trace.get());
 
 	// Generate packs
 	generatePacks(packs, src, dst);
+
+	if (trace) {
+		generatePreloadManifests(*trace, *db, dst);
+	}
 }
 
-std::map<String, AssetPackListing> AssetPacker::sortIntoPacks(const AssetPackManifest& manifest, const AssetDatabase& srcAssetDb, Maybe<std::set<String>> assetsToPack, const std::vector<String>& deletedAssets)
+std::map<String, AssetPackListing> AssetPacker::sortIntoPacks(const AssetPackManifest& manifest, const AssetDatabase& srcAssetDb, Maybe<std::set<String>> assetsToPack, const std::vector<String>& deletedAssets, const ResourceAccessTrace* trace)
 {
 	std::map<String, AssetPackListing> packs;
 	for (auto typeName: EnumNames<AssetType>()()) {
@@ -92,16 +141,18 @@ std::map<String, AssetPackListing> AssetPacker::sortIntoPacks(const AssetPackMan
 			auto packEntry = manifest.getPack("~:" + assetName);
 			String packName;
 			String encryptionKey;
+			bool shareData = false;
 			if (packEntry) {
 				packName = packEntry.get().get().getName();
 				encryptionKey = packEntry.get().get().getEncryptionKey();
+				shareData = packEntry.get().get().canShareData();
 			}
 
 			// Retrieve pack
 			auto iter = packs.find(packName);
 			if (iter == packs.end()) {
 				// Pack doesn't exist yet, create it first
-				packs[packName] = AssetPackListing(packName, encryptionKey);
+				packs[packName] = AssetPackListing(packName, encryptionKey, shareData);
 				iter = packs.find(packName);
 
 				// Initialise it to active if there's no asset list to pack
@@ -122,9 +173,19 @@ std::map<String, AssetPackListing> AssetPacker::sortIntoPacks(const AssetPackMan
 		}
 	}
 
-	// Sort all packs
-	for (auto& p: packs) {
-		p.second.sort();
+	// Sort all packs, so they're read sequentially if we know the order they're used in
+	if (trace) {
+		HashMap<String, size_t> firstUse;
+		for (auto& e: trace->getEntries()) {
+			firstUse.insert(std::make_pair(e.asset, firstUse.size()));
+		}
+		for (auto& p: packs) {
+			p.second.sortByFirstUse(firstUse);
+		}
+	} else {
+		for (auto& p: packs) {
+			p.second.sort();
+		}
 	}
 
 	// Activate any packs that contain deleted assets
@@ -142,11 +203,29 @@ std::map<String, AssetPackListing> AssetPacker::sortIntoPacks(const AssetPackMan
 		}
 	}
 
+	// Packs sharing data point at each other's assets, so if one is repacked, all of them have to be
+	bool repackShared = false;
+	for (auto& p: packs) {
+		repackShared = repackShared || (p.second.canShareData() && p.second.isActive());
+	}
+	if (repackShared) {
+		for (auto& p: packs) {
+			if (p.second.canShareData()) {
+				p.second.setActive(true);
+			}
+		}
+	}
+
 	return packs;
 }
 
 void AssetPacker::generatePacks(std::map<String, AssetPackListing> packs, const Path& src, const Path& dst)
 {
+	// Packs only refer to each other's data if they share it, so those are generated one after another, in order, and
+	// every other pack can be generated at the same time as the rest
+	std::vector<std::vector<const std::pair<const String, AssetPackListing>*>> groups;
+	std::vector<const std::pair<const String, AssetPackListing>*> sharedGroup;
+
 	for (auto& packListing: packs) {
 		if (packListing.first.isEmpty()) {
 			Logger::logWarning("The following assets will not be packed:");
@@ -158,43 +237,145 @@ void AssetPacker::generatePacks(std::map<String, AssetPackListing> packs, const
 			// Only pack if this pack listing is active or if it doesn't exist
 			auto dstPack = dst / packListing.first + ".dat";
 			if (packListing.second.isActive() || !FileSystem::exists(dstPack)) {
-				generatePack(packListing.first, packListing.second, src, dstPack);
+				if (packListing.second.canShareData()) {
+					sharedGroup.push_back(&packListing);
+				} else {
+					groups.push_back({ &packListing });
+				}
 			}
 		}
 	}
+	if (!sharedGroup.empty()) {
+		groups.push_back(std::move(sharedGroup));
+	}
+
+	Concurrent::parallelFor(Executors::getCPUAux(), Range<size_t>(0, groups.size()), 1, [&] (size_t start, size_t end)
+	{
+		for (size_t i = start; i < end; ++i) {
+			PackedAssets packed;
+			for (auto* packListing: groups[i]) {
+				generatePack(packListing->first, packListing->second, src, dst / packListing->first + ".dat", packed);
+			}
+		}
+	});
 }
 
-void AssetPacker::generatePack(const String& packId, const AssetPackListing& packListing, const Path& src, const Path& dst)
+void AssetPacker::generatePreloadManifests(const ResourceAccessTrace& trace, const AssetDatabase& srcAssetDb, const Path& dst)
 {
+	// One per section of the trace (i.e. per stage), listing what it used in the order it first used it
+	const auto entries = trace.getEntries();
+	for (auto& section: trace.getSections()) {
+		String manifest;
+		for (auto& e: entries) {
+			const auto split = e.asset.find(':');
+			if (e.section == section && split != String::npos) {
+				const auto type = fromString<AssetType>(e.asset.left(split));
+				if (srcAssetDb.getDatabase(type).contains(e.asset.mid(split + 1))) {
+					manifest += e.asset + "\n";
+				}
+			}
+		}
+
+		const auto path = dst / "preload" / (section + ".txt");
+		FileSystem::writeFile(path, gsl::as_bytes(gsl::span<const char>(manifest.c_str(), manifest.size())));
+	}
+	Logger::logInfo("- Wrote preload manifests for " + toString(trace.getSections().size()) + " sections.");
+}
+
+void AssetPacker::generatePack(const String& packId, const AssetPackListing& packListing, const Path& src, const Path& dst, PackedAssets& packed)
+{
+	// The data is written out as each asset is encoded, rather than kept in memory, and the header (which has to go in
+	// front of it, and can only be written once everything has been added) is joined with it at the end
 	AssetPack pack;
-	AssetDatabase& db = pack.getAssetDatabase();
-	Bytes& data = pack.getData();
+	const auto dataPath = dst.parentPath() / (dst.getFilename().getString() + ".tmp");
+	FileSystem::createParentDir(dataPath);
+	std::ofstream dataFile(dataPath.string(), std::ios::binary | std::ios::out);
+	size_t dataSize = 0;
+
+	const auto& key = packListing.getEncryptionKey();
+	size_t numDuplicates = 0;
+	size_t duplicateBytes = 0;
+
+	if (!key.isEmpty()) {
+		Logger::logInfo("- Encrypting \"" + packId + "\"...");
+	}
 
 	for (auto& entry: packListing.getEntries()) {
 		//Logger::logDev("  [" + toString(entry.type) + "] " + entry.name);
 
 		// Read original file
 		auto fileData = FileSystem::readFile(src / entry.path);
-		const size_t pos = data.size();
-		const size_t size = fileData.size();
-		if (size == 0) {
+		if (fileData.empty()) {
 			throw Exception("Unable to pack: \"" + (src / entry.path) + "\". File not found or empty.", HalleyExceptions::Tools);
 		}
-		
-		// Read data into pack data
-		data.reserve(nextPowerOf2(pos + size));
-		data.resize(pos + size);
-		memcpy(data.data() + pos, fileData.data(), size);
 
-		db.addAsset(entry.name, entry.type, AssetDatabase::Entry(toString(pos) + ":" + toString(size), entry.metadata));
-	}
+		// Identical data is only stored once, with every other asset that has it pointing at it
+		const auto hash = Hash::hash(fileData);
+		if (auto original = findPacked(packed, hash, fileData, packId, packListing)) {
+			if (original->packId == packId) {
+				pack.addAssetAlias(entry.name, entry.type, original->name, original->type, entry.metadata);
+			} else {
+				pack.addSharedAsset(entry.name, entry.type, original->name, original->type, entry.metadata);
+			}
+			++numDuplicates;
+			duplicateBytes += fileData.size();
+			continue;
+		}
 
-	if (!packListing.getEncryptionKey().isEmpty()) {
-		Logger::logInfo("- Encrypting \"" + packId + "\"...");
-		pack.encrypt(packListing.getEncryptionKey());
+		// Compressed and encrypted in chunks, so they can be decoded independently
+		const auto encoded = AssetPack::encodeAsset(gsl::as_bytes(gsl::span<const Byte>(fileData)), key);
+		dataFile.write(reinterpret_cast<const char*>(encoded.data.data()), encoded.data.size());
+		pack.addEncodedAsset(entry.name, entry.type, dataSize, encoded, entry.metadata);
+		dataSize += encoded.data.size();
+		packed[hash].push_back(PackedAsset{ packId, packListing.canShareData(), key, entry.type, entry.name, (src / entry.path).string() });
+	}
+	dataFile.close();
+	if (!dataFile) {
+		FileSystem::remove(dataPath);
+		throw Exception("Unable to write \"" + dataPath + "\".", HalleyExceptions::Tools);
 	}
 
 	// Write pack
-	FileSystem::writeFile(dst, pack.writeOut());
-	Logger::logInfo("- Packed " + toString(packListing.getEntries().size()) + " entries on \"" + packId + "\" (" + String::prettySize(data.size()) + ").");
+	writePack(dst, pack.writeOutHeader(), dataPath);
+	FileSystem::remove(dataPath);
+	Logger::logInfo("- Packed " + toString(packListing.getEntries().size()) + " entries on \"" + packId + "\" (" + String::prettySize(dataSize) + ").");
+	if (numDuplicates > 0) {
+		Logger::logInfo("  " + toString(numDuplicates) + " were duplicates, saving " + String::prettySize(duplicateBytes) + ".");
+	}
+}
+
+void AssetPacker::writePack(const Path& dst, const Bytes& header, const Path& dataPath)
+{
+	std::ofstream out(dst.string(), std::ios::binary | std::ios::out);
+	std::ifstream in(dataPath.string(), std::ios::binary | std::ios::in);
+	out.write(reinterpret_cast<const char*>(header.data()), header.size());
+
+	std::vector<char> buffer(4 * 1024 * 1024);
+	while (in) {
+		in.read(buffer.data(), buffer.size());
+		out.write(buffer.data(), in.gcount());
+	}
+
+	out.close();
+	if (!out || !in.eof()) {
+		FileSystem::remove(dst);
+		throw Exception("Unable to write \"" + dst + "\".", HalleyExceptions::Tools);
+	}
+}
+
+const AssetPacker::PackedAsset* AssetPacker::findPacked(const PackedAssets& packed, uint64_t hash, const Bytes& data, const String& packId, const AssetPackListing& pack)
+{
+	auto iter = packed.find(hash);
+	if (iter == packed.end()) {
+		return nullptr;
+	}
+
+	for (auto& candidate: iter->second) {
+		// Only into the same pack, or between packs that can share, and never across encryption keys
+		const bool reachable = candidate.packId == packId || (candidate.shareData && pack.canShareData());
+		if (reachable && candidate.encryptionKey == pack.getEncryptionKey() && FileSystem::readFile(Path(candidate.srcPath)) == data) {
+			return &candidate;
+		}
+	}
+	return nullptr;
 }
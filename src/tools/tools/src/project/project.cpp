@@ -1,7 +1,10 @@
 #include "halley/tools/assets/import_assets_database.h"
+#include "halley/tools/assets/import_cache.h"
 #include "halley/tools/project/project.h"
 #include "halley/tools/file/filesystem.h"
+#include "halley/tools/file/filesystem_cache.h"
 #include "halley/core/game/halley_statics.h"
+#include <cstdlib>
 
 using namespace Halley;
 
@@ -11,8 +14,10 @@ Project::Project(std::vector<String> _platforms, Path projectRootPath, Path hall
 	, halleyRootPath(halleyRootPath)
 	, plugins(std::move(plugins))
 {
-	importAssetsDatabase = std::make_unique<ImportAssetsDatabase>(getUnpackedAssetsPath(), getUnpackedAssetsPath() / "import.db", getUnpackedAssetsPath() / "assets.db", platforms);
-	codegenDatabase = std::make_unique<ImportAssetsDatabase>(getGenPath(), getGenPath() / "import.db", getGenPath() / "assets.db", std::vector<String>{ "" });
+	fileSystemCache = std::make_unique<FileSystemCache>();
+	importAssetsDatabase = std::make_unique<ImportAssetsDatabase>(getUnpackedAssetsPath(), getUnpackedAssetsPath() / "import.db", getUnpackedAssetsPath() / "assets.db", platforms, *fileSystemCache);
+	codegenDatabase = std::make_unique<ImportAssetsDatabase>(getGenPath(), getGenPath() / "import.db", getGenPath() / "assets.db", std::vector<String>{ "" }, *fileSystemCache);
+	importCache = std::make_unique<ImportCache>(getImportCachePath(), rootPath, getImportCacheServer());
 	assetImporter = std::make_unique<AssetImporter>(*this, std::vector<Path>{getSharedAssetsSrcPath(), getAssetsSrcPath()});
 }
 
@@ -32,6 +37,11 @@ Path Project::getRootPath() const
 	return rootPath;
 }
 
+Path Project::getHalleyRootPath() const
+{
+	return halleyRootPath;
+}
+
 Path Project::getUnpackedAssetsPath() const
 {
 	return rootPath / "assets_unpacked";
@@ -63,6 +73,28 @@ Path Project::getGenSrcPath() const
 	return rootPath / "gen_src";
 }
 
+Path Project::getImportCachePath() const
+{
+	// Can be pointed somewhere that outlives the checkout, e.g. to share it between branches, or on CI
+	const char* path = getenv("HALLEY_IMPORT_CACHE");
+	if (path && path[0] != 0) {
+		return Path(path);
+	}
+	return rootPath / "import_cache";
+}
+
+Path Project::getImportReportPath() const
+{
+	return rootPath / "import_report";
+}
+
+String Project::getImportCacheServer() const
+{
+	// e.g. "cache.mystudio.lan:8080/mygame", see ImportCache
+	const char* server = getenv("HALLEY_IMPORT_CACHE_SERVER");
+	return server ? String(server) : String();
+}
+
 Path Project::getAssetPackManifestPath() const
 {
 	return assetPackManifest;
@@ -78,6 +110,16 @@ ImportAssetsDatabase& Project::getCodegenDatabase() const
 	return *codegenDatabase;
 }
 
+ImportCache& Project::getImportCache() const
+{
+	return *importCache;
+}
+
+FileSystemCache& Project::getFileSystemCache() const
+{
+	return *fileSystemCache;
+}
+
 const AssetImporter& Project::getAssetImporter() const
 {
 	return *assetImporter;
@@ -109,3 +151,13 @@ DevConServer* Project::getDevConServer() const
 {
 	return devConServer;
 }
+
+void Project::setImportWorkerPool(std::shared_ptr<ImportWorkerPool> pool)
+{
+	importWorkerPool = std::move(pool);
+}
+
+const std::shared_ptr<ImportWorkerPool>& Project::getImportWorkerPool() const
+{
+	return importWorkerPool;
+}
@@ -3,6 +3,9 @@
 #include "halley/utils/utils.h"
 #include "halley/support/logger.h"
 #include "halley/bytes/compression.h"
+#include "halley/concurrency/concurrent.h"
+#include "halley/concurrency/executor.h"
+#include "halley/utils/hash.h"
 #include <limits>
 using namespace Halley;
 
@@ -133,6 +136,11 @@ struct AsepriteFileTagsEntryData
 
 void AsepriteCel::loadImage(AsepriteDepth depth, const std::vector<uint32_t>& palette)
 {
+	if (compressed) {
+		rawData = Compression::decompressRaw(gsl::as_bytes(gsl::span<const Byte>(rawData)), std::numeric_limits<size_t>::max());
+		compressed = false;
+	}
+
 	imgData = std::make_unique<Image>(Image::Format::RGBA, size);
 	imgData->clear(Image::convertRGBAToInt(0, 0, 0, 0));
 
@@ -252,6 +260,58 @@ void AsepriteFile::load(gsl::span<const gsl::byte> data)
 		// Next frame
 		pos = frameStartPos + frameHeader.dataSize;
 	}
+
+	Hash::Hasher hasher;
+	hasher.feedBytes(gsl::as_bytes(gsl::span<const uint32_t>(paletteBg)));
+	hasher.feed(transparentEntry);
+	paletteHash = hasher.digest();
+}
+
+uint64_t AsepriteFile::getFrameHash(int frameNumber) const
+{
+	Hash::Hasher hasher;
+	hasher.feed(size);
+	hasher.feed(colourDepth);
+	hasher.feed(paletteHash);
+
+	for (int layerNumber = 0; layerNumber < int(layers.size()); ++layerNumber) {
+		auto& layer = layers[layerNumber];
+		if (layer.visible) {
+			auto* cel = getCelAt(frameNumber, layerNumber);
+			hasher.feed(layerNumber);
+			hasher.feed(layer.opacity);
+			hasher.feed(layer.blendMode);
+			hasher.feed(layer.background);
+			hasher.feed(cel ? cel->hash : uint64_t(0));
+		}
+	}
+
+	return hasher.digest();
+}
+
+void AsepriteFile::loadFrames(const std::vector<int>& frameNumbers)
+{
+	// Decompressing cels is most of the work, and each one is independent. Linked cels can be shared between frames.
+	std::vector<std::pair<AsepriteCel*, const AsepriteLayer*>> toLoad;
+	for (int frameNumber: frameNumbers) {
+		for (int layerNumber = 0; layerNumber < int(layers.size()); ++layerNumber) {
+			if (layers[layerNumber].visible) {
+				auto* cel = getCelAt(frameNumber, layerNumber);
+				if (cel && !cel->imgData) {
+					toLoad.emplace_back(cel, &layers[layerNumber]);
+				}
+			}
+		}
+	}
+	std::sort(toLoad.begin(), toLoad.end());
+	toLoad.erase(std::unique(toLoad.begin(), toLoad.end()), toLoad.end());
+
+	Concurrent::parallelFor(Executors::getCPUAux(), Range<size_t>(0, toLoad.size()), 4, [&] (size_t start, size_t end)
+	{
+		for (size_t i = start; i < end; ++i) {
+			toLoad[i].first->loadImage(colourDepth, toLoad[i].second->background ? paletteBg : paletteTransparent);
+		}
+	});
 }
 
 void AsepriteFile::addFrame(uint16_t duration)
@@ -352,9 +412,18 @@ void AsepriteFile::addCelChunk(gsl::span<const gsl::byte> span)
 			}
 			memcpy(cel.rawData.data(), span.data(), cel.rawData.size());
 		} else if (type == 2) {
-			// ZLIB compressed
-			cel.rawData = Compression::decompressRaw(span, std::numeric_limits<size_t>::max());
+			// ZLIB compressed, only decompressed when a frame using it is loaded
+			cel.rawData = Bytes(reinterpret_cast<const Byte*>(span.data()), reinterpret_cast<const Byte*>(span.data()) + span.size());
+			cel.compressed = true;
 		}
+
+		Hash::Hasher hasher;
+		hasher.feed(cel.pos);
+		hasher.feed(cel.size);
+		hasher.feed(cel.opacity);
+		hasher.feed(cel.compressed);
+		hasher.feedBytes(gsl::as_bytes(gsl::span<const Byte>(cel.rawData)));
+		cel.hash = hasher.digest();
 	} else if (type == 1) {
 		// Linked
 		AsepriteFileLinkedCelData header;
@@ -435,6 +504,11 @@ AsepriteCel* AsepriteFile::getCelAt(int frameNumber, int layerNumber)
 	return nullptr;
 }
 
+const AsepriteCel* AsepriteFile::getCelAt(int frameNumber, int layerNumber) const
+{
+	return const_cast<AsepriteFile*>(this)->getCelAt(frameNumber, layerNumber);
+}
+
 size_t AsepriteFile::getBPP() const
 {
 	switch (colourDepth) {
@@ -454,7 +528,7 @@ const std::vector<AsepriteTag>& AsepriteFile::getTags() const
 	return tags;
 }
 
-std::unique_ptr<Image> AsepriteFile::makeFrameImage(int frameNumber)
+std::unique_ptr<Image> AsepriteFile::makeFrameImage(int frameNumber) const
 {
 	auto frameImage = std::make_unique<Image>(Image::Format::RGBA, size);
 	frameImage->clear(Image::convertRGBAToInt(0, 0, 0, 0));
@@ -465,9 +539,6 @@ std::unique_ptr<Image> AsepriteFile::makeFrameImage(int frameNumber)
 			auto* cel = getCelAt(frameNumber, layerNumber);
 			if (cel) {
 				const uint8_t opacity = uint8_t(clamp((uint32_t(cel->opacity) * uint32_t(layer.opacity)) / 255, uint32_t(0), uint32_t(255)));
-				if (!cel->imgData) {
-					cel->loadImage(colourDepth, layer.background ? paletteBg : paletteTransparent);
-				}
 				cel->drawAt(*frameImage, opacity, layer.blendMode);
 			}
 		}
@@ -26,8 +26,10 @@ namespace Halley {
 		uint16_t linkedFrame = 0;
 		uint8_t opacity = 255;
 		bool linked = false;
+		bool compressed = false;
+		uint64_t hash = 0; // Of its position, size, opacity and pixel data
 
-		Bytes rawData;
+		Bytes rawData; // ZLIB compressed if compressed is set, until loadImage
 		std::unique_ptr<Image> imgData;
 
 		void loadImage(AsepriteDepth depth, const std::vector<uint32_t>& palette);
@@ -111,10 +113,16 @@ namespace Halley {
 		void load(gsl::span<const gsl::byte> data);
 
 		const std::vector<AsepriteTag>& getTags() const;
-		std::unique_ptr<Image> makeFrameImage(int n);
 	    const AsepriteFrame& getFrame(int n) const;
 	    size_t getNumberOfFrames() const;
 
+		// Of everything that goes into a frame's image, so frames with the same hash compose to the same image
+		uint64_t getFrameHash(int n) const;
+
+		// Cels are only decompressed once a frame using them is loaded, so frames that are never composed cost nothing
+		void loadFrames(const std::vector<int>& frameNumbers);
+		std::unique_ptr<Image> makeFrameImage(int n) const; // Frame must be loaded. Safe to call concurrently
+
     private:
 	    void addFrame(uint16_t duration);
 	    void addChunk(uint16_t chunkType, gsl::span<const gsl::byte> data);
@@ -152,6 +160,7 @@ namespace Halley {
 		}
 
 	    AsepriteCel* getCelAt(int frameNumber, int layerNumber);
+	    const AsepriteCel* getCelAt(int frameNumber, int layerNumber) const;
 	    size_t getBPP() const;
 
 		Vector2i size;
@@ -165,5 +174,6 @@ namespace Halley {
 		std::vector<AsepriteTag> tags;
 		std::vector<uint32_t> paletteBg;
 		std::vector<uint32_t> paletteTransparent;
+		uint64_t paletteHash = 0;
     };
 }
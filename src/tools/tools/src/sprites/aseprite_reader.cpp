@@ -6,6 +6,8 @@
 #include "../assets/importers/sprite_importer.h"
 #include "halley/support/logger.h"
 #include "aseprite_file.h"
+#include "halley/concurrency/concurrent.h"
+#include "halley/concurrency/executor.h"
 using namespace Halley;
 
 std::vector<ImageData> AsepriteExternalReader::loadImagesFromPath(Path tmp, bool trim) {
@@ -120,7 +122,20 @@ std::vector<ImageData> AsepriteExternalReader::importAseprite(String spriteName,
 ////////////
 
 
-std::vector<ImageData> AsepriteReader::importAseprite(String spriteName, gsl::span<const gsl::byte> fileData, bool trim)
+HashMap<uint64_t, AsepriteFrameCache::Frame> AsepriteFrameCache::getFrames(const String& fileName) const
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	const auto iter = files.find(fileName);
+	return iter != files.end() ? iter->second : HashMap<uint64_t, Frame>();
+}
+
+void AsepriteFrameCache::setFrames(const String& fileName, HashMap<uint64_t, Frame> frames)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	files[fileName] = std::move(frames);
+}
+
+std::vector<ImageData> AsepriteReader::importAseprite(String spriteName, gsl::span<const gsl::byte> fileData, bool trim, AsepriteFrameCache* cache)
 {
 	const String baseName = Path(spriteName).getFilename().string();
 
@@ -156,17 +171,17 @@ std::vector<ImageData> AsepriteReader::importAseprite(String spriteName, gsl::sp
 
 	// Create frames
 	std::vector<ImageData> frameData;
+	std::vector<int> frameNumbers;
 	for (auto& t: tags) {
 		int i = 0;
 		for (auto& frameN: t.second) {
 			frameData.push_back(ImageData());
+			frameNumbers.push_back(frameN);
 			auto& imgData = frameData.back();
 
-			imgData.img = aseFile.makeFrameImage(frameN);
 			imgData.frameNumber = i;
 			imgData.sequenceName = t.first;
 			imgData.duration = aseFile.getFrame(frameN).duration;
-			imgData.clip = trim ? imgData.img->getTrimRect() : imgData.img->getRect();
 
 			std::stringstream ss;
 			ss << baseName.cppStr();
@@ -187,5 +202,48 @@ std::vector<ImageData> AsepriteReader::importAseprite(String spriteName, gsl::sp
 		}
 	}
 
+	// Find which frames changed since the last import. The same frame can appear in more than one tag.
+	const auto cached = cache ? cache->getFrames(spriteName) : HashMap<uint64_t, AsepriteFrameCache::Frame>();
+	HashMap<uint64_t, AsepriteFrameCache::Frame> composed;
+	std::vector<uint64_t> frameHashes(nFrames);
+	std::vector<int> toCompose;
+	for (size_t i = 0; i < nFrames; ++i) {
+		frameHashes[i] = aseFile.getFrameHash(int(i));
+		const auto iter = cached.find(frameHashes[i]);
+		if (iter != cached.end()) {
+			composed[frameHashes[i]] = iter->second;
+		} else if (composed.find(frameHashes[i]) == composed.end()) {
+			composed[frameHashes[i]] = AsepriteFrameCache::Frame();
+			toCompose.push_back(int(i));
+		}
+	}
+
+	// Compose the new ones
+	aseFile.loadFrames(toCompose);
+	std::vector<AsepriteFrameCache::Frame> newFrames(toCompose.size());
+	Concurrent::parallelFor(Executors::getCPUAux(), Range<size_t>(0, toCompose.size()), 1, [&] (size_t start, size_t end)
+	{
+		for (size_t i = start; i < end; ++i) {
+			std::shared_ptr<const Image> img = aseFile.makeFrameImage(toCompose[i]);
+			newFrames[i] = AsepriteFrameCache::Frame{ img, img->getTrimRect() };
+		}
+	});
+	for (size_t i = 0; i < toCompose.size(); ++i) {
+		composed[frameHashes[toCompose[i]]] = std::move(newFrames[i]);
+	}
+
+	// Each ImageData owns its image, so it gets a copy
+	for (size_t i = 0; i < frameData.size(); ++i) {
+		auto& imgData = frameData[i];
+		const auto& frame = composed.at(frameHashes[frameNumbers[i]]);
+		imgData.img = std::make_unique<Image>(frame.img->getFormat(), frame.img->getSize());
+		memcpy(imgData.img->getPixels(), frame.img->getPixels(), frame.img->getByteSize());
+		imgData.clip = trim ? frame.trimRect : frame.img->getRect();
+	}
+
+	if (cache) {
+		cache->setFrames(spriteName, std::move(composed));
+	}
+
 	return frameData;
 }
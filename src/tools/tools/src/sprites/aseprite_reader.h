@@ -1,8 +1,11 @@
 #pragma once
 #include <gsl/gsl>
 #include <map>
+#include <mutex>
 #include "halley/text/halleystring.h"
 #include "halley/maths/vector4.h"
+#include "halley/maths/rect.h"
+#include "halley/data_structures/hash_map.h"
 
 namespace Halley
 {
@@ -21,9 +24,29 @@ namespace Halley
 		static void processFrameData(String baseName, std::vector<ImageData>& frameData, std::map<int, int> durations);
 	};
 
+	// Frames composed by previous imports of each file, by AsepriteFile::getFrameHash, so that reimporting a file
+	// only decompresses and composes the frames that changed. Only the frames from the latest import of each file are
+	// kept. Safe to use from several imports at once.
+	class AsepriteFrameCache
+	{
+	public:
+		struct Frame
+		{
+			std::shared_ptr<const Image> img;
+			Rect4i trimRect;
+		};
+
+		HashMap<uint64_t, Frame> getFrames(const String& fileName) const;
+		void setFrames(const String& fileName, HashMap<uint64_t, Frame> frames);
+
+	private:
+		mutable std::mutex mutex;
+		HashMap<String, HashMap<uint64_t, Frame>> files;
+	};
+
 	class AsepriteReader
 	{
 	public:
-		static std::vector<ImageData> importAseprite(String baseName, gsl::span<const gsl::byte> fileData, bool trim);
+		static std::vector<ImageData> importAseprite(String baseName, gsl::span<const gsl::byte> fileData, bool trim, AsepriteFrameCache* cache = nullptr);
 	};
 }
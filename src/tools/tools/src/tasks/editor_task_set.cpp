@@ -1,4 +1,5 @@
 #include "halley/tools/tasks/editor_task_set.h"
+#include "halley/tools/assets/import_worker_pool.h"
 #include <thread>
 #include <chrono>
 #include <iostream>
@@ -30,6 +31,10 @@ void EditorTaskSet::update(Time time)
 {
 	Vector<EditorTaskAnchor> toAdd;
 
+	if (importWorkerPool) {
+		importWorkerPool->update();
+	}
+
 	auto next = tasks.begin();
 	for (auto iter = tasks.begin(); iter != tasks.end(); iter = next) {
 		++next;
@@ -77,6 +82,11 @@ void EditorTaskSet::setListener(EditorTaskSetListener& l)
 	listener = &l;
 }
 
+void EditorTaskSet::setImportWorkerPool(std::shared_ptr<ImportWorkerPool> pool)
+{
+	importWorkerPool = std::move(pool);
+}
+
 const std::list<std::shared_ptr<EditorTaskAnchor>>& EditorTaskSet::getTasks() const
 {
 	return tasks;
@@ -0,0 +1,125 @@
+#include "halley/tools/texture/mipmap_generator.h"
+#include <halley/core/graphics/texture_descriptor.h>
+#include <halley/file_formats/image.h>
+#include <halley/concurrency/concurrent.h>
+#include <halley/support/exception.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+using namespace Halley;
+
+namespace {
+	class ColourSpace
+	{
+	public:
+		ColourSpace(bool sRGB)
+		{
+			for (int i = 0; i < 256; ++i) {
+				const float v = float(i) / 255.0f;
+				toLinearTable[i] = sRGB ? (v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f)) : v;
+			}
+			for (int i = 0; i < 4096; ++i) {
+				const float v = float(i) / 4095.0f;
+				const float s = sRGB ? (v <= 0.0031308f ? v * 12.92f : 1.055f * std::pow(v, 1.0f / 2.4f) - 0.055f) : v;
+				fromLinearTable[i] = uint8_t(clamp(s * 255.0f + 0.5f, 0.0f, 255.0f));
+			}
+		}
+
+		float toLinear(uint8_t v) const
+		{
+			return toLinearTable[v];
+		}
+
+		uint8_t fromLinear(float v) const
+		{
+			return fromLinearTable[size_t(clamp(v, 0.0f, 1.0f) * 4095.0f + 0.5f)];
+		}
+
+	private:
+		std::array<float, 256> toLinearTable;
+		std::array<uint8_t, 4096> fromLinearTable;
+	};
+
+	void downsampleRows(const ColourSpace& cs, bool premultiplied, const Bytes& src, Vector2i srcSize, Bytes& dst, Vector2i dstSize, size_t y0, size_t y1)
+	{
+		for (int y = int(y0); y < int(y1); ++y) {
+			const int sy0 = std::min(2 * y, srcSize.y - 1);
+			const int sy1 = std::min(2 * y + 1, srcSize.y - 1);
+
+			for (int x = 0; x < dstSize.x; ++x) {
+				const int sx0 = std::min(2 * x, srcSize.x - 1);
+				const int sx1 = std::min(2 * x + 1, srcSize.x - 1);
+				const uint8_t* px[4] = {
+					&src[4 * (sx0 + sy0 * srcSize.x)],
+					&src[4 * (sx1 + sy0 * srcSize.x)],
+					&src[4 * (sx0 + sy1 * srcSize.x)],
+					&src[4 * (sx1 + sy1 * srcSize.x)]
+				};
+
+				// Weight straight colours by alpha, so transparent texels don't bleed into the result
+				float colour[3] = { 0, 0, 0 };
+				float unweighted[3] = { 0, 0, 0 };
+				float alpha = 0;
+				for (int i = 0; i < 4; ++i) {
+					const float a = float(px[i][3]) / 255.0f;
+					const float unpremultiply = premultiplied && px[i][3] > 0 ? 255.0f / float(px[i][3]) : 1.0f;
+					for (int c = 0; c < 3; ++c) {
+						const float v = cs.toLinear(uint8_t(std::min(255.0f, float(px[i][c]) * unpremultiply + 0.5f)));
+						colour[c] += v * a;
+						unweighted[c] += v;
+					}
+					alpha += a;
+				}
+
+				uint8_t* out = &dst[4 * (x + y * dstSize.x)];
+				const float outAlpha = alpha * 0.25f;
+				for (int c = 0; c < 3; ++c) {
+					const float v = alpha > 0 ? colour[c] / alpha : unweighted[c] * 0.25f;
+					const uint8_t s = cs.fromLinear(v);
+					out[c] = premultiplied ? uint8_t(float(s) * outAlpha + 0.5f) : s;
+				}
+				out[3] = uint8_t(outAlpha * 255.0f + 0.5f);
+			}
+		}
+	}
+}
+
+Vector<Bytes> MipMapGenerator::generate(const Image& src, int mipLevels, bool sRGB)
+{
+	if (src.getBytesPerPixel() != 4) {
+		throw Exception("Only RGBA images can have mipmaps generated.", HalleyExceptions::Tools);
+	}
+
+	const ColourSpace colourSpace(sRGB);
+	const bool premultiplied = src.getFormat() == Image::Format::RGBAPremultiplied;
+
+	Vector<Bytes> levels(size_t(std::max(mipLevels, 1)));
+	levels[0].resize(src.getByteSize());
+	memcpy(levels[0].data(), src.getPixels(), src.getByteSize());
+
+	for (size_t i = 1; i < levels.size(); ++i) {
+		const auto srcSize = TextureDescriptor::getMipLevelSize(src.getSize(), int(i - 1));
+		const auto dstSize = TextureDescriptor::getMipLevelSize(src.getSize(), int(i));
+		levels[i].resize(size_t(dstSize.x * dstSize.y * 4));
+
+		// Large levels are split by rows over the worker threads
+		const auto& prev = levels[i - 1];
+		auto& cur = levels[i];
+		Concurrent::parallelFor(Range<size_t>(0, size_t(dstSize.y)), std::max(size_t(1), size_t(16384 / dstSize.x)), [&] (size_t y0, size_t y1) {
+			downsampleRows(colourSpace, premultiplied, prev, srcSize, cur, dstSize, y0, y1);
+		});
+	}
+
+	return levels;
+}
+
+int MipMapGenerator::getMaxMipLevels(Vector2i size)
+{
+	int levels = 1;
+	while ((size.x >> levels) > 0 || (size.y >> levels) > 0) {
+		++levels;
+	}
+	return levels;
+}
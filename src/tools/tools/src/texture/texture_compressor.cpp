@@ -0,0 +1,631 @@
+#include "halley/tools/texture/texture_compressor.h"
+#include <halley/core/graphics/texture_descriptor.h>
+#include <halley/support/exception.h>
+#include <halley/concurrency/concurrent.h>
+#include <halley/concurrency/executor.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+using namespace Halley;
+
+namespace {
+	using Block = std::array<std::array<uint8_t, 4>, 16>; // Indexed by x + 4 * y
+	using Quality = TextureCompressionQuality;
+
+	template <typename T>
+	T clampTo(T v, T lo, T hi)
+	{
+		return std::max(lo, std::min(hi, v));
+	}
+
+	void writeLE(uint8_t* dst, uint64_t value, int bytes)
+	{
+		for (int i = 0; i < bytes; ++i) {
+			dst[i] = uint8_t(value >> (8 * i));
+		}
+	}
+
+	void writeBE(uint8_t* dst, uint64_t value)
+	{
+		for (int i = 0; i < 8; ++i) {
+			dst[i] = uint8_t(value >> (8 * (7 - i)));
+		}
+	}
+
+	////////////
+	// BC1/BC3
+
+	uint16_t toRGB565(const std::array<int, 3>& c)
+	{
+		return uint16_t(((c[0] >> 3) << 11) | ((c[1] >> 2) << 5) | (c[2] >> 3));
+	}
+
+	std::array<int, 3> fromRGB565(uint16_t v)
+	{
+		const int r = (v >> 11) & 31;
+		const int g = (v >> 5) & 63;
+		const int b = v & 31;
+		return {{ (r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2) }};
+	}
+
+	// Encodes with the given endpoints, returning the squared error over the opaque pixels
+	int encodeColourWith(const Block& block, bool hasTransparent, std::array<int, 3> hi, std::array<int, 3> lo, uint8_t* dst, std::array<int, 16>* indicesOut = nullptr)
+	{
+		uint16_t c0 = toRGB565(hi);
+		uint16_t c1 = toRGB565(lo);
+
+		// c0 > c1 selects four colour mode, c0 <= c1 three colours plus transparent black
+		if (hasTransparent ? c0 > c1 : c0 < c1) {
+			std::swap(c0, c1);
+		}
+		const bool fourColours = c0 > c1;
+
+		const auto e0 = fromRGB565(c0);
+		const auto e1 = fromRGB565(c1);
+		std::array<std::array<int, 3>, 4> palette;
+		palette[0] = e0;
+		palette[1] = e1;
+		for (int c = 0; c < 3; ++c) {
+			if (fourColours) {
+				palette[2][c] = (2 * e0[c] + e1[c]) / 3;
+				palette[3][c] = (e0[c] + 2 * e1[c]) / 3;
+			} else {
+				palette[2][c] = (e0[c] + e1[c]) / 2;
+				palette[3][c] = 0;
+			}
+		}
+
+		uint32_t indices = 0;
+		int error = 0;
+		for (int i = 0; i < 16; ++i) {
+			const auto& px = block[i];
+			int best = 0;
+			if (!fourColours && hasTransparent && px[3] < 128) {
+				best = 3;
+			} else {
+				int bestDist = std::numeric_limits<int>::max();
+				const int numCandidates = fourColours ? 4 : 3;
+				for (int j = 0; j < numCandidates; ++j) {
+					const int dr = px[0] - palette[j][0];
+					const int dg = px[1] - palette[j][1];
+					const int db = px[2] - palette[j][2];
+					const int dist = dr * dr + dg * dg + db * db;
+					if (dist < bestDist) {
+						bestDist = dist;
+						best = j;
+					}
+				}
+				error += bestDist;
+			}
+			indices |= uint32_t(best) << (2 * i);
+			if (indicesOut) {
+				(*indicesOut)[i] = fourColours ? best : -1;
+			}
+		}
+
+		writeLE(dst, c0, 2);
+		writeLE(dst + 2, c1, 2);
+		writeLE(dst + 4, indices, 4);
+		return error;
+	}
+
+	// Least squares fit of the endpoints to the pixels, given which palette entry each one picked. Four colour mode only.
+	bool refineEndpoints(const Block& block, const std::array<int, 16>& indices, std::array<int, 3>& hi, std::array<int, 3>& lo)
+	{
+		constexpr std::array<float, 4> weights = {{ 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f }};
+		float aa = 0, ab = 0, bb = 0;
+		std::array<float, 3> ap = {{ 0, 0, 0 }};
+		std::array<float, 3> bp = {{ 0, 0, 0 }};
+		for (int i = 0; i < 16; ++i) {
+			if (indices[i] < 0) {
+				return false;
+			}
+			const float a = weights[indices[i]];
+			const float b = 1.0f - a;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (int c = 0; c < 3; ++c) {
+				ap[c] += a * block[i][c];
+				bp[c] += b * block[i][c];
+			}
+		}
+
+		const float det = aa * bb - ab * ab;
+		if (std::abs(det) < 0.0001f) {
+			return false;
+		}
+		for (int c = 0; c < 3; ++c) {
+			hi[c] = clampTo(int(lround((ap[c] * bb - bp[c] * ab) / det)), 0, 255);
+			lo[c] = clampTo(int(lround((bp[c] * aa - ap[c] * ab) / det)), 0, 255);
+		}
+		return true;
+	}
+
+	void encodeColour(const Block& block, bool allowTransparent, Quality quality, uint8_t* dst)
+	{
+		std::array<int, 3> minC = {{ 255, 255, 255 }};
+		std::array<int, 3> maxC = {{ 0, 0, 0 }};
+		std::array<float, 3> mean = {{ 0, 0, 0 }};
+		int nOpaque = 0;
+		bool hasTransparent = false;
+		for (auto& px: block) {
+			if (allowTransparent && px[3] < 128) {
+				hasTransparent = true;
+				continue;
+			}
+			for (int c = 0; c < 3; ++c) {
+				minC[c] = std::min(minC[c], int(px[c]));
+				maxC[c] = std::max(maxC[c], int(px[c]));
+				mean[c] += px[c];
+			}
+			++nOpaque;
+		}
+		if (nOpaque == 0) {
+			// Fully transparent
+			encodeColourWith(block, true, {{ 0, 0, 0 }}, {{ 0, 0, 0 }}, dst);
+			return;
+		}
+
+		// Bounding box of the block's colours, inset slightly to reduce the error at the extremes
+		std::array<int, 3> hi;
+		std::array<int, 3> lo;
+		for (int c = 0; c < 3; ++c) {
+			const int inset = (maxC[c] - minC[c]) / 16;
+			hi[c] = maxC[c] - inset;
+			lo[c] = minC[c] + inset;
+		}
+		int bestError = encodeColourWith(block, hasTransparent, hi, lo, dst);
+		if (quality == Quality::Fast || bestError == 0) {
+			return;
+		}
+
+		// Along the principal axis of the colours, found by power iteration on their covariance
+		for (auto& m: mean) {
+			m /= float(nOpaque);
+		}
+		std::array<float, 6> cov = {{ 0, 0, 0, 0, 0, 0 }}; // rr, rg, rb, gg, gb, bb
+		for (auto& px: block) {
+			if (allowTransparent && px[3] < 128) {
+				continue;
+			}
+			const float r = px[0] - mean[0];
+			const float g = px[1] - mean[1];
+			const float b = px[2] - mean[2];
+			cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+			cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+		}
+		std::array<float, 3> axis = {{ float(maxC[0] - minC[0]), float(maxC[1] - minC[1]), float(maxC[2] - minC[2]) }};
+		for (int iter = 0; iter < 8; ++iter) {
+			const std::array<float, 3> next = {{
+				cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+				cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+				cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2]
+			}};
+			const float len = std::max(std::abs(next[0]), std::max(std::abs(next[1]), std::abs(next[2])));
+			if (len < 0.0001f) {
+				break;
+			}
+			axis = {{ next[0] / len, next[1] / len, next[2] / len }};
+		}
+
+		float minProj = std::numeric_limits<float>::max();
+		float maxProj = -std::numeric_limits<float>::max();
+		for (auto& px: block) {
+			if (allowTransparent && px[3] < 128) {
+				continue;
+			}
+			const float proj = (px[0] - mean[0]) * axis[0] + (px[1] - mean[1]) * axis[1] + (px[2] - mean[2]) * axis[2];
+			minProj = std::min(minProj, proj);
+			maxProj = std::max(maxProj, proj);
+		}
+		const float axisLenSq = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+		if (axisLenSq > 0.0001f) {
+			for (int c = 0; c < 3; ++c) {
+				hi[c] = clampTo(int(lround(mean[c] + axis[c] * maxProj / axisLenSq)), 0, 255);
+				lo[c] = clampTo(int(lround(mean[c] + axis[c] * minProj / axisLenSq)), 0, 255);
+			}
+		}
+
+		std::array<uint8_t, 8> candidate;
+		std::array<int, 16> indices;
+		int error = encodeColourWith(block, hasTransparent, hi, lo, candidate.data(), &indices);
+		if (error < bestError) {
+			bestError = error;
+			memcpy(dst, candidate.data(), 8);
+		}
+
+		// Refined to fit the pixels assigned to each palette entry
+		if (quality == Quality::High) {
+			for (int iter = 0; iter < 2 && bestError > 0; ++iter) {
+				if (!refineEndpoints(block, indices, hi, lo)) {
+					break;
+				}
+				error = encodeColourWith(block, hasTransparent, hi, lo, candidate.data(), &indices);
+				if (error >= bestError) {
+					break;
+				}
+				bestError = error;
+				memcpy(dst, candidate.data(), 8);
+			}
+		}
+	}
+
+	void encodeBCAlpha(const Block& block, uint8_t* dst)
+	{
+		uint8_t a0 = 0;
+		uint8_t a1 = 255;
+		for (auto& px: block) {
+			a0 = std::max(a0, px[3]);
+			a1 = std::min(a1, px[3]);
+		}
+
+		// a0 > a1 selects the eight value mode; if they're equal, every index picks a0 anyway
+		std::array<int, 8> palette;
+		palette[0] = a0;
+		palette[1] = a1;
+		for (int i = 1; i < 7; ++i) {
+			palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+		}
+
+		uint64_t indices = 0;
+		for (int i = 0; i < 16; ++i) {
+			int best = 0;
+			int bestDist = std::numeric_limits<int>::max();
+			for (int j = 0; j < 8; ++j) {
+				const int dist = std::abs(int(block[i][3]) - palette[j]);
+				if (dist < bestDist) {
+					bestDist = dist;
+					best = j;
+				}
+			}
+			indices |= uint64_t(best) << (3 * i);
+		}
+
+		dst[0] = a0;
+		dst[1] = a1;
+		writeLE(dst + 2, indices, 6);
+	}
+
+	////////////
+	// ETC2 (RGBA8 with EAC alpha). Colour only uses the ETC1 compatible modes.
+
+	// Pixels are numbered down each column in ETC, i.e. x * 4 + y
+	int etcPixelIndex(int blockIndex)
+	{
+		return (blockIndex % 4) * 4 + blockIndex / 4;
+	}
+
+	constexpr int etcModifiers[8][2] = {{ 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }};
+
+	struct EtcSubblockFit
+	{
+		int error = std::numeric_limits<int>::max();
+		int table = 0;
+		std::array<int, 8> selectors;
+	};
+
+	EtcSubblockFit fitEtcSubblock(const Block& block, const std::array<int, 8>& pixels, const std::array<int, 3>& base)
+	{
+		EtcSubblockFit result;
+		for (int t = 0; t < 8; ++t) {
+			EtcSubblockFit cur;
+			cur.table = t;
+			cur.error = 0;
+			for (int k = 0; k < 8 && cur.error < result.error; ++k) {
+				const auto& px = block[pixels[k]];
+				int bestDist = std::numeric_limits<int>::max();
+				for (int s = 0; s < 4; ++s) {
+					// Selector bits are (negative, large)
+					const int mod = (s & 2 ? -1 : 1) * etcModifiers[t][s & 1];
+					int dist = 0;
+					for (int c = 0; c < 3; ++c) {
+						const int d = int(px[c]) - clampTo(base[c] + mod, 0, 255);
+						dist += d * d;
+					}
+					if (dist < bestDist) {
+						bestDist = dist;
+						cur.selectors[k] = s;
+					}
+				}
+				cur.error += bestDist;
+			}
+			if (cur.error < result.error) {
+				result = cur;
+			}
+		}
+		return result;
+	}
+
+	int expand4(int v) { return (v << 4) | v; }
+	int expand5(int v) { return (v << 3) | (v >> 2); }
+
+	// Best quantised base colour for a subblock, searching around its average
+	std::pair<std::array<int, 3>, EtcSubblockFit> fitEtcBase(const Block& block, const std::array<int, 8>& pixels, const std::array<float, 3>& avg, int bits, int searchRadius)
+	{
+		const int maxQ = (1 << bits) - 1;
+		std::array<int, 3> centre;
+		for (int c = 0; c < 3; ++c) {
+			centre[c] = clampTo(int(lround(avg[c] * maxQ / 255.0f)), 0, maxQ);
+		}
+
+		std::pair<std::array<int, 3>, EtcSubblockFit> best;
+		for (int dr = -searchRadius; dr <= searchRadius; ++dr) {
+			for (int dg = -searchRadius; dg <= searchRadius; ++dg) {
+				for (int db = -searchRadius; db <= searchRadius; ++db) {
+					const std::array<int, 3> q = {{ clampTo(centre[0] + dr, 0, maxQ), clampTo(centre[1] + dg, 0, maxQ), clampTo(centre[2] + db, 0, maxQ) }};
+					std::array<int, 3> base;
+					for (int c = 0; c < 3; ++c) {
+						base[c] = bits == 4 ? expand4(q[c]) : expand5(q[c]);
+					}
+					auto fit = fitEtcSubblock(block, pixels, base);
+					if (fit.error < best.second.error) {
+						best = std::make_pair(q, fit);
+					}
+				}
+			}
+		}
+		return best;
+	}
+
+	void encodeEtcColour(const Block& block, Quality quality, uint8_t* dst)
+	{
+		const int searchRadius = quality == Quality::High ? 1 : 0;
+		int bestError = std::numeric_limits<int>::max();
+		uint64_t bestBits = 0;
+
+		for (int flip = 0; flip < 2; ++flip) {
+			// Not flipped, the subblocks are the left and right halves; flipped, the top and bottom ones
+			std::array<std::array<int, 8>, 2> pixels;
+			std::array<std::array<float, 3>, 2> avg = {{ {{ 0, 0, 0 }}, {{ 0, 0, 0 }} }};
+			std::array<int, 2> n = {{ 0, 0 }};
+			for (int i = 0; i < 16; ++i) {
+				const int x = i % 4;
+				const int y = i / 4;
+				const int sub = flip ? (y >= 2 ? 1 : 0) : (x >= 2 ? 1 : 0);
+				pixels[sub][n[sub]++] = i;
+				for (int c = 0; c < 3; ++c) {
+					avg[sub][c] += block[i][c] / 8.0f;
+				}
+			}
+
+			// Individual mode, with each base colour in 4 bits
+			{
+				const auto fit0 = fitEtcBase(block, pixels[0], avg[0], 4, searchRadius);
+				const auto fit1 = fitEtcBase(block, pixels[1], avg[1], 4, searchRadius);
+				const int error = fit0.second.error + fit1.second.error;
+				if (error < bestError) {
+					bestError = error;
+					const auto& q0 = fit0.first;
+					const auto& q1 = fit1.first;
+					uint64_t hi = (uint64_t(q0[0]) << 28) | (uint64_t(q1[0]) << 24) | (uint64_t(q0[1]) << 20) | (uint64_t(q1[1]) << 16) | (uint64_t(q0[2]) << 12) | (uint64_t(q1[2]) << 8)
+						| (uint64_t(fit0.second.table) << 5) | (uint64_t(fit1.second.table) << 2) | uint64_t(flip);
+					uint64_t lo = 0;
+					for (int sub = 0; sub < 2; ++sub) {
+						const auto& fit = sub == 0 ? fit0.second : fit1.second;
+						for (int k = 0; k < 8; ++k) {
+							const int p = etcPixelIndex(pixels[sub][k]);
+							lo |= uint64_t(fit.selectors[k] >> 1) << (p + 16);
+							lo |= uint64_t(fit.selectors[k] & 1) << p;
+						}
+					}
+					bestBits = (hi << 32) | lo;
+				}
+			}
+
+			// Differential mode, with 5 bit base colours no more than 3 bits apart. Anything further apart would
+			// select one of the other ETC2 modes, so those are left out.
+			{
+				const auto fit0 = fitEtcBase(block, pixels[0], avg[0], 5, searchRadius);
+				const auto fit1 = fitEtcBase(block, pixels[1], avg[1], 5, searchRadius);
+				const auto& q0 = fit0.first;
+				const auto& q1 = fit1.first;
+				bool fits = true;
+				for (int c = 0; c < 3; ++c) {
+					const int d = q1[c] - q0[c];
+					fits = fits && d >= -4 && d <= 3;
+				}
+				const int error = fit0.second.error + fit1.second.error;
+				if (fits && error < bestError) {
+					bestError = error;
+					uint64_t hi = (uint64_t(q0[0]) << 27) | (uint64_t((q1[0] - q0[0]) & 7) << 24) | (uint64_t(q0[1]) << 19) | (uint64_t((q1[1] - q0[1]) & 7) << 16)
+						| (uint64_t(q0[2]) << 11) | (uint64_t((q1[2] - q0[2]) & 7) << 8)
+						| (uint64_t(fit0.second.table) << 5) | (uint64_t(fit1.second.table) << 2) | (1ull << 1) | uint64_t(flip);
+					uint64_t lo = 0;
+					for (int sub = 0; sub < 2; ++sub) {
+						const auto& fit = sub == 0 ? fit0.second : fit1.second;
+						for (int k = 0; k < 8; ++k) {
+							const int p = etcPixelIndex(pixels[sub][k]);
+							lo |= uint64_t(fit.selectors[k] >> 1) << (p + 16);
+							lo |= uint64_t(fit.selectors[k] & 1) << p;
+						}
+					}
+					bestBits = (hi << 32) | lo;
+				}
+			}
+		}
+
+		writeBE(dst, bestBits);
+	}
+
+	constexpr int eacModifiers[16][8] = {
+		{ -3, -6, -9, -15, 2, 5, 8, 14 },
+		{ -3, -7, -10, -13, 2, 6, 9, 12 },
+		{ -2, -5, -8, -13, 1, 4, 7, 12 },
+		{ -2, -4, -6, -13, 1, 3, 5, 12 },
+		{ -3, -6, -8, -12, 2, 5, 7, 11 },
+		{ -3, -7, -9, -11, 2, 6, 8, 10 },
+		{ -4, -7, -8, -11, 3, 6, 7, 10 },
+		{ -3, -5, -8, -11, 2, 4, 7, 10 },
+		{ -2, -6, -8, -10, 1, 5, 7, 9 },
+		{ -2, -5, -8, -10, 1, 4, 7, 9 },
+		{ -2, -4, -8, -10, 1, 3, 7, 9 },
+		{ -2, -5, -7, -10, 1, 4, 6, 9 },
+		{ -3, -4, -7, -10, 2, 3, 6, 9 },
+		{ -1, -2, -3, -10, 0, 1, 2, 9 },
+		{ -4, -6, -8, -9, 3, 5, 7, 8 },
+		{ -3, -5, -7, -9, 2, 4, 6, 8 }
+	};
+
+	void encodeEacAlpha(const Block& block, Quality quality, uint8_t* dst)
+	{
+		int minA = 255;
+		int maxA = 0;
+		for (auto& px: block) {
+			minA = std::min(minA, int(px[3]));
+			maxA = std::max(maxA, int(px[3]));
+		}
+
+		if (minA == maxA) {
+			// A multiplier of zero gives the base value everywhere
+			writeBE(dst, uint64_t(minA) << 56);
+			return;
+		}
+
+		const int multRadius = quality == Quality::Fast ? 0 : 1;
+		const int baseRadius = quality == Quality::High ? 2 : 0;
+
+		int bestError = std::numeric_limits<int>::max();
+		uint64_t bestBits = 0;
+		for (int t = 0; t < 16; ++t) {
+			const int tableMin = eacModifiers[t][3];
+			const int tableMax = eacModifiers[t][7];
+			const int centreMult = clampTo(int(lround(float(maxA - minA) / float(tableMax - tableMin))), 1, 15);
+
+			for (int mult = std::max(1, centreMult - multRadius); mult <= std::min(15, centreMult + multRadius); ++mult) {
+				const int centreBase = int(lround((minA + maxA) * 0.5f - (tableMin + tableMax) * mult * 0.5f));
+				for (int base = centreBase - baseRadius; base <= centreBase + baseRadius; ++base) {
+					if (base < 0 || base > 255) {
+						continue;
+					}
+
+					int error = 0;
+					uint64_t indices = 0;
+					for (int i = 0; i < 16 && error < bestError; ++i) {
+						const int a = block[i][3];
+						int bestDist = std::numeric_limits<int>::max();
+						int best = 0;
+						for (int j = 0; j < 8; ++j) {
+							const int d = a - clampTo(base + eacModifiers[t][j] * mult, 0, 255);
+							if (d * d < bestDist) {
+								bestDist = d * d;
+								best = j;
+							}
+						}
+						error += bestDist;
+						indices |= uint64_t(best) << (45 - 3 * etcPixelIndex(i));
+					}
+
+					if (error < bestError) {
+						bestError = error;
+						bestBits = (uint64_t(base) << 56) | (uint64_t(mult) << 52) | (uint64_t(t) << 48) | indices;
+					}
+				}
+			}
+		}
+
+		writeBE(dst, bestBits);
+	}
+
+	////////////
+
+	size_t getBlockBytes(TextureFormat format)
+	{
+		return format == TextureFormat::BC1 ? 8 : 16;
+	}
+
+	void encodeBlock(const Block& block, TextureFormat format, Quality quality, uint8_t* dst)
+	{
+		switch (format) {
+		case TextureFormat::BC1:
+			encodeColour(block, true, quality, dst);
+			break;
+		case TextureFormat::BC3:
+			encodeBCAlpha(block, dst);
+			encodeColour(block, false, quality, dst + 8);
+			break;
+		case TextureFormat::ETC2:
+			encodeEacAlpha(block, quality, dst);
+			encodeEtcColour(block, quality, dst + 8);
+			break;
+		default:
+			break;
+		}
+	}
+
+	void encodeLevel(const uint8_t* px, Vector2i size, TextureFormat format, Quality quality, uint8_t* dst)
+	{
+		const int blocksX = (size.x + 3) / 4;
+		const int blocksY = (size.y + 3) / 4;
+		const size_t blockBytes = getBlockBytes(format);
+
+		auto encodeRows = [&] (size_t start, size_t end)
+		{
+			for (int by = int(start); by < int(end); ++by) {
+				for (int bx = 0; bx < blocksX; ++bx) {
+					// Blocks overhanging the edge repeat the last row/column
+					Block block;
+					for (int y = 0; y < 4; ++y) {
+						for (int x = 0; x < 4; ++x) {
+							const int sx = std::min(bx * 4 + x, size.x - 1);
+							const int sy = std::min(by * 4 + y, size.y - 1);
+							const uint8_t* src = px + 4 * (sx + sy * size.x);
+							block[x + 4 * y] = {{ src[0], src[1], src[2], src[3] }};
+						}
+					}
+					encodeBlock(block, format, quality, dst + (size_t(by) * blocksX + bx) * blockBytes);
+				}
+			}
+		};
+
+		if (Executors::hasInstance()) {
+			Concurrent::parallelFor(Executors::getCPUAux(), Range<size_t>(0, size_t(blocksY)), 4, encodeRows);
+		} else {
+			encodeRows(0, size_t(blocksY));
+		}
+	}
+}
+
+bool TextureCompressor::canEncode(TextureFormat format)
+{
+	return format == TextureFormat::BC1 || format == TextureFormat::BC3 || format == TextureFormat::ETC2;
+}
+
+Bytes TextureCompressor::compress(const Vector<Bytes>& levels, Vector2i size, TextureFormat format, TextureCompressionQuality quality)
+{
+	if (!canEncode(format)) {
+		throw Exception("Unable to encode textures to " + toString(format) + ", only bc1, bc3 and etc2 are supported.", HalleyExceptions::Tools);
+	}
+
+	size_t totalSize = 0;
+	for (size_t i = 0; i < levels.size(); ++i) {
+		const auto levelSize = TextureDescriptor::getMipLevelSize(size, int(i));
+		if (levels[i].size() != size_t(levelSize.x * levelSize.y * 4)) {
+			throw Exception("Mip level " + toString(i) + " is not RGBA of the expected size.", HalleyExceptions::Tools);
+		}
+		totalSize += size_t((levelSize.x + 3) / 4) * size_t((levelSize.y + 3) / 4) * getBlockBytes(format);
+	}
+
+	Bytes result(totalSize);
+	size_t pos = 0;
+	for (size_t i = 0; i < levels.size(); ++i) {
+		const auto levelSize = TextureDescriptor::getMipLevelSize(size, int(i));
+		encodeLevel(levels[i].data(), levelSize, format, quality, result.data() + pos);
+		pos += size_t((levelSize.x + 3) / 4) * size_t((levelSize.y + 3) / 4) * getBlockBytes(format);
+	}
+	return result;
+}
+
+TextureFormat TextureCompressor::pickBCFormat(const Bytes& rgba)
+{
+	for (size_t i = 3; i < rgba.size(); i += 4) {
+		if (rgba[i] != 0 && rgba[i] != 255) {
+			return TextureFormat::BC3;
+		}
+	}
+	return TextureFormat::BC1;
+}
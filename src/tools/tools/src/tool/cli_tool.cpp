@@ -4,6 +4,7 @@
 #include "halley/tools/distance_field/distance_field_tool.h"
 #include "halley/tools/make_font/make_font_tool.h"
 #include "halley/tools/assets/import_tool.h"
+#include "halley/tools/assets/import_worker_tool.h"
 #include "halley/tools/packer/asset_packer_tool.h"
 #include "halley/support/logger.h"
 #include "halley/core/game/halley_statics.h"
@@ -15,6 +16,7 @@ using namespace Halley;
 CommandLineTools::CommandLineTools()
 {
 	factories["import"] = []() { return std::make_unique<ImportTool>(); };
+	factories["importWorker"] = []() { return std::make_unique<ImportWorkerTool>(); };
 	factories["codegen"] = []() { return std::make_unique<CodegenTool>(); };
 	factories["distField"] = []() { return std::make_unique<DistanceFieldTool>(); };
 	factories["makeFont"] = []() { return std::make_unique<MakeFontTool>(); };
@@ -65,7 +67,9 @@ int CommandLineTool::runRaw(int argc, char** argv)
 	statics = std::make_unique<HalleyStatics>();
 	statics->resume(nullptr);
 	StdOutSink logSink(true);
-	Logger::addSink(logSink);
+	if (shouldLogToStdOut()) {
+		Logger::addSink(logSink);
+	}
 	env.parseProgramPath(argv[0]);
 
 	return run(args);